@@ -88,6 +88,9 @@ aql_clear(aql_adt_t *adt)
   adt->value_count = 0;
   adt->flags = 0;
   memset(adt->aggregators, 0, sizeof(adt->aggregators));
+#if DB_FEATURE_PREPARE
+  adt->parameter_count = 0;
+#endif /* DB_FEATURE_PREPARE */
 }
 
 db_result_t
@@ -48,9 +48,40 @@
 #include "relation.h"
 #include "result.h"
 #include "aql.h"
+#include "lvm.h"
+
+#if DB_FEATURE_PREPARE
+#include "lib/crc16.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#endif /* DB_FEATURE_PREPARE */
 
 static aql_adt_t adt;
 
+#if DB_FEATURE_PREPARE
+/*
+ * A prepared statement keeps the parsed query and the LVM code of its
+ * condition. Statements are cached by the hash of the query text, so
+ * that preparing the same query again does not parse it. Statements
+ * that are not in use stay in the cache until their memory is needed.
+ */
+struct db_statement {
+  struct db_statement *next;
+  aql_adt_t adt;
+  lvm_instance_t lvm_instance;
+  unsigned char vmcode[DB_VM_BYTECODE_SIZE];
+  /* The attributes that the LVM variables are bound to, by variable ID. */
+  uint8_t variables[LVM_MAX_VARIABLE_ID];
+  uint8_t variable_count;
+  uint8_t users;
+  uint16_t hash;
+  char query[AQL_MAX_QUERY_LENGTH];
+};
+
+LIST(statements);
+MEMB(statements_memb, db_statement_t, DB_STATEMENT_POOL_SIZE);
+#endif /* DB_FEATURE_PREPARE */
+
 static void
 clear_handle(db_handle_t *handle)
 {
@@ -205,11 +236,168 @@ db_query(db_handle_t *handle, const char *format, ...)
     return DB_PARSING_ERROR;
   }
 
+#if DB_FEATURE_PREPARE
+  if(adt.parameter_count > 0) {
+    /* Placeholders need values from db_execute(). */
+    return DB_ARGUMENT_ERROR;
+  }
+#endif /* DB_FEATURE_PREPARE */
+
   /*aql_optimize(&adt);*/
 
   return aql_execute(handle, &adt);
 }
 
+#if DB_FEATURE_PREPARE
+static db_statement_t *
+allocate_statement(void)
+{
+  db_statement_t *statement;
+  db_statement_t *unused;
+
+  statement = memb_alloc(&statements_memb);
+  if(statement != NULL) {
+    return statement;
+  }
+
+  /* Evict the least recently prepared statement that is not in use. */
+  unused = NULL;
+  for(statement = list_head(statements);
+      statement != NULL;
+      statement = statement->next) {
+    if(statement->users == 0) {
+      unused = statement;
+    }
+  }
+
+  if(unused != NULL) {
+    list_remove(statements, unused);
+  }
+  return unused;
+}
+
+db_statement_t *
+db_prepare(const char *query)
+{
+  db_statement_t *statement;
+  uint16_t hash;
+  lvm_instance_t *lvm_instance;
+  char *name;
+  int i;
+
+  if(strlen(query) >= AQL_MAX_QUERY_LENGTH) {
+    return NULL;
+  }
+
+  hash = crc16_data((const unsigned char *)query, strlen(query), 0);
+  for(statement = list_head(statements);
+      statement != NULL;
+      statement = statement->next) {
+    if(statement->hash == hash && strcmp(statement->query, query) == 0) {
+      list_remove(statements, statement);
+      list_push(statements, statement);
+      statement->users++;
+      return statement;
+    }
+  }
+
+  statement = allocate_statement();
+  if(statement == NULL) {
+    PRINTF("DB: No room for a prepared query\n");
+    return NULL;
+  }
+
+  strcpy(statement->query, query);
+  if(AQL_ERROR(aql_parse(&statement->adt, statement->query))) {
+    memb_free(&statements_memb, statement);
+    return NULL;
+  }
+
+  for(i = 0; i < statement->adt.value_count; i++) {
+    if(statement->adt.values[i].domain == DOMAIN_STRING) {
+      /* The parser keeps strings only until the next query is parsed. */
+      PRINTF("DB: Prepared queries cannot have string values\n");
+      memb_free(&statements_memb, statement);
+      return NULL;
+    }
+  }
+
+  statement->variable_count = 0;
+  lvm_instance = statement->adt.lvm_instance;
+  if(lvm_instance != NULL) {
+    lvm_clone(&statement->lvm_instance, lvm_instance);
+    memcpy(statement->vmcode, lvm_instance->code, sizeof(statement->vmcode));
+    statement->lvm_instance.code = statement->vmcode;
+    statement->adt.lvm_instance = &statement->lvm_instance;
+
+    /* All variables in the condition are also attributes of the query. */
+    while((name = lvm_get_variable_name(statement->variable_count)) != NULL) {
+      for(i = 0; i < statement->adt.attribute_count; i++) {
+        if(strcmp(statement->adt.attributes[i].name, name) == 0) {
+          break;
+        }
+      }
+      if(i == statement->adt.attribute_count) {
+        memb_free(&statements_memb, statement);
+        return NULL;
+      }
+      statement->variables[statement->variable_count++] = i;
+    }
+  }
+
+  statement->hash = hash;
+  statement->users = 1;
+  list_push(statements, statement);
+
+  return statement;
+}
+
+db_result_t
+db_execute(db_handle_t *handle, db_statement_t *statement, ...)
+{
+  va_list ap;
+  int i;
+  long value;
+
+  if(handle != NULL) {
+    clear_handle(handle);
+  }
+
+  memcpy(&adt, &statement->adt, sizeof(adt));
+
+  va_start(ap, statement);
+  for(i = 0; i < adt.parameter_count; i++) {
+    value = va_arg(ap, long);
+    if(adt.lvm_instance != NULL) {
+      lvm_bind_parameter(adt.lvm_instance, adt.parameters[i], value);
+    } else {
+      VALUE_LONG(&adt.values[adt.parameters[i]]) = value;
+    }
+  }
+  va_end(ap);
+
+  if(adt.lvm_instance != NULL) {
+    /* Other queries may have been parsed since this one,
+       so register its variables again in the same order. */
+    lvm_clear_variables();
+    for(i = 0; i < statement->variable_count; i++) {
+      lvm_register_variable(adt.attributes[statement->variables[i]].name,
+                            LVM_LONG);
+    }
+  }
+
+  return aql_execute(handle, &adt);
+}
+
+void
+db_finalize(db_statement_t *statement)
+{
+  if(statement->users > 0) {
+    statement->users--;
+  }
+}
+#endif /* DB_FEATURE_PREPARE */
+
 db_result_t
 db_process(db_handle_t *handle)
 {
@@ -63,6 +63,7 @@ static const struct keyword keywords[] = {
   {"-", SUB},
   {"*", MUL},
   {"/", DIV},
+  {"?", PARAMETER},
   {"#", COMMENT},
 
   {">=", GEQ},
@@ -91,6 +92,7 @@ static const struct keyword keywords[] = {
   {"WHERE", WHERE},
   {"COUNT", COUNT},
   {"INDEX", INDEX},
+  {"BTREE", BTREE},
 
   {"INSERT", INSERT},
   {"SELECT", SELECT},
@@ -111,7 +113,7 @@ static const struct keyword keywords[] = {
 };
 
 /* Provides a pointer to the first keyword of a specific length. */
-static const int8_t skip_hint[] = {0, 13, 21, 27, 33, 36, 44, 47, 48};
+static const int8_t skip_hint[] = {0, 14, 22, 28, 34, 38, 46, 49, 50};
 
 static char separators[] = "#.;,() \t\n";
 
@@ -250,6 +250,17 @@ PARSER(values)
   case INTEGER_VALUE:
     AQL_ADD_VALUE(adt, DOMAIN_INT, VALUE);
     break;
+#if DB_FEATURE_PREPARE
+  case PARAMETER:
+    if(adt->parameter_count == AQL_PARAMETER_LIMIT ||
+       adt->value_count == AQL_ATTRIBUTE_LIMIT) {
+      RETURN(SYNTAX_ERROR);
+    }
+    adt->parameters[adt->parameter_count++] = adt->value_count;
+    *(long *)lexer->value = 0;
+    AQL_ADD_VALUE(adt, DOMAIN_INT, VALUE);
+    break;
+#endif /* DB_FEATURE_PREPARE */
   default:
     RETURN(SYNTAX_ERROR);
   }
@@ -280,6 +291,14 @@ PARSER(operand)
   case INTEGER_VALUE:
     lvm_set_long(&p, *(long *)lexer->value);
     break;
+#if DB_FEATURE_PREPARE
+  case PARAMETER:
+    if(adt->parameter_count == AQL_PARAMETER_LIMIT) {
+      RETURN(SYNTAX_ERROR);
+    }
+    lvm_set_parameter(&p, adt->parameter_count++);
+    break;
+#endif /* DB_FEATURE_PREPARE */
   default:
     RETURN(SYNTAX_ERROR);
   }
@@ -645,6 +664,9 @@ PARSER_TOKEN(index_type)
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
+  case BTREE:
+    type = INDEX_BTREE;
+    break;
   default:
     return NONE;
   };
@@ -847,6 +869,24 @@ aql_parse(aql_adt_t *external_adt, char *input_string)
     }
   }
 
+#if DB_FEATURE_PREPARE
+  /* The placeholders in a condition can be located only in the
+     complete code, since operators are inserted before their operands. */
+  if(!AQL_ERROR(result) && adt->lvm_instance != NULL) {
+    lvm_ip_t ip;
+    int i;
+
+    for(i = 0; i < adt->parameter_count; i++) {
+      ip = lvm_get_parameter(&p, i);
+      if(ip < 0) {
+        result = SYNTAX_ERROR;
+        break;
+      }
+      adt->parameters[i] = ip;
+    }
+  }
+#endif /* DB_FEATURE_PREPARE */
+
   if(AQL_ERROR(result)) {
     PRINTF("Error in function %s, line %d: input \"%s\"\n",
 	   error_function, error_line, error_message);
@@ -104,6 +104,8 @@ enum token {
   MEMHASH = 46,
   RELATION = 47,
   ATTRIBUTE = 48,
+  BTREE = 49,
+  PARAMETER = 50,
 
   INTEGER_VALUE = 251,
   FLOAT_VALUE = 252,
@@ -157,6 +159,12 @@ struct aql_adt {
   uint8_t optype;
   uint8_t flags;
   void *lvm_instance;
+#if DB_FEATURE_PREPARE
+  /* The places of the "?" placeholders: value indexes in an INSERT,
+     and LVM code offsets in a condition. */
+  uint16_t parameters[AQL_PARAMETER_LIMIT];
+  uint8_t parameter_count;
+#endif /* DB_FEATURE_PREPARE */
 };
 typedef struct aql_adt aql_adt_t;
 
@@ -218,4 +226,12 @@ db_result_t aql_add_value(aql_adt_t *adt, domain_t domain, void *value);
 db_result_t db_query(db_handle_t *handle, const char *format, ...);
 db_result_t db_process(db_handle_t *handle);
 
+#if DB_FEATURE_PREPARE
+typedef struct db_statement db_statement_t;
+
+db_statement_t *db_prepare(const char *query);
+db_result_t db_execute(db_handle_t *handle, db_statement_t *statement, ...);
+void db_finalize(db_statement_t *statement);
+#endif /* DB_FEATURE_PREPARE */
+
 #endif /* !AQL_H */
@@ -69,6 +69,12 @@
 #define DB_FEATURE_INTEGRITY		0
 #endif /* DB_FEATURE_INTEGRITY */
 
+/* Support prepared queries, which are parsed once by db_prepare() and
+   then run by db_execute() with values for their "?" placeholders. */
+#ifndef DB_FEATURE_PREPARE
+#define DB_FEATURE_PREPARE		0
+#endif /* DB_FEATURE_PREPARE */
+
 /*----------------------------------------------------------------------------*/
 
 /* Configuration parameters that may be trimmed to save space. */
@@ -93,6 +99,11 @@
 #define DB_ATTRIBUTE_POOL_SIZE		16
 #endif /* DB_ATTRIBUTE_POOL_SIZE */
 
+/* The maximum number of prepared queries kept in memory. */
+#ifndef DB_STATEMENT_POOL_SIZE
+#define DB_STATEMENT_POOL_SIZE		2
+#endif /* DB_STATEMENT_POOL_SIZE */
+
 /* The maximum number of attributes in a relation. */
 #ifndef DB_MAX_ATTRIBUTES_PER_RELATION
 #define DB_MAX_ATTRIBUTES_PER_RELATION	6
@@ -133,6 +144,11 @@
 #define AQL_ATTRIBUTE_LIMIT    		5
 #endif /* AQL_ATTRIBUTE_LIMIT */
 
+/* The maximum number of placeholders in a prepared query. */
+#ifndef AQL_PARAMETER_LIMIT
+#define AQL_PARAMETER_LIMIT    		3
+#endif /* AQL_PARAMETER_LIMIT */
+
 /*----------------------------------------------------------------------------*/
 
 /*
@@ -178,6 +194,15 @@
 #define REMOVE_RELATION			"db-remove"
 #endif /* REMOVE_RELATION */
 
+/* The size of a buffer into which a selection without a usable index
+   reads as many tuples as fit at a time. The tuples of the buffer are
+   then evaluated in one call of db_process(), which returns DB_OK only
+   if none of them matched the condition. Set to 0 to read and process
+   one tuple per call. */
+#ifndef DB_SCAN_BUFFER_SIZE
+#define DB_SCAN_BUFFER_SIZE		0
+#endif /* DB_SCAN_BUFFER_SIZE */
+
 /*----------------------------------------------------------------------------*/
 
 /* Index options. */
@@ -206,6 +231,28 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BTREE_INDEX_LIMIT
+#define DB_BTREE_INDEX_LIMIT		1
+#endif /* DB_BTREE_INDEX_LIMIT */
+
+/* The maximum number of nodes cached in the B+-tree indexes. */
+#ifndef DB_BTREE_CACHE_LIMIT
+#define DB_BTREE_CACHE_LIMIT		2
+#endif /* DB_BTREE_CACHE_LIMIT */
+
+/* The size of a B+-tree node in bytes. */
+#ifndef DB_BTREE_NODE_SIZE
+#define DB_BTREE_NODE_SIZE		256
+#endif /* DB_BTREE_NODE_SIZE */
+
+/* The file size to reserve for a B+-tree index. Nodes are replaced
+   rather than rewritten, so the file must leave room for the nodes
+   that replace full ones. */
+#ifndef DB_BTREE_FILE_SIZE
+#define DB_BTREE_FILE_SIZE		(128 * 1024UL)
+#endif /* DB_BTREE_FILE_SIZE */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
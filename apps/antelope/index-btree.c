@@ -0,0 +1,826 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *     A B+-tree index for flash memory.
+ *
+ *     The nodes of the tree are never rewritten. Entries are appended
+ *     to the free slots of a node, and a node that is full is replaced
+ *     by one or two new nodes holding its live entries, which are
+ *     linked into its parent by appending entries to the parent in
+ *     turn. An entry of an inner node holds the lowest key of a child,
+ *     and overrides the older entries with the same key. A key is
+ *     deleted from a leaf by appending a deletion marker for it.
+ *
+ *     When the entry that does not fit in a full node is larger than
+ *     all the entries of the node, the node is kept as it is and a new
+ *     node is started with the entry. Keys inserted in ascending order,
+ *     such as timestamps, or the rows of a relation that is sorted by
+ *     the indexed attribute when the index is loaded, are thus bulk
+ *     loaded into completely filled nodes without copying any entry.
+ *
+ *     Keys are ordered together with their tuple IDs, so the entries
+ *     of a key that occurs in many tuples can span several leaves. The
+ *     tree is stored in one file, which starts with a log of the root
+ *     nodes, and a few recently used nodes are cached in RAM.
+ */
+
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#define NODE_LEAF	1
+#define NODE_INNER	2
+
+#define ROOT_LIMIT	16
+#define HEIGHT_LIMIT	8
+
+/*
+ * A leaf slot holds a key and its tuple ID plus one, or DELETED for a
+ * deletion marker. An inner slot holds the lowest key and tuple ID of a
+ * child and the node ID of the child plus one. Unused slots are zero.
+ */
+#define DELETED		((uint32_t)-1)
+#define EMPTY_SLOT(slot)	((slot)->tid == 0 && (slot)->ptr == 0)
+
+struct slot {
+  int32_t key;
+  uint32_t tid;
+  uint32_t ptr;
+};
+
+#define NODE_HEADER_SIZE	4
+#define NODE_SLOTS \
+  ((DB_BTREE_NODE_SIZE - NODE_HEADER_SIZE) / sizeof(struct slot))
+
+struct node {
+  uint8_t type;
+  uint8_t unused[NODE_HEADER_SIZE - 1];
+  struct slot slots[NODE_SLOTS];
+};
+
+struct root_record {
+  uint16_t node;
+  uint16_t height;
+};
+
+#define NODE_OFFSET(id) \
+  (ROOT_LIMIT * sizeof(struct root_record) + \
+   (unsigned long)(id) * sizeof(struct node))
+#define NODE_LIMIT \
+  ((DB_BTREE_FILE_SIZE - ROOT_LIMIT * sizeof(struct root_record)) / \
+   sizeof(struct node))
+
+struct btree {
+  db_storage_id_t storage;
+  uint16_t root;
+  uint16_t next_node;
+  uint8_t height;
+  uint8_t root_records;
+};
+typedef struct btree btree_t;
+
+struct btree_key {
+  int32_t key;
+  uint32_t tid;
+};
+typedef struct btree_key btree_key_t;
+
+/* The nodes from the root to a leaf, the lowest keys that lead to
+   them, and the lowest key beyond the range covered by the leaf. */
+struct path {
+  uint16_t node[HEIGHT_LIMIT];
+  btree_key_t low[HEIGHT_LIMIT];
+  btree_key_t upper;
+  uint8_t has_upper;
+};
+
+struct node_cache {
+  btree_t *tree;
+  uint16_t node_id;
+  uint16_t last_use;
+  struct node node;
+};
+
+static struct node_cache node_cache[DB_BTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+MEMB(btrees, btree_t, DB_BTREE_INDEX_LIMIT);
+
+/* The entries of a full node and the entries added to it. */
+static struct slot entries[NODE_SLOTS + 2];
+
+static struct {
+  index_iterator_t *iterator;
+  btree_key_t next;
+  uint8_t end;
+} search;
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+static int node_add(btree_t *, struct path *, int, const struct slot *,
+                    unsigned);
+
+index_api_t index_btree = {
+  INDEX_BTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+static int32_t
+to_key(long value)
+{
+#if LONG_MAX > INT32_MAX
+  if(value > INT32_MAX) {
+    return INT32_MAX;
+  } else if(value < INT32_MIN) {
+    return INT32_MIN;
+  }
+#endif
+  return (int32_t)value;
+}
+
+static int
+key_cmp(const btree_key_t *a, const btree_key_t *b)
+{
+  if(a->key != b->key) {
+    return a->key < b->key ? -1 : 1;
+  }
+  if(a->tid != b->tid) {
+    return a->tid < b->tid ? -1 : 1;
+  }
+  return 0;
+}
+
+static void
+slot_key(uint8_t type, const struct slot *slot, btree_key_t *key)
+{
+  key->key = slot->key;
+  key->tid = type == NODE_LEAF ? slot->tid - 1 : slot->tid;
+}
+
+/* Check whether an entry is overridden by a later entry. */
+static int
+superseded(uint8_t type, const struct slot *slots, unsigned count,
+           unsigned i)
+{
+  unsigned j;
+
+  for(j = i + 1; j < count && !EMPTY_SLOT(&slots[j]); j++) {
+    if(slots[j].key == slots[i].key &&
+       (slots[j].tid == slots[i].tid ||
+        (type == NODE_LEAF && slots[j].tid == DELETED))) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static struct node *
+node_get(btree_t *tree, uint16_t node_id)
+{
+  struct node_cache *cache;
+  struct node_cache *victim;
+  int i;
+
+  victim = NULL;
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    cache = &node_cache[i];
+    if(cache->tree == tree && cache->node_id == node_id) {
+      cache->last_use = ++cache_clock;
+      return &cache->node;
+    }
+    if(victim == NULL || cache->tree == NULL ||
+       (victim->tree != NULL &&
+        (uint16_t)(cache_clock - cache->last_use) >
+        (uint16_t)(cache_clock - victim->last_use))) {
+      victim = cache;
+    }
+  }
+
+  victim->tree = NULL;
+  if(DB_ERROR(storage_read(tree->storage, &victim->node,
+                           NODE_OFFSET(node_id), sizeof(victim->node)))) {
+    PRINTF("DB: Failed to read B+-tree node %u\n", (unsigned)node_id);
+    return NULL;
+  }
+  victim->tree = tree;
+  victim->node_id = node_id;
+  victim->last_use = ++cache_clock;
+
+  return &victim->node;
+}
+
+static int
+node_write_slots(btree_t *tree, uint16_t node_id, unsigned first,
+                 const struct slot *slots, unsigned count)
+{
+  int i;
+
+  if(DB_ERROR(storage_write(tree->storage, (void *)slots,
+                            NODE_OFFSET(node_id) +
+                            offsetof(struct node, slots) +
+                            first * sizeof(struct slot),
+                            count * sizeof(struct slot)))) {
+    return 0;
+  }
+
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree && node_cache[i].node_id == node_id) {
+      memcpy(&node_cache[i].node.slots[first], slots,
+             count * sizeof(struct slot));
+    }
+  }
+
+  return 1;
+}
+
+static int
+node_new(btree_t *tree, uint8_t type, const struct slot *slots,
+         unsigned count)
+{
+  struct node node;
+
+  if(tree->next_node >= NODE_LIMIT) {
+    PRINTF("DB: No more B+-tree nodes available\n");
+    return -1;
+  }
+
+  memset(&node, 0, sizeof(node));
+  node.type = type;
+  if(count > 0) {
+    memcpy(node.slots, slots, count * sizeof(struct slot));
+  }
+
+  if(DB_ERROR(storage_write(tree->storage, &node,
+                            NODE_OFFSET(tree->next_node), sizeof(node)))) {
+    return -1;
+  }
+
+  return tree->next_node++;
+}
+
+static int
+set_root(btree_t *tree, uint16_t root, uint8_t height)
+{
+  struct root_record record;
+
+  if(tree->root_records >= ROOT_LIMIT) {
+    PRINTF("DB: The B+-tree root log is full\n");
+    return 0;
+  }
+
+  record.node = root + 1;
+  record.height = height;
+  if(DB_ERROR(storage_write(tree->storage, &record,
+                            tree->root_records * sizeof(record),
+                            sizeof(record)))) {
+    return 0;
+  }
+
+  tree->root_records++;
+  tree->root = root;
+  tree->height = height;
+
+  return 1;
+}
+
+/* Find the leaf whose range contains a key. */
+static int
+descend(btree_t *tree, const btree_key_t *target, struct path *path)
+{
+  struct node *node;
+  const struct slot *slot;
+  const struct slot *best;
+  btree_key_t key;
+  btree_key_t best_key;
+  uint16_t node_id;
+  unsigned level;
+  unsigned i;
+
+  path->has_upper = 0;
+  path->low[0].key = INT32_MIN;
+  path->low[0].tid = 0;
+
+  node_id = tree->root;
+  for(level = 0; level < tree->height - 1; level++) {
+    path->node[level] = node_id;
+    node = node_get(tree, node_id);
+    if(node == NULL) {
+      return 0;
+    }
+
+    /* The child with the greatest lowest key not above the target is
+       chosen; of the entries with the same key, the last is valid. */
+    best = NULL;
+    for(i = 0; i < NODE_SLOTS && !EMPTY_SLOT(&node->slots[i]); i++) {
+      slot = &node->slots[i];
+      slot_key(NODE_INNER, slot, &key);
+      if(key_cmp(&key, target) <= 0) {
+        if(best == NULL || key_cmp(&key, &best_key) >= 0) {
+          best = slot;
+          best_key = key;
+        }
+      } else if(!path->has_upper || key_cmp(&key, &path->upper) < 0) {
+        path->upper = key;
+        path->has_upper = 1;
+      }
+    }
+
+    if(best == NULL) {
+      PRINTF("DB: B+-tree node %u has no child for the key\n",
+             (unsigned)node_id);
+      return 0;
+    }
+    path->low[level + 1] = best_key;
+    node_id = best->ptr - 1;
+  }
+  path->node[level] = node_id;
+
+  return 1;
+}
+
+/* Find the smallest live entry of a leaf that is not below a key. */
+static int
+leaf_find(const struct node *node, const btree_key_t *start,
+          btree_key_t *found)
+{
+  btree_key_t key;
+  unsigned i;
+  int has_found;
+
+  has_found = 0;
+  for(i = 0; i < NODE_SLOTS && !EMPTY_SLOT(&node->slots[i]); i++) {
+    if(node->slots[i].tid == DELETED) {
+      continue;
+    }
+    slot_key(NODE_LEAF, &node->slots[i], &key);
+    if(key_cmp(&key, start) >= 0 &&
+       (!has_found || key_cmp(&key, found) < 0) &&
+       !superseded(NODE_LEAF, node->slots, NODE_SLOTS, i)) {
+      *found = key;
+      has_found = 1;
+    }
+  }
+
+  return has_found;
+}
+
+/* Collect the live entries of a full node and the added entries in the
+   order of their keys. */
+static unsigned
+gather(const struct node *node, unsigned used,
+       const struct slot *add, unsigned add_count)
+{
+  static struct slot all[NODE_SLOTS + 2];
+  btree_key_t key;
+  btree_key_t other;
+  unsigned count;
+  unsigned i;
+  unsigned j;
+
+  memcpy(all, node->slots, used * sizeof(struct slot));
+  memcpy(&all[used], add, add_count * sizeof(struct slot));
+
+  count = 0;
+  for(i = 0; i < used + add_count; i++) {
+    if((node->type == NODE_LEAF && all[i].tid == DELETED) ||
+       superseded(node->type, all, used + add_count, i)) {
+      continue;
+    }
+
+    slot_key(node->type, &all[i], &key);
+    for(j = count; j > 0; j--) {
+      slot_key(node->type, &entries[j - 1], &other);
+      if(key_cmp(&other, &key) < 0) {
+        break;
+      }
+      entries[j] = entries[j - 1];
+    }
+    entries[j] = all[i];
+    count++;
+  }
+
+  return count;
+}
+
+/* Link the node or nodes that replace the node at a level of the path
+   into the tree. */
+static int
+link(btree_t *tree, struct path *path, int level, int left, int right,
+     const btree_key_t *separator)
+{
+  struct slot parent[2];
+  unsigned count;
+  int root;
+
+  if(level == 0) {
+    if(right < 0) {
+      return set_root(tree, left, tree->height);
+    }
+    if(tree->height >= HEIGHT_LIMIT) {
+      PRINTF("DB: The B+-tree is too high\n");
+      return 0;
+    }
+
+    parent[0].key = INT32_MIN;
+    parent[0].tid = 0;
+    parent[0].ptr = left + 1;
+    parent[1].key = separator->key;
+    parent[1].tid = separator->tid;
+    parent[1].ptr = right + 1;
+    root = node_new(tree, NODE_INNER, parent, 2);
+    if(root < 0) {
+      return 0;
+    }
+    return set_root(tree, root, tree->height + 1);
+  }
+
+  count = 0;
+  if(left != path->node[level]) {
+    parent[count].key = path->low[level].key;
+    parent[count].tid = path->low[level].tid;
+    parent[count].ptr = left + 1;
+    count++;
+  }
+  if(right >= 0) {
+    parent[count].key = separator->key;
+    parent[count].tid = separator->tid;
+    parent[count].ptr = right + 1;
+    count++;
+  }
+
+  return node_add(tree, path, level - 1, parent, count);
+}
+
+/* Add entries to the node at a level of the path. */
+static int
+node_add(btree_t *tree, struct path *path, int level,
+         const struct slot *add, unsigned add_count)
+{
+  struct node *node;
+  btree_key_t key;
+  btree_key_t add_key;
+  btree_key_t separator;
+  uint16_t node_id;
+  unsigned used;
+  unsigned count;
+  unsigned i;
+  uint8_t type;
+  int left;
+  int right;
+
+  node_id = path->node[level];
+  node = node_get(tree, node_id);
+  if(node == NULL) {
+    return 0;
+  }
+
+  for(used = 0; used < NODE_SLOTS && !EMPTY_SLOT(&node->slots[used]); used++);
+  if(used + add_count <= NODE_SLOTS) {
+    return node_write_slots(tree, node_id, used, add, add_count);
+  }
+
+  type = node->type;
+  if(add_count == 1 && !(type == NODE_LEAF && add->tid == DELETED)) {
+    slot_key(type, add, &add_key);
+    for(i = 0; i < used; i++) {
+      if(type == NODE_LEAF && node->slots[i].tid == DELETED) {
+        continue;
+      }
+      slot_key(type, &node->slots[i], &key);
+      if(key_cmp(&key, &add_key) >= 0) {
+        break;
+      }
+    }
+
+    if(i == used) {
+      /* Keep the full node, and start a new one with the entry. */
+      right = node_new(tree, type, add, 1);
+      if(right < 0) {
+        return 0;
+      }
+      return link(tree, path, level, node_id, right, &add_key);
+    }
+  }
+
+  count = gather(node, used, add, add_count);
+  PRINTF("DB: Replacing the full B+-tree node %u with %u entries\n",
+         (unsigned)node_id, count);
+
+  if(count <= NODE_SLOTS) {
+    left = node_new(tree, type, entries, count);
+    if(left < 0) {
+      return 0;
+    }
+    return link(tree, path, level, left, -1, NULL);
+  }
+
+  left = node_new(tree, type, entries, count / 2);
+  right = node_new(tree, type, &entries[count / 2], count - count / 2);
+  if(left < 0 || right < 0) {
+    return 0;
+  }
+  slot_key(type, &entries[count / 2], &separator);
+
+  return link(tree, path, level, left, right, &separator);
+}
+
+static db_result_t
+create(index_t *index)
+{
+  char *filename;
+  btree_t *tree;
+
+  filename = storage_generate_file("btree", DB_BTREE_FILE_SIZE);
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  index->opaque_data = tree = memb_alloc(&btrees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->next_node = 0;
+  tree->root_records = 0;
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0 ||
+     node_new(tree, NODE_LEAF, NULL, 0) < 0 ||
+     !set_root(tree, 0, 1)) {
+    storage_close(tree->storage);
+    memb_free(&btrees, tree);
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Created a B+-tree index in file %s\n", index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  cfs_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  struct root_record records[ROOT_LIMIT];
+  btree_t *tree;
+  uint16_t low;
+  uint16_t high;
+  uint16_t middle;
+  uint8_t type;
+
+  index->opaque_data = tree = memb_alloc(&btrees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0 ||
+     DB_ERROR(storage_read(tree->storage, records, 0, sizeof(records)))) {
+    goto error;
+  }
+
+  /* The last record in the root log is the current root. */
+  for(tree->root_records = 0;
+      tree->root_records < ROOT_LIMIT &&
+      records[tree->root_records].node != 0;
+      tree->root_records++) {
+    tree->root = records[tree->root_records].node - 1;
+    tree->height = records[tree->root_records].height;
+  }
+  if(tree->root_records == 0) {
+    goto error;
+  }
+
+  /* Nodes are allocated in order; find the first one that is unused.
+     A node beyond the end of the file cannot be read. */
+  low = 0;
+  high = NODE_LIMIT;
+  while(low < high) {
+    middle = low + (high - low) / 2;
+    if(DB_ERROR(storage_read(tree->storage, &type,
+                             NODE_OFFSET(middle), sizeof(type)))) {
+      type = 0;
+    }
+    if(type != 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  tree->next_node = low;
+
+  PRINTF("DB: Loaded a B+-tree of height %u with %u nodes from file %s\n",
+         (unsigned)tree->height, (unsigned)tree->next_node,
+         index->descriptor_file);
+  return DB_OK;
+
+error:
+  storage_close(tree->storage);
+  memb_free(&btrees, tree);
+  return DB_STORAGE_ERROR;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  btree_t *tree;
+  int i;
+
+  tree = index->opaque_data;
+
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree) {
+      node_cache[i].tree = NULL;
+    }
+  }
+  search.iterator = NULL;
+
+  storage_close(tree->storage);
+  memb_free(&btrees, tree);
+  return DB_OK;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *value, tuple_id_t tuple_id)
+{
+  btree_t *tree;
+  btree_key_t key;
+  struct path path;
+  struct slot slot;
+
+  tree = index->opaque_data;
+
+  key.key = to_key(db_value_to_long(value));
+  key.tid = tuple_id;
+  if(!descend(tree, &key, &path)) {
+    return DB_INDEX_ERROR;
+  }
+
+  slot.key = key.key;
+  slot.tid = tuple_id + 1;
+  slot.ptr = 0;
+  if(!node_add(tree, &path, tree->height - 1, &slot, 1)) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n",
+           (long)key.key);
+    return DB_INDEX_ERROR;
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  btree_t *tree;
+  btree_key_t key;
+  btree_key_t found;
+  struct path path;
+  struct node *node;
+  struct slot marker;
+
+  tree = index->opaque_data;
+
+  key.key = to_key(db_value_to_long(value));
+  key.tid = 0;
+
+  marker.key = key.key;
+  marker.tid = DELETED;
+  marker.ptr = 0;
+
+  /* Mark the key as deleted in every leaf that has entries for it. */
+  for(;;) {
+    if(!descend(tree, &key, &path)) {
+      return DB_INDEX_ERROR;
+    }
+    node = node_get(tree, path.node[tree->height - 1]);
+    if(node == NULL) {
+      return DB_INDEX_ERROR;
+    }
+    if(leaf_find(node, &key, &found) && found.key == marker.key &&
+       !node_add(tree, &path, tree->height - 1, &marker, 1)) {
+      return DB_INDEX_ERROR;
+    }
+    if(!path.has_upper || path.upper.key != marker.key) {
+      break;
+    }
+    key = path.upper;
+  }
+
+  return DB_OK;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  btree_t *tree;
+  btree_key_t found;
+  struct path path;
+  struct node *node;
+  int32_t max;
+
+  tree = iterator->index->opaque_data;
+
+  if(search.iterator != iterator || iterator->next_item_no == 0) {
+    /* Initialize the state for a new search. */
+    search.iterator = iterator;
+    search.next.key = to_key(db_value_to_long(&iterator->min_value));
+    search.next.tid = 0;
+    search.end = 0;
+  }
+  max = to_key(db_value_to_long(&iterator->max_value));
+
+  /* Look for the next entry in the leaf that covers it, and continue
+     with the following leaves if that leaf has no more entries. */
+  while(!search.end) {
+    if(!descend(tree, &search.next, &path)) {
+      break;
+    }
+    node = node_get(tree, path.node[tree->height - 1]);
+    if(node == NULL) {
+      break;
+    }
+
+    if(leaf_find(node, &search.next, &found)) {
+      if(found.key > max) {
+        break;
+      }
+      search.next.key = found.key;
+      search.next.tid = found.tid + 1;
+      iterator->next_item_no++;
+      PRINTF("DB: Found key %ld with value %lu\n", (long)found.key,
+             (unsigned long)found.tid);
+      return found.tid;
+    }
+
+    if(!path.has_upper || path.upper.key > max) {
+      break;
+    }
+    search.next = path.upper;
+  }
+
+  search.end = 1;
+  return INVALID_TUPLE;
+}
@@ -307,6 +307,12 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
   p->ip = 0;
   p->error = 0;
 
+  lvm_clear_variables();
+}
+
+void
+lvm_clear_variables(void)
+{
   memset(variables, 0, sizeof(variables));
   memset(derivations, 0, sizeof(derivations));
 }
@@ -487,6 +493,71 @@ lvm_set_variable(lvm_instance_t *p, char *name)
   }
 }
 
+char *
+lvm_get_variable_name(variable_id_t id)
+{
+  if(id >= LVM_MAX_VARIABLE_ID - 1 || variables[id].name[0] == '\0') {
+    return NULL;
+  }
+  return variables[id].name;
+}
+
+/*
+ * Parameters are placeholders for constants that are set after the
+ * code has been generated, for executing it with different values.
+ * lvm_get_parameter() finds where a parameter is in the code, and
+ * lvm_bind_parameter() replaces the operand at that place with a
+ * constant, which keeps its place in the code for the next binding.
+ */
+void
+lvm_set_parameter(lvm_instance_t *p, unsigned number)
+{
+  operand_t op;
+
+  op.type = LVM_PARAMETER;
+  op.value.l = number;
+
+  lvm_set_operand(p, &op);
+}
+
+lvm_ip_t
+lvm_get_parameter(lvm_instance_t *p, unsigned number)
+{
+  lvm_ip_t ip;
+  operand_t operand;
+
+  for(ip = 0; ip < p->end;) {
+    switch(*(node_type_t *)(p->code + ip)) {
+    case LVM_CMP_OP:
+    case LVM_ARITH_OP:
+      ip += sizeof(node_type_t) + sizeof(operator_t);
+      break;
+    case LVM_OPERAND:
+      ip += sizeof(node_type_t);
+      memcpy(&operand, p->code + ip, sizeof(operand));
+      if(operand.type == LVM_PARAMETER && operand.value.l == number) {
+        return ip;
+      }
+      ip += sizeof(operand);
+      break;
+    default:
+      return -1;
+    }
+  }
+
+  return -1;
+}
+
+void
+lvm_bind_parameter(lvm_instance_t *p, lvm_ip_t ip, long l)
+{
+  operand_t op;
+
+  op.type = LVM_LONG;
+  op.value.l = l;
+  memcpy(p->code + ip, &op, sizeof(op));
+}
+
 void
 lvm_clone(lvm_instance_t *dst, lvm_instance_t *src)
 {
@@ -765,6 +836,9 @@ print_operand(lvm_instance_t *p, lvm_ip_t index)
   case LVM_LONG:
     PRINTF("long:%ld ", operand.value.l);
     break;
+  case LVM_PARAMETER:
+    PRINTF("param:%ld ", operand.value.l);
+    break;
   default:
     PRINTF("?? ");
     break;
@@ -100,7 +100,8 @@ typedef enum operator operator_t;
 enum operand_type {
   LVM_VARIABLE,
   LVM_FLOAT,
-  LVM_LONG
+  LVM_LONG,
+  LVM_PARAMETER
 };
 typedef enum operand_type operand_type_t;
 
@@ -140,5 +141,10 @@ void lvm_set_relation(lvm_instance_t *p, operator_t op);
 void lvm_set_operand(lvm_instance_t *p, operand_t *op);
 void lvm_set_long(lvm_instance_t *p, long l);
 void lvm_set_variable(lvm_instance_t *p, char *name);
+char *lvm_get_variable_name(variable_id_t id);
+void lvm_clear_variables(void);
+void lvm_set_parameter(lvm_instance_t *p, unsigned number);
+lvm_ip_t lvm_get_parameter(lvm_instance_t *p, unsigned number);
+void lvm_bind_parameter(lvm_instance_t *p, lvm_ip_t ip, long l);
 
 #endif /* LVM_H */
@@ -88,6 +88,20 @@ static unsigned char * const left_row = row;
 static unsigned char * const right_row = extra_row;
 static unsigned char * const join_row = result_row;
 
+#if DB_SCAN_BUFFER_SIZE
+/* The tuples that a selection scanning a relation has read ahead. */
+static unsigned char scan_buffer[DB_SCAN_BUFFER_SIZE];
+static tuple_id_t scan_first;
+static unsigned scan_count;
+
+#define SCAN_BUFFERED(handle)                                   \
+  (!((handle)->flags & DB_HANDLE_FLAG_SEARCH_INDEX) &&          \
+   (handle)->tuple_id >= scan_first &&                          \
+   (handle)->tuple_id - scan_first < scan_count)
+#else
+#define SCAN_BUFFERED(handle)   0
+#endif /* DB_SCAN_BUFFER_SIZE */
+
 LIST(relations);
 MEMB(relations_memb, relation_t, DB_RELATION_POOL_SIZE);
 MEMB(attributes_memb, attribute_t, DB_ATTRIBUTE_POOL_SIZE);
@@ -643,7 +657,9 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
   min_range = ULONG_MAX;
 
   /* Find all indexed and derived attributes, and select the index of 
-     the attribute with the smallest range. */
+     the attribute with the smallest range. An index that does not
+     support range queries is only considered for a range that it can
+     search by looking up each value in it. */
   for(attr = list_head(handle->rel->attributes);
       attr != NULL;
       attr = attr->next) {
@@ -653,7 +669,14 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
       PRINTF("DB: The search range for attribute \"%s\" comprises %ld values\n",
              attr->name, range + 1);
 
+      if(!(((index_t *)attr->index)->api->flags & INDEX_API_RANGE_QUERIES) &&
+         (unsigned long)range >
+         relation_cardinality(handle->rel) / DB_INDEX_COST) {
+        continue;
+      }
+
       if(range <= min_range) {
+        min_range = range;
         index = attr->index;
         av_min.domain = av_max.domain = DOMAIN_INT;
         VALUE_LONG(&av_min) = min.l;
@@ -671,6 +694,34 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
   }
 }
 
+static db_result_t
+get_selection_row(db_handle_t *handle, unsigned char **row_ptr)
+{
+#if DB_SCAN_BUFFER_SIZE
+  unsigned row_length;
+
+  row_length = handle->rel->row_length;
+  if(!(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) &&
+     row_length > 0 && row_length <= sizeof(scan_buffer)) {
+    if(!SCAN_BUFFERED(handle)) {
+      scan_first = handle->tuple_id;
+      scan_count = sizeof(scan_buffer) / row_length;
+      if(storage_get_rows(handle->rel, &scan_first,
+                          scan_buffer, &scan_count) != DB_OK) {
+        scan_count = 0;
+        *row_ptr = row;
+        return storage_get_row(handle->rel, &handle->tuple_id, row);
+      }
+    }
+    *row_ptr = scan_buffer + (handle->tuple_id - scan_first) * row_length;
+    return DB_OK;
+  }
+#endif /* DB_SCAN_BUFFER_SIZE */
+
+  *row_ptr = row;
+  return storage_get_row(handle->rel, &handle->tuple_id, row);
+}
+
 static db_result_t
 generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
 {
@@ -683,6 +734,9 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
   handle->current_row = 0;
   handle->ncolumns = 0;
   handle->tuple_id = 0;
+#if DB_SCAN_BUFFER_SIZE
+  scan_count = 0;
+#endif
   for(attr = list_head(result_rel->attributes); attr != NULL; attr = attr->next) {
     if(attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
       continue;
@@ -746,6 +800,7 @@ relation_process_select(void *handle_ptr)
   uint8_t intbuf[2];
   attribute_value_t value;
   lvm_status_t wanted_result;
+  unsigned char *row_ptr;
 
   handle = (db_handle_t *)handle_ptr;
   adt = (aql_adt_t *)handle->adt;
@@ -771,76 +826,79 @@ relation_process_select(void *handle_ptr)
 
   /* Put the tuples fulfilling the given condition into a new relation.
      The tuples may be projected. */
-  result = storage_get_row(handle->rel, &handle->tuple_id, row);
-  handle->tuple_id++;
-  if(DB_ERROR(result)) {
-    PRINTF("DB: Failed to get a row in relation %s!\n", handle->rel->name);
-    return result;
-  } else if(result == DB_FINISHED) {
-    if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
-      goto end_aggregation;
+  do {
+    result = get_selection_row(handle, &row_ptr);
+    handle->tuple_id++;
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to get a row in relation %s!\n", handle->rel->name);
+      return result;
+    } else if(result == DB_FINISHED) {
+      if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+        goto end_aggregation;
+      }
+      return DB_FINISHED;
     }
-    return DB_FINISHED;
-  }
 
-  /* Process the attributes in the result relation. */
-  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-    from_ptr = row + attr_map_ptr->from_offset;
-    result_attr = attr_map_ptr->to_attr;
+    /* Process the attributes in the result relation. */
+    for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+      from_ptr = row_ptr + attr_map_ptr->from_offset;
+      result_attr = attr_map_ptr->to_attr;
+
+      /* Update the internal state of the PLE. */
+      if(result_attr->domain == DOMAIN_INT) {
+        operand_value.l = from_ptr[0] << 8 | from_ptr[1];
+        lvm_set_variable_value(result_attr->name, operand_value);
+      } else if(result_attr->domain == DOMAIN_LONG) {
+        operand_value.l = (uint32_t)from_ptr[0] << 24 |
+                          (uint32_t)from_ptr[1] << 16 |
+                          (uint32_t)from_ptr[2] << 8 |
+                          from_ptr[3];
+        lvm_set_variable_value(result_attr->name, operand_value);
+      }
 
-    /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
-      operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
-      operand_value.l = (uint32_t)from_ptr[0] << 24 |
-                        (uint32_t)from_ptr[1] << 16 |
-                        (uint32_t)from_ptr[2] << 8 |
-                        from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    }
+      if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+        /* The attribute is used just for the predicate,
+           so do not copy the current value into the result. */
+        continue;
+      }
 
-    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
-      /* The attribute is used just for the predicate,
-         so do not copy the current value into the result. */
-      continue;
+      if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE)) {
+        /* No aggregators. Copy the original value into the resulting tuple. */
+        memcpy(result_row + attr_map_ptr->to_offset, from_ptr,
+               result_attr->element_size);
+      }
     }
 
-    if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE)) {
-      /* No aggregators. Copy the original value into the resulting tuple. */
-      memcpy(result_row + attr_map_ptr->to_offset, from_ptr,
-             result_attr->element_size);
+    wanted_result = TRUE;
+    if(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) {
+      wanted_result = FALSE;
     }
-  }
-
-  wanted_result = TRUE;
-  if(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) {
-    wanted_result = FALSE;
-  }
 
-  /* Check whether the given predicate is true for this tuple. */
-  if(adt->lvm_instance == NULL ||
-     lvm_execute(adt->lvm_instance) == wanted_result) {
-    if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
-      for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-        from_ptr = row + attr_map_ptr->from_offset;
-        result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
-        if(DB_ERROR(result)) {
-	  return result;
+    /* Check whether the given predicate is true for this tuple. */
+    if(adt->lvm_instance == NULL ||
+       lvm_execute(adt->lvm_instance) == wanted_result) {
+      if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+        for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+          from_ptr = row_ptr + attr_map_ptr->from_offset;
+          result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
+          if(DB_ERROR(result)) {
+            return result;
+          }
+          aggregate(attr_map_ptr->to_attr, &value);
         }
-        aggregate(attr_map_ptr->to_attr, &value);
-      }
-    } else {
-      if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
-          PRINTF("DB: Failed to store a row in the result relation!\n");
-          return DB_STORAGE_ERROR;
+      } else {
+        if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
+          if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+            PRINTF("DB: Failed to store a row in the result relation!\n");
+            return DB_STORAGE_ERROR;
+          }
         }
+        handle->current_row++;
+        return DB_GOT_ROW;
       }
-      handle->current_row++;
-      return DB_GOT_ROW;
     }
-  }
+    /* Continue with the next tuple if it has already been read. */
+  } while(SCAN_BUFFERED(handle));
 
   return DB_OK;
 
@@ -437,6 +437,52 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
   return DB_OK;
 }
 
+db_result_t
+storage_get_rows(relation_t *rel, tuple_id_t *tuple_id, storage_row_t rows,
+                 unsigned *count)
+{
+  int r;
+  tuple_id_t nrows;
+  unsigned i;
+
+  if(DB_ERROR(storage_get_row_amount(rel, &nrows))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  if(*tuple_id >= nrows || *count == 0) {
+    return DB_FINISHED;
+  }
+
+  if(*count > nrows - *tuple_id) {
+    *count = nrows - *tuple_id;
+  }
+
+  if(cfs_seek(rel->tuple_storage, *tuple_id * rel->row_length, CFS_SEEK_SET) ==
+              (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+
+  r = cfs_read(rel->tuple_storage, rows, *count * rel->row_length);
+  if(r < 0) {
+    PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
+    return DB_STORAGE_ERROR;
+  } else if(r == 0) {
+    return DB_FINISHED;
+  } else if(r < rel->row_length) {
+    PRINTF("DB: Incomplete record: %d < %d\n", r, rel->row_length);
+    return DB_STORAGE_ERROR;
+  }
+
+  *count = r / rel->row_length;
+  for(i = 1; i <= *count; i++) {
+    rows[i * rel->row_length - 1] ^= ROW_XOR;
+  }
+
+  PRINTF("DB: Read %u rows from relation %s\n", *count, rel->name);
+
+  return DB_OK;
+}
+
 db_result_t
 storage_put_row(relation_t *rel, storage_row_t row)
 {
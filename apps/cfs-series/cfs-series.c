@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Append-only time series stored in a ring of CFS files.
+ */
+
+#include <string.h>
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs-series.h"
+#if CFS_SERIES_COFFEE
+#include "cfs/cfs-coffee.h"
+#endif
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/*
+ * A segment starts with its sequence number, followed by the samples.
+ * A sample has a header with its time and its length, in which the
+ * highest bit is set so that the header of a sample is never erased
+ * storage. All numbers are stored in little-endian byte order.
+ */
+#define SEGMENT_HEADER_SIZE 4
+#define SAMPLE_HEADER_SIZE  6
+#define SAMPLE_VALID        0x8000
+#define SAMPLE_MAX_LENGTH   0x7fff
+
+#define FILENAME_LENGTH     (CFS_SERIES_NAME_LENGTH + 5)
+/*---------------------------------------------------------------------------*/
+static void
+put_uint32(uint8_t *p, uint32_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get_uint32(const uint8_t *p)
+{
+  return p[0] | ((uint32_t)p[1] << 8) |
+    ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+/*---------------------------------------------------------------------------*/
+static void
+segment_name(char *buf, struct cfs_series *series, unsigned index)
+{
+  char *p;
+
+  strcpy(buf, series->name);
+  p = buf + strlen(buf);
+  *p++ = '.';
+  if(index >= 100) {
+    *p++ = '0' + index / 100;
+  }
+  if(index >= 10) {
+    *p++ = '0' + (index / 10) % 10;
+  }
+  *p++ = '0' + index % 10;
+  *p = '\0';
+}
+/*---------------------------------------------------------------------------*/
+/* Open the segment with a sequence number for reading, if it still exists. */
+static int
+open_segment(struct cfs_series *series, uint32_t seq)
+{
+  char file[FILENAME_LENGTH];
+  uint8_t header[SEGMENT_HEADER_SIZE];
+  int fd;
+
+  segment_name(file, series, seq % series->segments);
+  fd = cfs_open(file, CFS_READ);
+  if(fd < 0) {
+    return -1;
+  }
+  if(cfs_read(fd, header, sizeof(header)) != sizeof(header) ||
+     get_uint32(header) != seq) {
+    cfs_close(fd);
+    return -1;
+  }
+  return fd;
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_sample_header(struct cfs_series *series, int fd, cfs_offset_t offset,
+                   uint32_t *time, unsigned *length)
+{
+  uint8_t header[SAMPLE_HEADER_SIZE];
+  unsigned l;
+
+  if(offset + SAMPLE_HEADER_SIZE > series->segment_size ||
+     cfs_seek(fd, offset, CFS_SEEK_SET) != offset ||
+     cfs_read(fd, header, sizeof(header)) != sizeof(header)) {
+    return -1;
+  }
+
+  l = header[4] | (header[5] << 8);
+  if(!(l & SAMPLE_VALID)) {
+    return -1;
+  }
+  l &= SAMPLE_MAX_LENGTH;
+  if(offset + SAMPLE_HEADER_SIZE + l > series->segment_size) {
+    return -1;
+  }
+
+  *time = get_uint32(header);
+  *length = l;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Drop the oldest segment and start a new one in its place. */
+static int
+start_segment(struct cfs_series *series, uint32_t seq)
+{
+  char file[FILENAME_LENGTH];
+  uint8_t header[SEGMENT_HEADER_SIZE];
+
+  if(series->fd >= 0) {
+    cfs_close(series->fd);
+    series->fd = -1;
+  }
+
+  segment_name(file, series, seq % series->segments);
+  cfs_remove(file);
+#if CFS_SERIES_COFFEE
+  if(cfs_coffee_reserve(file, series->segment_size) < 0) {
+    PRINTF("cfs-series: cannot reserve %s\n", file);
+    return -1;
+  }
+#endif
+
+  series->fd = cfs_open(file, CFS_WRITE | CFS_APPEND);
+  if(series->fd < 0) {
+    return -1;
+  }
+  put_uint32(header, seq);
+  if(cfs_write(series->fd, header, sizeof(header)) != sizeof(header)) {
+    cfs_close(series->fd);
+    series->fd = -1;
+    return -1;
+  }
+
+  PRINTF("cfs-series: started segment %lu of %s\n",
+         (unsigned long)seq, series->name);
+  series->seq = seq;
+  series->offset = SEGMENT_HEADER_SIZE;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_series_open(struct cfs_series *series, const char *name,
+                cfs_offset_t segment_size, uint8_t segments)
+{
+  char file[FILENAME_LENGTH];
+  uint8_t header[SEGMENT_HEADER_SIZE];
+  cfs_offset_t offset;
+  uint32_t seq;
+  uint32_t time;
+  unsigned length;
+  unsigned i;
+  int fd;
+
+  if(strlen(name) > CFS_SERIES_NAME_LENGTH || segments < 2 ||
+     segment_size <= SEGMENT_HEADER_SIZE + SAMPLE_HEADER_SIZE) {
+    return -1;
+  }
+
+  series->name = name;
+  series->segment_size = segment_size;
+  series->segments = segments;
+  series->seq = 0;
+  series->last_time = 0;
+  series->fd = -1;
+
+  /* The newest segment has the highest sequence number. */
+  for(i = 0; i < segments; i++) {
+    segment_name(file, series, i);
+    fd = cfs_open(file, CFS_READ);
+    if(fd >= 0) {
+      if(cfs_read(fd, header, sizeof(header)) == sizeof(header)) {
+        seq = get_uint32(header);
+        if(seq % segments == i && seq > series->seq) {
+          series->seq = seq;
+        }
+      }
+      cfs_close(fd);
+    }
+  }
+
+  if(series->seq == 0) {
+    return start_segment(series, 1);
+  }
+
+  /* Find the end of the samples in the newest segment. */
+  fd = open_segment(series, series->seq);
+  if(fd < 0) {
+    return -1;
+  }
+  offset = SEGMENT_HEADER_SIZE;
+  while(read_sample_header(series, fd, offset, &time, &length) == 0) {
+    series->last_time = time;
+    offset += SAMPLE_HEADER_SIZE + length;
+  }
+  cfs_close(fd);
+
+  segment_name(file, series, series->seq % segments);
+  series->fd = cfs_open(file, CFS_WRITE | CFS_APPEND);
+  if(series->fd < 0) {
+    return -1;
+  }
+  cfs_seek(series->fd, offset, CFS_SEEK_SET);
+  series->offset = offset;
+
+  PRINTF("cfs-series: opened %s at segment %lu offset %lu\n",
+         name, (unsigned long)series->seq, (unsigned long)offset);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_series_close(struct cfs_series *series)
+{
+  if(series->fd >= 0) {
+    cfs_close(series->fd);
+    series->fd = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_series_remove(struct cfs_series *series)
+{
+  char file[FILENAME_LENGTH];
+  unsigned i;
+
+  cfs_series_close(series);
+  for(i = 0; i < series->segments; i++) {
+    segment_name(file, series, i);
+    cfs_remove(file);
+  }
+  series->seq = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_series_append(struct cfs_series *series, uint32_t time,
+                  const void *data, unsigned length)
+{
+  uint8_t header[SAMPLE_HEADER_SIZE];
+
+  if(series->fd < 0 || time < series->last_time ||
+     length > SAMPLE_MAX_LENGTH ||
+     SEGMENT_HEADER_SIZE + SAMPLE_HEADER_SIZE + length > series->segment_size) {
+    return -1;
+  }
+
+  if(series->offset + SAMPLE_HEADER_SIZE + length > series->segment_size) {
+    if(start_segment(series, series->seq + 1) < 0) {
+      return -1;
+    }
+  }
+
+  put_uint32(header, time);
+  header[4] = length;
+  header[5] = (length | SAMPLE_VALID) >> 8;
+  if(cfs_write(series->fd, header, sizeof(header)) != sizeof(header) ||
+     cfs_write(series->fd, data, length) != length) {
+    return -1;
+  }
+
+  series->offset += SAMPLE_HEADER_SIZE + length;
+  series->last_time = time;
+  return length;
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_series_find(struct cfs_series *series, struct cfs_series_cursor *cursor,
+                uint32_t from, uint32_t to)
+{
+  uint32_t seq;
+  uint32_t time;
+  unsigned length;
+  int fd;
+  int skip;
+
+  cursor->series = series;
+  cursor->from = from;
+  cursor->to = to;
+  cursor->fd = -1;
+
+  seq = series->seq >= series->segments ?
+    series->seq - series->segments + 1 : 1;
+
+  /*
+   * The samples of a segment are not later than the first sample of the
+   * next segment, so a segment can be skipped if the next one starts
+   * before the range.
+   */
+  for(; seq < series->seq; seq++) {
+    fd = open_segment(series, seq + 1);
+    if(fd < 0) {
+      break;
+    }
+    skip = read_sample_header(series, fd, SEGMENT_HEADER_SIZE,
+                              &time, &length) == 0 && time < from;
+    cfs_close(fd);
+    if(!skip) {
+      break;
+    }
+  }
+  cursor->seq = seq;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_series_next(struct cfs_series_cursor *cursor, uint32_t *time,
+                void *buf, unsigned size)
+{
+  struct cfs_series *series;
+  uint32_t t;
+  unsigned length;
+
+  series = cursor->series;
+  while(cursor->seq <= series->seq) {
+    if(cursor->fd < 0) {
+      cursor->fd = open_segment(series, cursor->seq);
+      cursor->offset = SEGMENT_HEADER_SIZE;
+      if(cursor->fd < 0) {
+        cursor->seq++;
+        continue;
+      }
+    }
+
+    if((cursor->seq == series->seq && cursor->offset >= series->offset) ||
+       read_sample_header(series, cursor->fd, cursor->offset,
+                          &t, &length) < 0) {
+      cfs_close(cursor->fd);
+      cursor->fd = -1;
+      cursor->seq++;
+      continue;
+    }
+    cursor->offset += SAMPLE_HEADER_SIZE + length;
+
+    if(t < cursor->from) {
+      continue;
+    }
+    if(t > cursor->to) {
+      break;
+    }
+
+    if(size > length) {
+      size = length;
+    }
+    if(cfs_read(cursor->fd, buf, size) != size) {
+      break;
+    }
+    *time = t;
+    return length;
+  }
+
+  cfs_series_done(cursor);
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_series_done(struct cfs_series_cursor *cursor)
+{
+  if(cursor->fd >= 0) {
+    cfs_close(cursor->fd);
+    cursor->fd = -1;
+  }
+  cursor->seq = cursor->series->seq + 1;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Append-only time series stored in a ring of CFS files.
+ *
+ *         A series is kept in a fixed number of segment files named
+ *         "name.0", "name.1", and so on, of a fixed size. Samples are
+ *         appended to the newest segment; when it is full, the oldest
+ *         segment is removed and reused, so the series holds the most
+ *         recent samples that fit. On Coffee each segment is reserved at
+ *         its full size when it is started, so appending never has to
+ *         extend or copy a file.
+ */
+
+#ifndef CFS_SERIES_H_
+#define CFS_SERIES_H_
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+/* Reserve the segments with cfs_coffee_reserve(). */
+#ifdef CFS_SERIES_CONF_COFFEE
+#define CFS_SERIES_COFFEE CFS_SERIES_CONF_COFFEE
+#else
+#define CFS_SERIES_COFFEE 1
+#endif
+
+/* Maximum length of a series name, without the segment suffix. */
+#ifdef CFS_SERIES_CONF_NAME_LENGTH
+#define CFS_SERIES_NAME_LENGTH CFS_SERIES_CONF_NAME_LENGTH
+#else
+#define CFS_SERIES_NAME_LENGTH 10
+#endif
+
+/* A series opened for appending. */
+struct cfs_series {
+  const char *name;
+  cfs_offset_t segment_size;
+  /* Sequence number of the newest segment. */
+  uint32_t seq;
+  /* Offset at which the next sample is appended to the newest segment. */
+  cfs_offset_t offset;
+  uint32_t last_time;
+  int fd;
+  uint8_t segments;
+};
+
+/* A search for the samples of a series in a time range. */
+struct cfs_series_cursor {
+  struct cfs_series *series;
+  uint32_t from;
+  uint32_t to;
+  uint32_t seq;
+  cfs_offset_t offset;
+  int fd;
+};
+
+/**
+ * \brief Open a series, creating it if it does not exist.
+ * \param series The series.
+ * \param name The name of the series, which must stay valid while the
+ *        series is open.
+ * \param segment_size The size of a segment file in bytes.
+ * \param segments The number of segments kept, at least 2.
+ * \return 0 on success, -1 on failure.
+ *
+ * The newest segment of an existing series is scanned to find where the
+ * next sample goes. A series must always be opened with the same
+ * segment size and number of segments.
+ */
+int cfs_series_open(struct cfs_series *series, const char *name,
+                    cfs_offset_t segment_size, uint8_t segments);
+
+/**
+ * \brief Close a series.
+ */
+void cfs_series_close(struct cfs_series *series);
+
+/**
+ * \brief Remove all the segments of a series.
+ *
+ * The series is closed.
+ */
+void cfs_series_remove(struct cfs_series *series);
+
+/**
+ * \brief Append a sample to a series.
+ * \param series The series.
+ * \param time The time of the sample, in any unit.
+ * \param data The sample.
+ * \param length The length of the sample.
+ * \return The length of the sample, or -1 if it could not be written.
+ *
+ * The times of the samples must not decrease. A sample must fit in a
+ * segment together with the 4 byte segment header and its own 6 byte
+ * header. Starting a new segment drops the oldest one.
+ */
+int cfs_series_append(struct cfs_series *series, uint32_t time,
+                      const void *data, unsigned length);
+
+/**
+ * \brief Start a search for the samples in a time range.
+ * \param series The series.
+ * \param cursor The cursor of the search.
+ * \param from The time of the first sample of interest.
+ * \param to The time of the last sample of interest.
+ *
+ * Segments that end before \a from are skipped without being read.
+ */
+void cfs_series_find(struct cfs_series *series,
+                     struct cfs_series_cursor *cursor,
+                     uint32_t from, uint32_t to);
+
+/**
+ * \brief Get the next sample of a search.
+ * \param cursor The cursor of the search.
+ * \param time A pointer to where the time of the sample is written.
+ * \param buf The buffer to which the sample is copied.
+ * \param size The size of the buffer; a longer sample is truncated.
+ * \return The length of the sample, or -1 if there are no more samples.
+ */
+int cfs_series_next(struct cfs_series_cursor *cursor, uint32_t *time,
+                    void *buf, unsigned size);
+
+/**
+ * \brief End a search before all its samples were read.
+ */
+void cfs_series_done(struct cfs_series_cursor *cursor);
+
+#endif /* CFS_SERIES_H_ */
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Application of binary patches to files.
+ */
+
+#include <string.h>
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "lib/crc16.h"
+#include "delta.h"
+#if DELTA_COFFEE
+#include "cfs/cfs-coffee.h"
+#endif
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define STATE_HEADER   0
+#define STATE_COMMAND  1
+#define STATE_ARGUMENT 2
+#define STATE_INSERT   3
+#define STATE_ERROR    4
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get_uint32(const uint8_t *p)
+{
+  return p[0] | ((uint32_t)p[1] << 8) |
+    ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_new(struct delta_patch *patch, const uint8_t *data, unsigned length)
+{
+  if(length > patch->new_size - patch->new_offset ||
+     cfs_write(patch->new_fd, data, length) != length) {
+    return -1;
+  }
+  patch->crc = crc16_data(data, length, patch->crc);
+  patch->new_offset += length;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+copy_old(struct delta_patch *patch, uint32_t length)
+{
+  uint8_t buf[DELTA_BUFFER_SIZE];
+  unsigned n;
+
+  if(length > patch->old_size - patch->old_offset ||
+     cfs_seek(patch->old_fd, patch->old_offset, CFS_SEEK_SET) !=
+     patch->old_offset) {
+    return -1;
+  }
+
+  while(length > 0) {
+    n = length < sizeof(buf) ? length : sizeof(buf);
+    if(cfs_read(patch->old_fd, buf, n) != n || write_new(patch, buf, n) < 0) {
+      return -1;
+    }
+    patch->old_offset += n;
+    length -= n;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Check the header against the old image and create the new file. */
+static int
+start_patch(struct delta_patch *patch)
+{
+  uint8_t buf[DELTA_BUFFER_SIZE];
+  uint32_t left;
+  uint16_t crc;
+  unsigned n;
+
+  if(memcmp(patch->header, DELTA_MAGIC, 4) != 0) {
+    PRINTF("delta: not a patch\n");
+    return -1;
+  }
+  patch->old_size = get_uint32(&patch->header[4]);
+  patch->new_size = get_uint32(&patch->header[8]);
+  patch->new_crc = patch->header[14] | (patch->header[15] << 8);
+
+  crc = 0;
+  for(left = patch->old_size; left > 0; left -= n) {
+    n = left < sizeof(buf) ? left : sizeof(buf);
+    if(cfs_read(patch->old_fd, buf, n) != n) {
+      PRINTF("delta: the old image is too short\n");
+      return -1;
+    }
+    crc = crc16_data(buf, n, crc);
+  }
+  if(crc != (patch->header[12] | (patch->header[13] << 8))) {
+    PRINTF("delta: the patch is for another image\n");
+    return -1;
+  }
+
+  cfs_remove(patch->new_file);
+#if DELTA_COFFEE
+  if(cfs_coffee_reserve(patch->new_file, patch->new_size) < 0) {
+    PRINTF("delta: cannot reserve %s\n", patch->new_file);
+    return -1;
+  }
+#endif
+  patch->new_fd = cfs_open(patch->new_file, CFS_WRITE);
+  if(patch->new_fd < 0) {
+    return -1;
+  }
+
+  PRINTF("delta: patching %lu bytes into %lu bytes\n",
+         (unsigned long)patch->old_size, (unsigned long)patch->new_size);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+run_command(struct delta_patch *patch)
+{
+  uint32_t distance;
+
+  switch(patch->command) {
+  case DELTA_COPY:
+    patch->state = STATE_COMMAND;
+    return copy_old(patch, patch->argument);
+  case DELTA_INSERT:
+    patch->state = patch->argument > 0 ? STATE_INSERT : STATE_COMMAND;
+    return 0;
+  case DELTA_SEEK:
+    patch->state = STATE_COMMAND;
+    distance = patch->argument / 2;
+    if(patch->argument & 1) {
+      distance++;
+      if(distance > patch->old_offset) {
+        return -1;
+      }
+      patch->old_offset -= distance;
+    } else {
+      if(distance > patch->old_size - patch->old_offset) {
+        return -1;
+      }
+      patch->old_offset += distance;
+    }
+    return 0;
+  default:
+    return -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_patch_open(struct delta_patch *patch, const char *old_file,
+                 const char *new_file)
+{
+  memset(patch, 0, sizeof(*patch));
+  patch->new_fd = -1;
+  patch->new_file = new_file;
+  patch->state = STATE_HEADER;
+
+  patch->old_fd = cfs_open(old_file, CFS_READ);
+  if(patch->old_fd < 0) {
+    return -1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_patch_write(struct delta_patch *patch, const void *data,
+                  unsigned length)
+{
+  const uint8_t *p;
+  const uint8_t *end;
+  unsigned n;
+
+  p = data;
+  end = p + length;
+  while(p < end) {
+    switch(patch->state) {
+    case STATE_HEADER:
+      patch->header[patch->received++] = *p++;
+      if(patch->received == DELTA_HEADER_SIZE) {
+        if(start_patch(patch) < 0) {
+          goto error;
+        }
+        patch->state = STATE_COMMAND;
+      }
+      break;
+    case STATE_COMMAND:
+      patch->received++;
+      patch->command = *p++;
+      patch->argument = 0;
+      patch->shift = 0;
+      patch->state = STATE_ARGUMENT;
+      break;
+    case STATE_ARGUMENT:
+      if(patch->shift > 28) {
+        goto error;
+      }
+      patch->argument |= (uint32_t)(*p & 0x7f) << patch->shift;
+      patch->shift += 7;
+      patch->received++;
+      if((*p++ & 0x80) == 0 && run_command(patch) < 0) {
+        goto error;
+      }
+      break;
+    case STATE_INSERT:
+      n = end - p;
+      if(n > patch->argument) {
+        n = patch->argument;
+      }
+      if(write_new(patch, p, n) < 0) {
+        goto error;
+      }
+      p += n;
+      patch->received += n;
+      patch->argument -= n;
+      if(patch->argument == 0) {
+        patch->state = STATE_COMMAND;
+      }
+      break;
+    default:
+      return -1;
+    }
+  }
+
+  return length;
+
+error:
+  PRINTF("delta: invalid patch at %lu\n", (unsigned long)patch->received);
+  patch->state = STATE_ERROR;
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_patch_close(struct delta_patch *patch)
+{
+  int complete;
+
+  complete = patch->state == STATE_COMMAND &&
+    patch->new_offset == patch->new_size && patch->crc == patch->new_crc;
+
+  if(patch->old_fd >= 0) {
+    cfs_close(patch->old_fd);
+    patch->old_fd = -1;
+  }
+  if(patch->new_fd >= 0) {
+    cfs_close(patch->new_fd);
+    patch->new_fd = -1;
+    if(!complete) {
+      cfs_remove(patch->new_file);
+    }
+  }
+
+  PRINTF("delta: %s\n", complete ? "done" : "failed");
+  return complete ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_apply(const char *patch_file, const char *old_file,
+            const char *new_file)
+{
+  struct delta_patch patch;
+  uint8_t buf[DELTA_BUFFER_SIZE];
+  int fd;
+  int n;
+
+  fd = cfs_open(patch_file, CFS_READ);
+  if(fd < 0) {
+    return -1;
+  }
+  if(delta_patch_open(&patch, old_file, new_file) < 0) {
+    cfs_close(fd);
+    return -1;
+  }
+
+  while((n = cfs_read(fd, buf, sizeof(buf))) > 0) {
+    if(delta_patch_write(&patch, buf, n) < 0) {
+      break;
+    }
+  }
+
+  cfs_close(fd);
+  return delta_patch_close(&patch);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Application of binary patches to files.
+ *
+ *         A patch describes a new image in terms of an old one, so that
+ *         an update that changes a small part of a firmware image can be
+ *         sent as a patch instead of the complete image. Patches are
+ *         created by tools/delta-diff. They are applied as they arrive,
+ *         in pieces of any size, with a few dozen bytes of RAM: the old
+ *         image is read from one CFS file and the new image is written
+ *         to another.
+ *
+ *         A patch that has been received as a file, for example as a
+ *         Deluge object, is applied with delta_apply(). A patch that is
+ *         received as a stream, for example in the blocks of a CoAP
+ *         Block1 upload, is passed to delta_patch_write() block by block;
+ *         a block is in order if its offset equals the number of bytes
+ *         that the patch has received.
+ */
+
+#ifndef DELTA_H_
+#define DELTA_H_
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+/*
+ * The patch format. All numbers are in little-endian byte order.
+ *
+ * The 16 byte header holds the magic "CDLT", the size of the old image
+ * (4 bytes), the size of the new image (4 bytes), and the CRC-16 of the
+ * old and the new image (2 bytes each).
+ *
+ * The header is followed by commands that produce the new image from
+ * start to end. Each command is a byte with its code followed by its
+ * argument, which is an unsigned number of 7 bits per byte, least
+ * significant first, with the highest bit set in all but the last byte.
+ *
+ * COPY n      copies n bytes from the current position in the old
+ *             image, which advances the position.
+ * INSERT n    is followed by n bytes that are written as they are.
+ * SEEK n      moves the position in the old image forward by n / 2
+ *             bytes if n is even, and backward by (n + 1) / 2 bytes
+ *             if n is odd.
+ */
+#define DELTA_MAGIC          "CDLT"
+#define DELTA_HEADER_SIZE    16
+
+#define DELTA_COPY           1
+#define DELTA_INSERT         2
+#define DELTA_SEEK           3
+
+/* Reserve the new image with cfs_coffee_reserve() before writing it. */
+#ifdef DELTA_CONF_COFFEE
+#define DELTA_COFFEE DELTA_CONF_COFFEE
+#else
+#define DELTA_COFFEE 1
+#endif
+
+/* The size of the buffer through which old data is copied. */
+#ifdef DELTA_CONF_BUFFER_SIZE
+#define DELTA_BUFFER_SIZE DELTA_CONF_BUFFER_SIZE
+#else
+#define DELTA_BUFFER_SIZE 32
+#endif
+
+/* A patch that is being applied. */
+struct delta_patch {
+  int old_fd;
+  int new_fd;
+  const char *new_file;
+  uint32_t old_size;
+  uint32_t new_size;
+  /* The position in the old image. */
+  uint32_t old_offset;
+  /* The number of bytes of the new image written so far. */
+  uint32_t new_offset;
+  /* The number of bytes of the patch received so far. */
+  uint32_t received;
+  /* The argument of the command being decoded, or the number of bytes
+     that remain of an INSERT. */
+  uint32_t argument;
+  uint16_t new_crc;
+  uint16_t crc;
+  uint8_t header[DELTA_HEADER_SIZE];
+  uint8_t state;
+  uint8_t command;
+  uint8_t shift;
+};
+
+/**
+ * \brief Start to apply a patch.
+ * \param patch The patch.
+ * \param old_file The name of the file with the old image.
+ * \param new_file The name of the file to which the new image is written,
+ *        which must stay valid until the patch is closed.
+ * \return 0 on success, -1 if the old image cannot be opened.
+ *
+ * The new file is replaced when the header of the patch has been
+ * received and the old image matches it.
+ */
+int delta_patch_open(struct delta_patch *patch, const char *old_file,
+                     const char *new_file);
+
+/**
+ * \brief Apply the next part of a patch.
+ * \param patch The patch.
+ * \param data The next bytes of the patch.
+ * \param length The number of bytes.
+ * \return \a length, or -1 if the patch is invalid, does not belong to
+ *         the old image, or the new image could not be written.
+ *
+ * After an error, the patch must be closed.
+ */
+int delta_patch_write(struct delta_patch *patch, const void *data,
+                      unsigned length);
+
+/**
+ * \brief Finish applying a patch.
+ * \param patch The patch.
+ * \return 0 if the new image is complete and matches its CRC, -1 otherwise.
+ *
+ * The new file is removed unless the new image is complete.
+ */
+int delta_patch_close(struct delta_patch *patch);
+
+/**
+ * \brief Apply a patch that is stored in a file.
+ * \param patch_file The name of the file with the patch.
+ * \param old_file The name of the file with the old image.
+ * \param new_file The name of the file to which the new image is written.
+ * \return 0 on success, -1 on failure.
+ */
+int delta_apply(const char *patch_file, const char *old_file,
+                const char *new_file);
+
+#endif /* DELTA_H_ */
@@ -157,6 +157,9 @@ init_page(struct deluge_object *obj, int pagenum, int have)
   page->flags = 0;
   page->last_request = 0;
   page->last_data = 0;
+#if DELUGE_WINDOW > 1
+  page->tx_set = 0;
+#endif
 
   if(have) {
     page->version = obj->version;
@@ -205,6 +208,7 @@ init_object(struct deluge_object *obj, char *filename, unsigned version)
   obj->current_rx_page = 0;
   obj->nrequests = 0;
   obj->tx_set = 0;
+  obj->nsources = 0;
 
   obj->pages = malloc(OBJECT_PAGE_COUNT(*obj) * sizeof(*obj->pages));
   if(obj->pages == NULL) {
@@ -236,29 +240,101 @@ highest_available_page(struct deluge_object *obj)
   return i;
 }
 
+static void
+add_source(struct deluge_object *obj, const linkaddr_t *addr,
+	   uint8_t highest_available)
+{
+  struct deluge_source *source;
+  int i;
+
+  for(i = 0; i < obj->nsources; i++) {
+    if(linkaddr_cmp(&obj->sources[i].addr, addr)) {
+      obj->sources[i].highest_available = highest_available;
+      return;
+    }
+  }
+
+  if(obj->nsources < DELUGE_WINDOW) {
+    source = &obj->sources[obj->nsources++];
+  } else {
+    /* Replace the neighbor that has the fewest pages. */
+    source = &obj->sources[0];
+    for(i = 1; i < obj->nsources; i++) {
+      if(obj->sources[i].highest_available < source->highest_available) {
+	source = &obj->sources[i];
+      }
+    }
+    if(source->highest_available > highest_available) {
+      return;
+    }
+  }
+
+  linkaddr_copy(&source->addr, addr);
+  source->highest_available = highest_available;
+}
+
+static struct deluge_source *
+select_source(struct deluge_object *obj, unsigned pagenum)
+{
+  int i, candidates;
+
+  /* Spread the pages of the window over the neighbors that have them. */
+  candidates = 0;
+  for(i = 0; i < obj->nsources; i++) {
+    if(obj->sources[i].highest_available > pagenum) {
+      candidates++;
+    }
+  }
+  if(candidates == 0) {
+    return NULL;
+  }
+
+  candidates = pagenum % candidates;
+  for(i = 0;; i++) {
+    if(obj->sources[i].highest_available > pagenum && candidates-- == 0) {
+      return &obj->sources[i];
+    }
+  }
+}
+
 static void
 send_request(void *arg)
 {
   struct deluge_object *obj;
   struct deluge_msg_request request;
+  struct deluge_source *source;
+  unsigned pagenum;
 
   obj = (struct deluge_object *)arg;
 
   request.cmd = DELUGE_CMD_REQUEST;
-  request.pagenum = obj->current_rx_page;
-  request.version = obj->pages[request.pagenum].version;
-  request.request_set = ~obj->pages[obj->current_rx_page].packet_set;
   request.object_id = obj->object_id;
 
-  PRINTF("Sending request for page %d, version %u, request_set %u\n", 
+  for(pagenum = obj->current_rx_page;
+      pagenum < obj->current_rx_page + DELUGE_WINDOW &&
+      pagenum < OBJECT_PAGE_COUNT(*obj);
+      pagenum++) {
+    source = select_source(obj, pagenum);
+    if(source == NULL || (obj->pages[pagenum].flags & PAGE_COMPLETE)) {
+      continue;
+    }
+
+    request.pagenum = pagenum;
+    request.version = obj->pages[pagenum].version;
+    request.request_set = ~obj->pages[pagenum].packet_set;
+
+    PRINTF("Sending request for page %d, version %u, request_set %u\n", 
 	request.pagenum, request.version, request.request_set);
-  packetbuf_copyfrom(&request, sizeof(request));
-  unicast_send(&deluge_uc, &obj->summary_from);
+    packetbuf_copyfrom(&request, sizeof(request));
+    unicast_send(&deluge_uc, &source->addr);
+  }
 
   /* Deluge R.2 */
   if(++obj->nrequests == CONST_LAMBDA) {
     /* XXX check rate here too. */
     obj->nrequests = 0;
+    /* Find out again which neighbors have the pages. */
+    obj->nsources = 0;
     transition(DELUGE_STATE_MAINTAIN);
   } else {
     ctimer_reset(&rx_timer);
@@ -316,6 +392,8 @@ handle_summary(struct deluge_msg_summary *msg, const linkaddr_t *sender)
       return;
     }
 
+    add_source(&current_object, sender, msg->highest_available);
+
     oldest_request = oldest_data = now = clock_time();
     for(i = 0; i < msg->highest_available; i++) {
       page = &current_object.pages[i];
@@ -332,7 +410,6 @@ handle_summary(struct deluge_msg_summary *msg, const linkaddr_t *sender)
       return;
     }
 
-    linkaddr_copy(&current_object.summary_from, sender);
     transition(DELUGE_STATE_RX);
 
     if(ctimer_expired(&rx_timer)) {
@@ -343,6 +420,125 @@ handle_summary(struct deluge_msg_summary *msg, const linkaddr_t *sender)
   }
 }
 
+#if DELUGE_NETWORK_CODING
+/* Arithmetic in GF(2^8) with the reduction polynomial x^8+x^4+x^3+x^2+1. */
+static uint8_t
+gf_mul(uint8_t a, uint8_t b)
+{
+  uint8_t product;
+
+  for(product = 0; b != 0; b >>= 1) {
+    if(b & 1) {
+      product ^= a;
+    }
+    a = (a << 1) ^ (a & 0x80 ? 0x1d : 0);
+  }
+  return product;
+}
+
+static uint8_t
+gf_inv(uint8_t a)
+{
+  uint8_t result;
+  unsigned exp;
+
+  /* a^254 is the inverse of a, since a^255 = 1. */
+  for(result = 1, exp = 254; exp != 0; exp >>= 1) {
+    if(exp & 1) {
+      result = gf_mul(result, a);
+    }
+    a = gf_mul(a, a);
+  }
+  return result;
+}
+
+/* dst += factor * src */
+static void
+gf_add_scaled(uint8_t *dst, const uint8_t *src, uint8_t factor, unsigned len)
+{
+  while(len-- > 0) {
+    *dst++ ^= gf_mul(factor, *src++);
+  }
+}
+
+static void
+gf_scale(uint8_t *buf, uint8_t factor, unsigned len)
+{
+  while(len-- > 0) {
+    *buf = gf_mul(factor, *buf);
+    buf++;
+  }
+}
+
+static void
+encode_packet(struct deluge_msg_packet *pkt, const unsigned char *page)
+{
+  int i;
+
+  /* Send a random combination of all the packets of the page. */
+  memset(pkt->payload, 0, S_PKT);
+  for(i = 0; i < N_PKT; i++) {
+    do {
+      pkt->coefficients[i] = random_rand();
+    } while(pkt->coefficients[i] == 0);
+    gf_add_scaled(pkt->payload, &page[i * S_PKT], pkt->coefficients[i], S_PKT);
+  }
+
+  pkt->crc = crc16_data(pkt->payload, S_PKT, 0);
+  pkt->crc = crc16_data(pkt->coefficients, N_PKT, pkt->crc);
+}
+
+static int
+decode_packet(struct deluge_object *obj, struct deluge_msg_packet *pkt)
+{
+  struct deluge_page *page;
+  uint8_t (*rows)[N_PKT];
+  unsigned char *buf;
+  uint8_t inverse;
+  int i, pivot;
+
+  /*
+   * The received combinations are kept in reduced row echelon form.
+   * The row with its leading coefficient in column i is stored in
+   * the slot of packet i, and bit i of the packet set is set, so the
+   * buffer holds the decoded page once every bit is set.
+   */
+  page = &obj->pages[pkt->pagenum];
+  rows = obj->coefficients[pkt->pagenum % DELUGE_WINDOW];
+  buf = obj->current_page[pkt->pagenum % DELUGE_WINDOW];
+
+  for(i = 0; i < N_PKT; i++) {
+    if((page->packet_set & (1 << i)) && pkt->coefficients[i] != 0) {
+      gf_add_scaled(pkt->payload, &buf[i * S_PKT], pkt->coefficients[i], S_PKT);
+      gf_add_scaled(pkt->coefficients, rows[i], pkt->coefficients[i], N_PKT);
+    }
+  }
+
+  for(pivot = 0; pivot < N_PKT && pkt->coefficients[pivot] == 0; pivot++);
+  if(pivot == N_PKT) {
+    /* The packet is a combination of those already received. */
+    return 0;
+  }
+
+  inverse = gf_inv(pkt->coefficients[pivot]);
+  gf_scale(pkt->payload, inverse, S_PKT);
+  gf_scale(pkt->coefficients, inverse, N_PKT);
+
+  for(i = 0; i < N_PKT; i++) {
+    if((page->packet_set & (1 << i)) && rows[i][pivot] != 0) {
+      gf_add_scaled(&buf[i * S_PKT], pkt->payload, rows[i][pivot], S_PKT);
+      gf_add_scaled(rows[i], pkt->coefficients, rows[i][pivot], N_PKT);
+    }
+  }
+
+  memcpy(rows[pivot], pkt->coefficients, N_PKT);
+  memcpy(&buf[pivot * S_PKT], pkt->payload, S_PKT);
+  page->packet_set |= 1 << pivot;
+
+  return 1;
+}
+#endif /* DELUGE_NETWORK_CODING */
+
 static void
 send_page(struct deluge_object *obj, unsigned pagenum)
 {
@@ -359,6 +555,19 @@ send_page(struct deluge_object *obj, unsigned pagenum)
 
   read_page(obj, pagenum, buf);
 
+#if DELUGE_NETWORK_CODING
+  /* Any combination that a receiver lacks can replace a missing packet,
+     so send as many combinations as packets were requested. */
+  pkt.cmd = DELUGE_CMD_CODED_PACKET;
+  for(cp = buf; cp + S_PKT <= (unsigned char *)&buf[S_PAGE]; cp += S_PKT) {
+    if(obj->tx_set & (1 << pkt.packetnum)) {
+      encode_packet(&pkt, buf);
+      packetbuf_copyfrom(&pkt, sizeof(pkt));
+      broadcast_send(&deluge_broadcast);
+    }
+    pkt.packetnum++;
+  }
+#else
   /* Divide the page into packets and send them one at a time. */
   for(cp = buf; cp + S_PKT <= (unsigned char *)&buf[S_PAGE]; cp += S_PKT) {
     if(obj->tx_set & (1 << pkt.packetnum)) {
@@ -369,9 +578,29 @@ send_page(struct deluge_object *obj, unsigned pagenum)
     }
     pkt.packetnum++;
   }
+#endif /* DELUGE_NETWORK_CODING */
   obj->tx_set = 0;
 }
 
+static int
+next_tx_page(struct deluge_object *obj)
+{
+#if DELUGE_WINDOW > 1
+  int i;
+
+  /* Continue with the lowest page that has been requested meanwhile. */
+  for(i = 0; i < OBJECT_PAGE_COUNT(*obj); i++) {
+    if(obj->pages[i].tx_set != 0) {
+      obj->current_tx_page = i;
+      obj->tx_set = obj->pages[i].tx_set;
+      obj->pages[i].tx_set = 0;
+      return 1;
+    }
+  }
+#endif
+  return 0;
+}
+
 static void
 tx_callback(void *arg)
 {
@@ -381,7 +610,7 @@ tx_callback(void *arg)
   if(obj->current_tx_page >= 0 && obj->tx_set) {
     send_page(obj, obj->current_tx_page);
     /* Deluge T.2. */
-    if(obj->tx_set) {
+    if(obj->tx_set || next_tx_page(obj)) {
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM);
       ctimer_reset(&tx_timer);
@@ -389,16 +618,31 @@ tx_callback(void *arg)
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
       obj->current_tx_page = -1;
+#if !DELUGE_PIPELINE
       transition(DELUGE_STATE_MAINTAIN);
+#endif
     }
   }
 }
 
+static int
+can_serve(struct deluge_msg_request *msg)
+{
+#if DELUGE_PIPELINE
+  struct deluge_page *page;
+
+  /* Forward every complete page, also while the object is updated. */
+  page = &current_object.pages[msg->pagenum];
+  return msg->version == page->version && (page->flags & PAGE_COMPLETE);
+#else
+  return msg->version == current_object.version &&
+    msg->pagenum <= highest_available_page(&current_object);
+#endif
+}
+
 static void
 handle_request(struct deluge_msg_request *msg)
 {
-  int highest_available;
-
   if(msg->pagenum >= OBJECT_PAGE_COUNT(current_object)) {
     return;
   }
@@ -407,22 +651,28 @@ handle_request(struct deluge_msg_request *msg)
     neighbor_inconsistency = 1;
   }
 
-  highest_available = highest_available_page(&current_object);
-
   /* Deluge M.6 */
-  if(msg->version == current_object.version &&
-      msg->pagenum <= highest_available) {
+  if(can_serve(msg)) {
     current_object.pages[msg->pagenum].last_request = clock_time();
 
     /* Deluge T.1 */
     if(msg->pagenum == current_object.current_tx_page) {
       current_object.tx_set |= msg->request_set;
+#if DELUGE_WINDOW > 1
+    } else if(current_object.current_tx_page >= 0 &&
+              current_object.tx_set != 0) {
+      /* Queue the page until the current one has been sent. */
+      current_object.pages[msg->pagenum].tx_set |= msg->request_set;
+      return;
+#endif
     } else {
       current_object.current_tx_page = msg->pagenum;
       current_object.tx_set = msg->request_set;
     }
 
+#if !DELUGE_PIPELINE
     transition(DELUGE_STATE_TX);
+#endif
     ctimer_set(&tx_timer, CLOCK_SECOND, tx_callback, &current_object);
   }
 }
@@ -433,6 +683,7 @@ handle_packet(struct deluge_msg_packet *msg)
   struct deluge_page *page;
   uint16_t crc;
   struct deluge_msg_packet packet;
+  unsigned char *buf;
 
   memcpy(&packet, msg, sizeof(packet));
 
@@ -440,7 +691,11 @@ handle_packet(struct deluge_msg_packet *msg)
 	(unsigned)packet.object_id, (unsigned)packet.version,
 	(unsigned)packet.pagenum, (unsigned)packet.packetnum);
 
-  if(packet.pagenum != current_object.current_rx_page) {
+  /* Accept the pages of the window that starts at the first missing page. */
+  if(packet.pagenum < current_object.current_rx_page ||
+     packet.pagenum >= current_object.current_rx_page + DELUGE_WINDOW ||
+     packet.pagenum >= OBJECT_PAGE_COUNT(current_object) ||
+     packet.packetnum >= N_PKT) {
     return;
   }
 
@@ -448,46 +703,66 @@ handle_packet(struct deluge_msg_packet *msg)
     neighbor_inconsistency = 1;
   }
 
+  buf = current_object.current_page[packet.pagenum % DELUGE_WINDOW];
   page = &current_object.pages[packet.pagenum];
   if(packet.version == page->version && !(page->flags & PAGE_COMPLETE)) {
-    memcpy(&current_object.current_page[S_PKT * packet.packetnum],
-	packet.payload, S_PKT);
-
     crc = crc16_data(packet.payload, S_PKT, 0);
+#if DELUGE_NETWORK_CODING
+    crc = crc16_data(packet.coefficients, N_PKT, crc);
+#endif
     if(packet.crc != crc) {
       PRINTF("packet crc: %hu, calculated crc: %hu\n", packet.crc, crc);
       return;
     }
 
     page->last_data = clock_time();
+#if DELUGE_NETWORK_CODING
+    if(!decode_packet(&current_object, &packet)) {
+      return;
+    }
+#else
+    memcpy(&buf[S_PKT * packet.packetnum], packet.payload, S_PKT);
     page->packet_set |= (1 << packet.packetnum);
+#endif
 
     if(page->packet_set == ALL_PACKETS) {
       /* This is the last packet of the requested page; stop streaming. */
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
 
-      write_page(&current_object, packet.pagenum, current_object.current_page);
+      write_page(&current_object, packet.pagenum, buf);
       page->version = packet.version;
       page->flags = PAGE_COMPLETE;
       PRINTF("Page %u completed\n", packet.pagenum);
 
-      current_object.current_rx_page++;
+      /* Pages after this one may already have been received. */
+      current_object.current_rx_page = highest_available_page(&current_object);
+      current_object.nrequests = 0;
+#if DELUGE_PIPELINE
+      /* Advertise the new page soon so that neighbors can request it. */
+      neighbor_inconsistency = 1;
+#endif
 
-      if(packet.pagenum == OBJECT_PAGE_COUNT(current_object) - 1) {
+      if(current_object.current_rx_page == OBJECT_PAGE_COUNT(current_object)) {
 	current_object.version = current_object.update_version;
 	leds_on(LEDS_RED);
 	PRINTF("Update completed for object %u, version %u\n", 
 	       (unsigned)current_object.object_id, packet.version);
-      } else if(current_object.current_rx_page < OBJECT_PAGE_COUNT(current_object)) {
-        if(ctimer_expired(&rx_timer)) {
-	  ctimer_set(&rx_timer,
+#ifdef DELUGE_UPDATE_CALLBACK
+	DELUGE_UPDATE_CALLBACK(current_object.filename);
+#endif
+#if DELUGE_WINDOW > 1
+	transition(DELUGE_STATE_MAINTAIN);
+#endif
+      } else if(ctimer_expired(&rx_timer)) {
+	ctimer_set(&rx_timer,
 		CONST_OMEGA * ESTIMATED_TX_TIME + (random_rand() % T_R),
 		send_request, &current_object);
-	}
       }
+#if DELUGE_WINDOW == 1
       /* Deluge R.3 */
       transition(DELUGE_STATE_MAINTAIN);
+#endif
     } else {
       /* More packets to come. Put lower layers in streaming mode. */
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
@@ -521,7 +796,7 @@ send_profile(struct deluge_object *obj)
 }
 
 static void
-handle_profile(struct deluge_msg_profile *msg)
+handle_profile(struct deluge_msg_profile *msg, const linkaddr_t *sender)
 {
   int i;
   int npages;
@@ -571,6 +846,10 @@ handle_profile(struct deluge_msg_profile *msg)
   obj->current_rx_page = highest_available_page(obj);
   obj->update_version = msg->version;
 
+  /* The sender of the profile has the complete object. */
+  obj->nsources = 0;
+  add_source(obj, sender, msg->npages);
+
   transition(DELUGE_STATE_RX);
 
   ctimer_set(&rx_timer,
@@ -599,7 +878,11 @@ command_dispatcher(const linkaddr_t *sender)
     if(len >= sizeof(struct deluge_msg_request))
       handle_request((struct deluge_msg_request *)msg);
     break;
+#if DELUGE_NETWORK_CODING
+  case DELUGE_CMD_CODED_PACKET:
+#else
   case DELUGE_CMD_PACKET:
+#endif
     if(len >= sizeof(struct deluge_msg_packet))
       handle_packet((struct deluge_msg_packet *)msg);
     break;
@@ -607,7 +890,7 @@ command_dispatcher(const linkaddr_t *sender)
     profile = (struct deluge_msg_profile *)msg;
     if(len >= sizeof(*profile) &&
        len >= sizeof(*profile) + profile->npages * profile->version_vector[0])
-      handle_profile((struct deluge_msg_profile *)msg);
+      handle_profile((struct deluge_msg_profile *)msg, sender);
     break;
   default:
     PRINTF("Incoming packet with unknown command: %d\n", msg[0]);
@@ -83,6 +83,7 @@ PROCESS_NAME(deluge_process);
 #define DELUGE_CMD_REQUEST	2
 #define DELUGE_CMD_PACKET	3
 #define DELUGE_CMD_PROFILE	4
+#define DELUGE_CMD_CODED_PACKET	5
 
 #define DELUGE_STATE_MAINTAIN	1
 #define DELUGE_STATE_RX		2
@@ -94,6 +95,41 @@ PROCESS_NAME(deluge_process);
 #define CONST_OMEGA		8
 #define ESTIMATED_TX_TIME	(CLOCK_SECOND)
 
+/* The number of consecutive pages that are requested and received at
+   the same time, possibly from different neighbors. Each page in the
+   window needs a page buffer. */
+#ifdef DELUGE_CONF_WINDOW
+#define DELUGE_WINDOW		DELUGE_CONF_WINDOW
+#else
+#define DELUGE_WINDOW		1
+#endif
+
+/* Serve requests for completed pages while other pages are still
+   being received, instead of alternating between receiving and
+   transmitting. */
+#ifdef DELUGE_CONF_PIPELINE
+#define DELUGE_PIPELINE		DELUGE_CONF_PIPELINE
+#else
+#define DELUGE_PIPELINE		0
+#endif
+
+/* Send random linear combinations of the packets of a page, so that a
+   page is complete after any N_PKT independent packets. All nodes
+   must use the same setting. */
+#ifdef DELUGE_CONF_NETWORK_CODING
+#define DELUGE_NETWORK_CODING	DELUGE_CONF_NETWORK_CODING
+#else
+#define DELUGE_NETWORK_CODING	0
+#endif
+
+/* A function that is called with the file name of the object when a
+   new version of it has been received completely, for example to apply
+   the object as a patch with delta_apply() of apps/delta. */
+#ifdef DELUGE_CONF_UPDATE_CALLBACK
+#define DELUGE_UPDATE_CALLBACK	DELUGE_CONF_UPDATE_CALLBACK
+void DELUGE_UPDATE_CALLBACK(const char *file);
+#endif
+
 typedef uint8_t deluge_object_id_t;
 
 struct deluge_msg_summary {
@@ -118,6 +154,10 @@ struct deluge_msg_packet {
   uint8_t packetnum;
   uint16_t crc;
   deluge_object_id_t object_id;
+#if DELUGE_NETWORK_CODING
+  /* The coefficients of the packets in the payload. */
+  uint8_t coefficients[N_PKT];
+#endif
   unsigned char payload[S_PKT];
 };
 
@@ -129,6 +169,12 @@ struct deluge_msg_profile {
   uint8_t version_vector[];
 };
 
+/* A neighbor that has advertised pages that this node lacks. */
+struct deluge_source {
+  linkaddr_t addr;
+  uint8_t highest_available;
+};
+
 struct deluge_object {
   char *filename;
   uint16_t object_id;
@@ -139,10 +185,16 @@ struct deluge_object {
   uint8_t current_rx_page;
   int8_t current_tx_page;
   uint8_t nrequests;
-  uint8_t current_page[S_PAGE];
+  /* The pages in the receive window, indexed by page number modulo
+     the window size. */
+  uint8_t current_page[DELUGE_WINDOW][S_PAGE];
+#if DELUGE_NETWORK_CODING
+  uint8_t coefficients[DELUGE_WINDOW][N_PKT][N_PKT];
+#endif
   uint8_t tx_set;
   int cfs_fd;
-  linkaddr_t summary_from;
+  struct deluge_source sources[DELUGE_WINDOW];
+  uint8_t nsources;
 };
 
 struct deluge_page {
@@ -152,6 +204,10 @@ struct deluge_page {
   clock_time_t last_data;
   uint8_t flags;
   uint8_t version;
+#if DELUGE_WINDOW > 1
+  /* Packets requested from this page while another page is sent. */
+  uint8_t tx_set;
+#endif
 };
 
 int deluge_disseminate(char *file, unsigned version);
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2016, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      Asynchronous CoAP client for block-wise transfers (Block2)
+ */
+
+#include <string.h>
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "er-coap.h"
+#include "er-coap-transactions.h"
+#include "er-coap-block-client.h"
+
+/* Compile this code only if the block-wise client is required */
+#if COAP_BLOCK_CLIENT
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define UNKNOWN 0xffffffff
+
+static void handle_block_response(void *data, void *response);
+
+/*----------------------------------------------------------------------------*/
+static int
+request_block(struct coap_block_transfer *bt, uint32_t num)
+{
+  coap_packet_t request[1];
+  coap_transaction_t *t;
+  struct coap_block_request *r;
+
+  for(r = bt->requests; r < &bt->requests[COAP_BLOCK_CLIENT_WINDOW]; r++) {
+    if(!r->used) {
+      break;
+    }
+  }
+  if(r == &bt->requests[COAP_BLOCK_CLIENT_WINDOW]) {
+    return 0;
+  }
+
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, coap_get_mid());
+  coap_set_header_uri_path(request, bt->url);
+  coap_set_header_block2(request, num, 0, bt->block_size);
+
+  t = coap_new_transaction(request->mid, &bt->addr, bt->port);
+  if(t == NULL) {
+    PRINTF("Could not allocate transaction buffer\n");
+    return 0;
+  }
+  t->callback = handle_block_response;
+  t->callback_data = r;
+  t->packet_len = coap_serialize_message(request, COAP_TRANSACTION_PACKET(t));
+
+  r->transfer = bt;
+  r->num = num;
+  r->mid = request->mid;
+  r->used = 1;
+
+  PRINTF("Requesting block %lu of /%s\n", (unsigned long)num, bt->url);
+  coap_send_transaction(t);
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+static int
+in_flight(struct coap_block_transfer *bt)
+{
+  int i, n;
+
+  n = 0;
+  for(i = 0; i < COAP_BLOCK_CLIENT_WINDOW; i++) {
+    n += bt->requests[i].used;
+  }
+  return n;
+}
+/*----------------------------------------------------------------------------*/
+static int
+write_block(struct coap_block_transfer *bt, uint32_t offset,
+            const uint8_t *data, uint16_t len)
+{
+  if(bt->buffer != NULL) {
+    if(offset + len > bt->buffer_size) {
+      return 0;
+    }
+    memcpy(bt->buffer + offset, data, len);
+    return 1;
+  }
+
+  /* blocks may arrive out of order */
+  if(cfs_seek(bt->fd, offset, CFS_SEEK_SET) != offset) {
+    return 0;
+  }
+  return cfs_write(bt->fd, data, len) == len;
+}
+/*----------------------------------------------------------------------------*/
+static void
+finish(struct coap_block_transfer *bt, coap_block_transfer_status_t status)
+{
+  PRINTF("Transfer of /%s ended (%u), %lu bytes\n", bt->url, status,
+         (unsigned long)bt->size);
+  coap_block_transfer_stop(bt);
+  if(bt->callback) {
+    bt->callback(bt, status);
+  }
+}
+/*----------------------------------------------------------------------------*/
+static void
+handle_block_response(void *data, void *response)
+{
+  struct coap_block_request *r = (struct coap_block_request *)data;
+  struct coap_block_transfer *bt = r->transfer;
+  coap_packet_t *res = (coap_packet_t *)response;
+  const uint8_t *payload;
+  uint32_t num;
+  uint8_t more;
+  uint16_t size;
+  int len;
+
+  r->used = 0;
+  if(!bt->running) {
+    return;
+  }
+
+  if(res == NULL) {
+    finish(bt, BLOCK_TRANSFER_NO_REPLY_FROM_SERVER);
+    return;
+  }
+
+  if(res->code != CONTENT_2_05) {
+    /* an error beyond the last block is no error */
+    if(r->num < bt->first_error) {
+      bt->first_error = r->num;
+    }
+  } else {
+    if(!coap_get_header_block2(res, &num, &more, &size, NULL)) {
+      /* the whole representation fits in one message */
+      num = 0;
+      more = 0;
+      size = bt->block_size;
+    }
+
+    if(num != r->num) {
+      PRINTF("Wrong block %lu/%lu\n", (unsigned long)num,
+             (unsigned long)r->num);
+      if(r->num < bt->first_error) {
+        bt->first_error = r->num;
+      }
+    } else {
+      if(num == 0) {
+        /* the server may choose a smaller block size */
+        if(size < bt->block_size) {
+          bt->block_size = size;
+        }
+        if(coap_get_header_size2(res, &bt->size) && bt->size > 0) {
+          bt->last_num = (bt->size - 1) / bt->block_size;
+        }
+      }
+
+      len = coap_get_payload(res, &payload);
+      if(!write_block(bt, num * bt->block_size, payload, len)) {
+        finish(bt, BLOCK_TRANSFER_WRITE_ERROR);
+        return;
+      }
+      if(!more) {
+        bt->last_num = num;
+        bt->size = num * bt->block_size + len;
+      }
+      bt->received++;
+    }
+  }
+
+  if(bt->last_num != UNKNOWN) {
+    if(bt->first_error <= bt->last_num) {
+      finish(bt, BLOCK_TRANSFER_ERROR_RESPONSE_CODE);
+      return;
+    }
+    if(bt->received == bt->last_num + 1) {
+      finish(bt, BLOCK_TRANSFER_DONE);
+      return;
+    }
+  }
+
+  /* keep the window full */
+  while(bt->next_num <= bt->last_num && bt->next_num < bt->first_error
+        && request_block(bt, bt->next_num)) {
+    bt->next_num++;
+  }
+
+  if(in_flight(bt) == 0) {
+    /* nothing more can complete the transfer */
+    finish(bt, BLOCK_TRANSFER_ERROR_RESPONSE_CODE);
+  }
+}
+/*----------------------------------------------------------------------------*/
+int
+coap_block_transfer_start(struct coap_block_transfer *bt)
+{
+  memset(bt->requests, 0, sizeof(bt->requests));
+  bt->size = 0;
+  bt->block_size = COAP_MAX_BLOCK_SIZE;
+  bt->next_num = 1;
+  bt->last_num = UNKNOWN;
+  bt->first_error = UNKNOWN;
+  bt->received = 0;
+  bt->running = 1;
+
+  /* the first block tells the block size and maybe the size, the others
+   * are requested in parallel */
+  if(!request_block(bt, 0)) {
+    bt->running = 0;
+    return 0;
+  }
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+void
+coap_block_transfer_stop(struct coap_block_transfer *bt)
+{
+  coap_transaction_t *t;
+  int i;
+
+  bt->running = 0;
+  for(i = 0; i < COAP_BLOCK_CLIENT_WINDOW; i++) {
+    if(bt->requests[i].used) {
+      t = coap_get_transaction_by_mid(bt->requests[i].mid);
+      if(t != NULL && t->callback_data == &bt->requests[i]) {
+        coap_clear_transaction(t);
+      }
+      bt->requests[i].used = 0;
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+#endif /* COAP_BLOCK_CLIENT */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2016, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      Asynchronous CoAP client for block-wise transfers (Block2), which
+ *      keeps several block requests in flight.
+ */
+
+#ifndef COAP_BLOCK_CLIENT_H_
+#define COAP_BLOCK_CLIENT_H_
+
+#include "er-coap.h"
+
+#ifndef COAP_BLOCK_CLIENT
+#define COAP_BLOCK_CLIENT 0
+#endif
+
+/* Number of block requests in flight per transfer */
+#ifdef COAP_CONF_BLOCK_CLIENT_WINDOW
+#define COAP_BLOCK_CLIENT_WINDOW COAP_CONF_BLOCK_CLIENT_WINDOW
+#else
+#define COAP_BLOCK_CLIENT_WINDOW 2
+#endif /* COAP_CONF_BLOCK_CLIENT_WINDOW */
+
+#if COAP_BLOCK_CLIENT && COAP_MAX_OPEN_TRANSACTIONS < COAP_BLOCK_CLIENT_WINDOW
+#warning "COAP_MAX_OPEN_TRANSACTIONS smaller than COAP_BLOCK_CLIENT_WINDOW: " \
+  "this may be a problem"
+#endif
+
+/*----------------------------------------------------------------------------*/
+typedef enum {
+  BLOCK_TRANSFER_DONE,
+  BLOCK_TRANSFER_ERROR_RESPONSE_CODE,
+  BLOCK_TRANSFER_NO_REPLY_FROM_SERVER,
+  BLOCK_TRANSFER_WRITE_ERROR,   /* does not fit in the buffer or the file */
+} coap_block_transfer_status_t;
+
+struct coap_block_transfer;
+
+typedef void (*coap_block_transfer_callback_t)(struct coap_block_transfer *bt,
+                                               coap_block_transfer_status_t
+                                               status);
+
+/* A block request in flight */
+struct coap_block_request {
+  struct coap_block_transfer *transfer;
+  uint32_t num;
+  uint16_t mid;
+  uint8_t used;
+};
+
+struct coap_block_transfer {
+  uip_ipaddr_t addr;
+  uint16_t port;
+  const char *url;
+
+  /* the representation is written to buffer if it is not NULL, and else
+   * to the CFS file fd */
+  uint8_t *buffer;
+  uint32_t buffer_size;
+  int fd;
+
+  coap_block_transfer_callback_t callback;
+  void *data;                   /* generic pointer for storing user data */
+
+  /* length of the representation, once known */
+  uint32_t size;
+
+  /* internal state */
+  uint16_t block_size;
+  uint32_t next_num;
+  uint32_t last_num;            /* known once size is */
+  uint32_t first_error;         /* first block answered with an error */
+  uint32_t received;
+  uint8_t running;
+  struct coap_block_request requests[COAP_BLOCK_CLIENT_WINDOW];
+};
+
+/*----------------------------------------------------------------------------*/
+/* Start fetching the representation of url, the other fields of the
+ * transfer must be set. The callback is called once, when all blocks are
+ * received or the transfer failed. Returns 0 if the first block could not
+ * be requested. */
+int coap_block_transfer_start(struct coap_block_transfer *bt);
+
+/* Stop a transfer, without calling its callback */
+void coap_block_transfer_stop(struct coap_block_transfer *bt);
+
+#endif /* COAP_BLOCK_CLIENT_H_ */
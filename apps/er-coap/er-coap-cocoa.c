@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2016, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP congestion control after CoCoA (draft-ietf-core-cocoa)
+ */
+
+#include "contiki.h"
+#include <string.h>
+#include "lib/memb.h"
+#include "lib/list.h"
+#include "lib/random.h"
+#include "er-coap-cocoa.h"
+
+/* Compile this code only if congestion control is enabled */
+#if COAP_COCOA
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* The RTO of a destination without round-trip time samples */
+#define RTO_INIT  (2 * CLOCK_SECOND)
+#define RTO_MAX   (32 * CLOCK_SECOND)
+
+MEMB(peers_memb, coap_peer_t, COAP_COCOA_PEERS);
+LIST(peers_list);
+
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+estimate(struct coap_rtt_estimator *e, clock_time_t rtt, uint8_t k)
+{
+  clock_time_t var;
+
+  if(!e->valid) {
+    e->srtt = rtt;
+    e->rttvar = rtt / 2;
+    e->valid = 1;
+  } else {
+    e->rttvar = (3 * e->rttvar +
+                 (e->srtt > rtt ? e->srtt - rtt : rtt - e->srtt)) / 4;
+    e->srtt = (7 * e->srtt + rtt) / 8;
+  }
+
+  /* the variance term is at least the clock granularity */
+  var = k * e->rttvar;
+  return e->srtt + (var > 0 ? var : 1);
+}
+/*---------------------------------------------------------------------------*/
+coap_peer_t *
+coap_cocoa_get_peer(const uip_ipaddr_t *addr)
+{
+  coap_peer_t *p, *idle;
+
+  idle = NULL;
+  for(p = list_head(peers_list); p != NULL; p = p->next) {
+    if(uip_ipaddr_cmp(&p->addr, addr)) {
+      /* keep the list in least recently used order */
+      list_remove(peers_list, p);
+      list_push(peers_list, p);
+      return p;
+    }
+    if(p->outstanding == 0) {
+      idle = p;
+    }
+  }
+
+  p = memb_alloc(&peers_memb);
+  if(p == NULL) {
+    /* replace the least recently used peer without exchanges */
+    if(idle == NULL) {
+      PRINTF("CoCoA: no peer entry left\n");
+      return NULL;
+    }
+    list_remove(peers_list, idle);
+    p = idle;
+  }
+
+  memset(p, 0, sizeof(coap_peer_t));
+  uip_ipaddr_copy(&p->addr, addr);
+  p->rto = RTO_INIT;
+  p->updated = clock_time();
+  list_push(peers_list, p);
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+coap_cocoa_initial_timeout(coap_peer_t *p)
+{
+  clock_time_t now;
+
+  /* age the RTOs that were not updated for long towards RTO_INIT */
+  now = clock_time();
+  if(p->rto < CLOCK_SECOND && now - p->updated > 16 * p->rto) {
+    p->rto *= 2;
+    p->updated = now;
+  } else if(p->rto > 3 * CLOCK_SECOND && now - p->updated > 4 * p->rto) {
+    p->rto = (RTO_INIT + p->rto) / 2;
+    p->updated = now;
+  }
+
+  /* dither between RTO and 1.5 RTO */
+  return p->rto + random_rand() % (p->rto / 2 + 1);
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+coap_cocoa_backoff(coap_peer_t *p, clock_time_t interval)
+{
+  clock_time_t rto = p != NULL ? p->rto : RTO_INIT;
+
+  /* variable backoff factor: short RTOs back off faster */
+  if(rto < CLOCK_SECOND) {
+    return 3 * interval;
+  } else if(rto > 3 * CLOCK_SECOND) {
+    return interval + interval / 2;
+  }
+  return 2 * interval;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_cocoa_rtt_sample(coap_peer_t *p, clock_time_t rtt,
+                      uint8_t retransmissions)
+{
+  clock_time_t rto;
+
+  if(retransmissions == 0) {
+    rto = estimate(&p->strong, rtt, 4);
+    p->rto = (rto + p->rto) / 2;
+  } else if(retransmissions <= 2) {
+    /* the RTT is measured from the first transmission */
+    rto = estimate(&p->weak, rtt, 1);
+    p->rto = (rto + 3 * p->rto) / 4;
+  } else {
+    return;
+  }
+
+  if(p->rto > RTO_MAX) {
+    p->rto = RTO_MAX;
+  } else if(p->rto == 0) {
+    p->rto = 1;
+  }
+  p->updated = clock_time();
+
+  PRINTF("CoCoA: RTT %lu (%u), RTO %lu\n", (unsigned long)rtt,
+         retransmissions, (unsigned long)p->rto);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* COAP_COCOA */
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2016, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP congestion control after CoCoA: a cache of the round-trip
+ *      times and outstanding exchanges per destination.
+ */
+
+#ifndef COAP_COCOA_H_
+#define COAP_COCOA_H_
+
+#include "er-coap.h"
+
+/* Round-trip time estimator, as in RFC 6298 */
+struct coap_rtt_estimator {
+  clock_time_t srtt;
+  clock_time_t rttvar;
+  uint8_t valid;
+};
+
+typedef struct coap_peer {
+  struct coap_peer *next;       /* for LIST */
+
+  uip_ipaddr_t addr;
+
+  /* the estimator of the exchanges that were not retransmitted, and of
+   * the ones that were retransmitted once or twice */
+  struct coap_rtt_estimator strong;
+  struct coap_rtt_estimator weak;
+
+  clock_time_t rto;
+  clock_time_t updated;         /* when rto last changed, for aging */
+
+  uint8_t outstanding;          /* confirmable exchanges, up to COAP_NSTART */
+} coap_peer_t;
+
+/* Get the cache entry of a destination, creating it if needed. Returns
+ * NULL if the cache is full of destinations with outstanding exchanges. */
+coap_peer_t *coap_cocoa_get_peer(const uip_ipaddr_t *addr);
+
+/* Timeout before the first retransmission to a peer, dithered */
+clock_time_t coap_cocoa_initial_timeout(coap_peer_t *p);
+
+/* Timeout before the next retransmission, after one of interval. The
+ * peer may be NULL, for destinations that are not in the cache. */
+clock_time_t coap_cocoa_backoff(coap_peer_t *p, clock_time_t interval);
+
+/* Update the RTO of a peer with the round-trip time of an exchange */
+void coap_cocoa_rtt_sample(coap_peer_t *p, clock_time_t rtt,
+                           uint8_t retransmissions);
+
+#endif /* COAP_COCOA_H_ */
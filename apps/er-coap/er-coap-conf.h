@@ -39,6 +39,26 @@
 #ifndef ER_COAP_CONF_H_
 #define ER_COAP_CONF_H_
 
+/* Forward proxy with a response cache (er-coap-proxy), for border routers
+ * whose clients read the same resources of the mesh: requests with a
+ * Proxy-Uri of the form coap://[address]:port/path?query are answered
+ * from the cache while their Max-Age lasts, stale entries are
+ * revalidated with their ETag, and identical requests that arrive while
+ * one is forwarded wait for its response. Only GET is proxied. */
+#ifndef COAP_PROXY
+#define COAP_PROXY                     0
+#endif /* COAP_PROXY */
+
+/* Number of cached responses, each takes about REST_MAX_CHUNK_SIZE bytes */
+#ifndef COAP_PROXY_CACHE_SIZE
+#define COAP_PROXY_CACHE_SIZE          2
+#endif /* COAP_PROXY_CACHE_SIZE */
+
+/* Number of clients waiting for a forwarded request */
+#ifndef COAP_PROXY_MAX_WAITERS
+#define COAP_PROXY_MAX_WAITERS         4
+#endif /* COAP_PROXY_MAX_WAITERS */
+
 /* Features that can be disabled to achieve smaller memory footprint */
 #define COAP_LINK_FORMAT_FILTERING     0
 #define COAP_PROXY_OPTION_PROCESSING   0
@@ -53,6 +73,73 @@
 #define COAP_MAX_OPEN_TRANSACTIONS     4
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
+/* Keep the messages of the transactions in the shared packet memory
+ * (lib/pktmem) instead of in a COAP_MAX_PACKET_SIZE buffer in each
+ * transaction. A transaction then holds a full-size block only while its
+ * message is built, and a confirmable one keeps just the bytes it has to
+ * retransmit, so that many more transactions may be open in the same
+ * RAM. The transactions share COAP_TRANSACTIONS_PKTMEM_BUDGET bytes. */
+#ifndef COAP_TRANSACTIONS_PKTMEM
+#define COAP_TRANSACTIONS_PKTMEM       0
+#endif /* COAP_TRANSACTIONS_PKTMEM */
+
+#ifndef COAP_TRANSACTIONS_PKTMEM_BUDGET
+#define COAP_TRANSACTIONS_PKTMEM_BUDGET (2 * (COAP_MAX_PACKET_SIZE + 1))
+#endif /* COAP_TRANSACTIONS_PKTMEM_BUDGET */
+
+/* Bytes of the packet memory kept for the transactions, so that a
+ * response can be built whatever the other users hold. */
+#ifndef COAP_TRANSACTIONS_PKTMEM_RESERVE
+#define COAP_TRANSACTIONS_PKTMEM_RESERVE (COAP_MAX_PACKET_SIZE + 1)
+#endif /* COAP_TRANSACTIONS_PKTMEM_RESERVE */
+
+/* Number of hash buckets (a power of two) of an index of the open
+ * transactions by message ID, for matching ACKs and RSTs. 0 walks all
+ * transactions. */
+#ifndef COAP_TRANSACTIONS_HASH
+#define COAP_TRANSACTIONS_HASH         0
+#endif /* COAP_TRANSACTIONS_HASH */
+
+/* Serialize responses and notifications around the payload that the
+ * resource handler wrote to the transaction buffer, instead of moving the
+ * payload behind the options: only the header is moved, to just before
+ * the payload. */
+#ifndef COAP_SERIALIZE_IN_PLACE
+#define COAP_SERIALIZE_IN_PLACE        0
+#endif /* COAP_SERIALIZE_IN_PLACE */
+
+/* Congestion control after CoCoA (draft-ietf-core-cocoa): the initial
+ * retransmission timeout of a confirmable message follows the round-trip
+ * times measured to its destination instead of COAP_RESPONSE_TIMEOUT,
+ * and at most COAP_NSTART exchanges with a destination are outstanding
+ * at a time, the others wait for one to end. */
+#ifndef COAP_COCOA
+#define COAP_COCOA                     0
+#endif /* COAP_COCOA */
+
+/* Number of destinations whose round-trip times are kept */
+#ifndef COAP_COCOA_PEERS
+#define COAP_COCOA_PEERS               4
+#endif /* COAP_COCOA_PEERS */
+
+/* Number of outstanding confirmable exchanges per destination, with
+ * COAP_COCOA */
+#ifndef COAP_NSTART
+#define COAP_NSTART                    1
+#endif /* COAP_NSTART */
+
+/* Number of representations of resources unaware of blockwise transfers
+ * that are kept between the requests for their blocks, so that the
+ * handler is called for the first block only. 0 calls it for every block. */
+#ifndef COAP_BLOCK_CACHE
+#define COAP_BLOCK_CACHE               0
+#endif /* COAP_BLOCK_CACHE */
+
+/* Time (in clock ticks) a representation is served from the block cache */
+#ifndef COAP_BLOCK_CACHE_LIFETIME
+#define COAP_BLOCK_CACHE_LIFETIME      (10 * CLOCK_SECOND)
+#endif /* COAP_BLOCK_CACHE_LIFETIME */
+
 /* Maximum number of failed request attempts before action */
 #ifndef COAP_MAX_ATTEMPTS
 #define COAP_MAX_ATTEMPTS              4
@@ -71,4 +158,31 @@
 /* Interval in notifies in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVE_REFRESH_INTERVAL  20
 
+/* Number of hash buckets (a power of two) of an index of the observers by
+ * the resource they observe, so that a notification only walks the
+ * observers of its resource. 0 walks all observers. */
+#ifndef COAP_OBSERVE_INDEX
+#define COAP_OBSERVE_INDEX             0
+#endif /* COAP_OBSERVE_INDEX */
+
+/* Call the GET handler of a resource once per notification event rather
+ * than once per observer; only token, MID, type and observe sequence
+ * differ between the notifications sent. */
+#ifndef COAP_OBSERVE_BATCH
+#define COAP_OBSERVE_BATCH             0
+#endif /* COAP_OBSERVE_BATCH */
+
+/* Coalescing window (in clock ticks): a resource notifies at most once per
+ * window, the notifications requested within a window are merged into one
+ * sent at its end. 0 sends every notification at once. */
+#ifndef COAP_OBSERVE_COALESCE_WINDOW
+#define COAP_OBSERVE_COALESCE_WINDOW   0
+#endif /* COAP_OBSERVE_COALESCE_WINDOW */
+
+/* Number of resources that can be in a coalescing window at the same
+ * time; when none is left, notifications are sent at once. */
+#ifndef COAP_OBSERVE_COALESCE_SLOTS
+#define COAP_OBSERVE_COALESCE_SLOTS    2
+#endif /* COAP_OBSERVE_COALESCE_SLOTS */
+
 #endif /* ER_COAP_CONF_H_ */
@@ -137,6 +137,12 @@ typedef enum {
   COAP_OPTION_SIZE1 = 60,       /* 0-4 B */
 } coap_option_t;
 
+/* Content-Format of series encoded with lib/timeseries.h. It is not
+ * registered with IANA, so the default is from the experimental range */
+#ifndef COAP_TIMESERIES_FORMAT
+#define COAP_TIMESERIES_FORMAT 65000
+#endif /* COAP_TIMESERIES_FORMAT */
+
 /* CoAP Content-Formats */
 typedef enum {
   TEXT_PLAIN = 0,
@@ -160,7 +166,9 @@ typedef enum {
   APPLICATION_FASTINFOSET = 48,
   APPLICATION_SOAP_FASTINFOSET = 49,
   APPLICATION_JSON = 50,
-  APPLICATION_X_OBIX_BINARY = 51
+  APPLICATION_X_OBIX_BINARY = 51,
+  APPLICATION_CBOR = 60,
+  APPLICATION_X_TIMESERIES = COAP_TIMESERIES_FORMAT
 } coap_content_format_t;
 
 #endif /* ER_COAP_CONSTANTS_H_ */
@@ -61,6 +61,116 @@ PROCESS(coap_engine, "CoAP Engine");
 /*---------------------------------------------------------------------------*/
 static service_callback_t service_cbk = NULL;
 
+#if COAP_BLOCK_CACHE
+/* Uri-Path and Uri-Query of the cached representations */
+#define BLOCK_CACHE_KEY_LEN 32
+
+struct block_cache {
+  char key[BLOCK_CACHE_KEY_LEN];
+  uint8_t key_len;
+  struct timer lifetime;
+  uint8_t code;
+  uint16_t content_format;
+  uint8_t etag_len;
+  uint8_t etag[COAP_ETAG_LEN];
+  uint16_t payload_len;
+  uint8_t payload[REST_MAX_CHUNK_SIZE];
+};
+static struct block_cache block_cache[COAP_BLOCK_CACHE];
+static uint8_t block_cache_next;
+#endif /* COAP_BLOCK_CACHE */
+
+/*---------------------------------------------------------------------------*/
+/*- Block Cache -------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+#if COAP_BLOCK_CACHE
+static int
+block_cache_key(coap_packet_t *request, char *key)
+{
+  size_t len = request->uri_path_len + 1 + request->uri_query_len;
+
+  if(len > BLOCK_CACHE_KEY_LEN) {
+    return 0;
+  }
+  memcpy(key, request->uri_path, request->uri_path_len);
+  key[request->uri_path_len] = '?';
+  memcpy(key + request->uri_path_len + 1, request->uri_query,
+         request->uri_query_len);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static struct block_cache *
+block_cache_lookup(const char *key, int key_len)
+{
+  int i;
+
+  for(i = 0; i < COAP_BLOCK_CACHE; i++) {
+    if(block_cache[i].key_len == key_len
+       && memcmp(block_cache[i].key, key, key_len) == 0) {
+      return &block_cache[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Answer a request for a later block of a cached representation */
+static int
+block_cache_get(coap_packet_t *request, coap_packet_t *response,
+                uint8_t *buffer, uint32_t block_num)
+{
+  struct block_cache *c;
+  char key[BLOCK_CACHE_KEY_LEN];
+  int key_len;
+
+  if(request->code != COAP_GET || block_num == 0
+     || !IS_OPTION(request, COAP_OPTION_BLOCK2)
+     || (key_len = block_cache_key(request, key)) == 0
+     || (c = block_cache_lookup(key, key_len)) == NULL
+     || timer_expired(&c->lifetime)) {
+    return 0;
+  }
+
+  PRINTF("Blockwise: block %lu from the cache\n", block_num);
+  response->code = c->code;
+  coap_set_header_content_format(response, c->content_format);
+  if(c->etag_len) {
+    coap_set_header_etag(response, c->etag, c->etag_len);
+  }
+  memcpy(buffer, c->payload, c->payload_len);
+  coap_set_payload(response, buffer, c->payload_len);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Keep the representation of a resource that is unaware of blockwise
+ * transfers for the requests of its next blocks */
+static void
+block_cache_put(coap_packet_t *request, coap_packet_t *response)
+{
+  struct block_cache *c;
+  char key[BLOCK_CACHE_KEY_LEN];
+  int key_len;
+
+  key_len = block_cache_key(request, key);
+  if(key_len == 0) {
+    return;
+  }
+  c = block_cache_lookup(key, key_len);
+  if(c == NULL) {
+    c = &block_cache[block_cache_next];
+    block_cache_next = (block_cache_next + 1) % COAP_BLOCK_CACHE;
+  }
+
+  memcpy(c->key, key, key_len);
+  c->key_len = key_len;
+  timer_set(&c->lifetime, COAP_BLOCK_CACHE_LIFETIME);
+  c->code = response->code;
+  c->content_format = response->content_format;
+  c->etag_len = IS_OPTION(response, COAP_OPTION_ETAG) ? response->etag_len : 0;
+  memcpy(c->etag, response->etag, c->etag_len);
+  c->payload_len = response->payload_len;
+  memcpy(c->payload, response->payload, c->payload_len);
+}
+#endif /* COAP_BLOCK_CACHE */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -107,6 +217,9 @@ coap_receive(void)
           uint16_t block_size = COAP_MAX_BLOCK_SIZE;
           uint32_t block_offset = 0;
           int32_t new_offset = 0;
+#if COAP_BLOCK_CACHE
+          int cached = 0;
+#endif /* COAP_BLOCK_CACHE */
 
           /* prepare response */
           if(message->type == COAP_TYPE_CON) {
@@ -134,8 +247,22 @@ coap_receive(void)
           if(service_cbk) {
 
             /* call REST framework and check if found and allowed */
-            if(service_cbk
-                 (message, response, transaction->packet + COAP_MAX_HEADER_SIZE,
+            if(
+#if COAP_PROXY
+               (IS_OPTION(message, COAP_OPTION_PROXY_URI)
+                && coap_proxy_handler(message, response,
+                                      COAP_TRANSACTION_PACKET(transaction)
+                                      + COAP_MAX_HEADER_SIZE,
+                                      block_size, &new_offset)) ||
+#endif /* COAP_PROXY */
+#if COAP_BLOCK_CACHE
+               (cached = block_cache_get(message, response,
+                                         COAP_TRANSACTION_PACKET(transaction)
+                                         + COAP_MAX_HEADER_SIZE, block_num)) ||
+#endif /* COAP_BLOCK_CACHE */
+               service_cbk
+                 (message, response,
+                 COAP_TRANSACTION_PACKET(transaction) + COAP_MAX_HEADER_SIZE,
                  block_size, &new_offset)) {
 
               if(erbium_status_code == NO_ERROR) {
@@ -156,6 +283,13 @@ coap_receive(void)
 
                   /* unchanged new_offset indicates that resource is unaware of blockwise transfer */
                   if(new_offset == block_offset) {
+#if COAP_BLOCK_CACHE
+                    if(!cached && message->code == COAP_GET
+                       && response->code == CONTENT_2_05
+                       && response->payload_len > block_size) {
+                      block_cache_put(message, response);
+                    }
+#endif /* COAP_BLOCK_CACHE */
                     PRINTF
                       ("Blockwise: unaware resource with payload length %u/%u\n",
                       response->payload_len, block_size);
@@ -208,10 +342,18 @@ coap_receive(void)
                 /* serialize response */
             }
             if(erbium_status_code == NO_ERROR) {
-              if((transaction->packet_len = coap_serialize_message(response,
-                                                                   transaction->
-                                                                   packet)) ==
-                 0) {
+#if COAP_SERIALIZE_IN_PLACE
+              transaction->packet_len =
+                coap_serialize_message_in_place(response,
+                                                COAP_TRANSACTION_PACKET
+                                                  (transaction),
+                                                &transaction->packet_offset);
+#else /* COAP_SERIALIZE_IN_PLACE */
+              transaction->packet_len =
+                coap_serialize_message(response,
+                                       COAP_TRANSACTION_PACKET(transaction));
+#endif /* COAP_SERIALIZE_IN_PLACE */
+              if(transaction->packet_len == 0) {
                 erbium_status_code = PACKET_SERIALIZATION_ERROR;
               }
             }
@@ -245,6 +387,9 @@ coap_receive(void)
           restful_response_handler callback = transaction->callback;
           void *callback_data = transaction->callback_data;
 
+#if COAP_COCOA
+          coap_transaction_answered(transaction);
+#endif /* COAP_COCOA */
           coap_clear_transaction(transaction);
 
           /* check if someone registered for the response */
@@ -349,7 +494,9 @@ PROCESS_THREAD(coap_engine, ev, data)
       coap_receive();
     } else if(ev == PROCESS_EVENT_TIMER) {
       /* retransmissions are handled here */
-      coap_check_transactions();
+      if(!coap_check_transaction_timer(data)) {
+        coap_check_transactions();
+      }
     }
   } /* while (1) */
 
@@ -399,9 +546,9 @@ PT_THREAD(coap_blocking_request
                                REST_MAX_CHUNK_SIZE);
       }
       state->transaction->packet_len = coap_serialize_message(request,
-                                                              state->
-                                                              transaction->
-                                                              packet);
+                                                              COAP_TRANSACTION_PACKET
+                                                                (state->
+                                                                transaction));
 
       coap_send_transaction(state->transaction);
       PRINTF("Requested #%lu (MID %u)\n", state->block_num, request->mid);
@@ -514,7 +661,9 @@ const struct rest_implementation coap_rest_implementation = {
     APPLICATION_FASTINFOSET,
     APPLICATION_SOAP_FASTINFOSET,
     APPLICATION_JSON,
-    APPLICATION_X_OBIX_BINARY
+    APPLICATION_X_OBIX_BINARY,
+    APPLICATION_CBOR,
+    APPLICATION_X_TIMESERIES
   }
 };
 /*---------------------------------------------------------------------------*/
@@ -45,6 +45,8 @@
 #include "er-coap-observe.h"
 #include "er-coap-separate.h"
 #include "er-coap-observe-client.h"
+#include "er-coap-block-client.h"
+#include "er-coap-proxy.h"
 
 #define SERVER_LISTEN_PORT      UIP_HTONS(COAP_SERVER_PORT)
 
@@ -328,7 +328,8 @@ coap_obs_request_registration(uip_ipaddr_t *addr, uint16_t port, char *uri,
     if(obs) {
       t->callback = handle_obs_registration_response;
       t->callback_data = obs;
-      t->packet_len = coap_serialize_message(request, t->packet);
+      t->packet_len = coap_serialize_message(request,
+                                             COAP_TRANSACTION_PACKET(t));
       coap_send_transaction(t);
     } else {
       PRINTF("Could not allocate obs_subject resource buffer");
@@ -55,12 +55,42 @@
 /*---------------------------------------------------------------------------*/
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
+
+#if COAP_OBSERVE_INDEX
+/* The observers, chained on hash_next in the bucket of their resource */
+static coap_observer_t *observer_buckets[COAP_OBSERVE_INDEX];
+#endif /* COAP_OBSERVE_INDEX */
+
+#if COAP_OBSERVE_COALESCE_WINDOW
+/* A resource in its coalescing window */
+struct coalesce {
+  struct coalesce *next;
+  resource_t *resource;
+  char subpath[COAP_OBSERVER_URL_LEN];
+  uint8_t pending;
+  struct ctimer timer;
+};
+MEMB(coalesce_memb, struct coalesce, COAP_OBSERVE_COALESCE_SLOTS);
+LIST(coalesce_list);
+#endif /* COAP_OBSERVE_COALESCE_WINDOW */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+#if COAP_OBSERVE_INDEX
+static coap_observer_t **
+bucket_from_resource(const resource_t *resource)
+{
+  uintptr_t hash = (uintptr_t)resource;
+
+  hash ^= hash >> 8;
+  return &observer_buckets[(hash >> 2) & (COAP_OBSERVE_INDEX - 1)];
+}
+#endif /* COAP_OBSERVE_INDEX */
+/*---------------------------------------------------------------------------*/
 static coap_observer_t *
-add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
-             size_t token_len, const char *uri, int uri_len)
+add_observer(resource_t *resource, uip_ipaddr_t *addr, uint16_t port,
+             const uint8_t *token, size_t token_len,
+             const char *uri, int uri_len)
 {
   /* Remove existing observe relationship, if any. */
   coap_remove_observer_by_uri(addr, port, uri);
@@ -84,6 +114,11 @@ add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
            list_length(observers_list) + 1, COAP_MAX_OBSERVERS,
            o->url, o->token[0], o->token[1]);
     list_add(observers_list, o);
+#if COAP_OBSERVE_INDEX
+    o->resource = resource;
+    o->hash_next = *bucket_from_resource(resource);
+    *bucket_from_resource(resource) = o;
+#endif /* COAP_OBSERVE_INDEX */
   }
 
   return o;
@@ -94,9 +129,22 @@ add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
 void
 coap_remove_observer(coap_observer_t *o)
 {
+#if COAP_OBSERVE_INDEX
+  coap_observer_t **p;
+#endif /* COAP_OBSERVE_INDEX */
+
   PRINTF("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0],
          o->token[1]);
 
+#if COAP_OBSERVE_INDEX
+  for(p = bucket_from_resource(o->resource); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == o) {
+      *p = o->hash_next;
+      break;
+    }
+  }
+#endif /* COAP_OBSERVE_INDEX */
+
   memb_free(&observers_memb, o);
   list_remove(observers_list, o);
 }
@@ -180,13 +228,8 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 /*---------------------------------------------------------------------------*/
 /*- Notification ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
-void
-coap_notify_observers(resource_t *resource)
-{
-  coap_notify_observers_sub(resource, NULL);
-}
-void
-coap_notify_observers_sub(resource_t *resource, const char *subpath)
+static void
+notify_observers(resource_t *resource, const char *subpath)
 {
   /* build notification */
   coap_packet_t notification[1]; /* this way the packet can be treated as pointer as usual */
@@ -194,6 +237,11 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   coap_observer_t *obs = NULL;
   int url_len, obs_url_len;
   char url[COAP_OBSERVER_URL_LEN];
+#if COAP_OBSERVE_BATCH
+  /* The representation, built for the first observer and sent to all */
+  static uint8_t payload[REST_MAX_CHUNK_SIZE];
+  uint8_t built = 0;
+#endif /* COAP_OBSERVE_BATCH */
 
   url_len = strlen(resource->url);
   strncpy(url, resource->url, COAP_OBSERVER_URL_LEN - 1);
@@ -212,8 +260,15 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
 
   /* iterate over observers */
   url_len = strlen(url);
+#if COAP_OBSERVE_INDEX
+  for(obs = *bucket_from_resource(resource); obs; obs = obs->hash_next) {
+    if(obs->resource != resource) {
+      continue;
+    }
+#else /* COAP_OBSERVE_INDEX */
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
       obs = obs->next) {
+#endif /* COAP_OBSERVE_INDEX */
     obs_url_len = strlen(obs->url);
 
     /* Do a match based on the parent/sub-resource match so that it is
@@ -228,6 +283,9 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
       /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
 
       if((transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port))) {
+#if COAP_OBSERVE_BATCH
+        notification->type = COAP_TYPE_NON;
+#endif /* COAP_OBSERVE_BATCH */
         if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
           PRINTF("           Force Confirmable for\n");
           notification->type = COAP_TYPE_CON;
@@ -243,17 +301,34 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
         /* prepare response */
         notification->mid = transaction->mid;
 
+#if COAP_OBSERVE_BATCH
+        if(!built) {
+          resource->get_handler(request, notification, payload,
+                                REST_MAX_CHUNK_SIZE, NULL);
+          built = 1;
+        }
+#else /* COAP_OBSERVE_BATCH */
         resource->get_handler(request, notification,
-                              transaction->packet + COAP_MAX_HEADER_SIZE,
+                              COAP_TRANSACTION_PACKET(transaction) +
+                              COAP_MAX_HEADER_SIZE,
                               REST_MAX_CHUNK_SIZE, NULL);
+#endif /* COAP_OBSERVE_BATCH */
 
         if(notification->code < BAD_REQUEST_4_00) {
           coap_set_header_observe(notification, (obs->obs_counter)++);
         }
         coap_set_token(notification, obs->token, obs->token_len);
 
+#if COAP_SERIALIZE_IN_PLACE && !COAP_OBSERVE_BATCH
+        transaction->packet_len =
+          coap_serialize_message_in_place(notification,
+                                          COAP_TRANSACTION_PACKET(transaction),
+                                          &transaction->packet_offset);
+#else /* COAP_SERIALIZE_IN_PLACE && !COAP_OBSERVE_BATCH */
         transaction->packet_len =
-          coap_serialize_message(notification, transaction->packet);
+          coap_serialize_message(notification,
+                                 COAP_TRANSACTION_PACKET(transaction));
+#endif /* COAP_SERIALIZE_IN_PLACE && !COAP_OBSERVE_BATCH */
 
         coap_send_transaction(transaction);
       }
@@ -261,6 +336,59 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if COAP_OBSERVE_COALESCE_WINDOW
+static void
+coalesce_expired(void *ptr)
+{
+  struct coalesce *c = ptr;
+
+  if(c->pending) {
+    /* send what was held back and start another window */
+    c->pending = 0;
+    ctimer_reset(&c->timer);
+    notify_observers(c->resource, c->subpath);
+  } else {
+    list_remove(coalesce_list, c);
+    memb_free(&coalesce_memb, c);
+  }
+}
+#endif /* COAP_OBSERVE_COALESCE_WINDOW */
+/*---------------------------------------------------------------------------*/
+void
+coap_notify_observers(resource_t *resource)
+{
+  coap_notify_observers_sub(resource, NULL);
+}
+void
+coap_notify_observers_sub(resource_t *resource, const char *subpath)
+{
+#if COAP_OBSERVE_COALESCE_WINDOW
+  struct coalesce *c;
+
+  if(subpath == NULL) {
+    subpath = "";
+  }
+  for(c = list_head(coalesce_list); c != NULL; c = c->next) {
+    if(c->resource == resource
+       && strncmp(c->subpath, subpath, sizeof(c->subpath) - 1) == 0) {
+      /* in its window: merged into the notification sent at the end */
+      c->pending = 1;
+      return;
+    }
+  }
+  c = memb_alloc(&coalesce_memb);
+  if(c != NULL) {
+    c->resource = resource;
+    strncpy(c->subpath, subpath, sizeof(c->subpath) - 1);
+    c->subpath[sizeof(c->subpath) - 1] = '\0';
+    c->pending = 0;
+    ctimer_set(&c->timer, COAP_OBSERVE_COALESCE_WINDOW, coalesce_expired, c);
+    list_add(coalesce_list, c);
+  }
+#endif /* COAP_OBSERVE_COALESCE_WINDOW */
+  notify_observers(resource, subpath);
+}
+/*---------------------------------------------------------------------------*/
 void
 coap_observe_handler(resource_t *resource, void *request, void *response)
 {
@@ -271,7 +399,8 @@ coap_observe_handler(resource_t *resource, void *request, void *response)
   if(coap_req->code == COAP_GET && coap_res->code < 128) { /* GET request and response without error code */
     if(IS_OPTION(coap_req, COAP_OPTION_OBSERVE)) {
       if(coap_req->observe == 0) {
-        obs = add_observer(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport,
+        obs = add_observer(resource, &UIP_IP_BUF->srcipaddr,
+                           UIP_UDP_BUF->srcport,
                            coap_req->token, coap_req->token_len,
                            coap_req->uri_path, coap_req->uri_path_len);
        if(obs) {
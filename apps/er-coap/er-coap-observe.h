@@ -67,6 +67,10 @@ typedef struct coap_observer {
 
   struct etimer retrans_timer;
   uint8_t retrans_counter;
+#if COAP_OBSERVE_INDEX
+  resource_t *resource;               /* the resource observed */
+  struct coap_observer *hash_next;    /* next in the same index bucket */
+#endif /* COAP_OBSERVE_INDEX */
 } coap_observer_t;
 
 list_t coap_get_observers(void);
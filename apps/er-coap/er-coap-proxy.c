@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2016, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP forward proxy with a response cache
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "contiki.h"
+#include "contiki-net.h"
+#include "lib/memb.h"
+#include "lib/list.h"
+#include "er-coap.h"
+#include "er-coap-transactions.h"
+#include "er-coap-separate.h"
+#include "er-coap-proxy.h"
+
+/* Compile this code only if the proxy is required */
+#if COAP_PROXY
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Path and query of a proxied URI, as two strings */
+#define URI_LEN 48
+
+struct proxy_entry {
+  struct proxy_entry *next;     /* for LIST, most recently used first */
+
+  /* the resource */
+  uip_ipaddr_t addr;
+  uint16_t port;
+  char uri[URI_LEN];
+  uint8_t uri_len;
+
+  /* the response, fresh until Max-Age expires */
+  uint8_t cached;
+  struct timer max_age;
+  uint8_t code;
+  uint16_t content_format;
+  uint8_t etag_len;
+  uint8_t etag[COAP_ETAG_LEN];
+  uint16_t payload_len;
+  uint8_t payload[REST_MAX_CHUNK_SIZE];
+
+  /* a request is forwarded to the origin */
+  uint8_t forwarding;
+};
+
+struct proxy_waiter {
+  struct proxy_waiter *next;    /* for LIST */
+  struct proxy_entry *entry;
+  coap_separate_t request;
+};
+
+MEMB(entries_memb, struct proxy_entry, COAP_PROXY_CACHE_SIZE);
+LIST(entries_list);
+MEMB(waiters_memb, struct proxy_waiter, COAP_PROXY_MAX_WAITERS);
+LIST(waiters_list);
+
+/*---------------------------------------------------------------------------*/
+/* Parse coap://[address]:port/path?query into the key of an entry */
+static int
+parse_proxy_uri(coap_packet_t *request, struct proxy_entry *key)
+{
+  char uri[URI_LEN + 48];
+  char *p, *query;
+  unsigned long port;
+
+  if(request->proxy_uri_len >= sizeof(uri)) {
+    return 0;
+  }
+  memcpy(uri, request->proxy_uri, request->proxy_uri_len);
+  uri[request->proxy_uri_len] = '\0';
+
+  if(strncmp(uri, "coap://[", 8) != 0
+     || !uiplib_ip6addrconv(uri + 7, &key->addr)) {
+    return 0;
+  }
+  p = strchr(uri, ']') + 1;
+
+  port = COAP_DEFAULT_PORT;
+  if(*p == ':') {
+    port = strtoul(p + 1, &p, 10);
+  }
+  key->port = UIP_HTONS(port);
+
+  while(*p == '/') {
+    p++;
+  }
+  query = strchr(p, '?');
+  if(query != NULL) {
+    *query++ = '\0';
+  } else {
+    query = "";
+  }
+
+  if(strlen(p) + strlen(query) + 2 > URI_LEN) {
+    return 0;
+  }
+  strcpy(key->uri, p);
+  strcpy(key->uri + strlen(p) + 1, query);
+  key->uri_len = strlen(p) + strlen(query) + 2;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static struct proxy_entry *
+get_entry(struct proxy_entry *key)
+{
+  struct proxy_entry *e, *idle;
+
+  idle = NULL;
+  for(e = list_head(entries_list); e != NULL; e = e->next) {
+    if(e->port == key->port && e->uri_len == key->uri_len
+       && uip_ipaddr_cmp(&e->addr, &key->addr)
+       && memcmp(e->uri, key->uri, key->uri_len) == 0) {
+      list_remove(entries_list, e);
+      list_push(entries_list, e);
+      return e;
+    }
+    if(!e->forwarding) {
+      idle = e;
+    }
+  }
+
+  /* a new entry, or the least recently used one that is not forwarding */
+  e = memb_alloc(&entries_memb);
+  if(e == NULL) {
+    if(idle == NULL) {
+      return NULL;
+    }
+    list_remove(entries_list, idle);
+    e = idle;
+  }
+  uip_ipaddr_copy(&e->addr, &key->addr);
+  e->port = key->port;
+  memcpy(e->uri, key->uri, key->uri_len);
+  e->uri_len = key->uri_len;
+  e->cached = 0;
+  e->forwarding = 0;
+  list_push(entries_list, e);
+  return e;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_fresh(struct proxy_entry *e)
+{
+  return e->cached && !timer_expired(&e->max_age);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill_response(struct proxy_entry *e, coap_packet_t *response,
+              uint8_t *buffer)
+{
+  response->code = e->code;
+  if(e->code == CONTENT_2_05) {
+    coap_set_header_content_format(response, e->content_format);
+  }
+  coap_set_header_max_age(response, timer_remaining(&e->max_age) /
+                          CLOCK_SECOND);
+  if(e->etag_len) {
+    coap_set_header_etag(response, e->etag, e->etag_len);
+  }
+  if(e->payload_len) {
+    memcpy(buffer, e->payload, e->payload_len);
+    coap_set_payload(response, buffer, e->payload_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+answer_waiters(struct proxy_entry *e, uint8_t code)
+{
+  struct proxy_waiter *w, *next;
+  coap_transaction_t *t;
+  coap_packet_t response[1];
+
+  for(w = list_head(waiters_list); w != NULL; w = next) {
+    next = w->next;
+    if(w->entry != e) {
+      continue;
+    }
+    t = coap_new_transaction(w->request.mid, &w->request.addr,
+                             w->request.port);
+    if(t != NULL) {
+      coap_separate_resume(response, &w->request, code);
+      if(code == CONTENT_2_05 || code == VALID_2_03) {
+        fill_response(e, response,
+                      COAP_TRANSACTION_PACKET(t) + COAP_MAX_HEADER_SIZE);
+      }
+      t->packet_len = coap_serialize_message(response,
+                                             COAP_TRANSACTION_PACKET(t));
+      coap_send_transaction(t);
+    }
+    list_remove(waiters_list, w);
+    memb_free(&waiters_memb, w);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_origin_response(void *data, void *response)
+{
+  struct proxy_entry *e = (struct proxy_entry *)data;
+  coap_packet_t *res = (coap_packet_t *)response;
+  const uint8_t *etag;
+  const uint8_t *payload;
+  uint32_t max_age;
+  int len;
+
+  e->forwarding = 0;
+
+  if(res == NULL) {
+    PRINTF("Proxy: no response from the origin\n");
+    answer_waiters(e, GATEWAY_TIMEOUT_5_04);
+    return;
+  }
+
+  coap_get_header_max_age(res, &max_age);
+  if(res->code == VALID_2_03 && e->cached) {
+    /* the stale entry is still valid */
+    PRINTF("Proxy: revalidated /%s\n", e->uri);
+    timer_set(&e->max_age, max_age * CLOCK_SECOND);
+  } else if(res->code == CONTENT_2_05
+            && !IS_OPTION(res, COAP_OPTION_BLOCK2)
+            && (len = coap_get_payload(res, &payload)) <= REST_MAX_CHUNK_SIZE) {
+    e->cached = 1;
+    timer_set(&e->max_age, max_age * CLOCK_SECOND);
+    e->code = CONTENT_2_05;
+    e->content_format = res->content_format;
+    e->etag_len = coap_get_header_etag(res, &etag);
+    memcpy(e->etag, etag, e->etag_len);
+    e->payload_len = len;
+    memcpy(e->payload, payload, len);
+  } else {
+    /* only successful responses are cached */
+    PRINTF("Proxy: origin answered %u\n", res->code);
+    e->cached = 0;
+    answer_waiters(e, res->code ? res->code : BAD_GATEWAY_5_02);
+    return;
+  }
+
+  answer_waiters(e, CONTENT_2_05);
+}
+/*---------------------------------------------------------------------------*/
+static int
+forward_request(struct proxy_entry *e)
+{
+  coap_packet_t request[1];
+  coap_transaction_t *t;
+  const char *query;
+
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, coap_get_mid());
+  coap_set_header_uri_path(request, e->uri);
+  query = e->uri + strlen(e->uri) + 1;
+  if(*query) {
+    coap_set_header_uri_query(request, query);
+  }
+  if(e->cached && e->etag_len) {
+    /* ask the origin to validate the stale entry */
+    coap_set_header_etag(request, e->etag, e->etag_len);
+  }
+
+  t = coap_new_transaction(request->mid, &e->addr, e->port);
+  if(t == NULL) {
+    return 0;
+  }
+  t->callback = handle_origin_response;
+  t->callback_data = e;
+  t->packet_len = coap_serialize_message(request, COAP_TRANSACTION_PACKET(t));
+
+  PRINTF("Proxy: forwarding /%s\n", e->uri);
+  e->forwarding = 1;
+  coap_send_transaction(t);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_proxy_handler(void *request, void *response, uint8_t *buffer,
+                   uint16_t preferred_size, int32_t *offset)
+{
+  coap_packet_t *const coap_req = (coap_packet_t *)request;
+  struct proxy_entry key;
+  struct proxy_entry *e;
+  struct proxy_waiter *w;
+  const uint8_t *etag;
+  int etag_len;
+
+  if(coap_req->code != COAP_GET) {
+    erbium_status_code = PROXYING_NOT_SUPPORTED_5_05;
+    coap_error_message = "OnlyGET";
+    return 1;
+  }
+  if(!parse_proxy_uri(coap_req, &key)) {
+    erbium_status_code = PROXYING_NOT_SUPPORTED_5_05;
+    coap_error_message = "BadProxyUri";
+    return 1;
+  }
+
+  e = get_entry(&key);
+  if(e == NULL) {
+    erbium_status_code = SERVICE_UNAVAILABLE_5_03;
+    coap_error_message = "ProxyBusy";
+    return 1;
+  }
+
+  if(is_fresh(e)) {
+    PRINTF("Proxy: /%s from the cache\n", e->uri);
+    etag_len = coap_get_header_etag(coap_req, &etag);
+    if(etag_len && etag_len == e->etag_len
+       && memcmp(etag, e->etag, etag_len) == 0) {
+      /* the client has the representation */
+      coap_set_header_etag(response, e->etag, e->etag_len);
+      coap_set_header_max_age(response, timer_remaining(&e->max_age) /
+                              CLOCK_SECOND);
+      ((coap_packet_t *)response)->code = VALID_2_03;
+    } else {
+      fill_response(e, response, buffer);
+    }
+    return 1;
+  }
+
+  /* wait for the response of the origin, with the identical requests */
+  w = memb_alloc(&waiters_memb);
+  if(w == NULL) {
+    coap_separate_reject();
+    return 1;
+  }
+  if(!e->forwarding && !forward_request(e)) {
+    memb_free(&waiters_memb, w);
+    coap_separate_reject();
+    return 1;
+  }
+  w->entry = e;
+  coap_separate_accept(request, &w->request);
+  list_add(waiters_list, w);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* COAP_PROXY */
@@ -38,6 +38,7 @@
 
 #include "contiki.h"
 #include "contiki-net.h"
+#include <stddef.h>
 #include "er-coap-transactions.h"
 #include "er-coap-observe.h"
 
@@ -59,6 +60,35 @@ LIST(transactions_list);
 
 static struct process *transaction_handler_process = NULL;
 
+#if COAP_TRANSACTIONS_PKTMEM
+PKTMEM_USER(coap_transactions, COAP_TRANSACTIONS_PKTMEM_RESERVE,
+            COAP_TRANSACTIONS_PKTMEM_BUDGET);
+#endif /* COAP_TRANSACTIONS_PKTMEM */
+
+#if COAP_TRANSACTIONS_HASH
+/* The open transactions, chained on hash_next in the bucket of their MID */
+static coap_transaction_t *mid_buckets[COAP_TRANSACTIONS_HASH];
+
+/* MIDs are given out in sequence, so their low bits spread them well */
+#define MID_BUCKET(mid) (&mid_buckets[(mid) & (COAP_TRANSACTIONS_HASH - 1)])
+#endif /* COAP_TRANSACTIONS_HASH */
+
+#define IS_CON(t) (COAP_TYPE_CON == \
+                   ((COAP_HEADER_TYPE_MASK & COAP_TRANSACTION_MESSAGE(t)[0]) >> \
+                    COAP_HEADER_TYPE_POSITION))
+
+#if COAP_SERIALIZE_IN_PLACE
+#define PACKET_END(t) ((t)->packet_offset + (t)->packet_len)
+#else /* COAP_SERIALIZE_IN_PLACE */
+#define PACKET_END(t) ((t)->packet_len)
+#endif /* COAP_SERIALIZE_IN_PLACE */
+
+#if COAP_COCOA
+#define IS_WAITING(t) ((t)->waiting)
+#else /* COAP_COCOA */
+#define IS_WAITING(t) 0
+#endif /* COAP_COCOA */
+
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -66,6 +96,9 @@ void
 coap_register_as_transaction_handler()
 {
   transaction_handler_process = PROCESS_CURRENT();
+#if COAP_TRANSACTIONS_PKTMEM
+  pktmem_register(&coap_transactions);
+#endif /* COAP_TRANSACTIONS_PKTMEM */
 }
 coap_transaction_t *
 coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
@@ -73,14 +106,33 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
   coap_transaction_t *t = memb_alloc(&transactions_memb);
 
   if(t) {
+#if COAP_TRANSACTIONS_PKTMEM
+    if(!pktmem_alloc(&coap_transactions, &t->packet,
+                     COAP_MAX_PACKET_SIZE + 1)) {
+      PRINTF("No packet memory for transaction %u\n", mid);
+      memb_free(&transactions_memb, t);
+      return NULL;
+    }
+#endif /* COAP_TRANSACTIONS_PKTMEM */
     t->mid = mid;
     t->retrans_counter = 0;
+#if COAP_SERIALIZE_IN_PLACE
+    t->packet_offset = 0;
+#endif /* COAP_SERIALIZE_IN_PLACE */
+#if COAP_COCOA
+    t->peer = NULL;
+    t->waiting = 0;
+#endif /* COAP_COCOA */
 
     /* save client address */
     uip_ipaddr_copy(&t->addr, addr);
     t->port = port;
 
     list_add(transactions_list, t); /* list itself makes sure same element is not added twice */
+#if COAP_TRANSACTIONS_HASH
+    t->hash_next = *MID_BUCKET(mid);
+    *MID_BUCKET(mid) = t;
+#endif /* COAP_TRANSACTIONS_HASH */
   }
 
   return t;
@@ -91,15 +143,45 @@ coap_send_transaction(coap_transaction_t *t)
 {
   PRINTF("Sending transaction %u\n", t->mid);
 
-  coap_send_message(&t->addr, t->port, t->packet, t->packet_len);
+#if COAP_COCOA
+  if(t->retrans_counter == 0 && t->peer == NULL && IS_CON(t)) {
+    t->peer = coap_cocoa_get_peer(&t->addr);
+    if(t->peer != NULL) {
+      if(t->peer->outstanding >= COAP_NSTART) {
+        /* sent when an exchange with the peer ends */
+        PRINTF("NSTART reached, transaction %u waits\n", t->mid);
+        t->peer = NULL;
+        t->waiting = 1;
+#if COAP_TRANSACTIONS_PKTMEM
+        pktmem_shrink(&coap_transactions, &t->packet, PACKET_END(t));
+#endif /* COAP_TRANSACTIONS_PKTMEM */
+        return;
+      }
+      t->peer->outstanding++;
+    }
+    t->start = clock_time();
+  }
+#endif /* COAP_COCOA */
+
+  coap_send_message(&t->addr, t->port, COAP_TRANSACTION_MESSAGE(t),
+                    t->packet_len);
 
-  if(COAP_TYPE_CON ==
-     ((COAP_HEADER_TYPE_MASK & t->packet[0]) >> COAP_HEADER_TYPE_POSITION)) {
+  if(IS_CON(t)) {
     if(t->retrans_counter < COAP_MAX_RETRANSMIT) {
       /* not timed out yet */
       PRINTF("Keeping transaction %u\n", t->mid);
 
       if(t->retrans_counter == 0) {
+#if COAP_TRANSACTIONS_PKTMEM
+        /* only the message is kept for retransmission */
+        pktmem_shrink(&coap_transactions, &t->packet, PACKET_END(t));
+#endif /* COAP_TRANSACTIONS_PKTMEM */
+#if COAP_COCOA
+        if(t->peer != NULL) {
+          t->retrans_timer.timer.interval =
+            coap_cocoa_initial_timeout(t->peer);
+        } else
+#endif /* COAP_COCOA */
         t->retrans_timer.timer.interval =
           COAP_RESPONSE_TIMEOUT_TICKS + (random_rand()
                                          %
@@ -108,7 +190,12 @@ coap_send_transaction(coap_transaction_t *t)
         PRINTF("Initial interval %f\n",
                (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
       } else {
+#if COAP_COCOA
+        t->retrans_timer.timer.interval =
+          coap_cocoa_backoff(t->peer, t->retrans_timer.timer.interval);
+#else /* COAP_COCOA */
         t->retrans_timer.timer.interval <<= 1;  /* double */
+#endif /* COAP_COCOA */
         PRINTF("Doubled (%u) interval %f\n", t->retrans_counter,
                (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
       }
@@ -141,12 +228,50 @@ coap_send_transaction(coap_transaction_t *t)
 void
 coap_clear_transaction(coap_transaction_t *t)
 {
+#if COAP_TRANSACTIONS_HASH
+  coap_transaction_t **p;
+#endif /* COAP_TRANSACTIONS_HASH */
+#if COAP_COCOA
+  coap_peer_t *peer;
+#endif /* COAP_COCOA */
+
   if(t) {
     PRINTF("Freeing transaction %u: %p\n", t->mid, t);
 
+#if COAP_TRANSACTIONS_HASH
+    for(p = MID_BUCKET(t->mid); *p != NULL; p = &(*p)->hash_next) {
+      if(*p == t) {
+        *p = t->hash_next;
+        break;
+      }
+    }
+#endif /* COAP_TRANSACTIONS_HASH */
+#if COAP_TRANSACTIONS_PKTMEM
+    pktmem_free(&coap_transactions, &t->packet);
+#endif /* COAP_TRANSACTIONS_PKTMEM */
+
+#if COAP_COCOA
+    peer = t->peer;
+#endif /* COAP_COCOA */
+
     etimer_stop(&t->retrans_timer);
     list_remove(transactions_list, t);
     memb_free(&transactions_memb, t);
+
+#if COAP_COCOA
+    if(peer != NULL) {
+      /* the exchange has ended, start the next one to the peer */
+      peer->outstanding--;
+      for(t = (coap_transaction_t *)list_head(transactions_list); t;
+          t = t->next) {
+        if(t->waiting && uip_ipaddr_cmp(&t->addr, &peer->addr)) {
+          t->waiting = 0;
+          coap_send_transaction(t);
+          break;
+        }
+      }
+    }
+#endif /* COAP_COCOA */
   }
 }
 coap_transaction_t *
@@ -154,7 +279,11 @@ coap_get_transaction_by_mid(uint16_t mid)
 {
   coap_transaction_t *t = NULL;
 
+#if COAP_TRANSACTIONS_HASH
+  for(t = *MID_BUCKET(mid); t; t = t->hash_next) {
+#else /* COAP_TRANSACTIONS_HASH */
   for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
+#endif /* COAP_TRANSACTIONS_HASH */
     if(t->mid == mid) {
       PRINTF("Found transaction for MID %u: %p\n", t->mid, t);
       return t;
@@ -169,7 +298,7 @@ coap_check_transactions()
   coap_transaction_t *t = NULL;
 
   for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
-    if(etimer_expired(&t->retrans_timer)) {
+    if(!IS_WAITING(t) && etimer_expired(&t->retrans_timer)) {
       ++(t->retrans_counter);
       PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
       coap_send_transaction(t);
@@ -177,3 +306,44 @@ coap_check_transactions()
   }
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * The data of a PROCESS_EVENT_TIMER is the etimer that expired, which
+ * leads straight to its transaction instead of checking them all.
+ * Returns zero if the timer is not the one of a transaction.
+ */
+int
+coap_check_transaction_timer(void *data)
+{
+  coap_transaction_t *t;
+
+  t = (coap_transaction_t *)((char *)data -
+                             offsetof(coap_transaction_t, retrans_timer));
+  if(!memb_inmemb(&transactions_memb, t)) {
+    return 0;
+  }
+
+  /* the transaction may have been cleared since the timer expired */
+  if(coap_get_transaction_by_mid(t->mid) == t && !IS_WAITING(t)
+     && etimer_expired(&t->retrans_timer)) {
+    ++(t->retrans_counter);
+    PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
+    coap_send_transaction(t);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_COCOA
+/*
+ * Called on the response to a transaction, before it is cleared, to
+ * sample the round-trip time to its destination.
+ */
+void
+coap_transaction_answered(coap_transaction_t *t)
+{
+  if(t->peer != NULL) {
+    coap_cocoa_rtt_sample(t->peer, clock_time() - t->start,
+                          t->retrans_counter);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* COAP_COCOA */
@@ -40,6 +40,12 @@
 #define COAP_TRANSACTIONS_H_
 
 #include "er-coap.h"
+#if COAP_TRANSACTIONS_PKTMEM
+#include "lib/pktmem.h"
+#endif /* COAP_TRANSACTIONS_PKTMEM */
+#if COAP_COCOA
+#include "er-coap-cocoa.h"
+#endif /* COAP_COCOA */
 
 /*
  * Modulo mask (thus +1) for a random number to get the tick number for the random
@@ -51,10 +57,18 @@
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
   struct coap_transaction *next;        /* for LIST */
+#if COAP_TRANSACTIONS_HASH
+  struct coap_transaction *hash_next;   /* for the MID index */
+#endif /* COAP_TRANSACTIONS_HASH */
 
   uint16_t mid;
   struct etimer retrans_timer;
   uint8_t retrans_counter;
+#if COAP_COCOA
+  coap_peer_t *peer;                    /* set while the exchange is outstanding */
+  clock_time_t start;                   /* first transmission, for the RTT */
+  uint8_t waiting;                      /* for an exchange with the peer to end */
+#endif /* COAP_COCOA */
 
   uip_ipaddr_t addr;
   uint16_t port;
@@ -63,10 +77,39 @@ typedef struct coap_transaction {
   void *callback_data;
 
   uint16_t packet_len;
+#if COAP_SERIALIZE_IN_PLACE
+  uint16_t packet_offset;               /* start of the message in the buffer */
+#endif /* COAP_SERIALIZE_IN_PLACE */
+#if COAP_TRANSACTIONS_PKTMEM
+  struct mmem packet;                           /* COAP_MAX_PACKET_SIZE + 1 while the message is built,
+                                                 * packet_len once a confirmable one is sent */
+#else /* COAP_TRANSACTIONS_PKTMEM */
   uint8_t packet[COAP_MAX_PACKET_SIZE + 1];     /* +1 for the terminating '\0' which will not be sent
                                                  * Use snprintf(buf, len+1, "", ...) to completely fill payload */
+#endif /* COAP_TRANSACTIONS_PKTMEM */
 } coap_transaction_t;
 
+/*
+ * The message buffer of a transaction. With COAP_TRANSACTIONS_PKTMEM, the
+ * buffer moves when the packet memory is compacted, so the pointer is only
+ * valid until a block allocated before it is freed; building and sending a
+ * message in one go, as the engine does, is safe.
+ */
+#if COAP_TRANSACTIONS_PKTMEM
+#define COAP_TRANSACTION_PACKET(t) ((uint8_t *)MMEM_PTR(&(t)->packet))
+#else /* COAP_TRANSACTIONS_PKTMEM */
+#define COAP_TRANSACTION_PACKET(t) ((t)->packet)
+#endif /* COAP_TRANSACTIONS_PKTMEM */
+
+/* The message of a transaction, which starts packet_offset bytes into the
+ * buffer when it was serialized in place */
+#if COAP_SERIALIZE_IN_PLACE
+#define COAP_TRANSACTION_MESSAGE(t) \
+  (COAP_TRANSACTION_PACKET(t) + (t)->packet_offset)
+#else /* COAP_SERIALIZE_IN_PLACE */
+#define COAP_TRANSACTION_MESSAGE(t) COAP_TRANSACTION_PACKET(t)
+#endif /* COAP_SERIALIZE_IN_PLACE */
+
 void coap_register_as_transaction_handler(void);
 
 coap_transaction_t *coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr,
@@ -76,5 +119,9 @@ void coap_clear_transaction(coap_transaction_t *t);
 coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
 
 void coap_check_transactions(void);
+int coap_check_transaction_timer(void *data);
+#if COAP_COCOA
+void coap_transaction_answered(coap_transaction_t *t);
+#endif /* COAP_COCOA */
 
 #endif /* COAP_TRANSACTIONS_H_ */
@@ -307,10 +307,14 @@ coap_init_message(void *packet, coap_message_type_t type, uint8_t code,
   coap_pkt->mid = mid;
 }
 /*---------------------------------------------------------------------------*/
-size_t
-coap_serialize_message(void *packet, uint8_t *buffer)
+/*
+ * Serialize the header, token and options of a message, and the payload
+ * marker. Returns the end of the header, or NULL if it exceeds
+ * COAP_MAX_HEADER_SIZE.
+ */
+static uint8_t *
+serialize_header(coap_packet_t *coap_pkt, uint8_t *buffer)
 {
-  coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
   uint8_t *option;
   unsigned int current_number = 0;
 
@@ -334,8 +338,7 @@ coap_serialize_message(void *packet, uint8_t *buffer)
 
   /* empty packet, dont need to do more stuff */
   if(!coap_pkt->code) {
-    PRINTF("-Done serializing empty message at %p-\n", coap_pkt->buffer);
-    return 4;
+    return coap_pkt->buffer + COAP_HEADER_LEN;
   }
 
   /* set Token */
@@ -390,21 +393,41 @@ coap_serialize_message(void *packet, uint8_t *buffer)
 
   PRINTF("-Done serializing at %p----\n", option);
 
-  /* Pack payload */
-  if((option - coap_pkt->buffer) <= COAP_MAX_HEADER_SIZE) {
-    /* Payload marker */
-    if(coap_pkt->payload_len) {
-      *option = 0xFF;
-      ++option;
-    }
-    memmove(option, coap_pkt->payload, coap_pkt->payload_len);
-  } else {
+  if((option - coap_pkt->buffer) > COAP_MAX_HEADER_SIZE) {
     /* an error occurred: caller must check for !=0 */
     coap_pkt->buffer = NULL;
     coap_error_message = "Serialized header exceeds COAP_MAX_HEADER_SIZE";
+    return NULL;
+  }
+
+  /* Payload marker */
+  if(coap_pkt->payload_len) {
+    *option = 0xFF;
+    ++option;
+  }
+  return option;
+}
+/*---------------------------------------------------------------------------*/
+size_t
+coap_serialize_message(void *packet, uint8_t *buffer)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+  uint8_t *option;
+
+  option = serialize_header(coap_pkt, buffer);
+
+  /* empty packet, dont need to do more stuff */
+  if(!coap_pkt->code) {
+    PRINTF("-Done serializing empty message at %p-\n", coap_pkt->buffer);
+    return 4;
+  }
+  if(option == NULL) {
     return 0;
   }
 
+  /* Pack payload */
+  memmove(option, coap_pkt->payload, coap_pkt->payload_len);
+
   PRINTF("-Done %u B (header len %u, payload len %u)-\n",
          (unsigned int)(coap_pkt->payload_len + option - buffer),
          (unsigned int)(option - buffer),
@@ -422,15 +445,62 @@ coap_serialize_message(void *packet, uint8_t *buffer)
   return (option - buffer) + coap_pkt->payload_len; /* packet length */
 }
 /*---------------------------------------------------------------------------*/
+#if COAP_SERIALIZE_IN_PLACE
+size_t
+coap_serialize_message_in_place(void *packet, uint8_t *buffer,
+                                uint16_t *offset)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+  uint8_t *option;
+  uint16_t header_len;
+
+  *offset = 0;
+  if(!coap_pkt->code || coap_pkt->payload_len == 0
+     || coap_pkt->payload != buffer + COAP_MAX_HEADER_SIZE) {
+    return coap_serialize_message(packet, buffer);
+  }
+
+  option = serialize_header(coap_pkt, buffer);
+  if(option == NULL) {
+    return 0;
+  }
+
+  header_len = option - buffer;
+  if(header_len > COAP_MAX_HEADER_SIZE) {
+    /* no room for the payload marker */
+    return coap_serialize_message(packet, buffer);
+  }
+
+  /* move the few bytes of the header up to the payload */
+  *offset = COAP_MAX_HEADER_SIZE - header_len;
+  memmove(buffer + *offset, buffer, header_len);
+  coap_pkt->buffer = buffer + *offset;
+
+  PRINTF("-Done in place at +%u (header len %u, payload len %u)-\n",
+         *offset, header_len, (unsigned int)coap_pkt->payload_len);
+
+  return header_len + coap_pkt->payload_len;
+}
+#endif /* COAP_SERIALIZE_IN_PLACE */
+/*---------------------------------------------------------------------------*/
 void
 coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
                   uint16_t length)
 {
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+  int subsystem;
+
+  subsystem = energest_subsystem_set(ENERGEST_SUBSYSTEM_COAP);
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
+
   /* configure connection to reply to client */
   uip_ipaddr_copy(&udp_conn->ripaddr, addr);
   udp_conn->rport = port;
 
   uip_udp_packet_send(udp_conn, data, length);
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+  energest_subsystem_set(subsystem);
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
 
   PRINTF("-sent UDP datagram (%u)-\n", length);
 
@@ -578,14 +648,19 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
       break;
 
     case COAP_OPTION_PROXY_URI:
-#if COAP_PROXY_OPTION_PROCESSING
+#if COAP_PROXY_OPTION_PROCESSING || COAP_PROXY
       coap_pkt->proxy_uri = (char *)current_option;
       coap_pkt->proxy_uri_len = option_length;
 #endif
+#if COAP_PROXY
+      PRINTF("Proxy-Uri [%.*s]\n", (int)coap_pkt->proxy_uri_len,
+             coap_pkt->proxy_uri);
+#else /* COAP_PROXY */
       PRINTF("Proxy-Uri NOT IMPLEMENTED [%.*s]\n", (int)coap_pkt->proxy_uri_len,
              coap_pkt->proxy_uri);
       coap_error_message = "This is a constrained server (Contiki)";
       return PROXYING_NOT_SUPPORTED_5_05;
+#endif /* COAP_PROXY */
       break;
     case COAP_OPTION_PROXY_SCHEME:
 #if COAP_PROXY_OPTION_PROCESSING
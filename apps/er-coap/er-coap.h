@@ -182,6 +182,15 @@ uint16_t coap_get_mid(void);
 void coap_init_message(void *packet, coap_message_type_t type, uint8_t code,
                        uint16_t mid);
 size_t coap_serialize_message(void *packet, uint8_t *buffer);
+#if COAP_SERIALIZE_IN_PLACE
+/* Serialize a message whose payload was written to buffer at
+ * COAP_MAX_HEADER_SIZE, the usual place for resource handlers, without
+ * moving the payload: the header is written just before it, and the
+ * message starts at buffer + *offset. Other messages are serialized
+ * at buffer, with an offset of 0. */
+size_t coap_serialize_message_in_place(void *packet, uint8_t *buffer,
+                                       uint16_t *offset);
+#endif /* COAP_SERIALIZE_IN_PLACE */
 void coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
                        uint16_t length);
 coap_status_t coap_parse_message(void *request, uint8_t *data,
@@ -44,6 +44,10 @@
 
 #include "contiki-net.h"
 #include "httpd-ws.h"
+#if HTTPD_WS_WEBSOCKET
+#include "lib/memb.h"
+#include "sha1.h"
+#endif /* HTTPD_WS_WEBSOCKET */
 
 #define DEBUG 0
 #if DEBUG
@@ -89,6 +93,28 @@ static const char http_header_200[] =
   "HTTP/1.0 200 OK\r\nServer: Contiki\r\nConnection: close\r\n";
 static const char html_not_found[] =
   "<html><body><h1>Page not found</h1></body></html>";
+#if HTTPD_WS_WEBSOCKET
+static const char http_header_101[] =
+  "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+  "Connection: Upgrade\r\n";
+static const char http_websocket_key[] = "Sec-WebSocket-Key:";
+static const char http_websocket_accept[] = "Sec-WebSocket-Accept:";
+static const char websocket_guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+static const char base64[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+#define WEBSOCKET_FIN_TEXT     0x81
+#define WEBSOCKET_OPCODE_CLOSE 0x08
+
+/* A published message, shared by all sessions that have it queued. */
+struct httpd_ws_message {
+  uint8_t refs;
+  uint16_t len;
+  char data[HTTPD_WS_WEBSOCKET_MSGLEN];
+};
+
+MEMB(messages, struct httpd_ws_message, HTTPD_WS_WEBSOCKET_MESSAGES);
+#endif /* HTTPD_WS_WEBSOCKET */
 /*---------------------------------------------------------------------------*/
 /* just set all states to unused */
 static void
@@ -143,11 +169,257 @@ PT_THREAD(send_headers(struct httpd_ws_state *s, const char *statushdr))
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+#if HTTPD_WS_WEBSOCKET
+/* Puts the Sec-WebSocket-Accept header for the key, and the end of
+   the header, in the output buffer. */
+static void
+websocket_accept(struct httpd_ws_state *s, const char *key)
+{
+  struct sha1_ctx ctx;
+  uint8_t digest[SHA1_DIGEST_LEN];
+  uint32_t v;
+  uint8_t i;
+  char *out;
+
+  while(*key == ISO_space) {
+    key++;
+  }
+  sha1_init(&ctx);
+  sha1_update(&ctx, key, strlen(key));
+  sha1_update(&ctx, websocket_guid, sizeof(websocket_guid) - 1);
+  sha1_final(&ctx, digest);
+
+  s->outbuf_pos = snprintf(s->outbuf, sizeof(s->outbuf), "%s ",
+                           http_websocket_accept);
+  out = &s->outbuf[s->outbuf_pos];
+  for(i = 0; i < SHA1_DIGEST_LEN; i += 3) {
+    v = (uint32_t)digest[i] << 16;
+    if(i + 1 < SHA1_DIGEST_LEN) {
+      v |= (uint32_t)digest[i + 1] << 8;
+    }
+    if(i + 2 < SHA1_DIGEST_LEN) {
+      v |= digest[i + 2];
+    }
+    *out++ = base64[(v >> 18) & 63];
+    *out++ = base64[(v >> 12) & 63];
+    *out++ = i + 1 < SHA1_DIGEST_LEN ? base64[(v >> 6) & 63] : '=';
+    *out++ = i + 2 < SHA1_DIGEST_LEN ? base64[v & 63] : '=';
+  }
+  memcpy(out, "\r\n\r\n", 4);
+  s->outbuf_pos = out + 4 - s->outbuf;
+}
+/*---------------------------------------------------------------------------*/
+static void
+websocket_open(struct httpd_ws_state *s)
+{
+  s->state = HTTPD_WS_STATE_WEBSOCKET;
+  s->conn = uip_conn;
+  s->queue_first = 0;
+  s->queue_len = 0;
+  s->inflight = 0;
+  s->skip = 0;
+  PRINTF("HTTPD-WS: WebSocket session on %s\n", s->filename);
+}
+/*---------------------------------------------------------------------------*/
+static void
+websocket_dequeue(struct httpd_ws_state *s, uint8_t n)
+{
+  struct httpd_ws_message *m;
+
+  while(n-- > 0 && s->queue_len > 0) {
+    m = s->queue[s->queue_first];
+    if(--m->refs == 0) {
+      memb_free(&messages, m);
+    }
+    s->queue_first = (s->queue_first + 1) % HTTPD_WS_WEBSOCKET_QUEUE;
+    s->queue_len--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Frames up to max queued messages into one segment. The frame
+   headers and payloads are written straight into uip_appdata. */
+static void
+websocket_send(struct httpd_ws_state *s, uint8_t max)
+{
+  struct httpd_ws_message *m;
+  uint8_t *ptr;
+  uint16_t len;
+  uint8_t hdrlen;
+  uint8_t i;
+
+  while(s->queue_len > 0) {
+    ptr = uip_appdata;
+    len = 0;
+    for(i = 0; i < s->queue_len && i < max; i++) {
+      m = s->queue[(s->queue_first + i) % HTTPD_WS_WEBSOCKET_QUEUE];
+      hdrlen = m->len < 126 ? 2 : 4;
+      if(len + hdrlen + m->len > uip_mss()) {
+        break;
+      }
+      ptr[0] = WEBSOCKET_FIN_TEXT;
+      if(hdrlen == 2) {
+        ptr[1] = m->len;
+      } else {
+        ptr[1] = 126;
+        ptr[2] = m->len >> 8;
+        ptr[3] = m->len & 0xff;
+      }
+      memcpy(ptr + hdrlen, m->data, m->len);
+      ptr += hdrlen + m->len;
+      len += hdrlen + m->len;
+    }
+    if(i > 0) {
+      s->inflight = i;
+      uip_send(uip_appdata, len);
+      return;
+    }
+    /* The peer's MSS is too small for this message. */
+    websocket_dequeue(s, 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Handles the frames from the client. Their payload is not used;
+   returns 0 if the client closed the session. */
+static int
+websocket_input(struct httpd_ws_state *s)
+{
+  uint8_t *ptr;
+  uint16_t left, len, hdrlen;
+
+  ptr = uip_appdata;
+  left = uip_datalen();
+  while(left > 0) {
+    if(s->skip > 0) {
+      len = s->skip < left ? s->skip : left;
+      s->skip -= len;
+      ptr += len;
+      left -= len;
+      continue;
+    }
+    if(left < 2) {
+      break;
+    }
+    if((ptr[0] & 0x0f) == WEBSOCKET_OPCODE_CLOSE) {
+      uip_close();
+      return 0;
+    }
+    len = ptr[1] & 0x7f;
+    hdrlen = (ptr[1] & 0x80) ? 6 : 2;
+    if(len == 126) {
+      if(left < 4) {
+        break;
+      }
+      len = (uint16_t)ptr[2] << 8 | ptr[3];
+      hdrlen += 2;
+    } else if(len == 127) {
+      /* No frames of 64 kbyte or more. */
+      uip_close();
+      return 0;
+    }
+    if(left < hdrlen) {
+      break;
+    }
+    ptr += hdrlen;
+    left -= hdrlen;
+    s->skip = len;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+websocket_appcall(struct httpd_ws_state *s)
+{
+  if(uip_acked()) {
+    websocket_dequeue(s, s->inflight);
+    s->inflight = 0;
+  }
+  if(uip_newdata() && !websocket_input(s)) {
+    return;
+  }
+  if(uip_rexmit()) {
+    websocket_send(s, s->inflight);
+  } else if(s->inflight == 0 &&
+            (uip_acked() || uip_newdata() || uip_poll())) {
+    websocket_send(s, HTTPD_WS_WEBSOCKET_QUEUE);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+httpd_ws_publish(const char *path, const char *data, uint16_t len)
+{
+  struct httpd_ws_message *m;
+  struct httpd_ws_state *s;
+  int i, n;
+
+  if(len > HTTPD_WS_WEBSOCKET_MSGLEN) {
+    return 0;
+  }
+
+  m = NULL;
+  n = 0;
+  for(i = 0; i < CONNS; i++) {
+    s = &conns[i];
+    if(s->state != HTTPD_WS_STATE_WEBSOCKET ||
+       strcmp(s->filename, path) != 0) {
+      continue;
+    }
+    if(s->queue_len == HTTPD_WS_WEBSOCKET_QUEUE) {
+      PRINTF("HTTPD-WS: queue full, dropping message for %s\n", path);
+      continue;
+    }
+    if(m == NULL) {
+      /* The message is only stored once. */
+      m = memb_alloc(&messages);
+      if(m == NULL) {
+        PRINTF("HTTPD-WS: no message buffer for %s\n", path);
+        return 0;
+      }
+      m->refs = 0;
+      m->len = len;
+      memcpy(m->data, data, len);
+    }
+    s->queue[(s->queue_first + s->queue_len) % HTTPD_WS_WEBSOCKET_QUEUE] = m;
+    s->queue_len++;
+    m->refs++;
+    n++;
+    tcpip_poll_tcp(s->conn);
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+int
+httpd_ws_subscribers(const char *path)
+{
+  int i, n;
+
+  n = 0;
+  for(i = 0; i < CONNS; i++) {
+    if(conns[i].state == HTTPD_WS_STATE_WEBSOCKET &&
+       strcmp(conns[i].filename, path) == 0) {
+      n++;
+    }
+  }
+  return n;
+}
+#endif /* HTTPD_WS_WEBSOCKET */
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_output(struct httpd_ws_state *s))
 {
   PT_BEGIN(&s->outputpt);
 
+#if HTTPD_WS_WEBSOCKET
+  if(s->request_type == HTTPD_WS_UPGRADE) {
+    PT_WAIT_THREAD(&s->outputpt,
+                   send_string(s, http_header_101,
+                               sizeof(http_header_101) - 1));
+    PT_WAIT_THREAD(&s->outputpt, send_string(s, s->outbuf, s->outbuf_pos));
+    s->outbuf_pos = 0;
+    websocket_open(s);
+    PT_EXIT(&s->outputpt);
+  }
+#endif /* HTTPD_WS_WEBSOCKET */
+
   s->content_type = http_content_type_html;
   s->script = httpd_ws_get_script(s);
   if(s->script == NULL) {
@@ -256,7 +528,15 @@ PT_THREAD(handle_input(struct httpd_ws_state *s))
 #endif /* URLCONV */
 
 /*   webserver_log_file(&uip_conn->ripaddr, s->filename); */
+#if HTTPD_WS_WEBSOCKET
+  /* A GET is answered once its header is read, as the header may ask
+     for an upgrade to WebSocket. */
+  if(s->request_type != HTTPD_WS_GET) {
+    s->state = HTTPD_WS_STATE_OUTPUT;
+  }
+#else /* HTTPD_WS_WEBSOCKET */
   s->state = HTTPD_WS_STATE_OUTPUT;
+#endif /* HTTPD_WS_WEBSOCKET */
 
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
@@ -271,11 +551,24 @@ PT_THREAD(handle_input(struct httpd_ws_state *s))
 
     if(PSOCK_DATALEN(&s->sin) > 2) {
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
+#if HTTPD_WS_WEBSOCKET
+      if(s->request_type == HTTPD_WS_GET &&
+         strncmp(s->inputbuf, http_websocket_key,
+                 sizeof(http_websocket_key) - 1) == 0) {
+        websocket_accept(s, &s->inputbuf[sizeof(http_websocket_key) - 1]);
+        s->request_type = HTTPD_WS_UPGRADE;
+      }
+#endif /* HTTPD_WS_WEBSOCKET */
     } else if(s->request_type == HTTPD_WS_POST) {
       PSOCK_READBUF_LEN(&s->sin, s->content_len);
       s->inputbuf[PSOCK_DATALEN(&s->sin)] = 0;
       /* printf("Content: '%s'\nSize:%d\n", s->inputbuf, PSOCK_DATALEN(&s->sin)); */
       s->state = HTTPD_WS_STATE_OUTPUT;
+#if HTTPD_WS_WEBSOCKET
+    } else if(s->state == HTTPD_WS_STATE_INPUT) {
+      /* End of the header of a GET or an upgrade request. */
+      s->state = HTTPD_WS_STATE_OUTPUT;
+#endif /* HTTPD_WS_WEBSOCKET */
     }
   }
   PSOCK_END(&s->sin);
@@ -301,6 +594,11 @@ httpd_ws_appcall(void *state)
   if(uip_closed() || uip_aborted() || uip_timedout()) {
     if(s != NULL) {
       PRINTF("HTTPD-WS: closed/aborted (%d)\n", http_connections);
+#if HTTPD_WS_WEBSOCKET
+      if(s->state == HTTPD_WS_STATE_WEBSOCKET) {
+        websocket_dequeue(s, s->queue_len);
+      }
+#endif /* HTTPD_WS_WEBSOCKET */
       http_connections--;
       httpd_state_free(s);
     } else {
@@ -330,6 +628,13 @@ httpd_ws_appcall(void *state)
     timer_set(&s->timer, CLOCK_SECOND * 30);
     handle_connection(s);
   } else if(s != NULL) {
+#if HTTPD_WS_WEBSOCKET
+    if(s->state == HTTPD_WS_STATE_WEBSOCKET) {
+      /* WebSocket sessions stay open until either side closes them. */
+      websocket_appcall(s);
+      return;
+    }
+#endif /* HTTPD_WS_WEBSOCKET */
     if(uip_poll()) {
       if(timer_expired(&s->timer)) {
         uip_abort();
@@ -460,6 +765,7 @@ PROCESS_THREAD(httpd_ws_process, ev, data)
       for(i = 0; i < CONNS; i++) {
         PRINTF("%d ", conns[i].state);
         if(conns[i].state != HTTPD_WS_STATE_UNUSED &&
+           conns[i].state != HTTPD_WS_STATE_WEBSOCKET &&
            timer_expired(&conns[i].timer)) {
           conns[i].state = HTTPD_WS_STATE_UNUSED;
           PRINTF("\n*** RELEASED HTTPD Session\n");
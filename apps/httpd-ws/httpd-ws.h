@@ -65,7 +65,44 @@
 #define  HTTPD_OUTBUF_SIZE WEBSERVER_CONF_OUTBUF_SIZE
 #endif /* WEBSERVER_CONF_OUTBUF_SIZE */
 
+/* Accept WebSocket upgrades. Every WebSocket session subscribes to
+   the path it was opened on and receives what is published to that
+   path with httpd_ws_publish(). */
+#ifdef HTTPD_WS_CONF_WEBSOCKET
+#define HTTPD_WS_WEBSOCKET HTTPD_WS_CONF_WEBSOCKET
+#else /* HTTPD_WS_CONF_WEBSOCKET */
+#define HTTPD_WS_WEBSOCKET 0
+#endif /* HTTPD_WS_CONF_WEBSOCKET */
+
+/* Number of published messages that can be buffered. A message is
+   stored once, however many sessions it is queued for. */
+#ifdef HTTPD_WS_CONF_WEBSOCKET_MESSAGES
+#define HTTPD_WS_WEBSOCKET_MESSAGES HTTPD_WS_CONF_WEBSOCKET_MESSAGES
+#else /* HTTPD_WS_CONF_WEBSOCKET_MESSAGES */
+#define HTTPD_WS_WEBSOCKET_MESSAGES 4
+#endif /* HTTPD_WS_CONF_WEBSOCKET_MESSAGES */
+
+/* Largest message that can be published. By default, the largest
+   that fits in a TCP segment with its frame header. */
+#ifdef HTTPD_WS_CONF_WEBSOCKET_MSGLEN
+#define HTTPD_WS_WEBSOCKET_MSGLEN HTTPD_WS_CONF_WEBSOCKET_MSGLEN
+#else /* HTTPD_WS_CONF_WEBSOCKET_MSGLEN */
+#define HTTPD_WS_WEBSOCKET_MSGLEN (UIP_TCP_MSS - 4)
+#endif /* HTTPD_WS_CONF_WEBSOCKET_MSGLEN */
+
+/* Number of messages each session can have queued. */
+#ifdef HTTPD_WS_CONF_WEBSOCKET_QUEUE
+#define HTTPD_WS_WEBSOCKET_QUEUE HTTPD_WS_CONF_WEBSOCKET_QUEUE
+#else /* HTTPD_WS_CONF_WEBSOCKET_QUEUE */
+#define HTTPD_WS_WEBSOCKET_QUEUE 4
+#endif /* HTTPD_WS_CONF_WEBSOCKET_QUEUE */
+
+#if HTTPD_WS_WEBSOCKET && HTTPD_WS_WEBSOCKET_MSGLEN + 4 > UIP_TCP_MSS
+#error HTTPD_WS_WEBSOCKET_MSGLEN is too large. A frame must fit in a TCP segment.
+#endif
+
 struct httpd_ws_state;
+struct httpd_ws_message;
 typedef char (* httpd_ws_script_t)(struct httpd_ws_state *s);
 typedef int (* httpd_ws_output_headers_t)(struct httpd_ws_state *s,
                                           char *buffer, int buf_size,
@@ -75,12 +112,14 @@ typedef int (* httpd_ws_output_headers_t)(struct httpd_ws_state *s,
 #define HTTPD_WS_POST     2
 #define HTTPD_WS_PUT      3
 #define HTTPD_WS_RESPONSE 4
+#define HTTPD_WS_UPGRADE  5
 
 #define HTTPD_WS_STATE_UNUSED         0
 #define HTTPD_WS_STATE_INPUT          1
 #define HTTPD_WS_STATE_OUTPUT         2
 #define HTTPD_WS_STATE_REQUEST_OUTPUT 3
 #define HTTPD_WS_STATE_REQUEST_INPUT  4
+#define HTTPD_WS_STATE_WEBSOCKET      5
 
 struct httpd_ws_state {
   struct timer timer;
@@ -99,6 +138,16 @@ struct httpd_ws_state {
   httpd_ws_output_headers_t output_extra_headers;
   httpd_ws_script_t script;
 
+#if HTTPD_WS_WEBSOCKET
+  struct uip_conn *conn;
+  struct httpd_ws_message *queue[HTTPD_WS_WEBSOCKET_QUEUE];
+  uint8_t queue_first, queue_len;
+  /* Number of queued messages in the segment that is not yet acked. */
+  uint8_t inflight;
+  /* Bytes of an incoming frame that are still to be skipped. */
+  uint16_t skip;
+#endif /* HTTPD_WS_WEBSOCKET */
+
 #ifdef HTTPD_WS_CONF_USER_STATE
   HTTPD_WS_CONF_USER_STATE;
 #endif
@@ -120,6 +169,18 @@ struct httpd_ws_state *httpd_ws_request(char request_type,
 
 httpd_ws_script_t httpd_ws_get_script(struct httpd_ws_state *s);
 
+#if HTTPD_WS_WEBSOCKET
+/**
+ * Queue a text message for all WebSocket sessions that were opened on
+ * path. The message is copied once and shared by the sessions. Returns
+ * the number of sessions it was queued for.
+ */
+int httpd_ws_publish(const char *path, const char *data, uint16_t len);
+
+/** Returns the number of WebSocket sessions open on path. */
+int httpd_ws_subscribers(const char *path);
+#endif /* HTTPD_WS_WEBSOCKET */
+
 PROCESS_NAME(httpd_ws_process);
 
 #endif /* HTTPD_WS_H_ */
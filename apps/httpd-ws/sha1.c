@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A small SHA-1 implementation, used for the WebSocket handshake
+ */
+
+#include "sha1.h"
+
+#include <string.h>
+
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+/*---------------------------------------------------------------------------*/
+static void
+process_block(struct sha1_ctx *ctx)
+{
+  uint32_t w[16];
+  uint32_t a, b, c, d, e, f, k, t;
+  uint8_t i;
+
+  for(i = 0; i < 16; i++) {
+    w[i] = (uint32_t)ctx->block[i * 4] << 24 |
+      (uint32_t)ctx->block[i * 4 + 1] << 16 |
+      (uint32_t)ctx->block[i * 4 + 2] << 8 |
+      ctx->block[i * 4 + 3];
+  }
+
+  a = ctx->h[0];
+  b = ctx->h[1];
+  c = ctx->h[2];
+  d = ctx->h[3];
+  e = ctx->h[4];
+
+  for(i = 0; i < 80; i++) {
+    if(i >= 16) {
+      /* The message schedule is kept in a 16 word ring. */
+      t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15];
+      w[i & 15] = ROL(t, 1);
+    }
+    if(i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5a827999;
+    } else if(i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ed9eba1;
+    } else if(i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8f1bbcdc;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xca62c1d6;
+    }
+    t = ROL(a, 5) + f + e + k + w[i & 15];
+    e = d;
+    d = c;
+    c = ROL(b, 30);
+    b = a;
+    a = t;
+  }
+
+  ctx->h[0] += a;
+  ctx->h[1] += b;
+  ctx->h[2] += c;
+  ctx->h[3] += d;
+  ctx->h[4] += e;
+}
+/*---------------------------------------------------------------------------*/
+void
+sha1_init(struct sha1_ctx *ctx)
+{
+  ctx->h[0] = 0x67452301;
+  ctx->h[1] = 0xefcdab89;
+  ctx->h[2] = 0x98badcfe;
+  ctx->h[3] = 0x10325476;
+  ctx->h[4] = 0xc3d2e1f0;
+  ctx->len = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+sha1_update(struct sha1_ctx *ctx, const void *data, uint16_t len)
+{
+  const uint8_t *p = data;
+
+  while(len-- > 0) {
+    ctx->block[ctx->len++ & 63] = *p++;
+    if((ctx->len & 63) == 0) {
+      process_block(ctx);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sha1_final(struct sha1_ctx *ctx, uint8_t digest[SHA1_DIGEST_LEN])
+{
+  uint32_t bits;
+  uint8_t i;
+
+  bits = ctx->len << 3;
+  ctx->block[ctx->len++ & 63] = 0x80;
+
+  /* Pad, using one more block if the 64-bit length does not fit. */
+  i = ctx->len & 63;
+  if(i > 56) {
+    memset(&ctx->block[i], 0, 64 - i);
+    process_block(ctx);
+    i = 0;
+  } else if(i == 0) {
+    process_block(ctx);
+  }
+  memset(&ctx->block[i], 0, 60 - i);
+  ctx->block[60] = bits >> 24;
+  ctx->block[61] = bits >> 16;
+  ctx->block[62] = bits >> 8;
+  ctx->block[63] = bits;
+  process_block(ctx);
+
+  for(i = 0; i < SHA1_DIGEST_LEN; i++) {
+    digest[i] = ctx->h[i / 4] >> (24 - 8 * (i & 3));
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -46,6 +46,7 @@
 #include "lwm2m-object.h"
 #include "lwm2m-engine.h"
 #include "er-coap-engine.h"
+#include "lib/timeseries.h"
 
 #ifdef IPSO_TEMPERATURE
 extern const struct ipso_objects_sensor IPSO_TEMPERATURE;
@@ -59,10 +60,38 @@ extern const struct ipso_objects_sensor IPSO_TEMPERATURE;
 #define IPSO_TEMPERATURE_MAX (80 * LWM2M_FLOAT32_FRAC)
 #endif
 
+/*
+ * With IPSO_TEMPERATURE_HISTORY set to a number of samples, the periodic
+ * readings are also kept, with their clock_seconds() timestamps, and
+ * served by the resource IPSO_TEMPERATURE_HISTORY_ID (not an IPSO
+ * resource) as a lib/timeseries.h series of fix float values, Content-
+ * Format APPLICATION_X_TIMESERIES. Observers are notified each time
+ * that many new samples have been taken, so that one message carries
+ * them all.
+ */
+#ifndef IPSO_TEMPERATURE_HISTORY
+#define IPSO_TEMPERATURE_HISTORY 0
+#endif
+
+#ifndef IPSO_TEMPERATURE_HISTORY_ID
+#define IPSO_TEMPERATURE_HISTORY_ID 26241
+#endif
+
+#define STR(x) #x
+#define HISTORY_PATH(id) "/0/" STR(id)
+
 static struct ctimer periodic_timer;
 static int32_t min_temp;
 static int32_t max_temp;
 static int read_temp(int32_t *value);
+
+#if IPSO_TEMPERATURE_HISTORY
+static uint32_t history_time[IPSO_TEMPERATURE_HISTORY];
+static int32_t history_value[IPSO_TEMPERATURE_HISTORY];
+static uint16_t history_next;
+static uint16_t history_count;
+static uint16_t history_new;
+#endif /* IPSO_TEMPERATURE_HISTORY */
 /*---------------------------------------------------------------------------*/
 static int
 temp(lwm2m_context_t *ctx, uint8_t *outbuf, size_t outsize)
@@ -75,6 +104,68 @@ temp(lwm2m_context_t *ctx, uint8_t *outbuf, size_t outsize)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if IPSO_TEMPERATURE_HISTORY
+/* Encode the samples from the given number of samples back, oldest first */
+static int
+encode_history(uint8_t *outbuf, size_t outsize, uint16_t count)
+{
+  struct timeseries_encoder e;
+  uint16_t i, index;
+
+  timeseries_encoder_init(&e, outbuf, outsize);
+  index = (history_next + IPSO_TEMPERATURE_HISTORY - count) %
+    IPSO_TEMPERATURE_HISTORY;
+  for(i = 0; i < count; i++) {
+    if(!timeseries_encoder_add(&e, history_time[index],
+                               history_value[index])) {
+      return -1;
+    }
+    index = (index + 1) % IPSO_TEMPERATURE_HISTORY;
+  }
+  return timeseries_encoder_length(&e);
+}
+/*---------------------------------------------------------------------------*/
+static int
+history(lwm2m_context_t *ctx, uint8_t *outbuf, size_t outsize)
+{
+  uint16_t count;
+  int len;
+
+  if(ctx->content_format != LWM2M_TLV) {
+    /* Part of a larger response: only give the number of samples */
+    return ctx->writer->write_int(ctx, outbuf, outsize, history_count);
+  }
+
+  /* As many of the latest samples as fit */
+  count = history_count;
+  while((len = encode_history(outbuf, outsize, count)) < 0 && count > 0) {
+    count--;
+  }
+  if(len <= 0) {
+    return 0;
+  }
+  ctx->content_format = APPLICATION_X_TIMESERIES;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns non-zero when IPSO_TEMPERATURE_HISTORY new samples are ready */
+static int
+add_history(int32_t value)
+{
+  history_time[history_next] = clock_seconds();
+  history_value[history_next] = value;
+  history_next = (history_next + 1) % IPSO_TEMPERATURE_HISTORY;
+  if(history_count < IPSO_TEMPERATURE_HISTORY) {
+    history_count++;
+  }
+  if(++history_new == IPSO_TEMPERATURE_HISTORY) {
+    history_new = 0;
+    return 1;
+  }
+  return 0;
+}
+#endif /* IPSO_TEMPERATURE_HISTORY */
+/*---------------------------------------------------------------------------*/
 LWM2M_RESOURCES(temperature_resources,
                 /* Temperature (Current) */
                 LWM2M_RESOURCE_CALLBACK(5700, { temp, NULL, NULL }),
@@ -88,6 +179,11 @@ LWM2M_RESOURCES(temperature_resources,
                 LWM2M_RESOURCE_FLOATFIX_VAR(5601, &min_temp),
                 /* Max Measured Value */
                 LWM2M_RESOURCE_FLOATFIX_VAR(5602, &max_temp),
+#if IPSO_TEMPERATURE_HISTORY
+                /* Recent values, as a time series */
+                LWM2M_RESOURCE_CALLBACK(IPSO_TEMPERATURE_HISTORY_ID,
+                                        { history, NULL, NULL }),
+#endif /* IPSO_TEMPERATURE_HISTORY */
                 );
 LWM2M_INSTANCES(temperature_instances,
                 LWM2M_INSTANCE(0, temperature_resources));
@@ -127,9 +223,17 @@ handle_periodic_timer(void *ptr)
   int32_t v;
 
   /* Only notify when the value has changed since last */
-  if(read_temp(&v) && v != last_value) {
-    last_value = v;
-    lwm2m_object_notify_observers(&temperature, "/0/5700");
+  if(read_temp(&v)) {
+#if IPSO_TEMPERATURE_HISTORY
+    if(add_history(v)) {
+      lwm2m_object_notify_observers(&temperature,
+                                    HISTORY_PATH(IPSO_TEMPERATURE_HISTORY_ID));
+    }
+#endif /* IPSO_TEMPERATURE_HISTORY */
+    if(v != last_value) {
+      last_value = v;
+      lwm2m_object_notify_observers(&temperature, "/0/5700");
+    }
   }
   ctimer_reset(&periodic_timer);
 }
@@ -56,7 +56,14 @@ pop(struct jsonparse_state *state)
 /* will pass by the value and store the start and length of the value for
    atomic types */
 /*--------------------------------------------------------------------*/
-static void
+static int
+is_number_char(char c)
+{
+  return (c >= '0' && c <= '9') || c == '.';
+}
+/*--------------------------------------------------------------------*/
+/* returns 0 if the value is cut by the end of the input */
+static int
 atomic(struct jsonparse_state *state, char type)
 {
   char c;
@@ -64,26 +71,30 @@ atomic(struct jsonparse_state *state, char type)
   state->vstart = state->pos;
   state->vtype = type;
   if(type == JSON_TYPE_STRING || type == JSON_TYPE_PAIR_NAME) {
-    while((c = state->json[state->pos++]) && c != '"') {
+    c = 0;
+    while(state->pos < state->len &&
+          (c = state->json[state->pos++]) && c != '"') {
       if(c == '\\') {
         state->pos++;           /* skip current char */
       }
     }
     state->vlen = state->pos - state->vstart - 1;
+    if(c != '"' || state->pos > state->len) {
+      return 0;
+    }
   } else if(type == JSON_TYPE_NUMBER) {
-    do {
-      c = state->json[state->pos];
-      if((c < '0' || c > '9') && c != '.') {
-        c = 0;
-      } else {
-        state->pos++;
-      }
-    } while(c);
+    while(state->pos < state->len && is_number_char(state->json[state->pos])) {
+      state->pos++;
+    }
     /* need to back one step since first char is already gone */
     state->vstart--;
     state->vlen = state->pos - state->vstart;
+    if(state->pos == state->len) {
+      return 0;
+    }
   }
   /* no other types for now... */
+  return 1;
 }
 /*--------------------------------------------------------------------*/
 static void
@@ -92,7 +103,8 @@ skip_ws(struct jsonparse_state *state)
   char c;
 
   while(state->pos < state->len &&
-        ((c = state->json[state->pos]) == ' ' || c == '\n')) {
+        ((c = state->json[state->pos]) == ' ' || c == '\n' ||
+         c == '\r' || c == '\t')) {
     state->pos++;
   }
 }
@@ -106,6 +118,93 @@ jsonparse_setup(struct jsonparse_state *state, const char *json, int len)
   state->depth = 0;
   state->error = 0;
   state->stack[0] = 0;
+#if JSONPARSE_CARRY_SIZE > 0
+  state->carry_len = 0;
+  state->next_json = NULL;
+#endif /* JSONPARSE_CARRY_SIZE > 0 */
+}
+/*--------------------------------------------------------------------*/
+#if JSONPARSE_CARRY_SIZE > 0
+/* keep the value cut at the end of the chunk, from its first char */
+static void
+carry_value(struct jsonparse_state *state, int start)
+{
+  int len = state->len - start;
+
+  state->pos = state->len;
+  state->vtype = 0;
+  if(len > JSONPARSE_CARRY_SIZE) {
+    state->error = JSON_ERROR_SYNTAX;
+    return;
+  }
+  memmove(state->carry, &state->json[start], len);
+  state->carry_len = len;
+}
+/*--------------------------------------------------------------------*/
+void
+jsonparse_feed(struct jsonparse_state *state, const char *json, int len)
+{
+  int pos, i, done;
+  char c, escaped;
+
+  state->json = json;
+  state->pos = 0;
+  state->len = len;
+  if(state->carry_len == 0) {
+    return;
+  }
+
+  /* complete the carried value from the chunk */
+  pos = 0;
+  done = 0;
+  if(state->carry[0] == '"') {
+    escaped = 0;
+    for(i = 1; i < state->carry_len; i++) {
+      escaped = !escaped && state->carry[i] == '\\';
+    }
+    while(pos < len && state->carry_len < JSONPARSE_CARRY_SIZE) {
+      c = json[pos++];
+      state->carry[state->carry_len++] = c;
+      if(!escaped && c == '"') {
+        done = 1;
+        break;
+      }
+      escaped = !escaped && c == '\\';
+    }
+  } else {
+    while(pos < len && is_number_char(json[pos]) &&
+          state->carry_len < JSONPARSE_CARRY_SIZE) {
+      state->carry[state->carry_len++] = json[pos++];
+    }
+    done = pos < len;
+  }
+  if(!done && state->carry_len < JSONPARSE_CARRY_SIZE) {
+    /* the value goes on in the next chunk */
+    state->pos = len;
+    return;
+  }
+
+  /* parse the value alone, then go on with the chunk */
+  state->next_json = json;
+  state->next_pos = pos;
+  state->next_len = len;
+  state->json = state->carry;
+  state->len = state->carry_len;
+  state->carry_len = 0;
+}
+#endif /* JSONPARSE_CARRY_SIZE > 0 */
+/*--------------------------------------------------------------------*/
+/* a value at the end of the input: complete unless more input follows */
+static int
+cut_value(struct jsonparse_state *state, int start)
+{
+#if JSONPARSE_CARRY_SIZE > 0
+  if(state->json != state->carry) {
+    carry_value(state, start);
+    return 0;
+  }
+#endif /* JSONPARSE_CARRY_SIZE > 0 */
+  return state->vtype;
 }
 /*--------------------------------------------------------------------*/
 int
@@ -113,8 +212,23 @@ jsonparse_next(struct jsonparse_state *state)
 {
   char c;
   char s;
+  int start;
 
   skip_ws(state);
+#if JSONPARSE_CARRY_SIZE > 0
+  if(state->pos >= state->len && state->next_json != NULL) {
+    /* the carried value is done, back to its chunk */
+    state->json = state->next_json;
+    state->pos = state->next_pos;
+    state->len = state->next_len;
+    state->next_json = NULL;
+    skip_ws(state);
+  }
+#endif /* JSONPARSE_CARRY_SIZE > 0 */
+  if(state->pos >= state->len) {
+    return 0;
+  }
+  start = state->pos;
   c = state->json[state->pos];
   s = jsonparse_get_type(state);
   state->pos++;
@@ -160,7 +274,9 @@ jsonparse_next(struct jsonparse_state *state)
     return c;
   case '"':
     if(s == '{' || s == '[' || s == ':') {
-      atomic(state, c = (s == '{' ? JSON_TYPE_PAIR_NAME : c));
+      if(!atomic(state, c = (s == '{' ? JSON_TYPE_PAIR_NAME : c))) {
+        return cut_value(state, start);
+      }
     } else {
       state->error = JSON_ERROR_UNEXPECTED_STRING;
       return JSON_TYPE_ERROR;
@@ -177,7 +293,9 @@ jsonparse_next(struct jsonparse_state *state)
   default:
     if(s == ':' || s == '[') {
       if(c <= '9' && c >= '0') {
-        atomic(state, JSON_TYPE_NUMBER);
+        if(!atomic(state, JSON_TYPE_NUMBER)) {
+          return cut_value(state, start);
+        }
         return JSON_TYPE_NUMBER;
       }
     }
@@ -192,16 +310,12 @@ jsonparse_next(struct jsonparse_state *state)
 int
 jsonparse_copy_value(struct jsonparse_state *state, char *str, int size)
 {
-  int i;
-
   if(state->vtype == 0) {
     return 0;
   }
   size = size <= state->vlen ? (size - 1) : state->vlen;
-  for(i = 0; i < size; i++) {
-    str[i] = state->json[state->vstart + i];
-  }
-  str[i] = 0;
+  memcpy(str, &state->json[state->vstart], size);
+  str[size] = 0;
   return state->vtype;
 }
 /*--------------------------------------------------------------------*/
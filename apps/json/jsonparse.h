@@ -41,6 +41,14 @@
 #define JSONPARSE_MAX_DEPTH 10
 #endif
 
+/* Longest string or number that can be split between two chunks of a
+ * document parsed with jsonparse_feed(). 0 disables jsonparse_feed(). */
+#ifdef JSONPARSE_CONF_CARRY_SIZE
+#define JSONPARSE_CARRY_SIZE JSONPARSE_CONF_CARRY_SIZE
+#else
+#define JSONPARSE_CARRY_SIZE 0
+#endif
+
 struct jsonparse_state {
   const char *json;
   int pos;
@@ -52,6 +60,14 @@ struct jsonparse_state {
   char vtype;
   char error;
   char stack[JSONPARSE_MAX_DEPTH];
+#if JSONPARSE_CARRY_SIZE > 0
+  /* a value split between two chunks, and the chunk that follows it */
+  char carry[JSONPARSE_CARRY_SIZE];
+  int carry_len;
+  const char *next_json;
+  int next_pos;
+  int next_len;
+#endif /* JSONPARSE_CARRY_SIZE > 0 */
 };
 
 /**
@@ -66,6 +82,22 @@ struct jsonparse_state {
 void jsonparse_setup(struct jsonparse_state *state, const char *json,
                      int len);
 
+#if JSONPARSE_CARRY_SIZE > 0
+/**
+ * \brief      Continue parsing with the next chunk of a document.
+ * \param state A pointer to a JSON parser state
+ * \param json The next chunk of the document
+ * \param len  The length of the chunk
+ *
+ *             jsonparse_next() returns 0 at the end of each chunk. A
+ *             string or number cut by the end of a chunk is kept in the
+ *             state and returned whole once the next chunk is fed. The
+ *             chunk must stay valid until jsonparse_next() returns 0.
+ */
+void jsonparse_feed(struct jsonparse_state *state, const char *json,
+                    int len);
+#endif /* JSONPARSE_CARRY_SIZE > 0 */
+
 /* move to next JSON element */
 int jsonparse_next(struct jsonparse_state *state);
 
@@ -50,32 +50,106 @@
 #define PRINTF(...)
 #endif
 
+#if JSONTREE_PRETTY
+/* written in one piece for the indentation of a level */
+static const char indentation[] = "                    ";
+#endif
+
+#if JSONTREE_BUFFERED
+/* the buffer written to by the putchar of the output callbacks */
+static struct jsontree_buffer *current_buffer;
+#endif /* JSONTREE_BUFFERED */
+/*---------------------------------------------------------------------------*/
+#if JSONTREE_BUFFERED
+static void
+buffer_write(struct jsontree_buffer *buffer, const char *data, int len)
+{
+  int n;
+
+  while(len > 0) {
+    if(buffer->len == buffer->size) {
+      buffer->write(buffer->data, buffer->len);
+      buffer->len = 0;
+    }
+    n = buffer->size - buffer->len;
+    if(n > len) {
+      n = len;
+    }
+    memcpy(&buffer->data[buffer->len], data, n);
+    buffer->len += n;
+    data += n;
+    len -= n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+buffer_putchar(int c)
+{
+  char ch = c;
+
+  if(current_buffer != NULL) {
+    buffer_write(current_buffer, &ch, 1);
+  }
+  return c;
+}
+#endif /* JSONTREE_BUFFERED */
+/*---------------------------------------------------------------------------*/
+static void
+write_bytes(const struct jsontree_context *js_ctx, const char *data, int len)
+{
+#if JSONTREE_BUFFERED
+  if(js_ctx->buffer != NULL) {
+    buffer_write(js_ctx->buffer, data, len);
+    return;
+  }
+#endif /* JSONTREE_BUFFERED */
+  while(len-- > 0) {
+    js_ctx->putchar(*data++);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if JSONTREE_PRETTY
+static void
+write_indentation(const struct jsontree_context *js_ctx, int depth)
+{
+  int len;
+
+  for(len = depth * 2; len > 0; len -= sizeof(indentation) - 1) {
+    write_bytes(js_ctx, indentation,
+                len < sizeof(indentation) - 1 ? len : sizeof(indentation) - 1);
+  }
+}
+#endif /* JSONTREE_PRETTY */
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
 {
   if(text == NULL) {
-    js_ctx->putchar('0');
+    write_bytes(js_ctx, "0", 1);
   } else {
-    while(*text != '\0') {
-      js_ctx->putchar(*text++);
-    }
+    write_bytes(js_ctx, text, strlen(text));
   }
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_string(const struct jsontree_context *js_ctx, const char *text)
 {
-  js_ctx->putchar('"');
+  int len;
+
+  write_bytes(js_ctx, "\"", 1);
   if(text != NULL) {
+    /* the runs between quotes in one piece */
     while(*text != '\0') {
+      len = strcspn(text, "\"");
+      write_bytes(js_ctx, text, len);
+      text += len;
       if(*text == '"') {
-        js_ctx->putchar('\\');
+        write_bytes(js_ctx, "\\\"", 2);
+        text++;
       }
-      js_ctx->putchar(*text++);
     }
   }
-  js_ctx->putchar('"');
+  write_bytes(js_ctx, "\"", 1);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -90,16 +164,15 @@ jsontree_write_uint(const struct jsontree_context *js_ctx, unsigned int value)
     value /= 10;
   } while(value > 0 && l >= 0);
 
-  while(++l < sizeof(buf)) {
-    js_ctx->putchar(buf[l]);
-  }
+  l++;
+  write_bytes(js_ctx, &buf[l], sizeof(buf) - l);
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_int(const struct jsontree_context *js_ctx, int value)
 {
   if(value < 0) {
-    js_ctx->putchar('-');
+    write_bytes(js_ctx, "-", 1);
     value = -value;
   }
 
@@ -112,10 +185,34 @@ jsontree_setup(struct jsontree_context *js_ctx, struct jsontree_value *root,
 {
   js_ctx->values[0] = root;
   js_ctx->putchar = putchar;
+#if JSONTREE_BUFFERED
+  js_ctx->buffer = NULL;
+#endif /* JSONTREE_BUFFERED */
   js_ctx->path = 0;
   jsontree_reset(js_ctx);
 }
 /*---------------------------------------------------------------------------*/
+#if JSONTREE_BUFFERED
+void
+jsontree_setup_buffered(struct jsontree_context *js_ctx,
+                        struct jsontree_value *root,
+                        struct jsontree_buffer *buffer)
+{
+  jsontree_setup(js_ctx, root, buffer_putchar);
+  buffer->len = 0;
+  js_ctx->buffer = buffer;
+}
+/*---------------------------------------------------------------------------*/
+void
+jsontree_flush(const struct jsontree_context *js_ctx)
+{
+  if(js_ctx->buffer != NULL && js_ctx->buffer->len > 0) {
+    js_ctx->buffer->write(js_ctx->buffer->data, js_ctx->buffer->len);
+    js_ctx->buffer->len = 0;
+  }
+}
+#endif /* JSONTREE_BUFFERED */
+/*---------------------------------------------------------------------------*/
 void
 jsontree_reset(struct jsontree_context *js_ctx)
 {
@@ -138,11 +235,11 @@ jsontree_print_next(struct jsontree_context *js_ctx)
 {
   struct jsontree_value *v;
   int index;
-#if JSONTREE_PRETTY
-  int indent;
-#endif
 
   v = js_ctx->values[js_ctx->depth];
+#if JSONTREE_BUFFERED
+  current_buffer = js_ctx->buffer;
+#endif /* JSONTREE_BUFFERED */
 
   /* Default operation after switch is to back up one level */
   switch(v->type) {
@@ -153,46 +250,41 @@ jsontree_print_next(struct jsontree_context *js_ctx)
 
     index = js_ctx->index[js_ctx->depth];
     if(index == 0) {
-      js_ctx->putchar(v->type);
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
+      write_bytes(js_ctx, v->type == JSON_TYPE_OBJECT ? "{\n" : "[\n", 2);
+#else
+      write_bytes(js_ctx, v->type == JSON_TYPE_OBJECT ? "{" : "[", 1);
 #endif
     }
     if(index >= o->count) {
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
-      indent = js_ctx->depth;
-      while (indent--) {
-        js_ctx->putchar(' ');
-        js_ctx->putchar(' ');
-      }
+      write_bytes(js_ctx, "\n", 1);
+      write_indentation(js_ctx, js_ctx->depth);
 #endif
-      js_ctx->putchar(v->type + 2);
+      write_bytes(js_ctx, v->type == JSON_TYPE_OBJECT ? "}" : "]", 1);
       /* Default operation: back up one level! */
       break;
     }
 
     if(index > 0) {
-      js_ctx->putchar(',');
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
+      write_bytes(js_ctx, ",\n", 2);
+#else
+      write_bytes(js_ctx, ",", 1);
 #endif
     }
 
 #if JSONTREE_PRETTY
-    indent = js_ctx->depth + 1;
-    while (indent--) {
-      js_ctx->putchar(' ');
-      js_ctx->putchar(' ');
-    }
+    write_indentation(js_ctx, js_ctx->depth + 1);
 #endif
 
     if(v->type == JSON_TYPE_OBJECT) {
       jsontree_write_string(js_ctx,
                             ((struct jsontree_object *)o)->pairs[index].name);
-      js_ctx->putchar(':');
 #if JSONTREE_PRETTY
-      js_ctx->putchar(' ');
+      write_bytes(js_ctx, ": ", 2);
+#else
+      write_bytes(js_ctx, ":", 1);
 #endif
       ov = ((struct jsontree_object *)o)->pairs[index].value;
     } else {
@@ -55,10 +55,31 @@
 #define JSONTREE_PRETTY 0
 #endif /* JSONTREE_CONF_PRETTY */
 
+/* Collect the output in a buffer handed to a write function in bulk,
+ * instead of calling putchar for each character */
+#ifdef JSONTREE_CONF_BUFFERED
+#define JSONTREE_BUFFERED JSONTREE_CONF_BUFFERED
+#else
+#define JSONTREE_BUFFERED 0
+#endif /* JSONTREE_CONF_BUFFERED */
+
+#if JSONTREE_BUFFERED
+struct jsontree_buffer {
+  /* called with the buffered output when the buffer is full or flushed */
+  int (* write)(const char *data, int len);
+  char *data;
+  uint16_t size;
+  uint16_t len;
+};
+#endif /* JSONTREE_BUFFERED */
+
 struct jsontree_context {
   struct jsontree_value *values[JSONTREE_MAX_DEPTH];
   uint16_t index[JSONTREE_MAX_DEPTH];
   int (* putchar)(int);
+#if JSONTREE_BUFFERED
+  struct jsontree_buffer *buffer;
+#endif /* JSONTREE_BUFFERED */
   uint8_t depth;
   uint8_t path;
   int callback_state;
@@ -143,6 +164,19 @@ void jsontree_setup(struct jsontree_context *js_ctx,
                     struct jsontree_value *root, int (* putchar)(int));
 void jsontree_reset(struct jsontree_context *js_ctx);
 
+#if JSONTREE_BUFFERED
+/*
+ * Set up a context whose output goes through buffer: write, data and size
+ * must be set. The putchar of the context, for the output callbacks,
+ * writes to the buffer as well. Call jsontree_flush() after the last
+ * jsontree_print_next().
+ */
+void jsontree_setup_buffered(struct jsontree_context *js_ctx,
+                             struct jsontree_value *root,
+                             struct jsontree_buffer *buffer);
+void jsontree_flush(const struct jsontree_context *js_ctx);
+#endif /* JSONTREE_BUFFERED */
+
 const char *jsontree_path_name(const struct jsontree_context *js_ctx,
                                int depth);
 
@@ -0,0 +1,877 @@
+/*
+ * Copyright (c) 2016, Texas Instruments Incorporated - http://www.ti.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup mqtt-sn-gateway
+ * @{
+ */
+/**
+ * \file
+ *    Implementation of the MQTT-SN gateway
+ */
+/*---------------------------------------------------------------------------*/
+#include "mqtt-sn-gateway.h"
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/simple-udp.h"
+#include "sys/ctimer.h"
+#include "lib/memb.h"
+#include "lib/list.h"
+
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+/*---------------------------------------------------------------------------*/
+#if MQTT_MAX_INFLIGHT == 0
+#error "The MQTT-SN gateway needs MQTT_CONF_MAX_INFLIGHT > 0"
+#endif
+
+/* Period of the check for lost clients */
+#define SWEEP_INTERVAL (10 * CLOCK_SECOND)
+
+#define MAX_PAYLOAD (MQTT_SN_MAX_PACKET_SIZE - 7)
+/*---------------------------------------------------------------------------*/
+typedef enum {
+  CLIENT_ACTIVE,
+  CLIENT_ASLEEP,
+} client_state_t;
+
+struct client {
+  struct client *next;
+  uip_ipaddr_t addr;
+  uint16_t port;
+  char id[MQTT_SN_CLIENT_ID_MAX_LEN + 1];
+  client_state_t state;
+  /* Keep-alive or sleep duration, in seconds */
+  uint16_t duration;
+  unsigned long last_heard;
+};
+
+typedef enum {
+  TOPIC_UNSUBSCRIBED,
+  TOPIC_PENDING,
+  TOPIC_SUBSCRIBING,
+  TOPIC_SUBSCRIBED,
+} topic_state_t;
+
+struct topic {
+  struct topic *next;
+  uint16_t id;
+  /* State of the subscription with the broker */
+  topic_state_t state;
+  char name[MQTT_SN_GATEWAY_TOPIC_LENGTH + 1];
+};
+
+struct subscription {
+  struct subscription *next;
+  struct client *client;
+  struct topic *topic;
+  /* The SUBSCRIBE to answer once the broker has acknowledged, or 0 */
+  uint16_t msg_id;
+  uint8_t short_name;
+};
+
+/* A message of a client, until the broker has it */
+struct forward {
+  struct forward *next;
+  struct client *client;
+  uint16_t mid;
+  uint16_t msg_id;
+  uint16_t topic_id;
+  uint8_t qos;
+  uint8_t payload[MAX_PAYLOAD];
+};
+
+/* A message for a sleeping client */
+struct kept {
+  struct kept *next;
+  struct client *client;
+  uint16_t topic_id;
+  uint8_t topic_type;
+  uint8_t length;
+  uint8_t payload[MAX_PAYLOAD];
+};
+
+MEMB(clients_memb, struct client, MQTT_SN_GATEWAY_MAX_CLIENTS);
+MEMB(topics_memb, struct topic, MQTT_SN_GATEWAY_MAX_TOPICS);
+MEMB(subscriptions_memb, struct subscription,
+     MQTT_SN_GATEWAY_MAX_SUBSCRIPTIONS);
+MEMB(forwards_memb, struct forward, MQTT_SN_GATEWAY_MAX_FORWARDS);
+MEMB(kept_memb, struct kept, MQTT_SN_GATEWAY_MAX_KEPT);
+LIST(clients);
+LIST(topics);
+LIST(subscriptions);
+LIST(forwards);
+LIST(kept_list);
+
+static struct simple_udp_connection udp;
+static struct mqtt_connection *broker;
+static struct topic *subscribing;
+static uint16_t last_topic_id;
+static struct ctimer sweep_timer;
+/*---------------------------------------------------------------------------*/
+static void
+write_uint16(uint8_t *p, uint16_t value)
+{
+  p[0] = value >> 8;
+  p[1] = value & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+read_uint16(const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_to(struct client *c, const uint8_t *msg)
+{
+  simple_udp_sendto_port(&udp, msg, msg[0], &c->addr, c->port);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_simple(struct client *c, uint8_t type)
+{
+  uint8_t msg[2];
+
+  msg[0] = sizeof(msg);
+  msg[1] = type;
+  send_to(c, msg);
+}
+/*---------------------------------------------------------------------------*/
+/* REGACK and PUBACK */
+static void
+send_ack(struct client *c, uint8_t type, uint16_t topic_id, uint16_t msg_id,
+         uint8_t return_code)
+{
+  uint8_t msg[7];
+
+  msg[0] = sizeof(msg);
+  msg[1] = type;
+  write_uint16(&msg[2], topic_id);
+  write_uint16(&msg[4], msg_id);
+  msg[6] = return_code;
+  send_to(c, msg);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_connack(const uip_ipaddr_t *addr, uint16_t port, uint8_t return_code)
+{
+  uint8_t msg[3];
+
+  msg[0] = sizeof(msg);
+  msg[1] = MQTT_SN_MSG_CONNACK;
+  msg[2] = return_code;
+  simple_udp_sendto_port(&udp, msg, sizeof(msg), addr, port);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_suback(struct client *c, uint16_t topic_id, uint16_t msg_id,
+            uint8_t return_code)
+{
+  uint8_t msg[8];
+
+  msg[0] = sizeof(msg);
+  msg[1] = MQTT_SN_MSG_SUBACK;
+  /* Messages are delivered with QoS 0 */
+  msg[2] = 0;
+  write_uint16(&msg[3], topic_id);
+  write_uint16(&msg[5], msg_id);
+  msg[7] = return_code;
+  send_to(c, msg);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_publish(struct client *c, uint16_t topic_id, uint8_t topic_type,
+             const uint8_t *payload, uint8_t length)
+{
+  uint8_t msg[MQTT_SN_MAX_PACKET_SIZE];
+
+  msg[0] = 7 + length;
+  msg[1] = MQTT_SN_MSG_PUBLISH;
+  msg[2] = topic_type;
+  write_uint16(&msg[3], topic_id);
+  write_uint16(&msg[5], 0);
+  memcpy(&msg[7], payload, length);
+  send_to(c, msg);
+}
+/*---------------------------------------------------------------------------*/
+/* Sends the messages kept while the client slept */
+static void
+send_kept(struct client *c)
+{
+  struct kept *k, *next;
+
+  for(k = list_head(kept_list); k != NULL; k = next) {
+    next = k->next;
+    if(k->client == c) {
+      send_publish(c, k->topic_id, k->topic_type, k->payload, k->length);
+      list_remove(kept_list, k);
+      memb_free(&kept_memb, k);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct client *
+find_client(const uip_ipaddr_t *addr, uint16_t port)
+{
+  struct client *c;
+
+  for(c = list_head(clients); c != NULL; c = c->next) {
+    if(c->port == port && uip_ipaddr_cmp(&c->addr, addr)) {
+      return c;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct client *
+find_client_by_id(const uint8_t *id, uint8_t len)
+{
+  struct client *c;
+
+  for(c = list_head(clients); c != NULL; c = c->next) {
+    if(strlen(c->id) == len && memcmp(c->id, id, len) == 0) {
+      return c;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Drops the subscriptions and kept messages of a client */
+static void
+clean_client(struct client *c)
+{
+  struct subscription *s, *next_s;
+  struct kept *k, *next_k;
+
+  for(s = list_head(subscriptions); s != NULL; s = next_s) {
+    next_s = s->next;
+    if(s->client == c) {
+      list_remove(subscriptions, s);
+      memb_free(&subscriptions_memb, s);
+    }
+  }
+  for(k = list_head(kept_list); k != NULL; k = next_k) {
+    next_k = k->next;
+    if(k->client == c) {
+      list_remove(kept_list, k);
+      memb_free(&kept_memb, k);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_client(struct client *c)
+{
+  struct forward *f;
+
+  PRINTF("MQTT-SN GW - Removing client %s\n", c->id);
+
+  clean_client(c);
+  for(f = list_head(forwards); f != NULL; f = f->next) {
+    if(f->client == c) {
+      f->client = NULL;
+    }
+  }
+  list_remove(clients, c);
+  memb_free(&clients_memb, c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sweep(void *ptr)
+{
+  struct client *c, *next;
+  unsigned long now = clock_seconds();
+
+  /* A client is lost after 1.5 times its keep-alive or sleep duration */
+  for(c = list_head(clients); c != NULL; c = next) {
+    next = c->next;
+    if(now - c->last_heard > c->duration + c->duration / 2) {
+      remove_client(c);
+    }
+  }
+  ctimer_reset(&sweep_timer);
+}
+/*---------------------------------------------------------------------------*/
+static struct topic *
+find_topic(const char *name, uint8_t len)
+{
+  struct topic *t;
+
+  for(t = list_head(topics); t != NULL; t = t->next) {
+    if(strlen(t->name) == len && memcmp(t->name, name, len) == 0) {
+      return t;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct topic *
+find_topic_by_id(uint16_t id)
+{
+  struct topic *t;
+
+  for(t = list_head(topics); t != NULL; t = t->next) {
+    if(t->id == id) {
+      return t;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct topic *
+get_topic(const char *name, uint8_t len)
+{
+  struct topic *t;
+
+  if(len == 0 || len > MQTT_SN_GATEWAY_TOPIC_LENGTH) {
+    return NULL;
+  }
+  t = find_topic(name, len);
+  if(t != NULL) {
+    return t;
+  }
+
+  t = memb_alloc(&topics_memb);
+  if(t == NULL) {
+    PRINTF("MQTT-SN GW - No room for another topic\n");
+    return NULL;
+  }
+  do {
+    if(++last_topic_id == 0) {
+      last_topic_id = 1;
+    }
+  } while(find_topic_by_id(last_topic_id) != NULL);
+  t->id = last_topic_id;
+  t->state = TOPIC_UNSUBSCRIBED;
+  memcpy(t->name, name, len);
+  t->name[len] = '\0';
+  list_add(topics, t);
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+subscription_topic_id(struct subscription *s)
+{
+  if(s->short_name) {
+    return MQTT_SN_SHORT_TOPIC(s->topic->name[0], s->topic->name[1]);
+  }
+  return s->topic->id;
+}
+/*---------------------------------------------------------------------------*/
+/* Subscribes with the broker, one topic at a time */
+static void
+subscribe_next(void)
+{
+  struct topic *t;
+
+  if(subscribing != NULL || !mqtt_connected(broker)) {
+    return;
+  }
+  for(t = list_head(topics); t != NULL; t = t->next) {
+    if(t->state == TOPIC_PENDING) {
+      if(mqtt_subscribe(broker, NULL, t->name, MQTT_QOS_LEVEL_0) ==
+         MQTT_STATUS_OK) {
+        PRINTF("MQTT-SN GW - Subscribing to %s\n", t->name);
+        t->state = TOPIC_SUBSCRIBING;
+        subscribing = t;
+      }
+      /* Otherwise tried again on the next SUBSCRIBE */
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+subscribed(struct topic *t)
+{
+  struct subscription *s;
+
+  t->state = TOPIC_SUBSCRIBED;
+  for(s = list_head(subscriptions); s != NULL; s = s->next) {
+    if(s->topic == t && s->msg_id != 0) {
+      send_suback(s->client, subscription_topic_id(s), s->msg_id,
+                  MQTT_SN_RC_ACCEPTED);
+      s->msg_id = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+in_window(struct forward *f)
+{
+  int i;
+
+  for(i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    if(broker->inflight[i].state != MQTT_INFLIGHT_FREE &&
+       broker->inflight[i].payload == f->payload) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Frees the QoS 0 messages the MQTT engine has written */
+static void
+free_forwards(void)
+{
+  struct forward *f, *next;
+
+  for(f = list_head(forwards); f != NULL; f = next) {
+    next = f->next;
+    if(f->qos == 0 && !in_window(f)) {
+      list_remove(forwards, f);
+      memb_free(&forwards_memb, f);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_connect(struct client *c, const uip_ipaddr_t *addr, uint16_t port,
+               const uint8_t *msg, uint8_t len)
+{
+  uint8_t id_len;
+
+  if(len < 6) {
+    return;
+  }
+  id_len = len - 6;
+  if(id_len == 0 || id_len > MQTT_SN_CLIENT_ID_MAX_LEN) {
+    return;
+  }
+  if(msg[2] & MQTT_SN_FLAG_WILL) {
+    send_connack(addr, port, MQTT_SN_RC_NOT_SUPPORTED);
+    return;
+  }
+
+  /* A client may come back from a new address */
+  if(c == NULL) {
+    c = find_client_by_id(&msg[6], id_len);
+  }
+  if(c == NULL) {
+    c = memb_alloc(&clients_memb);
+    if(c == NULL) {
+      PRINTF("MQTT-SN GW - No room for another client\n");
+      send_connack(addr, port, MQTT_SN_RC_CONGESTION);
+      return;
+    }
+    memset(c, 0, sizeof(struct client));
+    list_add(clients, c);
+  }
+
+  uip_ipaddr_copy(&c->addr, addr);
+  c->port = port;
+  memcpy(c->id, &msg[6], id_len);
+  c->id[id_len] = '\0';
+  c->state = CLIENT_ACTIVE;
+  c->duration = read_uint16(&msg[4]);
+  c->last_heard = clock_seconds();
+  if(msg[2] & MQTT_SN_FLAG_CLEAN) {
+    clean_client(c);
+  }
+
+  PRINTF("MQTT-SN GW - Client %s connected\n", c->id);
+
+  send_connack(addr, port, MQTT_SN_RC_ACCEPTED);
+  send_kept(c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_register(struct client *c, const uint8_t *msg, uint8_t len)
+{
+  struct topic *t;
+
+  if(len < 7) {
+    return;
+  }
+  t = get_topic((const char *)&msg[6], len - 6);
+  send_ack(c, MQTT_SN_MSG_REGACK, t != NULL ? t->id : 0, read_uint16(&msg[4]),
+           t != NULL ? MQTT_SN_RC_ACCEPTED : MQTT_SN_RC_CONGESTION);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_publish(struct client *c, const uint8_t *msg, uint8_t len)
+{
+  struct topic *t = NULL;
+  struct forward *f;
+  uint16_t topic_id;
+  uint16_t msg_id;
+  uint8_t qos;
+  char name[2];
+
+  if(len < 7) {
+    return;
+  }
+  topic_id = read_uint16(&msg[3]);
+  msg_id = read_uint16(&msg[5]);
+  qos = (msg[2] & MQTT_SN_FLAG_QOS_MASK) ? 1 : 0;
+
+  if((msg[2] & MQTT_SN_FLAG_TOPIC_MASK) == MQTT_SN_TOPIC_NORMAL) {
+    t = find_topic_by_id(topic_id);
+  } else if((msg[2] & MQTT_SN_FLAG_TOPIC_MASK) == MQTT_SN_TOPIC_SHORT) {
+    name[0] = topic_id >> 8;
+    name[1] = topic_id & 0xff;
+    t = get_topic(name, 2);
+  }
+  if(t == NULL) {
+    send_ack(c, MQTT_SN_MSG_PUBACK, topic_id, msg_id,
+             MQTT_SN_RC_INVALID_TOPIC);
+    return;
+  }
+
+  if(qos > 0 && (msg[2] & MQTT_SN_FLAG_DUP)) {
+    /* A retransmission of a message still being forwarded */
+    for(f = list_head(forwards); f != NULL; f = f->next) {
+      if(f->client == c && f->qos > 0 && f->msg_id == msg_id) {
+        return;
+      }
+    }
+  }
+
+  free_forwards();
+  f = memb_alloc(&forwards_memb);
+  if(f == NULL) {
+    send_ack(c, MQTT_SN_MSG_PUBACK, topic_id, msg_id, MQTT_SN_RC_CONGESTION);
+    return;
+  }
+  f->client = c;
+  f->msg_id = msg_id;
+  f->topic_id = topic_id;
+  f->qos = qos;
+  memcpy(f->payload, &msg[7], len - 7);
+
+  if(mqtt_publish(broker, &f->mid, t->name, f->payload, len - 7,
+                  qos, (msg[2] & MQTT_SN_FLAG_RETAIN) ?
+                  MQTT_RETAIN_ON : MQTT_RETAIN_OFF) != MQTT_STATUS_OK) {
+    memb_free(&forwards_memb, f);
+    send_ack(c, MQTT_SN_MSG_PUBACK, topic_id, msg_id, MQTT_SN_RC_CONGESTION);
+    return;
+  }
+  /* A QoS 1 message is acknowledged once the broker has it */
+  list_add(forwards, f);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_subscribe(struct client *c, const uint8_t *msg, uint8_t len)
+{
+  struct subscription *s;
+  struct topic *t;
+  uint16_t msg_id;
+  const char *name;
+  uint8_t name_len;
+
+  if(len < 6) {
+    return;
+  }
+  msg_id = read_uint16(&msg[3]);
+  name = (const char *)&msg[5];
+  name_len = len - 5;
+
+  if((msg[2] & MQTT_SN_FLAG_TOPIC_MASK) == MQTT_SN_TOPIC_PREDEFINED ||
+     ((msg[2] & MQTT_SN_FLAG_TOPIC_MASK) == MQTT_SN_TOPIC_SHORT &&
+      name_len != 2)) {
+    send_suback(c, 0, msg_id, MQTT_SN_RC_INVALID_TOPIC);
+    return;
+  }
+  if(memchr(name, '#', name_len) != NULL ||
+     memchr(name, '+', name_len) != NULL) {
+    send_suback(c, 0, msg_id, MQTT_SN_RC_NOT_SUPPORTED);
+    return;
+  }
+
+  t = get_topic(name, name_len);
+  if(t == NULL) {
+    send_suback(c, 0, msg_id, MQTT_SN_RC_CONGESTION);
+    return;
+  }
+
+  for(s = list_head(subscriptions); s != NULL; s = s->next) {
+    if(s->client == c && s->topic == t) {
+      break;
+    }
+  }
+  if(s == NULL) {
+    s = memb_alloc(&subscriptions_memb);
+    if(s == NULL) {
+      send_suback(c, 0, msg_id, MQTT_SN_RC_CONGESTION);
+      return;
+    }
+    s->client = c;
+    s->topic = t;
+    list_add(subscriptions, s);
+  }
+  s->short_name = (msg[2] & MQTT_SN_FLAG_TOPIC_MASK) == MQTT_SN_TOPIC_SHORT;
+
+  if(t->state == TOPIC_SUBSCRIBED) {
+    s->msg_id = 0;
+    send_suback(c, subscription_topic_id(s), msg_id, MQTT_SN_RC_ACCEPTED);
+    return;
+  }
+  s->msg_id = msg_id;
+  if(t->state == TOPIC_UNSUBSCRIBED) {
+    t->state = TOPIC_PENDING;
+  }
+  subscribe_next();
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_unsubscribe(struct client *c, const uint8_t *msg, uint8_t len)
+{
+  struct subscription *s;
+  struct topic *t;
+  uint8_t ack[4];
+
+  if(len < 6) {
+    return;
+  }
+
+  /* The subscription with the broker stays, for the next subscriber */
+  t = find_topic((const char *)&msg[5], len - 5);
+  for(s = list_head(subscriptions); s != NULL; s = s->next) {
+    if(s->client == c && s->topic == t) {
+      list_remove(subscriptions, s);
+      memb_free(&subscriptions_memb, s);
+      break;
+    }
+  }
+
+  ack[0] = sizeof(ack);
+  ack[1] = MQTT_SN_MSG_UNSUBACK;
+  ack[2] = msg[3];
+  ack[3] = msg[4];
+  send_to(c, ack);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_pingreq(struct client *c, const uint8_t *msg, uint8_t len)
+{
+  if(len > 2) {
+    /* A sleeping client woke up for its messages */
+    c = find_client_by_id(&msg[2], len - 2);
+    if(c == NULL || c->state != CLIENT_ASLEEP) {
+      return;
+    }
+    c->last_heard = clock_seconds();
+    send_kept(c);
+  } else if(c == NULL) {
+    return;
+  }
+  send_simple(c, MQTT_SN_MSG_PINGRESP);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_disconnect(struct client *c, const uint8_t *msg, uint8_t len)
+{
+  send_simple(c, MQTT_SN_MSG_DISCONNECT);
+  if(len >= 4) {
+    PRINTF("MQTT-SN GW - Client %s asleep\n", c->id);
+    c->state = CLIENT_ASLEEP;
+    c->duration = read_uint16(&msg[2]);
+  } else {
+    remove_client(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+receive_callback(struct simple_udp_connection *conn,
+                 const uip_ipaddr_t *sender_addr,
+                 uint16_t sender_port,
+                 const uip_ipaddr_t *receiver_addr,
+                 uint16_t receiver_port,
+                 const uint8_t *data,
+                 uint16_t datalen)
+{
+  struct client *c;
+  uint8_t len;
+
+  /* Messages longer than MQTT_SN_MAX_PACKET_SIZE are not accepted, so the
+   * 3-byte length field is not either */
+  if(datalen < 2 || data[0] < 2 || data[0] > datalen ||
+     data[0] > MQTT_SN_MAX_PACKET_SIZE) {
+    return;
+  }
+  len = data[0];
+
+  c = find_client(sender_addr, sender_port);
+  if(c != NULL) {
+    c->last_heard = clock_seconds();
+  }
+
+  PRINTF("MQTT-SN GW - Got message type 0x%02x, %u bytes\n", data[1], len);
+
+  if(data[1] == MQTT_SN_MSG_CONNECT) {
+    handle_connect(c, sender_addr, sender_port, data, len);
+  } else if(data[1] == MQTT_SN_MSG_PINGREQ) {
+    handle_pingreq(c, data, len);
+  } else if(c == NULL) {
+    PRINTF("MQTT-SN GW - Message from an unknown client\n");
+  } else if(data[1] == MQTT_SN_MSG_DISCONNECT) {
+    handle_disconnect(c, data, len);
+  } else if(c->state != CLIENT_ACTIVE) {
+    return;
+  } else if(data[1] == MQTT_SN_MSG_REGISTER) {
+    handle_register(c, data, len);
+  } else if(data[1] == MQTT_SN_MSG_PUBLISH) {
+    handle_publish(c, data, len);
+  } else if(data[1] == MQTT_SN_MSG_SUBSCRIBE) {
+    handle_subscribe(c, data, len);
+  } else if(data[1] == MQTT_SN_MSG_UNSUBSCRIBE) {
+    handle_unsubscribe(c, data, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+deliver(struct mqtt_message *m)
+{
+  struct subscription *s;
+  struct topic *t;
+  struct kept *k;
+  uint8_t topic_type;
+
+  /* Only messages that fit a MQTT-SN message are delivered */
+  if(!m->first_chunk || m->payload_left > 0 ||
+     m->payload_chunk_length > MAX_PAYLOAD) {
+    PRINTF("MQTT-SN GW - Message on %s too long\n", m->topic);
+    return;
+  }
+  t = find_topic(m->topic, strlen(m->topic));
+  if(t == NULL) {
+    return;
+  }
+
+  for(s = list_head(subscriptions); s != NULL; s = s->next) {
+    if(s->topic != t) {
+      continue;
+    }
+    topic_type = s->short_name ? MQTT_SN_TOPIC_SHORT : MQTT_SN_TOPIC_NORMAL;
+    if(s->client->state == CLIENT_ACTIVE) {
+      send_publish(s->client, subscription_topic_id(s), topic_type,
+                   m->payload_chunk, m->payload_chunk_length);
+      continue;
+    }
+    k = memb_alloc(&kept_memb);
+    if(k == NULL) {
+      PRINTF("MQTT-SN GW - No room to keep a message for %s\n",
+             s->client->id);
+      continue;
+    }
+    k->client = s->client;
+    k->topic_id = subscription_topic_id(s);
+    k->topic_type = topic_type;
+    k->length = m->payload_chunk_length;
+    memcpy(k->payload, m->payload_chunk, k->length);
+    list_add(kept_list, k);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+puback(uint16_t mid)
+{
+  struct forward *f;
+
+  for(f = list_head(forwards); f != NULL; f = f->next) {
+    if(f->qos > 0 && f->mid == mid) {
+      if(f->client != NULL) {
+        send_ack(f->client, MQTT_SN_MSG_PUBACK, f->topic_id, f->msg_id,
+                 MQTT_SN_RC_ACCEPTED);
+      }
+      list_remove(forwards, f);
+      memb_free(&forwards_memb, f);
+      break;
+    }
+  }
+  free_forwards();
+}
+/*---------------------------------------------------------------------------*/
+void
+mqtt_sn_gateway_mqtt_event(struct mqtt_connection *m, mqtt_event_t event,
+                           void *data)
+{
+  struct topic *t;
+
+  switch(event) {
+  case MQTT_EVENT_CONNECTED:
+  case MQTT_EVENT_DISCONNECTED:
+    /* The subscriptions are made again with the next connection */
+    subscribing = NULL;
+    for(t = list_head(topics); t != NULL; t = t->next) {
+      if(t->state != TOPIC_UNSUBSCRIBED) {
+        t->state = TOPIC_PENDING;
+      }
+    }
+    subscribe_next();
+    break;
+  case MQTT_EVENT_SUBACK:
+    if(subscribing != NULL) {
+      subscribed(subscribing);
+      subscribing = NULL;
+      subscribe_next();
+    }
+    break;
+  case MQTT_EVENT_PUBLISH:
+    deliver(data);
+    break;
+  case MQTT_EVENT_PUBACK:
+    puback(*(uint16_t *)data);
+    break;
+  default:
+    PRINTF("MQTT-SN GW - MQTT event %u\n", event);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+mqtt_sn_gateway_init(struct mqtt_connection *m)
+{
+  broker = m;
+  subscribing = NULL;
+  memb_init(&clients_memb);
+  memb_init(&topics_memb);
+  memb_init(&subscriptions_memb);
+  memb_init(&forwards_memb);
+  memb_init(&kept_memb);
+  list_init(clients);
+  list_init(topics);
+  list_init(subscriptions);
+  list_init(forwards);
+  list_init(kept_list);
+
+  simple_udp_register(&udp, MQTT_SN_PORT, NULL, 0, receive_callback);
+  ctimer_set(&sweep_timer, SWEEP_INTERVAL, sweep, NULL);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2016, Texas Instruments Incorporated - http://www.ti.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup mqtt-sn
+ * @{
+ *
+ * \defgroup mqtt-sn-gateway An aggregating MQTT-SN gateway
+ * @{
+ *
+ * The gateway serves the MQTT-SN clients of the network over UDP and
+ * forwards their publications and subscriptions to a MQTT broker over one
+ * MQTT connection of the MQTT engine, so that there is a single TCP
+ * connection and keep-alive for all clients. It is meant for the border
+ * router or for native.
+ *
+ * The application registers and connects the MQTT connection itself,
+ * with mqtt_sn_gateway_mqtt_event() as its event callback, and hands it
+ * to mqtt_sn_gateway_init(). The MQTT engine must be built with an
+ * in-flight window (MQTT_CONF_MAX_INFLIGHT), which the gateway uses to
+ * forward the messages of several clients at a time.
+ *
+ * Topic IDs are assigned by the gateway and are the same for all clients.
+ * The messages of the subscriptions of sleeping clients are kept until
+ * they wake. Wildcard subscriptions, predefined topic IDs and wills are
+ * not supported; messages are delivered to the clients with QoS 0.
+ */
+/**
+ * \file
+ *    Header file for the MQTT-SN gateway
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef MQTT_SN_GATEWAY_H_
+#define MQTT_SN_GATEWAY_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "mqtt.h"
+#include "mqtt-sn.h"
+/*---------------------------------------------------------------------------*/
+/* Number of clients, connected or asleep */
+#ifdef MQTT_SN_GATEWAY_CONF_MAX_CLIENTS
+#define MQTT_SN_GATEWAY_MAX_CLIENTS MQTT_SN_GATEWAY_CONF_MAX_CLIENTS
+#else
+#define MQTT_SN_GATEWAY_MAX_CLIENTS 8
+#endif
+
+/* Number of topic names, registered or subscribed to */
+#ifdef MQTT_SN_GATEWAY_CONF_MAX_TOPICS
+#define MQTT_SN_GATEWAY_MAX_TOPICS MQTT_SN_GATEWAY_CONF_MAX_TOPICS
+#else
+#define MQTT_SN_GATEWAY_MAX_TOPICS 16
+#endif
+
+#ifdef MQTT_SN_GATEWAY_CONF_TOPIC_LENGTH
+#define MQTT_SN_GATEWAY_TOPIC_LENGTH MQTT_SN_GATEWAY_CONF_TOPIC_LENGTH
+#else
+#define MQTT_SN_GATEWAY_TOPIC_LENGTH 32
+#endif
+
+/* Number of subscriptions of all clients */
+#ifdef MQTT_SN_GATEWAY_CONF_MAX_SUBSCRIPTIONS
+#define MQTT_SN_GATEWAY_MAX_SUBSCRIPTIONS MQTT_SN_GATEWAY_CONF_MAX_SUBSCRIPTIONS
+#else
+#define MQTT_SN_GATEWAY_MAX_SUBSCRIPTIONS 16
+#endif
+
+/* Number of messages of the clients being forwarded to the broker */
+#ifdef MQTT_SN_GATEWAY_CONF_MAX_FORWARDS
+#define MQTT_SN_GATEWAY_MAX_FORWARDS MQTT_SN_GATEWAY_CONF_MAX_FORWARDS
+#else
+#define MQTT_SN_GATEWAY_MAX_FORWARDS MQTT_MAX_INFLIGHT
+#endif
+
+/* Number of messages kept for sleeping clients */
+#ifdef MQTT_SN_GATEWAY_CONF_MAX_KEPT
+#define MQTT_SN_GATEWAY_MAX_KEPT MQTT_SN_GATEWAY_CONF_MAX_KEPT
+#else
+#define MQTT_SN_GATEWAY_MAX_KEPT 8
+#endif
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Starts the gateway.
+ * \param broker The MQTT connection to the broker, registered with
+ *        mqtt_sn_gateway_mqtt_event() as event callback.
+ */
+void mqtt_sn_gateway_init(struct mqtt_connection *broker);
+
+/**
+ * \brief The event callback of the MQTT connection to the broker.
+ */
+void mqtt_sn_gateway_mqtt_event(struct mqtt_connection *m,
+                                mqtt_event_t event, void *data);
+/*---------------------------------------------------------------------------*/
+#endif /* MQTT_SN_GATEWAY_H_ */
+/*---------------------------------------------------------------------------*/
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,554 @@
+/*
+ * Copyright (c) 2016, Texas Instruments Incorporated - http://www.ti.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup mqtt-sn
+ * @{
+ */
+/**
+ * \file
+ *    Implementation of the MQTT-SN client
+ */
+/*---------------------------------------------------------------------------*/
+#include "mqtt-sn.h"
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/simple-udp.h"
+#include "sys/ctimer.h"
+
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+/*---------------------------------------------------------------------------*/
+/* The client of a UDP connection */
+#define CONN(c) ((struct mqtt_sn_connection *)(c))
+
+static void keep_alive_callback(void *ptr);
+/*---------------------------------------------------------------------------*/
+static void
+call_event(struct mqtt_sn_connection *conn, mqtt_sn_event_t event, void *data)
+{
+  conn->event_callback(conn, event, data);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+next_msg_id(struct mqtt_sn_connection *conn)
+{
+  if(++conn->msg_id == 0) {
+    conn->msg_id = 1;
+  }
+  return conn->msg_id;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_message(struct mqtt_sn_connection *conn, const uint8_t *msg, uint8_t len)
+{
+  PRINTF("MQTT-SN - Sending message type 0x%02x, %u bytes\n", msg[1], len);
+
+  simple_udp_sendto(&conn->udp, msg, len, &conn->gateway);
+
+  /* Any message sent keeps the connection alive */
+  if(conn->state == MQTT_SN_STATE_ACTIVE) {
+    ctimer_set(&conn->keep_alive_timer, conn->keep_alive * CLOCK_SECOND,
+               keep_alive_callback, conn);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+retry_callback(void *ptr)
+{
+  struct mqtt_sn_connection *conn = ptr;
+
+  if(conn->out_reply == 0) {
+    return;
+  }
+
+  if(++conn->retries > MQTT_SN_MAX_RETRIES) {
+    PRINTF("MQTT-SN - No reply from the gateway\n");
+    conn->out_reply = 0;
+    conn->state = MQTT_SN_STATE_DISCONNECTED;
+    ctimer_stop(&conn->keep_alive_timer);
+    call_event(conn, MQTT_SN_EVENT_TIMEOUT_ERROR, NULL);
+    return;
+  }
+
+  if(conn->out_buffer[1] == MQTT_SN_MSG_PUBLISH ||
+     conn->out_buffer[1] == MQTT_SN_MSG_SUBSCRIBE) {
+    conn->out_buffer[2] |= MQTT_SN_FLAG_DUP;
+  }
+  send_message(conn, conn->out_buffer, conn->out_length);
+  ctimer_reset(&conn->retry_timer);
+}
+/*---------------------------------------------------------------------------*/
+/* Sends the request in out_buffer and retransmits it until the reply */
+static void
+send_request(struct mqtt_sn_connection *conn, uint8_t reply, uint16_t msg_id)
+{
+  conn->out_length = conn->out_buffer[0];
+  conn->out_reply = reply;
+  conn->out_msg_id = msg_id;
+  conn->retries = 0;
+  send_message(conn, conn->out_buffer, conn->out_length);
+  ctimer_set(&conn->retry_timer, MQTT_SN_RETRY_INTERVAL,
+             retry_callback, conn);
+}
+/*---------------------------------------------------------------------------*/
+/* Ends the request that the message of type reply answers, if any */
+static int
+reply_received(struct mqtt_sn_connection *conn, uint8_t reply,
+               uint16_t msg_id)
+{
+  if(conn->out_reply != reply || conn->out_msg_id != msg_id) {
+    return 0;
+  }
+  conn->out_reply = 0;
+  ctimer_stop(&conn->retry_timer);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+keep_alive_callback(void *ptr)
+{
+  struct mqtt_sn_connection *conn = ptr;
+
+  if(conn->state != MQTT_SN_STATE_ACTIVE) {
+    return;
+  }
+  if(conn->out_reply != 0) {
+    /* The request keeps the connection alive */
+    ctimer_reset(&conn->keep_alive_timer);
+    return;
+  }
+
+  PRINTF("MQTT-SN - Sending PINGREQ\n");
+  conn->out_buffer[0] = 2;
+  conn->out_buffer[1] = MQTT_SN_MSG_PINGREQ;
+  send_request(conn, MQTT_SN_MSG_PINGRESP, 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_uint16(uint8_t *p, uint16_t value)
+{
+  p[0] = value >> 8;
+  p[1] = value & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+read_uint16(const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_publish(struct mqtt_sn_connection *conn, const uint8_t *msg,
+               uint16_t len)
+{
+  struct mqtt_sn_message message;
+  uint8_t ack[7];
+
+  if(len < 7) {
+    return;
+  }
+  message.topic_type = msg[2] & MQTT_SN_FLAG_TOPIC_MASK;
+  message.topic_id = read_uint16(&msg[3]);
+  message.payload = &msg[7];
+  message.payload_length = len - 7;
+
+  if(msg[2] & MQTT_SN_FLAG_QOS_1) {
+    ack[0] = sizeof(ack);
+    ack[1] = MQTT_SN_MSG_PUBACK;
+    write_uint16(&ack[2], message.topic_id);
+    ack[4] = msg[5];
+    ack[5] = msg[6];
+    ack[6] = MQTT_SN_RC_ACCEPTED;
+    send_message(conn, ack, sizeof(ack));
+  }
+
+  call_event(conn, MQTT_SN_EVENT_PUBLISH, &message);
+}
+/*---------------------------------------------------------------------------*/
+static void
+receive_callback(struct simple_udp_connection *c,
+                 const uip_ipaddr_t *sender_addr,
+                 uint16_t sender_port,
+                 const uip_ipaddr_t *receiver_addr,
+                 uint16_t receiver_port,
+                 const uint8_t *data,
+                 uint16_t datalen)
+{
+  struct mqtt_sn_connection *conn = CONN(c);
+  struct mqtt_sn_ack_event ack;
+  uint16_t len;
+
+  if(!uip_ipaddr_cmp(sender_addr, &conn->gateway) ||
+     conn->state == MQTT_SN_STATE_DISCONNECTED) {
+    return;
+  }
+
+  /* A 3-byte length field starts with 0x01 */
+  if(datalen >= 4 && data[0] == 0x01) {
+    len = read_uint16(&data[1]) - 2;
+    data += 2;
+  } else if(datalen >= 2) {
+    len = data[0];
+  } else {
+    return;
+  }
+  if(len < 2 || len > datalen) {
+    return;
+  }
+
+  PRINTF("MQTT-SN - Got message type 0x%02x, %u bytes\n", data[1], len);
+
+  switch(data[1]) {
+  case MQTT_SN_MSG_CONNACK:
+    if(len < 3 || !reply_received(conn, MQTT_SN_MSG_CONNACK, 0)) {
+      break;
+    }
+    if(data[2] != MQTT_SN_RC_ACCEPTED) {
+      conn->state = MQTT_SN_STATE_DISCONNECTED;
+      call_event(conn, MQTT_SN_EVENT_CONNECTION_REFUSED_ERROR, NULL);
+      break;
+    }
+    conn->state = MQTT_SN_STATE_ACTIVE;
+    ctimer_set(&conn->keep_alive_timer, conn->keep_alive * CLOCK_SECOND,
+               keep_alive_callback, conn);
+    call_event(conn, MQTT_SN_EVENT_CONNECTED, NULL);
+    break;
+
+  case MQTT_SN_MSG_REGACK:
+  case MQTT_SN_MSG_PUBACK:
+    if(len < 7) {
+      break;
+    }
+    ack.topic_id = read_uint16(&data[2]);
+    ack.msg_id = read_uint16(&data[4]);
+    ack.return_code = data[6];
+    if(data[1] == MQTT_SN_MSG_REGACK) {
+      if(reply_received(conn, MQTT_SN_MSG_REGACK, ack.msg_id)) {
+        call_event(conn, MQTT_SN_EVENT_REGACK, &ack);
+      }
+    } else if(reply_received(conn, MQTT_SN_MSG_PUBACK, ack.msg_id) ||
+              ack.return_code != MQTT_SN_RC_ACCEPTED) {
+      /* A rejected QoS 0 message is reported as well */
+      call_event(conn, MQTT_SN_EVENT_PUBACK, &ack);
+    }
+    break;
+
+  case MQTT_SN_MSG_SUBACK:
+    if(len < 8) {
+      break;
+    }
+    ack.topic_id = read_uint16(&data[3]);
+    ack.msg_id = read_uint16(&data[5]);
+    ack.return_code = data[7];
+    if(reply_received(conn, MQTT_SN_MSG_SUBACK, ack.msg_id)) {
+      call_event(conn, MQTT_SN_EVENT_SUBACK, &ack);
+    }
+    break;
+
+  case MQTT_SN_MSG_UNSUBACK:
+    if(len < 4) {
+      break;
+    }
+    ack.topic_id = 0;
+    ack.msg_id = read_uint16(&data[2]);
+    ack.return_code = MQTT_SN_RC_ACCEPTED;
+    if(reply_received(conn, MQTT_SN_MSG_UNSUBACK, ack.msg_id)) {
+      call_event(conn, MQTT_SN_EVENT_UNSUBACK, &ack);
+    }
+    break;
+
+  case MQTT_SN_MSG_PUBLISH:
+    if(conn->state == MQTT_SN_STATE_ACTIVE ||
+       conn->state == MQTT_SN_STATE_AWAKE) {
+      handle_publish(conn, data, len);
+    }
+    break;
+
+  case MQTT_SN_MSG_PINGRESP:
+    if(!reply_received(conn, MQTT_SN_MSG_PINGRESP, 0)) {
+      break;
+    }
+    if(conn->state == MQTT_SN_STATE_AWAKE) {
+      /* The gateway has sent all it kept */
+      conn->state = MQTT_SN_STATE_ASLEEP;
+      call_event(conn, MQTT_SN_EVENT_AWAKE_DONE, NULL);
+    }
+    break;
+
+  case MQTT_SN_MSG_DISCONNECT:
+    ctimer_stop(&conn->keep_alive_timer);
+    if(reply_received(conn, MQTT_SN_MSG_DISCONNECT, 0) &&
+       conn->out_length > 2) {
+      /* The DISCONNECT had a sleep duration */
+      conn->state = MQTT_SN_STATE_ASLEEP;
+      call_event(conn, MQTT_SN_EVENT_ASLEEP, NULL);
+      break;
+    }
+    conn->out_reply = 0;
+    ctimer_stop(&conn->retry_timer);
+    conn->state = MQTT_SN_STATE_DISCONNECTED;
+    call_event(conn, MQTT_SN_EVENT_DISCONNECTED, NULL);
+    break;
+
+  default:
+    PRINTF("MQTT-SN - Message type 0x%02x not handled\n", data[1]);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+mqtt_sn_status_t
+mqtt_sn_register(struct mqtt_sn_connection *conn, uint16_t local_port,
+                 const char *client_id, mqtt_sn_event_callback_t event_callback)
+{
+  if(client_id == NULL || strlen(client_id) > MQTT_SN_CLIENT_ID_MAX_LEN ||
+     event_callback == NULL) {
+    return MQTT_SN_STATUS_INVALID_ARGS_ERROR;
+  }
+
+  memset(conn, 0, sizeof(struct mqtt_sn_connection));
+  conn->client_id = client_id;
+  conn->event_callback = event_callback;
+  conn->state = MQTT_SN_STATE_DISCONNECTED;
+
+  simple_udp_register(&conn->udp, local_port, NULL, MQTT_SN_PORT,
+                      receive_callback);
+  return MQTT_SN_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+mqtt_sn_status_t
+mqtt_sn_connect(struct mqtt_sn_connection *conn, const uip_ipaddr_t *gateway,
+                uint16_t keep_alive)
+{
+  uint8_t id_len;
+
+  if(conn->state != MQTT_SN_STATE_DISCONNECTED &&
+     conn->state != MQTT_SN_STATE_ASLEEP) {
+    return MQTT_SN_STATUS_BUSY;
+  }
+  if(keep_alive == 0) {
+    return MQTT_SN_STATUS_INVALID_ARGS_ERROR;
+  }
+
+  uip_ipaddr_copy(&conn->gateway, gateway);
+  conn->keep_alive = keep_alive;
+  conn->state = MQTT_SN_STATE_CONNECTING;
+
+  id_len = strlen(conn->client_id);
+  conn->out_buffer[0] = 6 + id_len;
+  conn->out_buffer[1] = MQTT_SN_MSG_CONNECT;
+  conn->out_buffer[2] = MQTT_SN_FLAG_CLEAN;
+  conn->out_buffer[3] = MQTT_SN_PROTOCOL_ID;
+  write_uint16(&conn->out_buffer[4], keep_alive);
+  memcpy(&conn->out_buffer[6], conn->client_id, id_len);
+  send_request(conn, MQTT_SN_MSG_CONNACK, 0);
+
+  return MQTT_SN_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+static mqtt_sn_status_t
+disconnect(struct mqtt_sn_connection *conn, uint16_t duration)
+{
+  if(conn->state != MQTT_SN_STATE_ACTIVE) {
+    return MQTT_SN_STATUS_NOT_CONNECTED_ERROR;
+  }
+  if(conn->out_reply != 0) {
+    return MQTT_SN_STATUS_BUSY;
+  }
+
+  conn->state = MQTT_SN_STATE_DISCONNECTING;
+  ctimer_stop(&conn->keep_alive_timer);
+  conn->out_buffer[0] = 2;
+  conn->out_buffer[1] = MQTT_SN_MSG_DISCONNECT;
+  if(duration > 0) {
+    conn->out_buffer[0] = 4;
+    write_uint16(&conn->out_buffer[2], duration);
+  }
+  send_request(conn, MQTT_SN_MSG_DISCONNECT, 0);
+
+  return MQTT_SN_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+mqtt_sn_status_t
+mqtt_sn_disconnect(struct mqtt_sn_connection *conn)
+{
+  return disconnect(conn, 0);
+}
+/*---------------------------------------------------------------------------*/
+mqtt_sn_status_t
+mqtt_sn_sleep(struct mqtt_sn_connection *conn, uint16_t duration)
+{
+  if(duration == 0) {
+    return MQTT_SN_STATUS_INVALID_ARGS_ERROR;
+  }
+  return disconnect(conn, duration);
+}
+/*---------------------------------------------------------------------------*/
+mqtt_sn_status_t
+mqtt_sn_wake(struct mqtt_sn_connection *conn)
+{
+  uint8_t id_len;
+
+  if(conn->state != MQTT_SN_STATE_ASLEEP) {
+    return MQTT_SN_STATUS_NOT_CONNECTED_ERROR;
+  }
+
+  /* A PINGREQ with the client ID asks for the kept messages */
+  conn->state = MQTT_SN_STATE_AWAKE;
+  id_len = strlen(conn->client_id);
+  conn->out_buffer[0] = 2 + id_len;
+  conn->out_buffer[1] = MQTT_SN_MSG_PINGREQ;
+  memcpy(&conn->out_buffer[2], conn->client_id, id_len);
+  send_request(conn, MQTT_SN_MSG_PINGRESP, 0);
+
+  return MQTT_SN_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+static mqtt_sn_status_t
+topic_request(struct mqtt_sn_connection *conn, uint8_t type, uint8_t reply,
+              uint8_t flags, uint16_t *msg_id, const char *topic)
+{
+  size_t topic_len;
+  uint8_t *p;
+
+  if(conn->state != MQTT_SN_STATE_ACTIVE) {
+    return MQTT_SN_STATUS_NOT_CONNECTED_ERROR;
+  }
+  if(conn->out_reply != 0) {
+    return MQTT_SN_STATUS_BUSY;
+  }
+  topic_len = strlen(topic);
+  if(topic_len == 0 || topic_len > MQTT_SN_MAX_PACKET_SIZE - 7) {
+    return MQTT_SN_STATUS_INVALID_ARGS_ERROR;
+  }
+
+  p = &conn->out_buffer[1];
+  *p++ = type;
+  if(type == MQTT_SN_MSG_REGISTER) {
+    /* The topic ID is assigned by the gateway */
+    write_uint16(p, 0);
+    p += 2;
+  } else {
+    if(topic_len == 2) {
+      flags |= MQTT_SN_TOPIC_SHORT;
+    }
+    *p++ = flags;
+  }
+  write_uint16(p, next_msg_id(conn));
+  p += 2;
+  memcpy(p, topic, topic_len);
+  conn->out_buffer[0] = p + topic_len - conn->out_buffer;
+
+  if(msg_id != NULL) {
+    *msg_id = conn->msg_id;
+  }
+  send_request(conn, reply, conn->msg_id);
+
+  return MQTT_SN_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+mqtt_sn_status_t
+mqtt_sn_register_topic(struct mqtt_sn_connection *conn, uint16_t *msg_id,
+                       const char *topic)
+{
+  return topic_request(conn, MQTT_SN_MSG_REGISTER, MQTT_SN_MSG_REGACK,
+                       0, msg_id, topic);
+}
+/*---------------------------------------------------------------------------*/
+mqtt_sn_status_t
+mqtt_sn_subscribe(struct mqtt_sn_connection *conn, uint16_t *msg_id,
+                  const char *topic, uint8_t qos)
+{
+  return topic_request(conn, MQTT_SN_MSG_SUBSCRIBE, MQTT_SN_MSG_SUBACK,
+                       qos > 0 ? MQTT_SN_FLAG_QOS_1 : 0, msg_id, topic);
+}
+/*---------------------------------------------------------------------------*/
+mqtt_sn_status_t
+mqtt_sn_unsubscribe(struct mqtt_sn_connection *conn, uint16_t *msg_id,
+                    const char *topic)
+{
+  return topic_request(conn, MQTT_SN_MSG_UNSUBSCRIBE, MQTT_SN_MSG_UNSUBACK,
+                       0, msg_id, topic);
+}
+/*---------------------------------------------------------------------------*/
+mqtt_sn_status_t
+mqtt_sn_publish(struct mqtt_sn_connection *conn, uint16_t *msg_id,
+                uint16_t topic_id, mqtt_sn_topic_type_t topic_type,
+                const uint8_t *payload, uint16_t payload_length,
+                uint8_t qos, uint8_t retain)
+{
+  uint8_t msg[MQTT_SN_MAX_PACKET_SIZE];
+  uint8_t *p;
+
+  if(conn->state != MQTT_SN_STATE_ACTIVE) {
+    return MQTT_SN_STATUS_NOT_CONNECTED_ERROR;
+  }
+  if(payload_length > MQTT_SN_MAX_PACKET_SIZE - 7) {
+    return MQTT_SN_STATUS_INVALID_ARGS_ERROR;
+  }
+  if(qos > 0 && conn->out_reply != 0) {
+    return MQTT_SN_STATUS_BUSY;
+  }
+
+  /* A QoS 1 message is kept in out_buffer until its PUBACK */
+  p = qos > 0 ? conn->out_buffer : msg;
+  p[0] = 7 + payload_length;
+  p[1] = MQTT_SN_MSG_PUBLISH;
+  p[2] = topic_type;
+  if(qos > 0) {
+    p[2] |= MQTT_SN_FLAG_QOS_1;
+  }
+  if(retain) {
+    p[2] |= MQTT_SN_FLAG_RETAIN;
+  }
+  write_uint16(&p[3], topic_id);
+  write_uint16(&p[5], qos > 0 ? next_msg_id(conn) : 0);
+  memcpy(&p[7], payload, payload_length);
+
+  if(msg_id != NULL) {
+    *msg_id = read_uint16(&p[5]);
+  }
+  if(qos > 0) {
+    send_request(conn, MQTT_SN_MSG_PUBACK, conn->msg_id);
+  } else {
+    send_message(conn, msg, p[0]);
+  }
+
+  return MQTT_SN_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
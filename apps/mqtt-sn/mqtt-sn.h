@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2016, Texas Instruments Incorporated - http://www.ti.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup apps
+ * @{
+ *
+ * \defgroup mqtt-sn An MQTT-SN v1.2 client
+ * @{
+ *
+ * MQTT-SN is MQTT for sensor networks: the same publish/subscribe model
+ * over UDP, with 2-byte topic IDs in place of topic names and with
+ * sleeping clients, whose messages the gateway keeps while they sleep.
+ * A node needs no TCP connection and sends no keep-alive while asleep;
+ * a gateway (see mqtt-sn-gateway) forwards its messages to a MQTT broker
+ * over a single TCP connection shared by all clients.
+ *
+ * The client supports QoS levels 0 and 1, registered topics and short
+ * (2-character) topic names. It has one request awaiting a reply at a
+ * time, retransmitted every MQTT_SN_RETRY_INTERVAL.
+ */
+/**
+ * \file
+ *    Header file for the MQTT-SN client
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef MQTT_SN_H_
+#define MQTT_SN_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/simple-udp.h"
+#include "sys/ctimer.h"
+/*---------------------------------------------------------------------------*/
+/* UDP port of MQTT-SN gateways */
+#ifdef MQTT_SN_CONF_PORT
+#define MQTT_SN_PORT MQTT_SN_CONF_PORT
+#else
+#define MQTT_SN_PORT 1883
+#endif
+
+/* Largest message sent or received; keep it within one frame */
+#ifdef MQTT_SN_CONF_MAX_PACKET_SIZE
+#define MQTT_SN_MAX_PACKET_SIZE MQTT_SN_CONF_MAX_PACKET_SIZE
+#else
+#define MQTT_SN_MAX_PACKET_SIZE 64
+#endif
+
+/* Time before a request without reply is sent again (Tretry) */
+#ifdef MQTT_SN_CONF_RETRY_INTERVAL
+#define MQTT_SN_RETRY_INTERVAL MQTT_SN_CONF_RETRY_INTERVAL
+#else
+#define MQTT_SN_RETRY_INTERVAL (10 * CLOCK_SECOND)
+#endif
+
+/* Retransmissions of a request before the gateway is deemed lost (Nretry) */
+#ifdef MQTT_SN_CONF_MAX_RETRIES
+#define MQTT_SN_MAX_RETRIES MQTT_SN_CONF_MAX_RETRIES
+#else
+#define MQTT_SN_MAX_RETRIES 3
+#endif
+/*---------------------------------------------------------------------------*/
+/* Protocol constants, shared with the gateway */
+#define MQTT_SN_PROTOCOL_ID      0x01
+#define MQTT_SN_CLIENT_ID_MAX_LEN 23
+
+#define MQTT_SN_MSG_ADVERTISE    0x00
+#define MQTT_SN_MSG_SEARCHGW     0x01
+#define MQTT_SN_MSG_GWINFO       0x02
+#define MQTT_SN_MSG_CONNECT      0x04
+#define MQTT_SN_MSG_CONNACK      0x05
+#define MQTT_SN_MSG_REGISTER     0x0A
+#define MQTT_SN_MSG_REGACK       0x0B
+#define MQTT_SN_MSG_PUBLISH      0x0C
+#define MQTT_SN_MSG_PUBACK       0x0D
+#define MQTT_SN_MSG_SUBSCRIBE    0x12
+#define MQTT_SN_MSG_SUBACK       0x13
+#define MQTT_SN_MSG_UNSUBSCRIBE  0x14
+#define MQTT_SN_MSG_UNSUBACK     0x15
+#define MQTT_SN_MSG_PINGREQ      0x16
+#define MQTT_SN_MSG_PINGRESP     0x17
+#define MQTT_SN_MSG_DISCONNECT   0x18
+
+#define MQTT_SN_FLAG_DUP         0x80
+#define MQTT_SN_FLAG_QOS_1       0x20
+#define MQTT_SN_FLAG_QOS_MASK    0x60
+#define MQTT_SN_FLAG_RETAIN      0x10
+#define MQTT_SN_FLAG_WILL        0x08
+#define MQTT_SN_FLAG_CLEAN       0x04
+#define MQTT_SN_FLAG_TOPIC_MASK  0x03
+
+#define MQTT_SN_RC_ACCEPTED      0x00
+#define MQTT_SN_RC_CONGESTION    0x01
+#define MQTT_SN_RC_INVALID_TOPIC 0x02
+#define MQTT_SN_RC_NOT_SUPPORTED 0x03
+/*---------------------------------------------------------------------------*/
+typedef enum {
+  MQTT_SN_TOPIC_NORMAL,
+  MQTT_SN_TOPIC_PREDEFINED,
+  MQTT_SN_TOPIC_SHORT,
+} mqtt_sn_topic_type_t;
+
+/* Topic ID of a short topic name, e.g. MQTT_SN_SHORT_TOPIC('t', '1') */
+#define MQTT_SN_SHORT_TOPIC(a, b) ((uint16_t)(((uint8_t)(a) << 8) | (uint8_t)(b)))
+
+typedef enum {
+  MQTT_SN_EVENT_CONNECTED,
+  MQTT_SN_EVENT_DISCONNECTED,
+  MQTT_SN_EVENT_REGACK,
+  MQTT_SN_EVENT_SUBACK,
+  MQTT_SN_EVENT_UNSUBACK,
+  MQTT_SN_EVENT_PUBLISH,
+  MQTT_SN_EVENT_PUBACK,
+  /* Asleep after mqtt_sn_sleep() */
+  MQTT_SN_EVENT_ASLEEP,
+  /* The messages kept by the gateway have been received, back to sleep */
+  MQTT_SN_EVENT_AWAKE_DONE,
+
+  /* Errors */
+  MQTT_SN_EVENT_ERROR = 0x80,
+  /* No reply after MQTT_SN_MAX_RETRIES, the client is disconnected */
+  MQTT_SN_EVENT_TIMEOUT_ERROR,
+  MQTT_SN_EVENT_CONNECTION_REFUSED_ERROR,
+} mqtt_sn_event_t;
+
+typedef enum {
+  MQTT_SN_STATUS_OK,
+  MQTT_SN_STATUS_BUSY,
+
+  /* Errors */
+  MQTT_SN_STATUS_ERROR = 0x80,
+  MQTT_SN_STATUS_NOT_CONNECTED_ERROR,
+  MQTT_SN_STATUS_INVALID_ARGS_ERROR,
+} mqtt_sn_status_t;
+
+typedef enum {
+  MQTT_SN_STATE_DISCONNECTED,
+  MQTT_SN_STATE_CONNECTING,
+  MQTT_SN_STATE_ACTIVE,
+  MQTT_SN_STATE_DISCONNECTING,
+  MQTT_SN_STATE_ASLEEP,
+  MQTT_SN_STATE_AWAKE,
+} mqtt_sn_state_t;
+
+/* Data of MQTT_SN_EVENT_REGACK, MQTT_SN_EVENT_SUBACK and
+ * MQTT_SN_EVENT_PUBACK */
+struct mqtt_sn_ack_event {
+  uint16_t msg_id;
+  uint16_t topic_id;
+  uint8_t return_code;
+};
+
+/* Data of MQTT_SN_EVENT_PUBLISH */
+struct mqtt_sn_message {
+  uint16_t topic_id;
+  mqtt_sn_topic_type_t topic_type;
+  const uint8_t *payload;
+  uint16_t payload_length;
+};
+
+struct mqtt_sn_connection;
+
+typedef void (*mqtt_sn_event_callback_t)(struct mqtt_sn_connection *conn,
+                                         mqtt_sn_event_t event,
+                                         void *data);
+
+struct mqtt_sn_connection {
+  struct simple_udp_connection udp;
+  uip_ipaddr_t gateway;
+  const char *client_id;
+  mqtt_sn_event_callback_t event_callback;
+  mqtt_sn_state_t state;
+  uint16_t keep_alive;
+  uint16_t msg_id;
+
+  /* The request awaiting a reply */
+  uint8_t out_buffer[MQTT_SN_MAX_PACKET_SIZE];
+  uint8_t out_length;
+  uint8_t out_reply;
+  uint16_t out_msg_id;
+  uint8_t retries;
+  struct ctimer retry_timer;
+
+  struct ctimer keep_alive_timer;
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Initializes a MQTT-SN client.
+ * \param conn A pointer to the connection.
+ * \param local_port The local UDP port.
+ * \param client_id The client ID, at most MQTT_SN_CLIENT_ID_MAX_LEN
+ *        characters. Must stay valid.
+ * \param event_callback Called on the events of the connection.
+ * \return MQTT_SN_STATUS_OK or MQTT_SN_STATUS_INVALID_ARGS_ERROR
+ */
+mqtt_sn_status_t mqtt_sn_register(struct mqtt_sn_connection *conn,
+                                  uint16_t local_port,
+                                  const char *client_id,
+                                  mqtt_sn_event_callback_t event_callback);
+
+/**
+ * \brief Connects to a MQTT-SN gateway.
+ * \param conn A pointer to the connection.
+ * \param gateway The address of the gateway, on port MQTT_SN_PORT.
+ * \param keep_alive Keep-alive interval in seconds while active.
+ * \return MQTT_SN_STATUS_OK or an error status
+ *
+ * MQTT_SN_EVENT_CONNECTED follows once the gateway has accepted.
+ */
+mqtt_sn_status_t mqtt_sn_connect(struct mqtt_sn_connection *conn,
+                                 const uip_ipaddr_t *gateway,
+                                 uint16_t keep_alive);
+
+/**
+ * \brief Disconnects from the gateway.
+ */
+mqtt_sn_status_t mqtt_sn_disconnect(struct mqtt_sn_connection *conn);
+
+/**
+ * \brief Registers a topic name, to get its topic ID.
+ * \param msg_id Set to the message ID of the request, or NULL.
+ *
+ * The topic ID comes with MQTT_SN_EVENT_REGACK.
+ */
+mqtt_sn_status_t mqtt_sn_register_topic(struct mqtt_sn_connection *conn,
+                                        uint16_t *msg_id,
+                                        const char *topic);
+
+/**
+ * \brief Subscribes to a topic name.
+ * \param msg_id Set to the message ID of the request, or NULL.
+ * \param topic The topic name. A 2-character name is subscribed to as a
+ *        short topic name.
+ * \param qos 0 or 1.
+ *
+ * The topic ID of the messages that will be received comes with
+ * MQTT_SN_EVENT_SUBACK.
+ */
+mqtt_sn_status_t mqtt_sn_subscribe(struct mqtt_sn_connection *conn,
+                                   uint16_t *msg_id,
+                                   const char *topic,
+                                   uint8_t qos);
+
+/**
+ * \brief Unsubscribes from a topic name.
+ */
+mqtt_sn_status_t mqtt_sn_unsubscribe(struct mqtt_sn_connection *conn,
+                                     uint16_t *msg_id,
+                                     const char *topic);
+
+/**
+ * \brief Publishes a message.
+ * \param msg_id Set to the message ID of the message, or NULL.
+ * \param topic_id A registered topic ID or a MQTT_SN_SHORT_TOPIC().
+ * \param topic_type The type of topic_id.
+ * \param qos 0 or 1. QoS 1 messages are confirmed with
+ *        MQTT_SN_EVENT_PUBACK.
+ * \return MQTT_SN_STATUS_OK, or MQTT_SN_STATUS_BUSY while a QoS 1 message
+ *         or another request awaits its reply.
+ */
+mqtt_sn_status_t mqtt_sn_publish(struct mqtt_sn_connection *conn,
+                                 uint16_t *msg_id,
+                                 uint16_t topic_id,
+                                 mqtt_sn_topic_type_t topic_type,
+                                 const uint8_t *payload,
+                                 uint16_t payload_length,
+                                 uint8_t qos,
+                                 uint8_t retain);
+
+/**
+ * \brief Goes to sleep.
+ * \param duration The longest time in seconds before the next
+ *        mqtt_sn_wake(), after which the gateway considers the client lost.
+ *
+ * While asleep the client sends nothing and the gateway keeps the messages
+ * of its subscriptions. MQTT_SN_EVENT_ASLEEP follows.
+ */
+mqtt_sn_status_t mqtt_sn_sleep(struct mqtt_sn_connection *conn,
+                               uint16_t duration);
+
+/**
+ * \brief Fetches the messages kept by the gateway during the sleep.
+ *
+ * The messages come as MQTT_SN_EVENT_PUBLISH, then
+ * MQTT_SN_EVENT_AWAKE_DONE tells that the client is asleep again.
+ * mqtt_sn_connect() makes it active again instead.
+ */
+mqtt_sn_status_t mqtt_sn_wake(struct mqtt_sn_connection *conn);
+
+#define mqtt_sn_connected(conn) \
+  ((conn)->state == MQTT_SN_STATE_ACTIVE)
+
+#define mqtt_sn_ready(conn) \
+  (mqtt_sn_connected(conn) && (conn)->out_reply == 0)
+/*---------------------------------------------------------------------------*/
+#endif /* MQTT_SN_H_ */
+/*---------------------------------------------------------------------------*/
+/**
+ * @}
+ * @}
+ */
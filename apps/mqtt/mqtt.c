@@ -127,6 +127,9 @@ typedef enum {
 /*---------------------------------------------------------------------------*/
 #define INCREMENT_MID(conn)   (conn)->mid_counter += 2
 #define MQTT_STRING_LENGTH(s) (((s)->length) == 0 ? 0 : (MQTT_STRING_LEN_SIZE + (s)->length))
+/* Bytes of a packet, with its fixed header */
+#define MQTT_PACKET_LENGTH(p) \
+  (MQTT_FHDR_SIZE + (p)->remaining_length_bytes + (p)->remaining_length)
 /*---------------------------------------------------------------------------*/
 /* Protothread send macros */
 #define PT_MQTT_WRITE_BYTES(conn, data, len)                                   \
@@ -203,7 +206,14 @@ call_event(struct mqtt_connection *conn,
 static void
 reset_defaults(struct mqtt_connection *conn)
 {
+#if MQTT_MAX_INFLIGHT > 0
+  /* The in-flight messages keep their IDs across reconnections */
+  if(conn->mid_counter == 0) {
+    conn->mid_counter = 1;
+  }
+#else
   conn->mid_counter = 1;
+#endif /* MQTT_MAX_INFLIGHT > 0 */
   PT_INIT(&conn->out_proto_thread);
   conn->waiting_for_pingresp = 0;
 
@@ -623,6 +633,101 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+#if MQTT_MAX_INFLIGHT > 0
+static struct mqtt_inflight *
+find_inflight(struct mqtt_connection *conn, mqtt_inflight_state_t state)
+{
+  struct mqtt_inflight *slot;
+  struct mqtt_inflight *oldest = NULL;
+
+  /* Message IDs grow with every message, so the oldest one is the furthest
+   * behind the counter */
+  for(slot = conn->inflight; slot < &conn->inflight[MQTT_MAX_INFLIGHT]; slot++) {
+    if(slot->state == state &&
+       (oldest == NULL ||
+        (uint16_t)(conn->mid_counter - slot->mid) >
+        (uint16_t)(conn->mid_counter - oldest->mid))) {
+      oldest = slot;
+    }
+  }
+  return oldest;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
+{
+  PT_BEGIN(pt);
+
+  /* Write all queued messages, in order, back to back in the out buffer, so
+   * that small ones share TCP segments, and do not wait for the PUBACKs */
+  while((conn->out_inflight = find_inflight(conn, MQTT_INFLIGHT_QUEUED))
+        != NULL) {
+    conn->out_packet.mid = conn->out_inflight->mid;
+    conn->out_packet.topic = conn->out_inflight->topic;
+    conn->out_packet.topic_length = strlen(conn->out_inflight->topic);
+    conn->out_packet.payload = conn->out_inflight->payload;
+    conn->out_packet.payload_size = conn->out_inflight->payload_size;
+    conn->out_packet.qos = conn->out_inflight->qos;
+    conn->out_packet.retain = conn->out_inflight->retain;
+
+    DBG("MQTT - Writing publish message %u, topic %s\n",
+        conn->out_packet.mid, conn->out_packet.topic);
+
+    conn->out_packet.fhdr = MQTT_FHDR_MSG_TYPE_PUBLISH |
+      conn->out_packet.qos << 1;
+    if(conn->out_packet.retain == MQTT_RETAIN_ON) {
+      conn->out_packet.fhdr |= MQTT_FHDR_RETAIN_FLAG;
+    }
+    if(conn->out_inflight->dup) {
+      conn->out_packet.fhdr |= MQTT_FHDR_DUP_FLAG;
+    }
+    conn->out_packet.remaining_length = MQTT_STRING_LEN_SIZE +
+      conn->out_packet.topic_length +
+      conn->out_packet.payload_size;
+    if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
+      conn->out_packet.remaining_length += MQTT_MID_SIZE;
+    }
+    encode_remaining_length(conn->out_packet.remaining_length_enc,
+                            &conn->out_packet.remaining_length_enc_bytes,
+                            conn->out_packet.remaining_length);
+    if(conn->out_packet.remaining_length_enc_bytes > 4) {
+      conn->out_inflight->state = MQTT_INFLIGHT_FREE;
+      call_event(conn, MQTT_EVENT_PROTOCOL_ERROR, NULL);
+      PRINTF("MQTT - Error, remaining length > 4 bytes\n");
+      continue;
+    }
+
+    PT_MQTT_WRITE_BYTE(conn, conn->out_packet.fhdr);
+    PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
+                        conn->out_packet.remaining_length_enc_bytes);
+    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
+    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length & 0x00FF));
+    PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.topic,
+                        conn->out_packet.topic_length);
+    if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
+      PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
+      PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
+    }
+    PT_MQTT_WRITE_BYTES(conn,
+                        conn->out_packet.payload,
+                        conn->out_packet.payload_size);
+
+    if(conn->out_packet.qos == MQTT_QOS_LEVEL_0) {
+      /* Nothing to wait for, the slot can take the next message */
+      conn->out_inflight->state = MQTT_INFLIGHT_FREE;
+      process_post(conn->app_process, mqtt_update_event, NULL);
+    } else {
+      conn->out_inflight->state = MQTT_INFLIGHT_SENT;
+    }
+  }
+
+  send_out_buffer(conn);
+
+  DBG("MQTT - Publish queue written\n");
+
+  PT_END(pt);
+}
+#else /* MQTT_MAX_INFLIGHT > 0 */
 static
 PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
 {
@@ -710,6 +815,7 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
 
   PT_END(pt);
 }
+#endif /* MQTT_MAX_INFLIGHT > 0 */
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(pingreq_pt(struct pt *pt, struct mqtt_connection *conn))
@@ -761,6 +867,26 @@ handle_connack(struct mqtt_connection *conn)
   /* Always reset packet before callback since it might be used directly */
   conn->state = MQTT_CONN_STATE_CONNECTED_TO_BROKER;
   call_event(conn, MQTT_EVENT_CONNECTED, NULL);
+
+#if MQTT_MAX_INFLIGHT > 0
+  {
+    struct mqtt_inflight *slot;
+    uint8_t queued = 0;
+
+    /* Messages not acknowledged on the previous connection are sent again */
+    for(slot = conn->inflight; slot < &conn->inflight[MQTT_MAX_INFLIGHT];
+        slot++) {
+      if(slot->state == MQTT_INFLIGHT_SENT) {
+        slot->state = MQTT_INFLIGHT_QUEUED;
+        slot->dup = 1;
+      }
+      queued |= slot->state == MQTT_INFLIGHT_QUEUED;
+    }
+    if(queued) {
+      process_post(&mqtt_process, mqtt_do_publish_event, conn);
+    }
+  }
+#endif /* MQTT_MAX_INFLIGHT > 0 */
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -824,6 +950,21 @@ handle_puback(struct mqtt_connection *conn)
   conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
     (conn->in_packet.payload[1]);
 
+#if MQTT_MAX_INFLIGHT > 0
+  {
+    struct mqtt_inflight *slot;
+
+    for(slot = conn->inflight; slot < &conn->inflight[MQTT_MAX_INFLIGHT];
+        slot++) {
+      if(slot->state == MQTT_INFLIGHT_SENT &&
+         slot->mid == conn->in_packet.mid) {
+        slot->state = MQTT_INFLIGHT_FREE;
+        break;
+      }
+    }
+  }
+#endif /* MQTT_MAX_INFLIGHT > 0 */
+
   call_event(conn, MQTT_EVENT_PUBACK, &conn->in_packet.mid);
 }
 /*---------------------------------------------------------------------------*/
@@ -844,16 +985,10 @@ handle_publish(struct mqtt_connection *conn)
   if(conn->in_publish_msg.first_chunk == 1) {
     conn->in_publish_msg.first_chunk = 0;
   }
+  conn->in_publish_msg.payload_offset +=
+    conn->in_publish_msg.payload_chunk_length;
 
-  /* If this is the last time handle_publish will be called, reset packet. */
-  if(conn->in_publish_msg.payload_left == 0) {
-
-    /* Check for QoS and initiate the reply, do not rely on the data in the
-     * in_packet being untouched. */
-
-    DBG("MQTT - (handle_publish) resetting packet.\n");
-    reset_packet(&conn->in_packet);
-  }
+  /* The packet is reset with the next input, once it is marked received */
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -864,31 +999,33 @@ parse_publish_vhdr(struct mqtt_connection *conn,
 {
   uint16_t copy_bytes;
 
-  /* Read out topic length */
-  if(conn->in_packet.topic_len_received == 0) {
-    conn->in_packet.topic_len = (input_data_ptr[(*pos)++] << 8);
-    conn->in_packet.byte_counter++;
+  /* Read out topic length, whose two bytes may come in two segments */
+  while(conn->in_packet.topic_len_received < MQTT_STRING_LEN_SIZE) {
     if(*pos >= input_data_len) {
       return;
     }
-    conn->in_packet.topic_len |= input_data_ptr[(*pos)++];
+    conn->in_packet.topic_len = (conn->in_packet.topic_len << 8) |
+      input_data_ptr[(*pos)++];
     conn->in_packet.byte_counter++;
-    conn->in_packet.topic_len_received = 1;
+    conn->in_packet.topic_len_received++;
 
     DBG("MQTT - Read PUBLISH topic len %i\n", conn->in_packet.topic_len);
-    /* WARNING: Check here if TOPIC fits in payload area, otherwise error */
   }
 
   /* Read out topic */
-  if(conn->in_packet.topic_len_received == 1 &&
+  if(conn->in_packet.topic_len_received == MQTT_STRING_LEN_SIZE &&
      conn->in_packet.topic_received == 0) {
     copy_bytes = MIN(conn->in_packet.topic_len - conn->in_packet.topic_pos,
                      input_data_len - *pos);
     DBG("MQTT - topic_pos: %i copy_bytes: %i", conn->in_packet.topic_pos,
         copy_bytes);
-    memcpy(&conn->in_publish_msg.topic[conn->in_packet.topic_pos],
-           &input_data_ptr[*pos],
-           copy_bytes);
+    /* Longer topics are truncated */
+    if(conn->in_packet.topic_pos < MQTT_MAX_TOPIC_LENGTH) {
+      memcpy(&conn->in_publish_msg.topic[conn->in_packet.topic_pos],
+             &input_data_ptr[*pos],
+             MIN(copy_bytes,
+                 MQTT_MAX_TOPIC_LENGTH - conn->in_packet.topic_pos));
+    }
     (*pos) += copy_bytes;
     conn->in_packet.byte_counter += copy_bytes;
     conn->in_packet.topic_pos += copy_bytes;
@@ -896,10 +1033,12 @@ parse_publish_vhdr(struct mqtt_connection *conn,
     if(conn->in_packet.topic_len - conn->in_packet.topic_pos == 0) {
       DBG("MQTT - Got topic '%s'", conn->in_publish_msg.topic);
       conn->in_packet.topic_received = 1;
-      conn->in_publish_msg.topic[conn->in_packet.topic_pos] = '\0';
+      conn->in_publish_msg.topic[MIN(conn->in_packet.topic_pos,
+                                     MQTT_MAX_TOPIC_LENGTH)] = '\0';
       conn->in_publish_msg.payload_length =
         conn->in_packet.remaining_length - conn->in_packet.topic_len - 2;
       conn->in_publish_msg.payload_left = conn->in_publish_msg.payload_length;
+      conn->in_publish_msg.payload_offset = 0;
     }
 
     /* Set this once per incomming publish message */
@@ -978,10 +1117,17 @@ tcp_input(struct tcp_socket *s,
 
     PRINTF("MQTT - Error, unsupported payload size for non-PUBLISH message\n");
 
-    conn->in_packet.byte_counter += input_data_len;
-    if(conn->in_packet.byte_counter >=
-       (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
-      conn->in_packet.packet_received = 1;
+    copy_bytes = MIN(input_data_len - pos,
+                     MQTT_PACKET_LENGTH(&conn->in_packet) -
+                     conn->in_packet.byte_counter);
+    conn->in_packet.byte_counter += copy_bytes;
+    pos += copy_bytes;
+    if(conn->in_packet.byte_counter < MQTT_PACKET_LENGTH(&conn->in_packet)) {
+      return 0;
+    }
+    conn->in_packet.packet_received = 1;
+    if(pos < input_data_len) {
+      return tcp_input(s, ptr, &input_data_ptr[pos], input_data_len - pos);
     }
     return 0;
   }
@@ -993,16 +1139,41 @@ tcp_input(struct tcp_socket *s,
    *       this loop.
    */
   while(conn->in_packet.byte_counter <
-        (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
+        MQTT_PACKET_LENGTH(&conn->in_packet)) {
 
     if((conn->in_packet.fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH &&
        conn->in_packet.topic_received == 0) {
       parse_publish_vhdr(conn, &pos, input_data_ptr, input_data_len);
     }
 
-    /* Read in as much as we can into the packet payload */
+#if MQTT_STREAM_PUBLISH
+    if((conn->in_packet.fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH) {
+      /* Hand the payload in this segment over as it is */
+      copy_bytes = MIN(input_data_len - pos,
+                       MQTT_PACKET_LENGTH(&conn->in_packet) -
+                       conn->in_packet.byte_counter);
+      if(conn->in_packet.topic_received && copy_bytes > 0) {
+        conn->in_publish_msg.payload_chunk = (uint8_t *)&input_data_ptr[pos];
+        conn->in_publish_msg.payload_chunk_length = copy_bytes;
+        conn->in_publish_msg.payload_left -= copy_bytes;
+        handle_publish(conn);
+      }
+      conn->in_packet.byte_counter += copy_bytes;
+      pos += copy_bytes;
+
+      if(pos >= input_data_len &&
+         (conn->in_packet.byte_counter < MQTT_PACKET_LENGTH(&conn->in_packet))) {
+        return 0;
+      }
+      continue;
+    }
+#endif /* MQTT_STREAM_PUBLISH */
+
+    /* Read in as much of the packet as we can into the packet payload */
     copy_bytes = MIN(input_data_len - pos,
                      MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos);
+    copy_bytes = MIN(copy_bytes, MQTT_PACKET_LENGTH(&conn->in_packet) -
+                     conn->in_packet.byte_counter);
     DBG("- Copied %lu payload bytes\n", copy_bytes);
     memcpy(&conn->in_packet.payload[conn->in_packet.payload_pos],
            &input_data_ptr[pos],
@@ -1011,15 +1182,18 @@ tcp_input(struct tcp_socket *s,
     conn->in_packet.payload_pos += copy_bytes;
     pos += copy_bytes;
 
-    uint8_t i;
+    uint32_t i;
     DBG("MQTT - Copied bytes: \n");
     for(i = 0; i < copy_bytes; i++) {
       DBG("%02X ", conn->in_packet.payload[i]);
     }
     DBG("\n");
 
-    /* Full buffer, shall only happen to PUBLISH messages. */
-    if(MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos == 0) {
+    /* Full buffer, shall only happen to PUBLISH messages. The last chunk is
+     * handled with the packet. */
+    if(MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos == 0 &&
+       conn->in_packet.byte_counter <
+       MQTT_PACKET_LENGTH(&conn->in_packet)) {
       conn->in_publish_msg.payload_chunk = conn->in_packet.payload;
       conn->in_publish_msg.payload_chunk_length = MQTT_INPUT_BUFF_SIZE;
       conn->in_publish_msg.payload_left -= MQTT_INPUT_BUFF_SIZE;
@@ -1031,7 +1205,7 @@ tcp_input(struct tcp_socket *s,
     }
 
     if(pos >= input_data_len &&
-       (conn->in_packet.byte_counter < (MQTT_FHDR_SIZE + conn->in_packet.remaining_length))) {
+       (conn->in_packet.byte_counter < MQTT_PACKET_LENGTH(&conn->in_packet))) {
       return 0;
     }
   }
@@ -1042,7 +1216,7 @@ tcp_input(struct tcp_socket *s,
   DBG("MQTT - Finished reading packet!\n");
   /* What to return? */
   DBG("MQTT - total data was %i bytes of data. \n",
-      (MQTT_FHDR_SIZE + conn->in_packet.remaining_length));
+      MQTT_PACKET_LENGTH(&conn->in_packet));
 
   /* Handle packet here. */
   switch(conn->in_packet.fhdr & 0xF0) {
@@ -1050,6 +1224,12 @@ tcp_input(struct tcp_socket *s,
     handle_connack(conn);
     break;
   case MQTT_FHDR_MSG_TYPE_PUBLISH:
+#if MQTT_STREAM_PUBLISH
+    /* The payload has been handed over, unless there is none */
+    if(conn->in_publish_msg.payload_length > 0) {
+      break;
+    }
+#endif /* MQTT_STREAM_PUBLISH */
     /* This is the only or the last chunk of publish payload */
     conn->in_publish_msg.payload_chunk = conn->in_packet.payload;
     conn->in_publish_msg.payload_chunk_length = conn->in_packet.payload_pos;
@@ -1086,6 +1266,11 @@ tcp_input(struct tcp_socket *s,
 
   conn->in_packet.packet_received = 1;
 
+  /* The segment may hold the next packet as well */
+  if(pos < input_data_len) {
+    return tcp_input(s, ptr, &input_data_ptr[pos], input_data_len - pos);
+  }
+
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -1131,6 +1316,12 @@ tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
     if(conn->socket.output_data_len == 0) {
       conn->out_buffer_sent = 1;
       conn->out_buffer_ptr = conn->out_buffer;
+#if MQTT_MAX_INFLIGHT > 0
+      /* Messages published while the buffer was out go in the next one */
+      if(find_inflight(conn, MQTT_INFLIGHT_QUEUED) != NULL) {
+        process_post(&mqtt_process, mqtt_do_publish_event, conn);
+      }
+#endif /* MQTT_MAX_INFLIGHT > 0 */
     }
 
     ctimer_restart(&conn->keep_alive_timer);
@@ -1421,6 +1612,39 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
 
   DBG("MQTT - Call to mqtt_publish...\n");
 
+#if MQTT_MAX_INFLIGHT > 0
+  {
+    struct mqtt_inflight *slot;
+
+    for(slot = conn->inflight; slot < &conn->inflight[MQTT_MAX_INFLIGHT];
+        slot++) {
+      if(slot->state == MQTT_INFLIGHT_FREE) {
+        break;
+      }
+    }
+    if(slot == &conn->inflight[MQTT_MAX_INFLIGHT]) {
+      DBG("MQTT - Not accepted!\n");
+      return MQTT_STATUS_OUT_QUEUE_FULL;
+    }
+    DBG("MQTT - Accepted!\n");
+
+    slot->mid = INCREMENT_MID(conn);
+    slot->topic = topic;
+    slot->payload = payload;
+    slot->payload_size = payload_size;
+    slot->qos = qos_level;
+    slot->retain = retain;
+    slot->dup = 0;
+    slot->state = MQTT_INFLIGHT_QUEUED;
+    if(mid != NULL) {
+      *mid = slot->mid;
+    }
+
+    process_post(&mqtt_process, mqtt_do_publish_event, conn);
+    return MQTT_STATUS_OK;
+  }
+#endif /* MQTT_MAX_INFLIGHT > 0 */
+
   /* Currently don't have a queue, so only one item at a time */
   if(conn->out_queue_full) {
     DBG("MQTT - Not accepted!\n");
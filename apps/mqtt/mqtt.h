@@ -108,7 +108,30 @@
 #define MQTT_TCP_INPUT_BUFF_SIZE 512
 #define MQTT_TCP_OUTPUT_BUFF_SIZE 512
 
+/*
+ * Hand the payload of incoming PUBLISH messages to the application as it
+ * arrives, straight from the TCP input buffer, instead of collecting it in
+ * in_packet.payload: MQTT_EVENT_PUBLISH comes once per received segment
+ * of payload, with its offset in the message and the total length, so
+ * that payloads of any size are received without a buffer of their size.
+ * in_packet.payload then only holds the other packets, which are a few
+ * bytes long.
+ */
+#ifdef MQTT_CONF_STREAM_PUBLISH
+#define MQTT_STREAM_PUBLISH MQTT_CONF_STREAM_PUBLISH
+#else
+#define MQTT_STREAM_PUBLISH 0
+#endif
+
+/* Size of in_packet.payload. Without MQTT_STREAM_PUBLISH, PUBLISH payloads
+ * are delivered in chunks of this size. */
+#ifdef MQTT_CONF_INPUT_BUFF_SIZE
+#define MQTT_INPUT_BUFF_SIZE MQTT_CONF_INPUT_BUFF_SIZE
+#elif MQTT_STREAM_PUBLISH
+#define MQTT_INPUT_BUFF_SIZE 8
+#else
 #define MQTT_INPUT_BUFF_SIZE 512
+#endif
 #define MQTT_MAX_TOPIC_LENGTH 64
 #define MQTT_MAX_TOPICS_PER_SUBSCRIBE 1
 
@@ -117,6 +140,21 @@
 #define MQTT_PROTOCOL_VERSION 3
 #define MQTT_PROTOCOL_NAME "MQIsdp"
 #define MQTT_TOPIC_MAX_LENGTH 128
+
+/*
+ * Number of PUBLISH messages that can be queued or wait for their PUBACK
+ * at the same time. Queued messages are written back to back, several to a
+ * TCP segment, and QoS 1 messages not acknowledged when the connection
+ * drops are sent again, with the DUP flag, after the next CONNACK. The
+ * topic and payload of a QoS 1 message must then stay valid until its
+ * MQTT_EVENT_PUBACK. 0 sends one message at a time and waits for its
+ * PUBACK before accepting the next.
+ */
+#ifdef MQTT_CONF_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT MQTT_CONF_MAX_INFLIGHT
+#else
+#define MQTT_MAX_INFLIGHT 0
+#endif
 /*---------------------------------------------------------------------------*/
 /*
  * Debug configuration, this is similar but not exactly like the Debugging
@@ -233,8 +271,10 @@ struct mqtt_message {
   uint16_t payload_chunk_length;
 
   uint8_t first_chunk;
-  uint16_t payload_length;
-  uint16_t payload_left;
+  /* Offset of payload_chunk in the payload */
+  uint32_t payload_offset;
+  uint32_t payload_length;
+  uint32_t payload_left;
 };
 
 /* This struct represents a packet received from the MQTT server. */
@@ -248,18 +288,18 @@ struct mqtt_in_packet {
   uint8_t packet_received;
 
   uint8_t fhdr;
-  uint16_t remaining_length;
+  uint32_t remaining_length;
   uint16_t mid;
 
   /* Helper variables needed to decode the remaining_length */
-  uint8_t remaining_multiplier;
+  uint32_t remaining_multiplier;
   uint8_t has_remaining_length;
   uint8_t remaining_length_bytes;
 
   /* Not the same as payload in the MQTT sense, it also contains the variable
    * header.
    */
-  uint8_t payload_pos;
+  uint16_t payload_pos;
   uint8_t payload[MQTT_INPUT_BUFF_SIZE];
 
   /* Message specific data */
@@ -284,6 +324,26 @@ struct mqtt_out_packet {
   mqtt_qos_state_t qos_state;
   mqtt_retain_t retain;
 };
+
+#if MQTT_MAX_INFLIGHT > 0
+typedef enum {
+  MQTT_INFLIGHT_FREE,
+  MQTT_INFLIGHT_QUEUED,
+  MQTT_INFLIGHT_SENT,
+} mqtt_inflight_state_t;
+
+/* A PUBLISH message of the in-flight window */
+struct mqtt_inflight {
+  uint16_t mid;
+  char *topic;
+  uint8_t *payload;
+  uint32_t payload_size;
+  mqtt_qos_level_t qos;
+  mqtt_retain_t retain;
+  mqtt_inflight_state_t state;
+  uint8_t dup;
+};
+#endif /* MQTT_MAX_INFLIGHT > 0 */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief           MQTT event callback function
@@ -348,6 +408,10 @@ struct mqtt_connection {
   struct pt out_proto_thread;
   uint32_t out_write_pos;
   uint16_t max_segment_size;
+#if MQTT_MAX_INFLIGHT > 0
+  struct mqtt_inflight inflight[MQTT_MAX_INFLIGHT];
+  struct mqtt_inflight *out_inflight;
+#endif /* MQTT_MAX_INFLIGHT > 0 */
 
   /* Incoming data related */
   uint8_t in_buffer[MQTT_TCP_INPUT_BUFF_SIZE];
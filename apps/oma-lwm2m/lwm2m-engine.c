@@ -52,6 +52,8 @@
 #include "oma-tlv.h"
 #include "oma-tlv-writer.h"
 #include "net/ipv6/uip-ds6.h"
+#include "lib/memb.h"
+#include "lib/list.h"
 #include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
@@ -77,6 +79,21 @@
 #define MAX_OBJECTS 10
 #endif /* LWM2M_ENGINE_CONF_MAX_OBJECTS */
 
+/* Largest rendered item (resource) of an instance or object read */
+#ifdef LWM2M_ENGINE_CONF_ITEM_SIZE
+#define ITEM_SIZE LWM2M_ENGINE_CONF_ITEM_SIZE
+#else /* LWM2M_ENGINE_CONF_ITEM_SIZE */
+#define ITEM_SIZE 64
+#endif /* LWM2M_ENGINE_CONF_ITEM_SIZE */
+
+/* Number of resources with notification attributes (pmin, pmax, gt, lt,
+ * st). 0 disables Write-Attributes, resources notify on every change. */
+#ifdef LWM2M_ENGINE_CONF_MAX_ATTRIBUTES
+#define MAX_ATTRIBUTES LWM2M_ENGINE_CONF_MAX_ATTRIBUTES
+#else /* LWM2M_ENGINE_CONF_MAX_ATTRIBUTES */
+#define MAX_ATTRIBUTES 0
+#endif /* LWM2M_ENGINE_CONF_MAX_ATTRIBUTES */
+
 #define REMOTE_PORT        UIP_HTONS(COAP_DEFAULT_PORT)
 #define BS_REMOTE_PORT     UIP_HTONS(5685)
 
@@ -585,126 +602,529 @@ get_resource(const lwm2m_instance_t *instance, lwm2m_context_t *context)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+#if MAX_ATTRIBUTES > 0
+/*
+ * Notification attributes of observed resources, set by the server with
+ * Write-Attributes (a PUT with a query and no payload): a resource
+ * notifies at most once per pmin seconds and at least once per pmax
+ * seconds, and when gt, lt or st is set only if its value crossed gt or
+ * lt, or moved by st since the last notification.
+ */
+#define ATTR_GT 1
+#define ATTR_LT 2
+#define ATTR_ST 4
+
+struct notify_attributes {
+  struct notify_attributes *next;       /* for LIST */
+  const lwm2m_object_t *object;
+  uint16_t instance_id;
+  uint16_t resource_id;
+
+  uint16_t pmin;
+  uint16_t pmax;
+  uint8_t flags;
+  uint8_t pending;              /* a notification waits for pmin */
+  int32_t gt;
+  int32_t lt;
+  int32_t st;
+
+  int32_t last_value;
+  clock_time_t last_time;
+  struct ctimer timer;
+};
+
+MEMB(attributes_memb, struct notify_attributes, MAX_ATTRIBUTES);
+LIST(attributes_list);
+
+static void notify_timeout(void *ptr);
+/*---------------------------------------------------------------------------*/
+static struct notify_attributes *
+get_attributes(const lwm2m_object_t *object, uint16_t instance_id,
+               uint16_t resource_id)
+{
+  struct notify_attributes *a;
+
+  for(a = list_head(attributes_list); a != NULL; a = a->next) {
+    if(a->object == object && a->instance_id == instance_id &&
+       a->resource_id == resource_id) {
+      return a;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Read the value of a numeric resource as fix float */
 static int
-write_rd_link_data(const lwm2m_object_t *object,
-                   const lwm2m_instance_t *instance,
-                   char *buffer, size_t size)
+read_fix_value(const struct notify_attributes *a, int32_t *value)
 {
+  const lwm2m_instance_t *instance;
   const lwm2m_resource_t *resource;
-  int len, rdlen, i;
+  lwm2m_context_t context;
+  uint8_t text[16];
+  int len, b;
+
+  memset(&context, 0, sizeof(context));
+  context.object_id = a->object->id;
+  context.object_instance_id = a->instance_id;
+  context.resource_id = a->resource_id;
+  instance = get_instance(a->object, &context, 2);
+  resource = get_resource(instance, &context);
+  if(resource == NULL) {
+    return 0;
+  }
 
-  PRINTF("<%d/%d>", object->id, instance->id);
-  rdlen = snprintf(buffer, size, "<%d/%d>",
-                   object->id, instance->id);
-  if(rdlen < 0 || rdlen >= size) {
-    return -1;
+  if(lwm2m_object_is_resource_floatfix(resource)) {
+    return lwm2m_object_get_resource_floatfix(resource, &context, value);
+  } else if(lwm2m_object_is_resource_int(resource)) {
+    if(lwm2m_object_get_resource_int(resource, &context, value)) {
+      *value *= LWM2M_FLOAT32_FRAC;
+      return 1;
+    }
+  } else if(lwm2m_object_is_resource_boolean(resource)) {
+    if(lwm2m_object_get_resource_boolean(resource, &context, &b)) {
+      *value = b ? LWM2M_FLOAT32_FRAC : 0;
+      return 1;
+    }
+  } else if(lwm2m_object_is_resource_callback(resource) &&
+            resource->value.callback.read != NULL) {
+    /* let the resource write its value as text */
+    context.writer = &lwm2m_plain_text_writer;
+    len = resource->value.callback.read(&context, text, sizeof(text));
+    return len > 0 && lwm2m_plain_text_read_float32fix(text, len, value,
+                                                       LWM2M_FLOAT32_BITS);
   }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+notify_now(struct notify_attributes *a)
+{
+  char path[14];
 
-  for(i = 0; i < instance->count; i++) {
-    resource = &instance->resources[i];
-    PRINTF(",<%d/%d/%d>", object->id, instance->id, resource->id);
+  snprintf(path, sizeof(path), "/%u/%u", a->instance_id, a->resource_id);
+  PRINTF("lwm2m: notify %u%s\n", a->object->id, path);
+  coap_notify_observers_sub(lwm2m_object_get_coap_resource(a->object), path);
 
-    len = snprintf(&buffer[rdlen], size - rdlen,
-                   ",<%d/%d/%d>", object->id, instance->id, resource->id);
-    rdlen += len;
-    if(len < 0 || rdlen >= size) {
-      return -1;
+  a->pending = 0;
+  a->last_time = clock_time();
+  if(a->flags) {
+    read_fix_value(a, &a->last_value);
+  }
+  if(a->pmax > 0) {
+    ctimer_set(&a->timer, a->pmax * CLOCK_SECOND, notify_timeout, a);
+  } else {
+    ctimer_stop(&a->timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+notify_timeout(void *ptr)
+{
+  /* end of pmin with a notification waiting, or pmax */
+  notify_now((struct notify_attributes *)ptr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+crossed_threshold(const struct notify_attributes *a)
+{
+  int32_t value, delta;
+
+  if(a->flags == 0) {
+    return 1;
+  }
+  if(!read_fix_value(a, &value)) {
+    return 1;
+  }
+  if((a->flags & ATTR_GT) && (a->last_value > a->gt) != (value > a->gt)) {
+    return 1;
+  }
+  if((a->flags & ATTR_LT) && (a->last_value < a->lt) != (value < a->lt)) {
+    return 1;
+  }
+  delta = value - a->last_value;
+  if((a->flags & ATTR_ST) && (delta >= a->st || -delta >= a->st)) {
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+notify_with_attributes(struct notify_attributes *a)
+{
+  clock_time_t elapsed;
+
+  if(a->pending || !crossed_threshold(a)) {
+    return;
+  }
+  elapsed = clock_time() - a->last_time;
+  if(elapsed < a->pmin * CLOCK_SECOND) {
+    /* sent at the end of pmin */
+    a->pending = 1;
+    ctimer_set(&a->timer, a->pmin * CLOCK_SECOND - elapsed,
+               notify_timeout, a);
+    return;
+  }
+  notify_now(a);
+}
+/*---------------------------------------------------------------------------*/
+static int
+get_query_fix(void *request, const char *name, int32_t *value)
+{
+  const char *text;
+  int len;
+
+  len = REST.get_query_variable(request, name, &text);
+  return len > 0 && lwm2m_plain_text_read_float32fix((const uint8_t *)text,
+                                                     len, value,
+                                                     LWM2M_FLOAT32_BITS);
+}
+/*---------------------------------------------------------------------------*/
+/* Handle Write-Attributes, returns 0 if the request carries none */
+static int
+write_attributes(const lwm2m_object_t *object,
+                 const lwm2m_context_t *context,
+                 void *request, void *response)
+{
+  struct notify_attributes *a;
+  const char *query;
+  int32_t value;
+
+  if(REST.get_query(request, &query) == 0) {
+    return 0;
+  }
+
+  a = get_attributes(object, context->object_instance_id,
+                     context->resource_id);
+  if(a == NULL) {
+    a = memb_alloc(&attributes_memb);
+    if(a == NULL) {
+      REST.set_response_status(response, SERVICE_UNAVAILABLE_5_03);
+      return 1;
+    }
+    memset(a, 0, sizeof(*a));
+    a->object = object;
+    a->instance_id = context->object_instance_id;
+    a->resource_id = context->resource_id;
+    read_fix_value(a, &a->last_value);
+    list_add(attributes_list, a);
+  }
+
+  if(get_query_fix(request, "pmin", &value)) {
+    a->pmin = value / LWM2M_FLOAT32_FRAC;
+  }
+  if(get_query_fix(request, "pmax", &value)) {
+    a->pmax = value / LWM2M_FLOAT32_FRAC;
+    if(a->pmax > 0 && !a->pending) {
+      ctimer_set(&a->timer, a->pmax * CLOCK_SECOND, notify_timeout, a);
+    }
+  }
+  if(get_query_fix(request, "gt", &a->gt)) {
+    a->flags |= ATTR_GT;
+  }
+  if(get_query_fix(request, "lt", &a->lt)) {
+    a->flags |= ATTR_LT;
+  }
+  if(get_query_fix(request, "st", &a->st)) {
+    a->flags |= ATTR_ST;
+  }
+  PRINTF("lwm2m: attributes of %u/%u/%u pmin %u pmax %u flags %x\n",
+         object->id, a->instance_id, a->resource_id, a->pmin, a->pmax,
+         a->flags);
+
+  REST.set_response_status(response, CHANGED_2_04);
+  return 1;
+}
+#endif /* MAX_ATTRIBUTES > 0 */
+/*---------------------------------------------------------------------------*/
+void
+lwm2m_engine_notify_observers(const lwm2m_object_t *object, char *path)
+{
+#if MAX_ATTRIBUTES > 0
+  struct notify_attributes *a;
+  const char *p = path;
+  int len = strlen(path);
+  uint16_t instance_id, resource_id;
+
+  /* path is /instance/resource */
+  if(*p == '/') {
+    p++;
+    len--;
+  }
+  if(parse_next(&p, &len, &instance_id) == 1 &&
+     parse_next(&p, &len, &resource_id) == 1) {
+    a = get_attributes(object, instance_id, resource_id);
+    if(a != NULL) {
+      notify_with_attributes(a);
+      return;
     }
   }
-  return rdlen;
+#endif /* MAX_ATTRIBUTES > 0 */
+  coap_notify_observers_sub(lwm2m_object_get_coap_resource(object), path);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Reads of a whole instance (depth 2) or object (depth 1) are rendered
+ * item by item: the JSON header, the link of each instance, each
+ * resource, the JSON footer. An item is rendered into item_buffer and
+ * the part of it that falls in the requested block is copied to the
+ * response. The read cursor remembers the item at which the last block
+ * ended and its byte offset, so that the next block of the same read
+ * starts from there instead of rendering the earlier blocks again.
+ */
+#define READ_HEADER    0
+#define READ_INSTANCE  1
+#define READ_RESOURCE  2
+#define READ_FOOTER    3
+#define READ_DONE      4
+
+struct read_cursor {
+  const lwm2m_object_t *object;
+  uint16_t instance_id;
+  uint8_t depth;
+  uint8_t link_format;
+
+  uint8_t state;
+  uint8_t empty;                /* no item written after the header yet */
+  uint16_t instance_index;
+  uint16_t resource_index;
+  int32_t offset;               /* offset of the item at the cursor */
+};
+
+static struct read_cursor read_cursor;
+static char item_buffer[ITEM_SIZE];
+/*---------------------------------------------------------------------------*/
 static int
-write_rd_json_data(const lwm2m_context_t *context,
-                   const lwm2m_object_t *object,
-                   const lwm2m_instance_t *instance,
-                   char *buffer, size_t size)
+is_read_instance(const struct read_cursor *c, int index)
 {
-  const lwm2m_resource_t *resource;
-  const char *s = "";
-  int len, rdlen, i;
-
-  PRINTF("{\"e\":[");
-  rdlen = snprintf(buffer, size, "{\"e\":[");
-  if(rdlen < 0 || rdlen >= size) {
-    return -1;
-  }
-
-  for(i = 0, len = 0; i < instance->count; i++) {
-    resource = &instance->resources[i];
-    len = 0;
-    if(lwm2m_object_is_resource_string(resource)) {
-      const uint8_t *value;
-      uint16_t slen;
-      value = lwm2m_object_get_resource_string(resource, context);
-      slen = lwm2m_object_get_resource_strlen(resource, context);
-      if(value != NULL) {
-        PRINTF("%s{\"n\":\"%u\",\"vs\":\"%.*s\"}", s,
-               resource->id, slen, value);
-        len = snprintf(&buffer[rdlen], size - rdlen,
-                       "%s{\"n\":\"%u\",\"vs\":\"%.*s\"}", s,
-                       resource->id, slen, value);
-      }
-    } else if(lwm2m_object_is_resource_int(resource)) {
-      int32_t value;
-      if(lwm2m_object_get_resource_int(resource, context, &value)) {
-        PRINTF("%s{\"n\":\"%u\",\"v\":%" PRId32 "}", s,
-               resource->id, value);
-        len = snprintf(&buffer[rdlen], size - rdlen,
-                       "%s{\"n\":\"%u\",\"v\":%" PRId32 "}", s,
-                       resource->id, value);
-      }
-    } else if(lwm2m_object_is_resource_floatfix(resource)) {
-      int32_t value;
-      if(lwm2m_object_get_resource_floatfix(resource, context, &value)) {
-        PRINTF("%s{\"n\":\"%u\",\"v\":%" PRId32 "}", s, resource->id,
-               value / LWM2M_FLOAT32_FRAC);
-        len = snprintf(&buffer[rdlen], size - rdlen,
-                       "%s{\"n\":\"%u\",\"v\":", s, resource->id);
-        rdlen += len;
-        if(len < 0 || rdlen >= size) {
-          return -1;
-        }
+  const lwm2m_instance_t *instance = &c->object->instances[index];
+  return (instance->flag & LWM2M_INSTANCE_FLAG_USED) &&
+    (c->depth == 1 || instance->id == c->instance_id);
+}
+/*---------------------------------------------------------------------------*/
+static void
+next_instance(struct read_cursor *c)
+{
+  while(c->instance_index < c->object->count &&
+        !is_read_instance(c, c->instance_index)) {
+    c->instance_index++;
+  }
+  if(c->instance_index < c->object->count) {
+    c->state = READ_INSTANCE;
+  } else {
+    c->state = c->link_format ? READ_DONE : READ_FOOTER;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_read(struct read_cursor *c, const lwm2m_object_t *object,
+           const lwm2m_context_t *context, int depth, int link_format)
+{
+  c->object = object;
+  c->instance_id = context->object_instance_id;
+  c->depth = depth;
+  c->link_format = link_format;
+  c->empty = 1;
+  c->instance_index = 0;
+  c->resource_index = 0;
+  c->offset = 0;
+  if(link_format) {
+    next_instance(c);
+  } else {
+    c->state = READ_HEADER;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_json_resource(const struct read_cursor *c,
+                    const lwm2m_context_t *context,
+                    const lwm2m_resource_t *resource,
+                    char *buffer, size_t size)
+{
+  const char *s = c->empty ? "" : ",";
+  char name[12];
+  int len, flen;
 
-        len = lwm2m_plain_text_write_float32fix((uint8_t *)&buffer[rdlen],
-                                                size - rdlen,
-                                                value, LWM2M_FLOAT32_BITS);
-        if(len == 0) {
-          return -1;
-        }
-        rdlen += len;
+  if(c->depth == 1) {
+    snprintf(name, sizeof(name), "%u/%u",
+             context->object_instance_id, resource->id);
+  } else {
+    snprintf(name, sizeof(name), "%u", resource->id);
+  }
 
-        if(rdlen < size) {
-          buffer[rdlen] = '}';
-        }
-        len = 1;
+  len = 0;
+  if(lwm2m_object_is_resource_string(resource)) {
+    const uint8_t *value;
+    uint16_t slen;
+    value = lwm2m_object_get_resource_string(resource, context);
+    slen = lwm2m_object_get_resource_strlen(resource, context);
+    if(value != NULL) {
+      len = snprintf(buffer, size, "%s{\"n\":\"%s\",\"vs\":\"%.*s\"}", s,
+                     name, slen, value);
+    }
+  } else if(lwm2m_object_is_resource_int(resource)) {
+    int32_t value;
+    if(lwm2m_object_get_resource_int(resource, context, &value)) {
+      len = snprintf(buffer, size, "%s{\"n\":\"%s\",\"v\":%" PRId32 "}", s,
+                     name, value);
+    }
+  } else if(lwm2m_object_is_resource_floatfix(resource)) {
+    int32_t value;
+    if(lwm2m_object_get_resource_floatfix(resource, context, &value)) {
+      len = snprintf(buffer, size, "%s{\"n\":\"%s\",\"v\":", s, name);
+      if(len < 0 || len >= size) {
+        return -1;
+      }
+      flen = lwm2m_plain_text_write_float32fix((uint8_t *)&buffer[len],
+                                               size - len,
+                                               value, LWM2M_FLOAT32_BITS);
+      if(flen == 0) {
+        return -1;
       }
-    } else if(lwm2m_object_is_resource_boolean(resource)) {
-      int value;
-      if(lwm2m_object_get_resource_boolean(resource, context, &value)) {
-        PRINTF("%s{\"n\":\"%u\",\"v\":%s}", s, resource->id,
-               value ? "true" : "false");
-        len = snprintf(&buffer[rdlen], size - rdlen,
-                       "%s{\"n\":\"%u\",\"v\":%s}", s, resource->id,
-                       value ? "true" : "false");
+      len += flen;
+      if(len + 1 >= size) {
+        return -1;
       }
+      buffer[len++] = '}';
     }
-    rdlen += len;
-    if(len < 0 || rdlen >= size) {
-      return -1;
+  } else if(lwm2m_object_is_resource_boolean(resource)) {
+    int value;
+    if(lwm2m_object_get_resource_boolean(resource, context, &value)) {
+      len = snprintf(buffer, size, "%s{\"n\":\"%s\",\"v\":%s}", s,
+                     name, value ? "true" : "false");
     }
-    if(len > 0) {
-      s = ",";
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* Render the item at the cursor, returns its length or -1 */
+static int
+write_read_item(const struct read_cursor *c, char *buffer, size_t size)
+{
+  const lwm2m_instance_t *instance;
+  lwm2m_context_t context;
+
+  switch(c->state) {
+  case READ_HEADER:
+    return snprintf(buffer, size, "{\"e\":[");
+  case READ_FOOTER:
+    return snprintf(buffer, size, "]}");
+  case READ_INSTANCE:
+    instance = &c->object->instances[c->instance_index];
+    if(!c->link_format) {
+      return 0;
+    }
+    return snprintf(buffer, size, "%s<%d/%d>", c->empty ? "" : ",",
+                    c->object->id, instance->id);
+  case READ_RESOURCE:
+    instance = &c->object->instances[c->instance_index];
+    if(c->link_format) {
+      return snprintf(buffer, size, ",<%d/%d/%d>", c->object->id,
+                      instance->id,
+                      instance->resources[c->resource_index].id);
+    }
+    memset(&context, 0, sizeof(context));
+    context.object_id = c->object->id;
+    context.object_instance_id = instance->id;
+    context.object_instance_index = c->instance_index;
+    context.resource_id = instance->resources[c->resource_index].id;
+    context.resource_index = c->resource_index;
+    return write_json_resource(c, &context,
+                               &instance->resources[c->resource_index],
+                               buffer, size);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Move the cursor past its item, of length len */
+static void
+advance_read(struct read_cursor *c, int len)
+{
+  const lwm2m_instance_t *instance;
+
+  c->offset += len;
+  if(len > 0 && c->state != READ_HEADER) {
+    c->empty = 0;
+  }
+
+  switch(c->state) {
+  case READ_HEADER:
+    next_instance(c);
+    break;
+  case READ_INSTANCE:
+  case READ_RESOURCE:
+    instance = &c->object->instances[c->instance_index];
+    if(c->state == READ_INSTANCE) {
+      c->resource_index = 0;
+    } else {
+      c->resource_index++;
+    }
+    if(c->resource_index < instance->count) {
+      c->state = READ_RESOURCE;
+    } else {
+      c->instance_index++;
+      next_instance(c);
     }
+    break;
+  case READ_FOOTER:
+    c->state = READ_DONE;
+    break;
   }
-  PRINTF("]}\n");
-  len = snprintf(&buffer[rdlen], size - rdlen, "]}");
-  rdlen += len;
-  if(len < 0 || rdlen >= size) {
-    return -1;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Write the block of the read at *offset to buffer, and set *offset to the
+ * offset of the next block or to -1 after the last one. Returns the length
+ * of the block, or -1 if an item does not fit in item_buffer.
+ */
+static int
+write_read_block(const lwm2m_object_t *object,
+                 const lwm2m_context_t *context, int depth, int link_format,
+                 uint8_t *buffer, uint16_t size, int32_t *offset)
+{
+  struct read_cursor *c = &read_cursor;
+  int32_t start, end;
+  int len, from, to;
+
+  start = *offset;
+  end = start + size;
+
+  if(c->object != object || c->depth != depth
+     || c->link_format != link_format
+     || c->instance_id != context->object_instance_id
+     || c->state == READ_DONE || c->offset > start) {
+    PRINTF("lwm2m: read of %u from the start\n", object->id);
+    start_read(c, object, context, depth, link_format);
   }
 
-  return rdlen;
+  while(c->state != READ_DONE) {
+    len = write_read_item(c, item_buffer, sizeof(item_buffer));
+    if(len < 0 || len >= sizeof(item_buffer)) {
+      c->object = NULL;
+      return -1;
+    }
+    if(c->offset >= end) {
+      /* the item starts the next block */
+      break;
+    }
+    if(c->offset + len > start) {
+      from = c->offset < start ? start - c->offset : 0;
+      to = c->offset + len > end ? end - c->offset : len;
+      memcpy(&buffer[c->offset + from - start], &item_buffer[from], to - from);
+      if(to < len) {
+        /* the item continues in the next block */
+        break;
+      }
+    }
+    advance_read(c, len);
+  }
+
+  if(c->state == READ_DONE) {
+    /* a read that fits in one block needs no blockwise transfer */
+    *offset = start == 0 ? 0 : -1;
+    return c->offset > start ? c->offset - start : 0;
+  }
+  *offset = end;
+  return size;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -867,6 +1287,12 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
       REST.set_response_status(response, NOT_FOUND_4_04);
       return;
     }
+#if MAX_ATTRIBUTES > 0
+    if(method == METHOD_PUT &&
+       write_attributes(object, &context, request, response)) {
+      return;
+    }
+#endif /* MAX_ATTRIBUTES > 0 */
     /* HANDLE PUT */
     if(method == METHOD_PUT) {
       if(lwm2m_object_is_resource_callback(resource)) {
@@ -931,6 +1357,7 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
         }
       } else if(lwm2m_object_is_resource_callback(resource)) {
         if(resource->value.callback.read != NULL) {
+          context.content_format = LWM2M_TLV;
           tlvlen = resource->value.callback.read(&context,
                                                  buffer, preferred_size);
         } else {
@@ -940,7 +1367,8 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
       }
       if(tlvlen > 0) {
         REST.set_response_payload(response, buffer, tlvlen);
-        REST.set_header_content_type(response, LWM2M_TLV);
+        REST.set_header_content_type(response, context.content_format != 0 ?
+                                     context.content_format : LWM2M_TLV);
       } else {
         /* failed to produce output - it is an internal error */
         REST.set_response_status(response, INTERNAL_SERVER_ERROR_5_00);
@@ -965,21 +1393,17 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
         REST.set_response_status(response, METHOD_NOT_ALLOWED_4_05);
       }
     }
-  } else if(depth == 2) {
-    /* produce an instance response */
+  } else if(depth > 0) {
+    /* produce an instance or object response */
     if(method != METHOD_GET) {
       REST.set_response_status(response, METHOD_NOT_ALLOWED_4_05);
-    } else if(instance == NULL) {
+    } else if(depth == 2 && instance == NULL) {
       REST.set_response_status(response, NOT_FOUND_4_04);
     } else {
       int rdlen;
-      if(format == APPLICATION_LINK_FORMAT) {
-        rdlen = write_rd_link_data(object, instance,
-                                   (char *)buffer, preferred_size);
-      } else {
-        rdlen = write_rd_json_data(&context, object, instance,
-                                   (char *)buffer, preferred_size);
-      }
+      rdlen = write_read_block(object, &context, depth,
+                               format == APPLICATION_LINK_FORMAT,
+                               buffer, preferred_size, offset);
       if(rdlen < 0) {
         PRINTF("Failed to generate instance response\n");
         REST.set_response_status(response, SERVICE_UNAVAILABLE_5_03);
@@ -99,6 +99,12 @@ typedef struct lwm2m_context {
 
   const struct lwm2m_reader *reader;
   const struct lwm2m_writer *writer;
+
+  /* Content-Format of a GET response for a single resource, LWM2M_TLV.
+     A read callback may write another format and change this to match.
+     0 when the value is part of a larger response and must be written
+     with the writer. */
+  unsigned int content_format;
 } lwm2m_context_t;
 
 /* LWM2M format writer for the various formats supported */
@@ -344,10 +350,14 @@ lwm2m_object_get_coap_resource(const lwm2m_object_t *object)
   return (resource_t *)object->coap_resource;
 }
 
+/* Notify the observers of a resource of an object, path is
+ * /instance/resource, as allowed by its notification attributes */
+void lwm2m_engine_notify_observers(const lwm2m_object_t *object, char *path);
+
 static inline void
 lwm2m_object_notify_observers(const lwm2m_object_t *object, char *path)
 {
-  coap_notify_observers_sub(lwm2m_object_get_coap_resource(object), path);
+  lwm2m_engine_notify_observers(object, path);
 }
 
 #include "lwm2m-engine.h"
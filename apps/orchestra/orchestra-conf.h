@@ -102,4 +102,34 @@
 #define ORCHESTRA_COLLISION_FREE_HASH             0 /* Set to 1 if ORCHESTRA_LINKADDR_HASH returns unique hashes */
 #endif /* ORCHESTRA_CONF_COLLISION_FREE_HASH */
 
+/* Adaptive unicast rule (unicast_adaptive): a child gets one extra cell to
+ * its parent per ORCHESTRA_ADAPTIVE_SUBTREE_PER_CELL nodes in its subtree
+ * (itself included), up to ORCHESTRA_ADAPTIVE_MAX_EXTRA_CELLS */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_SUBTREE_PER_CELL
+#define ORCHESTRA_ADAPTIVE_SUBTREE_PER_CELL       ORCHESTRA_CONF_ADAPTIVE_SUBTREE_PER_CELL
+#else /* ORCHESTRA_CONF_ADAPTIVE_SUBTREE_PER_CELL */
+#define ORCHESTRA_ADAPTIVE_SUBTREE_PER_CELL       4
+#endif /* ORCHESTRA_CONF_ADAPTIVE_SUBTREE_PER_CELL */
+
+#ifdef ORCHESTRA_CONF_ADAPTIVE_MAX_EXTRA_CELLS
+#define ORCHESTRA_ADAPTIVE_MAX_EXTRA_CELLS        ORCHESTRA_CONF_ADAPTIVE_MAX_EXTRA_CELLS
+#else /* ORCHESTRA_CONF_ADAPTIVE_MAX_EXTRA_CELLS */
+#define ORCHESTRA_ADAPTIVE_MAX_EXTRA_CELLS        3
+#endif /* ORCHESTRA_CONF_ADAPTIVE_MAX_EXTRA_CELLS */
+
+/* Queued packets to a neighbor above which its packets may also go in other
+ * slotframes (e.g. the common shared one). 0 to disable */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_QUEUE_THRESHOLD
+#define ORCHESTRA_ADAPTIVE_QUEUE_THRESHOLD        ORCHESTRA_CONF_ADAPTIVE_QUEUE_THRESHOLD
+#else /* ORCHESTRA_CONF_ADAPTIVE_QUEUE_THRESHOLD */
+#define ORCHESTRA_ADAPTIVE_QUEUE_THRESHOLD        4
+#endif /* ORCHESTRA_CONF_ADAPTIVE_QUEUE_THRESHOLD */
+
+/* How often the extra cells follow the subtree sizes */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_UPDATE_PERIOD
+#define ORCHESTRA_ADAPTIVE_UPDATE_PERIOD          ORCHESTRA_CONF_ADAPTIVE_UPDATE_PERIOD
+#else /* ORCHESTRA_CONF_ADAPTIVE_UPDATE_PERIOD */
+#define ORCHESTRA_ADAPTIVE_UPDATE_PERIOD          (60 * CLOCK_SECOND)
+#endif /* ORCHESTRA_CONF_ADAPTIVE_UPDATE_PERIOD */
+
 #endif /* __ORCHESTRA_CONF_H__ */
@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Orchestra: a receiver-based unicast slotframe whose capacity
+ *         follows the traffic. As in unicast_per_neighbor, nodes listen at
+ *         hash(MAC) % ORCHESTRA_UNICAST_PERIOD and transmit at the timeslot
+ *         of their parent and children. In addition, a child gets extra
+ *         dedicated cells to its parent, as many as its RPL subtree size
+ *         warrants (see ORCHESTRA_ADAPTIVE_SUBTREE_PER_CELL). Both ends know
+ *         the subtree size (the child from its routing table, the parent
+ *         from its routes via the child), so no negotiation is needed.
+ *         Extra cells are spread over the slotframe, which cuts the
+ *         latency near the root where subtrees are large.
+ *         When the queue to a neighbor builds up, its packets may also be
+ *         sent in any other slotframe, e.g. the common shared one.
+ *         Requires RPL storing mode to get extra cells.
+ */
+
+#include "contiki.h"
+#include "orchestra.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/packetbuf.h"
+#include "sys/ctimer.h"
+
+/* Marks our extra links, through their data field */
+static const uint8_t extra_link_tag;
+#define IS_EXTRA_LINK(l) ((l)->data == (void *)&extra_link_tag)
+
+/* Extra cells are spread over the slotframe */
+#define EXTRA_CELLS_STRIDE MAX(1, ORCHESTRA_UNICAST_PERIOD / (ORCHESTRA_ADAPTIVE_MAX_EXTRA_CELLS + 1))
+
+static uint16_t slotframe_handle = 0;
+static uint16_t channel_offset = 0;
+static struct tsch_slotframe *sf_unicast;
+static struct ctimer update_timer;
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_node_timeslot(const linkaddr_t *addr)
+{
+  if(addr != NULL && ORCHESTRA_UNICAST_PERIOD > 0) {
+    return ORCHESTRA_LINKADDR_HASH(addr) % ORCHESTRA_UNICAST_PERIOD;
+  } else {
+    return 0xffff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The timeslot of the i-th extra cell (from 1) of a child to its parent */
+static uint16_t
+get_extra_timeslot(const linkaddr_t *child, int i)
+{
+  return (get_node_timeslot(child) + i * EXTRA_CELLS_STRIDE) % ORCHESTRA_UNICAST_PERIOD;
+}
+/*---------------------------------------------------------------------------*/
+static int
+num_extra_cells(uint16_t subtree_size)
+{
+  return MIN(ORCHESTRA_ADAPTIVE_MAX_EXTRA_CELLS,
+             subtree_size / ORCHESTRA_ADAPTIVE_SUBTREE_PER_CELL);
+}
+/*---------------------------------------------------------------------------*/
+/* Number of extra cells of a child to us, from the routes via the child.
+ * The child itself is one of them */
+static int
+child_extra_cells(const linkaddr_t *child)
+{
+  struct uip_ds6_route_neighbor_routes *routes;
+  routes = nbr_table_get_from_lladdr(nbr_routes, (linkaddr_t *)child);
+  return routes != NULL ? num_extra_cells(list_length(routes->route_list)) : 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Number of extra cells of ours to our parent, from our own subtree */
+static int
+own_extra_cells(void)
+{
+  if(linkaddr_cmp(&orchestra_parent_linkaddr, &linkaddr_null)) {
+    return 0;
+  }
+  return num_extra_cells(uip_ds6_route_num_routes() + 1);
+}
+/*---------------------------------------------------------------------------*/
+static int
+neighbor_has_uc_link(const linkaddr_t *linkaddr)
+{
+  if(linkaddr != NULL && !linkaddr_cmp(linkaddr, &linkaddr_null)) {
+    if(linkaddr_cmp(&orchestra_parent_linkaddr, linkaddr)) {
+      return 1;
+    }
+    if(nbr_table_get_from_lladdr(nbr_routes, (linkaddr_t *)linkaddr) != NULL) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_uc_link(const linkaddr_t *linkaddr)
+{
+  if(linkaddr != NULL) {
+    uint16_t timeslot = get_node_timeslot(linkaddr);
+    tsch_schedule_add_link(sf_unicast, LINK_OPTION_TX | LINK_OPTION_SHARED,
+        LINK_TYPE_NORMAL, &tsch_broadcast_address,
+        timeslot, channel_offset);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_uc_link(const linkaddr_t *linkaddr)
+{
+  uint16_t timeslot;
+  struct tsch_link *l;
+
+  if(linkaddr == NULL) {
+    return;
+  }
+
+  timeslot = get_node_timeslot(linkaddr);
+  l = tsch_schedule_get_link_by_timeslot(sf_unicast, timeslot);
+  if(l == NULL || IS_EXTRA_LINK(l)) {
+    return;
+  }
+  /* Does our current parent need this timeslot? */
+  if(timeslot == get_node_timeslot(&orchestra_parent_linkaddr)) {
+    /* Yes, this timeslot is being used, return */
+    return;
+  }
+  /* Does any other child need this timeslot?
+   * (lookup all route next hops) */
+  nbr_table_item_t *item = nbr_table_head(nbr_routes);
+  while(item != NULL) {
+    linkaddr_t *addr = nbr_table_get_lladdr(nbr_routes, item);
+    if(timeslot == get_node_timeslot(addr)) {
+      /* Yes, this timeslot is being used, return */
+      return;
+    }
+    item = nbr_table_next(nbr_routes, item);
+  }
+  tsch_schedule_remove_link(sf_unicast, l);
+}
+/*---------------------------------------------------------------------------*/
+/* Is this extra link still needed? */
+static int
+extra_link_is_needed(const struct tsch_link *l)
+{
+  int i;
+  int count;
+  const linkaddr_t *child;
+
+  if(linkaddr_cmp(&l->addr, &orchestra_parent_linkaddr)) {
+    /* Tx to our parent, in our own extra cells */
+    child = &linkaddr_node_addr;
+    count = own_extra_cells();
+  } else {
+    /* Rx from a child, in its extra cells */
+    child = &l->addr;
+    count = child_extra_cells(child);
+  }
+  for(i = 1; i <= count; i++) {
+    if(get_extra_timeslot(child, i) == l->timeslot) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_extra_link(const linkaddr_t *addr, uint8_t link_options, uint16_t timeslot)
+{
+  struct tsch_link *l;
+  /* Keep any link already at this timeslot. If it is our Rx link or the
+   * extra cell of another child, we listen there anyway */
+  if(tsch_schedule_get_link_by_timeslot(sf_unicast, timeslot) == NULL) {
+    l = tsch_schedule_add_link(sf_unicast, link_options, LINK_TYPE_NORMAL,
+                               addr, timeslot, channel_offset);
+    if(l != NULL) {
+      l->data = (void *)&extra_link_tag;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Bring the extra links in line with the current subtree sizes */
+static void
+update_extra_links(void)
+{
+  int i;
+  int count;
+  struct tsch_link *l;
+  struct tsch_link *next;
+  nbr_table_item_t *item;
+
+  if(sf_unicast == NULL) {
+    return;
+  }
+
+  /* Remove the extra links no longer needed */
+  l = tsch_schedule_get_link_next(sf_unicast, NULL);
+  while(l != NULL) {
+    next = tsch_schedule_get_link_next(sf_unicast, l);
+    if(IS_EXTRA_LINK(l) && !extra_link_is_needed(l)) {
+      tsch_schedule_remove_link(sf_unicast, l);
+    }
+    l = next;
+  }
+
+  /* Tx to our parent */
+  count = own_extra_cells();
+  for(i = 1; i <= count; i++) {
+    add_extra_link(&orchestra_parent_linkaddr, LINK_OPTION_TX | LINK_OPTION_SHARED,
+                   get_extra_timeslot(&linkaddr_node_addr, i));
+  }
+
+  /* Rx from our children */
+  item = nbr_table_head(nbr_routes);
+  while(item != NULL) {
+    linkaddr_t *addr = nbr_table_get_lladdr(nbr_routes, item);
+    count = child_extra_cells(addr);
+    for(i = 1; i <= count; i++) {
+      add_extra_link(addr, LINK_OPTION_RX, get_extra_timeslot(addr, i));
+    }
+    item = nbr_table_next(nbr_routes, item);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_timer_callback(void *ptr)
+{
+  update_extra_links();
+  ctimer_reset(&update_timer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+child_added(const linkaddr_t *linkaddr)
+{
+  add_uc_link(linkaddr);
+  update_extra_links();
+}
+/*---------------------------------------------------------------------------*/
+static void
+child_removed(const linkaddr_t *linkaddr)
+{
+  remove_uc_link(linkaddr);
+  update_extra_links();
+}
+/*---------------------------------------------------------------------------*/
+static int
+select_packet(uint16_t *slotframe, uint16_t *timeslot)
+{
+  /* Select data packets we have a unicast link to */
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_DATAFRAME
+     && neighbor_has_uc_link(dest)) {
+    if(slotframe != NULL) {
+#if ORCHESTRA_ADAPTIVE_QUEUE_THRESHOLD
+      if(tsch_queue_packet_count(dest) >= ORCHESTRA_ADAPTIVE_QUEUE_THRESHOLD) {
+        /* Backlog: let the packet go in any slotframe */
+        *slotframe = 0xffff;
+      } else
+#endif /* ORCHESTRA_ADAPTIVE_QUEUE_THRESHOLD */
+      {
+        *slotframe = slotframe_handle;
+      }
+    }
+    if(timeslot != NULL) {
+      if(linkaddr_cmp(dest, &orchestra_parent_linkaddr) && own_extra_cells() > 0) {
+        /* Any of our cells to the parent */
+        *timeslot = 0xffff;
+      } else {
+        *timeslot = get_node_timeslot(dest);
+      }
+    }
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new)
+{
+  if(new != old) {
+    const linkaddr_t *new_addr = new != NULL ? &new->addr : NULL;
+    if(new_addr != NULL) {
+      linkaddr_copy(&orchestra_parent_linkaddr, new_addr);
+    } else {
+      linkaddr_copy(&orchestra_parent_linkaddr, &linkaddr_null);
+    }
+    remove_uc_link(new_addr);
+    add_uc_link(new_addr);
+    /* Drops the extra cells to the former parent */
+    update_extra_links();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(uint16_t sf_handle)
+{
+  slotframe_handle = sf_handle;
+  channel_offset = sf_handle;
+  /* Slotframe for unicast transmissions */
+  sf_unicast = tsch_schedule_add_slotframe(slotframe_handle, ORCHESTRA_UNICAST_PERIOD);
+  uint16_t timeslot = get_node_timeslot(&linkaddr_node_addr);
+  tsch_schedule_add_link(sf_unicast, LINK_OPTION_RX,
+            LINK_TYPE_NORMAL, &tsch_broadcast_address,
+            timeslot, channel_offset);
+  /* Subtree sizes change with DAOs, track them */
+  ctimer_set(&update_timer, ORCHESTRA_ADAPTIVE_UPDATE_PERIOD, update_timer_callback, NULL);
+}
+/*---------------------------------------------------------------------------*/
+struct orchestra_rule unicast_adaptive = {
+  init,
+  new_time_source,
+  select_packet,
+  child_added,
+  child_removed,
+};
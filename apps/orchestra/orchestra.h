@@ -54,6 +54,7 @@ struct orchestra_rule {
 
 struct orchestra_rule eb_per_time_source;
 struct orchestra_rule unicast_per_neighbor;
+struct orchestra_rule unicast_adaptive;
 struct orchestra_rule default_common;
 
 extern linkaddr_t orchestra_parent_linkaddr;
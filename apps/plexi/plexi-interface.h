@@ -82,6 +82,14 @@
  * \brief subresource URL of the last moment the neighbor sent a packet
  */
 #define NEIGHBORS_ASN_LABEL "asn"
+/** \def NEIGHBORS_AIRTIME_LABEL
+ * \brief subresource URL of the milliseconds spent sending to the neighbor (requires LINK_STATS_CONF_ENABLED)
+ */
+#define NEIGHBORS_AIRTIME_LABEL "airtime"
+/** \def NEIGHBORS_TX_LABEL
+ * \brief subresource URL of the number of frames sent to the neighbor, retransmissions included (requires LINK_STATS_CONF_ENABLED)
+ */
+#define NEIGHBORS_TX_LABEL "tx"
 #endif
 
 #if PLEXI_WITH_NEIGHBOR_RESOURCE || PLEXI_WITH_LINK_RESOURCE
@@ -171,4 +179,29 @@
 #define QUEUE_TXLEN_LABEL "txlen"
 #endif
 
+/* when the 6top resource is enabled, the 6top URI and its labels are defined */
+#if PLEXI_WITH_SIXTOP_RESOURCE
+#define SIXTOP_RESOURCE "6top/sf"
+#define SIXTOP_SFID_LABEL "sfid"
+#define SIXTOP_TX_LABEL "tx"
+#define SIXTOP_RX_LABEL "rx"
+#define SIXTOP_USAGE_LABEL "usage"
+#define SIXTOP_ADD_LABEL "add"
+#define SIXTOP_DELETE_LABEL "del"
+#define SIXTOP_CLEAR_LABEL "clear"
+#define SIXTOP_FAIL_LABEL "fail"
+#endif
+
+/* when the timing resource is enabled, the timing URI and its labels are defined */
+#if PLEXI_WITH_TIMING_RESOURCE
+#define TIMING_RESOURCE "6top/timing"
+#define TIMING_WIDTH_LABEL "width"
+#define TIMING_DROP_LABEL "drop"
+#define TIMING_COUNT_LABEL "n"
+#define TIMING_MIN_LABEL "min"
+#define TIMING_MAX_LABEL "max"
+#define TIMING_AVG_LABEL "avg"
+#define TIMING_HIST_LABEL "hist"
+#endif
+
 #endif
@@ -82,10 +82,24 @@ uint8_t plexi_reply_tna_if_possible(const linkaddr_t *tna, uint8_t *buffer, size
  *   - \code{http} GET /LINK_RESOURCE?LINK_ID_LABEL=8 -> a json link object with specific identifier e.g. {LINK_ID_LABEL:8,FRAME_ID_LABEL:1,LINK_SLOT_LABEL:3,LINK_CHANNEL_LABEL:5,LINK_OPTION_LABEL:0,LINK_TYPE_LABEL:0}\endcode
  * - subresources and queries. If subresources is included in the resource path together with the queries, the response includes the values of the given subresource of those link objects selected by the queries. Any of the subresources presented above may be used. The returned values will be included in a json array, even if a link is uniquely identified by a query triplet.
  *
+ * Replies that only depend on the schedule carry the schedule version as ETag (see plexi_reply_schedule_etag()). A GET with the
+ * ETag of the current schedule returns 2.03 Valid without payload. Statistics change while the schedule does not, so replies
+ * including them have no ETag. Instead, \code{http} GET /LINK_RESOURCE/LINK_STATS_LABEL \endcode can be observed and is
+ * notified every \ref PLEXI_LINK_STATS_UPDATE_INTERVAL.
+ * Requests accepting application/cbor get the compact form of plexi_get_links_cbor().
  *
  * \sa apps/rest-engine/rest-engine.h for more information on the handler signatures
  */
 static void plexi_get_links_handler(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset);
+
+/**
+ * \brief Compact form of GET /LINK_RESOURCE, served when the request accepts application/cbor.
+ *
+ * The reply is a CBOR array with one [id, slotframe, slotoffset, channeloffset, option, type] array per link, e.g.
+ * [[8,1,3,5,0,0],[9,3,4,5,1,0]]. Links with a target node address carry it as a seventh item, a byte string.
+ * Subresources, queries and statistics are only supported in json.
+ */
+static void plexi_get_links_cbor(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset);
 /** \brief Deletes an existing link upon a CoAP DEL request and returns the deleted objects.
  *
  * Handler to request the deletion of all links or specific ones via a query:
@@ -157,12 +171,24 @@ static uint16_t new_tx_timeslot = 0;
  *  }
  * \endcode
  */
+#if PLEXI_WITH_LINK_STATISTICS
+static void plexi_links_periodic_handler(void);
+PARENT_PERIODIC_RESOURCE(resource_6top_links,    /* name */
+                         "title=\"6top links\";obs", /* attributes */
+                         plexi_get_links_handler, /* GET handler */
+                         plexi_post_links_handler, /* POST handler */
+                         NULL,   /* PUT handler */
+                         plexi_delete_links_handler, /* DELETE handler */
+                         PLEXI_LINK_STATS_UPDATE_INTERVAL,
+                         plexi_links_periodic_handler);
+#else
 PARENT_RESOURCE(resource_6top_links,    /* name */
                 "title=\"6top links\"", /* attributes */
                 plexi_get_links_handler, /* GET handler */
                 plexi_post_links_handler, /* POST handler */
                 NULL,   /* PUT handler */
                 plexi_delete_links_handler); /* DELETE handler */
+#endif
 
 void
 plexi_reply_link_if_possible(const struct tsch_link *link, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset)
@@ -284,6 +310,17 @@ plexi_get_links_handler(void *request, void *response, uint8_t *buffer, uint16_t
       uri_len = (int)(base_len + 1 + strlen(LINK_STATS_LABEL));
       uri_subresource = LINK_STATS_LABEL;
     }
+#if PLEXI_WITH_LINK_STATISTICS
+    /* complete link objects embed their statistics, which change without the schedule changing */
+    if(*uri_subresource && strcmp(LINK_STATS_LABEL, uri_subresource)
+       && plexi_reply_schedule_etag(request, response, REST.type.APPLICATION_JSON, offset)) {
+      return;
+    }
+#else
+    if(plexi_reply_schedule_etag(request, response, REST.type.APPLICATION_JSON, offset)) {
+      return;
+    }
+#endif
     struct tsch_slotframe *slotframe = (struct tsch_slotframe *)tsch_schedule_get_slotframe_next(NULL);
     int first_item = 1;
     while(slotframe) {
@@ -378,12 +415,81 @@ plexi_get_links_handler(void *request, void *response, uint8_t *buffer, uint16_t
       coap_set_payload(response, "No specified statistics resource not found", 42);
       return;
     }
+  } else if(accept == REST.type.APPLICATION_CBOR) {
+    plexi_get_links_cbor(request, response, buffer, bufsize, offset);
   } else {
     coap_set_status_code(response, NOT_ACCEPTABLE_4_06);
     return;
   }
 }
 
+static void
+plexi_get_links_cbor(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset)
+{
+  size_t strpos = 0;
+  size_t bufpos = 0;
+  const char *uri_path = NULL;
+  const char *query = NULL;
+  struct tsch_slotframe *slotframe;
+  struct tsch_link *link;
+  uint16_t count = 0;
+  uint8_t has_tna;
+
+  if(REST.get_url(request, &uri_path) > strlen(resource_6top_links.url) + 1 || REST.get_query(request, &query) > 0) {
+    coap_set_status_code(response, NOT_IMPLEMENTED_5_01);
+    coap_set_payload(response, "CBOR only on the complete link list", 35);
+    return;
+  }
+  if(plexi_reply_schedule_etag(request, response, REST.type.APPLICATION_CBOR, offset)) {
+    return;
+  }
+  for(slotframe = tsch_schedule_get_slotframe_next(NULL); slotframe; slotframe = tsch_schedule_get_slotframe_next(slotframe)) {
+    for(link = tsch_schedule_get_link_next(slotframe, NULL); link; link = tsch_schedule_get_link_next(slotframe, link)) {
+      count++;
+    }
+  }
+  plexi_reply_cbor_head_if_possible(PLEXI_CBOR_ARRAY, count, buffer, &bufpos, bufsize, &strpos, offset);
+  for(slotframe = tsch_schedule_get_slotframe_next(NULL); slotframe; slotframe = tsch_schedule_get_slotframe_next(slotframe)) {
+    for(link = tsch_schedule_get_link_next(slotframe, NULL); link; link = tsch_schedule_get_link_next(slotframe, link)) {
+      has_tna = !linkaddr_cmp(&link->addr, &linkaddr_null);
+      plexi_reply_cbor_head_if_possible(PLEXI_CBOR_ARRAY, has_tna ? 7 : 6, buffer, &bufpos, bufsize, &strpos, offset);
+      plexi_reply_cbor_head_if_possible(PLEXI_CBOR_UINT, link->handle, buffer, &bufpos, bufsize, &strpos, offset);
+      plexi_reply_cbor_head_if_possible(PLEXI_CBOR_UINT, link->slotframe_handle, buffer, &bufpos, bufsize, &strpos, offset);
+      plexi_reply_cbor_head_if_possible(PLEXI_CBOR_UINT, link->timeslot, buffer, &bufpos, bufsize, &strpos, offset);
+      plexi_reply_cbor_head_if_possible(PLEXI_CBOR_UINT, link->channel_offset, buffer, &bufpos, bufsize, &strpos, offset);
+      plexi_reply_cbor_head_if_possible(PLEXI_CBOR_UINT, link->link_options, buffer, &bufpos, bufsize, &strpos, offset);
+      plexi_reply_cbor_head_if_possible(PLEXI_CBOR_UINT, link->link_type, buffer, &bufpos, bufsize, &strpos, offset);
+      if(has_tna) {
+        plexi_reply_cbor_bytes_if_possible(link->addr.u8, LINKADDR_SIZE, buffer, &bufpos, bufsize, &strpos, offset);
+      }
+    }
+  }
+  if(bufpos > 0) {
+    REST.set_header_content_type(response, REST.type.APPLICATION_CBOR);
+    REST.set_response_payload(response, buffer, bufpos);
+  } else {
+    coap_set_status_code(response, BAD_OPTION_4_02);
+    coap_set_payload(response, "BlockOutOfScope", 15);
+  }
+  if(strpos <= *offset + bufsize) {
+    *offset = -1;
+  } else {
+    *offset += bufsize;
+  }
+}
+
+#if PLEXI_WITH_LINK_STATISTICS
+/**
+ * \brief Notifies the observers of the link statistics every PLEXI_LINK_STATS_UPDATE_INTERVAL.
+ * Observers of the other link subresources are only answered on request.
+ */
+static void
+plexi_links_periodic_handler(void)
+{
+  coap_notify_observers_sub(&resource_6top_links, "/" LINK_STATS_LABEL);
+}
+#endif
+
 static void
 plexi_delete_links_handler(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset)
 {
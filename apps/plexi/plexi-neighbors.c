@@ -54,6 +54,7 @@
 
 #include "er-coap-engine.h"
 #include "net/ip/uip-debug.h"
+#include "net/link-stats.h"
 
 #ifndef PLEXI_NEIGHBOR_UPDATE_INTERVAL
 /**
@@ -94,6 +95,15 @@ void aggregate_statistics(uint16_t id, uint8_t metric, plexi_stats_value_st valu
 
 #endif
 
+#if LINK_STATS_ENABLED
+/**
+ * \brief Replies with the airtime or the frames sent to a neighbor, as kept by the link-stats module.
+ * \param label \ref NEIGHBORS_AIRTIME_LABEL or \ref NEIGHBORS_TX_LABEL to reply with that value alone, or NULL to append both
+ *        as fields of the neighbor object
+ */
+static void plexi_reply_link_stats_if_possible(const linkaddr_t *lla, const char *label, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset);
+#endif
+
 /**
  * \brief Notifies subscribers to neighbor list of any changes in the neighbor list.
  *
@@ -110,6 +120,8 @@ static void plexi_neighbors_event_handler(void);
  *   - else if \ref PLEXI_WITH_LINK_STATISTICS is set: \code{http} GET /NEIGHBORS_RESOURCE -> e.g. [ {NEIGHBORS_TNA_LABEL: "215:8d00:57:6466",STATS_PDR_LABEL:89}, {NEIGHBORS_TNA_LABEL: "215:8d00:57:64a2",STATS_ETX_LABEL:2,STATS_RSSI_LABEL:-50} ] \endcode
  *   Note that each neighbor may have different metrics according to the statistics configuration installed in each link with that neighbor.
  *   All of the following are possible: \ref STATS_ETX_LABEL, \ref STATS_PDR_LABEL, \ref STATS_RSSI_LABEL, \ref STATS_LQI_LABEL, \ref NEIGHBORS_ASN_LABEL.
+ *   If LINK_STATS_CONF_ENABLED is set, every neighbor sent to also has \ref NEIGHBORS_AIRTIME_LABEL and \ref NEIGHBORS_TX_LABEL,
+ *   which are also available as subresources.
  * - subresources returning json arrays with the values of the specified subresource for all neighbors:
  *   - \code{http} GET /NEIGHBORS_RESOURCE/NEIGHBORS_TNA_LABEL -> a json array of EUI-64 IP addresses (one per neighbor) e.g. ["215:8d00:57:6466","215:8d00:57:64a2"] \endcode
  *   - if \ref PLEXI_WITH_LINK_STATISTICS is set: \code{http} GET /NEIGHBORS_RESOURCE/STATS_RSSI_LABEL -> a json array of slotframe RSSI values per neighbor e.g. [-50] \endcode
@@ -209,15 +221,23 @@ plexi_get_neighbors_handler(void *request, void *response, uint8_t *buffer, uint
         && strcmp(STATS_LQI_LABEL, uri_subresource) \
         && strcmp(STATS_ETX_LABEL, uri_subresource) \
         && strcmp(STATS_PDR_LABEL, uri_subresource) \
-        && strcmp(NEIGHBORS_ASN_LABEL, uri_subresource) \
+        && strcmp(NEIGHBORS_ASN_LABEL, uri_subresource)
+#if LINK_STATS_ENABLED
+        && strcmp(NEIGHBORS_AIRTIME_LABEL, uri_subresource)
+        && strcmp(NEIGHBORS_TX_LABEL, uri_subresource)
+#endif
         ) || (query && !query_value)) {
       coap_set_status_code(response, BAD_REQUEST_4_00);
       coap_set_payload(response, "Supports only queries on neighbor address", 41);
       return;
     }
 #else
-    if((uri_len > base_len + 1 && strcmp(NEIGHBORS_TNA_LABEL, uri_subresource)) \
-       || (query && !query_value)) {
+    if((uri_len > base_len + 1 && strcmp(NEIGHBORS_TNA_LABEL, uri_subresource)
+#if LINK_STATS_ENABLED
+        && strcmp(NEIGHBORS_AIRTIME_LABEL, uri_subresource)
+        && strcmp(NEIGHBORS_TX_LABEL, uri_subresource)
+#endif
+       ) || (query && !query_value)) {
       coap_set_status_code(response, BAD_REQUEST_4_00);
       coap_set_payload(response, "Supports only queries on neighbor address", 41);
       return;
@@ -313,7 +333,14 @@ plexi_get_neighbors_handler(void *request, void *response, uint8_t *buffer, uint
               plexi_reply_hex_if_possible(temp_aggregate_stats.asn, buffer, &bufpos, bufsize, &strpos, offset,1);
               plexi_reply_char_if_possible('\"', buffer, &bufpos, bufsize, &strpos, offset);
             }
+#if LINK_STATS_ENABLED
+            plexi_reply_link_stats_if_possible(lla, NULL, buffer, &bufpos, bufsize, &strpos, offset);
+#endif
             plexi_reply_char_if_possible('}', buffer, &bufpos, bufsize, &strpos, offset);
+#if LINK_STATS_ENABLED
+          } else {
+            plexi_reply_link_stats_if_possible(lla, uri_subresource, buffer, &bufpos, bufsize, &strpos, offset);
+#endif
           }
 #else
           if(base_len == uri_len) {
@@ -321,7 +348,15 @@ plexi_get_neighbors_handler(void *request, void *response, uint8_t *buffer, uint
             plexi_reply_string_if_possible(NEIGHBORS_TNA_LABEL, buffer, &bufpos, bufsize, &strpos, offset);
             plexi_reply_string_if_possible("\":\"", buffer, &bufpos, bufsize, &strpos, offset);
             plexi_reply_lladdr_if_possible(lla, buffer, &bufpos, bufsize, &strpos, offset);
-            plexi_reply_string_if_possible("\"}", buffer, &bufpos, bufsize, &strpos, offset);
+            plexi_reply_char_if_possible('"', buffer, &bufpos, bufsize, &strpos, offset);
+#if LINK_STATS_ENABLED
+            plexi_reply_link_stats_if_possible(lla, NULL, buffer, &bufpos, bufsize, &strpos, offset);
+#endif
+            plexi_reply_char_if_possible('}', buffer, &bufpos, bufsize, &strpos, offset);
+#if LINK_STATS_ENABLED
+          } else {
+            plexi_reply_link_stats_if_possible(lla, uri_subresource, buffer, &bufpos, bufsize, &strpos, offset);
+#endif
           }
 #endif
         }
@@ -350,6 +385,36 @@ plexi_get_neighbors_handler(void *request, void *response, uint8_t *buffer, uint
   }
 }
 
+#if LINK_STATS_ENABLED
+static void
+plexi_reply_link_stats_if_possible(const linkaddr_t *lla, const char *label, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset)
+{
+  const struct link_stats *stats = link_stats_from_lladdr(lla);
+  char value[11];
+
+  if(stats == NULL) {
+    return;
+  }
+  if(label == NULL || !strcmp(NEIGHBORS_AIRTIME_LABEL, label)) {
+    if(label == NULL) {
+      plexi_reply_string_if_possible(",\"", buffer, bufpos, bufsize, strpos, offset);
+      plexi_reply_string_if_possible(NEIGHBORS_AIRTIME_LABEL, buffer, bufpos, bufsize, strpos, offset);
+      plexi_reply_string_if_possible("\":", buffer, bufpos, bufsize, strpos, offset);
+    }
+    snprintf(value, sizeof(value), "%lu", (unsigned long)(stats->tx_airtime / 1000));
+    plexi_reply_string_if_possible(value, buffer, bufpos, bufsize, strpos, offset);
+  }
+  if(label == NULL || !strcmp(NEIGHBORS_TX_LABEL, label)) {
+    if(label == NULL) {
+      plexi_reply_string_if_possible(",\"", buffer, bufpos, bufsize, strpos, offset);
+      plexi_reply_string_if_possible(NEIGHBORS_TX_LABEL, buffer, bufpos, bufsize, strpos, offset);
+      plexi_reply_string_if_possible("\":", buffer, bufpos, bufsize, strpos, offset);
+    }
+    snprintf(value, sizeof(value), "%lu", (unsigned long)stats->tx_frames);
+    plexi_reply_string_if_possible(value, buffer, bufpos, bufsize, strpos, offset);
+  }
+}
+#endif
 /**
  * \brief Notifies periodically all clients who observe the neighbor list resource
  */
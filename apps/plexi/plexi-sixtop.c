@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2017, Technische Universiteit Eindhoven.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file
+ *         PLEXI 6top resource interface (implementation file)
+ *
+ * \brief  6top resource provides read only access to the state of the 6top
+ *         scheduling function (see apps/sixtop).
+ *
+ * \details The cells negotiated with 6P and the decisions of the scheduling
+ *         function so far. The cells themselves are in the TSCH link resource.
+ *
+ */
+
+#include "plexi-interface.h"
+
+#include "plexi.h"
+#include "sixtop.h"
+
+#include "er-coap-engine.h"
+#include "net/ip/uip-debug.h"
+
+/**
+ * \brief Retrieves the 6top statistics upon a CoAP GET request to the 6top resource.
+ *
+ * \code{http} GET /SIXTOP_RESOURCE -> e.g. {SIXTOP_SFID_LABEL:0,SIXTOP_TX_LABEL:3,SIXTOP_RX_LABEL:2,SIXTOP_USAGE_LABEL:80,SIXTOP_ADD_LABEL:4,SIXTOP_DELETE_LABEL:1,SIXTOP_CLEAR_LABEL:0,SIXTOP_FAIL_LABEL:1} \endcode
+ *
+ * \sa apps/rest-engine/rest-engine.h for more information on the handler signatures
+ */
+static void plexi_get_sixtop_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+/**
+ * \brief 6top resource to GET the cell counts, last cell usage and request counters of the scheduling function.
+ */
+PARENT_RESOURCE(resource_6top_sf,                  /* name */
+                         "title=\"6top SF\"",      /* attributes */
+                         plexi_get_sixtop_handler, /* GET handler */
+                         NULL,                     /* POST handler */
+                         NULL,                     /* PUT handler */
+                         NULL);                    /* DELETE handler */
+
+static void
+reply_field_if_possible(char *label, uint16_t value, uint8_t first, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset)
+{
+  plexi_reply_string_if_possible(first ? "{\"" : ",\"", buffer, bufpos, bufsize, strpos, offset);
+  plexi_reply_string_if_possible(label, buffer, bufpos, bufsize, strpos, offset);
+  plexi_reply_string_if_possible("\":", buffer, bufpos, bufsize, strpos, offset);
+  plexi_reply_uint16_if_possible(value, buffer, bufpos, bufsize, strpos, offset);
+}
+
+static void
+plexi_get_sixtop_handler(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset)
+{
+  unsigned int accept = -1;
+  REST.get_header_accept(request, &accept);
+  if(accept == -1 || accept == REST.type.APPLICATION_JSON) {
+    size_t strpos = 0;            /* position in overall string (which is larger than the buffer) */
+    size_t bufpos = 0;            /* position within buffer (bytes written) */
+    const struct sixtop_msf_stats *stats = sixtop_msf_get_stats();
+
+    reply_field_if_possible(SIXTOP_SFID_LABEL, sixtop_msf.sfid, 1, buffer, &bufpos, bufsize, &strpos, offset);
+    reply_field_if_possible(SIXTOP_TX_LABEL, stats->num_tx_cells, 0, buffer, &bufpos, bufsize, &strpos, offset);
+    reply_field_if_possible(SIXTOP_RX_LABEL, stats->num_rx_cells, 0, buffer, &bufpos, bufsize, &strpos, offset);
+    reply_field_if_possible(SIXTOP_USAGE_LABEL, stats->last_usage, 0, buffer, &bufpos, bufsize, &strpos, offset);
+    reply_field_if_possible(SIXTOP_ADD_LABEL, stats->adds, 0, buffer, &bufpos, bufsize, &strpos, offset);
+    reply_field_if_possible(SIXTOP_DELETE_LABEL, stats->deletes, 0, buffer, &bufpos, bufsize, &strpos, offset);
+    reply_field_if_possible(SIXTOP_CLEAR_LABEL, stats->clears, 0, buffer, &bufpos, bufsize, &strpos, offset);
+    reply_field_if_possible(SIXTOP_FAIL_LABEL, stats->failures, 0, buffer, &bufpos, bufsize, &strpos, offset);
+    plexi_reply_char_if_possible('}', buffer, &bufpos, bufsize, &strpos, offset);
+
+    if(bufpos > 0) {
+      /* Build the header of the reply */
+      REST.set_header_content_type(response, REST.type.APPLICATION_JSON);
+      /* Build the payload of the reply */
+      REST.set_response_payload(response, buffer, bufpos);
+    } else if(strpos > 0) {
+      coap_set_status_code(response, BAD_OPTION_4_02);
+      coap_set_payload(response, "BlockOutOfScope", 15);
+    }
+    if(strpos < *offset + bufsize) {
+      *offset = -1;
+    } else {
+      *offset += bufsize;
+    }
+  } else {
+    coap_set_status_code(response, NOT_ACCEPTABLE_4_06);
+    return;
+  }
+}
@@ -67,12 +67,24 @@
  *   - \code{http} GET /FRAME_RESOURCE/FRAME_SLOTS_LABEL?FRAME_ID_LABEL=3 -> a json array with a single slotframe size e.g. [101]\endcode
  *   - \code{http} GET /FRAME_RESOURCE/FRAME_ID_LABEL?FRAME_SLOTS_LABEL=101 -> a json array of identifiers of all slotframes of specific size e.g. [3]\endcode
  *
+ * Replies carry the schedule version as ETag (see plexi_reply_schedule_etag()). A GET with the ETag of the
+ * current schedule returns 2.03 Valid without payload. Requests accepting application/cbor get the compact
+ * form of plexi_get_slotframe_cbor().
+ *
  * \note This handler does not support two query key-value pairs at the same request
  *
  * \sa apps/rest-engine/rest-engine.h for more information on the handler signatures
  */
 static void plexi_get_slotframe_handler(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset);
 
+/**
+ * \brief Compact form of GET /FRAME_RESOURCE, served when the request accepts application/cbor.
+ *
+ * The reply is a CBOR array with one [handle, slots] array per slotframe, e.g. [[1,13],[3,101]].
+ * Subresources and queries are only supported in json.
+ */
+static void plexi_get_slotframe_cbor(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset);
+
 /**
  * \brief Installs a new TSCH slotframe upon a CoAP POST request and returns a success/failure flag.
  *
@@ -194,6 +206,9 @@ plexi_get_slotframe_handler(void *request, void *response, uint8_t *buffer, uint
       coap_set_payload(response, "Supports only slot frame id XOR size as subresource or query", 60);
       return;
     }
+    if(plexi_reply_schedule_etag(request, response, REST.type.APPLICATION_JSON, offset)) {
+      return;
+    }
     /* iterate over all slotframes to pick the ones specified by the query */
     int item_counter = 0;
     plexi_reply_char_if_possible('[', buffer, &bufpos, bufsize, &strpos, offset);
@@ -249,12 +264,55 @@ plexi_get_slotframe_handler(void *request, void *response, uint8_t *buffer, uint
       coap_set_payload(response, "No slotframe was found", 22);
       return;
     }
-  } else { /* if the client accepts a response payload format other than json, return 406 */
+  } else if(accept == REST.type.APPLICATION_CBOR) {
+    plexi_get_slotframe_cbor(request, response, buffer, bufsize, offset);
+  } else { /* if the client accepts a response payload format other than json or cbor, return 406 */
     coap_set_status_code(response, NOT_ACCEPTABLE_4_06);
     return;
   }
 }
 
+static void
+plexi_get_slotframe_cbor(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset)
+{
+  size_t strpos = 0;
+  size_t bufpos = 0;
+  const char *uri_path = NULL;
+  const char *query = NULL;
+  struct tsch_slotframe *slotframe;
+  uint16_t count = 0;
+
+  if(REST.get_url(request, &uri_path) > strlen(resource_6top_slotframe.url) + 1 || REST.get_query(request, &query) > 0) {
+    coap_set_status_code(response, NOT_IMPLEMENTED_5_01);
+    coap_set_payload(response, "CBOR only on the complete slotframe list", 40);
+    return;
+  }
+  if(plexi_reply_schedule_etag(request, response, REST.type.APPLICATION_CBOR, offset)) {
+    return;
+  }
+  for(slotframe = tsch_schedule_get_slotframe_next(NULL); slotframe; slotframe = tsch_schedule_get_slotframe_next(slotframe)) {
+    count++;
+  }
+  plexi_reply_cbor_head_if_possible(PLEXI_CBOR_ARRAY, count, buffer, &bufpos, bufsize, &strpos, offset);
+  for(slotframe = tsch_schedule_get_slotframe_next(NULL); slotframe; slotframe = tsch_schedule_get_slotframe_next(slotframe)) {
+    plexi_reply_cbor_head_if_possible(PLEXI_CBOR_ARRAY, 2, buffer, &bufpos, bufsize, &strpos, offset);
+    plexi_reply_cbor_head_if_possible(PLEXI_CBOR_UINT, slotframe->handle, buffer, &bufpos, bufsize, &strpos, offset);
+    plexi_reply_cbor_head_if_possible(PLEXI_CBOR_UINT, slotframe->size.val, buffer, &bufpos, bufsize, &strpos, offset);
+  }
+  if(bufpos > 0) {
+    REST.set_header_content_type(response, REST.type.APPLICATION_CBOR);
+    REST.set_response_payload(response, buffer, bufpos);
+  } else {
+    coap_set_status_code(response, BAD_OPTION_4_02);
+    coap_set_payload(response, "BlockOutOfScope", 15);
+  }
+  if(strpos <= *offset + bufsize) {
+    *offset = -1;
+  } else {
+    *offset += bufsize;
+  }
+}
+
 static void
 plexi_post_slotframe_handler(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset)
 {
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2017, Technische Universiteit Eindhoven.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file
+ *         PLEXI TSCH timing resource interface (implementation file)
+ *
+ * \brief  Timing resource provides access to the timing histograms of the
+ *         TSCH slot operation (see core/net/mac/tsch/tsch-timing.h).
+ *
+ * \details For each traced event: number of records, minimum, maximum and
+ *         average offset from the nominal time, and histogram, in usec.
+ *         Used to tune TSCH_CONF_RX_WAIT and the guard times of a platform.
+ *
+ */
+
+#include "plexi-interface.h"
+
+#include "plexi.h"
+#include "net/mac/tsch/tsch-timing.h"
+
+#include "er-coap-engine.h"
+#include "net/ip/uip-debug.h"
+
+/**
+ * \brief Retrieves the timing histograms upon a CoAP GET request to the timing resource.
+ *
+ * \code{http} GET /TIMING_RESOURCE -> e.g. {TIMING_WIDTH_LABEL:50,TIMING_DROP_LABEL:0,"rx":{TIMING_COUNT_LABEL:120,TIMING_MIN_LABEL:-92,TIMING_MAX_LABEL:61,TIMING_AVG_LABEL:-3,TIMING_HIST_LABEL:[0,0,0,0,0,0,2,31,80,7,0,0,0,0,0,0]},...} \endcode
+ *
+ * \sa apps/rest-engine/rest-engine.h for more information on the handler signatures
+ */
+static void plexi_get_timing_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+/**
+ * \brief Clears the timing histograms upon a CoAP DELETE request to the timing resource.
+ */
+static void plexi_delete_timing_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+/**
+ * \brief Timing resource to GET or clear the timing histograms of the TSCH slot operation.
+ */
+PARENT_RESOURCE(resource_tsch_timing,                 /* name */
+                         "title=\"TSCH timing\"",     /* attributes */
+                         plexi_get_timing_handler,    /* GET handler */
+                         NULL,                        /* POST handler */
+                         NULL,                        /* PUT handler */
+                         plexi_delete_timing_handler); /* DELETE handler */
+
+static void
+reply_label_if_possible(char *label, uint8_t first, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset)
+{
+  plexi_reply_string_if_possible(first ? "{\"" : ",\"", buffer, bufpos, bufsize, strpos, offset);
+  plexi_reply_string_if_possible(label, buffer, bufpos, bufsize, strpos, offset);
+  plexi_reply_string_if_possible("\":", buffer, bufpos, bufsize, strpos, offset);
+}
+
+static void
+reply_int_if_possible(int32_t value, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset)
+{
+  if(value < 0) {
+    plexi_reply_char_if_possible('-', buffer, bufpos, bufsize, strpos, offset);
+    value = -value;
+  }
+  plexi_reply_uint16_if_possible(MIN(value, 0xffff), buffer, bufpos, bufsize, strpos, offset);
+}
+
+static void
+reply_field_if_possible(char *label, int32_t value, uint8_t first, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset)
+{
+  reply_label_if_possible(label, first, buffer, bufpos, bufsize, strpos, offset);
+  reply_int_if_possible(value, buffer, bufpos, bufsize, strpos, offset);
+}
+
+static void
+plexi_get_timing_handler(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset)
+{
+  unsigned int accept = -1;
+  REST.get_header_accept(request, &accept);
+  if(accept == -1 || accept == REST.type.APPLICATION_JSON) {
+    size_t strpos = 0;            /* position in overall string (which is larger than the buffer) */
+    size_t bufpos = 0;            /* position within buffer (bytes written) */
+    int i, j;
+
+    tsch_timing_process_pending();
+    reply_field_if_possible(TIMING_WIDTH_LABEL, TSCH_TIMING_HIST_BIN_WIDTH, 1, buffer, &bufpos, bufsize, &strpos, offset);
+    reply_field_if_possible(TIMING_DROP_LABEL, tsch_timing_dropped(), 0, buffer, &bufpos, bufsize, &strpos, offset);
+    for(i = 0; i < tsch_timing_num_events; i++) {
+      const struct tsch_timing_hist *h = tsch_timing_get_hist(i);
+      if(h->count == 0) {
+        continue;
+      }
+      reply_label_if_possible((char *)tsch_timing_event_name(i), 0, buffer, &bufpos, bufsize, &strpos, offset);
+      reply_field_if_possible(TIMING_COUNT_LABEL, MIN(h->count, 0xffff), 1, buffer, &bufpos, bufsize, &strpos, offset);
+      reply_field_if_possible(TIMING_MIN_LABEL, h->min, 0, buffer, &bufpos, bufsize, &strpos, offset);
+      reply_field_if_possible(TIMING_MAX_LABEL, h->max, 0, buffer, &bufpos, bufsize, &strpos, offset);
+      reply_field_if_possible(TIMING_AVG_LABEL, h->sum / (int32_t)h->count, 0, buffer, &bufpos, bufsize, &strpos, offset);
+      reply_label_if_possible(TIMING_HIST_LABEL, 0, buffer, &bufpos, bufsize, &strpos, offset);
+      for(j = 0; j < TSCH_TIMING_HIST_BINS; j++) {
+        plexi_reply_char_if_possible(j == 0 ? '[' : ',', buffer, &bufpos, bufsize, &strpos, offset);
+        plexi_reply_uint16_if_possible(h->bins[j], buffer, &bufpos, bufsize, &strpos, offset);
+      }
+      plexi_reply_string_if_possible("]}", buffer, &bufpos, bufsize, &strpos, offset);
+    }
+    plexi_reply_char_if_possible('}', buffer, &bufpos, bufsize, &strpos, offset);
+
+    if(bufpos > 0) {
+      /* Build the header of the reply */
+      REST.set_header_content_type(response, REST.type.APPLICATION_JSON);
+      /* Build the payload of the reply */
+      REST.set_response_payload(response, buffer, bufpos);
+    } else if(strpos > 0) {
+      coap_set_status_code(response, BAD_OPTION_4_02);
+      coap_set_payload(response, "BlockOutOfScope", 15);
+    }
+    if(strpos < *offset + bufsize) {
+      *offset = -1;
+    } else {
+      *offset += bufsize;
+    }
+  } else {
+    coap_set_status_code(response, NOT_ACCEPTABLE_4_06);
+    return;
+  }
+}
+
+static void
+plexi_delete_timing_handler(void *request, void *response, uint8_t *buffer, uint16_t bufsize, int32_t *offset)
+{
+  tsch_timing_reset();
+  coap_set_status_code(response, DELETED_2_02);
+}
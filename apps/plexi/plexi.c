@@ -47,11 +47,13 @@
 
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include <errno.h>
 #include <inttypes.h>
 #include "net/rime/rime.h"
 #include "net/mac/tsch/tsch-schedule.h"
 #include "net/packetbuf.h"
+#include "lib/crc16.h"
 
 #define DEBUG DEBUG_PRINT
 #include "net/ip/uip-debug.h"
@@ -90,6 +92,16 @@ extern resource_t resource_6top_slotframe;
 extern resource_t resource_6top_links;
 #endif
 
+/* activate 6top module of plexi only when needed */
+#if PLEXI_WITH_SIXTOP_RESOURCE
+extern resource_t resource_6top_sf;
+#endif
+
+/* activate TSCH timing module of plexi only when needed */
+#if PLEXI_WITH_TIMING_RESOURCE
+extern resource_t resource_tsch_timing;
+#endif
+
 /* activate link quality monitoring module of plexi only when needed */
 #if PLEXI_WITH_LINK_STATISTICS
 #include "plexi-link-statistics.h"
@@ -231,6 +243,16 @@ plexi_init()
   PRINTF("  * TSCH links resource\n");
 #endif
 
+#if PLEXI_WITH_SIXTOP_RESOURCE
+  rest_activate_resource(&resource_6top_sf, SIXTOP_RESOURCE);
+  PRINTF("  * 6top scheduling function resource\n");
+#endif
+
+#if PLEXI_WITH_TIMING_RESOURCE
+  rest_activate_resource(&resource_tsch_timing, TIMING_RESOURCE);
+  PRINTF("  * TSCH timing resource\n");
+#endif
+
 #if PLEXI_WITH_LINK_STATISTICS
   plexi_link_statistics_init(); /* initialize plexi-link-statistics module */
   PRINTF("  * TSCH link statistics resource\n");
@@ -500,3 +522,93 @@ plexi_reply_ip_if_possible(const uip_ipaddr_t *addr, uint8_t *buffer, size_t *bu
 #endif /* NETSTACK_CONF_WITH_IPV6 */
   return 1;
 }
+
+uint8_t
+plexi_reply_cbor_head_if_possible(uint8_t major, uint32_t value, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset)
+{
+  int len;
+
+  major <<= 5;
+  if(value < 24) {
+    return plexi_reply_char_if_possible((char)(major | value), buffer, bufpos, bufsize, strpos, offset);
+  }
+  if(value <= 0xFF) {
+    plexi_reply_char_if_possible((char)(major | 24), buffer, bufpos, bufsize, strpos, offset);
+    len = 1;
+  } else if(value <= 0xFFFF) {
+    plexi_reply_char_if_possible((char)(major | 25), buffer, bufpos, bufsize, strpos, offset);
+    len = 2;
+  } else {
+    plexi_reply_char_if_possible((char)(major | 26), buffer, bufpos, bufsize, strpos, offset);
+    len = 4;
+  }
+  while(len-- > 0) {
+    plexi_reply_char_if_possible((char)(value >> (8 * len)), buffer, bufpos, bufsize, strpos, offset);
+  }
+  return *bufpos < bufsize;
+}
+
+uint8_t
+plexi_reply_cbor_bytes_if_possible(const uint8_t *bytes, uint16_t len, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset)
+{
+  uint16_t i;
+
+  plexi_reply_cbor_head_if_possible(PLEXI_CBOR_BYTES, len, buffer, bufpos, bufsize, strpos, offset);
+  for(i = 0; i < len; i++) {
+    plexi_reply_char_if_possible((char)bytes[i], buffer, bufpos, bufsize, strpos, offset);
+  }
+  return *bufpos < bufsize;
+}
+
+uint16_t
+plexi_schedule_version(void)
+{
+  struct tsch_slotframe *slotframe;
+  struct tsch_link *link;
+  uint8_t item[7];
+  uint16_t crc = 0;
+
+  for(slotframe = tsch_schedule_get_slotframe_next(NULL); slotframe;
+      slotframe = tsch_schedule_get_slotframe_next(slotframe)) {
+    item[0] = slotframe->handle & 0xFF;
+    item[1] = slotframe->size.val >> 8;
+    item[2] = slotframe->size.val & 0xFF;
+    crc = crc16_data(item, 3, crc);
+    for(link = tsch_schedule_get_link_next(slotframe, NULL); link;
+        link = tsch_schedule_get_link_next(slotframe, link)) {
+      item[0] = link->handle >> 8;
+      item[1] = link->handle & 0xFF;
+      item[2] = link->timeslot >> 8;
+      item[3] = link->timeslot & 0xFF;
+      item[4] = link->channel_offset & 0xFF;
+      item[5] = link->link_options;
+      item[6] = link->link_type;
+      crc = crc16_data(item, sizeof(item), crc);
+      crc = crc16_data(link->addr.u8, LINKADDR_SIZE, crc);
+    }
+  }
+  return crc;
+}
+
+uint8_t
+plexi_reply_schedule_etag(void *request, void *response, unsigned int format, int32_t *offset)
+{
+  const uint8_t *request_etag;
+  uint8_t etag[2];
+  uint16_t version;
+
+  /* One version per representation: JSON and CBOR replies of the same
+   * schedule must not validate each other */
+  version = crc16_add(format & 0xFF, plexi_schedule_version());
+  etag[0] = version >> 8;
+  etag[1] = version & 0xFF;
+  REST.set_header_etag(response, etag, sizeof(etag));
+  if(coap_get_header_etag(request, &request_etag) == sizeof(etag)
+     && !memcmp(request_etag, etag, sizeof(etag))) {
+    PRINTF("PLEXI: schedule unchanged since version %04x\n", version);
+    REST.set_response_status(response, REST.status.NOT_MODIFIED);
+    *offset = -1;
+    return 1;
+  }
+  return 0;
+}
@@ -119,6 +119,38 @@ uint8_t plexi_reply_uint16_if_possible(uint16_t d, uint8_t *buffer, size_t *bufp
 void plexi_reply_lladdr_if_possible(const linkaddr_t *lladdr, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset);
 uint8_t plexi_reply_ip_if_possible(const uip_ipaddr_t *addr, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset);
 
+/** \name CBOR major types (RFC 7049) used by the compact representations
+ * @{
+ */
+#define PLEXI_CBOR_UINT   0
+#define PLEXI_CBOR_BYTES  2
+#define PLEXI_CBOR_ARRAY  4
+/** @} */
+
+/**
+ * \brief Utility function. Writes the head of a CBOR data item, i.e. its major type and its argument (value, length or item count).
+ * Like the other plexi_reply functions, only the part of the reply within the requested block is written to buffer.
+ */
+uint8_t plexi_reply_cbor_head_if_possible(uint8_t major, uint32_t value, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset);
+/**
+ * \brief Utility function. Writes a CBOR byte string of len bytes.
+ */
+uint8_t plexi_reply_cbor_bytes_if_possible(const uint8_t *bytes, uint16_t len, uint8_t *buffer, size_t *bufpos, uint16_t bufsize, size_t *strpos, int32_t *offset);
+
+/**
+ * \brief Returns a checksum over all installed slotframes and links. It changes whenever the TSCH schedule does.
+ */
+uint16_t plexi_schedule_version(void);
+/**
+ * \brief Sets the ETag of a schedule reply to the schedule version and checks it against the ETag of the request.
+ * \param format The content format of the reply, so that each representation gets its own ETag
+ * \return Returns 1 if the client already holds the current schedule. The response is then 2.03 Valid with no payload
+ * and the handler should return. Returns 0 otherwise.
+ *
+ * Clients poll a large schedule by sending back the ETag of their last copy: the schedule is only transferred again once it changed.
+ */
+uint8_t plexi_reply_schedule_etag(void *request, void *response, unsigned int format, int32_t *offset);
+
 
 /**
  * \brief Utility function. Searches for a field in a json object.
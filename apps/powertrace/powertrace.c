@@ -42,6 +42,9 @@
 #include "sys/compower.h"
 #include "powertrace.h"
 #include "net/rime/rime.h"
+#if POWERTRACE_BINARY_SLIP
+#include "dev/slip.h"
+#endif /* POWERTRACE_BINARY_SLIP */
 
 #include <stdio.h>
 #include <string.h>
@@ -57,6 +60,9 @@ struct powertrace_sniff_stats {
   uint16_t channel;
   unsigned long last_input_txtime, last_input_rxtime;
   unsigned long last_output_txtime, last_output_rxtime;
+#if POWERTRACE_BINARY
+  unsigned long last_num_input, last_num_output;
+#endif /* POWERTRACE_BINARY */
 };
 
 #define INPUT  1
@@ -69,6 +75,157 @@ LIST(stats_list);
 
 PROCESS(powertrace_process, "Periodic power output");
 /*---------------------------------------------------------------------------*/
+#if POWERTRACE_BINARY
+/*
+ * A binary record is a length byte, counting the bytes that follow
+ * it, a type byte and a list of unsigned LEB128 varints. Times are
+ * truncated to 32 bits.
+ *
+ * P records hold the seqno, the clock ticks since the previous P
+ * record and the CPU, LPM, transmit, listen, idle transmit and idle
+ * listen times of the interval.
+ *
+ * SP records hold the channel, the network protocol if the PROTO flag
+ * is set, and the number of packets, the transmit time and the listen
+ * time of the interval for input and then for output packets. They
+ * belong to the P record before them.
+ *
+ * Records with the SYNC flag let the decoder start from them. A P
+ * sync record has the absolute clock instead of the clock delta,
+ * followed by the node address (two bytes) and the number of records
+ * dropped so far. Both P and SP sync records end with the totals of
+ * their interval fields. Sync records are written for the first
+ * interval and for the interval after the ring overflowed.
+ */
+#define BINARY_P      0x01
+#define BINARY_SP     0x02
+#define BINARY_PROTO  0x40
+#define BINARY_SYNC   0x80
+
+#define BINARY_RECORD_MAX 80
+#define BINARY_FRAME_SIZE 128
+
+static uint8_t ring[POWERTRACE_BINARY_SIZE];
+static uint16_t ring_get, ring_len;
+
+static uint8_t record[BINARY_RECORD_MAX];
+static uint8_t *recptr;
+
+static uint8_t need_sync = 1;
+static unsigned long dropped;
+/*---------------------------------------------------------------------------*/
+static void
+record_start(uint8_t type)
+{
+  recptr = &record[1];
+  *recptr++ = type;
+}
+/*---------------------------------------------------------------------------*/
+static void
+record_varint(uint32_t v)
+{
+  while(v >= 0x80) {
+    *recptr++ = (v & 0x7f) | 0x80;
+    v >>= 7;
+  }
+  *recptr++ = v;
+}
+/*---------------------------------------------------------------------------*/
+/* Appends the record to the ring. A record that does not fit is
+   dropped, and the next interval is written as sync records. */
+static int
+record_commit(void)
+{
+  uint16_t len, put;
+  uint8_t *ptr;
+
+  len = recptr - record;
+  record[0] = len - 1;
+  if(len > POWERTRACE_BINARY_SIZE - ring_len) {
+    dropped++;
+    need_sync = 1;
+    return 0;
+  }
+
+  put = (ring_get + ring_len) % POWERTRACE_BINARY_SIZE;
+  for(ptr = record; ptr < recptr; ptr++) {
+    ring[put] = *ptr;
+    if(++put == POWERTRACE_BINARY_SIZE) {
+      put = 0;
+    }
+  }
+  ring_len += len;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+powertrace_binary_read(uint8_t *buf, int len)
+{
+  int n;
+  uint16_t reclen;
+
+  n = 0;
+  while(ring_len > 0) {
+    reclen = ring[ring_get] + 1;
+    if(n + reclen > len) {
+      break;
+    }
+    ring_len -= reclen;
+    while(reclen-- > 0) {
+      buf[n++] = ring[ring_get];
+      if(++ring_get == POWERTRACE_BINARY_SIZE) {
+        ring_get = 0;
+      }
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+#if POWERTRACE_BINARY_SLIP
+void
+powertrace_binary_slip_drain(void)
+{
+  static uint8_t frame[BINARY_FRAME_SIZE];
+  int len;
+
+  frame[0] = POWERTRACE_BINARY_FRAME_TAG;
+  while((len = powertrace_binary_read(&frame[1], sizeof(frame) - 1)) > 0) {
+    slip_write(frame, len + 1);
+  }
+}
+#endif /* POWERTRACE_BINARY_SLIP */
+/*---------------------------------------------------------------------------*/
+#endif /* POWERTRACE_BINARY */
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS && !POWERTRACE_BINARY
+/* One line per subsystem that has used any CPU or radio time:
+   the total and the new CPU, transmit and listen times. */
+static void
+powertrace_print_subsystems(char *str, unsigned long seqno)
+{
+  static unsigned long last[ENERGEST_SUBSYSTEM_MAX][3];
+  unsigned long all_cpu, all_transmit, all_listen;
+  int i;
+
+  for(i = 0; i < ENERGEST_SUBSYSTEM_MAX; i++) {
+    all_cpu = energest_subsystem_time(i, ENERGEST_TYPE_CPU);
+    all_transmit = energest_subsystem_time(i, ENERGEST_TYPE_TRANSMIT);
+    all_listen = energest_subsystem_time(i, ENERGEST_TYPE_LISTEN);
+    if(all_cpu == 0 && all_transmit == 0 && all_listen == 0) {
+      continue;
+    }
+    printf("%s %lu PS %d.%d %lu %s %lu %lu %lu %lu %lu %lu\n",
+           str, clock_time(), linkaddr_node_addr.u8[0],
+           linkaddr_node_addr.u8[1], seqno, energest_subsystem_name(i),
+           all_cpu, all_transmit, all_listen,
+           all_cpu - last[i][0], all_transmit - last[i][1],
+           all_listen - last[i][2]);
+    last[i][0] = all_cpu;
+    last[i][1] = all_transmit;
+    last[i][2] = all_listen;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS && !POWERTRACE_BINARY */
 void
 powertrace_print(char *str)
 {
@@ -82,8 +239,14 @@ powertrace_print(char *str)
 
   static unsigned long seqno;
 
+#if POWERTRACE_BINARY
+  static clock_time_t last_clock;
+  clock_time_t now;
+  uint8_t sync, written;
+#else /* POWERTRACE_BINARY */
   unsigned long time, all_time, radio, all_radio;
-  
+#endif /* POWERTRACE_BINARY */
+
   struct powertrace_sniff_stats *s;
 
   energest_flush();
@@ -109,6 +272,38 @@ powertrace_print(char *str)
   last_idle_listen = compower_idle_activity.listen;
   last_idle_transmit = compower_idle_activity.transmit;
 
+#if POWERTRACE_BINARY
+  now = clock_time();
+  sync = need_sync;
+  need_sync = 0;
+
+  record_start(BINARY_P | (sync ? BINARY_SYNC : 0));
+  record_varint(seqno);
+  if(sync) {
+    record_varint(now);
+    *recptr++ = linkaddr_node_addr.u8[0];
+    *recptr++ = linkaddr_node_addr.u8[1];
+    record_varint(dropped);
+  } else {
+    record_varint(now - last_clock);
+  }
+  record_varint(cpu);
+  record_varint(lpm);
+  record_varint(transmit);
+  record_varint(listen);
+  record_varint(idle_transmit);
+  record_varint(idle_listen);
+  if(sync) {
+    record_varint(all_cpu);
+    record_varint(all_lpm);
+    record_varint(all_transmit);
+    record_varint(all_listen);
+    record_varint(all_idle_transmit);
+    record_varint(all_idle_listen);
+  }
+  last_clock = now;
+  written = record_commit();
+#else /* POWERTRACE_BINARY */
   radio = transmit + listen;
   time = cpu + lpm;
   all_time = all_cpu + all_lpm;
@@ -133,9 +328,42 @@ powertrace_print(char *str)
          (int)((100L * listen) / time),
          (int)((10000L * listen) / time - (100L * listen / time) * 100));
 
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+  powertrace_print_subsystems(str, seqno);
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
+#endif /* POWERTRACE_BINARY */
+
   for(s = list_head(stats_list); s != NULL; s = list_item_next(s)) {
 
-#if ! NETSTACK_CONF_WITH_IPV6
+#if POWERTRACE_BINARY
+    if(written) {
+#if NETSTACK_CONF_WITH_IPV6
+      record_start(BINARY_SP | BINARY_PROTO | (sync ? BINARY_SYNC : 0));
+      record_varint(s->channel);
+      record_varint(s->proto);
+#else
+      record_start(BINARY_SP | (sync ? BINARY_SYNC : 0));
+      record_varint(s->channel);
+#endif
+      record_varint(s->num_input - s->last_num_input);
+      record_varint(s->input_txtime - s->last_input_txtime);
+      record_varint(s->input_rxtime - s->last_input_rxtime);
+      record_varint(s->num_output - s->last_num_output);
+      record_varint(s->output_txtime - s->last_output_txtime);
+      record_varint(s->output_rxtime - s->last_output_rxtime);
+      if(sync) {
+        record_varint(s->num_input);
+        record_varint(s->input_txtime);
+        record_varint(s->input_rxtime);
+        record_varint(s->num_output);
+        record_varint(s->output_txtime);
+        record_varint(s->output_rxtime);
+      }
+      record_commit();
+    }
+    s->last_num_input = s->num_input;
+    s->last_num_output = s->num_output;
+#elif ! NETSTACK_CONF_WITH_IPV6
     printf("%s %lu SP %d.%d %lu %u %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu (channel %d radio %d.%02d%% / %d.%02d%%)\n",
            str, clock_time(), linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1], seqno,
            s->channel,
@@ -208,6 +436,11 @@ PROCESS_THREAD(powertrace_process, ev, data)
     PROCESS_WAIT_UNTIL(etimer_expired(&periodic));
     etimer_reset(&periodic);
     powertrace_print("");
+#if POWERTRACE_BINARY && POWERTRACE_BINARY_SLIP
+    if(ring_len >= POWERTRACE_BINARY_SIZE / 2) {
+      powertrace_binary_slip_drain();
+    }
+#endif /* POWERTRACE_BINARY && POWERTRACE_BINARY_SLIP */
   }
 
   PROCESS_END();
@@ -42,6 +42,34 @@
 
 #include "sys/clock.h"
 
+/* Instead of printing text lines, write each interval as compact
+   binary records into a ring that is drained in bulk, either with
+   powertrace_binary_read() (e.g. from a CoAP resource) or over
+   SLIP. tools/powertrace/powertrace-decode turns the records back
+   into the text lines. */
+#ifdef POWERTRACE_CONF_BINARY
+#define POWERTRACE_BINARY POWERTRACE_CONF_BINARY
+#else
+#define POWERTRACE_BINARY 0
+#endif
+
+/* Size of the binary record ring, in bytes. */
+#ifdef POWERTRACE_CONF_BINARY_SIZE
+#define POWERTRACE_BINARY_SIZE POWERTRACE_CONF_BINARY_SIZE
+#else
+#define POWERTRACE_BINARY_SIZE 512
+#endif
+
+/* Send the ring as SLIP frames whenever it is half full. */
+#ifdef POWERTRACE_CONF_BINARY_SLIP
+#define POWERTRACE_BINARY_SLIP POWERTRACE_CONF_BINARY_SLIP
+#else
+#define POWERTRACE_BINARY_SLIP 0
+#endif
+
+/* First byte of the SLIP frames that carry binary records. */
+#define POWERTRACE_BINARY_FRAME_TAG 'P'
+
 void powertrace_start(clock_time_t perioc);
 void powertrace_stop(void);
 
@@ -54,4 +82,17 @@ void powertrace_sniff(powertrace_onoff_t onoff);
 
 void powertrace_print(char *str);
 
+#if POWERTRACE_BINARY
+/**
+ * Copy as many whole binary records as fit into buf and remove them
+ * from the ring. Returns the number of bytes copied.
+ */
+int powertrace_binary_read(uint8_t *buf, int len);
+
+#if POWERTRACE_BINARY_SLIP
+/** Send all buffered records as SLIP frames. */
+void powertrace_binary_slip_drain(void);
+#endif /* POWERTRACE_BINARY_SLIP */
+#endif /* POWERTRACE_BINARY */
+
 #endif /* POWERTRACE_H */
@@ -94,6 +94,8 @@ struct rest_implementation_type {
   unsigned int APPLICATION_SOAP_FASTINFOSET;
   unsigned int APPLICATION_JSON;
   unsigned int APPLICATION_X_OBIX_BINARY;
+  unsigned int APPLICATION_CBOR;
+  unsigned int APPLICATION_X_TIMESERIES;
 };
 
 /**
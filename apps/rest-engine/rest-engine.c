@@ -58,6 +58,59 @@ PROCESS(rest_engine_process, "REST Engine");
 /*---------------------------------------------------------------------------*/
 LIST(restful_services);
 LIST(restful_periodic_services);
+#if REST_ENGINE_HASH
+#include "lib/hashlist.h"
+
+/* The resources, chained on hash_next in the bucket of their URL */
+static resource_t *resource_buckets[REST_ENGINE_HASH];
+static uint16_t resource_count;
+#endif /* REST_ENGINE_HASH */
+/*---------------------------------------------------------------------------*/
+#if REST_ENGINE_HASH
+static resource_t **
+bucket_from_url(const char *url, int len)
+{
+  return &resource_buckets[hashlist_hash(url, len) & (REST_ENGINE_HASH - 1)];
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the resource activated first among best and the resources
+ * whose URL is the len first characters of url, only counting those
+ * with sub-resources if parent is set */
+static resource_t *
+lookup(const char *url, int len, int parent, resource_t *best)
+{
+  resource_t *resource;
+
+  for(resource = *bucket_from_url(url, len); resource != NULL;
+      resource = resource->hash_next) {
+    if((!parent || (resource->flags & HAS_SUB_RESOURCES))
+       && (best == NULL || resource->order < best->order)
+       && strlen(resource->url) == len
+       && strncmp(resource->url, url, len) == 0) {
+      best = resource;
+    }
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+/* Same result as the walk of restful_services in
+ * rest_invoke_restful_service(): the URL itself, or any of its parent
+ * paths for a resource with sub-resources */
+static resource_t *
+find_resource(const char *url, int url_len)
+{
+  resource_t *best;
+  int i;
+
+  best = lookup(url, url_len, 0, NULL);
+  for(i = 0; i < url_len; i++) {
+    if(url[i] == '/') {
+      best = lookup(url, i, 1, best);
+    }
+  }
+  return best;
+}
+#endif /* REST_ENGINE_HASH */
 /*---------------------------------------------------------------------------*/
 /*- REST Engine API ---------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -102,8 +155,30 @@ rest_init_engine(void)
 void
 rest_activate_resource(resource_t *resource, char *path)
 {
+#if REST_ENGINE_HASH
+  resource_t **bucket;
+  resource_t **r;
+#endif /* REST_ENGINE_HASH */
+
   resource->url = path;
   list_add(restful_services, resource);
+#if REST_ENGINE_HASH
+  /* A resource activated again is unlinked first, as list_add() moves it
+   * to the end of the list */
+  for(bucket = resource_buckets; bucket < &resource_buckets[REST_ENGINE_HASH];
+      bucket++) {
+    for(r = bucket; *r != NULL; r = &(*r)->hash_next) {
+      if(*r == resource) {
+        *r = resource->hash_next;
+        break;
+      }
+    }
+  }
+  resource->order = resource_count++;
+  bucket = bucket_from_url(path, strlen(path));
+  resource->hash_next = *bucket;
+  *bucket = resource;
+#endif /* REST_ENGINE_HASH */
 
   PRINTF("Activating: %s\n", resource->url);
 
@@ -133,9 +208,15 @@ rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
 
   resource_t *resource = NULL;
   const char *url = NULL;
-  int url_len, res_url_len;
+  int url_len;
+#if !REST_ENGINE_HASH
+  int res_url_len;
+#endif /* !REST_ENGINE_HASH */
 
   url_len = REST.get_url(request, &url);
+#if REST_ENGINE_HASH
+  resource = find_resource(url, url_len);
+#else /* REST_ENGINE_HASH */
   for(resource = (resource_t *)list_head(restful_services);
       resource; resource = resource->next) {
 
@@ -146,33 +227,37 @@ rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
             && (resource->flags & HAS_SUB_RESOURCES)
             && url[res_url_len] == '/'))
        && strncmp(resource->url, url, res_url_len) == 0) {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
-
-      PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
-             (uint16_t)method, resource->flags);
-
-      if((method & METHOD_GET) && resource->get_handler != NULL) {
-        /* call handler function */
-        resource->get_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_POST) && resource->post_handler != NULL) {
-        /* call handler function */
-        resource->post_handler(request, response, buffer, buffer_size,
-                               offset);
-      } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
-        /* call handler function */
-        resource->put_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
-        /* call handler function */
-        resource->delete_handler(request, response, buffer, buffer_size,
-                                 offset);
-      } else {
-        allowed = 0;
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
-      }
       break;
     }
   }
+#endif /* REST_ENGINE_HASH */
+
+  if(resource != NULL) {
+    found = 1;
+    rest_resource_flags_t method = REST.get_method_type(request);
+
+    PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
+           (uint16_t)method, resource->flags);
+
+    if((method & METHOD_GET) && resource->get_handler != NULL) {
+      /* call handler function */
+      resource->get_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_POST) && resource->post_handler != NULL) {
+      /* call handler function */
+      resource->post_handler(request, response, buffer, buffer_size,
+                             offset);
+    } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
+      /* call handler function */
+      resource->put_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
+      /* call handler function */
+      resource->delete_handler(request, response, buffer, buffer_size,
+                               offset);
+    } else {
+      allowed = 0;
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
+    }
+  }
   if(!found) {
     REST.set_response_status(response, REST.status.NOT_FOUND);
   } else if(allowed) {
@@ -62,6 +62,20 @@
 #define REST_MAX_CHUNK_SIZE     64
 #endif
 
+/*
+ * With REST_ENGINE_CONF_HASH set to a number of hash buckets (a power of
+ * two), resources are also indexed by the hash of their URL, so that a
+ * request is dispatched with one lookup for its full path and one for
+ * each of its parent paths, rather than by comparing its URL with every
+ * resource. Matching is unchanged: the first activated resource that
+ * matches wins.
+ */
+#ifdef REST_ENGINE_CONF_HASH
+#define REST_ENGINE_HASH REST_ENGINE_CONF_HASH
+#else
+#define REST_ENGINE_HASH 0
+#endif
+
 struct resource_s;
 struct periodic_resource_s;
 
@@ -95,6 +109,10 @@ struct resource_s {
     restful_trigger_handler trigger;
     restful_trigger_handler resume;
   };
+#if REST_ENGINE_HASH
+  struct resource_s *hash_next;   /* next resource in the same hash bucket */
+  uint16_t order;                 /* rank of activation */
+#endif /* REST_ENGINE_HASH */
 };
 typedef struct resource_s resource_t;
 
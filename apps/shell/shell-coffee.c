@@ -75,9 +75,33 @@ PROCESS_THREAD(shell_format_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+PROCESS(shell_wear_process, "wear");
+SHELL_COMMAND(wear_command,
+	      "wear",
+	      "wear: show the page allocation and erase count of each Coffee sector",
+	      &shell_wear_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_wear_process, ev, data)
+{
+  struct cfs_coffee_sector_stats stats;
+  unsigned sector;
+  char buf[80];
+
+  PROCESS_BEGIN();
+
+  for(sector = 0; cfs_coffee_get_sector_stats(sector, &stats) == 0; sector++) {
+    snprintf(buf, sizeof(buf), "%u: %u active %u obsolete %u free, %lu erases",
+             sector, stats.active, stats.obsolete, stats.free, stats.erases);
+    shell_output_str(&wear_command, "sector ", buf);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
 void
 shell_coffee_init(void)
 {
   shell_register_command(&format_command);
+  shell_register_command(&wear_command);
 }
 /*---------------------------------------------------------------------------*/
@@ -87,7 +87,12 @@ PROCESS_THREAD(shell_ls_process, ev, data)
       shell_output_str(&ls_command, "Cannot open directory", "");
     } else {
       totsize = 0;
-      while(cfs_readdir(&dir, &dirent) == 0) {
+      while(1) {
+        /* Let the next command in the pipeline catch up. */
+        SHELL_OUTPUT_WAIT(&ls_command, sizeof(buf) + sizeof(dirent.name));
+        if(cfs_readdir(&dir, &dirent) != 0) {
+          break;
+        }
         totsize += dirent.size;
         sprintf(buf, "%lu ", (unsigned long)dirent.size);
         /*      printf("'%s'\n", dirent.name);*/
@@ -240,6 +245,7 @@ PROCESS_THREAD(shell_read_process, ev, data)
     } else {
       
       while(1) {
+	SHELL_OUTPUT_WAIT(&read_command, block_size);
 	len = cfs_read(fd, buf, block_size);
 	if(len <= 0) {
 	  cfs_close(fd);
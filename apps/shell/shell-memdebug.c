@@ -40,6 +40,7 @@
 
 #include "contiki.h"
 #include "shell-memdebug.h"
+#include "lib/memb.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -55,6 +56,20 @@ SHELL_COMMAND(peek_command,
 	      "peek",
 	      "peek <address>: read a byte from address <address>",
 	      &shell_peek_process);
+#if MEMB_REGISTRY
+PROCESS(shell_pools_process, "pools");
+SHELL_COMMAND(pools_command,
+	      "pools",
+	      "pools: show the use of the memory pools",
+	      &shell_pools_process);
+#endif /* MEMB_REGISTRY */
+#if MEMB_FAILURE_TRACE
+PROCESS(shell_allocfail_process, "allocfail");
+SHELL_COMMAND(allocfail_command,
+	      "allocfail",
+	      "allocfail: show the latest failed memory allocations",
+	      &shell_allocfail_process);
+#endif /* MEMB_FAILURE_TRACE */
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_poke_process, ev, data)
 {
@@ -119,10 +134,57 @@ PROCESS_THREAD(shell_peek_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#if MEMB_REGISTRY
+PROCESS_THREAD(shell_pools_process, ev, data)
+{
+  struct memb *m;
+  char buf[64];
+
+  PROCESS_BEGIN();
+
+  shell_output_str(&pools_command,
+                   "name size num used peak failures", "");
+  for(m = memb_registry(); m != NULL; m = m->next) {
+    snprintf(buf, sizeof(buf), "%s %d %d %d %d %d", m->name,
+             m->size, m->num, memb_numused(m), memb_highwater(m),
+             memb_failures(m));
+    shell_output_str(&pools_command, buf, "");
+  }
+
+  PROCESS_END();
+}
+#endif /* MEMB_REGISTRY */
+/*---------------------------------------------------------------------------*/
+#if MEMB_FAILURE_TRACE
+PROCESS_THREAD(shell_allocfail_process, ev, data)
+{
+  struct memb_failure f;
+  char buf[64];
+  int i;
+
+  PROCESS_BEGIN();
+
+  shell_output_str(&allocfail_command, "time pool caller", "");
+  for(i = 0; memb_failure(i, &f); ++i) {
+    snprintf(buf, sizeof(buf), "%lu %s %p", (unsigned long)f.time,
+             f.pool, f.caller);
+    shell_output_str(&allocfail_command, buf, "");
+  }
+
+  PROCESS_END();
+}
+#endif /* MEMB_FAILURE_TRACE */
+/*---------------------------------------------------------------------------*/
 void
 shell_memdebug_init(void)
 {
   shell_register_command(&poke_command);
   shell_register_command(&peek_command);
+#if MEMB_REGISTRY
+  shell_register_command(&pools_command);
+#endif /* MEMB_REGISTRY */
+#if MEMB_FAILURE_TRACE
+  shell_register_command(&allocfail_command);
+#endif /* MEMB_FAILURE_TRACE */
 }
 /*---------------------------------------------------------------------------*/
@@ -110,11 +110,12 @@ SHELL_COMMAND(netstat_command,
 PROCESS_THREAD(shell_netstat_process, ev, data)
 {
   char buf[BUFLEN];
-  int i;
+  static int i;
   struct uip_conn *conn;
   PROCESS_BEGIN();
 
   for(i = 0; i < UIP_CONNS; ++i) {
+    SHELL_OUTPUT_WAIT(&netstat_command, sizeof(buf) + 4);
     conn = &uip_conns[i];
     snprintf(buf, BUFLEN,
 	     "%d, %u.%u.%u.%u:%u, %s, %u, %u, %c %c",
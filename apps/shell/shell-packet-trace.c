@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Shell interface to the packet latency tracing
+ */
+
+#include "shell.h"
+#include "net/packet-trace.h"
+#include <stdio.h>
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_packet_trace_process, "packet-trace");
+SHELL_COMMAND(packet_trace_command,
+	      "packet-trace",
+	      "packet-trace [interval]: print the packet trace records, or every <interval> seconds",
+	      &shell_packet_trace_process);
+/*---------------------------------------------------------------------------*/
+#if PACKET_TRACE_ENABLED
+static clock_time_t interval;
+
+PROCESS(packet_trace_stream_process, "packet-trace stream");
+
+PROCESS_THREAD(packet_trace_stream_process, ev, data)
+{
+  static struct etimer periodic;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&periodic, interval);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&periodic));
+    etimer_reset(&periodic);
+    packet_trace_print();
+  }
+
+  PROCESS_END();
+}
+#endif /* PACKET_TRACE_ENABLED */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_packet_trace_process, ev, data)
+{
+#if PACKET_TRACE_ENABLED
+  char buf[10];
+  int seconds;
+#endif /* PACKET_TRACE_ENABLED */
+
+  PROCESS_BEGIN();
+
+#if PACKET_TRACE_ENABLED
+  seconds = shell_strtolong(data, NULL);
+
+  process_exit(&packet_trace_stream_process);
+  if(data == NULL || seconds == 0) {
+    packet_trace_print();
+  } else {
+    interval = seconds * CLOCK_SECOND;
+    process_start(&packet_trace_stream_process, NULL);
+    sprintf(buf, "%d", seconds);
+    shell_output_str(&packet_trace_command,
+                     "Printing packet trace records with interval ", buf);
+  }
+#else /* PACKET_TRACE_ENABLED */
+  shell_output_str(&packet_trace_command,
+                   "Packet tracing is off, see PACKET_TRACE_CONF_ENABLED", "");
+#endif /* PACKET_TRACE_ENABLED */
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_packet_trace_init(void)
+{
+  shell_register_command(&packet_trace_command);
+}
+/*---------------------------------------------------------------------------*/
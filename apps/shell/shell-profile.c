@@ -32,7 +32,7 @@
 
 /**
  * \file
- *         A brief description of what this file is.
+ *         Shell interface to the sampling profiler
  * \author
  *         Adam Dunkels <adam@sics.se>
  */
@@ -40,48 +40,38 @@
 #include "contiki.h"
 #include "contiki-conf.h"
 #include "shell-profile.h"
-
-#include "loader/symbols.h"
+#include "sys/profiler.h"
 
 #include <stdio.h>
-#include <string.h>
 
 /*---------------------------------------------------------------------------*/
 PROCESS(shell_profile_process, "Shell 'profile' command");
 SHELL_COMMAND(profile_command,
 	      "profile",
-	      "profile: show aggregate profiling information",
+	      "profile [rate]: start sampling <rate> times per second, stop with 0, or print the samples",
 	      &shell_profile_process);
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_profile_process, ev, data)
 {
-  int i;
-  char buf[100];
+  char buf[10];
+  const char *next;
+  int rate;
+
   PROCESS_BEGIN();
 
-#if DETAILED_AGGREGATES
-  for(i = 0; i < aggregates_list_ptr; ++i) {
-    sprintf(buf, "-- %s: %lu / %u = %lu", aggregates[i].ptr,
-	   aggregates[i].cycles,
-	   aggregates[i].episodes,
-	   aggregates[i].cycles / aggregates[i].episodes);
-    shell_output(buf, "");
+  next = data;
+  rate = shell_strtolong(data, &next);
+  if(next == data) {
+    /* No rate given: print the samples for tools/profiler-symbolize */
+    profiler_print();
+  } else if(rate == 0) {
+    profiler_stop();
+    shell_output_str(&profile_command, "Profiling stopped", "");
+  } else {
+    profiler_start(rate);
+    sprintf(buf, "%d", rate);
+    shell_output_str(&profile_command, "Sampling per second: ", buf);
   }
-#else
-  for(i = 0; i < aggregates_list_ptr; ++i) {
-    sprintf(buf, "-- %c%c: %lu / %u = %lu",
-	   aggregates[i].ptr[0], aggregates[i].ptr[1],
-	   aggregates[i].cycles,
-	   aggregates[i].episodes,
-	   aggregates[i].cycles / aggregates[i].episodes);
-    shell_output(buf, "");
-  }
-#endif
-
-  sprintf(buf, "Memory for aggregates: %d * %d = %d\n",
-	  (int)sizeof(struct aggregate), aggregates_list_ptr,
-	  (int)sizeof(struct aggregate) * aggregates_list_ptr);
-  shell_output(buf, "");
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
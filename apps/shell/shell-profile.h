@@ -32,7 +32,7 @@
 
 /**
  * \file
- *         A brief description of what this file is.
+ *         Shell interface to the sampling profiler
  * \author
  *         Adam Dunkels <adam@sics.se>
  */
@@ -49,6 +49,13 @@ SHELL_COMMAND(ps_command,
 	      "ps",
 	      "ps: list all running processes",
 	      &shell_ps_process);
+#if PROCESS_PROFILE
+PROCESS(shell_pstat_process, "pstat");
+SHELL_COMMAND(pstat_command,
+	      "pstat",
+	      "pstat [-r]: show per-process run time, calls and latency",
+	      &shell_pstat_process);
+#endif /* PROCESS_PROFILE */
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_ps_process, ev, data)
 {
@@ -65,9 +72,38 @@ PROCESS_THREAD(shell_ps_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PROFILE
+PROCESS_THREAD(shell_pstat_process, ev, data)
+{
+  struct process *p;
+  char buf[60];
+  int reset;
+  PROCESS_BEGIN();
+
+  reset = data != NULL && strcmp(data, "-r") == 0;
+
+  shell_output_str(&pstat_command,
+                   "ticks calls max-latency process (rtimer ticks)", "");
+  for(p = PROCESS_LIST(); p != NULL; p = p->next) {
+    snprintf(buf, sizeof(buf), "%lu %lu %lu ",
+             process_profile_time(p), process_profile_calls(p),
+             (unsigned long)process_profile_max_latency(p));
+    shell_output_str(&pstat_command, buf, PROCESS_NAME_STRING(p));
+    if(reset) {
+      process_profile_reset(p);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* PROCESS_PROFILE */
+/*---------------------------------------------------------------------------*/
 void
 shell_ps_init(void)
 {
   shell_register_command(&ps_command);
+#if PROCESS_PROFILE
+  shell_register_command(&pstat_command);
+#endif /* PROCESS_PROFILE */
 }
 /*---------------------------------------------------------------------------*/
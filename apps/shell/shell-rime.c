@@ -328,9 +328,27 @@ recv_collect(const linkaddr_t *originator, uint8_t seqno, uint8_t hops)
 	msg.hops = hops;
 	msg.latency = latency;
 	
+#if COLLECT_HOP_TIMING
+	{
+	  /* The queueing and retry times of the path follow the data. */
+	  uint16_t data[PACKETBUF_SIZE / 2 + 2];
+	  uint16_t timing[2];
+
+	  len &= ~1;
+	  memcpy(data, dataptr, len);
+	  timing[0] = collect_queue_time();
+	  timing[1] = collect_tx_time();
+	  memcpy((uint8_t *)data + len, timing, sizeof(timing));
+	  msg.len += 2;
+	  shell_output(&collect_command,
+		       &msg, sizeof(msg),
+		       data, len + sizeof(timing));
+	}
+#else /* COLLECT_HOP_TIMING */
 	shell_output(&collect_command,
 		     &msg, sizeof(msg),
 		     dataptr, packetbuf_datalen() - COLLECT_MSG_HDRSIZE);
+#endif /* COLLECT_HOP_TIMING */
       }
     }
   }
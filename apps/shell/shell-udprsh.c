@@ -0,0 +1,682 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A service that runs shell scripts sent over UDP, and the
+ *         udprsh command that sends them.
+ *
+ *         A request carries a script of command lines separated by
+ *         newlines, and may be sent to a multicast address to reach
+ *         many nodes at once. Each node runs the script, collects
+ *         the output of the commands, compresses it, and waits for a
+ *         random time within the reply window given in the request
+ *         before it answers. Only the first block of the compressed
+ *         output is sent unasked. The requester fetches the following
+ *         blocks with GET messages, from one node at a time.
+ */
+
+#include "contiki.h"
+#include "shell.h"
+#include "contiki-net.h"
+#include "net/ip/simple-udp.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#ifdef SHELL_UDPRSH_CONF_PORT
+#define PORT SHELL_UDPRSH_CONF_PORT
+#else /* SHELL_UDPRSH_CONF_PORT */
+#define PORT 6530
+#endif /* SHELL_UDPRSH_CONF_PORT */
+
+/* The longest script that can be sent or received. */
+#ifdef SHELL_UDPRSH_CONF_SCRIPT_SIZE
+#define SCRIPT_SIZE SHELL_UDPRSH_CONF_SCRIPT_SIZE
+#else /* SHELL_UDPRSH_CONF_SCRIPT_SIZE */
+#define SCRIPT_SIZE 96
+#endif /* SHELL_UDPRSH_CONF_SCRIPT_SIZE */
+
+/* The amount of script output kept for the reply. Further output is
+   dropped, and the reply is marked as truncated. */
+#ifdef SHELL_UDPRSH_CONF_OUTPUT_SIZE
+#define OUTPUT_SIZE SHELL_UDPRSH_CONF_OUTPUT_SIZE
+#else /* SHELL_UDPRSH_CONF_OUTPUT_SIZE */
+#define OUTPUT_SIZE 256
+#endif /* SHELL_UDPRSH_CONF_OUTPUT_SIZE */
+
+/* The largest amount of compressed output in a reply packet. */
+#ifdef SHELL_UDPRSH_CONF_BLOCK_SIZE
+#define BLOCK_SIZE SHELL_UDPRSH_CONF_BLOCK_SIZE
+#else /* SHELL_UDPRSH_CONF_BLOCK_SIZE */
+#define BLOCK_SIZE 64
+#endif /* SHELL_UDPRSH_CONF_BLOCK_SIZE */
+
+/* The number of nodes whose replies the requester remembers to fetch
+   while it fetches the reply of another node. */
+#ifdef SHELL_UDPRSH_CONF_PENDING
+#define PENDING SHELL_UDPRSH_CONF_PENDING
+#else /* SHELL_UDPRSH_CONF_PENDING */
+#define PENDING 8
+#endif /* SHELL_UDPRSH_CONF_PENDING */
+
+/* The longest time that a command in a script may run. */
+#ifdef SHELL_UDPRSH_CONF_TIMEOUT
+#define TIMEOUT SHELL_UDPRSH_CONF_TIMEOUT
+#else /* SHELL_UDPRSH_CONF_TIMEOUT */
+#define TIMEOUT (10 * CLOCK_SECOND)
+#endif /* SHELL_UDPRSH_CONF_TIMEOUT */
+
+#define MSG_REQUEST 1 /* id (2), reply window in seconds (2), script */
+#define MSG_GET     2 /* id (2), block number */
+#define MSG_BLOCK   3 /* id (2), block number, flags, compressed output */
+
+#define REQUEST_HDR_SIZE 5
+#define GET_SIZE         4
+#define BLOCK_HDR_SIZE   5
+
+#define FLAG_MORE      1
+#define FLAG_TRUNCATED 2
+
+#define RETRY_INTERVAL CLOCK_SECOND
+#define MAX_RETRIES    3
+
+/* The output is compressed with LZSS: a flag byte tells whether each
+   of the next eight items is a literal byte (bit set) or a two-byte
+   match of a 12-bit offset and a 4-bit length. */
+#define MIN_MATCH  3
+#define MAX_MATCH  (15 + MIN_MATCH)
+#define MAX_OFFSET 4096
+
+#define COMPRESSED_SIZE (OUTPUT_SIZE + (OUTPUT_SIZE + 7) / 8)
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_udprsh_process, "udprsh");
+SHELL_COMMAND(udprsh_command,
+	      "udprsh",
+	      "udprsh <address> <reply window> [command]: run a script on remote nodes",
+	      &shell_udprsh_process);
+PROCESS(shell_udprsh_server_process, "udprsh server");
+PROCESS(shell_udprsh_output_process, "udprsh output");
+/* Collects the output of the commands run by the server. The command
+   is not registered, so it cannot be started from the shell. */
+SHELL_COMMAND(output_command, "udprsh-output", "",
+	      &shell_udprsh_output_process);
+/*---------------------------------------------------------------------------*/
+
+static struct simple_udp_connection conn;
+
+/* Server state. */
+static char script[SCRIPT_SIZE + 1];
+static uint8_t output[OUTPUT_SIZE];
+static uint16_t output_len;
+static uint8_t compressed[COMPRESSED_SIZE];
+static uint16_t compressed_len;
+static uint8_t truncated;
+static uint8_t output_ready;
+static uint16_t request_id;
+static uint16_t reply_window;
+static uip_ipaddr_t requester;
+static uint16_t requester_port;
+
+/* Client state. A reply of more than one block is reassembled from
+   one node at a time; the nodes that wait are kept in a list. */
+static uint16_t client_id;
+static uint8_t request[REQUEST_HDR_SIZE + SCRIPT_SIZE];
+static uint16_t request_len;
+static uint8_t reply[COMPRESSED_SIZE];
+static uint16_t reply_len;
+static uint8_t text[OUTPUT_SIZE + 1];
+static uip_ipaddr_t reply_addr;
+static uint16_t reply_port;
+static uint8_t reply_busy, reply_next, reply_retries;
+static clock_time_t last_block;
+static struct {
+  uip_ipaddr_t addr;
+  uint16_t port;
+} pending[PENDING];
+static uint8_t npending;
+
+static uint8_t packet[BLOCK_HDR_SIZE + BLOCK_SIZE];
+
+/*---------------------------------------------------------------------------*/
+static int
+compress(const uint8_t *in, int inlen, uint8_t *out)
+{
+  int pos, o, flag_pos, bit, i, len, best_len, best_offset;
+
+  pos = o = 0;
+  while(pos < inlen) {
+    flag_pos = o++;
+    out[flag_pos] = 0;
+    for(bit = 0; bit < 8 && pos < inlen; bit++) {
+      best_len = best_offset = 0;
+      for(i = pos > MAX_OFFSET ? pos - MAX_OFFSET : 0; i < pos; i++) {
+	for(len = 0;
+	    pos + len < inlen && len < MAX_MATCH && in[i + len] == in[pos + len];
+	    len++);
+	if(len > best_len) {
+	  best_len = len;
+	  best_offset = pos - i;
+	}
+      }
+      if(best_len >= MIN_MATCH) {
+	out[o++] = ((best_offset - 1) >> 8) << 4 | (best_len - MIN_MATCH);
+	out[o++] = (best_offset - 1) & 0xff;
+	pos += best_len;
+      } else {
+	out[flag_pos] |= 1 << bit;
+	out[o++] = in[pos++];
+      }
+    }
+  }
+  return o;
+}
+/*---------------------------------------------------------------------------*/
+static int
+decompress(const uint8_t *in, int len, uint8_t *out, int outmax)
+{
+  int i, o, bit, offset, n;
+  uint8_t flags;
+
+  i = o = 0;
+  while(i < len) {
+    flags = in[i++];
+    for(bit = 0; bit < 8 && i < len; bit++) {
+      if(flags & (1 << bit)) {
+	if(o >= outmax) {
+	  return -1;
+	}
+	out[o++] = in[i++];
+      } else {
+	if(i + 1 >= len) {
+	  return -1;
+	}
+	offset = ((in[i] >> 4) << 8 | in[i + 1]) + 1;
+	n = (in[i] & 0x0f) + MIN_MATCH;
+	i += 2;
+	if(offset > o || o + n > outmax) {
+	  return -1;
+	}
+	while(n-- > 0) {
+	  out[o] = out[o - offset];
+	  o++;
+	}
+      }
+    }
+  }
+  return o;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_block(const uip_ipaddr_t *addr, uint16_t port, uint8_t block)
+{
+  uint16_t offset, len;
+
+  offset = block * BLOCK_SIZE;
+  if(offset > compressed_len || (offset == compressed_len && block > 0)) {
+    /* There is no such block. */
+    return;
+  }
+  len = compressed_len - offset;
+  if(len > BLOCK_SIZE) {
+    len = BLOCK_SIZE;
+  }
+
+  packet[0] = MSG_BLOCK;
+  packet[1] = request_id >> 8;
+  packet[2] = request_id & 0xff;
+  packet[3] = block;
+  packet[4] = (offset + len < compressed_len ? FLAG_MORE : 0) |
+    (truncated ? FLAG_TRUNCATED : 0);
+  memcpy(&packet[BLOCK_HDR_SIZE], &compressed[offset], len);
+  PRINTF("udprsh: sending block %u of %u bytes\n", block, len);
+  simple_udp_sendto_port(&conn, packet, BLOCK_HDR_SIZE + len, addr, port);
+}
+/*---------------------------------------------------------------------------*/
+static void
+append_output(const char *data, int len)
+{
+  if(len > OUTPUT_SIZE - output_len) {
+    len = OUTPUT_SIZE - output_len;
+    truncated = 1;
+  }
+  memcpy(&output[output_len], data, len);
+  output_len += len;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_udprsh_output_process, ev, data)
+{
+  struct shell_input *input;
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
+    input = data;
+    /* The end of the input of one command is not the end of the
+       script, so keep running. */
+    if(input->len1 + input->len2 > 0) {
+      append_output(input->data1, input->len1);
+      append_output(input->data2, input->len2);
+      append_output("\n", 1);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_udprsh_server_process, ev, data)
+{
+  static struct etimer etimer;
+  static struct process *started;
+  static char *line, *next;
+  int ret;
+  PROCESS_BEGIN();
+
+  output_len = 0;
+  truncated = 0;
+  if(!process_is_running(&shell_udprsh_output_process)) {
+    process_start(&shell_udprsh_output_process, NULL);
+  }
+
+  for(line = script; *line != 0; line = next) {
+    next = strchr(line, '\n');
+    if(next != NULL) {
+      *next++ = 0;
+    } else {
+      next = line + strlen(line);
+    }
+    PRINTF("udprsh: running '%s'\n", line);
+    started = NULL;
+    ret = shell_start_command(line, (int)strlen(line),
+			      &output_command, &started);
+    if(started == NULL) {
+      if(*line != 0) {
+	append_output("udprsh: failed to start ", 24);
+	append_output(line, (int)strlen(line));
+	append_output("\n", 1);
+      }
+    } else if(ret == SHELL_FOREGROUND && process_is_running(started)) {
+      etimer_set(&etimer, TIMEOUT);
+      PROCESS_WAIT_EVENT_UNTIL((ev == PROCESS_EVENT_EXITED &&
+				data == started) ||
+			       etimer_expired(&etimer));
+      if(process_is_running(started)) {
+	process_exit(started);
+      }
+    }
+  }
+  compressed_len = compress(output, output_len, compressed);
+  PRINTF("udprsh: %u bytes of output compressed to %u\n",
+	 output_len, compressed_len);
+  output_ready = 1;
+
+  /* Spread the replies from all nodes that got the request over the
+     reply window. */
+  if(reply_window > 0) {
+    etimer_set(&etimer, (clock_time_t)(random_rand() % reply_window) *
+	       CLOCK_SECOND + random_rand() % CLOCK_SECOND);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
+  }
+  send_block(&requester, requester_port, 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static int
+sprint_addr(char *buf, const uip_ipaddr_t *addr)
+{
+#if NETSTACK_CONF_WITH_IPV6
+  int i, n, run, best, best_len;
+
+  /* Replace the longest run of zero groups with "::". */
+  best = -1;
+  best_len = 1;
+  for(i = 0; i < 8; i += run + 1) {
+    for(run = 0; i + run < 8 && addr->u16[i + run] == 0; run++);
+    if(run > best_len) {
+      best = i;
+      best_len = run;
+    }
+  }
+
+  n = 0;
+  for(i = 0; i < 8; i++) {
+    if(i == best) {
+      n += sprintf(&buf[n], "::");
+      i += best_len - 1;
+      continue;
+    }
+    if(n > 0 && buf[n - 1] != ':') {
+      buf[n++] = ':';
+    }
+    n += sprintf(&buf[n], "%x", (addr->u8[i * 2] << 8) + addr->u8[i * 2 + 1]);
+  }
+  buf[n] = 0;
+  return n;
+#else /* NETSTACK_CONF_WITH_IPV6 */
+  return sprintf(buf, "%u.%u.%u.%u", addr->u8[0], addr->u8[1],
+		 addr->u8[2], addr->u8[3]);
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_get(const uip_ipaddr_t *addr, uint16_t port, uint8_t block)
+{
+  uint8_t get[GET_SIZE];
+
+  get[0] = MSG_GET;
+  get[1] = client_id >> 8;
+  get[2] = client_id & 0xff;
+  get[3] = block;
+  simple_udp_sendto_port(&conn, get, sizeof(get), addr, port);
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_reply(const uip_ipaddr_t *sender, const uint8_t *data, int len,
+	    uint8_t flags)
+{
+  char addr[48];
+  char *line, *end;
+  int n;
+
+  strcpy(&addr[sprint_addr(addr, sender)], ": ");
+
+  n = decompress(data, len, text, OUTPUT_SIZE);
+  if(n < 0) {
+    shell_output_str(&udprsh_command, addr, "(bad reply)");
+    return;
+  }
+  text[n] = 0;
+
+  for(line = (char *)text; *line != 0; line = end) {
+    end = strchr(line, '\n');
+    if(end != NULL) {
+      *end++ = 0;
+    } else {
+      end = line + strlen(line);
+    }
+    shell_output_str(&udprsh_command, addr, line);
+  }
+  if(flags & FLAG_TRUNCATED) {
+    shell_output_str(&udprsh_command, addr, "(output truncated)");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_reply(const uip_ipaddr_t *sender, uint16_t port)
+{
+  uip_ipaddr_copy(&reply_addr, sender);
+  reply_port = port;
+  reply_len = 0;
+  reply_next = 0;
+  reply_retries = 0;
+  reply_busy = 1;
+  last_block = clock_time();
+}
+/*---------------------------------------------------------------------------*/
+/* Fetch the reply of the node that has waited the longest. */
+static void
+next_reply(void)
+{
+  reply_busy = 0;
+  if(npending > 0) {
+    start_reply(&pending[0].addr, pending[0].port);
+    npending--;
+    memmove(&pending[0], &pending[1], npending * sizeof(pending[0]));
+    send_get(&reply_addr, reply_port, 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_block(const uip_ipaddr_t *sender, uint16_t port,
+	     const uint8_t *data, uint16_t datalen)
+{
+  uint8_t block, flags;
+  uint16_t len;
+  int i;
+
+  block = data[3];
+  flags = data[4];
+  len = datalen - BLOCK_HDR_SIZE;
+  data += BLOCK_HDR_SIZE;
+
+  if(!(reply_busy && uip_ipaddr_cmp(sender, &reply_addr))) {
+    if(block != 0) {
+      return;
+    }
+    if(!(flags & FLAG_MORE)) {
+      /* The whole reply is in this block. */
+      print_reply(sender, data, len, flags);
+      return;
+    }
+    if(reply_busy) {
+      for(i = 0; i < npending; i++) {
+	if(uip_ipaddr_cmp(sender, &pending[i].addr)) {
+	  return;
+	}
+      }
+      if(npending == PENDING) {
+	char addr[48];
+	strcpy(&addr[sprint_addr(addr, sender)], ": ");
+	shell_output_str(&udprsh_command, addr, "(reply dropped)");
+	return;
+      }
+      uip_ipaddr_copy(&pending[npending].addr, sender);
+      pending[npending].port = port;
+      npending++;
+      return;
+    }
+    start_reply(sender, port);
+  }
+
+  if(block != reply_next || reply_len + len > sizeof(reply)) {
+    return;
+  }
+  memcpy(&reply[reply_len], data, len);
+  reply_len += len;
+  reply_next++;
+  reply_retries = 0;
+  last_block = clock_time();
+
+  if(flags & FLAG_MORE) {
+    send_get(sender, port, reply_next);
+  } else {
+    print_reply(sender, reply, reply_len, flags);
+    next_reply();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+	 const uip_ipaddr_t *sender_addr,
+	 uint16_t sender_port,
+	 const uip_ipaddr_t *receiver_addr,
+	 uint16_t receiver_port,
+	 const uint8_t *data,
+	 uint16_t datalen)
+{
+  uint16_t id, len;
+
+  if(datalen < GET_SIZE) {
+    return;
+  }
+  id = (data[1] << 8) | data[2];
+
+  switch(data[0]) {
+  case MSG_REQUEST:
+    if(datalen <= REQUEST_HDR_SIZE ||
+       process_is_running(&shell_udprsh_server_process)) {
+      /* Repeated requests are dropped while the script runs, so that
+	 the requester can repeat a multicast request safely. */
+      return;
+    }
+    if(output_ready && id == request_id) {
+      return;
+    }
+    len = datalen - REQUEST_HDR_SIZE;
+    if(len > SCRIPT_SIZE) {
+      len = SCRIPT_SIZE;
+    }
+    memcpy(script, &data[REQUEST_HDR_SIZE], len);
+    script[len] = 0;
+    request_id = id;
+    reply_window = (data[3] << 8) | data[4];
+    uip_ipaddr_copy(&requester, sender_addr);
+    requester_port = sender_port;
+    output_ready = 0;
+    process_start(&shell_udprsh_server_process, NULL);
+    break;
+  case MSG_GET:
+    if(output_ready && id == request_id) {
+      send_block(sender_addr, sender_port, data[3]);
+    }
+    break;
+  case MSG_BLOCK:
+    if(datalen >= BLOCK_HDR_SIZE &&
+       process_is_running(&shell_udprsh_process) && id == client_id) {
+      handle_block(sender_addr, sender_port, data, datalen);
+    }
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_udprsh_process, ev, data)
+{
+  static struct etimer etimer;
+  static uip_ipaddr_t addr;
+  static uint16_t window;
+  static clock_time_t start;
+  char addrstr[48];
+  const char *next;
+  struct shell_input *input;
+  int len;
+  PROCESS_BEGIN();
+
+  next = strchr(data, ' ');
+  if(next == NULL || next - (char *)data >= (int)sizeof(addrstr)) {
+    shell_output_str(&udprsh_command,
+		     "udprsh <address> <reply window> [command]", "");
+    PROCESS_EXIT();
+  }
+  memcpy(addrstr, data, next - (char *)data);
+  addrstr[next - (char *)data] = 0;
+  if(!uiplib_ipaddrconv(addrstr, &addr)) {
+    shell_output_str(&udprsh_command, "udprsh: bad address ", addrstr);
+    PROCESS_EXIT();
+  }
+  window = shell_strtolong(next, &next);
+  while(*next == ' ') {
+    next++;
+  }
+
+  request_len = REQUEST_HDR_SIZE;
+  if(*next != 0) {
+    len = (int)strlen(next);
+    if(len > SCRIPT_SIZE) {
+      shell_output_str(&udprsh_command, "udprsh: command too long", "");
+      PROCESS_EXIT();
+    }
+    memcpy(&request[request_len], next, len);
+    request_len += len;
+  } else {
+    /* Read the script from the input, one command per line. */
+    while(1) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
+      input = data;
+      if(input->len1 + input->len2 == 0) {
+	break;
+      }
+      if(request_len + input->len1 + input->len2 + 1 >
+	 REQUEST_HDR_SIZE + SCRIPT_SIZE) {
+	shell_output_str(&udprsh_command, "udprsh: script too long", "");
+	PROCESS_EXIT();
+      }
+      memcpy(&request[request_len], input->data1, input->len1);
+      request_len += input->len1;
+      memcpy(&request[request_len], input->data2, input->len2);
+      request_len += input->len2;
+      request[request_len++] = '\n';
+    }
+  }
+
+  client_id = random_rand();
+  request[0] = MSG_REQUEST;
+  request[1] = client_id >> 8;
+  request[2] = client_id & 0xff;
+  request[3] = window >> 8;
+  request[4] = window & 0xff;
+  reply_busy = 0;
+  npending = 0;
+  simple_udp_sendto_port(&conn, request, request_len, &addr, PORT);
+
+  /* Collect replies until the reply window has passed and all replies
+     that have been announced are fetched. A GET that is not answered
+     is repeated a few times before the reply is given up. */
+  start = clock_time();
+  etimer_set(&etimer, RETRY_INTERVAL);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
+    etimer_reset(&etimer);
+    if(reply_busy && clock_time() - last_block >= RETRY_INTERVAL) {
+      if(++reply_retries > MAX_RETRIES) {
+	strcpy(&addrstr[sprint_addr(addrstr, &reply_addr)], ": ");
+	shell_output_str(&udprsh_command, addrstr, "(reply incomplete)");
+	next_reply();
+      } else {
+	send_get(&reply_addr, reply_port, reply_next);
+      }
+    }
+    if(!reply_busy && npending == 0 &&
+       clock_time() - start >= (clock_time_t)window * CLOCK_SECOND + TIMEOUT) {
+      break;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_udprsh_init(void)
+{
+  simple_udp_register(&conn, PORT, NULL, PORT, receiver);
+  shell_register_command(&udprsh_command);
+}
+/*---------------------------------------------------------------------------*/
@@ -73,6 +73,28 @@ static struct process *front_process;
 
 static unsigned long time_offset;
 
+#if SHELL_PIPES
+/* A pipe buffers the output of a command until the shell server
+   process hands it to the next command. Each output is stored as a
+   record of two 16-bit lengths followed by both halves of the data,
+   each zero-terminated. */
+struct shell_pipe {
+  struct shell_pipe *next;
+  struct shell_command *writer;
+  unsigned long bytes;
+  clock_time_t start;
+  uint16_t pos, len;
+  uint8_t delivering;
+  uint8_t buf[SHELL_PIPE_SIZE];
+};
+
+#define RECORD_SIZE(len1, len2) (4 + (len1) + 1 + (len2) + 1)
+
+MEMB(pipes_memb, struct shell_pipe, SHELL_PIPES);
+LIST(pipes);
+static uint8_t pipes_closed;
+#endif /* SHELL_PIPES */
+
 PROCESS(shell_process, "Shell");
 PROCESS(shell_server_process, "Shell server");
 /*---------------------------------------------------------------------------*/
@@ -90,6 +112,12 @@ SHELL_COMMAND(kill_command, "kill", "kill <command>: stop a specific command",
 PROCESS(shell_null_process, "null");
 SHELL_COMMAND(null_command, "null", "null: discard input",
 	      &shell_null_process);
+#if SHELL_PIPES
+PROCESS(shell_pipestat_process, "pipestat");
+SHELL_COMMAND(pipestat_command, "pipestat",
+	      "pipestat: show the output rate of the last piped commands",
+	      &shell_pipestat_process);
+#endif /* SHELL_PIPES */
 PROCESS(shell_exit_process, "exit");
 SHELL_COMMAND(exit_command, "exit", "exit: exit shell",
 	      &shell_exit_process);
@@ -111,6 +139,28 @@ PROCESS_THREAD(shell_null_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#if SHELL_PIPES
+PROCESS_THREAD(shell_pipestat_process, ev, data)
+{
+  struct shell_command *c;
+  unsigned long ms;
+  char buf[64];
+  PROCESS_BEGIN();
+
+  for(c = list_head(commands); c != NULL; c = c->next) {
+    if(c->output_bytes > 0) {
+      ms = (unsigned long)c->output_time * 1000 / CLOCK_SECOND;
+      snprintf(buf, sizeof(buf), "%lu bytes in %lu ms, %lu bytes/s ",
+	       c->output_bytes, ms,
+	       ms == 0 ? 0 : c->output_bytes * 1000 / ms);
+      shell_output_str(&pipestat_command, buf, c->command);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* SHELL_PIPES */
+/*---------------------------------------------------------------------------*/
 static void
 command_kill(struct shell_command *c)
 {
@@ -296,6 +346,20 @@ start_command(char *commandline, struct shell_command *child)
     c = NULL;
   } else {
     c->child = child;
+#if SHELL_PIPES
+    c->pipe = NULL;
+    if(child != NULL) {
+      c->pipe = memb_alloc(&pipes_memb);
+      if(c->pipe != NULL) {
+	c->pipe->writer = c;
+	c->pipe->bytes = 0;
+	c->pipe->start = clock_time();
+	c->pipe->pos = c->pipe->len = 0;
+	c->pipe->delivering = 0;
+	list_add(pipes, c->pipe);
+      }
+    }
+#endif /* SHELL_PIPES */
     /*    printf("shell: start_command starting '%s'\n", c->process->name);*/
     /* Start a new process for the command. */
     process_start(c->process, (void *)args);
@@ -355,6 +419,125 @@ input_to_child_command(struct shell_command *c,
   }
 }
 /*---------------------------------------------------------------------------*/
+#if SHELL_PIPES
+/* Hand the buffered output of a command to the next command. Unless
+   all is set, only the records that were in the pipe when the
+   function was called are delivered. */
+static void
+pipe_deliver(struct shell_pipe *pipe, int all)
+{
+  uint16_t end, len1, len2;
+  uint8_t *record;
+
+  pipe->delivering = 1;
+  end = pipe->len;
+  while(pipe->pos < (all ? pipe->len : end)) {
+    record = &pipe->buf[pipe->pos];
+    len1 = record[0] | (record[1] << 8);
+    len2 = record[2] | (record[3] << 8);
+    pipe->pos += RECORD_SIZE(len1, len2);
+    input_to_child_command(pipe->writer->child,
+			   (char *)&record[4], len1,
+			   (char *)&record[4 + len1 + 1], len2);
+    if(pipe->writer == NULL) {
+      /* The pipe was closed while the next command ran. */
+      return;
+    }
+  }
+  if(pipe->pos == pipe->len) {
+    pipe->pos = pipe->len = 0;
+  }
+  pipe->delivering = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+pipe_close(struct shell_command *c)
+{
+  if(c->pipe != NULL) {
+    pipe_deliver(c->pipe, 1);
+    c->output_bytes = c->pipe->bytes;
+    c->output_time = clock_time() - c->pipe->start;
+    c->pipe->writer = NULL;
+    list_remove(pipes, c->pipe);
+    memb_free(&pipes_memb, c->pipe);
+    pipes_closed++;
+    c->pipe = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+pipe_write(struct shell_pipe *pipe,
+	   const char *data1, int len1,
+	   const char *data2, int len2)
+{
+  uint8_t *record;
+
+  if(RECORD_SIZE(len1, len2) > SHELL_PIPE_SIZE - pipe->len) {
+    if(pipe->delivering || pipe->pos == 0) {
+      return 0;
+    }
+    /* Move the undelivered records to the start of the buffer. */
+    memmove(pipe->buf, &pipe->buf[pipe->pos], pipe->len - pipe->pos);
+    pipe->len -= pipe->pos;
+    pipe->pos = 0;
+    if(RECORD_SIZE(len1, len2) > SHELL_PIPE_SIZE - pipe->len) {
+      return 0;
+    }
+  }
+
+  record = &pipe->buf[pipe->len];
+  record[0] = len1 & 0xff;
+  record[1] = len1 >> 8;
+  record[2] = len2 & 0xff;
+  record[3] = len2 >> 8;
+  memcpy(&record[4], data1, len1);
+  record[4 + len1] = 0;
+  memcpy(&record[4 + len1 + 1], data2, len2);
+  record[4 + len1 + 1 + len2] = 0;
+  pipe->len += RECORD_SIZE(len1, len2);
+  pipe->bytes += len1 + len2;
+
+  process_poll(&shell_server_process);
+  return 1;
+}
+#endif /* SHELL_PIPES */
+/*---------------------------------------------------------------------------*/
+static void
+output_to_child_command(struct shell_command *c,
+			char *data1, int len1,
+			const char *data2, int len2)
+{
+#if SHELL_PIPES
+  if(c->pipe != NULL) {
+    if(pipe_write(c->pipe, data1, len1, data2, len2)) {
+      return;
+    }
+    /* The pipe is full: keep the order of the output by handing over
+       the buffered records before this one. */
+    if(!c->pipe->delivering) {
+      pipe_deliver(c->pipe, 1);
+    }
+    c->pipe->bytes += len1 + len2;
+  }
+#endif /* SHELL_PIPES */
+  input_to_child_command(c->child, data1, len1, data2, len2);
+}
+/*---------------------------------------------------------------------------*/
+int
+shell_output_ready(struct shell_command *c, int size)
+{
+#if SHELL_PIPES
+  if(c != NULL && c->child != NULL && c->pipe != NULL) {
+    if(RECORD_SIZE(size, 0) + 1 > SHELL_PIPE_SIZE) {
+      return c->pipe->len == 0;
+    }
+    return RECORD_SIZE(size, 0) + 1 <=
+      SHELL_PIPE_SIZE - (c->pipe->len - c->pipe->pos);
+  }
+#endif /* SHELL_PIPES */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 void
 shell_input(char *commandline, int commandline_len)
 {
@@ -383,8 +566,8 @@ void
 shell_output_str(struct shell_command *c, char *text1, const char *text2)
 {
   if(c != NULL && c->child != NULL) {
-    input_to_child_command(c->child, text1, (int)strlen(text1),
-			   text2, (int)strlen(text2));
+    output_to_child_command(c, text1, (int)strlen(text1),
+			    text2, (int)strlen(text2));
   } else {
     shell_default_output(text1, (int)strlen(text1),
 			 text2, (int)strlen(text2));
@@ -397,7 +580,7 @@ shell_output(struct shell_command *c,
 	     const void *data2, int len2)
 {
   if(c != NULL && c->child != NULL) {
-    input_to_child_command(c->child, data1, len1, data2, len2);
+    output_to_child_command(c, data1, len1, data2, len2);
   } else {
     shell_default_output(data1, len1, data2, len2);
   }
@@ -481,6 +664,10 @@ PROCESS_THREAD(shell_server_process, ev, data)
 	  c != NULL && c->process != p;
 	  c = c->next);
       while(c != NULL) {
+#if SHELL_PIPES
+	/* Hand over the remaining output before the end of input. */
+	pipe_close(c);
+#endif /* SHELL_PIPES */
 	if(c->child != NULL && c->child->process != NULL) {
 	  /*	  printf("Killing '%s'\n", c->process->name);*/
 	  input_to_child_command(c->child, "", 0, "", 0);
@@ -488,6 +675,25 @@ PROCESS_THREAD(shell_server_process, ev, data)
 	}
 	c = c->child;
       }
+#if SHELL_PIPES
+    } else if(ev == PROCESS_EVENT_POLL) {
+      struct shell_pipe *pipe;
+      uint8_t closed = pipes_closed;
+      for(pipe = list_head(pipes); pipe != NULL; pipe = pipe->next) {
+	if(pipe->pos < pipe->len) {
+	  pipe_deliver(pipe, 0);
+	  /* Let a producer that waits for room continue. */
+	  if(pipe->writer != NULL) {
+	    process_poll(pipe->writer->process);
+	  }
+	  if(closed != pipes_closed) {
+	    /* The list has changed: start over on the next poll. */
+	    process_poll(&shell_server_process);
+	    break;
+	  }
+	}
+      }
+#endif /* SHELL_PIPES */
     } else if(ev == PROCESS_EVENT_TIMER) {
       etimer_reset(&etimer);
       shell_set_time(shell_time());
@@ -506,6 +712,11 @@ shell_init(void)
   shell_register_command(&killall_command);
   shell_register_command(&kill_command);
   shell_register_command(&null_command);
+#if SHELL_PIPES
+  shell_register_command(&pipestat_command);
+  memb_init(&pipes_memb);
+  list_init(pipes);
+#endif /* SHELL_PIPES */
   shell_register_command(&exit_command);
   shell_register_command(&quit_command);
   
@@ -61,6 +61,27 @@
 #define SHELL_H_
 
 #include "sys/process.h"
+#include "sys/clock.h"
+
+/* The number of buffered pipes between the commands of a pipeline.
+   Output from a command with a pipe is buffered and handed to the
+   next command by the shell server process, so that the producer can
+   wait for the consumer with SHELL_OUTPUT_WAIT(). With no free pipe,
+   or with the option set to 0, output is handed over directly. */
+#ifdef SHELL_CONF_PIPES
+#define SHELL_PIPES SHELL_CONF_PIPES
+#else /* SHELL_CONF_PIPES */
+#define SHELL_PIPES 0
+#endif /* SHELL_CONF_PIPES */
+
+/* The size of the buffer of each pipe. */
+#ifdef SHELL_CONF_PIPE_SIZE
+#define SHELL_PIPE_SIZE SHELL_CONF_PIPE_SIZE
+#else /* SHELL_CONF_PIPE_SIZE */
+#define SHELL_PIPE_SIZE 128
+#endif /* SHELL_CONF_PIPE_SIZE */
+
+struct shell_pipe;
 
 /**
  * \brief      Holds a information about a shell command
@@ -76,6 +97,11 @@ struct shell_command {
   char *description;
   struct process *process;
   struct shell_command *child;
+#if SHELL_PIPES
+  struct shell_pipe *pipe;
+  unsigned long output_bytes;
+  clock_time_t output_time;
+#endif /* SHELL_PIPES */
 };
 
 /**
@@ -257,6 +283,42 @@ void shell_output(struct shell_command *c,
 void shell_output_str(struct shell_command *c,
 		      char *str1, const char *str2);
 
+/**
+ * \brief      Check if a shell command can output without blocking
+ * \param c    The command that outputs data
+ * \param size The total size of the data to output
+ * \return     Non-zero if the output fits in the pipe to the next command
+ *
+ *             A command that outputs much data in a loop uses this
+ *             function, through SHELL_OUTPUT_WAIT(), to let the next
+ *             command in the pipeline catch up. Output that does not
+ *             fit is still delivered, but directly to the next
+ *             command, which takes away the producer's chance to
+ *             yield.
+ *
+ */
+int shell_output_ready(struct shell_command *c, int size);
+
+/**
+ * \brief      Wait until a shell command can output data
+ * \param c    The command that outputs data
+ * \param size The total size of the data to output
+ *
+ *             This macro blocks the calling process until the pipe
+ *             to the next command has room for size bytes of
+ *             output. It must be called from the process thread of
+ *             the command, and local variables are lost while it
+ *             waits.
+ *
+ * \hideinitializer
+ */
+#if SHELL_PIPES
+#define SHELL_OUTPUT_WAIT(c, size) \
+  PROCESS_WAIT_UNTIL(shell_output_ready(c, size))
+#else /* SHELL_PIPES */
+#define SHELL_OUTPUT_WAIT(c, size)
+#endif /* SHELL_PIPES */
+
 /**
  * \brief      Register a command with the shell
  * \param c    A pointer to a shell command structure, defined with SHELL_COMMAND()
@@ -384,9 +446,11 @@ struct shell_input {
 #include "shell-memdebug.h"
 #include "shell-netperf.h"
 #include "shell-netstat.h"
+#include "shell-packet-trace.h"
 #include "shell-ping.h"
 #include "shell-power.h"
 #include "shell-powertrace.h"
+#include "shell-profile.h"
 #include "shell-ps.h"
 #include "shell-reboot.h"
 #include "shell-rime-debug.h"
@@ -405,6 +469,7 @@ struct shell_input {
 #include "shell-tcpsend.h"
 #include "shell-text.h"
 #include "shell-time.h"
+#include "shell-udprsh.h"
 #include "shell-udpsend.h"
 #include "shell-vars.h"
 #include "shell-wget.h"
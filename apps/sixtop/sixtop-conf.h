@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         6top configuration
+ */
+
+#ifndef __SIXTOP_CONF_H__
+#define __SIXTOP_CONF_H__
+
+/* Max number of neighbors we keep 6P state (sequence numbers and
+ * transactions) for */
+#ifdef SIXTOP_CONF_MAX_NEIGHBORS
+#define SIXTOP_MAX_NEIGHBORS                      SIXTOP_CONF_MAX_NEIGHBORS
+#else /* SIXTOP_CONF_MAX_NEIGHBORS */
+#define SIXTOP_MAX_NEIGHBORS                      8
+#endif /* SIXTOP_CONF_MAX_NEIGHBORS */
+
+/* Max number of cells in a 6P cell list */
+#ifdef SIXTOP_CONF_MAX_CELLS
+#define SIXTOP_MAX_CELLS                          SIXTOP_CONF_MAX_CELLS
+#else /* SIXTOP_CONF_MAX_CELLS */
+#define SIXTOP_MAX_CELLS                          5
+#endif /* SIXTOP_CONF_MAX_CELLS */
+
+/* Time after which a 6P transaction without response is aborted */
+#ifdef SIXTOP_CONF_TIMEOUT
+#define SIXTOP_TIMEOUT                            SIXTOP_CONF_TIMEOUT
+#else /* SIXTOP_CONF_TIMEOUT */
+#define SIXTOP_TIMEOUT                            (10 * CLOCK_SECOND)
+#endif /* SIXTOP_CONF_TIMEOUT */
+
+/* The handle and length of the slotframe holding the cells negotiated
+ * by the MSF scheduling function. The handle sets the slotframe priority,
+ * use one above the slotframes of any autonomous schedule (e.g. Orchestra) */
+#ifdef SIXTOP_MSF_CONF_SLOTFRAME_HANDLE
+#define SIXTOP_MSF_SLOTFRAME_HANDLE               SIXTOP_MSF_CONF_SLOTFRAME_HANDLE
+#else /* SIXTOP_MSF_CONF_SLOTFRAME_HANDLE */
+#define SIXTOP_MSF_SLOTFRAME_HANDLE               1
+#endif /* SIXTOP_MSF_CONF_SLOTFRAME_HANDLE */
+
+#ifdef SIXTOP_MSF_CONF_SLOTFRAME_LENGTH
+#define SIXTOP_MSF_SLOTFRAME_LENGTH               SIXTOP_MSF_CONF_SLOTFRAME_LENGTH
+#else /* SIXTOP_MSF_CONF_SLOTFRAME_LENGTH */
+#define SIXTOP_MSF_SLOTFRAME_LENGTH               101
+#endif /* SIXTOP_MSF_CONF_SLOTFRAME_LENGTH */
+
+/* Channel offsets are drawn in [0, SIXTOP_MSF_NUM_CHANNEL_OFFSETS[ */
+#ifdef SIXTOP_MSF_CONF_NUM_CHANNEL_OFFSETS
+#define SIXTOP_MSF_NUM_CHANNEL_OFFSETS            SIXTOP_MSF_CONF_NUM_CHANNEL_OFFSETS
+#else /* SIXTOP_MSF_CONF_NUM_CHANNEL_OFFSETS */
+#define SIXTOP_MSF_NUM_CHANNEL_OFFSETS            16
+#endif /* SIXTOP_MSF_CONF_NUM_CHANNEL_OFFSETS */
+
+/* Min and max number of Tx cells to the parent */
+#ifdef SIXTOP_MSF_CONF_MIN_CELLS
+#define SIXTOP_MSF_MIN_CELLS                      SIXTOP_MSF_CONF_MIN_CELLS
+#else /* SIXTOP_MSF_CONF_MIN_CELLS */
+#define SIXTOP_MSF_MIN_CELLS                      1
+#endif /* SIXTOP_MSF_CONF_MIN_CELLS */
+
+#ifdef SIXTOP_MSF_CONF_MAX_CELLS
+#define SIXTOP_MSF_MAX_CELLS                      SIXTOP_MSF_CONF_MAX_CELLS
+#else /* SIXTOP_MSF_CONF_MAX_CELLS */
+#define SIXTOP_MSF_MAX_CELLS                      8
+#endif /* SIXTOP_MSF_CONF_MAX_CELLS */
+
+/* Number of elapsed Tx cells after which the cell usage is evaluated */
+#ifdef SIXTOP_MSF_CONF_MAX_NUM_CELLS
+#define SIXTOP_MSF_MAX_NUM_CELLS                  SIXTOP_MSF_CONF_MAX_NUM_CELLS
+#else /* SIXTOP_MSF_CONF_MAX_NUM_CELLS */
+#define SIXTOP_MSF_MAX_NUM_CELLS                  16
+#endif /* SIXTOP_MSF_CONF_MAX_NUM_CELLS */
+
+/* Cell usage (in percent) above which a cell is added, below which one is
+ * deleted */
+#ifdef SIXTOP_MSF_CONF_LIM_HIGH
+#define SIXTOP_MSF_LIM_HIGH                       SIXTOP_MSF_CONF_LIM_HIGH
+#else /* SIXTOP_MSF_CONF_LIM_HIGH */
+#define SIXTOP_MSF_LIM_HIGH                       75
+#endif /* SIXTOP_MSF_CONF_LIM_HIGH */
+
+#ifdef SIXTOP_MSF_CONF_LIM_LOW
+#define SIXTOP_MSF_LIM_LOW                        SIXTOP_MSF_CONF_LIM_LOW
+#else /* SIXTOP_MSF_CONF_LIM_LOW */
+#define SIXTOP_MSF_LIM_LOW                        25
+#endif /* SIXTOP_MSF_CONF_LIM_LOW */
+
+/* Number of packets queued for the parent above which a cell is added
+ * without waiting for the usage estimate. 0 to disable */
+#ifdef SIXTOP_MSF_CONF_QUEUE_THRESHOLD
+#define SIXTOP_MSF_QUEUE_THRESHOLD                SIXTOP_MSF_CONF_QUEUE_THRESHOLD
+#else /* SIXTOP_MSF_CONF_QUEUE_THRESHOLD */
+#define SIXTOP_MSF_QUEUE_THRESHOLD                4
+#endif /* SIXTOP_MSF_CONF_QUEUE_THRESHOLD */
+
+/* Period of the MSF housekeeping, where cells are added or deleted */
+#ifdef SIXTOP_MSF_CONF_HOUSEKEEPING_PERIOD
+#define SIXTOP_MSF_HOUSEKEEPING_PERIOD            SIXTOP_MSF_CONF_HOUSEKEEPING_PERIOD
+#else /* SIXTOP_MSF_CONF_HOUSEKEEPING_PERIOD */
+#define SIXTOP_MSF_HOUSEKEEPING_PERIOD            (5 * CLOCK_SECOND)
+#endif /* SIXTOP_MSF_CONF_HOUSEKEEPING_PERIOD */
+
+#endif /* __SIXTOP_CONF_H__ */
@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         A traffic-adaptive scheduling function for 6top, after the
+ *         6TiSCH Minimal Scheduling Function (MSF). A node negotiates
+ *         dedicated Tx cells to its time source (the RPL preferred parent)
+ *         in a slotframe of its own. It counts how many of these cells were
+ *         used, and adds a cell when the usage goes above
+ *         SIXTOP_MSF_LIM_HIGH or the queue to the parent builds up, or
+ *         deletes one when the usage goes below SIXTOP_MSF_LIM_LOW. It
+ *         moves its cells to a new parent on parent switch.
+ */
+
+#include "contiki.h"
+#include "sixtop.h"
+#include "net/mac/mac.h"
+#include "net/mac/tsch/tsch-slot-operation.h"
+#include "lib/random.h"
+#include "sys/ctimer.h"
+#include <string.h>
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+/* The SFID of MSF */
+#define SIXTOP_MSF_SFID 0
+
+static struct tsch_slotframe *sf_msf;
+static linkaddr_t parent_addr;
+static int has_parent;
+static struct ctimer housekeeping_timer;
+static struct sixtop_msf_stats stats;
+
+/* Tx cells to the parent elapsed and used since the last usage estimate.
+ * Updated from the slot operation */
+static volatile uint16_t num_cells_elapsed;
+static volatile uint16_t num_cells_used;
+
+/* Timeslots proposed in our ongoing ADD request, not to be given away
+ * to a child meanwhile */
+static uint16_t reserved[SIXTOP_MAX_CELLS];
+static uint8_t reserved_count;
+
+/*---------------------------------------------------------------------------*/
+static int
+cell_is_free(uint16_t timeslot)
+{
+  int i;
+  if(timeslot == 0 || timeslot >= SIXTOP_MSF_SLOTFRAME_LENGTH
+     || tsch_schedule_get_link_by_timeslot(sf_msf, timeslot) != NULL) {
+    /* Timeslot 0 is kept for the minimal or EB cells of other slotframes */
+    return 0;
+  }
+  for(i = 0; i < reserved_count; i++) {
+    if(reserved[i] == timeslot) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Number of cells with a neighbor having some of the given link options */
+static int
+count_cells(const linkaddr_t *addr, uint8_t link_options)
+{
+  int count = 0;
+  struct tsch_link *l = NULL;
+  while((l = tsch_schedule_get_link_next(sf_msf, l)) != NULL) {
+    if((addr == NULL || linkaddr_cmp(&l->addr, addr))
+       && (l->link_options & link_options)) {
+      count++;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_cells(const linkaddr_t *addr)
+{
+  struct tsch_link *l = NULL;
+  struct tsch_link *next;
+  l = tsch_schedule_get_link_next(sf_msf, NULL);
+  while(l != NULL) {
+    next = tsch_schedule_get_link_next(sf_msf, l);
+    if(linkaddr_cmp(&l->addr, addr)) {
+      tsch_schedule_remove_link(sf_msf, l);
+    }
+    l = next;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The link options installed by the responder, reversed from the 6P cell
+ * options of the request */
+static uint8_t
+responder_link_options(uint8_t cell_options)
+{
+  uint8_t link_options = 0;
+  if(cell_options & SIXP_CELL_OPTION_TX) {
+    link_options |= LINK_OPTION_RX;
+  }
+  if(cell_options & SIXP_CELL_OPTION_RX) {
+    link_options |= LINK_OPTION_TX;
+  }
+  if(cell_options & SIXP_CELL_OPTION_SHARED) {
+    link_options |= LINK_OPTION_SHARED;
+  }
+  return link_options;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_clear(const linkaddr_t *peer)
+{
+  struct sixp_msg req;
+  memset(&req, 0, sizeof(req));
+  req.code = SIXP_CMD_CLEAR;
+  /* Cells are removed regardless of the outcome of the CLEAR */
+  remove_cells(peer);
+  if(sixtop_request(peer, &req)) {
+    stats.clears++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_add(int num_cells)
+{
+  struct sixp_msg req;
+  int attempts;
+
+  memset(&req, 0, sizeof(req));
+  req.code = SIXP_CMD_ADD;
+  req.cell_options = SIXP_CELL_OPTION_TX;
+  req.num_cells = num_cells;
+
+  /* Propose random free cells, the parent picks among them */
+  reserved_count = 0;
+  for(attempts = 0; attempts < 4 * SIXTOP_MAX_CELLS
+      && req.cell_count < SIXTOP_MAX_CELLS; attempts++) {
+    uint16_t timeslot = random_rand() % SIXTOP_MSF_SLOTFRAME_LENGTH;
+    if(cell_is_free(timeslot)) {
+      req.cells[req.cell_count].timeslot = timeslot;
+      req.cells[req.cell_count].channel_offset = random_rand() % SIXTOP_MSF_NUM_CHANNEL_OFFSETS;
+      req.cell_count++;
+      reserved[reserved_count++] = timeslot;
+    }
+  }
+
+  if(req.cell_count == 0 || !sixtop_request(&parent_addr, &req)) {
+    reserved_count = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_delete(void)
+{
+  struct sixp_msg req;
+  struct tsch_link *l = NULL;
+
+  memset(&req, 0, sizeof(req));
+  req.code = SIXP_CMD_DELETE;
+  req.cell_options = SIXP_CELL_OPTION_TX;
+  req.num_cells = 1;
+
+  while((l = tsch_schedule_get_link_next(sf_msf, l)) != NULL) {
+    if(linkaddr_cmp(&l->addr, &parent_addr) && (l->link_options & LINK_OPTION_TX)) {
+      req.cells[0].timeslot = l->timeslot;
+      req.cells[0].channel_offset = l->channel_offset;
+      req.cell_count = 1;
+    }
+  }
+
+  if(req.cell_count > 0) {
+    sixtop_request(&parent_addr, &req);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+housekeeping(void *ptr)
+{
+  int num_tx_cells;
+  uint16_t elapsed = 0;
+  uint16_t used = 0;
+
+  ctimer_set(&housekeeping_timer, SIXTOP_MSF_HOUSEKEEPING_PERIOD, housekeeping, NULL);
+
+  if(!has_parent || sf_msf == NULL || sixtop_is_busy(&parent_addr)) {
+    return;
+  }
+
+  num_tx_cells = count_cells(&parent_addr, LINK_OPTION_TX);
+  if(num_tx_cells < SIXTOP_MSF_MIN_CELLS) {
+    send_add(SIXTOP_MSF_MIN_CELLS - num_tx_cells);
+    return;
+  }
+
+#if SIXTOP_MSF_QUEUE_THRESHOLD
+  if(num_tx_cells < SIXTOP_MSF_MAX_CELLS
+     && tsch_queue_packet_count(&parent_addr) >= SIXTOP_MSF_QUEUE_THRESHOLD) {
+    PRINTF("6top-msf: queue to parent is %u, add a cell\n",
+           tsch_queue_packet_count(&parent_addr));
+    send_add(1);
+    return;
+  }
+#endif /* SIXTOP_MSF_QUEUE_THRESHOLD */
+
+  if(num_cells_elapsed < SIXTOP_MSF_MAX_NUM_CELLS || !tsch_get_lock()) {
+    return;
+  }
+  elapsed = num_cells_elapsed;
+  used = num_cells_used;
+  num_cells_elapsed = 0;
+  num_cells_used = 0;
+  tsch_release_lock();
+
+  stats.last_usage = (uint32_t)used * 100 / elapsed;
+  PRINTF("6top-msf: %u Tx cells, usage %u%%\n", num_tx_cells, stats.last_usage);
+  if(stats.last_usage > SIXTOP_MSF_LIM_HIGH && num_tx_cells < SIXTOP_MSF_MAX_CELLS) {
+    send_add(1);
+  } else if(stats.last_usage < SIXTOP_MSF_LIM_LOW && num_tx_cells > SIXTOP_MSF_MIN_CELLS) {
+    send_delete();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sixtop_msf_callback_cell_elapsed(struct tsch_link *link, int used)
+{
+  if(has_parent && link->slotframe_handle == SIXTOP_MSF_SLOTFRAME_HANDLE
+     && (link->link_options & LINK_OPTION_TX)
+     && linkaddr_cmp(&link->addr, &parent_addr)
+     && num_cells_elapsed < 0xffff) {
+    num_cells_elapsed++;
+    if(used) {
+      num_cells_used++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sixtop_msf_callback_new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new)
+{
+  if(sf_msf == NULL) {
+    return;
+  }
+  if(old != NULL && (new == NULL || !linkaddr_cmp(&old->addr, &new->addr))) {
+    /* Give our cells back to the former parent */
+    send_clear(&old->addr);
+  }
+  if(new != NULL) {
+    linkaddr_copy(&parent_addr, &new->addr);
+    has_parent = 1;
+  } else {
+    has_parent = 0;
+  }
+  num_cells_elapsed = 0;
+  num_cells_used = 0;
+  /* Get a first cell with the new parent soon */
+  ctimer_set(&housekeeping_timer, CLOCK_SECOND, housekeeping, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+request_input(const linkaddr_t *peer, const struct sixp_msg *req, struct sixp_msg *res)
+{
+  int i;
+  struct tsch_link *l;
+
+  switch(req->code) {
+    case SIXP_CMD_ADD:
+      /* Accept the first free candidates */
+      for(i = 0; i < req->cell_count && res->cell_count < req->num_cells; i++) {
+        int j;
+        int taken = !cell_is_free(req->cells[i].timeslot);
+        for(j = 0; j < res->cell_count; j++) {
+          taken |= res->cells[j].timeslot == req->cells[i].timeslot;
+        }
+        if(!taken) {
+          res->cells[res->cell_count++] = req->cells[i];
+        }
+      }
+      return SIXP_RC_SUCCESS;
+    case SIXP_CMD_DELETE:
+      for(i = 0; i < req->cell_count && res->cell_count < req->num_cells; i++) {
+        l = tsch_schedule_get_link_by_timeslot(sf_msf, req->cells[i].timeslot);
+        if(l != NULL && linkaddr_cmp(&l->addr, peer)
+           && l->channel_offset == req->cells[i].channel_offset) {
+          res->cells[res->cell_count++] = req->cells[i];
+        }
+      }
+      return res->cell_count > 0 ? SIXP_RC_SUCCESS : SIXP_RC_ERR_CELLLIST;
+    case SIXP_CMD_COUNT:
+      res->total_num_cells = count_cells(peer, responder_link_options(req->cell_options));
+      return SIXP_RC_SUCCESS;
+    case SIXP_CMD_LIST:
+      {
+        uint16_t index = 0;
+        uint8_t options = responder_link_options(req->cell_options);
+        l = NULL;
+        while((l = tsch_schedule_get_link_next(sf_msf, l)) != NULL) {
+          if(!linkaddr_cmp(&l->addr, peer) || !(l->link_options & options)) {
+            continue;
+          }
+          if(index++ < req->offset) {
+            continue;
+          }
+          if(res->cell_count == SIXTOP_MAX_CELLS || res->cell_count == req->max_num_cells) {
+            return SIXP_RC_SUCCESS;
+          }
+          res->cells[res->cell_count].timeslot = l->timeslot;
+          res->cells[res->cell_count].channel_offset = l->channel_offset;
+          res->cell_count++;
+        }
+        return SIXP_RC_EOL;
+      }
+    case SIXP_CMD_CLEAR:
+      return SIXP_RC_SUCCESS;
+    default:
+      return SIXP_RC_ERR;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_sent(const linkaddr_t *peer, const struct sixp_msg *req,
+              const struct sixp_msg *res, int status)
+{
+  int i;
+
+  if(res->code != SIXP_RC_SUCCESS) {
+    return;
+  }
+  if(req->code == SIXP_CMD_CLEAR) {
+    /* Applied regardless of whether the response was received */
+    remove_cells(peer);
+    return;
+  }
+  if(status != MAC_TX_OK) {
+    return;
+  }
+  for(i = 0; i < res->cell_count; i++) {
+    if(req->code == SIXP_CMD_ADD) {
+      tsch_schedule_add_link(sf_msf, responder_link_options(req->cell_options),
+                             LINK_TYPE_NORMAL, peer,
+                             res->cells[i].timeslot, res->cells[i].channel_offset);
+    } else if(req->code == SIXP_CMD_DELETE) {
+      tsch_schedule_remove_link_by_timeslot(sf_msf, res->cells[i].timeslot);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_input(const linkaddr_t *peer, const struct sixp_msg *req,
+               const struct sixp_msg *res)
+{
+  int i;
+  struct tsch_link *l;
+
+  if(req->code == SIXP_CMD_ADD) {
+    reserved_count = 0;
+  }
+
+  if(res->code == SIXP_RC_ERR_SEQNUM) {
+    /* Our schedules with this neighbor are inconsistent, start over */
+    stats.failures++;
+    send_clear(peer);
+    return;
+  }
+  if(res->code != SIXP_RC_SUCCESS) {
+    if(req->code != SIXP_CMD_CLEAR) {
+      stats.failures++;
+    }
+    return;
+  }
+
+  for(i = 0; i < res->cell_count; i++) {
+    if(req->code == SIXP_CMD_ADD) {
+      /* The cell may have been given to a child since we proposed it */
+      if(tsch_schedule_get_link_by_timeslot(sf_msf, res->cells[i].timeslot) == NULL
+         && tsch_schedule_add_link(sf_msf, LINK_OPTION_TX, LINK_TYPE_NORMAL, peer,
+                                   res->cells[i].timeslot, res->cells[i].channel_offset) != NULL) {
+        stats.adds++;
+      }
+    } else if(req->code == SIXP_CMD_DELETE) {
+      l = tsch_schedule_get_link_by_timeslot(sf_msf, res->cells[i].timeslot);
+      if(l != NULL && linkaddr_cmp(&l->addr, peer)) {
+        tsch_schedule_remove_link(sf_msf, l);
+        stats.deletes++;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+timeout(const linkaddr_t *peer, const struct sixp_msg *req)
+{
+  if(req->code == SIXP_CMD_ADD) {
+    reserved_count = 0;
+  }
+  stats.failures++;
+  /* The next housekeeping tries again */
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  sf_msf = tsch_schedule_add_slotframe(SIXTOP_MSF_SLOTFRAME_HANDLE, SIXTOP_MSF_SLOTFRAME_LENGTH);
+  if(sf_msf == NULL) {
+    PRINTF("6top-msf:! could not add slotframe\n");
+    return;
+  }
+  ctimer_set(&housekeeping_timer, SIXTOP_MSF_HOUSEKEEPING_PERIOD, housekeeping, NULL);
+}
+/*---------------------------------------------------------------------------*/
+const struct sixtop_msf_stats *
+sixtop_msf_get_stats(void)
+{
+  if(sf_msf != NULL) {
+    stats.num_tx_cells = has_parent ? count_cells(&parent_addr, LINK_OPTION_TX) : 0;
+    stats.num_rx_cells = count_cells(NULL, LINK_OPTION_RX);
+  }
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
+const struct sixtop_sf sixtop_msf = {
+  SIXTOP_MSF_SFID,
+  init,
+  request_input,
+  response_sent,
+  response_input,
+  timeout,
+};
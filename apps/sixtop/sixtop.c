@@ -0,0 +1,514 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         6top Protocol (6P, RFC 8480). Runs 2-step transactions with
+ *         neighbors and keeps one sequence number per neighbor. The
+ *         cells to add or delete are chosen by a scheduling function.
+ *         6P messages travel in a payload IETF IE, see tsch_send_ietf.
+ */
+
+#include "contiki.h"
+#include "sixtop.h"
+#include "net/mac/mac.h"
+#include "net/mac/tsch/tsch-packet.h"
+#include "net/mac/tsch/tsch-log.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "sys/ctimer.h"
+#include <string.h>
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+/* Length of the sub-ID and 6P header */
+#define SIXP_HDR_LEN 5
+
+#define WRITE16(buf, val) \
+  do { ((uint8_t *)(buf))[0] = (val) & 0xff; \
+       ((uint8_t *)(buf))[1] = ((val) >> 8) & 0xff; } while(0)
+
+#define READ16(buf) \
+  (((uint8_t *)(buf))[0] | ((uint8_t *)(buf))[1] << 8)
+
+enum sixp_state {
+  SIXP_STATE_IDLE,
+  SIXP_STATE_REQ_SENDING, /* Our request is in the TSCH queue */
+  SIXP_STATE_REQ_SENT, /* Our request was ACKed, waiting for the response */
+  SIXP_STATE_RES_SENDING, /* Our response is in the TSCH queue */
+};
+
+/* The 6P state kept for a neighbor */
+struct sixp_nbr {
+  struct sixp_nbr *next;
+  linkaddr_t addr;
+  /* The sequence number of the next transaction, in either direction */
+  uint8_t seqnum;
+  uint8_t state;
+  /* Number of our frames to this neighbor still in the TSCH queue. The
+   * entry is not reused before their sent callback was called */
+  uint8_t tx_pending;
+  /* The ongoing transaction */
+  struct sixp_msg req;
+  struct sixp_msg res;
+  struct ctimer timer;
+};
+
+MEMB(nbr_memb, struct sixp_nbr, SIXTOP_MAX_NEIGHBORS);
+LIST(nbr_list);
+
+static const struct sixtop_sf *current_sf;
+static uint8_t msg_buf[TSCH_PACKET_MAX_LEN];
+
+/*---------------------------------------------------------------------------*/
+/* 0 is used only for the first transaction after a reset or a CLEAR */
+static uint8_t
+next_seqnum(uint8_t seqnum)
+{
+  return seqnum == 0xff ? 1 : seqnum + 1;
+}
+/*---------------------------------------------------------------------------*/
+static struct sixp_nbr *
+get_nbr(const linkaddr_t *addr, int create)
+{
+  struct sixp_nbr *n;
+  for(n = list_head(nbr_list); n != NULL; n = list_item_next(n)) {
+    if(linkaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+  }
+  if(!create) {
+    return NULL;
+  }
+  n = memb_alloc(&nbr_memb);
+  if(n == NULL) {
+    /* Reuse the entry of an idle neighbor. Should it start a transaction
+     * again, the sequence numbers will mismatch and it will CLEAR */
+    for(n = list_head(nbr_list); n != NULL; n = list_item_next(n)) {
+      if(n->state == SIXP_STATE_IDLE && n->tx_pending == 0) {
+        break;
+      }
+    }
+    if(n == NULL) {
+      PRINTF("6top:! no room for a new neighbor\n");
+      return NULL;
+    }
+    list_remove(nbr_list, n);
+  }
+  memset(n, 0, sizeof(struct sixp_nbr));
+  linkaddr_copy(&n->addr, addr);
+  n->state = SIXP_STATE_IDLE;
+  list_add(nbr_list, n);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Write a 6P message, with the sub-ID. cmd is the command a response
+ * answers. Returns the length, or -1 */
+static int
+build_msg(const struct sixp_msg *m, uint8_t cmd, uint8_t *buf, int buf_size)
+{
+  int i;
+  int len = SIXP_HDR_LEN;
+  int with_cells = 0;
+
+  if(buf_size < SIXP_HDR_LEN + 6 + 4 * SIXTOP_MAX_CELLS
+     || m->cell_count > SIXTOP_MAX_CELLS) {
+    return -1;
+  }
+
+  buf[0] = SIXTOP_SUBIE_ID;
+  buf[1] = SIXP_VERSION | (m->type << 4);
+  buf[2] = m->code;
+  buf[3] = m->sfid;
+  buf[4] = m->seqnum;
+
+  if(m->type == SIXP_TYPE_REQUEST) {
+    WRITE16(buf + len, m->metadata);
+    len += 2;
+    switch(m->code) {
+      case SIXP_CMD_ADD:
+      case SIXP_CMD_DELETE:
+        buf[len++] = m->cell_options;
+        buf[len++] = m->num_cells;
+        with_cells = 1;
+        break;
+      case SIXP_CMD_COUNT:
+        buf[len++] = m->cell_options;
+        break;
+      case SIXP_CMD_LIST:
+        buf[len++] = m->cell_options;
+        buf[len++] = 0; /* Reserved */
+        WRITE16(buf + len, m->offset);
+        WRITE16(buf + len + 2, m->max_num_cells);
+        len += 4;
+        break;
+      case SIXP_CMD_CLEAR:
+        break;
+      default:
+        /* RELOCATE and SIGNAL are not supported */
+        return -1;
+    }
+  } else if(m->code == SIXP_RC_SUCCESS || m->code == SIXP_RC_EOL) {
+    switch(cmd) {
+      case SIXP_CMD_ADD:
+      case SIXP_CMD_DELETE:
+      case SIXP_CMD_LIST:
+        with_cells = 1;
+        break;
+      case SIXP_CMD_COUNT:
+        WRITE16(buf + len, m->total_num_cells);
+        len += 2;
+        break;
+    }
+  }
+
+  if(with_cells) {
+    for(i = 0; i < m->cell_count; i++) {
+      WRITE16(buf + len, m->cells[i].timeslot);
+      WRITE16(buf + len + 2, m->cells[i].channel_offset);
+      len += 4;
+    }
+  }
+
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse_cells(const uint8_t *buf, int len, struct sixp_msg *m)
+{
+  int i;
+  if(len % 4 != 0 || len / 4 > SIXTOP_MAX_CELLS) {
+    return -1;
+  }
+  m->cell_count = len / 4;
+  for(i = 0; i < m->cell_count; i++) {
+    m->cells[i].timeslot = READ16(buf + 4 * i);
+    m->cells[i].channel_offset = READ16(buf + 4 * i + 2);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Read a 6P message, with the sub-ID. cmd is the command a response
+ * answers. Returns 0, -1 if malformed, -2 if of another 6P version (only
+ * the header is read then) */
+static int
+parse_msg(const uint8_t *buf, int len, uint8_t cmd, struct sixp_msg *m)
+{
+  const uint8_t *body = buf + SIXP_HDR_LEN;
+  int body_len = len - SIXP_HDR_LEN;
+
+  memset(m, 0, sizeof(struct sixp_msg));
+  if(len < SIXP_HDR_LEN || buf[0] != SIXTOP_SUBIE_ID) {
+    return -1;
+  }
+  m->type = (buf[1] >> 4) & 0x03;
+  m->code = buf[2];
+  m->sfid = buf[3];
+  m->seqnum = buf[4];
+  if((buf[1] & 0x0f) != SIXP_VERSION) {
+    return -2;
+  }
+
+  if(m->type == SIXP_TYPE_REQUEST) {
+    if(body_len < 2) {
+      return -1;
+    }
+    m->metadata = READ16(body);
+    body += 2;
+    body_len -= 2;
+    switch(m->code) {
+      case SIXP_CMD_ADD:
+      case SIXP_CMD_DELETE:
+        if(body_len < 2) {
+          return -1;
+        }
+        m->cell_options = body[0];
+        m->num_cells = body[1];
+        return parse_cells(body + 2, body_len - 2, m);
+      case SIXP_CMD_COUNT:
+        if(body_len < 1) {
+          return -1;
+        }
+        m->cell_options = body[0];
+        return 0;
+      case SIXP_CMD_LIST:
+        if(body_len < 6) {
+          return -1;
+        }
+        m->cell_options = body[0];
+        m->offset = READ16(body + 2);
+        m->max_num_cells = READ16(body + 4);
+        return 0;
+      default:
+        /* CLEAR has no body. Others are not supported, the scheduling
+         * function answers them with an error */
+        return 0;
+    }
+  } else if(m->type == SIXP_TYPE_RESPONSE
+            && (m->code == SIXP_RC_SUCCESS || m->code == SIXP_RC_EOL)) {
+    switch(cmd) {
+      case SIXP_CMD_ADD:
+      case SIXP_CMD_DELETE:
+      case SIXP_CMD_LIST:
+        return parse_cells(body, body_len, m);
+      case SIXP_CMD_COUNT:
+        if(body_len < 2) {
+          return -1;
+        }
+        m->total_num_cells = READ16(body);
+        return 0;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* The requester's view of a transaction ends: update the sequence number */
+static void
+end_request(struct sixp_nbr *n, int success)
+{
+  ctimer_stop(&n->timer);
+  n->state = SIXP_STATE_IDLE;
+  if(n->req.code == SIXP_CMD_CLEAR) {
+    /* CLEAR resets the sequence number, answered or not */
+    n->seqnum = 0;
+  } else if(success) {
+    n->seqnum = next_seqnum(n->req.seqnum);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_timeout(void *ptr)
+{
+  struct sixp_nbr *n = ptr;
+  if(n->state == SIXP_STATE_REQ_SENDING || n->state == SIXP_STATE_REQ_SENT) {
+    PRINTF("6top: request %u seqnum %u timed out\n", n->req.code, n->req.seqnum);
+    end_request(n, 0);
+    if(current_sf->timeout != NULL) {
+      current_sf->timeout(&n->addr, &n->req);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_sent(void *ptr, int status, int transmissions)
+{
+  struct sixp_nbr *n = ptr;
+  n->tx_pending--;
+  if(n->state != SIXP_STATE_REQ_SENDING) {
+    /* Already answered or timed out */
+    return;
+  }
+  if(status == MAC_TX_OK) {
+    n->state = SIXP_STATE_REQ_SENT;
+  } else {
+    PRINTF("6top:! request %u not sent, status %u\n", n->req.code, status);
+    end_request(n, 0);
+    if(current_sf->timeout != NULL) {
+      current_sf->timeout(&n->addr, &n->req);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_sent(void *ptr, int status, int transmissions)
+{
+  struct sixp_nbr *n = ptr;
+  n->tx_pending--;
+  if(n->state != SIXP_STATE_RES_SENDING) {
+    return;
+  }
+  n->state = SIXP_STATE_IDLE;
+  if(n->req.code == SIXP_CMD_CLEAR && n->res.code == SIXP_RC_SUCCESS) {
+    /* CLEAR resets the sequence number, whether the response went through
+     * or not */
+    n->seqnum = 0;
+  } else if(status == MAC_TX_OK && n->res.code == SIXP_RC_SUCCESS) {
+    n->seqnum = next_seqnum(n->req.seqnum);
+  }
+  PRINTF("6top: response %u to %u sent, status %u, next seqnum %u\n",
+         n->res.code, n->req.code, status, n->seqnum);
+  if(current_sf->response_sent != NULL) {
+    current_sf->response_sent(&n->addr, &n->req, &n->res, status);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_input(const linkaddr_t *src, const uint8_t *content, uint16_t content_len)
+{
+  static struct sixp_msg req;
+  static struct sixp_msg res;
+  struct sixp_nbr *n;
+  int ret;
+  int len;
+
+  if((ret = parse_msg(content, content_len, 0, &req)) == -1) {
+    PRINTF("6top:! malformed request\n");
+    return;
+  }
+  if((n = get_nbr(src, 1)) == NULL) {
+    return;
+  }
+  if(n->state == SIXP_STATE_RES_SENDING
+     && req.seqnum == n->req.seqnum && req.code == n->req.code) {
+    /* Retransmission of the request we are answering, our ACK was lost */
+    return;
+  }
+
+  memset(&res, 0, sizeof(res));
+  res.type = SIXP_TYPE_RESPONSE;
+  res.sfid = req.sfid;
+  res.seqnum = req.seqnum;
+  if(ret == -2) {
+    res.code = SIXP_RC_ERR_VERSION;
+  } else if(req.sfid != current_sf->sfid) {
+    res.code = SIXP_RC_ERR_SFID;
+  } else if(n->state != SIXP_STATE_IDLE) {
+    res.code = SIXP_RC_ERR_BUSY;
+  } else if(req.code != SIXP_CMD_CLEAR && req.seqnum != n->seqnum) {
+    res.code = SIXP_RC_ERR_SEQNUM;
+  } else if(current_sf->request_input == NULL) {
+    res.code = SIXP_RC_ERR;
+  } else {
+    res.code = current_sf->request_input(src, &req, &res);
+  }
+  PRINTF("6top: request %u seqnum %u from %u, rc %u\n",
+         req.code, req.seqnum, TSCH_LOG_ID_FROM_LINKADDR(src), res.code);
+
+  if((len = build_msg(&res, req.code, msg_buf, sizeof(msg_buf))) < 0) {
+    return;
+  }
+
+  if(n->state != SIXP_STATE_IDLE) {
+    /* Busy with another transaction, which we must not overwrite */
+    tsch_send_ietf(src, msg_buf, len, NULL, NULL);
+    return;
+  }
+
+  n->req = req;
+  n->res = res;
+  n->state = SIXP_STATE_RES_SENDING;
+  n->tx_pending++;
+  if(!tsch_send_ietf(src, msg_buf, len, response_sent, n)) {
+    response_sent(n, MAC_TX_ERR, 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_input(const linkaddr_t *src, const uint8_t *content, uint16_t content_len)
+{
+  struct sixp_nbr *n = get_nbr(src, 0);
+
+  /* The response may come before the sent callback of our request */
+  if(n == NULL || (n->state != SIXP_STATE_REQ_SENDING
+                   && n->state != SIXP_STATE_REQ_SENT)) {
+    return;
+  }
+  if(parse_msg(content, content_len, n->req.code, &n->res) != 0
+     || n->res.seqnum != n->req.seqnum || n->res.sfid != n->req.sfid) {
+    PRINTF("6top:! unexpected response from %u\n", TSCH_LOG_ID_FROM_LINKADDR(src));
+    return;
+  }
+
+  end_request(n, n->res.code == SIXP_RC_SUCCESS);
+  PRINTF("6top: response %u to %u from %u, next seqnum %u\n",
+         n->res.code, n->req.code, TSCH_LOG_ID_FROM_LINKADDR(src), n->seqnum);
+  if(current_sf->response_input != NULL) {
+    current_sf->response_input(src, &n->req, &n->res);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sixtop_callback_ietf_ie_input(const linkaddr_t *src, const uint8_t *content, uint16_t content_len)
+{
+  if(current_sf == NULL || content_len < SIXP_HDR_LEN
+     || content[0] != SIXTOP_SUBIE_ID) {
+    return;
+  }
+  switch((content[1] >> 4) & 0x03) {
+    case SIXP_TYPE_REQUEST:
+      request_input(src, content, content_len);
+      break;
+    case SIXP_TYPE_RESPONSE:
+      response_input(src, content, content_len);
+      break;
+    default:
+      /* We run 2-step transactions only */
+      break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+sixtop_request(const linkaddr_t *peer, struct sixp_msg *req)
+{
+  struct sixp_nbr *n;
+  int len;
+
+  if(current_sf == NULL || (n = get_nbr(peer, 1)) == NULL
+     || n->state != SIXP_STATE_IDLE) {
+    return 0;
+  }
+
+  req->type = SIXP_TYPE_REQUEST;
+  req->sfid = current_sf->sfid;
+  req->seqnum = n->seqnum;
+  if((len = build_msg(req, req->code, msg_buf, sizeof(msg_buf))) < 0
+     || !tsch_send_ietf(peer, msg_buf, len, request_sent, n)) {
+    return 0;
+  }
+  PRINTF("6top: request %u seqnum %u to %u\n",
+         req->code, req->seqnum, TSCH_LOG_ID_FROM_LINKADDR(peer));
+
+  n->req = *req;
+  n->state = SIXP_STATE_REQ_SENDING;
+  n->tx_pending++;
+  ctimer_set(&n->timer, SIXTOP_TIMEOUT, request_timeout, n);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+sixtop_is_busy(const linkaddr_t *peer)
+{
+  struct sixp_nbr *n = get_nbr(peer, 0);
+  return n != NULL && n->state != SIXP_STATE_IDLE;
+}
+/*---------------------------------------------------------------------------*/
+void
+sixtop_init(const struct sixtop_sf *sf)
+{
+  memb_init(&nbr_memb);
+  list_init(nbr_list);
+  current_sf = sf;
+  if(current_sf != NULL && current_sf->init != NULL) {
+    current_sf->init();
+  }
+  PRINTF("6top: initialization done, SFID %u\n", sf != NULL ? sf->sfid : 0);
+}
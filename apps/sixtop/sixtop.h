@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         6top Protocol (6P, RFC 8480): negotiation of TSCH cells between
+ *         neighbors, on behalf of a scheduling function (SF).
+ */
+
+#ifndef __SIXTOP_H__
+#define __SIXTOP_H__
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/tsch-queue.h"
+#include "net/mac/tsch/tsch-schedule.h"
+#include "sixtop-conf.h"
+
+/* 6P messages are carried in a payload IETF IE, with this sub-ID */
+#define SIXTOP_SUBIE_ID             0xc9
+#define SIXP_VERSION                0
+
+/* Message types */
+#define SIXP_TYPE_REQUEST           0
+#define SIXP_TYPE_RESPONSE          1
+#define SIXP_TYPE_CONFIRMATION      2
+
+/* Command identifiers (the code of requests) */
+#define SIXP_CMD_ADD                1
+#define SIXP_CMD_DELETE             2
+#define SIXP_CMD_RELOCATE           3
+#define SIXP_CMD_COUNT              4
+#define SIXP_CMD_LIST               5
+#define SIXP_CMD_SIGNAL             6
+#define SIXP_CMD_CLEAR              7
+
+/* Return codes (the code of responses) */
+#define SIXP_RC_SUCCESS             0
+#define SIXP_RC_EOL                 1
+#define SIXP_RC_ERR                 2
+#define SIXP_RC_RESET               3
+#define SIXP_RC_ERR_VERSION         4
+#define SIXP_RC_ERR_SFID            5
+#define SIXP_RC_ERR_SEQNUM          6
+#define SIXP_RC_ERR_CELLLIST        7
+#define SIXP_RC_ERR_BUSY            8
+#define SIXP_RC_ERR_LOCKED          9
+
+/* Cell options, from the point of view of the sender of the request */
+#define SIXP_CELL_OPTION_TX         0x01
+#define SIXP_CELL_OPTION_RX         0x02
+#define SIXP_CELL_OPTION_SHARED     0x04
+
+struct sixp_cell {
+  uint16_t timeslot;
+  uint16_t channel_offset;
+};
+
+/* A 6P message. Which fields are meaningful depends on type and code */
+struct sixp_msg {
+  uint8_t type;
+  uint8_t code; /* Command of a request, return code of a response */
+  uint8_t sfid;
+  uint8_t seqnum;
+  uint16_t metadata;
+  uint8_t cell_options;
+  uint8_t num_cells;
+  uint16_t offset; /* LIST request */
+  uint16_t max_num_cells; /* LIST request */
+  uint16_t total_num_cells; /* COUNT response */
+  uint8_t cell_count;
+  struct sixp_cell cells[SIXTOP_MAX_CELLS];
+};
+
+/* The structure of a scheduling function */
+struct sixtop_sf {
+  uint8_t sfid;
+  void (* init)(void);
+  /* Responder: a request was received. Fill the cells of the response and
+   * return a return code. Nothing must be committed before response_sent */
+  uint8_t (* request_input)(const linkaddr_t *peer, const struct sixp_msg *req,
+                            struct sixp_msg *res);
+  /* Responder: our response was sent, status is a MAC_TX_* code. Commit
+   * the transaction if status is MAC_TX_OK and the response a success */
+  void (* response_sent)(const linkaddr_t *peer, const struct sixp_msg *req,
+                         const struct sixp_msg *res, int status);
+  /* Requester: the response to our request was received */
+  void (* response_input)(const linkaddr_t *peer, const struct sixp_msg *req,
+                          const struct sixp_msg *res);
+  /* Requester: our request failed or was not answered in time */
+  void (* timeout)(const linkaddr_t *peer, const struct sixp_msg *req);
+};
+
+/* The MSF-like traffic-adaptive scheduling function */
+extern const struct sixtop_sf sixtop_msf;
+
+/* Call from application to start 6top with a given scheduling function */
+void sixtop_init(const struct sixtop_sf *sf);
+/* Send a request to a neighbor. The type, sfid and seqnum fields of req
+ * are set by 6P. Returns 1 if sent, 0 if a transaction with the
+ * neighbor is ongoing or the request could not be sent */
+int sixtop_request(const linkaddr_t *peer, struct sixp_msg *req);
+/* Is a transaction with a neighbor ongoing? */
+int sixtop_is_busy(const linkaddr_t *peer);
+
+/* Callbacks required for 6top to operate */
+/* Set with #define TSCH_CALLBACK_IETF_IE_INPUT sixtop_callback_ietf_ie_input */
+void sixtop_callback_ietf_ie_input(const linkaddr_t *src, const uint8_t *content, uint16_t content_len);
+
+/* Callbacks required for MSF to operate */
+/* Set with #define TSCH_CALLBACK_NEW_TIME_SOURCE sixtop_msf_callback_new_time_source */
+void sixtop_msf_callback_new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new);
+/* Set with #define TSCH_CALLBACK_CELL_ELAPSED sixtop_msf_callback_cell_elapsed */
+void sixtop_msf_callback_cell_elapsed(struct tsch_link *link, int used);
+
+/* MSF statistics */
+struct sixtop_msf_stats {
+  uint16_t num_tx_cells; /* Tx cells to the parent */
+  uint16_t num_rx_cells; /* Rx cells from children */
+  uint8_t last_usage; /* Last estimated Tx cell usage, percent */
+  uint16_t adds; /* Cells added by our requests */
+  uint16_t deletes; /* Cells deleted by our requests */
+  uint16_t clears; /* CLEAR requests sent */
+  uint16_t failures; /* Failed or timed out requests */
+};
+const struct sixtop_msf_stats *sixtop_msf_get_stats(void);
+
+#endif /* __SIXTOP_H__ */
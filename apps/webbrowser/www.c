@@ -86,9 +86,23 @@ static char editurl[WWW_CONF_MAX_URLLEN + 1];
 static struct ctk_textentry urlentry =
   {CTK_TEXTENTRY(0, 1, WWW_CONF_WEBPAGE_WIDTH - 2,
 		 1, editurl, WWW_CONF_MAX_URLLEN)};
+#if WWW_CONF_LINE_REDRAW
+/* One label per web page line, so that a line can be redrawn on its
+   own. */
+static struct ctk_label webpagelines[WWW_CONF_WEBPAGE_HEIGHT];
+
+/* The lines written to since the last redraw, and whether any page
+   widgets were added. CTK queues at most four widget redraws and the
+   status text takes one of them, so more dirty lines than
+   MAX_LINEREDRAWS or new widgets call for a full window redraw. */
+#define MAX_LINEREDRAWS 3
+static unsigned char dirtyfirst, dirtylast;
+static unsigned char dirtywidgets;
+#else /* WWW_CONF_LINE_REDRAW */
 static struct ctk_label webpagelabel =
   {CTK_LABEL(0, 3, WWW_CONF_WEBPAGE_WIDTH,
 	     WWW_CONF_WEBPAGE_HEIGHT, webpage)};
+#endif /* WWW_CONF_LINE_REDRAW */
 
 static char statustexturl[WWW_CONF_WEBPAGE_WIDTH];
 static struct ctk_label statustext =
@@ -203,6 +217,10 @@ static void formsubmit(struct inputattrib *trigger);
 static void
 make_window(void)
 {
+#if WWW_CONF_LINE_REDRAW
+  unsigned char i;
+#endif /* WWW_CONF_LINE_REDRAW */
+
 #if WWW_CONF_HISTORY_SIZE > 0
   CTK_WIDGET_ADD(&mainwindow, &backbutton);
 #endif /* WWW_CONF_HISTORY_SIZE > 0 */
@@ -211,8 +229,17 @@ make_window(void)
   CTK_WIDGET_ADD(&mainwindow, &gobutton);
   CTK_WIDGET_ADD(&mainwindow, &urlentry);
   CTK_WIDGET_ADD(&mainwindow, &sep1);
+#if WWW_CONF_LINE_REDRAW
+  for(i = 0; i < WWW_CONF_WEBPAGE_HEIGHT; ++i) {
+    CTK_LABEL_NEW(&webpagelines[i], 0, 3 + i, WWW_CONF_WEBPAGE_WIDTH, 1,
+		  webpage + i * WWW_CONF_WEBPAGE_WIDTH);
+    CTK_WIDGET_ADD(&mainwindow, &webpagelines[i]);
+    CTK_WIDGET_SET_FLAG(&webpagelines[i], CTK_WIDGET_FLAG_MONOSPACE);
+  }
+#else /* WWW_CONF_LINE_REDRAW */
   CTK_WIDGET_ADD(&mainwindow, &webpagelabel);
   CTK_WIDGET_SET_FLAG(&webpagelabel, CTK_WIDGET_FLAG_MONOSPACE);
+#endif /* WWW_CONF_LINE_REDRAW */
   CTK_WIDGET_ADD(&mainwindow, &sep2);
   CTK_WIDGET_ADD(&mainwindow, &statustext);
 
@@ -226,9 +253,55 @@ make_window(void)
 static void
 redraw_window(void)
 {
+#if WWW_CONF_LINE_REDRAW
+  dirtyfirst = WWW_CONF_WEBPAGE_HEIGHT;
+  dirtylast = 0;
+  dirtywidgets = 0;
+#endif /* WWW_CONF_LINE_REDRAW */
   ctk_window_redraw(&mainwindow);
 }
 /*-----------------------------------------------------------------------------------*/
+/* redraw_page():
+ *
+ * Called while the page is loading to show what has been added to
+ * it. Redraws only the changed lines if possible. */
+static void
+redraw_page(void)
+{
+#if WWW_CONF_LINE_REDRAW
+  unsigned char i;
+
+  if(dirtywidgets || (dirtyfirst <= dirtylast &&
+		      dirtylast - dirtyfirst >= MAX_LINEREDRAWS)) {
+    redraw_window();
+    return;
+  }
+  for(i = dirtyfirst; i <= dirtylast; ++i) {
+    CTK_WIDGET_REDRAW(&webpagelines[i]);
+  }
+  dirtyfirst = WWW_CONF_WEBPAGE_HEIGHT;
+  dirtylast = 0;
+#else /* WWW_CONF_LINE_REDRAW */
+  redraw_window();
+#endif /* WWW_CONF_LINE_REDRAW */
+}
+/*-----------------------------------------------------------------------------------*/
+/* touch_line():
+ *
+ * Marks the current line as changed. */
+static void
+touch_line(void)
+{
+#if WWW_CONF_LINE_REDRAW
+  if(y < dirtyfirst) {
+    dirtyfirst = y;
+  }
+  if(y > dirtylast) {
+    dirtylast = y;
+  }
+#endif /* WWW_CONF_LINE_REDRAW */
+}
+/*-----------------------------------------------------------------------------------*/
 static char *
 add_pageattrib(unsigned size)
 {
@@ -700,7 +773,7 @@ webclient_datahandler(char *data, uint16_t len)
       count = (count + 1) & 3;
       show_statustext(receivingmsgs[count]);
       htmlparser_parse(data, len);
-      redraw_window();
+      redraw_page();
     } else {
       uip_abort();
 #if WWW_CONF_WITH_WGET || defined(WWW_CONF_WGET_EXEC)
@@ -769,6 +842,10 @@ add_pagewidget(char *text, unsigned char size, char *attrib, unsigned char type,
   if(firsty == pagey) {
     unsigned char attriblen = strlen(attrib);
 
+    touch_line();
+#if WWW_CONF_LINE_REDRAW
+    dirtywidgets |= size;
+#endif /* WWW_CONF_LINE_REDRAW */
     wptr = webpageptr;
     /* To save memory, we'll copy the widget text to the web page
        drawing area and reference it from there. */
@@ -890,6 +967,7 @@ htmlparser_word(char *word, unsigned char wordlen)
 
     if(loading) {
       if(pagey == firsty) {
+	touch_line();
 	memcpy(webpageptr, word, wordlen);
 	webpageptr += wordlen;
 	*webpageptr = ' ';
@@ -61,6 +61,12 @@
 #ifndef WWW_CONF_MAX_INPUTVALUELEN
 #define WWW_CONF_MAX_INPUTVALUELEN 100
 #endif
+/* Draw the web page as one label per line and, while a page is
+   loading, redraw only the lines that changed instead of the whole
+   window. Costs one label widget per line. */
+#ifndef WWW_CONF_LINE_REDRAW
+#define WWW_CONF_LINE_REDRAW 0
+#endif
 
 PROCESS_NAME(www_process);
 
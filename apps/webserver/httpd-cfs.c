@@ -47,6 +47,9 @@ int snprintf(char *str, size_t size, const char *format, ...);
 #include "urlconv.h"
 
 #include "httpd-cfs.h"
+#if HTTPD_MAP
+#include "cfs/cfs-coffee.h"
+#endif /* HTTPD_MAP */
 
 #ifndef WEBSERVER_CONF_CFS_CONNS
 #define CONNS UIP_CONNS
@@ -76,7 +79,16 @@ static
 PT_THREAD(send_file(struct httpd_state *s))
 {
   PSOCK_BEGIN(&s->sout);
-  
+
+#if HTTPD_MAP
+  /* Send the file directly from the flash if it is mapped */
+  s->map = cfs_coffee_map(s->fd, &s->maplen);
+  if(s->map != NULL) {
+    PSOCK_SEND(&s->sout, (uint8_t *)s->map, s->maplen);
+    PSOCK_EXIT(&s->sout);
+  }
+#endif /* HTTPD_MAP */
+
   do {
     /* Read data from file system into buffer */
     s->len = cfs_read(s->fd, s->outputbuf, sizeof(s->outputbuf));
@@ -35,6 +35,7 @@
 #define HTTPD_CFS_H_
 
 #include "contiki-net.h"
+#include "cfs/cfs.h"
 
 #ifndef WEBSERVER_CONF_CFS_PATHLEN
 #define HTTPD_PATHLEN 80
@@ -42,6 +43,14 @@
 #define HTTPD_PATHLEN WEBSERVER_CONF_CFS_PATHLEN
 #endif /* WEBSERVER_CONF_CFS_CONNS */
 
+/* Send files that Coffee can map from where they are stored, without
+   copying them through the output buffer. */
+#ifndef WEBSERVER_CONF_CFS_MAP
+#define HTTPD_MAP 0
+#else /* WEBSERVER_CONF_CFS_MAP */
+#define HTTPD_MAP WEBSERVER_CONF_CFS_MAP
+#endif /* WEBSERVER_CONF_CFS_MAP */
+
 struct httpd_state {
   struct timer timer;
   struct psock sin, sout;
@@ -52,6 +61,10 @@ struct httpd_state {
   char state;
   int fd;
   int len;
+#if HTTPD_MAP
+  const void *map;
+  cfs_offset_t maplen;
+#endif /* HTTPD_MAP */
 };
 
 
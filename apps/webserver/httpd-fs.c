@@ -32,6 +32,8 @@
  *
  */
 
+#include <string.h>
+
 #include "contiki-net.h"
 #include "httpd.h"
 #include "httpd-fs.h"
@@ -93,6 +95,36 @@ httpd_fs_open(const char *name, struct httpd_fs_file *file)
   return 0;
 }
 /*-----------------------------------------------------------------------------------*/
+int
+httpd_fs_open_gz(const char *name, struct httpd_fs_file *file)
+{
+#if HTTPD_FS_STATISTICS
+  uint16_t i = 0;
+#endif /* HTTPD_FS_STATISTICS */
+  struct httpd_fsdata_file_noconst *f;
+  size_t namelen;
+
+  namelen = strlen(name);
+  for(f = (struct httpd_fsdata_file_noconst *)HTTPD_FS_ROOT;
+      f != NULL;
+      f = (struct httpd_fsdata_file_noconst *)f->next) {
+
+    if(strncmp(name, f->name, namelen) == 0 &&
+       strcmp(f->name + namelen, ".gz") == 0) {
+      file->data = f->data;
+      file->len = f->len;
+#if HTTPD_FS_STATISTICS
+      ++count[i];
+#endif /* HTTPD_FS_STATISTICS */
+      return 1;
+    }
+#if HTTPD_FS_STATISTICS
+    ++i;
+#endif /* HTTPD_FS_STATISTICS */
+  }
+  return 0;
+}
+/*-----------------------------------------------------------------------------------*/
 void
 httpd_fs_init(void)
 {
@@ -47,6 +47,9 @@ struct httpd_fs_file {
    by the function. */
 int httpd_fs_open(const char *name, struct httpd_fs_file *file);
 
+/* Opens the gzip-compressed variant of a file, stored as name.gz. */
+int httpd_fs_open_gz(const char *name, struct httpd_fs_file *file);
+
 #ifdef HTTPD_FS_STATISTICS
 #if HTTPD_FS_STATISTICS == 1  
 uint16_t httpd_fs_count(char *name);
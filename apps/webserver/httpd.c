@@ -33,6 +33,7 @@
  */
  
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "contiki-net.h"
@@ -41,6 +42,7 @@
 #include "httpd-fs.h"
 #include "httpd-cgi.h"
 #include "lib/petsciiconv.h"
+#include "lib/crc16.h"
 #include "http-strings.h"
 
 #include "httpd.h"
@@ -57,13 +59,21 @@
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, (unsigned int)strlen(str))
 MEMB(conns, struct httpd_state, CONNS);
 
+#if WEBSERVER_SENDFILE
+#define SEND_FILE(s) sendfile(s)
+#else /* WEBSERVER_SENDFILE */
+#define SEND_FILE(s) send_file(s)
+#endif /* WEBSERVER_SENDFILE */
+
 #define ISO_nl      0x0a
+#define ISO_cr      0x0d
 #define ISO_space   0x20
 #define ISO_bang    0x21
 #define ISO_percent 0x25
 #define ISO_period  0x2e
 #define ISO_slash   0x2f
 #define ISO_colon   0x3a
+#define ISO_quote   0x22
 
 /*---------------------------------------------------------------------------*/
 static unsigned short
@@ -95,6 +105,51 @@ PT_THREAD(send_file(struct httpd_state *s))
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+#if WEBSERVER_SENDFILE
+/* Sends the file straight from the file system, without going through
+   the protosocket, so that more segments than one can be in flight.
+   s->sent is what has been sent but not acknowledged yet; as in
+   tcp-socket, uIP forgets about it when it asks for a retransmission. */
+static
+PT_THREAD(sendfile(struct httpd_state *s))
+{
+  uint16_t len;
+
+  PT_BEGIN(&s->sendfilept);
+
+  s->sent = 0;
+  while(1) {
+    if(uip_acked()) {
+      len = s->sent - uip_outstanding(uip_conn);
+      s->file.data += len;
+      s->file.len -= len;
+      s->sent -= len;
+    }
+    if(s->file.len == 0) {
+      break;
+    }
+    if(uip_rexmit()) {
+      s->sent = 0;
+    }
+    len = MIN(s->file.len - s->sent, uip_mss());
+    if(len > 0) {
+      uip_send(s->file.data + s->sent, len);
+      s->sent += len;
+#if UIP_TCP_SEGMENTS > 1
+      if(s->sent < s->file.len) {
+        /* Ask for another call to send the next segment, if the
+           window has room for it. */
+        tcpip_poll_tcp(uip_conn);
+      }
+#endif /* UIP_TCP_SEGMENTS > 1 */
+    }
+    PT_YIELD(&s->sendfilept);
+  }
+
+  PT_END(&s->sendfilept);
+}
+#endif /* WEBSERVER_SENDFILE */
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(send_part_of_file(struct httpd_state *s))
 {
@@ -193,6 +248,17 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
 
   SEND_STRING(&s->sout, statushdr);
 
+#if WEBSERVER_GZIP
+  if(s->gzip) {
+    SEND_STRING(&s->sout, http_content_encoding_gzip);
+  }
+#endif /* WEBSERVER_GZIP */
+#if WEBSERVER_ETAG
+  if(s->etag[0] != 0) {
+    SEND_STRING(&s->sout, s->etag);
+  }
+#endif /* WEBSERVER_ETAG */
+
   ptr = strrchr(s->filename, ISO_period);
   if(ptr == NULL) {
     ptr = http_content_type_binary;
@@ -214,32 +280,86 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+static int
+is_script(struct httpd_state *s)
+{
+  char *ptr;
+
+  ptr = strrchr(s->filename, ISO_period);
+  return ptr != NULL && strncmp(ptr, http_shtml, 6) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+open_file(struct httpd_state *s)
+{
+#if WEBSERVER_ETAG
+  s->etag[0] = 0;
+#endif /* WEBSERVER_ETAG */
+#if WEBSERVER_GZIP
+  s->gzip = 0;
+  if(s->accept_gzip && httpd_fs_open_gz(s->filename, &s->file)) {
+    s->gzip = 1;
+    return 1;
+  }
+  if(httpd_fs_open(s->filename, &s->file)) {
+    return 1;
+  }
+  /* A file stored compressed only is sent compressed to all clients. */
+  s->gzip = httpd_fs_open_gz(s->filename, &s->file);
+  return s->gzip;
+#else /* WEBSERVER_GZIP */
+  return httpd_fs_open(s->filename, &s->file);
+#endif /* WEBSERVER_GZIP */
+}
+/*---------------------------------------------------------------------------*/
+#if WEBSERVER_ETAG
+/* The entity tag of a static file is made of its length and CRC, so it
+   changes with the file system image. Returns non-zero if it is the
+   one the client has. */
+static int
+not_modified(struct httpd_state *s)
+{
+  uint32_t etag;
+
+  if(is_script(s)) {
+    return 0;
+  }
+  etag = ((uint32_t)(s->file.len & 0xffff) << 16) |
+    crc16_data((const unsigned char *)s->file.data, s->file.len, 0);
+  sprintf(s->etag, "ETag: \"%08lx\"\r\n", (unsigned long)etag);
+  return s->if_none_match_valid && s->if_none_match == etag;
+}
+#endif /* WEBSERVER_ETAG */
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_output(struct httpd_state *s))
 {
-  char *ptr;
-  
   PT_BEGIN(&s->outputpt);
  
-  if(!httpd_fs_open(s->filename, &s->file)) {
+  if(!open_file(s)) {
     strcpy(s->filename, http_404_html);
     httpd_fs_open(s->filename, &s->file);
     PT_WAIT_THREAD(&s->outputpt,
 		   send_headers(s,
 		   http_header_404));
     PT_WAIT_THREAD(&s->outputpt,
-		   send_file(s));
+		   SEND_FILE(s));
+#if WEBSERVER_ETAG
+  } else if(not_modified(s)) {
+    PT_WAIT_THREAD(&s->outputpt,
+		   send_headers(s,
+		   http_header_304));
+#endif /* WEBSERVER_ETAG */
   } else {
     PT_WAIT_THREAD(&s->outputpt,
 		   send_headers(s,
 		   http_header_200));
-    ptr = strrchr(s->filename, ISO_period);
-    if(ptr != NULL && strncmp(ptr, http_shtml, 6) == 0) {
+    if(is_script(s)) {
       PT_INIT(&s->scriptpt);
       PT_WAIT_THREAD(&s->outputpt, handle_script(s));
     } else {
       PT_WAIT_THREAD(&s->outputpt,
-		     send_file(s));
+		     SEND_FILE(s));
     }
   }
   PSOCK_CLOSE(&s->sout);
@@ -249,6 +369,10 @@ PT_THREAD(handle_output(struct httpd_state *s))
 static
 PT_THREAD(handle_input(struct httpd_state *s))
 {
+#if WEBSERVER_ETAG
+  char *ptr, *end;
+#endif /* WEBSERVER_ETAG */
+
   PSOCK_BEGIN(&s->sin);
 
   PSOCK_READTO(&s->sin, ISO_space);
@@ -272,11 +396,36 @@ PT_THREAD(handle_input(struct httpd_state *s))
   petsciiconv_topetscii(s->filename, sizeof(s->filename));
   webserver_log_file(&uip_conn->ripaddr, s->filename);
   petsciiconv_toascii(s->filename, sizeof(s->filename));
+#if WEBSERVER_GZIP || WEBSERVER_ETAG
+  /* The response depends on the request headers, so it is sent after
+     the empty line that ends them. */
+#else /* WEBSERVER_GZIP || WEBSERVER_ETAG */
   s->state = STATE_OUTPUT;
+#endif /* WEBSERVER_GZIP || WEBSERVER_ETAG */
 
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
 
+#if WEBSERVER_GZIP || WEBSERVER_ETAG
+    if(s->inputbuf[0] == ISO_cr || s->inputbuf[0] == ISO_nl) {
+      s->state = STATE_OUTPUT;
+    }
+    s->inputbuf[PSOCK_DATALEN(&s->sin)] = 0;
+#endif /* WEBSERVER_GZIP || WEBSERVER_ETAG */
+#if WEBSERVER_GZIP
+    if(strncmp(s->inputbuf, http_accept_encoding, 16) == 0 &&
+       strstr(s->inputbuf + 16, http_gzip) != NULL) {
+      s->accept_gzip = 1;
+    }
+#endif /* WEBSERVER_GZIP */
+#if WEBSERVER_ETAG
+    if(strncmp(s->inputbuf, http_if_none_match, 14) == 0 &&
+       (ptr = strchr(s->inputbuf + 14, ISO_quote)) != NULL) {
+      s->if_none_match = strtoul(ptr + 1, &end, 16);
+      s->if_none_match_valid = (end == ptr + 9 && *end == ISO_quote);
+    }
+#endif /* WEBSERVER_ETAG */
+
     if(strncmp(s->inputbuf, http_referer, 8) == 0) {
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
       petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
@@ -315,6 +464,15 @@ httpd_appcall(void *state)
     PSOCK_INIT(&s->sin, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PSOCK_INIT(&s->sout, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PT_INIT(&s->outputpt);
+#if WEBSERVER_SENDFILE
+    PT_INIT(&s->sendfilept);
+#endif /* WEBSERVER_SENDFILE */
+#if WEBSERVER_GZIP
+    s->accept_gzip = 0;
+#endif /* WEBSERVER_GZIP */
+#if WEBSERVER_ETAG
+    s->if_none_match_valid = 0;
+#endif /* WEBSERVER_ETAG */
     s->state = STATE_WAITING;
     /*    timer_set(&s->timer, CLOCK_SECOND * 100);*/
     s->timer = 0;
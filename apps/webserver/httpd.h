@@ -38,6 +38,31 @@
 #include "contiki-net.h"
 #include "httpd-fs.h"
 
+/* Serve the gzip-compressed variant of a file (stored as name.gz by
+   makefsdata -z) to clients that accept it */
+#ifdef WEBSERVER_CONF_GZIP
+#define WEBSERVER_GZIP WEBSERVER_CONF_GZIP
+#else /* WEBSERVER_CONF_GZIP */
+#define WEBSERVER_GZIP 0
+#endif /* WEBSERVER_CONF_GZIP */
+
+/* Send an ETag with static files and answer If-None-Match with
+   304 Not Modified */
+#ifdef WEBSERVER_CONF_ETAG
+#define WEBSERVER_ETAG WEBSERVER_CONF_ETAG
+#else /* WEBSERVER_CONF_ETAG */
+#define WEBSERVER_ETAG 0
+#endif /* WEBSERVER_CONF_ETAG */
+
+/* Send static files straight from the file system, with as many
+   segments in flight as uIP allows (UIP_CONF_TCP_SEGMENTS), instead of
+   one segment per round trip */
+#ifdef WEBSERVER_CONF_SENDFILE
+#define WEBSERVER_SENDFILE WEBSERVER_CONF_SENDFILE
+#else /* WEBSERVER_CONF_SENDFILE */
+#define WEBSERVER_SENDFILE 0
+#endif /* WEBSERVER_CONF_SENDFILE */
+
 struct httpd_state {
   unsigned char timer;
   struct psock sin, sout;
@@ -53,6 +78,19 @@ struct httpd_state {
     unsigned short count;
     void *ptr;
   } u;
+#if WEBSERVER_GZIP
+  uint8_t accept_gzip;
+  uint8_t gzip;
+#endif /* WEBSERVER_GZIP */
+#if WEBSERVER_ETAG
+  uint8_t if_none_match_valid;
+  uint32_t if_none_match;
+  char etag[20];
+#endif /* WEBSERVER_ETAG */
+#if WEBSERVER_SENDFILE
+  struct pt sendfilept;
+  uint16_t sent;
+#endif /* WEBSERVER_SENDFILE */
 };
 
 
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Asynchronous file system operations
+ */
+
+/**
+ * \addtogroup cfs-async
+ * @{
+ */
+
+#include "cfs/cfs-async.h"
+#include "lib/list.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define OP_READ  0
+#define OP_WRITE 1
+
+LIST(ops);
+
+process_event_t cfs_async_event_done;
+
+/* File operations get the CPU last, after all other processes. */
+PROCESS_WITH_PRIORITY(cfs_async_process, "CFS async", PROCESS_PRIORITY_LOW);
+/*---------------------------------------------------------------------------*/
+static void
+finish(struct cfs_async_op *op, int result)
+{
+  list_remove(ops, op);
+  op->result = result;
+  op->state = CFS_ASYNC_OP_IDLE;
+  PRINTF("cfs-async: %s fd %d done, %d bytes\n",
+         op->type == OP_WRITE ? "write" : "read", op->fd, result);
+  process_post(op->p, cfs_async_event_done, op);
+}
+/*---------------------------------------------------------------------------*/
+/* Transfer the next chunk of the first operation in the queue. */
+static void
+run_chunk(void)
+{
+  struct cfs_async_op *op;
+  unsigned n;
+  int r;
+
+  op = list_head(ops);
+  if(op == NULL) {
+    return;
+  }
+
+  op->state = CFS_ASYNC_OP_RUNNING;
+
+  n = op->len - op->done;
+  if(n > CFS_ASYNC_CHUNK) {
+    n = CFS_ASYNC_CHUNK;
+  }
+
+  if(n > 0 && op->offset != CFS_ASYNC_OFFSET_CURRENT &&
+     cfs_seek(op->fd, op->offset + op->done, CFS_SEEK_SET) == (cfs_offset_t)-1) {
+    finish(op, -1);
+    return;
+  }
+
+  if(n == 0) {
+    r = 0;
+  } else if(op->type == OP_WRITE) {
+    r = cfs_write(op->fd, (char *)op->buf + op->done, n);
+  } else {
+    r = cfs_read(op->fd, (char *)op->buf + op->done, n);
+  }
+
+  if(r < 0) {
+    finish(op, op->done > 0 ? (int)op->done : -1);
+    return;
+  }
+
+  op->done += r;
+  if(op->done == op->len || (unsigned)r < n) {
+    /* Done, or a short read at the end of the file. */
+    finish(op, op->done);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(cfs_async_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    run_chunk();
+
+    if(list_head(ops) != NULL) {
+      /* Come back after the other processes have run. */
+      process_poll(&cfs_async_process);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_async_init(void)
+{
+  list_init(ops);
+  cfs_async_event_done = process_alloc_event();
+  process_start(&cfs_async_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static int
+submit(struct cfs_async_op *op, unsigned char type, int fd, void *buf,
+       unsigned len, cfs_offset_t offset)
+{
+  if(cfs_async_pending(op)) {
+    return CFS_ASYNC_ERR_BUSY;
+  }
+
+  op->p = PROCESS_CURRENT();
+  op->type = type;
+  op->fd = fd;
+  op->buf = buf;
+  op->len = len;
+  op->offset = offset;
+  op->done = 0;
+  op->result = 0;
+  op->state = CFS_ASYNC_OP_QUEUED;
+  list_add(ops, op);
+
+  process_poll(&cfs_async_process);
+  return CFS_ASYNC_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_async_read(struct cfs_async_op *op, int fd, void *buf,
+               unsigned len, cfs_offset_t offset)
+{
+  return submit(op, OP_READ, fd, buf, len, offset);
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_async_write(struct cfs_async_op *op, int fd, const void *buf,
+                unsigned len, cfs_offset_t offset)
+{
+  return submit(op, OP_WRITE, fd, (void *)buf, len, offset);
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_async_cancel(struct cfs_async_op *op)
+{
+  if(op->state != CFS_ASYNC_OP_QUEUED) {
+    return 0;
+  }
+  list_remove(ops, op);
+  op->state = CFS_ASYNC_OP_IDLE;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_async_pending(struct cfs_async_op *op)
+{
+  return op->state != CFS_ASYNC_OP_IDLE;
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_async_flush(void)
+{
+  while(list_head(ops) != NULL) {
+    run_chunk();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Asynchronous file system operations
+ */
+
+/**
+ * \addtogroup cfs
+ * @{
+ */
+
+/**
+ * \defgroup cfs-async Asynchronous CFS operations
+ * @{
+ *
+ * The cfs-async module runs cfs_read() and cfs_write() calls in the
+ * background, so that a process that logs to an external flash does
+ * not block the rest of the system while a page is programmed. The
+ * caller queues an operation on an open file and gets a
+ * cfs_async_event_done event with a pointer to the operation as data
+ * when it is done.
+ *
+ * Operations are run in queue order by a process with the lowest
+ * priority. Each time it is scheduled, the process transfers at most
+ * CFS_ASYNC_CHUNK bytes, so other processes, and the radio, run
+ * between two chunks. With the default chunk size of one external
+ * flash page, the flash chip programs the previous page while the
+ * other processes run, instead of while the caller busy-waits.
+ *
+ * The file descriptor and the buffer of an operation must stay valid
+ * until the operation is done. Like the other CFS back-end helpers,
+ * the module is not built by default: add cfs-async.c to
+ * PROJECT_SOURCEFILES to use it.
+ */
+
+#ifndef CFS_ASYNC_H_
+#define CFS_ASYNC_H_
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+/** The largest number of bytes that is read or written at a time */
+#ifdef CFS_ASYNC_CONF_CHUNK
+#define CFS_ASYNC_CHUNK CFS_ASYNC_CONF_CHUNK
+#else /* CFS_ASYNC_CONF_CHUNK */
+#define CFS_ASYNC_CHUNK 256
+#endif /* CFS_ASYNC_CONF_CHUNK */
+
+/** Offset value that reads or writes at the current file position */
+#define CFS_ASYNC_OFFSET_CURRENT ((cfs_offset_t)-1)
+
+struct cfs_async_op {
+  struct cfs_async_op *next;
+  struct process *p;
+  void *buf;
+  cfs_offset_t offset;
+  unsigned len;
+  unsigned done;
+  int fd;
+  int result;
+  unsigned char type;
+  unsigned char state;
+};
+
+#define CFS_ASYNC_OP_IDLE    0
+#define CFS_ASYNC_OP_QUEUED  1
+#define CFS_ASYNC_OP_RUNNING 2
+
+#define CFS_ASYNC_OK         0
+#define CFS_ASYNC_ERR_BUSY   1
+
+/**
+ * The event that is posted to the process that queued an operation
+ * when the operation is done. The data is a pointer to the struct
+ * cfs_async_op. Its result field holds the number of bytes that were
+ * read or written, or -1 if the operation failed.
+ */
+extern process_event_t cfs_async_event_done;
+
+/**
+ * \brief      Initialize the asynchronous CFS module
+ *
+ *             This function starts the process that runs the
+ *             operations. It must be called before any operation is
+ *             queued.
+ */
+void cfs_async_init(void);
+
+/**
+ * \brief        Queue a read from an open file
+ * \param op     A pointer to the operation
+ * \param fd     The file descriptor of the open file
+ * \param buf    The buffer that the data is read into
+ * \param len    The number of bytes to read
+ * \param offset The file offset to read from, or CFS_ASYNC_OFFSET_CURRENT
+ * \retval CFS_ASYNC_OK The operation was queued
+ * \retval CFS_ASYNC_ERR_BUSY The operation is already queued or running
+ *
+ *             The read ends early at the end of the file. The
+ *             operation structure must not be reused until the
+ *             calling process got the cfs_async_event_done event.
+ */
+int cfs_async_read(struct cfs_async_op *op, int fd, void *buf,
+                   unsigned len, cfs_offset_t offset);
+
+/**
+ * \brief        Queue a write to an open file
+ * \param op     A pointer to the operation
+ * \param fd     The file descriptor of the open file
+ * \param buf    The data to write
+ * \param len    The number of bytes to write
+ * \param offset The file offset to write to, or CFS_ASYNC_OFFSET_CURRENT
+ * \retval CFS_ASYNC_OK The operation was queued
+ * \retval CFS_ASYNC_ERR_BUSY The operation is already queued or running
+ *
+ *             The buffer is not copied and must not be changed until
+ *             the operation is done.
+ */
+int cfs_async_write(struct cfs_async_op *op, int fd, const void *buf,
+                    unsigned len, cfs_offset_t offset);
+
+/**
+ * \brief      Remove an operation that has not started yet
+ * \param op   A pointer to the operation
+ * \return     Non-zero (true) if the operation was removed from the
+ *             queue, zero (false) if it was not queued
+ *
+ *             No event is posted for a cancelled operation. An
+ *             operation that already transferred data cannot be
+ *             cancelled.
+ */
+int cfs_async_cancel(struct cfs_async_op *op);
+
+/**
+ * \brief      Check if an operation is queued or running
+ * \param op   A pointer to the operation
+ * \return     Non-zero (true) if the operation is not done yet
+ */
+int cfs_async_pending(struct cfs_async_op *op);
+
+/**
+ * \brief      Wait until all queued operations are done
+ *
+ *             This function runs the queued operations to the end
+ *             from the calling context, for instance before the node
+ *             reboots or a file is closed. The completion events are
+ *             still posted.
+ */
+void cfs_async_flush(void);
+
+#endif /* CFS_ASYNC_H_ */
+/** @} */
+/** @} */
@@ -90,6 +90,92 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * Number of files in a RAM index of the directory, which maps a hash of
+ * the file name to the first page of the file. find_file() otherwise
+ * scans the headers of the whole file system for the files that are
+ * not cached. The index is built at the first scan and kept up to date
+ * by reserve() and remove_by_page(). If there are more files than
+ * entries, names that are not in the index are still searched for by
+ * scanning. Each entry takes four bytes with 16-bit pages.
+ */
+#ifndef COFFEE_DIR_INDEX
+#define COFFEE_DIR_INDEX 0
+#endif
+
+/*
+ * Keep a hint of the file end in the file header, so that the end of a
+ * file that is not cached is searched for in the last written eighth of
+ * the file instead of in all of its pages. The hint only has bits added
+ * to it, which flash memories allow without erasing the header.
+ */
+#ifndef COFFEE_EOF_HINT
+#define COFFEE_EOF_HINT 0
+#endif
+
+/*
+ * Reclaim the sectors of removed files in a process, one sector erasure
+ * at a time, instead of in the middle of the reserve() call that finds
+ * no room for a file. The process wakes up when files are created or
+ * removed, and erases sectors when there are fewer free pages than the
+ * low watermark, until there are as many as the high watermark.
+ * reserve() still collects garbage itself if it has to.
+ */
+#ifndef COFFEE_BACKGROUND_GC
+#define COFFEE_BACKGROUND_GC 0
+#endif
+
+#ifndef COFFEE_GC_LOW_WATERMARK
+#define COFFEE_GC_LOW_WATERMARK (COFFEE_PAGE_COUNT / 8)
+#endif
+
+#ifndef COFFEE_GC_HIGH_WATERMARK
+#define COFFEE_GC_HIGH_WATERMARK (COFFEE_PAGE_COUNT / 4)
+#endif
+
+#if COFFEE_BACKGROUND_GC
+#include "sys/process.h"
+#endif
+
+/*
+ * Allocate files from where the last allocation ended, wrapping around
+ * to the start of the file system, instead of from the lowest free
+ * page. Otherwise the sectors freed by the garbage collector at the
+ * start of the file system are written to again and again while the
+ * ones at its end see little wear.
+ */
+#ifndef COFFEE_ROTATING_ALLOCATION
+#define COFFEE_ROTATING_ALLOCATION 0
+#endif
+
+/* Count the erasures of each sector since the system started. */
+#ifndef COFFEE_ERASE_COUNTERS
+#define COFFEE_ERASE_COUNTERS 0
+#endif
+
+/*
+ * Number of pages in a write-back cache in front of the storage, for
+ * the small reads and writes of the micro logs and of applications
+ * that access files in small pieces. Writes to a page are collected
+ * while they extend a contiguous range. The pages written to are
+ * written to the storage, in the order they were first modified, before
+ * any file header is written, when cfs_close() is called, and when a
+ * page has to be evicted; data written to a file that stays open may
+ * thus be lost at a reset. Whole pages that are not cached are read
+ * and written directly.
+ */
+#ifndef COFFEE_PAGE_CACHE
+#define COFFEE_PAGE_CACHE 0
+#endif
+
+#if COFFEE_PAGE_CACHE
+#define FLASH_READ(buf, size, offset)   cache_read((buf), (size), (offset))
+#define FLASH_WRITE(buf, size, offset)  cache_write((buf), (size), (offset))
+#else
+#define FLASH_READ(buf, size, offset)   COFFEE_READ((buf), (size), (offset))
+#define FLASH_WRITE(buf, size, offset)  COFFEE_WRITE((buf), (size), (offset))
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -169,6 +255,9 @@ struct file {
   int16_t record_count;
   uint8_t references;
   uint8_t flags;
+#if COFFEE_EOF_HINT
+  uint8_t eof_hint;
+#endif
 };
 
 /* The file descriptor structure. */
@@ -188,11 +277,23 @@ struct file_header {
   uint16_t log_records;
   uint16_t log_record_size;
   coffee_page_t max_pages;
-  uint8_t deprecated_eof_hint;
+  uint8_t eof_hint;
   uint8_t flags;
   char name[COFFEE_NAME_LENGTH];
 };
 
+#if COFFEE_DIR_INDEX
+/* An entry of the directory index. */
+struct dir_entry {
+  uint16_t hash;
+  coffee_page_t page;
+};
+
+#define DIR_INDEX_UNBUILT   0
+#define DIR_INDEX_COMPLETE  1
+#define DIR_INDEX_PARTIAL   2 /* Files left out of a full index. */
+#endif /* COFFEE_DIR_INDEX */
+
 /* This is needed because of a buggy compiler. */
 struct log_param {
   cfs_offset_t offset;
@@ -211,24 +312,212 @@ static struct protected_mem_t {
   struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
   coffee_page_t next_free;
   char gc_wait;
+#if COFFEE_DIR_INDEX
+  struct dir_entry dir_index[COFFEE_DIR_INDEX];
+  uint16_t dir_index_count;
+  uint8_t dir_index_state;
+#endif
 } protected_mem;
 static struct file *const coffee_files = protected_mem.coffee_files;
 static struct file_desc *const coffee_fd_set = protected_mem.coffee_fd_set;
 static coffee_page_t *const next_free = &protected_mem.next_free;
 static char *const gc_wait = &protected_mem.gc_wait;
 
+#if COFFEE_ERASE_COUNTERS
+static uint32_t sector_erases[COFFEE_SECTOR_COUNT];
+#endif
+
+/*---------------------------------------------------------------------------*/
+#if COFFEE_PAGE_CACHE
+/* A cached page, with the range [dirty_start, dirty_end) modified. */
+struct cache_page {
+  coffee_page_t page;
+  uint16_t dirty_start;
+  uint16_t dirty_end;
+  uint16_t dirty_seq;
+  uint16_t last_use;
+  uint8_t valid;
+  unsigned char data[COFFEE_PAGE_SIZE];
+};
+
+static struct cache_page page_cache[COFFEE_PAGE_CACHE];
+static uint16_t cache_clock;
+static uint16_t cache_dirty_seq;
+
+#define CACHE_DIRTY(c) ((c)->dirty_end > (c)->dirty_start)
+
+/* Write the modified pages in the order they were first modified. */
+static void
+cache_flush(void)
+{
+  struct cache_page *c, *oldest;
+
+  do {
+    oldest = NULL;
+    for(c = page_cache; c < &page_cache[COFFEE_PAGE_CACHE]; c++) {
+      if(c->valid && CACHE_DIRTY(c) &&
+         (oldest == NULL || c->dirty_seq < oldest->dirty_seq)) {
+        oldest = c;
+      }
+    }
+    if(oldest != NULL) {
+      COFFEE_WRITE(oldest->data + oldest->dirty_start,
+                   oldest->dirty_end - oldest->dirty_start,
+                   (cfs_offset_t)oldest->page * COFFEE_PAGE_SIZE +
+                   oldest->dirty_start);
+      oldest->dirty_start = oldest->dirty_end = 0;
+    }
+  } while(oldest != NULL);
+  cache_dirty_seq = 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct cache_page *
+cache_lookup(coffee_page_t page)
+{
+  struct cache_page *c;
+
+  for(c = page_cache; c < &page_cache[COFFEE_PAGE_CACHE]; c++) {
+    if(c->valid && c->page == page) {
+      c->last_use = ++cache_clock;
+      return c;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct cache_page *
+cache_load(coffee_page_t page)
+{
+  struct cache_page *c, *victim;
+
+  victim = NULL;
+  for(c = page_cache; c < &page_cache[COFFEE_PAGE_CACHE]; c++) {
+    if(!c->valid) {
+      victim = c;
+      break;
+    }
+    if(victim == NULL ||
+       (uint16_t)(cache_clock - c->last_use) >
+       (uint16_t)(cache_clock - victim->last_use)) {
+      victim = c;
+    }
+  }
+
+  if(victim->valid && CACHE_DIRTY(victim)) {
+    cache_flush();
+  }
+
+  COFFEE_READ(victim->data, COFFEE_PAGE_SIZE,
+              (cfs_offset_t)page * COFFEE_PAGE_SIZE);
+  victim->page = page;
+  victim->valid = 1;
+  victim->dirty_start = victim->dirty_end = 0;
+  victim->last_use = ++cache_clock;
+  return victim;
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_read(void *buf, cfs_offset_t size, cfs_offset_t offset)
+{
+  struct cache_page *c;
+  cfs_offset_t n, in_page;
+  char *p;
+
+  for(p = buf; size > 0; p += n, offset += n, size -= n) {
+    in_page = offset % COFFEE_PAGE_SIZE;
+    n = COFFEE_PAGE_SIZE - in_page;
+    if(n > size) {
+      n = size;
+    }
+    c = cache_lookup(offset / COFFEE_PAGE_SIZE);
+    if(c == NULL) {
+      if(n == COFFEE_PAGE_SIZE) {
+        COFFEE_READ(p, n, offset);
+        continue;
+      }
+      c = cache_load(offset / COFFEE_PAGE_SIZE);
+    }
+    memcpy(p, c->data + in_page, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_write(const void *buf, cfs_offset_t size, cfs_offset_t offset)
+{
+  struct cache_page *c;
+  cfs_offset_t n, in_page;
+  const char *p;
+
+  for(p = buf; size > 0; p += n, offset += n, size -= n) {
+    in_page = offset % COFFEE_PAGE_SIZE;
+    n = COFFEE_PAGE_SIZE - in_page;
+    if(n > size) {
+      n = size;
+    }
+    c = cache_lookup(offset / COFFEE_PAGE_SIZE);
+    if(c == NULL) {
+      if(n == COFFEE_PAGE_SIZE) {
+        cache_flush();
+        COFFEE_WRITE(p, n, offset);
+        continue;
+      }
+      c = cache_load(offset / COFFEE_PAGE_SIZE);
+    }
+
+    /* Only bytes that have been written to are written to the storage,
+       so the modified range must stay contiguous. */
+    if(CACHE_DIRTY(c) &&
+       (in_page > c->dirty_end || in_page + n < c->dirty_start)) {
+      cache_flush();
+    }
+    memcpy(c->data + in_page, p, n);
+    if(!CACHE_DIRTY(c)) {
+      c->dirty_start = in_page;
+      c->dirty_end = in_page + n;
+      c->dirty_seq = ++cache_dirty_seq;
+    } else {
+      if(in_page < c->dirty_start) {
+        c->dirty_start = in_page;
+      }
+      if(in_page + n > c->dirty_end) {
+        c->dirty_end = in_page + n;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_invalidate(uint16_t sector)
+{
+  struct cache_page *c;
+
+  for(c = page_cache; c < &page_cache[COFFEE_PAGE_CACHE]; c++) {
+    if(c->valid && c->page / COFFEE_PAGES_PER_SECTOR == sector) {
+      c->valid = 0;
+    }
+  }
+}
+#endif /* COFFEE_PAGE_CACHE */
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
 {
   hdr->flags |= HDR_FLAG_VALID;
-  COFFEE_WRITE(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+#if COFFEE_PAGE_CACHE
+  /* File data reaches the storage before the header that refers to it,
+     and the header at once. */
+  cache_flush();
+  FLASH_WRITE(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  cache_flush();
+#else
+  FLASH_WRITE(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+#endif
 }
 /*---------------------------------------------------------------------------*/
 static void
 read_header(struct file_header *hdr, coffee_page_t page)
 {
-  COFFEE_READ(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  FLASH_READ(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
 #if DEBUG
   if(HDR_ACTIVE(*hdr) && !HDR_VALID(*hdr)) {
     PRINTF("Invalid header at page %u!\n", (unsigned)page);
@@ -242,6 +531,18 @@ absolute_offset(coffee_page_t page, cfs_offset_t offset)
   return page * COFFEE_PAGE_SIZE + sizeof(struct file_header) + offset;
 }
 /*---------------------------------------------------------------------------*/
+static void
+erase_sector(uint16_t sector)
+{
+#if COFFEE_ERASE_COUNTERS
+  sector_erases[sector]++;
+#endif
+#if COFFEE_PAGE_CACHE
+  cache_invalidate(sector);
+#endif
+  COFFEE_ERASE(sector);
+}
+/*---------------------------------------------------------------------------*/
 static coffee_page_t
 get_sector_status(uint16_t sector, struct sector_status *stats)
 {
@@ -360,6 +661,24 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
   PRINTF("Coffee: Isolated %u pages starting in sector %d\n",
          (unsigned)skip_pages, (int)start / COFFEE_PAGES_PER_SECTOR);
 }
+#if COFFEE_BACKGROUND_GC
+PROCESS(coffee_gc_process, "Coffee GC");
+
+static struct cfs_coffee_gc_stats gc_stats;
+
+/* Changes when the file extents change under the process. */
+static uint8_t gc_generation;
+
+static void
+gc_poll(void)
+{
+  gc_generation++;
+  if(!process_is_running(&coffee_gc_process)) {
+    process_start(&coffee_gc_process, NULL);
+  }
+  process_poll(&coffee_gc_process);
+}
+#endif /* COFFEE_BACKGROUND_GC */
 /*---------------------------------------------------------------------------*/
 static void
 collect_garbage(int mode)
@@ -368,6 +687,11 @@ collect_garbage(int mode)
   struct sector_status stats;
   coffee_page_t first_page, isolation_count;
 
+#if COFFEE_BACKGROUND_GC
+  gc_generation++;
+  gc_stats.foreground_runs++;
+#endif
+
   PRINTF("Coffee: Running the file system garbage collector in %s mode\n",
          mode == GC_RELUCTANT ? "reluctant" : "greedy");
   /*
@@ -387,15 +711,17 @@ collect_garbage(int mode)
     if((mode == GC_RELUCTANT && stats.free == 0) ||
        (mode == GC_GREEDY && stats.obsolete > 0)) {
       first_page = sector * COFFEE_PAGES_PER_SECTOR;
+#if !COFFEE_ROTATING_ALLOCATION
       if(first_page < *next_free) {
         *next_free = first_page;
       }
+#endif
 
       if(isolation_count > 0) {
         isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
       }
 
-      COFFEE_ERASE(sector);
+      erase_sector(sector);
       PRINTF("Coffee: Erased sector %d!\n", sector);
 
       if(mode == GC_RELUCTANT && isolation_count > 0) {
@@ -405,6 +731,83 @@ collect_garbage(int mode)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+static void
+measure_sectors(void)
+{
+  uint16_t sector;
+  struct sector_status stats;
+
+  gc_stats.active = gc_stats.obsolete = gc_stats.free = 0;
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    get_sector_status(sector, &stats);
+    gc_stats.active += stats.active;
+    gc_stats.obsolete += stats.obsolete;
+    gc_stats.free += stats.free;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  static uint16_t sector;
+  static uint8_t generation;
+  struct sector_status stats;
+  coffee_page_t first_page, isolation_count;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    do {
+      generation = gc_generation;
+      measure_sectors();
+      PRINTF("Coffee: %u active, %u obsolete, and %u free pages\n",
+             (unsigned)gc_stats.active, (unsigned)gc_stats.obsolete,
+             (unsigned)gc_stats.free);
+      if(gc_stats.free >= COFFEE_GC_LOW_WATERMARK) {
+        break;
+      }
+
+      /* The same greedy pass as collect_garbage(), with a pause after
+         each erasure. get_sector_status() keeps state from one sector
+         to the next, so the pass starts over if the file extents have
+         changed during a pause. */
+      for(sector = 0; sector < COFFEE_SECTOR_COUNT &&
+          gc_stats.free < COFFEE_GC_HIGH_WATERMARK; sector++) {
+        isolation_count = get_sector_status(sector, &stats);
+        if(stats.active > 0 || stats.obsolete == 0) {
+          continue;
+        }
+
+        first_page = sector * COFFEE_PAGES_PER_SECTOR;
+#if !COFFEE_ROTATING_ALLOCATION
+        if(first_page < *next_free) {
+          *next_free = first_page;
+        }
+#endif
+        if(isolation_count > 0) {
+          isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+        }
+        erase_sector(sector);
+        PRINTF("Coffee: Erased sector %d in the background\n", sector);
+        gc_stats.erased_sectors++;
+        gc_stats.free += stats.obsolete;
+        gc_stats.obsolete -= stats.obsolete;
+
+        process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL);
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
+        if(generation != gc_generation) {
+          break;
+        }
+      }
+    } while(generation != gc_generation);
+  }
+
+  PROCESS_END();
+}
+#endif /* COFFEE_BACKGROUND_GC */
+/*---------------------------------------------------------------------------*/
 static coffee_page_t
 next_file(coffee_page_t page, struct file_header *hdr)
 {
@@ -464,16 +867,87 @@ load_file(coffee_page_t start, struct file_header *hdr)
   }
   /* We don't know the amount of records yet. */
   file->record_count = -1;
+#if COFFEE_EOF_HINT
+  file->eof_hint = hdr->eof_hint;
+#endif
 
   return file;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_DIR_INDEX
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  /* Only the part of the name that fits in a header counts. */
+  hash = 5381;
+  for(i = 0; i < COFFEE_NAME_LENGTH - 1 && name[i] != '\0'; i++) {
+    hash = (hash << 5) + hash + (unsigned char)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dir_index_add(const char *name, coffee_page_t page)
+{
+  struct protected_mem_t *pm = &protected_mem;
+
+  if(pm->dir_index_state == DIR_INDEX_UNBUILT) {
+    /* The file will be found when the index is built. */
+    return;
+  }
+  if(pm->dir_index_count == COFFEE_DIR_INDEX) {
+    pm->dir_index_state = DIR_INDEX_PARTIAL;
+    return;
+  }
+  pm->dir_index[pm->dir_index_count].hash = name_hash(name);
+  pm->dir_index[pm->dir_index_count].page = page;
+  pm->dir_index_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dir_index_remove(coffee_page_t page)
+{
+  struct protected_mem_t *pm = &protected_mem;
+  int i;
+
+  for(i = 0; i < pm->dir_index_count; i++) {
+    if(pm->dir_index[i].page == page) {
+      pm->dir_index[i] = pm->dir_index[--pm->dir_index_count];
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+dir_index_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+
+  protected_mem.dir_index_count = 0;
+  protected_mem.dir_index_state = DIR_INDEX_COMPLETE;
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      dir_index_add(hdr.name, page);
+    }
+  }
+  PRINTF("Coffee: Indexed %u files\n", protected_mem.dir_index_count);
+}
+#endif /* COFFEE_DIR_INDEX */
+/*---------------------------------------------------------------------------*/
 static struct file *
 find_file(const char *name)
 {
   int i;
   struct file_header hdr;
   coffee_page_t page;
+#if COFFEE_DIR_INDEX
+  uint16_t hash;
+#endif
 
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
@@ -487,6 +961,27 @@ find_file(const char *name)
     }
   }
 
+#if COFFEE_DIR_INDEX
+  /* Then read only the headers of the files whose names hash alike. */
+  if(protected_mem.dir_index_state == DIR_INDEX_UNBUILT) {
+    dir_index_build();
+  }
+  hash = name_hash(name);
+  for(i = 0; i < protected_mem.dir_index_count; i++) {
+    if(protected_mem.dir_index[i].hash != hash) {
+      continue;
+    }
+    page = protected_mem.dir_index[i].page;
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+      return load_file(page, &hdr);
+    }
+  }
+  if(protected_mem.dir_index_state == DIR_INDEX_COMPLETE) {
+    return NULL;
+  }
+#endif /* COFFEE_DIR_INDEX */
+
   /* Scan the flash memory sequentially otherwise. */
   for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
     read_header(&hdr, page);
@@ -498,15 +993,75 @@ find_file(const char *name)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_EOF_HINT
+/*
+ * The EOF hint divides the pages of a file into eight parts and has
+ * bit n, and all bits below it, set once data has been written into
+ * part n.
+ */
+static uint8_t
+eof_hint(coffee_page_t max_pages, cfs_offset_t end)
+{
+  unsigned long page;
+
+  if(end == 0) {
+    return 0;
+  }
+  page = (end - 1 + sizeof(struct file_header)) / COFFEE_PAGE_SIZE;
+  return (2 << (page * 8 / max_pages)) - 1;
+}
+/*---------------------------------------------------------------------------*/
+/* First page of part n of a file. */
+static coffee_page_t
+eof_hint_page(coffee_page_t max_pages, int part)
+{
+  return ((unsigned long)part * max_pages + 7) / 8;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_eof_hint(struct file *file, cfs_offset_t end)
+{
+  struct file_header hdr;
+  uint8_t hint;
+
+  hint = eof_hint(file->max_pages, end);
+  if((file->eof_hint | hint) != file->eof_hint) {
+    read_header(&hdr, file->page);
+    hdr.eof_hint |= hint;
+    write_header(&hdr, file->page);
+    file->eof_hint = hdr.eof_hint;
+  }
+}
+#endif /* COFFEE_EOF_HINT */
+/*---------------------------------------------------------------------------*/
 static cfs_offset_t
 file_end(coffee_page_t start)
 {
   struct file_header hdr;
   unsigned char buf[COFFEE_PAGE_SIZE];
-  coffee_page_t page;
+  coffee_page_t page, last;
   int i;
 
   read_header(&hdr, start);
+  last = hdr.max_pages - 1;
+
+#if COFFEE_EOF_HINT
+  /*
+   * Search from the end of the last part that the hint says has been
+   * written to, after making sure that the next part starts empty. The
+   * hint is behind the data if the system stopped between writing the
+   * data and the header.
+   */
+  for(i = 0; i < 8 && (hdr.eof_hint & (1 << i)); i++);
+  page = eof_hint_page(hdr.max_pages, i);
+  if(i < 8 && page < hdr.max_pages) {
+    FLASH_READ(buf, sizeof(buf), (start + page) * COFFEE_PAGE_SIZE);
+    for(i = COFFEE_PAGE_SIZE - 1; i >= 0 && buf[i] == 0; i--);
+    if(i < 0 || (page == 0 && i < sizeof(hdr))) {
+      last = page - 1;
+    }
+  }
+#endif /* COFFEE_EOF_HINT */
 
   /*
    * Move from the end of the range towards the beginning and look for
@@ -516,8 +1071,8 @@ file_end(coffee_page_t start)
    * are zeroes, then these are skipped from the calculation.
    */
 
-  for(page = hdr.max_pages - 1; page >= 0; page--) {
-    COFFEE_READ(buf, sizeof(buf), (start + page) * COFFEE_PAGE_SIZE);
+  for(page = last; page >= 0; page--) {
+    FLASH_READ(buf, sizeof(buf), (start + page) * COFFEE_PAGE_SIZE);
     for(i = COFFEE_PAGE_SIZE - 1; i >= 0; i--) {
       if(buf[i] != 0) {
         if(page == 0 && i < sizeof(hdr)) {
@@ -533,13 +1088,13 @@ file_end(coffee_page_t start)
 }
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
-find_contiguous_pages(coffee_page_t amount)
+search_pages(coffee_page_t first, coffee_page_t amount)
 {
   coffee_page_t page, start;
   struct file_header hdr;
 
   start = INVALID_PAGE;
-  for(page = *next_free; page < COFFEE_PAGE_COUNT;) {
+  for(page = first; page < COFFEE_PAGE_COUNT;) {
     read_header(&hdr, page);
     if(HDR_FREE(hdr)) {
       if(start == INVALID_PAGE) {
@@ -568,6 +1123,23 @@ find_contiguous_pages(coffee_page_t amount)
   return INVALID_PAGE;
 }
 /*---------------------------------------------------------------------------*/
+static coffee_page_t
+find_contiguous_pages(coffee_page_t amount)
+{
+  coffee_page_t start;
+
+  start = search_pages(*next_free, amount);
+#if COFFEE_ROTATING_ALLOCATION
+  if(start == INVALID_PAGE && *next_free > 0) {
+    start = search_pages(0, amount);
+  }
+  if(start != INVALID_PAGE) {
+    *next_free = start + amount;
+  }
+#endif
+  return start;
+}
+/*---------------------------------------------------------------------------*/
 static int
 remove_by_page(coffee_page_t page, int remove_log, int close_fds,
                int gc_allowed)
@@ -608,7 +1180,13 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
     }
   }
 
-#if !COFFEE_EXTENDED_WEAR_LEVELLING
+#if COFFEE_DIR_INDEX
+  dir_index_remove(page);
+#endif
+
+#if COFFEE_BACKGROUND_GC
+  gc_poll();
+#elif !COFFEE_EXTENDED_WEAR_LEVELLING
   if(gc_allowed) {
     collect_garbage(GC_RELUCTANT);
   }
@@ -658,6 +1236,16 @@ reserve(const char *name, coffee_page_t pages,
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          pages, page, name);
 
+#if COFFEE_BACKGROUND_GC
+  gc_poll();
+#endif
+
+#if COFFEE_DIR_INDEX
+  if(!(flags & HDR_FLAG_LOG)) {
+    dir_index_add(name, page);
+  }
+#endif
+
   file = load_file(page, &hdr);
   if(file != NULL) {
     file->end = 0;
@@ -721,7 +1309,7 @@ get_record_index(coffee_page_t log_page, uint16_t search_records,
       }
 
       base -= batch_size * sizeof(indices[0]);
-      COFFEE_READ(&indices, sizeof(indices[0]) * batch_size, base);
+      FLASH_READ(&indices, sizeof(indices[0]) * batch_size, base);
 
       for(i = batch_size - 1; i >= 0; i--) {
         if(indices[i] - 1 == region) {
@@ -762,7 +1350,7 @@ read_log_page(struct file_header *hdr, int16_t record_count,
   base = absolute_offset(hdr->log_page, log_records * sizeof(region));
   base += (cfs_offset_t)match_index * log_record_size;
   base += lp->offset;
-  COFFEE_READ(lp->buf, lp->size, base);
+  FLASH_READ(lp->buf, lp->size, base);
 
   return lp->size;
 }
@@ -832,7 +1420,7 @@ merge_log(coffee_page_t file_page, int extend)
       cfs_close(fd);
       return -1;
     } else if(n > 0) {
-      COFFEE_WRITE(buf, n, absolute_offset(new_file->page, offset));
+      FLASH_WRITE(buf, n, absolute_offset(new_file->page, offset));
       offset += n;
     }
   } while(n != 0);
@@ -855,10 +1443,16 @@ merge_log(coffee_page_t file_page, int extend)
   read_header(&hdr2, new_file->page);
   hdr2.log_record_size = hdr.log_record_size;
   hdr2.log_records = hdr.log_records;
+#if COFFEE_EOF_HINT
+  hdr2.eof_hint = eof_hint(new_file->max_pages, offset);
+#endif
   write_header(&hdr2, new_file->page);
 
   new_file->flags &= ~COFFEE_FILE_MODIFIED;
   new_file->end = offset;
+#if COFFEE_EOF_HINT
+  new_file->eof_hint = hdr2.eof_hint;
+#endif
 
   cfs_close(fd);
 
@@ -889,7 +1483,7 @@ find_next_record(struct file *file, coffee_page_t log_page,
       batch_size = log_records - processed >= preferred_batch_size ?
         preferred_batch_size : log_records - processed;
 
-      COFFEE_READ(&indices, batch_size * sizeof(indices[0]),
+      FLASH_READ(&indices, batch_size * sizeof(indices[0]),
                   absolute_offset(log_page, processed * sizeof(indices[0])));
       for(log_record = 0; log_record < batch_size; log_record++) {
         if(indices[log_record] == 0) {
@@ -953,7 +1547,7 @@ write_log_page(struct file *file, struct log_param *lp)
 
     if((lp->offset > 0 || lp->size != log_record_size) &&
        read_log_page(&hdr, log_record, &lp_out) < 0) {
-      COFFEE_READ(copy_buf, sizeof(copy_buf),
+      FLASH_READ(copy_buf, sizeof(copy_buf),
                   absolute_offset(file->page, offset));
     }
 
@@ -965,11 +1559,11 @@ write_log_page(struct file *file, struct log_param *lp)
      */
     offset = absolute_offset(log_page, 0);
     ++region;
-    COFFEE_WRITE(&region, sizeof(region),
+    FLASH_WRITE(&region, sizeof(region),
                  offset + log_record * sizeof(region));
 
     offset += log_records * sizeof(region);
-    COFFEE_WRITE(copy_buf, sizeof(copy_buf),
+    FLASH_WRITE(copy_buf, sizeof(copy_buf),
                  offset + log_record * log_record_size);
     file->record_count = log_record + 1;
   }
@@ -1034,6 +1628,9 @@ cfs_close(int fd)
     coffee_fd_set[fd].flags = COFFEE_FD_FREE;
     coffee_fd_set[fd].file->references--;
     coffee_fd_set[fd].file = NULL;
+#if COFFEE_PAGE_CACHE
+    cache_flush();
+#endif
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -1112,7 +1709,7 @@ cfs_read(int fd, void *buf, unsigned size)
 
   /* If the file is allocated, read directly in the file. */
   if(!FILE_MODIFIED(file)) {
-    COFFEE_READ(buf, size, absolute_offset(file->page, fdp->offset));
+    FLASH_READ(buf, size, absolute_offset(file->page, fdp->offset));
     fdp->offset += size;
     return size;
   }
@@ -1132,7 +1729,7 @@ cfs_read(int fd, void *buf, unsigned size)
 
     /* Read from the original file if we cannot find the data in the log. */
     if(r < 0) {
-      COFFEE_READ(buf, lp.size, absolute_offset(file->page, fdp->offset));
+      FLASH_READ(buf, lp.size, absolute_offset(file->page, fdp->offset));
       r = lp.size;
     }
     fdp->offset += r;
@@ -1223,7 +1820,7 @@ cfs_write(int fd, const void *buf, unsigned size)
        * corresponding end offset in the original extent to ensure that
        * the correct file size is calculated when opening the file again.
        */
-      COFFEE_WRITE(dummy, 1, absolute_offset(file->page, fdp->offset - 1));
+      FLASH_WRITE(dummy, 1, absolute_offset(file->page, fdp->offset - 1));
     }
   } else {
 #endif /* COFFEE_MICRO_LOGS */
@@ -1233,7 +1830,7 @@ cfs_write(int fd, const void *buf, unsigned size)
   }
 #endif /* COFFEE_APPEND_ONLY */
 
-  COFFEE_WRITE(buf, size, absolute_offset(file->page, fdp->offset));
+  FLASH_WRITE(buf, size, absolute_offset(file->page, fdp->offset));
   fdp->offset += size;
 #if COFFEE_MICRO_LOGS
 }
@@ -1243,6 +1840,10 @@ cfs_write(int fd, const void *buf, unsigned size)
     file->end = fdp->offset;
   }
 
+#if COFFEE_EOF_HINT
+  update_eof_hint(file, fdp->offset);
+#endif
+
   return size;
 }
 /*---------------------------------------------------------------------------*/
@@ -1339,6 +1940,33 @@ cfs_coffee_set_io_semantics(int fd, unsigned flags)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+const void *
+cfs_coffee_map(int fd, cfs_offset_t *size)
+{
+#ifdef COFFEE_MAP
+  struct file *file;
+
+  if(!(FD_VALID(fd) && FD_READABLE(fd))) {
+    return NULL;
+  }
+
+  /* The data of a file with log records is not stored in one place. */
+  file = coffee_fd_set[fd].file;
+  if(FILE_MODIFIED(file)) {
+    return NULL;
+  }
+
+#if COFFEE_PAGE_CACHE
+  cache_flush();
+#endif
+
+  *size = file->end;
+  return COFFEE_MAP(absolute_offset(file->page, 0));
+#else
+  return NULL;
+#endif /* COFFEE_MAP */
+}
+/*---------------------------------------------------------------------------*/
 int
 cfs_coffee_format(void)
 {
@@ -1349,18 +1977,55 @@ cfs_coffee_format(void)
   *next_free = 0;
 
   for(i = 0; i < COFFEE_SECTOR_COUNT; i++) {
-    COFFEE_ERASE(i);
+    erase_sector(i);
     PRINTF(".");
   }
 
   /* Formatting invalidates the file information. */
   memset(&protected_mem, 0, sizeof(protected_mem));
+#if COFFEE_BACKGROUND_GC
+  gc_generation++;
+#endif
 
   PRINTF(" done!\n");
 
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+void
+cfs_coffee_gc_stats(struct cfs_coffee_gc_stats *stats)
+{
+  memcpy(stats, &gc_stats, sizeof(*stats));
+}
+#endif
+/*---------------------------------------------------------------------------*/
+int
+cfs_coffee_get_sector_stats(unsigned sector,
+                            struct cfs_coffee_sector_stats *stats)
+{
+  struct sector_status status;
+
+  if(sector >= COFFEE_SECTOR_COUNT) {
+    return -1;
+  }
+
+#if COFFEE_BACKGROUND_GC
+  /* The garbage collector's pass over the sectors is interrupted. */
+  gc_generation++;
+#endif
+  get_sector_status(sector, &status);
+  stats->active = status.active;
+  stats->obsolete = status.obsolete;
+  stats->free = status.free;
+#if COFFEE_ERASE_COUNTERS
+  stats->erases = sector_erases[sector];
+#else
+  stats->erases = 0;
+#endif
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 void *
 cfs_coffee_get_protected_mem(unsigned *size)
 {
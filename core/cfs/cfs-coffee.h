@@ -116,6 +116,22 @@ int cfs_coffee_configure_log(const char *file, unsigned log_size,
  */
 int cfs_coffee_set_io_semantics(int fd, unsigned flags);
 
+/**
+ * \brief Get a pointer to the data of a file in the storage.
+ * \param fd The file descriptor of a file opened for reading.
+ * \param size A pointer to where the size of the file is written.
+ * \return A pointer to the first byte of the file, or NULL if the
+ *         file cannot be read in place.
+ *
+ * On platforms whose storage is mapped in the address space, and whose
+ * Coffee port defines COFFEE_MAP(offset), the data of a file can be read
+ * without copying it through a buffer. On other platforms the function
+ * always returns NULL. It also does for a file whose changes are kept
+ * in a micro log. The pointer stays valid until the file is written to,
+ * removed, or the storage is formatted.
+ */
+const void *cfs_coffee_map(int fd, cfs_offset_t *size);
+
 /**
  * \brief Format the storage area assigned to Coffee.
  * \return 0 on success, -1 on failure.
@@ -126,6 +142,52 @@ int cfs_coffee_set_io_semantics(int fd, unsigned flags);
  */
 int cfs_coffee_format(void);
 
+/**
+ * Statistics of the background garbage collector. The page counts are
+ * those of its last pass over the sectors.
+ */
+struct cfs_coffee_gc_stats {
+  unsigned long active;
+  unsigned long obsolete;
+  unsigned long free;
+  unsigned long erased_sectors;
+  unsigned long foreground_runs;
+};
+
+/**
+ * \brief Get the statistics of the background garbage collector.
+ * \param stats The structure to which the statistics are copied.
+ *
+ * Only available when Coffee is built with COFFEE_BACKGROUND_GC. The
+ * foreground runs count the garbage collections that reserve() had to
+ * do itself because no file could be allocated.
+ */
+void cfs_coffee_gc_stats(struct cfs_coffee_gc_stats *stats);
+
+/**
+ * Page allocation and wear of a sector.
+ */
+struct cfs_coffee_sector_stats {
+  unsigned active;
+  unsigned obsolete;
+  unsigned free;
+  unsigned long erases;
+};
+
+/**
+ * \brief Get the allocation statistics of a sector.
+ * \param sector The sector number.
+ * \param stats The structure to which the statistics are written.
+ * \return 0 on success, -1 if there is no such sector.
+ *
+ * The pages of a file may extend over several sectors, so the sectors
+ * must be requested in order starting from sector 0. The erase count is
+ * the number of erasures since the system started if Coffee is built
+ * with COFFEE_ERASE_COUNTERS, and 0 otherwise.
+ */
+int cfs_coffee_get_sector_stats(unsigned sector,
+                                struct cfs_coffee_sector_stats *stats);
+
 /**
  * \brief Points out a memory region that may not be altered during
  * checkpointing operations that use the file system.
@@ -58,6 +58,7 @@
 #define RADIO_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * Each radio has a set of parameters that designate the current
@@ -180,7 +181,12 @@ enum {
   /* The minimum transmission power in dBm. */
   RADIO_CONST_TXPOWER_MIN,
   /* The maximum transmission power in dBm. */
-  RADIO_CONST_TXPOWER_MAX
+  RADIO_CONST_TXPOWER_MAX,
+
+  /* What the radio supports and how long its operations take, of type
+   * struct radio_capabilities. It needs to be used with
+   * radio.get_object(). */
+  RADIO_CONST_CAPABILITIES
 };
 
 /* Radio power modes */
@@ -215,6 +221,46 @@ enum {
  */
 #define RADIO_TX_MODE_SEND_ON_CCA      (1 << 0)
 
+/**
+ * Flags of struct radio_capabilities.
+ *
+ * RADIO_CAP_SFD_TIMESTAMP: RADIO_PARAM_LAST_PACKET_TIMESTAMP is the time
+ * the SFD of the last frame was received, rather than a time taken by
+ * software after the frame.
+ * RADIO_CAP_HW_ACK: RADIO_RX_MODE_AUTOACK is supported.
+ * RADIO_CAP_HW_ACK_IE: automatic ACKs can be enhanced ACKs carrying IEs.
+ * RADIO_CAP_SEND_ON_CCA: RADIO_TX_MODE_SEND_ON_CCA is supported.
+ * RADIO_CAP_POLL_MODE: RADIO_RX_MODE_POLL_MODE is supported.
+ * RADIO_CAP_TIMING: the delays of struct radio_capabilities are set.
+ */
+#define RADIO_CAP_SFD_TIMESTAMP        (1 << 0)
+#define RADIO_CAP_HW_ACK               (1 << 1)
+#define RADIO_CAP_HW_ACK_IE            (1 << 2)
+#define RADIO_CAP_SEND_ON_CCA          (1 << 3)
+#define RADIO_CAP_POLL_MODE            (1 << 4)
+#define RADIO_CAP_TIMING               (1 << 5)
+
+/**
+ * The value of RADIO_CONST_CAPABILITIES. MAC protocols can use it to
+ * pick their timing and the features they rely on at runtime, rather
+ * than assuming the worst case of all radios. Times are in microseconds.
+ */
+struct radio_capabilities {
+  uint16_t flags;
+  /* Resolution of RADIO_PARAM_LAST_PACKET_TIMESTAMP, 0 if the radio
+   * has no timestamps */
+  uint16_t timestamp_precision_us;
+  /* From transmit() to the start of the frame on air */
+  uint16_t delay_before_tx_us;
+  /* From on() to the radio listening */
+  uint16_t delay_before_rx_us;
+  /* From the SFD on air to receiving_packet() returning 1 */
+  uint16_t delay_before_detect_us;
+  /* Shortest time from the end of a received frame to the start of a
+   * transmission */
+  uint16_t turnaround_us;
+};
+
 /* Radio return values when setting or getting radio parameters. */
 typedef enum {
   RADIO_RESULT_OK,
@@ -231,6 +277,14 @@ enum {
   RADIO_TX_NOACK,
 };
 
+/**
+ * A frame of a burst, see radio_driver.send_burst().
+ */
+struct radio_frame {
+  const void *payload;
+  unsigned short payload_len;
+};
+
 /**
  * The structure of a device driver for a radio in Contiki.
  */
@@ -286,6 +340,17 @@ struct radio_driver {
   radio_result_t (* set_object)(radio_param_t param, const void *src,
                                 size_t size);
 
+  /**
+   * Transmit frames back to back, with the shortest inter-frame spacing
+   * the radio allows. With send-on-CCA, only the first frame waits for a
+   * clear channel, and the radio stays on between frames. No ACK is
+   * waited for. Stops at the first failure: returns RADIO_TX_OK if all
+   * frames were sent, the status of the failed frame otherwise, and the
+   * number of frames sent in 'sent'.
+   * Optional: NULL if the radio does not support bursts.
+   */
+  int (* send_burst)(const struct radio_frame *frames, unsigned short count,
+                     unsigned short *sent);
 };
 
 #endif /* RADIO_H_ */
@@ -32,8 +32,6 @@
 #include "dev/serial-line.h"
 #include <string.h> /* for memcpy() */
 
-#include "lib/ringbuf.h"
-
 #ifdef SERIAL_LINE_CONF_BUFSIZE
 #define BUFSIZE SERIAL_LINE_CONF_BUFSIZE
 #else /* SERIAL_LINE_CONF_BUFSIZE */
@@ -45,49 +43,141 @@
 #error Change SERIAL_LINE_CONF_BUFSIZE in contiki-conf.h.
 #endif
 
+/* The number of line buffers. Each received line is posted in a
+   buffer of its own, which stays untouched until all processes have
+   handled the event. With more than one buffer, the next lines are
+   read from the ring while the consumers are still busy. */
+#ifdef SERIAL_LINE_CONF_QUEUE_LENGTH
+#define QUEUE_LENGTH SERIAL_LINE_CONF_QUEUE_LENGTH
+#else /* SERIAL_LINE_CONF_QUEUE_LENGTH */
+#define QUEUE_LENGTH 1
+#endif /* SERIAL_LINE_CONF_QUEUE_LENGTH */
+
+/* The maximum length of a line, including the terminating zero. */
+#ifdef SERIAL_LINE_CONF_LINE_LENGTH
+#define LINE_LENGTH SERIAL_LINE_CONF_LINE_LENGTH
+#elif BUFSIZE > 128
+#define LINE_LENGTH 128
+#else
+#define LINE_LENGTH BUFSIZE
+#endif /* SERIAL_LINE_CONF_LINE_LENGTH */
+
+/* A platform that receives into a DMA buffer can define this as a
+   function that hands the buffered data to serial_line_input_block().
+   It is called by the serial line process each time it is polled. */
+#ifdef SERIAL_LINE_CONF_ARCH_POLL
+#define SERIAL_LINE_ARCH_POLL SERIAL_LINE_CONF_ARCH_POLL
+void SERIAL_LINE_ARCH_POLL(void);
+#endif /* SERIAL_LINE_CONF_ARCH_POLL */
+
 #define IGNORE_CHAR(c) (c == 0x0d)
 #define END 0x0a
 
-static struct ringbuf rxbuf;
+/* The receive ring is written by the UART driver, often from an
+   interrupt, and read by the serial line process. Unlike lib/ringbuf,
+   it may hold more than 128 bytes. The indices must be read
+   atomically, so rings larger than 256 bytes are only safe on CPUs
+   with atomic 16-bit loads and stores. */
+#if BUFSIZE > 256
+typedef uint16_t ring_index_t;
+#else
+typedef uint8_t ring_index_t;
+#endif
+
 static uint8_t rxbuf_data[BUFSIZE];
+static volatile ring_index_t put_ptr, get_ptr;
+static uint8_t overflow; /* Buffer overflow: ignore until END */
 
 PROCESS(serial_line_process, "Serial driver");
 
 process_event_t serial_line_event_message;
 
 /*---------------------------------------------------------------------------*/
-int
-serial_line_input_byte(unsigned char c)
+static int
+ring_put(uint8_t c)
 {
-  static uint8_t overflow = 0; /* Buffer overflow: ignore until END */
-  
-  if(IGNORE_CHAR(c)) {
+  ring_index_t next;
+
+  next = (put_ptr + 1) & (BUFSIZE - 1);
+  if(next == get_ptr) {
     return 0;
   }
+  rxbuf_data[put_ptr] = c;
+  put_ptr = next;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+ring_get(void)
+{
+  uint8_t c;
+
+  if(get_ptr == put_ptr) {
+    return -1;
+  }
+  c = rxbuf_data[get_ptr];
+  get_ptr = (get_ptr + 1) & (BUFSIZE - 1);
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+input(uint8_t c)
+{
+  if(IGNORE_CHAR(c)) {
+    return;
+  }
 
   if(!overflow) {
     /* Add character */
-    if(ringbuf_put(&rxbuf, c) == 0) {
+    if(ring_put(c) == 0) {
       /* Buffer overflow: ignore the rest of the line */
       overflow = 1;
     }
   } else {
     /* Buffer overflowed:
      * Only (try to) add terminator characters, otherwise skip */
-    if(c == END && ringbuf_put(&rxbuf, c) != 0) {
+    if(c == END && ring_put(c) != 0) {
       overflow = 0;
     }
   }
+}
+/*---------------------------------------------------------------------------*/
+int
+serial_line_input_byte(unsigned char c)
+{
+  if(IGNORE_CHAR(c)) {
+    return 0;
+  }
+
+  input(c);
 
   /* Wake up consumer process */
   process_poll(&serial_line_process);
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+int
+serial_line_input_block(const uint8_t *data, uint16_t len)
+{
+  uint16_t i;
+
+  for(i = 0; i < len; i++) {
+    input(data[i]);
+  }
+
+  if(len > 0) {
+    process_poll(&serial_line_process);
+  }
+  return len > 0;
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(serial_line_process, ev, data)
 {
-  static char buf[BUFSIZE];
+  static char lines[QUEUE_LENGTH][LINE_LENGTH];
+  static uint8_t head, tail, queued;
+  static uint8_t complete;
   static int ptr;
+  int c;
 
   PROCESS_BEGIN();
 
@@ -95,34 +185,54 @@ PROCESS_THREAD(serial_line_process, ev, data)
   ptr = 0;
 
   while(1) {
-    /* Fill application buffer until newline or empty */
-    int c = ringbuf_get(&rxbuf);
-    
-    if(c == -1) {
-      /* Buffer empty, wait for poll */
-      PROCESS_YIELD();
-    } else {
-      if(c != END) {
-        if(ptr < BUFSIZE-1) {
-          buf[ptr++] = (uint8_t)c;
-        } else {
-          /* Ignore character (wait for EOL) */
-        }
-      } else {
-        /* Terminate */
-        buf[ptr++] = (uint8_t)'\0';
-
-        /* Broadcast event */
-        process_post(PROCESS_BROADCAST, serial_line_event_message, buf);
+    if(ev == PROCESS_EVENT_CONTINUE && queued > 0 && data == lines[tail]) {
+      /* All processes have handled the line in the oldest buffer. */
+      tail = (tail + 1) % QUEUE_LENGTH;
+      queued--;
+    }
 
-        /* Wait until all processes have handled the serial line event */
-        if(PROCESS_ERR_OK ==
-          process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL)) {
-          PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
+#ifdef SERIAL_LINE_ARCH_POLL
+    if(ev == PROCESS_EVENT_POLL) {
+      SERIAL_LINE_ARCH_POLL();
+    }
+#endif /* SERIAL_LINE_ARCH_POLL */
+
+    while(queued < QUEUE_LENGTH) {
+      if(!complete) {
+        /* Fill the line buffer until newline or empty */
+        c = ring_get();
+        if(c == -1) {
+          break;
         }
+        if(c != END) {
+          if(ptr < LINE_LENGTH - 1) {
+            lines[head][ptr++] = (uint8_t)c;
+          } else {
+            /* Ignore character (wait for EOL) */
+          }
+          continue;
+        }
+        /* Terminate */
+        lines[head][ptr] = '\0';
         ptr = 0;
+        complete = 1;
       }
+
+      /* The line is posted together with an event to ourselves, which
+         arrives once all processes have handled the line. Wait for
+         room in the event queue for both. */
+      if(process_post_capacity(PROCESS_CURRENT()) < 2) {
+        process_poll(PROCESS_CURRENT());
+        break;
+      }
+      process_post(PROCESS_BROADCAST, serial_line_event_message, lines[head]);
+      process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, lines[head]);
+      head = (head + 1) % QUEUE_LENGTH;
+      queued++;
+      complete = 0;
     }
+
+    PROCESS_YIELD();
   }
 
   PROCESS_END();
@@ -131,7 +241,6 @@ PROCESS_THREAD(serial_line_process, ev, data)
 void
 serial_line_init(void)
 {
-  ringbuf_init(&rxbuf, rxbuf_data, sizeof(rxbuf_data));
   process_start(&serial_line_process, NULL);
 }
 /*---------------------------------------------------------------------------*/
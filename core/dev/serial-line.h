@@ -46,7 +46,10 @@
  *
  * This event is posted when an entire line of input has been received
  * from the serial port. A data pointer to the incoming line of input
- * is sent together with the event.
+ * is sent together with the event. The line stays valid until all
+ * processes have handled the event. With SERIAL_LINE_CONF_QUEUE_LENGTH
+ * larger than one, further lines are posted while earlier ones are
+ * still being handled, each in a buffer of its own.
  */
 extern process_event_t serial_line_event_message;
 
@@ -69,6 +72,22 @@ extern process_event_t serial_line_event_message;
 
 int serial_line_input_byte(unsigned char c);
 
+/**
+ * Get a block of input from the serial driver.
+ *
+ * This function is to be called by drivers that receive several bytes
+ * at a time, such as a UART driver that receives into a DMA buffer.
+ * It may be called from an interrupt or from the function given by
+ * SERIAL_LINE_CONF_ARCH_POLL, which the serial line process calls
+ * each time it is polled.
+ *
+ * \param data The data that is received.
+ * \param len The length of the data.
+ *
+ * \return Non-zero if the CPU should be powered up, zero otherwise.
+ */
+int serial_line_input_block(const uint8_t *data, uint16_t len);
+
 void serial_line_init(void);
 
 PROCESS_NAME(serial_line_process);
@@ -86,6 +86,12 @@ static uint8_t rxbuf[RX_BUFSIZE];
 static uint16_t pkt_end;		/* SLIP_END tracker. */
 
 static void (* input_callback)(void) = NULL;
+
+#if SLIP_BLOCK
+static uint8_t txbuf[2][SLIP_TX_BUFSIZE];
+static uint8_t txbuf_current;
+static uint16_t txbuf_len;
+#endif
 /*---------------------------------------------------------------------------*/
 void
 slip_set_input_callback(void (*c)(void))
@@ -93,48 +99,95 @@ slip_set_input_callback(void (*c)(void))
   input_callback = c;
 }
 /*---------------------------------------------------------------------------*/
-/* slip_send: forward (IPv4) packets with {UIP_FW_NETIF(..., slip_send)}
- * was used in slip-bridge.c
+/*
+ * Encode as much of src as fits in dst, without END bytes. Returns the
+ * number of bytes written to dst and sets *consumed to the number of
+ * bytes taken from src.
  */
-uint8_t
-slip_send(void)
+static int
+encode(uint8_t *dst, int dst_len, const uint8_t *src, int src_len,
+       int *consumed)
 {
-  uint16_t i;
-  uint8_t *ptr;
+  int i, n;
   uint8_t c;
 
-  slip_arch_writeb(SLIP_END);
-
-  ptr = &uip_buf[UIP_LLH_LEN];
-  for(i = 0; i < uip_len; ++i) {
-    if(i == UIP_TCPIP_HLEN) {
-      ptr = (uint8_t *)uip_appdata;
-    }
-    c = *ptr++;
-    if(c == SLIP_END) {
-      slip_arch_writeb(SLIP_ESC);
-      c = SLIP_ESC_END;
-    } else if(c == SLIP_ESC) {
-      slip_arch_writeb(SLIP_ESC);
-      c = SLIP_ESC_ESC;
+  for(i = 0, n = 0; i < src_len && n < dst_len; i++) {
+    c = src[i];
+    if(c == SLIP_END || c == SLIP_ESC) {
+      if(n + 2 > dst_len) {
+        break;
+      }
+      dst[n++] = SLIP_ESC;
+      c = c == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC;
     }
-    slip_arch_writeb(c);
+    dst[n++] = c;
   }
-  slip_arch_writeb(SLIP_END);
+  *consumed = i;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+int
+slip_encode(uint8_t *dst, int dst_len, const void *src, int src_len)
+{
+  int n, consumed;
 
-  return UIP_FW_OK;
+  if(dst_len < 2) {
+    return -1;
+  }
+  dst[0] = SLIP_END;
+  n = 1 + encode(&dst[1], dst_len - 2, src, src_len, &consumed);
+  if(consumed < src_len) {
+    return -1;
+  }
+  dst[n++] = SLIP_END;
+  return n;
 }
 /*---------------------------------------------------------------------------*/
-uint8_t
-slip_write(const void *_ptr, int len)
+#if SLIP_BLOCK
+static void
+flush(void)
 {
-  const uint8_t *ptr = _ptr;
-  uint16_t i;
-  uint8_t c;
+  if(txbuf_len > 0) {
+    slip_arch_write(txbuf[txbuf_current], txbuf_len);
+    txbuf_current ^= 1;
+    txbuf_len = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_byte(uint8_t c)
+{
+  if(txbuf_len == SLIP_TX_BUFSIZE) {
+    flush();
+  }
+  txbuf[txbuf_current][txbuf_len++] = c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_data(const uint8_t *ptr, int len)
+{
+  int consumed;
 
-  slip_arch_writeb(SLIP_END);
+  while(len > 0) {
+    if(txbuf_len + 2 > SLIP_TX_BUFSIZE) {
+      flush();
+    }
+    txbuf_len += encode(&txbuf[txbuf_current][txbuf_len],
+                        SLIP_TX_BUFSIZE - txbuf_len, ptr, len, &consumed);
+    ptr += consumed;
+    len -= consumed;
+  }
+}
+#else /* SLIP_BLOCK */
+#define write_byte(c) slip_arch_writeb(c)
+#define flush()
+/*---------------------------------------------------------------------------*/
+static void
+write_data(const uint8_t *ptr, int len)
+{
+  uint8_t c;
 
-  for(i = 0; i < len; ++i) {
+  for(; len > 0; len--) {
     c = *ptr++;
     if(c == SLIP_END) {
       slip_arch_writeb(SLIP_ESC);
@@ -145,7 +198,36 @@ slip_write(const void *_ptr, int len)
     }
     slip_arch_writeb(c);
   }
-  slip_arch_writeb(SLIP_END);
+}
+#endif /* SLIP_BLOCK */
+/*---------------------------------------------------------------------------*/
+/* slip_send: forward (IPv4) packets with {UIP_FW_NETIF(..., slip_send)}
+ * was used in slip-bridge.c
+ */
+uint8_t
+slip_send(void)
+{
+  uint16_t len;
+
+  write_byte(SLIP_END);
+
+  len = uip_len < UIP_TCPIP_HLEN ? uip_len : UIP_TCPIP_HLEN;
+  write_data(&uip_buf[UIP_LLH_LEN], len);
+  write_data((uint8_t *)uip_appdata, uip_len - len);
+
+  write_byte(SLIP_END);
+  flush();
+
+  return UIP_FW_OK;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+slip_write(const void *ptr, int len)
+{
+  write_byte(SLIP_END);
+  write_data(ptr, len);
+  write_byte(SLIP_END);
+  flush();
 
   return len;
 }
@@ -172,8 +254,9 @@ slip_poll_handler(uint8_t *outbuf, uint16_t blen)
       rxbuf_init();
       
       for(i = 0; i < 13; i++) {
-	slip_arch_writeb("CLIENTSERVER\300"[i]);
+	write_byte("CLIENTSERVER\300"[i]);
       }
+      flush();
       return 0;
     }
   }
@@ -192,13 +275,14 @@ slip_poll_handler(uint8_t *outbuf, uint16_t blen)
       
       linkaddr_t addr = get_mac_addr();
       /* this is just a test so far... just to see if it works */
-      slip_arch_writeb('!');
-      slip_arch_writeb('M');
+      write_byte('!');
+      write_byte('M');
       for(j = 0; j < 8; j++) {
-        slip_arch_writeb(hexchar[addr.u8[j] >> 4]);
-        slip_arch_writeb(hexchar[addr.u8[j] & 15]);
+        write_byte(hexchar[addr.u8[j] >> 4]);
+        write_byte(hexchar[addr.u8[j] & 15]);
       }
-      slip_arch_writeb(SLIP_END);
+      write_byte(SLIP_END);
+      flush();
       return 0;
     }
   }
@@ -391,3 +475,37 @@ slip_input_byte(unsigned char c)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+void
+slip_input_block(const uint8_t *data, uint16_t len)
+{
+  uint16_t n, space;
+
+  while(len > 0) {
+    n = 0;
+    if(state == STATE_OK) {
+      /* Copy the bytes up to the next END or ESC byte at once. */
+      for(; n < len && data[n] != SLIP_END && data[n] != SLIP_ESC; n++);
+      space = (begin > end ? begin : RX_BUFSIZE + begin) - end - 1;
+      if(space > RX_BUFSIZE - end) {
+        space = RX_BUFSIZE - end;
+      }
+      if(n > space) {
+        n = space;
+      }
+      memcpy(&rxbuf[end], data, n);
+      end = end + n == RX_BUFSIZE ? 0 : end + n;
+    }
+    if(n == 0) {
+      /* Control bytes, other states, and a full buffer. */
+      slip_input_byte(*data);
+      n = 1;
+    }
+    data += n;
+    len -= n;
+  }
+
+  if(begin != end && rxbuf[begin] == 'C') {
+    process_poll(&slip_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -36,6 +36,27 @@
 
 #include "contiki.h"
 
+/*
+ * In block mode, encoded frames are handed to the platform in blocks
+ * with slip_arch_write() instead of byte by byte, so that a UART DMA
+ * can send them, and the platform passes received data to
+ * slip_input_block() in chunks from its poll handler instead of to
+ * slip_input_byte() from its interrupt handler.
+ */
+#ifdef SLIP_CONF_BLOCK
+#define SLIP_BLOCK SLIP_CONF_BLOCK
+#else
+#define SLIP_BLOCK 0
+#endif
+
+/* The size of each of the two buffers into which frames are encoded in
+   block mode. One is filled while the other is sent. */
+#ifdef SLIP_CONF_TX_BUFSIZE
+#define SLIP_TX_BUFSIZE SLIP_CONF_TX_BUFSIZE
+#else
+#define SLIP_TX_BUFSIZE 64
+#endif
+
 PROCESS_NAME(slip_process);
 
 /**
@@ -64,6 +85,32 @@ int slip_input_byte(unsigned char c);
 
 uint8_t slip_write(const void *ptr, int len);
 
+/**
+ * Input a chunk of received SLIP data in block mode.
+ *
+ * This function must be called from the poll handler of the device
+ * driver, not from an interrupt context, and must not be mixed with
+ * slip_input_byte().
+ *
+ * \param data The received data
+ * \param len The number of bytes
+ */
+void slip_input_block(const uint8_t *data, uint16_t len);
+
+/**
+ * Encode a frame into a buffer.
+ *
+ * \param dst The buffer
+ * \param dst_len The size of the buffer, of which at most 2 * src_len + 2
+ *        bytes are used
+ * \param src The data of the frame
+ * \param src_len The length of the data
+ *
+ * \return The length of the encoded frame including its two END bytes,
+ *         or -1 if it does not fit in the buffer.
+ */
+int slip_encode(uint8_t *dst, int dst_len, const void *src, int src_len);
+
 /* Did we receive any bytes lately? */
 extern uint8_t slip_active;
 
@@ -83,4 +130,12 @@ void slip_set_input_callback(void (*callback)(void));
 void slip_arch_init(unsigned long ubr);
 void slip_arch_writeb(unsigned char c);
 
+/*
+ * Start to send a block of encoded data, in block mode. The function
+ * may return before the block has been sent, but must wait until the
+ * previous block has been sent before it starts, since the SLIP driver
+ * then fills the buffer of the previous block.
+ */
+void slip_arch_write(const uint8_t *buf, uint16_t len);
+
 #endif /* SLIP_H_ */
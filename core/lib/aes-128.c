@@ -64,38 +64,229 @@ static const uint8_t sbox[256] =   {
 0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
 0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16 };
 
-static uint8_t round_keys[11][AES_128_KEY_LENGTH];
+#if AES_128_IMPL == AES_128_IMPL_XTIME
+/* xtime[x] is x multiplied by 2 in GF(2^8) */
+static const uint8_t xtime[256] = {
+0x00, 0x02, 0x04, 0x06, 0x08, 0x0a, 0x0c, 0x0e, 0x10, 0x12, 0x14, 0x16, 0x18, 0x1a, 0x1c, 0x1e,
+0x20, 0x22, 0x24, 0x26, 0x28, 0x2a, 0x2c, 0x2e, 0x30, 0x32, 0x34, 0x36, 0x38, 0x3a, 0x3c, 0x3e,
+0x40, 0x42, 0x44, 0x46, 0x48, 0x4a, 0x4c, 0x4e, 0x50, 0x52, 0x54, 0x56, 0x58, 0x5a, 0x5c, 0x5e,
+0x60, 0x62, 0x64, 0x66, 0x68, 0x6a, 0x6c, 0x6e, 0x70, 0x72, 0x74, 0x76, 0x78, 0x7a, 0x7c, 0x7e,
+0x80, 0x82, 0x84, 0x86, 0x88, 0x8a, 0x8c, 0x8e, 0x90, 0x92, 0x94, 0x96, 0x98, 0x9a, 0x9c, 0x9e,
+0xa0, 0xa2, 0xa4, 0xa6, 0xa8, 0xaa, 0xac, 0xae, 0xb0, 0xb2, 0xb4, 0xb6, 0xb8, 0xba, 0xbc, 0xbe,
+0xc0, 0xc2, 0xc4, 0xc6, 0xc8, 0xca, 0xcc, 0xce, 0xd0, 0xd2, 0xd4, 0xd6, 0xd8, 0xda, 0xdc, 0xde,
+0xe0, 0xe2, 0xe4, 0xe6, 0xe8, 0xea, 0xec, 0xee, 0xf0, 0xf2, 0xf4, 0xf6, 0xf8, 0xfa, 0xfc, 0xfe,
+0x1b, 0x19, 0x1f, 0x1d, 0x13, 0x11, 0x17, 0x15, 0x0b, 0x09, 0x0f, 0x0d, 0x03, 0x01, 0x07, 0x05,
+0x3b, 0x39, 0x3f, 0x3d, 0x33, 0x31, 0x37, 0x35, 0x2b, 0x29, 0x2f, 0x2d, 0x23, 0x21, 0x27, 0x25,
+0x5b, 0x59, 0x5f, 0x5d, 0x53, 0x51, 0x57, 0x55, 0x4b, 0x49, 0x4f, 0x4d, 0x43, 0x41, 0x47, 0x45,
+0x7b, 0x79, 0x7f, 0x7d, 0x73, 0x71, 0x77, 0x75, 0x6b, 0x69, 0x6f, 0x6d, 0x63, 0x61, 0x67, 0x65,
+0x9b, 0x99, 0x9f, 0x9d, 0x93, 0x91, 0x97, 0x95, 0x8b, 0x89, 0x8f, 0x8d, 0x83, 0x81, 0x87, 0x85,
+0xbb, 0xb9, 0xbf, 0xbd, 0xb3, 0xb1, 0xb7, 0xb5, 0xab, 0xa9, 0xaf, 0xad, 0xa3, 0xa1, 0xa7, 0xa5,
+0xdb, 0xd9, 0xdf, 0xdd, 0xd3, 0xd1, 0xd7, 0xd5, 0xcb, 0xc9, 0xcf, 0xcd, 0xc3, 0xc1, 0xc7, 0xc5,
+0xfb, 0xf9, 0xff, 0xfd, 0xf3, 0xf1, 0xf7, 0xf5, 0xeb, 0xe9, 0xef, 0xed, 0xe3, 0xe1, 0xe7, 0xe5 };
+#elif AES_128_IMPL == AES_128_IMPL_TTABLE
+/*
+ * te0[x] is the column MixColumn makes of S(x) in row 0, that is 2S(x),
+ * S(x), S(x) and 3S(x) from the least to the most significant byte. The
+ * tables for rows 1 to 3 are rotations of it.
+ */
+static const uint32_t te0[256] = {
+0xa56363c6, 0x847c7cf8, 0x997777ee, 0x8d7b7bf6, 0x0df2f2ff, 0xbd6b6bd6,
+0xb16f6fde, 0x54c5c591, 0x50303060, 0x03010102, 0xa96767ce, 0x7d2b2b56,
+0x19fefee7, 0x62d7d7b5, 0xe6abab4d, 0x9a7676ec, 0x45caca8f, 0x9d82821f,
+0x40c9c989, 0x877d7dfa, 0x15fafaef, 0xeb5959b2, 0xc947478e, 0x0bf0f0fb,
+0xecadad41, 0x67d4d4b3, 0xfda2a25f, 0xeaafaf45, 0xbf9c9c23, 0xf7a4a453,
+0x967272e4, 0x5bc0c09b, 0xc2b7b775, 0x1cfdfde1, 0xae93933d, 0x6a26264c,
+0x5a36366c, 0x413f3f7e, 0x02f7f7f5, 0x4fcccc83, 0x5c343468, 0xf4a5a551,
+0x34e5e5d1, 0x08f1f1f9, 0x937171e2, 0x73d8d8ab, 0x53313162, 0x3f15152a,
+0x0c040408, 0x52c7c795, 0x65232346, 0x5ec3c39d, 0x28181830, 0xa1969637,
+0x0f05050a, 0xb59a9a2f, 0x0907070e, 0x36121224, 0x9b80801b, 0x3de2e2df,
+0x26ebebcd, 0x6927274e, 0xcdb2b27f, 0x9f7575ea, 0x1b090912, 0x9e83831d,
+0x742c2c58, 0x2e1a1a34, 0x2d1b1b36, 0xb26e6edc, 0xee5a5ab4, 0xfba0a05b,
+0xf65252a4, 0x4d3b3b76, 0x61d6d6b7, 0xceb3b37d, 0x7b292952, 0x3ee3e3dd,
+0x712f2f5e, 0x97848413, 0xf55353a6, 0x68d1d1b9, 0x00000000, 0x2cededc1,
+0x60202040, 0x1ffcfce3, 0xc8b1b179, 0xed5b5bb6, 0xbe6a6ad4, 0x46cbcb8d,
+0xd9bebe67, 0x4b393972, 0xde4a4a94, 0xd44c4c98, 0xe85858b0, 0x4acfcf85,
+0x6bd0d0bb, 0x2aefefc5, 0xe5aaaa4f, 0x16fbfbed, 0xc5434386, 0xd74d4d9a,
+0x55333366, 0x94858511, 0xcf45458a, 0x10f9f9e9, 0x06020204, 0x817f7ffe,
+0xf05050a0, 0x443c3c78, 0xba9f9f25, 0xe3a8a84b, 0xf35151a2, 0xfea3a35d,
+0xc0404080, 0x8a8f8f05, 0xad92923f, 0xbc9d9d21, 0x48383870, 0x04f5f5f1,
+0xdfbcbc63, 0xc1b6b677, 0x75dadaaf, 0x63212142, 0x30101020, 0x1affffe5,
+0x0ef3f3fd, 0x6dd2d2bf, 0x4ccdcd81, 0x140c0c18, 0x35131326, 0x2fececc3,
+0xe15f5fbe, 0xa2979735, 0xcc444488, 0x3917172e, 0x57c4c493, 0xf2a7a755,
+0x827e7efc, 0x473d3d7a, 0xac6464c8, 0xe75d5dba, 0x2b191932, 0x957373e6,
+0xa06060c0, 0x98818119, 0xd14f4f9e, 0x7fdcdca3, 0x66222244, 0x7e2a2a54,
+0xab90903b, 0x8388880b, 0xca46468c, 0x29eeeec7, 0xd3b8b86b, 0x3c141428,
+0x79dedea7, 0xe25e5ebc, 0x1d0b0b16, 0x76dbdbad, 0x3be0e0db, 0x56323264,
+0x4e3a3a74, 0x1e0a0a14, 0xdb494992, 0x0a06060c, 0x6c242448, 0xe45c5cb8,
+0x5dc2c29f, 0x6ed3d3bd, 0xefacac43, 0xa66262c4, 0xa8919139, 0xa4959531,
+0x37e4e4d3, 0x8b7979f2, 0x32e7e7d5, 0x43c8c88b, 0x5937376e, 0xb76d6dda,
+0x8c8d8d01, 0x64d5d5b1, 0xd24e4e9c, 0xe0a9a949, 0xb46c6cd8, 0xfa5656ac,
+0x07f4f4f3, 0x25eaeacf, 0xaf6565ca, 0x8e7a7af4, 0xe9aeae47, 0x18080810,
+0xd5baba6f, 0x887878f0, 0x6f25254a, 0x722e2e5c, 0x241c1c38, 0xf1a6a657,
+0xc7b4b473, 0x51c6c697, 0x23e8e8cb, 0x7cdddda1, 0x9c7474e8, 0x211f1f3e,
+0xdd4b4b96, 0xdcbdbd61, 0x868b8b0d, 0x858a8a0f, 0x907070e0, 0x423e3e7c,
+0xc4b5b571, 0xaa6666cc, 0xd8484890, 0x05030306, 0x01f6f6f7, 0x120e0e1c,
+0xa36161c2, 0x5f35356a, 0xf95757ae, 0xd0b9b969, 0x91868617, 0x58c1c199,
+0x271d1d3a, 0xb99e9e27, 0x38e1e1d9, 0x13f8f8eb, 0xb398982b, 0x33111122,
+0xbb6969d2, 0x70d9d9a9, 0x898e8e07, 0xa7949433, 0xb69b9b2d, 0x221e1e3c,
+0x92878715, 0x20e9e9c9, 0x49cece87, 0xff5555aa, 0x78282850, 0x7adfdfa5,
+0x8f8c8c03, 0xf8a1a159, 0x80898909, 0x170d0d1a, 0xdabfbf65, 0x31e6e6d7,
+0xc6424284, 0xb86868d0, 0xc3414182, 0xb0999929, 0x772d2d5a, 0x110f0f1e,
+0xcbb0b07b, 0xfc5454a8, 0xd6bbbb6d, 0x3a16162c };
+#endif /* AES_128_IMPL */
+
+/* The expanded keys, round_keys points to the one in use */
+#if AES_128_IMPL == AES_128_IMPL_TTABLE
+/* round keys as columns, row i in bits 8i to 8i + 7 */
+static uint32_t schedules[AES_128_KEY_CACHE][11][4];
+static uint32_t (*round_keys)[4] = schedules[0];
+#else /* AES_128_IMPL == AES_128_IMPL_TTABLE */
+static uint8_t schedules[AES_128_KEY_CACHE][11][AES_128_KEY_LENGTH];
+static uint8_t (*round_keys)[AES_128_KEY_LENGTH] = schedules[0];
+#endif /* AES_128_IMPL == AES_128_IMPL_TTABLE */
+#if AES_128_KEY_CACHE > 1
+/* The number of expanded keys, and the next one to replace */
+static uint8_t schedules_used;
+static uint8_t schedules_next;
+#endif /* AES_128_KEY_CACHE > 1 */
 
 /*---------------------------------------------------------------------------*/
 /* multiplies by 2 in GF(2) */
 static uint8_t
 galois_mul2(uint8_t value)
 {
+#if AES_128_IMPL == AES_128_IMPL_XTIME
+  return xtime[value];
+#else /* AES_128_IMPL == AES_128_IMPL_XTIME */
   uint8_t xor_val = (value >> 7) * 0x1b;
   return ((value << 1) ^ xor_val);
+#endif /* AES_128_IMPL == AES_128_IMPL_XTIME */
+}
+/*---------------------------------------------------------------------------*/
+#if AES_128_IMPL == AES_128_IMPL_TTABLE
+#define BYTE(word, row)  ((uint8_t)((word) >> (8 * (row))))
+#define ROTL8(word)      (((word) << 8) | ((word) >> 24))
+#define ROTL16(word)     (((word) << 16) | ((word) >> 16))
+#define ROTL24(word)     (((word) << 24) | ((word) >> 8))
+
+static uint32_t
+load_column(const uint8_t *bytes)
+{
+  return bytes[0]
+      | ((uint32_t)bytes[1] << 8)
+      | ((uint32_t)bytes[2] << 16)
+      | ((uint32_t)bytes[3] << 24);
 }
+#endif /* AES_128_IMPL == AES_128_IMPL_TTABLE */
 /*---------------------------------------------------------------------------*/
 static void
+store_round_key(uint8_t round, const uint8_t *key)
+{
+#if AES_128_IMPL == AES_128_IMPL_TTABLE
+  uint8_t i;
+
+  for(i = 0; i < 4; i++) {
+    round_keys[round][i] = load_column(key + (i << 2));
+  }
+#else /* AES_128_IMPL == AES_128_IMPL_TTABLE */
+  memcpy(round_keys[round], key, AES_128_KEY_LENGTH);
+#endif /* AES_128_IMPL == AES_128_IMPL_TTABLE */
+}
+/*---------------------------------------------------------------------------*/
+#if AES_128_KEY_CACHE > 1
+/* Round key 0 is the key itself */
+static int
+schedule_matches(uint8_t schedule, const uint8_t *key)
+{
+#if AES_128_IMPL == AES_128_IMPL_TTABLE
+  uint8_t i;
+
+  for(i = 0; i < 4; i++) {
+    if(schedules[schedule][0][i] != load_column(key + (i << 2))) {
+      return 0;
+    }
+  }
+  return 1;
+#else /* AES_128_IMPL == AES_128_IMPL_TTABLE */
+  return memcmp(schedules[schedule][0], key, AES_128_KEY_LENGTH) == 0;
+#endif /* AES_128_IMPL == AES_128_IMPL_TTABLE */
+}
+/*---------------------------------------------------------------------------*/
+#endif /* AES_128_KEY_CACHE > 1 */
+static void
 set_key(const uint8_t *key)
 {
   uint8_t i;
   uint8_t j;
   uint8_t rcon;
+  uint8_t buf1;
+  uint8_t round_key[AES_128_KEY_LENGTH];
+
+#if AES_128_KEY_CACHE > 1
+  for(i = 0; i < schedules_used; i++) {
+    if(schedule_matches(i, key)) {
+      round_keys = schedules[i];
+      return;
+    }
+  }
+  round_keys = schedules[schedules_next];
+  if(schedules_used < AES_128_KEY_CACHE) {
+    schedules_used++;
+  }
+  schedules_next = (schedules_next + 1) % AES_128_KEY_CACHE;
+#endif /* AES_128_KEY_CACHE > 1 */
   
   rcon = 0x01;
-  memcpy(round_keys[0], key, AES_128_KEY_LENGTH);
+  memcpy(round_key, key, AES_128_KEY_LENGTH);
+  store_round_key(0, round_key);
   for(i = 1; i <= 10; i++) {
-    round_keys[i][0] = sbox[round_keys[i - 1][13]] ^ round_keys[i - 1][0] ^ rcon;
-    round_keys[i][1] = sbox[round_keys[i - 1][14]] ^ round_keys[i - 1][1];
-    round_keys[i][2] = sbox[round_keys[i - 1][15]] ^ round_keys[i - 1][2];
-    round_keys[i][3] = sbox[round_keys[i - 1][12]] ^ round_keys[i - 1][3];
+    buf1 = round_key[12];
+    round_key[0] ^= sbox[round_key[13]] ^ rcon;
+    round_key[1] ^= sbox[round_key[14]];
+    round_key[2] ^= sbox[round_key[15]];
+    round_key[3] ^= sbox[buf1];
     for(j = 4; j < AES_128_BLOCK_SIZE; j++) {
-      round_keys[i][j] = round_keys[i - 1][j] ^ round_keys[i][j - 4];
+      round_key[j] ^= round_key[j - 4];
     }
+    store_round_key(i, round_key);
     rcon = galois_mul2(rcon);
   }
 }
 /*---------------------------------------------------------------------------*/
+#if AES_128_IMPL == AES_128_IMPL_TTABLE
+static void
+encrypt(uint8_t *state)
+{
+  uint32_t s[4];
+  uint32_t t[4];
+  uint8_t round, i;
+
+  /* round 0 */
+  for(i = 0; i < 4; i++) {
+    s[i] = load_column(state + (i << 2)) ^ round_keys[0][i];
+  }
+
+  /* rounds 1 to 9: ByteSub, ShiftRow and MixColumn are table lookups */
+  for(round = 1; round < 10; round++) {
+    for(i = 0; i < 4; i++) {
+      t[i] = te0[BYTE(s[i], 0)]
+          ^ ROTL8(te0[BYTE(s[(i + 1) & 3], 1)])
+          ^ ROTL16(te0[BYTE(s[(i + 2) & 3], 2)])
+          ^ ROTL24(te0[BYTE(s[(i + 3) & 3], 3)])
+          ^ round_keys[round][i];
+    }
+    memcpy(s, t, sizeof(s));
+  }
+
+  /* last round skips MixColumn */
+  for(i = 0; i < 4; i++) {
+    state[(i << 2)] = sbox[BYTE(s[i], 0)] ^ BYTE(round_keys[10][i], 0);
+    state[(i << 2) + 1] = sbox[BYTE(s[(i + 1) & 3], 1)] ^ BYTE(round_keys[10][i], 1);
+    state[(i << 2) + 2] = sbox[BYTE(s[(i + 2) & 3], 2)] ^ BYTE(round_keys[10][i], 2);
+    state[(i << 2) + 3] = sbox[BYTE(s[(i + 3) & 3], 3)] ^ BYTE(round_keys[10][i], 3);
+  }
+}
+#else /* AES_128_IMPL == AES_128_IMPL_TTABLE */
 static void
 encrypt(uint8_t *state)
 {
@@ -165,6 +356,7 @@ encrypt(uint8_t *state)
     }
   }
 }
+#endif /* AES_128_IMPL == AES_128_IMPL_TTABLE */
 /*---------------------------------------------------------------------------*/
 void
 aes_128_set_padded_key(uint8_t *key, uint8_t key_len)
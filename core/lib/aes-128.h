@@ -51,6 +51,43 @@
 #define AES_128            aes_128_driver
 #endif /* AES_128_CONF */
 
+/*
+ * Implementations of the software aes_128_driver, selected with
+ * AES_128_CONF_IMPL according to the flash budget of the platform:
+ * - COMPACT: the byte-wise reference code, only the 256-byte S-box.
+ * - XTIME: the same, with the doubling in GF(2^8) looked up in another
+ *   256-byte table. Suits 8- and 16-bit MCUs, where the byte-wise code
+ *   otherwise spends most of its time in MixColumn (msp430 without
+ *   hardware multiplier, AVR).
+ * - TTABLE: SubBytes, ShiftRows and MixColumn folded into one 1 KB table
+ *   of 32-bit words, a round is 16 lookups and a few rotations. Suits
+ *   32-bit MCUs and native.
+ * All keep the 176-byte key schedule in RAM.
+ */
+#define AES_128_IMPL_COMPACT 0
+#define AES_128_IMPL_XTIME   1
+#define AES_128_IMPL_TTABLE  2
+
+#ifdef AES_128_CONF_IMPL
+#define AES_128_IMPL       AES_128_CONF_IMPL
+#else /* AES_128_CONF_IMPL */
+#define AES_128_IMPL       AES_128_IMPL_COMPACT
+#endif /* AES_128_CONF_IMPL */
+
+/*
+ * Number of expanded keys the software aes_128_driver keeps. set_key()
+ * with a key that is still kept only selects its schedule, so code
+ * alternating between a few keys (e.g. TSCH with its EB and data keys)
+ * does not expand them again for each frame. Each additional key takes
+ * 176 bytes of RAM, and the keys are replaced in the order they were
+ * expanded.
+ */
+#ifdef AES_128_CONF_KEY_CACHE
+#define AES_128_KEY_CACHE  AES_128_CONF_KEY_CACHE
+#else /* AES_128_CONF_KEY_CACHE */
+#define AES_128_KEY_CACHE  1
+#endif /* AES_128_CONF_KEY_CACHE */
+
 /**
  * Structure of AES drivers.
  */
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2016, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Queue of asynchronous CCM* jobs.
+ */
+
+#include "lib/ccm-star-queue.h"
+#include "lib/list.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+LIST(jobs);
+/* Is the job at the head of the list running on the crypto engine? */
+static uint8_t engine_busy;
+
+PROCESS(ccm_star_queue_process, "CCM* queue");
+/*---------------------------------------------------------------------------*/
+static void
+start_next(void)
+{
+  struct ccm_star_job *job;
+
+  job = list_head(jobs);
+  if(job == NULL) {
+    return;
+  }
+  if(job->key != NULL) {
+    CCM_STAR.set_key(job->key);
+  }
+  if(CCM_STAR.aead_async != NULL && CCM_STAR.aead_async(job)) {
+    engine_busy = 1;
+    return;
+  }
+  /* Run it from the queue process */
+  process_poll(&ccm_star_queue_process);
+}
+/*---------------------------------------------------------------------------*/
+void
+ccm_star_queue_submit(struct ccm_star_job *job)
+{
+  if(!process_is_running(&ccm_star_queue_process)) {
+    process_start(&ccm_star_queue_process, NULL);
+  }
+  list_add(jobs, job);
+  if(list_head(jobs) == job) {
+    start_next();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+ccm_star_queue_done(struct ccm_star_job *job)
+{
+  list_remove(jobs, job);
+  engine_busy = 0;
+  job->callback(job);
+  start_next();
+}
+/*---------------------------------------------------------------------------*/
+int
+ccm_star_queue_length(void)
+{
+  return list_length(jobs);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ccm_star_queue_process, ev, data)
+{
+  struct ccm_star_job *job;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    job = list_head(jobs);
+    if(job != NULL && !engine_busy) {
+      CCM_STAR.aead(job->nonce,
+                    job->m, job->m_len,
+                    job->a, job->a_len,
+                    job->result, job->mic_len,
+                    job->forward);
+      ccm_star_queue_done(job);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
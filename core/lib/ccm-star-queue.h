@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2016, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Queue of asynchronous CCM* jobs.
+ *
+ *         Jobs are run one at a time, in submission order. With a driver
+ *         that implements aead_async(), a job runs on the crypto engine
+ *         while the CPU does other work. Otherwise, each job is run
+ *         synchronously from the queue process, so that the caller and
+ *         other processes (e.g. the radio driver) are not held up.
+ */
+
+#ifndef CCM_STAR_QUEUE_H_
+#define CCM_STAR_QUEUE_H_
+
+#include "lib/ccm-star.h"
+
+/**
+ * \brief Queues a job. The buffers of the job must stay valid until its
+ *        callback is called
+ */
+void ccm_star_queue_submit(struct ccm_star_job *job);
+
+/**
+ * \brief Called by aead_async() drivers, from process context, when the
+ *        job they started is done
+ */
+void ccm_star_queue_done(struct ccm_star_job *job);
+
+/**
+ * \brief Returns the number of queued jobs, including the running one
+ */
+int ccm_star_queue_length(void);
+
+#endif /* CCM_STAR_QUEUE_H_ */
@@ -50,6 +50,28 @@
 
 #define CCM_STAR_NONCE_LENGTH 13
 
+/**
+ * An asynchronous CCM* operation, see lib/ccm-star-queue.h. The
+ * operation is done in place, on buffers owned by the submitter until
+ * the callback is called.
+ */
+struct ccm_star_job {
+  struct ccm_star_job *next;
+  /** Key to load before running the job, NULL to keep the current key */
+  const uint8_t *key;
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t *m;
+  uint8_t m_len;
+  const uint8_t *a;
+  uint8_t a_len;
+  uint8_t *result;
+  uint8_t mic_len;
+  uint8_t forward;
+  /** Called from process context when the job is done */
+  void (* callback)(struct ccm_star_job *job);
+  void *ptr;
+};
+
 /**
  * Structure of CCM* drivers.
  */
@@ -75,6 +97,17 @@ struct ccm_star_driver {
       const uint8_t* a, uint8_t a_len,
       uint8_t *result, uint8_t mic_len,
       int forward);
+
+  /**
+   * \brief         Starts a job on a crypto engine, without waiting for it
+   *                to complete. Optional, NULL when the driver only works
+   *                synchronously.
+   * \param job     The job to start. The driver calls
+   *                ccm_star_queue_done(job) from process context once done.
+   * \return        1 if the job was started, 0 otherwise, in which case
+   *                the job is run through aead().
+   */
+  int (* aead_async)(struct ccm_star_job *job);
 };
 
 extern const struct ccm_star_driver CCM_STAR;
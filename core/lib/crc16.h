@@ -55,6 +55,36 @@
 #ifndef CRC16_H_
 #define CRC16_H_
 
+#include "contiki-conf.h"
+
+/*
+ * CRC16_CONF_TABLE selects how crc16_add() and crc16_data() compute
+ * the checksum. With 0 (the default), shifts and XORs are used and no
+ * table is needed. With 16, a 32-byte table is used, one lookup per
+ * 4 bits. With 256, a 512-byte table is used, one lookup per byte,
+ * which is the fastest for whole images such as Deluge or Coffee
+ * files. The tables are const; on Harvard CPUs such as the AVR they
+ * take RAM as well.
+ */
+#ifdef CRC16_CONF_TABLE
+#define CRC16_TABLE CRC16_CONF_TABLE
+#else /* CRC16_CONF_TABLE */
+#define CRC16_TABLE 0
+#endif /* CRC16_CONF_TABLE */
+
+/*
+ * With CRC16_CONF_ARCH, crc16_data() is not compiled in, and the CPU
+ * or platform provides it instead, for instance with a CRC engine. It
+ * must give the same result as the crc16_add() loop: CRC-CCITT
+ * (polynomial 0x1021) processed LSB first, with acc as the initial
+ * value and no final XOR.
+ */
+#ifdef CRC16_CONF_ARCH
+#define CRC16_ARCH CRC16_CONF_ARCH
+#else /* CRC16_CONF_ARCH */
+#define CRC16_ARCH 0
+#endif /* CRC16_CONF_ARCH */
+
 /**
  * \brief      Update an accumulated CRC16 checksum with one byte.
  * \param b    The byte to be added to the checksum
@@ -65,10 +95,10 @@
  *             with one byte. It can be used as a running checksum, or
  *             to checksum an entire data block.
  *
- *             \note The algorithm used in this implementation is
- *             tailored for a running checksum and does not perform as
- *             well as a table-driven algorithm when checksumming an
- *             entire data block.
+ *             \note Unless CRC16_CONF_TABLE is set, the algorithm
+ *             used in this implementation is tailored for a running
+ *             checksum and does not perform as well as a table-driven
+ *             algorithm when checksumming an entire data block.
  *
  */
 unsigned short crc16_add(unsigned char b, unsigned short crc);
@@ -82,7 +112,8 @@ unsigned short crc16_add(unsigned char b, unsigned short crc);
  *
  *             This function calculates the CRC16 checksum of a data area.
  *
- *             \note The algorithm used in this implementation is
+ *             \note Unless CRC16_CONF_TABLE or CRC16_CONF_ARCH is
+ *             set, the algorithm used in this implementation is
  *             tailored for a running checksum and does not perform as
  *             well as a table-driven algorithm when checksumming an
  *             entire data block.
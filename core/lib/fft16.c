@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Fixed-point (Q15) radix-4 FFT with streaming front-end
+ */
+
+#include "lib/fft16.h"
+
+/*---------------------------------------------------------------------------*/
+/* sin(2 * pi * k / FFT16_MAX_N) in Q15, for k = 0 to FFT16_MAX_N / 4 */
+static const int16_t sin_tab[FFT16_MAX_N / 4 + 1] = {
+      0,   201,   402,   603,   804,  1005,  1206,  1407,
+   1608,  1809,  2009,  2210,  2411,  2611,  2811,  3012,
+   3212,  3412,  3612,  3812,  4011,  4211,  4410,  4609,
+   4808,  5007,  5205,  5404,  5602,  5800,  5998,  6195,
+   6393,  6590,  6787,  6983,  7180,  7376,  7571,  7767,
+   7962,  8157,  8351,  8546,  8740,  8933,  9127,  9319,
+   9512,  9704,  9896, 10088, 10279, 10469, 10660, 10850,
+  11039, 11228, 11417, 11605, 11793, 11980, 12167, 12354,
+  12540, 12725, 12910, 13095, 13279, 13463, 13646, 13828,
+  14010, 14192, 14373, 14553, 14733, 14912, 15091, 15269,
+  15447, 15624, 15800, 15976, 16151, 16326, 16500, 16673,
+  16846, 17018, 17190, 17361, 17531, 17700, 17869, 18037,
+  18205, 18372, 18538, 18703, 18868, 19032, 19195, 19358,
+  19520, 19681, 19841, 20001, 20160, 20318, 20475, 20632,
+  20788, 20943, 21097, 21251, 21403, 21555, 21706, 21856,
+  22006, 22154, 22302, 22449, 22595, 22740, 22884, 23028,
+  23170, 23312, 23453, 23593, 23732, 23870, 24008, 24144,
+  24279, 24414, 24548, 24680, 24812, 24943, 25073, 25202,
+  25330, 25457, 25583, 25708, 25833, 25956, 26078, 26199,
+  26320, 26439, 26557, 26674, 26791, 26906, 27020, 27133,
+  27246, 27357, 27467, 27576, 27684, 27791, 27897, 28002,
+  28106, 28209, 28311, 28411, 28511, 28610, 28707, 28803,
+  28899, 28993, 29086, 29178, 29269, 29359, 29448, 29535,
+  29622, 29707, 29792, 29875, 29957, 30038, 30118, 30196,
+  30274, 30350, 30425, 30499, 30572, 30644, 30715, 30784,
+  30853, 30920, 30986, 31050, 31114, 31177, 31238, 31298,
+  31357, 31415, 31471, 31527, 31581, 31634, 31686, 31737,
+  31786, 31834, 31881, 31927, 31972, 32015, 32058, 32099,
+  32138, 32177, 32214, 32251, 32286, 32319, 32352, 32383,
+  32413, 32442, 32470, 32496, 32522, 32546, 32568, 32590,
+  32610, 32629, 32647, 32664, 32679, 32693, 32706, 32718,
+  32729, 32738, 32746, 32753, 32758, 32762, 32766, 32767,
+  32767
+};
+/*---------------------------------------------------------------------------*/
+static int16_t
+sin_q15(uint16_t a)
+{
+  uint16_t r;
+
+  a &= FFT16_MAX_N - 1;
+  r = a & (FFT16_MAX_N / 4 - 1);
+  switch(a / (FFT16_MAX_N / 4)) {
+  case 0:
+    return sin_tab[r];
+  case 1:
+    return sin_tab[FFT16_MAX_N / 4 - r];
+  case 2:
+    return -sin_tab[r];
+  default:
+    return -sin_tab[FFT16_MAX_N / 4 - r];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int16_t
+cos_q15(uint16_t a)
+{
+  return sin_q15(a + FFT16_MAX_N / 4);
+}
+/*---------------------------------------------------------------------------*/
+/* exp(-2 * pi * i * a / FFT16_MAX_N) */
+static fft16_complex_t
+twiddle(uint16_t a)
+{
+  fft16_complex_t w;
+
+  w.re = cos_q15(a);
+  w.im = -sin_q15(a);
+  return w;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Butterfly operations. hadd() and hsub() give (a + b) / 2 and
+ * (a - b) / 2, hsax() gives (a - i * b) / 2 and hasx() (a + i * b) / 2.
+ * cmul() multiplies by a Q15 twiddle factor. All results are rounded
+ * towards minus infinity, as the SIMD instructions do.
+ */
+#if FFT16_DSP
+typedef union {
+  fft16_complex_t c;
+  uint32_t w;
+} packed_t;
+
+#define SIMD_OP(name, insn)                                           \
+  static inline fft16_complex_t                                       \
+  name(fft16_complex_t a, fft16_complex_t b)                          \
+  {                                                                   \
+    packed_t pa, pb, r;                                               \
+    pa.c = a;                                                         \
+    pb.c = b;                                                         \
+    __asm__(insn " %0, %1, %2" : "=r" (r.w) : "r" (pa.w), "r" (pb.w)); \
+    return r.c;                                                       \
+  }
+
+SIMD_OP(hadd, "shadd16")
+SIMD_OP(hsub, "shsub16")
+SIMD_OP(hsax, "shsax")
+SIMD_OP(hasx, "shasx")
+
+static inline fft16_complex_t
+cmul(fft16_complex_t x, fft16_complex_t w)
+{
+  packed_t px, pw;
+  int32_t re, im;
+
+  px.c = x;
+  pw.c = w;
+  __asm__("smusd %0, %1, %2" : "=r" (re) : "r" (px.w), "r" (pw.w));
+  __asm__("smuadx %0, %1, %2" : "=r" (im) : "r" (px.w), "r" (pw.w));
+  x.re = re >> 15;
+  x.im = im >> 15;
+  return x;
+}
+#else /* FFT16_DSP */
+static inline fft16_complex_t
+hadd(fft16_complex_t a, fft16_complex_t b)
+{
+  fft16_complex_t r;
+
+  r.re = ((int32_t)a.re + b.re) >> 1;
+  r.im = ((int32_t)a.im + b.im) >> 1;
+  return r;
+}
+
+static inline fft16_complex_t
+hsub(fft16_complex_t a, fft16_complex_t b)
+{
+  fft16_complex_t r;
+
+  r.re = ((int32_t)a.re - b.re) >> 1;
+  r.im = ((int32_t)a.im - b.im) >> 1;
+  return r;
+}
+
+static inline fft16_complex_t
+hsax(fft16_complex_t a, fft16_complex_t b)
+{
+  fft16_complex_t r;
+
+  r.re = ((int32_t)a.re + b.im) >> 1;
+  r.im = ((int32_t)a.im - b.re) >> 1;
+  return r;
+}
+
+static inline fft16_complex_t
+hasx(fft16_complex_t a, fft16_complex_t b)
+{
+  fft16_complex_t r;
+
+  r.re = ((int32_t)a.re - b.im) >> 1;
+  r.im = ((int32_t)a.im + b.re) >> 1;
+  return r;
+}
+
+static inline fft16_complex_t
+cmul(fft16_complex_t x, fft16_complex_t w)
+{
+  fft16_complex_t r;
+
+  r.re = ((int32_t)x.re * w.re - (int32_t)x.im * w.im) >> 15;
+  r.im = ((int32_t)x.re * w.im + (int32_t)x.im * w.re) >> 15;
+  return r;
+}
+#endif /* FFT16_DSP */
+/*---------------------------------------------------------------------------*/
+void
+fft16(fft16_complex_t x[], uint16_t n)
+{
+  fft16_complex_t x0, x1, x2, x3, s02, s13, d02, d13;
+  fft16_complex_t w1, w2, w3, t;
+  uint16_t l, q, j, b, k, step;
+
+  if(n < 4 || n > FFT16_MAX_N) {
+    return;
+  }
+
+  /* Radix-4 stages: each one does the work of two radix-2 stages */
+  for(l = n; l >= 4; l >>= 2) {
+    q = l >> 2;
+    step = FFT16_MAX_N / l;
+    for(j = 0; j < q; j++) {
+      w1 = twiddle(j * step);
+      w2 = twiddle(2 * j * step);
+      w3 = twiddle(3 * j * step);
+      for(b = j; b < n; b += l) {
+        x0 = x[b];
+        x1 = x[b + q];
+        x2 = x[b + 2 * q];
+        x3 = x[b + 3 * q];
+        s02 = hadd(x0, x2);
+        d02 = hsub(x0, x2);
+        s13 = hadd(x1, x3);
+        d13 = hsub(x1, x3);
+        x[b] = hadd(s02, s13);
+        x[b + q] = hsub(s02, s13);
+        x[b + 2 * q] = hsax(d02, d13);
+        x[b + 3 * q] = hasx(d02, d13);
+        if(j != 0) {
+          x[b + q] = cmul(x[b + q], w2);
+          x[b + 2 * q] = cmul(x[b + 2 * q], w1);
+          x[b + 3 * q] = cmul(x[b + 3 * q], w3);
+        }
+      }
+    }
+  }
+
+  /* A last radix-2 stage if n is not a power of four */
+  if(l == 2) {
+    for(b = 0; b < n; b += 2) {
+      x0 = x[b];
+      x[b] = hadd(x0, x[b + 1]);
+      x[b + 1] = hsub(x0, x[b + 1]);
+    }
+  }
+
+  /* Bit-reversed to natural order */
+  for(j = 0, k = 0; j < n; j++) {
+    if(j < k) {
+      t = x[j];
+      x[j] = x[k];
+      x[k] = t;
+    }
+    for(b = n >> 1; k & b; b >>= 1) {
+      k ^= b;
+    }
+    k |= b;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+fft16_power(const fft16_complex_t x[], uint16_t n, uint32_t power[])
+{
+  uint16_t i;
+
+  for(i = 0; i <= n / 2; i++) {
+    power[i] = (uint32_t)((int32_t)x[i].re * x[i].re) +
+      (uint32_t)((int32_t)x[i].im * x[i].im);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+fft16_bands(const uint32_t power[], uint16_t n,
+            uint32_t bands[], uint8_t nbands)
+{
+  uint16_t i, lo, hi;
+  uint8_t b;
+  uint32_t sum;
+
+  for(b = 0; b < nbands; b++) {
+    lo = 1 + (uint32_t)b * (n / 2) / nbands;
+    hi = 1 + (uint32_t)(b + 1) * (n / 2) / nbands;
+    sum = 0;
+    for(i = lo; i < hi; i++) {
+      sum += power[i];
+      if(sum < power[i]) {
+        sum = UINT32_MAX;
+        break;
+      }
+    }
+    bands[b] = sum;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+fft16_stream_init(struct fft16_stream *s, int16_t *ring,
+                  fft16_complex_t *frame, uint16_t n, uint16_t hop)
+{
+  uint16_t i;
+
+  s->ring = ring;
+  s->frame = frame;
+  s->n = n;
+  s->hop = hop;
+  s->head = 0;
+  s->need = n;
+  for(i = 0; i < n; i++) {
+    ring[i] = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+fft16_stream_add(struct fft16_stream *s, int16_t sample)
+{
+  uint16_t i, step;
+  int16_t window;
+
+  s->ring[s->head] = sample;
+  s->head = (s->head + 1) & (s->n - 1);
+  if(--s->need > 0) {
+    return 0;
+  }
+  s->need = s->hop;
+
+  /* Copy the last n samples, oldest first, through a Hann window */
+  step = FFT16_MAX_N / s->n;
+  for(i = 0; i < s->n; i++) {
+    window = (32767 - cos_q15(i * step)) >> 1;
+    s->frame[i].re = ((int32_t)s->ring[(s->head + i) & (s->n - 1)] *
+                      window) >> 15;
+    s->frame[i].im = 0;
+  }
+  fft16(s->frame, s->n);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Fixed-point (Q15) complex FFT, power spectrum and a streaming,
+ *         windowed front-end for sampled sensor data.
+ *
+ *         The FFT is a radix-4 (radix-2^2) decimation-in-frequency
+ *         transform, with one radix-2 stage when the size is not a
+ *         power of four. Every radix-2 step halves its results, so the
+ *         output is the DFT divided by n and can never overflow, as
+ *         long as the input samples have a magnitude of at most 32767.
+ *         Real-valued input always satisfies this.
+ *
+ *         With FFT16_CONF_DSP, the butterflies use the dual 16-bit SIMD
+ *         instructions of the Cortex-M4 (and M7) DSP extension. The
+ *         results are identical to those of the portable code.
+ */
+
+#ifndef FFT16_H_
+#define FFT16_H_
+
+#include "contiki-conf.h"
+
+#include <stdint.h>
+
+/*
+ * Use the Cortex-M4 DSP instructions. Only set this for CPUs that have
+ * the DSP extension (__ARM_FEATURE_DSP).
+ */
+#ifdef FFT16_CONF_DSP
+#define FFT16_DSP FFT16_CONF_DSP
+#else /* FFT16_CONF_DSP */
+#define FFT16_DSP 0
+#endif /* FFT16_CONF_DSP */
+
+/** The largest supported transform size */
+#define FFT16_MAX_N 1024
+
+/** A complex Q15 value, real part first */
+typedef struct {
+  int16_t re;
+  int16_t im;
+} fft16_complex_t;
+
+/**
+ * \brief      In-place forward FFT
+ * \param x    The n input values, replaced by the n output values
+ * \param n    The size, a power of two from 4 to FFT16_MAX_N
+ *
+ *             The output is in natural order and scaled by 1/n. For a
+ *             real input signal, bins 0 to n/2 hold the spectrum.
+ */
+void fft16(fft16_complex_t x[], uint16_t n);
+
+/**
+ * \brief       Power spectrum of a real input signal
+ * \param x     The output of fft16()
+ * \param n     The size of the transform
+ * \param power Receives the n/2 + 1 values re^2 + im^2 of bins 0 to n/2
+ */
+void fft16_power(const fft16_complex_t x[], uint16_t n, uint32_t power[]);
+
+/**
+ * \brief        Reduces a power spectrum to a few bands
+ * \param power  The output of fft16_power()
+ * \param n      The size of the transform
+ * \param bands  Receives the summed power of each band
+ * \param nbands The number of bands, at most n/2
+ *
+ *               Bins 1 to n/2 are split into nbands bands of equal
+ *               width; the DC bin is left out. Sums saturate.
+ */
+void fft16_bands(const uint32_t power[], uint16_t n,
+                 uint32_t bands[], uint8_t nbands);
+
+/**
+ * A stream of real samples, transformed in overlapping Hann-windowed
+ * frames of n samples, one every hop samples.
+ */
+struct fft16_stream {
+  int16_t *ring;          /**< The last n samples */
+  fft16_complex_t *frame; /**< The spectrum of the last frame */
+  uint16_t n;
+  uint16_t hop;
+  uint16_t head;          /**< Where the next sample goes in ring */
+  uint16_t need;          /**< Samples left until the next frame */
+};
+
+/**
+ * \brief       Sets up a stream
+ * \param s     The stream
+ * \param ring  Buffer for n samples
+ * \param frame Buffer for n complex values, receives each spectrum
+ * \param n     The frame size, a power of two from 4 to FFT16_MAX_N
+ * \param hop   Samples between the starts of two frames, from 1 to n.
+ *              For instance, n/2 gives a 50% overlap.
+ */
+void fft16_stream_init(struct fft16_stream *s, int16_t *ring,
+                       fft16_complex_t *frame, uint16_t n, uint16_t hop);
+
+/**
+ * \brief        Adds a sample to a stream
+ * \param s      The stream
+ * \param sample The sample, Q15
+ * \return       1 when a frame has been completed, 0 otherwise
+ *
+ *               When 1 is returned, the frame buffer holds the spectrum
+ *               of the last n samples and stays valid until the next
+ *               frame is completed. The transform runs in the caller's
+ *               context, so this must not be called from an interrupt.
+ */
+int fft16_stream_add(struct fft16_stream *s, int16_t sample);
+
+#endif /* FFT16_H_ */
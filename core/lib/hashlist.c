@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Hashed list library
+ */
+
+/**
+ * \addtogroup hashlist
+ * @{
+ */
+
+#include <stddef.h>
+#include "lib/hashlist.h"
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+bucket_of(struct hashlist *h, uint32_t hash)
+{
+  uint16_t b;
+
+  b = hash & h->mask;
+  if(b < h->split) {
+    b = hash & ((h->mask << 1) | 1);
+  }
+  return b;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+buckets_in_use(struct hashlist *h)
+{
+  return h->mask + 1 + h->split;
+}
+/*---------------------------------------------------------------------------*/
+/* Split the next bucket, moving the elements that now belong in the
+   new bucket. */
+static void
+split(struct hashlist *h)
+{
+  list_t from, to;
+  void *item, *next;
+  uint16_t b;
+
+  b = h->split;
+  from = (list_t)&h->buckets[b];
+  to = (list_t)&h->buckets[b + h->mask + 1];
+
+  if(++h->split == h->mask + 1) {
+    h->mask = (h->mask << 1) | 1;
+    h->split = 0;
+  }
+
+  for(item = list_head(from); item != NULL; item = next) {
+    next = list_item_next(item);
+    if(bucket_of(h, h->hash(item)) != b) {
+      list_remove(from, item);
+      list_add(to, item);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+hashlist_init(struct hashlist *h)
+{
+  int i;
+
+  for(i = 0; i < h->num; ++i) {
+    h->buckets[i] = NULL;
+  }
+  h->mask = h->growing ? 0 : h->num - 1;
+  h->split = 0;
+  h->count = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+hashlist_add(struct hashlist *h, void *item)
+{
+  list_t bucket;
+  void *i;
+
+  bucket = (list_t)&h->buckets[bucket_of(h, h->hash(item))];
+  for(i = list_head(bucket); i != NULL && i != item; i = list_item_next(i));
+  if(i == NULL) {
+    h->count++;
+  }
+  list_add(bucket, item);
+
+  if(h->growing && buckets_in_use(h) < h->num &&
+     h->count > buckets_in_use(h) * HASHLIST_LOAD) {
+    split(h);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+hashlist_remove(struct hashlist *h, void *item)
+{
+  list_t bucket;
+  void *i;
+
+  bucket = (list_t)&h->buckets[bucket_of(h, h->hash(item))];
+  for(i = list_head(bucket); i != NULL && i != item; i = list_item_next(i));
+  if(i != NULL) {
+    list_remove(bucket, item);
+    h->count--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void *
+hashlist_head(struct hashlist *h, uint32_t hash)
+{
+  return h->buckets[bucket_of(h, hash)];
+}
+/*---------------------------------------------------------------------------*/
+static void *
+first_from(struct hashlist *h, uint16_t b)
+{
+  for(; b < buckets_in_use(h); ++b) {
+    if(h->buckets[b] != NULL) {
+      return h->buckets[b];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void *
+hashlist_first(struct hashlist *h)
+{
+  return first_from(h, 0);
+}
+/*---------------------------------------------------------------------------*/
+void *
+hashlist_next(struct hashlist *h, void *item)
+{
+  void *next;
+
+  next = list_item_next(item);
+  if(next != NULL) {
+    return next;
+  }
+  return first_from(h, bucket_of(h, h->hash(item)) + 1);
+}
+/*---------------------------------------------------------------------------*/
+int
+hashlist_length(struct hashlist *h)
+{
+  return h->count;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+hashlist_hash(const void *key, int len)
+{
+  const uint8_t *p = key;
+  uint32_t hash = 2166136261UL;
+
+  while(len-- > 0) {
+    hash = (hash ^ *p++) * 16777619UL;
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
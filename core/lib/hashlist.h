@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the hashed list library
+ */
+
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup hashlist Hashed list library
+ * @{
+ *
+ * A hashed list is a table of linked lists, the buckets, that holds
+ * the same kind of elements as the \ref list "linked list library":
+ * structures whose first element is a pointer, which is used to link
+ * the elements of a bucket. An element is put in the bucket that is
+ * selected by its hash value, so that looking up an element only
+ * walks one bucket instead of the whole table.
+ *
+ * Hashed lists are declared with the HASHLIST() macro, with a bucket
+ * count that is a power of two and a function that gives the hash
+ * value of an element. To look an element up, the hash value of the
+ * key is passed to hashlist_head(), and the bucket is walked with
+ * list_item_next(), comparing keys, since elements with other hash
+ * values can be in the same bucket.
+ *
+ * A hashed list that is declared with HASHLIST_GROWING() starts with
+ * one bucket in use and splits one bucket at a time, as elements are
+ * added, until all its buckets are in use, so that a table that is
+ * mostly small is still cheap to iterate over.
+ */
+
+#ifndef HASHLIST_H_
+#define HASHLIST_H_
+
+#include "contiki-conf.h"
+#include "lib/list.h"
+
+/**
+ * The average number of elements per bucket above which a growing
+ * hashed list splits a bucket.
+ */
+#ifdef HASHLIST_CONF_LOAD
+#define HASHLIST_LOAD HASHLIST_CONF_LOAD
+#else /* HASHLIST_CONF_LOAD */
+#define HASHLIST_LOAD 2
+#endif /* HASHLIST_CONF_LOAD */
+
+struct hashlist {
+  void **buckets;
+  uint32_t (*hash)(const void *item);
+  uint16_t num;
+  uint8_t growing;
+  /* The buckets in use are selected with mask, or with the next
+     larger mask for the buckets below split. */
+  uint16_t mask;
+  uint16_t split;
+  uint16_t count;
+};
+
+/**
+ * Declare a hashed list.
+ *
+ * \param name The name of the hashed list.
+ * \param num  The number of buckets, which must be a power of two.
+ * \param hash A function that returns the hash value of an element.
+ */
+#define HASHLIST(name, num, hash) \
+         static void *LIST_CONCAT(name,_buckets)[num]; \
+         static struct hashlist name = { LIST_CONCAT(name,_buckets), \
+                                         hash, num, 0 }
+
+/**
+ * Declare a hashed list that uses more buckets as it grows.
+ *
+ * \param name The name of the hashed list.
+ * \param num  The largest number of buckets, which must be a power of two.
+ * \param hash A function that returns the hash value of an element.
+ */
+#define HASHLIST_GROWING(name, num, hash) \
+         static void *LIST_CONCAT(name,_buckets)[num]; \
+         static struct hashlist name = { LIST_CONCAT(name,_buckets), \
+                                         hash, num, 1 }
+
+/**
+ * Initialize a hashed list, which will be empty.
+ */
+void   hashlist_init(struct hashlist *h);
+
+/**
+ * Add an element to a hashed list.
+ *
+ * The hash value of the element must not change while it is in the
+ * hashed list.
+ */
+void   hashlist_add(struct hashlist *h, void *item);
+
+/**
+ * Remove an element from a hashed list.
+ */
+void   hashlist_remove(struct hashlist *h, void *item);
+
+/**
+ * Get the first element of the bucket for a hash value.
+ *
+ * \return The first element, or NULL. The following elements of the
+ *         bucket are found with list_item_next().
+ */
+void * hashlist_head(struct hashlist *h, uint32_t hash);
+
+/**
+ * Get the first element of a hashed list, in no particular order.
+ */
+void * hashlist_first(struct hashlist *h);
+
+/**
+ * Get the element after an element, as returned by hashlist_first().
+ */
+void * hashlist_next(struct hashlist *h, void *item);
+
+/**
+ * Get the number of elements in a hashed list.
+ */
+int    hashlist_length(struct hashlist *h);
+
+/**
+ * Compute a hash value of a key, with the 32-bit FNV-1a hash.
+ */
+uint32_t hashlist_hash(const void *key, int len);
+
+#endif /* HASHLIST_H_ */
+
+/** @} */
+/** @} */
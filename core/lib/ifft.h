@@ -51,7 +51,8 @@
    16 bit values). The reason for the int16_t array is for keeping some
    'room' for the calculations. It is also designed for doing fairly small
    FFT:s since to large sample arrays might cause it to overflow during
-   calculations.
+   calculations. lib/fft16.h has a Q15 FFT that does not have these
+   limitations.
 */
 void ifft(int16_t xre[], int16_t xim[], uint16_t n);
 
@@ -47,12 +47,141 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+/*---------------------------------------------------------------------------*/
+#if MEMB_FREELIST
+/* A free block ends with a pointer to the next free block. The end
+   is used rather than the start, as the start usually holds the list
+   pointer that code walking a list may still read from a block it
+   just freed. The pointer is copied with memcpy(), as the blocks need
+   not be aligned for a pointer. */
+#define HAS_FREELIST(m) ((m)->size >= sizeof(void *))
+#define LINK(m, block) ((char *)(block) + (m)->size - sizeof(void *))
+
+static void
+push_free(struct memb *m, void *block)
+{
+  memcpy(LINK(m, block), &m->free, sizeof(m->free));
+  m->free = block;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+pop_free(struct memb *m)
+{
+  void *block;
+
+  block = m->free;
+  if(block != NULL) {
+    memcpy(&m->free, LINK(m, block), sizeof(m->free));
+    memset(LINK(m, block), 0, sizeof(m->free));
+  }
+  return block;
+}
+/*---------------------------------------------------------------------------*/
+static void
+build_freelist(struct memb *m)
+{
+  int i;
+
+  m->free = NULL;
+  if(HAS_FREELIST(m)) {
+    /* Push the blocks in reverse order, so that they are allocated in
+       the same order as without the free list. */
+    for(i = m->num - 1; i >= 0; --i) {
+      if(m->count[i] == 0) {
+        push_free(m, (char *)m->mem + (i * m->size));
+      }
+    }
+  }
+}
+#endif /* MEMB_FREELIST */
+/*---------------------------------------------------------------------------*/
+#if MEMB_STATS
+static void
+count_alloc(struct memb *m)
+{
+  ++m->used;
+  if(m->used > m->max_used) {
+    m->max_used = m->used;
+  }
+}
+#endif /* MEMB_STATS */
+/*---------------------------------------------------------------------------*/
+#if MEMB_REGISTRY
+static struct memb *registry;
+
+void
+memb_register(struct memb *m)
+{
+  struct memb *r;
+
+  for(r = registry; r != NULL; r = r->next) {
+    if(r == m) {
+      return;
+    }
+  }
+  m->next = registry;
+  registry = m;
+}
+/*---------------------------------------------------------------------------*/
+struct memb *
+memb_registry(void)
+{
+  return registry;
+}
+/*---------------------------------------------------------------------------*/
+int
+memb_failures(struct memb *m)
+{
+  return m->failures;
+}
+#endif /* MEMB_REGISTRY */
+/*---------------------------------------------------------------------------*/
+#if MEMB_FAILURE_TRACE
+static struct memb_failure failures[MEMB_FAILURE_TRACE];
+static uint8_t failures_next, failures_num;
+
+void
+memb_trace_failure(const char *pool, const void *caller)
+{
+  failures[failures_next].pool = pool;
+  failures[failures_next].caller = caller;
+  failures[failures_next].time = clock_time();
+  failures_next = (failures_next + 1) % MEMB_FAILURE_TRACE;
+  if(failures_num < MEMB_FAILURE_TRACE) {
+    ++failures_num;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+memb_failure(int i, struct memb_failure *f)
+{
+  if(i < 0 || i >= failures_num) {
+    return 0;
+  }
+  *f = failures[(failures_next + MEMB_FAILURE_TRACE - 1 - i) %
+                MEMB_FAILURE_TRACE];
+  return 1;
+}
+#define TRACE_FAILURE(m) memb_trace_failure((m)->name, MEMB_CALLER())
+#else /* MEMB_FAILURE_TRACE */
+#define TRACE_FAILURE(m)
+#endif /* MEMB_FAILURE_TRACE */
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+#if MEMB_STATS
+  m->used = m->max_used = 0;
+#endif /* MEMB_STATS */
+#if MEMB_FREELIST
+  build_freelist(m);
+#endif /* MEMB_FREELIST */
+#if MEMB_REGISTRY
+  m->failures = 0;
+  memb_register(m);
+#endif /* MEMB_REGISTRY */
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -60,21 +189,81 @@ memb_alloc(struct memb *m)
 {
   int i;
 
+#if MEMB_FREELIST
+  if(HAS_FREELIST(m)) {
+    void *block;
+
+    if(m->free == NULL && m->used == 0) {
+      /* The pool is in zeroed memory but memb_init() has not been
+         called. */
+      build_freelist(m);
+    }
+    block = pop_free(m);
+    if(block != NULL) {
+      i = ((char *)block - (char *)m->mem) / m->size;
+      ++(m->count[i]);
+      count_alloc(m);
+    } else {
+#if MEMB_REGISTRY
+      ++m->failures;
+#endif /* MEMB_REGISTRY */
+      TRACE_FAILURE(m);
+    }
+    return block;
+  }
+#endif /* MEMB_FREELIST */
+
   for(i = 0; i < m->num; ++i) {
     if(m->count[i] == 0) {
       /* If this block was unused, we increase the reference count to
 	 indicate that it now is used and return a pointer to the
 	 memory block. */
       ++(m->count[i]);
+#if MEMB_STATS
+      count_alloc(m);
+#endif /* MEMB_STATS */
       return (void *)((char *)m->mem + (i * m->size));
     }
   }
 
   /* No free block was found, so we return NULL to indicate failure to
      allocate block. */
+#if MEMB_REGISTRY
+  ++m->failures;
+#endif /* MEMB_REGISTRY */
+  TRACE_FAILURE(m);
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+#if MEMB_FREELIST
+char
+memb_free(struct memb *m, void *ptr)
+{
+  int i;
+  unsigned offset;
+
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    return -1;
+  }
+
+  i = offset / m->size;
+  if(m->count[i] > 0) {
+    /* Make sure that we don't deallocate free memory. */
+    --(m->count[i]);
+    if(m->count[i] == 0) {
+      --m->used;
+      if(HAS_FREELIST(m)) {
+        push_free(m, ptr);
+      }
+    }
+  }
+  return m->count[i];
+}
+#else /* MEMB_FREELIST */
 char
 memb_free(struct memb *m, void *ptr)
 {
@@ -92,6 +281,11 @@ memb_free(struct memb *m, void *ptr)
       if(m->count[i] > 0) {
 	/* Make sure that we don't deallocate free memory. */
 	--(m->count[i]);
+#if MEMB_STATS
+	if(m->count[i] == 0) {
+	  --m->used;
+	}
+#endif /* MEMB_STATS */
       }
       return m->count[i];
     }
@@ -99,6 +293,7 @@ memb_free(struct memb *m, void *ptr)
   }
   return -1;
 }
+#endif /* MEMB_FREELIST */
 /*---------------------------------------------------------------------------*/
 int
 memb_inmemb(struct memb *m, void *ptr)
@@ -110,6 +305,9 @@ memb_inmemb(struct memb *m, void *ptr)
 int
 memb_numfree(struct memb *m)
 {
+#if MEMB_FREELIST
+  return m->num - m->used;
+#else /* MEMB_FREELIST */
   int i;
   int num_free = 0;
 
@@ -120,5 +318,20 @@ memb_numfree(struct memb *m)
   }
 
   return num_free;
+#endif /* MEMB_FREELIST */
+}
+/*---------------------------------------------------------------------------*/
+#if MEMB_STATS
+int
+memb_numused(struct memb *m)
+{
+  return m->used;
+}
+/*---------------------------------------------------------------------------*/
+int
+memb_highwater(struct memb *m)
+{
+  return m->max_used;
 }
+#endif /* MEMB_STATS */
 /** @} */
@@ -65,6 +65,59 @@
 
 #include "sys/cc.h"
 
+/*
+ * With MEMB_CONF_FREELIST, the free blocks of a memory block are kept
+ * in a list that is threaded through the blocks themselves, so that
+ * memb_alloc(), memb_free() and memb_numfree() take constant time
+ * instead of scanning the pool. The pools also count their used
+ * blocks and the highest number of blocks that have been in use,
+ * see memb_numused() and memb_highwater(). Pools with blocks smaller
+ * than a pointer fall back to scanning.
+ */
+#ifdef MEMB_CONF_FREELIST
+#define MEMB_FREELIST MEMB_CONF_FREELIST
+#else /* MEMB_CONF_FREELIST */
+#define MEMB_FREELIST 0
+#endif /* MEMB_CONF_FREELIST */
+
+/*
+ * With MEMB_CONF_REGISTRY, every memory block that is initialized with
+ * memb_init() is added to a registry, together with its name from
+ * MEMB(). The pools count their used blocks, the highest number of
+ * used blocks and the allocations that failed, so that the memory
+ * use of the whole system can be inspected at run-time, see
+ * memb_registry(). The managed memory of mmem is registered as a
+ * memory block of one-byte blocks named "mmem"; it must not be
+ * passed to memb_alloc() or memb_free().
+ */
+#ifdef MEMB_CONF_REGISTRY
+#define MEMB_REGISTRY MEMB_CONF_REGISTRY
+#else /* MEMB_CONF_REGISTRY */
+#define MEMB_REGISTRY 0
+#endif /* MEMB_CONF_REGISTRY */
+
+/*
+ * With MEMB_CONF_FAILURE_TRACE set to a number of records, every
+ * allocation from a memory block, from mmem or of a queuebuf that
+ * fails is recorded in a ring of that many records, with the name of
+ * the pool, the address of the code that asked for the memory and the
+ * time, see memb_failure().
+ */
+#ifdef MEMB_CONF_FAILURE_TRACE
+#define MEMB_FAILURE_TRACE MEMB_CONF_FAILURE_TRACE
+#else /* MEMB_CONF_FAILURE_TRACE */
+#define MEMB_FAILURE_TRACE 0
+#endif /* MEMB_CONF_FAILURE_TRACE */
+
+#define MEMB_STATS (MEMB_FREELIST || MEMB_REGISTRY)
+#define MEMB_NAMES (MEMB_REGISTRY || MEMB_FAILURE_TRACE)
+
+#if MEMB_NAMES
+#define MEMB_NAME(name) , #name
+#else /* MEMB_NAMES */
+#define MEMB_NAME(name)
+#endif /* MEMB_NAMES */
+
 /**
  * Declare a memory block.
  *
@@ -91,13 +144,28 @@ MEMB(connections, struct connection, 16);
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem) \
+                                          MEMB_NAME(name)}
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_NAMES
+  const char *name;
+#endif /* MEMB_NAMES */
+#if MEMB_REGISTRY
+  struct memb *next;
+  unsigned short failures;
+#endif /* MEMB_REGISTRY */
+#if MEMB_FREELIST
+  void *free;
+#endif /* MEMB_FREELIST */
+#if MEMB_STATS
+  unsigned short used;
+  unsigned short max_used;
+#endif /* MEMB_STATS */
 };
 
 /**
@@ -132,6 +200,87 @@ int memb_inmemb(struct memb *m, void *ptr);
 
 int  memb_numfree(struct memb *m);
 
+#if MEMB_STATS
+/**
+ * Get the number of blocks that are in use.
+ *
+ * \param m A memory block previously declared with MEMB().
+ */
+int memb_numused(struct memb *m);
+
+/**
+ * Get the highest number of blocks that have been in use at the same
+ * time since the memory block was initialized.
+ *
+ * \param m A memory block previously declared with MEMB().
+ */
+int memb_highwater(struct memb *m);
+#endif /* MEMB_STATS */
+
+#if MEMB_REGISTRY
+/**
+ * Add a memory block to the registry. This is done by memb_init(),
+ * and only needs to be called for memory blocks that are used
+ * without being initialized. Adding a memory block twice has no
+ * effect.
+ *
+ * \param m A memory block previously declared with MEMB().
+ */
+void memb_register(struct memb *m);
+
+/**
+ * Get the first memory block in the registry. The rest of the
+ * registry is reached through the next field of each memory block.
+ *
+ * \return The first registered memory block, or NULL if there is none.
+ */
+struct memb *memb_registry(void);
+
+/**
+ * Get the number of allocations from a memory block that have failed
+ * because the memory block was full.
+ *
+ * \param m A memory block previously declared with MEMB().
+ */
+int memb_failures(struct memb *m);
+#endif /* MEMB_REGISTRY */
+
+#if MEMB_FAILURE_TRACE
+#include "sys/clock.h"
+
+struct memb_failure {
+  const char *pool;
+  const void *caller;
+  clock_time_t time;
+};
+
+#ifdef __GNUC__
+#define MEMB_CALLER() __builtin_return_address(0)
+#else /* __GNUC__ */
+#define MEMB_CALLER() NULL
+#endif /* __GNUC__ */
+
+/**
+ * Record a failed allocation. This is done by memb_alloc(),
+ * mmem_alloc() and queuebuf_new_from_packetbuf(), and can be done by
+ * other allocators too.
+ *
+ * \param pool The name of the pool.
+ * \param caller The address of the code that asked for the memory,
+ * usually MEMB_CALLER() in the allocation function.
+ */
+void memb_trace_failure(const char *pool, const void *caller);
+
+/**
+ * Get a recorded failed allocation.
+ *
+ * \param i The number of the failure, 0 being the most recent one.
+ * \param f Filled in with the failure.
+ * \return Zero if fewer than i + 1 failures are recorded.
+ */
+int memb_failure(int i, struct memb_failure *f);
+#endif /* MEMB_FAILURE_TRACE */
+
 /** @} */
 /** @} */
 
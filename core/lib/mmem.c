@@ -46,6 +46,7 @@
 
 #include "mmem.h"
 #include "list.h"
+#include "lib/memb.h"
 #include "contiki-conf.h"
 #include <string.h>
 
@@ -55,9 +56,54 @@
 #define MMEM_SIZE 4096
 #endif
 
+#ifdef MMEM_CONF_COMPACT_STEP
+#define MMEM_COMPACT_STEP MMEM_CONF_COMPACT_STEP
+#else
+#define MMEM_COMPACT_STEP 256
+#endif
+
 LIST(mmemlist);
 unsigned int avail_memory;
 static char memory[MMEM_SIZE];
+static unsigned long bytes_moved;
+
+#if MEMB_REGISTRY
+/* The managed memory is registered as a memory block with one-byte
+   blocks, so that it is reported together with the memb pools. It
+   has no reference counts and is never allocated from as a memb. */
+static struct memb mmem_pool = {1, MMEM_SIZE, NULL, memory, "mmem"};
+
+static void
+count_usage(void)
+{
+  mmem_pool.used = MMEM_SIZE - avail_memory;
+  if(mmem_pool.used > mmem_pool.max_used) {
+    mmem_pool.max_used = mmem_pool.used;
+  }
+}
+#define COUNT_USAGE() count_usage()
+#define COUNT_FAILURE() (++mmem_pool.failures)
+#else /* MEMB_REGISTRY */
+#define COUNT_USAGE()
+#define COUNT_FAILURE()
+#endif /* MEMB_REGISTRY */
+
+#if MEMB_FAILURE_TRACE
+#define TRACE_FAILURE() memb_trace_failure("mmem", MEMB_CALLER())
+#else /* MEMB_FAILURE_TRACE */
+#define TRACE_FAILURE()
+#endif /* MEMB_FAILURE_TRACE */
+
+#if MMEM_DEFERRED_COMPACTION
+#include "sys/process.h"
+
+/* The memory is compacted when nothing else has to run. */
+PROCESS_WITH_PRIORITY(mmem_compact_process, "Memory compaction",
+                      PROCESS_PRIORITY_LOW);
+
+/* The blocks are kept in the list in address order. */
+#define BLOCK_END(m) ((char *)(m)->ptr + (m)->size)
+#endif /* MMEM_DEFERRED_COMPACTION */
 
 /*---------------------------------------------------------------------------*/
 /**
@@ -79,11 +125,57 @@ static char memory[MMEM_SIZE];
  *             allocated memory.
  *
  */
+#if MMEM_DEFERRED_COMPACTION
+int
+mmem_alloc(struct mmem *m, unsigned int size)
+{
+  struct mmem *n, *prev;
+  char *start;
+
+  if(avail_memory < size) {
+    COUNT_FAILURE();
+    TRACE_FAILURE();
+    return 0;
+  }
+
+  /* Use the first hole, or the end of the memory, that is large
+     enough. */
+  prev = NULL;
+  start = memory;
+  for(n = list_head(mmemlist); n != NULL; n = n->next) {
+    if((unsigned int)((char *)n->ptr - start) >= size) {
+      break;
+    }
+    prev = n;
+    start = BLOCK_END(n);
+  }
+
+  if(n == NULL && (unsigned int)(&memory[MMEM_SIZE] - start) < size) {
+    /* The free memory is fragmented. Move it all to the end. */
+    mmem_compact(MMEM_SIZE);
+    prev = list_tail(mmemlist);
+    start = prev != NULL ? BLOCK_END(prev) : memory;
+  }
+
+  if(prev == NULL) {
+    list_push(mmemlist, m);
+  } else {
+    list_insert(mmemlist, prev, m);
+  }
+  m->ptr = start;
+  m->size = size;
+  avail_memory -= size;
+  COUNT_USAGE();
+  return 1;
+}
+#else /* MMEM_DEFERRED_COMPACTION */
 int
 mmem_alloc(struct mmem *m, unsigned int size)
 {
   /* Check if we have enough memory left for this allocation. */
   if(avail_memory < size) {
+    COUNT_FAILURE();
+    TRACE_FAILURE();
     return 0;
   }
 
@@ -100,11 +192,13 @@ mmem_alloc(struct mmem *m, unsigned int size)
 
   /* Decrease the amount of available memory. */
   avail_memory -= size;
+  COUNT_USAGE();
 
   /* Return non-zero to indicate that we were able to allocate
      memory. */
   return 1;
 }
+#endif /* MMEM_DEFERRED_COMPACTION */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Deallocate a managed memory block
@@ -115,12 +209,24 @@ mmem_alloc(struct mmem *m, unsigned int size)
  *             previously has been allocated with mmem_alloc().
  *
  */
+#if MMEM_DEFERRED_COMPACTION
+void
+mmem_free(struct mmem *m)
+{
+  /* Leave a hole, the compaction process fills it later. */
+  avail_memory += m->size;
+  COUNT_USAGE();
+  list_remove(mmemlist, m);
+  process_poll(&mmem_compact_process);
+}
+#else /* MMEM_DEFERRED_COMPACTION */
 void
 mmem_free(struct mmem *m)
 {
   struct mmem *n;
 
   if(m->next != NULL) {
+    bytes_moved += &memory[MMEM_SIZE - avail_memory] - (char *)m->next->ptr;
     /* Compact the memory after the allocation that is to be removed
        by moving it downwards. */
     memmove(m->ptr, m->next->ptr,
@@ -134,10 +240,160 @@ mmem_free(struct mmem *m)
   }
 
   avail_memory += m->size;
+  COUNT_USAGE();
 
   /* Remove the memory block from the list. */
   list_remove(mmemlist, m);
 }
+#endif /* MMEM_DEFERRED_COMPACTION */
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Shrink a managed memory block
+ * \param m    A pointer to the managed memory block
+ * \param size The new size of the block, no larger than the current one
+ *
+ *             This function gives the end of a block back to the
+ *             managed memory, the start of the block keeps its
+ *             content. Like mmem_free(), it may move the blocks that
+ *             were allocated after this one.
+ *
+ */
+void
+mmem_shrink(struct mmem *m, unsigned int size)
+{
+  unsigned int delta;
+#if !MMEM_DEFERRED_COMPACTION
+  struct mmem *n;
+#endif /* !MMEM_DEFERRED_COMPACTION */
+
+  if(size >= m->size) {
+    return;
+  }
+  delta = m->size - size;
+
+#if MMEM_DEFERRED_COMPACTION
+  /* Leave a hole after the block. */
+  process_poll(&mmem_compact_process);
+#else /* MMEM_DEFERRED_COMPACTION */
+  if(m->next != NULL) {
+    bytes_moved += &memory[MMEM_SIZE - avail_memory] - (char *)m->next->ptr;
+    memmove((char *)m->ptr + size, m->next->ptr,
+            &memory[MMEM_SIZE - avail_memory] - (char *)m->next->ptr);
+    for(n = m->next; n != NULL; n = n->next) {
+      n->ptr = (void *)((char *)n->ptr - delta);
+    }
+  }
+#endif /* MMEM_DEFERRED_COMPACTION */
+
+  m->size = size;
+  avail_memory += delta;
+  COUNT_USAGE();
+}
+/*---------------------------------------------------------------------------*/
+#if MMEM_DEFERRED_COMPACTION
+/**
+ * \brief      Compact the managed memory
+ * \param max_bytes The largest number of bytes to move
+ * \return     Non-zero if there is more to compact, zero if the free
+ *             memory is one block at the end
+ *
+ *             This function moves allocated blocks downwards to fill
+ *             the holes left by mmem_free(), until about \e max_bytes
+ *             have been moved. At least one block is moved, if any
+ *             block can be moved.
+ */
+int
+mmem_compact(unsigned int max_bytes)
+{
+  struct mmem *n;
+  char *start;
+  unsigned int moved;
+
+  moved = 0;
+  start = memory;
+  for(n = list_head(mmemlist); n != NULL; n = n->next) {
+    if((char *)n->ptr != start) {
+      if(moved > 0 && moved + n->size > max_bytes) {
+        return 1;
+      }
+      memmove(start, n->ptr, n->size);
+      n->ptr = start;
+      moved += n->size;
+      bytes_moved += n->size;
+    }
+    start += n->size;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mmem_compact_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    if(mmem_compact(MMEM_COMPACT_STEP)) {
+      process_poll(&mmem_compact_process);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* MMEM_DEFERRED_COMPACTION */
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Get the amount of free managed memory
+ * \return     The number of free bytes
+ */
+unsigned int
+mmem_avail(void)
+{
+  return avail_memory;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Get the largest block that can be allocated without compacting
+ * \return     The size of the largest free block
+ *
+ *             The fragmentation of the managed memory is the part of
+ *             the free memory that is not in the largest free block.
+ *             Without MMEM_CONF_DEFERRED_COMPACTION, the free memory
+ *             always is one block.
+ */
+unsigned int
+mmem_largest_free(void)
+{
+#if MMEM_DEFERRED_COMPACTION
+  struct mmem *n;
+  char *start;
+  unsigned int largest;
+
+  largest = 0;
+  start = memory;
+  for(n = list_head(mmemlist); n != NULL; n = n->next) {
+    if((unsigned int)((char *)n->ptr - start) > largest) {
+      largest = (char *)n->ptr - start;
+    }
+    start = BLOCK_END(n);
+  }
+  if((unsigned int)(&memory[MMEM_SIZE] - start) > largest) {
+    largest = &memory[MMEM_SIZE] - start;
+  }
+  return largest;
+#else /* MMEM_DEFERRED_COMPACTION */
+  return avail_memory;
+#endif /* MMEM_DEFERRED_COMPACTION */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Get the number of bytes moved by compaction
+ * \return     The number of bytes moved since boot
+ */
+unsigned long
+mmem_bytes_moved(void)
+{
+  return bytes_moved;
+}
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Initialize the managed memory module
@@ -158,6 +414,12 @@ mmem_init(void)
   list_init(mmemlist);
   avail_memory = MMEM_SIZE;
   inited = 1;
+#if MEMB_REGISTRY
+  memb_register(&mmem_pool);
+#endif /* MEMB_REGISTRY */
+#if MMEM_DEFERRED_COMPACTION
+  process_start(&mmem_compact_process, NULL);
+#endif /* MMEM_DEFERRED_COMPACTION */
 }
 /*---------------------------------------------------------------------------*/
 
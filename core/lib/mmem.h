@@ -59,6 +59,8 @@
 #ifndef MMEM_H_
 #define MMEM_H_
 
+#include "contiki-conf.h"
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Get a pointer to the managed memory
@@ -83,10 +85,33 @@ struct mmem {
 /* XXX: tagga minne med "interrupt usage", vilke gr att man r
    speciellt varsam under free(). */
 
+/*
+ * With MMEM_CONF_DEFERRED_COMPACTION, mmem_free() does not compact
+ * the memory. It leaves a hole that later allocations can reuse, and
+ * the memory is compacted in steps of about MMEM_CONF_COMPACT_STEP
+ * bytes by a low-priority process, or by calling mmem_compact(). An
+ * allocation that does not fit in any hole or at the end compacts
+ * all of the memory first.
+ */
+#ifdef MMEM_CONF_DEFERRED_COMPACTION
+#define MMEM_DEFERRED_COMPACTION MMEM_CONF_DEFERRED_COMPACTION
+#else /* MMEM_CONF_DEFERRED_COMPACTION */
+#define MMEM_DEFERRED_COMPACTION 0
+#endif /* MMEM_CONF_DEFERRED_COMPACTION */
+
 int  mmem_alloc(struct mmem *m, unsigned int size);
 void mmem_free(struct mmem *);
+void mmem_shrink(struct mmem *m, unsigned int size);
 void mmem_init(void);
 
+#if MMEM_DEFERRED_COMPACTION
+int mmem_compact(unsigned int max_bytes);
+#endif /* MMEM_DEFERRED_COMPACTION */
+
+unsigned int mmem_avail(void);
+unsigned int mmem_largest_free(void);
+unsigned long mmem_bytes_moved(void);
+
 #endif /* MMEM_H_ */
 
 /** @} */
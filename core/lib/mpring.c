@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Multi-producer ring buffer library
+ */
+
+#include <string.h>
+#include "lib/mpring.h"
+
+#ifdef MPRING_CONF_ATOMIC
+#define MPRING_ATOMIC MPRING_CONF_ATOMIC
+#else /* MPRING_CONF_ATOMIC */
+#define MPRING_ATOMIC 1
+#endif /* MPRING_CONF_ATOMIC */
+
+#ifdef MPRING_CONF_CRITICAL_ENTER
+#define CRITICAL_ENTER() MPRING_CONF_CRITICAL_ENTER()
+#define CRITICAL_EXIT() MPRING_CONF_CRITICAL_EXIT()
+#else /* MPRING_CONF_CRITICAL_ENTER */
+#define CRITICAL_ENTER()
+#define CRITICAL_EXIT()
+#endif /* MPRING_CONF_CRITICAL_ENTER */
+
+/*---------------------------------------------------------------------------*/
+#if MPRING_ATOMIC && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+#define BARRIER() __asm volatile ("dmb" ::: "memory")
+
+static int
+cas(volatile uint16_t *p, uint16_t old, uint16_t new)
+{
+  uint32_t cur, failed;
+
+  __asm volatile ("ldrexh %0, [%1]" : "=r" (cur) : "r" (p) : "memory");
+  if(cur != old) {
+    __asm volatile ("clrex" ::: "memory");
+    return 0;
+  }
+  __asm volatile ("strexh %0, %2, [%1]"
+                  : "=&r" (failed) : "r" (p), "r" (new) : "memory");
+  /* The store fails if an interrupt came in between. */
+  return failed == 0;
+}
+/*---------------------------------------------------------------------------*/
+#elif MPRING_ATOMIC && defined(__GCC_ATOMIC_SHORT_LOCK_FREE) && \
+  __GCC_ATOMIC_SHORT_LOCK_FREE == 2
+#define BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+static int
+cas(volatile uint16_t *p, uint16_t old, uint16_t new)
+{
+  return __atomic_compare_exchange_n(p, &old, new, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+/*---------------------------------------------------------------------------*/
+#else
+#define MPRING_LOCKED 1
+#ifdef __GNUC__
+#define BARRIER() __asm__ volatile ("" ::: "memory")
+#else /* __GNUC__ */
+#define BARRIER()
+#endif /* __GNUC__ */
+#endif
+/*---------------------------------------------------------------------------*/
+void
+mpring_init(struct mpring *r, void *data, uint8_t *ready,
+            uint16_t elem_size, uint16_t size)
+{
+  r->data = data;
+  r->ready = ready;
+  r->elem_size = elem_size;
+  r->mask = size - 1;
+  r->put_ptr = 0;
+  r->get_ptr = 0;
+  memset(ready, 0, size);
+}
+/*---------------------------------------------------------------------------*/
+static int
+reserve(struct mpring *r, int n, uint16_t *start)
+{
+  uint16_t put;
+
+#ifdef MPRING_LOCKED
+  CRITICAL_ENTER();
+  put = r->put_ptr;
+  if((uint16_t)(put - r->get_ptr) + n > r->mask + 1) {
+    CRITICAL_EXIT();
+    return 0;
+  }
+  r->put_ptr = put + n;
+  CRITICAL_EXIT();
+#else /* MPRING_LOCKED */
+  do {
+    put = r->put_ptr;
+    /* A stale get_ptr only makes the ring look fuller than it is. */
+    if((uint16_t)(put - r->get_ptr) + n > r->mask + 1) {
+      return 0;
+    }
+  } while(!cas(&r->put_ptr, put, put + n));
+#endif /* MPRING_LOCKED */
+
+  *start = put;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+mpring_put(struct mpring *r, const void *elems, int n)
+{
+  uint16_t start, slot;
+  int i;
+
+  if(n <= 0 || !reserve(r, n, &start)) {
+    return 0;
+  }
+
+  for(i = 0; i < n; ++i) {
+    slot = (start + i) & r->mask;
+    memcpy(r->data + slot * r->elem_size,
+           (const uint8_t *)elems + i * r->elem_size, r->elem_size);
+  }
+
+  /* The elements must be written before they are marked as ready. */
+  BARRIER();
+  for(i = 0; i < n; ++i) {
+    r->ready[(start + i) & r->mask] = 1;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+mpring_get(struct mpring *r, void *elems, int max)
+{
+  uint16_t get, slot;
+  int n;
+
+  get = r->get_ptr;
+  for(n = 0; n < max; ++n) {
+    slot = get & r->mask;
+    if(!r->ready[slot]) {
+      /* Empty, or a producer is still writing this element. */
+      break;
+    }
+    BARRIER();
+    memcpy((uint8_t *)elems + n * r->elem_size,
+           r->data + slot * r->elem_size, r->elem_size);
+    r->ready[slot] = 0;
+    ++get;
+  }
+
+  if(n > 0) {
+    /* The slots must be read and cleared before the producers may
+       reuse them. */
+    BARRIER();
+#ifdef MPRING_LOCKED
+    /* The counter may not be stored atomically. */
+    CRITICAL_ENTER();
+    r->get_ptr = get;
+    CRITICAL_EXIT();
+#else /* MPRING_LOCKED */
+    r->get_ptr = get;
+#endif /* MPRING_LOCKED */
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+int
+mpring_size(const struct mpring *r)
+{
+  return r->mask + 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+mpring_elements(const struct mpring *r)
+{
+  return (uint16_t)(r->put_ptr - r->get_ptr);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the multi-producer ring buffer library
+ */
+
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup mpring Multi-producer ring buffer library
+ * @{
+ *
+ * The multi-producer ring buffer holds fixed-size elements that can
+ * be put by several producers, typically interrupt handlers of
+ * different priority, and taken by one consumer, typically a
+ * process. Producers reserve room for a batch of elements with an
+ * atomic compare-and-swap, copy the elements and then mark them as
+ * ready, so a producer that interrupts another one never has to wait
+ * for it. The consumer takes the ready elements in order and stops
+ * at the first element that is still being written.
+ *
+ * On ARMv7-M (Cortex-M3/M4) the compare-and-swap uses LDREXH/STREXH,
+ * on other GCC targets with lock-free 16-bit atomics the GCC atomic
+ * builtins are used. On other platforms, the reservation is done
+ * between MPRING_CONF_CRITICAL_ENTER() and MPRING_CONF_CRITICAL_EXIT(),
+ * which must disable and restore interrupts if there is more than one
+ * producer.
+ *
+ */
+
+#ifndef MPRING_H_
+#define MPRING_H_
+
+#include "contiki-conf.h"
+
+/**
+ * \brief      Structure that holds the state of a multi-producer ring buffer.
+ *
+ *             The element storage and the ready flags need to be
+ *             defined separately. This struct is an opaque structure
+ *             with no user-visible elements.
+ *
+ */
+struct mpring {
+  uint8_t *data;
+  volatile uint8_t *ready;
+  uint16_t elem_size;
+  uint16_t mask;
+
+  /* Free-running counters: put_ptr is advanced by the producers when
+     they reserve room, get_ptr by the consumer. */
+  volatile uint16_t put_ptr, get_ptr;
+};
+
+/**
+ * \brief      Initialize a multi-producer ring buffer
+ * \param r    A pointer to a struct mpring to hold the state of the ring buffer
+ * \param data A pointer to an array of size * elem_size bytes to hold the elements
+ * \param ready A pointer to an array of size bytes to hold the ready flags
+ * \param elem_size The size of an element
+ * \param size The number of elements, which must be a power of two and at most 32768
+ *
+ */
+void mpring_init(struct mpring *r, void *data, uint8_t *ready,
+                 uint16_t elem_size, uint16_t size);
+
+/**
+ * \brief      Insert a batch of elements into the ring buffer
+ * \param r    A pointer to a struct mpring
+ * \param elems A pointer to the elements
+ * \param n    The number of elements
+ * \return     Non-zero if the elements were inserted, zero if there
+ *             was not room for all of them, in which case none were
+ *             inserted.
+ *
+ *             The elements of a batch are kept together and in
+ *             order. It is safe to call this function from several
+ *             interrupt handlers.
+ *
+ */
+int mpring_put(struct mpring *r, const void *elems, int n);
+
+/**
+ * \brief      Remove a batch of elements from the ring buffer
+ * \param r    A pointer to a struct mpring
+ * \param elems A pointer to room for max elements
+ * \param max  The largest number of elements to remove
+ * \return     The number of elements that were removed
+ *
+ *             Only one consumer may call this function.
+ *
+ */
+int mpring_get(struct mpring *r, void *elems, int max);
+
+/**
+ * \brief      Get the size of a ring buffer
+ * \param r    A pointer to a struct mpring
+ * \return     The number of elements that the buffer can hold.
+ */
+int mpring_size(const struct mpring *r);
+
+/**
+ * \brief      Get the number of elements currently in the ring buffer
+ * \param r    A pointer to a struct mpring
+ * \return     The number of elements that are reserved or ready.
+ */
+int mpring_elements(const struct mpring *r);
+
+#endif /* MPRING_H_ */
+
+/** @}*/
+/** @}*/
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Shared packet memory
+ */
+
+/**
+ * \addtogroup pktmem
+ * @{
+ */
+
+#include "lib/pktmem.h"
+#include "lib/list.h"
+
+LIST(users);
+static unsigned int used;
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/*---------------------------------------------------------------------------*/
+/* The part of the reserves of the other users that they do not use. */
+static unsigned int
+reserved_by_others(struct pktmem_user *u)
+{
+  struct pktmem_user *o;
+  unsigned int r;
+
+  r = 0;
+  for(o = list_head(users); o != NULL; o = list_item_next(o)) {
+    if(o != u && o->used < o->reserve) {
+      r += o->reserve - o->used;
+    }
+  }
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+int
+pktmem_register(struct pktmem_user *u)
+{
+  struct pktmem_user *o;
+  unsigned int reserved;
+
+  mmem_init();
+
+  reserved = u->reserve;
+  for(o = list_head(users); o != NULL; o = list_item_next(o)) {
+    if(o == u) {
+      return 1;
+    }
+    reserved += o->reserve;
+  }
+  if(reserved > PKTMEM_SIZE) {
+    PRINTF("pktmem: the reserve of %s does not fit\n", u->name);
+    return 0;
+  }
+  list_add(users, u);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+unsigned int
+pktmem_avail(struct pktmem_user *u)
+{
+  unsigned int shared, own;
+
+  own = u->quota > u->used ? u->quota - u->used : 0;
+  shared = PKTMEM_SIZE - used - reserved_by_others(u);
+  return own < shared ? own : shared;
+}
+/*---------------------------------------------------------------------------*/
+int
+pktmem_alloc(struct pktmem_user *u, struct mmem *m, unsigned int size)
+{
+  if(size > pktmem_avail(u) || !mmem_alloc(m, size)) {
+    PRINTF("pktmem: %s could not allocate %u bytes\n", u->name, size);
+    u->failures++;
+    return 0;
+  }
+  used += size;
+  u->used += size;
+  if(u->used > u->max_used) {
+    u->max_used = u->used;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+pktmem_free(struct pktmem_user *u, struct mmem *m)
+{
+  used -= m->size;
+  u->used -= m->size;
+  mmem_free(m);
+}
+/*---------------------------------------------------------------------------*/
+void
+pktmem_shrink(struct pktmem_user *u, struct mmem *m, unsigned int size)
+{
+  if(size < m->size) {
+    used -= m->size - size;
+    u->used -= m->size - size;
+    mmem_shrink(m, size);
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct pktmem_user *
+pktmem_users(void)
+{
+  return list_head(users);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
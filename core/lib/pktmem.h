@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the shared packet memory
+ */
+
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup pktmem Shared packet memory
+ * @{
+ *
+ * The packet memory lets several subsystems keep variable-length
+ * packet data, such as fragments that are being reassembled, in the
+ * managed memory (\ref mmem) instead of in buffers of their own that
+ * are idle most of the time. The subsystems share a budget of
+ * PKTMEM_CONF_SIZE bytes of the managed memory.
+ *
+ * Every subsystem is a user of the packet memory, declared with
+ * PKTMEM_USER() and registered with pktmem_register(). A user has a
+ * reserve, which other users cannot take, and a quota, which it
+ * cannot go beyond. The memory between the reserves is given to the
+ * users that need it first, so that a subsystem with a burst of
+ * packets can use the memory of the subsystems that are idle.
+ *
+ * The blocks are managed memory, so they move when the memory is
+ * compacted and must be accessed with MMEM_PTR().
+ */
+
+#ifndef PKTMEM_H_
+#define PKTMEM_H_
+
+#include "contiki-conf.h"
+#include <stddef.h>
+#include "lib/mmem.h"
+
+/**
+ * The number of bytes of the managed memory that the packet memory
+ * users can take together.
+ */
+#ifdef PKTMEM_CONF_SIZE
+#define PKTMEM_SIZE PKTMEM_CONF_SIZE
+#else /* PKTMEM_CONF_SIZE */
+#define PKTMEM_SIZE 2048
+#endif /* PKTMEM_CONF_SIZE */
+
+struct pktmem_user {
+  struct pktmem_user *next;
+  const char *name;
+  uint16_t reserve;
+  uint16_t quota;
+  uint16_t used;
+  uint16_t max_used;
+  uint16_t failures;
+};
+
+/**
+ * Declare a user of the packet memory.
+ *
+ * \param name    The name of the user.
+ * \param reserve The number of bytes that are kept for this user.
+ * \param quota   The largest number of bytes this user may have.
+ */
+#define PKTMEM_USER(name, reserve, quota) \
+        static struct pktmem_user name = { NULL, #name, reserve, quota }
+
+/**
+ * Register a user of the packet memory.
+ *
+ * \return Zero if the reserve of the user does not fit in the budget
+ *         next to the reserves of the other users.
+ */
+int pktmem_register(struct pktmem_user *u);
+
+/**
+ * Allocate a block of packet memory.
+ *
+ * \param u    The user.
+ * \param m    The managed memory block.
+ * \param size The size of the block.
+ * \return     Non-zero if the block was allocated, zero if the user
+ *             would go beyond its quota, or the memory is taken by
+ *             other users or their reserves.
+ */
+int pktmem_alloc(struct pktmem_user *u, struct mmem *m, unsigned int size);
+
+/**
+ * Free a block that was allocated with pktmem_alloc().
+ */
+void pktmem_free(struct pktmem_user *u, struct mmem *m);
+
+/**
+ * Shrink a block that was allocated with pktmem_alloc(), for a user
+ * that allocates for the largest packet and keeps only what it used.
+ */
+void pktmem_shrink(struct pktmem_user *u, struct mmem *m, unsigned int size);
+
+/**
+ * Get the number of bytes that a user can still allocate.
+ */
+unsigned int pktmem_avail(struct pktmem_user *u);
+
+/**
+ * Get the first of the registered users, to iterate over them with
+ * their next pointer.
+ */
+struct pktmem_user *pktmem_users(void);
+
+#endif /* PKTMEM_H_ */
+
+/** @} */
+/** @} */
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Sensor sampling pipeline
+ */
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "lib/sensor-pipeline.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Event states of a pipeline */
+#define STATE_IDLE     0 /* Waiting for a batch */
+#define STATE_PENDING  1 /* A batch is ready, the event is to be posted */
+#define STATE_POSTED   2 /* The event has been posted, not read yet */
+
+process_event_t sensor_pipeline_event;
+LIST(pipelines);
+
+PROCESS(sensor_pipeline_process, "Sensor pipeline");
+/*---------------------------------------------------------------------------*/
+static void
+check_batch(struct sensor_pipeline *p)
+{
+  if(p->state == STATE_IDLE &&
+     ringbufindex_elements(&p->ring) >= p->batch) {
+    p->state = STATE_PENDING;
+    process_poll(&sensor_pipeline_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sensor_pipeline_process, ev, data)
+{
+  struct sensor_pipeline *p;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    for(p = list_head(pipelines); p != NULL; p = list_item_next(p)) {
+      if(p->state == STATE_PENDING) {
+        if(process_post(p->owner, sensor_pipeline_event, p) ==
+           PROCESS_ERR_OK) {
+          p->state = STATE_POSTED;
+        } else {
+          /* Event queue full, try again later */
+          process_poll(&sensor_pipeline_process);
+        }
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_pipeline_init(struct sensor_pipeline *p, struct process *owner,
+                     int16_t *buf, uint8_t size, uint8_t filter_shift,
+                     uint8_t decimation, uint8_t batch)
+{
+  if(sensor_pipeline_event == 0) {
+    sensor_pipeline_event = process_alloc_event();
+    list_init(pipelines);
+  }
+  if(!process_is_running(&sensor_pipeline_process)) {
+    process_start(&sensor_pipeline_process, NULL);
+  }
+
+  p->owner = owner;
+  p->buf = buf;
+  ringbufindex_init(&p->ring, size);
+  p->filter_shift = filter_shift;
+  p->filter = 0;
+  p->primed = 0;
+  p->decimation = decimation > 0 ? decimation : 1;
+  p->count = 0;
+  p->acc = 0;
+  p->batch = batch > 0 ? batch : 1;
+  if(p->batch > size - 1) {
+    p->batch = size - 1;
+  }
+  p->state = STATE_IDLE;
+  p->dropped = 0;
+
+  list_add(pipelines, p);
+  PRINTF("sensor-pipeline: %p size %u decimation %u batch %u\n",
+         p, size, p->decimation, p->batch);
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_pipeline_remove(struct sensor_pipeline *p)
+{
+  list_remove(pipelines, p);
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_pipeline_input(struct sensor_pipeline *p,
+                      const int16_t *samples, uint16_t n)
+{
+  int32_t x;
+  int put;
+
+  for(; n > 0; n--, samples++) {
+    x = *samples;
+    if(p->filter_shift > 0) {
+      if(!p->primed) {
+        /* Start from the first sample rather than from zero */
+        p->filter = x * 256;
+        p->primed = 1;
+      }
+      p->filter += (x * 256 - p->filter) >> p->filter_shift;
+      x = p->filter >> 8;
+    }
+
+    p->acc += x;
+    if(++p->count < p->decimation) {
+      continue;
+    }
+    x = p->acc / p->decimation;
+    p->acc = 0;
+    p->count = 0;
+
+    put = ringbufindex_peek_put(&p->ring);
+    if(put < 0) {
+      p->dropped++;
+      continue;
+    }
+    p->buf[put] = (int16_t)x;
+    ringbufindex_put(&p->ring);
+  }
+
+  check_batch(p);
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_pipeline_read(struct sensor_pipeline *p, int16_t *dst, int max)
+{
+  int i, get;
+
+  for(i = 0; i < max; i++) {
+    get = ringbufindex_peek_get(&p->ring);
+    if(get < 0) {
+      break;
+    }
+    dst[i] = p->buf[get];
+    ringbufindex_get(&p->ring);
+  }
+
+  if(p->state == STATE_POSTED) {
+    p->state = STATE_IDLE;
+  }
+  check_batch(p);
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+sensor_pipeline_dropped(const struct sensor_pipeline *p)
+{
+  return p->dropped;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Sensor sampling pipeline.
+ *
+ *         A pipeline takes blocks of raw samples from a sampling driver,
+ *         typically from its interrupt handler, runs them through a
+ *         low-pass filter and a decimation stage and stores the result
+ *         in a ring buffer. Once a batch of samples is available, the
+ *         owner process gets a sensor_pipeline_event and reads them all
+ *         at once. Samples that do not fit in the ring are counted as
+ *         dropped.
+ */
+
+#ifndef SENSOR_PIPELINE_H_
+#define SENSOR_PIPELINE_H_
+
+#include "contiki.h"
+#include "lib/ringbufindex.h"
+
+#include <stdint.h>
+
+struct sensor_pipeline {
+  struct sensor_pipeline *next;
+  struct process *owner;
+  int16_t *buf;
+  struct ringbufindex ring;
+  int32_t filter;          /* Filter state, 8 fractional bits */
+  int32_t acc;             /* Sum of the samples being decimated */
+  uint8_t filter_shift;
+  uint8_t decimation;
+  uint8_t count;
+  uint8_t batch;
+  uint8_t primed;          /* The filter has seen a sample */
+  volatile uint8_t state;
+  volatile uint16_t dropped;
+};
+
+/**
+ * Posted to the owner of a pipeline, with the pipeline as data, when
+ * at least a batch of samples can be read. The next event is posted
+ * once sensor_pipeline_read() has been called and a batch is available
+ * again.
+ */
+extern process_event_t sensor_pipeline_event;
+
+/**
+ * \brief              Sets up a pipeline and starts delivering events
+ * \param p            The pipeline
+ * \param owner        The process that receives the events
+ * \param buf          Ring buffer of size entries, of which size - 1 are
+ *                     used for output samples
+ * \param size         Ring size, a power of two of at most 128
+ * \param filter_shift Low-pass filter y += (x - y) / 2^filter_shift
+ *                     applied to every raw sample; 0 for none
+ * \param decimation   Number of raw samples averaged into one output
+ *                     sample; 1 for none
+ * \param batch        Number of output samples per event, at most
+ *                     size - 1
+ */
+void sensor_pipeline_init(struct sensor_pipeline *p, struct process *owner,
+                          int16_t *buf, uint8_t size, uint8_t filter_shift,
+                          uint8_t decimation, uint8_t batch);
+
+/**
+ * \brief   Stops delivering events for a pipeline
+ *
+ *          The sampling driver must no longer feed the pipeline.
+ */
+void sensor_pipeline_remove(struct sensor_pipeline *p);
+
+/**
+ * \brief   Feeds raw samples into a pipeline
+ * \param p The pipeline
+ * \param samples The raw samples
+ * \param n The number of samples
+ *
+ *          This is meant for sampling drivers and may be called from
+ *          an interrupt handler, but only from one context per pipeline.
+ */
+void sensor_pipeline_input(struct sensor_pipeline *p,
+                           const int16_t *samples, uint16_t n);
+
+/**
+ * \brief   Reads output samples from a pipeline
+ * \param p The pipeline
+ * \param dst Where to store the samples
+ * \param max The maximum number of samples to read
+ * \return  The number of samples read
+ */
+int sensor_pipeline_read(struct sensor_pipeline *p, int16_t *dst, int max);
+
+/**
+ * \brief   Returns the number of output samples dropped since the
+ *          pipeline was set up, because the ring was full
+ */
+uint16_t sensor_pipeline_dropped(const struct sensor_pipeline *p);
+
+#endif /* SENSOR_PIPELINE_H_ */
@@ -36,6 +36,7 @@
 
 #define SETTINGS_CONF_SKIP_CONVENIENCE_FUNCS 1
 
+#include <string.h>
 #include "contiki.h"
 #include "settings.h"
 #include "dev/eeprom.h"
@@ -189,128 +190,142 @@ settings_iter_get_value_bytes(settings_iter_t iter, void *bytes,
   return max_length;
 }
 
-/*---------------------------------------------------------------------------*/
-settings_status_t
-settings_iter_delete(settings_iter_t iter)
-{
-  settings_status_t ret = SETTINGS_STATUS_FAILURE;
-
-  settings_iter_t next = settings_iter_next(iter);
-
-  if(!next) {
-    /* Special case: we are the last item. we can get away with
-     * just wiping out our own header.
-     */
-    item_header_t header;
-
-    memset(&header, 0xFF, sizeof(header));
-
-    eeprom_write(iter - sizeof(header), (uint8_t *)&header, sizeof(header));
-
-    ret = SETTINGS_STATUS_OK;
-  }
-
-  /* This case requires the settings store to be shifted.
-   * Currently unimplemented. TODO: Writeme!
-   */
-  ret = SETTINGS_STATUS_UNIMPLEMENTED;
-
-  return ret;
-}
-
 /*****************************************************************************/
-// MARK: - Public Functions
+// MARK: - Private Functions
 /*****************************************************************************/
 
+#if SETTINGS_CONF_INDEX_SIZE
+/* The index lists the key and iterator of each item, in the order of
+ * the store. It is built by the first function that needs it.
+ */
+#define INDEX_UNBUILT   0
+#define INDEX_VALID     1
+#define INDEX_TOO_SMALL 2
+
+static struct {
+  settings_key_t key;
+  settings_iter_t iter;
+} index_items[SETTINGS_CONF_INDEX_SIZE];
+static uint8_t index_count;
+static uint8_t index_state;
+/* The iterator of the next item to be added. */
+static settings_iter_t index_end;
+
 /*---------------------------------------------------------------------------*/
-uint8_t
-settings_check(settings_key_t key, uint8_t index)
+static void
+index_build(void)
 {
-  uint8_t ret = 0;
-
   settings_iter_t iter;
 
+  index_count = 0;
+  index_end = SETTINGS_TOP_ADDR;
   for(iter = settings_iter_begin(); iter; iter = settings_iter_next(iter)) {
-    if(settings_iter_get_key(iter) == key) {
-      if(!index) {
-        ret = 1;
-        break;
-      } else {
-        index--;
-      }
+    if(index_count == SETTINGS_CONF_INDEX_SIZE) {
+      /* Too many items: keep scanning EEPROM instead. */
+      index_state = INDEX_TOO_SMALL;
+      return;
     }
+    index_items[index_count].key = settings_iter_get_key(iter);
+    index_items[index_count].iter = iter;
+    index_count++;
+    index_end = settings_iter_get_value_addr(iter);
   }
-
-  return ret;
+  index_state = INDEX_VALID;
 }
-
 /*---------------------------------------------------------------------------*/
-settings_status_t
-settings_get(settings_key_t key, uint8_t index, uint8_t *value,
-             settings_length_t * value_size)
+static uint8_t
+index_ready(void)
 {
-  settings_status_t ret = SETTINGS_STATUS_NOT_FOUND;
+  if(index_state == INDEX_UNBUILT) {
+    index_build();
+  }
+  return index_state == INDEX_VALID;
+}
+#endif /* SETTINGS_CONF_INDEX_SIZE */
 
+/*---------------------------------------------------------------------------*/
+static settings_iter_t
+find_item(settings_key_t key, uint8_t index)
+{
   settings_iter_t iter;
 
+#if SETTINGS_CONF_INDEX_SIZE
+  if(index_ready()) {
+    uint8_t i;
+
+    for(i = 0; i < index_count; i++) {
+      if(index_items[i].key == key) {
+        if(!index) {
+          return index_items[i].iter;
+        }
+        index--;
+      }
+    }
+    return SETTINGS_INVALID_ITER;
+  }
+#endif /* SETTINGS_CONF_INDEX_SIZE */
+
   for(iter = settings_iter_begin(); iter; iter = settings_iter_next(iter)) {
     if(settings_iter_get_key(iter) == key) {
       if(!index) {
-        /* We found it! */
-        *value_size = settings_iter_get_value_bytes(iter,
-                                                    (void *)value,
-                                                    *value_size);
-        ret = SETTINGS_STATUS_OK;
         break;
-      } else {
-        /* Nope, keep looking */
-        index--;
       }
+      index--;
     }
   }
-
-  return ret;
+  return iter;
 }
 
 /*---------------------------------------------------------------------------*/
-settings_status_t
-settings_add(settings_key_t key, const uint8_t *value,
-             settings_length_t value_size)
+/* Returns the iterator that the next item added will get. */
+static settings_iter_t
+store_end(void)
 {
-  settings_status_t ret = SETTINGS_STATUS_FAILURE;
-
-  settings_iter_t iter;
-
-  item_header_t header;
+  settings_iter_t iter, next;
 
-  /* Find the last item. */
-  for(iter = settings_iter_begin(); settings_iter_next(iter);
-      iter = settings_iter_next(iter)) {
-    /* This block intentionally left blank. */
+#if SETTINGS_CONF_INDEX_SIZE
+  if(index_ready()) {
+    return index_end;
   }
+#endif /* SETTINGS_CONF_INDEX_SIZE */
 
-  if(iter) {
-    /* Value address of item is the same as the iterator for next item. */
-    iter = settings_iter_get_value_addr(iter);
-  } else {
-    /* This will be the first setting! */
-    iter = SETTINGS_TOP_ADDR;
+  iter = settings_iter_begin();
+  if(!iter) {
+    return SETTINGS_TOP_ADDR;
   }
-
-  if(iter < SETTINGS_BOTTOM_ADDR + value_size + sizeof(header)) {
-    /* This value is too big to store. */
-    ret = SETTINGS_STATUS_OUT_OF_SPACE;
-    goto bail;
+  while((next = settings_iter_next(iter))) {
+    iter = next;
   }
+  return settings_iter_get_value_addr(iter);
+}
 
-  header.key = key;
+/*---------------------------------------------------------------------------*/
+/* Returns the number of bytes an item with a value of the given size
+ * takes up, including its header.
+ */
+static uint16_t
+item_size(settings_length_t value_size)
+{
+#if SETTINGS_CONF_SUPPORT_LARGE_VALUES
+  return sizeof(item_header_t) + value_size + (value_size >= 128);
+#else
+  return sizeof(item_header_t) + value_size;
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+static settings_status_t
+make_header(item_header_t *header, settings_key_t key,
+            settings_length_t value_size)
+{
+  header->key = key;
 
   if(value_size < 0x80) {
     /* If the value size is less than 128, then
      * we can get away with only using one byte
      * to store the size.
      */
-    header.size_low = value_size;
+    header->size_low = value_size;
   }
 #if SETTINGS_CONF_SUPPORT_LARGE_VALUES
   else if(value_size <= SETTINGS_MAX_VALUE_SIZE) {
@@ -321,24 +336,158 @@ settings_add(settings_key_t key, const uint8_t *value,
      * least significant bits in the second
      * byte (with LSB clear)
      */
-    header.size_low = (value_size >> 7) | 0x80;
-    header.size_extra = value_size & ~0x80;
+    header->size_low = (value_size >> 7) | 0x80;
+    header->size_extra = value_size & ~0x80;
   }
 #endif
   else {
     /* Value size way too big! */
-    ret = SETTINGS_STATUS_VALUE_TOO_BIG;
-    goto bail;
+    return SETTINGS_STATUS_VALUE_TOO_BIG;
+  }
+
+  header->size_check = ~header->size_low;
+
+  return SETTINGS_STATUS_OK;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Writes an invalid header below the last item if the bytes there
+ * happen to look like an item.
+ */
+static void
+terminate(settings_iter_t end)
+{
+  item_header_t header;
+
+  if(settings_iter_is_valid(end)) {
+    memset(&header, 0xFF, sizeof(header));
+    eeprom_write(end - sizeof(header), (uint8_t *)&header, sizeof(header));
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Moves len bytes in EEPROM from one address to another. */
+static void
+move_bytes(eeprom_addr_t to, eeprom_addr_t from, uint16_t len)
+{
+  uint8_t buf[16];
+  uint16_t n;
+
+  if(to > from) {
+    /* Moving up: copy from the top, since the areas may overlap. */
+    while(len > 0) {
+      n = MIN(sizeof(buf), len);
+      len -= n;
+      eeprom_read(from + len, buf, n);
+      eeprom_write(to + len, buf, n);
+    }
+  } else {
+    while(len > 0) {
+      n = MIN(sizeof(buf), len);
+      eeprom_read(from, buf, n);
+      eeprom_write(to, buf, n);
+      from += n;
+      to += n;
+      len -= n;
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Changes the size of the item at the given iterator, or removes it if
+ * value is NULL. The items after it are moved so that the store stays
+ * contiguous and keeps its order.
+ */
+static settings_status_t
+resize_item(settings_iter_t iter, settings_key_t key,
+            const uint8_t *value, settings_length_t value_size)
+{
+  settings_status_t ret;
+  item_header_t header;
+  eeprom_addr_t start, end;
+  uint16_t new_size;
+  int16_t delta;
+
+  if(value != NULL) {
+    ret = make_header(&header, key, value_size);
+    if(ret != SETTINGS_STATUS_OK) {
+      return ret;
+    }
+    new_size = item_size(value_size);
+  } else {
+    new_size = 0;
   }
 
-  header.size_check = ~header.size_low;
+  start = settings_iter_get_value_addr(iter);
+  end = store_end();
+  delta = (int16_t)(iter - start) - (int16_t)new_size;
+
+  if(delta < 0 && end < SETTINGS_BOTTOM_ADDR - delta) {
+    return SETTINGS_STATUS_OUT_OF_SPACE;
+  }
+
+  /* Move the items after this one, which lie below it in EEPROM. */
+  move_bytes(end + delta, end, start - end);
+  terminate(end + delta);
+
+  if(value != NULL) {
+    eeprom_write(iter - sizeof(header), (uint8_t *)&header, sizeof(header));
+    eeprom_write(settings_iter_get_value_addr(iter),
+                 (uint8_t *)value, value_size);
+  }
+
+#if SETTINGS_CONF_INDEX_SIZE
+  if(index_state == INDEX_VALID) {
+    uint8_t i;
+
+    for(i = 0; i < index_count && index_items[i].iter != iter; i++);
+    if(value == NULL && i < index_count) {
+      index_count--;
+      memmove(&index_items[i], &index_items[i + 1],
+              (index_count - i) * sizeof(index_items[0]));
+    } else {
+      i++;
+    }
+    for(; i < index_count; i++) {
+      index_items[i].iter += delta;
+    }
+    index_end += delta;
+  } else {
+    /* The store may now fit in the index. */
+    index_state = INDEX_UNBUILT;
+  }
+#endif /* SETTINGS_CONF_INDEX_SIZE */
+
+  return SETTINGS_STATUS_OK;
+}
+
+/*---------------------------------------------------------------------------*/
+static settings_status_t
+add_item(settings_key_t key, const uint8_t *value,
+         settings_length_t value_size)
+{
+  settings_status_t ret;
+  settings_iter_t iter;
+  item_header_t header;
+
+  iter = store_end();
+
+  if(iter < SETTINGS_BOTTOM_ADDR + item_size(value_size)) {
+    /* This value is too big to store. */
+    return SETTINGS_STATUS_OUT_OF_SPACE;
+  }
+
+  ret = make_header(&header, key, value_size);
+  if(ret != SETTINGS_STATUS_OK) {
+    return ret;
+  }
 
   /* Write the header first */
   eeprom_write(iter - sizeof(header), (uint8_t *)&header, sizeof(header));
 
   /* Sanity check, remove once confident */
   if(settings_iter_get_value_length(iter) != value_size) {
-    goto bail;
+    return SETTINGS_STATUS_FAILURE;
   }
 
   /* Now write the data */
@@ -347,76 +496,333 @@ settings_add(settings_key_t key, const uint8_t *value,
   /* This should be the last item. If this is not the case,
    * then we need to clear out the phantom setting.
    */
-  if((iter = settings_iter_next(iter))) {
-    memset(&header, 0xFF, sizeof(header));
+  terminate(settings_iter_get_value_addr(iter));
+
+#if SETTINGS_CONF_INDEX_SIZE
+  if(index_state == INDEX_VALID) {
+    if(index_count == SETTINGS_CONF_INDEX_SIZE) {
+      index_state = INDEX_TOO_SMALL;
+    } else {
+      index_items[index_count].key = key;
+      index_items[index_count].iter = iter;
+      index_count++;
+      index_end = settings_iter_get_value_addr(iter);
+    }
+  }
+#endif /* SETTINGS_CONF_INDEX_SIZE */
+
+  return SETTINGS_STATUS_OK;
+}
 
-    eeprom_write(iter - sizeof(header),(uint8_t *)&header, sizeof(header));
+/*---------------------------------------------------------------------------*/
+static uint8_t
+value_equals(settings_iter_t iter, const uint8_t *value,
+             settings_length_t value_size)
+{
+  eeprom_addr_t addr;
+  uint8_t buf[16];
+  uint16_t n;
+
+  addr = settings_iter_get_value_addr(iter);
+  while(value_size > 0) {
+    n = MIN(sizeof(buf), value_size);
+    eeprom_read(addr, buf, n);
+    if(memcmp(buf, value, n) != 0) {
+      return 0;
+    }
+    addr += n;
+    value += n;
+    value_size -= n;
   }
+  return 1;
+}
 
-  ret = SETTINGS_STATUS_OK;
+/*---------------------------------------------------------------------------*/
+static settings_status_t
+set_item(settings_key_t key, const uint8_t *value,
+         settings_length_t value_size)
+{
+  settings_iter_t iter;
 
-bail:
-  return ret;
+  iter = find_item(key, 0);
+
+  if((iter == EEPROM_NULL) || !settings_iter_is_valid(iter)) {
+    return add_item(key, value, value_size);
+  }
+
+  if(value_size != settings_iter_get_value_length(iter)) {
+    return resize_item(iter, key, value, value_size);
+  }
+
+  /* Spare the EEPROM if the value has not changed. */
+  if(!value_equals(iter, value, value_size)) {
+    eeprom_write(settings_iter_get_value_addr(iter),
+                 (uint8_t *)value, value_size);
+  }
+
+  return SETTINGS_STATUS_OK;
+}
+
+#if SETTINGS_CONF_TRANSACTION_SIZE
+/* Changes made within a transaction are kept as records of a key, a
+ * value size, an operation, and the value.
+ */
+#define OP_SET 1
+#define OP_ADD 2
+#define RECORD_HDR_SIZE 5
+
+static uint8_t transaction[SETTINGS_CONF_TRANSACTION_SIZE];
+static uint16_t transaction_len;
+static uint8_t in_transaction;
+
+/*---------------------------------------------------------------------------*/
+static settings_length_t
+record_size(const uint8_t *record)
+{
+  settings_length_t size;
+
+  memcpy(&size, &record[2], sizeof(size));
+  return size;
+}
+
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+find_record(settings_key_t key, uint8_t op, uint8_t index)
+{
+  uint8_t *record;
+  settings_key_t k;
+
+  for(record = transaction; record < &transaction[transaction_len];
+      record += RECORD_HDR_SIZE + record_size(record)) {
+    memcpy(&k, record, sizeof(k));
+    if(k == key && record[4] == op) {
+      if(!index) {
+        return record;
+      }
+      index--;
+    }
+  }
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+static settings_status_t
+apply_records(void)
+{
+  settings_status_t ret, status;
+  settings_key_t key;
+  uint8_t *record;
+
+  status = SETTINGS_STATUS_OK;
+  for(record = transaction; record < &transaction[transaction_len];
+      record += RECORD_HDR_SIZE + record_size(record)) {
+    memcpy(&key, record, sizeof(key));
+    if(record[4] == OP_SET) {
+      ret = set_item(key, &record[RECORD_HDR_SIZE], record_size(record));
+    } else {
+      ret = add_item(key, &record[RECORD_HDR_SIZE], record_size(record));
+    }
+    if(ret != SETTINGS_STATUS_OK) {
+      status = ret;
+    }
+  }
+  transaction_len = 0;
+  return status;
 }
 
+/*---------------------------------------------------------------------------*/
+static settings_status_t
+add_record(settings_key_t key, uint8_t op, const uint8_t *value,
+           settings_length_t value_size)
+{
+  settings_status_t ret;
+  uint8_t *record;
+  uint16_t len;
+
+  if(value_size > SETTINGS_MAX_VALUE_SIZE) {
+    return SETTINGS_STATUS_VALUE_TOO_BIG;
+  }
+
+  if(op == OP_SET) {
+    /* Only the last value set for a key needs to be written. */
+    record = find_record(key, OP_SET, 0);
+    if(record != NULL) {
+      len = RECORD_HDR_SIZE + record_size(record);
+      memmove(record, record + len,
+              &transaction[transaction_len] - (record + len));
+      transaction_len -= len;
+    }
+  }
+
+  if(RECORD_HDR_SIZE + value_size > sizeof(transaction) - transaction_len) {
+    /* The buffer is full: commit the changes so far. */
+    ret = apply_records();
+    if(RECORD_HDR_SIZE + value_size > sizeof(transaction)) {
+      if(op == OP_SET) {
+        return set_item(key, value, value_size);
+      }
+      return add_item(key, value, value_size);
+    }
+    if(ret != SETTINGS_STATUS_OK) {
+      return ret;
+    }
+  }
+
+  record = &transaction[transaction_len];
+  memcpy(&record[0], &key, sizeof(key));
+  memcpy(&record[2], &value_size, sizeof(value_size));
+  record[4] = op;
+  memcpy(&record[RECORD_HDR_SIZE], value, value_size);
+  transaction_len += RECORD_HDR_SIZE + value_size;
+
+  return SETTINGS_STATUS_OK;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Finds the value of a key among the changes of the transaction. Values
+ * added are numbered after the items with the same key in EEPROM.
+ */
+static uint8_t *
+find_pending(settings_key_t key, uint8_t index)
+{
+  uint8_t stored;
+
+  if(!in_transaction) {
+    return NULL;
+  }
+  if(!index && find_record(key, OP_SET, 0) != NULL) {
+    return find_record(key, OP_SET, 0);
+  }
+  if(find_item(key, index)) {
+    return NULL;
+  }
+  for(stored = 0; stored < index && find_item(key, stored); stored++);
+  return find_record(key, OP_ADD, index - stored);
+}
+#endif /* SETTINGS_CONF_TRANSACTION_SIZE */
+
+/*****************************************************************************/
+// MARK: - Public Functions
+/*****************************************************************************/
+
 /*---------------------------------------------------------------------------*/
 settings_status_t
-settings_set(settings_key_t key, const uint8_t *value,
-             settings_length_t value_size)
+settings_iter_delete(settings_iter_t iter)
 {
-  settings_status_t ret = SETTINGS_STATUS_FAILURE;
+  if(!settings_iter_is_valid(iter)) {
+    return SETTINGS_STATUS_FAILURE;
+  }
+
+  return resize_item(iter, settings_iter_get_key(iter), NULL, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+uint8_t
+settings_check(settings_key_t key, uint8_t index)
+{
+#if SETTINGS_CONF_TRANSACTION_SIZE
+  if(find_pending(key, index) != NULL) {
+    return 1;
+  }
+#endif /* SETTINGS_CONF_TRANSACTION_SIZE */
+
+  return find_item(key, index) != SETTINGS_INVALID_ITER;
+}
 
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_get(settings_key_t key, uint8_t index, uint8_t *value,
+             settings_length_t * value_size)
+{
   settings_iter_t iter;
 
-  for(iter = settings_iter_begin(); iter; iter = settings_iter_next(iter)) {
-    if(settings_iter_get_key(iter) == key) {
-      break;
-    }
+#if SETTINGS_CONF_TRANSACTION_SIZE
+  uint8_t *record;
+
+  record = find_pending(key, index);
+  if(record != NULL) {
+    *value_size = MIN(*value_size, record_size(record));
+    memcpy(value, &record[RECORD_HDR_SIZE], *value_size);
+    return SETTINGS_STATUS_OK;
   }
+#endif /* SETTINGS_CONF_TRANSACTION_SIZE */
 
-  if((iter == EEPROM_NULL) || !settings_iter_is_valid(iter)) {
-    ret = settings_add(key, value, value_size);
-    goto bail;
+  iter = find_item(key, index);
+  if(iter == SETTINGS_INVALID_ITER) {
+    return SETTINGS_STATUS_NOT_FOUND;
   }
 
-  if(value_size != settings_iter_get_value_length(iter)) {
-    /* Requires the settings store to be shifted. Currently unimplemented. */
-    ret = SETTINGS_STATUS_UNIMPLEMENTED;
-    goto bail;
+  *value_size = settings_iter_get_value_bytes(iter, (void *)value,
+                                              *value_size);
+  return SETTINGS_STATUS_OK;
+}
+
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_add(settings_key_t key, const uint8_t *value,
+             settings_length_t value_size)
+{
+#if SETTINGS_CONF_TRANSACTION_SIZE
+  if(in_transaction) {
+    return add_record(key, OP_ADD, value, value_size);
   }
+#endif /* SETTINGS_CONF_TRANSACTION_SIZE */
 
-  /* Now write the data */
-  eeprom_write(settings_iter_get_value_addr(iter),
-               (uint8_t *)value, value_size);
+  return add_item(key, value, value_size);
+}
 
-  ret = SETTINGS_STATUS_OK;
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_set(settings_key_t key, const uint8_t *value,
+             settings_length_t value_size)
+{
+#if SETTINGS_CONF_TRANSACTION_SIZE
+  if(in_transaction) {
+    return add_record(key, OP_SET, value, value_size);
+  }
+#endif /* SETTINGS_CONF_TRANSACTION_SIZE */
 
-bail:
-  return ret;
+  return set_item(key, value, value_size);
 }
 
 /*---------------------------------------------------------------------------*/
 settings_status_t
 settings_delete(settings_key_t key, uint8_t index)
 {
-  settings_status_t ret = SETTINGS_STATUS_NOT_FOUND;
-
   settings_iter_t iter;
 
-  for(iter = settings_iter_begin(); iter; iter = settings_iter_next(iter)) {
-    if(settings_iter_get_key(iter) == key) {
-      if(!index) {
-        /* We found it! */
-        ret = settings_iter_delete(iter);
-        break;
-      } else {
-        /* Nope, keep looking */
-        index--;
-      }
-    }
+#if SETTINGS_CONF_TRANSACTION_SIZE
+  /* Keep the order of the changes. */
+  apply_records();
+#endif /* SETTINGS_CONF_TRANSACTION_SIZE */
+
+  iter = find_item(key, index);
+  if(iter == SETTINGS_INVALID_ITER) {
+    return SETTINGS_STATUS_NOT_FOUND;
   }
 
-  return ret;
+  return settings_iter_delete(iter);
+}
+
+/*---------------------------------------------------------------------------*/
+void
+settings_begin(void)
+{
+#if SETTINGS_CONF_TRANSACTION_SIZE
+  in_transaction = 1;
+#endif /* SETTINGS_CONF_TRANSACTION_SIZE */
+}
+
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_commit(void)
+{
+#if SETTINGS_CONF_TRANSACTION_SIZE
+  in_transaction = 0;
+  return apply_records();
+#else /* SETTINGS_CONF_TRANSACTION_SIZE */
+  return SETTINGS_STATUS_OK;
+#endif /* SETTINGS_CONF_TRANSACTION_SIZE */
 }
 
 /*---------------------------------------------------------------------------*/
@@ -426,9 +832,18 @@ settings_wipe(void)
   /* Simply making the first item invalid will effectively
    * clear the key-value store.
    */
-  const uint32_t x = 0xFFFFFF;
+  item_header_t header;
+
+  memset(&header, 0xFF, sizeof(header));
+  eeprom_write(SETTINGS_TOP_ADDR - sizeof(header), (uint8_t *)&header,
+               sizeof(header));
 
-  eeprom_write(SETTINGS_TOP_ADDR - sizeof(x), (uint8_t *)&x, sizeof(x));
+#if SETTINGS_CONF_TRANSACTION_SIZE
+  transaction_len = 0;
+#endif /* SETTINGS_CONF_TRANSACTION_SIZE */
+#if SETTINGS_CONF_INDEX_SIZE
+  index_state = INDEX_UNBUILT;
+#endif /* SETTINGS_CONF_INDEX_SIZE */
 }
 
 /*****************************************************************************/
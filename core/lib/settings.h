@@ -83,6 +83,15 @@
  *     of the size byte (or size_low byte).
  *   * The key has a value of 0x0000.
  *
+ *  ## Index and Transactions ##
+ *
+ *  With SETTINGS_CONF_INDEX_SIZE set, the key and location of each item
+ *  is kept in RAM after the store has been scanned once, so that lookups
+ *  and additions do not scan EEPROM. With SETTINGS_CONF_TRANSACTION_SIZE
+ *  set, changes made between settings_begin() and settings_commit() are
+ *  kept in RAM and written together, and a value that is set several
+ *  times is only written once.
+ *
  * @{ */
 
 #include <stdint.h>
@@ -145,6 +154,17 @@ typedef uint16_t settings_length_t;
 #define SETTINGS_CONF_SUPPORT_LARGE_VALUES  0
 #endif
 
+/** The number of items whose location is kept in RAM. If the store holds
+ *  more items, lookups fall back to scanning EEPROM. */
+#ifndef SETTINGS_CONF_INDEX_SIZE
+#define SETTINGS_CONF_INDEX_SIZE  0
+#endif
+
+/** The size of the RAM buffer for the changes in a transaction. */
+#ifndef SETTINGS_CONF_TRANSACTION_SIZE
+#define SETTINGS_CONF_TRANSACTION_SIZE  0
+#endif
+
 #if SETTINGS_CONF_SUPPORT_LARGE_VALUES
 #define SETTINGS_MAX_VALUE_SIZE    0x3FFF        /* 16383 bytes */
 #else
@@ -177,9 +197,21 @@ extern settings_status_t settings_set(settings_key_t key,
                                       const uint8_t *value,
                                       settings_length_t value_size);
 
-/** Removes the given key (at the given index) from the settings store. */
+/** Removes the given key (at the given index) from the settings store.
+ *  The items after it are moved to keep the store contiguous.
+ */
 extern settings_status_t settings_delete(settings_key_t key, uint8_t index);
 
+/** Starts a transaction. Until settings_commit() is called, the values
+ *  given to settings_set() and settings_add() are kept in RAM, where
+ *  settings_get() and settings_check() see them. If the transaction
+ *  buffer fills up, the changes so far are committed early.
+ */
+extern void settings_begin(void);
+
+/** Writes the changes made since settings_begin() to EEPROM. */
+extern settings_status_t settings_commit(void);
+
 /*****************************************************************************/
 // MARK: - Settings traversal functions
 
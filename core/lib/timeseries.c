@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Compact encoding of time series of integer sensor readings
+ */
+
+#include "lib/timeseries.h"
+
+/*---------------------------------------------------------------------------*/
+static uint32_t
+zigzag(uint32_t v)
+{
+  return (v << 1) ^ (0 - (v >> 31));
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+unzigzag(uint32_t v)
+{
+  return (v >> 1) ^ (0 - (v & 1));
+}
+/*---------------------------------------------------------------------------*/
+static int
+put_varint(uint8_t *p, uint32_t v)
+{
+  int n;
+
+  for(n = 0; v >= 0x80; n++) {
+    p[n] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static int
+get_varint(struct timeseries_decoder *d, uint32_t *v)
+{
+  uint8_t b, shift;
+
+  *v = 0;
+  for(shift = 0; shift < 35; shift += 7) {
+    if(d->pos >= d->len) {
+      return 0;
+    }
+    b = d->buf[d->pos++];
+    *v |= (uint32_t)(b & 0x7f) << shift;
+    if((b & 0x80) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+timeseries_encoder_init(struct timeseries_encoder *e,
+                        uint8_t *buf, uint16_t size)
+{
+  e->buf = buf;
+  e->size = size;
+  e->count = 0;
+  e->last_time = 0;
+  e->last_delta = 0;
+  e->last_value = 0;
+  e->len = 0;
+  if(size > 0) {
+    buf[e->len++] = TIMESERIES_VERSION;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+timeseries_encoder_add(struct timeseries_encoder *e,
+                       uint32_t time, int32_t value)
+{
+  uint8_t record[TIMESERIES_MAX_RECORD];
+  uint32_t delta;
+  int n, i;
+
+  delta = time - e->last_time;
+  if(e->count == 0) {
+    n = put_varint(record, time);
+  } else if(e->count == 1) {
+    n = put_varint(record, zigzag(delta));
+  } else {
+    n = put_varint(record, zigzag(delta - e->last_delta));
+  }
+  n += put_varint(record + n, zigzag((uint32_t)value - e->last_value));
+
+  if(e->len == 0 || e->len + n > e->size) {
+    return 0;
+  }
+  for(i = 0; i < n; i++) {
+    e->buf[e->len++] = record[i];
+  }
+
+  if(e->count > 0) {
+    e->last_delta = delta;
+  }
+  e->last_time = time;
+  e->last_value = (uint32_t)value;
+  e->count++;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+timeseries_encoder_length(const struct timeseries_encoder *e)
+{
+  return e->len;
+}
+/*---------------------------------------------------------------------------*/
+int
+timeseries_decoder_init(struct timeseries_decoder *d,
+                        const uint8_t *buf, uint16_t len)
+{
+  d->buf = buf;
+  d->len = len;
+  d->pos = 1;
+  d->count = 0;
+  d->last_time = 0;
+  d->last_delta = 0;
+  d->last_value = 0;
+  return len > 0 && buf[0] == TIMESERIES_VERSION;
+}
+/*---------------------------------------------------------------------------*/
+int
+timeseries_decoder_next(struct timeseries_decoder *d,
+                        uint32_t *time, int32_t *value)
+{
+  uint32_t t, v, delta;
+
+  if(d->pos >= d->len || !get_varint(d, &t) || !get_varint(d, &v)) {
+    return 0;
+  }
+
+  if(d->count == 0) {
+    d->last_time = t;
+  } else {
+    if(d->count == 1) {
+      delta = unzigzag(t);
+    } else {
+      delta = d->last_delta + unzigzag(t);
+    }
+    d->last_time += delta;
+    d->last_delta = delta;
+  }
+  d->last_value += unzigzag(v);
+  d->count++;
+
+  *time = d->last_time;
+  *value = (int32_t)d->last_value;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Compact encoding of time series of integer sensor readings.
+ *
+ *         A series is a version byte, TIMESERIES_VERSION, followed by
+ *         one record per sample. A record is the timestamp part and then
+ *         the value part, each a zigzag-encoded LEB128 varint of 1 to 5
+ *         bytes:
+ *
+ *         - first sample: the timestamp and the value
+ *         - second sample: the timestamp delta and the value delta
+ *         - later samples: the change of the timestamp delta
+ *           (delta-of-delta) and the value delta
+ *
+ *         Periodic samples of a slowly changing quantity thus take two
+ *         bytes each. Arithmetic wraps modulo 2^32, so any series
+ *         round-trips exactly.
+ */
+
+#ifndef TIMESERIES_H_
+#define TIMESERIES_H_
+
+#include "contiki-conf.h"
+
+#include <stdint.h>
+
+/** The version byte that starts a series */
+#define TIMESERIES_VERSION 1
+
+/** The most bytes one sample can take */
+#define TIMESERIES_MAX_RECORD 10
+
+struct timeseries_encoder {
+  uint8_t *buf;
+  uint16_t size;
+  uint16_t len;
+  uint16_t count;
+  uint32_t last_time;
+  uint32_t last_delta;
+  uint32_t last_value;
+};
+
+struct timeseries_decoder {
+  const uint8_t *buf;
+  uint16_t len;
+  uint16_t pos;
+  uint16_t count;
+  uint32_t last_time;
+  uint32_t last_delta;
+  uint32_t last_value;
+};
+
+/**
+ * \brief      Starts a series in a buffer
+ * \param e    The encoder
+ * \param buf  The buffer
+ * \param size The size of the buffer, at least 1
+ */
+void timeseries_encoder_init(struct timeseries_encoder *e,
+                             uint8_t *buf, uint16_t size);
+
+/**
+ * \brief       Appends a sample
+ * \param e     The encoder
+ * \param time  The timestamp, in any unit, e.g. clock_seconds()
+ * \param value The value
+ * \return      1 if the sample was added, 0 if it does not fit, in
+ *              which case the series is left as it was
+ */
+int timeseries_encoder_add(struct timeseries_encoder *e,
+                           uint32_t time, int32_t value);
+
+/**
+ * \brief   Returns the length of the encoded series so far
+ */
+uint16_t timeseries_encoder_length(const struct timeseries_encoder *e);
+
+/**
+ * \brief     Starts decoding a series
+ * \param d   The decoder
+ * \param buf The series
+ * \param len The length of the series
+ * \return    1 if the series has a known version, 0 otherwise
+ */
+int timeseries_decoder_init(struct timeseries_decoder *d,
+                            const uint8_t *buf, uint16_t len);
+
+/**
+ * \brief       Decodes the next sample
+ * \param d     The decoder
+ * \param time  Receives the timestamp
+ * \param value Receives the value
+ * \return      1 if a sample was decoded, 0 at the end of the series
+ *              or on a truncated record
+ */
+int timeseries_decoder_next(struct timeseries_decoder *d,
+                            uint32_t *time, int32_t *value);
+
+#endif /* TIMESERIES_H_ */
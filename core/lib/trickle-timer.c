@@ -74,6 +74,134 @@ static clock_time_t loc_clock; /* A local, general-purpose placeholder */
 static void fire(void *ptr);
 static void double_interval(void *ptr);
 /*---------------------------------------------------------------------------*/
+#if TRICKLE_TIMER_POOLED
+/* Values of a pooled timer's action field */
+#define TT_ACTION_NONE    0
+#define TT_ACTION_FIRE    1
+#define TT_ACTION_DOUBLE  2
+
+#define tt_timer_set(tt, t, f) pool_set((tt), (t), TT_ACTION_##f)
+#define tt_timer_expires(tt) ((tt)->expires)
+
+/* True if absolute time a is earlier than absolute time b */
+#define TT_BEFORE(a, b) \
+  ((clock_time_t)((a) - (b)) > (TRICKLE_TIMER_CLOCK_MAX >> 1))
+
+static struct ctimer pool_ct;
+static struct trickle_timer *pool_head;
+static uint8_t pool_running;
+
+static void pool_run(void *ptr);
+#else
+#define FIRE fire
+#define DOUBLE double_interval
+
+#define tt_timer_set(tt, t, f) ctimer_set(&(tt)->ct, (t), f, (tt))
+#define tt_timer_expires(tt) \
+  ((tt)->ct.etimer.timer.start + (tt)->ct.etimer.timer.interval)
+#endif
+/*---------------------------------------------------------------------------*/
+#if TRICKLE_TIMER_POOLED
+/* (Re)arm the shared ctimer for the timer at the head of the pool */
+static void
+pool_arm(void)
+{
+  clock_time_t delay;
+
+  if(pool_head == NULL) {
+    ctimer_stop(&pool_ct);
+    return;
+  }
+
+  delay = pool_head->expires - clock_time();
+  if(delay > (TRICKLE_TIMER_CLOCK_MAX >> 1)) {
+    delay = 0;
+  }
+  ctimer_set(&pool_ct, delay, pool_run, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+pool_unlink(struct trickle_timer *tt)
+{
+  struct trickle_timer **pp;
+
+  for(pp = &pool_head; *pp != NULL; pp = &(*pp)->next) {
+    if(*pp == tt) {
+      *pp = tt->next;
+      tt->next = NULL;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Schedule action to be taken for tt in t ticks, keeping the pool sorted */
+static void
+pool_set(struct trickle_timer *tt, clock_time_t t, uint8_t action)
+{
+  struct trickle_timer **pp;
+  uint8_t was_head = (pool_head == tt);
+
+  pool_unlink(tt);
+
+  tt->expires = clock_time() + t;
+  tt->action = action;
+
+  /* Insert after all timers which are due no later than tt */
+  for(pp = &pool_head; *pp != NULL; pp = &(*pp)->next) {
+    if(TT_BEFORE(tt->expires, (*pp)->expires)) {
+      break;
+    }
+  }
+  tt->next = *pp;
+  *pp = tt;
+
+  /* pool_run() re-arms when it's done with the batch */
+  if(!pool_running && (was_head || pool_head == tt)) {
+    pool_arm();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Callback of the shared ctimer. Handles all timers that are due */
+static void
+pool_run(void *ptr)
+{
+  struct trickle_timer *tt;
+  clock_time_t now = clock_time();
+
+  pool_running = 1;
+  while(pool_head != NULL && !TT_BEFORE(now, pool_head->expires)) {
+    tt = pool_head;
+    pool_head = tt->next;
+    tt->next = NULL;
+
+    if(tt->action == TT_ACTION_FIRE) {
+      tt->action = TT_ACTION_NONE;
+      fire(tt);
+    } else if(tt->action == TT_ACTION_DOUBLE) {
+      tt->action = TT_ACTION_NONE;
+      double_interval(tt);
+    }
+  }
+  pool_running = 0;
+
+  pool_arm();
+}
+/*---------------------------------------------------------------------------*/
+void
+trickle_timer_pool_remove(struct trickle_timer *tt)
+{
+  uint8_t was_head = (pool_head == tt);
+
+  if(pool_unlink(tt)) {
+    tt->action = TT_ACTION_NONE;
+    if(!pool_running && was_head) {
+      pool_arm();
+    }
+  }
+}
+#endif /* TRICKLE_TIMER_POOLED */
+/*---------------------------------------------------------------------------*/
 /* Local utilities and functions to be used as ctimer callbacks */
 /*---------------------------------------------------------------------------*/
 #if TRICKLE_TIMER_WIDE_RAND
@@ -183,7 +311,7 @@ schedule_for_end(struct trickle_timer *tt)
     PRINTF("trickle_timer doubling: Was in the past. Compensating\n");
   }
 
-  ctimer_set(&tt->ct, loc_clock, double_interval, tt);
+  tt_timer_set(tt, loc_clock, DOUBLE);
 }
 /*---------------------------------------------------------------------------*/
 /* This is used as a ctimer callback, thus its argument must be void *. ptr is
@@ -233,7 +361,7 @@ double_interval(void *ptr)
     loc_clock = 0;
     PRINTF("trickle_timer doubling: Was in the past. Compensating\n");
   }
-  ctimer_set(&loctt->ct, loc_clock, fire, loctt);
+  tt_timer_set(loctt, loc_clock, FIRE);
 
   /* Store the actual interval start (absolute time), we need it later.
    * We pretend that it started at the same time when the last one ended */
@@ -241,16 +369,15 @@ double_interval(void *ptr)
 #else
   /* Assumed that the previous interval's end is 'now' and schedule in t ticks
    * after 'now', ignoring potential offsets */
-  ctimer_set(&loctt->ct, loc_clock, fire, loctt);
+  tt_timer_set(loctt, loc_clock, FIRE);
   /* Store the actual interval start (absolute time), we need it later */
-  loctt->i_start = loctt->ct.etimer.timer.start;
+  loctt->i_start = tt_timer_expires(loctt) - loc_clock;
 #endif
 
   PRINTF("trickle_timer doubling: Last end %lu, new end %lu, for %lu, I=%lu\n",
          (unsigned long)last_end,
          (unsigned long)TRICKLE_TIMER_INTERVAL_END(loctt),
-         (unsigned long)(loctt->ct.etimer.timer.start +
-                         loctt->ct.etimer.timer.interval),
+         (unsigned long)tt_timer_expires(loctt),
          (unsigned long)(loctt->i_cur));
 }
 /*---------------------------------------------------------------------------*/
@@ -264,8 +391,7 @@ fire(void *ptr)
 
   PRINTF("trickle_timer fire: at %lu (was for %lu)\n",
          (unsigned long)clock_time(),
-         (unsigned long)(loctt->ct.etimer.timer.start +
-                         loctt->ct.etimer.timer.interval));
+         (unsigned long)tt_timer_expires(loctt));
 
   if(loctt->cb) {
     /*
@@ -292,10 +418,10 @@ new_interval(struct trickle_timer *tt)
   /* Random t in [I/2, I) */
   loc_clock = get_t(tt->i_cur);
 
-  ctimer_set(&tt->ct, loc_clock, fire, tt);
+  tt_timer_set(tt, loc_clock, FIRE);
 
   /* Store the actual interval start (absolute time), we need it later */
-  tt->i_start = tt->ct.etimer.timer.start;
+  tt->i_start = tt_timer_expires(tt) - loc_clock;
   PRINTF("trickle_timer new interval: at %lu, ends %lu, ",
          (unsigned long)clock_time(),
          (unsigned long)TRICKLE_TIMER_INTERVAL_END(tt));
@@ -401,7 +527,7 @@ trickle_timer_set(struct trickle_timer *tt, trickle_timer_cb_t proto_cb,
   PRINTF("trickle_timer set: at %lu, ends %lu, t=%lu in [%lu , %lu)\n",
          (unsigned long)tt->i_start,
          (unsigned long)TRICKLE_TIMER_INTERVAL_END(tt),
-         (unsigned long)tt->ct.etimer.timer.interval,
+         (unsigned long)(tt_timer_expires(tt) - tt->i_start),
          (unsigned long)tt->i_cur >> 1, (unsigned long)tt->i_cur);
 
   return TRICKLE_TIMER_SUCCESS;
@@ -204,6 +204,28 @@
 #define TRICKLE_TIMER_ERROR_CHECKING 1
 #endif
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief Multiplexes all trickle timers onto a single, shared ctimer
+ *
+ * 0: Disabled (default). Each trickle timer embeds its own \ref ctimer
+ * 1: Enabled. Running timers are kept in a list sorted by expiration time and
+ *    a single ctimer is armed for the head of that list. When it expires, all
+ *    timers that are due are handled in one go.
+ *
+ * This saves a ctimer's worth of RAM per trickle timer and keeps the number
+ * of active etimers constant, which helps nodes that run many trickle timers.
+ * Setting or resetting a timer costs a walk of the sorted list.
+ *
+ * When this is enabled, protocol callbacks are invoked in the context of the
+ * process which last armed the shared ctimer, rather than the process that
+ * called trickle_timer_set().
+ */
+#ifdef TRICKLE_TIMER_CONF_POOLED
+#define TRICKLE_TIMER_POOLED TRICKLE_TIMER_CONF_POOLED
+#else
+#define TRICKLE_TIMER_POOLED 0
+#endif
+/*---------------------------------------------------------------------------*/
 /* Trickle Timer Library Macros */
 /*---------------------------------------------------------------------------*/
 /**
@@ -369,7 +391,12 @@ struct trickle_timer {
                                Imin << Imax used internally, so that we can
                                have direct access to the maximum interval size
                                without having to calculate it all the time */
+#if TRICKLE_TIMER_POOLED
+  struct trickle_timer *next; /**< Next timer in the pool's sorted list */
+  clock_time_t expires;   /**< When this timer is due (absolute clock_time) */
+#else
   struct ctimer ct;       /**< A \ref ctimer used internally */
+#endif
   trickle_timer_cb_t cb;  /**< Protocol's own callback, invoked at time t
                                within the current interval */
   void *cb_arg;           /**< Opaque pointer to be used as the argument of the
@@ -377,6 +404,9 @@ struct trickle_timer {
   uint8_t i_max;          /**< Imax: Max number of doublings */
   uint8_t k;              /**< k: Redundancy Constant */
   uint8_t c;              /**< c: Consistency Counter */
+#if TRICKLE_TIMER_POOLED
+  uint8_t action;         /**< What to do when this timer is due */
+#endif
 };
 /** @} */
 /*---------------------------------------------------------------------------*/
@@ -447,10 +477,29 @@ uint8_t trickle_timer_set(struct trickle_timer *tt,
  * to reset a timer manually. Instead, in response to events or inconsistencies,
  * the corresponding functions must be used
  */
+#if TRICKLE_TIMER_POOLED
+#define trickle_timer_stop(tt) do { \
+  trickle_timer_pool_remove(tt); \
+  (tt)->i_cur = TRICKLE_TIMER_IS_STOPPED; \
+} while(0)
+#else
 #define trickle_timer_stop(tt) do { \
   ctimer_stop(&((tt)->ct)); \
   (tt)->i_cur = TRICKLE_TIMER_IS_STOPPED; \
 } while(0)
+#endif
+
+#if TRICKLE_TIMER_POOLED
+/**
+ * \brief      Remove a trickle timer from the shared pool
+ * \param tt   A pointer to a ::trickle_timer structure
+ *
+ * Only available when ::TRICKLE_TIMER_POOLED is enabled. Used internally by
+ * trickle_timer_stop(). Protocol implementations must call
+ * trickle_timer_stop() instead.
+ */
+void trickle_timer_pool_remove(struct trickle_timer *tt);
+#endif
 
 /**
  * \brief      To be called by the protocol when it hears a consistent
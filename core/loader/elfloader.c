@@ -206,6 +206,80 @@ find_local_symbol(int fd, const char *symbol,
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+/* The addresses that symbols have been resolved to while loading the
+   current module, in a direct-mapped cache indexed by symbol number. */
+static struct {
+  unsigned int symbol; /* The symbol number plus one; 0 if unused. */
+  char *addr;
+} symbol_cache[ELFLOADER_SYMBOL_CACHE_SIZE];
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
+
+/* Relocation entries are read from the file into this buffer. */
+static char relocation_buf[ELFLOADER_RELOCATION_BATCH *
+			   sizeof(struct elf32_rela)];
+/*---------------------------------------------------------------------------*/
+static int
+resolve_symbol(int fd, unsigned int symbol,
+	       unsigned int strtab,
+	       unsigned int symtab, unsigned short symtabsize,
+	       char **addrp)
+{
+  struct elf32_sym s;
+  char name[30];
+  char *addr;
+  struct relevant_section *sect;
+
+  seek_read(fd,
+	    symtab + sizeof(struct elf32_sym) * symbol,
+	    (char *)&s, sizeof(s));
+  if(s.st_name != 0) {
+    seek_read(fd, strtab + s.st_name, name, sizeof(name));
+    PRINTF("name: %s\n", name);
+    addr = (char *)symtab_lookup(name);
+    /* ADDED */
+    if(addr == NULL) {
+      PRINTF("name not found in global: %s\n", name);
+      addr = find_local_symbol(fd, name, symtab, symtabsize, strtab);
+      PRINTF("found address %p\n", addr);
+    }
+    if(addr == NULL) {
+      if(s.st_shndx == bss.number) {
+	sect = &bss;
+      } else if(s.st_shndx == data.number) {
+	sect = &data;
+      } else if(s.st_shndx == rodata.number) {
+	sect = &rodata;
+      } else if(s.st_shndx == text.number) {
+	sect = &text;
+      } else {
+	PRINTF("elfloader unknown name: '%30s'\n", name);
+	memcpy(elfloader_unknown, name, sizeof(elfloader_unknown));
+	elfloader_unknown[sizeof(elfloader_unknown) - 1] = 0;
+	return ELFLOADER_SYMBOL_NOT_FOUND;
+      }
+      addr = sect->address;
+    }
+  } else {
+    if(s.st_shndx == bss.number) {
+      sect = &bss;
+    } else if(s.st_shndx == data.number) {
+      sect = &data;
+    } else if(s.st_shndx == rodata.number) {
+      sect = &rodata;
+    } else if(s.st_shndx == text.number) {
+      sect = &text;
+    } else {
+      return ELFLOADER_SEGMENT_NOT_FOUND;
+    }
+
+    addr = sect->address;
+  }
+
+  *addrp = addr;
+  return ELFLOADER_OK;
+}
+/*---------------------------------------------------------------------------*/
 static int
 relocate_section(int fd,
 		 unsigned int section, unsigned short size,
@@ -219,11 +293,11 @@ relocate_section(int fd,
   /* sectionbase added; runtime start address of current section */
   struct elf32_rela rela; /* Now used both for rel and rela data! */
   int rel_size = 0;
-  struct elf32_sym s;
   unsigned int a;
-  char name[30];
+  unsigned int symbol;
+  unsigned int buffered, bufpos;
   char *addr;
-  struct relevant_section *sect;
+  int ret;
 
   /* determine correct relocation entry sizes */
   if(using_relas) {
@@ -231,54 +305,39 @@ relocate_section(int fd,
   } else {
     rel_size = sizeof(struct elf32_rel);
   }
-  
+
+  buffered = bufpos = 0;
   for(a = section; a < section + size; a += rel_size) {
-    seek_read(fd, a, (char *)&rela, rel_size);
-    seek_read(fd,
-	      symtab + sizeof(struct elf32_sym) * ELF32_R_SYM(rela.r_info),
-	      (char *)&s, sizeof(s));
-    if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
-      PRINTF("name: %s\n", name);
-      addr = (char *)symtab_lookup(name);
-      /* ADDED */
-      if(addr == NULL) {
-	PRINTF("name not found in global: %s\n", name);
-	addr = find_local_symbol(fd, name, symtab, symtabsize, strtab);
-	PRINTF("found address %p\n", addr);
-      }
-      if(addr == NULL) {
-	if(s.st_shndx == bss.number) {
-	  sect = &bss;
-	} else if(s.st_shndx == data.number) {
-	  sect = &data;
-	} else if(s.st_shndx == rodata.number) {
-	  sect = &rodata;
-	} else if(s.st_shndx == text.number) {
-	  sect = &text;
-	} else {
-	  PRINTF("elfloader unknown name: '%30s'\n", name);
-	  memcpy(elfloader_unknown, name, sizeof(elfloader_unknown));
-	  elfloader_unknown[sizeof(elfloader_unknown) - 1] = 0;
-	  return ELFLOADER_SYMBOL_NOT_FOUND;
-	}
-	addr = sect->address;
+    if(bufpos == buffered) {
+      /* Read as many whole entries as fit into the buffer. */
+      buffered = section + size - a;
+      if(buffered > sizeof(relocation_buf)) {
+	buffered = sizeof(relocation_buf) - sizeof(relocation_buf) % rel_size;
       }
+      seek_read(fd, a, relocation_buf, buffered);
+      bufpos = 0;
+    }
+    memcpy(&rela, &relocation_buf[bufpos], rel_size);
+    bufpos += rel_size;
+
+    symbol = ELF32_R_SYM(rela.r_info);
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+    if(symbol_cache[symbol % ELFLOADER_SYMBOL_CACHE_SIZE].symbol == symbol + 1) {
+      addr = symbol_cache[symbol % ELFLOADER_SYMBOL_CACHE_SIZE].addr;
     } else {
-      if(s.st_shndx == bss.number) {
-	sect = &bss;
-      } else if(s.st_shndx == data.number) {
-	sect = &data;
-      } else if(s.st_shndx == rodata.number) {
-	sect = &rodata;
-      } else if(s.st_shndx == text.number) {
-	sect = &text;
-      } else {
-	return ELFLOADER_SEGMENT_NOT_FOUND;
+      ret = resolve_symbol(fd, symbol, strtab, symtab, symtabsize, &addr);
+      if(ret != ELFLOADER_OK) {
+	return ret;
       }
-      
-      addr = sect->address;
+      symbol_cache[symbol % ELFLOADER_SYMBOL_CACHE_SIZE].symbol = symbol + 1;
+      symbol_cache[symbol % ELFLOADER_SYMBOL_CACHE_SIZE].addr = addr;
+    }
+#else /* ELFLOADER_SYMBOL_CACHE_SIZE */
+    ret = resolve_symbol(fd, symbol, strtab, symtab, symtabsize, &addr);
+    if(ret != ELFLOADER_OK) {
+      return ret;
     }
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
 
     if(!using_relas) {
       /* copy addend to rela structure */
@@ -312,6 +371,88 @@ find_program_processes(int fd,
   return NULL;
 /*   return find_local_symbol(fd, "autostart_processes", symtab, size, strtab); */
 }
+#if ELFLOADER_PRELINK
+#define PRELINK_MISMATCH -1
+/*---------------------------------------------------------------------------*/
+static unsigned long
+get_le(const unsigned char *ptr, int len)
+{
+  unsigned long value;
+
+  value = 0;
+  while(len-- > 0) {
+    value = (value << 8) | ptr[len];
+  }
+  return value;
+}
+/*---------------------------------------------------------------------------*/
+static int
+load_prelinked(int fd)
+{
+  unsigned char buf[4 + sizeof(elfloader_unknown)];
+  char *name;
+  unsigned int offset;
+  unsigned short textsize, datasize, bsssize;
+  unsigned long textaddr, ramaddr, autostart;
+  int imports;
+
+  /* A prelinked image is announced by the trailer of the file. */
+  if(cfs_seek(fd, -ELFLOADER_PRELINK_TRAILER_SIZE, CFS_SEEK_END) ==
+     (cfs_offset_t)-1 ||
+     cfs_read(fd, buf, ELFLOADER_PRELINK_TRAILER_SIZE) !=
+     ELFLOADER_PRELINK_TRAILER_SIZE ||
+     memcmp(&buf[4], ELFLOADER_PRELINK_MAGIC, 4) != 0) {
+    return PRELINK_MISMATCH;
+  }
+  offset = get_le(buf, 4);
+
+  seek_read(fd, offset, (char *)buf, ELFLOADER_PRELINK_HEADER_SIZE);
+  if(memcmp(buf, ELFLOADER_PRELINK_MAGIC, 4) != 0 ||
+     buf[4] != ELFLOADER_PRELINK_VERSION) {
+    PRINTF("elfloader: unknown prelinked image\n");
+    return PRELINK_MISMATCH;
+  }
+  imports = buf[5];
+  textsize = get_le(&buf[6], 2);
+  datasize = get_le(&buf[8], 2);
+  bsssize = get_le(&buf[10], 2);
+  textaddr = get_le(&buf[12], 4);
+  ramaddr = get_le(&buf[16], 4);
+  autostart = get_le(&buf[20], 4);
+  offset += ELFLOADER_PRELINK_HEADER_SIZE;
+
+  /* The image can be used only if the firmware has every symbol that
+     it imports at the address that the image was linked with. */
+  name = (char *)&buf[4];
+  for(; imports > 0; imports--) {
+    seek_read(fd, offset, (char *)buf, sizeof(buf));
+    buf[sizeof(buf) - 1] = 0;
+    if((unsigned long)(uintptr_t)symtab_lookup(name) != get_le(buf, 4)) {
+      PRINTF("elfloader: prelinked symbol %s has moved\n", name);
+      return PRELINK_MISMATCH;
+    }
+    offset += 4 + strlen(name) + 1;
+  }
+
+  bss.address = (char *)elfloader_arch_allocate_ram(bsssize + datasize);
+  text.address = (char *)elfloader_arch_allocate_rom(textsize);
+  if((unsigned long)(uintptr_t)text.address != textaddr ||
+     (unsigned long)(uintptr_t)bss.address != ramaddr) {
+    PRINTF("elfloader: prelinked for other memory regions\n");
+    return PRELINK_MISMATCH;
+  }
+
+  elfloader_arch_write_rom(fd, offset, textsize, text.address);
+  memset(bss.address, 0, bsssize);
+  seek_read(fd, offset + textsize, bss.address + bsssize, datasize);
+
+  if(autostart == 0) {
+    return ELFLOADER_NO_STARTPOINT;
+  }
+  elfloader_autostart_processes = (struct process **)(uintptr_t)autostart;
+  return ELFLOADER_OK;
+}
+#endif /* ELFLOADER_PRELINK */
 /*---------------------------------------------------------------------------*/
 void
 elfloader_init(void)
@@ -362,6 +503,18 @@ elfloader_load(int fd)
 
   elfloader_unknown[0] = 0;
 
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+  /* Addresses resolved for a previously loaded module are not valid. */
+  memset(symbol_cache, 0, sizeof(symbol_cache));
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
+
+#if ELFLOADER_PRELINK
+  ret = load_prelinked(fd);
+  if(ret != PRELINK_MISMATCH) {
+    return ret;
+  }
+#endif /* ELFLOADER_PRELINK */
+
   /* The ELF header is located at the start of the buffer. */
   seek_read(fd, 0, (char *)&ehdr, sizeof(ehdr));
 
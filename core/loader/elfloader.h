@@ -175,6 +175,64 @@ extern char elfloader_unknown[30];
 #endif
 #endif /* ELFLOADER_TEXTMEMORY_SIZE */
 
+/* The number of resolved symbol addresses that are cached while the
+   relocations of a module are processed. 0 disables the cache. */
+#ifndef ELFLOADER_SYMBOL_CACHE_SIZE
+#ifdef ELFLOADER_CONF_SYMBOL_CACHE_SIZE
+#define ELFLOADER_SYMBOL_CACHE_SIZE ELFLOADER_CONF_SYMBOL_CACHE_SIZE
+#else
+#define ELFLOADER_SYMBOL_CACHE_SIZE 0
+#endif
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
+
+/* The number of relocation entries read from the file at a time. */
+#ifndef ELFLOADER_RELOCATION_BATCH
+#ifdef ELFLOADER_CONF_RELOCATION_BATCH
+#define ELFLOADER_RELOCATION_BATCH ELFLOADER_CONF_RELOCATION_BATCH
+#else
+#define ELFLOADER_RELOCATION_BATCH 1
+#endif
+#endif /* ELFLOADER_RELOCATION_BATCH */
+
+/* Load the prelinked image appended to a module by tools/elf-prelink
+   when it matches the running firmware. */
+#ifndef ELFLOADER_PRELINK
+#ifdef ELFLOADER_CONF_PRELINK
+#define ELFLOADER_PRELINK ELFLOADER_CONF_PRELINK
+#else
+#define ELFLOADER_PRELINK 0
+#endif
+#endif /* ELFLOADER_PRELINK */
+
+/*
+ * A prelinked module is an ELF file followed by an image of its
+ * sections, already relocated for the text and data addresses of a
+ * specific firmware, and an 8-byte trailer at the end of the file:
+ * the little-endian 32-bit file offset of the image and the magic
+ * string below. All integers in the image are little-endian.
+ *
+ * The image starts with a header:
+ *   4 bytes  magic string
+ *   1 byte   format version
+ *   1 byte   number of imported symbols
+ *   2 bytes  size of .text and .rodata
+ *   2 bytes  size of .data
+ *   2 bytes  size of .bss
+ *   4 bytes  address of .text, followed by .rodata
+ *   4 bytes  address of .bss, followed by .data
+ *   4 bytes  address of autostart_processes, or 0 if none
+ *
+ * The header is followed by the imported symbols, each of which is a
+ * 4-byte address and a null-terminated name, and then by the contents
+ * of .text, .rodata, and .data. The image is used only if all
+ * imported symbols and memory regions have the addresses it was
+ * linked for; otherwise the ELF file is loaded instead.
+ */
+#define ELFLOADER_PRELINK_MAGIC       "CPLK"
+#define ELFLOADER_PRELINK_VERSION     1
+#define ELFLOADER_PRELINK_HEADER_SIZE 24
+#define ELFLOADER_PRELINK_TRAILER_SIZE 8
+
 typedef unsigned long  elf32_word;
 typedef   signed long  elf32_sword;
 typedef unsigned short elf32_half;
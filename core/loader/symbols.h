@@ -41,4 +41,9 @@ extern const int symbols_nelts;
 
 extern const struct symbols symbols[/* symbols_nelts */];
 
+/* A hash table of indexes into symbols[] plus one, with 0 in the
+   empty slots. It is generated by tools/mknmlist. */
+extern const int symbols_hash_size;
+extern const unsigned short symbols_hash[/* symbols_hash_size */];
+
 #endif /* SYMBOLS_H_ */
@@ -41,16 +41,22 @@
 #define SYMTAB_CONF_BINARY_SEARCH 1
 #endif
 
+/* Look up symbols in the hash table generated by tools/mknmlist,
+   and search symbols[] only if the firmware has no such table. */
+#ifndef SYMTAB_CONF_HASH
+#define SYMTAB_CONF_HASH 0
+#endif
+
 /*---------------------------------------------------------------------------*/
 #if SYMTAB_CONF_BINARY_SEARCH
-void *
-symtab_lookup(const char *name)
+static void *
+search_symbols(const char *name)
 {
   int start, middle, end;
   int r;
   
   start = 0;
-  end = symbols_nelts - 1;	/* Last entry is { 0, 0 }. */
+  end = symbols_nelts - 2;	/* Last entry is { 0, 0 }. */
 
   while(start <= end) {
     /* Check middle, divide */
@@ -67,8 +73,8 @@ symtab_lookup(const char *name)
   return NULL;
 }
 #else /* SYMTAB_CONF_BINARY_SEARCH */
-void *
-symtab_lookup(const char *name)
+static void *
+search_symbols(const char *name)
 {
   const struct symbols *s;
   for(s = symbols; s->name != NULL; ++s) {
@@ -80,3 +86,44 @@ symtab_lookup(const char *name)
 }
 #endif /* SYMTAB_CONF_BINARY_SEARCH */
 /*---------------------------------------------------------------------------*/
+#if SYMTAB_CONF_HASH
+/* Must match the hash function in tools/mknmlist. */
+static unsigned short
+symbol_hash(const char *name)
+{
+  unsigned short hash;
+
+  hash = 0;
+  while(*name != '\0') {
+    hash = hash * 31 + (unsigned char)*name++;
+  }
+  return hash;
+}
+#endif /* SYMTAB_CONF_HASH */
+/*---------------------------------------------------------------------------*/
+void *
+symtab_lookup(const char *name)
+{
+#if SYMTAB_CONF_HASH
+  unsigned short mask;
+  unsigned short slot;
+  unsigned short index;
+
+  if(symbols_hash_size > 0) {
+    /* The table size is a power of two, and the table always has
+       empty slots, which end the probing. */
+    mask = symbols_hash_size - 1;
+    for(slot = symbol_hash(name) & mask;
+        (index = symbols_hash[slot]) != 0;
+        slot = (slot + 1) & mask) {
+      if(strcmp(name, symbols[index - 1].name) == 0) {
+        return symbols[index - 1].value;
+      }
+    }
+    return NULL;
+  }
+#endif /* SYMTAB_CONF_HASH */
+
+  return search_symbols(name);
+}
+/*---------------------------------------------------------------------------*/
@@ -32,15 +32,54 @@
 #include "ip64-addr.h"
 #include "http-socket.h"
 
+#include "lib/memb.h"
+
 #include <ctype.h>
 #include <stdio.h>
 
 #define MAX_PATHLEN 80
 #define MAX_HOSTLEN 40
+
+#define IS_POST(s) ((s)->postdata != NULL || (s)->body_callback != NULL)
 PROCESS(http_socket_process, "HTTP socket process");
 LIST(socketlist);
 
+#if HTTP_SOCKET_KEEPALIVE
+enum {
+  CONN_CONNECTING,
+  CONN_CONNECTED,
+  CONN_CLOSING,
+  CONN_CLOSED,
+};
+
+enum {
+  REQUEST_QUEUED,
+  REQUEST_SENT,
+  REQUEST_RECEIVING,
+};
+
+struct http_socket_conn {
+  struct http_socket_conn *next;
+  struct tcp_socket s;
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint8_t state;
+  /* Whether a response has been received on the connection */
+  uint8_t served;
+  struct etimer idle_timer;
+  uint8_t inputbuf[HTTP_SOCKET_INPUTBUFSIZE];
+  uint8_t outputbuf[HTTP_SOCKET_OUTPUTBUFSIZE];
+};
+
+MEMB(conns, struct http_socket_conn, HTTP_SOCKET_CONNECTIONS);
+LIST(connlist);
+
+static void close_connection(struct http_socket_conn *c);
+static int start_request(struct http_socket *s);
+#endif /* HTTP_SOCKET_KEEPALIVE */
+
 static void removesocket(struct http_socket *s);
+static void close_socket(struct http_socket *s);
 /*---------------------------------------------------------------------------*/
 static void
 call_callback(struct http_socket *s, http_socket_event_t e,
@@ -52,194 +91,252 @@ call_callback(struct http_socket *s, http_socket_event_t e,
   }
 }
 /*---------------------------------------------------------------------------*/
+enum {
+  CHUNK_SIZE,
+  CHUNK_EXTENSION,
+  CHUNK_DATA,
+  CHUNK_DATA_END,
+  CHUNK_TRAILER,
+};
+/*---------------------------------------------------------------------------*/
 static void
 parse_header_init(struct http_socket *s)
 {
-  PT_INIT(&s->headerpt);
+  memset(&s->header, -1, sizeof(s->header));
+  s->header_linelen = 0;
+  s->chunked = 0;
 }
 /*---------------------------------------------------------------------------*/
+static const char *
+skip_lws(const char *p)
+{
+  while(*p == ' ' || *p == '\t') {
+    p++;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+static const char *
+parse_number(const char *p, int64_t *n)
+{
+  *n = 0;
+  while(isdigit((int)*p)) {
+    *n = *n * 10 + *p - '0';
+    p++;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+/* Parse the status line of the response. Returns zero if the response
+   is an error. */
 static int
-parse_header_byte(struct http_socket *s, char c)
+parse_status_line(struct http_socket *s, const char *line)
 {
-  PT_BEGIN(&s->headerpt);
-
-  memset(&s->header, -1, sizeof(s->header));
+  const char *p;
+  int i;
 
   /* Skip the HTTP response */
-  while(c != ' ') {
-    PT_YIELD(&s->headerpt);
+  p = strchr(line, ' ');
+  if(p == NULL) {
+    p = line + strlen(line);
   }
+#if HTTP_SOCKET_KEEPALIVE
+  /* HTTP/1.0 servers close the connection unless told otherwise */
+  s->response_close = (p > line && p[-1] == '0');
+#endif /* HTTP_SOCKET_KEEPALIVE */
+  p = skip_lws(p);
 
-  /* Skip the space */
-  PT_YIELD(&s->headerpt);
   /* Read three characters of HTTP status and convert to BCD */
   s->header.status_code = 0;
-  for(s->header_chars = 0; s->header_chars < 3; s->header_chars++) {
-    s->header.status_code = s->header.status_code << 4 | (c - '0');
-    PT_YIELD(&s->headerpt);
+  for(i = 0; i < 3 && *p != '\0'; i++, p++) {
+    s->header.status_code = s->header.status_code << 4 | (*p - '0');
   }
 
   if(s->header.status_code == 0x200 || s->header.status_code == 0x206) {
-    /* Read headers until data */
-
-    while(1) {
-      /* Skip characters until end of line */
-      do {
-        while(c != '\r') {
-          s->header_chars++;
-          PT_YIELD(&s->headerpt);
-        }
-        s->header_chars++;
-        PT_YIELD(&s->headerpt);
-      } while(c != '\n');
-      s->header_chars--;
-      PT_YIELD(&s->headerpt);
-
-      if(s->header_chars == 0) {
-        /* This was an empty line, i.e. the end of headers */
-        break;
-      }
+    return 1;
+  }
 
-      /* Start of line */
-      s->header_chars = 0;
+  if(s->header.status_code == 0x404) {
+    printf("File not found\n");
+  } else if(s->header.status_code == 0x301 || s->header.status_code == 0x302) {
+    printf("File moved (not handled)\n");
+  }
 
-      /* Read header field */
-      while(c != ' ' && c != '\t' && c != ':' && c != '\r' &&
-            s->header_chars < sizeof(s->header_field) - 1) {
-        s->header_field[s->header_chars++] = c;
-        PT_YIELD(&s->headerpt);
-      }
-      s->header_field[s->header_chars] = '\0';
-      /* Skip linear white spaces */
-      while(c == ' ' || c == '\t') {
-        s->header_chars++;
-        PT_YIELD(&s->headerpt);
-      }
-      if(c == ':') {
-        /* Skip the colon */
-        s->header_chars++;
-        PT_YIELD(&s->headerpt);
-        /* Skip linear white spaces */
-        while(c == ' ' || c == '\t') {
-          s->header_chars++;
-          PT_YIELD(&s->headerpt);
-        }
-        if(!strcmp(s->header_field, "Content-Length")) {
-          s->header.content_length = 0;
-          while(isdigit((int)c)) {
-            s->header.content_length = s->header.content_length * 10 + c - '0';
-            s->header_chars++;
-            PT_YIELD(&s->headerpt);
-          }
-        } else if(!strcmp(s->header_field, "Content-Range")) {
-          /* Skip the bytes-unit token */
-          while(c != ' ' && c != '\t') {
-            s->header_chars++;
-            PT_YIELD(&s->headerpt);
-          }
-          /* Skip linear white spaces */
-          while(c == ' ' || c == '\t') {
-            s->header_chars++;
-            PT_YIELD(&s->headerpt);
-          }
-          s->header.content_range.first_byte_pos = 0;
-          while(isdigit((int)c)) {
-            s->header.content_range.first_byte_pos =
-              s->header.content_range.first_byte_pos * 10 + c - '0';
-            s->header_chars++;
-            PT_YIELD(&s->headerpt);
-          }
-          /* Skip linear white spaces */
-          while(c == ' ' || c == '\t') {
-            s->header_chars++;
-            PT_YIELD(&s->headerpt);
-          }
-          if(c == '-') {
-            /* Skip the dash */
-            s->header_chars++;
-            PT_YIELD(&s->headerpt);
-            /* Skip linear white spaces */
-            while(c == ' ' || c == '\t') {
-              s->header_chars++;
-              PT_YIELD(&s->headerpt);
-            }
-            s->header.content_range.last_byte_pos = 0;
-            while(isdigit((int)c)) {
-              s->header.content_range.last_byte_pos =
-                s->header.content_range.last_byte_pos * 10 + c - '0';
-              s->header_chars++;
-              PT_YIELD(&s->headerpt);
-            }
-            /* Skip linear white spaces */
-            while(c == ' ' || c == '\t') {
-              s->header_chars++;
-              PT_YIELD(&s->headerpt);
-            }
-            if(c == '/') {
-              /* Skip the slash */
-              s->header_chars++;
-              PT_YIELD(&s->headerpt);
-              /* Skip linear white spaces */
-              while(c == ' ' || c == '\t') {
-                s->header_chars++;
-                PT_YIELD(&s->headerpt);
-              }
-              if(c != '*') {
-                s->header.content_range.instance_length = 0;
-                while(isdigit((int)c)) {
-                  s->header.content_range.instance_length =
-                    s->header.content_range.instance_length * 10 + c - '0';
-                  s->header_chars++;
-                  PT_YIELD(&s->headerpt);
-                }
-              }
-            }
-          }
+  call_callback(s, HTTP_SOCKET_ERR, (void *)&s->header, sizeof(s->header));
+  close_socket(s);
+  removesocket(s);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Parse a header line. The line has been converted to lower case. */
+static void
+parse_header_line(struct http_socket *s, const char *line)
+{
+  const char *p;
+
+  p = strchr(line, ':');
+  if(p == NULL) {
+    return;
+  }
+  p = skip_lws(p + 1);
+
+  if(!strncmp(line, "content-length:", 15)) {
+    parse_number(p, &s->header.content_length);
+  } else if(!strncmp(line, "content-range:", 14)) {
+    /* Skip the bytes-unit token */
+    while(*p != '\0' && *p != ' ' && *p != '\t') {
+      p++;
+    }
+    p = parse_number(skip_lws(p), &s->header.content_range.first_byte_pos);
+    p = skip_lws(p);
+    if(*p == '-') {
+      p = parse_number(skip_lws(p + 1),
+                       &s->header.content_range.last_byte_pos);
+      p = skip_lws(p);
+      if(*p == '/') {
+        p = skip_lws(p + 1);
+        if(*p != '*') {
+          parse_number(p, &s->header.content_range.instance_length);
         }
       }
     }
+  } else if(!strncmp(line, "transfer-encoding:", 18)) {
+    s->chunked = (strstr(p, "chunked") != NULL);
+#if HTTP_SOCKET_KEEPALIVE
+  } else if(!strncmp(line, "connection:", 11)) {
+    /* The values are "close" and "keep-alive" */
+    s->response_close = (*p == 'c');
+#endif /* HTTP_SOCKET_KEEPALIVE */
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Parse the response header, a line at a time. Only the start of a
+   line that does not fit the line buffer is kept, which is all that
+   is parsed of it. Returns the number of bytes consumed, which are
+   all of them unless the end of the header or an error is reached. */
+static int
+parse_header(struct http_socket *s, const uint8_t *data, int len)
+{
+  const uint8_t *end;
+  int used, n, copylen;
 
-    /* All headers read, now read data */
-    call_callback(s, HTTP_SOCKET_HEADER, (void *)&s->header, sizeof(s->header));
+  used = 0;
+  while(used < len) {
+    end = memchr(&data[used], '\n', len - used);
+    n = (end == NULL ? len : end - data + 1) - used;
+    copylen = MIN(n, (int)sizeof(s->header_line) - 1 - s->header_linelen);
+    for(; copylen > 0; copylen--) {
+      s->header_line[s->header_linelen++] = tolower((int)data[used++]);
+      n--;
+    }
+    used += n;
+    if(end == NULL) {
+      break;
+    }
 
-    /* Should exit the pt here to indicate that all headers have been
-       read */
-    PT_EXIT(&s->headerpt);
-  } else {
-    if(s->header.status_code == 0x404) {
-      printf("File not found\n");
-    } else if(s->header.status_code == 0x301 || s->header.status_code == 0x302) {
-      printf("File moved (not handled)\n");
+    /* A full line, without its CRLF */
+    while(s->header_linelen > 0 &&
+          (s->header_line[s->header_linelen - 1] == '\n' ||
+           s->header_line[s->header_linelen - 1] == '\r')) {
+      s->header_linelen--;
     }
+    s->header_line[s->header_linelen] = '\0';
 
-    call_callback(s, HTTP_SOCKET_ERR, (void *)&s->header, sizeof(s->header));
-    tcp_socket_close(&s->s);
-    removesocket(s);
-    PT_EXIT(&s->headerpt);
+    if(s->header.status_code == (uint16_t)-1) {
+      if(!parse_status_line(s, s->header_line)) {
+        s->header_received = 1;
+        break;
+      }
+    } else if(s->header_linelen == 0) {
+      /* This was an empty line, i.e. the end of headers */
+      s->header_received = 1;
+      call_callback(s, HTTP_SOCKET_HEADER, (void *)&s->header,
+                    sizeof(s->header));
+      break;
+    } else {
+      parse_header_line(s, s->header_line);
+    }
+    s->header_linelen = 0;
   }
+  return used;
+}
+/*---------------------------------------------------------------------------*/
+/* Pass the data of a chunked body to the application without the
+   chunk framing. Returns non-zero at the end of the body. */
+static int
+parse_chunked(struct http_socket *s,
+              const uint8_t **inputptr, int *inputdatalen)
+{
+  uint8_t c;
+  int len;
+
+  while(*inputdatalen > 0) {
+    if(s->chunk_state == CHUNK_DATA) {
+      len = MIN(*inputdatalen, s->chunk_left);
+      call_callback(s, HTTP_SOCKET_DATA, *inputptr, len);
+      s->bodylen += len;
+      s->chunk_left -= len;
+      *inputptr += len;
+      *inputdatalen -= len;
+      if(s->chunk_left == 0) {
+        s->chunk_state = CHUNK_DATA_END;
+      }
+      continue;
+    }
 
+    c = **inputptr;
+    (*inputptr)++;
+    (*inputdatalen)--;
 
-  PT_END(&s->headerpt);
+    if(c == '\n') {
+      if(s->chunk_state == CHUNK_SIZE || s->chunk_state == CHUNK_EXTENSION) {
+        if(s->chunk_left == 0) {
+          /* The last chunk, followed by the trailer */
+          s->chunk_state = CHUNK_TRAILER;
+          s->header_linelen = 0;
+        } else {
+          s->chunk_state = CHUNK_DATA;
+        }
+      } else if(s->chunk_state == CHUNK_DATA_END) {
+        s->chunk_state = CHUNK_SIZE;
+      } else if(s->header_linelen == 0) {
+        /* The empty line that ends the trailer */
+        return 1;
+      } else {
+        s->header_linelen = 0;
+      }
+    } else if(c != '\r') {
+      if(s->chunk_state == CHUNK_SIZE) {
+        if(isxdigit((int)c)) {
+          s->chunk_left = s->chunk_left << 4 |
+            (isdigit((int)c) ? c - '0' : (tolower((int)c) - 'a' + 10));
+        } else {
+          s->chunk_state = CHUNK_EXTENSION;
+        }
+      } else if(s->chunk_state == CHUNK_TRAILER) {
+        s->header_linelen = 1;
+      }
+    }
+  }
+  return 0;
 }
 /*---------------------------------------------------------------------------*/
 static int
 input_pt(struct http_socket *s,
-         const uint8_t *inputptr, int inputdatalen)
+         const uint8_t **inputptr, int *inputdatalen)
 {
   int i;
+#if HTTP_SOCKET_KEEPALIVE
+  int len;
+#endif /* HTTP_SOCKET_KEEPALIVE */
   PT_BEGIN(&s->pt);
 
   /* Parse the header */
   s->header_received = 0;
   do {
-    for(i = 0; i < inputdatalen; i++) {
-      if(!PT_SCHEDULE(parse_header_byte(s, inputptr[i]))) {
-        s->header_received = 1;
-        break;
-      }
-    }
-    inputdatalen -= i;
-    inputptr += i;
+    i = parse_header(s, *inputptr, *inputdatalen);
+    *inputdatalen -= i;
+    *inputptr += i;
 
     if(s->header_received == 0) {
       /* If we have not yet received the full header, we wait for the
@@ -248,21 +345,62 @@ input_pt(struct http_socket *s,
     }
   } while(s->header_received == 0);
 
+  if(s->header.status_code != 0x200 && s->header.status_code != 0x206) {
+    /* The error has been reported by the header parser */
+    PT_EXIT(&s->pt);
+  }
+
   s->bodylen = 0;
-  do {
-    /* Receive the data */
-    call_callback(s, HTTP_SOCKET_DATA, inputptr, inputdatalen);
-
-    /* Close the connection if the expected content length has been received */
-    if(s->header.content_length >= 0 && s->bodylen < s->header.content_length) {
-      s->bodylen += inputdatalen;
-      if(s->bodylen >= s->header.content_length) {
-        tcp_socket_close(&s->s);
+  if(s->chunked) {
+    s->chunk_state = CHUNK_SIZE;
+    s->chunk_left = 0;
+    while(!parse_chunked(s, inputptr, inputdatalen)) {
+      PT_YIELD(&s->pt);
+    }
+#if !HTTP_SOCKET_KEEPALIVE
+    tcp_socket_close(&s->s);
+    /* Ignore anything that follows until the connection has closed */
+    PT_WAIT_WHILE(&s->pt, 1);
+#endif /* !HTTP_SOCKET_KEEPALIVE */
+  } else {
+#if HTTP_SOCKET_KEEPALIVE
+    /* The response ends after Content-Length bytes, what follows belongs
+       to the next response on the connection. */
+    while(s->header.content_length < 0 ||
+          s->bodylen < s->header.content_length) {
+      len = *inputdatalen;
+      if(s->header.content_length >= 0 &&
+         len > s->header.content_length - s->bodylen) {
+        len = s->header.content_length - s->bodylen;
+      }
+      if(len > 0) {
+        call_callback(s, HTTP_SOCKET_DATA, *inputptr, len);
+        s->bodylen += len;
+        *inputdatalen -= len;
+        *inputptr += len;
+      }
+      if(s->header.content_length < 0 ||
+         s->bodylen < s->header.content_length) {
+        PT_YIELD(&s->pt);
       }
     }
+#else /* HTTP_SOCKET_KEEPALIVE */
+    do {
+      /* Receive the data */
+      call_callback(s, HTTP_SOCKET_DATA, *inputptr, *inputdatalen);
 
-    PT_YIELD(&s->pt);
-  } while(inputdatalen > 0);
+      /* Close the connection if the expected content length has been received */
+      if(s->header.content_length >= 0 && s->bodylen < s->header.content_length) {
+        s->bodylen += *inputdatalen;
+        if(s->bodylen >= s->header.content_length) {
+          tcp_socket_close(&s->s);
+        }
+      }
+
+      PT_YIELD(&s->pt);
+    } while(*inputdatalen > 0);
+#endif /* HTTP_SOCKET_KEEPALIVE */
+  }
 
   PT_END(&s->pt);
 }
@@ -276,17 +414,19 @@ start_timeout_timer(struct http_socket *s)
   s->timeout_timer_started = 1;
 }
 /*---------------------------------------------------------------------------*/
+#if !HTTP_SOCKET_KEEPALIVE
 static int
 input(struct tcp_socket *tcps, void *ptr,
       const uint8_t *inputptr, int inputdatalen)
 {
   struct http_socket *s = ptr;
 
-  input_pt(s, inputptr, inputdatalen);
+  input_pt(s, &inputptr, &inputdatalen);
   start_timeout_timer(s);
 
   return 0; /* all data consumed */
 }
+#endif /* !HTTP_SOCKET_KEEPALIVE */
 /*---------------------------------------------------------------------------*/
 static int
 parse_url(const char *url, char *host, uint16_t *portptr, char *path)
@@ -387,64 +527,390 @@ removesocket(struct http_socket *s)
   list_remove(socketlist, s);
 }
 /*---------------------------------------------------------------------------*/
-static void
-event(struct tcp_socket *tcps, void *ptr,
-      tcp_socket_event_t e)
+static int
+send_str(struct tcp_socket *tcps, const char *str, int send)
+{
+  if(send) {
+    tcp_socket_send_str(tcps, str);
+  }
+  return strlen(str);
+}
+/*---------------------------------------------------------------------------*/
+/* Send the request line and header of the request, or only count their
+   length if send is zero. */
+static int
+send_request(struct tcp_socket *tcps, struct http_socket *s, int send)
 {
-  struct http_socket *s = ptr;
   char host[MAX_HOSTLEN];
   char path[MAX_PATHLEN];
   uint16_t port;
   char str[42];
   int len;
 
+  if(!parse_url(s->url, host, &port, path)) {
+    return 0;
+  }
+
+  len = send_str(tcps, IS_POST(s) ? "POST " : "GET ", send);
+  if(s->proxy_port != 0) {
+    /* If we are configured to route through a proxy, we should
+       provide the full URL as the path. */
+    len += send_str(tcps, s->url, send);
+  } else {
+    len += send_str(tcps, path, send);
+  }
+  len += send_str(tcps, " HTTP/1.1\r\n", send);
+#if !HTTP_SOCKET_KEEPALIVE
+  len += send_str(tcps, "Connection: close\r\n", send);
+#endif /* !HTTP_SOCKET_KEEPALIVE */
+  len += send_str(tcps, "Host: ", send);
+  len += send_str(tcps, host, send);
+  len += send_str(tcps, "\r\n", send);
+  if(IS_POST(s)) {
+    if(s->content_type) {
+      len += send_str(tcps, "Content-Type: ", send);
+      len += send_str(tcps, s->content_type, send);
+      len += send_str(tcps, "\r\n", send);
+    }
+    len += send_str(tcps, "Content-Length: ", send);
+    if(s->body_callback != NULL) {
+      sprintf(str, "%lu", (unsigned long)s->body_len);
+    } else {
+      sprintf(str, "%u", s->postdatalen);
+    }
+    len += send_str(tcps, str, send);
+    len += send_str(tcps, "\r\n", send);
+  } else if(s->length || s->pos > 0) {
+    len += send_str(tcps, "Range: bytes=", send);
+    if(s->length) {
+      if(s->pos >= 0) {
+        sprintf(str, "%llu-%llu", s->pos, s->pos + s->length - 1);
+      } else {
+        sprintf(str, "-%llu", s->length);
+      }
+    } else {
+      sprintf(str, "%llu-", s->pos);
+    }
+    len += send_str(tcps, str, send);
+    len += send_str(tcps, "\r\n", send);
+  }
+  len += send_str(tcps, "\r\n", send);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+generate_body(struct tcp_socket *tcps, const void *ptr,
+              uint8_t *buf, uint16_t offset, uint16_t len)
+{
+  struct http_socket *s = (struct http_socket *)ptr;
+
+  s->body_callback(s, s->callbackptr, buf, s->body_offset + offset, len);
+}
+/*---------------------------------------------------------------------------*/
+/* Send the next part of the body of a POST request. A streamed body is
+   sent in parts of up to 64 kilobytes that are generated as they are
+   transmitted. Returns non-zero while there is more to send. */
+static int
+send_body(struct tcp_socket *tcps, struct http_socket *s)
+{
+  uint32_t len;
+
+  if(s->body_callback != NULL) {
+    if(s->body_sent < s->body_len) {
+      len = MIN(s->body_len - s->body_sent, 0xffff);
+      if(tcp_socket_send_generated(tcps, generate_body, s, len) > 0) {
+        s->body_offset = s->body_sent;
+        s->body_sent += len;
+      }
+    }
+    return s->body_sent < s->body_len;
+  }
+
+  if(s->postdata != NULL && s->postdatalen) {
+    len = tcp_socket_send_ref(tcps, s->postdata, s->postdatalen);
+    s->postdata += len;
+    s->postdatalen -= len;
+  }
+  return s->postdata != NULL && s->postdatalen > 0;
+}
+/*---------------------------------------------------------------------------*/
+#if HTTP_SOCKET_KEEPALIVE
+/* The requests queued on a connection are the HTTP sockets that refer
+   to it, in the order of the socket list. The first one is the one
+   that the next response belongs to. */
+static struct http_socket *
+first_request(struct http_socket_conn *c)
+{
+  struct http_socket *s;
+
+  for(s = list_head(socketlist); s != NULL; s = list_item_next(s)) {
+    if(s->conn == c) {
+      return s;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_next(struct http_socket_conn *c)
+{
+  struct http_socket *s;
+  uint8_t outstanding;
+  int len;
+
+  if(c->state != CONN_CONNECTED) {
+    return;
+  }
+
+  outstanding = 0;
+  for(s = list_head(socketlist); s != NULL; s = list_item_next(s)) {
+    if(s->conn != c) {
+      continue;
+    }
+    if(s->request_state != REQUEST_QUEUED) {
+      if(!HTTP_SOCKET_PIPELINE || IS_POST(s)) {
+        return;
+      }
+      outstanding = 1;
+      continue;
+    }
+    if(outstanding && IS_POST(s)) {
+      return;
+    }
+
+    /* Wait for room in the output buffer, unless the request would
+       not fit even in an empty one. */
+    len = send_request(&c->s, s, 0);
+    if(len > tcp_socket_max_sendlen(&c->s) &&
+       tcp_socket_max_sendlen(&c->s) < HTTP_SOCKET_OUTPUTBUFSIZE) {
+      return;
+    }
+
+    send_request(&c->s, s, 1);
+    send_body(&c->s, s);
+    s->request_state = REQUEST_SENT;
+    parse_header_init(s);
+    PT_INIT(&s->pt);
+    if(!HTTP_SOCKET_PIPELINE || IS_POST(s)) {
+      return;
+    }
+    outstanding = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_connection(struct http_socket_conn *c)
+{
+  if(c->state == CONN_CONNECTING || c->state == CONN_CONNECTED) {
+    c->state = CONN_CLOSING;
+    tcp_socket_close(&c->s);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_done(struct http_socket *s)
+{
+  struct http_socket_conn *c = s->conn;
+  uint8_t close_conn = s->response_close;
+
+  c->served = 1;
+  /* Remove the socket first, so that the callback can start another
+     request with it. */
+  removesocket(s);
+  call_callback(s, HTTP_SOCKET_CLOSED, NULL, 0);
+
+  if(close_conn) {
+    close_connection(c);
+  } else if(first_request(c) == NULL) {
+    PROCESS_CONTEXT_BEGIN(&http_socket_process);
+    etimer_set(&c->idle_timer, HTTP_SOCKET_IDLE_TIMEOUT);
+    PROCESS_CONTEXT_END(&http_socket_process);
+    /* Requests that wait for a connection may take this one */
+    process_poll(&http_socket_process);
+  } else {
+    send_next(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+input(struct tcp_socket *tcps, void *ptr,
+      const uint8_t *inputptr, int inputdatalen)
+{
+  struct http_socket_conn *c = ptr;
+  struct http_socket *s;
+
+  /* The data may hold the end of one response and the start of the
+     next one. */
+  while(inputdatalen > 0 && c->state == CONN_CONNECTED) {
+    s = first_request(c);
+    if(s == NULL || s->request_state == REQUEST_QUEUED) {
+      break;
+    }
+    s->request_state = REQUEST_RECEIVING;
+    start_timeout_timer(s);
+    if(input_pt(s, &inputptr, &inputdatalen) == PT_ENDED) {
+      response_done(s);
+    }
+  }
+
+  return 0; /* all data consumed */
+}
+/*---------------------------------------------------------------------------*/
+static void
+event(struct tcp_socket *tcps, void *ptr,
+      tcp_socket_event_t e)
+{
+  struct http_socket_conn *c = ptr;
+  struct http_socket *s;
+
   if(e == TCP_SOCKET_CONNECTED) {
     printf("Connected\n");
-    if(parse_url(s->url, host, &port, path)) {
-      tcp_socket_send_str(tcps, s->postdata != NULL ? "POST " : "GET ");
-      if(s->proxy_port != 0) {
-        /* If we are configured to route through a proxy, we should
-           provide the full URL as the path. */
-        tcp_socket_send_str(tcps, s->url);
+    c->state = CONN_CONNECTED;
+    send_next(c);
+  } else if(e == TCP_SOCKET_DATA_SENT) {
+    /* Nothing is sent after a POST request until it has been answered,
+       so a body being sent is that of the first request. */
+    s = first_request(c);
+    if(s != NULL && s->request_state != REQUEST_QUEUED && IS_POST(s)) {
+      send_body(&c->s, s);
+    }
+    send_next(c);
+    if(s != NULL) {
+      start_timeout_timer(s);
+    }
+  } else {
+    s = first_request(c);
+    /* A response that was being received ends here. So do a POST
+       request that has been sent, which must not be repeated, and the
+       first request if the connection failed before it served any. If
+       we closed the connection or the server closed it after serving
+       some requests, the request is retried. */
+    if(s != NULL &&
+       (s->request_state == REQUEST_RECEIVING ||
+        (s->request_state == REQUEST_SENT && IS_POST(s)) ||
+        (c->state != CONN_CLOSING && !c->served))) {
+      removesocket(s);
+      if(e == TCP_SOCKET_CLOSED) {
+        call_callback(s, HTTP_SOCKET_CLOSED, NULL, 0);
+      } else if(e == TCP_SOCKET_TIMEDOUT) {
+        call_callback(s, HTTP_SOCKET_TIMEDOUT, NULL, 0);
       } else {
-        tcp_socket_send_str(tcps, path);
+        call_callback(s, HTTP_SOCKET_ABORTED, NULL, 0);
       }
-      tcp_socket_send_str(tcps, " HTTP/1.1\r\n");
-      tcp_socket_send_str(tcps, "Connection: close\r\n");
-      tcp_socket_send_str(tcps, "Host: ");
-      tcp_socket_send_str(tcps, host);
-      tcp_socket_send_str(tcps, "\r\n");
-      if(s->postdata != NULL) {
-        if(s->content_type) {
-          tcp_socket_send_str(tcps, "Content-Type: ");
-          tcp_socket_send_str(tcps, s->content_type);
-          tcp_socket_send_str(tcps, "\r\n");
-        }
-        tcp_socket_send_str(tcps, "Content-Length: ");
-        sprintf(str, "%u", s->postdatalen);
-        tcp_socket_send_str(tcps, str);
-        tcp_socket_send_str(tcps, "\r\n");
-      } else if(s->length || s->pos > 0) {
-        tcp_socket_send_str(tcps, "Range: bytes=");
-        if(s->length) {
-          if(s->pos >= 0) {
-            sprintf(str, "%llu-%llu", s->pos, s->pos + s->length - 1);
-          } else {
-            sprintf(str, "-%llu", s->length);
-          }
-        } else {
-          sprintf(str, "%llu-", s->pos);
-        }
-        tcp_socket_send_str(tcps, str);
-        tcp_socket_send_str(tcps, "\r\n");
+    }
+    for(s = list_head(socketlist); s != NULL; s = list_item_next(s)) {
+      if(s->conn == c) {
+        s->conn = NULL;
+      }
+    }
+    /* The connection is freed and the remaining requests are restarted
+       by the process, outside of the TCP socket callback. */
+    c->state = CONN_CLOSED;
+    process_poll(&http_socket_process);
+    printf("Closed\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+connect_socket(struct http_socket *s, uip_ipaddr_t *addr, uint16_t port)
+{
+  struct http_socket_conn *c;
+
+  s->did_tcp_connect = 1;
+  s->request_state = REQUEST_QUEUED;
+
+  for(c = list_head(connlist); c != NULL; c = list_item_next(c)) {
+    if((c->state == CONN_CONNECTING || c->state == CONN_CONNECTED) &&
+       c->port == port && uip_ipaddr_cmp(&c->addr, addr)) {
+      s->conn = c;
+      etimer_stop(&c->idle_timer);
+      send_next(c);
+      return HTTP_SOCKET_OK;
+    }
+  }
+
+  c = memb_alloc(&conns);
+  if(c == NULL) {
+    /* Close an idle connection to make room. The request is started
+       when it has closed. */
+    for(c = list_head(connlist); c != NULL; c = list_item_next(c)) {
+      if(c->state == CONN_CONNECTED && first_request(c) == NULL) {
+        close_connection(c);
+        break;
       }
-      tcp_socket_send_str(tcps, "\r\n");
-      if(s->postdata != NULL && s->postdatalen) {
-        len = tcp_socket_send(tcps, s->postdata, s->postdatalen);
-        s->postdata += len;
-        s->postdatalen -= len;
+    }
+    return HTTP_SOCKET_OK;
+  }
+
+  uip_ipaddr_copy(&c->addr, addr);
+  c->port = port;
+  c->state = CONN_CONNECTING;
+  c->served = 0;
+  tcp_socket_register(&c->s, c,
+                      c->inputbuf, sizeof(c->inputbuf),
+                      c->outputbuf, sizeof(c->outputbuf),
+                      input, event);
+  if(tcp_socket_connect(&c->s, addr, port) < 0) {
+    tcp_socket_unregister(&c->s);
+    memb_free(&conns, c);
+    return HTTP_SOCKET_ERR;
+  }
+  list_add(connlist, c);
+  s->conn = c;
+  return HTTP_SOCKET_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_socket(struct http_socket *s)
+{
+  /* The requests that follow on the connection are retried on a new
+     one. */
+  if(s->conn != NULL && s->request_state != REQUEST_QUEUED) {
+    close_connection(s->conn);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_connections(void)
+{
+  struct http_socket_conn *c, *next;
+  struct http_socket *s, *snext;
+
+  for(c = list_head(connlist); c != NULL; c = next) {
+    next = list_item_next(c);
+    if(c->state == CONN_CLOSED) {
+      etimer_stop(&c->idle_timer);
+      tcp_socket_unregister(&c->s);
+      list_remove(connlist, c);
+      memb_free(&conns, c);
+    }
+  }
+
+  /* Restart the requests that wait for a connection */
+  for(s = list_head(socketlist); s != NULL; s = snext) {
+    snext = list_item_next(s);
+    if(s->did_tcp_connect && s->conn == NULL) {
+      s->did_tcp_connect = 0;
+      if(start_request(s) == HTTP_SOCKET_ERR) {
+        removesocket(s);
+        call_callback(s, HTTP_SOCKET_ERR, NULL, 0);
       }
     }
+  }
+}
+#else /* HTTP_SOCKET_KEEPALIVE */
+/*---------------------------------------------------------------------------*/
+static void
+event(struct tcp_socket *tcps, void *ptr,
+      tcp_socket_event_t e)
+{
+  struct http_socket *s = ptr;
+
+  if(e == TCP_SOCKET_CONNECTED) {
+    printf("Connected\n");
+    if(send_request(tcps, s, 1) > 0) {
+      send_body(tcps, s);
+    }
     parse_header_init(s);
   } else if(e == TCP_SOCKET_CLOSED) {
     call_callback(s, HTTP_SOCKET_CLOSED, NULL, 0);
@@ -459,17 +925,27 @@ event(struct tcp_socket *tcps, void *ptr,
     removesocket(s);
     printf("Aborted\n");
   } else if(e == TCP_SOCKET_DATA_SENT) {
-    if(s->postdata != NULL && s->postdatalen) {
-      len = tcp_socket_send(tcps, s->postdata, s->postdatalen);
-      s->postdata += len;
-      s->postdatalen -= len;
-    } else {
+    if(!send_body(tcps, s)) {
       start_timeout_timer(s);
     }
   }
 }
 /*---------------------------------------------------------------------------*/
 static int
+connect_socket(struct http_socket *s, uip_ipaddr_t *addr, uint16_t port)
+{
+  tcp_socket_connect(&s->s, addr, port);
+  return HTTP_SOCKET_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_socket(struct http_socket *s)
+{
+  tcp_socket_close(&s->s);
+}
+#endif /* HTTP_SOCKET_KEEPALIVE */
+/*---------------------------------------------------------------------------*/
+static int
 start_request(struct http_socket *s)
 {
   uip_ip4addr_t ip4addr;
@@ -506,15 +982,13 @@ start_request(struct http_socket *s)
         }
         if(addr != NULL) {
           s->did_tcp_connect = 1;
-          tcp_socket_connect(&s->s, addr, port);
-          return HTTP_SOCKET_OK;
+          return connect_socket(s, addr, port);
         } else {
           return HTTP_SOCKET_ERR;
         }
       }
     }
-    tcp_socket_connect(&s->s, &ip6addr, port);
-    return HTTP_SOCKET_OK;
+    return connect_socket(s, &ip6addr, port);
   } else {
     return HTTP_SOCKET_ERR;
   }
@@ -565,10 +1039,27 @@ PROCESS_THREAD(http_socket_process, ev, data)
           s != NULL;
           s = list_item_next(s)) {
         if(timeout_timer == &s->timeout_timer && s->timeout_timer_started) {
-          tcp_socket_close(&s->s);
+#if HTTP_SOCKET_KEEPALIVE
+          removesocket(s);
+          call_callback(s, HTTP_SOCKET_TIMEDOUT, NULL, 0);
+#endif /* HTTP_SOCKET_KEEPALIVE */
+          close_socket(s);
           break;
         }
       }
+#if HTTP_SOCKET_KEEPALIVE
+      {
+        struct http_socket_conn *c;
+        for(c = list_head(connlist); c != NULL; c = list_item_next(c)) {
+          if(timeout_timer == &c->idle_timer && first_request(c) == NULL) {
+            close_connection(c);
+            break;
+          }
+        }
+      }
+    } else if(ev == PROCESS_EVENT_POLL) {
+      free_connections();
+#endif /* HTTP_SOCKET_KEEPALIVE */
     }
   }
 
@@ -582,6 +1073,10 @@ init(void)
   if(inited == 0) {
     process_start(&http_socket_process, NULL);
     list_init(socketlist);
+#if HTTP_SOCKET_KEEPALIVE
+    memb_init(&conns);
+    list_init(connlist);
+#endif /* HTTP_SOCKET_KEEPALIVE */
     inited = 1;
   }
 }
@@ -601,12 +1096,18 @@ initialize_socket(struct http_socket *s)
   s->length = 0;
   s->postdata = NULL;
   s->postdatalen = 0;
+  s->body_callback = NULL;
   s->timeout_timer_started = 0;
   PT_INIT(&s->pt);
+#if HTTP_SOCKET_KEEPALIVE
+  s->conn = NULL;
+  s->response_close = 0;
+#else /* HTTP_SOCKET_KEEPALIVE */
   tcp_socket_register(&s->s, s,
                       s->inputbuf, sizeof(s->inputbuf),
                       s->outputbuf, sizeof(s->outputbuf),
                       input, event);
+#endif /* HTTP_SOCKET_KEEPALIVE */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -617,6 +1118,8 @@ http_socket_get(struct http_socket *s,
                 http_socket_callback_t callback,
                 void *callbackptr)
 {
+  int ret;
+
   initialize_socket(s);
   strncpy(s->url, url, sizeof(s->url));
   s->pos = pos;
@@ -628,7 +1131,11 @@ http_socket_get(struct http_socket *s,
 
   list_add(socketlist, s);
 
-  return start_request(s);
+  ret = start_request(s);
+  if(ret == HTTP_SOCKET_ERR) {
+    removesocket(s);
+  }
+  return ret;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -640,6 +1147,8 @@ http_socket_post(struct http_socket *s,
                  http_socket_callback_t callback,
                  void *callbackptr)
 {
+  int ret;
+
   initialize_socket(s);
   strncpy(s->url, url, sizeof(s->url));
   s->postdata = postdata;
@@ -653,7 +1162,43 @@ http_socket_post(struct http_socket *s,
 
   list_add(socketlist, s);
 
-  return start_request(s);
+  ret = start_request(s);
+  if(ret == HTTP_SOCKET_ERR) {
+    removesocket(s);
+  }
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+int
+http_socket_post_stream(struct http_socket *s,
+                        const char *url,
+                        http_socket_body_callback_t body_callback,
+                        uint32_t bodylen,
+                        const char *content_type,
+                        http_socket_callback_t callback,
+                        void *callbackptr)
+{
+  int ret;
+
+  initialize_socket(s);
+  strncpy(s->url, url, sizeof(s->url));
+  s->body_callback = body_callback;
+  s->body_len = bodylen;
+  s->body_sent = 0;
+  s->content_type = content_type;
+
+  s->callback = callback;
+  s->callbackptr = callbackptr;
+
+  s->did_tcp_connect = 0;
+
+  list_add(socketlist, s);
+
+  ret = start_request(s);
+  if(ret == HTTP_SOCKET_ERR) {
+    removesocket(s);
+  }
+  return ret;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -664,7 +1209,7 @@ http_socket_close(struct http_socket *socket)
       s != NULL;
       s = list_item_next(s)) {
     if(s == socket) {
-      tcp_socket_close(&s->s);
+      close_socket(s);
       removesocket(s);
       return 1;
     }
@@ -62,6 +62,17 @@ typedef void (* http_socket_callback_t)(struct http_socket *s,
                                         const uint8_t *data,
                                         uint16_t datalen);
 
+/* The body of a streamed POST request is produced by a callback that
+   writes len bytes of it, starting at offset, to buf. The callback is
+   called when the data is transmitted, and again for the same offset
+   if it has to be retransmitted, so the body must not change until the
+   request has completed. */
+typedef void (* http_socket_body_callback_t)(struct http_socket *s,
+                                             void *ptr,
+                                             uint8_t *buf,
+                                             uint32_t offset,
+                                             uint16_t len);
+
 #define MAX(n, m)   (((n) < (m)) ? (m) : (n))
 
 #define HTTP_SOCKET_INPUTBUFSIZE  UIP_TCP_MSS
@@ -69,31 +80,87 @@ typedef void (* http_socket_callback_t)(struct http_socket *s,
 
 #define HTTP_SOCKET_URLLEN        128
 
+/* The length of the start of a header line that is parsed */
+#define HTTP_SOCKET_HEADER_LINELEN 64
+
 #define HTTP_SOCKET_TIMEOUT       ((2 * 60 + 30) * CLOCK_SECOND)
 
+/* Keep the connections open between requests. The connections are
+   taken from a pool shared by all HTTP sockets, and a request is sent
+   on an open connection to the same host and port if there is one,
+   after the requests that are already queued on it. The end of a
+   response is signalled with HTTP_SOCKET_CLOSED as before. A response
+   without a Content-Length ends when the server closes the
+   connection. */
+#ifdef HTTP_SOCKET_CONF_KEEPALIVE
+#define HTTP_SOCKET_KEEPALIVE HTTP_SOCKET_CONF_KEEPALIVE
+#else /* HTTP_SOCKET_CONF_KEEPALIVE */
+#define HTTP_SOCKET_KEEPALIVE 0
+#endif /* HTTP_SOCKET_CONF_KEEPALIVE */
+
+/* The number of connections in the pool */
+#ifdef HTTP_SOCKET_CONF_CONNECTIONS
+#define HTTP_SOCKET_CONNECTIONS HTTP_SOCKET_CONF_CONNECTIONS
+#else /* HTTP_SOCKET_CONF_CONNECTIONS */
+#define HTTP_SOCKET_CONNECTIONS 1
+#endif /* HTTP_SOCKET_CONF_CONNECTIONS */
+
+/* Send the queued GET requests on a connection without waiting for
+   the responses to the previous ones. POST requests are never
+   pipelined. */
+#ifdef HTTP_SOCKET_CONF_PIPELINE
+#define HTTP_SOCKET_PIPELINE HTTP_SOCKET_CONF_PIPELINE
+#else /* HTTP_SOCKET_CONF_PIPELINE */
+#define HTTP_SOCKET_PIPELINE 0
+#endif /* HTTP_SOCKET_CONF_PIPELINE */
+
+/* The time a connection without requests is kept open */
+#ifdef HTTP_SOCKET_CONF_IDLE_TIMEOUT
+#define HTTP_SOCKET_IDLE_TIMEOUT HTTP_SOCKET_CONF_IDLE_TIMEOUT
+#else /* HTTP_SOCKET_CONF_IDLE_TIMEOUT */
+#define HTTP_SOCKET_IDLE_TIMEOUT (30 * CLOCK_SECOND)
+#endif /* HTTP_SOCKET_CONF_IDLE_TIMEOUT */
+
+struct http_socket_conn;
+
 struct http_socket {
   struct http_socket *next;
+#if HTTP_SOCKET_KEEPALIVE
+  struct http_socket_conn *conn;
+  uint8_t request_state;
+  uint8_t response_close;
+#else /* HTTP_SOCKET_KEEPALIVE */
   struct tcp_socket s;
+#endif /* HTTP_SOCKET_KEEPALIVE */
   uip_ipaddr_t proxy_addr;
   uint16_t proxy_port;
   int64_t pos;
   uint64_t length;
   const uint8_t *postdata;
   uint16_t postdatalen;
+  http_socket_body_callback_t body_callback;
+  uint32_t body_len;
+  uint32_t body_offset;
+  uint32_t body_sent;
   http_socket_callback_t callback;
   void *callbackptr;
   int did_tcp_connect;
   char url[HTTP_SOCKET_URLLEN];
+#if !HTTP_SOCKET_KEEPALIVE
   uint8_t inputbuf[HTTP_SOCKET_INPUTBUFSIZE];
   uint8_t outputbuf[HTTP_SOCKET_OUTPUTBUFSIZE];
+#endif /* !HTTP_SOCKET_KEEPALIVE */
 
   struct etimer timeout_timer;
   uint8_t timeout_timer_started;
-  struct pt pt, headerpt;
-  int header_chars;
-  char header_field[15];
+  struct pt pt;
+  uint8_t header_linelen;
+  char header_line[HTTP_SOCKET_HEADER_LINELEN];
   struct http_socket_header header;
   uint8_t header_received;
+  uint8_t chunked;
+  uint8_t chunk_state;
+  uint32_t chunk_left;
   uint64_t bodylen;
   const char *content_type;
 };
@@ -112,6 +179,13 @@ int http_socket_post(struct http_socket *s, const char *url,
                      http_socket_callback_t callback,
                      void *callbackptr);
 
+int http_socket_post_stream(struct http_socket *s, const char *url,
+                            http_socket_body_callback_t body_callback,
+                            uint32_t bodylen,
+                            const char *content_type,
+                            http_socket_callback_t callback,
+                            void *callbackptr);
+
 int http_socket_close(struct http_socket *socket);
 
 void http_socket_set_proxy(struct http_socket *s,
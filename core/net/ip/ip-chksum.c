@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2001-2003, Adam Dunkels.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the uIP TCP/IP stack.
+ *
+ */
+
+/**
+ * \file
+ *         The Internet checksum, shared by uIP and IP64.
+ */
+
+#include "net/ip/uip.h"
+#include "net/ip/ip-chksum.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if !IP_CHKSUM_ARCH
+/*---------------------------------------------------------------------------*/
+static uint16_t
+add_bytes(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = data + len - 1;
+
+  while(dataptr < last_byte) {   /* At least two more bytes */
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+  }
+
+  /* Return sum in host byte order. */
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+#if IP_CHKSUM_WORD
+#define ADD_WORD(acc, p) do {                   \
+    uint32_t w;                                 \
+    memcpy(&w, (p), sizeof(w));                 \
+    (acc) += (w & 0xffff) + (w >> 16);          \
+  } while(0)
+
+/* Sum 32-bit aligned words. The halves of each word are added to a
+   32-bit accumulator, which cannot overflow for buffers of up to 64
+   kilobytes, so no carries have to be handled in the loop. The sum of
+   words in the CPU byte order is the byte-swapped sum of big-endian
+   words (RFC 1071). */
+static uint16_t
+add_words(uint16_t sum, const uint8_t *data, uint16_t words)
+{
+  uint32_t acc;
+  uint16_t t;
+
+  acc = 0;
+  while(words >= 4) {
+    ADD_WORD(acc, data);
+    ADD_WORD(acc, data + 4);
+    ADD_WORD(acc, data + 8);
+    ADD_WORD(acc, data + 12);
+    data += 16;
+    words -= 4;
+  }
+  while(words > 0) {
+    ADD_WORD(acc, data);
+    data += 4;
+    words--;
+  }
+
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+#if UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN
+  t = (uint16_t)((acc << 8) | (acc >> 8));
+#else /* UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN */
+  t = (uint16_t)acc;
+#endif /* UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN */
+
+  sum += t;
+  if(sum < t) {
+    sum++;      /* carry */
+  }
+  return sum;
+}
+#endif /* IP_CHKSUM_WORD */
+/*---------------------------------------------------------------------------*/
+uint16_t
+ip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+#if IP_CHKSUM_WORD
+  uint16_t words;
+
+  /* A buffer at an odd address would have its words split across
+     32-bit words, so it is summed a byte at a time. */
+  if(((uintptr_t)data & 1) == 0) {
+    if(((uintptr_t)data & 2) != 0 && len >= 2) {
+      sum = add_bytes(sum, data, 2);
+      data += 2;
+      len -= 2;
+    }
+    words = len / 4;
+    sum = add_words(sum, data, words);
+    data += words * 4;
+    len -= words * 4;
+  }
+#endif /* IP_CHKSUM_WORD */
+  return add_bytes(sum, data, len);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* !IP_CHKSUM_ARCH */
+/*---------------------------------------------------------------------------*/
+static uint16_t
+add16(uint16_t sum, uint16_t t)
+{
+  sum += t;
+  if(sum < t) {
+    sum++;      /* carry */
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ip_chksum_adjust(uint16_t chksum, uint16_t old_sum, uint16_t new_sum)
+{
+  uint16_t sum;
+
+  /* HC' = ~(~HC + ~m + m') */
+  sum = add16(~chksum, ~old_sum);
+  sum = add16(sum, new_sum);
+  return ~sum;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2001-2003, Adam Dunkels.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the uIP TCP/IP stack.
+ *
+ */
+
+/**
+ * \file
+ *         The Internet checksum, shared by uIP and IP64.
+ */
+
+/**
+ * \addtogroup uiparch
+ * @{
+ */
+
+#ifndef IP_CHKSUM_H_
+#define IP_CHKSUM_H_
+
+#include "contiki-conf.h"
+
+/*
+ * With IP_CHKSUM_CONF_WORD, the checksum is computed 32 bits at a time
+ * into a 32-bit accumulator, four words per loop iteration, which is
+ * several times faster than the byte loop on 32-bit CPUs. It only pays
+ * off where 32-bit arithmetic is native.
+ */
+#ifdef IP_CHKSUM_CONF_WORD
+#define IP_CHKSUM_WORD IP_CHKSUM_CONF_WORD
+#else /* IP_CHKSUM_CONF_WORD */
+#define IP_CHKSUM_WORD 0
+#endif /* IP_CHKSUM_CONF_WORD */
+
+/*
+ * With IP_CHKSUM_CONF_ARCH, ip_chksum_add() is not compiled in, and
+ * the CPU or platform provides it instead, for instance in assembler
+ * or with a checksum engine.
+ */
+#ifdef IP_CHKSUM_CONF_ARCH
+#define IP_CHKSUM_ARCH IP_CHKSUM_CONF_ARCH
+#else /* IP_CHKSUM_CONF_ARCH */
+#define IP_CHKSUM_ARCH 0
+#endif /* IP_CHKSUM_CONF_ARCH */
+
+/**
+ * Add the 16-bit words of a buffer to a one's complement sum.
+ *
+ * The buffer is summed as big-endian 16-bit words; an odd last byte is
+ * padded with a zero byte.
+ *
+ * \param sum The sum so far, in host byte order.
+ * \param data The buffer, which need not be aligned.
+ * \param len The length of the buffer.
+ * \return The new sum, in host byte order.
+ */
+uint16_t ip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len);
+
+/**
+ * Update a checksum for changed data, without summing all of the
+ * covered data again (RFC 1624).
+ *
+ * \param chksum The checksum field before the change, in host byte order.
+ * \param old_sum The sum of the changed data before the change, as
+ *                computed with ip_chksum_add().
+ * \param new_sum The sum of the changed data after the change.
+ * \return The new checksum field, in host byte order.
+ */
+uint16_t ip_chksum_adjust(uint16_t chksum, uint16_t old_sum, uint16_t new_sum);
+
+#endif /* IP_CHKSUM_H_ */
+
+/** @} */
@@ -158,6 +158,47 @@ strcasecmp(const char *s1, const char *s2)
 #define RESOLV_SUPPORTS_RECORD_EXPIRATION 1
 #endif
 
+/* Seconds a failed lookup is kept as "not found", when the server does
+ * not say for how long (RFC 2308). */
+#ifdef RESOLV_CONF_NEGATIVE_TTL
+#define RESOLV_NEGATIVE_TTL RESOLV_CONF_NEGATIVE_TTL
+#else
+#define RESOLV_NEGATIVE_TTL 30
+#endif
+
+/* Upper bound, in seconds, of the time an answer is cached. */
+#ifdef RESOLV_CONF_MAX_TTL
+#define RESOLV_MAX_TTL RESOLV_CONF_MAX_TTL
+#else
+#define RESOLV_MAX_TTL 86400UL
+#endif
+
+/* If RESOLV_CONF_CACHE is set, resolv_query() answers from the cache:
+ * a name whose address, or whose "not found", is still valid is not
+ * asked for again, and a query for a name already being resolved joins
+ * it. "Not found" answers are kept for the time given by the SOA record
+ * that comes with them, and names are compared by hash first.
+ */
+#ifdef RESOLV_CONF_CACHE
+#define RESOLV_CACHE RESOLV_CONF_CACHE
+#else
+#define RESOLV_CACHE 0
+#endif
+
+/* With RESOLV_CONF_CACHE, a lookup of a cached name that expires within
+ * this number of seconds asks for it again in the background, while
+ * the cached address is still returned. 0 disables the prefetch.
+ */
+#ifdef RESOLV_CONF_PREFETCH_TIME
+#define RESOLV_PREFETCH_TIME RESOLV_CONF_PREFETCH_TIME
+#else
+#define RESOLV_PREFETCH_TIME 0
+#endif
+
+#if RESOLV_CACHE && !RESOLV_SUPPORTS_RECORD_EXPIRATION
+#error RESOLV_CONF_CACHE cannot be set without RESOLV_CONF_SUPPORTS_RECORD_EXPIRATION
+#endif
+
 #if RESOLV_CONF_SUPPORTS_MDNS && !RESOLV_VERIFY_ANSWER_NAMES
 #error RESOLV_CONF_SUPPORTS_MDNS cannot be set without RESOLV_CONF_VERIFY_ANSWER_NAMES
 #endif
@@ -178,6 +219,7 @@ strcasecmp(const char *s1, const char *s2)
 
 #define DNS_TYPE_A      1
 #define DNS_TYPE_CNAME  5
+#define DNS_TYPE_SOA    6
 #define DNS_TYPE_PTR   12
 #define DNS_TYPE_MX    15
 #define DNS_TYPE_TXT   16
@@ -263,6 +305,11 @@ struct namemap {
 #if RESOLV_CONF_SUPPORTS_MDNS
   int is_mdns:1, is_probe:1;
 #endif
+#if RESOLV_CACHE
+  uint8_t hash;
+  /* Being asked again while the cached address is still valid */
+  uint8_t is_prefetch;
+#endif /* RESOLV_CACHE */
   char name[RESOLV_CONF_MAX_DOMAIN_NAME_SIZE + 1];
 };
 
@@ -628,6 +675,75 @@ mdns_prep_host_announce_packet(void)
 }
 #endif /* RESOLV_CONF_SUPPORTS_MDNS */
 /*---------------------------------------------------------------------------*/
+/** \internal
+ * Returns the TTL of an answer, in seconds.
+ */
+static unsigned long
+answer_ttl(const struct dns_answer *ans)
+{
+  unsigned long ttl;
+
+  ttl = ((unsigned long)uip_ntohs(ans->ttl[0]) << 16) | uip_ntohs(ans->ttl[1]);
+  return ttl > RESOLV_MAX_TTL ? RESOLV_MAX_TTL : ttl;
+}
+/*---------------------------------------------------------------------------*/
+#if RESOLV_CACHE
+/** \internal
+ * Hashes a name, ignoring case.
+ */
+static uint8_t
+name_hash(const char *name)
+{
+  uint8_t hash = 0;
+
+  while(*name != 0) {
+    hash = (hash << 3) + (hash >> 5) + tolower((unsigned char)*name++);
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+/** \internal
+ * Returns how long a "not found" answer is valid: the smaller of the
+ * TTL and the MINIMUM field of the SOA record in the authority section
+ * (RFC 2308), or RESOLV_NEGATIVE_TTL if there is none. queryptr points
+ * to the first answer.
+ */
+static unsigned long
+negative_ttl(unsigned char *queryptr, uint8_t nanswers, uint8_t nauthrr)
+{
+  const unsigned char *end = (unsigned char *)uip_appdata + uip_datalen();
+  unsigned long ttl, minimum;
+  uint16_t n, len;
+
+  for(n = 0; n < (uint16_t)nanswers + nauthrr; ++n) {
+    queryptr = skip_name(queryptr);
+    if(queryptr + 10 > end) {
+      break;
+    }
+    len = ((uint16_t)queryptr[8] << 8) | queryptr[9];
+    if(queryptr + 10 + len > end) {
+      break;
+    }
+    if(n >= nanswers && queryptr[0] == 0 && queryptr[1] == DNS_TYPE_SOA &&
+       len >= 22) {
+      ttl = ((unsigned long)queryptr[4] << 24) |
+        ((unsigned long)queryptr[5] << 16) |
+        ((unsigned long)queryptr[6] << 8) | queryptr[7];
+      queryptr += 10 + len - 4;
+      minimum = ((unsigned long)queryptr[0] << 24) |
+        ((unsigned long)queryptr[1] << 16) |
+        ((unsigned long)queryptr[2] << 8) | queryptr[3];
+      if(minimum < ttl) {
+        ttl = minimum;
+      }
+      return ttl > RESOLV_MAX_TTL ? RESOLV_MAX_TTL : ttl;
+    }
+    queryptr += 10 + len;
+  }
+  return RESOLV_NEGATIVE_TTL;
+}
+#endif /* RESOLV_CACHE */
+/*---------------------------------------------------------------------------*/
 static char
 try_next_server(struct namemap *namemapptr)
 {
@@ -679,8 +795,8 @@ check_entries(void)
               namemapptr->state = STATE_ERROR;
 
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-              /* Keep the "not found" error valid for 30 seconds */
-              namemapptr->expiration = clock_seconds() + 30;
+              /* Keep the "not found" error valid for a while */
+              namemapptr->expiration = clock_seconds() + RESOLV_NEGATIVE_TTL;
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
               resolv_found(namemapptr->name, NULL);
@@ -895,7 +1011,13 @@ newdata(void)
 
 /** ANSWER HANDLING SECTION **************************************************/
 
-  if(nanswers == 0) {
+  if(nanswers == 0
+#if RESOLV_CACHE
+     /* Responses to our queries without answers say that the name has
+        no address, they are cached below. */
+     && (is_request || hdr->id == 0)
+#endif /* RESOLV_CACHE */
+    ) {
     /* Skip responses with no answers. */
     return;
   }
@@ -933,16 +1055,32 @@ newdata(void)
     namemapptr->err = hdr->flags2 & DNS_FLAG2_ERR_MASK;
 
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-    /* If we remain in the error state, keep it cached for 30 seconds. */
-    namemapptr->expiration = clock_seconds() + 30;
+    /* If we remain in the error state, keep it cached for a while. */
+    namemapptr->expiration = clock_seconds() + RESOLV_NEGATIVE_TTL;
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
     /* Check for error. If so, call callback to inform. */
     if(namemapptr->err != 0) {
       namemapptr->state = STATE_ERROR;
+#if RESOLV_CACHE
+      if(namemapptr->err == DNS_FLAG2_ERR_NAME) {
+        namemapptr->expiration = clock_seconds() +
+          negative_ttl(queryptr, nanswers, (uint8_t)uip_ntohs(hdr->numauthrr));
+      }
+#endif /* RESOLV_CACHE */
+      resolv_found(namemapptr->name, NULL);
+      return;
+    }
+
+#if RESOLV_CACHE
+    if(nanswers == 0) {
+      /* The name exists, but has no address */
+      namemapptr->expiration = clock_seconds() +
+        negative_ttl(queryptr, 0, (uint8_t)uip_ntohs(hdr->numauthrr));
       resolv_found(namemapptr->name, NULL);
       return;
     }
+#endif /* RESOLV_CACHE */
   }
 
   i = 0;
@@ -1013,6 +1151,9 @@ newdata(void)
           namemapptr = NULL;
           goto skip_to_next_answer;
         }
+#if RESOLV_CACHE
+        namemapptr->hash = name_hash(namemapptr->name);
+#endif /* RESOLV_CACHE */
       }
       if(i == RESOLV_ENTRIES) {
         DEBUG_PRINTF
@@ -1047,8 +1188,7 @@ newdata(void)
 
     namemapptr->state = STATE_DONE;
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-    namemapptr->expiration = ans->ttl[1] + (ans->ttl[0] << 8);
-    namemapptr->expiration += clock_seconds();
+    namemapptr->expiration = clock_seconds() + answer_ttl(ans);
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
     uip_ipaddr_copy(&namemapptr->ipaddr, (uip_ipaddr_t *) ans->ipaddr);
@@ -1258,6 +1398,42 @@ remove_trailing_dots(const char *name) {
 #define remove_trailing_dots(x) (x)
 #endif /* RESOLV_AUTO_REMOVE_TRAILING_DOTS */
 /*---------------------------------------------------------------------------*/
+#if RESOLV_CACHE
+/** \internal
+ * Returns non-zero if a query for the name of an entry needs not be
+ * sent: it is being resolved, and the querying process will get the
+ * event of that, or the entry is still valid and the event is posted
+ * right away.
+ */
+static int
+answered_from_cache(struct namemap *nameptr)
+{
+#if RESOLV_CONF_SUPPORTS_MDNS
+  if(mdns_state == MDNS_STATE_PROBING &&
+     strcmp(nameptr->name, resolv_hostname) == 0) {
+    /* Probes always go out */
+    return 0;
+  }
+#endif /* RESOLV_CONF_SUPPORTS_MDNS */
+
+  switch(nameptr->state) {
+  case STATE_NEW:
+  case STATE_ASKING:
+    PRINTF("resolver: Joining query for \"%s\".\n", nameptr->name);
+    return 1;
+  case STATE_DONE:
+  case STATE_ERROR:
+    if(clock_seconds() <= nameptr->expiration) {
+      PRINTF("resolver: \"%s\" is cached.\n", nameptr->name);
+      process_post(PROCESS_BROADCAST, resolv_event_found, nameptr->name);
+      return 1;
+    }
+    break;
+  }
+  return 0;
+}
+#endif /* RESOLV_CACHE */
+/*---------------------------------------------------------------------------*/
 /**
  * Queues a name so that a question for the name will be sent out.
  *
@@ -1272,6 +1448,10 @@ resolv_query(const char *name)
 
   register struct namemap *nameptr = 0;
 
+#if RESOLV_CACHE
+  uint8_t hash;
+#endif /* RESOLV_CACHE */
+
   init();
   
   lseq = lseqi = 0;
@@ -1279,15 +1459,26 @@ resolv_query(const char *name)
   /* Remove trailing dots, if present. */
   name = remove_trailing_dots(name);
 
+#if RESOLV_CACHE
+  hash = name_hash(name);
+#endif /* RESOLV_CACHE */
+
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     nameptr = &names[i];
-    if(0 == strcasecmp(nameptr->name, name)) {
+    if(
+#if RESOLV_CACHE
+       nameptr->hash == hash &&
+#endif /* RESOLV_CACHE */
+       0 == strcasecmp(nameptr->name, name)) {
       break;
     }
     if((nameptr->state == STATE_UNUSED)
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
       || (nameptr->state == STATE_DONE && clock_seconds() > nameptr->expiration)
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+#if RESOLV_CACHE
+      || (nameptr->state == STATE_ERROR && clock_seconds() > nameptr->expiration)
+#endif /* RESOLV_CACHE */
     ) {
       lseqi = i;
       lseq = 255;
@@ -1301,12 +1492,20 @@ resolv_query(const char *name)
     i = lseqi;
     nameptr = &names[i];
   }
+#if RESOLV_CACHE
+  else if(answered_from_cache(nameptr)) {
+    return;
+  }
+#endif /* RESOLV_CACHE */
 
   PRINTF("resolver: Starting query for \"%s\".\n", name);
 
   memset(nameptr, 0, sizeof(*nameptr));
 
   strncpy(nameptr->name, name, sizeof(nameptr->name));
+#if RESOLV_CACHE
+  nameptr->hash = name_hash(nameptr->name);
+#endif /* RESOLV_CACHE */
   nameptr->state = STATE_NEW;
   nameptr->seqno = seqno;
   ++seqno;
@@ -1351,9 +1550,17 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
 
   struct namemap *nameptr;
 
+#if RESOLV_CACHE
+  uint8_t hash;
+#endif /* RESOLV_CACHE */
+
   /* Remove trailing dots, if present. */
   name = remove_trailing_dots(name);
 
+#if RESOLV_CACHE
+  hash = name_hash(name);
+#endif /* RESOLV_CACHE */
+
 #if UIP_CONF_LOOPBACK_INTERFACE
   if(strcmp(name, "localhost")) {
     static uip_ipaddr_t loopback =
@@ -1374,7 +1581,11 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     nameptr = &names[i];
 
-    if(strcasecmp(name, nameptr->name) == 0) {
+    if(
+#if RESOLV_CACHE
+       nameptr->hash == hash &&
+#endif /* RESOLV_CACHE */
+       strcasecmp(name, nameptr->name) == 0) {
       switch (nameptr->state) {
       case STATE_DONE:
         ret = RESOLV_STATUS_CACHED;
@@ -1383,10 +1594,24 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
           ret = RESOLV_STATUS_EXPIRED;
         }
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+#if RESOLV_CACHE && RESOLV_PREFETCH_TIME
+        else if(nameptr->expiration - clock_seconds() < RESOLV_PREFETCH_TIME) {
+          /* Ask again before it expires, the address is used meanwhile */
+          PRINTF("resolver: Prefetching \"%s\".\n", nameptr->name);
+          nameptr->state = STATE_NEW;
+          nameptr->is_prefetch = 1;
+          process_post(&resolv_process, PROCESS_EVENT_TIMER, 0);
+        }
+#endif /* RESOLV_CACHE && RESOLV_PREFETCH_TIME */
         break;
       case STATE_NEW:
       case STATE_ASKING:
         ret = RESOLV_STATUS_RESOLVING;
+#if RESOLV_CACHE && RESOLV_PREFETCH_TIME
+        if(nameptr->is_prefetch && clock_seconds() <= nameptr->expiration) {
+          ret = RESOLV_STATUS_CACHED;
+        }
+#endif /* RESOLV_CACHE && RESOLV_PREFETCH_TIME */
         break;
       /* Almost certainly a not-found error from server */
       case STATE_ERROR:
@@ -54,6 +54,10 @@ static uint8_t databuffer[UIP_BUFSIZE];
 
 #define UIP_IP_BUF   ((struct uip_udpip_hdr *)&uip_buf[UIP_LLH_LEN])
 
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl.h"
+#endif /* UIP_CONF_IPV6_RPL */
+
 /*---------------------------------------------------------------------------*/
 static void
 init_simple_udp(void)
@@ -64,14 +68,29 @@ init_simple_udp(void)
   }
 }
 /*---------------------------------------------------------------------------*/
-int
-simple_udp_send(struct simple_udp_connection *c,
-                const void *data, uint16_t datalen)
+static void
+send_packet(struct simple_udp_connection *c, const void *data, uint16_t datalen,
+            const uip_ipaddr_t *to, uint16_t port)
 {
   if(c->udp_conn != NULL) {
+#if UIP_CONF_IPV6_RPL
+    /* The packet is sent right away, so RPL picks its instance while
+       this is set. */
+    rpl_set_output_instance(c->rpl_instance);
+#endif /* UIP_CONF_IPV6_RPL */
     uip_udp_packet_sendto(c->udp_conn, data, datalen,
-                          &c->remote_addr, UIP_HTONS(c->remote_port));
+                          to, UIP_HTONS(port));
+#if UIP_CONF_IPV6_RPL
+    rpl_set_output_instance(RPL_OUTPUT_INSTANCE_NONE);
+#endif /* UIP_CONF_IPV6_RPL */
   }
+}
+/*---------------------------------------------------------------------------*/
+int
+simple_udp_send(struct simple_udp_connection *c,
+                const void *data, uint16_t datalen)
+{
+  send_packet(c, data, datalen, &c->remote_addr, c->remote_port);
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -80,10 +99,7 @@ simple_udp_sendto(struct simple_udp_connection *c,
                   const void *data, uint16_t datalen,
                   const uip_ipaddr_t *to)
 {
-  if(c->udp_conn != NULL) {
-    uip_udp_packet_sendto(c->udp_conn, data, datalen,
-                          to, UIP_HTONS(c->remote_port));
-  }
+  send_packet(c, data, datalen, to, c->remote_port);
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -93,14 +109,44 @@ simple_udp_sendto_port(struct simple_udp_connection *c,
 		       const uip_ipaddr_t *to,
 		       uint16_t port)
 {
-  if(c->udp_conn != NULL) {
-    uip_udp_packet_sendto(c->udp_conn, data, datalen,
-                          to, UIP_HTONS(port));
-  }
+  send_packet(c, data, datalen, to, port);
   return 0;
 }
 /*---------------------------------------------------------------------------*/
 int
+simple_udp_sendto_batch(struct simple_udp_connection *c,
+                        const struct uip_udp_packet_item *items,
+                        int count)
+{
+  uint16_t curport;
+  int sent;
+
+  if(c->udp_conn == NULL) {
+    return 0;
+  }
+#if UIP_CONF_IPV6_RPL
+  rpl_set_output_instance(c->rpl_instance);
+#endif /* UIP_CONF_IPV6_RPL */
+  /* Items without a port go to the remote port of the connection. */
+  curport = c->udp_conn->rport;
+  c->udp_conn->rport = UIP_HTONS(c->remote_port);
+  sent = uip_udp_packet_sendto_batch(c->udp_conn, items, count);
+  c->udp_conn->rport = curport;
+#if UIP_CONF_IPV6_RPL
+  rpl_set_output_instance(RPL_OUTPUT_INSTANCE_NONE);
+#endif /* UIP_CONF_IPV6_RPL */
+  return sent;
+}
+/*---------------------------------------------------------------------------*/
+void
+simple_udp_set_rpl_instance(struct simple_udp_connection *c, int instance_id)
+{
+#if UIP_CONF_IPV6_RPL
+  c->rpl_instance = instance_id;
+#endif /* UIP_CONF_IPV6_RPL */
+}
+/*---------------------------------------------------------------------------*/
+int
 simple_udp_register(struct simple_udp_connection *c,
                     uint16_t local_port,
                     uip_ipaddr_t *remote_addr,
@@ -116,6 +162,9 @@ simple_udp_register(struct simple_udp_connection *c,
     uip_ipaddr_copy(&c->remote_addr, remote_addr);
   }
   c->receive_callback = receive_callback;
+#if UIP_CONF_IPV6_RPL
+  c->rpl_instance = RPL_OUTPUT_INSTANCE_NONE;
+#endif /* UIP_CONF_IPV6_RPL */
 
   PROCESS_CONTEXT_BEGIN(&simple_udp_process);
   c->udp_conn = udp_new(remote_addr, UIP_HTONS(remote_port), c);
@@ -56,6 +56,7 @@
 #define SIMPLE_UDP_H
 
 #include "net/ip/uip.h"
+#include "net/ip/uip-udp-packet.h"
 
 struct simple_udp_connection;
 
@@ -75,6 +76,9 @@ struct simple_udp_connection {
   simple_udp_callback receive_callback;
   struct uip_udp_conn *udp_conn;
   struct process *client_process;
+#if UIP_CONF_IPV6_RPL
+  int rpl_instance;
+#endif /* UIP_CONF_IPV6_RPL */
 };
 
 /**
@@ -155,6 +159,41 @@ int simple_udp_sendto_port(struct simple_udp_connection *c,
 			   const void *data, uint16_t datalen,
 			   const uip_ipaddr_t *to, uint16_t to_port);
 
+/**
+ * \brief      Send a batch of UDP packets
+ * \param c    A pointer to a struct simple_udp_connection
+ * \param items The packets to send: receiver, UDP port in host byte
+ *             order (0 for the remote port of the connection), data
+ *             and length
+ * \param count The number of packets
+ * \return     The number of packets sent
+ *
+ *     This function sends a number of UDP packets in one go,
+ *     for example the same message to many receivers. The
+ *     route to a receiver is looked up once for consecutive
+ *     packets to it.
+ *
+ * \sa simple_udp_sendto_port()
+ */
+int simple_udp_sendto_batch(struct simple_udp_connection *c,
+                            const struct uip_udp_packet_item *items,
+                            int count);
+
+/**
+ * \brief      Send the packets of a connection in an RPL instance
+ * \param c    A pointer to a struct simple_udp_connection
+ * \param instance_id The RPL instance ID, or -1 for the instance
+ *             that RPL would choose otherwise
+ *
+ *     This function makes the packets sent with the connection
+ *     go in the given RPL instance, so that they are routed
+ *     with the objective function of that instance. It has no
+ *     effect when the node is not part of the instance.
+ *
+ */
+void simple_udp_set_rpl_instance(struct simple_udp_connection *c,
+                                 int instance_id);
+
 void simple_udp_init(void);
 
 #endif /* SIMPLE_UDP_H */
@@ -55,6 +55,63 @@ call_event(struct tcp_socket *s, tcp_socket_event_t event)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* The amount of data that is queued and not yet acknowledged: the
+   output buffer, followed by what is left of a generated message. */
+static uint16_t
+pending(struct tcp_socket *s)
+{
+  return s->output_data_len + s->output_gen_len - s->output_gen_offset;
+}
+/*---------------------------------------------------------------------------*/
+/* Send len bytes of the queued data, starting at offset. Data from the
+   output buffer is copied by uip_send(), a generated message is
+   written straight into the uIP buffer by its generator. */
+static void
+senddata_from(struct tcp_socket *s, uint16_t offset, int len)
+{
+  uint8_t *buf;
+  int n;
+
+  if(offset + len <= s->output_data_len) {
+    uip_send(&s->output_data_ptr[offset], len);
+    return;
+  }
+
+  buf = uip_appdata;
+  n = 0;
+  if(offset < s->output_data_len) {
+    n = s->output_data_len - offset;
+    memcpy(buf, &s->output_data_ptr[offset], n);
+  }
+  s->output_generator(s, s->output_gen_ptr, &buf[n],
+                      s->output_gen_offset + offset + n - s->output_data_len,
+                      len - n);
+  uip_send(buf, len);
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_SEGMENTS > 1
+static void
+senddata(struct tcp_socket *s)
+{
+  int len = MIN(s->output_data_max_seg, uip_mss());
+
+  /* output_data_send_nxt is the amount of data in transit. uIP has
+     forgotten about it when asking for a retransmission. */
+  if(uip_rexmit()) {
+    s->output_data_send_nxt = 0;
+  }
+  len = MIN(pending(s) - s->output_data_send_nxt, len);
+  if(len > 0) {
+    senddata_from(s, s->output_data_send_nxt, len);
+    s->output_data_send_nxt += len;
+    if(s->output_data_send_nxt < pending(s)) {
+      /* Ask for another call to send the next segment, if the window
+         has room for it. */
+      tcpip_poll_tcp(uip_conn);
+    }
+  }
+}
+#else /* UIP_TCP_SEGMENTS > 1 */
 static void
 senddata(struct tcp_socket *s)
 {
@@ -63,35 +120,52 @@ senddata(struct tcp_socket *s)
   if(s->output_senddata_len > 0) {
     len = MIN(s->output_senddata_len, len);
     s->output_data_send_nxt = len;
-    uip_send(s->output_data_ptr, len);
+    senddata_from(s, 0, len);
   }
 }
+#endif /* UIP_TCP_SEGMENTS > 1 */
 /*---------------------------------------------------------------------------*/
 static void
 acked(struct tcp_socket *s)
 {
+  uint16_t acked_len, len;
+
   if(s->output_senddata_len > 0) {
     /* Copy the data in the outputbuf down and update outputbufptr and
        outputbuf_lastsent */
 
-    if(s->output_data_send_nxt > 0) {
-      memcpy(&s->output_data_ptr[0],
-             &s->output_data_ptr[s->output_data_send_nxt],
-             s->output_data_maxlen - s->output_data_send_nxt);
-    }
-    if(s->output_data_len < s->output_data_send_nxt) {
-      printf("tcp: acked assertion failed s->output_data_len (%d) < s->output_data_send_nxt (%d)\n",
-             s->output_data_len,
-             s->output_data_send_nxt);
+    /* What is still outstanding after the acknowledgement stays in the
+       buffer. This is nothing unless several segments are in flight. */
+    acked_len = s->output_data_send_nxt - uip_outstanding(uip_conn);
+    if(pending(s) < acked_len) {
+      printf("tcp: acked assertion failed pending data (%d) < acked_len (%d)\n",
+             pending(s),
+             acked_len);
       tcp_markconn(uip_conn, NULL);
       uip_abort();
       call_event(s, TCP_SOCKET_ABORTED);
       relisten(s);
       return;
     }
-    s->output_data_len -= s->output_data_send_nxt;
-    s->output_senddata_len = s->output_data_len;
-    s->output_data_send_nxt = 0;
+    s->output_data_send_nxt -= acked_len;
+
+    /* The output buffer is sent first, the generated message after it. */
+    len = MIN(acked_len, s->output_data_len);
+    if(len > 0) {
+      memmove(&s->output_data_ptr[0],
+              &s->output_data_ptr[len],
+              s->output_data_maxlen - len);
+      s->output_data_len -= len;
+      acked_len -= len;
+    }
+    if(s->output_generator != NULL) {
+      s->output_gen_offset += acked_len;
+      if(s->output_gen_offset == s->output_gen_len) {
+        s->output_generator = NULL;
+        s->output_gen_len = s->output_gen_offset = 0;
+      }
+    }
+    s->output_senddata_len = pending(s);
 
     call_event(s, TCP_SOCKET_DATA_SENT);
   }
@@ -130,6 +204,17 @@ newdata(struct tcp_socket *s)
 }
 /*---------------------------------------------------------------------------*/
 static void
+drop_generated(struct tcp_socket *s)
+{
+  /* The generated message may refer to data that the application
+     frees when the connection goes away. */
+  if(s != NULL) {
+    s->output_generator = NULL;
+    s->output_gen_len = s->output_gen_offset = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
 relisten(struct tcp_socket *s)
 {
   if(s != NULL && s->listen_port != 0) {
@@ -184,12 +269,14 @@ appcall(void *state)
   }
 
   if(uip_timedout()) {
+    drop_generated(s);
     call_event(s, TCP_SOCKET_TIMEDOUT);
     relisten(s);
   }
 
   if(uip_aborted()) {
     tcp_markconn(uip_conn, NULL);
+    drop_generated(s);
     call_event(s, TCP_SOCKET_ABORTED);
     relisten(s);
 
@@ -215,7 +302,7 @@ appcall(void *state)
     senddata(s);
   }
 
-  if(s->output_data_len == 0 && s->flags & TCP_SOCKET_FLAGS_CLOSING) {
+  if(pending(s) == 0 && s->flags & TCP_SOCKET_FLAGS_CLOSING) {
     s->flags &= ~TCP_SOCKET_FLAGS_CLOSING;
     uip_close();
     s->c = NULL;
@@ -228,6 +315,7 @@ appcall(void *state)
   if(uip_closed()) {
     tcp_markconn(uip_conn, NULL);
     s->c = NULL;
+    drop_generated(s);
     call_event(s, TCP_SOCKET_CLOSED);
     relisten(s);
   }
@@ -276,6 +364,8 @@ tcp_socket_register(struct tcp_socket *s, void *ptr,
   s->output_data_len = 0;
   s->output_data_ptr = output_databuf;
   s->output_data_maxlen = output_databuf_len;
+  s->output_generator = NULL;
+  s->output_gen_len = s->output_gen_offset = 0;
   s->input_callback = input_callback;
   s->event_callback = event_callback;
   list_add(socketlist, s);
@@ -347,7 +437,7 @@ tcp_socket_send(struct tcp_socket *s,
     return -1;
   }
 
-  len = MIN(datalen, s->output_data_maxlen - s->output_data_len);
+  len = MIN(datalen, tcp_socket_max_sendlen(s));
 
   memcpy(&s->output_data_ptr[s->output_data_len], data, len);
   s->output_data_len += len;
@@ -356,10 +446,60 @@ tcp_socket_send(struct tcp_socket *s,
     s->output_senddata_len = s->output_data_len;
   }
 
+  /* Have the data sent soon rather than on the next periodic poll, so
+     that it also carries any acknowledgement that uIP is holding
+     back. */
+  if(len > 0 && s->c != NULL) {
+    tcpip_poll_tcp(s->c);
+  }
+
   return len;
 }
 /*---------------------------------------------------------------------------*/
 int
+tcp_socket_send_generated(struct tcp_socket *s,
+                          tcp_socket_generator_t generator, const void *ptr,
+                          uint16_t len)
+{
+  if(s == NULL || generator == NULL) {
+    return -1;
+  }
+
+  if(s->output_generator != NULL || len == 0) {
+    return 0;
+  }
+
+  s->output_generator = generator;
+  s->output_gen_ptr = ptr;
+  s->output_gen_len = len;
+  s->output_gen_offset = 0;
+
+  if(s->output_senddata_len == 0) {
+    s->output_senddata_len = pending(s);
+  }
+
+  if(s->c != NULL) {
+    tcpip_poll_tcp(s->c);
+  }
+
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+generate_ref(struct tcp_socket *s, const void *ptr,
+             uint8_t *buf, uint16_t offset, uint16_t len)
+{
+  memcpy(buf, (const uint8_t *)ptr + offset, len);
+}
+/*---------------------------------------------------------------------------*/
+int
+tcp_socket_send_ref(struct tcp_socket *s,
+                    const uint8_t *data, uint16_t datalen)
+{
+  return tcp_socket_send_generated(s, generate_ref, data, datalen);
+}
+/*---------------------------------------------------------------------------*/
+int
 tcp_socket_send_str(struct tcp_socket *s,
              const char *str)
 {
@@ -395,6 +535,10 @@ tcp_socket_unregister(struct tcp_socket *s)
 int
 tcp_socket_max_sendlen(struct tcp_socket *s)
 {
+  /* Data sent now would go out before the generated message. */
+  if(s->output_generator != NULL) {
+    return 0;
+  }
   return s->output_data_maxlen - s->output_data_len;
 }
 /*---------------------------------------------------------------------------*/
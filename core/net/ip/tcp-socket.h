@@ -80,6 +80,29 @@ typedef void (* tcp_socket_event_callback_t)(struct tcp_socket *s,
                                              void *ptr,
                                              tcp_socket_event_t event);
 
+/**
+ * \brief      TCP generator function
+ * \param s    A pointer to a TCP socket
+ * \param ptr  The pointer given to tcp_socket_send_generated()
+ * \param buf  A pointer to where the data should be written
+ * \param offset The offset of the data within the generated message
+ * \param len  The number of bytes to write
+ *
+ *             The TCP socket generator function gets called whenever
+ *             a segment carrying part of a generated message is sent
+ *             or retransmitted. The function must write len bytes of
+ *             the message, starting at offset, to buf. buf points
+ *             into the uIP packet buffer, so that the message does not
+ *             have to be copied to the output buffer of the socket
+ *             first. The function must produce the same data each
+ *             time it is called for the same offset.
+ */
+typedef void (* tcp_socket_generator_t)(struct tcp_socket *s,
+                                        const void *ptr,
+                                        uint8_t *buf,
+                                        uint16_t offset,
+                                        uint16_t len);
+
 struct tcp_socket {
   struct tcp_socket *next;
 
@@ -100,6 +123,11 @@ struct tcp_socket {
   uint16_t output_senddata_len;
   uint16_t output_data_max_seg;
 
+  tcp_socket_generator_t output_generator;
+  const void *output_gen_ptr;
+  uint16_t output_gen_len;
+  uint16_t output_gen_offset;
+
   uint8_t flags;
   uint16_t listen_port;
   struct uip_conn *c;
@@ -229,6 +257,56 @@ int tcp_socket_send(struct tcp_socket *s,
                     const uint8_t *dataptr,
                     int datalen);
 
+/**
+ * \brief      Send a generated message on a connected TCP socket
+ * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
+ * \param generator A pointer to the generator function of the message
+ * \param ptr  A pointer that will be sent to the generator function
+ * \param len  The length of the message
+ * \retval -1  If an error occurs
+ * \retval 0   If a generated message is already being sent
+ * \return     The length of the message
+ *
+ *             This function sends a message of len bytes that is
+ *             written by the generator function directly into the
+ *             uIP packet buffer each time a segment of it is sent or
+ *             retransmitted, the way protosocket generators
+ *             work. The message does not take up room in the output
+ *             buffer and is sent after the data that is already in
+ *             it.
+ *
+ *             Only one generated message can be sent at a time.
+ *             Until it has been acknowledged by the remote host,
+ *             tcp_socket_max_sendlen() returns 0 and no other data
+ *             can be sent on the socket. The message is dropped if
+ *             the connection is closed, aborted or times out.
+ */
+int tcp_socket_send_generated(struct tcp_socket *s,
+                              tcp_socket_generator_t generator,
+                              const void *ptr,
+                              uint16_t len);
+
+/**
+ * \brief      Send data on a connected TCP socket without buffering it
+ * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
+ * \param dataptr A pointer to the data to be sent
+ * \param datalen The length of the data to be sent
+ * \retval -1  If an error occurs
+ * \retval 0   If a generated message is already being sent
+ * \return     The length of the data
+ *
+ *             This function sends data as a generated message (see
+ *             tcp_socket_send_generated()) that is copied from
+ *             dataptr into each segment. The data is not copied to
+ *             the output buffer and must stay valid until it has been
+ *             acknowledged, i.e. until tcp_socket_max_sendlen()
+ *             returns non-zero again, or the connection has gone
+ *             away.
+ */
+int tcp_socket_send_ref(struct tcp_socket *s,
+                        const uint8_t *dataptr,
+                        uint16_t datalen);
+
 /**
  * \brief      Send a string on a connected TCP socket
  * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
@@ -41,6 +41,11 @@
 #include "contiki-net.h"
 #include "net/ip/uip-split.h"
 #include "net/ip/uip-packetqueue.h"
+#include "net/packetbuf.h"
+#include "net/packet-trace.h"
+#include "sys/boot-profile.h"
+#include "lib/list.h"
+#include "lib/memb.h"
 
 #if NETSTACK_CONF_WITH_IPV6
 #include "net/ipv6/uip-nd6.h"
@@ -106,6 +111,21 @@ enum {
   PACKET_INPUT
 };
 
+#if TCPIP_INPUT_BUFFERS
+/* A received packet waiting for uIP, with the link-layer context that
+   the upper layers may ask packetbuf for while it is processed. */
+struct input_buffer {
+  struct input_buffer *next;
+  uint16_t len;
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  uint8_t buf[UIP_BUFSIZE];
+};
+
+MEMB(input_buffer_memb, struct input_buffer, TCPIP_INPUT_BUFFERS);
+LIST(input_queue);
+#endif /* TCPIP_INPUT_BUFFERS */
+
 /* Called on IP packet output. */
 #if NETSTACK_CONF_WITH_IPV6
 
@@ -116,7 +136,16 @@ tcpip_output(const uip_lladdr_t *a)
 {
   int ret;
   if(outputfunc != NULL) {
+    BOOT_PROFILE_MARK(BOOT_PROFILE_FIRST_TX);
+#if PACKET_TRACE_ENABLED
+    /* Every frame created for the packet carries its trace ID */
+    packet_trace_id = packet_trace_uip_id();
+    packet_trace_record(packet_trace_id, PACKET_TRACE_LOWPAN_OUT, 0);
+#endif /* PACKET_TRACE_ENABLED */
     ret = outputfunc(a);
+#if PACKET_TRACE_ENABLED
+    packet_trace_id = 0;
+#endif /* PACKET_TRACE_ENABLED */
     return ret;
   }
   UIP_LOG("tcpip_output: Use tcpip_set_outputfunc() to set an output function");
@@ -152,7 +181,7 @@ tcpip_set_outputfunc(uint8_t (*f)(void))
 unsigned char tcpip_is_forwarding; /* Forwarding right now? */
 #endif /* UIP_CONF_IP_FORWARD */
 
-PROCESS(tcpip_process, "TCP/IP stack");
+PROCESS_WITH_PRIORITY(tcpip_process, "TCP/IP stack", PROCESS_PRIORITY_HIGH);
 
 /*---------------------------------------------------------------------------*/
 #if UIP_TCP || UIP_CONF_IP_FORWARD
@@ -213,6 +242,24 @@ packet_input(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if TCPIP_INPUT_BUFFERS
+static void
+input_queued(void)
+{
+  struct input_buffer *b;
+
+  /* The packets are taken in arrival order. uip_buf is free here, as
+     the tcpip process is not in the middle of handling a packet. */
+  while((b = list_pop(input_queue)) != NULL) {
+    memcpy(uip_buf, b->buf, b->len);
+    uip_len = b->len - UIP_LLH_LEN;
+    packetbuf_attr_copyfrom(b->attrs, b->addrs);
+    memb_free(&input_buffer_memb, b);
+    packet_input();
+  }
+}
+#endif /* TCPIP_INPUT_BUFFERS */
+/*---------------------------------------------------------------------------*/
 #if UIP_TCP
 #if UIP_ACTIVE_OPEN
 struct uip_conn *
@@ -510,27 +557,116 @@ eventhandler(process_event_t ev, process_data_t data)
     case PACKET_INPUT:
       packet_input();
       break;
+#if TCPIP_INPUT_BUFFERS
+    case PROCESS_EVENT_POLL:
+      input_queued();
+      break;
+#endif /* TCPIP_INPUT_BUFFERS */
   };
 }
 /*---------------------------------------------------------------------------*/
 void
 tcpip_input(void)
 {
+#if TCPIP_INPUT_BUFFERS
+  struct input_buffer *b;
+#endif /* TCPIP_INPUT_BUFFERS */
+
+  packet_trace_ip_input();
+
+#if TCPIP_INPUT_BUFFERS
+  if(uip_len > 0) {
+    b = NULL;
+    if(UIP_LLH_LEN + uip_len <= UIP_BUFSIZE) {
+      b = memb_alloc(&input_buffer_memb);
+    }
+    if(b == NULL) {
+      UIP_LOG("tcpip_input: no free input buffer, packet dropped");
+      UIP_STAT(++uip_stat.ip.drop);
+    } else {
+      b->len = UIP_LLH_LEN + uip_len;
+      memcpy(b->buf, uip_buf, b->len);
+      packetbuf_attr_copyto(b->attrs, b->addrs);
+      list_add(input_queue, b);
+      process_poll(&tcpip_process);
+    }
+  }
+#else /* TCPIP_INPUT_BUFFERS */
   process_post_synch(&tcpip_process, PACKET_INPUT, NULL);
+#endif /* TCPIP_INPUT_BUFFERS */
   uip_clear_buf();
 }
 /*---------------------------------------------------------------------------*/
+#if NETSTACK_CONF_WITH_IPV6 && UIP_ND6_SEND_NA && UIP_CONF_IPV6_QUEUE_PKT
+static void
+queue_packet(uip_ds6_nbr_t *nbr)
+{
+  struct uip_packetqueue_packet *p;
+
+  p = uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME);
+  if(p != NULL) {
+    memcpy(p->queue_buf, UIP_IP_BUF, uip_len);
+    p->queue_buf_len = uip_len;
+  } else {
+    UIP_LOG("tcpip_ipv6_output: packet queue full, packet dropped");
+  }
+}
+#endif /* NETSTACK_CONF_WITH_IPV6 && UIP_ND6_SEND_NA && UIP_CONF_IPV6_QUEUE_PKT */
+/*---------------------------------------------------------------------------*/
+#if NETSTACK_CONF_WITH_IPV6 && UIP_ND6_LITE
+/*
+ * ND-lite address resolution: a link-local next hop on a 6LoWPAN carries
+ * the MAC address of the neighbour in its interface identifier, so the
+ * neighbour entry can be created as reachable without sending a multicast
+ * NS. Neighbour unreachability detection still runs on the entry.
+ */
+static uip_ds6_nbr_t *
+nbr_from_iid(uip_ipaddr_t *nexthop)
+{
+  uip_lladdr_t lladdr;
+  uip_ds6_nbr_t *nbr;
+
+  if(!uip_is_addr_linklocal(nexthop) ||
+     !uip_ds6_get_lladdr_from_iid(nexthop, &lladdr)) {
+    return NULL;
+  }
+  nbr = uip_ds6_nbr_add(nexthop, &lladdr, 0, NBR_REACHABLE);
+  if(nbr != NULL) {
+    stimer_set(&nbr->reachable, uip_ds6_if.reachable_time / 1000);
+    uip_ds6_schedule_stimer(&nbr->reachable);
+    PRINTF("tcpip_ipv6_output: nbr resolved from IID\n");
+  }
+  return nbr;
+}
+#endif /* NETSTACK_CONF_WITH_IPV6 && UIP_ND6_LITE */
+/*---------------------------------------------------------------------------*/
 #if NETSTACK_CONF_WITH_IPV6
+static struct tcpip_nexthop_cache *batch_cache;
+/*---------------------------------------------------------------------------*/
+void
+tcpip_ipv6_output_batch(struct tcpip_nexthop_cache *cache)
+{
+  batch_cache = cache;
+  if(cache != NULL) {
+    cache->valid = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
 void
 tcpip_ipv6_output(void)
 {
   uip_ds6_nbr_t *nbr = NULL;
   uip_ipaddr_t *nexthop;
+#if UIP_CONF_IPV6_RPL
+  uip_ipaddr_t srh_nexthop;
+#endif /* UIP_CONF_IPV6_RPL */
 
   if(uip_len == 0) {
     return;
   }
 
+  PACKET_TRACE_UIP(PACKET_TRACE_IP_OUT);
+
   if(uip_len > UIP_LINK_MTU) {
     UIP_LOG("tcpip_ipv6_output: Packet to big");
     uip_clear_buf();
@@ -546,21 +682,50 @@ tcpip_ipv6_output(void)
   if(!uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
     /* Next hop determination */
     nbr = NULL;
+    nexthop = NULL;
+
+#if UIP_CONF_IPV6_RPL
+    /* In RPL non-storing mode, the root source routes packets down the
+       DODAG, and the next hop of a source routed packet is given by
+       its destination. */
+    if(!rpl_insert_srh_header()) {
+      uip_clear_buf();
+      return;
+    }
+    if(rpl_srh_get_next_hop(&srh_nexthop)) {
+      nexthop = &srh_nexthop;
+    }
+#endif /* UIP_CONF_IPV6_RPL */
 
     /* We first check if the destination address is on our immediate
        link. If so, we simply use the destination address as our
        nexthop address. */
-    if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)){
+    if(nexthop != NULL) {
+      PRINTF("tcpip_ipv6_output: source routed\n");
+    } else if(batch_cache != NULL && batch_cache->valid &&
+              uip_ipaddr_cmp(&batch_cache->dest, &UIP_IP_BUF->destipaddr)) {
+      /* Same destination as the previous packet of the batch */
+      nexthop = &batch_cache->nexthop;
+    } else if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)){
       nexthop = &UIP_IP_BUF->destipaddr;
     } else {
       uip_ds6_route_t *route;
-      /* Check if we have a route to the destination address. */
+      /* Check if we have a route to the destination address. With
+         RPL, the route is looked up in the instance of the packet. */
+#if UIP_CONF_IPV6_RPL
+      route = rpl_lookup_route(&UIP_IP_BUF->destipaddr);
+#else /* UIP_CONF_IPV6_RPL */
       route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr);
+#endif /* UIP_CONF_IPV6_RPL */
 
       /* No route was found - we send to the default route instead. */
       if(route == NULL) {
         PRINTF("tcpip_ipv6_output: no route found, using default route\n");
+#if UIP_CONF_IPV6_RPL
+        nexthop = rpl_get_default_nexthop();
+#else /* UIP_CONF_IPV6_RPL */
         nexthop = uip_ds6_defrt_choose();
+#endif /* UIP_CONF_IPV6_RPL */
         if(nexthop == NULL) {
 #ifdef UIP_FALLBACK_INTERFACE
 	  PRINTF("FALLBACK: removing ext hdrs & setting proto %d %d\n", 
@@ -635,6 +800,12 @@ tcpip_ipv6_output(void)
 
     /* End of next hop determination */
 
+    if(batch_cache != NULL && nexthop != &batch_cache->nexthop) {
+      uip_ipaddr_copy(&batch_cache->dest, &UIP_IP_BUF->destipaddr);
+      uip_ipaddr_copy(&batch_cache->nexthop, nexthop);
+      batch_cache->valid = 1;
+    }
+
 #if UIP_CONF_IPV6_RPL
     if(rpl_update_header_final(nexthop)) {
       uip_clear_buf();
@@ -642,6 +813,11 @@ tcpip_ipv6_output(void)
     }
 #endif /* UIP_CONF_IPV6_RPL */
     nbr = uip_ds6_nbr_lookup(nexthop);
+#if UIP_ND6_LITE
+    if(nbr == NULL) {
+      nbr = nbr_from_iid(nexthop);
+    }
+#endif /* UIP_ND6_LITE */
     if(nbr == NULL) {
 #if UIP_ND6_SEND_NA
       if((nbr = uip_ds6_nbr_add(nexthop, NULL, 0, NBR_INCOMPLETE)) == NULL) {
@@ -650,10 +826,7 @@ tcpip_ipv6_output(void)
       } else {
 #if UIP_CONF_IPV6_QUEUE_PKT
         /* Copy outgoing pkt in the queuing buffer for later transmit. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        queue_packet(nbr);
 #endif
       /* RFC4861, 7.2.2:
        * "If the source address of the packet prompting the solicitation is the
@@ -668,6 +841,7 @@ tcpip_ipv6_output(void)
         }
 
         stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
+        uip_ds6_schedule_stimer(&nbr->sendns);
         nbr->nscount = 1;
         /* Send the first NS try from here (multicast destination IP address). */
       }
@@ -682,10 +856,7 @@ tcpip_ipv6_output(void)
 #if UIP_CONF_IPV6_QUEUE_PKT
         /* Copy outgoing pkt in the queuing buffer for later transmit and set
            the destination nbr to nbr. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        queue_packet(nbr);
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
         uip_clear_buf();
         return;
@@ -695,6 +866,7 @@ tcpip_ipv6_output(void)
       if(nbr->state == NBR_STALE) {
         nbr->state = NBR_DELAY;
         stimer_set(&nbr->reachable, UIP_ND6_DELAY_FIRST_PROBE_TIME);
+        uip_ds6_schedule_stimer(&nbr->reachable);
         nbr->nscount = 0;
         PRINTF("tcpip_ipv6_output: nbr cache entry stale moving to delay\n");
       }
@@ -707,12 +879,12 @@ tcpip_ipv6_output(void)
        * Send the queued packets from here, may not be 100% perfect though.
        * This happens in a few cases, for example when instead of receiving a
        * NA after sendiong a NS, you receive a NS with SLLAO: the entry moves
-       * to STALE, and you must both send a NA and the queued packet.
+       * to STALE, and you must both send a NA and the queued packets.
        */
-      if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
+      while(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
         uip_len = uip_packetqueue_buflen(&nbr->packethandle);
         memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-        uip_packetqueue_free(&nbr->packethandle);
+        uip_packetqueue_pop(&nbr->packethandle);
         tcpip_output(uip_ds6_nbr_get_ll(nbr));
       }
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
@@ -336,6 +336,24 @@ CCIF extern process_event_t tcpip_event;
  */
 CCIF void tcpip_input(void);
 
+/*
+ * With TCPIP_CONF_INPUT_BUFFERS set to a non-zero number, tcpip_input()
+ * does not process the packet right away. The packet is instead copied,
+ * together with its packetbuf attributes and addresses, into one of a
+ * pool of that many buffers, and the tcpip process later hands the
+ * queued packets to uIP one at a time. The driver that delivered the
+ * packet can then return to the radio before the packet has been
+ * forwarded or passed to an application, which lets a node that
+ * forwards much traffic, such as a RPL root, accept frames back to
+ * back. Each buffer costs UIP_BUFSIZE bytes. Packets that arrive while
+ * all buffers are in use are dropped.
+ */
+#ifdef TCPIP_CONF_INPUT_BUFFERS
+#define TCPIP_INPUT_BUFFERS TCPIP_CONF_INPUT_BUFFERS
+#else /* TCPIP_CONF_INPUT_BUFFERS */
+#define TCPIP_INPUT_BUFFERS 0
+#endif /* TCPIP_CONF_INPUT_BUFFERS */
+
 /**
  * \brief Output packet to layer 2
  * The eventual parameter is the MAC address of the destination.
@@ -353,6 +371,24 @@ void tcpip_set_outputfunc(uint8_t (* f)(void));
  */
 #if NETSTACK_CONF_WITH_IPV6
 void tcpip_ipv6_output(void);
+
+/** The next hop of a destination, kept over a batch of packets */
+struct tcpip_nexthop_cache {
+  uip_ipaddr_t dest;
+  uip_ipaddr_t nexthop;
+  uint8_t valid;
+};
+
+/**
+ * \brief Start or end a batch of packets sent with tcpip_ipv6_output()
+ * \param cache The next hop cache of the batch, or NULL to end it
+ *
+ * Within a batch, the next hop found for a destination is used for
+ * the following packets to the same destination without looking up
+ * its route again. The packets of a batch must be sent without
+ * returning to the scheduler, so that the routes do not change.
+ */
+void tcpip_ipv6_output_batch(struct tcpip_nexthop_cache *cache);
 #endif
 
 /**
@@ -147,6 +147,18 @@ udp_socket_sendto(struct udp_socket *c,
   return -1;
 }
 /*---------------------------------------------------------------------------*/
+int
+udp_socket_sendto_batch(struct udp_socket *c,
+                        const struct uip_udp_packet_item *items,
+                        int count)
+{
+  if(c == NULL || c->udp_conn == NULL) {
+    return -1;
+  }
+
+  return uip_udp_packet_sendto_batch(c->udp_conn, items, count);
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(udp_socket_process, ev, data)
 {
   struct udp_socket *c;
@@ -33,6 +33,7 @@
 #define UDP_SOCKET_H
 
 #include "net/ip/uip.h"
+#include "net/ip/uip-udp-packet.h"
 
 struct udp_socket;
 
@@ -190,4 +191,23 @@ int udp_socket_sendto(struct udp_socket *c,
  */
 int udp_socket_close(struct udp_socket *c);
 
+/**
+ * \brief      Send a batch of UDP datagrams
+ * \param c    A pointer to the struct udp_socket on which the data should be sent
+ * \param items The datagrams to send: receiver, UDP port in host byte
+ *             order (0 for the port of udp_socket_connect()), data and
+ *             length
+ * \param count The number of datagrams
+ * \retval -1  The UDP socket was not registered
+ * \return     The number of datagrams sent
+ *
+ *             This function sends a number of UDP datagrams in one
+ *             go. The route to a receiver is looked up once for
+ *             consecutive datagrams to it.
+ *
+ */
+int udp_socket_sendto_batch(struct udp_socket *c,
+                            const struct uip_udp_packet_item *items,
+                            int count);
+
 #endif /* UDP_SOCKET_H */
@@ -6,8 +6,7 @@
 
 #include "net/ip/uip-packetqueue.h"
 
-#define MAX_NUM_QUEUED_PACKETS 2
-MEMB(packets_memb, struct uip_packetqueue_packet, MAX_NUM_QUEUED_PACKETS);
+MEMB(packets_memb, struct uip_packetqueue_packet, UIP_PACKETQUEUE_PACKETS);
 
 #define DEBUG 0
 #if DEBUG
@@ -17,15 +16,29 @@ MEMB(packets_memb, struct uip_packetqueue_packet, MAX_NUM_QUEUED_PACKETS);
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static void
+packet_remove(struct uip_packetqueue_packet *p)
+{
+  struct uip_packetqueue_packet **pp;
+
+  for(pp = &p->handle->packet; *pp != NULL; pp = &(*pp)->next) {
+    if(*pp == p) {
+      *pp = p->next;
+      break;
+    }
+  }
+  ctimer_stop(&p->lifetimer);
+  memb_free(&packets_memb, p);
+}
 /*---------------------------------------------------------------------------*/
 static void
 packet_timedout(void *ptr)
 {
-  struct uip_packetqueue_handle *h = ptr;
+  struct uip_packetqueue_packet *p = ptr;
 
-  PRINTF("uip_packetqueue_free timed out %p\n", h);
-  memb_free(&packets_memb, h->packet);
-  h->packet = NULL;
+  PRINTF("uip_packetqueue_free timed out %p\n", p->handle);
+  packet_remove(p);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -38,29 +51,47 @@ uip_packetqueue_new(struct uip_packetqueue_handle *handle)
 struct uip_packetqueue_packet *
 uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime)
 {
+  struct uip_packetqueue_packet **pp;
+  struct uip_packetqueue_packet *p;
+  int n;
+
   PRINTF("uip_packetqueue_alloc %p\n", handle);
-  if(handle->packet != NULL) {
-    PRINTF("alloced\n");
+  n = 0;
+  for(pp = &handle->packet; *pp != NULL; pp = &(*pp)->next) {
+    n++;
+  }
+  if(n >= UIP_PACKETQUEUE_PACKETS_PER_HANDLE) {
+    PRINTF("handle full\n");
     return NULL;
   }
-  handle->packet = memb_alloc(&packets_memb);
-  if(handle->packet != NULL) {
-    ctimer_set(&handle->packet->lifetimer, lifetime,
-               packet_timedout, handle);
+  p = memb_alloc(&packets_memb);
+  if(p != NULL) {
+    p->next = NULL;
+    p->queue_buf_len = 0;
+    p->handle = handle;
+    ctimer_set(&p->lifetimer, lifetime, packet_timedout, p);
+    *pp = p;
   } else {
     PRINTF("uip_packetqueue_alloc failed\n");
   }
-  return handle->packet;
+  return p;
 }
 /*---------------------------------------------------------------------------*/
 void
 uip_packetqueue_free(struct uip_packetqueue_handle *handle)
 {
   PRINTF("uip_packetqueue_free %p\n", handle);
+  while(handle->packet != NULL) {
+    packet_remove(handle->packet);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_packetqueue_pop(struct uip_packetqueue_handle *handle)
+{
+  PRINTF("uip_packetqueue_pop %p\n", handle);
   if(handle->packet != NULL) {
-    ctimer_stop(&handle->packet->lifetimer);
-    memb_free(&packets_memb, handle->packet);
-    handle->packet = NULL;
+    packet_remove(handle->packet);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -3,30 +3,54 @@
 
 #include "sys/ctimer.h"
 
+/* The number of packets that can be queued in total, for all handles
+   together. Each packet costs a full uIP buffer. */
+#ifdef UIP_PACKETQUEUE_CONF_PACKETS
+#define UIP_PACKETQUEUE_PACKETS UIP_PACKETQUEUE_CONF_PACKETS
+#else /* UIP_PACKETQUEUE_CONF_PACKETS */
+#define UIP_PACKETQUEUE_PACKETS 2
+#endif /* UIP_PACKETQUEUE_CONF_PACKETS */
+
+/* The number of packets that can be queued on a single handle, so that
+   one unresolved neighbor cannot take all of the packets. */
+#ifdef UIP_PACKETQUEUE_CONF_PACKETS_PER_HANDLE
+#define UIP_PACKETQUEUE_PACKETS_PER_HANDLE UIP_PACKETQUEUE_CONF_PACKETS_PER_HANDLE
+#else /* UIP_PACKETQUEUE_CONF_PACKETS_PER_HANDLE */
+#define UIP_PACKETQUEUE_PACKETS_PER_HANDLE UIP_PACKETQUEUE_PACKETS
+#endif /* UIP_PACKETQUEUE_CONF_PACKETS_PER_HANDLE */
+
 struct uip_packetqueue_handle;
 
 struct uip_packetqueue_packet {
-  struct uip_ds6_queued_packet *next;
+  struct uip_packetqueue_packet *next;
   uint8_t queue_buf[UIP_BUFSIZE - UIP_LLH_LEN];
   uint16_t queue_buf_len;
   struct ctimer lifetimer;
   struct uip_packetqueue_handle *handle;
 };
 
+/* The packets of a handle, oldest first. */
 struct uip_packetqueue_handle {
   struct uip_packetqueue_packet *packet;
 };
 
 void uip_packetqueue_new(struct uip_packetqueue_handle *handle);
 
-
+/* Append a packet to the queue of the handle. The caller fills in the
+   queue_buf and queue_buf_len of the returned packet. NULL is returned
+   when the handle or the pool is full. */
 struct uip_packetqueue_packet *
 uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime);
 
-
+/* Free all packets of the handle. */
 void
 uip_packetqueue_free(struct uip_packetqueue_handle *handle);
 
+/* Free the oldest packet of the handle, after it has been sent. */
+void
+uip_packetqueue_pop(struct uip_packetqueue_handle *handle);
+
+/* The buffer and length of the oldest packet of the handle. */
 uint8_t *uip_packetqueue_buf(struct uip_packetqueue_handle *h);
 uint16_t uip_packetqueue_buflen(struct uip_packetqueue_handle *h);
 void uip_packetqueue_set_buflen(struct uip_packetqueue_handle *h, uint16_t len);
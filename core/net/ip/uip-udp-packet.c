@@ -42,6 +42,7 @@
 extern uint16_t uip_slen;
 
 #include "net/ip/uip-udp-packet.h"
+#include "net/ip/tcpip.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 
 #include <string.h>
@@ -102,3 +103,40 @@ uip_udp_packet_sendto(struct uip_udp_conn *c, const void *data, int len,
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+uip_udp_packet_sendto_batch(struct uip_udp_conn *c,
+                            const struct uip_udp_packet_item *items,
+                            int count)
+{
+  uip_ipaddr_t curaddr;
+  uint16_t curport;
+  int i, sent;
+#if NETSTACK_CONF_WITH_IPV6
+  struct tcpip_nexthop_cache cache;
+
+  tcpip_ipv6_output_batch(&cache);
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+
+  uip_ipaddr_copy(&curaddr, &c->ripaddr);
+  curport = c->rport;
+
+  sent = 0;
+  for(i = 0; i < count; i++) {
+    if(items[i].to == NULL) {
+      continue;
+    }
+    uip_ipaddr_copy(&c->ripaddr, items[i].to);
+    c->rport = items[i].port != 0 ? UIP_HTONS(items[i].port) : curport;
+    uip_udp_packet_send(c, items[i].data, items[i].datalen);
+    sent++;
+  }
+
+  uip_ipaddr_copy(&c->ripaddr, &curaddr);
+  c->rport = curport;
+
+#if NETSTACK_CONF_WITH_IPV6
+  tcpip_ipv6_output_batch(NULL);
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+  return sent;
+}
+/*---------------------------------------------------------------------------*/
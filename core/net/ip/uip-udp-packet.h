@@ -46,4 +46,25 @@ void uip_udp_packet_send(struct uip_udp_conn *c, const void *data, int len);
 void uip_udp_packet_sendto(struct uip_udp_conn *c, const void *data, int len,
 			   const uip_ipaddr_t *toaddr, uint16_t toport);
 
+/**
+ * A datagram of a batch. Unlike with uip_udp_packet_sendto(), the port
+ * is in host byte order; 0 is the remote port of the connection.
+ */
+struct uip_udp_packet_item {
+  const uip_ipaddr_t *to;
+  uint16_t port;
+  const void *data;
+  uint16_t datalen;
+};
+
+/**
+ * Sends a batch of datagrams on a connection, one after the other.
+ * The route of a destination is looked up once for consecutive
+ * datagrams to it, so the items are best grouped by destination.
+ * Returns the number of datagrams handed to the IP layer.
+ */
+int uip_udp_packet_sendto_batch(struct uip_udp_conn *c,
+                                const struct uip_udp_packet_item *items,
+                                int count);
+
 #endif /* UIP_UDP_PACKET_H_ */
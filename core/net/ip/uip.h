@@ -836,7 +836,20 @@ CCIF void uip_send(const void *data, int len);
  *
  * \hideinitializer
  */
+#if UIP_TCP_SEGMENTS > 1
+#define uip_mss()             uip_tcp_sendable(uip_conn)
+#else /* UIP_TCP_SEGMENTS > 1 */
 #define uip_mss()             (uip_conn->mss)
+#endif /* UIP_TCP_SEGMENTS > 1 */
+
+/**
+ * \internal
+ *
+ * The amount of new data that may be sent on a connection right now,
+ * with UIP_CONF_TCP_SEGMENTS larger than 1. This is at most one
+ * segment, and zero when the window is full.
+ */
+uint16_t uip_tcp_sendable(struct uip_conn *conn);
 
 /**
  * Set up a new UDP connection.
@@ -886,7 +899,19 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_DEMUX_HASH
+#define uip_udp_bind(conn, port) do { (conn)->lport = port;     \
+                                      uip_udp_demux_flush(); } while(0)
+#else /* UIP_DEMUX_HASH */
 #define uip_udp_bind(conn, port) (conn)->lport = port
+#endif /* UIP_DEMUX_HASH */
+
+/**
+ * Forget which UDP connections incoming packets were last delivered
+ * to. Called when a connection is bound to a port, since it may then
+ * take the packets of another one.
+ */
+void uip_udp_demux_flush(void);
 
 /**
  * Send a UDP datagram of length len on the current connection.
@@ -1370,6 +1395,12 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
                               segment sent. */
+#if UIP_TCP_SEGMENTS > 1
+  uint16_t snd_wnd;      /**< The window last advertised by the remote host. */
+#endif /* UIP_TCP_SEGMENTS > 1 */
+#if UIP_TCP_DELAYED_ACK
+  uint8_t ackpending;    /**< Received data has not been acknowledged yet. */
+#endif /* UIP_TCP_DELAYED_ACK */
 
   uip_tcp_appstate_t appstate; /** The application state. */
 };
@@ -252,6 +252,24 @@ void uip_log(char *msg);
  */
 #define UIP_REASS_MAXAGE 60 /*60s*/
 
+/**
+ * The number of IPv6 datagrams that can be reassembled at the same
+ * time.
+ *
+ * Each datagram being reassembled takes a buffer of the size of
+ * uip_buf from a shared pool, with its own timeout. Fragments of a
+ * further datagram are dropped while all buffers are in use. Border
+ * routers that receive fragmented packets from several senders at once
+ * should have more than one.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_REASS_CONTEXTS
+#define UIP_REASS_CONTEXTS UIP_CONF_REASS_CONTEXTS
+#else /* UIP_CONF_REASS_CONTEXTS */
+#define UIP_REASS_CONTEXTS 1
+#endif /* UIP_CONF_REASS_CONTEXTS */
+
 /**
  * Turn on support for IP packet reassembly.
  *
@@ -435,6 +453,24 @@ void uip_log(char *msg);
 #define UIP_LISTENPORTS (UIP_CONF_MAX_LISTENPORTS)
 #endif /* UIP_CONF_MAX_LISTENPORTS */
 
+/**
+ * The number of hash buckets (a power of two) for finding the TCP
+ * connection and the UDP connection of incoming packets.
+ *
+ * Each bucket remembers which connection last matched the packets
+ * that hash to it, so that a packet is usually demultiplexed without
+ * scanning all connections. With the default 0, every packet scans
+ * them, which is enough for the default number of connections. Each
+ * bucket takes one byte per protocol.
+ *
+ * \hideinitializer
+ */
+#ifndef UIP_CONF_DEMUX_HASH
+#define UIP_DEMUX_HASH 0
+#else /* UIP_CONF_DEMUX_HASH */
+#define UIP_DEMUX_HASH (UIP_CONF_DEMUX_HASH)
+#endif /* UIP_CONF_DEMUX_HASH */
+
 /**
  * Determines if support for TCP urgent data notification should be
  * compiled in.
@@ -500,6 +536,49 @@ void uip_log(char *msg);
 #define UIP_RECEIVE_WINDOW (UIP_CONF_RECEIVE_WINDOW)
 #endif
 
+/**
+ * The number of full-sized segments that a TCP connection may have
+ * unacknowledged at the same time.
+ *
+ * With the default of 1, uIP sends one segment and waits for it to be
+ * acknowledged before the application may send the next one, which
+ * limits the throughput to one segment per round-trip time. With a
+ * larger value, the application may send new data while earlier data
+ * is in transit, as long as it fits both this limit and the
+ * receiver's window. The application keeps all unacknowledged data
+ * and, when uip_rexmit() is set, sends it again starting from the
+ * oldest unacknowledged byte (go-back-N). uip_outstanding() tells how
+ * much data is still unacknowledged, and uip_mss() how much may be
+ * sent right now. Only supported by the IPv6 stack.
+ *
+ * \hideinitializer
+ */
+#if defined(UIP_CONF_TCP_SEGMENTS) && NETSTACK_CONF_WITH_IPV6
+#define UIP_TCP_SEGMENTS (UIP_CONF_TCP_SEGMENTS)
+#else /* UIP_CONF_TCP_SEGMENTS */
+#define UIP_TCP_SEGMENTS 1
+#endif /* UIP_CONF_TCP_SEGMENTS */
+
+/**
+ * Delay the acknowledgement of incoming TCP data (RFC 1122, 4.2.3.2).
+ *
+ * When set, a segment with new data is not acknowledged right away
+ * unless an earlier segment is also unacknowledged, so that every
+ * second segment is acknowledged. The acknowledgement is otherwise
+ * sent with the next data segment on the connection, or on the next
+ * tick of the periodic TCP timer, at most half a second later. This
+ * saves one transmission per segment in bulk transfers and lets the
+ * acknowledgement of a request ride on the reply. Only supported by
+ * the IPv6 stack.
+ *
+ * \hideinitializer
+ */
+#if defined(UIP_CONF_TCP_DELAYED_ACK) && NETSTACK_CONF_WITH_IPV6
+#define UIP_TCP_DELAYED_ACK (UIP_CONF_TCP_DELAYED_ACK)
+#else /* UIP_CONF_TCP_DELAYED_ACK */
+#define UIP_TCP_DELAYED_ACK 0
+#endif /* UIP_CONF_TCP_DELAYED_ACK */
+
 /**
  * How long a connection should stay in the TIME_WAIT state.
  *
@@ -32,7 +32,7 @@
 #include "ip64-addrmap.h"
 
 #include "lib/memb.h"
-#include "lib/list.h"
+#include "lib/hashlist.h"
 
 #include "ip64-conf.h"
 
@@ -46,8 +46,24 @@
 #define NUM_ENTRIES 32
 #endif /* IP64_ADDRMAP_CONF_ENTRIES */
 
+/* The number of buckets in each of the two hash tables, a power of
+   two. */
+#ifdef IP64_ADDRMAP_CONF_BUCKETS
+#define NUM_BUCKETS IP64_ADDRMAP_CONF_BUCKETS
+#else /* IP64_ADDRMAP_CONF_BUCKETS */
+#define NUM_BUCKETS 16
+#endif /* IP64_ADDRMAP_CONF_BUCKETS */
+
 MEMB(entrymemb, struct ip64_addrmap_entry, NUM_ENTRIES);
-LIST(entrylist);
+
+/* The mappings, ordered by expiration time, so that expired and
+   recyclable mappings are found at the start of the list. */
+static struct ip64_addrmap_entry *entrylist_head, *entrylist_tail;
+
+/* The mappings, chained on tuple_next by their IPv6 side and on
+   port_next by their mapped port. */
+static struct ip64_addrmap_entry *tuple_buckets[NUM_BUCKETS];
+static struct ip64_addrmap_entry *port_buckets[NUM_BUCKETS];
 
 #define FIRST_MAPPED_PORT 10000
 #define LAST_MAPPED_PORT  20000
@@ -55,37 +71,125 @@ static uint16_t mapped_port = FIRST_MAPPED_PORT;
 
 #define printf(...)
 
+/*---------------------------------------------------------------------------*/
+static struct ip64_addrmap_entry **
+tuple_bucket(const uip_ip6addr_t *ip6addr,
+             uint16_t ip6port,
+             const uip_ip4addr_t *ip4addr,
+             uint16_t ip4port,
+             uint8_t protocol)
+{
+  uint32_t hash;
+
+  hash = hashlist_hash(&ip6addr->u8[8], 8);
+  hash = hash * 31 + ip6port;
+  hash = hash * 31 + (ip4addr->u16[0] ^ ip4addr->u16[1]);
+  hash = hash * 31 + ip4port;
+  hash = hash * 31 + protocol;
+  return &tuple_buckets[(hash ^ (hash >> 16)) & (NUM_BUCKETS - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static struct ip64_addrmap_entry **
+port_bucket(uint16_t port)
+{
+  return &port_buckets[port & (NUM_BUCKETS - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+remaining(struct ip64_addrmap_entry *m)
+{
+  return timer_expired(&m->timer) ? 0 : timer_remaining(&m->timer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+entrylist_unlink(struct ip64_addrmap_entry *m)
+{
+  if(m->prev != NULL) {
+    m->prev->next = m->next;
+  } else {
+    entrylist_head = m->next;
+  }
+  if(m->next != NULL) {
+    m->next->prev = m->prev;
+  } else {
+    entrylist_tail = m->prev;
+  }
+  m->next = m->prev = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+entrylist_insert(struct ip64_addrmap_entry *m)
+{
+  struct ip64_addrmap_entry *p;
+  clock_time_t r;
+
+  /* Lifetimes are mostly renewed with the longest lifetime, so the
+     place of the mapping is searched for from the end of the list. */
+  r = remaining(m);
+  for(p = entrylist_tail; p != NULL && remaining(p) > r; p = p->prev);
+
+  m->prev = p;
+  if(p == NULL) {
+    m->next = entrylist_head;
+    entrylist_head = m;
+  } else {
+    m->next = p->next;
+    p->next = m;
+  }
+  if(m->next != NULL) {
+    m->next->prev = m;
+  } else {
+    entrylist_tail = m;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_entry(struct ip64_addrmap_entry *m)
+{
+  struct ip64_addrmap_entry **p;
+
+  for(p = tuple_bucket(&m->ip6addr, m->ip6port, &m->ip4addr, m->ip4port,
+                       m->protocol);
+      *p != NULL;
+      p = &(*p)->tuple_next) {
+    if(*p == m) {
+      *p = m->tuple_next;
+      break;
+    }
+  }
+  for(p = port_bucket(m->mapped_port); *p != NULL; p = &(*p)->port_next) {
+    if(*p == m) {
+      *p = m->port_next;
+      break;
+    }
+  }
+  entrylist_unlink(m);
+  memb_free(&entrymemb, m);
+}
 /*---------------------------------------------------------------------------*/
 struct ip64_addrmap_entry *
 ip64_addrmap_list(void)
 {
-  return list_head(entrylist);
+  return entrylist_head;
 }
 /*---------------------------------------------------------------------------*/
 void
 ip64_addrmap_init(void)
 {
   memb_init(&entrymemb);
-  list_init(entrylist);
+  entrylist_head = entrylist_tail = NULL;
+  memset(tuple_buckets, 0, sizeof(tuple_buckets));
+  memset(port_buckets, 0, sizeof(port_buckets));
   mapped_port = FIRST_MAPPED_PORT;
 }
 /*---------------------------------------------------------------------------*/
 static void
 check_age(void)
 {
-  struct ip64_addrmap_entry *m;
-
-  /* Walk through the list of address mappings, throw away the ones
-     that are too old. */
-  m = list_head(entrylist);
-  while(m != NULL) {
-    if(timer_expired(&m->timer)) {
-      list_remove(entrylist, m);
-      memb_free(&entrymemb, m);
-      m = list_head(entrylist);
-    } else {
-      m = list_item_next(m);
-    }
+  /* Throw away the address mappings that are too old. They are at the
+     start of the list. */
+  while(entrylist_head != NULL && timer_expired(&entrylist_head->timer)) {
+    remove_entry(entrylist_head);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -93,35 +197,15 @@ static int
 recycle(void)
 {
   /* Find the oldest recyclable mapping and remove it. */
-  struct ip64_addrmap_entry *m, *oldest;
-
-  /* Walk through the list of address mappings, throw away the ones
-     that are too old. */
+  struct ip64_addrmap_entry *m;
 
-  oldest = NULL;
-  for(m = list_head(entrylist);
-      m != NULL;
-      m = list_item_next(m)) {
+  for(m = entrylist_head; m != NULL; m = m->next) {
     if(m->flags & FLAGS_RECYCLABLE) {
-      if(oldest == NULL) {
-        oldest = m;
-      } else {
-        if(timer_remaining(&m->timer) <
-           timer_remaining(&oldest->timer)) {
-          oldest = m;
-        }
-      }
+      remove_entry(m);
+      return 1;
     }
   }
 
-  /* If we found an oldest recyclable entry, remove it and return
-     non-zero. */
-  if(oldest != NULL) {
-    list_remove(entrylist, oldest);
-    memb_free(&entrymemb, oldest);
-    return 1;
-  }
-
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -137,7 +221,9 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
   printf("lookup ip4port %d ip6port %d\n", uip_htons(ip4port),
 	 uip_htons(ip6port));
   check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
+  for(m = *tuple_bucket(ip6addr, ip6port, ip4addr, ip4port, protocol);
+      m != NULL;
+      m = m->tuple_next) {
     printf("protocol %d %d, ip4port %d %d, ip6port %d %d, ip4 %d ip6 %d\n",
 	   m->protocol, protocol,
 	   m->ip4port, ip4port,
@@ -162,7 +248,7 @@ ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
   struct ip64_addrmap_entry *m;
 
   check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
+  for(m = *port_bucket(mapped_port); m != NULL; m = m->port_next) {
     printf("mapped port %d %d, protocol %d %d\n",
 	   m->mapped_port, mapped_port,
 	   m->protocol, protocol);
@@ -182,6 +268,19 @@ increase_mapped_port(void)
     FIRST_MAPPED_PORT;
 }
 /*---------------------------------------------------------------------------*/
+static int
+mapped_port_in_use(uint16_t port)
+{
+  struct ip64_addrmap_entry *m;
+
+  for(m = *port_bucket(port); m != NULL; m = m->port_next) {
+    if(m->mapped_port == port) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 struct ip64_addrmap_entry *
 ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
 		    uint16_t ip6port,
@@ -190,6 +289,7 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
 		    uint8_t protocol)
 {
   struct ip64_addrmap_entry *m;
+  struct ip64_addrmap_entry **bucket;
 
   check_age();
   m = memb_alloc(&entrymemb);
@@ -214,22 +314,19 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
     /* Pick a new, unused local port. First make sure that the
        mapped_port number does not belong to any active connection. If
        so, we keep increasing the mapped_port until we're free. */
-    {
-      struct ip64_addrmap_entry *n;
-      n = list_head(entrylist);
-      while(n != NULL) {
-	if(n->mapped_port == mapped_port) {
-	  increase_mapped_port();
-	  n = list_head(entrylist);
-	} else {
-	  n = list_item_next(m);
-	}
-      }
+    while(mapped_port_in_use(mapped_port)) {
+      increase_mapped_port();
     }
     m->mapped_port = mapped_port;
     increase_mapped_port();
 
-    list_add(entrylist, m);
+    bucket = tuple_bucket(ip6addr, ip6port, ip4addr, ip4port, protocol);
+    m->tuple_next = *bucket;
+    *bucket = m;
+    bucket = port_bucket(m->mapped_port);
+    m->port_next = *bucket;
+    *bucket = m;
+    entrylist_insert(m);
     return m;
   }
   return NULL;
@@ -241,6 +338,8 @@ ip64_addrmap_set_lifetime(struct ip64_addrmap_entry *e,
 {
   if(e != NULL) {
     timer_set(&e->timer, time);
+    entrylist_unlink(e);
+    entrylist_insert(e);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -37,7 +37,11 @@
 #include "net/ip/uip.h"
 
 struct ip64_addrmap_entry {
-  struct ip64_addrmap_entry *next;
+  /* The mappings are kept on a list ordered by expiration time, and
+     in two hash tables: one for the IPv6 side and one for the mapped
+     port. */
+  struct ip64_addrmap_entry *next, *prev;
+  struct ip64_addrmap_entry *tuple_next, *port_next;
   struct timer timer;
   uip_ip6addr_t ip6addr;
   uip_ip4addr_t ip4addr;
@@ -97,7 +101,8 @@ void ip64_addrmap_set_lifetime(struct ip64_addrmap_entry *e,
 void ip64_addrmap_set_recycleble(struct ip64_addrmap_entry *e);
 
 /**
- * Obtain the list of all address mappings.
+ * Obtain the list of all address mappings, the one that expires first
+ * being the first one.
  */
 struct ip64_addrmap_entry *ip64_addrmap_list(void);
 #endif /* IP64_ADDRMAP_H */
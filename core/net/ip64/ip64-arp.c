@@ -35,10 +35,22 @@
 #include "ip64.h"
 #include "ip64-eth.h"
 #include "ip64-arp.h"
+#include "sys/ctimer.h"
 
 #include <string.h>
 #include <stdio.h>
 
+/* The number of hash buckets for looking up ARP entries, a power of
+   two. */
+#ifdef IP64_ARP_CONF_BUCKETS
+#define NUM_BUCKETS IP64_ARP_CONF_BUCKETS
+#else /* IP64_ARP_CONF_BUCKETS */
+#define NUM_BUCKETS 8
+#endif /* IP64_ARP_CONF_BUCKETS */
+
+/* The entries are aged in steps of 10 seconds, see UIP_ARP_MAXAGE. */
+#define ARP_TIMER_INTERVAL (10 * CLOCK_SECOND)
+
 #define printf(...)
 
 struct arp_hdr {
@@ -87,8 +99,11 @@ struct ipv4_hdr {
 #define ARP_HWTYPE_ETH 1
 
 struct arp_entry {
+  struct arp_entry *next;
   uip_ip4addr_t ipaddr;
-  struct uip_eth_addr ethaddr;
+  /* The Ethernet header of IPv4 packets to this neighbor, built once
+     when the entry is updated. */
+  struct ip64_eth_hdr ethhdr;
   uint8_t time;
 };
 
@@ -98,6 +113,15 @@ static const uint16_t broadcast_ipaddr[2] = {0xffff,0xffff};
 
 static struct arp_entry arp_table[UIP_ARPTAB_SIZE];
 
+/* The entries in use, chained on next by their IP address */
+static struct arp_entry *buckets[NUM_BUCKETS];
+
+/* The entry that was looked up last. An IP64 gateway mostly sends to
+   its default router, so this saves the lookup for most packets. */
+static struct arp_entry *last_entry;
+
+static struct ctimer arp_timer;
+
 static uint8_t arptime;
 static uint8_t tmpage;
 
@@ -111,6 +135,73 @@ static uint8_t tmpage;
 
 const uip_ipaddr_t uip_all_zeroes_addr;
 
+/*---------------------------------------------------------------------------*/
+static struct arp_entry **
+bucket(const uip_ip4addr_t *ipaddr)
+{
+  uint16_t hash;
+
+  hash = ipaddr->u16[0] ^ ipaddr->u16[1];
+  hash ^= hash >> 8;
+  return &buckets[hash & (NUM_BUCKETS - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static struct arp_entry *
+lookup(const uip_ip4addr_t *ipaddr)
+{
+  struct arp_entry *tabptr;
+
+  if(last_entry != NULL && uip_ip4addr_cmp(ipaddr, &last_entry->ipaddr)) {
+    return last_entry;
+  }
+  for(tabptr = *bucket(ipaddr); tabptr != NULL; tabptr = tabptr->next) {
+    if(uip_ip4addr_cmp(ipaddr, &tabptr->ipaddr)) {
+      last_entry = tabptr;
+      return tabptr;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_entry(struct arp_entry *tabptr)
+{
+  struct arp_entry **pp;
+
+  for(pp = bucket(&tabptr->ipaddr); *pp != NULL; pp = &(*pp)->next) {
+    if(*pp == tabptr) {
+      *pp = tabptr->next;
+      break;
+    }
+  }
+  if(last_entry == tabptr) {
+    last_entry = NULL;
+  }
+  tabptr->next = NULL;
+  memset(&tabptr->ipaddr, 0, 4);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the address whose MAC address is the destination of an IPv4
+   packet: the destination itself if it is on the local network, else
+   the default router. */
+static void
+nexthop(const struct ipv4_hdr *ipv4_hdr, uip_ip4addr_t *ipaddr)
+{
+  if(!uip_ipaddr_maskcmp(&ipv4_hdr->destipaddr,
+                         ip64_get_hostaddr(),
+                         ip64_get_netmask())) {
+    uip_ip4addr_copy(ipaddr, ip64_get_draddr());
+  } else {
+    uip_ip4addr_copy(ipaddr, &ipv4_hdr->destipaddr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+arp_timer_expired(void *ptr)
+{
+  ip64_arp_timer();
+  ctimer_reset(&arp_timer);
+}
 /*---------------------------------------------------------------------------*/
 /**
  * Initialize the ARP module.
@@ -119,19 +210,30 @@ const uip_ipaddr_t uip_all_zeroes_addr;
 /*---------------------------------------------------------------------------*/
 void
 ip64_arp_init(void)
+{
+  ip64_arp_flush();
+  ctimer_set(&arp_timer, ARP_TIMER_INTERVAL, arp_timer_expired, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+ip64_arp_flush(void)
 {
   int i;
+
   for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
+    arp_table[i].next = NULL;
     memset(&arp_table[i].ipaddr, 0, 4);
   }
+  memset(buckets, 0, sizeof(buckets));
+  last_entry = NULL;
 }
 /*---------------------------------------------------------------------------*/
 /**
  * Periodic ARP processing function.
  *
- * This function performs periodic timer processing in the ARP module
- * and should be called at regular intervals. The recommended interval
- * is 10 seconds between the calls.
+ * This function performs periodic timer processing in the ARP module.
+ * ip64_arp_init() sets up a callback timer that calls it every 10
+ * seconds.
  *
  */
 /*---------------------------------------------------------------------------*/
@@ -144,9 +246,9 @@ ip64_arp_timer(void)
   ++arptime;
   for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
     tabptr = &arp_table[i];
-    if(uip_ip4addr_cmp(&tabptr->ipaddr, &uip_all_zeroes_addr) &&
-       arptime - tabptr->time >= UIP_ARP_MAXAGE) {
-      memset(&tabptr->ipaddr, 0, 4);
+    if(!uip_ip4addr_cmp(&tabptr->ipaddr, &uip_all_zeroes_addr) &&
+       (uint8_t)(arptime - tabptr->time) >= UIP_ARP_MAXAGE) {
+      remove_entry(tabptr);
     }
   }
 
@@ -156,30 +258,17 @@ ip64_arp_timer(void)
 static void
 arp_update(uip_ip4addr_t *ipaddr, struct uip_eth_addr *ethaddr)
 {
-  register struct arp_entry *tabptr = arp_table;
+  register struct arp_entry *tabptr;
   int i, c;
   
-  /* Walk through the ARP mapping table and try to find an entry to
-     update. If none is found, the IP -> MAC address mapping is
-     inserted in the ARP table. */
-  for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
-    tabptr = &arp_table[i];
-
-    /* Only check those entries that are actually in use. */
-    if(!uip_ip4addr_cmp(&tabptr->ipaddr, &uip_all_zeroes_addr)) {
-
-      /* Check if the source IP address of the incoming packet matches
-         the IP address in this ARP table entry. */
-      if(uip_ip4addr_cmp(ipaddr, &tabptr->ipaddr)) {
-	 
-	/* An old entry found, update this and return. */
-	memcpy(tabptr->ethaddr.addr, ethaddr->addr, 6);
-	tabptr->time = arptime;
-
-	return;
-      }
-    }
-	tabptr++;
+  /* Look up the IP address in the ARP table and update the entry. If
+     none is found, the IP -> MAC address mapping is inserted in the
+     ARP table. */
+  tabptr = lookup(ipaddr);
+  if(tabptr != NULL) {
+    memcpy(tabptr->ethhdr.dest.addr, ethaddr->addr, 6);
+    tabptr->time = arptime;
+    return;
   }
 
   /* If we get here, no existing ARP table entry was found, so we
@@ -207,13 +296,19 @@ arp_update(uip_ip4addr_t *ipaddr, struct uip_eth_addr *ethaddr)
     }
     i = c;
     tabptr = &arp_table[i];
+    remove_entry(tabptr);
   }
 
   /* Now, i is the ARP table entry which we will fill with the new
      information. */
   uip_ip4addr_copy(&tabptr->ipaddr, ipaddr);
-  memcpy(tabptr->ethaddr.addr, ethaddr->addr, 6);
+  memcpy(tabptr->ethhdr.dest.addr, ethaddr->addr, 6);
+  memcpy(tabptr->ethhdr.src.addr, ip64_eth_addr.addr, 6);
+  tabptr->ethhdr.type = UIP_HTONS(IP64_ETH_TYPE_IP);
   tabptr->time = arptime;
+
+  tabptr->next = *bucket(ipaddr);
+  *bucket(ipaddr) = tabptr;
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
@@ -272,7 +367,6 @@ ip64_arp_check_cache(const uint8_t *nlhdr)
 {
   struct ipv4_hdr *ipv4_hdr = (struct ipv4_hdr *)nlhdr;
   uip_ip4addr_t broadcast_addr;
-  struct arp_entry *tabptr = arp_table;
 
   printf("check cache %d.%d.%d.%d\n",
 	 uip_ipaddr_to_quad(&ipv4_hdr->destipaddr));
@@ -287,30 +381,9 @@ ip64_arp_check_cache(const uint8_t *nlhdr)
     return 1;
   } else {
     uip_ip4addr_t ipaddr;
-    int i;
-    /* Check if the destination address is on the local network. */
-    if(!uip_ipaddr_maskcmp(&ipv4_hdr->destipaddr,
-			   ip64_get_hostaddr(),
-			   ip64_get_netmask())) {
-      /* Destination address was not on the local network, so we need to
-	 use the default router's IP address instead of the destination
-	 address when determining the MAC address. */
-      uip_ip4addr_copy(&ipaddr, ip64_get_draddr());
-    } else {
-      /* Else, we use the destination IP address. */
-      uip_ip4addr_copy(&ipaddr, &ipv4_hdr->destipaddr);
-    }
-    for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
-      if(uip_ip4addr_cmp(&ipaddr, &tabptr->ipaddr)) {
-	break;
-      }
-      tabptr++;
-    }
 
-    if(i == UIP_ARPTAB_SIZE) {
-      return 0;
-    }
-    return 1;
+    nexthop(ipv4_hdr, &ipaddr);
+    return lookup(&ipaddr) != NULL;
   }
   return 0;
 }
@@ -318,23 +391,20 @@ ip64_arp_check_cache(const uint8_t *nlhdr)
 int
 ip64_arp_create_ethhdr(uint8_t *llhdr, const uint8_t *nlhdr)
 {
-  struct arp_entry *tabptr = arp_table;
+  struct arp_entry *tabptr;
   struct ipv4_hdr *ipv4_hdr = (struct ipv4_hdr *)nlhdr;
   struct ip64_eth_hdr *ethhdr = (struct ip64_eth_hdr *)llhdr;
-  uip_ip4addr_t broadcast_addr;
-  
-  /* Find the destination IP address in the ARP table and construct
-     the Ethernet header. If the destination IP addres isn't on the
-     local network, we use the default router's IP address instead.
+  uip_ip4addr_t ipaddr;
 
-     If not ARP table entry is found, we overwrite the original IP
-     packet with an ARP request for the IP address. */
+  /* Find the destination IP address in the ARP table and copy the
+     Ethernet header of the entry. If the destination IP addres isn't
+     on the local network, we use the default router's IP address
+     instead.
 
-  /* First check if destination is a local broadcast. */
-  uip_ipaddr(&broadcast_addr, 255,255,255,255);
-  if(uip_ip4addr_cmp(&ipv4_hdr->destipaddr, &broadcast_addr)) {
-    memcpy(&ethhdr->dest.addr, &broadcast_ethaddr.addr, 6);
-  } else if(ipv4_hdr->destipaddr.u8[0] == 224) {
+     If no ARP table entry is found, 0 is returned and the caller
+     should send an ARP request instead. */
+
+  if(ipv4_hdr->destipaddr.u8[0] == 224) {
     /* Multicast. */
     ethhdr->dest.addr[0] = 0x01;
     ethhdr->dest.addr[1] = 0x00;
@@ -342,34 +412,18 @@ ip64_arp_create_ethhdr(uint8_t *llhdr, const uint8_t *nlhdr)
     ethhdr->dest.addr[3] = ipv4_hdr->destipaddr.u8[1];
     ethhdr->dest.addr[4] = ipv4_hdr->destipaddr.u8[2];
     ethhdr->dest.addr[5] = ipv4_hdr->destipaddr.u8[3];
+  } else if(ipv4_hdr->destipaddr.u16[0] == broadcast_ipaddr[0] &&
+            ipv4_hdr->destipaddr.u16[1] == broadcast_ipaddr[1]) {
+    /* Local broadcast. */
+    memcpy(&ethhdr->dest.addr, &broadcast_ethaddr.addr, 6);
   } else {
-    uip_ip4addr_t ipaddr;
-    int i;
-    /* Check if the destination address is on the local network. */
-    if(!uip_ipaddr_maskcmp(&ipv4_hdr->destipaddr,
-			   ip64_get_hostaddr(),
-			   ip64_get_netmask())) {
-      /* Destination address was not on the local network, so we need to
-	 use the default router's IP address instead of the destination
-	 address when determining the MAC address. */
-      uip_ip4addr_copy(&ipaddr, ip64_get_draddr());
-    } else {
-      /* Else, we use the destination IP address. */
-      uip_ip4addr_copy(&ipaddr, &ipv4_hdr->destipaddr);
-    }
-    for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
-      if(uip_ip4addr_cmp(&ipaddr, &tabptr->ipaddr)) {
-	break;
-      }
-      tabptr++;
-    }
-
-    if(i == UIP_ARPTAB_SIZE) {
+    nexthop(ipv4_hdr, &ipaddr);
+    tabptr = lookup(&ipaddr);
+    if(tabptr == NULL) {
       return 0;
     }
-
-    memcpy(ethhdr->dest.addr, tabptr->ethaddr.addr, 6);
-
+    memcpy(ethhdr, &tabptr->ethhdr, sizeof(struct ip64_eth_hdr));
+    return sizeof(struct ip64_eth_hdr);
   }
   memcpy(ethhdr->src.addr, ip64_eth_addr.addr, 6);
   
@@ -383,18 +437,8 @@ ip64_arp_create_arp_request(uint8_t *llhdr, const uint8_t *nlhdr)
   struct ipv4_hdr *ipv4_hdr = (struct ipv4_hdr *)nlhdr;
   struct arp_hdr *arp_hdr = (struct arp_hdr *)llhdr;
   uip_ip4addr_t ipaddr;
-  
-  if(!uip_ipaddr_maskcmp(&ipv4_hdr->destipaddr,
-			 ip64_get_hostaddr(),
-			 ip64_get_netmask())) {
-    /* Destination address was not on the local network, so we need to
-       use the default router's IP address instead of the destination
-       address when determining the MAC address. */
-    uip_ip4addr_copy(&ipaddr, ip64_get_draddr());
-  } else {
-    /* Else, we use the destination IP address. */
-    uip_ip4addr_copy(&ipaddr, &ipv4_hdr->destipaddr);
-  }
+
+  nexthop(ipv4_hdr, &ipaddr);
   
   memset(arp_hdr->ethhdr.dest.addr, 0xff, 6);
   memset(arp_hdr->dhwaddr.addr, 0x00, 6);
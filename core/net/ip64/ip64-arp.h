@@ -44,6 +44,16 @@
    ARP functions. */
 void ip64_arp_init(void);
 
+/* The ip64_arp_flush() function removes all entries from the ARP
+   table. It is called when the Ethernet address changes, as the
+   entries hold prebuilt Ethernet headers. */
+void ip64_arp_flush(void);
+
+/* The ip64_arp_timer() function ages the ARP table entries. It is
+   called every 10 seconds by a callback timer that ip64_arp_init()
+   sets up. */
+void ip64_arp_timer(void);
+
 /* The uip_arp_ipin() function should be called whenever an IP packet
    arrives from the Ethernet. This function refreshes the ARP table or
    inserts a new mapping if none exists. The function assumes that an
@@ -72,6 +82,9 @@ uint16_t ip64_arp_arp_input(const uint8_t *packet, uint16_t packet_len);
 void ip64_arp_ip_output(uint8_t *packet, uint16_t packet_len);
 
 
+/* The ip64_arp_create_ethhdr() function writes the Ethernet header
+   for an IPv4 packet and returns its length, or 0 if the MAC address
+   of the next hop is not in the ARP table yet. */
 int ip64_arp_create_ethhdr(uint8_t *link_header,
 			   const uint8_t *network_header);
 
@@ -45,4 +45,25 @@
  * optional configuration parameter. The default value is set in ip64.h 
  */
 /* #define IP64_CONF_DHCP                      1 */
+
+/*
+ * The number of address mappings (flows), 32 by default, and the number
+ * of hash buckets used to look them up, 16 by default. Routers that
+ * serve many flows should increase both.
+ */
+/* #define IP64_ADDRMAP_CONF_ENTRIES           256 */
+/* #define IP64_ADDRMAP_CONF_BUCKETS           64 */
+
+/*
+ * The number of hash buckets used to look up ARP entries, 8 by
+ * default. The size of the ARP table is UIP_CONF_ARPTAB_SIZE.
+ */
+/* #define IP64_ARP_CONF_BUCKETS               16 */
+
+/*
+ * The number of synthesized DNS64 answers to cache, 0 (no cache) by
+ * default. With a cache, identical queries from several nodes are
+ * also sent upstream only once.
+ */
+/* #define IP64_DNS64_CONF_CACHE_ENTRIES       8 */
 #endif /* IP64_CONF_H */
@@ -33,7 +33,13 @@
 #include "ip64-addr.h"
 #include "ip64-dns64.h"
 
+#if IP64_DNS64_CACHE_ENTRIES
+#include "contiki-net.h"
+#include "net/ipv6/uip-ds6.h"
+#endif /* IP64_DNS64_CACHE_ENTRIES */
+
 #include <stdio.h>
+#include <string.h>
 
 #define DEBUG 0
 
@@ -175,7 +181,7 @@ ip64_dns64_4to6(const uint8_t *ipv4data, int ipv4datalen,
     } while(qlen != 0);
     q = qcopy;
     if(q[DNS_QUESTION_CLASS0] == 0 && q[DNS_QUESTION_CLASS1] == DNS_CLASS_IN &&
-       q[DNS_QUESTION_TYPE0] == 0 && q[DNS_QUESTION_TYPE1] == DNS_TYPE_AAAA) {
+       q[DNS_QUESTION_TYPE0] == 0 && q[DNS_QUESTION_TYPE1] == DNS_TYPE_A) {
       q[DNS_QUESTION_TYPE1] = DNS_TYPE_AAAA;
     }
 
@@ -257,3 +263,348 @@ ip64_dns64_4to6(const uint8_t *ipv4data, int ipv4datalen,
   return ipv6datalen;
 }
 /*---------------------------------------------------------------------------*/
+#if IP64_DNS64_CACHE_ENTRIES
+
+#define DNS_HDRLEN sizeof(struct dns_hdr)
+#define DNS_PORT   53
+
+#define UIP_IP_BUF  ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+struct waiter {
+  uip_ip6addr_t addr;
+  uint16_t port;
+  uint8_t id[2];
+};
+
+#define STATE_FREE    0
+#define STATE_PENDING 1
+#define STATE_VALID   2
+
+/* An entry holds the query while it is outstanding and the translated
+   answer after that. Both start with the same question, so entries
+   are matched on the bytes following the DNS header. */
+struct cache_entry {
+  uip_ip6addr_t server;
+  struct waiter owner;
+  struct waiter waiters[IP64_DNS64_CACHE_WAITERS];
+  unsigned long stored;
+  unsigned long expires;
+  uint16_t len;
+  uint16_t qend;
+  uint8_t state;
+  uint8_t nwaiters;
+  uint8_t data[IP64_DNS64_CACHE_MAXLEN];
+};
+
+static struct cache_entry cache[IP64_DNS64_CACHE_ENTRIES];
+
+PROCESS(ip64_dns64_process, "DNS64 cache");
+/*---------------------------------------------------------------------------*/
+/* Returns the end of the single question of a DNS message, or 0 if
+   the message does not have exactly one question or it does not fit
+   in a cache entry. */
+static int
+question_end(const uint8_t *data, int datalen)
+{
+  const struct dns_hdr *hdr = (const struct dns_hdr *)data;
+  int i;
+
+  if(datalen < DNS_HDRLEN ||
+     hdr->numquestions[0] != 0 || hdr->numquestions[1] != 1) {
+    return 0;
+  }
+  i = DNS_HDRLEN;
+  while(i < datalen && data[i] != 0) {
+    if(data[i] & 0xc0) {
+      return 0;
+    }
+    i += data[i] + 1;
+  }
+  i += 1 + DNS_QUESTION_SIZE;
+  if(i > datalen || i > IP64_DNS64_CACHE_MAXLEN) {
+    return 0;
+  }
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+/* Walks the answer records, subtracts elapsed seconds from their TTL
+   and returns the smallest TTL found. */
+static uint32_t
+answer_ttls(uint8_t *data, int datalen, int qend, uint32_t elapsed)
+{
+  struct dns_hdr *hdr = (struct dns_hdr *)data;
+  uint32_t ttl, min_ttl;
+  uint8_t *a, *end;
+  int i;
+
+  min_ttl = IP64_DNS64_CACHE_MAX_TTL;
+  a = data + qend;
+  end = data + datalen;
+  for(i = 0; i < ((hdr->numanswers[0] << 8) + hdr->numanswers[1]); i++) {
+    while(a < end && *a != 0 && (*a & 0xc0) == 0) {
+      a += *a + 1;
+    }
+    a += (a < end && (*a & 0xc0)) ? 2 : 1;
+    if(a + 10 > end) {
+      return 0;
+    }
+    ttl = ((uint32_t)a[4] << 24) + ((uint32_t)a[5] << 16) +
+      ((uint32_t)a[6] << 8) + a[7];
+    if(elapsed > 0) {
+      ttl = ttl > elapsed ? ttl - elapsed : 0;
+      a[4] = ttl >> 24;
+      a[5] = ttl >> 16;
+      a[6] = ttl >> 8;
+      a[7] = ttl;
+    }
+    if(ttl < min_ttl) {
+      min_ttl = ttl;
+    }
+    a += 10 + (a[8] << 8) + a[9];
+  }
+  return min_ttl;
+}
+/*---------------------------------------------------------------------------*/
+/* Valid entries are kept until their answer has been sent to all
+   waiting nodes. Nodes waiting for a query that timed out are
+   dropped: they will retry. */
+static int
+expired(const struct cache_entry *e)
+{
+  if(e->state == STATE_FREE) {
+    return 1;
+  }
+  if(e->state == STATE_VALID && e->nwaiters > 0) {
+    return 0;
+  }
+  return (long)(clock_seconds() - e->expires) >= 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct cache_entry *
+lookup(const uip_ip6addr_t *server, const uint8_t *data, int qend)
+{
+  struct cache_entry *e;
+
+  for(e = cache; e < &cache[IP64_DNS64_CACHE_ENTRIES]; e++) {
+    if(!expired(e) && e->qend == qend &&
+       uip_ip6addr_cmp(&e->server, server) &&
+       memcmp(&e->data[DNS_HDRLEN], &data[DNS_HDRLEN],
+              qend - DNS_HDRLEN) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Finds a free entry, or else the valid entry closest to expiring
+   that nobody waits for. */
+static struct cache_entry *
+allocate(void)
+{
+  struct cache_entry *e, *oldest;
+
+  oldest = NULL;
+  for(e = cache; e < &cache[IP64_DNS64_CACHE_ENTRIES]; e++) {
+    if(expired(e)) {
+      return e;
+    }
+    if(e->state == STATE_VALID && e->nwaiters == 0 &&
+       (oldest == NULL || (long)(e->expires - oldest->expires) < 0)) {
+      oldest = e;
+    }
+  }
+  return oldest;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_waiter(struct waiter *w, const uip_ip6addr_t *addr, uint16_t port,
+           const uint8_t *data)
+{
+  uip_ip6addr_copy(&w->addr, addr);
+  w->port = port;
+  w->id[0] = data[0];
+  w->id[1] = data[1];
+}
+/*---------------------------------------------------------------------------*/
+static int
+add_waiter(struct cache_entry *e, const uip_ip6addr_t *src, uint16_t srcport,
+           const uint8_t *data)
+{
+  if(e->nwaiters == IP64_DNS64_CACHE_WAITERS) {
+    return 0;
+  }
+  set_waiter(&e->waiters[e->nwaiters++], src, srcport, data);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+ip64_dns64_cache_query(const uip_ip6addr_t *src, uint16_t srcport,
+                       const uip_ip6addr_t *server,
+                       const uint8_t *data, int datalen)
+{
+  const struct dns_hdr *hdr = (const struct dns_hdr *)data;
+  const uint8_t *q;
+  struct cache_entry *e;
+  int qend;
+
+  qend = question_end(data, datalen);
+  if(qend == 0 || (hdr->flags1 & ~DNS_FLAG1_RD) != 0 ||
+     hdr->numanswers[0] != 0 || hdr->numanswers[1] != 0) {
+    return 0;
+  }
+  q = &data[qend - DNS_QUESTION_SIZE];
+  if(q[DNS_QUESTION_TYPE0] != 0 || q[DNS_QUESTION_TYPE1] != DNS_TYPE_AAAA ||
+     q[DNS_QUESTION_CLASS0] != 0 || q[DNS_QUESTION_CLASS1] != DNS_CLASS_IN) {
+    return 0;
+  }
+
+  e = lookup(server, data, qend);
+  if(e != NULL && e->state == STATE_VALID) {
+    if(add_waiter(e, src, srcport, data)) {
+      PRINTF("ip64_dns64_cache_query: answering from the cache\n");
+      process_poll(&ip64_dns64_process);
+      return 1;
+    }
+    return 0;
+  }
+
+  if(e != NULL) {
+    /* The query is outstanding. Retransmissions from the node that
+       sent it are forwarded, other nodes wait for its answer. */
+    if(uip_ip6addr_cmp(&e->owner.addr, src) && e->owner.port == srcport) {
+      return 0;
+    }
+    PRINTF("ip64_dns64_cache_query: waiting for outstanding query\n");
+    return add_waiter(e, src, srcport, data);
+  }
+
+  e = allocate();
+  if(e != NULL) {
+    uip_ip6addr_copy(&e->server, server);
+    set_waiter(&e->owner, src, srcport, data);
+    memcpy(e->data, data, qend);
+    e->len = qend;
+    e->qend = qend;
+    e->nwaiters = 0;
+    e->state = STATE_PENDING;
+    e->expires = clock_seconds() + IP64_DNS64_CACHE_PENDING_TIMEOUT;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+ip64_dns64_cache_answer(const uip_ip6addr_t *server,
+                        const uint8_t *data, int datalen)
+{
+  const struct dns_hdr *hdr = (const struct dns_hdr *)data;
+  struct cache_entry *e;
+  uint32_t ttl;
+  int qend;
+
+  qend = question_end(data, datalen);
+  if(qend == 0 || (hdr->flags1 & DNS_FLAG1_RESPONSE) == 0) {
+    return;
+  }
+  e = lookup(server, data, qend);
+  if(e == NULL || e->state != STATE_PENDING) {
+    return;
+  }
+  if(datalen > IP64_DNS64_CACHE_MAXLEN) {
+    PRINTF("ip64_dns64_cache_answer: answer too long, %d bytes\n", datalen);
+    e->state = STATE_FREE;
+    return;
+  }
+
+  memcpy(e->data, data, datalen);
+  e->len = datalen;
+  e->state = STATE_VALID;
+  e->stored = clock_seconds();
+
+  /* Errors and empty answers are only passed on to the waiting
+     nodes. */
+  ttl = 0;
+  if((hdr->flags2 & DNS_FLAG2_ERR_MASK) == DNS_FLAG2_ERR_NONE &&
+     (hdr->numanswers[0] != 0 || hdr->numanswers[1] != 0)) {
+    ttl = answer_ttls(e->data, e->len, e->qend, 0);
+  }
+  e->expires = e->stored + ttl;
+  PRINTF("ip64_dns64_cache_answer: ttl %lu, %d waiting\n",
+         (unsigned long)ttl, e->nwaiters);
+
+  if(e->nwaiters > 0) {
+    process_poll(&ip64_dns64_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_answer(struct cache_entry *e, const struct waiter *w, uint32_t elapsed)
+{
+  uint8_t *payload = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  uint16_t len;
+
+  memcpy(payload, e->data, e->len);
+  payload[0] = w->id[0];
+  payload[1] = w->id[1];
+  answer_ttls(payload, e->len, e->qend, elapsed);
+
+  len = UIP_UDPH_LEN + e->len;
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->tcflow = 0;
+  UIP_IP_BUF->flow = 0;
+  UIP_IP_BUF->len[0] = len >> 8;
+  UIP_IP_BUF->len[1] = len & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = uip_ds6_if.cur_hop_limit;
+  uip_ip6addr_copy(&UIP_IP_BUF->srcipaddr, &e->server);
+  uip_ip6addr_copy(&UIP_IP_BUF->destipaddr, &w->addr);
+
+  UIP_UDP_BUF->srcport = UIP_HTONS(DNS_PORT);
+  UIP_UDP_BUF->destport = w->port;
+  UIP_UDP_BUF->udplen = UIP_HTONS(len);
+  UIP_UDP_BUF->udpchksum = 0;
+
+  uip_len = UIP_IPH_LEN + len;
+  uip_ext_len = 0;
+  UIP_UDP_BUF->udpchksum = ~(uip_udpchksum());
+  if(UIP_UDP_BUF->udpchksum == 0) {
+    UIP_UDP_BUF->udpchksum = 0xffff;
+  }
+
+  tcpip_input();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ip64_dns64_process, ev, data)
+{
+  static struct cache_entry *e;
+  uint32_t elapsed;
+  int i;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    for(e = cache; e < &cache[IP64_DNS64_CACHE_ENTRIES]; e++) {
+      if(e->state != STATE_VALID || e->nwaiters == 0) {
+        continue;
+      }
+      elapsed = clock_seconds() - e->stored;
+      for(i = 0; i < e->nwaiters; i++) {
+        send_answer(e, &e->waiters[i], elapsed);
+      }
+      e->nwaiters = 0;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+ip64_dns64_cache_init(void)
+{
+  memset(cache, 0, sizeof(cache));
+  process_start(&ip64_dns64_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* IP64_DNS64_CACHE_ENTRIES */
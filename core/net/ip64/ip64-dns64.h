@@ -32,9 +32,74 @@
 #ifndef IP64_DNS64_H_
 #define IP64_DNS64_H_
 
+#include "net/ip/uip.h"
+
+/* With IP64_DNS64_CONF_CACHE_ENTRIES set, synthesized AAAA answers are
+   kept for the TTL of their records, at most
+   IP64_DNS64_CONF_CACHE_MAX_TTL seconds, and later queries for the
+   same name to the same server are answered by ip64 itself. While a
+   query is outstanding, identical queries from other nodes are not
+   forwarded but answered when the upstream answer arrives. Answers
+   longer than IP64_DNS64_CONF_CACHE_MAXLEN bytes are not cached. */
+#ifdef IP64_DNS64_CONF_CACHE_ENTRIES
+#define IP64_DNS64_CACHE_ENTRIES IP64_DNS64_CONF_CACHE_ENTRIES
+#else /* IP64_DNS64_CONF_CACHE_ENTRIES */
+#define IP64_DNS64_CACHE_ENTRIES 0
+#endif /* IP64_DNS64_CONF_CACHE_ENTRIES */
+
+#ifdef IP64_DNS64_CONF_CACHE_MAXLEN
+#define IP64_DNS64_CACHE_MAXLEN IP64_DNS64_CONF_CACHE_MAXLEN
+#else /* IP64_DNS64_CONF_CACHE_MAXLEN */
+#define IP64_DNS64_CACHE_MAXLEN 128
+#endif /* IP64_DNS64_CONF_CACHE_MAXLEN */
+
+#ifdef IP64_DNS64_CONF_CACHE_MAX_TTL
+#define IP64_DNS64_CACHE_MAX_TTL IP64_DNS64_CONF_CACHE_MAX_TTL
+#else /* IP64_DNS64_CONF_CACHE_MAX_TTL */
+#define IP64_DNS64_CACHE_MAX_TTL 600
+#endif /* IP64_DNS64_CONF_CACHE_MAX_TTL */
+
+/* The number of nodes that can wait for the answer of one cache
+   entry, and how many seconds an outstanding query holds back
+   identical queries. */
+#ifdef IP64_DNS64_CONF_CACHE_WAITERS
+#define IP64_DNS64_CACHE_WAITERS IP64_DNS64_CONF_CACHE_WAITERS
+#else /* IP64_DNS64_CONF_CACHE_WAITERS */
+#define IP64_DNS64_CACHE_WAITERS 4
+#endif /* IP64_DNS64_CONF_CACHE_WAITERS */
+
+#ifdef IP64_DNS64_CONF_CACHE_PENDING_TIMEOUT
+#define IP64_DNS64_CACHE_PENDING_TIMEOUT IP64_DNS64_CONF_CACHE_PENDING_TIMEOUT
+#else /* IP64_DNS64_CONF_CACHE_PENDING_TIMEOUT */
+#define IP64_DNS64_CACHE_PENDING_TIMEOUT 5
+#endif /* IP64_DNS64_CONF_CACHE_PENDING_TIMEOUT */
+
 void ip64_dns64_6to4(const uint8_t *ipv6data, int ipv6datalen,
                      uint8_t *ipv4data, int ipv4datalen);
 int ip64_dns64_4to6(const uint8_t *ipv4data, int ipv4datalen,
                     uint8_t *ipv6data, int ipv6datalen);
 
+#if IP64_DNS64_CACHE_ENTRIES
+/**
+ * Start the process that sends answers from the cache.
+ */
+void ip64_dns64_cache_init(void);
+
+/**
+ * Look up a DNS query from the IPv6 network in the cache. The source
+ * port is in network byte order. Returns non-zero if the query will
+ * be answered by ip64 and must not be forwarded, and 0 if it should
+ * be forwarded to the server.
+ */
+int ip64_dns64_cache_query(const uip_ip6addr_t *src, uint16_t srcport,
+                           const uip_ip6addr_t *server,
+                           const uint8_t *data, int datalen);
+
+/**
+ * Pass a translated DNS answer from a server to the cache.
+ */
+void ip64_dns64_cache_answer(const uip_ip6addr_t *server,
+                             const uint8_t *data, int datalen);
+#endif /* IP64_DNS64_CACHE_ENTRIES */
+
 #endif /* IP64_DNS64_H_ */
@@ -82,6 +82,7 @@ static void
 init(void)
 {
   printf("ip64-eth-interface: init\n");
+  ip64_arp_init();
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -101,14 +102,13 @@ output(void)
 
   printf("ip64-interface: output len %d\n", len);
   if(len > 0) {
-    if(ip64_arp_check_cache(&ip64_packet_buffer[sizeof(struct ip64_eth_hdr)])) {
-      printf("Create header\n");
-      ret = ip64_arp_create_ethhdr(ip64_packet_buffer,
-				   &ip64_packet_buffer[sizeof(struct ip64_eth_hdr)]);
-      if(ret > 0) {
-	len += ret;
-	IP64_ETH_DRIVER.output(ip64_packet_buffer, len);
-      }
+    /* The Ethernet header comes from the ARP table, if the next hop
+       is there. */
+    ret = ip64_arp_create_ethhdr(ip64_packet_buffer,
+                                 &ip64_packet_buffer[sizeof(struct ip64_eth_hdr)]);
+    if(ret > 0) {
+      len += ret;
+      IP64_ETH_DRIVER.output(ip64_packet_buffer, len);
     } else {
       printf("Create request\n");
       len = ip64_arp_create_arp_request(ip64_packet_buffer,
@@ -30,6 +30,7 @@
  *
  */
 #include "ip64-eth.h"
+#include "ip64-arp.h"
 
 #include <string.h>
 
@@ -40,5 +41,7 @@ void
 ip64_eth_addr_set(struct ip64_eth_addr *addr)
 {
   memcpy(&ip64_eth_addr, addr, sizeof(struct ip64_eth_addr));
+  /* The ARP entries hold Ethernet headers with the old address. */
+  ip64_arp_flush();
 }
 /*---------------------------------------------------------------------------*/
@@ -63,6 +63,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "ip64-ipv4-dhcp.h"
 #include "contiki-net.h"
+#include "net/ip/ip-chksum.h"
 
 #include "net/ip/uip-debug.h"
 
@@ -101,6 +102,17 @@ struct ipv4_hdr {
 
 #define EPHEMERAL_PORTRANGE 1024
 
+/* With IP64_CONF_INCREMENTAL_CHECKSUM, the TCP and UDP checksums of a
+   translated packet are updated for the changed addresses and ports
+   (RFC 1624) instead of being computed over the whole packet. The
+   checksum of the original packet is then carried over rather than
+   checked. */
+#ifdef IP64_CONF_INCREMENTAL_CHECKSUM
+#define IP64_INCREMENTAL_CHECKSUM IP64_CONF_INCREMENTAL_CHECKSUM
+#else /* IP64_CONF_INCREMENTAL_CHECKSUM */
+#define IP64_INCREMENTAL_CHECKSUM 1
+#endif /* IP64_CONF_INCREMENTAL_CHECKSUM */
+
 #define IPV6_HDRLEN 40
 #define IPV4_HDRLEN 20
 
@@ -191,6 +203,9 @@ ip64_init(void)
 #if IP64_DHCP
   ip64_ipv4_dhcp_init();
 #endif /* IP64_CONF_DHCP */
+#if IP64_DNS64_CACHE_ENTRIES
+  ip64_dns64_cache_init();
+#endif /* IP64_DNS64_CACHE_ENTRIES */
 
   /* Specify an IPv6 address for local communication to the
      host. We'll just pick the first one we find in our list. */
@@ -269,42 +284,11 @@ ip64_set_ipv6_address(const uip_ip6addr_t *addr)
 }
 /*---------------------------------------------------------------------------*/
 static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {	/* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
-static uint16_t
 ipv4_checksum(struct ipv4_hdr *hdr)
 {
   uint16_t sum;
 
-  sum = chksum(0, (uint8_t *)hdr, IPV4_HDRLEN);
+  sum = ip_chksum_add(0, (uint8_t *)hdr, IPV4_HDRLEN);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
@@ -323,14 +307,14 @@ ipv4_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
     /* IP protocol and length fields. This addition cannot carry. */
     sum = transport_layer_len + proto;
     /* Sum IP source and destination addresses. */
-    sum = chksum(sum, (uint8_t *)&v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
+    sum = ip_chksum_add(sum, (uint8_t *)&v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
   } else {
     /* ping replies' checksums are calculated over the icmp-part only */
     sum = 0;
   }
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV4_HDRLEN], transport_layer_len);
+  sum = ip_chksum_add(sum, &packet[IPV4_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -349,15 +333,44 @@ ipv6_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = transport_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&v6hdr->srcipaddr, sizeof(uip_ip6addr_t));
-  sum = chksum(sum, (uint8_t *)&v6hdr->destipaddr, sizeof(uip_ip6addr_t));
+  sum = ip_chksum_add(sum, (uint8_t *)&v6hdr->srcipaddr, sizeof(uip_ip6addr_t));
+  sum = ip_chksum_add(sum, (uint8_t *)&v6hdr->destipaddr, sizeof(uip_ip6addr_t));
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV6_HDRLEN], transport_layer_len);
+  sum = ip_chksum_add(sum, &packet[IPV6_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
+/* The sum of the parts of a TCP or UDP checksum that are changed by
+   the translation: the addresses in the pseudo header and the
+   ports. The length and protocol fields of the pseudo headers add up
+   the same in IPv4 and IPv6. */
+static uint16_t
+ipv4_rewrite_sum(const struct ipv4_hdr *hdr, const uint8_t *transport)
+{
+  uint16_t sum;
+
+  sum = ip_chksum_add(0, (uint8_t *)&hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
+  return ip_chksum_add(sum, transport, 2 * sizeof(uint16_t));
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ipv6_rewrite_sum(const struct ipv6_hdr *hdr, const uint8_t *transport)
+{
+  uint16_t sum;
+
+  sum = ip_chksum_add(0, (uint8_t *)&hdr->srcipaddr, sizeof(uip_ip6addr_t));
+  sum = ip_chksum_add(sum, (uint8_t *)&hdr->destipaddr, sizeof(uip_ip6addr_t));
+  return ip_chksum_add(sum, transport, 2 * sizeof(uint16_t));
+}
+/*---------------------------------------------------------------------------*/
+static void
+adjust_checksum(uint16_t *chksum, uint16_t old_sum, uint16_t new_sum)
+{
+  *chksum = uip_htons(ip_chksum_adjust(uip_ntohs(*chksum), old_sum, new_sum));
+}
+/*---------------------------------------------------------------------------*/
 int
 ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
 	  uint8_t *resultpacket)
@@ -370,6 +383,8 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv6len, ipv4len;
   struct ip64_addrmap_entry *m;
+  uint16_t old_sum;
+  int incremental;
 
   v6hdr = (struct ipv6_hdr *)ipv6packet;
   v4hdr = (struct ipv4_hdr *)resultpacket;
@@ -392,6 +407,12 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   icmpv4hdr = (struct icmpv4_hdr *)&resultpacket[IPV4_HDRLEN];
   icmpv6hdr = (struct icmpv6_hdr *)&ipv6packet[IPV6_HDRLEN];
 
+  incremental = IP64_INCREMENTAL_CHECKSUM;
+  old_sum = 0;
+  if(incremental) {
+    old_sum = ipv6_rewrite_sum(v6hdr, &resultpacket[IPV4_HDRLEN]);
+  }
+
   /* Translate the IPv6 header into an IPv4 header. */
 
   /* First the basics: the IPv4 version, header length, type of
@@ -427,8 +448,10 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
 
     /* Compute and check the TCP checksum - since we're going to
        recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
+       the first place. An incrementally updated checksum stays
+       wrong if it was. */
+    if(!incremental &&
+       ipv6_transport_checksum(ipv6packet, ipv6len,
                                IP_PROTO_TCP) != 0xffff) {
       PRINTF("Bad TCP checksum, dropping packet\n");
     }
@@ -442,15 +465,27 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
     /* Check if this is a DNS request. If so, we should rewrite it
        with the DNS64 module. */
     if(udphdr->destport == UIP_HTONS(DNS_PORT)) {
+#if IP64_DNS64_CACHE_ENTRIES
+      /* Queries that are answered from the DNS64 cache, or that wait
+         for an identical outstanding query, are not forwarded. */
+      if(ip64_dns64_cache_query(&v6hdr->srcipaddr, udphdr->srcport,
+                                &v6hdr->destipaddr,
+                                (uint8_t *)v6hdr + IPV6_HDRLEN + sizeof(struct udp_hdr),
+                                ipv6len - IPV6_HDRLEN - sizeof(struct udp_hdr))) {
+        return 0;
+      }
+#endif /* IP64_DNS64_CACHE_ENTRIES */
       ip64_dns64_6to4((uint8_t *)v6hdr + IPV6_HDRLEN + sizeof(struct udp_hdr),
                       ipv6len - IPV6_HDRLEN - sizeof(struct udp_hdr),
                       (uint8_t *)udphdr + sizeof(struct udp_hdr),
                       BUFSIZE - IPV4_HDRLEN - sizeof(struct udp_hdr));
+      incremental = 0;
     }
     /* Compute and check the UDP checksum - since we're going to
        recompute it ourselves, we must ensure that it was correct in
        the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
+    if(!incremental &&
+       ipv6_transport_checksum(ipv6packet, ipv6len,
                                IP_PROTO_UDP) != 0xffff) {
       PRINTF("Bad UDP checksum, dropping packet\n");
     }
@@ -460,6 +495,7 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
     PRINTF("ip64_6to4: ICMPv6 header\n");
     v4hdr->proto = IP_PROTO_ICMPV4;
     /* Translate only ECHO_REPLY messages. */
+    incremental = 0;
     if(icmpv6hdr->type == ICMP6_ECHO_REPLY) {
       icmpv4hdr->type = ICMP_ECHO_REPLY;
     } else {
@@ -619,14 +655,24 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
      field. */
   switch(v4hdr->proto) {
   case IP_PROTO_TCP:
+    if(incremental) {
+      adjust_checksum(&tcphdr->tcpchksum, old_sum,
+                      ipv4_rewrite_sum(v4hdr, &resultpacket[IPV4_HDRLEN]));
+      break;
+    }
     tcphdr->tcpchksum = 0;
     tcphdr->tcpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
 						  IP_PROTO_TCP));
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_UDP));
+    if(incremental) {
+      adjust_checksum(&udphdr->udpchksum, old_sum,
+                      ipv4_rewrite_sum(v4hdr, &resultpacket[IPV4_HDRLEN]));
+    } else {
+      udphdr->udpchksum = 0;
+      udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
+                                                    IP_PROTO_UDP));
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
@@ -659,6 +705,8 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv4len, ipv6len, ipv6_packet_len;
   struct ip64_addrmap_entry *m;
+  uint16_t old_sum;
+  int incremental;
 
   v6hdr = (struct ipv6_hdr *)resultpacket;
   v4hdr = (struct ipv4_hdr *)ipv4packet;
@@ -690,6 +738,12 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   icmpv4hdr = (struct icmpv4_hdr *)&ipv4packet[IPV4_HDRLEN];
   icmpv6hdr = (struct icmpv6_hdr *)&resultpacket[IPV6_HDRLEN];
 
+  incremental = IP64_INCREMENTAL_CHECKSUM;
+  old_sum = 0;
+  if(incremental) {
+    old_sum = ipv4_rewrite_sum(v4hdr, &ipv4packet[IPV4_HDRLEN]);
+  }
+
   ipv6len = ipv4len - IPV4_HDRLEN + IPV6_HDRLEN;
   ipv6_packet_len = ipv6len - IPV6_HDRLEN;
 
@@ -728,11 +782,17 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   switch(v4hdr->proto) {
   case IP_PROTO_UDP:
     v6hdr->nxthdr = IP_PROTO_UDP;
+    /* A zero checksum means that the IPv4 packet has none, but it is
+       mandatory in IPv6. */
+    if(udphdr->udpchksum == 0) {
+      incremental = 0;
+    }
     /* Check if this is a DNS request. If so, we should rewrite it
        with the DNS64 module. */
     if(udphdr->srcport == UIP_HTONS(DNS_PORT)) {
       int len;
 
+      incremental = 0;
       len = ip64_dns64_4to6((uint8_t *)v4hdr + IPV4_HDRLEN + sizeof(struct udp_hdr),
                             ipv4len - IPV4_HDRLEN - sizeof(struct udp_hdr),
                             (uint8_t *)v6hdr + IPV6_HDRLEN + sizeof(struct udp_hdr),
@@ -741,7 +801,11 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
       v6hdr->len[0] = ipv6_packet_len >> 8;
       v6hdr->len[1] = ipv6_packet_len & 0xff;
       ipv6len = ipv6_packet_len + IPV6_HDRLEN;
-
+#if IP64_DNS64_CACHE_ENTRIES
+      ip64_dns64_cache_answer(&v6hdr->srcipaddr,
+                              (uint8_t *)v6hdr + IPV6_HDRLEN + sizeof(struct udp_hdr),
+                              len);
+#endif /* IP64_DNS64_CACHE_ENTRIES */
     }
     break;
 
@@ -750,6 +814,7 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
     break;
 
   case IP_PROTO_ICMPV4:
+    incremental = 0;
     /* Allow only ICMPv4 ECHO_REQUESTS (ping packets) through to the
        local IPv6 host. */
     if(icmpv4hdr->type == ICMP_ECHO) {
@@ -854,16 +919,26 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
      field. */
   switch(v6hdr->nxthdr) {
   case IP_PROTO_TCP:
+    if(incremental) {
+      adjust_checksum(&tcphdr->tcpchksum, old_sum,
+                      ipv6_rewrite_sum(v6hdr, &resultpacket[IPV6_HDRLEN]));
+      break;
+    }
     tcphdr->tcpchksum = 0;
     tcphdr->tcpchksum = ~(ipv6_transport_checksum(resultpacket,
 						  ipv6len,
 						  IP_PROTO_TCP));
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_UDP));
+    if(incremental) {
+      adjust_checksum(&udphdr->udpchksum, old_sum,
+                      ipv6_rewrite_sum(v6hdr, &resultpacket[IPV6_HDRLEN]));
+    } else {
+      udphdr->udpchksum = 0;
+      udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
+                                                    ipv6len,
+                                                    IP_PROTO_UDP));
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
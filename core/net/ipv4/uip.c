@@ -74,6 +74,7 @@
 #include "net/ip/uipopt.h"
 #include "net/ipv4/uip_arp.h"
 #include "net/ip/uip_arch.h"
+#include "net/ip/ip-chksum.h"
 
 #include "net/ipv4/uip-neighbor.h"
 
@@ -260,41 +261,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {	/* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(ip_chksum_add(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -303,7 +273,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = ip_chksum_add(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   DEBUG_PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -326,10 +296,10 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = ip_chksum_add(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN],
+  sum = ip_chksum_add(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN],
 	       upper_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
@@ -359,6 +329,57 @@ uip_udpchksum(void)
 #endif /* UIP_UDP_CHECKSUMS */
 #endif /* UIP_ARCH_CHKSUM */
 /*---------------------------------------------------------------------------*/
+#if UIP_DEMUX_HASH
+/*
+ * Demultiplexing hints: for each hash bucket, the index of the
+ * connection that last matched the packets hashing to it, or
+ * DEMUX_NONE. TCP packets hash on both ports and the source address,
+ * UDP packets on the destination port only. A hint is checked against
+ * the packet before it is used, so a stale one only costs the scan it
+ * would have saved.
+ *
+ * A UDP hint is only kept for the first connection bound to its port:
+ * an earlier connection on the same port, which the scan would have
+ * chosen, could otherwise be skipped. Binding may change that order,
+ * hence uip_udp_demux_flush().
+ */
+#if (UIP_DEMUX_HASH & (UIP_DEMUX_HASH - 1)) != 0
+#error UIP_CONF_DEMUX_HASH must be a power of two
+#endif
+#if UIP_CONNS >= 255 || UIP_UDP_CONNS >= 255
+#error UIP_CONF_DEMUX_HASH requires fewer than 255 connections
+#endif
+#define DEMUX_NONE 0xff
+static uint8_t tcp_hints[UIP_DEMUX_HASH];
+#if UIP_UDP
+static uint8_t udp_hints[UIP_DEMUX_HASH];
+#endif /* UIP_UDP */
+static uint8_t demux_bucket;
+
+static uint8_t
+demux_hash(uint16_t lport, uint16_t rport, const uip_ipaddr_t *ripaddr)
+{
+  uint16_t h;
+  uint8_t i;
+
+  h = lport ^ (rport << 7 | rport >> 9);
+  if(ripaddr != NULL) {
+    for(i = 0; i < sizeof(uip_ipaddr_t) / 2; i++) {
+      h = (h << 5 | h >> 11) ^ ripaddr->u16[i];
+    }
+  }
+  return (h ^ (h >> 8)) & (UIP_DEMUX_HASH - 1);
+}
+#endif /* UIP_DEMUX_HASH */
+/*---------------------------------------------------------------------------*/
+void
+uip_udp_demux_flush(void)
+{
+#if UIP_DEMUX_HASH && UIP_UDP
+  memset(udp_hints, DEMUX_NONE, sizeof(udp_hints));
+#endif /* UIP_DEMUX_HASH && UIP_UDP */
+}
+/*---------------------------------------------------------------------------*/
 void
 uip_init(void)
 {
@@ -378,6 +399,10 @@ uip_init(void)
   }
 #endif /* UIP_UDP */
 
+#if UIP_DEMUX_HASH
+  memset(tcp_hints, DEMUX_NONE, sizeof(tcp_hints));
+  uip_udp_demux_flush();
+#endif /* UIP_DEMUX_HASH */
 
   /* IPv4 initialization. */
 #if UIP_FIXEDADDR == 0
@@ -1113,25 +1138,46 @@ uip_process(uint8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+  /* If the local UDP port is non-zero, the connection is considered
+     to be used. If so, the local port number is checked against the
+     destination port number in the received packet. If the two port
+     numbers match, the remote port number is checked if the
+     connection is bound to a remote port. Finally, if the
+     connection is bound to a remote IP address, the source IP
+     address of the packet is checked. */
+#define UDP_CONN_MATCHES(conn)                                          \
+  ((conn)->lport != 0 &&                                                \
+   UDPBUF->destport == (conn)->lport &&                                 \
+   ((conn)->rport == 0 || UDPBUF->srcport == (conn)->rport) &&          \
+   (uip_ipaddr_cmp(&(conn)->ripaddr, &uip_all_zeroes_addr) ||           \
+    uip_ipaddr_cmp(&(conn)->ripaddr, &uip_broadcast_addr) ||            \
+    uip_ipaddr_cmp(&BUF->srcipaddr, &(conn)->ripaddr)))
+#if UIP_DEMUX_HASH
+  demux_bucket = demux_hash(UDPBUF->destport, 0, NULL);
+  if(udp_hints[demux_bucket] != DEMUX_NONE) {
+    uip_udp_conn = &uip_udp_conns[udp_hints[demux_bucket]];
+    if(UDP_CONN_MATCHES(uip_udp_conn)) {
+      goto udp_found;
+    }
+  }
+  c = 0;
+#endif /* UIP_DEMUX_HASH */
   for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
-    /* If the local UDP port is non-zero, the connection is considered
-       to be used. If so, the local port number is checked against the
-       destination port number in the received packet. If the two port
-       numbers match, the remote port number is checked if the
-       connection is bound to a remote port. Finally, if the
-       connection is bound to a remote IP address, the source IP
-       address of the packet is checked. */
-    if(uip_udp_conn->lport != 0 &&
-       UDPBUF->destport == uip_udp_conn->lport &&
-       (uip_udp_conn->rport == 0 ||
-        UDPBUF->srcport == uip_udp_conn->rport) &&
-       (uip_ipaddr_cmp(&uip_udp_conn->ripaddr, &uip_all_zeroes_addr) ||
-	uip_ipaddr_cmp(&uip_udp_conn->ripaddr, &uip_broadcast_addr) ||
-	uip_ipaddr_cmp(&BUF->srcipaddr, &uip_udp_conn->ripaddr))) {
+    if(UDP_CONN_MATCHES(uip_udp_conn)) {
+#if UIP_DEMUX_HASH
+      if(!c) {
+        udp_hints[demux_bucket] = uip_udp_conn - uip_udp_conns;
+      }
+#endif /* UIP_DEMUX_HASH */
       goto udp_found;
     }
+#if UIP_DEMUX_HASH
+    if(uip_udp_conn->lport == UDPBUF->destport) {
+      c = 1;
+    }
+#endif /* UIP_DEMUX_HASH */
   }
   UIP_LOG("udp: no matching connection found");
   UIP_STAT(++uip_stat.udp.drop);
@@ -1240,12 +1286,26 @@ uip_process(uint8_t flag)
 
   /* Demultiplex this segment. */
   /* First check any active connections. */
+#define TCP_CONN_MATCHES(conn)                                          \
+  ((conn)->tcpstateflags != UIP_CLOSED &&                               \
+   BUF->destport == (conn)->lport &&                                    \
+   BUF->srcport == (conn)->rport &&                                     \
+   uip_ipaddr_cmp(&BUF->srcipaddr, &(conn)->ripaddr))
+#if UIP_DEMUX_HASH
+  demux_bucket = demux_hash(BUF->destport, BUF->srcport, &BUF->srcipaddr);
+  if(tcp_hints[demux_bucket] != DEMUX_NONE) {
+    uip_connr = &uip_conns[tcp_hints[demux_bucket]];
+    if(TCP_CONN_MATCHES(uip_connr)) {
+      goto found;
+    }
+  }
+#endif /* UIP_DEMUX_HASH */
   for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
       ++uip_connr) {
-    if(uip_connr->tcpstateflags != UIP_CLOSED &&
-       BUF->destport == uip_connr->lport &&
-       BUF->srcport == uip_connr->rport &&
-       uip_ipaddr_cmp(&BUF->srcipaddr, &uip_connr->ripaddr)) {
+    if(TCP_CONN_MATCHES(uip_connr)) {
+#if UIP_DEMUX_HASH
+      tcp_hints[demux_bucket] = uip_connr - uip_conns;
+#endif /* UIP_DEMUX_HASH */
       goto found;
     }
   }
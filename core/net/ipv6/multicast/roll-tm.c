@@ -443,6 +443,26 @@ static struct roll_tm_stats stats;
 static struct trickle_param t[2];
 static struct sliding_window windows[ROLL_TM_WINS];
 static struct mcast_packet buffered_msgs[ROLL_TM_BUFF_NUM];
+#if ROLL_TM_HASH
+/*
+ * Windows and buffered messages are chained from their hash buckets by
+ * index, so that a lookup only visits the entries of one bucket.
+ * Windows are hashed by Seed ID and M, messages by window and sequence
+ * value. A window stays in its bucket after it is freed, because
+ * window_lookup() also matches free windows by their last Seed ID.
+ */
+#define HASH_NONE 0xFF
+#if (ROLL_TM_HASH & (ROLL_TM_HASH - 1)) != 0
+#error ROLL_TM_CONF_HASH must be a power of two
+#endif
+#if ROLL_TM_WINS >= HASH_NONE || ROLL_TM_BUFF_NUM >= HASH_NONE
+#error ROLL_TM_CONF_HASH needs fewer than 255 windows and buffered messages
+#endif
+static uint8_t window_buckets[ROLL_TM_HASH];
+static uint8_t window_next[ROLL_TM_WINS];
+static uint8_t msg_buckets[ROLL_TM_HASH];
+static uint8_t msg_next[ROLL_TM_BUFF_NUM];
+#endif /* ROLL_TM_HASH */
 /*---------------------------------------------------------------------------*/
 /* Temporary Stores */
 /*---------------------------------------------------------------------------*/
@@ -478,6 +498,90 @@ static void handle_timer(void *);
 UIP_ICMP6_HANDLER(roll_tm_icmp_handler, ICMP6_ROLL_TM,
                   UIP_ICMP6_HANDLER_CODE_ANY, icmp_input);
 /*---------------------------------------------------------------------------*/
+#if ROLL_TM_HASH
+static uint8_t
+window_hash(const seed_id_t *s, uint8_t m)
+{
+  const uint8_t *p = (const uint8_t *)s;
+  uint8_t h = m;
+  uint8_t i;
+
+  for(i = 0; i < sizeof(seed_id_t); i++) {
+    h = h * 31 + p[i];
+  }
+  return h & (ROLL_TM_HASH - 1);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+msg_hash(const struct sliding_window *w, uint16_t seq_val)
+{
+  return (seq_val ^ ((w - windows) << 3)) & (ROLL_TM_HASH - 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Unlinks entry i from a chain of buckets and next indices */
+static void
+hash_unlink(uint8_t *bucket, uint8_t *next, uint8_t i)
+{
+  while(*bucket != HASH_NONE) {
+    if(*bucket == i) {
+      *bucket = next[i];
+      return;
+    }
+    bucket = &next[*bucket];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_hash_add(struct sliding_window *w)
+{
+  uint8_t *bucket = &window_buckets[window_hash(&w->seed_id,
+                                                SLIDING_WINDOW_GET_M(w))];
+
+  window_next[w - windows] = *bucket;
+  *bucket = w - windows;
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_hash_remove(struct sliding_window *w)
+{
+  hash_unlink(&window_buckets[window_hash(&w->seed_id,
+                                          SLIDING_WINDOW_GET_M(w))],
+              window_next, w - windows);
+}
+/*---------------------------------------------------------------------------*/
+static void
+msg_hash_add(struct mcast_packet *p)
+{
+  uint8_t *bucket = &msg_buckets[msg_hash(p->sw, p->seq_val)];
+
+  msg_next[p - buffered_msgs] = *bucket;
+  *bucket = p - buffered_msgs;
+}
+/*---------------------------------------------------------------------------*/
+static void
+msg_hash_remove(struct mcast_packet *p)
+{
+  hash_unlink(&msg_buckets[msg_hash(p->sw, p->seq_val)], msg_next,
+              p - buffered_msgs);
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_init()
+{
+  memset(window_buckets, HASH_NONE, sizeof(window_buckets));
+  memset(msg_buckets, HASH_NONE, sizeof(msg_buckets));
+  for(iterswptr = windows; iterswptr < &windows[ROLL_TM_WINS]; iterswptr++) {
+    window_hash_add(iterswptr);
+  }
+}
+#else /* ROLL_TM_HASH */
+#define window_hash_add(w)
+#define window_hash_remove(w)
+#define msg_hash_add(p)
+#define msg_hash_remove(p)
+#define hash_init()
+#endif /* ROLL_TM_HASH */
+/*---------------------------------------------------------------------------*/
 /* Return a random number in [I/2, I), for a timer with Imin when the timer's
  * current number of doublings is d */
 static clock_time_t
@@ -614,6 +718,7 @@ handle_timer(void *ptr)
           PRINTF("\n");
           window_free(locmpptr->sw);
         }
+        msg_hash_remove(locmpptr);
         MCAST_PACKET_FREE(locmpptr);
       } else if(MCAST_PACKET_TTL(locmpptr) > 0) {
         /* Handle multicast transmissions */
@@ -701,8 +806,16 @@ window_allocate()
 static struct sliding_window *
 window_lookup(seed_id_t *s, uint8_t m)
 {
+#if ROLL_TM_HASH
+  uint8_t i;
+
+  for(i = window_buckets[window_hash(s, m)]; i != HASH_NONE;
+      i = window_next[i]) {
+    iterswptr = &windows[i];
+#else /* ROLL_TM_HASH */
   for(iterswptr = &windows[ROLL_TM_WINS - 1]; iterswptr >= windows;
       iterswptr--) {
+#endif /* ROLL_TM_HASH */
     VERBOSE_PRINTF("ROLL TM: M=%u (%u) ", SLIDING_WINDOW_GET_M(iterswptr), m);
     VERBOSE_PRINT_SEED(&iterswptr->seed_id);
     VERBOSE_PRINTF("\n");
@@ -714,6 +827,28 @@ window_lookup(seed_id_t *s, uint8_t m)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Returns the buffered message of window w with sequence value seq_val */
+static struct mcast_packet *
+msg_lookup(struct sliding_window *w, uint16_t seq_val)
+{
+  struct mcast_packet *p;
+#if ROLL_TM_HASH
+  uint8_t i;
+
+  for(i = msg_buckets[msg_hash(w, seq_val)]; i != HASH_NONE;
+      i = msg_next[i]) {
+    p = &buffered_msgs[i];
+#else /* ROLL_TM_HASH */
+  for(p = &buffered_msgs[ROLL_TM_BUFF_NUM - 1]; p >= buffered_msgs; p--) {
+#endif /* ROLL_TM_HASH */
+    if(MCAST_PACKET_IS_USED(p) && p->sw == w &&
+       SEQ_VAL_IS_EQ(p->seq_val, seq_val)) {
+      return p;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 static void
 window_update_bounds()
 {
@@ -764,23 +899,20 @@ buffer_reclaim()
   PRINTF(" M=%u, count was %u\n",
          SLIDING_WINDOW_GET_M(largest), largest->count);
   /* Find the packet at the lowest bound for the largest window */
-  for(locmpptr = &buffered_msgs[ROLL_TM_BUFF_NUM - 1];
-      locmpptr >= buffered_msgs; locmpptr--) {
-    if(MCAST_PACKET_IS_USED(locmpptr) && (locmpptr->sw == largest) &&
-       SEQ_VAL_IS_EQ(locmpptr->seq_val, largest->lower_bound)) {
-      rv = locmpptr;
-      PRINTF("ROLL TM: Reclaim seq. val %u\n", locmpptr->seq_val);
-      MCAST_PACKET_FREE(rv);
-      largest->count--;
-      window_update_bounds();
-      VERBOSE_PRINTF("ROLL TM: Reclaim - new bounds [%u , %u]\n",
-                     largest->lower_bound, largest->upper_bound);
-      return rv;
-    }
+  rv = msg_lookup(largest, largest->lower_bound);
+  if(rv == NULL) {
+    /* oops */
+    return NULL;
   }
 
-  /* oops */
-  return NULL;
+  PRINTF("ROLL TM: Reclaim seq. val %u\n", rv->seq_val);
+  msg_hash_remove(rv);
+  MCAST_PACKET_FREE(rv);
+  largest->count--;
+  window_update_bounds();
+  VERBOSE_PRINTF("ROLL TM: Reclaim - new bounds [%u , %u]\n",
+                 largest->lower_bound, largest->upper_bound);
+  return rv;
 }
 /*---------------------------------------------------------------------------*/
 static struct mcast_packet *
@@ -978,17 +1110,11 @@ accept(uint8_t in)
       UIP_MCAST6_STATS_ADD(mcast_dropped);
       return UIP_MCAST6_DROP;
     }
-    for(locmpptr = &buffered_msgs[ROLL_TM_BUFF_NUM - 1];
-        locmpptr >= buffered_msgs; locmpptr--) {
-      if(MCAST_PACKET_IS_USED(locmpptr) &&
-         locmpptr->sw == locswptr &&
-         SLIDING_WINDOW_GET_M(locmpptr->sw) == m &&
-         SEQ_VAL_IS_EQ(seq_val, locmpptr->seq_val)) {
-        /* Seen before , drop */
-        PRINTF("ROLL TM: Seen before\n");
-        UIP_MCAST6_STATS_ADD(mcast_dropped);
-        return UIP_MCAST6_DROP;
-      }
+    if(msg_lookup(locswptr, seq_val) != NULL) {
+      /* Seen before , drop */
+      PRINTF("ROLL TM: Seen before\n");
+      UIP_MCAST6_STATS_ADD(mcast_dropped);
+      return UIP_MCAST6_DROP;
     }
   }
 
@@ -1032,12 +1158,14 @@ accept(uint8_t in)
 
   /* We have a window and we have a buffer. Accept this message */
   /* Set the seed ID and correct M for this window */
+  window_hash_remove(locswptr);
   SLIDING_WINDOW_M_CLR(locswptr);
   if(m) {
     SLIDING_WINDOW_M_SET(locswptr);
   }
   SLIDING_WINDOW_IS_USED_SET(locswptr);
   seed_id_cpy(&locswptr->seed_id, seed_ptr);
+  window_hash_add(locswptr);
   PRINTF("ROLL TM: Window for seed ");
   PRINT_SEED(&locswptr->seed_id);
   PRINTF(" M=%u, count=%u\n",
@@ -1063,6 +1191,7 @@ accept(uint8_t in)
   locmpptr->buff_len = uip_len;
   locmpptr->seq_val = seq_val;
   MCAST_PACKET_USED_SET(locmpptr);
+  msg_hash_add(locmpptr);
 
   PRINTF("ROLL TM: Window for seed ");
   PRINT_SEED(&locswptr->seed_id);
@@ -1222,23 +1351,17 @@ icmp_input()
 
           inconsistency = 1;
           /* Check if the advertised sequence is in our buffer */
-          for(locmpptr = &buffered_msgs[ROLL_TM_BUFF_NUM - 1];
-              locmpptr >= buffered_msgs; locmpptr--) {
-            if(MCAST_PACKET_IS_USED(locmpptr) && locmpptr->sw == locswptr) {
-              if(SEQ_VAL_IS_EQ(locmpptr->seq_val, val)) {
-
-                inconsistency = 0;
-                MCAST_PACKET_LISTED_SET(locmpptr);
-                PRINTF("ROLL TM: ICMPv6 In, %u listed\n", locmpptr->seq_val);
-
-                /* Update lowest seq. num listed for this window
-                 * We need this to check for "we have new" */
-                if(locswptr->min_listed == -1 ||
-                   SEQ_VAL_IS_LT(val, locswptr->min_listed)) {
-                  locswptr->min_listed = val;
-                }
-                break;
-              }
+          locmpptr = msg_lookup(locswptr, val);
+          if(locmpptr != NULL) {
+            inconsistency = 0;
+            MCAST_PACKET_LISTED_SET(locmpptr);
+            PRINTF("ROLL TM: ICMPv6 In, %u listed\n", locmpptr->seq_val);
+
+            /* Update lowest seq. num listed for this window
+             * We need this to check for "we have new" */
+            if(locswptr->min_listed == -1 ||
+               SEQ_VAL_IS_LT(val, locswptr->min_listed)) {
+              locswptr->min_listed = val;
             }
           }
           if(inconsistency) {
@@ -1416,6 +1539,7 @@ init()
   memset(windows, 0, sizeof(windows));
   memset(buffered_msgs, 0, sizeof(buffered_msgs));
   memset(t, 0, sizeof(t));
+  hash_init();
 
   ROLL_TM_STATS_INIT();
   UIP_MCAST6_STATS_INIT(&stats);
@@ -187,6 +187,20 @@
 #define ROLL_TM_BUFF_NUM 6
 #endif
 /*---------------------------------------------------------------------------*/
+/**
+ * Number of hash buckets (a power of two) for looking up Sliding Windows by
+ * Seed ID and buffered messages by Seed ID and sequence value. With the
+ * default 0, every lookup scans all windows or all buffered messages, which
+ * is enough for the default sizes. Large configurations, with many seeds
+ * and messages, should set this to about ROLL_TM_BUFF_NUM. Both sizes must
+ * then be under 255
+ */
+#ifdef ROLL_TM_CONF_HASH
+#define ROLL_TM_HASH ROLL_TM_CONF_HASH
+#else
+#define ROLL_TM_HASH 0
+#endif
+/*---------------------------------------------------------------------------*/
 /**
  * Use Short Seed IDs [short: 2, long: 16 (default)]
  * It can be argued that we should (and it would be easy to) support both at
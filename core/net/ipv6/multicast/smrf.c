@@ -73,10 +73,19 @@ static uint8_t fwd_spread;
 /* uIPv6 Pointers */
 /*---------------------------------------------------------------------------*/
 #define UIP_IP_BUF        ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define MCAST_IP_BUF      ((struct uip_ip_hdr *)&mcast_buf.u8[UIP_LLH_LEN])
 /*---------------------------------------------------------------------------*/
 static void
 mcast_fwd(void *p)
 {
+#if UIP_MCAST6_STATS
+  uip_mcast6_route_t *route;
+
+  route = uip_mcast6_route_lookup(&MCAST_IP_BUF->destipaddr);
+  if(route != NULL) {
+    UIP_MCAST6_GROUP_STATS_ADD(route, fwd);
+  }
+#endif
   memcpy(uip_buf, &mcast_buf, mcast_len);
   uip_len = mcast_len;
   UIP_IP_BUF->ttl--;
@@ -90,6 +99,7 @@ in()
   rpl_dag_t *d;                 /* Our DODAG */
   uip_ipaddr_t *parent_ipaddr;  /* Our pref. parent's IPv6 address */
   const uip_lladdr_t *parent_lladdr;  /* Our pref. parent's LL address */
+  uip_mcast6_route_t *route;    /* Routing table entry for the group */
 
   /*
    * Fetch a pointer to the LL address of our preferred parent
@@ -135,7 +145,13 @@ in()
 
   /* If we have an entry in the mcast routing table, something with
    * a higher RPL rank (somewhere down the tree) is a group member */
-  if(uip_mcast6_route_lookup(&UIP_IP_BUF->destipaddr)) {
+  route = uip_mcast6_route_lookup(&UIP_IP_BUF->destipaddr);
+  if(route != NULL && !ctimer_expired(&mcast_periodic) &&
+     mcast_len == uip_len && memcmp(&mcast_buf, uip_buf, uip_len) == 0) {
+    /* Already queued for forwarding, leave the pending forward alone */
+    PRINTF("SMRF: Duplicate of the queued datagram\n");
+    UIP_MCAST6_GROUP_STATS_ADD(route, dup);
+  } else if(route != NULL) {
     /* If we enter here, we will definitely forward */
     UIP_MCAST6_STATS_ADD(mcast_fwd);
 
@@ -155,6 +171,7 @@ in()
 
     if(fwd_delay == 0) {
       /* No delay required, send it, do it now, why wait? */
+      UIP_MCAST6_GROUP_STATS_ADD(route, fwd);
       UIP_IP_BUF->ttl--;
       tcpip_output(NULL);
       UIP_IP_BUF->ttl++;        /* Restore before potential upstack delivery */
@@ -168,6 +185,15 @@ in()
         fwd_delay = fwd_delay * (1 + ((random_rand() >> 11) % fwd_spread));
       }
 
+#if UIP_MCAST6_STATS
+      if(!ctimer_expired(&mcast_periodic)) {
+        /* The datagram still queued will never be forwarded */
+        route = uip_mcast6_route_lookup(&MCAST_IP_BUF->destipaddr);
+        if(route != NULL) {
+          UIP_MCAST6_GROUP_STATS_ADD(route, suppressed);
+        }
+      }
+#endif
       memcpy(&mcast_buf, uip_buf, uip_len);
       mcast_len = uip_len;
       ctimer_set(&mcast_periodic, fwd_delay, mcast_fwd, NULL);
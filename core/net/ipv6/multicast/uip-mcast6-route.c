@@ -62,13 +62,44 @@ MEMB(mcast_route_memb, uip_mcast6_route_t, UIP_MCAST6_ROUTE_ROUTES);
 
 static uip_mcast6_route_t *locmcastrt;
 /*---------------------------------------------------------------------------*/
+#if UIP_MCAST6_ROUTE_HASH
+#if (UIP_MCAST6_ROUTE_HASH & (UIP_MCAST6_ROUTE_HASH - 1)) != 0
+#error UIP_MCAST6_ROUTE_CONF_HASH must be a power of two
+#endif
+/* Each bucket chains the routes whose group hashes to it via hash_next */
+static uip_mcast6_route_t *mcast_route_buckets[UIP_MCAST6_ROUTE_HASH];
+
+/* Hashes the scope and the low-order group ID bytes of a group */
+#define route_bucket(g) (&mcast_route_buckets[((g)->u8[1] ^ (g)->u8[13] ^ \
+  ((g)->u8[14] << 3) ^ ((g)->u8[15] * 31)) & (UIP_MCAST6_ROUTE_HASH - 1)])
+/*---------------------------------------------------------------------------*/
+static void
+route_unhash(uip_mcast6_route_t *route)
+{
+  uip_mcast6_route_t **rp;
+
+  for(rp = route_bucket(&route->group); *rp != NULL; rp = &(*rp)->hash_next) {
+    if(*rp == route) {
+      *rp = route->hash_next;
+      return;
+    }
+  }
+}
+#endif /* UIP_MCAST6_ROUTE_HASH */
+/*---------------------------------------------------------------------------*/
 uip_mcast6_route_t *
 uip_mcast6_route_lookup(uip_ipaddr_t *group)
 {
   locmcastrt = NULL;
+#if UIP_MCAST6_ROUTE_HASH
+  for(locmcastrt = *route_bucket(group);
+      locmcastrt != NULL;
+      locmcastrt = locmcastrt->hash_next) {
+#else /* UIP_MCAST6_ROUTE_HASH */
   for(locmcastrt = list_head(mcast_route_list);
       locmcastrt != NULL;
       locmcastrt = list_item_next(locmcastrt)) {
+#endif /* UIP_MCAST6_ROUTE_HASH */
     if(uip_ipaddr_cmp(&locmcastrt->group, group)) {
       return locmcastrt;
     }
@@ -89,12 +120,16 @@ uip_mcast6_route_add(uip_ipaddr_t *group)
       return NULL;
     }
     list_add(mcast_route_list, locmcastrt);
+    uip_ipaddr_copy(&(locmcastrt->group), group);
+#if UIP_MCAST6_ROUTE_HASH
+    locmcastrt->hash_next = *route_bucket(group);
+    *route_bucket(group) = locmcastrt;
+#endif
+    UIP_MCAST6_GROUP_STATS_INIT(locmcastrt);
   }
 
   /* Reaching here means we either found the prefix or allocated a new one */
 
-  uip_ipaddr_copy(&(locmcastrt->group), group);
-
   return locmcastrt;
 }
 /*---------------------------------------------------------------------------*/
@@ -106,6 +141,9 @@ uip_mcast6_route_rm(uip_mcast6_route_t *route)
       locmcastrt != NULL;
       locmcastrt = list_item_next(locmcastrt)) {
     if(locmcastrt == route) {
+#if UIP_MCAST6_ROUTE_HASH
+      route_unhash(route);
+#endif
       list_remove(mcast_route_list, route);
       memb_free(&mcast_route_memb, route);
       return;
@@ -113,6 +151,35 @@ uip_mcast6_route_rm(uip_mcast6_route_t *route)
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+uip_mcast6_route_add_groups(uip_ipaddr_t *groups, int count)
+{
+  int added = 0;
+
+  for(; count > 0; count--, groups++) {
+    if(uip_mcast6_route_add(groups) != NULL) {
+      added++;
+    }
+  }
+  return added;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_mcast6_route_rm_groups(uip_ipaddr_t *groups, int count)
+{
+  uip_mcast6_route_t *route;
+  int removed = 0;
+
+  for(; count > 0; count--, groups++) {
+    route = uip_mcast6_route_lookup(groups);
+    if(route != NULL) {
+      uip_mcast6_route_rm(route);
+      removed++;
+    }
+  }
+  return removed;
+}
+/*---------------------------------------------------------------------------*/
 uip_mcast6_route_t *
 uip_mcast6_route_list_head(void)
 {
@@ -130,6 +197,9 @@ uip_mcast6_route_init()
 {
   memb_init(&mcast_route_memb);
   list_init(mcast_route_list);
+#if UIP_MCAST6_ROUTE_HASH
+  memset(mcast_route_buckets, 0, sizeof(mcast_route_buckets));
+#endif
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -44,15 +44,34 @@
 
 #include "contiki.h"
 #include "net/ip/uip.h"
+#include "net/ipv6/multicast/uip-mcast6-stats.h"
 
 #include <stdint.h>
 /*---------------------------------------------------------------------------*/
+/**
+ * Number of hash buckets (a power of two) used to look up multicast routes
+ * by group. With the default 0, lookups walk the list of routes. Engines
+ * that look up the group of each incoming datagram, such as SMRF, benefit
+ * from this when the table holds many groups
+ */
+#ifdef UIP_MCAST6_ROUTE_CONF_HASH
+#define UIP_MCAST6_ROUTE_HASH UIP_MCAST6_ROUTE_CONF_HASH
+#else
+#define UIP_MCAST6_ROUTE_HASH 0
+#endif
+/*---------------------------------------------------------------------------*/
 /** \brief An entry in the multicast routing table */
 typedef struct uip_mcast6_route {
   struct uip_mcast6_route *next; /**< Routes are arranged in a linked list */
+#if UIP_MCAST6_ROUTE_HASH
+  struct uip_mcast6_route *hash_next; /**< Next route in the same bucket */
+#endif
   uip_ipaddr_t group; /**< The multicast group */
   uint32_t lifetime; /**< Entry lifetime seconds */
   void *dag; /**< Pointer to an rpl_dag_t struct */
+#if UIP_MCAST6_STATS
+  uip_mcast6_group_stats_t stats; /**< Forwarding stats for this group */
+#endif
 } uip_mcast6_route_t;
 /*---------------------------------------------------------------------------*/
 /** \name Multicast Routing Table Manipulation */
@@ -79,6 +98,25 @@ uip_mcast6_route_t *uip_mcast6_route_add(uip_ipaddr_t *group);
  */
 void uip_mcast6_route_rm(uip_mcast6_route_t *route);
 
+/**
+ * \brief Add multicast routes for several groups
+ * \param groups An array of multicast groups to be added
+ * \param count The number of groups in the array
+ * \return The number of groups which now have a route
+ *
+ * Groups which already have a route keep it. Groups which could not be
+ * added because the table is full are skipped.
+ */
+int uip_mcast6_route_add_groups(uip_ipaddr_t *groups, int count);
+
+/**
+ * \brief Remove the multicast routes for several groups
+ * \param groups An array of multicast groups to be removed
+ * \param count The number of groups in the array
+ * \return The number of routes removed
+ */
+int uip_mcast6_route_rm_groups(uip_ipaddr_t *groups, int count);
+
 /**
  * \brief Retrieve the count of multicast routes
  * \return The number of multicast routes
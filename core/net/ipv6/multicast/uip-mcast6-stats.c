@@ -51,4 +51,10 @@ uip_mcast6_stats_init(void *stats)
   uip_mcast6_stats.engine_stats = stats;
 }
 /*---------------------------------------------------------------------------*/
+void
+uip_mcast6_group_stats_init(uip_mcast6_group_stats_t *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
@@ -90,6 +90,19 @@ typedef struct uip_mcast6_stats {
   /** Opaque pointer to an engine's additional stats */
   void *engine_stats;
 } uip_mcast6_stats_t;
+/**
+ * \brief Forwarding stats kept for each group of the multicast routing table
+ */
+typedef struct uip_mcast6_group_stats {
+  /** Count of datagrams for this group forwarded by us */
+  UIP_MCAST6_STATS_DATATYPE fwd;
+
+  /** Count of datagrams for this group received again while still queued */
+  UIP_MCAST6_STATS_DATATYPE dup;
+
+  /** Count of queued datagrams for this group replaced before forwarding */
+  UIP_MCAST6_STATS_DATATYPE suppressed;
+} uip_mcast6_group_stats_t;
 /*---------------------------------------------------------------------------*/
 /* Access macros */
 /*---------------------------------------------------------------------------*/
@@ -100,10 +113,16 @@ extern uip_mcast6_stats_t uip_mcast6_stats;
 #define UIP_MCAST6_STATS_ADD(x) uip_mcast6_stats.x++
 #define UIP_MCAST6_STATS_GET(x) uip_mcast6_stats.x
 #define UIP_MCAST6_STATS_INIT(s) uip_mcast6_stats_init(s)
+#define UIP_MCAST6_GROUP_STATS_ADD(r, x) (r)->stats.x++
+#define UIP_MCAST6_GROUP_STATS_GET(r, x) (r)->stats.x
+#define UIP_MCAST6_GROUP_STATS_INIT(r) uip_mcast6_group_stats_init(&(r)->stats)
 #else /* UIP_MCAST6_STATS */
 #define UIP_MCAST6_STATS_ADD(x)
 #define UIP_MCAST6_STATS_GET(x) 0
 #define UIP_MCAST6_STATS_INIT(s)
+#define UIP_MCAST6_GROUP_STATS_ADD(r, x)
+#define UIP_MCAST6_GROUP_STATS_GET(r, x) 0
+#define UIP_MCAST6_GROUP_STATS_INIT(r)
 #endif /* UIP_MCAST6_STATS */
 /*---------------------------------------------------------------------------*/
 /**
@@ -111,6 +130,12 @@ extern uip_mcast6_stats_t uip_mcast6_stats;
  * \param stats A pointer to a struct holding an engine's additional statistics
  */
 void uip_mcast6_stats_init(void *stats);
+
+/**
+ * \brief Initialise the forwarding stats of a multicast group
+ * \param stats A pointer to the stats of a multicast routing table entry
+ */
+void uip_mcast6_group_stats_init(uip_mcast6_group_stats_t *stats);
 /*---------------------------------------------------------------------------*/
 #endif /* UIP_MCAST6_STATS_H_ */
 /*---------------------------------------------------------------------------*/
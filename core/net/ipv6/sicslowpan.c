@@ -68,6 +68,9 @@
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
+#include "lib/memb.h"
+#include "lib/list.h"
+#include "sys/ctimer.h"
 
 #include <stdio.h>
 
@@ -106,6 +109,20 @@ void uip_log(char *msg);
 #endif /* SICSLOWPAN_CONF_COMPRESSION */
 #endif /* SICSLOWPAN_COMPRESSION */
 
+/* With SICSLOWPAN_CONF_6LORH, a hop-by-hop options header that holds
+ * only the RPL option is sent as an RPI-6LoRH (RFC 8138) of 2 to 5
+ * bytes after a page 1 dispatch, instead of inline as 8 bytes. This
+ * requires IPHC, and all nodes of the network must enable it, as page 1
+ * packets are dropped by nodes that do not. */
+#ifdef SICSLOWPAN_CONF_6LORH
+#define SICSLOWPAN_6LORH SICSLOWPAN_CONF_6LORH
+#else
+#define SICSLOWPAN_6LORH 0
+#endif
+
+/* The length of a hop-by-hop options header with only the RPL option */
+#define SICSLOWPAN_RPI_HBH_LEN 8
+
 #define GET16(ptr,index) (((uint16_t)((ptr)[index] << 8)) | ((ptr)[(index) + 1]))
 #define SET16(ptr,index,value) do {     \
   (ptr)[index] = ((value) >> 8) & 0xff; \
@@ -210,6 +227,64 @@ static int last_tx_status;
 
 static int last_rssi;
 
+/* ----------------------------------------------------------------- */
+/* Mesh-under forwarding                                             */
+/* ----------------------------------------------------------------- */
+
+/* With SICSLOWPAN_CONF_MESH, a packet to a link-layer destination for
+ * which there is a mesh route is sent to the next hop of the route with
+ * a mesh header (RFC 4944), and relays forward it on the mesh header
+ * alone, without passing it up to IPv6. The routes are added with
+ * sicslowpan_mesh_route_add(), and, with SICSLOWPAN_CONF_MESH_DS6_ROUTES,
+ * follow the host routes of uip-ds6, as RPL installs them. The mesh
+ * header carries addresses of the size of the link-layer addresses. */
+#ifdef SICSLOWPAN_CONF_MESH
+#define SICSLOWPAN_MESH SICSLOWPAN_CONF_MESH
+#else
+#define SICSLOWPAN_MESH 0
+#endif
+
+#if SICSLOWPAN_MESH
+/* The number of mesh routes */
+#ifdef SICSLOWPAN_CONF_MESH_ROUTES
+#define SICSLOWPAN_MESH_ROUTES SICSLOWPAN_CONF_MESH_ROUTES
+#else
+#define SICSLOWPAN_MESH_ROUTES 8
+#endif
+
+/* The hops left of the packets that this node originates (at most 14) */
+#ifdef SICSLOWPAN_CONF_MESH_HOPS
+#define SICSLOWPAN_MESH_HOPS SICSLOWPAN_CONF_MESH_HOPS
+#else
+#define SICSLOWPAN_MESH_HOPS 8
+#endif
+
+#ifdef SICSLOWPAN_CONF_MESH_DS6_ROUTES
+#define SICSLOWPAN_MESH_DS6_ROUTES SICSLOWPAN_CONF_MESH_DS6_ROUTES
+#else
+#define SICSLOWPAN_MESH_DS6_ROUTES UIP_DS6_NOTIFICATIONS
+#endif
+
+#define SICSLOWPAN_MESH_HDR_LEN (1 + 2 * LINKADDR_SIZE)
+#if LINKADDR_SIZE == 2
+#define SICSLOWPAN_MESH_ADDR_FLAGS (SICSLOWPAN_MESH_V | SICSLOWPAN_MESH_F)
+#else /* LINKADDR_SIZE == 2 */
+#define SICSLOWPAN_MESH_ADDR_FLAGS 0
+#endif /* LINKADDR_SIZE == 2 */
+
+struct sicslowpan_mesh_route {
+  /** The final destination (linkaddr_null if this entry is not used) */
+  linkaddr_t dest;
+  linkaddr_t next_hop;
+};
+
+static struct sicslowpan_mesh_route mesh_routes[SICSLOWPAN_MESH_ROUTES];
+
+#if SICSLOWPAN_MESH_DS6_ROUTES
+static struct uip_ds6_notification mesh_notification;
+#endif /* SICSLOWPAN_MESH_DS6_ROUTES */
+#endif /* SICSLOWPAN_MESH */
+
 /* ----------------------------------------------------------------- */
 /* Support for reassembling multiple packets                         */
 /* ----------------------------------------------------------------- */
@@ -217,6 +292,79 @@ static int last_rssi;
 #if SICSLOWPAN_CONF_FRAG
 static uint16_t my_tag;
 
+/* The fragments of a datagram are queued as a batch, and handed to the
+ * MAC one at a time, each when the one before it has been sent. When a
+ * fragment cannot be sent, the rest of the datagram is dropped, as it
+ * could not be reassembled anyway. SICSLOWPAN_CONF_FRAG_BATCHES is the
+ * number of datagrams that can be sent at the same time. */
+#ifdef SICSLOWPAN_CONF_FRAG_BATCHES
+#define SICSLOWPAN_FRAG_BATCHES SICSLOWPAN_CONF_FRAG_BATCHES
+#else
+#define SICSLOWPAN_FRAG_BATCHES 2
+#endif
+
+/* A datagram can not have more fragments than there are queuebufs */
+#define SICSLOWPAN_FRAG_BATCH_LEN QUEUEBUF_NUM
+
+/* With SICSLOWPAN_CONF_FRAG_RECOVERY, a lost fragment does not cost the
+ * whole datagram, in the style of RFC 8931. The receiver answers the
+ * fragment that ends a datagram, and the completion of the datagram,
+ * with a FRAG_ACK: the tag and a bitmap of the offsets, in units of 8
+ * octets, at which it has received a fragment. The sender keeps the
+ * fragments until they are acknowledged, and sends the missing ones
+ * again, followed by the last fragment as a request for a new FRAG_ACK.
+ * Both ends must be configured with it. */
+#ifdef SICSLOWPAN_CONF_FRAG_RECOVERY
+#define SICSLOWPAN_FRAG_RECOVERY SICSLOWPAN_CONF_FRAG_RECOVERY
+#else
+#define SICSLOWPAN_FRAG_RECOVERY 0
+#endif
+
+#if SICSLOWPAN_FRAG_RECOVERY
+/* How long the sender waits for a FRAG_ACK */
+#ifdef SICSLOWPAN_CONF_FRAG_ACK_TIMEOUT
+#define SICSLOWPAN_FRAG_ACK_TIMEOUT SICSLOWPAN_CONF_FRAG_ACK_TIMEOUT
+#else
+#define SICSLOWPAN_FRAG_ACK_TIMEOUT (CLOCK_SECOND / 2)
+#endif
+
+/* How many times the missing fragments are sent again */
+#ifdef SICSLOWPAN_CONF_FRAG_RETRIES
+#define SICSLOWPAN_FRAG_RETRIES SICSLOWPAN_CONF_FRAG_RETRIES
+#else
+#define SICSLOWPAN_FRAG_RETRIES 3
+#endif
+
+/* The bitmap covers the largest datagram size of the fragment headers */
+#define SICSLOWPAN_FRAG_ACK_BITMAP_LEN (2048 / 8 / 8)
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
+struct frag_batch {
+#if SICSLOWPAN_FRAG_RECOVERY
+  struct frag_batch *next_batch;
+  /** The offsets of the fragments, in units of 8 octets */
+  uint8_t offsets[SICSLOWPAN_FRAG_BATCH_LEN];
+  /** Non-zero for the fragments that have been acknowledged */
+  uint8_t acked[SICSLOWPAN_FRAG_BATCH_LEN];
+  linkaddr_t dest;
+  uint16_t tag;
+  uint8_t retries;
+  /** Non-zero while a fragment is with the MAC */
+  uint8_t sending;
+  struct ctimer ack_timer;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+  /** The fragments, of which the first next have been sent */
+  struct queuebuf *frags[SICSLOWPAN_FRAG_BATCH_LEN];
+  uint8_t count;
+  uint8_t next;
+};
+
+MEMB(frag_batch_memb, struct frag_batch, SICSLOWPAN_FRAG_BATCHES);
+#if SICSLOWPAN_FRAG_RECOVERY
+/* The batches that are waiting for their fragments to be acknowledged */
+LIST(frag_batch_list);
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
 /** The total length of the IPv6 packet in the sicslowpan_buf. */
 
 /* This needs to be defined in NBR / Nodes depending on available RAM   */
@@ -230,7 +378,9 @@ static uint16_t my_tag;
 /* REASS_CONTEXTS corresponds to the number of simultaneous
  * reassemblies that can be made. NOTE: the first buffer for each
  * reassembly is stored in the context since it can be larger than the
- * rest of the fragments due to header compression.
+ * rest of the fragments due to header compression. With
+ * SICSLOWPAN_CONF_FRAG_PKTMEM, it is kept in the packet memory
+ * instead, and a context only costs its bookkeeping.
  **/
 #ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
 #define SICSLOWPAN_REASS_CONTEXTS SICSLOWPAN_CONF_REASS_CONTEXTS
@@ -245,8 +395,27 @@ static uint16_t my_tag;
 #define SICSLOWPAN_FRAGMENT_SIZE 110
 #endif
 
-/* Assuming that the worst growth for uncompression is 38 bytes */
+/* Assuming that the worst growth for uncompression is 38 bytes, and 5
+   more for an RPI-6LoRH */
+#if SICSLOWPAN_6LORH
+#define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38 + 5)
+#else /* SICSLOWPAN_6LORH */
 #define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
+#endif /* SICSLOWPAN_6LORH */
+
+/* With SICSLOWPAN_CONF_FRAG_PKTMEM, the fragments are stored in the
+ * shared packet memory, and the fragment buffers only hold their
+ * bookkeeping, so that no memory is held while nothing is being
+ * reassembled. */
+#ifdef SICSLOWPAN_CONF_FRAG_PKTMEM
+#define SICSLOWPAN_FRAG_PKTMEM SICSLOWPAN_CONF_FRAG_PKTMEM
+#else
+#define SICSLOWPAN_FRAG_PKTMEM 0
+#endif
+
+#if SICSLOWPAN_FRAG_PKTMEM
+#include "lib/pktmem.h"
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
 
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
@@ -263,15 +432,53 @@ struct sicslowpan_frag_info {
   /** Reassembly %process %timer. */
   struct timer reass_timer;
 
-  /** Fragment size of first fragment */
+  /** Fragment size of first fragment (zero if it is not stored) */
   uint16_t first_frag_len;
   /** First fragment - needs a larger buffer since the size is uncompressed size
    and we need to know total size to know when we have received last fragment. */
+#if SICSLOWPAN_FRAG_PKTMEM
+  struct mmem first_frag;
+#else /* SICSLOWPAN_FRAG_PKTMEM */
   uint8_t first_frag[SICSLOWPAN_FIRST_FRAGMENT_SIZE];
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
 };
 
+#if SICSLOWPAN_FRAG_PKTMEM
+#define FIRST_FRAG_DATA(i) ((uint8_t *)MMEM_PTR(&frag_info[i].first_frag))
+#else /* SICSLOWPAN_FRAG_PKTMEM */
+#define FIRST_FRAG_DATA(i) (frag_info[i].first_frag)
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
+
 static struct sicslowpan_frag_info frag_info[SICSLOWPAN_REASS_CONTEXTS];
 
+#if SICSLOWPAN_FRAG_STATS
+struct sicslowpan_frag_stats sicslowpan_frag_stats;
+#endif /* SICSLOWPAN_FRAG_STATS */
+
+#if SICSLOWPAN_FRAG_PKTMEM
+/* The number of bytes that the fragments being reassembled may take
+ * together in the packet memory. The reassembly contexts share this
+ * budget, and each holds only the fragments it has received, so a
+ * router may configure many more contexts than fit at the worst-case
+ * datagram size. */
+#ifdef SICSLOWPAN_CONF_FRAG_PKTMEM_BUDGET
+#define SICSLOWPAN_FRAG_PKTMEM_BUDGET SICSLOWPAN_CONF_FRAG_PKTMEM_BUDGET
+#else
+#define SICSLOWPAN_FRAG_PKTMEM_BUDGET \
+  (SICSLOWPAN_FRAGMENT_BUFFERS * SICSLOWPAN_FRAGMENT_SIZE + \
+   SICSLOWPAN_REASS_CONTEXTS * SICSLOWPAN_FIRST_FRAGMENT_SIZE)
+#endif
+
+#ifdef SICSLOWPAN_CONF_FRAG_PKTMEM_RESERVE
+#define SICSLOWPAN_FRAG_PKTMEM_RESERVE SICSLOWPAN_CONF_FRAG_PKTMEM_RESERVE
+#else
+#define SICSLOWPAN_FRAG_PKTMEM_RESERVE 0
+#endif
+
+PKTMEM_USER(sicslowpan_frags, SICSLOWPAN_FRAG_PKTMEM_RESERVE,
+            SICSLOWPAN_FRAG_PKTMEM_BUDGET);
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
+
 struct sicslowpan_frag_buf {
   /* the index of the frag_info */
   uint8_t index;
@@ -279,11 +486,83 @@ struct sicslowpan_frag_buf {
   uint8_t offset;
   /* Length of this fragment (if zero this buffer is not allocated) */
   uint8_t len;
+#if SICSLOWPAN_FRAG_PKTMEM
+  struct mmem data;
+#else /* SICSLOWPAN_FRAG_PKTMEM */
   uint8_t data[SICSLOWPAN_FRAGMENT_SIZE];
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
 };
 
+#if SICSLOWPAN_FRAG_PKTMEM
+#define FRAG_BUF_DATA(b) ((uint8_t *)MMEM_PTR(&(b)->data))
+#else /* SICSLOWPAN_FRAG_PKTMEM */
+#define FRAG_BUF_DATA(b) ((b)->data)
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
+
 static struct sicslowpan_frag_buf frag_buf[SICSLOWPAN_FRAGMENT_BUFFERS];
 
+#if SICSLOWPAN_FRAG_RECOVERY
+/* The FRAG_ACK to send when input() is done with the packetbuf */
+static struct {
+  linkaddr_t dest;
+  uint16_t tag;
+  /** The length of the bitmap (zero if there is nothing to send) */
+  uint8_t len;
+  uint8_t bitmap[SICSLOWPAN_FRAG_ACK_BITMAP_LEN];
+} frag_ack;
+
+/* The last datagram that was reassembled, which is acknowledged again
+   if its fragments keep coming because the FRAG_ACK was lost */
+static struct {
+  linkaddr_t sender;
+  uint16_t tag;
+  /** The length of the datagram (zero if there is none) */
+  uint16_t len;
+} frag_done;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
+/* With SICSLOWPAN_CONF_FRAG_FORWARDING, a router forwards the fragments
+ * of a datagram that is not addressed to it as they arrive, instead of
+ * reassembling the datagram and fragmenting it again. The first
+ * fragment is routed on its IPv6 header, and a virtual reassembly
+ * buffer, keyed on the previous hop and the tag, holds the next hop and
+ * the new tag for the fragments that follow
+ * (draft-ietf-6lo-minimal-fragment). */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING SICSLOWPAN_CONF_FRAG_FORWARDING
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+#if SICSLOWPAN_FRAG_FORWARDING
+/* The number of datagrams that can be forwarded at the same time */
+#ifdef SICSLOWPAN_CONF_VRB_ENTRIES
+#define SICSLOWPAN_VRB_ENTRIES SICSLOWPAN_CONF_VRB_ENTRIES
+#else
+#define SICSLOWPAN_VRB_ENTRIES 4
+#endif
+
+/* A virtual reassembly buffer entry */
+struct sicslowpan_vrb {
+  /** The previous hop of the fragments */
+  linkaddr_t sender;
+  /** The next hop of the fragments */
+  linkaddr_t next_hop;
+  /** The tag of the received fragments */
+  uint16_t tag;
+  /** The tag of the forwarded fragments */
+  uint16_t out_tag;
+  /** Total length of the datagram (zero if this entry is not used) */
+  uint16_t len;
+  /** Number of bytes of the datagram forwarded so far */
+  uint16_t forwarded_len;
+  /** The entry is dropped when this timer expires */
+  struct timer timer;
+};
+
+static struct sicslowpan_vrb vrb[SICSLOWPAN_VRB_ENTRIES];
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
 /*---------------------------------------------------------------------------*/
 static int
 clear_fragments(uint8_t frag_info_index)
@@ -294,10 +573,20 @@ clear_fragments(uint8_t frag_info_index)
   for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
     if(frag_buf[i].len > 0 && frag_buf[i].index == frag_info_index) {
       /* deallocate the buffer */
+#if SICSLOWPAN_FRAG_PKTMEM
+      pktmem_free(&sicslowpan_frags, &frag_buf[i].data);
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
       frag_buf[i].len = 0;
       clear_count++;
     }
   }
+#if SICSLOWPAN_FRAG_PKTMEM
+  if(frag_info[frag_info_index].first_frag_len > 0) {
+    pktmem_free(&sicslowpan_frags, &frag_info[frag_info_index].first_frag);
+    clear_count++;
+  }
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
+  frag_info[frag_info_index].first_frag_len = 0;
   return clear_count;
 }
 /*---------------------------------------------------------------------------*/
@@ -310,6 +599,7 @@ timeout_fragments(int not_context)
     if(frag_info[i].len > 0 && i != not_context &&
        timer_expired(&frag_info[i].reass_timer)) {
       /* This context can be freed */
+      SICSLOWPAN_FRAG_STAT(sicslowpan_frag_stats.timed_out++);
       count += clear_fragments(i);
     }
   }
@@ -322,11 +612,18 @@ store_fragment(uint8_t index, uint8_t offset)
   int i;
   for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
     if(frag_buf[i].len == 0) {
+#if SICSLOWPAN_FRAG_PKTMEM
+      if(packetbuf_datalen() <= packetbuf_hdr_len ||
+         !pktmem_alloc(&sicslowpan_frags, &frag_buf[i].data,
+                       packetbuf_datalen() - packetbuf_hdr_len)) {
+        return -1;
+      }
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
       /* copy over the data from packetbuf into the fragment buffer and store offset and len */
       frag_buf[i].offset = offset; /* frag offset */
       frag_buf[i].len = packetbuf_datalen() - packetbuf_hdr_len;
       frag_buf[i].index = index;
-      memcpy(frag_buf[i].data, packetbuf_ptr + packetbuf_hdr_len,
+      memcpy(FRAG_BUF_DATA(&frag_buf[i]), packetbuf_ptr + packetbuf_hdr_len,
              packetbuf_datalen() - packetbuf_hdr_len);
 
       PRINTF("Fragsize: %d\n", frag_buf[i].len);
@@ -342,15 +639,23 @@ store_fragment(uint8_t index, uint8_t offset)
 static int8_t
 add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
 {
-  int i;
+  int i, j;
   int len;
   int8_t found = -1;
 
   if(offset == 0) {
     /* This is a first fragment - check if we can add this */
     for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+      if(frag_info[i].len > 0 && frag_info[i].tag == tag &&
+         !timer_expired(&frag_info[i].reass_timer) &&
+         linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+        PRINTF("*** Duplicate first fragment - tag: %d\n", tag);
+        return -1;
+      }
+
       /* clear all fragment info with expired timer to free all fragment buffers */
       if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
+        SICSLOWPAN_FRAG_STAT(sicslowpan_frag_stats.timed_out++);
 	clear_fragments(i);
       }
 
@@ -364,6 +669,7 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
 
     if(found < 0) {
       PRINTF("*** Failed to store new fragment session - tag: %d\n", tag);
+      SICSLOWPAN_FRAG_STAT(sicslowpan_frag_stats.no_context++);
       return -1;
     }
 
@@ -394,6 +700,15 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
     return -1;
   }
 
+  /* A fragment that was sent again is only stored once */
+  for(j = 0; j < SICSLOWPAN_FRAGMENT_BUFFERS; j++) {
+    if(frag_buf[j].len > 0 && frag_buf[j].index == i &&
+       frag_buf[j].offset == offset) {
+      PRINTF("*** Duplicate fragment - tag: %d offset: %d\n", tag, offset);
+      return i;
+    }
+  }
+
   /* i is the index of the reassembly context */
   len = store_fragment(i, offset);
   if(len < 0 && timeout_fragments(i) > 0) {
@@ -406,6 +721,7 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
     /* should we also clear all fragments since we failed to store
        this fragment? */
     PRINTF("*** Failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[i].tag);
+    SICSLOWPAN_FRAG_STAT(sicslowpan_frag_stats.no_buffer++);
     return -1;
   }
 }
@@ -418,18 +734,40 @@ copy_frags2uip(int context)
   int i;
 
   /* Copy from the fragment context info buffer first */
-  memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)frag_info[context].first_frag,
+  memcpy((uint8_t *)UIP_IP_BUF, FIRST_FRAG_DATA(context),
 	 frag_info[context].first_frag_len);
   for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
     /* And also copy all matching fragments */
     if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
       memcpy((uint8_t *)UIP_IP_BUF + (uint16_t)(frag_buf[i].offset << 3),
-	     (uint8_t *)frag_buf[i].data, frag_buf[i].len);
+	     FRAG_BUF_DATA(&frag_buf[i]), frag_buf[i].len);
     }
   }
   /* deallocate all the fragments for this context */
   clear_fragments(context);
 }
+#if SICSLOWPAN_FRAG_RECOVERY
+/*---------------------------------------------------------------------------*/
+/* Prepare a FRAG_ACK with the fragments that a context has received */
+static void
+frag_ack_prepare(int context)
+{
+  int i;
+
+  linkaddr_copy(&frag_ack.dest, &frag_info[context].sender);
+  frag_ack.tag = frag_info[context].tag;
+  frag_ack.len = (frag_info[context].len + 63) / 64;
+  memset(frag_ack.bitmap, 0, frag_ack.len);
+  if(frag_info[context].first_frag_len > 0) {
+    frag_ack.bitmap[0] = 0x80;
+  }
+  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
+    if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
+      frag_ack.bitmap[frag_buf[i].offset >> 3] |= 0x80 >> (frag_buf[i].offset & 7);
+    }
+  }
+}
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 /* -------------------------------------------------------------------------- */
@@ -500,6 +838,52 @@ static struct sicslowpan_addr_context *context;
 /** pointer to the byte where to write next inline field. */
 static uint8_t *hc06_ptr;
 
+#if SICSLOWPAN_6LORH
+/** The RPL option of the packet being uncompressed, from its RPI-6LoRH */
+static struct {
+  uint8_t present;
+  uint8_t flags;
+  uint8_t instance;
+  uint16_t rank;
+} rpi_6lorh;
+#endif /* SICSLOWPAN_6LORH */
+
+/* The IPHC encoding of the addresses of a packet depends only on the
+ * addresses, the link-layer destination, this node's link-layer address
+ * and the contexts. SICSLOWPAN_CONF_IPHC_CACHE_ENTRIES is the number of
+ * address pairs whose encoding is kept, so that a node that sends to the
+ * same destinations does not look up contexts and compare interface
+ * identifiers for every packet. */
+#ifdef SICSLOWPAN_CONF_IPHC_CACHE_ENTRIES
+#define SICSLOWPAN_IPHC_CACHE_ENTRIES SICSLOWPAN_CONF_IPHC_CACHE_ENTRIES
+#else
+#define SICSLOWPAN_IPHC_CACHE_ENTRIES 0
+#endif
+
+/** The IPHC encoding of the source and destination addresses */
+struct iphc_addrs {
+#if SICSLOWPAN_IPHC_CACHE_ENTRIES > 0
+  uip_ipaddr_t srcipaddr;
+  uip_ipaddr_t destipaddr;
+  linkaddr_t link_destaddr;
+  uint8_t used;
+#endif /* SICSLOWPAN_IPHC_CACHE_ENTRIES > 0 */
+  /** The CID, SAC, SAM, M, DAC and DAM bits of the second IPHC byte */
+  uint8_t iphc1;
+  /** The context identifier extension byte */
+  uint8_t cid;
+  /** The inline address bytes */
+  uint8_t len;
+  uint8_t addr[32];
+};
+
+#if SICSLOWPAN_IPHC_CACHE_ENTRIES > 0
+static struct iphc_addrs iphc_cache[SICSLOWPAN_IPHC_CACHE_ENTRIES];
+static uint8_t iphc_cache_next;
+#else /* SICSLOWPAN_IPHC_CACHE_ENTRIES > 0 */
+static struct iphc_addrs iphc_cache[1];
+#endif /* SICSLOWPAN_IPHC_CACHE_ENTRIES > 0 */
+
 /* Uncompression of linklocal */
 /*   0 -> 16 bytes from packet  */
 /*   1 -> 2 bytes from prefix - bunch of zeroes and 8 from packet */
@@ -591,6 +975,11 @@ compress_addr_64(uint8_t bitpos, uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
  * to configure the IP address (autoconf style).
  * pref_post_count takes a byte where the first nibble specify prefix count
  * and the second postfix count (NOTE: 15/0xf => 16 bytes copy).
+ *
+ * The address is cleared in 16-bit words, and the prefix and postfix
+ * are copied with copies of the few sizes that the modes use, which the
+ * compiler turns into plain loads and stores, instead of with memcpy()
+ * and memset() calls of a variable size.
  */
 static void
 uncompress_addr(uip_ipaddr_t *ipaddr, uint8_t const prefix[],
@@ -604,29 +993,306 @@ uncompress_addr(uip_ipaddr_t *ipaddr, uint8_t const prefix[],
 
   PRINTF("Uncompressing %d + %d => ", prefcount, postcount);
 
-  if(prefcount > 0) {
-    memcpy(ipaddr, prefix, prefcount);
+  if(postcount == 16) {
+    /* Carried inline */
+    memcpy(ipaddr, hc06_ptr, 16);
+    hc06_ptr += 16;
+    PRINT6ADDR(ipaddr);
+    PRINTF("\n");
+    return;
   }
-  if(prefcount + postcount < 16) {
-    memset(&ipaddr->u8[prefcount], 0, 16 - (prefcount + postcount));
+
+  ipaddr->u16[0] = 0;
+  ipaddr->u16[1] = 0;
+  ipaddr->u16[2] = 0;
+  ipaddr->u16[3] = 0;
+  ipaddr->u16[4] = 0;
+  ipaddr->u16[5] = 0;
+  ipaddr->u16[6] = 0;
+  ipaddr->u16[7] = 0;
+
+  switch(prefcount) {
+  case 2:
+    memcpy(ipaddr, prefix, 2);
+    break;
+  case 8:
+    memcpy(ipaddr, prefix, 8);
+    break;
+  case 0:
+    break;
+  default:
+    memcpy(ipaddr, prefix, prefcount);
+    break;
   }
-  if(postcount > 0) {
-    memcpy(&ipaddr->u8[16 - postcount], hc06_ptr, postcount);
-    if(postcount == 2 && prefcount < 11) {
-      /* 16 bits uncompression => 0000:00ff:fe00:XXXX */
-      ipaddr->u8[11] = 0xff;
-      ipaddr->u8[12] = 0xfe;
+
+  switch(postcount) {
+  case 0:
+    if(prefcount > 0) {
+      /* no IID based configuration if no prefix and no data => unspec */
+      uip_ds6_set_addr_iid(ipaddr, lladdr);
     }
-    hc06_ptr += postcount;
-  } else if (prefcount > 0) {
-    /* no IID based configuration if no prefix and no data => unspec */
-    uip_ds6_set_addr_iid(ipaddr, lladdr);
+    break;
+  case 2:
+    /* 16 bits uncompression => 0000:00ff:fe00:XXXX */
+    ipaddr->u16[5] = UIP_HTONS(0x00ff);
+    ipaddr->u16[6] = UIP_HTONS(0xfe00);
+    memcpy(&ipaddr->u8[14], hc06_ptr, 2);
+    break;
+  case 8:
+    memcpy(&ipaddr->u8[8], hc06_ptr, 8);
+    break;
+  default:
+    memcpy(&ipaddr->u8[16 - postcount], hc06_ptr, postcount);
+    break;
   }
+  hc06_ptr += postcount;
 
   PRINT6ADDR(ipaddr);
   PRINTF("\n");
 }
 
+#if SICSLOWPAN_6LORH
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Compress a hop-by-hop options header with only the RPL option
+ * into a page 1 dispatch and an RPI-6LoRH (RFC 8138)
+ * \return The length of the compressed IPv6 extension header, 0 if the
+ * packet has no such header
+ *
+ * The RPLInstanceID is elided if it is 0, and the SenderRank is sent in
+ * one byte if it is below 256.
+ */
+static uint8_t
+compress_rpi_6lorh(void)
+{
+  uint8_t *hbh;
+  uint8_t *ptr;
+  uint16_t rank;
+
+  hbh = &uip_buf[UIP_LLIPH_LEN];
+  if(UIP_IP_BUF->proto != UIP_PROTO_HBHO ||
+     uip_len < UIP_IPH_LEN + SICSLOWPAN_RPI_HBH_LEN ||
+     hbh[1] != 0 || hbh[2] != UIP_EXT_HDR_OPT_RPL || hbh[3] != 4 ||
+     (hbh[4] & 0x1f) != 0) {
+    return 0;
+  }
+
+  ptr = packetbuf_ptr + packetbuf_hdr_len;
+  ptr[0] = SICSLOWPAN_DISPATCH_PAGE_1;
+  /* O, R and F are the three top bits of the RPL option flags */
+  ptr[1] = SICSLOWPAN_6LORH_DISPATCH | ((hbh[4] & 0xe0) >> 3);
+  ptr[2] = SICSLOWPAN_6LORH_TYPE_RPI;
+  if(hbh[5] == 0) {
+    ptr[1] |= SICSLOWPAN_6LORH_RPI_I;
+    hc06_ptr = ptr + 3;
+  } else {
+    ptr[3] = hbh[5];
+    hc06_ptr = ptr + 4;
+  }
+  rank = (hbh[6] << 8) | hbh[7];
+  if(rank < 0x100) {
+    ptr[1] |= SICSLOWPAN_6LORH_RPI_K;
+    *hc06_ptr++ = rank;
+  } else {
+    *hc06_ptr++ = rank >> 8;
+    *hc06_ptr++ = rank & 0xff;
+  }
+  packetbuf_hdr_len = hc06_ptr - packetbuf_ptr;
+  return SICSLOWPAN_RPI_HBH_LEN;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Parse the 6LoRHs that follow a page 1 dispatch
+ * \return 1 if the headers were parsed, 0 if the packet has to be
+ * dropped
+ *
+ * The RPI-6LoRH is stored in rpi_6lorh, to be expanded by
+ * uncompress_hdr_iphc(). Elective 6LoRHs of other types are skipped.
+ */
+static int
+uncompress_6lorh(void)
+{
+  uint8_t *ptr;
+  uint8_t *end;
+  uint8_t hdr;
+
+  ptr = packetbuf_ptr + packetbuf_hdr_len + 1;
+  end = packetbuf_ptr + packetbuf_datalen();
+  while(ptr + 2 <= end &&
+        (ptr[0] & SICSLOWPAN_6LORH_MASK) == SICSLOWPAN_6LORH_DISPATCH) {
+    if(ptr[0] & SICSLOWPAN_6LORH_ELECTIVE) {
+      ptr += 2 + (ptr[0] & SICSLOWPAN_6LORH_LEN_MASK);
+      continue;
+    }
+    if(ptr[1] != SICSLOWPAN_6LORH_TYPE_RPI) {
+      PRINTF("sicslowpan: unsupported critical 6LoRH type %u\n", ptr[1]);
+      return 0;
+    }
+    hdr = ptr[0];
+    ptr += 2;
+    rpi_6lorh.present = 1;
+    rpi_6lorh.flags = (hdr & SICSLOWPAN_6LORH_RPI_ORF) << 3;
+    rpi_6lorh.instance = 0;
+    if((hdr & SICSLOWPAN_6LORH_RPI_I) == 0) {
+      rpi_6lorh.instance = *ptr++;
+    }
+    if(hdr & SICSLOWPAN_6LORH_RPI_K) {
+      rpi_6lorh.rank = *ptr++;
+    } else {
+      rpi_6lorh.rank = (ptr[0] << 8) | ptr[1];
+      ptr += 2;
+    }
+  }
+  if(ptr >= end) {
+    return 0;
+  }
+  packetbuf_hdr_len = ptr - packetbuf_ptr;
+  return 1;
+}
+#endif /* SICSLOWPAN_6LORH */
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Compress the source and destination addresses of the packet
+ * in uip_buf
+ * \param a the IPHC address encoding is stored here
+ * \param link_destaddr L2 destination address, needed to compress IP
+ * dest
+ */
+static void
+compress_addrs_iphc(struct iphc_addrs *a, linkaddr_t *link_destaddr)
+{
+  a->iphc1 = 0;
+  a->cid = 0;
+  hc06_ptr = a->addr;
+
+  /* source address - cannot be multicast */
+  if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
+    PRINTF("IPHC: compressing unspecified - setting SAC\n");
+    a->iphc1 |= SICSLOWPAN_IPHC_SAC;
+    a->iphc1 |= SICSLOWPAN_IPHC_SAM_00;
+  } else if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr))
+     != NULL) {
+    /* elide the prefix - indicate by CID and set context + SAC */
+    PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
+           context->number);
+    a->iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC;
+    a->cid |= context->number << 4;
+    /* compession compare with this nodes address (source) */
+
+    a->iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
+                                 &UIP_IP_BUF->srcipaddr, &uip_lladdr);
+    /* No context found for this address */
+  } else if(uip_is_addr_linklocal(&UIP_IP_BUF->srcipaddr) &&
+            UIP_IP_BUF->destipaddr.u16[1] == 0 &&
+            UIP_IP_BUF->destipaddr.u16[2] == 0 &&
+            UIP_IP_BUF->destipaddr.u16[3] == 0) {
+    a->iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
+                                 &UIP_IP_BUF->srcipaddr, &uip_lladdr);
+  } else {
+    /* send the full address => SAC = 0, SAM = 00 */
+    a->iphc1 |= SICSLOWPAN_IPHC_SAM_00; /* 128-bits */
+    memcpy(hc06_ptr, &UIP_IP_BUF->srcipaddr.u16[0], 16);
+    hc06_ptr += 16;
+  }
+
+  /* dest address*/
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+    /* Address is multicast, try to compress */
+    a->iphc1 |= SICSLOWPAN_IPHC_M;
+    if(sicslowpan_is_mcast_addr_compressable8(&UIP_IP_BUF->destipaddr)) {
+      a->iphc1 |= SICSLOWPAN_IPHC_DAM_11;
+      /* use last byte */
+      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[15];
+      hc06_ptr += 1;
+    } else if(sicslowpan_is_mcast_addr_compressable32(&UIP_IP_BUF->destipaddr)) {
+      a->iphc1 |= SICSLOWPAN_IPHC_DAM_10;
+      /* second byte + the last three */
+      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
+      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[13], 3);
+      hc06_ptr += 4;
+    } else if(sicslowpan_is_mcast_addr_compressable48(&UIP_IP_BUF->destipaddr)) {
+      a->iphc1 |= SICSLOWPAN_IPHC_DAM_01;
+      /* second byte + the last five */
+      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
+      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[11], 5);
+      hc06_ptr += 6;
+    } else {
+      a->iphc1 |= SICSLOWPAN_IPHC_DAM_00;
+      /* full address */
+      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u8[0], 16);
+      hc06_ptr += 16;
+    }
+  } else {
+    /* Address is unicast, try to compress */
+    if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr)) != NULL) {
+      /* elide the prefix - indicate by CID and set context + DAC */
+      a->iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_DAC;
+      a->cid |= context->number;
+      /* compession compare with link adress (destination) */
+
+      a->iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
+                                   &UIP_IP_BUF->destipaddr,
+                                   (uip_lladdr_t *)link_destaddr);
+      /* No context found for this address */
+    } else if(uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr) &&
+              UIP_IP_BUF->destipaddr.u16[1] == 0 &&
+              UIP_IP_BUF->destipaddr.u16[2] == 0 &&
+              UIP_IP_BUF->destipaddr.u16[3] == 0) {
+      a->iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
+                  &UIP_IP_BUF->destipaddr, (uip_lladdr_t *)link_destaddr);
+    } else {
+      /* send the full address */
+      a->iphc1 |= SICSLOWPAN_IPHC_DAM_00; /* 128-bits */
+      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u16[0], 16);
+      hc06_ptr += 16;
+    }
+  }
+
+  a->len = hc06_ptr - a->addr;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Get the IPHC address encoding of the packet in uip_buf, from
+ * the cache if it is there
+ * \param link_destaddr L2 destination address of the packet
+ * \return The address encoding
+ */
+static struct iphc_addrs *
+get_addrs_iphc(linkaddr_t *link_destaddr)
+{
+  struct iphc_addrs *a;
+#if SICSLOWPAN_IPHC_CACHE_ENTRIES > 0
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_IPHC_CACHE_ENTRIES; i++) {
+    a = &iphc_cache[i];
+    if(a->used &&
+       uip_ipaddr_cmp(&a->srcipaddr, &UIP_IP_BUF->srcipaddr) &&
+       uip_ipaddr_cmp(&a->destipaddr, &UIP_IP_BUF->destipaddr) &&
+       linkaddr_cmp(&a->link_destaddr, link_destaddr)) {
+      return a;
+    }
+  }
+
+  /* Not cached: replace the entries in turn */
+  a = &iphc_cache[iphc_cache_next];
+  iphc_cache_next = (iphc_cache_next + 1) % SICSLOWPAN_IPHC_CACHE_ENTRIES;
+  uip_ipaddr_copy(&a->srcipaddr, &UIP_IP_BUF->srcipaddr);
+  uip_ipaddr_copy(&a->destipaddr, &UIP_IP_BUF->destipaddr);
+  linkaddr_copy(&a->link_destaddr, link_destaddr);
+  a->used = 1;
+#else /* SICSLOWPAN_IPHC_CACHE_ENTRIES > 0 */
+  a = &iphc_cache[0];
+#endif /* SICSLOWPAN_IPHC_CACHE_ENTRIES > 0 */
+  compress_addrs_iphc(a, link_destaddr);
+  return a;
+}
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_flush_iphc_cache(void)
+{
+  memset(iphc_cache, 0, sizeof(iphc_cache));
+}
 /*--------------------------------------------------------------------*/
 /**
  * \brief Compress IP/UDP header
@@ -666,6 +1332,11 @@ static void
 compress_hdr_iphc(linkaddr_t *link_destaddr)
 {
   uint8_t tmp, iphc0, iphc1;
+  struct iphc_addrs *addrs;
+  /* The header after any extension header that is compressed away */
+  uint8_t proto;
+  uint8_t ext_len;
+  struct uip_udp_hdr *udp_buf;
 #if DEBUG
   { uint16_t ndx;
     PRINTF("before compression (%d): ", UIP_IP_BUF->len[1]);
@@ -677,7 +1348,20 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
   }
 #endif
 
-  hc06_ptr = packetbuf_ptr + 2;
+  ext_len = 0;
+#if SICSLOWPAN_6LORH
+  ext_len = compress_rpi_6lorh();
+#endif /* SICSLOWPAN_6LORH */
+  proto = ext_len > 0 ? uip_buf[UIP_LLIPH_LEN] : UIP_IP_BUF->proto;
+  udp_buf = (struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN + ext_len];
+
+  /*
+   * Address handling needs to be made first since it might
+   * cause an extra byte with [ SCI | DCI ]
+   */
+  addrs = get_addrs_iphc(link_destaddr);
+
+  hc06_ptr = packetbuf_ptr + packetbuf_hdr_len + 2;
   /*
    * As we copy some bit-length fields, in the IPHC encoding bytes,
    * we sometimes use |=
@@ -686,24 +1370,11 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
    */
 
   iphc0 = SICSLOWPAN_DISPATCH_IPHC;
-  iphc1 = 0;
-  PACKETBUF_IPHC_BUF[2] = 0; /* might not be used - but needs to be cleared */
-
-  /*
-   * Address handling needs to be made first since it might
-   * cause an extra byte with [ SCI | DCI ]
-   *
-   */
+  iphc1 = addrs->iphc1;
+  PACKETBUF_IPHC_BUF[2] = addrs->cid; /* might not be used - but needs to be set */
 
-
-  /* check if dest context exists (for allocating third byte) */
-  /* TODO: fix this so that it remembers the looked up values for
-     avoiding two lookups - or set the lookup values immediately */
-  if(addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr) != NULL ||
-     addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr) != NULL) {
-    /* set context flag and increase hc06_ptr */
+  if(iphc1 & SICSLOWPAN_IPHC_CID) {
     PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
-    iphc1 |= SICSLOWPAN_IPHC_CID;
     hc06_ptr++;
   }
 
@@ -755,13 +1426,13 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
 
   /* Next header. We compress it if UDP */
 #if UIP_CONF_UDP || UIP_CONF_ROUTER
-  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+  if(proto == UIP_PROTO_UDP) {
     iphc0 |= SICSLOWPAN_IPHC_NH_C;
   }
 #endif /*UIP_CONF_UDP*/
 
   if ((iphc0 & SICSLOWPAN_IPHC_NH_C) == 0) {
-    *hc06_ptr = UIP_IP_BUF->proto;
+    *hc06_ptr = proto;
     hc06_ptr += 1;
   }
 
@@ -788,136 +1459,57 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
       break;
   }
 
-  /* source address - cannot be multicast */
-  if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
-    PRINTF("IPHC: compressing unspecified - setting SAC\n");
-    iphc1 |= SICSLOWPAN_IPHC_SAC;
-    iphc1 |= SICSLOWPAN_IPHC_SAM_00;
-  } else if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr))
-     != NULL) {
-    /* elide the prefix - indicate by CID and set context + SAC */
-    PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
-           context->number);
-    iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC;
-    PACKETBUF_IPHC_BUF[2] |= context->number << 4;
-    /* compession compare with this nodes address (source) */
+  /* source and destination addresses */
+  memcpy(hc06_ptr, addrs->addr, addrs->len);
+  hc06_ptr += addrs->len;
 
-    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
-    /* No context found for this address */
-  } else if(uip_is_addr_linklocal(&UIP_IP_BUF->srcipaddr) &&
-            UIP_IP_BUF->destipaddr.u16[1] == 0 &&
-            UIP_IP_BUF->destipaddr.u16[2] == 0 &&
-            UIP_IP_BUF->destipaddr.u16[3] == 0) {
-    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
-  } else {
-    /* send the full address => SAC = 0, SAM = 00 */
-    iphc1 |= SICSLOWPAN_IPHC_SAM_00; /* 128-bits */
-    memcpy(hc06_ptr, &UIP_IP_BUF->srcipaddr.u16[0], 16);
-    hc06_ptr += 16;
-  }
-
-  /* dest address*/
-  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
-    /* Address is multicast, try to compress */
-    iphc1 |= SICSLOWPAN_IPHC_M;
-    if(sicslowpan_is_mcast_addr_compressable8(&UIP_IP_BUF->destipaddr)) {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_11;
-      /* use last byte */
-      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[15];
-      hc06_ptr += 1;
-    } else if(sicslowpan_is_mcast_addr_compressable32(&UIP_IP_BUF->destipaddr)) {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_10;
-      /* second byte + the last three */
-      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
-      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[13], 3);
-      hc06_ptr += 4;
-    } else if(sicslowpan_is_mcast_addr_compressable48(&UIP_IP_BUF->destipaddr)) {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_01;
-      /* second byte + the last five */
-      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
-      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[11], 5);
-      hc06_ptr += 6;
-    } else {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_00;
-      /* full address */
-      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u8[0], 16);
-      hc06_ptr += 16;
-    }
-  } else {
-    /* Address is unicast, try to compress */
-    if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr)) != NULL) {
-      /* elide the prefix */
-      iphc1 |= SICSLOWPAN_IPHC_DAC;
-      PACKETBUF_IPHC_BUF[2] |= context->number;
-      /* compession compare with link adress (destination) */
-
-      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-                                &UIP_IP_BUF->destipaddr,
-                                (uip_lladdr_t *)link_destaddr);
-      /* No context found for this address */
-    } else if(uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr) &&
-              UIP_IP_BUF->destipaddr.u16[1] == 0 &&
-              UIP_IP_BUF->destipaddr.u16[2] == 0 &&
-              UIP_IP_BUF->destipaddr.u16[3] == 0) {
-      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-               &UIP_IP_BUF->destipaddr, (uip_lladdr_t *)link_destaddr);
-    } else {
-      /* send the full address */
-      iphc1 |= SICSLOWPAN_IPHC_DAM_00; /* 128-bits */
-      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u16[0], 16);
-      hc06_ptr += 16;
-    }
-  }
-
-  uncomp_hdr_len = UIP_IPH_LEN;
+  uncomp_hdr_len = UIP_IPH_LEN + ext_len;
 
 #if UIP_CONF_UDP || UIP_CONF_ROUTER
   /* UDP header compression */
-  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+  if(proto == UIP_PROTO_UDP) {
     PRINTF("IPHC: Uncompressed UDP ports on send side: %x, %x\n",
-           UIP_HTONS(UIP_UDP_BUF->srcport), UIP_HTONS(UIP_UDP_BUF->destport));
+           UIP_HTONS(udp_buf->srcport), UIP_HTONS(udp_buf->destport));
     /* Mask out the last 4 bits can be used as a mask */
-    if(((UIP_HTONS(UIP_UDP_BUF->srcport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) &&
-       ((UIP_HTONS(UIP_UDP_BUF->destport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN)) {
+    if(((UIP_HTONS(udp_buf->srcport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) &&
+       ((UIP_HTONS(udp_buf->destport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN)) {
       /* we can compress 12 bits of both source and dest */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_11;
       PRINTF("IPHC: remove 12 b of both source & dest with prefix 0xFOB\n");
       *(hc06_ptr + 1) =
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->srcport) -
+        (uint8_t)((UIP_HTONS(udp_buf->srcport) -
                    SICSLOWPAN_UDP_4_BIT_PORT_MIN) << 4) +
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->destport) -
+        (uint8_t)((UIP_HTONS(udp_buf->destport) -
                    SICSLOWPAN_UDP_4_BIT_PORT_MIN));
       hc06_ptr += 2;
-    } else if((UIP_HTONS(UIP_UDP_BUF->destport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
+    } else if((UIP_HTONS(udp_buf->destport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
       /* we can compress 8 bits of dest, leave source. */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_01;
       PRINTF("IPHC: leave source, remove 8 bits of dest with prefix 0xF0\n");
-      memcpy(hc06_ptr + 1, &UIP_UDP_BUF->srcport, 2);
+      memcpy(hc06_ptr + 1, &udp_buf->srcport, 2);
       *(hc06_ptr + 3) =
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->destport) -
+        (uint8_t)((UIP_HTONS(udp_buf->destport) -
                    SICSLOWPAN_UDP_8_BIT_PORT_MIN));
       hc06_ptr += 4;
-    } else if((UIP_HTONS(UIP_UDP_BUF->srcport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
+    } else if((UIP_HTONS(udp_buf->srcport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
       /* we can compress 8 bits of src, leave dest. Copy compressed port */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_10;
       PRINTF("IPHC: remove 8 bits of source with prefix 0xF0, leave dest. hch: %i\n", *hc06_ptr);
       *(hc06_ptr + 1) =
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->srcport) -
+        (uint8_t)((UIP_HTONS(udp_buf->srcport) -
                    SICSLOWPAN_UDP_8_BIT_PORT_MIN));
-      memcpy(hc06_ptr + 2, &UIP_UDP_BUF->destport, 2);
+      memcpy(hc06_ptr + 2, &udp_buf->destport, 2);
       hc06_ptr += 4;
     } else {
       /* we cannot compress. Copy uncompressed ports, full checksum  */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_00;
       PRINTF("IPHC: cannot compress headers\n");
-      memcpy(hc06_ptr + 1, &UIP_UDP_BUF->srcport, 4);
+      memcpy(hc06_ptr + 1, &udp_buf->srcport, 4);
       hc06_ptr += 5;
     }
     /* always inline the checksum  */
     if(1) {
-      memcpy(hc06_ptr, &UIP_UDP_BUF->udpchksum, 2);
+      memcpy(hc06_ptr, &udp_buf->udpchksum, 2);
       hc06_ptr += 2;
     }
     uncomp_hdr_len += UIP_UDPH_LEN;
@@ -953,6 +1545,18 @@ static void
 uncompress_hdr_iphc(uint8_t *buf, uint16_t ip_len)
 {
   uint8_t tmp, iphc0, iphc1;
+  /* The length of an extension header expanded from a 6LoRH */
+  uint8_t ext_len;
+  struct uip_udp_hdr *udp_buf;
+
+  ext_len = 0;
+#if SICSLOWPAN_6LORH
+  if(rpi_6lorh.present) {
+    ext_len = SICSLOWPAN_RPI_HBH_LEN;
+  }
+#endif /* SICSLOWPAN_6LORH */
+  udp_buf = (struct uip_udp_hdr *)&buf[UIP_IPH_LEN + ext_len];
+
   /* at least two byte will be used for the encoding */
   hc06_ptr = packetbuf_ptr + packetbuf_hdr_len + 2;
 
@@ -1106,43 +1710,43 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t ip_len)
       switch(*hc06_ptr & SICSLOWPAN_NHC_UDP_CS_P_11) {
       case SICSLOWPAN_NHC_UDP_CS_P_00:
 	/* 1 byte for NHC, 4 byte for ports, 2 bytes chksum */
-	memcpy(&SICSLOWPAN_UDP_BUF(buf)->srcport, hc06_ptr + 1, 2);
-	memcpy(&SICSLOWPAN_UDP_BUF(buf)->destport, hc06_ptr + 3, 2);
+	memcpy(&udp_buf->srcport, hc06_ptr + 1, 2);
+	memcpy(&udp_buf->destport, hc06_ptr + 3, 2);
 	PRINTF("IPHC: Uncompressed UDP ports (ptr+5): %x, %x\n",
-	       UIP_HTONS(SICSLOWPAN_UDP_BUF(buf)->srcport),
-	       UIP_HTONS(SICSLOWPAN_UDP_BUF(buf)->destport));
+	       UIP_HTONS(udp_buf->srcport),
+	       UIP_HTONS(udp_buf->destport));
 	hc06_ptr += 5;
 	break;
 
       case SICSLOWPAN_NHC_UDP_CS_P_01:
         /* 1 byte for NHC + source 16bit inline, dest = 0xF0 + 8 bit inline */
 	PRINTF("IPHC: Decompressing destination\n");
-	memcpy(&SICSLOWPAN_UDP_BUF(buf)->srcport, hc06_ptr + 1, 2);
-	SICSLOWPAN_UDP_BUF(buf)->destport = UIP_HTONS(SICSLOWPAN_UDP_8_BIT_PORT_MIN + (*(hc06_ptr + 3)));
+	memcpy(&udp_buf->srcport, hc06_ptr + 1, 2);
+	udp_buf->destport = UIP_HTONS(SICSLOWPAN_UDP_8_BIT_PORT_MIN + (*(hc06_ptr + 3)));
 	PRINTF("IPHC: Uncompressed UDP ports (ptr+4): %x, %x\n",
-	       UIP_HTONS(SICSLOWPAN_UDP_BUF(buf)->srcport), UIP_HTONS(SICSLOWPAN_UDP_BUF(buf)->destport));
+	       UIP_HTONS(udp_buf->srcport), UIP_HTONS(udp_buf->destport));
 	hc06_ptr += 4;
 	break;
 
       case SICSLOWPAN_NHC_UDP_CS_P_10:
         /* 1 byte for NHC + source = 0xF0 + 8bit inline, dest = 16 bit inline*/
 	PRINTF("IPHC: Decompressing source\n");
-	SICSLOWPAN_UDP_BUF(buf)->srcport = UIP_HTONS(SICSLOWPAN_UDP_8_BIT_PORT_MIN +
+	udp_buf->srcport = UIP_HTONS(SICSLOWPAN_UDP_8_BIT_PORT_MIN +
 					    (*(hc06_ptr + 1)));
-	memcpy(&SICSLOWPAN_UDP_BUF(buf)->destport, hc06_ptr + 2, 2);
+	memcpy(&udp_buf->destport, hc06_ptr + 2, 2);
 	PRINTF("IPHC: Uncompressed UDP ports (ptr+4): %x, %x\n",
-	       UIP_HTONS(SICSLOWPAN_UDP_BUF(buf)->srcport), UIP_HTONS(SICSLOWPAN_UDP_BUF(buf)->destport));
+	       UIP_HTONS(udp_buf->srcport), UIP_HTONS(udp_buf->destport));
 	hc06_ptr += 4;
 	break;
 
       case SICSLOWPAN_NHC_UDP_CS_P_11:
 	/* 1 byte for NHC, 1 byte for ports */
-	SICSLOWPAN_UDP_BUF(buf)->srcport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
+	udp_buf->srcport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
 					    (*(hc06_ptr + 1) >> 4));
-	SICSLOWPAN_UDP_BUF(buf)->destport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
+	udp_buf->destport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
 					     ((*(hc06_ptr + 1)) & 0x0F));
 	PRINTF("IPHC: Uncompressed UDP ports (ptr+2): %x, %x\n",
-	       UIP_HTONS(SICSLOWPAN_UDP_BUF(buf)->srcport), UIP_HTONS(SICSLOWPAN_UDP_BUF(buf)->destport));
+	       UIP_HTONS(udp_buf->srcport), UIP_HTONS(udp_buf->destport));
 	hc06_ptr += 2;
 	break;
 
@@ -1151,7 +1755,7 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t ip_len)
         return;
       }
       if(!checksum_compressed) { /* has_checksum, default  */
-	memcpy(&SICSLOWPAN_UDP_BUF(buf)->udpchksum, hc06_ptr, 2);
+	memcpy(&udp_buf->udpchksum, hc06_ptr, 2);
 	hc06_ptr += 2;
 	PRINTF("IPHC: sicslowpan uncompress_hdr: checksum included\n");
       } else {
@@ -1161,6 +1765,22 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t ip_len)
     }
   }
 
+#if SICSLOWPAN_6LORH
+  if(ext_len > 0) {
+    /* Expand the RPI-6LoRH into a hop-by-hop options header */
+    buf[UIP_IPH_LEN] = SICSLOWPAN_IP_BUF(buf)->proto;
+    buf[UIP_IPH_LEN + 1] = 0;
+    buf[UIP_IPH_LEN + 2] = UIP_EXT_HDR_OPT_RPL;
+    buf[UIP_IPH_LEN + 3] = 4;
+    buf[UIP_IPH_LEN + 4] = rpi_6lorh.flags;
+    buf[UIP_IPH_LEN + 5] = rpi_6lorh.instance;
+    buf[UIP_IPH_LEN + 6] = rpi_6lorh.rank >> 8;
+    buf[UIP_IPH_LEN + 7] = rpi_6lorh.rank & 0xff;
+    SICSLOWPAN_IP_BUF(buf)->proto = UIP_PROTO_HBHO;
+    uncomp_hdr_len += ext_len;
+  }
+#endif /* SICSLOWPAN_6LORH */
+
   packetbuf_hdr_len = hc06_ptr - packetbuf_ptr;
 
   /* IP length field. */
@@ -1176,8 +1796,10 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t ip_len)
   }
 
   /* length field in UDP header */
-  if(SICSLOWPAN_IP_BUF(buf)->proto == UIP_PROTO_UDP) {
-    memcpy(&SICSLOWPAN_UDP_BUF(buf)->udplen, &SICSLOWPAN_IP_BUF(buf)->len[0], 2);
+  if((ext_len > 0 ? buf[UIP_IPH_LEN] : SICSLOWPAN_IP_BUF(buf)->proto) ==
+     UIP_PROTO_UDP) {
+    udp_buf->udplen = UIP_HTONS(((SICSLOWPAN_IP_BUF(buf)->len[0] << 8) |
+                                 SICSLOWPAN_IP_BUF(buf)->len[1]) - ext_len);
   }
 
   return;
@@ -1232,12 +1854,11 @@ packet_sent(void *ptr, int status, int transmissions)
 }
 /*--------------------------------------------------------------------*/
 /**
- * \brief This function is called by the 6lowpan code to send out a
- * packet.
+ * \brief Set the link layer addresses of the packet in packetbuf.
  * \param dest the link layer destination address of the packet
  */
 static void
-send_packet(linkaddr_t *dest)
+set_packet_addrs(linkaddr_t *dest)
 {
   /* Set the link layer destination address for the packet as a
    * packetbuf attribute. The MAC layer can access the destination
@@ -1249,6 +1870,17 @@ send_packet(linkaddr_t *dest)
   /* This needs to be explicitly set here for bridge mode to work */
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER,(void*)&uip_lladdr);
 #endif
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief This function is called by the 6lowpan code to send out a
+ * packet.
+ * \param dest the link layer destination address of the packet
+ */
+static void
+send_packet(linkaddr_t *dest)
+{
+  set_packet_addrs(dest);
 
   /* Provide a callback function to receive the result of
      a packet transmission. */
@@ -1258,6 +1890,423 @@ send_packet(linkaddr_t *dest)
      watchdog know that we are still alive. */
   watchdog_periodic();
 }
+#if SICSLOWPAN_MESH
+/*--------------------------------------------------------------------*/
+/* Look up the route to dest, or a free entry if dest is linkaddr_null */
+static struct sicslowpan_mesh_route *
+mesh_route_lookup(const linkaddr_t *dest)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_MESH_ROUTES; i++) {
+    if(linkaddr_cmp(&mesh_routes[i].dest, dest)) {
+      return &mesh_routes[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+int
+sicslowpan_mesh_route_add(const linkaddr_t *dest, const linkaddr_t *next_hop)
+{
+  struct sicslowpan_mesh_route *r;
+
+  r = mesh_route_lookup(dest);
+  if(r == NULL) {
+    r = mesh_route_lookup(&linkaddr_null);
+    if(r == NULL) {
+      PRINTF("sicslowpan: mesh route table full\n");
+      return 0;
+    }
+    linkaddr_copy(&r->dest, dest);
+  }
+  linkaddr_copy(&r->next_hop, next_hop);
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_mesh_route_rm(const linkaddr_t *dest)
+{
+  struct sicslowpan_mesh_route *r;
+
+  r = mesh_route_lookup(dest);
+  if(r != NULL) {
+    linkaddr_copy(&r->dest, &linkaddr_null);
+  }
+}
+/*--------------------------------------------------------------------*/
+/** \brief Get the link-layer address an IPv6 address was formed from */
+static int
+mesh_lladdr_from_ipaddr(const uip_ipaddr_t *ipaddr, linkaddr_t *lladdr)
+{
+#if LINKADDR_SIZE == 8
+  memcpy(lladdr, &ipaddr->u8[8], LINKADDR_SIZE);
+  lladdr->u8[0] ^= 0x02;
+  return 1;
+#elif LINKADDR_SIZE == 2
+  if(ipaddr->u16[4] == 0 && ipaddr->u8[10] == 0 && ipaddr->u8[11] == 0xff &&
+     ipaddr->u8[12] == 0xfe && ipaddr->u8[13] == 0) {
+    memcpy(lladdr, &ipaddr->u8[14], LINKADDR_SIZE);
+    return 1;
+  }
+  return 0;
+#else /* LINKADDR_SIZE */
+  return 0;
+#endif /* LINKADDR_SIZE */
+}
+#if SICSLOWPAN_MESH_DS6_ROUTES
+/*--------------------------------------------------------------------*/
+/** \brief Keep the mesh routes in step with the uip-ds6 host routes */
+static void
+mesh_route_callback(int event, uip_ipaddr_t *route, uip_ipaddr_t *nexthop,
+                    int num_routes)
+{
+  const uip_lladdr_t *nh;
+  linkaddr_t dest;
+
+  if(!mesh_lladdr_from_ipaddr(route, &dest)) {
+    return;
+  }
+  if(event == UIP_DS6_NOTIFICATION_ROUTE_ADD) {
+    nh = uip_ds6_nbr_lladdr_from_ipaddr(nexthop);
+    if(nh != NULL && !linkaddr_cmp(&dest, (const linkaddr_t *)nh)) {
+      sicslowpan_mesh_route_add(&dest, (const linkaddr_t *)nh);
+    }
+  } else if(event == UIP_DS6_NOTIFICATION_ROUTE_RM) {
+    sicslowpan_mesh_route_rm(&dest);
+  }
+}
+#endif /* SICSLOWPAN_MESH_DS6_ROUTES */
+/*--------------------------------------------------------------------*/
+/** \brief Put a mesh header in front of the packet in packetbuf */
+static int
+mesh_add_hdr(const linkaddr_t *final)
+{
+  uint8_t *hdr;
+
+  if(!packetbuf_hdralloc(SICSLOWPAN_MESH_HDR_LEN)) {
+    return 0;
+  }
+  hdr = packetbuf_hdrptr();
+  hdr[0] = SICSLOWPAN_DISPATCH_MESH | SICSLOWPAN_MESH_ADDR_FLAGS |
+    SICSLOWPAN_MESH_HOPS;
+  memcpy(hdr + 1, &linkaddr_node_addr, LINKADDR_SIZE);
+  memcpy(hdr + 1 + LINKADDR_SIZE, final, LINKADDR_SIZE);
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Process the mesh header of a received frame
+ * \return Non-zero if the frame is for this node, and the mesh header
+ *         has been removed
+ *
+ * A frame for another node is forwarded to the next hop of its mesh
+ * route, or to the final destination if that is a neighbor.
+ */
+static int
+mesh_input(void)
+{
+  struct sicslowpan_mesh_route *r;
+  const linkaddr_t *next_hop;
+  linkaddr_t originator, final;
+  uint8_t *hdr;
+  uint8_t hops;
+  uint16_t len;
+
+  hdr = packetbuf_dataptr();
+  len = packetbuf_datalen();
+  if(len <= SICSLOWPAN_MESH_HDR_LEN ||
+     (hdr[0] & (SICSLOWPAN_MESH_V | SICSLOWPAN_MESH_F)) !=
+     SICSLOWPAN_MESH_ADDR_FLAGS) {
+    PRINTFI("sicslowpan input: unsupported mesh header\n");
+    return 0;
+  }
+  memcpy(&originator, hdr + 1, LINKADDR_SIZE);
+  memcpy(&final, hdr + 1 + LINKADDR_SIZE, LINKADDR_SIZE);
+
+  if(linkaddr_cmp(&final, &linkaddr_null)) {
+    PRINTFI("sicslowpan input: broadcast mesh frames are not supported\n");
+    return 0;
+  }
+  if(linkaddr_cmp(&final, &linkaddr_node_addr)) {
+    /* The compressed addresses are elided against the mesh addresses */
+    packetbuf_hdrreduce(SICSLOWPAN_MESH_HDR_LEN);
+    packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &originator);
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &final);
+    return 1;
+  }
+
+  hops = hdr[0] & SICSLOWPAN_MESH_HOPS_MASK;
+  if(hops <= 1 || linkaddr_cmp(&originator, &linkaddr_node_addr)) {
+    PRINTFI("sicslowpan input: mesh frame dropped, hops left %u\n", hops);
+    return 0;
+  }
+  r = mesh_route_lookup(&final);
+  if(r != NULL) {
+    next_hop = &r->next_hop;
+  } else if(uip_ds6_nbr_ll_lookup((const uip_lladdr_t *)&final) != NULL) {
+    next_hop = &final;
+  } else {
+    PRINTFI("sicslowpan input: no mesh route, frame dropped\n");
+    return 0;
+  }
+
+  /* The incoming frame is copied out of packetbuf so that packetbuf
+     can be cleared of the attributes of the received frame. */
+  memcpy(UIP_IP_BUF, hdr, len);
+  ((uint8_t *)UIP_IP_BUF)[0] = (hdr[0] & ~SICSLOWPAN_MESH_HOPS_MASK) | (hops - 1);
+  packetbuf_clear();
+  packetbuf_copyfrom(UIP_IP_BUF, len);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  PRINTFI("sicslowpan input: forwarding mesh frame, hops left %u\n", hops - 1);
+  send_packet((linkaddr_t *)next_hop);
+  return 0;
+}
+#endif /* SICSLOWPAN_MESH */
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/** \brief Free a fragment batch and the fragments it has not sent */
+static void
+batch_free(struct frag_batch *batch)
+{
+#if SICSLOWPAN_FRAG_RECOVERY
+  /* The sent fragments are kept until they are acknowledged */
+  ctimer_stop(&batch->ack_timer);
+  list_remove(frag_batch_list, batch);
+  batch->next = 0;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+  while(batch->next < batch->count) {
+    queuebuf_free(batch->frags[batch->next++]);
+  }
+  memb_free(&frag_batch_memb, batch);
+}
+/*--------------------------------------------------------------------*/
+/** \brief Add the fragment in packetbuf to a batch
+ *  \return 1 if the fragment was added, 0 if there was no room
+ */
+static int
+batch_add(struct frag_batch *batch)
+{
+  struct queuebuf *q;
+
+  if(batch->count >= SICSLOWPAN_FRAG_BATCH_LEN) {
+    return 0;
+  }
+  q = queuebuf_new_from_packetbuf();
+  if(q == NULL) {
+    return 0;
+  }
+  batch->frags[batch->count++] = q;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Report the outcome of a datagram and free its batch */
+static void
+batch_done(struct frag_batch *batch, int status)
+{
+  if(callback != NULL) {
+    callback->output_callback(status);
+  }
+  last_tx_status = status;
+  batch_free(batch);
+}
+/*--------------------------------------------------------------------*/
+static void batch_send_next(struct frag_batch *batch);
+#if SICSLOWPAN_FRAG_RECOVERY
+/*--------------------------------------------------------------------*/
+/** \brief Check whether all the fragments of a batch are acknowledged */
+static int
+batch_acked(struct frag_batch *batch)
+{
+  int i;
+
+  for(i = 0; i < batch->count; i++) {
+    if(!batch->acked[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Skip to the next fragment to send in this round
+ * \return Zero if the round is over
+ *
+ * The fragments that are not acknowledged are sent, and the last
+ * fragment always, as it requests a FRAG_ACK.
+ */
+static int
+batch_find_next(struct frag_batch *batch)
+{
+  while(batch->next < batch->count - 1 && batch->acked[batch->next]) {
+    batch->next++;
+  }
+  return batch->next < batch->count;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Send the fragments of a batch that are missing again */
+static void
+batch_retry(void *ptr)
+{
+  struct frag_batch *batch = ptr;
+
+  ctimer_stop(&batch->ack_timer);
+  if(batch->retries >= SICSLOWPAN_FRAG_RETRIES) {
+    PRINTFO("sicslowpan: fragments of tag %u not acknowledged, dropping\n",
+            batch->tag);
+    batch_done(batch, MAC_TX_NOACK);
+    return;
+  }
+  batch->retries++;
+  batch->next = 0;
+  batch_find_next(batch);
+  batch_send_next(batch);
+}
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+/*--------------------------------------------------------------------*/
+/**
+ * Callback function for the MAC packet sent callback of a fragment.
+ * The next fragment of the batch is sent if this one was, and the
+ * datagram is reported as sent or failed when it is done.
+ */
+static void
+fragment_sent(void *ptr, int status, int transmissions)
+{
+  struct frag_batch *batch = ptr;
+
+  uip_ds6_link_neighbor_callback(status, transmissions);
+
+#if SICSLOWPAN_FRAG_RECOVERY
+  /* A fragment that is lost is sent again when the receiver reports it
+     missing, so the round goes on unless the MAC cannot send at all */
+  batch->sending = 0;
+  if(linkaddr_cmp(&batch->dest, &linkaddr_null)) {
+    /* Broadcast fragments are not acknowledged, and are sent once */
+    batch->acked[batch->next - 1] = 1;
+  }
+  if(status == MAC_TX_ERR_FATAL) {
+    batch_done(batch, status);
+  } else if(batch_acked(batch)) {
+    batch_done(batch, MAC_TX_OK);
+  } else if(batch_find_next(batch)) {
+    batch_send_next(batch);
+  } else {
+    ctimer_set(&batch->ack_timer, SICSLOWPAN_FRAG_ACK_TIMEOUT,
+               batch_retry, batch);
+  }
+#else /* SICSLOWPAN_FRAG_RECOVERY */
+  if(status == MAC_TX_OK && batch->next < batch->count) {
+    batch_send_next(batch);
+    return;
+  }
+
+  if(status != MAC_TX_OK) {
+    PRINTFO("sicslowpan: fragment %u not sent (status %d), dropping %u more\n",
+            batch->next, status, batch->count - batch->next);
+  }
+  batch_done(batch, status);
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+}
+/*--------------------------------------------------------------------*/
+/** \brief Hand the next fragment of a batch to the MAC */
+static void
+batch_send_next(struct frag_batch *batch)
+{
+  struct queuebuf *q;
+
+  q = batch->frags[batch->next++];
+  queuebuf_to_packetbuf(q);
+#if SICSLOWPAN_FRAG_RECOVERY
+  batch->sending = 1;
+#else /* SICSLOWPAN_FRAG_RECOVERY */
+  queuebuf_free(q);
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+  NETSTACK_LLSEC.send(&fragment_sent, batch);
+  watchdog_periodic();
+}
+#if SICSLOWPAN_FRAG_RECOVERY
+/*--------------------------------------------------------------------*/
+/** \brief Process a FRAG_ACK for a datagram that this node has sent */
+static void
+frag_ack_input(void)
+{
+  struct frag_batch *batch;
+  uint8_t *bitmap;
+  uint16_t tag;
+  int bitmap_len;
+  int i;
+
+  if(packetbuf_datalen() < SICSLOWPAN_FRAG_ACK_HDR_LEN) {
+    return;
+  }
+  tag = GET16(PACKETBUF_FRAG_PTR, 1);
+  bitmap = PACKETBUF_FRAG_PTR + SICSLOWPAN_FRAG_ACK_HDR_LEN;
+  bitmap_len = packetbuf_datalen() - SICSLOWPAN_FRAG_ACK_HDR_LEN;
+
+  for(batch = list_head(frag_batch_list);
+      batch != NULL;
+      batch = list_item_next(batch)) {
+    if(batch->tag == tag &&
+       linkaddr_cmp(&batch->dest, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+      break;
+    }
+  }
+  if(batch == NULL) {
+    PRINTFI("sicslowpan: FRAG_ACK for unknown tag %u\n", tag);
+    return;
+  }
+
+  for(i = 0; i < batch->count; i++) {
+    if((batch->offsets[i] >> 3) < bitmap_len &&
+       (bitmap[batch->offsets[i] >> 3] & (0x80 >> (batch->offsets[i] & 7)))) {
+      batch->acked[i] = 1;
+    }
+  }
+  PRINTFI("sicslowpan: FRAG_ACK for tag %u, all acked %d\n",
+          tag, batch_acked(batch));
+
+  if(batch->sending) {
+    /* The round goes on, and ends with a new request */
+    return;
+  }
+  if(batch_acked(batch)) {
+    batch_done(batch, MAC_TX_OK);
+  } else {
+    batch_retry(batch);
+  }
+}
+/*--------------------------------------------------------------------*/
+/** \brief Send the FRAG_ACK that input() has prepared */
+static void
+frag_ack_send(void)
+{
+  PRINTFI("sicslowpan: sending FRAG_ACK for tag %u\n", frag_ack.tag);
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_ptr[0] = SICSLOWPAN_DISPATCH_FRAG_ACK;
+  SET16(packetbuf_ptr, 1, frag_ack.tag);
+  memcpy(packetbuf_ptr + SICSLOWPAN_FRAG_ACK_HDR_LEN, frag_ack.bitmap,
+         frag_ack.len);
+  packetbuf_set_datalen(SICSLOWPAN_FRAG_ACK_HDR_LEN + frag_ack.len);
+  frag_ack.len = 0;
+#if SICSLOWPAN_MESH
+  {
+    struct sicslowpan_mesh_route *r;
+
+    r = mesh_route_lookup(&frag_ack.dest);
+    if(r != NULL && mesh_add_hdr(&frag_ack.dest)) {
+      set_packet_addrs(&r->next_hop);
+      NETSTACK_LLSEC.send(NULL, NULL);
+      return;
+    }
+  }
+#endif /* SICSLOWPAN_MESH */
+  set_packet_addrs(&frag_ack.dest);
+  NETSTACK_LLSEC.send(NULL, NULL);
+}
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+#endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
  *  network using 6lowpan.
@@ -1276,6 +2325,12 @@ output(const uip_lladdr_t *localdest)
 
   /* The MAC address of the destination of the packet */
   linkaddr_t dest;
+  /* The MAC address the frames are sent to */
+  linkaddr_t *next_hop;
+#if SICSLOWPAN_MESH
+  struct sicslowpan_mesh_route *mesh_route;
+  int mesh_hdr_len;
+#endif /* SICSLOWPAN_MESH */
 
 #if SICSLOWPAN_CONF_FRAG
   /* Number of bytes processed. */
@@ -1292,6 +2347,8 @@ output(const uip_lladdr_t *localdest)
 
   packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
                      SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  /* The protocol lets the MAC layer prioritize control traffic */
+  packetbuf_set_attr(PACKETBUF_ATTR_NETWORK_ID, UIP_IP_BUF->proto);
 
   if(callback) {
     /* call the attribution when the callback comes, but set attributes
@@ -1326,6 +2383,33 @@ output(const uip_lladdr_t *localdest)
   } else {
     linkaddr_copy(&dest, (const linkaddr_t *)localdest);
   }
+  next_hop = &dest;
+
+#if SICSLOWPAN_MESH
+  /* A packet is sent mesh-under if there is a mesh route to the node
+     of its IPv6 destination, which uIP may reach route-over, or to its
+     link-layer destination */
+  mesh_hdr_len = 0;
+  mesh_route = NULL;
+  if(localdest != NULL) {
+    linkaddr_t final;
+
+    if(mesh_lladdr_from_ipaddr(&UIP_IP_BUF->destipaddr, &final) &&
+       !linkaddr_cmp(&final, &linkaddr_null)) {
+      mesh_route = mesh_route_lookup(&final);
+    }
+    if(mesh_route != NULL) {
+      linkaddr_copy(&dest, &final);
+    } else {
+      mesh_route = mesh_route_lookup(&dest);
+    }
+  }
+  if(mesh_route != NULL) {
+    next_hop = &mesh_route->next_hop;
+    mesh_hdr_len = SICSLOWPAN_MESH_HDR_LEN;
+    PRINTFO("sicslowpan output: mesh-under via %02x\n", next_hop->u8[LINKADDR_SIZE - 1]);
+  }
+#endif /* SICSLOWPAN_MESH */
 
   PRINTFO("sicslowpan output: sending packet len %d\n", uip_len);
 
@@ -1347,7 +2431,7 @@ output(const uip_lladdr_t *localdest)
    * needs to be fragmented or not. */
 #define USE_FRAMER_HDRLEN 1
 #if USE_FRAMER_HDRLEN
-  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, next_hop);
   framer_hdrlen = NETSTACK_FRAMER.length();
   if(framer_hdrlen < 0) {
     /* Framing failed, we assume the maximum header length */
@@ -1358,9 +2442,14 @@ output(const uip_lladdr_t *localdest)
 #endif /* USE_FRAMER_HDRLEN */
 
   max_payload = MAC_MAX_PAYLOAD - framer_hdrlen;
+#if SICSLOWPAN_MESH
+  max_payload -= mesh_hdr_len;
+#endif /* SICSLOWPAN_MESH */
   if((int)uip_len - (int)uncomp_hdr_len > max_payload - (int)packetbuf_hdr_len) {
 #if SICSLOWPAN_CONF_FRAG
-    struct queuebuf *q;
+    struct frag_batch *batch;
+    struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+    struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
     uint16_t frag_tag;
 
     /*
@@ -1380,12 +2469,17 @@ output(const uip_lladdr_t *localdest)
 
     PRINTFO("Fragmentation sending packet len %d\n", uip_len);
 
+    batch = memb_alloc(&frag_batch_memb);
+    if(batch == NULL) {
+      PRINTFO("Dropping packet, no free fragment batch\n");
+      return 0;
+    }
+    batch->count = 0;
+    batch->next = 0;
+
     /* Create 1st Fragment */
     PRINTFO("sicslowpan output: 1rst fragment ");
 
-    /* Reset last tx status to ok in case the fragment transmissions are deferred */
-    last_tx_status = MAC_TX_OK;
-
     /* move IPHC/IPv6 header */
     memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
 
@@ -1400,50 +2494,55 @@ output(const uip_lladdr_t *localdest)
     frag_tag = my_tag++;
     SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
 
-    /* Copy payload and send */
+    /* Copy payload and queue */
     packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
     packetbuf_payload_len = (max_payload - packetbuf_hdr_len) & 0xfffffff8;
     PRINTFO("(len %d, tag %d)\n", packetbuf_payload_len, frag_tag);
     memcpy(packetbuf_ptr + packetbuf_hdr_len,
            (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, packetbuf_payload_len);
     packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
-    q = queuebuf_new_from_packetbuf();
-    if(q == NULL) {
-      PRINTFO("could not allocate queuebuf for first fragment, dropping packet\n");
+    set_packet_addrs(next_hop);
+#if SICSLOWPAN_MESH
+    if(mesh_hdr_len > 0 && !mesh_add_hdr(&dest)) {
+      batch_free(batch);
       return 0;
     }
-    send_packet(&dest);
-    queuebuf_to_packetbuf(q);
-    queuebuf_free(q);
-    q = NULL;
-
-    /* Check tx result. */
-    if((last_tx_status == MAC_TX_COLLISION) ||
-       (last_tx_status == MAC_TX_ERR) ||
-       (last_tx_status == MAC_TX_ERR_FATAL)) {
-      PRINTFO("error in fragment tx, dropping subsequent fragments.\n");
+#endif /* SICSLOWPAN_MESH */
+    if(!batch_add(batch)) {
+      PRINTFO("could not allocate queuebuf for first fragment, dropping packet\n");
+      batch_free(batch);
       return 0;
     }
+#if SICSLOWPAN_FRAG_RECOVERY
+    batch->offsets[0] = 0;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
 
     /* set processed_ip_out_len to what we already sent from the IP payload*/
     processed_ip_out_len = packetbuf_payload_len + uncomp_hdr_len;
 
     /*
      * Create following fragments
-     * Datagram tag is already in the buffer, we need to set the
-     * FRAGN dispatch and for each fragment, the offset
+     * The tag is the same as in the first fragment. For each fragment,
+     * we need to set the FRAGN dispatch and the offset
      */
     packetbuf_hdr_len = SICSLOWPAN_FRAGN_HDR_LEN;
-/*     PACKETBUF_FRAG_BUF->dispatch_size = */
-/*       uip_htons((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len); */
-    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
-          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
     packetbuf_payload_len = (max_payload - packetbuf_hdr_len) & 0xfffffff8;
     while(processed_ip_out_len < uip_len) {
       PRINTFO("sicslowpan output: fragment ");
+      /* The queued fragment may share its bytes with the packetbuf, so
+         each fragment is written to a cleared packetbuf. */
+      packetbuf_attr_copyto(attrs, addrs);
+      packetbuf_clear();
+      packetbuf_attr_copyfrom(attrs, addrs);
+      packetbuf_ptr = packetbuf_dataptr();
+/*     PACKETBUF_FRAG_BUF->dispatch_size = */
+/*       uip_htons((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len); */
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+            ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
       PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = processed_ip_out_len >> 3;
 
-      /* Copy payload and send */
+      /* Copy payload and queue */
       if(uip_len - processed_ip_out_len < packetbuf_payload_len) {
         /* last fragment */
         packetbuf_payload_len = uip_len - processed_ip_out_len;
@@ -1453,24 +2552,42 @@ output(const uip_lladdr_t *localdest)
       memcpy(packetbuf_ptr + packetbuf_hdr_len,
              (uint8_t *)UIP_IP_BUF + processed_ip_out_len, packetbuf_payload_len);
       packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
-      q = queuebuf_new_from_packetbuf();
-      if(q == NULL) {
-        PRINTFO("could not allocate queuebuf, dropping fragment\n");
+#if SICSLOWPAN_MESH
+      if(mesh_hdr_len > 0 && !mesh_add_hdr(&dest)) {
+        batch_free(batch);
         return 0;
       }
-      send_packet(&dest);
-      queuebuf_to_packetbuf(q);
-      queuebuf_free(q);
-      q = NULL;
-      processed_ip_out_len += packetbuf_payload_len;
-
-      /* Check tx result. */
-      if((last_tx_status == MAC_TX_COLLISION) ||
-         (last_tx_status == MAC_TX_ERR) ||
-         (last_tx_status == MAC_TX_ERR_FATAL)) {
-        PRINTFO("error in fragment tx, dropping subsequent fragments.\n");
+#endif /* SICSLOWPAN_MESH */
+      if(!batch_add(batch)) {
+        PRINTFO("could not allocate queuebuf, dropping packet\n");
+        batch_free(batch);
         return 0;
       }
+#if SICSLOWPAN_FRAG_RECOVERY
+      batch->offsets[batch->count - 1] = processed_ip_out_len >> 3;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+      processed_ip_out_len += packetbuf_payload_len;
+    }
+
+#if SICSLOWPAN_FRAG_RECOVERY
+    /* The batch is kept until the receiver has acknowledged it */
+    linkaddr_copy(&batch->dest, &dest);
+    batch->tag = frag_tag;
+    batch->retries = 0;
+    memset(batch->acked, 0, sizeof(batch->acked));
+    list_add(frag_batch_list, batch);
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
+    /* Reset last tx status to ok in case the fragment transmissions are deferred */
+    last_tx_status = MAC_TX_OK;
+
+    /* The batch is freed when its last fragment has been sent, which
+       may happen before batch_send_next() returns. */
+    batch_send_next(batch);
+    if((last_tx_status == MAC_TX_COLLISION) ||
+       (last_tx_status == MAC_TX_ERR) ||
+       (last_tx_status == MAC_TX_ERR_FATAL)) {
+      return 0;
     }
 #else /* SICSLOWPAN_CONF_FRAG */
     PRINTFO("sicslowpan output: Packet too large to be sent without fragmentation support; dropping packet\n");
@@ -1485,11 +2602,225 @@ output(const uip_lladdr_t *localdest)
     memcpy(packetbuf_ptr + packetbuf_hdr_len, (uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
            uip_len - uncomp_hdr_len);
     packetbuf_set_datalen(uip_len - uncomp_hdr_len + packetbuf_hdr_len);
-    send_packet(&dest);
+#if SICSLOWPAN_MESH
+    if(mesh_hdr_len > 0 && !mesh_add_hdr(&dest)) {
+      return 0;
+    }
+#endif /* SICSLOWPAN_MESH */
+    send_packet(next_hop);
+  }
+  return 1;
+}
+
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Look up the link-layer next hop of a datagram that this node
+ * should forward fragment by fragment.
+ * \param ip the uncompressed IPv6 header of the datagram
+ * \param next_hop set to the link-layer address of the next hop
+ * \return 1 if the fragments can be forwarded, 0 if the datagram
+ * has to be reassembled
+ *
+ * Datagrams for this node, multicast datagrams, datagrams with a
+ * hop-by-hop options header, and datagrams whose hop limit would
+ * expire are reassembled and handed to the IP layer as usual.
+ */
+static int
+vrb_next_hop(struct uip_ip_hdr *ip, linkaddr_t *next_hop)
+{
+  uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+  const uip_lladdr_t *lladdr;
+
+  if(uip_is_addr_mcast(&ip->destipaddr) ||
+     uip_ds6_is_my_addr(&ip->destipaddr) ||
+     ip->proto == UIP_PROTO_HBHO || ip->ttl <= 1) {
+    return 0;
+  }
+
+  if(uip_ds6_is_addr_onlink(&ip->destipaddr)) {
+    nexthop = &ip->destipaddr;
+  } else {
+    route = uip_ds6_route_lookup(&ip->destipaddr);
+    if(route != NULL) {
+      nexthop = uip_ds6_route_nexthop(route);
+    } else {
+      nexthop = uip_ds6_defrt_choose();
+    }
+  }
+  if(nexthop == NULL) {
+    return 0;
   }
+
+  lladdr = uip_ds6_nbr_lladdr_from_ipaddr(nexthop);
+  if(lladdr == NULL) {
+    return 0;
+  }
+  linkaddr_copy(next_hop, (const linkaddr_t *)lladdr);
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+static struct sicslowpan_vrb *
+vrb_lookup(const linkaddr_t *sender, uint16_t tag)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb[i].len > 0 && vrb[i].tag == tag &&
+       linkaddr_cmp(&vrb[i].sender, sender)) {
+      if(timer_expired(&vrb[i].timer)) {
+        vrb[i].len = 0;
+        return NULL;
+      }
+      return &vrb[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+static struct sicslowpan_vrb *
+vrb_alloc(void)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb[i].len == 0 || timer_expired(&vrb[i].timer)) {
+      vrb[i].len = 0;
+      return &vrb[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward the first fragment of a datagram that is not for
+ * this node, and set up a virtual reassembly buffer for the rest.
+ * \param context the reassembly context holding the first fragment,
+ * with its IPv6 header uncompressed
+ * \return 1 if the fragment was forwarded, 0 if the datagram has to
+ * be reassembled
+ *
+ * The header is compressed again for the next hop, so the first
+ * fragment may change length, but it still covers the same bytes of
+ * the datagram and the following fragments are forwarded unchanged
+ * but for their tag. Any following fragments that arrived before the
+ * first one are dropped.
+ */
+static int
+vrb_forward_first(int8_t context)
+{
+  struct sicslowpan_vrb *v;
+  linkaddr_t next_hop;
+  uint16_t first_frag_len;
+  int framer_hdrlen;
+  int payload_len;
+
+  memcpy(UIP_IP_BUF, FIRST_FRAG_DATA(context),
+         frag_info[context].first_frag_len);
+  if(!vrb_next_hop(UIP_IP_BUF, &next_hop)) {
+    return 0;
+  }
+  /* A repeated first fragment is forwarded with the same tag */
+  v = vrb_lookup(&frag_info[context].sender, frag_info[context].tag);
+  if(v == NULL) {
+    v = vrb_alloc();
+  }
+  if(v == NULL) {
+    PRINTFI("sicslowpan input: no free VRB entry, reassembling\n");
+    return 0;
+  }
+  if(v->len == 0) {
+    v->out_tag = my_tag++;
+  }
+  UIP_IP_BUF->ttl--;
+  first_frag_len = frag_info[context].first_frag_len;
+
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_hdr_len = 0;
+  uncomp_hdr_len = 0;
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+  compress_hdr_iphc(&next_hop);
+#else /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+  compress_hdr_ipv6(&next_hop);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &next_hop);
+  framer_hdrlen = NETSTACK_FRAMER.length();
+  if(framer_hdrlen < 0) {
+    framer_hdrlen = 21;
+  }
+  payload_len = first_frag_len - uncomp_hdr_len;
+  if(payload_len < 0 ||
+     SICSLOWPAN_FRAG1_HDR_LEN + packetbuf_hdr_len + payload_len >
+     MAC_MAX_PAYLOAD - framer_hdrlen) {
+    PRINTFI("sicslowpan input: first fragment does not fit, reassembling\n");
+    return 0;
+  }
+
+  linkaddr_copy(&v->sender, &frag_info[context].sender);
+  linkaddr_copy(&v->next_hop, &next_hop);
+  v->tag = frag_info[context].tag;
+  v->len = frag_info[context].len;
+  v->forwarded_len = first_frag_len;
+  timer_set(&v->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+
+  /* The datagram is forwarded: the reassembly context is not needed */
+  clear_fragments(context);
+
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr,
+          packetbuf_hdr_len);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | v->len));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, v->out_tag);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  memcpy(packetbuf_ptr + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, payload_len);
+  packetbuf_set_datalen(packetbuf_hdr_len + payload_len);
+
+  PRINTFI("sicslowpan input: forwarding FRAG1 tag %d as tag %d\n",
+          v->tag, v->out_tag);
+  send_packet(&next_hop);
   return 1;
 }
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward a following fragment through its virtual reassembly
+ * buffer, rewriting only its tag.
+ * \param v the virtual reassembly buffer entry of the datagram
+ */
+static void
+vrb_forward_next(struct sicslowpan_vrb *v)
+{
+  uint16_t len;
+
+  len = packetbuf_datalen();
+  if(len < SICSLOWPAN_FRAGN_HDR_LEN) {
+    return;
+  }
+  /* The incoming frame is copied out of packetbuf so that packetbuf
+     can be cleared of the attributes of the received frame. */
+  memcpy(UIP_IP_BUF, packetbuf_ptr, len);
+  SET16((uint8_t *)UIP_IP_BUF, PACKETBUF_FRAG_TAG, v->out_tag);
+
+  v->forwarded_len += len - SICSLOWPAN_FRAGN_HDR_LEN;
+  if(v->forwarded_len >= v->len) {
+    /* This was the last fragment */
+    v->len = 0;
+  }
 
+  packetbuf_clear();
+  packetbuf_copyfrom(UIP_IP_BUF, len);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  PRINTFI("sicslowpan input: forwarding FRAGN tag %d as tag %d\n",
+          v->tag, v->out_tag);
+  send_packet(&v->next_hop);
+}
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *
@@ -1518,6 +2849,9 @@ input(void)
   /* tag of the fragment */
   uint16_t frag_tag = 0;
   uint8_t first_fragment = 0, last_fragment = 0;
+#if SICSLOWPAN_FRAG_FORWARDING
+  struct sicslowpan_vrb *v;
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* init */
@@ -1527,6 +2861,23 @@ input(void)
   /* The MAC puts the 15.4 payload inside the packetbuf data buffer */
   packetbuf_ptr = packetbuf_dataptr();
 
+#if SICSLOWPAN_MESH
+  if((packetbuf_ptr[0] & SICSLOWPAN_MESH_MASK) == SICSLOWPAN_DISPATCH_MESH) {
+    if(!mesh_input()) {
+      return;
+    }
+    packetbuf_ptr = packetbuf_dataptr();
+  }
+#endif /* SICSLOWPAN_MESH */
+
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY
+  frag_ack.len = 0;
+  if(PACKETBUF_FRAG_PTR[0] == SICSLOWPAN_DISPATCH_FRAG_ACK) {
+    frag_ack_input();
+    return;
+  }
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY */
+
   /* This is default uip_buf since we assume that this is not fragmented */
   buffer = (uint8_t *)UIP_IP_BUF;
 
@@ -1537,8 +2888,9 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
 
   /*
-   * Since we don't support the mesh and broadcast header, the first header
-   * we look for is the fragmentation header
+   * Since we don't support the broadcast header, and the mesh header
+   * has been removed, the first header we look for is the fragmentation
+   * header
    */
   switch((GET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE) & 0xf800) >> 8) {
     case SICSLOWPAN_DISPATCH_FRAG1:
@@ -1562,7 +2914,11 @@ input(void)
         return;
       }
 
+#if !SICSLOWPAN_FRAG_PKTMEM
+      /* With the packet memory, the first fragment is uncompressed in
+         uip_buf and stored once its length is known */
       buffer = frag_info[frag_context].first_frag;
+#endif /* !SICSLOWPAN_FRAG_PKTMEM */
 
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
@@ -1578,6 +2934,16 @@ input(void)
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
 
+#if SICSLOWPAN_FRAG_FORWARDING
+      /* Fragments of a datagram that is being forwarded are sent on
+         at once */
+      v = vrb_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER), frag_tag);
+      if(v != NULL) {
+        vrb_forward_next(v);
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       /* If this is the last fragment, we may shave off any extrenous
          bytes at the end. We must be liberal in what we accept. */
       PRINTFI("last_fragment?: packetbuf_payload_len %d frag_size %d\n",
@@ -1588,6 +2954,17 @@ input(void)
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
 
       if(frag_context == -1) {
+#if SICSLOWPAN_FRAG_RECOVERY
+        if(frag_done.len > 0 && frag_done.tag == frag_tag &&
+           linkaddr_cmp(&frag_done.sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+          /* The sender has not heard that the datagram is complete */
+          linkaddr_copy(&frag_ack.dest, &frag_done.sender);
+          frag_ack.tag = frag_done.tag;
+          frag_ack.len = (frag_done.len + 63) / 64;
+          memset(frag_ack.bitmap, 0xff, frag_ack.len);
+          frag_ack_send();
+        }
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
         return;
       }
 
@@ -1599,6 +2976,21 @@ input(void)
         last_fragment = 1;
       }
       is_fragment = 1;
+
+#if SICSLOWPAN_FRAG_RECOVERY
+      /* The fragment that ends the datagram requests a FRAG_ACK, which
+         is also sent when the datagram is complete */
+      if(!linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &linkaddr_null) &&
+         (last_fragment ||
+          (frag_offset << 3) + packetbuf_datalen() - packetbuf_hdr_len >= frag_size)) {
+        frag_ack_prepare(frag_context);
+      }
+      if(last_fragment) {
+        linkaddr_copy(&frag_done.sender, &frag_info[frag_context].sender);
+        frag_done.tag = frag_tag;
+        frag_done.len = frag_size;
+      }
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
       break;
     default:
       break;
@@ -1612,6 +3004,15 @@ input(void)
 
   /* Process next dispatch and headers */
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+#if SICSLOWPAN_6LORH
+  rpi_6lorh.present = 0;
+  if(PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH] == SICSLOWPAN_DISPATCH_PAGE_1) {
+    PRINTFI("sicslowpan input: page 1\n");
+    if(!uncompress_6lorh()) {
+      return;
+    }
+  }
+#endif /* SICSLOWPAN_6LORH */
   if((PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH] & 0xe0) == SICSLOWPAN_DISPATCH_IPHC) {
     PRINTFI("sicslowpan input: IPHC\n");
     uncompress_hdr_iphc(buffer, frag_size);
@@ -1679,7 +3080,26 @@ input(void)
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
       frag_info[frag_context].reassembled_len = uncomp_hdr_len + packetbuf_payload_len;
+#if SICSLOWPAN_FRAG_PKTMEM
+      if(!pktmem_alloc(&sicslowpan_frags, &frag_info[frag_context].first_frag,
+                       uncomp_hdr_len + packetbuf_payload_len) &&
+         (timeout_fragments(frag_context) == 0 ||
+          !pktmem_alloc(&sicslowpan_frags, &frag_info[frag_context].first_frag,
+                        uncomp_hdr_len + packetbuf_payload_len))) {
+        PRINTF("*** Failed to store first fragment - tag: %d\n", frag_tag);
+        SICSLOWPAN_FRAG_STAT(sicslowpan_frag_stats.no_buffer++);
+        clear_fragments(frag_context);
+        return;
+      }
+      memcpy(MMEM_PTR(&frag_info[frag_context].first_frag), buffer,
+             uncomp_hdr_len + packetbuf_payload_len);
+#endif /* SICSLOWPAN_FRAG_PKTMEM */
       frag_info[frag_context].first_frag_len = uncomp_hdr_len + packetbuf_payload_len;
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(vrb_forward_first(frag_context)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
     }
     /* For the last fragment, we are OK if there is extrenous bytes at
        the end of the packet. */
@@ -1687,6 +3107,7 @@ input(void)
       frag_info[frag_context].reassembled_len = frag_size;
       /* copy to uip */
       copy_frags2uip(frag_context);
+      SICSLOWPAN_FRAG_STAT(sicslowpan_frag_stats.reassembled++);
     }
   }
 
@@ -1729,6 +3150,12 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   }
 #endif /* SICSLOWPAN_CONF_FRAG */
+
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY
+  if(frag_ack.len > 0) {
+    frag_ack_send();
+  }
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY */
 }
 /** @} */
 
@@ -1745,6 +3172,21 @@ sicslowpan_init(void)
 
   tcpip_set_outputfunc(output);
 
+#if SICSLOWPAN_MESH && SICSLOWPAN_MESH_DS6_ROUTES
+  uip_ds6_notification_add(&mesh_notification, mesh_route_callback);
+#endif /* SICSLOWPAN_MESH && SICSLOWPAN_MESH_DS6_ROUTES */
+
+#if SICSLOWPAN_CONF_FRAG
+  memb_init(&frag_batch_memb);
+#if SICSLOWPAN_FRAG_RECOVERY
+  list_init(frag_batch_list);
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+#endif /* SICSLOWPAN_CONF_FRAG */
+
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_PKTMEM
+  pktmem_register(&sicslowpan_frags);
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_PKTMEM */
+
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
 /* Preinitialize any address contexts for better header compression
  * (Saves up to 13 bytes per 6lowpan packet)
@@ -1787,6 +3229,7 @@ sicslowpan_init(void)
   }
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1 */
 
+  sicslowpan_flush_iphc_cache();
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
 }
 /*--------------------------------------------------------------------*/
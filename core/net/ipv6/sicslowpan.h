@@ -80,8 +80,35 @@
 #define SICSLOWPAN_DISPATCH_IPV6                    0x41 /* 01000001 = 65 */
 #define SICSLOWPAN_DISPATCH_HC1                     0x42 /* 01000010 = 66 */
 #define SICSLOWPAN_DISPATCH_IPHC                    0x60 /* 011xxxxx = ... */
+#define SICSLOWPAN_DISPATCH_MESH                    0x80 /* 10xxxxxx */
 #define SICSLOWPAN_DISPATCH_FRAG1                   0xc0 /* 11000xxx */
 #define SICSLOWPAN_DISPATCH_FRAGN                   0xe0 /* 11100xxx */
+#define SICSLOWPAN_DISPATCH_FRAG_ACK                0xea /* 11101010 */
+#define SICSLOWPAN_DISPATCH_PAGE_1                  0xf1 /* 11110001 */
+/** @} */
+
+/**
+ * \name Mesh header (RFC 4944) fields
+ * @{
+ */
+#define SICSLOWPAN_MESH_MASK                        0xc0
+#define SICSLOWPAN_MESH_V                           0x20 /* short originator */
+#define SICSLOWPAN_MESH_F                           0x10 /* short final */
+#define SICSLOWPAN_MESH_HOPS_MASK                   0x0f
+/** @} */
+
+/**
+ * \name 6LoWPAN routing header (6LoRH, RFC 8138) encoding, in page 1
+ * @{
+ */
+#define SICSLOWPAN_6LORH_MASK                       0xc0
+#define SICSLOWPAN_6LORH_DISPATCH                   0x80 /* 10xxxxxx */
+#define SICSLOWPAN_6LORH_ELECTIVE                   0x20 /* 101xxxxx */
+#define SICSLOWPAN_6LORH_LEN_MASK                   0x1f
+#define SICSLOWPAN_6LORH_TYPE_RPI                   5
+#define SICSLOWPAN_6LORH_RPI_ORF                    0x1c
+#define SICSLOWPAN_6LORH_RPI_I                      0x02
+#define SICSLOWPAN_6LORH_RPI_K                      0x01
 /** @} */
 
 /** \name HC1 encoding
@@ -175,6 +202,7 @@
 #define SICSLOWPAN_HC1_HC_UDP_HDR_LEN               7
 #define SICSLOWPAN_FRAG1_HDR_LEN                    4
 #define SICSLOWPAN_FRAGN_HDR_LEN                    5
+#define SICSLOWPAN_FRAG_ACK_HDR_LEN                 3
 /** @} */
 
 /**
@@ -239,10 +267,8 @@ struct sicslowpan_addr_context {
  */
 #define sicslowpan_is_iid_16_bit_compressable(a) \
   ((((a)->u16[4]) == 0) &&                       \
-   (((a)->u8[10]) == 0)&&			    \
-   (((a)->u8[11]) == 0xff)&&			    \
-   (((a)->u8[12]) == 0xfe)&&			    \
-   (((a)->u8[13]) == 0))
+   (((a)->u16[5]) == UIP_HTONS(0x00ff)) &&       \
+   (((a)->u16[6]) == UIP_HTONS(0xfe00)))
 
 /**
  * \brief check whether the 9-bit group-id of the
@@ -321,6 +347,57 @@ struct sicslowpan_nh_compressor {
 
 int sicslowpan_get_last_rssi(void);
 
+/**
+ * Forget the cached IPHC address encodings. This must be called when
+ * the compression contexts or the link-layer address of this node
+ * change at run time.
+ */
+void sicslowpan_flush_iphc_cache(void);
+
+/**
+ * Add or update a mesh-under route. With SICSLOWPAN_CONF_MESH, frames
+ * for the link-layer address dest are sent to next_hop with a mesh
+ * header, and the relays forward them without passing them up to IPv6.
+ *
+ * \return Non-zero if the route was added, zero if the table is full.
+ */
+int sicslowpan_mesh_route_add(const linkaddr_t *dest,
+                              const linkaddr_t *next_hop);
+
+/**
+ * Remove the mesh-under route to a link-layer address.
+ */
+void sicslowpan_mesh_route_rm(const linkaddr_t *dest);
+
+/**
+ * With SICSLOWPAN_CONF_FRAG_STATS, the reassembly keeps counters of
+ * the datagrams it reassembles and of the ones it has to drop.
+ */
+#ifdef SICSLOWPAN_CONF_FRAG_STATS
+#define SICSLOWPAN_FRAG_STATS SICSLOWPAN_CONF_FRAG_STATS
+#else /* SICSLOWPAN_CONF_FRAG_STATS */
+#define SICSLOWPAN_FRAG_STATS 0
+#endif /* SICSLOWPAN_CONF_FRAG_STATS */
+
+#if SICSLOWPAN_FRAG_STATS
+struct sicslowpan_frag_stats {
+  /** Datagrams that were reassembled */
+  uint16_t reassembled;
+  /** Partial datagrams that were evicted because they timed out */
+  uint16_t timed_out;
+  /** First fragments dropped because no context was free */
+  uint16_t no_context;
+  /** Fragments dropped because there was no memory to store them */
+  uint16_t no_buffer;
+};
+
+extern struct sicslowpan_frag_stats sicslowpan_frag_stats;
+
+#define SICSLOWPAN_FRAG_STAT(code) (code)
+#else /* SICSLOWPAN_FRAG_STATS */
+#define SICSLOWPAN_FRAG_STAT(code)
+#endif /* SICSLOWPAN_FRAG_STATS */
+
 extern const struct network_driver sicslowpan_driver;
 
 #endif /* SICSLOWPAN_H_ */
@@ -92,6 +92,7 @@ uip_ds6_nbr_add(const uip_ipaddr_t *ipaddr, const uip_lladdr_t *lladdr,
     /* timers are set separately, for now we put them in expired state */
     stimer_set(&nbr->reachable, 0);
     stimer_set(&nbr->sendns, 0);
+    uip_ds6_schedule(0);
     nbr->nscount = 0;
     PRINTF("Adding neighbor with ip addr ");
     PRINT6ADDR(ipaddr);
@@ -222,6 +223,7 @@ uip_ds6_link_neighbor_callback(int status, int numtx)
     if(nbr != NULL && nbr->state != NBR_INCOMPLETE) {
       nbr->state = NBR_REACHABLE;
       stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+      uip_ds6_schedule_stimer(&nbr->reachable);
       PRINTF("uip-ds6-neighbor : received a link layer ACK : ");
       PRINTLLADDR((uip_lladdr_t *)dest);
       PRINTF(" is reachable.\n");
@@ -267,16 +269,22 @@ uip_ds6_neighbor_periodic(void)
         nbr->state = NBR_STALE;
 #endif /* UIP_CONF_IPV6_RPL */
       }
+      if(nbr->state != NBR_STALE) {
+        uip_ds6_schedule_stimer(&nbr->reachable);
+      }
       break;
 #if UIP_ND6_SEND_NA
     case NBR_INCOMPLETE:
       if(nbr->nscount >= UIP_ND6_MAX_MULTICAST_SOLICIT) {
         uip_ds6_nbr_rm(nbr);
-      } else if(stimer_expired(&nbr->sendns) && (uip_len == 0)) {
-        nbr->nscount++;
-        PRINTF("NBR_INCOMPLETE: NS %u\n", nbr->nscount);
-        uip_nd6_ns_output(NULL, NULL, &nbr->ipaddr);
-        stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
+      } else {
+        if(stimer_expired(&nbr->sendns) && (uip_len == 0)) {
+          nbr->nscount++;
+          PRINTF("NBR_INCOMPLETE: NS %u\n", nbr->nscount);
+          uip_nd6_ns_output(NULL, NULL, &nbr->ipaddr);
+          stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
+        }
+        uip_ds6_schedule_stimer(&nbr->sendns);
       }
       break;
     case NBR_DELAY:
@@ -285,6 +293,9 @@ uip_ds6_neighbor_periodic(void)
         nbr->nscount = 0;
         PRINTF("DELAY: moving to PROBE\n");
         stimer_set(&nbr->sendns, 0);
+        uip_ds6_schedule_stimer(&nbr->sendns);
+      } else {
+        uip_ds6_schedule_stimer(&nbr->reachable);
       }
       break;
     case NBR_PROBE:
@@ -297,11 +308,14 @@ uip_ds6_neighbor_periodic(void)
           }
         }
         uip_ds6_nbr_rm(nbr);
-      } else if(stimer_expired(&nbr->sendns) && (uip_len == 0)) {
-        nbr->nscount++;
-        PRINTF("PROBE: NS %u\n", nbr->nscount);
-        uip_nd6_ns_output(NULL, &nbr->ipaddr, &nbr->ipaddr);
-        stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
+      } else {
+        if(stimer_expired(&nbr->sendns) && (uip_len == 0)) {
+          nbr->nscount++;
+          PRINTF("PROBE: NS %u\n", nbr->nscount);
+          uip_nd6_ns_output(NULL, &nbr->ipaddr, &nbr->ipaddr);
+          stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
+        }
+        uip_ds6_schedule_stimer(&nbr->sendns);
       }
       break;
 #endif /* UIP_ND6_SEND_NA */
@@ -44,6 +44,9 @@
 #include "lib/list.h"
 #include "lib/memb.h"
 #include "net/nbr-table.h"
+#if UIP_DS6_ROUTE_INDEX
+#include "lib/hashlist.h"
+#endif /* UIP_DS6_ROUTE_INDEX */
 
 #include <string.h>
 
@@ -71,6 +74,52 @@ MEMB(neighborroutememb, struct uip_ds6_route_neighbor_route, UIP_DS6_ROUTE_NB);
 LIST(routelist);
 MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 
+#if UIP_DS6_ROUTE_INDEX
+/* The routing table index holds one entry per route, at the same
+   position in index_entries as the route has in routememb. Host
+   routes are put in the hostroutes hash table and all other routes
+   on the prefixroutes list. The stamp tells when the route was last
+   looked up. */
+struct route_index {
+  struct route_index *next;
+  uip_ds6_route_t *route;
+  uint32_t stamp;
+};
+
+static struct route_index index_entries[UIP_DS6_ROUTE_NB];
+static uint32_t index_stamp;
+
+static uint32_t host_route_hash(const void *item);
+HASHLIST(hostroutes, UIP_DS6_ROUTE_INDEX, host_route_hash);
+LIST(prefixroutes);
+
+/* The last address that was looked up, the table it was looked up
+   in, and the route found for it. */
+static uip_ipaddr_t cache_addr;
+static uint8_t cache_table;
+static uip_ds6_route_t *cache_route;
+#endif /* UIP_DS6_ROUTE_INDEX */
+
+#if UIP_DS6_ROUTE_EXPIRY_HEAP
+#if UIP_DS6_ROUTE_NB > 255
+#error "UIP_DS6_ROUTE_CONF_EXPIRY_HEAP supports at most 255 routes"
+#endif
+/* The expiration time of each route and its position on the heap are
+   kept at the same position as the route has in routememb. The heap
+   holds the routes that have a lifetime, the first to expire first. */
+#define NOT_IN_HEAP 0xff
+static unsigned long expiry_time[UIP_DS6_ROUTE_NB];
+static uint8_t heap_index[UIP_DS6_ROUTE_NB];
+static uip_ds6_route_t *expiry_heap[UIP_DS6_ROUTE_NB];
+static uint8_t heap_len;
+#endif /* UIP_DS6_ROUTE_EXPIRY_HEAP */
+
+#if UIP_DS6_ROUTE_TABLES > 1
+#define IN_TABLE(r, t) ((t) == UIP_DS6_ROUTE_ANY_TABLE || (r)->table == (t))
+#else /* UIP_DS6_ROUTE_TABLES > 1 */
+#define IN_TABLE(r, t) 1
+#endif /* UIP_DS6_ROUTE_TABLES > 1 */
+
 /* Default routes are held on the defaultrouterlist and their
    structures are allocated from the defaultroutermemb memory block.*/
 LIST(defaultrouterlist);
@@ -116,6 +165,245 @@ assert_nbr_routes_list_sane(void)
 }
 #endif /* DEBUG != DEBUG_NONE */
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_INDEX
+static uint32_t
+addr_hash(const uip_ipaddr_t *addr)
+{
+  /* The interface identifier is what tells host routes apart. */
+  return hashlist_hash(&addr->u8[8], 8);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+host_route_hash(const void *item)
+{
+  return addr_hash(&((const struct route_index *)item)->route->ipaddr);
+}
+/*---------------------------------------------------------------------------*/
+static struct route_index *
+index_entry(uip_ds6_route_t *r)
+{
+  return &index_entries[r - (uip_ds6_route_t *)routememb.mem];
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(uip_ds6_route_t *r)
+{
+  struct route_index *e;
+
+  e = index_entry(r);
+  e->route = r;
+  e->stamp = ++index_stamp;
+  if(r->length == 128) {
+    hashlist_add(&hostroutes, e);
+  } else {
+    list_add(prefixroutes, e);
+  }
+  cache_route = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_rm(uip_ds6_route_t *r)
+{
+  struct route_index *e;
+
+  e = index_entry(r);
+  if(r->length == 128) {
+    hashlist_remove(&hostroutes, e);
+  } else {
+    list_remove(prefixroutes, e);
+  }
+  e->route = NULL;
+  cache_route = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+index_lookup(uip_ipaddr_t *addr, uint8_t table)
+{
+  struct route_index *e;
+  uip_ds6_route_t *found_route;
+  uint8_t longestmatch;
+
+  if(cache_route != NULL && cache_table == table &&
+     uip_ipaddr_cmp(addr, &cache_addr)) {
+    index_entry(cache_route)->stamp = ++index_stamp;
+    return cache_route;
+  }
+
+  found_route = NULL;
+  for(e = hashlist_head(&hostroutes, addr_hash(addr));
+      e != NULL;
+      e = list_item_next(e)) {
+    if(IN_TABLE(e->route, table) &&
+       uip_ipaddr_cmp(addr, &e->route->ipaddr)) {
+      found_route = e->route;
+      break;
+    }
+  }
+
+  if(found_route == NULL) {
+    longestmatch = 0;
+    for(e = list_head(prefixroutes); e != NULL; e = list_item_next(e)) {
+      if(e->route->length >= longestmatch && IN_TABLE(e->route, table) &&
+         uip_ipaddr_prefixcmp(addr, &e->route->ipaddr, e->route->length)) {
+        longestmatch = e->route->length;
+        found_route = e->route;
+      }
+    }
+  }
+
+  if(found_route != NULL) {
+    index_entry(found_route)->stamp = ++index_stamp;
+    uip_ipaddr_copy(&cache_addr, addr);
+    cache_table = table;
+    cache_route = found_route;
+  }
+  return found_route;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+index_oldest(void)
+{
+  uip_ds6_route_t *r;
+  uip_ds6_route_t *oldest;
+  uint32_t age, oldest_age;
+
+  oldest = NULL;
+  oldest_age = 0;
+  for(r = list_head(routelist); r != NULL; r = list_item_next(r)) {
+    age = index_stamp - index_entry(r)->stamp;
+    if(oldest == NULL || age > oldest_age) {
+      oldest = r;
+      oldest_age = age;
+    }
+  }
+  return oldest;
+}
+#endif /* UIP_DS6_ROUTE_INDEX */
+/*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_EXPIRY_HEAP
+static int
+route_slot(uip_ds6_route_t *r)
+{
+  return r - (uip_ds6_route_t *)routememb.mem;
+}
+/*---------------------------------------------------------------------------*/
+static int
+expires_before(uip_ds6_route_t *a, uip_ds6_route_t *b)
+{
+  return (long)(expiry_time[route_slot(a)] - expiry_time[route_slot(b)]) < 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_set(int i, uip_ds6_route_t *r)
+{
+  expiry_heap[i] = r;
+  heap_index[route_slot(r)] = i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_up(int i)
+{
+  uip_ds6_route_t *r;
+  int parent;
+
+  r = expiry_heap[i];
+  while(i > 0) {
+    parent = (i - 1) / 2;
+    if(!expires_before(r, expiry_heap[parent])) {
+      break;
+    }
+    heap_set(i, expiry_heap[parent]);
+    i = parent;
+  }
+  heap_set(i, r);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_down(int i)
+{
+  uip_ds6_route_t *r;
+  int child;
+
+  r = expiry_heap[i];
+  for(;;) {
+    child = 2 * i + 1;
+    if(child >= heap_len) {
+      break;
+    }
+    if(child + 1 < heap_len &&
+       expires_before(expiry_heap[child + 1], expiry_heap[child])) {
+      child++;
+    }
+    if(!expires_before(expiry_heap[child], r)) {
+      break;
+    }
+    heap_set(i, expiry_heap[child]);
+    i = child;
+  }
+  heap_set(i, r);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_rm(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t *last;
+  int i;
+
+  i = heap_index[route_slot(r)];
+  if(i == NOT_IN_HEAP) {
+    return;
+  }
+  heap_index[route_slot(r)] = NOT_IN_HEAP;
+  heap_len--;
+  if(i < heap_len) {
+    /* Fill the hole with the last route and restore the order. */
+    last = expiry_heap[heap_len];
+    heap_set(i, last);
+    heap_up(i);
+    heap_down(heap_index[route_slot(last)]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_route_set_lifetime(uip_ds6_route_t *route, unsigned long lifetime)
+{
+  int i;
+
+  expiry_time[route_slot(route)] = clock_seconds() + lifetime;
+  i = heap_index[route_slot(route)];
+  if(i == NOT_IN_HEAP) {
+    i = heap_len++;
+    heap_set(i, route);
+    heap_up(i);
+  } else {
+    heap_up(i);
+    heap_down(heap_index[route_slot(route)]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+uip_ds6_route_lifetime(uip_ds6_route_t *route)
+{
+  long left;
+
+  if(heap_index[route_slot(route)] == NOT_IN_HEAP) {
+    return 0;
+  }
+  left = (long)(expiry_time[route_slot(route)] - clock_seconds());
+  return left > 0 ? left : 0;
+}
+/*---------------------------------------------------------------------------*/
+uip_ds6_route_t *
+uip_ds6_route_expired(void)
+{
+  if(heap_len > 0 &&
+     (long)(expiry_time[route_slot(expiry_heap[0])] - clock_seconds()) <= 0) {
+    return expiry_heap[0];
+  }
+  return NULL;
+}
+#endif /* UIP_DS6_ROUTE_EXPIRY_HEAP */
+/*---------------------------------------------------------------------------*/
 #if UIP_DS6_NOTIFICATIONS
 static void
 call_route_callback(int event, uip_ipaddr_t *route,
@@ -158,6 +446,14 @@ uip_ds6_route_init(void)
 {
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_INDEX
+  hashlist_init(&hostroutes);
+  list_init(prefixroutes);
+  cache_route = NULL;
+#endif /* UIP_DS6_ROUTE_INDEX */
+#if UIP_DS6_ROUTE_EXPIRY_HEAP
+  heap_len = 0;
+#endif /* UIP_DS6_ROUTE_EXPIRY_HEAP */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -215,21 +511,31 @@ uip_ds6_route_num_routes(void)
 uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
-  uip_ds6_route_t *r;
+  return uip_ds6_route_lookup_table(addr, UIP_DS6_ROUTE_ANY_TABLE);
+}
+/*---------------------------------------------------------------------------*/
+uip_ds6_route_t *
+uip_ds6_route_lookup_table(uip_ipaddr_t *addr, uint8_t table)
+{
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_INDEX
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_INDEX */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
-
+#if UIP_DS6_ROUTE_INDEX
+  found_route = index_lookup(addr, table);
+#else /* UIP_DS6_ROUTE_INDEX */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
       r != NULL;
       r = uip_ds6_route_next(r)) {
-    if(r->length >= longestmatch &&
+    if(r->length >= longestmatch && IN_TABLE(r, table) &&
        uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
       longestmatch = r->length;
       found_route = r;
@@ -239,6 +545,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_INDEX */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -250,6 +557,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
+#if !UIP_DS6_ROUTE_INDEX
   if(found_route != NULL && found_route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
@@ -259,6 +567,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
   }
+#endif /* !UIP_DS6_ROUTE_INDEX */
 
   return found_route;
 }
@@ -266,6 +575,13 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 uip_ds6_route_t *
 uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 		  uip_ipaddr_t *nexthop)
+{
+  return uip_ds6_route_add_table(ipaddr, length, nexthop, 0);
+}
+/*---------------------------------------------------------------------------*/
+uip_ds6_route_t *
+uip_ds6_route_add_table(uip_ipaddr_t *ipaddr, uint8_t length,
+                        uip_ipaddr_t *nexthop, uint8_t table)
 {
   uip_ds6_route_t *r;
   struct uip_ds6_route_neighbor_route *nbrr;
@@ -286,7 +602,7 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
   /* First make sure that we don't add a route twice. If we find an
      existing route for our destination, we'll delete the old
      one first. */
-  r = uip_ds6_route_lookup(ipaddr);
+  r = uip_ds6_route_lookup_table(ipaddr, table);
   if(r != NULL) {
     uip_ipaddr_t *current_nexthop;
     current_nexthop = uip_ds6_route_nexthop(r);
@@ -311,7 +627,18 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
          least recently used route is the first route on the list. */
       uip_ds6_route_t *oldest;
 
-      oldest = list_tail(routelist); /* uip_ds6_route_head(); */
+      oldest = NULL;
+#if UIP_DS6_ROUTE_EXPIRY_HEAP
+      /* A route that has already expired goes first. */
+      oldest = uip_ds6_route_expired();
+#endif /* UIP_DS6_ROUTE_EXPIRY_HEAP */
+      if(oldest == NULL) {
+#if UIP_DS6_ROUTE_INDEX
+        oldest = index_oldest();
+#else /* UIP_DS6_ROUTE_INDEX */
+        oldest = list_tail(routelist); /* uip_ds6_route_head(); */
+#endif /* UIP_DS6_ROUTE_INDEX */
+      }
       PRINTF("uip_ds6_route_add: dropping route to ");
       PRINT6ADDR(&oldest->ipaddr);
       PRINTF("\n");
@@ -387,6 +714,15 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_TABLES > 1
+  r->table = table;
+#endif /* UIP_DS6_ROUTE_TABLES > 1 */
+#if UIP_DS6_ROUTE_INDEX
+  index_add(r);
+#endif /* UIP_DS6_ROUTE_INDEX */
+#if UIP_DS6_ROUTE_EXPIRY_HEAP
+  heap_index[route_slot(r)] = NOT_IN_HEAP;
+#endif /* UIP_DS6_ROUTE_EXPIRY_HEAP */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -425,6 +761,12 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_INDEX
+    index_rm(route);
+#endif /* UIP_DS6_ROUTE_INDEX */
+#if UIP_DS6_ROUTE_EXPIRY_HEAP
+    heap_rm(route);
+#endif /* UIP_DS6_ROUTE_EXPIRY_HEAP */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -542,6 +884,7 @@ uip_ds6_defrt_add(uip_ipaddr_t *ipaddr, unsigned long interval)
   uip_ipaddr_copy(&d->ipaddr, ipaddr);
   if(interval != 0) {
     stimer_set(&d->lifetime, interval);
+    uip_ds6_schedule_stimer(&d->lifetime);
     d->isinfinite = 0;
   } else {
     d->isinfinite = 1;
@@ -647,6 +990,9 @@ uip_ds6_defrt_periodic(void)
       uip_ds6_defrt_rm(d);
       d = list_head(defaultrouterlist);
     } else {
+      if(!d->isinfinite) {
+        uip_ds6_schedule_stimer(&d->lifetime);
+      }
       d = list_item_next(d);
     }
   }
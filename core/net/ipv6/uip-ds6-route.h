@@ -92,6 +92,45 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* With UIP_DS6_ROUTE_CONF_INDEX set to a number of hash buckets (a
+   power of two), host routes (/128) are kept in a hash table and the
+   other routes on a list of their own, so that uip_ds6_route_lookup()
+   does not have to walk the whole routing table. The result of the
+   last lookup is cached as well. The least recently used route is
+   then tracked with a lookup stamp instead of by the order of the
+   routing table. */
+#ifdef UIP_DS6_ROUTE_CONF_INDEX
+#define UIP_DS6_ROUTE_INDEX UIP_DS6_ROUTE_CONF_INDEX
+#else /* UIP_DS6_ROUTE_CONF_INDEX */
+#define UIP_DS6_ROUTE_INDEX 0
+#endif /* UIP_DS6_ROUTE_CONF_INDEX */
+
+/* With UIP_DS6_ROUTE_CONF_TABLES set above one, every route belongs
+   to one of that many routing tables, numbered from zero, and the
+   same prefix may have a route in each table. RPL keeps the routes of
+   each instance in a table of their own when there are at least
+   RPL_CONF_MAX_INSTANCES tables. */
+#ifdef UIP_DS6_ROUTE_CONF_TABLES
+#define UIP_DS6_ROUTE_TABLES UIP_DS6_ROUTE_CONF_TABLES
+#else /* UIP_DS6_ROUTE_CONF_TABLES */
+#define UIP_DS6_ROUTE_TABLES 1
+#endif /* UIP_DS6_ROUTE_CONF_TABLES */
+
+/* With UIP_DS6_ROUTE_CONF_EXPIRY_HEAP set, a route can be given a
+   lifetime with uip_ds6_route_set_lifetime(). The routes with a
+   lifetime are kept on a binary min-heap ordered by the time they
+   expire, so that uip_ds6_route_expired() finds the expired routes
+   without touching the others. When the table is full, a route that
+   has expired is dropped before the least recently used one. */
+#ifdef UIP_DS6_ROUTE_CONF_EXPIRY_HEAP
+#define UIP_DS6_ROUTE_EXPIRY_HEAP UIP_DS6_ROUTE_CONF_EXPIRY_HEAP
+#else /* UIP_DS6_ROUTE_CONF_EXPIRY_HEAP */
+#define UIP_DS6_ROUTE_EXPIRY_HEAP 0
+#endif /* UIP_DS6_ROUTE_CONF_EXPIRY_HEAP */
+
+/* The table given to look up a route in all routing tables */
+#define UIP_DS6_ROUTE_ANY_TABLE 0xff
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -125,6 +164,9 @@ typedef struct uip_ds6_route {
   UIP_DS6_ROUTE_STATE_TYPE state;
 #endif
   uint8_t length;
+#if UIP_DS6_ROUTE_TABLES > 1
+  uint8_t table;
+#endif /* UIP_DS6_ROUTE_TABLES > 1 */
 } uip_ds6_route_t;
 
 /** \brief A neighbor route list entry, used on the
@@ -159,9 +201,23 @@ void uip_ds6_defrt_periodic(void);
 uip_ds6_route_t *uip_ds6_route_lookup(uip_ipaddr_t *destipaddr);
 uip_ds6_route_t *uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
                                    uip_ipaddr_t *next_hop);
+uip_ds6_route_t *uip_ds6_route_lookup_table(uip_ipaddr_t *destipaddr,
+                                            uint8_t table);
+uip_ds6_route_t *uip_ds6_route_add_table(uip_ipaddr_t *ipaddr, uint8_t length,
+                                         uip_ipaddr_t *next_hop,
+                                         uint8_t table);
 void uip_ds6_route_rm(uip_ds6_route_t *route);
 void uip_ds6_route_rm_by_nexthop(uip_ipaddr_t *nexthop);
 
+#if UIP_DS6_ROUTE_EXPIRY_HEAP
+/* Sets the route to expire in the given number of seconds */
+void uip_ds6_route_set_lifetime(uip_ds6_route_t *route, unsigned long lifetime);
+/* The seconds left before the route expires */
+unsigned long uip_ds6_route_lifetime(uip_ds6_route_t *route);
+/* The route that expired first, or NULL if no route has expired */
+uip_ds6_route_t *uip_ds6_route_expired(void);
+#endif /* UIP_DS6_ROUTE_EXPIRY_HEAP */
+
 uip_ipaddr_t *uip_ds6_route_nexthop(uip_ds6_route_t *);
 int uip_ds6_route_num_routes(void);
 uip_ds6_route_t *uip_ds6_route_head(void);
@@ -46,14 +46,22 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include "lib/random.h"
+#include "sys/boot-profile.h"
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/ip/uip-packetqueue.h"
+#if UIP_DS6_TICKLESS
+#include "net/ip/tcpip.h"
+#endif /* UIP_DS6_TICKLESS */
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
 
 struct etimer uip_ds6_timer_periodic;                           /**< Timer for maintenance of data structures */
+#if UIP_DS6_TICKLESS
+static clock_time_t periodic_due;                               /**< When uip_ds6_timer_periodic is due */
+static uint8_t periodic_scheduled;                              /**< Whether periodic_due is valid */
+#endif /* UIP_DS6_TICKLESS */
 
 #if UIP_CONF_ROUTER
 struct stimer uip_ds6_timer_ra;                                 /**< RA timer, to schedule RA sending */
@@ -130,22 +138,88 @@ uip_ds6_init(void)
   uip_ds6_maddr_add(&loc_fipaddr);
 #if UIP_ND6_SEND_RA
   stimer_set(&uip_ds6_timer_ra, 2);     /* wait to have a link local IP address */
+  uip_ds6_schedule_stimer(&uip_ds6_timer_ra);
 #endif /* UIP_ND6_SEND_RA */
 #else /* UIP_CONF_ROUTER */
+#if BOOT_FAST
+  /* Solicit routers at once */
+  etimer_set(&uip_ds6_timer_rs, 0);
+#else /* BOOT_FAST */
   etimer_set(&uip_ds6_timer_rs,
              random_rand() % (UIP_ND6_MAX_RTR_SOLICITATION_DELAY *
                               CLOCK_SECOND));
+#endif /* BOOT_FAST */
 #endif /* UIP_CONF_ROUTER */
+#if UIP_DS6_TICKLESS
+  uip_ds6_schedule(UIP_DS6_PERIOD);
+#else /* UIP_DS6_TICKLESS */
   etimer_set(&uip_ds6_timer_periodic, UIP_DS6_PERIOD);
+#endif /* UIP_DS6_TICKLESS */
 
   return;
 }
 
+#if UIP_DS6_TICKLESS
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_schedule(clock_time_t ticks)
+{
+  clock_time_t left;
+
+  if(ticks < UIP_DS6_PERIOD) {
+    ticks = UIP_DS6_PERIOD;
+  }
+
+  /* Keep an earlier run, also one that is due but not handled yet */
+  left = periodic_due - clock_time();
+  if(periodic_scheduled &&
+     (left <= ticks || left > ((clock_time_t)~0 >> 1))) {
+    return;
+  }
+
+  periodic_due = clock_time() + ticks;
+  periodic_scheduled = 1;
+  PROCESS_CONTEXT_BEGIN(&tcpip_process);
+  etimer_set(&uip_ds6_timer_periodic, ticks);
+  PROCESS_CONTEXT_END(&tcpip_process);
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_schedule_stimer(struct stimer *t)
+{
+  unsigned long left;
+
+  if(stimer_expired(t)) {
+    uip_ds6_schedule(0);
+    return;
+  }
+  left = stimer_remaining(t);
+  if(left > ((clock_time_t)~0 >> 1) / CLOCK_SECOND) {
+    left = ((clock_time_t)~0 >> 1) / CLOCK_SECOND;
+  }
+  /* The stimer expires when clock_seconds() next ticks over after
+     left - 1 seconds. Waking up early only costs a reschedule */
+  uip_ds6_schedule(left * CLOCK_SECOND - clock_time() % CLOCK_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_ND6_DEF_MAXDADNS > 0
+static void
+schedule_timer(struct timer *t)
+{
+  uip_ds6_schedule(timer_expired(t) ? 0 : timer_remaining(t));
+}
+#endif /* UIP_ND6_DEF_MAXDADNS > 0 */
+#endif /* UIP_DS6_TICKLESS */
+
 
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_periodic(void)
 {
+#if UIP_DS6_TICKLESS
+  /* Each timer still running schedules the next run */
+  periodic_scheduled = 0;
+#endif /* UIP_DS6_TICKLESS */
 
   /* Periodic processing on unicast addresses */
   for(locaddr = uip_ds6_if.addr_list;
@@ -161,6 +235,17 @@ uip_ds6_periodic(void)
         uip_ds6_dad(locaddr);
 #endif /* UIP_ND6_DEF_MAXDADNS > 0 */
       }
+#if UIP_DS6_TICKLESS
+      if(locaddr->isused && !locaddr->isinfinite) {
+        uip_ds6_schedule_stimer(&locaddr->vlifetime);
+      }
+#if UIP_ND6_DEF_MAXDADNS > 0
+      if(locaddr->isused && locaddr->state == ADDR_TENTATIVE
+         && locaddr->dadnscount <= uip_ds6_if.maxdadns) {
+        schedule_timer(&locaddr->dadtimer);
+      }
+#endif /* UIP_ND6_DEF_MAXDADNS > 0 */
+#endif /* UIP_DS6_TICKLESS */
     }
   }
 
@@ -182,6 +267,8 @@ uip_ds6_periodic(void)
     if(locprefix->isused && !locprefix->isinfinite
        && stimer_expired(&(locprefix->vlifetime))) {
       uip_ds6_prefix_rm(locprefix);
+    } else if(locprefix->isused && !locprefix->isinfinite) {
+      uip_ds6_schedule_stimer(&locprefix->vlifetime);
     }
   }
 #endif /* !UIP_CONF_ROUTER */
@@ -193,8 +280,11 @@ uip_ds6_periodic(void)
   if(stimer_expired(&uip_ds6_timer_ra) && (uip_len == 0)) {
     uip_ds6_send_ra_periodic();
   }
+  uip_ds6_schedule_stimer(&uip_ds6_timer_ra);
 #endif /* UIP_CONF_ROUTER && UIP_ND6_SEND_RA */
+#if !UIP_DS6_TICKLESS
   etimer_reset(&uip_ds6_timer_periodic);
+#endif /* !UIP_DS6_TICKLESS */
   return;
 }
 
@@ -270,6 +360,7 @@ uip_ds6_prefix_add(uip_ipaddr_t *ipaddr, uint8_t ipaddrlen,
     locprefix->length = ipaddrlen;
     if(interval != 0) {
       stimer_set(&(locprefix->vlifetime), interval);
+      uip_ds6_schedule_stimer(&locprefix->vlifetime);
       locprefix->isinfinite = 0;
     } else {
       locprefix->isinfinite = 1;
@@ -335,15 +426,28 @@ uip_ds6_addr_add(uip_ipaddr_t *ipaddr, unsigned long vlifetime, uint8_t type)
     } else {
       locaddr->isinfinite = 0;
       stimer_set(&(locaddr->vlifetime), vlifetime);
+      uip_ds6_schedule_stimer(&locaddr->vlifetime);
     }
 #if UIP_ND6_DEF_MAXDADNS > 0
-    locaddr->state = ADDR_TENTATIVE;
-    timer_set(&locaddr->dadtimer,
-              random_rand() % (UIP_ND6_MAX_RTR_SOLICITATION_DELAY *
-                               CLOCK_SECOND));
-    locaddr->dadnscount = 0;
+#if BOOT_FAST
+    /* The interface identifier comes from the unique link-layer
+       address: skip duplicate address detection */
+    if(type == ADDR_AUTOCONF) {
+      locaddr->state = ADDR_PREFERRED;
+      BOOT_PROFILE_MARK(BOOT_PROFILE_ADDRESS);
+    } else
+#endif /* BOOT_FAST */
+    {
+      locaddr->state = ADDR_TENTATIVE;
+      timer_set(&locaddr->dadtimer,
+                random_rand() % (UIP_ND6_MAX_RTR_SOLICITATION_DELAY *
+                                 CLOCK_SECOND));
+      uip_ds6_schedule(timer_remaining(&locaddr->dadtimer));
+      locaddr->dadnscount = 0;
+    }
 #else /* UIP_ND6_DEF_MAXDADNS > 0 */
     locaddr->state = ADDR_PREFERRED;
+    BOOT_PROFILE_MARK(BOOT_PROFILE_ADDRESS);
 #endif /* UIP_ND6_DEF_MAXDADNS > 0 */
     uip_create_solicited_node(ipaddr, &loc_fipaddr);
     uip_ds6_maddr_add(&loc_fipaddr);
@@ -555,6 +659,28 @@ uip_ds6_set_addr_iid(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
 #endif
 }
 
+/*---------------------------------------------------------------------------*/
+uint8_t
+uip_ds6_get_lladdr_from_iid(const uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
+{
+  /* Inverse of uip_ds6_set_addr_iid() */
+#if (UIP_LLADDR_LEN == 8)
+  memcpy(lladdr, ipaddr->u8 + 8, UIP_LLADDR_LEN);
+  ((uint8_t *)lladdr)[0] ^= 0x02;
+  return 1;
+#elif (UIP_LLADDR_LEN == 6)
+  if(ipaddr->u8[11] != 0xff || ipaddr->u8[12] != 0xfe) {
+    return 0;
+  }
+  memcpy(lladdr, ipaddr->u8 + 8, 3);
+  memcpy((uint8_t *)lladdr + 3, ipaddr->u8 + 13, 3);
+  ((uint8_t *)lladdr)[0] ^= 0x02;
+  return 1;
+#else
+  return 0;
+#endif
+}
+
 /*---------------------------------------------------------------------------*/
 uint8_t
 get_match_length(uip_ipaddr_t *src, uip_ipaddr_t *dst)
@@ -603,6 +729,7 @@ uip_ds6_dad(uip_ds6_addr_t *addr)
   PRINTF("\n");
 
   addr->state = ADDR_PREFERRED;
+  BOOT_PROFILE_MARK(BOOT_PROFILE_ADDRESS);
   return;
 }
 
@@ -646,6 +773,7 @@ uip_ds6_send_ra_sollicited(void)
                  stimer_elapsed(&uip_ds6_timer_ra));
   */ } else {
       stimer_set(&uip_ds6_timer_ra, rand_time);
+      uip_ds6_schedule_stimer(&uip_ds6_timer_ra);
     }
   }
 }
@@ -138,6 +138,17 @@
 #define UIP_DS6_PERIOD UIP_DS6_CONF_PERIOD
 #endif
 
+/** With UIP_DS6_CONF_TICKLESS, uip_ds6_periodic() is not run every
+ * UIP_DS6_PERIOD but only when the earliest neighbor, address, prefix,
+ * default router or RA timer is due, at most once per UIP_DS6_PERIOD.
+ * Code that sets one of these timers must then call
+ * uip_ds6_schedule_stimer() or uip_ds6_schedule() */
+#ifndef UIP_DS6_CONF_TICKLESS
+#define UIP_DS6_TICKLESS 0
+#else
+#define UIP_DS6_TICKLESS UIP_DS6_CONF_TICKLESS
+#endif
+
 #define FOUND 0
 #define FREESPACE 1
 #define NOSPACE 2
@@ -252,6 +263,17 @@ void uip_ds6_init(void);
 /** \brief Periodic processing of data structures */
 void uip_ds6_periodic(void);
 
+#if UIP_DS6_TICKLESS
+/** \brief Make sure uip_ds6_periodic() runs within ticks clock ticks */
+void uip_ds6_schedule(clock_time_t ticks);
+
+/** \brief Make sure uip_ds6_periodic() runs when an stimer expires */
+void uip_ds6_schedule_stimer(struct stimer *t);
+#else /* UIP_DS6_TICKLESS */
+#define uip_ds6_schedule(ticks)
+#define uip_ds6_schedule_stimer(t)
+#endif /* UIP_DS6_TICKLESS */
+
 /** \brief Generic loop routine on an abstract data structure, which generalizes
  * all data structures used in DS6 */
 uint8_t uip_ds6_list_loop(uip_ds6_element_t *list, uint8_t size,
@@ -312,6 +334,11 @@ uip_ds6_aaddr_t *uip_ds6_aaddr_lookup(uip_ipaddr_t *ipaddr);
 /** \brief set the last 64 bits of an IP address based on the MAC address */
 void uip_ds6_set_addr_iid(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr);
 
+/** \brief get the MAC address an IP address was formed from, 0 if it
+ * cannot have been built by uip_ds6_set_addr_iid() */
+uint8_t uip_ds6_get_lladdr_from_iid(const uip_ipaddr_t *ipaddr,
+                                    uip_lladdr_t *lladdr);
+
 /** \brief Get the number of matching bits of two addresses */
 uint8_t get_match_length(uip_ipaddr_t *src, uip_ipaddr_t *dst);
 
@@ -46,6 +46,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "contiki-default-conf.h"
+#include "sys/energest.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -294,6 +295,15 @@ uip_icmp6_error_output(uint8_t type, uint8_t code, uint32_t param) {
 void
 uip_icmp6_send(const uip_ipaddr_t *dest, int type, int code, int payload_len)
 {
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+  int subsystem;
+
+  /* All RPL control messages are sent from here */
+  subsystem = energest_subsystem_get();
+  if(type == ICMP6_RPL) {
+    energest_subsystem_set(ENERGEST_SUBSYSTEM_RPL);
+  }
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
 
   UIP_IP_BUF->vtc = 0x60;
   UIP_IP_BUF->tcflow = 0;
@@ -318,6 +328,9 @@ uip_icmp6_send(const uip_ipaddr_t *dest, int type, int code, int payload_len)
   UIP_STAT(++uip_stat.ip.sent);
 
   tcpip_ipv6_output();
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+  energest_subsystem_set(subsystem);
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
 }
 /*---------------------------------------------------------------------------*/
 static void
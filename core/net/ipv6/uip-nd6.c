@@ -179,6 +179,14 @@ ns_input(void)
   }
 #endif /* UIP_CONF_IPV6_CHECKS */
 
+#if UIP_ND6_LITE
+  /* Neighbours resolve our address from its IID; only unicast NS (NUD) */
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+    PRINTF("NS multicast dropped (ND-lite)\n");
+    goto discard;
+  }
+#endif /* UIP_ND6_LITE */
+
   /* Options processing */
   nd6_opt_llao = NULL;
   nd6_opt_offset = UIP_ND6_NS_LEN;
@@ -512,6 +520,7 @@ na_input(void)
 
         /* reachable time is stored in ms */
         stimer_set(&(nbr->reachable), uip_ds6_if.reachable_time / 1000);
+        uip_ds6_schedule_stimer(&nbr->reachable);
 
       } else {
         nbr->state = NBR_STALE;
@@ -534,6 +543,7 @@ na_input(void)
             nbr->state = NBR_REACHABLE;
             /* reachable time is stored in ms */
             stimer_set(&(nbr->reachable), uip_ds6_if.reachable_time / 1000);
+            uip_ds6_schedule_stimer(&nbr->reachable);
           } else {
             if(nd6_opt_llao != 0 && is_llchange) {
               nbr->state = NBR_STALE;
@@ -551,7 +561,9 @@ na_input(void)
     }
   }
 #if UIP_CONF_IPV6_QUEUE_PKT
-  /* The nbr is now reachable, check if we had buffered a pkt for it */
+  /* The nbr is now reachable, check if we had buffered pkts for it. The
+     first one is sent as the reply to this NA, and tcpip_ipv6_output()
+     sends the rest of the queue along with it. */
   /*if(nbr->queue_buf_len != 0) {
     uip_len = nbr->queue_buf_len;
     memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
@@ -561,7 +573,7 @@ na_input(void)
   if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
     uip_len = uip_packetqueue_buflen(&nbr->packethandle);
     memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
+    uip_packetqueue_pop(&nbr->packethandle);
     return;
   }
 
@@ -927,6 +939,7 @@ ra_input(void)
               PRINTF(" new value %lu\n", uip_ntohl(nd6_opt_prefix_info->validlt));
               stimer_set(&prefix->vlifetime,
                          uip_ntohl(nd6_opt_prefix_info->validlt));
+              uip_ds6_schedule_stimer(&prefix->vlifetime);
               prefix->isinfinite = 0;
               break;
             }
@@ -959,6 +972,7 @@ ra_input(void)
                 PRINT6ADDR(&addr->ipaddr);
                 PRINTF(" new value %lu\n", (unsigned long)(2 * 60 * 60));
               }
+              uip_ds6_schedule_stimer(&addr->vlifetime);
               addr->isinfinite = 0;
             } else {
               addr->isinfinite = 1;
@@ -1012,6 +1026,7 @@ ra_input(void)
     } else {
       stimer_set(&(defrt->lifetime),
                  (unsigned long)(uip_ntohs(UIP_ND6_RA_BUF->router_lifetime)));
+      uip_ds6_schedule_stimer(&defrt->lifetime);
     }
   } else {
     if(defrt != NULL) {
@@ -1021,7 +1036,8 @@ ra_input(void)
 
 #if UIP_CONF_IPV6_QUEUE_PKT
   /* If the nbr just became reachable (e.g. it was in NBR_INCOMPLETE state
-   * and we got a SLLAO), check if we had buffered a pkt for it */
+   * and we got a SLLAO), check if we had buffered pkts for it. The rest
+   * of the queue follows the first one in tcpip_ipv6_output(). */
   /*  if((nbr != NULL) && (nbr->queue_buf_len != 0)) {
     uip_len = nbr->queue_buf_len;
     memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
@@ -1031,7 +1047,7 @@ ra_input(void)
   if(nbr != NULL && uip_packetqueue_buflen(&nbr->packethandle) != 0) {
     uip_len = uip_packetqueue_buflen(&nbr->packethandle);
     memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
+    uip_packetqueue_pop(&nbr->packethandle);
     return;
   }
 
@@ -104,9 +104,24 @@
 #define UIP_ND6_MAX_RA_DELAY_TIME_MS        500 /*milli seconds*/
 /** @} */
 
+/**
+ * \brief 6LoWPAN ND-lite (RFC 6775 style host behaviour)
+ *
+ * When set, link-local neighbours are resolved from the interface identifier
+ * of their address instead of with a multicast NS, no multicast DAD is sent
+ * (addresses formed from the MAC are unique and registration is left to the
+ * border router), and incoming multicast NS are dropped. Unicast NS for NUD
+ * are still answered.
+ */
+#ifndef UIP_CONF_ND6_LITE
+#define UIP_ND6_LITE                        0
+#else
+#define UIP_ND6_LITE UIP_CONF_ND6_LITE
+#endif
+
 #ifndef UIP_CONF_ND6_DEF_MAXDADNS
 /** \brief Do not try DAD when using EUI-64 as allowed by draft-ietf-6lowpan-nd-15 section 8.2 */
-#if UIP_CONF_LL_802154
+#if UIP_CONF_LL_802154 || UIP_ND6_LITE
 #define UIP_ND6_DEF_MAXDADNS 0
 #else /* UIP_CONF_LL_802154 */
 #define UIP_ND6_DEF_MAXDADNS UIP_ND6_SEND_NA
@@ -74,10 +74,13 @@
 #include "sys/cc.h"
 #include "net/ip/uip.h"
 #include "net/ip/uipopt.h"
+#include "net/ip/ip-chksum.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
+#include "lib/list.h"
+#include "lib/memb.h"
 
 #include <string.h>
 
@@ -152,7 +155,7 @@ uint8_t uip_ext_opt_offset = 0;
  * \name Buffer defines
  * @{
  */
-#define FBUF                             ((struct uip_tcpip_hdr *)&uip_reassbuf[0])
+#define FBUF                             ((struct uip_tcpip_hdr *)&reass_ctx->buf[0])
 #define UIP_IP_BUF                          ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UIP_ICMP_BUF                      ((struct uip_icmp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
 #define UIP_UDP_BUF                        ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
@@ -257,6 +260,12 @@ static uint8_t iss[4];
 /* Temporary variables. */
 uint8_t uip_acc32[4];
 static uint8_t opt;
+
+#if UIP_TCP_SEGMENTS > 1
+/* Where the segment being sent starts, relative to the oldest
+   unacknowledged byte of the connection. */
+static uint16_t tcp_seq_offset;
+#endif /* UIP_TCP_SEGMENTS > 1 */
 static uint16_t tmp16;
 #endif /* UIP_TCP */
 /** @} */
@@ -323,41 +332,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {   /* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(ip_chksum_add(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -366,7 +344,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = ip_chksum_add(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -396,10 +374,10 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = ip_chksum_add(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+  sum = ip_chksum_add(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
                upper_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
@@ -429,6 +407,59 @@ uip_udpchksum(void)
 #endif /* UIP_UDP && UIP_UDP_CHECKSUMS */
 #endif /* UIP_ARCH_CHKSUM */
 /*---------------------------------------------------------------------------*/
+#if UIP_DEMUX_HASH
+/*
+ * Demultiplexing hints: for each hash bucket, the index of the
+ * connection that last matched the packets hashing to it, or
+ * DEMUX_NONE. TCP packets hash on both ports and the source address,
+ * UDP packets on the destination port only. A hint is checked against
+ * the packet before it is used, so a stale one only costs the scan it
+ * would have saved.
+ *
+ * A UDP hint is only kept for the first connection bound to its port:
+ * an earlier connection on the same port, which the scan would have
+ * chosen, could otherwise be skipped. Binding may change that order,
+ * hence uip_udp_demux_flush().
+ */
+#if (UIP_DEMUX_HASH & (UIP_DEMUX_HASH - 1)) != 0
+#error UIP_CONF_DEMUX_HASH must be a power of two
+#endif
+#if UIP_CONNS >= 255 || UIP_UDP_CONNS >= 255
+#error UIP_CONF_DEMUX_HASH requires fewer than 255 connections
+#endif
+#define DEMUX_NONE 0xff
+#if UIP_TCP
+static uint8_t tcp_hints[UIP_DEMUX_HASH];
+#endif /* UIP_TCP */
+#if UIP_UDP
+static uint8_t udp_hints[UIP_DEMUX_HASH];
+#endif /* UIP_UDP */
+static uint8_t demux_bucket;
+
+static uint8_t
+demux_hash(uint16_t lport, uint16_t rport, const uip_ipaddr_t *ripaddr)
+{
+  uint16_t h;
+  uint8_t i;
+
+  h = lport ^ (rport << 7 | rport >> 9);
+  if(ripaddr != NULL) {
+    for(i = 0; i < sizeof(uip_ipaddr_t) / 2; i++) {
+      h = (h << 5 | h >> 11) ^ ripaddr->u16[i];
+    }
+  }
+  return (h ^ (h >> 8)) & (UIP_DEMUX_HASH - 1);
+}
+#endif /* UIP_DEMUX_HASH */
+/*---------------------------------------------------------------------------*/
+void
+uip_udp_demux_flush(void)
+{
+#if UIP_DEMUX_HASH && UIP_UDP
+  memset(udp_hints, DEMUX_NONE, sizeof(udp_hints));
+#endif /* UIP_DEMUX_HASH && UIP_UDP */
+}
+/*---------------------------------------------------------------------------*/
 void
 uip_init(void)
 {
@@ -456,6 +487,13 @@ uip_init(void)
   }
 #endif /* UIP_UDP */
 
+#if UIP_DEMUX_HASH
+#if UIP_TCP
+  memset(tcp_hints, DEMUX_NONE, sizeof(tcp_hints));
+#endif /* UIP_TCP */
+  uip_udp_demux_flush();
+#endif /* UIP_DEMUX_HASH */
+
 #if UIP_CONF_IPV6_MULTICAST
   UIP_MCAST6.init();
 #endif
@@ -519,6 +557,12 @@ uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->initialmss = conn->mss = UIP_TCP_MSS;
 
   conn->len = 1;   /* TCP length of the SYN is one. */
+#if UIP_TCP_SEGMENTS > 1
+  conn->snd_wnd = 0;
+#endif /* UIP_TCP_SEGMENTS > 1 */
+#if UIP_TCP_DELAYED_ACK
+  conn->ackpending = 0;
+#endif /* UIP_TCP_DELAYED_ACK */
   conn->nrtx = 0;
   conn->timer = 1; /* Send the SYN next time around. */
   conn->rto = UIP_RTO;
@@ -629,19 +673,31 @@ uip_listen(uint16_t port)
 #if UIP_CONF_IPV6_REASSEMBLY
 #define UIP_REASS_BUFSIZE (UIP_BUFSIZE - UIP_LLH_LEN)
 
-static uint8_t uip_reassbuf[UIP_REASS_BUFSIZE];
+/* A datagram being reassembled. Fragments are matched to it by their
+   source and destination addresses and their identification. */
+struct uip_reass_ctx {
+  struct uip_reass_ctx *next;
+  uint8_t buf[UIP_REASS_BUFSIZE];
+  uint8_t bitmap[UIP_REASS_BUFSIZE / (8 * 8)];
+  /*the first byte of an IP fragment is aligned on an 8-byte boundary */
+  uint16_t len;
+  uint8_t flags;
+  uint32_t id;
+  struct timer timer;
+};
+
+MEMB(reass_memb, struct uip_reass_ctx, UIP_REASS_CONTEXTS);
+LIST(reass_list);
 
-static uint8_t uip_reassbitmap[UIP_REASS_BUFSIZE / (8 * 8)];
-/*the first byte of an IP fragment is aligned on an 8-byte boundary */
+/* The datagram that the fragment being processed belongs to. */
+static struct uip_reass_ctx *reass_ctx;
 
 static const uint8_t bitmap_bits[8] = {0xff, 0x7f, 0x3f, 0x1f,
                                     0x0f, 0x07, 0x03, 0x01};
-static uint16_t uip_reasslen;
-static uint8_t uip_reassflags;
+static uint8_t uip_reass_error;
 
 #define UIP_REASS_FLAG_LASTFRAG 0x01
 #define UIP_REASS_FLAG_FIRSTFRAG 0x02
-#define UIP_REASS_FLAG_ERROR_MSG 0x04
 
 
 /*
@@ -654,14 +710,40 @@ static uint8_t uip_reassflags;
  */
 
 
-struct etimer uip_reass_timer; /**< Timer for reassembly */
-uint8_t uip_reass_on; /* equal to 1 if we are currently reassembling a packet */
+struct etimer uip_reass_timer; /**< Timer for reassembly, set to the
+                                    earliest timeout of all datagrams */
 
-static uint32_t uip_id; /* For every packet that is to be fragmented, the source
-                        node generates an Identification value that is present
-                        in all the fragments */
 #define IP_MF   0x0001
 
+/*---------------------------------------------------------------------------*/
+static void
+reass_timer_update(void)
+{
+  struct uip_reass_ctx *ctx;
+  clock_time_t remaining, earliest;
+
+  if(list_head(reass_list) == NULL) {
+    etimer_stop(&uip_reass_timer);
+    return;
+  }
+  earliest = UIP_REASS_MAXAGE * CLOCK_SECOND;
+  for(ctx = list_head(reass_list); ctx != NULL; ctx = list_item_next(ctx)) {
+    remaining = timer_expired(&ctx->timer) ? 0 : timer_remaining(&ctx->timer);
+    if(remaining < earliest) {
+      earliest = remaining;
+    }
+  }
+  etimer_set(&uip_reass_timer, earliest > 0 ? earliest : 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+reass_free(struct uip_reass_ctx *ctx)
+{
+  list_remove(reass_list, ctx);
+  memb_free(&reass_memb, ctx);
+  reass_timer_update();
+}
+/*---------------------------------------------------------------------------*/
 static uint16_t
 uip_reass(void)
 {
@@ -669,154 +751,168 @@ uip_reass(void)
   uint16_t len;
   uint16_t i;
 
-  /* If ip_reasstmr is zero, no packet is present in the buffer */
-  /* We first write the unfragmentable part of IP header into the reassembly
-     buffer. The reset the other reassembly variables. */
-  if(uip_reass_on == 0) {
+  uip_reass_error = 0;
+
+  /* Find the datagram that the fragment belongs to. */
+  for(reass_ctx = list_head(reass_list);
+      reass_ctx != NULL;
+      reass_ctx = list_item_next(reass_ctx)) {
+    if(uip_ipaddr_cmp(&FBUF->srcipaddr, &UIP_IP_BUF->srcipaddr) &&
+       uip_ipaddr_cmp(&FBUF->destipaddr, &UIP_IP_BUF->destipaddr) &&
+       UIP_FRAG_BUF->id == reass_ctx->id) {
+      break;
+    }
+  }
+
+  /* If there is none, we start a new one. We first write the
+     unfragmentable part of IP header into the reassembly buffer, then
+     reset the other reassembly variables. */
+  if(reass_ctx == NULL) {
+    reass_ctx = memb_alloc(&reass_memb);
+    if(reass_ctx == NULL) {
+      PRINTF("Already reassembling too many paquets\n");
+      return 0;
+    }
     PRINTF("Starting reassembly\n");
     memcpy(FBUF, UIP_IP_BUF, uip_ext_len + UIP_IPH_LEN);
     /* temporary in case we do not receive the fragment with offset 0 first */
-    etimer_set(&uip_reass_timer, UIP_REASS_MAXAGE*CLOCK_SECOND);
-    uip_reass_on = 1;
-    uip_reassflags = 0;
-    uip_id = UIP_FRAG_BUF->id;
+    timer_set(&reass_ctx->timer, UIP_REASS_MAXAGE * CLOCK_SECOND);
+    reass_ctx->flags = 0;
+    reass_ctx->id = UIP_FRAG_BUF->id;
     /* Clear the bitmap. */
-    memset(uip_reassbitmap, 0, sizeof(uip_reassbitmap));
+    memset(reass_ctx->bitmap, 0, sizeof(reass_ctx->bitmap));
+    list_add(reass_list, reass_ctx);
+    reass_timer_update();
   }
-  /*
-   * Check if the incoming fragment matches the one currently present
-   * in the reasembly buffer. If so, we proceed with copying the fragment
-   * into the buffer.
-   */
-  if(uip_ipaddr_cmp(&FBUF->srcipaddr, &UIP_IP_BUF->srcipaddr) &&
-     uip_ipaddr_cmp(&FBUF->destipaddr, &UIP_IP_BUF->destipaddr) &&
-     UIP_FRAG_BUF->id == uip_id) {
-    len = uip_len - uip_ext_len - UIP_IPH_LEN - UIP_FRAGH_LEN;
-    offset = (uip_ntohs(UIP_FRAG_BUF->offsetresmore) & 0xfff8);
-    /* in byte, originaly in multiple of 8 bytes*/
-    PRINTF("len %d\n", len);
-    PRINTF("offset %d\n", offset);
-    if(offset == 0){
-      uip_reassflags |= UIP_REASS_FLAG_FIRSTFRAG;
-      /*
-       * The Next Header field of the last header of the Unfragmentable
-       * Part is obtained from the Next Header field of the first
-       * fragment's Fragment header.
-       */
-      *uip_next_hdr = UIP_FRAG_BUF->next;
-      memcpy(FBUF, UIP_IP_BUF, uip_ext_len + UIP_IPH_LEN);
-      PRINTF("src ");
-      PRINT6ADDR(&FBUF->srcipaddr);
-      PRINTF("dest ");
-      PRINT6ADDR(&FBUF->destipaddr);
-      PRINTF("next %d\n", UIP_IP_BUF->proto);
 
-    }
+  len = uip_len - uip_ext_len - UIP_IPH_LEN - UIP_FRAGH_LEN;
+  offset = (uip_ntohs(UIP_FRAG_BUF->offsetresmore) & 0xfff8);
+  /* in byte, originaly in multiple of 8 bytes*/
+  PRINTF("len %d\n", len);
+  PRINTF("offset %d\n", offset);
+  if(offset == 0){
+    reass_ctx->flags |= UIP_REASS_FLAG_FIRSTFRAG;
+    /*
+     * The Next Header field of the last header of the Unfragmentable
+     * Part is obtained from the Next Header field of the first
+     * fragment's Fragment header.
+     */
+    *uip_next_hdr = UIP_FRAG_BUF->next;
+    memcpy(FBUF, UIP_IP_BUF, uip_ext_len + UIP_IPH_LEN);
+    PRINTF("src ");
+    PRINT6ADDR(&FBUF->srcipaddr);
+    PRINTF("dest ");
+    PRINT6ADDR(&FBUF->destipaddr);
+    PRINTF("next %d\n", UIP_IP_BUF->proto);
 
-    /* If the offset or the offset + fragment length overflows the
-       reassembly buffer, we discard the entire packet. */
-    if(offset > UIP_REASS_BUFSIZE ||
-       offset + len > UIP_REASS_BUFSIZE) {
-      uip_reass_on = 0;
-      etimer_stop(&uip_reass_timer);
-      return 0;
-    }
+  }
 
-    /* If this fragment has the More Fragments flag set to zero, it is the
-       last fragment*/
-    if((uip_ntohs(UIP_FRAG_BUF->offsetresmore) & IP_MF) == 0) {
-      uip_reassflags |= UIP_REASS_FLAG_LASTFRAG;
-      /*calculate the size of the entire packet*/
-      uip_reasslen = offset + len;
-      PRINTF("LAST FRAGMENT reasslen %d\n", uip_reasslen);
-    } else {
-      /* If len is not a multiple of 8 octets and the M flag of that fragment
-         is 1, then that fragment must be discarded and an ICMP Parameter
-         Problem, Code 0, message should be sent to the source of the fragment,
-         pointing to the Payload Length field of the fragment packet. */
-      if(len % 8 != 0){
-        uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, 4);
-        uip_reassflags |= UIP_REASS_FLAG_ERROR_MSG;
-        /* not clear if we should interrupt reassembly, but it seems so from
-           the conformance tests */
-        uip_reass_on = 0;
-        etimer_stop(&uip_reass_timer);
-        return uip_len;
-      }
+  /* If the offset or the offset + fragment length overflows the
+     reassembly buffer, we discard the entire packet. */
+  if(offset > UIP_REASS_BUFSIZE ||
+     offset + len > UIP_REASS_BUFSIZE) {
+    reass_free(reass_ctx);
+    return 0;
+  }
+
+  /* If this fragment has the More Fragments flag set to zero, it is the
+     last fragment*/
+  if((uip_ntohs(UIP_FRAG_BUF->offsetresmore) & IP_MF) == 0) {
+    reass_ctx->flags |= UIP_REASS_FLAG_LASTFRAG;
+    /*calculate the size of the entire packet*/
+    reass_ctx->len = offset + len;
+    PRINTF("LAST FRAGMENT reasslen %d\n", reass_ctx->len);
+  } else {
+    /* If len is not a multiple of 8 octets and the M flag of that fragment
+       is 1, then that fragment must be discarded and an ICMP Parameter
+       Problem, Code 0, message should be sent to the source of the fragment,
+       pointing to the Payload Length field of the fragment packet. */
+    if(len % 8 != 0){
+      uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, 4);
+      uip_reass_error = 1;
+      /* not clear if we should interrupt reassembly, but it seems so from
+         the conformance tests */
+      reass_free(reass_ctx);
+      return uip_len;
     }
+  }
 
-    /* Copy the fragment into the reassembly buffer, at the right
-       offset. */
-    memcpy((uint8_t *)FBUF + UIP_IPH_LEN + uip_ext_len + offset,
-           (uint8_t *)UIP_FRAG_BUF + UIP_FRAGH_LEN, len);
+  /* Copy the fragment into the reassembly buffer, at the right
+     offset. */
+  memcpy((uint8_t *)FBUF + UIP_IPH_LEN + uip_ext_len + offset,
+         (uint8_t *)UIP_FRAG_BUF + UIP_FRAGH_LEN, len);
 
-    /* Update the bitmap. */
-    if(offset >> 6 == (offset + len) >> 6) {
-      uip_reassbitmap[offset >> 6] |=
-        bitmap_bits[(offset >> 3) & 7] &
-        ~bitmap_bits[((offset + len) >> 3)  & 7];
-    } else {
-      /* If the two endpoints are in different bytes, we update the
-         bytes in the endpoints and fill the stuff inbetween with
-         0xff. */
-      uip_reassbitmap[offset >> 6] |= bitmap_bits[(offset >> 3) & 7];
+  /* Update the bitmap. */
+  if(offset >> 6 == (offset + len) >> 6) {
+    reass_ctx->bitmap[offset >> 6] |=
+      bitmap_bits[(offset >> 3) & 7] &
+      ~bitmap_bits[((offset + len) >> 3)  & 7];
+  } else {
+    /* If the two endpoints are in different bytes, we update the
+       bytes in the endpoints and fill the stuff inbetween with
+       0xff. */
+    reass_ctx->bitmap[offset >> 6] |= bitmap_bits[(offset >> 3) & 7];
 
-      for(i = (1 + (offset >> 6)); i < ((offset + len) >> 6); ++i) {
-        uip_reassbitmap[i] = 0xff;
-      }
-      uip_reassbitmap[(offset + len) >> 6] |=
-        ~bitmap_bits[((offset + len) >> 3) & 7];
+    for(i = (1 + (offset >> 6)); i < ((offset + len) >> 6); ++i) {
+      reass_ctx->bitmap[i] = 0xff;
     }
+    reass_ctx->bitmap[(offset + len) >> 6] |=
+      ~bitmap_bits[((offset + len) >> 3) & 7];
+  }
 
-    /* Finally, we check if we have a full packet in the buffer. We do
-       this by checking if we have the last fragment and if all bits
-       in the bitmap are set. */
+  /* Finally, we check if we have a full packet in the buffer. We do
+     this by checking if we have the last fragment and if all bits
+     in the bitmap are set. */
 
-    if(uip_reassflags & UIP_REASS_FLAG_LASTFRAG) {
-      /* Check all bytes up to and including all but the last byte in
-         the bitmap. */
-      for(i = 0; i < (uip_reasslen >> 6); ++i) {
-        if(uip_reassbitmap[i] != 0xff) {
-          return 0;
-        }
-      }
-      /* Check the last byte in the bitmap. It should contain just the
-         right amount of bits. */
-      if(uip_reassbitmap[uip_reasslen >> 6] !=
-         (uint8_t)~bitmap_bits[(uip_reasslen >> 3) & 7]) {
+  if(reass_ctx->flags & UIP_REASS_FLAG_LASTFRAG) {
+    /* Check all bytes up to and including all but the last byte in
+       the bitmap. */
+    for(i = 0; i < (reass_ctx->len >> 6); ++i) {
+      if(reass_ctx->bitmap[i] != 0xff) {
         return 0;
       }
+    }
+    /* Check the last byte in the bitmap. It should contain just the
+       right amount of bits. */
+    if(reass_ctx->bitmap[reass_ctx->len >> 6] !=
+       (uint8_t)~bitmap_bits[(reass_ctx->len >> 3) & 7]) {
+      return 0;
+    }
 
-     /* If we have come this far, we have a full packet in the
-         buffer, so we copy it to uip_buf. We also reset the timer. */
-      uip_reass_on = 0;
-      etimer_stop(&uip_reass_timer);
-
-      uip_reasslen += UIP_IPH_LEN + uip_ext_len;
-      memcpy(UIP_IP_BUF, FBUF, uip_reasslen);
-      UIP_IP_BUF->len[0] = ((uip_reasslen - UIP_IPH_LEN) >> 8);
-      UIP_IP_BUF->len[1] = ((uip_reasslen - UIP_IPH_LEN) & 0xff);
-      PRINTF("REASSEMBLED PAQUET %d (%d)\n", uip_reasslen,
-             (UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]);
+    /* If we have come this far, we have a full packet in the
+       buffer, so we copy it to uip_buf. We also free the context. */
+    len = reass_ctx->len + UIP_IPH_LEN + uip_ext_len;
+    memcpy(UIP_IP_BUF, FBUF, len);
+    reass_free(reass_ctx);
+    UIP_IP_BUF->len[0] = ((len - UIP_IPH_LEN) >> 8);
+    UIP_IP_BUF->len[1] = ((len - UIP_IPH_LEN) & 0xff);
+    PRINTF("REASSEMBLED PAQUET %d (%d)\n", len,
+           (UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]);
 
-      return uip_reasslen;
+    return len;
 
-    }
-  } else {
-    PRINTF("Already reassembling another paquet\n");
   }
   return 0;
 }
-
+/*---------------------------------------------------------------------------*/
 void
 uip_reass_over(void)
 {
-   /* to late, we abandon the reassembly of the packet */
-
-  uip_reass_on = 0;
-  etimer_stop(&uip_reass_timer);
+  /* to late, we abandon the reassembly of the packets that have timed
+     out */
+  for(reass_ctx = list_head(reass_list);
+      reass_ctx != NULL;
+      reass_ctx = list_item_next(reass_ctx)) {
+    if(timer_expired(&reass_ctx->timer)) {
+      break;
+    }
+  }
+  if(reass_ctx == NULL) {
+    reass_timer_update();
+    return;
+  }
 
-  if(uip_reassflags & UIP_REASS_FLAG_FIRSTFRAG){
+  if(reass_ctx->flags & UIP_REASS_FLAG_FIRSTFRAG){
     PRINTF("FRAG INTERRUPTED TOO LATE\n");
     /* If the first fragment has been received, an ICMP Time Exceeded
        -- Fragment Reassembly Time Exceeded message should be sent to the
@@ -835,6 +931,11 @@ uip_reass_over(void)
     UIP_STAT(++uip_stat.ip.sent);
     uip_flags = 0;
   }
+
+  /* Any other datagram that has timed out is handled when the timer
+     fires again, right away, as only one error message fits in
+     uip_buf. */
+  reass_free(reass_ctx);
 }
 
 #endif /* UIP_CONF_IPV6_REASSEMBLY */
@@ -852,6 +953,33 @@ uip_add_rcv_nxt(uint16_t n)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP && UIP_TCP_SEGMENTS > 1
+uint16_t
+uip_tcp_sendable(struct uip_conn *conn)
+{
+  uint16_t wnd;
+
+  wnd = conn->snd_wnd;
+  if(wnd > UIP_TCP_SEGMENTS * conn->initialmss) {
+    wnd = UIP_TCP_SEGMENTS * conn->initialmss;
+  }
+  if(conn->len >= wnd) {
+    /* As without a sliding window, one segment may always be sent when
+       nothing is outstanding, also into a zero window. */
+    return conn->len == 0 ? conn->initialmss : 0;
+  }
+  wnd -= conn->len;
+  return wnd > conn->initialmss ? conn->initialmss : wnd;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+seq32(const uint8_t *seq)
+{
+  return ((uint32_t)seq[0] << 24) | ((uint32_t)seq[1] << 16) |
+    ((uint32_t)seq[2] << 8) | seq[3];
+}
+#endif /* UIP_TCP && UIP_TCP_SEGMENTS > 1 */
+/*---------------------------------------------------------------------------*/
 
 /**
  * \brief Process the options in Destination and Hop By Hop extension headers
@@ -942,6 +1070,11 @@ uip_process(uint8_t flag)
 {
 #if UIP_TCP
   register struct uip_conn *uip_connr = uip_conn;
+#if UIP_TCP_SEGMENTS > 1
+  uint32_t acked;
+
+  tcp_seq_offset = 0;
+#endif /* UIP_TCP_SEGMENTS > 1 */
 #endif /* UIP_TCP */
 #if UIP_UDP
   if(flag == UIP_UDP_SEND_CONN) {
@@ -955,7 +1088,11 @@ uip_process(uint8_t flag)
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+#if UIP_TCP_SEGMENTS > 1
+       uip_tcp_sendable(uip_connr) > 0) {
+#else /* UIP_TCP_SEGMENTS > 1 */
        !uip_outstanding(uip_connr)) {
+#endif /* UIP_TCP_SEGMENTS > 1 */
       uip_flags = UIP_POLL;
       UIP_APPCALL();
       goto appsend;
@@ -1058,16 +1195,40 @@ uip_process(uint8_t flag)
                * label).
                */
               uip_flags = UIP_REXMIT;
+#if UIP_TCP_SEGMENTS > 1
+              /* Go back to the oldest unacknowledged byte. The
+                 application sends one segment from there, and the rest
+                 again as new data once that has been acknowledged. */
+              uip_connr->len = 0;
+              uip_slen = 0;
               UIP_APPCALL();
+              if(uip_slen > uip_tcp_sendable(uip_connr)) {
+                uip_slen = uip_tcp_sendable(uip_connr);
+              }
+              uip_connr->len = uip_slen;
+#else /* UIP_TCP_SEGMENTS > 1 */
+              UIP_APPCALL();
+#endif /* UIP_TCP_SEGMENTS > 1 */
               goto apprexmit;
 
             case UIP_FIN_WAIT_1:
             case UIP_CLOSING:
             case UIP_LAST_ACK:
               /* In all these states we should retransmit a FINACK. */
+#if UIP_TCP_SEGMENTS > 1
+              tcp_seq_offset = uip_connr->len - 1;
+#endif /* UIP_TCP_SEGMENTS > 1 */
               goto tcp_send_finack;
           }
         }
+#if UIP_TCP_SEGMENTS > 1
+      } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+                uip_tcp_sendable(uip_connr) > 0) {
+        /* There is room in the window for more data. */
+        uip_flags = UIP_POLL;
+        UIP_APPCALL();
+        goto appsend;
+#endif /* UIP_TCP_SEGMENTS > 1 */
       } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
         /*
          * If there was no need for a retransmission, we poll the
@@ -1077,6 +1238,12 @@ uip_process(uint8_t flag)
         UIP_APPCALL();
         goto appsend;
       }
+#if UIP_TCP_DELAYED_ACK
+      /* The delayed acknowledgement is due. */
+      if(uip_connr->ackpending) {
+        goto tcp_send_ack;
+      }
+#endif /* UIP_TCP_DELAYED_ACK */
     }
     goto drop;
 #endif /* UIP_TCP */
@@ -1367,6 +1534,20 @@ uip_process(uint8_t flag)
 
         PRINTF("Processing Routing header\n");
         if(UIP_ROUTING_BUF->seg_left > 0) {
+#if UIP_CONF_IPV6_RPL
+          /* A RPL source route: forward to the next address */
+          if(rpl_process_srh_header()) {
+            if(UIP_IP_BUF->ttl <= 1) {
+              uip_icmp6_error_output(ICMP6_TIME_EXCEEDED,
+                                     ICMP6_TIME_EXCEED_TRANSIT, 0);
+              UIP_STAT(++uip_stat.ip.drop);
+              goto send;
+            }
+            UIP_IP_BUF->ttl = UIP_IP_BUF->ttl - 1;
+            UIP_STAT(++uip_stat.ip.forwarded);
+            goto send;
+          }
+#endif /* UIP_CONF_IPV6_RPL */
           uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, UIP_IPH_LEN + uip_ext_len + 2);
           UIP_STAT(++uip_stat.ip.drop);
           UIP_LOG("ip6: unrecognized routing type");
@@ -1383,7 +1564,7 @@ uip_process(uint8_t flag)
         if(uip_len == 0) {
           goto drop;
         }
-        if(uip_reassflags & UIP_REASS_FLAG_ERROR_MSG){
+        if(uip_reass_error){
           /* we are not done with reassembly, this is an error message */
           goto send;
         }
@@ -1506,24 +1687,45 @@ uip_process(uint8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+  /* If the local UDP port is non-zero, the connection is considered
+     to be used. If so, the local port number is checked against the
+     destination port number in the received packet. If the two port
+     numbers match, the remote port number is checked if the
+     connection is bound to a remote port. Finally, if the
+     connection is bound to a remote IP address, the source IP
+     address of the packet is checked. */
+#define UDP_CONN_MATCHES(conn)                                          \
+  ((conn)->lport != 0 &&                                                \
+   UIP_UDP_BUF->destport == (conn)->lport &&                            \
+   ((conn)->rport == 0 || UIP_UDP_BUF->srcport == (conn)->rport) &&     \
+   (uip_is_addr_unspecified(&(conn)->ripaddr) ||                        \
+    uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &(conn)->ripaddr)))
+#if UIP_DEMUX_HASH
+  demux_bucket = demux_hash(UIP_UDP_BUF->destport, 0, NULL);
+  if(udp_hints[demux_bucket] != DEMUX_NONE) {
+    uip_udp_conn = &uip_udp_conns[udp_hints[demux_bucket]];
+    if(UDP_CONN_MATCHES(uip_udp_conn)) {
+      goto udp_found;
+    }
+  }
+  c = 0;
+#endif /* UIP_DEMUX_HASH */
   for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
-    /* If the local UDP port is non-zero, the connection is considered
-       to be used. If so, the local port number is checked against the
-       destination port number in the received packet. If the two port
-       numbers match, the remote port number is checked if the
-       connection is bound to a remote port. Finally, if the
-       connection is bound to a remote IP address, the source IP
-       address of the packet is checked. */
-    if(uip_udp_conn->lport != 0 &&
-       UIP_UDP_BUF->destport == uip_udp_conn->lport &&
-       (uip_udp_conn->rport == 0 ||
-        UIP_UDP_BUF->srcport == uip_udp_conn->rport) &&
-       (uip_is_addr_unspecified(&uip_udp_conn->ripaddr) ||
-        uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &uip_udp_conn->ripaddr))) {
+    if(UDP_CONN_MATCHES(uip_udp_conn)) {
+#if UIP_DEMUX_HASH
+      if(!c) {
+        udp_hints[demux_bucket] = uip_udp_conn - uip_udp_conns;
+      }
+#endif /* UIP_DEMUX_HASH */
       goto udp_found;
     }
+#if UIP_DEMUX_HASH
+    if(uip_udp_conn->lport == UIP_UDP_BUF->destport) {
+      c = 1;
+    }
+#endif /* UIP_DEMUX_HASH */
   }
   PRINTF("udp: no matching connection found\n");
   UIP_STAT(++uip_stat.udp.drop);
@@ -1615,12 +1817,27 @@ uip_process(uint8_t flag)
 
   /* Demultiplex this segment. */
   /* First check any active connections. */
+#define TCP_CONN_MATCHES(conn)                                          \
+  ((conn)->tcpstateflags != UIP_CLOSED &&                               \
+   UIP_TCP_BUF->destport == (conn)->lport &&                            \
+   UIP_TCP_BUF->srcport == (conn)->rport &&                             \
+   uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &(conn)->ripaddr))
+#if UIP_DEMUX_HASH
+  demux_bucket = demux_hash(UIP_TCP_BUF->destport, UIP_TCP_BUF->srcport,
+                            &UIP_IP_BUF->srcipaddr);
+  if(tcp_hints[demux_bucket] != DEMUX_NONE) {
+    uip_connr = &uip_conns[tcp_hints[demux_bucket]];
+    if(TCP_CONN_MATCHES(uip_connr)) {
+      goto found;
+    }
+  }
+#endif /* UIP_DEMUX_HASH */
   for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
       ++uip_connr) {
-    if(uip_connr->tcpstateflags != UIP_CLOSED &&
-       UIP_TCP_BUF->destport == uip_connr->lport &&
-       UIP_TCP_BUF->srcport == uip_connr->rport &&
-       uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &uip_connr->ripaddr)) {
+    if(TCP_CONN_MATCHES(uip_connr)) {
+#if UIP_DEMUX_HASH
+      tcp_hints[demux_bucket] = uip_connr - uip_conns;
+#endif /* UIP_DEMUX_HASH */
       goto found;
     }
   }
@@ -1746,6 +1963,12 @@ uip_process(uint8_t flag)
   uip_connr->snd_nxt[2] = iss[2];
   uip_connr->snd_nxt[3] = iss[3];
   uip_connr->len = 1;
+#if UIP_TCP_SEGMENTS > 1
+  uip_connr->snd_wnd = 0;
+#endif /* UIP_TCP_SEGMENTS > 1 */
+#if UIP_TCP_DELAYED_ACK
+  uip_connr->ackpending = 0;
+#endif /* UIP_TCP_DELAYED_ACK */
 
   /* rcv_nxt should be the seqno from the incoming packet + 1. */
   uip_connr->rcv_nxt[0] = UIP_TCP_BUF->seqno[0];
@@ -1864,12 +2087,20 @@ uip_process(uint8_t flag)
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
+#if UIP_TCP_SEGMENTS > 1
+    /* Acknowledgements are cumulative, so any part of the outstanding
+       data may be acknowledged. */
+    acked = seq32(UIP_TCP_BUF->ackno) - seq32(uip_connr->snd_nxt);
+    if(acked > 0 && acked <= uip_connr->len) {
+      uip_add32(uip_connr->snd_nxt, acked);
+#else /* UIP_TCP_SEGMENTS > 1 */
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
     if(UIP_TCP_BUF->ackno[0] == uip_acc32[0] &&
        UIP_TCP_BUF->ackno[1] == uip_acc32[1] &&
        UIP_TCP_BUF->ackno[2] == uip_acc32[2] &&
        UIP_TCP_BUF->ackno[3] == uip_acc32[3]) {
+#endif /* UIP_TCP_SEGMENTS > 1 */
       /* Update sequence number. */
       uip_connr->snd_nxt[0] = uip_acc32[0];
       uip_connr->snd_nxt[1] = uip_acc32[1];
@@ -1897,11 +2128,22 @@ uip_process(uint8_t flag)
       uip_connr->timer = uip_connr->rto;
 
       /* Reset length of outstanding data. */
+#if UIP_TCP_SEGMENTS > 1
+      uip_connr->len -= acked;
+#else /* UIP_TCP_SEGMENTS > 1 */
       uip_connr->len = 0;
+#endif /* UIP_TCP_SEGMENTS > 1 */
     }
 
   }
 
+#if UIP_TCP_SEGMENTS > 1
+  if(UIP_TCP_BUF->flags & TCP_ACK) {
+    uip_connr->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+      UIP_TCP_BUF->wnd[1];
+  }
+#endif /* UIP_TCP_SEGMENTS > 1 */
+
   /* Do different things depending on in what state the connection is. */
   switch(uip_connr->tcpstateflags & UIP_TS_MASK) {
     /* CLOSED and LISTEN are not handled here. CLOSE_WAIT is not
@@ -2103,7 +2345,13 @@ uip_process(uint8_t flag)
 
         if(uip_flags & UIP_CLOSE) {
           uip_slen = 0;
+#if UIP_TCP_SEGMENTS > 1
+          /* The FIN follows any data still in transit. */
+          tcp_seq_offset = uip_connr->len;
+          uip_connr->len += 1;
+#else /* UIP_TCP_SEGMENTS > 1 */
           uip_connr->len = 1;
+#endif /* UIP_TCP_SEGMENTS > 1 */
           uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
           uip_connr->nrtx = 0;
           UIP_TCP_BUF->flags = TCP_FIN | TCP_ACK;
@@ -2111,6 +2359,17 @@ uip_process(uint8_t flag)
         }
 
         /* If uip_slen > 0, the application has data to be sent. */
+#if UIP_TCP_SEGMENTS > 1
+        if(uip_slen > 0) {
+          /* New data goes after the data that is already in transit,
+             as far as the window allows. */
+          if(uip_slen > uip_tcp_sendable(uip_connr)) {
+            uip_slen = uip_tcp_sendable(uip_connr);
+          }
+          tcp_seq_offset = uip_connr->len;
+          uip_connr->len += uip_slen;
+        }
+#else /* UIP_TCP_SEGMENTS > 1 */
         if(uip_slen > 0) {
 
           /* If the connection has acknowledged data, the contents of
@@ -2142,6 +2401,7 @@ uip_process(uint8_t flag)
             uip_slen = uip_connr->len;
           }
         }
+#endif /* UIP_TCP_SEGMENTS > 1 */
         uip_connr->nrtx = 0;
       apprexmit:
         uip_appdata = uip_sappdata;
@@ -2150,7 +2410,11 @@ uip_process(uint8_t flag)
            packet had new data in it, we must send out a packet. */
         if(uip_slen > 0 && uip_connr->len > 0) {
           /* Add the length of the IP and TCP headers. */
+#if UIP_TCP_SEGMENTS > 1
+          uip_len = uip_slen + UIP_TCPIP_HLEN;
+#else /* UIP_TCP_SEGMENTS > 1 */
           uip_len = uip_connr->len + UIP_TCPIP_HLEN;
+#endif /* UIP_TCP_SEGMENTS > 1 */
           /* We always set the ACK flag in response packets. */
           UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
           /* Send the packet. */
@@ -2159,10 +2423,23 @@ uip_process(uint8_t flag)
         /* If there is no data to send, just send out a pure ACK if
            there is newdata. */
         if(uip_flags & UIP_NEWDATA) {
+#if UIP_TCP_DELAYED_ACK
+          /* Acknowledge every second segment right away, and leave the
+             others to the next data segment or the periodic timer. */
+          if(!uip_connr->ackpending) {
+            uip_connr->ackpending = 1;
+            goto drop;
+          }
+#endif /* UIP_TCP_DELAYED_ACK */
           uip_len = UIP_TCPIP_HLEN;
           UIP_TCP_BUF->flags = TCP_ACK;
           goto tcp_send_noopts;
         }
+#if UIP_TCP_DELAYED_ACK
+        if(uip_connr->ackpending && flag == UIP_TIMER) {
+          goto tcp_send_ack;
+        }
+#endif /* UIP_TCP_DELAYED_ACK */
       }
       goto drop;
     case UIP_LAST_ACK:
@@ -2254,11 +2531,25 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->ackno[1] = uip_connr->rcv_nxt[1];
   UIP_TCP_BUF->ackno[2] = uip_connr->rcv_nxt[2];
   UIP_TCP_BUF->ackno[3] = uip_connr->rcv_nxt[3];
+#if UIP_TCP_DELAYED_ACK
+  /* Every segment sent on the connection acknowledges what has been
+     received. */
+  uip_connr->ackpending = 0;
+#endif /* UIP_TCP_DELAYED_ACK */
 
   UIP_TCP_BUF->seqno[0] = uip_connr->snd_nxt[0];
   UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#if UIP_TCP_SEGMENTS > 1
+  if(tcp_seq_offset > 0) {
+    uip_add32(UIP_TCP_BUF->seqno, tcp_seq_offset);
+    UIP_TCP_BUF->seqno[0] = uip_acc32[0];
+    UIP_TCP_BUF->seqno[1] = uip_acc32[1];
+    UIP_TCP_BUF->seqno[2] = uip_acc32[2];
+    UIP_TCP_BUF->seqno[3] = uip_acc32[3];
+  }
+#endif /* UIP_TCP_SEGMENTS > 1 */
 
   UIP_TCP_BUF->srcport  = uip_connr->lport;
   UIP_TCP_BUF->destport = uip_connr->rport;
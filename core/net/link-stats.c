@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Airtime and transmission counts per link-layer neighbor
+ */
+
+#include "net/link-stats.h"
+
+#if LINK_STATS_ENABLED
+
+#include "net/mac/mac.h"
+#include "sys/ctimer.h"
+#include <stdio.h>
+#include <string.h>
+
+NBR_TABLE_GLOBAL(struct link_stats, link_stats);
+
+static struct link_stats broadcast_stats;
+static uint32_t total_airtime;
+static struct ctimer freshness_timer;
+
+/*---------------------------------------------------------------------------*/
+static uint32_t
+airtime(uint16_t len)
+{
+  return (uint32_t)(len + LINK_STATS_PHY_OVERHEAD) * LINK_STATS_BYTE_TIME;
+}
+/*---------------------------------------------------------------------------*/
+/* Neighbors the node sends to are usually in the table already, added
+   by IPv6 neighbor discovery or RPL, so that this rarely allocates */
+static struct link_stats *
+get(const linkaddr_t *lladdr, int add)
+{
+  struct link_stats *stats;
+
+  if(lladdr == NULL || linkaddr_cmp(lladdr, &linkaddr_null)) {
+    return &broadcast_stats;
+  }
+  stats = nbr_table_get_from_lladdr(link_stats, lladdr);
+  if(stats == NULL && add) {
+    stats = nbr_table_add_lladdr(link_stats, lladdr);
+  }
+  return stats;
+}
+/*---------------------------------------------------------------------------*/
+static void
+freshness_decay(void *ptr)
+{
+  struct link_stats *stats;
+
+  for(stats = nbr_table_head(link_stats); stats != NULL;
+      stats = nbr_table_next(link_stats, stats)) {
+    stats->freshness >>= 1;
+  }
+  ctimer_reset(&freshness_timer);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_init(void)
+{
+  nbr_table_register(link_stats, NULL);
+  ctimer_set(&freshness_timer, LINK_STATS_FRESHNESS_HALF_LIFE,
+             freshness_decay, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_transmission(const linkaddr_t *dest, uint16_t len, uint16_t count)
+{
+  struct link_stats *stats;
+  uint32_t t;
+
+  if(count == 0) {
+    return;
+  }
+  t = airtime(len) * count;
+  total_airtime += t;
+  stats = get(dest, 1);
+  if(stats != NULL) {
+    stats->tx_airtime += t;
+    stats->tx_frames += count;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_packet_sent(const linkaddr_t *dest, int status, int numtx)
+{
+  struct link_stats *stats;
+  uint16_t packet_etx;
+
+  stats = get(dest, 1);
+  if(stats == NULL) {
+    return;
+  }
+  stats->tx_packets++;
+  if(stats == &broadcast_stats) {
+    return;
+  }
+  if(status == MAC_TX_OK) {
+    stats->tx_acked++;
+  }
+
+  /* Collisions and transmission errors say nothing about the link */
+  if(status != MAC_TX_OK && status != MAC_TX_NOACK) {
+    return;
+  }
+  if(status == MAC_TX_NOACK) {
+    packet_etx = LINK_STATS_ETX_NOACK_PENALTY * LINK_STATS_ETX_DIVISOR;
+  } else {
+    packet_etx = numtx * LINK_STATS_ETX_DIVISOR;
+  }
+  if(stats->etx == 0) {
+    stats->etx = packet_etx;
+  } else {
+    stats->etx = ((uint32_t)stats->etx * LINK_STATS_ETX_ALPHA +
+                  (uint32_t)packet_etx * (100 - LINK_STATS_ETX_ALPHA)) / 100;
+  }
+  if(stats->freshness < LINK_STATS_FRESHNESS_MAX) {
+    stats->freshness++;
+  }
+  stats->last_tx_time = clock_time();
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_input(const linkaddr_t *src, uint16_t len, int16_t rssi)
+{
+  struct link_stats *stats;
+
+  stats = get(src, 0);
+  if(stats != NULL && stats != &broadcast_stats) {
+    stats->rx_airtime += airtime(len);
+    if(stats->rx_frames == 0) {
+      stats->rssi = rssi;
+    } else {
+      stats->rssi = ((int32_t)stats->rssi * LINK_STATS_RSSI_ALPHA +
+                     (int32_t)rssi * (100 - LINK_STATS_RSSI_ALPHA)) / 100;
+    }
+    stats->rx_frames++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+link_stats_is_fresh(const struct link_stats *stats)
+{
+  return stats != NULL && stats->etx != 0 &&
+    stats->freshness >= LINK_STATS_FRESHNESS_TARGET &&
+    clock_time() - stats->last_tx_time < LINK_STATS_FRESHNESS_EXPIRATION;
+}
+/*---------------------------------------------------------------------------*/
+const struct link_stats *
+link_stats_from_lladdr(const linkaddr_t *lladdr)
+{
+  return get(lladdr, 0);
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+link_stats_total_airtime(void)
+{
+  return total_airtime;
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_reset(void)
+{
+  struct link_stats *stats;
+
+  for(stats = nbr_table_head(link_stats); stats != NULL;
+      stats = nbr_table_next(link_stats, stats)) {
+    memset(stats, 0, sizeof(struct link_stats));
+  }
+  memset(&broadcast_stats, 0, sizeof(broadcast_stats));
+  total_airtime = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_stats(const struct link_stats *stats)
+{
+  printf(" tx %lu %lu pkts %u %u rx %u %lu etx %u.%02u rssi %d fresh %u\n",
+         (unsigned long)stats->tx_frames, (unsigned long)stats->tx_airtime,
+         stats->tx_packets, stats->tx_acked,
+         stats->rx_frames, (unsigned long)stats->rx_airtime,
+         stats->etx / LINK_STATS_ETX_DIVISOR,
+         (stats->etx % LINK_STATS_ETX_DIVISOR) * 100 / LINK_STATS_ETX_DIVISOR,
+         stats->rssi, stats->freshness);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_print(void)
+{
+  struct link_stats *stats;
+  const linkaddr_t *lladdr;
+  int i;
+
+  printf("LS total %lu\n", (unsigned long)total_airtime);
+  for(stats = nbr_table_head(link_stats); stats != NULL;
+      stats = nbr_table_next(link_stats, stats)) {
+    lladdr = nbr_table_get_lladdr(link_stats, stats);
+    printf("LS ");
+    for(i = 0; i < LINKADDR_SIZE; i++) {
+      printf("%s%02x", i > 0 ? ":" : "", lladdr->u8[i]);
+    }
+    print_stats(stats);
+  }
+  printf("LS bcast");
+  print_stats(&broadcast_stats);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* LINK_STATS_ENABLED */
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Airtime and transmission counts per link-layer neighbor
+ *
+ *         Energest tells how long the radio has been transmitting, but
+ *         not to whom. With LINK_STATS_CONF_ENABLED, the duty cycling
+ *         layers report every frame they put on the air, strobes and
+ *         retransmissions included, and the MAC layers report the
+ *         outcome of every packet. These are kept per neighbor in a
+ *         neighbor table, and for broadcast in a single entry, so that
+ *         the links that cost the most airtime can be found.
+ *
+ *         The airtime of a frame is estimated from its length, as the
+ *         time to send its bytes and the PHY overhead at the data rate
+ *         of the radio. Acknowledgements are not counted.
+ *
+ *         The same entries hold the link quality of each neighbor: the
+ *         ETX as a moving average over the packet outcomes, the RSSI of
+ *         its frames, and how fresh these are. RPL takes its link
+ *         metric from here for all objective functions, rather than
+ *         each of them keeping its own estimate.
+ */
+
+#ifndef LINK_STATS_H_
+#define LINK_STATS_H_
+
+#include "contiki-conf.h"
+#include "net/linkaddr.h"
+#include "net/nbr-table.h"
+#include "sys/clock.h"
+#include <stdint.h>
+
+#ifdef LINK_STATS_CONF_ENABLED
+#define LINK_STATS_ENABLED LINK_STATS_CONF_ENABLED
+#else
+#define LINK_STATS_ENABLED 0
+#endif
+
+/* The time in microseconds to send one byte; 32 at 250 kbit/s */
+#ifdef LINK_STATS_CONF_BYTE_TIME
+#define LINK_STATS_BYTE_TIME LINK_STATS_CONF_BYTE_TIME
+#else
+#define LINK_STATS_BYTE_TIME 32
+#endif
+
+/* The bytes sent with every frame besides the ones the MAC layer
+   builds: preamble, SFD, length and FCS of IEEE 802.15.4 */
+#ifdef LINK_STATS_CONF_PHY_OVERHEAD
+#define LINK_STATS_PHY_OVERHEAD LINK_STATS_CONF_PHY_OVERHEAD
+#else
+#define LINK_STATS_PHY_OVERHEAD 8
+#endif
+
+/* ETX fixed point divisor. 128 gives an ETX up to 511 in 16 bits */
+#define LINK_STATS_ETX_DIVISOR 128
+
+/* Weight of the old ETX in the moving average, out of 100 */
+#ifdef LINK_STATS_CONF_ETX_ALPHA
+#define LINK_STATS_ETX_ALPHA LINK_STATS_CONF_ETX_ALPHA
+#else
+#define LINK_STATS_ETX_ALPHA 90
+#endif
+
+/* The ETX counted for a packet that got no acknowledgement */
+#ifdef LINK_STATS_CONF_ETX_NOACK_PENALTY
+#define LINK_STATS_ETX_NOACK_PENALTY LINK_STATS_CONF_ETX_NOACK_PENALTY
+#else
+#define LINK_STATS_ETX_NOACK_PENALTY 10
+#endif
+
+/* Weight of the old RSSI in the moving average, out of 100 */
+#ifdef LINK_STATS_CONF_RSSI_ALPHA
+#define LINK_STATS_RSSI_ALPHA LINK_STATS_CONF_RSSI_ALPHA
+#else
+#define LINK_STATS_RSSI_ALPHA 80
+#endif
+
+/* The freshness counts the recent packet outcomes. It is halved every
+   FRESHNESS_HALF_LIFE, and a link is fresh with at least
+   FRESHNESS_TARGET of them and one within FRESHNESS_EXPIRATION */
+#ifdef LINK_STATS_CONF_FRESHNESS_HALF_LIFE
+#define LINK_STATS_FRESHNESS_HALF_LIFE LINK_STATS_CONF_FRESHNESS_HALF_LIFE
+#else
+#define LINK_STATS_FRESHNESS_HALF_LIFE (20 * 60 * CLOCK_SECOND)
+#endif
+
+#ifdef LINK_STATS_CONF_FRESHNESS_TARGET
+#define LINK_STATS_FRESHNESS_TARGET LINK_STATS_CONF_FRESHNESS_TARGET
+#else
+#define LINK_STATS_FRESHNESS_TARGET 4
+#endif
+
+#define LINK_STATS_FRESHNESS_MAX 16
+
+#ifdef LINK_STATS_CONF_FRESHNESS_EXPIRATION
+#define LINK_STATS_FRESHNESS_EXPIRATION LINK_STATS_CONF_FRESHNESS_EXPIRATION
+#else
+#define LINK_STATS_FRESHNESS_EXPIRATION (10 * 60 * CLOCK_SECOND)
+#endif
+
+struct link_stats {
+  /* Microseconds spent sending frames to the neighbor */
+  uint32_t tx_airtime;
+  /* Microseconds spent by the neighbor sending frames to us */
+  uint32_t rx_airtime;
+  /* Frames sent, including strobes and retransmissions */
+  uint32_t tx_frames;
+  /* Packets handed down by the upper layers, and the ones acknowledged */
+  uint16_t tx_packets;
+  uint16_t tx_acked;
+  /* Frames received */
+  uint16_t rx_frames;
+  /* ETX with LINK_STATS_ETX_DIVISOR, 0 until a packet has been sent */
+  uint16_t etx;
+  /* RSSI of the frames received, valid once rx_frames is not 0 */
+  int16_t rssi;
+  /* Recent packet outcomes, and the time of the last one */
+  uint8_t freshness;
+  clock_time_t last_tx_time;
+};
+
+NBR_TABLE_DECLARE(link_stats);
+
+void link_stats_init(void);
+
+/* Called by the duty cycling layers when count frames of len bytes, as
+   built by the framer, have been sent to dest, which is linkaddr_null
+   for broadcast. */
+void link_stats_transmission(const linkaddr_t *dest, uint16_t len,
+                             uint16_t count);
+
+/* Called by the MAC layers when they are done with a packet to dest,
+   after numtx transmissions. Updates the ETX of unicast packets. */
+void link_stats_packet_sent(const linkaddr_t *dest, int status, int numtx);
+
+/* Called by the duty cycling layers when a frame of len bytes from src
+   has been received with the given RSSI. Only neighbors already in the
+   table are counted. */
+void link_stats_input(const linkaddr_t *src, uint16_t len, int16_t rssi);
+
+/* Whether the ETX of a neighbor is based on enough recent packets */
+int link_stats_is_fresh(const struct link_stats *stats);
+
+/* The statistics of a neighbor, or of broadcast for linkaddr_null, or
+   NULL if none have been kept */
+const struct link_stats *link_stats_from_lladdr(const linkaddr_t *lladdr);
+
+/* The airtime of all frames sent, to any neighbor or broadcast */
+uint32_t link_stats_total_airtime(void);
+
+void link_stats_reset(void);
+void link_stats_print(void);
+
+#endif /* LINK_STATS_H_ */
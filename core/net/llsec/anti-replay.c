@@ -46,9 +46,64 @@
 #include "net/llsec/anti-replay.h"
 #include "net/packetbuf.h"
 
+#if ANTI_REPLAY_PERSIST
+#include "cfs/cfs.h"
+#endif /* ANTI_REPLAY_PERSIST */
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
 /* This node's current frame counter value */
 static uint32_t counter;
 
+#if ANTI_REPLAY_PERSIST
+/* The bound stored in the file system, counter stays below it */
+static uint32_t persisted_bound;
+
+/*---------------------------------------------------------------------------*/
+static void
+persist_save(uint32_t bound)
+{
+  int fd;
+
+  /* overwritten rather than removed first: a reboot in between would
+   * lose the bound */
+  fd = cfs_open(ANTI_REPLAY_PERSIST_FILE, CFS_WRITE);
+  if(fd < 0) {
+    PRINTF("anti-replay: failed to save\n");
+    return;
+  }
+  if(cfs_write(fd, &bound, sizeof(bound)) == sizeof(bound)) {
+    persisted_bound = bound;
+  }
+  cfs_close(fd);
+}
+#endif /* ANTI_REPLAY_PERSIST */
+/*---------------------------------------------------------------------------*/
+void
+anti_replay_init(void)
+{
+#if ANTI_REPLAY_PERSIST
+  int fd;
+  uint32_t bound;
+
+  fd = cfs_open(ANTI_REPLAY_PERSIST_FILE, CFS_READ);
+  if(fd >= 0) {
+    if(cfs_read(fd, &bound, sizeof(bound)) == sizeof(bound)) {
+      /* counters up to the bound may have been used before the reboot */
+      counter = persisted_bound = bound;
+      PRINTF("anti-replay: frame counter restarts from %lu\n",
+             (unsigned long)counter);
+    }
+    cfs_close(fd);
+  }
+#endif /* ANTI_REPLAY_PERSIST */
+}
 /*---------------------------------------------------------------------------*/
 void
 anti_replay_set_counter(void)
@@ -56,6 +111,12 @@ anti_replay_set_counter(void)
   frame802154_frame_counter_t reordered_counter;
   
   ++counter;
+#if ANTI_REPLAY_PERSIST
+  if(counter >= persisted_bound) {
+    /* store the next bound before the counter reaches it */
+    persist_save(counter + ANTI_REPLAY_PERSIST_INTERVAL);
+  }
+#endif /* ANTI_REPLAY_PERSIST */
   reordered_counter.u32 = LLSEC802154_HTONL(counter);
   
   packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, reordered_counter.u16[0]);
@@ -47,11 +47,39 @@
 
 #include "contiki.h"
 
+/* With ANTI_REPLAY_CONF_PERSIST, the frame counter of this node survives
+ * reboots, so that neighbors keep accepting its frames. An upper bound
+ * of the counter is written to the file system every
+ * ANTI_REPLAY_PERSIST_INTERVAL frames, and the counter restarts from
+ * that bound after a reboot. */
+#ifdef ANTI_REPLAY_CONF_PERSIST
+#define ANTI_REPLAY_PERSIST ANTI_REPLAY_CONF_PERSIST
+#else /* ANTI_REPLAY_CONF_PERSIST */
+#define ANTI_REPLAY_PERSIST 0
+#endif /* ANTI_REPLAY_CONF_PERSIST */
+
+#ifdef ANTI_REPLAY_CONF_PERSIST_INTERVAL
+#define ANTI_REPLAY_PERSIST_INTERVAL ANTI_REPLAY_CONF_PERSIST_INTERVAL
+#else /* ANTI_REPLAY_CONF_PERSIST_INTERVAL */
+#define ANTI_REPLAY_PERSIST_INTERVAL 256
+#endif /* ANTI_REPLAY_CONF_PERSIST_INTERVAL */
+
+#ifdef ANTI_REPLAY_CONF_PERSIST_FILE
+#define ANTI_REPLAY_PERSIST_FILE ANTI_REPLAY_CONF_PERSIST_FILE
+#else /* ANTI_REPLAY_CONF_PERSIST_FILE */
+#define ANTI_REPLAY_PERSIST_FILE "frame-counter"
+#endif /* ANTI_REPLAY_CONF_PERSIST_FILE */
+
 struct anti_replay_info {
   uint32_t last_broadcast_counter;
   uint32_t last_unicast_counter;
 };
 
+/**
+ * \brief Restores the frame counter of this node, if persisted.
+ */
+void anti_replay_init(void);
+
 /**
  * \brief Sets the frame counter packetbuf attributes.
  */
@@ -53,6 +53,8 @@
 #include "net/nbr-table.h"
 #include "net/linkaddr.h"
 #include "lib/ccm-star.h"
+#include "lib/ccm-star-queue.h"
+#include "lib/memb.h"
 #include <string.h>
 
 #define WITH_ENCRYPTION (LLSEC802154_SECURITY_LEVEL & (1 << 2))
@@ -66,6 +68,23 @@
                          0x0C , 0x0D , 0x0E , 0x0F }
 #endif /* NONCORESEC_CONF_KEY */
 
+/* Authenticate and decrypt incoming frames through the CCM* job queue
+ * (lib/ccm-star-queue.h), after the radio input path, rather than while
+ * parsing them. Lower layers then see frames before they are
+ * authenticated, e.g. for duplicate detection. */
+#ifdef NONCORESEC_CONF_ASYNC_INPUT
+#define NONCORESEC_ASYNC_INPUT NONCORESEC_CONF_ASYNC_INPUT
+#else /* NONCORESEC_CONF_ASYNC_INPUT */
+#define NONCORESEC_ASYNC_INPUT 0
+#endif /* NONCORESEC_CONF_ASYNC_INPUT */
+
+/* Number of incoming frames waiting for authentication at a time */
+#ifdef NONCORESEC_CONF_ASYNC_INPUT_JOBS
+#define NONCORESEC_ASYNC_INPUT_JOBS NONCORESEC_CONF_ASYNC_INPUT_JOBS
+#else /* NONCORESEC_CONF_ASYNC_INPUT_JOBS */
+#define NONCORESEC_ASYNC_INPUT_JOBS 2
+#endif /* NONCORESEC_CONF_ASYNC_INPUT_JOBS */
+
 #define SECURITY_HEADER_LENGTH 5
 
 #define DEBUG 0
@@ -80,40 +99,65 @@
 static uint8_t key[16] = NONCORESEC_KEY;
 NBR_TABLE(struct anti_replay_info, anti_replay_table);
 
+#if NONCORESEC_ASYNC_INPUT
+/* An incoming frame being authenticated */
+struct input_job {
+  struct ccm_star_job job;
+  uint8_t generated_mic[LLSEC802154_MIC_LENGTH];
+  /* The frame, from its first header byte to the end of its MIC */
+  uint8_t frame[PACKETBUF_SIZE];
+  /* Length of the frame without the MIC */
+  uint8_t totlen;
+  /* packetbuf header and data lengths when handed to input() */
+  uint8_t hdrlen;
+  uint16_t datalen;
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+};
+MEMB(input_jobs, struct input_job, NONCORESEC_ASYNC_INPUT_JOBS);
+
+/* Header length and length without the MIC of the last frame parsed */
+static uint8_t parsed_hdrlen;
+static uint8_t parsed_totlen;
+#endif /* NONCORESEC_ASYNC_INPUT */
+
+/*---------------------------------------------------------------------------*/
+/* Set the CCM* inputs of job for the frame starting at frame, whose
+ * length is totlen without the MIC */
+static void
+set_job(struct ccm_star_job *job, uint8_t *frame,
+        uint8_t hdrlen, uint8_t totlen, int forward)
+{
+  ccm_star_packetbuf_set_nonce(job->nonce, forward);
+  job->a = frame;
+#if WITH_ENCRYPTION
+  job->a_len = hdrlen;
+  job->m = frame + hdrlen;
+  job->m_len = totlen - hdrlen;
+#else /* WITH_ENCRYPTION */
+  job->a_len = totlen;
+  job->m = NULL;
+  job->m_len = 0;
+#endif /* WITH_ENCRYPTION */
+  job->mic_len = LLSEC802154_MIC_LENGTH;
+  job->forward = forward;
+}
 /*---------------------------------------------------------------------------*/
 static int
 aead(uint8_t hdrlen, int forward)
 {
-  uint8_t totlen;
-  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
-  uint8_t *m;
-  uint8_t m_len;
-  uint8_t *a;
-  uint8_t a_len;
-  uint8_t *result;
+  struct ccm_star_job job;
   uint8_t generated_mic[LLSEC802154_MIC_LENGTH];
   uint8_t *mic;
-  
-  ccm_star_packetbuf_set_nonce(nonce, forward);
-  totlen = packetbuf_totlen();
-  a = packetbuf_hdrptr();
-#if WITH_ENCRYPTION
-  a_len = hdrlen;
-  m = a + a_len;
-  m_len = totlen - hdrlen;
-#else /* WITH_ENCRYPTION */
-  a_len = totlen;
-  m = NULL;
-  m_len = 0;
-#endif /* WITH_ENCRYPTION */
-  
-  mic = a + totlen;
-  result = forward ? mic : generated_mic;
-  
-  CCM_STAR.aead(nonce,
-      m, m_len,
-      a, a_len,
-      result, LLSEC802154_MIC_LENGTH,
+
+  set_job(&job, packetbuf_hdrptr(), hdrlen, packetbuf_totlen(), forward);
+  mic = (uint8_t *)packetbuf_hdrptr() + packetbuf_totlen();
+  job.result = forward ? mic : generated_mic;
+
+  CCM_STAR.aead(job.nonce,
+      job.m, job.m_len,
+      job.a, job.a_len,
+      job.result, job.mic_len,
       forward);
   
   if(forward) {
@@ -157,35 +201,10 @@ create(void)
 }
 /*---------------------------------------------------------------------------*/
 static int
-parse(void)
+check_replay(const linkaddr_t *sender)
 {
-  int result;
-  const linkaddr_t *sender;
   struct anti_replay_info* info;
-  
-  result = framer_802154.parse();
-  if(result == FRAMER_FAILED) {
-    return result;
-  }
-  
-  if(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) != LLSEC802154_SECURITY_LEVEL) {
-    PRINTF("noncoresec: received frame with wrong security level\n");
-    return FRAMER_FAILED;
-  }
-  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
-  if(linkaddr_cmp(sender, &linkaddr_node_addr)) {
-    PRINTF("noncoresec: frame from ourselves\n");
-    return FRAMER_FAILED;
-  }
-  
-  packetbuf_set_datalen(packetbuf_datalen() - LLSEC802154_MIC_LENGTH);
-  
-  if(!aead(result, 0)) {
-    PRINTF("noncoresec: received unauthentic frame %"PRIu32"\n",
-        anti_replay_get_counter());
-    return FRAMER_FAILED;
-  }
-  
+
   info = nbr_table_get_from_lladdr(anti_replay_table, sender);
   if(!info) {
     info = nbr_table_add_lladdr(anti_replay_table, sender);
@@ -208,7 +227,7 @@ parse(void)
     if(!nbr_table_lock(anti_replay_table, info)) {
       nbr_table_remove(anti_replay_table, info);
       PRINTF("noncoresec: could not lock\n");
-      return FRAMER_FAILED;
+      return 0;
     }
     
     anti_replay_init_info(info);
@@ -216,17 +235,110 @@ parse(void)
     if(anti_replay_was_replayed(info)) {
        PRINTF("noncoresec: received replayed frame %"PRIu32"\n",
            anti_replay_get_counter());
-       return FRAMER_FAILED;
+       return 0;
     }
   }
   
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse(void)
+{
+  int result;
+  const linkaddr_t *sender;
+  
+  result = framer_802154.parse();
+  if(result == FRAMER_FAILED) {
+    return result;
+  }
+  
+  if(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) != LLSEC802154_SECURITY_LEVEL) {
+    PRINTF("noncoresec: received frame with wrong security level\n");
+    return FRAMER_FAILED;
+  }
+  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  if(linkaddr_cmp(sender, &linkaddr_node_addr)) {
+    PRINTF("noncoresec: frame from ourselves\n");
+    return FRAMER_FAILED;
+  }
+  
+  packetbuf_set_datalen(packetbuf_datalen() - LLSEC802154_MIC_LENGTH);
+
+#if NONCORESEC_ASYNC_INPUT
+  /* Authenticated, and checked for replays, once handed to input() */
+  parsed_hdrlen = result;
+  parsed_totlen = packetbuf_totlen();
   return result;
+#else /* NONCORESEC_ASYNC_INPUT */
+  if(!aead(result, 0)) {
+    PRINTF("noncoresec: received unauthentic frame %"PRIu32"\n",
+        anti_replay_get_counter());
+    return FRAMER_FAILED;
+  }
+
+  if(!check_replay(sender)) {
+    return FRAMER_FAILED;
+  }
+
+  return result;
+#endif /* NONCORESEC_ASYNC_INPUT */
 }
 /*---------------------------------------------------------------------------*/
+#if NONCORESEC_ASYNC_INPUT
+static void
+input_done(struct ccm_star_job *job)
+{
+  struct input_job *j = job->ptr;
+  int authentic;
+
+  authentic = memcmp(j->generated_mic, j->frame + j->totlen,
+                     LLSEC802154_MIC_LENGTH) == 0;
+
+  /* Restore packetbuf as it was handed to input(), decrypted */
+  packetbuf_copyfrom(j->frame, j->hdrlen + j->datalen);
+  packetbuf_hdrreduce(j->hdrlen);
+  packetbuf_attr_copyfrom(j->attrs, j->addrs);
+  memb_free(&input_jobs, j);
+
+  if(!authentic) {
+    PRINTF("noncoresec: received unauthentic frame %"PRIu32"\n",
+        anti_replay_get_counter());
+    return;
+  }
+  if(!check_replay(packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+    return;
+  }
+  NETSTACK_NETWORK.input();
+}
+#endif /* NONCORESEC_ASYNC_INPUT */
+/*---------------------------------------------------------------------------*/
 static void
 input(void)
 {
+#if NONCORESEC_ASYNC_INPUT
+  struct input_job *j;
+
+  j = memb_alloc(&input_jobs);
+  if(j == NULL) {
+    PRINTF("noncoresec: no free input job\n");
+    return;
+  }
+  j->totlen = parsed_totlen;
+  j->hdrlen = packetbuf_hdrlen();
+  j->datalen = packetbuf_datalen();
+  memcpy(j->frame, packetbuf_hdrptr(), parsed_totlen + LLSEC802154_MIC_LENGTH);
+  packetbuf_attr_copyto(j->attrs, j->addrs);
+
+  set_job(&j->job, j->frame, parsed_hdrlen, parsed_totlen, 0);
+  j->job.key = NULL;
+  j->job.result = j->generated_mic;
+  j->job.callback = input_done;
+  j->job.ptr = j;
+  ccm_star_queue_submit(&j->job);
+#else /* NONCORESEC_ASYNC_INPUT */
   NETSTACK_NETWORK.input();
+#endif /* NONCORESEC_ASYNC_INPUT */
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -241,6 +353,10 @@ init(void)
 {
   CCM_STAR.set_key(key);
   nbr_table_register(anti_replay_table, NULL);
+  anti_replay_init();
+#if NONCORESEC_ASYNC_INPUT
+  memb_init(&input_jobs);
+#endif /* NONCORESEC_ASYNC_INPUT */
 }
 /*---------------------------------------------------------------------------*/
 const struct llsec_driver noncoresec_driver = {
@@ -38,11 +38,16 @@
  */
 
 #include "net/mac/contikimac/contikimac-framer.h"
+#include "net/mac/contikimac/contikimac.h"
 #include "net/packetbuf.h"
 #include "net/netstack.h"
 #include <string.h>
 
 #define CONTIKIMAC_ID 0x00
+/* With CONTIKIMAC_ADAPTIVE_CHECK_RATE, the low nibble of the id carries
+   the check rate shift of the sender */
+#define CONTIKIMAC_ID_ADAPTIVE 0x10
+#define CONTIKIMAC_ID_SHIFT_MASK 0x0f
 
 /* SHORTEST_PACKET_SIZE is the shortest packet that ContikiMAC
    allows. Packets have to be a certain size to be able to be detected
@@ -100,7 +105,11 @@ create(void)
     return FRAMER_FAILED;
   }
   chdr = packetbuf_hdrptr();
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  chdr->id = CONTIKIMAC_ID_ADAPTIVE | contikimac_check_rate_shift();
+#else
   chdr->id = CONTIKIMAC_ID;
+#endif
   chdr->len = packetbuf_datalen();
   pad();
   
@@ -144,6 +153,11 @@ parse(void)
   }
   
   chdr = packetbuf_dataptr();
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  if((chdr->id & ~CONTIKIMAC_ID_SHIFT_MASK) == CONTIKIMAC_ID_ADAPTIVE) {
+    contikimac_neighbor_check_rate(chdr->id & CONTIKIMAC_ID_SHIFT_MASK);
+  } else
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
   if(chdr->id != CONTIKIMAC_ID) {
     PRINTF("contikimac-framer: CONTIKIMAC_ID is missing\n");
     return FRAMER_FAILED;
@@ -47,6 +47,7 @@
 #include "net/mac/mac-sequence.h"
 #include "net/mac/contikimac/contikimac.h"
 #include "net/netstack.h"
+#include "net/link-stats.h"
 #include "net/rime/rime.h"
 #include "sys/compower.h"
 #include "sys/pt.h"
@@ -189,8 +190,9 @@ static int we_are_receiving_burst = 0;
 
 
 /* STROBE_TIME is the maximum amount of time a transmitted packet
-   should be repeatedly transmitted as part of a transmission. */
-#define STROBE_TIME                        (CYCLE_TIME + 2 * CHECK_TIME)
+   should be repeatedly transmitted as part of a transmission, to a
+   receiver that checks the channel every cycle_time. */
+#define STROBE_TIME(cycle_time)            ((cycle_time) + 2 * CHECK_TIME)
 
 /* GUARD_TIME is the time before the expected phase of a neighbor that
    a transmitted should begin transmitting packets. */
@@ -264,6 +266,26 @@ static struct compower_activity current_packet;
 
 #define DEFAULT_STREAM_TIME (4 * CYCLE_TIME)
 
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+#include "net/nbr-table.h"
+#include "sys/ctimer.h"
+
+#if CONTIKIMAC_ADAPTIVE_MAX_SHIFT > 7
+#error "CONTIKIMAC_CONF_ADAPTIVE_MAX_SHIFT must be at most 7"
+#endif
+
+/* We check the channel once every CYCLE_TIME << cycle_shift, i.e. in one
+   powercycle out of 1 << cycle_shift */
+static volatile uint8_t cycle_shift;
+static uint8_t cycle_count;
+/* Frames received in the current adaptation period */
+static uint16_t rx_count;
+static struct ctimer adaptive_timer;
+/* Check rate shift advertised by each neighbor. The interval of neighbors
+   not in the table is unknown and taken as the longest one */
+NBR_TABLE(uint8_t, nbr_check_rate);
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+
 #if CONTIKIMAC_CONF_BROADCAST_RATE_LIMIT
 static struct timer broadcast_rate_timer;
 static int broadcast_rate_counter;
@@ -362,7 +384,16 @@ powercycle_turn_radio_on(void)
 static void
 powercycle_wrapper(struct rtimer *t, void *ptr)
 {
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+  int subsystem;
+
+  /* The channel checks belong to the MAC layer */
+  subsystem = energest_subsystem_set(ENERGEST_SUBSYSTEM_MAC);
+  powercycle(t, ptr);
+  energest_subsystem_set(subsystem);
+#else /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
   powercycle(t, ptr);
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
 }
 /*---------------------------------------------------------------------------*/
 static char
@@ -405,7 +436,13 @@ powercycle(struct rtimer *t, void *ptr)
 
     packet_seen = 0;
 
-    for(count = 0; count < CCA_COUNT_MAX; ++count) {
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+    /* Skip the channel checks of all but one cycle out of 1 << cycle_shift */
+    count = (cycle_count++ & ((1 << cycle_shift) - 1)) ? CCA_COUNT_MAX : 0;
+#else
+    count = 0;
+#endif
+    for(; count < CCA_COUNT_MAX; ++count) {
       if(we_are_sending == 0 && we_are_receiving_burst == 0) {
         powercycle_turn_radio_on();
         /* Check if a packet is seen in the air. If so, we keep the
@@ -528,12 +565,86 @@ broadcast_rate_drop(void)
 #endif /* CONTIKIMAC_CONF_BROADCAST_RATE_LIMIT */
 }
 /*---------------------------------------------------------------------------*/
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+uint8_t
+contikimac_check_rate_shift(void)
+{
+  return cycle_shift;
+}
+/*---------------------------------------------------------------------------*/
+void
+contikimac_neighbor_check_rate(uint8_t shift)
+{
+  uint8_t *s;
+
+  /* Only track the neighbors that talk to us, to avoid filling the
+     neighbor table with overheard nodes */
+  if(!linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &linkaddr_node_addr) &&
+     !packetbuf_holds_broadcast()) {
+    return;
+  }
+  if(shift > CONTIKIMAC_ADAPTIVE_MAX_SHIFT) {
+    shift = CONTIKIMAC_ADAPTIVE_MAX_SHIFT;
+  }
+  s = nbr_table_get_from_lladdr(nbr_check_rate, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  if(s == NULL) {
+    s = nbr_table_add_lladdr(nbr_check_rate, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  }
+  if(s != NULL) {
+    *s = shift;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+adapt_check_rate(void *ptr)
+{
+  if(rx_count > CONTIKIMAC_ADAPTIVE_HIGH && cycle_shift > 0) {
+    cycle_shift--;
+    PRINTF("contikimac: %u frames, check rate shift %u\n", rx_count, cycle_shift);
+  } else if(rx_count < CONTIKIMAC_ADAPTIVE_LOW &&
+            cycle_shift < CONTIKIMAC_ADAPTIVE_MAX_SHIFT) {
+    cycle_shift++;
+    PRINTF("contikimac: %u frames, check rate shift %u\n", rx_count, cycle_shift);
+  }
+  rx_count = 0;
+  ctimer_reset(&adaptive_timer);
+}
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+/*---------------------------------------------------------------------------*/
+/* The wake-up interval of the receiver(s) of the frame in packetbuf */
+static rtimer_clock_t
+receiver_cycle_time(void)
+{
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  uint8_t *s;
+  uint8_t shift;
+
+  if(packetbuf_holds_broadcast()) {
+    /* Reach the slowest neighbor we know of */
+    s = nbr_table_head(nbr_check_rate);
+    shift = s == NULL ? CONTIKIMAC_ADAPTIVE_MAX_SHIFT : 0;
+    for(; s != NULL; s = nbr_table_next(nbr_check_rate, s)) {
+      if(*s > shift) {
+        shift = *s;
+      }
+    }
+  } else {
+    s = nbr_table_get_from_lladdr(nbr_check_rate, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    shift = s == NULL ? CONTIKIMAC_ADAPTIVE_MAX_SHIFT : *s;
+  }
+  return (rtimer_clock_t)CYCLE_TIME << shift;
+#else /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+  return CYCLE_TIME;
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+}
+/*---------------------------------------------------------------------------*/
 static int
 send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 	    struct rdc_buf_list *buf_list,
             int is_receiver_awake)
 {
   rtimer_clock_t t0;
+  rtimer_clock_t cycle_time;
 #if WITH_PHASE_OPTIMIZATION
   rtimer_clock_t encounter_time = 0;
 #endif
@@ -589,6 +700,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
                packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[1]);
 #endif /* NETSTACK_CONF_WITH_IPV6 */
   }
+  cycle_time = receiver_cycle_time();
 
   if(!packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
     packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
@@ -604,7 +716,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   if(!is_broadcast && !is_receiver_awake) {
 #if WITH_PHASE_OPTIMIZATION
     ret = phase_wait(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
-                     CYCLE_TIME, GUARD_TIME,
+                     cycle_time, GUARD_TIME,
                      mac_callback, mac_callback_ptr, buf_list);
     if(ret == PHASE_DEFERRED) {
       return MAC_TX_DEFERRED;
@@ -696,7 +808,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   t0 = RTIMER_NOW();
   for(strobes = 0, collisions = 0;
       got_strobe_ack == 0 && collisions == 0 &&
-      RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + STROBE_TIME); strobes++) {
+      RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + STROBE_TIME(cycle_time)); strobes++) {
 
     watchdog_periodic();
 
@@ -769,6 +881,12 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 
   off();
 
+#if LINK_STATS_ENABLED
+  /* The strobe that got acknowledged left the loop uncounted */
+  link_stats_transmission(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                          transmit_len, strobes + got_strobe_ack);
+#endif /* LINK_STATS_ENABLED */
+
   PRINTF("contikimac: send (strobes=%u, len=%u, %s, %s), done\n", strobes,
          packetbuf_totlen(),
          got_strobe_ack ? "ack" : "no ack",
@@ -818,6 +936,18 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   }
 #endif /* WITH_PHASE_OPTIMIZATION */
 
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  if(ret == MAC_TX_NOACK) {
+    uint8_t *s;
+    /* The receiver may have lengthened its interval since it last told
+       us; forget it so that retransmissions strobe for the longest one */
+    s = nbr_table_get_from_lladdr(nbr_check_rate, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    if(s != NULL) {
+      nbr_table_remove(nbr_check_rate, s);
+    }
+  }
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+
   return ret;
 }
 /*---------------------------------------------------------------------------*/
@@ -919,6 +1049,9 @@ input_packet(void)
 {
   static struct ctimer ct;
   int duplicate = 0;
+#if LINK_STATS_ENABLED
+  uint16_t frame_len = packetbuf_datalen();
+#endif /* LINK_STATS_ENABLED */
 
 #if CONTIKIMAC_SEND_SW_ACK
   int original_datalen;
@@ -961,6 +1094,11 @@ input_packet(void)
         ctimer_stop(&ct);
       }
 
+#if LINK_STATS_ENABLED
+      link_stats_input(packetbuf_addr(PACKETBUF_ADDR_SENDER), frame_len,
+                       (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI));
+#endif /* LINK_STATS_ENABLED */
+
 #if RDC_WITH_DUPLICATE_DETECTION
       /* Check for duplicate packet. */
       duplicate = mac_sequence_is_duplicate();
@@ -1009,6 +1147,9 @@ input_packet(void)
 #endif /* CONTIKIMAC_SEND_SW_ACK */
 
       if(!duplicate) {
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+        rx_count++;
+#endif
         NETSTACK_MAC.input();
       }
       return;
@@ -1034,6 +1175,11 @@ init(void)
   phase_init();
 #endif /* WITH_PHASE_OPTIMIZATION */
 
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  nbr_table_register(nbr_check_rate, NULL);
+  ctimer_set(&adaptive_timer, CONTIKIMAC_ADAPTIVE_PERIOD, adapt_check_rate, NULL);
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -1064,7 +1210,11 @@ turn_off(int keep_radio_on)
 static unsigned short
 duty_cycle(void)
 {
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  return ((1ul * CLOCK_SECOND * CYCLE_TIME) << cycle_shift) / RTIMER_ARCH_SECOND;
+#else
   return (1ul * CLOCK_SECOND * CYCLE_TIME) / RTIMER_ARCH_SECOND;
+#endif
 }
 /*---------------------------------------------------------------------------*/
 const struct rdc_driver contikimac_driver = {
@@ -44,6 +44,56 @@
 #include "net/mac/rdc.h"
 #include "dev/radio.h"
 
+/* Adaptive channel check rate. Each node checks the channel once every
+   CYCLE_TIME << shift, where shift goes from 0 (the configured
+   NETSTACK_RDC_CHANNEL_CHECK_RATE) to CONTIKIMAC_ADAPTIVE_MAX_SHIFT. The
+   shift is picked from the number of frames received every
+   CONTIKIMAC_ADAPTIVE_PERIOD. It is advertised in the ContikiMAC header,
+   so this requires contikimac_framer on every node, and senders strobe for
+   the interval of the receiver. */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE
+#define CONTIKIMAC_ADAPTIVE_CHECK_RATE CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE
+#else
+#define CONTIKIMAC_ADAPTIVE_CHECK_RATE 0
+#endif
+
+/* Largest shift, i.e. slowest check rate. At most 7 */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_MAX_SHIFT
+#define CONTIKIMAC_ADAPTIVE_MAX_SHIFT CONTIKIMAC_CONF_ADAPTIVE_MAX_SHIFT
+#else
+#define CONTIKIMAC_ADAPTIVE_MAX_SHIFT 3
+#endif
+
+/* Period over which incoming frames are counted */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_PERIOD
+#define CONTIKIMAC_ADAPTIVE_PERIOD CONTIKIMAC_CONF_ADAPTIVE_PERIOD
+#else
+#define CONTIKIMAC_ADAPTIVE_PERIOD (60 * CLOCK_SECOND)
+#endif
+
+/* Check the channel twice as often when receiving more frames than this
+   in a period */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_HIGH
+#define CONTIKIMAC_ADAPTIVE_HIGH CONTIKIMAC_CONF_ADAPTIVE_HIGH
+#else
+#define CONTIKIMAC_ADAPTIVE_HIGH 30
+#endif
+
+/* Check the channel half as often when receiving fewer frames than this
+   in a period */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_LOW
+#define CONTIKIMAC_ADAPTIVE_LOW CONTIKIMAC_CONF_ADAPTIVE_LOW
+#else
+#define CONTIKIMAC_ADAPTIVE_LOW 6
+#endif
+
 extern const struct rdc_driver contikimac_driver;
 
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+/* Our current check rate, as a shift of the base cycle time */
+uint8_t contikimac_check_rate_shift(void);
+/* Record the check rate advertised by the sender of the frame in packetbuf */
+void contikimac_neighbor_check_rate(uint8_t shift);
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+
 #endif /* CONTIKIMAC_H */
@@ -40,9 +40,12 @@
 #include "net/mac/csma.h"
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
+#include "net/packet-trace.h"
+#include "net/link-stats.h"
 
 #include "sys/ctimer.h"
 #include "sys/clock.h"
+#include "sys/energest.h"
 
 #include "lib/random.h"
 
@@ -98,6 +101,12 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
+#if CSMA_FAIR_QUEUING
+  /* Is the backoff over, i.e., is the queue waiting for its turn? */
+  uint8_t ready;
+  /* Bytes the queue may still send, deficit round-robin */
+  int16_t deficit;
+#endif /* CSMA_FAIR_QUEUING */
   LIST_STRUCT(queued_packet_list);
 };
 
@@ -124,6 +133,21 @@ LIST(neighbor_list);
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
 
+#if CSMA_STATS
+struct csma_stats csma_stats;
+#endif /* CSMA_STATS */
+
+#if CSMA_FAIR_QUEUING
+/* The queue whose turn it is, and whether the turn is still open */
+static struct neighbor_queue *rr_current;
+static uint8_t rr_turn_open;
+/* Is a packet being sent by the RDC layer? */
+static uint8_t tx_busy;
+static struct ctimer schedule_timer;
+
+static void schedule_next(void);
+#endif /* CSMA_FAIR_QUEUING */
+
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
@@ -156,18 +180,162 @@ default_timebase(void)
 }
 /*---------------------------------------------------------------------------*/
 static void
-transmit_packet_list(void *ptr)
+transmit_queue_head(struct neighbor_queue *n)
 {
-  struct neighbor_queue *n = ptr;
   if(n) {
     struct rdc_buf_list *q = list_head(n->queued_packet_list);
     if(q != NULL) {
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+      int subsystem;
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
       PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
           list_length(n->queued_packet_list));
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+      /* Retransmissions are scheduled from a callback timer. The
+         radio time still belongs to the sender of the packet. */
+      subsystem = energest_subsystem_set(queuebuf_attr(q->buf,
+                                         PACKETBUF_ATTR_ENERGEST_SUBSYSTEM));
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
+#if CSMA_FAIR_QUEUING
+      n->ready = 0;
+      n->deficit -= queuebuf_datalen(q->buf);
+      tx_busy = 1;
+#endif /* CSMA_FAIR_QUEUING */
+      PACKET_TRACE_QUEUEBUF(q->buf, PACKET_TRACE_MAC_TX, n->transmissions);
       /* Send packets in the neighbor's list */
       NETSTACK_RDC.send_list(packet_sent, n, q);
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+      energest_subsystem_set(subsystem);
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if CSMA_FAIR_QUEUING
+/* Can the queue send its head packet now, within its deficit? */
+static int
+queue_can_send(struct neighbor_queue *n)
+{
+  struct rdc_buf_list *q = list_head(n->queued_packet_list);
+  return n->ready && q != NULL && n->deficit >= queuebuf_datalen(q->buf);
+}
+/*---------------------------------------------------------------------------*/
+/* Deficit round-robin across the queues that are done backing off, one
+ * packet at a time: a queue in long backoff no longer holds the others */
+static void
+schedule_next(void)
+{
+  struct neighbor_queue *n;
+  int i;
+  int count;
+
+  if(tx_busy) {
+    return;
+  }
+
+  /* Carry on with the current turn while the deficit allows */
+  if(rr_turn_open && rr_current != NULL && queue_can_send(rr_current)) {
+    transmit_queue_head(rr_current);
+    return;
+  }
+  rr_turn_open = 0;
+
+  /* Give the next ready queue its quantum */
+  n = rr_current;
+  count = list_length(neighbor_list);
+  for(i = 0; i < count; i++) {
+    if(n == NULL || list_item_next(n) == NULL) {
+      n = list_head(neighbor_list);
+    } else {
+      n = list_item_next(n);
+    }
+    if(n->ready) {
+      n->deficit += CSMA_FAIR_QUEUING_QUANTUM;
+      if(queue_can_send(n)) {
+        rr_current = n;
+        rr_turn_open = 1;
+        transmit_queue_head(n);
+        return;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule_timer_callback(void *ptr)
+{
+  schedule_next();
+}
+/*---------------------------------------------------------------------------*/
+/* The number of packets each neighbor queue is guaranteed. A queue may
+ * borrow more while the pool has free entries */
+static int
+fair_share(void)
+{
+  int num_queues = list_length(neighbor_list);
+  if(num_queues == 0 || num_queues >= MAX_QUEUED_PACKETS) {
+    return 1;
+  }
+  return MAX_QUEUED_PACKETS / num_queues;
+}
+/*---------------------------------------------------------------------------*/
+/* Make room for a packet to n, under its fair share, by dropping the last
+ * packet of the longest queue above its share. Returns 1 on success */
+static int
+evict_for(struct neighbor_queue *n)
+{
+  struct neighbor_queue *m;
+  struct neighbor_queue *victim = NULL;
+  struct rdc_buf_list *q;
+  struct qbuf_metadata *metadata;
+  int share = fair_share();
+  int victim_len = share;
+
+  if(list_length(n->queued_packet_list) >= share) {
+    return 0;
+  }
+  for(m = list_head(neighbor_list); m != NULL; m = list_item_next(m)) {
+    int len = list_length(m->queued_packet_list);
+    if(m != n && len > victim_len) {
+      victim = m;
+      victim_len = len;
     }
   }
+  if(victim == NULL) {
+    return 0;
+  }
+
+  /* The victim holds at least two packets: its tail is not being sent */
+  q = list_tail(victim->queued_packet_list);
+  metadata = (struct qbuf_metadata *)q->ptr;
+  list_remove(victim->queued_packet_list, q);
+  queuebuf_free(q->buf);
+  memb_free(&packet_memb, q);
+  PRINTF("csma: evicted a packet from a queue of %d\n", victim_len);
+  CSMA_STAT(csma_stats.evicted++);
+  if(metadata != NULL) {
+    mac_callback_t sent = metadata->sent;
+    void *cptr = metadata->cptr;
+    memb_free(&metadata_memb, metadata);
+    mac_call_sent_callback(sent, cptr, MAC_TX_ERR, 1);
+  }
+  return 1;
+}
+#endif /* CSMA_FAIR_QUEUING */
+/*---------------------------------------------------------------------------*/
+static void
+transmit_packet_list(void *ptr)
+{
+#if CSMA_FAIR_QUEUING
+  struct neighbor_queue *n = ptr;
+  if(n) {
+    /* The backoff is over, wait for our turn */
+    n->ready = 1;
+    schedule_next();
+  }
+#else /* CSMA_FAIR_QUEUING */
+  transmit_queue_head(ptr);
+#endif /* CSMA_FAIR_QUEUING */
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -195,6 +363,17 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p, int status)
     } else {
       /* This was the last packet in the queue, we free the neighbor */
       ctimer_stop(&n->transmit_timer);
+#if CSMA_FAIR_QUEUING
+      if(rr_current == n) {
+        /* The next queue in the list gets the next turn */
+        struct neighbor_queue *prev = list_head(neighbor_list);
+        while(prev != NULL && list_item_next(prev) != n) {
+          prev = list_item_next(prev);
+        }
+        rr_current = prev;
+        rr_turn_open = 0;
+      }
+#endif /* CSMA_FAIR_QUEUING */
       list_remove(neighbor_list, n);
       memb_free(&neighbor_memb, n);
     }
@@ -218,6 +397,11 @@ packet_sent(void *ptr, int status, int num_transmissions)
   if(n == NULL) {
     return;
   }
+#if CSMA_FAIR_QUEUING
+  tx_busy = 0;
+  /* Pick the next queue once we are done with this packet */
+  ctimer_set(&schedule_timer, 0, schedule_timer_callback, NULL);
+#endif /* CSMA_FAIR_QUEUING */
   switch(status) {
   case MAC_TX_OK:
   case MAC_TX_NOACK:
@@ -241,6 +425,7 @@ packet_sent(void *ptr, int status, int num_transmissions)
   }
 
   if(q != NULL) {
+    PACKET_TRACE_QUEUEBUF(q->buf, PACKET_TRACE_MAC_DONE, status);
     metadata = (struct qbuf_metadata *)q->ptr;
 
     if(metadata != NULL) {
@@ -295,6 +480,10 @@ packet_sent(void *ptr, int status, int num_transmissions)
         } else {
           PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
                  status, n->transmissions, n->collisions);
+          CSMA_STAT(csma_stats.max_transmissions++);
+#if LINK_STATS_ENABLED
+          link_stats_packet_sent(&n->addr, status, num_tx);
+#endif /* LINK_STATS_ENABLED */
           free_packet(n, q, status);
           mac_call_sent_callback(sent, cptr, status, num_tx);
         }
@@ -304,6 +493,9 @@ packet_sent(void *ptr, int status, int num_transmissions)
         } else {
           PRINTF("csma: rexmit failed %d: %d\n", n->transmissions, status);
         }
+#if LINK_STATS_ENABLED
+        link_stats_packet_sent(&n->addr, status, num_tx);
+#endif /* LINK_STATS_ENABLED */
         free_packet(n, q, status);
         mac_call_sent_callback(sent, cptr, status, num_tx);
       }
@@ -348,6 +540,10 @@ send_packet(mac_callback_t sent, void *ptr)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+#if CSMA_FAIR_QUEUING
+      n->ready = 0;
+      n->deficit = 0;
+#endif /* CSMA_FAIR_QUEUING */
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
@@ -358,6 +554,13 @@ send_packet(mac_callback_t sent, void *ptr)
   if(n != NULL) {
     /* Add packet to the neighbor's queue */
     if(list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
+#if CSMA_FAIR_QUEUING
+      if(memb_numfree(&packet_memb) == 0 || queuebuf_numfree() == 0) {
+        /* The pool is exhausted: take back a packet from a queue that
+           borrowed more than its share */
+        evict_for(n);
+      }
+#endif /* CSMA_FAIR_QUEUING */
       q = memb_alloc(&packet_memb);
       if(q != NULL) {
         q->ptr = memb_alloc(&metadata_memb);
@@ -385,6 +588,8 @@ send_packet(mac_callback_t sent, void *ptr)
               list_add(n->queued_packet_list, q);
             }
 
+            PACKET_TRACE(PACKET_TRACE_MAC_QUEUE,
+                         list_length(n->queued_packet_list));
             PRINTF("csma: send_packet, queue length %d, free packets %d\n",
                    list_length(n->queued_packet_list), memb_numfree(&packet_memb));
             /* If q is the first packet in the neighbor's queue, send asap */
@@ -400,16 +605,19 @@ send_packet(mac_callback_t sent, void *ptr)
         PRINTF("csma: could not allocate queuebuf, dropping packet\n");
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
+      CSMA_STAT(csma_stats.no_buffer++);
       if(list_length(n->queued_packet_list) == 0) {
         list_remove(neighbor_list, n);
         memb_free(&neighbor_memb, n);
       }
     } else {
       PRINTF("csma: Neighbor queue full\n");
+      CSMA_STAT(csma_stats.queue_full++);
     }
     PRINTF("csma: could not allocate packet, dropping packet\n");
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
+    CSMA_STAT(csma_stats.no_neighbor++);
   }
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
@@ -417,6 +625,7 @@ send_packet(mac_callback_t sent, void *ptr)
 static void
 input_packet(void)
 {
+  packet_trace_mac_input();
   NETSTACK_LLSEC.input();
 }
 /*---------------------------------------------------------------------------*/
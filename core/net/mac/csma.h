@@ -44,6 +44,52 @@
 #include "net/mac/mac.h"
 #include "dev/radio.h"
 
+/* Serve the neighbor queues with deficit round-robin, one packet at a
+ * time, instead of letting each queue transmit as soon as its backoff
+ * is over. Also guarantees each queue a fair share of the packet pool:
+ * when the pool is exhausted, a queue under its share gets room by
+ * dropping the last packet of the longest queue above its share. */
+#ifdef CSMA_CONF_FAIR_QUEUING
+#define CSMA_FAIR_QUEUING CSMA_CONF_FAIR_QUEUING
+#else /* CSMA_CONF_FAIR_QUEUING */
+#define CSMA_FAIR_QUEUING 0
+#endif /* CSMA_CONF_FAIR_QUEUING */
+
+/* Bytes a queue may send per round. At least the largest frame */
+#ifdef CSMA_CONF_FAIR_QUEUING_QUANTUM
+#define CSMA_FAIR_QUEUING_QUANTUM CSMA_CONF_FAIR_QUEUING_QUANTUM
+#else /* CSMA_CONF_FAIR_QUEUING_QUANTUM */
+#define CSMA_FAIR_QUEUING_QUANTUM PACKETBUF_SIZE
+#endif /* CSMA_CONF_FAIR_QUEUING_QUANTUM */
+
+#ifdef CSMA_CONF_STATS
+#define CSMA_STATS CSMA_CONF_STATS
+#else /* CSMA_CONF_STATS */
+#define CSMA_STATS 0
+#endif /* CSMA_CONF_STATS */
+
+#if CSMA_STATS
+/* Packets dropped by CSMA, by cause */
+struct csma_stats {
+  /** The neighbor queue held CSMA_MAX_PACKET_PER_NEIGHBOR packets */
+  uint16_t queue_full;
+  /** No neighbor queue was free */
+  uint16_t no_neighbor;
+  /** No packet entry or queuebuf was free */
+  uint16_t no_buffer;
+  /** Evicted to make room for a queue under its fair share */
+  uint16_t evicted;
+  /** Not acknowledged after the maximum number of transmissions */
+  uint16_t max_transmissions;
+};
+
+extern struct csma_stats csma_stats;
+
+#define CSMA_STAT(code) (code)
+#else /* CSMA_STATS */
+#define CSMA_STAT(code)
+#endif /* CSMA_STATS */
+
 extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
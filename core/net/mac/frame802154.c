@@ -452,6 +452,74 @@ frame802154_create(frame802154_t *p, uint8_t *buf)
   return (int)pos;
 }
 /*----------------------------------------------------------------------------*/
+/* Fast path of frame802154_parse for the frames Contiki sends most: 2003
+ * or 2006 data frames without security nor IEs, with a sequence number, a
+ * short or long destination address and a long source address. Returns 0
+ * if the frame has another layout. */
+static int
+parse_data_frame(uint8_t *data, int len, frame802154_t *pf)
+{
+  uint8_t *p;
+  int c;
+
+  if(len < 2 ||
+     (data[0] & 0x0f) != FRAME802154_DATAFRAME ||
+     (data[1] & 0x03) != 0 ||
+     ((data[1] >> 4) & 3) >= FRAME802154_IEEE802154E_2012 ||
+     ((data[1] >> 6) & 3) != FRAME802154_LONGADDRMODE ||
+     ((data[1] >> 2) & 3) < FRAME802154_SHORTADDRMODE) {
+    return 0;
+  }
+
+  memset(&pf->fcf, 0, sizeof(frame802154_fcf_t));
+  pf->fcf.frame_type = FRAME802154_DATAFRAME;
+  pf->fcf.frame_pending = (data[0] >> 4) & 1;
+  pf->fcf.ack_required = (data[0] >> 5) & 1;
+  pf->fcf.panid_compression = (data[0] >> 6) & 1;
+  pf->fcf.dest_addr_mode = (data[1] >> 2) & 3;
+  pf->fcf.frame_version = (data[1] >> 4) & 3;
+  pf->fcf.src_addr_mode = FRAME802154_LONGADDRMODE;
+
+  /* Sequence number, destination PAN ID and address, source PAN ID unless
+     compressed, and long source address */
+  c = 2 + 1 + 2 + addr_len(pf->fcf.dest_addr_mode) +
+    (pf->fcf.panid_compression ? 0 : 2) + 8;
+  if(c > len) {
+    return 0;
+  }
+
+  p = data + 2;
+  pf->seq = *p++;
+  pf->dest_pid = p[0] + (p[1] << 8);
+  p += 2;
+  if(pf->fcf.dest_addr_mode == FRAME802154_SHORTADDRMODE) {
+    linkaddr_copy((linkaddr_t *)&(pf->dest_addr), &linkaddr_null);
+    pf->dest_addr[0] = p[1];
+    pf->dest_addr[1] = p[0];
+    p += 2;
+  } else {
+    for(c = 0; c < 8; c++) {
+      pf->dest_addr[c] = p[7 - c];
+    }
+    p += 8;
+  }
+  if(pf->fcf.panid_compression) {
+    pf->src_pid = pf->dest_pid;
+  } else {
+    pf->src_pid = p[0] + (p[1] << 8);
+    p += 2;
+  }
+  for(c = 0; c < 8; c++) {
+    pf->src_addr[c] = p[7 - c];
+  }
+  p += 8;
+
+  c = p - data;
+  pf->payload_len = len - c;
+  pf->payload = p;
+  return c;
+}
+/*----------------------------------------------------------------------------*/
 /**
  *   \brief Parses an input frame.  Scans the input frame to find each
  *   section, and stores the information of each section in a
@@ -473,6 +541,11 @@ frame802154_parse(uint8_t *data, int len, frame802154_t *pf)
   uint8_t key_id_mode;
 #endif /* LLSEC802154_USES_EXPLICIT_KEYS */
 
+  c = parse_data_frame(data, len, pf);
+  if(c > 0) {
+    return c;
+  }
+
   if(len < 2) {
     return 0;
   }
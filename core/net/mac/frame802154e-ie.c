@@ -60,6 +60,7 @@ enum ieee802154e_header_ie_id {
 enum ieee802154e_payload_ie_id {
   PAYLOAD_IE_ESDU = 0,
   PAYLOAD_IE_MLME,
+  PAYLOAD_IE_IETF = 0x5, /* c.f. RFC 8480 */
   PAYLOAD_IE_LIST_TERMINATION = 0xf,
 };
 
@@ -207,6 +208,21 @@ frame80215e_create_ie_mlme(uint8_t *buf, int len,
   }
 }
 
+/* Payload IE. IETF. Used by 6top. The content (ies->ie_ietf_len bytes)
+ * is written by the caller right after the descriptor */
+int
+frame80215e_create_ie_ietf(uint8_t *buf, int len,
+    struct ieee802154_ies *ies)
+{
+  int ie_len = 0;
+  if(len >= 2 + ie_len && ies != NULL) {
+    create_payload_ie_descriptor(buf, PAYLOAD_IE_IETF, ies->ie_ietf_len);
+    return 2 + ie_len;
+  } else {
+    return -1;
+  }
+}
+
 /* MLME sub-IE. TSCH synchronization. Used in EBs: ASN and join priority */
 int
 frame80215e_create_ie_tsch_synchronization(uint8_t *buf, int len,
@@ -460,6 +476,8 @@ frame802154e_parse_information_elements(const uint8_t *buf, uint8_t buf_size,
   /* Always look for a header IE first (at least "list termination 1") */
   parsing_state = PARSING_HEADER_IE;
   ies->ie_payload_ie_offset = 0;
+  ies->ie_ietf = NULL;
+  ies->ie_ietf_len = 0;
 
   /* Loop over all IEs */
   while(buf_size > 0) {
@@ -529,6 +547,16 @@ frame802154e_parse_information_elements(const uint8_t *buf, uint8_t buf_size,
             len = 0; /* Reset len as we want to read subIEs and not jump over them */
             PRINTF("frame802154e: entering MLME ie with len %u\n", nested_mlme_len);
             break;
+          case PAYLOAD_IE_IETF:
+            /* Keep a pointer to the content, it is parsed by 6top */
+            if(len > buf_size) {
+              PRINTF("frame802154e: IETF ie too long %u\n", len);
+              return -1;
+            }
+            ies->ie_ietf = buf;
+            ies->ie_ietf_len = len;
+            PRINTF("frame802154e: IETF ie with len %u\n", len);
+            break;
           case PAYLOAD_IE_LIST_TERMINATION:
             PRINTF("frame802154e: payload ie list termination %u\n", len);
             return (len == 0) ? buf + len - start : -1;
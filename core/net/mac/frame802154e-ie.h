@@ -80,6 +80,9 @@ struct ieee802154_ies {
   /* We include and parse only the sequence len and list and omit unused fields */
   uint16_t ie_hopping_sequence_len;
   uint8_t ie_hopping_sequence_list[TSCH_HOPPING_SEQUENCE_MAX_LEN];
+  /* Payload IETF IE (6top), content is not copied */
+  const uint8_t *ie_ietf;
+  uint16_t ie_ietf_len;
 };
 
 /** Insert various Information Elements **/
@@ -100,6 +103,9 @@ int frame80215e_create_ie_payload_list_termination(uint8_t *buf, int len,
 /* Payload IE. MLME. Used to nest sub-IEs */
 int frame80215e_create_ie_mlme(uint8_t *buf, int len,
     struct ieee802154_ies *ies);
+/* Payload IE. IETF. Used by 6top to carry 6P messages */
+int frame80215e_create_ie_ietf(uint8_t *buf, int len,
+    struct ieee802154_ies *ies);
 /* MLME sub-IE. TSCH synchronization. Used in EBs: ASN and join priority */
 int frame80215e_create_ie_tsch_synchronization(uint8_t *buf, int len,
     struct ieee802154_ies *ies);
@@ -62,25 +62,176 @@ static uint8_t mac_dsn;
 
 static uint8_t initialized = 0;
 
+#if FRAMER_802154_HDR_CACHE
+/* Longest header: FCF, sequence number, two PAN IDs, two long addresses
+   and the largest aux security header */
+#define HDR_CACHE_MAX_LEN (2 + 1 + 2 + 8 + 2 + 8 + 14)
+
+/* Everything a cached header depends on, apart from the sequence number
+   and the frame counter */
+struct hdr_cache_key {
+  linkaddr_t dest;
+  linkaddr_t src;
+  uint16_t pan_id;
+  uint8_t frame_type;
+  uint8_t pending;
+  uint8_t ack_required;
+  uint8_t security_level;
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  uint8_t key_id_mode;
+  uint8_t key_index;
+  uint16_t key_source;
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+};
+
+struct hdr_cache_entry {
+  struct hdr_cache_key key;
+  uint8_t len;
+  /* Offset of the frame counter in hdr, 0 if there is none */
+  uint8_t frame_counter_offset;
+  uint8_t hdr[HDR_CACHE_MAX_LEN];
+};
+
+static struct hdr_cache_entry hdr_cache[FRAMER_802154_HDR_CACHE_SIZE];
+static uint8_t hdr_cache_next;
+#endif /* FRAMER_802154_HDR_CACHE */
+
+/*---------------------------------------------------------------------------*/
+static uint8_t
+next_seqno(void)
+{
+  uint8_t seq;
+
+  if(packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO)) {
+    return packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+  }
+  /* Ensure that the sequence number 0 is not used as it would bypass the above check. */
+  if(mac_dsn == 0) {
+    mac_dsn++;
+  }
+  seq = mac_dsn++;
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, seq);
+  return seq;
+}
+/*---------------------------------------------------------------------------*/
+#if FRAMER_802154_HDR_CACHE
+static void
+hdr_cache_key_init(struct hdr_cache_key *key)
+{
+  memset(key, 0, sizeof(*key));
+  if(!packetbuf_holds_broadcast()) {
+    linkaddr_copy(&key->dest, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    key->ack_required = packetbuf_attr(PACKETBUF_ATTR_MAC_ACK);
+  }
+  linkaddr_copy(&key->src, &linkaddr_node_addr);
+  key->pan_id = frame802154_get_pan_id();
+  key->frame_type = packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE);
+  key->pending = packetbuf_attr(PACKETBUF_ATTR_PENDING);
+#if LLSEC802154_SECURITY_LEVEL
+  key->security_level = packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL);
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  key->key_id_mode = packetbuf_attr(PACKETBUF_ATTR_KEY_ID_MODE);
+  key->key_index = packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX);
+  key->key_source = packetbuf_attr(PACKETBUF_ATTR_KEY_SOURCE_BYTES_0_1);
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /* LLSEC802154_SECURITY_LEVEL */
+}
+/*---------------------------------------------------------------------------*/
+/* Write the header of the frame in packetbuf from the cache. Returns the
+   header length, 0 if not cached, FRAMER_FAILED if it does not fit */
+static int
+hdr_cache_create(const struct hdr_cache_key *key)
+{
+  struct hdr_cache_entry *e;
+  uint8_t *hdr;
+  int i;
+
+  for(i = 0; i < FRAMER_802154_HDR_CACHE_SIZE; i++) {
+    e = &hdr_cache[i];
+    if(e->len == 0 || memcmp(&e->key, key, sizeof(*key)) != 0) {
+      continue;
+    }
+    if(!packetbuf_hdralloc(e->len)) {
+      PRINTF("15.4-OUT: too large header: %u\n", e->len);
+      return FRAMER_FAILED;
+    }
+    hdr = packetbuf_hdrptr();
+    memcpy(hdr, e->hdr, e->len);
+    if(!FRAME802154_SUPPR_SEQNO) {
+      hdr[2] = next_seqno();
+    }
+#if LLSEC802154_USES_FRAME_COUNTER
+    if(e->frame_counter_offset) {
+      frame802154_frame_counter_t counter;
+      counter.u16[0] = packetbuf_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1);
+      counter.u16[1] = packetbuf_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3);
+      memcpy(hdr + e->frame_counter_offset, counter.u8, 4);
+    }
+#endif /* LLSEC802154_USES_FRAME_COUNTER */
+    return e->len;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Cache the header just created in packetbuf */
+static void
+hdr_cache_add(const struct hdr_cache_key *key, frame802154_t *params, int hdr_len)
+{
+  struct hdr_cache_entry *e;
+
+  if(hdr_len > HDR_CACHE_MAX_LEN) {
+    return;
+  }
+  e = &hdr_cache[hdr_cache_next];
+  hdr_cache_next = (hdr_cache_next + 1) % FRAMER_802154_HDR_CACHE_SIZE;
+
+  memcpy(&e->key, key, sizeof(*key));
+  memcpy(e->hdr, packetbuf_hdrptr(), hdr_len);
+  e->len = hdr_len;
+  e->frame_counter_offset = 0;
+#if LLSEC802154_USES_FRAME_COUNTER
+  if(params->fcf.security_enabled) {
+    /* The aux header comes last, the frame counter follows its
+       security control byte */
+    params->fcf.security_enabled = 0;
+    e->frame_counter_offset = frame802154_hdrlen(params) + 1;
+    params->fcf.security_enabled = 1;
+  }
+#endif /* LLSEC802154_USES_FRAME_COUNTER */
+}
+#endif /* FRAMER_802154_HDR_CACHE */
 /*---------------------------------------------------------------------------*/
 static int
 create_frame(int type, int do_create)
 {
   frame802154_t params;
   int hdr_len;
+#if FRAMER_802154_HDR_CACHE
+  struct hdr_cache_key key;
+#endif /* FRAMER_802154_HDR_CACHE */
 
   if(frame802154_get_pan_id() == 0xffff) {
     return -1;
   }
 
-  /* init to zeros */
-  memset(&params, 0, sizeof(params));
-
   if(!initialized) {
     initialized = 1;
     mac_dsn = random_rand() & 0xff;
   }
 
+#if FRAMER_802154_HDR_CACHE
+  if(do_create) {
+    hdr_cache_key_init(&key);
+    hdr_len = hdr_cache_create(&key);
+    if(hdr_len != 0) {
+      return hdr_len;
+    }
+  }
+#endif /* FRAMER_802154_HDR_CACHE */
+
+  /* init to zeros */
+  memset(&params, 0, sizeof(params));
+
   /* Build the FCF. */
   params.fcf.frame_type = packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE);
   params.fcf.frame_pending = packetbuf_attr(PACKETBUF_ATTR_PENDING);
@@ -123,16 +274,8 @@ create_frame(int type, int do_create)
     /* Only length calculation - no sequence number is needed and
        should not be consumed. */
 
-  } else if(packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO)) {
-    params.seq = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
-
   } else {
-    /* Ensure that the sequence number 0 is not used as it would bypass the above check. */
-    if(mac_dsn == 0) {
-      mac_dsn++;
-    }
-    params.seq = mac_dsn++;
-    packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, params.seq);
+    params.seq = next_seqno();
   }
 
   /* Complete the addressing fields. */
@@ -181,6 +324,9 @@ create_frame(int type, int do_create)
     return hdr_len;
   } else if(packetbuf_hdralloc(hdr_len)) {
     frame802154_create(&params, packetbuf_hdrptr());
+#if FRAMER_802154_HDR_CACHE
+    hdr_cache_add(&key, &params, hdr_len);
+#endif /* FRAMER_802154_HDR_CACHE */
 
     PRINTF("15.4-OUT: %2X", params.fcf.frame_type);
     PRINTADDR(params.dest_addr);
@@ -41,6 +41,23 @@
 
 #include "net/mac/framer.h"
 
+/* Keep the headers of the last frames sent in a small cache keyed by
+   destination, frame type, flags, security parameters and PAN ID. A frame
+   matching an entry gets a copy of the cached header, with only the
+   sequence number (and frame counter) patched in */
+#ifdef FRAMER_802154_CONF_HDR_CACHE
+#define FRAMER_802154_HDR_CACHE FRAMER_802154_CONF_HDR_CACHE
+#else
+#define FRAMER_802154_HDR_CACHE 0
+#endif
+
+/* Number of cached headers */
+#ifdef FRAMER_802154_CONF_HDR_CACHE_SIZE
+#define FRAMER_802154_HDR_CACHE_SIZE FRAMER_802154_CONF_HDR_CACHE_SIZE
+#else
+#define FRAMER_802154_HDR_CACHE_SIZE 4
+#endif
+
 extern const struct framer framer_802154;
 
 #endif /* FRAMER_802154_H_ */
@@ -43,6 +43,7 @@
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
 #include "net/netstack.h"
+#include "net/link-stats.h"
 #include "net/rime/rimestats.h"
 #include <string.h>
 
@@ -107,8 +108,33 @@
 #include "net/mac/frame802154.h"
 #endif /* NULLRDC_SEND_802154_ACK */
 
+/* Send the frames of a list with the radio's send_burst(), when it has
+   one. Only without software or hardware ACKs, as ACKs are not waited
+   for within a burst. */
+#ifdef NULLRDC_CONF_SEND_BURST
+#define NULLRDC_SEND_BURST NULLRDC_CONF_SEND_BURST
+#else /* NULLRDC_CONF_SEND_BURST */
+#define NULLRDC_SEND_BURST 0
+#endif /* NULLRDC_CONF_SEND_BURST */
+
+#if NULLRDC_SEND_BURST && (NULLRDC_802154_AUTOACK || NULLRDC_802154_AUTOACK_HW)
+#error NULLRDC_CONF_SEND_BURST cannot be used with ACKs
+#endif
+
+/* The maximum number of frames in a burst */
+#ifdef NULLRDC_CONF_BURST_MAX_FRAMES
+#define NULLRDC_BURST_MAX_FRAMES NULLRDC_CONF_BURST_MAX_FRAMES
+#else /* NULLRDC_CONF_BURST_MAX_FRAMES */
+#define NULLRDC_BURST_MAX_FRAMES 4
+#endif /* NULLRDC_CONF_BURST_MAX_FRAMES */
+
 #define ACK_LEN 3
 
+#if NULLRDC_SEND_BURST
+static uint8_t burst_buf[NULLRDC_BURST_MAX_FRAMES][PACKETBUF_SIZE];
+static struct radio_frame burst_frames[NULLRDC_BURST_MAX_FRAMES];
+#endif /* NULLRDC_SEND_BURST */
+
 /*---------------------------------------------------------------------------*/
 static int
 send_one_packet(mac_callback_t sent, void *ptr)
@@ -147,6 +173,10 @@ send_one_packet(mac_callback_t sent, void *ptr)
         RIMESTATS_ADD(reliabletx);
       }
 
+#if LINK_STATS_ENABLED
+      link_stats_transmission(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                              packetbuf_totlen(), 1);
+#endif /* LINK_STATS_ENABLED */
       switch(NETSTACK_RADIO.transmit(packetbuf_totlen())) {
       case RADIO_TX_OK:
         if(is_broadcast) {
@@ -210,6 +240,10 @@ send_one_packet(mac_callback_t sent, void *ptr)
 
 #else /* ! NULLRDC_802154_AUTOACK */
 
+#if LINK_STATS_ENABLED
+    link_stats_transmission(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                            packetbuf_totlen(), 1);
+#endif /* LINK_STATS_ENABLED */
     switch(NETSTACK_RADIO.send(packetbuf_hdrptr(), packetbuf_totlen())) {
     case RADIO_TX_OK:
       ret = MAC_TX_OK;
@@ -240,9 +274,82 @@ send_packet(mac_callback_t sent, void *ptr)
   send_one_packet(sent, ptr);
 }
 /*---------------------------------------------------------------------------*/
+#if NULLRDC_SEND_BURST
+/* Send the list in bursts of up to NULLRDC_BURST_MAX_FRAMES frames */
+static void
+send_list_burst(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
+{
+  struct rdc_buf_list *bufs[NULLRDC_BURST_MAX_FRAMES];
+  unsigned short count;
+  unsigned short num_sent;
+  unsigned short i;
+  int ret;
+
+  while(buf_list != NULL) {
+    /* Frame the packets of the burst */
+    for(count = 0; buf_list != NULL && count < NULLRDC_BURST_MAX_FRAMES; count++) {
+      queuebuf_to_packetbuf(buf_list->buf);
+      packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+      if(NETSTACK_FRAMER.create() < 0) {
+        break;
+      }
+      memcpy(burst_buf[count], packetbuf_hdrptr(), packetbuf_totlen());
+      burst_frames[count].payload = burst_buf[count];
+      burst_frames[count].payload_len = packetbuf_totlen();
+      bufs[count] = buf_list;
+      buf_list = buf_list->next;
+    }
+
+    if(count == 0) {
+      /* The first packet cannot be framed */
+      PRINTF("nullrdc: send failed, too large header\n");
+      mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+      return;
+    }
+
+    ret = NETSTACK_RADIO.send_burst(burst_frames, count, &num_sent);
+    switch(ret) {
+    case RADIO_TX_OK:
+      ret = MAC_TX_OK;
+      break;
+    case RADIO_TX_COLLISION:
+      ret = MAC_TX_COLLISION;
+      break;
+    case RADIO_TX_NOACK:
+      ret = MAC_TX_NOACK;
+      break;
+    default:
+      ret = MAC_TX_ERR;
+      break;
+    }
+
+    /* Report the frames sent and the one that failed, if any. The frames
+       after it are left to the upper layers, as in send_list() */
+    for(i = 0; i < count && i <= num_sent; i++) {
+      queuebuf_to_packetbuf(bufs[i]->buf);
+#if LINK_STATS_ENABLED
+      link_stats_transmission(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                              burst_frames[i].payload_len, 1);
+#endif /* LINK_STATS_ENABLED */
+      mac_call_sent_callback(sent, ptr, i < num_sent ? MAC_TX_OK : ret, 1);
+    }
+    if(num_sent < count) {
+      return;
+    }
+  }
+}
+#endif /* NULLRDC_SEND_BURST */
+/*---------------------------------------------------------------------------*/
 static void
 send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
 {
+#if NULLRDC_SEND_BURST
+  if(NETSTACK_RADIO.send_burst != NULL
+     && buf_list != NULL && buf_list->next != NULL) {
+    send_list_burst(sent, ptr, buf_list);
+    return;
+  }
+#endif /* NULLRDC_SEND_BURST */
   while(buf_list != NULL) {
     /* We backup the next pointer, as it may be nullified by
      * mac_call_sent_callback() */
@@ -265,6 +372,9 @@ send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
 static void
 packet_input(void)
 {
+#if LINK_STATS_ENABLED
+  uint16_t frame_len = packetbuf_datalen();
+#endif /* LINK_STATS_ENABLED */
 #if NULLRDC_SEND_802154_ACK
   int original_datalen;
   uint8_t *original_dataptr;
@@ -290,6 +400,11 @@ packet_input(void)
   } else {
     int duplicate = 0;
 
+#if LINK_STATS_ENABLED
+    link_stats_input(packetbuf_addr(PACKETBUF_ADDR_SENDER), frame_len,
+                     (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI));
+#endif /* LINK_STATS_ENABLED */
+
 #if NULLRDC_802154_AUTOACK || NULLRDC_802154_AUTOACK_HW
 #if RDC_WITH_DUPLICATE_DETECTION
     /* Check for duplicate packet. */
@@ -50,15 +50,74 @@
 #define PHASE_DRIFT_CORRECT 0
 #endif
 
+/* A phase older than this (in clock ticks) is not trusted any more and
+   the next transmission to the neighbor strobes a full cycle again.
+   0 to trust phases forever */
+#ifdef PHASE_CONF_MAX_AGE
+#define PHASE_MAX_AGE PHASE_CONF_MAX_AGE
+#else
+#define PHASE_MAX_AGE 0
+#endif
+
+/* Save the drift learned for each neighbor in the file system (CFS), and
+   load it back at boot. Phases themselves are relative to our own rtimer,
+   which restarts on reboot, so they are relearned from the first
+   transmission; the drift estimate is then used right away. */
+#ifdef PHASE_CONF_PERSIST
+#define PHASE_PERSIST PHASE_CONF_PERSIST
+#else
+#define PHASE_PERSIST 0
+#endif
+
+/* Minimum time between two saves of the phase table, to limit flash wear */
+#ifdef PHASE_CONF_PERSIST_INTERVAL
+#define PHASE_PERSIST_INTERVAL PHASE_CONF_PERSIST_INTERVAL
+#else
+#define PHASE_PERSIST_INTERVAL (10 * 60 * CLOCK_SECOND)
+#endif
+
+#ifdef PHASE_CONF_PERSIST_FILE
+#define PHASE_PERSIST_FILE PHASE_CONF_PERSIST_FILE
+#else
+#define PHASE_PERSIST_FILE "phase"
+#endif
+
+#if PHASE_PERSIST && !PHASE_DRIFT_CORRECT
+#error "PHASE_CONF_PERSIST requires PHASE_CONF_DRIFT_CORRECT"
+#endif
+
+#if PHASE_PERSIST
+#include "cfs/cfs.h"
+#endif
+
+/* Set when the phase (time) is known, i.e. we reached the neighbor at
+   least once since boot */
+#define PHASE_FLAG_SYNCED 0x01
+
 struct phase {
   rtimer_clock_t time;
 #if PHASE_DRIFT_CORRECT
+  /* Time between the last two encounters, its offset from a whole
+     number of cycles is the drift accumulated over that time */
   rtimer_clock_t drift;
 #endif
+#if PHASE_MAX_AGE
+  clock_time_t updated;
+#endif
+  uint8_t flags;
   uint8_t noacks;
   struct timer noacks_timer;
 };
 
+#if PHASE_PERSIST
+/* One record of the persisted phase table */
+struct phase_record {
+  linkaddr_t addr;
+  rtimer_clock_t drift;
+};
+static struct ctimer persist_timer;
+#endif /* PHASE_PERSIST */
+
 struct phase_queueitem {
   struct ctimer timer;
   mac_callback_t mac_callback;
@@ -87,6 +146,67 @@ NBR_TABLE(struct phase, nbr_phase);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+#if PHASE_PERSIST
+static void
+persist_save(void *ptr)
+{
+  struct phase *e;
+  struct phase_record r;
+  int fd;
+
+  cfs_remove(PHASE_PERSIST_FILE);
+  fd = cfs_open(PHASE_PERSIST_FILE, CFS_WRITE);
+  if(fd < 0) {
+    PRINTF("phase: failed to save\n");
+    return;
+  }
+  for(e = nbr_table_head(nbr_phase); e != NULL; e = nbr_table_next(nbr_phase, e)) {
+    if(e->drift == 0) {
+      continue;
+    }
+    linkaddr_copy(&r.addr, nbr_table_get_lladdr(nbr_phase, e));
+    r.drift = e->drift;
+    if(cfs_write(fd, &r, sizeof(r)) != sizeof(r)) {
+      break;
+    }
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+static void
+persist_load(void)
+{
+  struct phase *e;
+  struct phase_record r;
+  int fd;
+
+  fd = cfs_open(PHASE_PERSIST_FILE, CFS_READ);
+  if(fd < 0) {
+    return;
+  }
+  while(cfs_read(fd, &r, sizeof(r)) == sizeof(r)) {
+    e = nbr_table_add_lladdr(nbr_phase, &r.addr);
+    if(e == NULL) {
+      break;
+    }
+    e->flags = 0;
+    e->drift = r.drift;
+    e->noacks = 0;
+    PRINTF("phase: loaded drift %u for %d.%d\n",
+           (unsigned)r.drift, r.addr.u8[0], r.addr.u8[1]);
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+static void
+persist_schedule(void)
+{
+  if(ctimer_expired(&persist_timer)) {
+    ctimer_set(&persist_timer, PHASE_PERSIST_INTERVAL, persist_save, NULL);
+  }
+}
+#endif /* PHASE_PERSIST */
+/*---------------------------------------------------------------------------*/
 void
 phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
              int mac_status)
@@ -98,9 +218,20 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
 #if PHASE_DRIFT_CORRECT
-      e->drift = time-e->time;
+      /* Only a previous encounter since boot gives a meaningful
+         interval, otherwise keep the (persisted) drift */
+      if(e->flags & PHASE_FLAG_SYNCED) {
+        e->drift = time - e->time;
+#if PHASE_PERSIST
+        persist_schedule();
+#endif
+      }
 #endif
       e->time = time;
+      e->flags |= PHASE_FLAG_SYNCED;
+#if PHASE_MAX_AGE
+      e->updated = clock_time();
+#endif
     }
     /* If the neighbor didn't reply to us, it may have switched
        phase (rebooted). We try a number of transmissions to it
@@ -126,9 +257,13 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
       if(e) {
         e->time = time;
 #if PHASE_DRIFT_CORRECT
-      e->drift = 0;
+        e->drift = 0;
 #endif
-      e->noacks = 0;
+#if PHASE_MAX_AGE
+        e->updated = clock_time();
+#endif
+        e->flags = PHASE_FLAG_SYNCED;
+        e->noacks = 0;
       }
     }
   }
@@ -163,6 +298,16 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
      time for the next expected phase and setup a ctimer to switch on
      the radio just before the phase. */
   e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  if(e != NULL && !(e->flags & PHASE_FLAG_SYNCED)) {
+    /* Only the drift is known, the phase is learned on this transmission */
+    e = NULL;
+  }
+#if PHASE_MAX_AGE
+  if(e != NULL && clock_time() - e->updated > PHASE_MAX_AGE) {
+    PRINTF("phase: stale phase for %d.%d\n", neighbor->u8[0], neighbor->u8[1]);
+    e = NULL;
+  }
+#endif
   if(e != NULL) {
     rtimer_clock_t wait, now, expected, sync;
     clock_time_t ctimewait;
@@ -186,13 +331,14 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
     sync = (e == NULL) ? now : e->time;
 
 #if PHASE_DRIFT_CORRECT
-    {
-      int32_t s;
-      if(e->drift > cycle_time) {
-        s = e->drift % cycle_time / (e->drift / cycle_time);  /* drift per cycle */
-        s = s * (now - sync) / cycle_time;                    /* estimated drift to now */
-        sync += s;                                            /* add it in */
-      }
+    if(e->drift > cycle_time) {
+      int32_t cycles, shift, elapsed;
+      /* The neighbor's wake-ups moved by shift over the last interval of
+         cycles cycles; it can be early (negative) or late (positive) */
+      cycles = ((int32_t)e->drift + cycle_time / 2) / cycle_time;
+      shift = (int32_t)e->drift - cycles * cycle_time;
+      elapsed = (rtimer_clock_t)(now - sync) / cycle_time;
+      sync += (int64_t)shift * elapsed / cycles;  /* estimated drift to now */
     }
 #endif
 
@@ -248,5 +394,8 @@ phase_init(void)
 {
   memb_init(&queued_packets_memb);
   nbr_table_register(nbr_phase, NULL);
+#if PHASE_PERSIST
+  persist_load();
+#endif
 }
 /*---------------------------------------------------------------------------*/
@@ -40,7 +40,10 @@
 
 #include "tsch-adaptive-timesync.h"
 #include "tsch-log.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/tsch-queue.h"
 #include <stdio.h>
+#include <string.h>
 
 #if TSCH_ADAPTIVE_TIMESYNC
 
@@ -53,31 +56,59 @@ static int32_t compensated_ticks;
 static uint8_t timesync_entry_count;
 /* Since last learning of the  drift; may be more than time since last timesync */
 static uint32_t asn_since_last_learning;
+/* All the adjustments made to our clock, corrections and compensation,
+ * in ticks since boot. Wraps around */
+static uint32_t clock_adjust_ticks;
 
 /* Units in which drift is stored: ppm * 256 */
 #define TSCH_DRIFT_UNIT (1000L * 1000 * 256)
 
+/* Observations of a neighbor closer than this are not used to learn
+ * its drift, and farther than this are too old */
+#define MODEL_MIN_ASN (16 * TSCH_SLOTS_PER_SECOND)
+#define MODEL_MAX_ASN (600UL * TSCH_SLOTS_PER_SECOND)
+
+/* The drift model of a neighbor, learned while it is our time source or
+ * from the timing of its frames otherwise */
+struct drift_model {
+  linkaddr_t addr;
+  uint8_t in_use;
+  /* Is drift_ppm learned? */
+  uint8_t learned;
+  /* Is the observation below valid? */
+  uint8_t observed;
+  /* Drift in the same units and reference as drift_ppm */
+  int32_t drift_ppm;
+  /* Last observation: the correction that would have aligned us with
+   * the neighbor at offset_asn, and clock_adjust_ticks at that time */
+  int32_t offset;
+  uint32_t offset_adjust;
+  struct asn_t offset_asn;
+};
+static struct drift_model models[TSCH_TIMESYNC_NUM_MODELS];
+
+#define NUM_TIMESYNC_ENTRIES 8
+static int32_t timesync_entries[NUM_TIMESYNC_ENTRIES];
+static uint8_t timesync_entry_pos;
+
 /*---------------------------------------------------------------------------*/
 /* Add a value to a moving average estimator */
 static int32_t
 timesync_entry_add(int32_t val, uint32_t time_delta)
 {
-#define NUM_TIMESYNC_ENTRIES 8
-  static int32_t buffer[NUM_TIMESYNC_ENTRIES];
-  static uint8_t pos;
   int i;
   if(timesync_entry_count == 0) {
-    pos = 0;
+    timesync_entry_pos = 0;
   }
-  buffer[pos] = val;
+  timesync_entries[timesync_entry_pos] = val;
   if(timesync_entry_count < NUM_TIMESYNC_ENTRIES) {
     timesync_entry_count++;
   }
-  pos = (pos + 1) % NUM_TIMESYNC_ENTRIES;
+  timesync_entry_pos = (timesync_entry_pos + 1) % NUM_TIMESYNC_ENTRIES;
 
   val = 0;
   for(i = 0; i < timesync_entry_count; ++i) {
-    val += buffer[i];
+    val += timesync_entries[i];
   }
   return val / timesync_entry_count;
 }
@@ -94,10 +125,62 @@ timesync_learn_drift_ticks(uint32_t time_delta_asn, int32_t drift_ticks)
   drift_ppm = timesync_entry_add(last_drift_ppm, time_delta_ticks);
 }
 /*---------------------------------------------------------------------------*/
+/* Is model a a better candidate for replacement than b? Free entries
+ * first, then models not learned yet, then the least recently observed */
+static int
+model_replaces_before(const struct drift_model *a, const struct drift_model *b)
+{
+  if(a->in_use != b->in_use) {
+    return !a->in_use;
+  }
+  if(a->learned != b->learned) {
+    return !a->learned;
+  }
+  return (int32_t)ASN_DIFF(b->offset_asn, a->offset_asn) > 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Get the drift model of a neighbor. If there is none and create is set,
+ * replace the entry that matters least */
+static struct drift_model *
+model_get(const linkaddr_t *addr, int create)
+{
+  struct drift_model *oldest = NULL;
+  int i;
+
+  for(i = 0; i < TSCH_TIMESYNC_NUM_MODELS; i++) {
+    struct drift_model *m = &models[i];
+    if(m->in_use && linkaddr_cmp(&m->addr, addr)) {
+      return m;
+    }
+    if(oldest == NULL || model_replaces_before(m, oldest)) {
+      oldest = m;
+    }
+  }
+  if(!create || oldest == NULL) {
+    return NULL;
+  }
+  memset(oldest, 0, sizeof(struct drift_model));
+  linkaddr_copy(&oldest->addr, addr);
+  oldest->in_use = 1;
+  return oldest;
+}
+/*---------------------------------------------------------------------------*/
+/* Record that a correction of offset ticks would align us with the neighbor */
+static void
+model_observe(struct drift_model *m, int32_t offset)
+{
+  m->observed = 1;
+  m->offset = offset;
+  m->offset_adjust = clock_adjust_ticks;
+  m->offset_asn = current_asn;
+}
+/*---------------------------------------------------------------------------*/
 /* Either reset or update the neighbor's drift */
 void
 tsch_timesync_update(struct tsch_neighbor *n, uint16_t time_delta_asn, int32_t drift_correction)
 {
+  struct drift_model *m = model_get(&n->addr, 1);
+
   /* Account the drift if either this is a new timesource,
    * or the timedelta is not too small, as smaller timedelta
    * means proportionally larger measurement error. */
@@ -107,17 +190,96 @@ tsch_timesync_update(struct tsch_neighbor *n, uint16_t time_delta_asn, int32_t d
     timesync_entry_count = 0;
     compensated_ticks = 0;
     asn_since_last_learning = 0;
+    if(m != NULL && m->learned) {
+      /* Start from what we learned about this neighbor, as time source
+       * or by observing its frames, rather than from scratch */
+      drift_ppm = timesync_entry_add(m->drift_ppm, 0);
+    }
   } else {
     asn_since_last_learning += time_delta_asn;
     if(asn_since_last_learning >= 4 * TSCH_SLOTS_PER_SECOND) {
       timesync_learn_drift_ticks(asn_since_last_learning, drift_correction);
       compensated_ticks = 0;
       asn_since_last_learning = 0;
+      if(m != NULL) {
+        m->drift_ppm = drift_ppm;
+        m->learned = 1;
+      }
     } else {
       /* Too small timedelta, do not recalculate the drift to avoid introducing error. instead account for the corrected ticks */
       compensated_ticks += drift_correction;
     }
   }
+
+  if(m != NULL) {
+    model_observe(m, drift_correction);
+  }
+  clock_adjust_ticks += drift_correction;
+}
+/*---------------------------------------------------------------------------*/
+/* Learn the drift of a neighbor other than the time source, from the
+ * correction that would have aligned us with its frame */
+void
+tsch_timesync_observe(const linkaddr_t *addr, int32_t drift_correction)
+{
+  struct drift_model *m = model_get(addr, 1);
+
+  if(m == NULL) {
+    return;
+  }
+  if(m->observed) {
+    uint32_t time_delta_asn = ASN_DIFF(current_asn, m->offset_asn);
+    if(time_delta_asn < MODEL_MIN_ASN) {
+      /* Keep the older observation, for a longer baseline */
+      return;
+    }
+    if(time_delta_asn <= MODEL_MAX_ASN) {
+      /* The neighbor drifted from our adjusted clock by the difference of
+       * offsets, and from the clock drift_ppm refers to by our
+       * adjustments on top of that */
+      uint32_t time_delta_ticks = time_delta_asn * tsch_timing[tsch_ts_timeslot_length];
+      int32_t drift_ticks = drift_correction - m->offset
+        + (int32_t)(clock_adjust_ticks - m->offset_adjust);
+      int32_t last_drift_ppm = (int32_t)((int64_t)drift_ticks * TSCH_DRIFT_UNIT / time_delta_ticks);
+      m->drift_ppm = m->learned ? (3 * m->drift_ppm + last_drift_ppm) / 4 : last_drift_ppm;
+      m->learned = 1;
+    }
+  }
+  model_observe(m, drift_correction);
+}
+/*---------------------------------------------------------------------------*/
+/* The keep-alive timeout our drift model allows: the time it takes for the
+ * spread of the recent drift estimates, plus a margin, to use up half of
+ * the Rx guard time on either side. */
+clock_time_t
+tsch_timesync_keepalive_timeout(void)
+{
+  int32_t residual = 0;
+  uint32_t guard_us;
+  unsigned long timeout;
+  int i;
+
+  if(last_timesource_neighbor == NULL || timesync_entry_count < NUM_TIMESYNC_ENTRIES) {
+    /* The model is not trusted yet */
+    return TSCH_KEEPALIVE_TIMEOUT;
+  }
+  for(i = 0; i < NUM_TIMESYNC_ENTRIES; i++) {
+    int32_t d = ABS(timesync_entries[i] - drift_ppm);
+    if(d > residual) {
+      residual = d;
+    }
+  }
+  residual += 256L * TSCH_TIMESYNC_KEEPALIVE_MARGIN_PPM;
+  guard_us = RTIMERTICKS_TO_US(tsch_timing[tsch_ts_rx_wait]) / 4;
+  timeout = (unsigned long)((uint64_t)guard_us * 256 * CLOCK_SECOND / residual);
+
+  if(timeout < TSCH_KEEPALIVE_TIMEOUT) {
+    return TSCH_KEEPALIVE_TIMEOUT;
+  }
+  if(timeout > TSCH_MAX_KEEPALIVE_TIMEOUT) {
+    return TSCH_MAX_KEEPALIVE_TIMEOUT;
+  }
+  return timeout;
 }
 /*---------------------------------------------------------------------------*/
 /* Error-accumulation free compensation algorithm */
@@ -158,6 +320,7 @@ tsch_timesync_adaptive_compensate(rtimer_clock_t time_delta_ticks)
     result = compensate_internal(time_delta_usec, drift_ppm,
         &remainder, &tick_conversion_error);
     compensated_ticks += result;
+    clock_adjust_ticks += result;
   }
 
   if(TSCH_BASE_DRIFT_PPM) {
@@ -177,6 +340,17 @@ tsch_timesync_update(struct tsch_neighbor *n, uint16_t time_delta_asn, int32_t d
 {
 }
 /*---------------------------------------------------------------------------*/
+void
+tsch_timesync_observe(const linkaddr_t *addr, int32_t drift_correction)
+{
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+tsch_timesync_keepalive_timeout(void)
+{
+  return TSCH_KEEPALIVE_TIMEOUT;
+}
+/*---------------------------------------------------------------------------*/
 int32_t
 tsch_timesync_adaptive_compensate(rtimer_clock_t delta_ticks)
 {
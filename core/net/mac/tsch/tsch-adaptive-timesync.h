@@ -72,6 +72,22 @@
 #define TSCH_BASE_DRIFT_PPM 0
 #endif
 
+/* Number of neighbors we keep a drift model for. The model of a new time
+ * source is used right away instead of learning its drift from scratch */
+#ifdef TSCH_CONF_TIMESYNC_NUM_MODELS
+#define TSCH_TIMESYNC_NUM_MODELS TSCH_CONF_TIMESYNC_NUM_MODELS
+#else
+#define TSCH_TIMESYNC_NUM_MODELS 4
+#endif
+
+/* Drift assumed on top of the spread of the drift estimates when
+ * lengthening the keep-alive timeout, in ppm */
+#ifdef TSCH_CONF_TIMESYNC_KEEPALIVE_MARGIN_PPM
+#define TSCH_TIMESYNC_KEEPALIVE_MARGIN_PPM TSCH_CONF_TIMESYNC_KEEPALIVE_MARGIN_PPM
+#else
+#define TSCH_TIMESYNC_KEEPALIVE_MARGIN_PPM 4
+#endif
+
 /* The approximate number of slots per second */
 #define TSCH_SLOTS_PER_SECOND (1000000 / TSCH_DEFAULT_TS_TIMESLOT_LENGTH)
 
@@ -84,6 +100,15 @@ extern struct tsch_neighbor *last_timesource_neighbor;
 
 void tsch_timesync_update(struct tsch_neighbor *n, uint16_t time_delta_asn, int32_t drift_correction);
 
+/* Update the drift model of a neighbor other than the time source, from
+ * the correction that would have aligned us with a frame it sent */
+void tsch_timesync_observe(const linkaddr_t *addr, int32_t drift_correction);
+
+/* The keep-alive timeout, between TSCH_KEEPALIVE_TIMEOUT and
+ * TSCH_MAX_KEEPALIVE_TIMEOUT depending on the accuracy of the drift model
+ * of the time source */
+clock_time_t tsch_timesync_keepalive_timeout(void);
+
 int32_t tsch_timesync_adaptive_compensate(rtimer_clock_t delta_ticks);
 
 #endif /* __TSCH_ADAPTIVE_TIMESYNC_H__ */
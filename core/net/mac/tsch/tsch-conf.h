@@ -175,4 +175,35 @@
 #define TSCH_ADAPTIVE_TIMESYNC 0
 #endif
 
+/* Number of radios. The radios other than NETSTACK_RADIO only receive: in a
+ * timeslot where NETSTACK_RADIO does not transmit, each listens on another
+ * link with Rx option active in the same timeslot, on a distinct channel
+ * offset. Meant for the coordinator, which receives from the whole network */
+#ifdef TSCH_CONF_NUM_RADIOS
+#define TSCH_NUM_RADIOS TSCH_CONF_NUM_RADIOS
+#else
+#define TSCH_NUM_RADIOS 1
+#endif
+
+/* The radio drivers other than NETSTACK_RADIO, as an initializer of
+ * TSCH_NUM_RADIOS - 1 pointers, e.g. { &cc2420_b_driver }. The drivers
+ * must be declared in the project configuration */
+#if TSCH_NUM_RADIOS > 1
+#ifdef TSCH_CONF_SECONDARY_RADIOS
+#define TSCH_SECONDARY_RADIOS TSCH_CONF_SECONDARY_RADIOS
+#else
+#error "TSCH: TSCH_CONF_NUM_RADIOS > 1 requires TSCH_CONF_SECONDARY_RADIOS"
+#endif
+#endif /* TSCH_NUM_RADIOS > 1 */
+
+/* Take the radio delays from the RADIO_CONST_CAPABILITIES of
+ * NETSTACK_RADIO at init, when it reports them, rather than from the
+ * RADIO_DELAY_* of the platform, which then become optional. Also resync
+ * on SFD timestamps whenever the radio has them */
+#ifdef TSCH_CONF_RADIO_CAPABILITIES
+#define TSCH_RADIO_CAPABILITIES TSCH_CONF_RADIO_CAPABILITIES
+#else
+#define TSCH_RADIO_CAPABILITIES 0
+#endif
+
 #endif /* __TSCH_CONF_H__ */
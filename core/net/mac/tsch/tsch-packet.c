@@ -187,9 +187,77 @@ tsch_packet_parse_eack(const uint8_t *buf, int buf_size,
   return curr_len;
 }
 /*---------------------------------------------------------------------------*/
-/* Create an EB packet */
-int
-tsch_packet_create_eb(uint8_t *buf, int buf_size, uint8_t seqno,
+#if TSCH_PACKET_EB_CACHE
+/* The parameters an EB carries, other than ASN, join priority and seqno */
+struct eb_params {
+  uint16_t pan_id;
+  uint8_t pan_secured;
+  uint8_t security_level;
+  uint8_t key_id_mode;
+  uint8_t key_index;
+#if TSCH_PACKET_EB_WITH_TIMESLOT_TIMING
+  rtimer_clock_t timing[tsch_ts_elements_count];
+#endif /* TSCH_PACKET_EB_WITH_TIMESLOT_TIMING */
+#if TSCH_PACKET_EB_WITH_HOPPING_SEQUENCE
+  uint8_t hopping_sequence_len;
+  uint8_t hopping_sequence[TSCH_HOPPING_SEQUENCE_MAX_LEN];
+#endif /* TSCH_PACKET_EB_WITH_HOPPING_SEQUENCE */
+#if TSCH_PACKET_EB_WITH_SLOTFRAME_AND_LINK
+  uint16_t sf0_size;
+  uint16_t link0_channel_offset;
+  uint8_t link0_options;
+  uint8_t has_link0;
+#endif /* TSCH_PACKET_EB_WITH_SLOTFRAME_AND_LINK */
+};
+
+static struct {
+  struct eb_params params;
+  uint8_t buf[TSCH_PACKET_MAX_LEN];
+  uint8_t len;
+  uint8_t hdr_len;
+  uint8_t tsch_sync_ie_offset;
+} eb_cache;
+
+/* Reads the current EB parameters */
+static void
+eb_params_get(struct eb_params *params)
+{
+  /* Zero the padding too, params are compared with memcmp */
+  memset(params, 0, sizeof(*params));
+  params->pan_id = frame802154_get_pan_id();
+#if TSCH_SECURITY_ENABLED
+  if(tsch_is_pan_secured) {
+    params->pan_secured = 1;
+    params->security_level = packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL);
+    params->key_id_mode = packetbuf_attr(PACKETBUF_ATTR_KEY_ID_MODE);
+    params->key_index = packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX);
+  }
+#endif /* TSCH_SECURITY_ENABLED */
+#if TSCH_PACKET_EB_WITH_TIMESLOT_TIMING
+  memcpy(params->timing, tsch_timing, sizeof(params->timing));
+#endif /* TSCH_PACKET_EB_WITH_TIMESLOT_TIMING */
+#if TSCH_PACKET_EB_WITH_HOPPING_SEQUENCE
+  params->hopping_sequence_len = tsch_hopping_sequence_length.val;
+  memcpy(params->hopping_sequence, tsch_hopping_sequence, params->hopping_sequence_len);
+#endif /* TSCH_PACKET_EB_WITH_HOPPING_SEQUENCE */
+#if TSCH_PACKET_EB_WITH_SLOTFRAME_AND_LINK
+  {
+    struct tsch_slotframe *sf0 = tsch_schedule_get_slotframe_by_handle(0);
+    struct tsch_link *link0 = tsch_schedule_get_link_by_timeslot(sf0, 0);
+    if(sf0 && link0) {
+      params->sf0_size = sf0->size.val;
+      params->link0_channel_offset = link0->channel_offset;
+      params->link0_options = link0->link_options;
+      params->has_link0 = 1;
+    }
+  }
+#endif /* TSCH_PACKET_EB_WITH_SLOTFRAME_AND_LINK */
+}
+#endif /* TSCH_PACKET_EB_CACHE */
+/*---------------------------------------------------------------------------*/
+/* Build an EB packet */
+static int
+create_eb(uint8_t *buf, int buf_size, uint8_t seqno,
     uint8_t *hdr_len, uint8_t *tsch_sync_ie_offset)
 {
   int ret = 0;
@@ -334,6 +402,155 @@ tsch_packet_create_eb(uint8_t *buf, int buf_size, uint8_t seqno,
   return curr_len;
 }
 /*---------------------------------------------------------------------------*/
+/* Create an EB packet */
+int
+tsch_packet_create_eb(uint8_t *buf, int buf_size, uint8_t seqno,
+    uint8_t *hdr_len, uint8_t *tsch_sync_ie_offset)
+{
+#if TSCH_PACKET_EB_CACHE
+  struct eb_params params;
+  int len;
+
+  if(buf_size < TSCH_PACKET_MAX_LEN) {
+    return 0;
+  }
+
+  eb_params_get(&params);
+  if(eb_cache.len > 0 && memcmp(&params, &eb_cache.params, sizeof(params)) == 0) {
+    /* Same parameters: reuse the last EB, with the new seqno */
+    memcpy(buf, eb_cache.buf, eb_cache.len);
+#if !FRAME802154_SUPPR_SEQNO
+    /* The seqno follows the 2-byte frame control field */
+    buf[2] = seqno;
+#endif /* !FRAME802154_SUPPR_SEQNO */
+    if(hdr_len != NULL) {
+      *hdr_len = eb_cache.hdr_len;
+    }
+    if(tsch_sync_ie_offset != NULL) {
+      *tsch_sync_ie_offset = eb_cache.tsch_sync_ie_offset;
+    }
+    return eb_cache.len;
+  }
+
+  len = create_eb(buf, buf_size, seqno, &eb_cache.hdr_len, &eb_cache.tsch_sync_ie_offset);
+  if(len > 0) {
+    memcpy(eb_cache.buf, buf, len);
+    memcpy(&eb_cache.params, &params, sizeof(params));
+    eb_cache.len = len;
+    if(hdr_len != NULL) {
+      *hdr_len = eb_cache.hdr_len;
+    }
+    if(tsch_sync_ie_offset != NULL) {
+      *tsch_sync_ie_offset = eb_cache.tsch_sync_ie_offset;
+    }
+  } else {
+    eb_cache.len = 0;
+  }
+  return len;
+#else /* TSCH_PACKET_EB_CACHE */
+  return create_eb(buf, buf_size, seqno, hdr_len, tsch_sync_ie_offset);
+#endif /* TSCH_PACKET_EB_CACHE */
+}
+/*---------------------------------------------------------------------------*/
+/* Create a unicast data frame carrying a payload IETF IE (6top) */
+int
+tsch_packet_create_ietf(uint8_t *buf, int buf_size, const linkaddr_t *dest_addr,
+    uint8_t seqno, const uint8_t *content, uint16_t content_len, uint8_t *hdr_len)
+{
+  int ret;
+  uint8_t curr_len = 0;
+  frame802154_t p;
+  struct ieee802154_ies ies;
+
+  if(buf_size < TSCH_PACKET_MAX_LEN || dest_addr == NULL) {
+    return 0;
+  }
+
+  /* Create 802.15.4 header */
+  memset(&p, 0, sizeof(p));
+  p.fcf.frame_type = FRAME802154_DATAFRAME;
+  p.fcf.ie_list_present = 1;
+  p.fcf.frame_version = FRAME802154_IEEE802154E_2012;
+  p.fcf.ack_required = 1;
+  p.fcf.src_addr_mode = FRAME802154_LONGADDRMODE;
+  p.fcf.dest_addr_mode = FRAME802154_LONGADDRMODE;
+  p.seq = seqno;
+  /* Include the destination PAN ID only */
+  p.fcf.panid_compression = 0;
+  p.src_pid = frame802154_get_pan_id();
+  p.dest_pid = frame802154_get_pan_id();
+  linkaddr_copy((linkaddr_t *)&p.src_addr, &linkaddr_node_addr);
+  linkaddr_copy((linkaddr_t *)&p.dest_addr, dest_addr);
+
+#if TSCH_SECURITY_ENABLED
+  if(tsch_is_pan_secured) {
+    p.fcf.security_enabled = packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) > 0;
+    p.aux_hdr.security_control.security_level = packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL);
+    p.aux_hdr.security_control.key_id_mode = packetbuf_attr(PACKETBUF_ATTR_KEY_ID_MODE);
+    p.aux_hdr.security_control.frame_counter_suppression = 1;
+    p.aux_hdr.security_control.frame_counter_size = 1;
+    p.aux_hdr.key_index = packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX);
+  }
+#endif /* TSCH_SECURITY_ENABLED */
+
+  if((curr_len = frame802154_create(&p, buf)) == 0) {
+    return 0;
+  }
+
+  /* The receiver secures everything after the frame802154 header, IEs included */
+  if(hdr_len != NULL) {
+    *hdr_len = curr_len;
+  }
+
+  memset(&ies, 0, sizeof(ies));
+
+  /* Header-IE termination IE, payload IEs follow */
+  if((ret = frame80215e_create_ie_header_list_termination_1(buf + curr_len, buf_size - curr_len, &ies)) == -1) {
+    return -1;
+  }
+  curr_len += ret;
+
+  ies.ie_ietf_len = content_len;
+  if(curr_len + 2 + content_len > TSCH_PACKET_MAX_LEN
+     || (ret = frame80215e_create_ie_ietf(buf + curr_len, buf_size - curr_len, &ies)) == -1) {
+    return -1;
+  }
+  curr_len += ret;
+  memcpy(buf + curr_len, content, content_len);
+  curr_len += content_len;
+
+  return curr_len;
+}
+/*---------------------------------------------------------------------------*/
+/* Parse a data frame with IEs, extract the payload IETF IE (6top) if any */
+int
+tsch_packet_parse_ietf(const uint8_t *buf, int buf_size,
+    frame802154_t *frame, struct ieee802154_ies *ies)
+{
+  int ret;
+
+  if(frame == NULL || ies == NULL || buf_size < 0) {
+    return 0;
+  }
+
+  memset(ies, 0, sizeof(struct ieee802154_ies));
+
+  if((ret = frame802154_parse((uint8_t *)buf, buf_size, frame)) == 0
+     || frame->fcf.frame_type != FRAME802154_DATAFRAME
+     || !frame->fcf.ie_list_present) {
+    return 0;
+  }
+
+  /* Incoming frames are authenticated and stripped of their MIC in the slot
+   * operation, so buf_size is the exact frame len */
+  if(frame802154e_parse_information_elements(buf + ret, buf_size - ret, ies) == -1) {
+    PRINTF("TSCH:! parse_ietf: failed to parse IEs\n");
+    return 0;
+  }
+
+  return ies->ie_ietf != NULL;
+}
+/*---------------------------------------------------------------------------*/
 /* Update ASN in EB packet */
 int
 tsch_packet_update_eb(uint8_t *buf, int buf_size, uint8_t tsch_sync_ie_offset)
@@ -63,6 +63,15 @@
 #define TSCH_PACKET_EB_WITH_SLOTFRAME_AND_LINK 0
 #endif
 
+/* TSCH EB: keep the last EB built, and reuse it as long as the parameters it
+ * carries are unchanged. Only the seqno and the Sync IE (ASN and join
+ * priority, updated at Tx time) then differ between EBs */
+#ifdef TSCH_PACKET_CONF_EB_CACHE
+#define TSCH_PACKET_EB_CACHE TSCH_PACKET_CONF_EB_CACHE
+#else
+#define TSCH_PACKET_EB_CACHE 1
+#endif
+
 /* Include source address in ACK? */
 #ifdef TSCH_PACKET_CONF_EACK_WITH_SRC_ADDR
 #define TSCH_PACKET_EACK_WITH_SRC_ADDR TSCH_PACKET_CONF_EACK_WITH_SRC_ADDR
@@ -94,6 +103,12 @@ int tsch_packet_parse_eack(const uint8_t *buf, int buf_size,
 /* Create an EB packet */
 int tsch_packet_create_eb(uint8_t *buf, int buf_size,
     uint8_t seqno, uint8_t *hdr_len, uint8_t *tsch_sync_ie_ptr);
+/* Create a unicast data frame carrying a payload IETF IE (6top) */
+int tsch_packet_create_ietf(uint8_t *buf, int buf_size, const linkaddr_t *dest_addr,
+    uint8_t seqno, const uint8_t *content, uint16_t content_len, uint8_t *hdr_len);
+/* Parse a data frame with IEs, return 1 if it carries a payload IETF IE */
+int tsch_packet_parse_ietf(const uint8_t *buf, int buf_size,
+    frame802154_t *frame, struct ieee802154_ies *ies);
 /* Update ASN in EB packet */
 int tsch_packet_update_eb(uint8_t *buf, int buf_size, uint8_t tsch_sync_ie_offset);
 /* Parse EB and extract ASN and join priority */
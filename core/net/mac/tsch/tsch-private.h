@@ -84,6 +84,14 @@ extern uint8_t tsch_hopping_sequence[TSCH_HOPPING_SEQUENCE_MAX_LEN];
 extern struct asn_divisor_t tsch_hopping_sequence_length;
 /* TSCH timeslot timing (in rtimer ticks) */
 extern rtimer_clock_t tsch_timing[tsch_ts_elements_count];
+#if TSCH_RADIO_CAPABILITIES
+/* Radio delays (in rtimer ticks) and SFD timestamp support, as reported
+ * by the radio */
+extern rtimer_clock_t tsch_radio_delay_before_tx;
+extern rtimer_clock_t tsch_radio_delay_before_rx;
+extern rtimer_clock_t tsch_radio_delay_before_detect;
+extern uint8_t tsch_radio_sfd_timestamps;
+#endif /* TSCH_RADIO_CAPABILITIES */
 
 /* TSCH processes */
 PROCESS_NAME(tsch_process);
@@ -96,6 +104,10 @@ PROCESS_NAME(tsch_pending_events_process);
 void tsch_schedule_keepalive(void);
 /* Leave the TSCH network */
 void tsch_disassociate(void);
+#if TSCH_RADIO_CAPABILITIES
+/* Read the radio delays from RADIO_CONST_CAPABILITIES */
+void tsch_radio_capabilities_init(void);
+#endif /* TSCH_RADIO_CAPABILITIES */
 
 /************ Macros **********/
 
@@ -108,6 +120,28 @@ void tsch_disassociate(void);
 #define TSCH_CLOCK_TO_TICKS(c) (((c) * RTIMER_SECOND) / CLOCK_SECOND)
 #define TSCH_CLOCK_TO_SLOTS(c, timeslot_length) (TSCH_CLOCK_TO_TICKS(c) / timeslot_length)
 
+/* Radio delays and SFD timestamp use in the slot operation */
+#if TSCH_RADIO_CAPABILITIES
+#ifndef RADIO_DELAY_BEFORE_TX
+#define RADIO_DELAY_BEFORE_TX 0
+#endif
+#ifndef RADIO_DELAY_BEFORE_RX
+#define RADIO_DELAY_BEFORE_RX 0
+#endif
+#ifndef RADIO_DELAY_BEFORE_DETECT
+#define RADIO_DELAY_BEFORE_DETECT 0
+#endif
+#define TSCH_RADIO_DELAY_BEFORE_TX     tsch_radio_delay_before_tx
+#define TSCH_RADIO_DELAY_BEFORE_RX     tsch_radio_delay_before_rx
+#define TSCH_RADIO_DELAY_BEFORE_DETECT tsch_radio_delay_before_detect
+#define TSCH_RADIO_SFD_TIMESTAMPS      (TSCH_RESYNC_WITH_SFD_TIMESTAMPS || tsch_radio_sfd_timestamps)
+#else /* TSCH_RADIO_CAPABILITIES */
+#define TSCH_RADIO_DELAY_BEFORE_TX     RADIO_DELAY_BEFORE_TX
+#define TSCH_RADIO_DELAY_BEFORE_RX     RADIO_DELAY_BEFORE_RX
+#define TSCH_RADIO_DELAY_BEFORE_DETECT RADIO_DELAY_BEFORE_DETECT
+#define TSCH_RADIO_SFD_TIMESTAMPS      TSCH_RESYNC_WITH_SFD_TIMESTAMPS
+#endif /* TSCH_RADIO_CAPABILITIES */
+
 /* Wait for a condition with timeout t0+offset. */
 #define BUSYWAIT_UNTIL_ABS(cond, t0, offset) \
   while(!(cond) && RTIMER_CLOCK_LT(RTIMER_NOW(), (t0) + (offset))) ;
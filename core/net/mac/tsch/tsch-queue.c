@@ -54,6 +54,9 @@
 #include "net/mac/tsch/tsch-schedule.h"
 #include "net/mac/tsch/tsch-slot-operation.h"
 #include "net/mac/tsch/tsch-log.h"
+#if NETSTACK_CONF_WITH_IPV6
+#include "net/ip/uip.h"
+#endif /* NETSTACK_CONF_WITH_IPV6 */
 #include <string.h>
 
 #if TSCH_LOG_LEVEL >= 1
@@ -68,15 +71,231 @@
 #error TSCH_QUEUE_NUM_PER_NEIGHBOR must be power of two
 #endif
 
+#if TSCH_QUEUE_NUM_CLASSES < 1 || TSCH_QUEUE_NUM_CLASSES > 8
+#error TSCH_QUEUE_NUM_CLASSES must be in [1;8]
+#endif
+
 /* We have as many packets are there are queuebuf in the system */
 MEMB(packet_memb, struct tsch_packet, QUEUEBUF_NUM);
 MEMB(neighbor_memb, struct tsch_neighbor, TSCH_QUEUE_MAX_NEIGHBOR_QUEUES);
 LIST(neighbor_list);
+#if TSCH_QUEUE_SHARED_POOL
+/* The packets borrowed from the pool, in enqueueing order. Only used from
+ * the process context. */
+LIST(borrowed_list);
+#endif /* TSCH_QUEUE_SHARED_POOL */
 
 /* Broadcast and EB virtual neighbors */
 struct tsch_neighbor *n_broadcast;
 struct tsch_neighbor *n_eb;
 
+/* The ready set: a bitmap, indexed like neighbor_memb, of the unicast
+ * neighbors with no Tx link, packets to send and no backoff. These are the
+ * neighbors that may use a shared link. The ready set is only changed from
+ * the slot operation or with the lock held; the process context posts the
+ * neighbors it changed as ready events instead, processed at the next
+ * lookup. If the events overflow, the whole set is recomputed. */
+#define READY_SET_WORDS ((TSCH_QUEUE_MAX_NEIGHBOR_QUEUES + 31) / 32)
+#define READY_EVENTS_NUM 8
+static uint32_t ready_set[READY_SET_WORDS];
+static uint8_t ready_events[READY_EVENTS_NUM];
+static struct ringbufindex ready_events_ringbuf;
+static volatile uint8_t ready_events_overflow;
+
+#ifdef TSCH_QUEUE_CLASS_WEIGHTS
+static const uint8_t class_weights[TSCH_QUEUE_NUM_CLASSES] = TSCH_QUEUE_CLASS_WEIGHTS;
+#endif /* TSCH_QUEUE_CLASS_WEIGHTS */
+
+/*---------------------------------------------------------------------------*/
+/* Returns the class of the packet in packetbuf */
+static uint8_t
+packet_class(void)
+{
+#if TSCH_QUEUE_NUM_CLASSES > 1
+#ifdef TSCH_CALLBACK_QUEUE_CLASS
+  uint8_t c = TSCH_CALLBACK_QUEUE_CLASS();
+  return c < TSCH_QUEUE_NUM_CLASSES ? c : TSCH_QUEUE_NUM_CLASSES - 1;
+#else /* TSCH_CALLBACK_QUEUE_CLASS */
+#if NETSTACK_CONF_WITH_IPV6
+  /* Control traffic first: RPL and ND are ICMPv6 */
+  if(packetbuf_attr(PACKETBUF_ATTR_NETWORK_ID) == UIP_PROTO_ICMP6) {
+    return 0;
+  }
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+  return TSCH_QUEUE_NUM_CLASSES - 1;
+#endif /* TSCH_CALLBACK_QUEUE_CLASS */
+#else /* TSCH_QUEUE_NUM_CLASSES > 1 */
+  return 0;
+#endif /* TSCH_QUEUE_NUM_CLASSES > 1 */
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the head packet of a class queue, if it may go on the link */
+static struct tsch_packet *
+get_packet_in_class(const struct tsch_neighbor *n, uint8_t c, struct tsch_link *link)
+{
+  int16_t get_index = ringbufindex_peek_get(&n->tx_ringbuf[c]);
+  if(get_index != -1) {
+#if TSCH_WITH_LINK_SELECTOR
+    int packet_attr_slotframe = queuebuf_attr(n->tx_array[c][get_index]->qb, PACKETBUF_ATTR_TSCH_SLOTFRAME);
+    int packet_attr_timeslot = queuebuf_attr(n->tx_array[c][get_index]->qb, PACKETBUF_ATTR_TSCH_TIMESLOT);
+    if(packet_attr_slotframe != 0xffff && packet_attr_slotframe != link->slotframe_handle) {
+      return NULL;
+    }
+    if(packet_attr_timeslot != 0xffff && packet_attr_timeslot != link->timeslot) {
+      return NULL;
+    }
+#endif
+#ifdef TSCH_CALLBACK_LINK_ALLOWS_CLASS
+    if(link != NULL && !TSCH_CALLBACK_LINK_ALLOWS_CLASS(link, c)) {
+      return NULL;
+    }
+#endif
+    return n->tx_array[c][get_index];
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Are all class queues of the neighbor empty? */
+static int
+nbr_queue_is_empty(const struct tsch_neighbor *n)
+{
+  uint8_t c;
+  for(c = 0; c < TSCH_QUEUE_NUM_CLASSES; c++) {
+    if(!ringbufindex_empty(&n->tx_ringbuf[c])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Adds the neighbor to, or removes it from, the ready set. Call from the
+ * slot operation or with the lock held. */
+static void
+update_ready(const struct tsch_neighbor *n)
+{
+  uint8_t i = n - (struct tsch_neighbor *)neighbor_memb.mem;
+  uint32_t bit = (uint32_t)1 << (i % 32);
+  if(!n->is_broadcast && n->tx_links_count == 0
+     && n->backoff_window == 0 && !nbr_queue_is_empty(n)) {
+    ready_set[i / 32] |= bit;
+  } else {
+    ready_set[i / 32] &= ~bit;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Posts a ready event for the neighbor, from the process context */
+static void
+post_ready_event(const struct tsch_neighbor *n)
+{
+  int16_t put_index = ringbufindex_peek_put(&ready_events_ringbuf);
+  if(put_index != -1) {
+    ready_events[put_index] = n - (struct tsch_neighbor *)neighbor_memb.mem;
+    ringbufindex_put(&ready_events_ringbuf);
+  } else {
+    ready_events_overflow = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Applies the ready events. Call from the slot operation or with the lock
+ * held. */
+static void
+process_ready_events(void)
+{
+  int16_t get_index;
+  if(ready_events_overflow) {
+    struct tsch_neighbor *n = list_head(neighbor_list);
+    ready_events_overflow = 0;
+    while(n != NULL) {
+      update_ready(n);
+      n = list_item_next(n);
+    }
+  }
+  while((get_index = ringbufindex_get(&ready_events_ringbuf)) != -1) {
+    uint8_t i = ready_events[get_index];
+    /* Skip events of neighbors freed since */
+    if(neighbor_memb.count[i]) {
+      update_ready((struct tsch_neighbor *)neighbor_memb.mem + i);
+    }
+  }
+}
+#if TSCH_QUEUE_SHARED_POOL
+/*---------------------------------------------------------------------------*/
+/* Returns the number of packets a neighbor borrowed from the pool */
+static int
+nbr_borrowed_count(const struct tsch_neighbor *n)
+{
+  uint8_t c;
+  int count = 0;
+  for(c = 0; c < TSCH_QUEUE_NUM_CLASSES; c++) {
+    count += n->borrowed_count[c];
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Moves the borrowed packets of a neighbor to its class queues, in order,
+ * as far as they have room. Call from the process context, without lock. */
+static void
+move_borrowed_packets(struct tsch_neighbor *n)
+{
+  struct tsch_packet *p = list_head(borrowed_list);
+  uint8_t full = 0; /* The classes whose ringbuf is full */
+  uint8_t moved = 0;
+  while(p != NULL && nbr_borrowed_count(n) > 0) {
+    struct tsch_packet *next = list_item_next(p);
+    uint8_t c = p->queue_class;
+    if(p->nbr == n && !(full & (1 << c))) {
+      int16_t put_index = ringbufindex_peek_put(&n->tx_ringbuf[c]);
+      if(put_index == -1) {
+        /* Later packets of this class must wait too, to keep the order */
+        full |= 1 << c;
+      } else {
+        list_remove(borrowed_list, p);
+        n->borrowed_count[c]--;
+        /* Add to ringbuf (actual add committed through atomic operation) */
+        n->tx_array[c][put_index] = p;
+        ringbufindex_put(&n->tx_ringbuf[c]);
+        moved = 1;
+      }
+    }
+    p = next;
+  }
+  if(moved) {
+    post_ready_event(n);
+  }
+}
+#endif /* TSCH_QUEUE_SHARED_POOL */
+/*---------------------------------------------------------------------------*/
+/* Removes the head packet of a class queue */
+static struct tsch_packet *
+dequeue_packet(struct tsch_neighbor *n, uint8_t c)
+{
+  struct tsch_packet *p;
+  /* Get and remove packet from ringbuf (remove committed through an atomic operation */
+  int16_t get_index = ringbufindex_get(&n->tx_ringbuf[c]);
+  if(get_index == -1) {
+    return NULL;
+  }
+  p = n->tx_array[c][get_index];
+#ifdef TSCH_QUEUE_CLASS_WEIGHTS
+  if(n->tx_credits[c] > 0) {
+    n->tx_credits[c]--;
+  }
+  /* Start a new round once no class with packets has credits left */
+  for(c = 0; c < TSCH_QUEUE_NUM_CLASSES; c++) {
+    if(n->tx_credits[c] > 0 && !ringbufindex_empty(&n->tx_ringbuf[c])) {
+      break;
+    }
+  }
+  if(c == TSCH_QUEUE_NUM_CLASSES) {
+    memcpy(n->tx_credits, class_weights, sizeof(n->tx_credits));
+  }
+#endif /* TSCH_QUEUE_CLASS_WEIGHTS */
+#ifdef TSCH_CALLBACK_QUEUE_CHANGED
+  TSCH_CALLBACK_QUEUE_CHANGED(TSCH_QUEUE_EVENT_SHRINK, n);
+#endif
+  return p;
+}
+
 /*---------------------------------------------------------------------------*/
 /* Add a TSCH neighbor */
 struct tsch_neighbor *
@@ -87,15 +306,22 @@ tsch_queue_add_nbr(const linkaddr_t *addr)
   n = tsch_queue_get_nbr(addr);
   if(n == NULL) {
     if(tsch_get_lock()) {
+      uint8_t c;
       /* Allocate a neighbor */
       n = memb_alloc(&neighbor_memb);
       if(n != NULL) {
         /* Initialize neighbor entry */
         memset(n, 0, sizeof(struct tsch_neighbor));
-        ringbufindex_init(&n->tx_ringbuf, TSCH_QUEUE_NUM_PER_NEIGHBOR);
+        for(c = 0; c < TSCH_QUEUE_NUM_CLASSES; c++) {
+          ringbufindex_init(&n->tx_ringbuf[c], TSCH_QUEUE_NUM_PER_NEIGHBOR);
+        }
+#ifdef TSCH_QUEUE_CLASS_WEIGHTS
+        memcpy(n->tx_credits, class_weights, sizeof(n->tx_credits));
+#endif /* TSCH_QUEUE_CLASS_WEIGHTS */
         linkaddr_copy(&n->addr, addr);
         n->is_broadcast = linkaddr_cmp(addr, &tsch_eb_address)
           || linkaddr_cmp(addr, &tsch_broadcast_address);
+        /* Also resets its ready state, as we hold the lock */
         tsch_queue_backoff_reset(n);
         /* Add neighbor to the list */
         list_add(neighbor_list, n);
@@ -219,9 +445,14 @@ tsch_queue_remove_nbr(struct tsch_neighbor *n)
 {
   if(n != NULL) {
     if(tsch_get_lock()) {
+      uint8_t i;
 
       /* Remove neighbor from list */
       list_remove(neighbor_list, n);
+      /* And from the ready set, once its pending events are applied */
+      process_ready_events();
+      i = n - (struct tsch_neighbor *)neighbor_memb.mem;
+      ready_set[i / 32] &= ~((uint32_t)1 << (i % 32));
 
       tsch_release_lock();
 
@@ -244,8 +475,20 @@ tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr)
   if(!tsch_is_locked()) {
     n = tsch_queue_add_nbr(addr);
     if(n != NULL) {
-      put_index = ringbufindex_peek_put(&n->tx_ringbuf);
+      uint8_t c = packet_class();
+#if TSCH_QUEUE_SHARED_POOL
+      uint8_t borrow;
+      /* Packets borrowed earlier go first */
+      move_borrowed_packets(n);
+      put_index = ringbufindex_peek_put(&n->tx_ringbuf[c]);
+      /* Over the soft limit, borrow from the pool unless it is down to
+       * its reserve */
+      borrow = put_index == -1 || n->borrowed_count[c] > 0;
+      if(!borrow || memb_numfree(&packet_memb) > TSCH_QUEUE_POOL_RESERVE) {
+#else /* TSCH_QUEUE_SHARED_POOL */
+      put_index = ringbufindex_peek_put(&n->tx_ringbuf[c]);
       if(put_index != -1) {
+#endif /* TSCH_QUEUE_SHARED_POOL */
         p = memb_alloc(&packet_memb);
         if(p != NULL) {
           /* Enqueue packet */
@@ -258,9 +501,21 @@ tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr)
             p->ptr = ptr;
             p->ret = MAC_TX_DEFERRED;
             p->transmissions = 0;
-            /* Add to ringbuf (actual add committed through atomic operation) */
-            n->tx_array[put_index] = p;
-            ringbufindex_put(&n->tx_ringbuf);
+#if TSCH_QUEUE_SHARED_POOL
+            p->nbr = n;
+            p->queue_class = c;
+            if(borrow) {
+              /* Wait out of the ringbuf, see move_borrowed_packets */
+              list_add(borrowed_list, p);
+              n->borrowed_count[c]++;
+            } else
+#endif /* TSCH_QUEUE_SHARED_POOL */
+            {
+              /* Add to ringbuf (actual add committed through atomic operation) */
+              n->tx_array[c][put_index] = p;
+              ringbufindex_put(&n->tx_ringbuf[c]);
+              post_ready_event(n);
+            }
 #ifdef TSCH_CALLBACK_QUEUE_CHANGED
             TSCH_CALLBACK_QUEUE_CHANGED(TSCH_QUEUE_EVENT_GROW, n);
 #endif
@@ -284,27 +539,59 @@ tsch_queue_packet_count(const linkaddr_t *addr)
   if(!tsch_is_locked()) {
     n = tsch_queue_add_nbr(addr);
     if(n != NULL) {
-      return ringbufindex_elements(&n->tx_ringbuf);
+      uint8_t c;
+      int count = 0;
+      for(c = 0; c < TSCH_QUEUE_NUM_CLASSES; c++) {
+        count += ringbufindex_elements(&n->tx_ringbuf[c]);
+      }
+#if TSCH_QUEUE_SHARED_POOL
+      count += nbr_borrowed_count(n);
+#endif /* TSCH_QUEUE_SHARED_POOL */
+      return count;
     }
   }
   return -1;
 }
 /*---------------------------------------------------------------------------*/
-/* Remove first packet from a neighbor queue */
+/* Remove first packet from a neighbor queue, highest class first */
 struct tsch_packet *
 tsch_queue_remove_packet_from_queue(struct tsch_neighbor *n)
 {
   if(!tsch_is_locked()) {
     if(n != NULL) {
-      /* Get and remove packet from ringbuf (remove committed through an atomic operation */
-      int16_t get_index = ringbufindex_get(&n->tx_ringbuf);
-      if(get_index != -1) {
-#ifdef TSCH_CALLBACK_QUEUE_CHANGED
-        TSCH_CALLBACK_QUEUE_CHANGED(TSCH_QUEUE_EVENT_SHRINK, n);
-#endif
-        return n->tx_array[get_index];
-      } else {
-        return NULL;
+      uint8_t c;
+#if TSCH_QUEUE_SHARED_POOL
+      move_borrowed_packets(n);
+#endif /* TSCH_QUEUE_SHARED_POOL */
+      for(c = 0; c < TSCH_QUEUE_NUM_CLASSES; c++) {
+        if(!ringbufindex_empty(&n->tx_ringbuf[c])) {
+          struct tsch_packet *p = dequeue_packet(n, c);
+          post_ready_event(n);
+          return p;
+        }
+      }
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a given packet, returned by tsch_queue_get_packet_for_nbr, from a
+ * neighbor queue */
+struct tsch_packet *
+tsch_queue_remove_packet(struct tsch_neighbor *n, struct tsch_packet *p)
+{
+  if(!tsch_is_locked()) {
+    if(n != NULL && p != NULL) {
+      uint8_t c;
+      /* The packet is at the head of its class queue */
+      for(c = 0; c < TSCH_QUEUE_NUM_CLASSES; c++) {
+        int16_t get_index = ringbufindex_peek_get(&n->tx_ringbuf[c]);
+        if(get_index != -1 && n->tx_array[c][get_index] == p) {
+          dequeue_packet(n, c);
+          /* Called from the slot operation */
+          update_ready(n);
+          return p;
+        }
       }
     }
   }
@@ -318,6 +605,17 @@ tsch_queue_free_packet(struct tsch_packet *p)
   if(p != NULL) {
     queuebuf_free(p->qb);
     memb_free(&packet_memb, p);
+#if TSCH_QUEUE_SHARED_POOL
+    /* Packets are freed after the slot operation dequeued them: there may
+     * be room for borrowed packets now */
+    if(list_head(borrowed_list) != NULL && !tsch_is_locked()) {
+      struct tsch_neighbor *n = list_head(neighbor_list);
+      while(n != NULL) {
+        move_borrowed_packets(n);
+        n = list_item_next(n);
+      }
+    }
+#endif /* TSCH_QUEUE_SHARED_POOL */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -366,31 +664,36 @@ tsch_queue_free_unused_neighbors(void)
 int
 tsch_queue_is_empty(const struct tsch_neighbor *n)
 {
-  return !tsch_is_locked() && n != NULL && ringbufindex_empty(&n->tx_ringbuf);
+  return !tsch_is_locked() && n != NULL && nbr_queue_is_empty(n)
+#if TSCH_QUEUE_SHARED_POOL
+         && nbr_borrowed_count(n) == 0
+#endif /* TSCH_QUEUE_SHARED_POOL */
+  ;
 }
 /*---------------------------------------------------------------------------*/
-/* Returns the first packet from a neighbor queue */
+/* Returns the first packet from a neighbor queue, taking the classes in
+ * priority order (first those that still have credits, with weights) */
 struct tsch_packet *
 tsch_queue_get_packet_for_nbr(const struct tsch_neighbor *n, struct tsch_link *link)
 {
   if(!tsch_is_locked()) {
     int is_shared_link = link != NULL && link->link_options & LINK_OPTION_SHARED;
-    if(n != NULL) {
-      int16_t get_index = ringbufindex_peek_get(&n->tx_ringbuf);
-      if(get_index != -1 &&
-          !(is_shared_link && !tsch_queue_backoff_expired(n))) {    /* If this is a shared link,
-                                                                    make sure the backoff has expired */
-#if TSCH_WITH_LINK_SELECTOR
-        int packet_attr_slotframe = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_SLOTFRAME);
-        int packet_attr_timeslot = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_TIMESLOT);
-        if(packet_attr_slotframe != 0xffff && packet_attr_slotframe != link->slotframe_handle) {
-          return NULL;
+    if(n != NULL &&
+        !(is_shared_link && !tsch_queue_backoff_expired(n))) {    /* If this is a shared link,
+                                                                  make sure the backoff has expired */
+      struct tsch_packet *p;
+      uint8_t c;
+#ifdef TSCH_QUEUE_CLASS_WEIGHTS
+      for(c = 0; c < TSCH_QUEUE_NUM_CLASSES; c++) {
+        if(n->tx_credits[c] > 0 && (p = get_packet_in_class(n, c, link)) != NULL) {
+          return p;
         }
-        if(packet_attr_timeslot != 0xffff && packet_attr_timeslot != link->timeslot) {
-          return NULL;
+      }
+#endif /* TSCH_QUEUE_CLASS_WEIGHTS */
+      for(c = 0; c < TSCH_QUEUE_NUM_CLASSES; c++) {
+        if((p = get_packet_in_class(n, c, link)) != NULL) {
+          return p;
         }
-#endif
-        return n->tx_array[get_index];
       }
     }
   }
@@ -406,6 +709,16 @@ tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr, struct tsch_link *li
   }
   return NULL;
 }
+/*---------------------------------------------------------------------------*/
+/* Notify the queue module that the links to a neighbor have changed */
+void
+tsch_queue_nbr_changed(struct tsch_neighbor *n)
+{
+  if(n != NULL) {
+    post_ready_event(n);
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Returns the head packet of any neighbor queue with zero backoff counter.
  * Writes pointer to the neighbor in *n */
 struct tsch_packet *
@@ -414,6 +727,31 @@ tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link
   if(!tsch_is_locked()) {
     struct tsch_neighbor *curr_nbr = list_head(neighbor_list);
     struct tsch_packet *p = NULL;
+    if(link != NULL && (link->link_options & LINK_OPTION_SHARED)) {
+      /* Only neighbors with no backoff may use a shared link: take them
+       * from the ready set rather than walking all neighbors */
+      uint8_t i;
+      process_ready_events();
+      for(i = 0; i < READY_SET_WORDS; i++) {
+        uint32_t bits = ready_set[i];
+        uint8_t b = 0;
+        while(bits != 0) {
+          if(bits & ((uint32_t)1 << b)) {
+            curr_nbr = (struct tsch_neighbor *)neighbor_memb.mem + i * 32 + b;
+            p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
+            if(p != NULL) {
+              if(n != NULL) {
+                *n = curr_nbr;
+              }
+              return p;
+            }
+            bits &= ~((uint32_t)1 << b);
+          }
+          b++;
+        }
+      }
+      return NULL;
+    }
     while(curr_nbr != NULL) {
       if(!curr_nbr->is_broadcast && curr_nbr->tx_links_count == 0) {
         /* Only look up for non-broadcast neighbors we do not have a tx link to */
@@ -444,6 +782,7 @@ tsch_queue_backoff_reset(struct tsch_neighbor *n)
 {
   n->backoff_window = 0;
   n->backoff_exponent = TSCH_MAC_MIN_BE;
+  update_ready(n);
 }
 /*---------------------------------------------------------------------------*/
 /* Increment backoff exponent, pick a new window */
@@ -459,6 +798,7 @@ tsch_queue_backoff_inc(struct tsch_neighbor *n)
   /* Add one to the window as we will decrement it at the end of the current slot
    * through tsch_queue_update_all_backoff_windows */
   n->backoff_window++;
+  update_ready(n);
 }
 /*---------------------------------------------------------------------------*/
 /* Decrement backoff window for all queues directed at dest_addr */
@@ -473,6 +813,9 @@ tsch_queue_update_all_backoff_windows(const linkaddr_t *dest_addr)
          && ((n->tx_links_count == 0 && is_broadcast)
              || (n->tx_links_count > 0 && linkaddr_cmp(dest_addr, &n->addr)))) {
         n->backoff_window--;
+        if(n->backoff_window == 0) {
+          update_ready(n);
+        }
       }
       n = list_item_next(n);
     }
@@ -486,6 +829,12 @@ tsch_queue_init(void)
   list_init(neighbor_list);
   memb_init(&neighbor_memb);
   memb_init(&packet_memb);
+#if TSCH_QUEUE_SHARED_POOL
+  list_init(borrowed_list);
+#endif /* TSCH_QUEUE_SHARED_POOL */
+  memset(ready_set, 0, sizeof(ready_set));
+  ringbufindex_init(&ready_events_ringbuf, READY_EVENTS_NUM);
+  ready_events_overflow = 0;
   /* Add virtual EB and the broadcast neighbors */
   n_eb = tsch_queue_add_nbr(&tsch_eb_address);
   n_broadcast = tsch_queue_add_nbr(&tsch_broadcast_address);
@@ -42,6 +42,25 @@
 
 /******** Configuration *******/
 
+/* Share the packet pool between neighbors: a neighbor queue holds
+ * TSCH_QUEUE_NUM_PER_NEIGHBOR packets (its soft limit) and borrows further
+ * packets from the pool, as long as TSCH_QUEUE_POOL_RESERVE packets remain
+ * free for the others. Borrowed packets wait in the process context and
+ * enter the queue as the slot operation drains it. Queue depth then follows
+ * traffic (e.g. towards the time source) with small per-neighbor arrays. */
+#ifdef TSCH_QUEUE_CONF_SHARED_POOL
+#define TSCH_QUEUE_SHARED_POOL TSCH_QUEUE_CONF_SHARED_POOL
+#else
+#define TSCH_QUEUE_SHARED_POOL 0
+#endif
+
+/* The number of packets of the pool that no neighbor may borrow */
+#ifdef TSCH_QUEUE_CONF_POOL_RESERVE
+#define TSCH_QUEUE_POOL_RESERVE TSCH_QUEUE_CONF_POOL_RESERVE
+#else
+#define TSCH_QUEUE_POOL_RESERVE 2
+#endif
+
 /* The maximum number of outgoing packets towards each neighbor
  * Must be power of two to enable atomic ringbuf operations.
  * Note: the total number of outgoing packets in the system (for
@@ -50,8 +69,9 @@
 #define TSCH_QUEUE_NUM_PER_NEIGHBOR TSCH_QUEUE_CONF_NUM_PER_NEIGHBOR
 #else
 /* By default, round QUEUEBUF_CONF_NUM to next power of two
- * (in the range [4;256]) */
-#if QUEUEBUF_CONF_NUM <= 4
+ * (in the range [4;256]). With a shared pool, this is only the soft
+ * limit. */
+#if TSCH_QUEUE_SHARED_POOL || QUEUEBUF_CONF_NUM <= 4
 #define TSCH_QUEUE_NUM_PER_NEIGHBOR 4
 #elif QUEUEBUF_CONF_NUM <= 8
 #define TSCH_QUEUE_NUM_PER_NEIGHBOR 8
@@ -76,6 +96,23 @@
 #define TSCH_QUEUE_MAX_NEIGHBOR_QUEUES ((NBR_TABLE_CONF_MAX_NEIGHBORS) + 2)
 #endif
 
+/* The number of traffic classes per neighbor. Each class has its own queue
+ * of TSCH_QUEUE_NUM_PER_NEIGHBOR packets; class 0 has the highest priority.
+ * By default, with more than one class, ICMPv6 (RPL and ND) goes to class 0
+ * and all other traffic to the last class. See TSCH_CALLBACK_QUEUE_CLASS. */
+#ifdef TSCH_QUEUE_CONF_NUM_CLASSES
+#define TSCH_QUEUE_NUM_CLASSES TSCH_QUEUE_CONF_NUM_CLASSES
+#else
+#define TSCH_QUEUE_NUM_CLASSES 1
+#endif
+
+/* Dequeue weights of the classes, e.g. { 4, 2, 1 }: a class may send as
+ * many packets as its weight before the lower classes get their turn.
+ * Without weights, classes are served in strict priority order. */
+#ifdef TSCH_QUEUE_CONF_CLASS_WEIGHTS
+#define TSCH_QUEUE_CLASS_WEIGHTS TSCH_QUEUE_CONF_CLASS_WEIGHTS
+#endif
+
 /* TSCH CSMA-CA parameters, see IEEE 802.15.4e-2012 */
 /* Min backoff exponent */
 #ifdef TSCH_CONF_MAC_MIN_BE
@@ -118,10 +155,26 @@ void TSCH_CALLBACK_PACKET_READY(void);
 struct tsch_neighbor;
 void TSCH_CALLBACK_QUEUE_CHANGED(uint8_t, struct tsch_neighbor*);
 #endif
+/* Called by TSCH to pick the class of the packet in packetbuf */
+#ifdef TSCH_CALLBACK_QUEUE_CLASS
+uint8_t TSCH_CALLBACK_QUEUE_CLASS(void);
+#endif
+
+/* Called by TSCH to check whether a link may carry packets of a class,
+ * e.g. to reserve a slotframe to a deterministic flow */
+#ifdef TSCH_CALLBACK_LINK_ALLOWS_CLASS
+struct tsch_link;
+int TSCH_CALLBACK_LINK_ALLOWS_CLASS(const struct tsch_link *link, uint8_t queue_class);
+#endif
 /************ Types ***********/
 
 /* TSCH packet information */
 struct tsch_packet {
+#if TSCH_QUEUE_SHARED_POOL
+  struct tsch_packet *next; /* Next borrowed packet: must be the first field */
+  struct tsch_neighbor *nbr; /* The neighbor the packet is queued for */
+  uint8_t queue_class; /* The class the packet is queued in */
+#endif /* TSCH_QUEUE_SHARED_POOL */
   struct queuebuf *qb;  /* pointer to the queuebuf to be sent */
   mac_callback_t sent; /* callback for this packet */
   void *ptr; /* MAC callback parameter */
@@ -149,11 +202,19 @@ struct tsch_neighbor {
   uint8_t last_backoff_window; /* Last CSMA backoff window */
   uint8_t tx_links_count; /* How many links do we have to this neighbor? */
   uint8_t dedicated_tx_links_count; /* How many dedicated links do we have to this neighbor? */
-  /* Array for the ringbuf. Contains pointers to packets.
+  /* Arrays for the ringbufs, one per class. Contains pointers to packets.
    * Its size must be a power of two to allow for atomic put */
-  struct tsch_packet *tx_array[TSCH_QUEUE_NUM_PER_NEIGHBOR];
-  /* Circular buffer of pointers to packet. */
-  struct ringbufindex tx_ringbuf;
+  struct tsch_packet *tx_array[TSCH_QUEUE_NUM_CLASSES][TSCH_QUEUE_NUM_PER_NEIGHBOR];
+  /* Circular buffers of pointers to packet, one per class. */
+  struct ringbufindex tx_ringbuf[TSCH_QUEUE_NUM_CLASSES];
+#ifdef TSCH_QUEUE_CLASS_WEIGHTS
+  /* Packets each class may still send in the current round */
+  uint8_t tx_credits[TSCH_QUEUE_NUM_CLASSES];
+#endif /* TSCH_QUEUE_CLASS_WEIGHTS */
+#if TSCH_QUEUE_SHARED_POOL
+  /* Packets borrowed from the pool, waiting for room in each class queue */
+  uint8_t borrowed_count[TSCH_QUEUE_NUM_CLASSES];
+#endif /* TSCH_QUEUE_SHARED_POOL */
 };
 
 /***** External Variables *****/
@@ -181,6 +242,9 @@ int tsch_queue_packet_count(const linkaddr_t *addr);
 /* Remove first packet from a neighbor queue. The packet is stored in a separate
  * dequeued packet list, for later processing. Return the packet. */
 struct tsch_packet *tsch_queue_remove_packet_from_queue(struct tsch_neighbor *n);
+/* Remove a given packet, returned by tsch_queue_get_packet_for_nbr, from a
+ * neighbor queue. Return the packet. */
+struct tsch_packet *tsch_queue_remove_packet(struct tsch_neighbor *n, struct tsch_packet *p);
 /* Free a packet */
 void tsch_queue_free_packet(struct tsch_packet *p);
 /* Flush all neighbor queues */
@@ -193,6 +257,8 @@ int tsch_queue_is_empty(const struct tsch_neighbor *n);
 struct tsch_packet *tsch_queue_get_packet_for_nbr(const struct tsch_neighbor *n, struct tsch_link *link);
 /* Returns the head packet from a neighbor queue (from neighbor address) */
 struct tsch_packet *tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr, struct tsch_link *link);
+/* Notify the queue module that the links to a neighbor have changed */
+void tsch_queue_nbr_changed(struct tsch_neighbor *n);
 /* Returns the head packet of any neighbor queue with zero backoff counter.
  * Writes pointer to the neighbor in *n */
 struct tsch_packet *tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link);
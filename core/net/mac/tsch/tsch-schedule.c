@@ -68,6 +68,54 @@ MEMB(link_memb, struct tsch_link, TSCH_SCHEDULE_MAX_LINKS);
 MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
+#if TSCH_SCHEDULE_WITH_LINK_INDEX
+/* The links of all slotframes, each slotframe's links in a contiguous
+ * slice sorted by timeslot. Rebuilt under the lock whenever a link is
+ * added or removed. */
+static struct tsch_link *link_index[TSCH_SCHEDULE_MAX_LINKS];
+
+/*---------------------------------------------------------------------------*/
+/* Rebuilds the link index from the links lists, which are kept sorted by
+ * timeslot. Call with the lock held. */
+static void
+rebuild_link_index(void)
+{
+  struct tsch_link **next = link_index;
+  struct tsch_slotframe *sf = list_head(slotframe_list);
+  while(sf != NULL) {
+    struct tsch_link *l = list_head(sf->links_list);
+    sf->sorted_links = next;
+    sf->links_count = 0;
+    while(l != NULL) {
+      *next++ = l;
+      sf->links_count++;
+      l = list_item_next(l);
+    }
+    sf = list_item_next(sf);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the first link of a slotframe strictly after a timeslot, wrapping
+ * around to the first link of the slotframe, or NULL if it has no links */
+static struct tsch_link *
+next_link_in_slotframe(struct tsch_slotframe *sf, uint16_t timeslot)
+{
+  uint16_t low = 0;
+  uint16_t high = sf->links_count;
+  if(high == 0) {
+    return NULL;
+  }
+  while(low < high) {
+    uint16_t mid = low + (high - low) / 2;
+    if(sf->sorted_links[mid]->timeslot > timeslot) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return sf->sorted_links[low == sf->links_count ? 0 : low];
+}
+#endif /* TSCH_SCHEDULE_WITH_LINK_INDEX */
 
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
@@ -89,6 +137,10 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       sf->handle = handle;
       ASN_DIVISOR_INIT(sf->size, size);
       LIST_STRUCT_INIT(sf, links_list);
+#if TSCH_SCHEDULE_WITH_LINK_INDEX
+      sf->sorted_links = link_index;
+      sf->links_count = 0;
+#endif /* TSCH_SCHEDULE_WITH_LINK_INDEX */
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
     }
@@ -194,8 +246,6 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
       } else {
         static int current_link_handle = 0;
         struct tsch_neighbor *n;
-        /* Add the link to the slotframe */
-        list_add(slotframe->links_list, l);
         /* Initialize link */
         l->handle = current_link_handle++;
         l->link_options = link_options;
@@ -209,6 +259,23 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
         }
         linkaddr_copy(&l->addr, address);
 
+        /* Add the link to the slotframe */
+#if TSCH_SCHEDULE_WITH_LINK_INDEX
+        {
+          /* Keep the links sorted by timeslot */
+          struct tsch_link *prev = NULL;
+          struct tsch_link *curr = list_head(slotframe->links_list);
+          while(curr != NULL && curr->timeslot < timeslot) {
+            prev = curr;
+            curr = list_item_next(curr);
+          }
+          list_insert(slotframe->links_list, prev, l);
+        }
+        rebuild_link_index();
+#else /* TSCH_SCHEDULE_WITH_LINK_INDEX */
+        list_add(slotframe->links_list, l);
+#endif /* TSCH_SCHEDULE_WITH_LINK_INDEX */
+
         PRINTF("TSCH-schedule: add_link %u %u %u %u %u %u\n",
                slotframe->handle, link_options, link_type, timeslot, channel_offset, TSCH_LOG_ID_FROM_LINKADDR(address));
 
@@ -223,6 +290,7 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
             if(!(l->link_options & LINK_OPTION_SHARED)) {
               n->dedicated_tx_links_count++;
             }
+            tsch_queue_nbr_changed(n);
           }
         }
       }
@@ -258,6 +326,9 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
 
       list_remove(slotframe->links_list, l);
       memb_free(&link_memb, l);
+#if TSCH_SCHEDULE_WITH_LINK_INDEX
+      rebuild_link_index();
+#endif /* TSCH_SCHEDULE_WITH_LINK_INDEX */
 
       /* Release the lock before we update the neighbor (will take the lock) */
       tsch_release_lock();
@@ -270,6 +341,7 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
           if(!(link_options & LINK_OPTION_SHARED)) {
             n->dedicated_tx_links_count--;
           }
+          tsch_queue_nbr_changed(n);
         }
       }
 
@@ -351,7 +423,13 @@ tsch_schedule_get_next_active_link(struct asn_t *asn, uint16_t *time_offset,
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
       uint16_t timeslot = ASN_MOD(*asn, sf->size);
+#if TSCH_SCHEDULE_WITH_LINK_INDEX
+      /* There is at most one link per timeslot in a slotframe: only the
+       * first one after the current timeslot can be the earliest */
+      struct tsch_link *l = next_link_in_slotframe(sf, timeslot);
+#else /* TSCH_SCHEDULE_WITH_LINK_INDEX */
       struct tsch_link *l = list_head(sf->links_list);
+#endif /* TSCH_SCHEDULE_WITH_LINK_INDEX */
       while(l != NULL) {
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
@@ -395,7 +473,11 @@ tsch_schedule_get_next_active_link(struct asn_t *asn, uint16_t *time_offset,
           }
         }
 
+#if TSCH_SCHEDULE_WITH_LINK_INDEX
+        break;
+#else /* TSCH_SCHEDULE_WITH_LINK_INDEX */
         l = list_item_next(l);
+#endif /* TSCH_SCHEDULE_WITH_LINK_INDEX */
       }
       sf = list_item_next(sf);
     }
@@ -409,6 +491,47 @@ tsch_schedule_get_next_active_link(struct asn_t *asn, uint16_t *time_offset,
   return curr_best;
 }
 /*---------------------------------------------------------------------------*/
+/* Fills links with up to max links with Rx flag active at a given ASN, other than link
+ * and on channel offsets distinct from that of link and from each other.
+ * Returns the number of links. Used for reception on several radios */
+int
+tsch_schedule_get_concurrent_rx_links(struct asn_t *asn, const struct tsch_link *link,
+    struct tsch_link **links, int max)
+{
+  int count = 0;
+  if(!tsch_is_locked()) {
+    struct tsch_slotframe *sf = list_head(slotframe_list);
+    while(sf != NULL && count < max) {
+      uint16_t timeslot = ASN_MOD(*asn, sf->size);
+#if TSCH_SCHEDULE_WITH_LINK_INDEX
+      /* The first link at or after the timeslot */
+      struct tsch_link *l = next_link_in_slotframe(sf, timeslot - 1);
+#else /* TSCH_SCHEDULE_WITH_LINK_INDEX */
+      struct tsch_link *l = list_head(sf->links_list);
+#endif /* TSCH_SCHEDULE_WITH_LINK_INDEX */
+      while(l != NULL && count < max) {
+        if(l != link && l->timeslot == timeslot && (l->link_options & LINK_OPTION_RX)) {
+          int i;
+          int is_free = link == NULL || l->channel_offset != link->channel_offset;
+          for(i = 0; i < count && is_free; i++) {
+            is_free = l->channel_offset != links[i]->channel_offset;
+          }
+          if(is_free) {
+            links[count++] = l;
+          }
+        }
+#if TSCH_SCHEDULE_WITH_LINK_INDEX
+        break;
+#else /* TSCH_SCHEDULE_WITH_LINK_INDEX */
+        l = list_item_next(l);
+#endif /* TSCH_SCHEDULE_WITH_LINK_INDEX */
+      }
+      sf = list_item_next(sf);
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
 /* Module initialization, call only once at startup. Returns 1 is success, 0 if failure. */
 int
 tsch_schedule_init(void)
@@ -72,6 +72,15 @@
 #define TSCH_SCHEDULE_MAX_LINKS 32
 #endif
 
+/* Keep, for each slotframe, an array of its links sorted by timeslot, so
+ * that the next active link is found with a binary search instead of a
+ * walk through every link of the schedule. Costs one pointer per link. */
+#ifdef TSCH_SCHEDULE_CONF_WITH_LINK_INDEX
+#define TSCH_SCHEDULE_WITH_LINK_INDEX TSCH_SCHEDULE_CONF_WITH_LINK_INDEX
+#else
+#define TSCH_SCHEDULE_WITH_LINK_INDEX 1
+#endif
+
 #ifdef TSCH_CALLBACK_REMOVE_LINK
   void TSCH_CALLBACK_REMOVE_LINK(struct tsch_link*);
 #endif
@@ -126,6 +135,12 @@ struct tsch_slotframe {
   struct asn_divisor_t size;
   /* List of links belonging to this slotframe */
   LIST_STRUCT(links_list);
+#if TSCH_SCHEDULE_WITH_LINK_INDEX
+  /* The links of the slotframe sorted by timeslot, a slice of the
+   * schedule-wide link index */
+  struct tsch_link **sorted_links;
+  uint16_t links_count;
+#endif /* TSCH_SCHEDULE_WITH_LINK_INDEX */
 };
 
 /********** Functions *********/
@@ -167,5 +182,10 @@ int tsch_schedule_remove_link_by_timeslot(struct tsch_slotframe *slotframe, uint
 /* Returns the next active link after a given ASN, and a backup link (for the same ASN, with Rx flag) */
 struct tsch_link * tsch_schedule_get_next_active_link(struct asn_t *asn, uint16_t *time_offset,
     struct tsch_link **backup_link);
+/* Fills links with up to max links with Rx flag active at a given ASN, other than link
+ * and on channel offsets distinct from that of link and from each other.
+ * Returns the number of links. Used for reception on several radios */
+int tsch_schedule_get_concurrent_rx_links(struct asn_t *asn, const struct tsch_link *link,
+    struct tsch_link **links, int max);
 
 #endif /* __TSCH_SCHEDULE_H__ */
@@ -50,6 +50,7 @@
 #include "net/mac/tsch/tsch-queue.h"
 #include "net/mac/tsch/tsch-private.h"
 #include "net/mac/tsch/tsch-log.h"
+#include "net/mac/tsch/tsch-timing.h"
 #include "net/mac/tsch/tsch-packet.h"
 #include "net/mac/tsch/tsch-security.h"
 #include "net/mac/tsch/tsch-adaptive-timesync.h"
@@ -151,15 +152,51 @@ static struct tsch_link *backup_link = NULL;
 static struct tsch_packet *current_packet = NULL;
 static struct tsch_neighbor *current_neighbor = NULL;
 
+#if TSCH_NUM_RADIOS > 1
+/* The radios other than NETSTACK_RADIO, receiving only */
+const struct radio_driver *const tsch_secondary_radios[TSCH_NUM_RADIOS - 1] = TSCH_SECONDARY_RADIOS;
+/* State of a radio in a multi-radio Rx slot */
+struct rx_radio {
+  const struct radio_driver *radio;
+  struct tsch_link *link;
+  enum { RX_RADIO_LISTEN, RX_RADIO_RECEIVING, RX_RADIO_ACK, RX_RADIO_DONE } state;
+  rtimer_clock_t rx_start_time;
+  rtimer_clock_t ack_offset; /* From rx_start_time */
+  int ack_len;
+};
+/* The radios receiving in the current slot, 0 for a single-radio slot */
+static struct rx_radio rx_radios[TSCH_NUM_RADIOS];
+static int num_rx_radios;
+#endif /* TSCH_NUM_RADIOS > 1 */
+
+#if TSCH_RADIO_CAPABILITIES
+/* Radio delays, the RADIO_DELAY_* of the platform until the radio
+ * reports its own */
+rtimer_clock_t tsch_radio_delay_before_tx = RADIO_DELAY_BEFORE_TX;
+rtimer_clock_t tsch_radio_delay_before_rx = RADIO_DELAY_BEFORE_RX;
+rtimer_clock_t tsch_radio_delay_before_detect = RADIO_DELAY_BEFORE_DETECT;
+/* Does the radio timestamp the SFD of received frames? */
+uint8_t tsch_radio_sfd_timestamps;
+#endif /* TSCH_RADIO_CAPABILITIES */
+
 /* Protothread for association */
 PT_THREAD(tsch_scan(struct pt *pt));
 /* Protothread for slot operation, called from rtimer interrupt
  * and scheduled from tsch_schedule_slot_operation */
 static PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr));
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+static void slot_operation_wrapper(struct rtimer *t, void *ptr);
+#define SLOT_OPERATION_CALLBACK slot_operation_wrapper
+#else /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
+#define SLOT_OPERATION_CALLBACK ((void (*)(struct rtimer *, void *))tsch_slot_operation)
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
 static struct pt slot_operation_pt;
 /* Sub-protothreads of tsch_slot_operation */
 static PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t));
 static PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t));
+#if TSCH_NUM_RADIOS > 1
+static PT_THREAD(tsch_rx_slot_multi(struct pt *pt, struct rtimer *t));
+#endif /* TSCH_NUM_RADIOS > 1 */
 
 /*---------------------------------------------------------------------------*/
 /* TSCH locking system. TSCH is locked during slot operations */
@@ -215,6 +252,29 @@ tsch_release_lock(void)
   tsch_locked = 0;
 }
 
+/*---------------------------------------------------------------------------*/
+#if TSCH_RADIO_CAPABILITIES
+/* Read the radio delays and SFD timestamp support from the radio */
+void
+tsch_radio_capabilities_init(void)
+{
+  struct radio_capabilities caps;
+
+  if(NETSTACK_RADIO.get_object(RADIO_CONST_CAPABILITIES, &caps, sizeof(caps)) != RADIO_RESULT_OK) {
+    PRINTF("TSCH: radio does not report its capabilities, using RADIO_DELAY_*\n");
+    return;
+  }
+  if(caps.flags & RADIO_CAP_TIMING) {
+    tsch_radio_delay_before_tx = US_TO_RTIMERTICKS(caps.delay_before_tx_us);
+    tsch_radio_delay_before_rx = US_TO_RTIMERTICKS(caps.delay_before_rx_us);
+    tsch_radio_delay_before_detect = US_TO_RTIMERTICKS(caps.delay_before_detect_us);
+  }
+  tsch_radio_sfd_timestamps = (caps.flags & RADIO_CAP_SFD_TIMESTAMP) != 0;
+  PRINTF("TSCH: radio delays tx %u rx %u detect %u ticks, SFD timestamps %u\n",
+         (unsigned)tsch_radio_delay_before_tx, (unsigned)tsch_radio_delay_before_rx,
+         (unsigned)tsch_radio_delay_before_detect, tsch_radio_sfd_timestamps);
+}
+#endif /* TSCH_RADIO_CAPABILITIES */
 /*---------------------------------------------------------------------------*/
 /* Channel hopping utility functions */
 
@@ -273,7 +333,7 @@ tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_
     return 0;
   }
   ref_time += offset;
-  r = rtimer_set(tm, ref_time, 1, (void (*)(struct rtimer *, void *))tsch_slot_operation, NULL);
+  r = rtimer_set(tm, ref_time, 1, SLOT_OPERATION_CALLBACK, NULL);
   if(r != RTIMER_OK) {
     return 0;
   }
@@ -338,7 +398,7 @@ update_neighbor_state(struct tsch_neighbor *n, struct tsch_packet *p,
 
   if(mac_tx_status == MAC_TX_OK) {
     /* Successful transmission */
-    tsch_queue_remove_packet_from_queue(n);
+    tsch_queue_remove_packet(n, p);
     in_queue = 0;
 
     /* Update CSMA state in the unicast case */
@@ -353,7 +413,7 @@ update_neighbor_state(struct tsch_neighbor *n, struct tsch_packet *p,
     /* Failed transmission */
     if(p->transmissions >= TSCH_MAC_MAX_FRAME_RETRIES + 1) {
       /* Drop packet */
-      tsch_queue_remove_packet_from_queue(n);
+      tsch_queue_remove_packet(n, p);
       in_queue = 0;
     }
     /* Update CSMA state in the unicast case */
@@ -461,6 +521,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
         BUSYWAIT_UNTIL_ABS(!(cca_status |= NETSTACK_RADIO.channel_clear()),
                            current_slot_start, TS_CCA_OFFSET + TS_CCA);
         TSCH_DEBUG_TX_EVENT();
+        TSCH_TIMING_RECORD(tsch_timing_cca, RTIMER_NOW(), current_slot_start + TS_CCA_OFFSET);
         /* there is not enough time to turn radio off */
         /*  NETSTACK_RADIO.off(); */
         if(cca_status == 0) {
@@ -469,8 +530,10 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 #endif /* CCA_ENABLED */
         {
           /* delay before TX */
-          TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_tx_offset] - RADIO_DELAY_BEFORE_TX, "TxBeforeTx");
+          TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_tx_offset] - TSCH_RADIO_DELAY_BEFORE_TX, "TxBeforeTx");
           TSCH_DEBUG_TX_EVENT();
+          TSCH_TIMING_RECORD(tsch_timing_tx_start, RTIMER_NOW() + TSCH_RADIO_DELAY_BEFORE_TX,
+                             current_slot_start + tsch_timing[tsch_ts_tx_offset]);
           /* send packet already in radio tx buffer */
           mac_tx_status = NETSTACK_RADIO.transmit(packet_len);
           /* Save tx timestamp */
@@ -498,7 +561,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
               NETSTACK_RADIO.set_value(RADIO_PARAM_RX_MODE, radio_rx_mode & (~RADIO_RX_MODE_ADDRESS_FILTER));
               /* Unicast: wait for ack after tx: sleep until ack time */
               TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start,
-                  tsch_timing[tsch_ts_tx_offset] + tx_duration + tsch_timing[tsch_ts_rx_ack_delay] - RADIO_DELAY_BEFORE_RX, "TxBeforeAck");
+                  tsch_timing[tsch_ts_tx_offset] + tx_duration + tsch_timing[tsch_ts_rx_ack_delay] - TSCH_RADIO_DELAY_BEFORE_RX, "TxBeforeAck");
               TSCH_DEBUG_TX_EVENT();
               NETSTACK_RADIO.on();
               /* Wait for ACK to come */
@@ -507,6 +570,10 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
               TSCH_DEBUG_TX_EVENT();
 
               ack_start_time = RTIMER_NOW();
+              if(NETSTACK_RADIO.receiving_packet()) {
+                TSCH_TIMING_RECORD(tsch_timing_ack_rx, ack_start_time - TSCH_RADIO_DELAY_BEFORE_DETECT,
+                                   tx_start_time + tx_duration + tsch_timing[tsch_ts_rx_ack_delay]);
+              }
 
               /* Wait for ACK to finish */
               BUSYWAIT_UNTIL_ABS(!NETSTACK_RADIO.receiving_packet(),
@@ -622,6 +689,145 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+/* Reads and parses the frame pending in a radio, and sets its Rx duration.
+ * Returns 1 if the frame is valid */
+static int
+rx_read_frame(const struct radio_driver *radio, struct input_packet *input, frame802154_t *frame,
+              linkaddr_t *source_address, linkaddr_t *destination_address,
+              rtimer_clock_t *packet_duration)
+{
+  int frame_valid;
+  int header_len;
+  radio_value_t radio_last_rssi;
+
+  radio->get_value(RADIO_PARAM_LAST_RSSI, &radio_last_rssi);
+  /* Read packet */
+  input->len = radio->read((void *)input->payload, TSCH_PACKET_MAX_LEN);
+  input->rx_asn = current_asn;
+  input->rssi = (signed)radio_last_rssi;
+  header_len = frame802154_parse((uint8_t *)input->payload, input->len, frame);
+  frame_valid = header_len > 0 &&
+    frame802154_check_dest_panid(frame) &&
+    frame802154_extract_linkaddr(frame, source_address, destination_address);
+
+  *packet_duration = TSCH_PACKET_DURATION(input->len);
+
+#if TSCH_WITH_LINK_STATISTICS || TSCH_LOG_CONF_LEVEL
+  radio_value_t radio_last_lqi;
+  radio->get_value(RADIO_PARAM_LAST_LINK_QUALITY, &radio_last_lqi);
+  input->lqi = (signed)radio_last_lqi;
+  input->slotframe_id = current_link->slotframe_handle;
+  input->slotoffset = current_link->timeslot;
+  input->channeloffset = current_link->channel_offset;
+#endif
+
+#if TSCH_SECURITY_ENABLED
+  /* Decrypt and verify incoming frame */
+  if(frame_valid) {
+    if(tsch_security_parse_frame(
+         input->payload, header_len, input->len - header_len - tsch_security_mic_len(frame),
+         frame, source_address, &current_asn)) {
+      input->len -= tsch_security_mic_len(frame);
+    } else {
+      TSCH_LOG_ADD(tsch_log_message,
+          snprintf(log->message, sizeof(log->message),
+          "!failed to authenticate frame %u", input->len));
+      frame_valid = 0;
+    }
+  } else {
+    TSCH_LOG_ADD(tsch_log_message,
+        snprintf(log->message, sizeof(log->message),
+        "!failed to parse frame %u %u", header_len, input->len));
+    frame_valid = 0;
+  }
+#endif /* TSCH_SECURITY_ENABLED */
+
+  return frame_valid;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the drift of a frame received at rx_start_time instead of expected_rx_time */
+static int32_t
+rx_estimate_drift(rtimer_clock_t expected_rx_time, rtimer_clock_t rx_start_time)
+{
+  int32_t estimated_drift = ((int32_t)expected_rx_time - (int32_t)rx_start_time);
+
+#if TSCH_TIMESYNC_REMOVE_JITTER
+  /* remove jitter due to measurement errors */
+  if(abs(estimated_drift) <= TSCH_TIMESYNC_MEASUREMENT_ERROR) {
+    estimated_drift = 0;
+  } else if(estimated_drift > 0) {
+    estimated_drift -= TSCH_TIMESYNC_MEASUREMENT_ERROR;
+  } else {
+    estimated_drift += TSCH_TIMESYNC_MEASUREMENT_ERROR;
+  }
+#endif
+
+  return estimated_drift;
+}
+/*---------------------------------------------------------------------------*/
+/* Builds the ACK of a received frame into ack_buf. Returns the ACK length */
+static int
+rx_create_ack(frame802154_t *frame, linkaddr_t *source_address, linkaddr_t *destination_address,
+              int32_t estimated_drift, uint8_t *ack_buf)
+{
+  int do_nack = 0;
+  int ack_len;
+
+#ifdef TSCH_CALLBACK_DO_NACK
+  do_nack = TSCH_CALLBACK_DO_NACK(current_link, source_address, destination_address);
+#endif
+
+  ack_len = tsch_packet_create_eack(ack_buf, TSCH_PACKET_MAX_LEN,
+      source_address, frame->seq, (int16_t)RTIMERTICKS_TO_US(estimated_drift), do_nack);
+
+#if TSCH_SECURITY_ENABLED
+  if(tsch_is_pan_secured) {
+    /* Secure ACK frame. There is only header and header IEs, therefore data len == 0. */
+    ack_len += tsch_security_secure_frame(ack_buf, ack_buf, ack_len, 0, &current_asn);
+  }
+#endif /* TSCH_SECURITY_ENABLED */
+
+  return ack_len;
+}
+/*---------------------------------------------------------------------------*/
+/* Handles a received frame addressed to us: resynchronizes if the sender is
+ * a time source, adds the input to input_ringbuf and logs the reception */
+static void
+rx_frame_accepted(linkaddr_t *source_address, frame802154_t *frame,
+                  struct input_packet *input, int32_t estimated_drift)
+{
+  /* If the sender is a time source, proceed to clock drift compensation */
+  struct tsch_neighbor *n = tsch_queue_get_nbr(source_address);
+  if(n != NULL && n->is_time_source) {
+    int32_t since_last_timesync = ASN_DIFF(current_asn, last_sync_asn);
+    /* Keep track of last sync time */
+    last_sync_asn = current_asn;
+    /* Save estimated drift */
+    drift_correction = -estimated_drift;
+    is_drift_correction_used = 1;
+    tsch_timesync_update(n, since_last_timesync, -estimated_drift);
+    tsch_schedule_keepalive();
+  } else {
+    /* Learn the drift of other neighbors, in case they become time source */
+    tsch_timesync_observe(source_address, -estimated_drift);
+  }
+
+  /* Add current input to ringbuf */
+  ringbufindex_put(&input_ringbuf);
+
+  /* Log every reception */
+  TSCH_LOG_ADD(tsch_log_rx,
+    log->rx.src = TSCH_LOG_ID_FROM_LINKADDR((linkaddr_t*)&frame->src_addr);
+    log->rx.is_unicast = frame->fcf.ack_required;
+    log->rx.datalen = input->len;
+    log->rx.drift = drift_correction;
+    log->rx.drift_used = is_drift_correction_used;
+    log->rx.is_data = frame->fcf.frame_type == FRAME802154_DATAFRAME;
+    log->rx.sec_level = frame->aux_hdr.security_control.security_level;
+    log->rx.estimated_drift = estimated_drift;
+  );
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 {
@@ -634,7 +840,6 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
    * 5. Drift calculated in the ACK callback registered with the radio driver. Use it if receiving from a time source neighbor.
    **/
 
-  struct tsch_neighbor *n;
   static linkaddr_t source_address;
   static linkaddr_t destination_address;
   static int16_t input_index;
@@ -664,10 +869,12 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
     current_input = &input_array[input_index];
 
     /* Wait before starting to listen */
-    TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_rx_offset] - RADIO_DELAY_BEFORE_RX, "RxBeforeListen");
+    TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_rx_offset] - TSCH_RADIO_DELAY_BEFORE_RX, "RxBeforeListen");
     TSCH_DEBUG_RX_EVENT();
 
     /* Start radio for at least guard time */
+    TSCH_TIMING_RECORD(tsch_timing_radio_on, RTIMER_NOW() + TSCH_RADIO_DELAY_BEFORE_RX,
+                       current_slot_start + tsch_timing[tsch_ts_rx_offset]);
     NETSTACK_RADIO.on();
     packet_seen = NETSTACK_RADIO.receiving_packet();
     if(!packet_seen) {
@@ -678,11 +885,13 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
     if(packet_seen) {
       TSCH_DEBUG_RX_EVENT();
       /* Save packet timestamp */
-      rx_start_time = RTIMER_NOW() - RADIO_DELAY_BEFORE_DETECT;
+      rx_start_time = RTIMER_NOW() - TSCH_RADIO_DELAY_BEFORE_DETECT;
     }
     if(!NETSTACK_RADIO.receiving_packet() && !NETSTACK_RADIO.pending_packet()) {
       NETSTACK_RADIO.off();
       /* no packets on air */
+      TSCH_TIMING_RECORD(tsch_timing_radio_off, RTIMER_NOW(),
+                         current_slot_start + tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait]);
     } else {
       /* Wait until packet is received, turn radio off */
       BUSYWAIT_UNTIL_ABS(!NETSTACK_RADIO.receiving_packet(),
@@ -690,135 +899,46 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
       TSCH_DEBUG_RX_EVENT();
       NETSTACK_RADIO.off();
 
-#if TSCH_RESYNC_WITH_SFD_TIMESTAMPS
-      /* At the end of the reception, get an more accurate estimate of SFD arrival time */
-      NETSTACK_RADIO.get_object(RADIO_PARAM_LAST_PACKET_TIMESTAMP, &rx_start_time, sizeof(rtimer_clock_t));
-#endif
+      if(TSCH_RADIO_SFD_TIMESTAMPS) {
+        /* At the end of the reception, get an more accurate estimate of SFD arrival time */
+        NETSTACK_RADIO.get_object(RADIO_PARAM_LAST_PACKET_TIMESTAMP, &rx_start_time, sizeof(rtimer_clock_t));
+      }
 
       if(NETSTACK_RADIO.pending_packet()) {
         static int frame_valid;
-        static int header_len;
         static frame802154_t frame;
-        radio_value_t radio_last_rssi;
-
-        NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_RSSI, &radio_last_rssi);
-        /* Read packet */
-        current_input->len = NETSTACK_RADIO.read((void *)current_input->payload, TSCH_PACKET_MAX_LEN);
-        current_input->rx_asn = current_asn;
-        current_input->rssi = (signed)radio_last_rssi;
-        header_len = frame802154_parse((uint8_t *)current_input->payload, current_input->len, &frame);
-        frame_valid = header_len > 0 &&
-          frame802154_check_dest_panid(&frame) &&
-          frame802154_extract_linkaddr(&frame, &source_address, &destination_address);
 
-        packet_duration = TSCH_PACKET_DURATION(current_input->len);
-
-#if TSCH_WITH_LINK_STATISTICS || TSCH_LOG_CONF_LEVEL
-        radio_value_t radio_last_lqi;
-        NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_LINK_QUALITY, &radio_last_lqi);
-        current_input->lqi = (signed)radio_last_lqi;
-        current_input->slotframe_id = current_link->slotframe_handle;
-        current_input->slotoffset = current_link->timeslot;
-        current_input->channeloffset = current_link->channel_offset;
-#endif
-
-#if TSCH_SECURITY_ENABLED
-        /* Decrypt and verify incoming frame */
-        if(frame_valid) {
-          if(tsch_security_parse_frame(
-               current_input->payload, header_len, current_input->len - header_len - tsch_security_mic_len(&frame),
-               &frame, &source_address, &current_asn)) {
-            current_input->len -= tsch_security_mic_len(&frame);
-          } else {
-            TSCH_LOG_ADD(tsch_log_message,
-                snprintf(log->message, sizeof(log->message),
-                "!failed to authenticate frame %u", current_input->len));
-            frame_valid = 0;
-          }
-        } else {
-          TSCH_LOG_ADD(tsch_log_message,
-              snprintf(log->message, sizeof(log->message),
-              "!failed to parse frame %u %u", header_len, current_input->len));
-          frame_valid = 0;
-        }
-#endif /* TSCH_SECURITY_ENABLED */
+        frame_valid = rx_read_frame(&NETSTACK_RADIO, current_input, &frame,
+            &source_address, &destination_address, &packet_duration);
 
         if(frame_valid) {
           if(linkaddr_cmp(&destination_address, &linkaddr_node_addr)
              || linkaddr_cmp(&destination_address, &linkaddr_null)) {
-            int do_nack = 0;
-            estimated_drift = ((int32_t)expected_rx_time - (int32_t)rx_start_time);
-
-#if TSCH_TIMESYNC_REMOVE_JITTER
-            /* remove jitter due to measurement errors */
-            if(abs(estimated_drift) <= TSCH_TIMESYNC_MEASUREMENT_ERROR) {
-              estimated_drift = 0;
-            } else if(estimated_drift > 0) {
-              estimated_drift -= TSCH_TIMESYNC_MEASUREMENT_ERROR;
-            } else {
-              estimated_drift += TSCH_TIMESYNC_MEASUREMENT_ERROR;
-            }
-#endif
-
-#ifdef TSCH_CALLBACK_DO_NACK
-            if(frame.fcf.ack_required) {
-              do_nack = TSCH_CALLBACK_DO_NACK(current_link,
-                  &source_address, &destination_address);
-            }
-#endif
+            estimated_drift = rx_estimate_drift(expected_rx_time, rx_start_time);
+            TSCH_TIMING_RECORD(tsch_timing_rx_start, rx_start_time, expected_rx_time);
 
             if(frame.fcf.ack_required) {
               static uint8_t ack_buf[TSCH_PACKET_MAX_LEN];
               static int ack_len;
 
               /* Build ACK frame */
-              ack_len = tsch_packet_create_eack(ack_buf, sizeof(ack_buf),
-                  &source_address, frame.seq, (int16_t)RTIMERTICKS_TO_US(estimated_drift), do_nack);
-
-#if TSCH_SECURITY_ENABLED
-              if(tsch_is_pan_secured) {
-                /* Secure ACK frame. There is only header and header IEs, therefore data len == 0. */
-                ack_len += tsch_security_secure_frame(ack_buf, ack_buf, ack_len, 0, &current_asn);
-              }
-#endif /* TSCH_SECURITY_ENABLED */
+              ack_len = rx_create_ack(&frame, &source_address, &destination_address,
+                  estimated_drift, ack_buf);
 
               /* Copy to radio buffer */
               NETSTACK_RADIO.prepare((const void *)ack_buf, ack_len);
 
               /* Wait for time to ACK and transmit ACK */
               TSCH_SCHEDULE_AND_YIELD(pt, t, rx_start_time,
-                  packet_duration + tsch_timing[tsch_ts_tx_ack_delay] - RADIO_DELAY_BEFORE_TX, "RxBeforeAck");
+                  packet_duration + tsch_timing[tsch_ts_tx_ack_delay] - TSCH_RADIO_DELAY_BEFORE_TX, "RxBeforeAck");
               TSCH_DEBUG_RX_EVENT();
+              TSCH_TIMING_RECORD(tsch_timing_ack_tx, RTIMER_NOW() + TSCH_RADIO_DELAY_BEFORE_TX,
+                                 rx_start_time + packet_duration + tsch_timing[tsch_ts_tx_ack_delay]);
               NETSTACK_RADIO.transmit(ack_len);
             }
 
-            /* If the sender is a time source, proceed to clock drift compensation */
-            n = tsch_queue_get_nbr(&source_address);
-            if(n != NULL && n->is_time_source) {
-              int32_t since_last_timesync = ASN_DIFF(current_asn, last_sync_asn);
-              /* Keep track of last sync time */
-              last_sync_asn = current_asn;
-              /* Save estimated drift */
-              drift_correction = -estimated_drift;
-              is_drift_correction_used = 1;
-              tsch_timesync_update(n, since_last_timesync, -estimated_drift);
-              tsch_schedule_keepalive();
-            }
-
-            /* Add current input to ringbuf */
-            ringbufindex_put(&input_ringbuf);
-
-            /* Log every reception */
-            TSCH_LOG_ADD(tsch_log_rx,
-              log->rx.src = TSCH_LOG_ID_FROM_LINKADDR((linkaddr_t*)&frame.src_addr);
-              log->rx.is_unicast = frame.fcf.ack_required;
-              log->rx.datalen = current_input->len;
-              log->rx.drift = drift_correction;
-              log->rx.drift_used = is_drift_correction_used;
-              log->rx.is_data = frame.fcf.frame_type == FRAME802154_DATAFRAME;
-              log->rx.sec_level = frame.aux_hdr.security_control.security_level;
-              log->rx.estimated_drift = estimated_drift;
-            );
+            /* Resynchronize, and add current input to ringbuf */
+            rx_frame_accepted(&source_address, &frame, current_input, estimated_drift);
           } else {
             TSCH_LOG_ADD(tsch_log_message,
                   snprintf(log->message, sizeof(log->message),
@@ -847,6 +967,189 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+#if TSCH_NUM_RADIOS > 1
+/* Sets up the radios to receive in the current slot: NETSTACK_RADIO on
+ * current_link if it has Rx flag, and the secondary radios on the other links
+ * with Rx flag active in this slot, on distinct channel offsets.
+ * Returns the number of radios, or 0 if a single radio is enough */
+static int
+rx_radios_setup(void)
+{
+  struct tsch_link *links[TSCH_NUM_RADIOS - 1];
+  int num_links;
+  int count = 0;
+  int i;
+
+  num_links = tsch_schedule_get_concurrent_rx_links(&current_asn, current_link,
+                                                    links, TSCH_NUM_RADIOS - 1);
+  if(num_links == 0) {
+    return 0;
+  }
+  if(current_link->link_options & LINK_OPTION_RX) {
+    rx_radios[count].radio = &NETSTACK_RADIO;
+    rx_radios[count].link = current_link;
+    count++;
+  }
+  for(i = 0; i < num_links; i++) {
+    rx_radios[count].radio = tsch_secondary_radios[i];
+    rx_radios[count].link = links[i];
+    rx_radios[count].radio->set_value(RADIO_PARAM_CHANNEL,
+        tsch_calculate_channel(&current_asn, links[i]->channel_offset));
+    count++;
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Moves a radio of a multi-radio Rx slot one step forward. Returns 1 when
+ * the radio is done for the slot */
+static int
+rx_radio_poll(struct rx_radio *r, uint8_t *ack_buf)
+{
+  rtimer_clock_t now = RTIMER_NOW();
+
+  switch(r->state) {
+    case RX_RADIO_LISTEN:
+      if(r->radio->receiving_packet()) {
+        /* Save packet timestamp */
+        r->rx_start_time = now - TSCH_RADIO_DELAY_BEFORE_DETECT;
+        r->state = RX_RADIO_RECEIVING;
+      } else if(check_timer_miss(current_slot_start,
+                  tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait], now)
+                && !r->radio->pending_packet()) {
+        /* no packets on air */
+        r->radio->off();
+        TSCH_TIMING_RECORD(tsch_timing_radio_off, now,
+                           current_slot_start + tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait]);
+        r->state = RX_RADIO_DONE;
+      } else if(r->radio->pending_packet()) {
+        /* Received before we saw it on air */
+        r->state = RX_RADIO_RECEIVING;
+      }
+      break;
+
+    case RX_RADIO_RECEIVING:
+      if(r->radio->receiving_packet()
+         && !check_timer_miss(current_slot_start, tsch_timing[tsch_ts_rx_offset]
+                              + tsch_timing[tsch_ts_rx_wait] + tsch_timing[tsch_ts_max_tx], now)) {
+        /* Wait until packet is received */
+        break;
+      }
+      r->radio->off();
+      r->state = RX_RADIO_DONE;
+      if(TSCH_RADIO_SFD_TIMESTAMPS) {
+        /* At the end of the reception, get an more accurate estimate of SFD arrival time */
+        r->radio->get_object(RADIO_PARAM_LAST_PACKET_TIMESTAMP, &r->rx_start_time, sizeof(rtimer_clock_t));
+      }
+      if(r->radio->pending_packet()) {
+        int16_t input_index = ringbufindex_peek_put(&input_ringbuf);
+        if(input_index != -1) {
+          struct input_packet *input = &input_array[input_index];
+          static frame802154_t frame;
+          static linkaddr_t source_address;
+          static linkaddr_t destination_address;
+          rtimer_clock_t packet_duration;
+          rtimer_clock_t expected_rx_time = current_slot_start + tsch_timing[tsch_ts_tx_offset];
+          if(rx_read_frame(r->radio, input, &frame, &source_address, &destination_address, &packet_duration)
+             && (linkaddr_cmp(&destination_address, &linkaddr_node_addr)
+                 || linkaddr_cmp(&destination_address, &linkaddr_null))) {
+            int32_t estimated_drift = rx_estimate_drift(expected_rx_time, r->rx_start_time);
+            TSCH_TIMING_RECORD(tsch_timing_rx_start, r->rx_start_time, expected_rx_time);
+            if(frame.fcf.ack_required) {
+              r->ack_len = rx_create_ack(&frame, &source_address, &destination_address,
+                                         estimated_drift, ack_buf);
+              /* Copy to radio buffer */
+              r->radio->prepare((const void *)ack_buf, r->ack_len);
+              r->ack_offset = packet_duration + tsch_timing[tsch_ts_tx_ack_delay] - TSCH_RADIO_DELAY_BEFORE_TX;
+              r->state = RX_RADIO_ACK;
+            }
+            /* The input is handed over before the ACK is sent, as the next
+             * radio to receive will take the next input slot */
+            rx_frame_accepted(&source_address, &frame, input, estimated_drift);
+          }
+          /* Poll process for processing of pending input and logs */
+          process_poll(&tsch_pending_events_process);
+        }
+      }
+      break;
+
+    case RX_RADIO_ACK:
+      if(check_timer_miss(r->rx_start_time, r->ack_offset, now)) {
+        TSCH_TIMING_RECORD(tsch_timing_ack_tx, now, r->rx_start_time + r->ack_offset);
+        r->radio->transmit(r->ack_len);
+        r->state = RX_RADIO_DONE;
+      }
+      break;
+
+    case RX_RADIO_DONE:
+      break;
+  }
+
+  return r->state == RX_RADIO_DONE;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(tsch_rx_slot_multi(struct pt *pt, struct rtimer *t))
+{
+  /**
+   * Multi-radio RX slot, as the RX slot but on every radio set up by
+   * rx_radios_setup, each on its own link and channel:
+   * 1. Sleep and wake up just before expected RX time
+   * 2. Turn all radios on, and busy wait polling them: end of guard time,
+   *    end of reception, ACK time, until all are done
+   **/
+
+  static uint8_t ack_bufs[TSCH_NUM_RADIOS][TSCH_PACKET_MAX_LEN];
+
+  PT_BEGIN(pt);
+
+  TSCH_DEBUG_RX_EVENT();
+
+  /* Wait before starting to listen */
+  TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_rx_offset] - TSCH_RADIO_DELAY_BEFORE_RX, "RxBeforeListen");
+  TSCH_DEBUG_RX_EVENT();
+
+  {
+    struct tsch_link *slot_link = current_link;
+    int num_done = 0;
+    int i;
+
+    TSCH_TIMING_RECORD(tsch_timing_radio_on, RTIMER_NOW() + TSCH_RADIO_DELAY_BEFORE_RX,
+                       current_slot_start + tsch_timing[tsch_ts_rx_offset]);
+    for(i = 0; i < num_rx_radios; i++) {
+      rx_radios[i].state = RX_RADIO_LISTEN;
+      rx_radios[i].radio->on();
+    }
+
+    while(num_done < num_rx_radios) {
+      num_done = 0;
+      for(i = 0; i < num_rx_radios; i++) {
+        /* Inputs and logs are attributed to current_link */
+        current_link = rx_radios[i].link;
+        num_done += rx_radio_poll(&rx_radios[i], ack_bufs[i]);
+      }
+    }
+    current_link = slot_link;
+  }
+
+  TSCH_DEBUG_RX_EVENT();
+
+  PT_END(pt);
+}
+#endif /* TSCH_NUM_RADIOS > 1 */
+/*---------------------------------------------------------------------------*/
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+/* Attributes the CPU and radio time of the slot operation to TSCH */
+static void
+slot_operation_wrapper(struct rtimer *t, void *ptr)
+{
+  int subsystem;
+
+  subsystem = energest_subsystem_set(ENERGEST_SUBSYSTEM_TSCH);
+  tsch_slot_operation(t, ptr);
+  energest_subsystem_set(subsystem);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
 /* Protothread for slot operation, called from rtimer interrupt
  * and scheduled from tsch_schedule_slot_operation */
 static
@@ -872,9 +1175,14 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
     } else {
       uint8_t current_channel;
       TSCH_DEBUG_SLOT_START();
+      TSCH_TIMING_RECORD(tsch_timing_slot_start, RTIMER_NOW(), current_slot_start);
       tsch_in_slot_operation = 1;
       /* Get a packet ready to be sent */
       current_packet = get_packet_and_neighbor_for_link(current_link, &current_neighbor);
+#ifdef TSCH_CALLBACK_CELL_ELAPSED
+      /* Let the scheduling function account for cell usage */
+      TSCH_CALLBACK_CELL_ELAPSED(current_link, current_packet != NULL);
+#endif
       /* There is no packet to send, and this link does not have Rx flag. Instead of doing
        * nothing, switch to the backup link (has Rx flag) if any. */
       if(current_packet == NULL && !(current_link->link_options & LINK_OPTION_RX) && backup_link != NULL) {
@@ -887,6 +1195,10 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
       /* Reset drift correction */
       drift_correction = 0;
       is_drift_correction_used = 0;
+#if TSCH_NUM_RADIOS > 1
+      /* Receive on several radios if several Rx links are active */
+      num_rx_radios = current_packet == NULL ? rx_radios_setup() : 0;
+#endif /* TSCH_NUM_RADIOS > 1 */
       /* Decide whether it is a TX/RX/IDLE or OFF slot */
       /* Actual slot operation */
       if(current_packet != NULL) {
@@ -897,6 +1209,12 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
          **/
         static struct pt slot_tx_pt;
         PT_SPAWN(&slot_operation_pt, &slot_tx_pt, tsch_tx_slot(&slot_tx_pt, t));
+#if TSCH_NUM_RADIOS > 1
+      } else if(num_rx_radios > 0) {
+        /* Listen on several radios */
+        static struct pt slot_rx_multi_pt;
+        PT_SPAWN(&slot_operation_pt, &slot_rx_multi_pt, tsch_rx_slot_multi(&slot_rx_multi_pt, t));
+#endif /* TSCH_NUM_RADIOS > 1 */
       } else if((current_link->link_options & LINK_OPTION_RX)) {
         /* Listen */
         static struct pt slot_rx_pt;
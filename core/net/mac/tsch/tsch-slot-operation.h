@@ -36,6 +36,7 @@
 /********** Includes **********/
 
 #include "contiki.h"
+#include "dev/radio.h"
 #include "lib/ringbufindex.h"
 #include "net/mac/tsch/tsch-packet.h"
 #include "net/mac/tsch/tsch-private.h"
@@ -82,6 +83,13 @@
 int TSCH_CALLBACK_DO_NACK(struct tsch_link *link, linkaddr_t *src, linkaddr_t *dst);
 #endif
 
+/* Called by TSCH from interrupt at the start of every active slot, with used
+ * set if a packet is to be sent in the slot. Used by scheduling functions
+ * to measure cell usage. Must be short. */
+#ifdef TSCH_CALLBACK_CELL_ELAPSED
+void TSCH_CALLBACK_CELL_ELAPSED(struct tsch_link *link, int used);
+#endif
+
 /************ Types ***********/
 
 /* Stores data about an incoming packet */
@@ -110,6 +118,10 @@ extern struct tsch_packet *dequeued_array[TSCH_DEQUEUED_ARRAY_SIZE];
  * Will be processed layer by tsch_rx_process_pending */
 extern struct ringbufindex input_ringbuf;
 extern struct input_packet input_array[TSCH_MAX_INCOMING_PACKETS];
+#if TSCH_NUM_RADIOS > 1
+/* The radios other than NETSTACK_RADIO, receiving only */
+extern const struct radio_driver *const tsch_secondary_radios[TSCH_NUM_RADIOS - 1];
+#endif /* TSCH_NUM_RADIOS > 1 */
 
 /********** Functions *********/
 
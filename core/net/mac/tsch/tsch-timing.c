@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2016, SICS Swedish ICT.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Timing trace of the TSCH slot operation. Records are added from
+ *         interrupt to a ringbuf, and moved into the histograms from the
+ *         TSCH pending events process.
+ *
+ */
+
+#include "contiki.h"
+#include <stdio.h>
+#include <string.h>
+#include "net/mac/tsch/tsch-private.h"
+#include "net/mac/tsch/tsch-timing.h"
+#include "lib/ringbufindex.h"
+
+#if TSCH_TIMING_TRACE
+
+PROCESS_NAME(tsch_pending_events_process);
+
+/* Check if TSCH_TIMING_QUEUE_LEN is a power of two */
+#if (TSCH_TIMING_QUEUE_LEN & (TSCH_TIMING_QUEUE_LEN - 1)) != 0
+#error TSCH_TIMING_QUEUE_LEN must be power of two
+#endif
+
+struct tsch_timing_entry {
+  uint8_t event;
+  int32_t offset; /* In rtimer ticks */
+};
+
+static struct ringbufindex timing_ringbuf;
+static struct tsch_timing_entry timing_array[TSCH_TIMING_QUEUE_LEN];
+static uint16_t timing_dropped;
+static struct tsch_timing_hist hists[tsch_timing_num_events];
+
+static const char *event_names[tsch_timing_num_events] = {
+  "slot", "on", "off", "tx", "rx", "cca", "ack-tx", "ack-rx"
+};
+
+/*---------------------------------------------------------------------------*/
+void
+tsch_timing_record(enum tsch_timing_event event, rtimer_clock_t time, rtimer_clock_t nominal)
+{
+  int index = ringbufindex_peek_put(&timing_ringbuf);
+  if(index != -1) {
+    rtimer_clock_t diff = time - nominal;
+    timing_array[index].event = event;
+    /* Signed difference, whatever the width of rtimer_clock_t */
+    timing_array[index].offset = sizeof(rtimer_clock_t) == 2 ? (int16_t)diff : (int32_t)diff;
+    ringbufindex_put(&timing_ringbuf);
+    /* Idle slots do not poll the pending events process, do it before
+     * the queue fills up */
+    if(ringbufindex_elements(&timing_ringbuf) >= TSCH_TIMING_QUEUE_LEN / 2) {
+      process_poll(&tsch_pending_events_process);
+    }
+  } else {
+    timing_dropped++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+hist_add(struct tsch_timing_hist *h, int32_t us)
+{
+  int32_t bin;
+
+  us = MAX(INT16_MIN, MIN(INT16_MAX, us));
+  if(h->count == 0 || us < h->min) {
+    h->min = us;
+  }
+  if(h->count == 0 || us > h->max) {
+    h->max = us;
+  }
+  h->count++;
+  h->sum += us;
+
+  /* Floor division, for the bins left of 0 */
+  bin = us >= 0 ? us / TSCH_TIMING_HIST_BIN_WIDTH
+                : -((-us + TSCH_TIMING_HIST_BIN_WIDTH - 1) / TSCH_TIMING_HIST_BIN_WIDTH);
+  bin += TSCH_TIMING_HIST_BINS / 2;
+  bin = MAX(0, MIN(TSCH_TIMING_HIST_BINS - 1, bin));
+  if(h->bins[bin] < 0xffff) {
+    h->bins[bin]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_timing_process_pending(void)
+{
+  int16_t index;
+  while((index = ringbufindex_peek_get(&timing_ringbuf)) != -1) {
+    struct tsch_timing_entry *e = &timing_array[index];
+    if(e->event < tsch_timing_num_events) {
+      hist_add(&hists[e->event], (int32_t)RTIMERTICKS_TO_US(e->offset));
+    }
+    ringbufindex_get(&timing_ringbuf);
+  }
+}
+/*---------------------------------------------------------------------------*/
+const struct tsch_timing_hist *
+tsch_timing_get_hist(enum tsch_timing_event event)
+{
+  return event < tsch_timing_num_events ? &hists[event] : NULL;
+}
+/*---------------------------------------------------------------------------*/
+const char *
+tsch_timing_event_name(enum tsch_timing_event event)
+{
+  return event < tsch_timing_num_events ? event_names[event] : "?";
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+tsch_timing_dropped(void)
+{
+  return timing_dropped;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_timing_reset(void)
+{
+  tsch_timing_process_pending();
+  memset(hists, 0, sizeof(hists));
+  timing_dropped = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_timing_print(void)
+{
+  int i, j;
+  tsch_timing_process_pending();
+  printf("TSCH timing: bins of %u us from %d us, %u dropped\n",
+         TSCH_TIMING_HIST_BIN_WIDTH,
+         -(TSCH_TIMING_HIST_BINS / 2) * TSCH_TIMING_HIST_BIN_WIDTH, timing_dropped);
+  for(i = 0; i < tsch_timing_num_events; i++) {
+    struct tsch_timing_hist *h = &hists[i];
+    if(h->count == 0) {
+      continue;
+    }
+    printf("TSCH timing: %s n %lu min %d max %d avg %ld |",
+           event_names[i], (unsigned long)h->count, h->min, h->max,
+           (long)(h->sum / (int32_t)h->count));
+    for(j = 0; j < TSCH_TIMING_HIST_BINS; j++) {
+      printf(" %u", h->bins[j]);
+    }
+    printf("\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_timing_init(void)
+{
+  ringbufindex_init(&timing_ringbuf, TSCH_TIMING_QUEUE_LEN);
+  memset(hists, 0, sizeof(hists));
+  timing_dropped = 0;
+}
+
+#endif /* TSCH_TIMING_TRACE */
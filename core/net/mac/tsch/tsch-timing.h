@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2016, SICS Swedish ICT.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Timing trace of the TSCH slot operation. Records how far each
+ *         slot action lands from its nominal offset (from interrupt, into a
+ *         ringbuf), and aggregates the records into per-event histograms
+ *         (from process). Meant for tuning TSCH_CONF_RX_WAIT, the guard
+ *         times and the radio delays of a platform.
+ *
+ */
+
+#ifndef __TSCH_TIMING_H__
+#define __TSCH_TIMING_H__
+
+/********** Includes **********/
+
+#include "contiki.h"
+#include "sys/rtimer.h"
+
+/******** Configuration *******/
+
+/* Enable the timing trace */
+#ifdef TSCH_TIMING_CONF_TRACE
+#define TSCH_TIMING_TRACE TSCH_TIMING_CONF_TRACE
+#else /* TSCH_TIMING_CONF_TRACE */
+#define TSCH_TIMING_TRACE 0
+#endif /* TSCH_TIMING_CONF_TRACE */
+
+/* The length of the record queue, between two runs of the TSCH pending
+ * events process. Must be a power of two */
+#ifdef TSCH_TIMING_CONF_QUEUE_LEN
+#define TSCH_TIMING_QUEUE_LEN TSCH_TIMING_CONF_QUEUE_LEN
+#else /* TSCH_TIMING_CONF_QUEUE_LEN */
+#define TSCH_TIMING_QUEUE_LEN 32
+#endif /* TSCH_TIMING_CONF_QUEUE_LEN */
+
+/* The number of histogram bins. The first and last bins also count
+ * everything below and above the histogram range */
+#ifdef TSCH_TIMING_CONF_HIST_BINS
+#define TSCH_TIMING_HIST_BINS TSCH_TIMING_CONF_HIST_BINS
+#else /* TSCH_TIMING_CONF_HIST_BINS */
+#define TSCH_TIMING_HIST_BINS 16
+#endif /* TSCH_TIMING_CONF_HIST_BINS */
+
+/* The width of a histogram bin, in usec. The histogram is centered on 0,
+ * i.e. on the nominal offset */
+#ifdef TSCH_TIMING_CONF_HIST_BIN_WIDTH
+#define TSCH_TIMING_HIST_BIN_WIDTH TSCH_TIMING_CONF_HIST_BIN_WIDTH
+#else /* TSCH_TIMING_CONF_HIST_BIN_WIDTH */
+#define TSCH_TIMING_HIST_BIN_WIDTH 50
+#endif /* TSCH_TIMING_CONF_HIST_BIN_WIDTH */
+
+/************ Types ***********/
+
+/* The traced events. Each record is the time of the event minus its
+ * nominal time, i.e. positive when late */
+enum tsch_timing_event {
+  /* Slot start: rtimer interrupt vs. slot start */
+  tsch_timing_slot_start,
+  /* Radio on edge: Rx radio on vs. TsRxOffset */
+  tsch_timing_radio_on,
+  /* Radio off edge of idle Rx: radio off vs. TsRxOffset + TsRxWait */
+  tsch_timing_radio_off,
+  /* Tx: transmission start vs. TsTxOffset */
+  tsch_timing_tx_start,
+  /* Rx: frame start vs. TsTxOffset. Its spread is what TsRxWait must cover */
+  tsch_timing_rx_start,
+  /* CCA duration */
+  tsch_timing_cca,
+  /* ACK turnaround of the receiver: ACK transmission vs. TsTxAckDelay */
+  tsch_timing_ack_tx,
+  /* ACK arrival at the transmitter vs. TsRxAckDelay. Its spread is what
+   * TsAckWait must cover */
+  tsch_timing_ack_rx,
+  tsch_timing_num_events
+};
+
+/* Histogram of one event, in usec */
+struct tsch_timing_hist {
+  uint32_t count;
+  int32_t sum;
+  int16_t min;
+  int16_t max;
+  uint16_t bins[TSCH_TIMING_HIST_BINS];
+};
+
+#if TSCH_TIMING_TRACE
+
+/********** Functions *********/
+
+/* Add a record, from the slot operation: time of an event and its
+ * nominal time, in rtimer ticks */
+void tsch_timing_record(enum tsch_timing_event event, rtimer_clock_t time, rtimer_clock_t nominal);
+/* Move pending records into the histograms */
+void tsch_timing_process_pending(void);
+/* Returns the histogram of an event */
+const struct tsch_timing_hist *tsch_timing_get_hist(enum tsch_timing_event event);
+/* Returns the name of an event */
+const char *tsch_timing_event_name(enum tsch_timing_event event);
+/* Returns the number of records dropped because the queue was full */
+uint16_t tsch_timing_dropped(void);
+/* Clear the histograms */
+void tsch_timing_reset(void);
+/* Print the histograms */
+void tsch_timing_print(void);
+/* Initialize the timing trace */
+void tsch_timing_init(void);
+
+/************ Macros **********/
+
+/* Record the time of an event against its nominal time */
+#define TSCH_TIMING_RECORD(event, time, nominal) tsch_timing_record((event), (time), (nominal))
+
+#else /* TSCH_TIMING_TRACE */
+
+#define tsch_timing_process_pending()
+#define tsch_timing_init()
+#define TSCH_TIMING_RECORD(event, time, nominal)
+
+#endif /* TSCH_TIMING_TRACE */
+
+#endif /* __TSCH_TIMING_H__ */
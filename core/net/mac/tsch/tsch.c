@@ -45,15 +45,22 @@
 #include "net/netstack.h"
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
+#include "net/link-stats.h"
 #include "net/mac/framer-802154.h"
 #include "net/mac/tsch/tsch.h"
 #include "net/mac/tsch/tsch-slot-operation.h"
 #include "net/mac/tsch/tsch-queue.h"
 #include "net/mac/tsch/tsch-private.h"
 #include "net/mac/tsch/tsch-log.h"
+#include "net/mac/tsch/tsch-timing.h"
 #include "net/mac/tsch/tsch-packet.h"
 #include "net/mac/tsch/tsch-security.h"
+#include "net/mac/tsch/tsch-adaptive-timesync.h"
 #include "lib/random.h"
+#include "sys/boot-profile.h"
+#if TSCH_SCAN_LAST_CHANNEL
+#include "cfs/cfs.h"
+#endif /* TSCH_SCAN_LAST_CHANNEL */
 
 #if FRAME802154_VERSION < FRAME802154_IEEE802154E_2012
 #error TSCH: FRAME802154_VERSION must be at least FRAME802154_IEEE802154E_2012
@@ -243,6 +250,14 @@ keepalive_send()
 {
   if(tsch_is_associated) {
     struct tsch_neighbor *n = tsch_queue_get_time_source();
+    if(n != NULL && tsch_queue_packet_count(&n->addr) > 0) {
+      /* Unicast traffic to the time source is pending: its ACK will
+       * resynchronize us. Check again at the next timeout */
+      PRINTF("TSCH: KA to %u piggybacked on pending traffic\n",
+             TSCH_LOG_ID_FROM_LINKADDR(&n->addr));
+      tsch_schedule_keepalive();
+      return;
+    }
     /* Simply send an empty packet */
     packetbuf_clear();
     packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &n->addr);
@@ -252,14 +267,16 @@ keepalive_send()
   }
 }
 /*---------------------------------------------------------------------------*/
-/* Set ctimer to send a keepalive message after expiration of TSCH_KEEPALIVE_TIMEOUT */
+/* Set ctimer to send a keepalive message after expiration of the keepalive
+ * timeout: TSCH_KEEPALIVE_TIMEOUT, or longer when the drift model allows */
 void
 tsch_schedule_keepalive()
 {
-  /* Pick a delay in the range [TSCH_KEEPALIVE_TIMEOUT*0.9, TSCH_KEEPALIVE_TIMEOUT[ */
+  /* Pick a delay in the range [timeout*0.9, timeout[ */
   if(!tsch_is_coordinator && tsch_is_associated) {
-    unsigned long delay = (TSCH_KEEPALIVE_TIMEOUT - TSCH_KEEPALIVE_TIMEOUT / 10)
-      + random_rand() % (TSCH_KEEPALIVE_TIMEOUT / 10);
+    unsigned long timeout = tsch_timesync_keepalive_timeout();
+    unsigned long delay = (timeout - timeout / 10)
+      + random_rand() % (timeout / 10);
     ctimer_set(&keepalive_timer, delay, keepalive_send, NULL);
   }
 }
@@ -340,6 +357,26 @@ eb_input(struct input_packet *current_input)
   }
 }
 
+/*---------------------------------------------------------------------------*/
+/* Pass the IETF IE of a data frame to the upper layer (6top) */
+static void
+ietf_input(struct input_packet *current_input)
+{
+  frame802154_t frame;
+  struct ieee802154_ies ies;
+
+  if(tsch_packet_parse_ietf(current_input->payload, current_input->len,
+                            &frame, &ies)) {
+    /* PAN ID check and authentication done at rx time */
+#ifdef TSCH_CALLBACK_IETF_IE_INPUT
+    TSCH_CALLBACK_IETF_IE_INPUT((const linkaddr_t *)&frame.src_addr,
+                                ies.ie_ietf, ies.ie_ietf_len);
+#endif
+  } else {
+    PRINTF("TSCH:! failed to parse IETF IE\n");
+  }
+}
+
 /*---------------------------------------------------------------------------*/
 /* Process pending input packet(s) */
 static void
@@ -351,11 +388,23 @@ tsch_rx_process_pending()
     struct input_packet *current_input = &input_array[input_index];
     frame802154_t frame;
     uint8_t ret = frame802154_parse(current_input->payload, current_input->len, &frame);
-    int is_data = ret && frame.fcf.frame_type == FRAME802154_DATAFRAME;
+    /* Data frames with IEs carry 6top messages, they bypass the upper layers */
+    int is_ietf = ret
+      && frame.fcf.frame_version == FRAME802154_IEEE802154E_2012
+      && frame.fcf.frame_type == FRAME802154_DATAFRAME
+      && frame.fcf.ie_list_present;
+    int is_data = ret && frame.fcf.frame_type == FRAME802154_DATAFRAME && !is_ietf;
     int is_eb = ret
       && frame.fcf.frame_version == FRAME802154_IEEE802154E_2012
       && frame.fcf.frame_type == FRAME802154_BEACONFRAME;
 
+#if LINK_STATS_ENABLED
+    if(ret) {
+      link_stats_input((linkaddr_t *)&frame.src_addr, current_input->len,
+                       (int16_t)current_input->rssi);
+    }
+#endif /* LINK_STATS_ENABLED */
+
     if(is_data) {
       /* Skip EBs and other control messages */
       /* Copy to packetbuf for processing */
@@ -382,6 +431,8 @@ tsch_rx_process_pending()
       packet_input();
     } else if(is_eb) {
       eb_input(current_input);
+    } else if(is_ietf) {
+      ietf_input(current_input);
     }
   }
 }
@@ -405,6 +456,14 @@ tsch_tx_process_pending()
     packetbuf_set_attr(PACKETBUF_ATTR_TSCH_TRANSMISSIONS, p->transmissions);
 #endif /* TSCH_WITH_LINK_STATISTICS */
 
+#if LINK_STATS_ENABLED
+    /* The frame was kept as framed, so it is all data in the packetbuf */
+    link_stats_transmission(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                            packetbuf_totlen(), p->transmissions);
+    link_stats_packet_sent(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), p->ret,
+                           p->transmissions);
+#endif /* LINK_STATS_ENABLED */
+
     /* Call packet_sent callback */
     mac_call_sent_callback(p->sent, p->ptr, p->ret, p->transmissions);
     /* Free packet queuebuf */
@@ -430,6 +489,7 @@ tsch_start_coordinator(void)
 
   tsch_is_associated = 1;
   tsch_join_priority = 0;
+  BOOT_PROFILE_MARK(BOOT_PROFILE_MAC);
 
   PRINTF("TSCH: starting as coordinator, PAN ID %x, asn-%x.%lx\n",
       frame802154_get_pan_id(), current_asn.ms1b, current_asn.ls4b);
@@ -593,6 +653,7 @@ tsch_associate(const struct input_packet *input_eb, rtimer_clock_t timestamp)
       /* Update global flags */
       tsch_is_associated = 1;
       tsch_is_pan_secured = frame.fcf.security_enabled;
+      BOOT_PROFILE_MARK(BOOT_PROFILE_MAC);
 
       /* Association done, schedule keepalive messages */
       tsch_schedule_keepalive();
@@ -617,6 +678,193 @@ tsch_associate(const struct input_packet *input_eb, rtimer_clock_t timestamp)
 
 /* Processes and protothreads used by TSCH */
 
+/*---------------------------------------------------------------------------*/
+/* Channel selection for scanning */
+
+/* Time when we started scanning, and number of channels scanned since */
+static clock_time_t scan_start_time;
+static uint16_t scan_channel_count;
+
+#if TSCH_SCAN_LAST_CHANNEL
+/* The channel we last joined on, 0 if unknown */
+static uint8_t scan_last_channel;
+
+static void
+scan_last_channel_load(void)
+{
+  int fd;
+
+  scan_last_channel = 0;
+  fd = cfs_open(TSCH_SCAN_LAST_CHANNEL_FILE, CFS_READ);
+  if(fd >= 0) {
+    if(cfs_read(fd, &scan_last_channel, 1) != 1) {
+      scan_last_channel = 0;
+    }
+    cfs_close(fd);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+scan_last_channel_save(uint8_t channel)
+{
+  int fd;
+
+  if(channel == scan_last_channel) {
+    return;
+  }
+  cfs_remove(TSCH_SCAN_LAST_CHANNEL_FILE);
+  fd = cfs_open(TSCH_SCAN_LAST_CHANNEL_FILE, CFS_WRITE);
+  if(fd < 0) {
+    PRINTF("TSCH:! failed to save the last channel\n");
+    return;
+  }
+  if(cfs_write(fd, &channel, 1) == 1) {
+    scan_last_channel = channel;
+  }
+  cfs_close(fd);
+}
+#endif /* TSCH_SCAN_LAST_CHANNEL */
+
+#if TSCH_SCAN_STRATEGY != TSCH_SCAN_RANDOM
+/* The channels of the current scan round, in order, and our position */
+static uint8_t scan_order[TSCH_HOPPING_SEQUENCE_MAX_LEN + 1];
+static uint8_t scan_order_len;
+static uint8_t scan_order_index;
+
+#if TSCH_SCAN_STRATEGY == TSCH_SCAN_RSSI
+/* Highest of TSCH_SCAN_RSSI_SAMPLES readings on a channel. The radio is on */
+static radio_value_t
+scan_channel_rssi(uint8_t channel)
+{
+  radio_value_t rssi;
+  radio_value_t max_rssi = -128;
+  rtimer_clock_t t0;
+  int i;
+
+  NETSTACK_RADIO.set_value(RADIO_PARAM_CHANNEL, channel);
+  for(i = 0; i < TSCH_SCAN_RSSI_SAMPLES; i++) {
+    t0 = RTIMER_NOW();
+    BUSYWAIT_UNTIL_ABS(0, t0, RTIMER_SECOND / 2000);
+    if(NETSTACK_RADIO.get_value(RADIO_PARAM_RSSI, &rssi) == RADIO_RESULT_OK
+       && rssi > max_rssi) {
+      max_rssi = rssi;
+    }
+  }
+  return max_rssi;
+}
+#endif /* TSCH_SCAN_STRATEGY == TSCH_SCAN_RSSI */
+
+/* Fill scan_order with the join hopping sequence, without duplicates and
+ * with the last channel we joined on first */
+static void
+scan_order_build(void)
+{
+  const uint8_t *sequence = TSCH_JOIN_HOPPING_SEQUENCE;
+  uint8_t i, j;
+
+  scan_order_len = 0;
+  scan_order_index = 0;
+#if TSCH_SCAN_LAST_CHANNEL
+  if(scan_last_channel != 0) {
+    scan_order[scan_order_len++] = scan_last_channel;
+  }
+#endif /* TSCH_SCAN_LAST_CHANNEL */
+  for(i = 0; i < sizeof(TSCH_JOIN_HOPPING_SEQUENCE)
+      && scan_order_len < sizeof(scan_order); i++) {
+    for(j = 0; j < scan_order_len && scan_order[j] != sequence[i]; j++);
+    if(j == scan_order_len) {
+      scan_order[scan_order_len++] = sequence[i];
+    }
+  }
+
+#if TSCH_SCAN_STRATEGY == TSCH_SCAN_RSSI
+  {
+    /* Insertion sort by decreasing RSSI, keeping the last channel first */
+    radio_value_t rssi[sizeof(scan_order)];
+    radio_value_t r;
+    uint8_t channel;
+    uint8_t first = 0;
+
+#if TSCH_SCAN_LAST_CHANNEL
+    first = scan_last_channel != 0;
+#endif /* TSCH_SCAN_LAST_CHANNEL */
+    for(i = 0; i < scan_order_len; i++) {
+      channel = scan_order[i];
+      r = scan_channel_rssi(channel);
+      for(j = i; j > first && rssi[j - 1] < r; j--) {
+        rssi[j] = rssi[j - 1];
+        scan_order[j] = scan_order[j - 1];
+      }
+      rssi[j] = r;
+      scan_order[j] = channel;
+    }
+    PRINTF("TSCH: scan order by RSSI:");
+    for(i = 0; i < scan_order_len; i++) {
+      PRINTF(" %u (%d)", scan_order[i], rssi[i]);
+    }
+    PRINTF("\n");
+  }
+#endif /* TSCH_SCAN_STRATEGY == TSCH_SCAN_RSSI */
+}
+#endif /* TSCH_SCAN_STRATEGY != TSCH_SCAN_RANDOM */
+/*---------------------------------------------------------------------------*/
+static void
+scan_start(void)
+{
+  scan_start_time = clock_time();
+  scan_channel_count = 0;
+#if TSCH_SCAN_LAST_CHANNEL
+  scan_last_channel_load();
+#endif /* TSCH_SCAN_LAST_CHANNEL */
+#if TSCH_SCAN_STRATEGY != TSCH_SCAN_RANDOM
+  /* Build the first round when picking the first channel */
+  scan_order_len = 0;
+  scan_order_index = 0;
+#endif /* TSCH_SCAN_STRATEGY != TSCH_SCAN_RANDOM */
+}
+/*---------------------------------------------------------------------------*/
+/* The next channel to scan. The radio is on */
+static uint8_t
+scan_next_channel(void)
+{
+  scan_channel_count++;
+#if TSCH_SCAN_STRATEGY == TSCH_SCAN_RANDOM
+#if TSCH_SCAN_LAST_CHANNEL
+  if(scan_channel_count == 1 && scan_last_channel != 0) {
+    return scan_last_channel;
+  }
+#endif /* TSCH_SCAN_LAST_CHANNEL */
+  /* Pick a channel at random in TSCH_JOIN_HOPPING_SEQUENCE */
+  return TSCH_JOIN_HOPPING_SEQUENCE[
+      random_rand() % sizeof(TSCH_JOIN_HOPPING_SEQUENCE)];
+#else /* TSCH_SCAN_STRATEGY == TSCH_SCAN_RANDOM */
+  if(scan_order_index >= scan_order_len) {
+    /* New round */
+    scan_order_build();
+  }
+  return scan_order[scan_order_index++];
+#endif /* TSCH_SCAN_STRATEGY == TSCH_SCAN_RANDOM */
+}
+/*---------------------------------------------------------------------------*/
+/* Report how long joining took, for join latency benchmarks */
+static void
+scan_joined(uint8_t channel)
+{
+#if TSCH_LOG_LEVEL >= 1
+  unsigned long join_ms = (unsigned long)(clock_time() - scan_start_time)
+    * 1000 / CLOCK_SECOND;
+
+  PRINTF("TSCH: joined after %lu ms on channel %u, %u channels scanned\n",
+         join_ms, channel, scan_channel_count);
+  TSCH_LOG_ADD(tsch_log_message,
+      snprintf(log->message, sizeof(log->message),
+          "join %lu ms ch %u scanned %u", join_ms, channel, scan_channel_count);
+  );
+#endif /* TSCH_LOG_LEVEL */
+#if TSCH_SCAN_LAST_CHANNEL
+  scan_last_channel_save(channel);
+#endif /* TSCH_SCAN_LAST_CHANNEL */
+}
 /*---------------------------------------------------------------------------*/
 /* Scanning protothread, called by tsch_process:
  * Listen to different channels, and when receiving an EB,
@@ -628,38 +876,38 @@ PT_THREAD(tsch_scan(struct pt *pt))
 
   static struct input_packet input_eb;
   static struct etimer scan_timer;
+  /* Hop to any channel offset */
+  static int current_channel;
+  /* Time when we started scanning on current_channel */
+  static clock_time_t current_channel_since;
 
   ASN_INIT(current_asn, 0, 0);
+  current_channel = 0;
+  scan_start();
 
   etimer_set(&scan_timer, CLOCK_SECOND / TSCH_ASSOCIATION_POLL_FREQUENCY);
 
   while(!tsch_is_associated && !tsch_is_coordinator) {
-    /* Hop to any channel offset */
-    static int current_channel = 0;
-    /* Time when we started scanning on current_channel */
-    static clock_time_t current_channel_since = 0;
-
     /* We are not coordinator, try to associate */
     rtimer_clock_t t0;
     int is_packet_pending = 0;
-    clock_time_t now_seconds = clock_seconds();
+    clock_time_t now = clock_time();
+
+    /* Turn radio on and wait for EB */
+    NETSTACK_RADIO.on();
 
     /* Switch to a (new) channel for scanning */
-    if(current_channel == 0 || now_seconds != current_channel_since) {
-      /* Pick a channel at random in TSCH_JOIN_HOPPING_SEQUENCE */
-      uint8_t scan_channel = TSCH_JOIN_HOPPING_SEQUENCE[
-          random_rand() % sizeof(TSCH_JOIN_HOPPING_SEQUENCE)];
-      if(current_channel != scan_channel) {
+    if(current_channel == 0 || now - current_channel_since >= TSCH_CHANNEL_SCAN_DURATION) {
+      uint8_t scan_channel = scan_next_channel();
+      /* RSSI sampling may have moved the radio to another channel */
+      if(current_channel != scan_channel || TSCH_SCAN_STRATEGY == TSCH_SCAN_RSSI) {
         NETSTACK_RADIO.set_value(RADIO_PARAM_CHANNEL, scan_channel);
         current_channel = scan_channel;
         PRINTF("TSCH: scanning on channel %u\n", scan_channel);
       }
-      current_channel_since = now_seconds;
+      current_channel_since = now;
     }
 
-    /* Turn radio on and wait for EB */
-    NETSTACK_RADIO.on();
-
     is_packet_pending = NETSTACK_RADIO.pending_packet();
     if(!is_packet_pending && NETSTACK_RADIO.receiving_packet()) {
       /* If we are currently receiving a packet, wait until end of reception */
@@ -677,7 +925,9 @@ PT_THREAD(tsch_scan(struct pt *pt))
       /* Parse EB and attempt to associate */
       PRINTF("TSCH: association: received packet (%u bytes) on channel %u\n", input_eb.len, current_channel);
 
-      tsch_associate(&input_eb, t0);
+      if(tsch_associate(&input_eb, t0)) {
+        scan_joined(current_channel);
+      }
     }
 
     if(tsch_is_associated) {
@@ -814,6 +1064,7 @@ PROCESS_THREAD(tsch_pending_events_process, ev, data)
     tsch_rx_process_pending();
     tsch_tx_process_pending();
     tsch_log_process_pending();
+    tsch_timing_process_pending();
   }
   PROCESS_END();
 }
@@ -827,6 +1078,9 @@ tsch_init(void)
   radio_value_t radio_rx_mode;
   radio_value_t radio_tx_mode;
   rtimer_clock_t t;
+#if TSCH_NUM_RADIOS > 1
+  int i;
+#endif /* TSCH_NUM_RADIOS > 1 */
 
   /* Radio Rx mode */
   if(NETSTACK_RADIO.get_value(RADIO_PARAM_RX_MODE, &radio_rx_mode) != RADIO_RESULT_OK) {
@@ -855,11 +1109,27 @@ tsch_init(void)
     printf("TSCH:! radio does not support setting required RADIO_PARAM_TX_MODE. Abort init.\n");
     return;
   }
+#if TSCH_NUM_RADIOS > 1
+  /* Secondary radios, receiving only: same Rx and Tx modes */
+  for(i = 0; i < TSCH_NUM_RADIOS - 1; i++) {
+    const struct radio_driver *radio = tsch_secondary_radios[i];
+    radio->init();
+    if(radio->set_value(RADIO_PARAM_RX_MODE, radio_rx_mode) != RADIO_RESULT_OK
+       || radio->set_value(RADIO_PARAM_TX_MODE, radio_tx_mode) != RADIO_RESULT_OK) {
+      printf("TSCH:! secondary radio %u does not support the required modes. Abort init.\n", i + 1);
+      return;
+    }
+    radio->off();
+  }
+#endif /* TSCH_NUM_RADIOS > 1 */
   /* Test setting channel */
   if(NETSTACK_RADIO.set_value(RADIO_PARAM_CHANNEL, TSCH_DEFAULT_HOPPING_SEQUENCE[0]) != RADIO_RESULT_OK) {
     printf("TSCH:! radio does not support setting channel. Abort init.\n");
     return;
   }
+#if TSCH_RADIO_CAPABILITIES
+  tsch_radio_capabilities_init();
+#endif /* TSCH_RADIO_CAPABILITIES */
   /* Test getting timestamp */
   if(NETSTACK_RADIO.get_object(RADIO_PARAM_LAST_PACKET_TIMESTAMP, &t, sizeof(rtimer_clock_t)) != RADIO_RESULT_OK) {
     printf("TSCH:! radio does not support getting last packet timestamp. Abort init.\n");
@@ -875,6 +1145,7 @@ tsch_init(void)
   tsch_queue_init();
   tsch_schedule_init();
   tsch_log_init();
+  tsch_timing_init();
   ringbufindex_init(&input_ringbuf, TSCH_MAX_INCOMING_PACKETS);
   ringbufindex_init(&dequeued_ringbuf, TSCH_DEQUEUED_ARRAY_SIZE);
 
@@ -966,6 +1237,55 @@ send_packet(mac_callback_t sent, void *ptr)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Enqueue a unicast frame carrying a payload IETF IE (6top). The sent
+ * callback is called only if the frame was enqueued (returns 1) */
+int
+tsch_send_ietf(const linkaddr_t *dest, const uint8_t *content, uint16_t content_len,
+    mac_callback_t sent, void *ptr)
+{
+  int len;
+  uint8_t hdr_len = 0;
+  struct tsch_packet *p;
+
+  if(!tsch_is_associated || dest == NULL || linkaddr_cmp(dest, &linkaddr_null)) {
+    return 0;
+  }
+
+  packetbuf_clear();
+  /* We don't use seqno 0 */
+  if(++tsch_packet_seqno == 0) {
+    tsch_packet_seqno++;
+  }
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, tsch_packet_seqno);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
+#if TSCH_SECURITY_ENABLED
+  if(tsch_is_pan_secured) {
+    /* Set security level, key id and index */
+    packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, TSCH_SECURITY_KEY_SEC_LEVEL_OTHER);
+    packetbuf_set_attr(PACKETBUF_ATTR_KEY_ID_MODE, FRAME802154_1_BYTE_KEY_ID_MODE); /* Use 1-byte key index */
+    packetbuf_set_attr(PACKETBUF_ATTR_KEY_INDEX, TSCH_SECURITY_KEY_INDEX_OTHER);
+  }
+#endif /* TSCH_SECURITY_ENABLED */
+
+  len = tsch_packet_create_ietf(packetbuf_dataptr(), PACKETBUF_SIZE, dest,
+      tsch_packet_seqno, content, content_len, &hdr_len);
+  if(len <= 0) {
+    PRINTF("TSCH:! can't create IETF IE frame\n");
+    return 0;
+  }
+  packetbuf_set_datalen(len);
+
+  if((p = tsch_queue_add_packet(dest, sent, ptr)) == NULL) {
+    PRINTF("TSCH:! can't enqueue IETF IE frame\n");
+    return 0;
+  }
+  p->header_len = hdr_len;
+  PRINTF("TSCH: enqueue IETF IE frame to %u, len %u %u\n",
+         TSCH_LOG_ID_FROM_LINKADDR(dest), len, hdr_len);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 static void
 packet_input(void)
 {
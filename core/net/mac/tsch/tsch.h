@@ -56,6 +56,15 @@
 #define TSCH_DESYNC_THRESHOLD (4 * TSCH_KEEPALIVE_TIMEOUT)
 #endif
 
+/* With TSCH_ADAPTIVE_TIMESYNC, the keep-alive timeout is lengthened up to
+ * this value once the drift of the time source is accurately known.
+ * Must stay below TSCH_DESYNC_THRESHOLD */
+#ifdef TSCH_CONF_MAX_KEEPALIVE_TIMEOUT
+#define TSCH_MAX_KEEPALIVE_TIMEOUT TSCH_CONF_MAX_KEEPALIVE_TIMEOUT
+#else
+#define TSCH_MAX_KEEPALIVE_TIMEOUT (TSCH_DESYNC_THRESHOLD / 2)
+#endif
+
 /* Period between two consecutive EBs */
 #ifdef TSCH_CONF_EB_PERIOD
 #define TSCH_EB_PERIOD TSCH_CONF_EB_PERIOD
@@ -102,6 +111,51 @@
 #define TSCH_ASSOCIATION_POLL_FREQUENCY 100
 #endif
 
+/* Channel scan strategies used when joining:
+ * RANDOM picks a random channel of TSCH_JOIN_HOPPING_SEQUENCE for every
+ * scan period; HOPPING walks the join hopping sequence in order, so that
+ * every channel gets listened to once per round; RSSI walks the channels
+ * in decreasing order of the energy sampled at the start of each round,
+ * as busy channels are more likely to carry EBs. */
+#define TSCH_SCAN_RANDOM  0
+#define TSCH_SCAN_HOPPING 1
+#define TSCH_SCAN_RSSI    2
+
+#ifdef TSCH_CONF_SCAN_STRATEGY
+#define TSCH_SCAN_STRATEGY TSCH_CONF_SCAN_STRATEGY
+#else
+#define TSCH_SCAN_STRATEGY TSCH_SCAN_RANDOM
+#endif
+
+/* Time spent listening on a channel before switching to the next one */
+#ifdef TSCH_CONF_CHANNEL_SCAN_DURATION
+#define TSCH_CHANNEL_SCAN_DURATION TSCH_CONF_CHANNEL_SCAN_DURATION
+#else
+#define TSCH_CHANNEL_SCAN_DURATION CLOCK_SECOND
+#endif
+
+/* Number of RSSI readings per channel with TSCH_SCAN_RSSI, the highest
+ * one is kept */
+#ifdef TSCH_CONF_SCAN_RSSI_SAMPLES
+#define TSCH_SCAN_RSSI_SAMPLES TSCH_CONF_SCAN_RSSI_SAMPLES
+#else
+#define TSCH_SCAN_RSSI_SAMPLES 8
+#endif
+
+/* Store the channel we joined on in the file system (CFS), and scan it
+ * first after a reboot */
+#ifdef TSCH_CONF_SCAN_LAST_CHANNEL
+#define TSCH_SCAN_LAST_CHANNEL TSCH_CONF_SCAN_LAST_CHANNEL
+#else
+#define TSCH_SCAN_LAST_CHANNEL 0
+#endif
+
+#ifdef TSCH_CONF_SCAN_LAST_CHANNEL_FILE
+#define TSCH_SCAN_LAST_CHANNEL_FILE TSCH_CONF_SCAN_LAST_CHANNEL_FILE
+#else
+#define TSCH_SCAN_LAST_CHANNEL_FILE "tsch-channel"
+#endif
+
 /* When associating, check ASN against our own uptime (time in minutes)..
  * Useful to force joining only with nodes started roughly at the same time.
  * Set to the max number of minutes acceptable. */
@@ -142,6 +196,12 @@ void TSCH_CALLBACK_JOINING_NETWORK();
 void TSCH_CALLBACK_LEAVING_NETWORK();
 #endif
 
+/* Called by TSCH from process context when receiving a data frame with a
+ * payload IETF IE, e.g. a 6P message. The content is not valid after return */
+#ifdef TSCH_CALLBACK_IETF_IE_INPUT
+void TSCH_CALLBACK_IETF_IE_INPUT(const linkaddr_t *src, const uint8_t *content, uint16_t content_len);
+#endif
+
 /***** External Variables *****/
 
 /* Are we coordinator of the TSCH network? */
@@ -163,5 +223,9 @@ void tsch_set_eb_period(uint32_t period);
 void tsch_set_coordinator(int enable);
 /* Set the pan as secured or not */
 void tsch_set_pan_secured(int enable);
+/* Send a frame with a payload IETF IE (e.g. a 6P message) to a neighbor.
+ * Returns 1 if enqueued, in which case sent is called after transmission */
+int tsch_send_ietf(const linkaddr_t *dest, const uint8_t *content, uint16_t content_len,
+    mac_callback_t sent, void *ptr);
 
 #endif /* __TSCH_H__ */
@@ -55,12 +55,17 @@ static uint8_t initialized = 0;
 /* List of link-layer addresses of the neighbors, used as key in the tables */
 typedef struct nbr_table_key {
   struct nbr_table_key *next;
+#if NBR_TABLE_HASH
+  struct nbr_table_key *hash_next;
+#endif /* NBR_TABLE_HASH */
   linkaddr_t lladdr;
 } nbr_table_key_t;
 
 /* For each neighbor, a map of the tables that use the neighbor.
  * As we are using uint8_t, we have a maximum of 8 tables in the system */
 static uint8_t used_map[NBR_TABLE_MAX_NEIGHBORS];
+/* For each neighbor, the number of bits set in its used_map entry */
+static uint8_t used_count[NBR_TABLE_MAX_NEIGHBORS];
 /* For each neighbor, a map of the tables that lock the neighbor */
 static uint8_t locked_map[NBR_TABLE_MAX_NEIGHBORS];
 /* The maximum number of tables */
@@ -69,11 +74,18 @@ static uint8_t locked_map[NBR_TABLE_MAX_NEIGHBORS];
 static struct nbr_table *all_tables[MAX_NUM_TABLES];
 /* The current number of tables */
 static unsigned num_tables;
+/* Ranks the neighbors to evict when the table is full, if set */
+static nbr_table_policy *eviction_policy;
 
 /* The neighbor address table */
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH
+/* The keys, chained on hash_next in the bucket of their address */
+static nbr_table_key_t *key_buckets[NBR_TABLE_HASH];
+#endif /* NBR_TABLE_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -117,6 +129,47 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_HASH
+/* Get the hash bucket of a link-layer address. The last bytes of an
+   address vary the most, so they are mixed in last. */
+static nbr_table_key_t **
+bucket_from_lladdr(const linkaddr_t *lladdr)
+{
+  unsigned hash;
+  int i;
+
+  hash = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = (hash * 31) ^ lladdr->u8[i];
+  }
+  return &key_buckets[(hash ^ (hash >> 8)) & (NBR_TABLE_HASH - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(nbr_table_key_t *key)
+{
+  nbr_table_key_t **bucket;
+
+  bucket = bucket_from_lladdr(&key->lladdr);
+  key->hash_next = *bucket;
+  *bucket = key;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  nbr_table_key_t **k;
+
+  for(k = bucket_from_lladdr(&key->lladdr); *k != NULL; k = &(*k)->hash_next) {
+    if(*k == key) {
+      *k = key->hash_next;
+      key->hash_next = NULL;
+      return;
+    }
+  }
+}
+#endif /* NBR_TABLE_HASH */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
@@ -127,6 +180,14 @@ index_from_lladdr(const linkaddr_t *lladdr)
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH
+  for(key = *bucket_from_lladdr(lladdr); key != NULL; key = key->hash_next) {
+    if(linkaddr_cmp(lladdr, &key->lladdr)) {
+      return index_from_key(key);
+    }
+  }
+  return -1;
+#else /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -135,6 +196,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     key = list_item_next(key);
   }
   return -1;
+#endif /* NBR_TABLE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 /* Get bit from "used" or "locked" bitmap */
@@ -169,11 +231,26 @@ nbr_set_bit(uint8_t *bitmap, nbr_table_t *table, nbr_table_item_t *item, int val
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Set bit in the "used" bitmap, keeping count of the tables using the item */
+static int
+nbr_set_used(nbr_table_t *table, nbr_table_item_t *item, int value)
+{
+  int item_index = index_from_item(table, item);
+
+  if(table != NULL && item_index != -1) {
+    if((value != 0) != ((used_map[item_index] & (1 << table->index)) != 0)) {
+      used_count[item_index] += value ? 1 : -1;
+    }
+  }
+  return nbr_set_bit(used_map, table, item, value);
+}
+/*---------------------------------------------------------------------------*/
 static nbr_table_key_t *
 nbr_table_allocate(void)
 {
   nbr_table_key_t *key;
   int least_used_count = 0;
+  int least_worth = 0;
   nbr_table_key_t *least_used_key = NULL;
 
   key = memb_alloc(&neighbor_addr_mem);
@@ -182,8 +259,9 @@ nbr_table_allocate(void)
   } else { /* No more space, try to free a neighbor.
             * The replacement policy is the following: remove neighbor that is:
             * (1) not locked
-            * (2) used by fewest tables
-            * (3) oldest (the list is ordered by insertion time)
+            * (2) least worth keeping, according to the eviction policy
+            * (3) used by fewest tables
+            * (4) oldest (the list is ordered by insertion time)
             * */
     /* Get item from first key */
     key = list_head(nbr_table_keys);
@@ -192,20 +270,16 @@ nbr_table_allocate(void)
       int locked = locked_map[item_index];
       /* Never delete a locked item */
       if(!locked) {
-        int used = used_map[item_index];
-        int used_count = 0;
-        /* Count how many tables are using this item */
-        while(used != 0) {
-          if((used & 1) == 1) {
-            used_count++;
-          }
-          used >>= 1;
-        }
-        /* Find least used item */
-        if(least_used_key == NULL || used_count < least_used_count) {
+        int used = used_count[item_index];
+        int worth = eviction_policy != NULL ? eviction_policy(&key->lladdr) : 0;
+        /* Find least worth, least used item */
+        if(worth < NBR_TABLE_KEEP &&
+           (least_used_key == NULL || worth < least_worth ||
+            (worth == least_worth && used < least_used_count))) {
           least_used_key = key;
-          least_used_count = used_count;
-          if(used_count == 0) { /* We won't find any least used item */
+          least_used_count = used;
+          least_worth = worth;
+          if(worth == 0 && used == 0) { /* We won't find any less used item */
             break;
           }
         }
@@ -229,8 +303,12 @@ nbr_table_allocate(void)
       }
       /* Empty used map */
       used_map[index_from_key(least_used_key)] = 0;
+      used_count[index_from_key(least_used_key)] = 0;
       /* Remove neighbor from list */
       list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_HASH
+      hash_remove(least_used_key);
+#endif /* NBR_TABLE_HASH */
       /* Return associated key */
       return least_used_key;
     }
@@ -260,6 +338,13 @@ nbr_table_register(nbr_table_t *table, nbr_table_callback *callback)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Set the policy ranking the neighbors to evict when the table is full */
+void
+nbr_table_set_policy(nbr_table_policy *policy)
+{
+  eviction_policy = policy;
+}
+/*---------------------------------------------------------------------------*/
 /* Returns the first item of the current table */
 nbr_table_item_t *
 nbr_table_head(nbr_table_t *table)
@@ -318,6 +403,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_add(key);
+#endif /* NBR_TABLE_HASH */
   }
 
   /* Get item in the current table */
@@ -325,7 +413,7 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 
   /* Initialize item data and set "used" bit */
   memset(item, 0, table->item_size);
-  nbr_set_bit(used_map, table, item, 1);
+  nbr_set_used(table, item, 1);
 
   return item;
 }
@@ -342,7 +430,7 @@ nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 int
 nbr_table_remove(nbr_table_t *table, void *item)
 {
-  int ret = nbr_set_bit(used_map, table, item, 0);
+  int ret = nbr_set_used(table, item, 0);
   nbr_set_bit(locked_map, table, item, 0);
   return ret;
 }
@@ -46,12 +46,31 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* With NBR_TABLE_CONF_HASH set to a number of hash buckets (a power of
+   two), the link-layer addresses of the neighbors are also kept in a
+   hash table, so that finding a neighbor from its address does not
+   have to compare it with every address in the table. */
+#ifdef NBR_TABLE_CONF_HASH
+#define NBR_TABLE_HASH NBR_TABLE_CONF_HASH
+#else /* NBR_TABLE_CONF_HASH */
+#define NBR_TABLE_HASH 0
+#endif /* NBR_TABLE_CONF_HASH */
+
 /* An item in a neighbor table */
 typedef void nbr_table_item_t;
 
 /* Callback function, called when removing an item from a table */
 typedef void(nbr_table_callback)(nbr_table_item_t *item);
 
+/* Eviction policy, consulted when all neighbors are in use and one
+   must make room for a new one. It returns how much the neighbor with
+   the given address is worth keeping, from 0 (evicted first) up to
+   NBR_TABLE_KEEP (never evicted). Among neighbors of equal worth, the
+   one used by fewest tables goes first, then the oldest one. Locked
+   neighbors are never evicted. */
+typedef int(nbr_table_policy)(const linkaddr_t *lladdr);
+#define NBR_TABLE_KEEP 0x7fff
+
 /* A neighbor table */
 typedef struct nbr_table {
   int index;
@@ -82,6 +101,11 @@ nbr_table_item_t *nbr_table_head(nbr_table_t *table);
 nbr_table_item_t *nbr_table_next(nbr_table_t *table, nbr_table_item_t *item);
 /** @} */
 
+/** \name Neighbor tables: eviction policy (NULL: fewest tables, then oldest) */
+/** @{ */
+void nbr_table_set_policy(nbr_table_policy *policy);
+/** @} */
+
 /** \name Neighbor tables: add and get data */
 /** @{ */
 nbr_table_item_t *nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr);
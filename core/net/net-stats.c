@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A registry of the network stack counters
+ */
+
+#include "net/net-stats.h"
+
+#if NET_STATS_ENABLED
+
+#include "lib/list.h"
+#include <string.h>
+
+#if UIP_STATISTICS == 1
+#include "net/ip/uip.h"
+#endif /* UIP_STATISTICS == 1 */
+#if RIMESTATS_CONF_ENABLED
+#include "net/rime/rimestats.h"
+#endif /* RIMESTATS_CONF_ENABLED */
+#if NETSTACK_CONF_WITH_IPV6
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/ipv6/multicast/uip-mcast6-stats.h"
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+#if UIP_CONF_IPV6_RPL && RPL_CONF_STATS
+#include "net/rpl/rpl-private.h"
+#endif /* UIP_CONF_IPV6_RPL && RPL_CONF_STATS */
+
+LIST(groups);
+static uint32_t last[NET_STATS_DELTA_MAX];
+
+/*---------------------------------------------------------------------------*/
+/* The counters of the stack, in the order of their structs */
+#if UIP_STATISTICS == 1
+static const char *const ip_fields[] = {
+  "recv", "sent", "forwarded", "drop", "vhlerr", "hblenerr", "lblenerr",
+  "fragerr", "chkerr", "protoerr"
+};
+static NET_STATS_GROUP(ip_group, "ip", ip_fields, uip_stat.ip.recv, 0);
+
+static const char *const icmp_fields[] = {
+  "recv", "sent", "drop", "typeerr", "chkerr"
+};
+static NET_STATS_GROUP(icmp_group, "icmp", icmp_fields, uip_stat.icmp.recv, 0);
+
+#if UIP_TCP
+static const char *const tcp_fields[] = {
+  "recv", "sent", "drop", "chkerr", "ackerr", "rst", "rexmit", "syndrop",
+  "synrst"
+};
+static NET_STATS_GROUP(tcp_group, "tcp", tcp_fields, uip_stat.tcp.recv, 0);
+#endif /* UIP_TCP */
+
+#if UIP_UDP
+static const char *const udp_fields[] = {
+  "drop", "recv", "sent", "chkerr"
+};
+static NET_STATS_GROUP(udp_group, "udp", udp_fields, uip_stat.udp.drop, 0);
+#endif /* UIP_UDP */
+
+#if NETSTACK_CONF_WITH_IPV6
+static const char *const nd6_fields[] = {
+  "drop", "recv", "sent"
+};
+static NET_STATS_GROUP(nd6_group, "nd6", nd6_fields, uip_stat.nd6.drop, 0);
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+#endif /* UIP_STATISTICS == 1 */
+
+#if RIMESTATS_CONF_ENABLED
+static const char *const rime_fields[] = {
+  "tx", "rx", "reliabletx", "reliablerx", "rexmit", "acktx", "noacktx",
+  "ackrx", "timedout", "badackrx", "toolong", "tooshort", "badsynch",
+  "badcrc", "contentiondrop", "sendingdrop", "lltx", "llrx"
+};
+static NET_STATS_GROUP(rime_group, "rime", rime_fields, rimestats.tx, 0);
+#endif /* RIMESTATS_CONF_ENABLED */
+
+#if UIP_CONF_IPV6_RPL && RPL_CONF_STATS
+static const char *const rpl_fields[] = {
+  "mem_overflows", "local_repairs", "global_repairs", "malformed_msgs",
+  "resets", "parent_switch", "forward_errors", "loop_errors",
+  "loop_warnings", "root_repairs", "dis_sent", "dio_sent", "dao_sent",
+  "dao_ack_sent", "dis_recvd", "dio_recvd", "dao_recvd", "dao_ack_recvd"
+};
+static NET_STATS_GROUP(rpl_group, "rpl", rpl_fields,
+                       rpl_stats.mem_overflows, 0);
+
+static const char *const rpl_bytes_fields[] = {
+  "control_bytes_sent"
+};
+static NET_STATS_GROUP(rpl_bytes_group, "rpl", rpl_bytes_fields,
+                       rpl_stats.control_bytes_sent, 0);
+#endif /* UIP_CONF_IPV6_RPL && RPL_CONF_STATS */
+
+#if NETSTACK_CONF_WITH_IPV6
+#if UIP_MCAST6_STATS && defined(UIP_MCAST6_CONF_ENGINE)
+static const char *const mcast6_fields[] = {
+  "in_unique", "in_all", "in_ours", "fwd", "out", "bad", "dropped"
+};
+static NET_STATS_GROUP(mcast6_group, "mcast6", mcast6_fields,
+                       uip_mcast6_stats.mcast_in_unique, 0);
+#endif /* UIP_MCAST6_STATS && defined(UIP_MCAST6_CONF_ENGINE) */
+
+static const char *const ds6_fields[] = {
+  "neighbors", "routes"
+};
+static uint32_t
+ds6_get(uint8_t field)
+{
+  return field == 0 ? uip_ds6_nbr_num() : uip_ds6_route_num_routes();
+}
+static NET_STATS_GAUGES(ds6_group, "ds6", ds6_fields, ds6_get);
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+/*---------------------------------------------------------------------------*/
+void
+net_stats_init(void)
+{
+  list_init(groups);
+#if UIP_STATISTICS == 1
+  net_stats_register(&ip_group);
+  net_stats_register(&icmp_group);
+#if UIP_TCP
+  net_stats_register(&tcp_group);
+#endif /* UIP_TCP */
+#if UIP_UDP
+  net_stats_register(&udp_group);
+#endif /* UIP_UDP */
+#if NETSTACK_CONF_WITH_IPV6
+  net_stats_register(&nd6_group);
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+#endif /* UIP_STATISTICS == 1 */
+#if RIMESTATS_CONF_ENABLED
+  net_stats_register(&rime_group);
+#endif /* RIMESTATS_CONF_ENABLED */
+#if UIP_CONF_IPV6_RPL && RPL_CONF_STATS
+  net_stats_register(&rpl_group);
+  net_stats_register(&rpl_bytes_group);
+#endif /* UIP_CONF_IPV6_RPL && RPL_CONF_STATS */
+#if NETSTACK_CONF_WITH_IPV6
+#if UIP_MCAST6_STATS && defined(UIP_MCAST6_CONF_ENGINE)
+  net_stats_register(&mcast6_group);
+#endif /* UIP_MCAST6_STATS && defined(UIP_MCAST6_CONF_ENGINE) */
+  net_stats_register(&ds6_group);
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+}
+/*---------------------------------------------------------------------------*/
+void
+net_stats_register(struct net_stats_group *g)
+{
+  list_add(groups, g);
+}
+/*---------------------------------------------------------------------------*/
+struct net_stats_group *
+net_stats_groups(void)
+{
+  return list_head(groups);
+}
+/*---------------------------------------------------------------------------*/
+int
+net_stats_count(void)
+{
+  struct net_stats_group *g;
+  int count = 0;
+
+  for(g = list_head(groups); g != NULL; g = g->next) {
+    count += g->count;
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+net_stats_value(const struct net_stats_group *g, uint8_t field)
+{
+  const uint8_t *p;
+
+  if(g->values == NULL) {
+    return g->get(field);
+  }
+  p = (const uint8_t *)g->values + field * g->size;
+  switch(g->size) {
+  case 1:
+    return *p;
+  case 2:
+    return *(const uint16_t *)p;
+  case 4:
+    return *(const uint32_t *)p;
+  case 8:
+    /* Counters of type unsigned long on 64-bit hosts */
+    return (uint32_t)*(const uint64_t *)p;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+net_stats_snapshot(uint8_t *buf, int size, int offset)
+{
+  struct net_stats_group *g;
+  uint32_t value;
+  int pos = 0;
+  int len = 0;
+  int i;
+  int b;
+
+  for(g = list_head(groups); g != NULL && len < size; g = g->next) {
+    if(pos + g->count * 4 <= offset) {
+      pos += g->count * 4;
+      continue;
+    }
+    for(i = 0; i < g->count && len < size; i++) {
+      value = net_stats_value(g, i);
+      for(b = 3; b >= 0 && len < size; b--, pos++) {
+        if(pos >= offset) {
+          buf[len++] = value >> (b * 8);
+        }
+      }
+    }
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+net_stats_delta(uint8_t *buf, int size)
+{
+  struct net_stats_group *g;
+  uint8_t encoded[6];
+  uint32_t value;
+  uint32_t change;
+  int index = 0;
+  int len = 0;
+  int n;
+  int i;
+
+  for(g = list_head(groups); g != NULL; g = g->next) {
+    for(i = 0; i < g->count && index < NET_STATS_DELTA_MAX; i++, index++) {
+      value = net_stats_value(g, i);
+      if(value == last[index]) {
+        continue;
+      }
+      if(g->flags & NET_STATS_GAUGE) {
+        change = value;
+      } else {
+        /* Counters narrower than 32 bits wrap around */
+        change = value - last[index];
+        if(g->size < 4) {
+          change &= (1UL << (g->size * 8)) - 1;
+        }
+      }
+      n = 0;
+      encoded[n++] = index;
+      while(change >= 0x80) {
+        encoded[n++] = (change & 0x7f) | 0x80;
+        change >>= 7;
+      }
+      encoded[n++] = change;
+      if(len + n > size) {
+        return len;
+      }
+      memcpy(buf + len, encoded, n);
+      len += n;
+      last[index] = value;
+    }
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* NET_STATS_ENABLED */
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A registry of the network stack counters
+ *
+ *         The counters of the stack are kept where they always were, in
+ *         uip_stat, rimestats, rpl_stats and uip_mcast6_stats. With
+ *         NET_STATS_CONF_ENABLED, these are registered at start-up as
+ *         named groups, so that all of them can be read and exported in
+ *         one format. Other modules can register their own groups of
+ *         counters, or of gauges read through a function.
+ *
+ *         A snapshot holds every value as a 32-bit big-endian number,
+ *         in registration order. The names, one "group.field" per line
+ *         in the same order, are fetched once to decode snapshots. A
+ *         delta update holds only the values that changed since the
+ *         previous update, each as a one-byte index followed by the
+ *         increase, or the value of a gauge, in 7-bit groups, least
+ *         significant first, with the top bit set on all but the last.
+ */
+
+#ifndef NET_STATS_H_
+#define NET_STATS_H_
+
+#include "contiki-conf.h"
+#include <stdint.h>
+
+#ifdef NET_STATS_CONF_ENABLED
+#define NET_STATS_ENABLED NET_STATS_CONF_ENABLED
+#else
+#define NET_STATS_ENABLED 0
+#endif
+
+/* The number of values that take part in delta updates, at four bytes
+   of RAM each. Values registered beyond this are only in snapshots. */
+#ifdef NET_STATS_CONF_DELTA_MAX
+#define NET_STATS_DELTA_MAX NET_STATS_CONF_DELTA_MAX
+#else
+#define NET_STATS_DELTA_MAX 64
+#endif
+
+/* The values of the group are levels rather than running counts */
+#define NET_STATS_GAUGE 0x01
+
+struct net_stats_group {
+  struct net_stats_group *next;
+  const char *name;
+  const char *const *fields;
+  /* An array of count values of size bytes, or NULL to use get() */
+  const void *values;
+  uint32_t (*get)(uint8_t field);
+  uint8_t size;
+  uint8_t count;
+  uint8_t flags;
+};
+
+/**
+ * Declare a group of counters that are consecutive variables of the
+ * same type, such as the fields of a statistics struct, starting with
+ * first. There is one value for each name in the array fields.
+ */
+#define NET_STATS_GROUP(var, name, fields, first, flags)                \
+  struct net_stats_group var = { NULL, name, fields, &(first), NULL,    \
+                                 sizeof(first),                         \
+                                 sizeof(fields) / sizeof(fields[0]),    \
+                                 flags }
+
+/**
+ * Declare a group of gauges that are read through the function get,
+ * which is given the index of the field in the array fields.
+ */
+#define NET_STATS_GAUGES(var, name, fields, get)                        \
+  struct net_stats_group var = { NULL, name, fields, NULL, get,         \
+                                 sizeof(uint32_t),                      \
+                                 sizeof(fields) / sizeof(fields[0]),    \
+                                 NET_STATS_GAUGE }
+
+#if NET_STATS_ENABLED
+
+/** Register the counters of the stack. Called by netstack_init(). */
+void net_stats_init(void);
+
+/** Add a group at the end of the registry. */
+void net_stats_register(struct net_stats_group *g);
+
+/** The first registered group, followed by g->next. */
+struct net_stats_group *net_stats_groups(void);
+
+/** The number of registered values. */
+int net_stats_count(void);
+
+/** Read one value of a group. */
+uint32_t net_stats_value(const struct net_stats_group *g, uint8_t field);
+
+/**
+ * Write the part of the snapshot from byte offset that fits in size
+ * bytes. Returns the number of bytes written. The full snapshot is
+ * 4 * net_stats_count() bytes.
+ */
+int net_stats_snapshot(uint8_t *buf, int size, int offset);
+
+/**
+ * Write a delta update of at most size bytes. Returns the number of
+ * bytes written. Changes that do not fit are in the next update.
+ */
+int net_stats_delta(uint8_t *buf, int size);
+
+#define NET_STATS_REGISTER(g) net_stats_register(g)
+
+#else /* NET_STATS_ENABLED */
+
+#define NET_STATS_REGISTER(g)
+
+#endif /* NET_STATS_ENABLED */
+
+#endif /* NET_STATS_H_ */
@@ -38,14 +38,25 @@
  */
 
 #include "net/netstack.h"
+#include "net/net-stats.h"
+#include "net/link-stats.h"
+#include "sys/boot-profile.h"
 /*---------------------------------------------------------------------------*/
 void
 netstack_init(void)
 {
+  BOOT_PROFILE_MARK(BOOT_PROFILE_PLATFORM);
   NETSTACK_RADIO.init();
   NETSTACK_RDC.init();
   NETSTACK_LLSEC.init();
   NETSTACK_MAC.init();
   NETSTACK_NETWORK.init();
+#if LINK_STATS_ENABLED
+  link_stats_init();
+#endif /* LINK_STATS_ENABLED */
+#if NET_STATS_ENABLED
+  net_stats_init();
+#endif /* NET_STATS_ENABLED */
+  BOOT_PROFILE_MARK(BOOT_PROFILE_NETSTACK);
 }
 /*---------------------------------------------------------------------------*/
@@ -124,6 +124,8 @@ struct network_driver {
   void (* input)(void);
 };
 
+/* The drivers must be defined const, so that a build with LTO=1 can
+   turn the calls through them into direct calls */
 extern const struct network_driver NETSTACK_NETWORK;
 extern const struct llsec_driver   NETSTACK_LLSEC;
 extern const struct rdc_driver     NETSTACK_RDC;
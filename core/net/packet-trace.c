@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-packet latency tracing through the network stack
+ */
+
+#include "net/packet-trace.h"
+
+#if PACKET_TRACE_ENABLED
+
+#include "net/linkaddr.h"
+#include "lib/crc16.h"
+#include <stdio.h>
+
+#if NETSTACK_CONF_WITH_IPV6
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-icmp6.h"
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+
+/* The number of upper-layer header bytes that go into a trace ID:
+   ports, length and checksum of UDP, ports and sequence number of TCP,
+   or type, checksum, identifier and sequence number of an echo. */
+#define TRACE_HDR_LEN 8
+
+uint16_t packet_trace_id;
+
+static struct packet_trace_record records[PACKET_TRACE_SIZE];
+static uint16_t first;
+static uint16_t count;
+static uint16_t lost;
+
+static rtimer_clock_t mac_input_time;
+static uint8_t mac_input_valid;
+
+static const char *stage_names[] = {
+  "ip-out", "6lo-out", "mac-queue", "mac-tx", "mac-done", "mac-in", "ip-in"
+};
+/*---------------------------------------------------------------------------*/
+static void
+add(uint16_t id, uint8_t stage, uint8_t info, rtimer_clock_t time)
+{
+  struct packet_trace_record *r;
+
+  if(id == 0) {
+    return;
+  }
+  if(count == PACKET_TRACE_SIZE) {
+    first = (first + 1) % PACKET_TRACE_SIZE;
+    count--;
+    lost++;
+  }
+  r = &records[(first + count) % PACKET_TRACE_SIZE];
+  r->time = time;
+  r->id = id;
+  r->stage = stage;
+  r->info = info;
+  count++;
+}
+/*---------------------------------------------------------------------------*/
+void
+packet_trace_record(uint16_t id, uint8_t stage, uint8_t info)
+{
+  add(id, stage, info, RTIMER_NOW());
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+packet_trace_uip_id(void)
+{
+#if NETSTACK_CONF_WITH_IPV6
+  uint8_t proto;
+  uint16_t offset;
+  uint16_t len;
+  uint16_t id;
+
+  if(uip_len < UIP_IPH_LEN) {
+    return 0;
+  }
+
+  /* Skip the extension headers, which routers may add or change */
+  proto = UIP_IP_BUF->proto;
+  offset = UIP_LLH_LEN + UIP_IPH_LEN;
+  while(offset + 2 <= UIP_LLH_LEN + uip_len) {
+    if(proto == UIP_PROTO_HBHO || proto == UIP_PROTO_ROUTING ||
+       proto == UIP_PROTO_DESTO) {
+      proto = uip_buf[offset];
+      offset += (uip_buf[offset + 1] + 1) * 8;
+    } else if(proto == UIP_PROTO_FRAG) {
+      proto = uip_buf[offset];
+      offset += 8;
+    } else {
+      break;
+    }
+  }
+  if(offset >= UIP_LLH_LEN + uip_len) {
+    return 0;
+  }
+
+  /* Leave out control traffic such as ND and RPL */
+  if(proto == UIP_PROTO_ICMP6 &&
+     uip_buf[offset] != ICMP6_ECHO_REQUEST &&
+     uip_buf[offset] != ICMP6_ECHO_REPLY) {
+    return 0;
+  }
+
+  len = UIP_LLH_LEN + uip_len - offset;
+  if(len > TRACE_HDR_LEN) {
+    len = TRACE_HDR_LEN;
+  }
+  id = crc16_data((uint8_t *)&UIP_IP_BUF->srcipaddr,
+                  sizeof(uip_ipaddr_t) * 2, 0);
+  id = crc16_data(&proto, 1, id);
+  id = crc16_data(&uip_buf[offset], len, id);
+
+  /* Zero stands for an untraced packet */
+  return id == 0 ? 1 : id;
+#else /* NETSTACK_CONF_WITH_IPV6 */
+  return 0;
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+}
+/*---------------------------------------------------------------------------*/
+void
+packet_trace_mac_input(void)
+{
+  mac_input_time = RTIMER_NOW();
+  mac_input_valid = 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+packet_trace_ip_input(void)
+{
+  uint16_t id;
+
+  id = packet_trace_uip_id();
+  if(mac_input_valid) {
+    add(id, PACKET_TRACE_MAC_IN, 0, mac_input_time);
+    mac_input_valid = 0;
+  }
+  add(id, PACKET_TRACE_IP_IN, 0, RTIMER_NOW());
+}
+/*---------------------------------------------------------------------------*/
+int
+packet_trace_read(struct packet_trace_record *record)
+{
+  if(count == 0) {
+    return 0;
+  }
+  *record = records[first];
+  first = (first + 1) % PACKET_TRACE_SIZE;
+  count--;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+packet_trace_print(void)
+{
+  struct packet_trace_record r;
+  unsigned node;
+
+  node = (linkaddr_node_addr.u8[LINKADDR_SIZE - 2] << 8) |
+    linkaddr_node_addr.u8[LINKADDR_SIZE - 1];
+
+  printf("PT %04x rate %lu lost %u\n", node,
+         (unsigned long)RTIMER_SECOND, lost);
+  lost = 0;
+  while(packet_trace_read(&r)) {
+    printf("PT %04x %04x %s %lu %u\n", node, r.id, stage_names[r.stage],
+           (unsigned long)r.time, r.info);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* PACKET_TRACE_ENABLED */
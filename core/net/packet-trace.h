@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-packet latency tracing through the network stack
+ *
+ *         Outgoing IPv6 packets get a trace ID, derived from their
+ *         addresses and upper-layer header so that every hop computes
+ *         the same ID without changing the frames sent. The ID follows
+ *         the packet down the stack in PACKETBUF_ATTR_TRACE_ID, and each
+ *         layer records a timestamp for it in a ring buffer, which is
+ *         read out by packet_trace_print(). tools/packet-trace turns the
+ *         output of one or more nodes into per-packet and per-hop latency
+ *         breakdowns.
+ */
+
+#ifndef PACKET_TRACE_H_
+#define PACKET_TRACE_H_
+
+#include "contiki-conf.h"
+#include "sys/rtimer.h"
+#include "net/packetbuf.h"
+
+#ifdef PACKET_TRACE_CONF_ENABLED
+#define PACKET_TRACE_ENABLED PACKET_TRACE_CONF_ENABLED
+#else
+#define PACKET_TRACE_ENABLED 0
+#endif
+
+/* The number of records kept. When full, the oldest record is dropped */
+#ifdef PACKET_TRACE_CONF_SIZE
+#define PACKET_TRACE_SIZE PACKET_TRACE_CONF_SIZE
+#else
+#define PACKET_TRACE_SIZE 32
+#endif
+
+/* The points in the stack where a packet is timestamped */
+enum {
+  PACKET_TRACE_IP_OUT,      /* Handed to tcpip_ipv6_output() */
+  PACKET_TRACE_LOWPAN_OUT,  /* Handed to the 6LoWPAN layer */
+  PACKET_TRACE_MAC_QUEUE,   /* Queued by the MAC, info: queue length */
+  PACKET_TRACE_MAC_TX,      /* Handed to the RDC, info: transmission number */
+  PACKET_TRACE_MAC_DONE,    /* Done by the RDC, info: MAC_TX status */
+  PACKET_TRACE_MAC_IN,      /* Last frame received by the MAC */
+  PACKET_TRACE_IP_IN,       /* Handed to the IP layer */
+  PACKET_TRACE_STAGES
+};
+
+struct packet_trace_record {
+  rtimer_clock_t time;
+  uint16_t id;
+  uint8_t stage;
+  uint8_t info;
+};
+
+#if PACKET_TRACE_ENABLED
+
+/* The ID of the packet being sent, which packetbuf_clear() copies to
+   PACKETBUF_ATTR_TRACE_ID. Zero when no traced packet is being sent. */
+extern uint16_t packet_trace_id;
+
+void packet_trace_record(uint16_t id, uint8_t stage, uint8_t info);
+uint16_t packet_trace_uip_id(void);
+void packet_trace_mac_input(void);
+void packet_trace_ip_input(void);
+int packet_trace_read(struct packet_trace_record *record);
+void packet_trace_print(void);
+
+#define PACKET_TRACE(stage, info) \
+  packet_trace_record(packetbuf_attr(PACKETBUF_ATTR_TRACE_ID), (stage), (info))
+#define PACKET_TRACE_QUEUEBUF(buf, stage, info) \
+  packet_trace_record(queuebuf_attr((buf), PACKETBUF_ATTR_TRACE_ID), (stage), (info))
+#define PACKET_TRACE_UIP(stage) \
+  packet_trace_record(packet_trace_uip_id(), (stage), 0)
+
+#else /* PACKET_TRACE_ENABLED */
+
+#define packet_trace_mac_input()
+#define packet_trace_ip_input()
+#define packet_trace_print()
+#define PACKET_TRACE(stage, info)
+#define PACKET_TRACE_QUEUEBUF(buf, stage, info)
+#define PACKET_TRACE_UIP(stage)
+
+#endif /* PACKET_TRACE_ENABLED */
+
+#endif /* PACKET_TRACE_H_ */
@@ -46,7 +46,11 @@
 
 #include "contiki-net.h"
 #include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "lib/memb.h"
 #include "net/rime/rime.h"
+#include "sys/energest.h"
+#include "net/packet-trace.h"
 
 struct packetbuf_attr packetbuf_attrs[PACKETBUF_NUM_ATTRS];
 struct packetbuf_addr packetbuf_addrs[PACKETBUF_NUM_ADDRS];
@@ -55,12 +59,33 @@ struct packetbuf_addr packetbuf_addrs[PACKETBUF_NUM_ADDRS];
 static uint16_t buflen, bufptr;
 static uint8_t hdrptr;
 
+#if PACKETBUF_ZEROCOPY
+struct packetbuf_frame {
+  uint8_t refs;
+  /* The lowest offset that a reference other than the packetbuf's
+     may refer to. */
+  uint16_t shared_off;
+  /* Aligned on an even 32-bit boundary, see below. */
+  uint32_t data[(PACKETBUF_SIZE + PACKETBUF_HDR_SIZE + 3) / 4];
+};
+
+/* The packetbuf starts out in a statically allocated frame. Every
+   queuebuf holds at most one frame, so with one frame more than there
+   are queuebufs, the packetbuf can always get a frame of its own. */
+static struct packetbuf_frame home_frame = { 1 };
+MEMB(packetbuf_frames, struct packetbuf_frame, QUEUEBUF_NUM);
+static uint8_t frames_initialized;
+
+static struct packetbuf_frame *frame = &home_frame;
+static uint8_t *packetbuf = (uint8_t *)home_frame.data;
+#else /* PACKETBUF_ZEROCOPY */
 /* The declarations below ensure that the packet buffer is aligned on
    an even 32-bit boundary. On some platforms (most notably the
    msp430 or OpenRISC), having a potentially misaligned packet buffer may lead to
    problems when accessing words. */
 static uint32_t packetbuf_aligned[(PACKETBUF_SIZE + PACKETBUF_HDR_SIZE + 3) / 4];
 static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
+#endif /* PACKETBUF_ZEROCOPY */
 
 static uint8_t *packetbufptr;
 
@@ -73,14 +98,135 @@ static uint8_t *packetbufptr;
 #endif
 
 /*---------------------------------------------------------------------------*/
-void
-packetbuf_clear(void)
+static void
+reset(void)
 {
   buflen = bufptr = 0;
   hdrptr = PACKETBUF_HDR_SIZE;
 
   packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
   packetbuf_attr_clear();
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+  /* The packet belongs to the subsystem that is creating it. */
+  packetbuf_set_attr(PACKETBUF_ATTR_ENERGEST_SUBSYSTEM,
+                     energest_subsystem_get());
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
+#if PACKET_TRACE_ENABLED
+  packetbuf_set_attr(PACKETBUF_ATTR_TRACE_ID, packet_trace_id);
+#endif /* PACKET_TRACE_ENABLED */
+}
+#if PACKETBUF_ZEROCOPY
+/*---------------------------------------------------------------------------*/
+struct packetbuf_frame *
+packetbuf_frame_alloc(void)
+{
+  struct packetbuf_frame *f;
+
+  if(home_frame.refs == 0) {
+    f = &home_frame;
+  } else {
+    if(!frames_initialized) {
+      memb_init(&packetbuf_frames);
+      frames_initialized = 1;
+    }
+    f = memb_alloc(&packetbuf_frames);
+    if(f == NULL) {
+      return NULL;
+    }
+  }
+  f->refs = 1;
+  f->shared_off = PACKETBUF_HDR_SIZE + PACKETBUF_SIZE;
+  return f;
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_frame_unref(struct packetbuf_frame *f)
+{
+  if(--f->refs == 0 && f != &home_frame) {
+    memb_free(&packetbuf_frames, f);
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint8_t *
+packetbuf_frame_ptr(struct packetbuf_frame *f)
+{
+  return (uint8_t *)f->data;
+}
+/*---------------------------------------------------------------------------*/
+static void
+use_frame(struct packetbuf_frame *f)
+{
+  frame = f;
+  packetbuf = (uint8_t *)f->data;
+  packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+/* Give the packetbuf a frame that no queuebuf refers to. If keep is
+   set, the header and the data are copied to the new frame, with the
+   data consecutive to the header. */
+static int
+own_frame(int keep)
+{
+  struct packetbuf_frame *f;
+  uint8_t *to;
+
+  if(frame->refs == 1) {
+    return 1;
+  }
+  f = packetbuf_frame_alloc();
+  if(f == NULL) {
+    PRINTF("packetbuf: no free frame\n");
+    return 0;
+  }
+  if(keep) {
+    to = (uint8_t *)f->data;
+    memcpy(to + hdrptr, packetbuf + hdrptr, PACKETBUF_HDR_SIZE - hdrptr);
+    memcpy(to + PACKETBUF_HDR_SIZE, packetbufptr + bufptr, buflen);
+    bufptr = 0;
+  }
+  packetbuf_frame_unref(frame);
+  use_frame(f);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+struct packetbuf_frame *
+packetbuf_frame_ref(uint16_t *off, uint16_t *len)
+{
+  if((bufptr > 0 && hdrptr < PACKETBUF_HDR_SIZE) ||
+     PACKETBUF_HDR_SIZE - hdrptr + buflen > PACKETBUF_SIZE) {
+    return NULL;
+  }
+  *off = hdrptr < PACKETBUF_HDR_SIZE ? hdrptr : PACKETBUF_HDR_SIZE + bufptr;
+  *len = PACKETBUF_HDR_SIZE - hdrptr + buflen;
+  frame->refs++;
+  if(*off < frame->shared_off) {
+    frame->shared_off = *off;
+  }
+  return frame;
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_frame_attach(struct packetbuf_frame *f, uint16_t off, uint16_t len)
+{
+  if(off != PACKETBUF_HDR_SIZE) {
+    packetbuf_copyfrom(packetbuf_frame_ptr(f) + off, len);
+    return;
+  }
+  f->refs++;
+  packetbuf_frame_unref(frame);
+  use_frame(f);
+  reset();
+  buflen = len;
+}
+#endif /* PACKETBUF_ZEROCOPY */
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_clear(void)
+{
+#if PACKETBUF_ZEROCOPY
+  own_frame(0);
+#endif /* PACKETBUF_ZEROCOPY */
+  reset();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -107,6 +253,13 @@ packetbuf_compact(void)
   int i, len;
 
   if(bufptr > 0) {
+#if PACKETBUF_ZEROCOPY
+    if(frame->refs > 1) {
+      /* Compact while copying the packet to a frame of its own. */
+      own_frame(1);
+      return;
+    }
+#endif /* PACKETBUF_ZEROCOPY */
     len = packetbuf_datalen() + PACKETBUF_HDR_SIZE;
     for(i = PACKETBUF_HDR_SIZE; i < len; i++) {
       packetbuf[i] = packetbuf[bufptr + i];
@@ -170,6 +323,12 @@ int
 packetbuf_hdralloc(int size)
 {
   if(hdrptr >= size && packetbuf_totlen() + size <= PACKETBUF_SIZE) {
+#if PACKETBUF_ZEROCOPY
+    /* The new header would overwrite bytes that a queuebuf refers to. */
+    if(frame->refs > 1 && hdrptr > frame->shared_off && !own_frame(1)) {
+      return 0;
+    }
+#endif /* PACKETBUF_ZEROCOPY */
     hdrptr -= size;
     return 1;
   }
@@ -267,6 +426,95 @@ packetbuf_attr_copyfrom(struct packetbuf_attr *attrs,
   memcpy(packetbuf_attrs, attrs, sizeof(packetbuf_attrs));
   memcpy(packetbuf_addrs, addrs, sizeof(packetbuf_addrs));
 }
+#if PACKETBUF_PACKED_ATTRS_NUM
+/*---------------------------------------------------------------------------*/
+#define IS_PRESENT(p, type) ((p)->present[(type) / 8] & (1 << ((type) % 8)))
+/*---------------------------------------------------------------------------*/
+int
+packetbuf_attr_pack(struct packetbuf_packed_attrs *p)
+{
+  int i, nattrs, naddrs;
+
+  nattrs = naddrs = 0;
+  for(i = 0; i < PACKETBUF_NUM_ATTRS; ++i) {
+    nattrs += packetbuf_attrs[i].val != 0;
+  }
+  for(i = 0; i < PACKETBUF_NUM_ADDRS; ++i) {
+    naddrs += !linkaddr_cmp(&packetbuf_addrs[i].addr, &linkaddr_null);
+  }
+  if(nattrs > PACKETBUF_PACKED_ATTRS_NUM ||
+     naddrs > PACKETBUF_PACKED_ADDRS_NUM) {
+    PRINTF("packetbuf_attr_pack: %d attributes, %d addresses do not fit\n",
+           nattrs, naddrs);
+    return 0;
+  }
+
+  memset(p->present, 0, sizeof(p->present));
+  nattrs = naddrs = 0;
+  for(i = 0; i < PACKETBUF_NUM_ATTRS; ++i) {
+    if(packetbuf_attrs[i].val != 0) {
+      p->present[i / 8] |= 1 << (i % 8);
+      p->attrs[nattrs++] = packetbuf_attrs[i].val;
+    }
+  }
+  for(i = 0; i < PACKETBUF_NUM_ADDRS; ++i) {
+    if(!linkaddr_cmp(&packetbuf_addrs[i].addr, &linkaddr_null)) {
+      p->present[(PACKETBUF_ADDR_FIRST + i) / 8] |=
+        1 << ((PACKETBUF_ADDR_FIRST + i) % 8);
+      linkaddr_copy(&p->addrs[naddrs++], &packetbuf_addrs[i].addr);
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_attr_unpack(const struct packetbuf_packed_attrs *p)
+{
+  int i, nattrs, naddrs;
+
+  nattrs = naddrs = 0;
+  for(i = 0; i < PACKETBUF_NUM_ATTRS; ++i) {
+    packetbuf_attrs[i].val = IS_PRESENT(p, i) ? p->attrs[nattrs++] : 0;
+  }
+  for(i = 0; i < PACKETBUF_NUM_ADDRS; ++i) {
+    linkaddr_copy(&packetbuf_addrs[i].addr,
+                  IS_PRESENT(p, PACKETBUF_ADDR_FIRST + i) ?
+                  &p->addrs[naddrs++] : &linkaddr_null);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The index of a present attribute among those of its kind. */
+static int
+packed_index(const struct packetbuf_packed_attrs *p, uint8_t first,
+             uint8_t type)
+{
+  int i, n;
+
+  n = 0;
+  for(i = first; i < type; ++i) {
+    n += IS_PRESENT(p, i) != 0;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+packetbuf_attr_t
+packetbuf_packed_attr(const struct packetbuf_packed_attrs *p, uint8_t type)
+{
+  if(!IS_PRESENT(p, type)) {
+    return 0;
+  }
+  return p->attrs[packed_index(p, 0, type)];
+}
+/*---------------------------------------------------------------------------*/
+const linkaddr_t *
+packetbuf_packed_addr(const struct packetbuf_packed_attrs *p, uint8_t type)
+{
+  if(!IS_PRESENT(p, type)) {
+    return &linkaddr_null;
+  }
+  return &p->addrs[packed_index(p, PACKETBUF_ADDR_FIRST, type)];
+}
+#endif /* PACKETBUF_PACKED_ATTRS_NUM */
 /*---------------------------------------------------------------------------*/
 #if !PACKETBUF_CONF_ATTRS_INLINE
 int
@@ -251,6 +251,72 @@ int packetbuf_copyto(void *to);
  */
 int packetbuf_copyto_hdr(uint8_t *to);
 
+/*
+ * With PACKETBUF_CONF_ZEROCOPY, the packetbuf is stored in one of a
+ * pool of reference-counted frames. A queuebuf made from the packetbuf
+ * takes a reference to the packetbuf's frame instead of copying it,
+ * and queuebuf_to_packetbuf() makes the packetbuf refer to the
+ * queuebuf's frame. The packetbuf gets a frame of its own again when
+ * it is cleared, or before packetbuf_compact() or packetbuf_hdralloc()
+ * would overwrite bytes that a queuebuf refers to. A packet that has
+ * been queued must therefore not be modified through
+ * packetbuf_dataptr() before the packetbuf has been cleared, and
+ * queuebufs that are made from the same packet share its bytes.
+ */
+#ifdef PACKETBUF_CONF_ZEROCOPY
+#define PACKETBUF_ZEROCOPY PACKETBUF_CONF_ZEROCOPY
+#else
+#define PACKETBUF_ZEROCOPY 0
+#endif
+
+#if PACKETBUF_ZEROCOPY
+struct packetbuf_frame;
+
+/**
+ * \brief      Take a reference to the frame that holds the packetbuf
+ * \param off  Set to the offset of the packet in the frame
+ * \param len  Set to the length of the packet, header and data
+ * \return     The frame, or NULL if the header and the data of the
+ *             packetbuf are not consecutive
+ *
+ *             The packet at off in the frame is the same as the one
+ *             that packetbuf_copyto() would have copied.
+ */
+struct packetbuf_frame *packetbuf_frame_ref(uint16_t *off, uint16_t *len);
+
+/**
+ * \brief      Allocate a new frame
+ * \return     The frame, with one reference, or NULL
+ */
+struct packetbuf_frame *packetbuf_frame_alloc(void);
+
+/**
+ * \brief      Release a reference to a frame
+ * \param f    The frame
+ */
+void packetbuf_frame_unref(struct packetbuf_frame *f);
+
+/**
+ * \brief      Get a pointer to the bytes of a frame
+ * \param f    The frame
+ * \return     A pointer to (PACKETBUF_SIZE + PACKETBUF_HDR_SIZE) bytes
+ */
+uint8_t *packetbuf_frame_ptr(struct packetbuf_frame *f);
+
+/**
+ * \brief      Make the packetbuf refer to a packet in a frame
+ * \param f    The frame
+ * \param off  The offset of the packet in the frame
+ * \param len  The length of the packet
+ *
+ *             This has the same effect as packetbuf_copyfrom() with
+ *             the packet, but the packet is copied only if it does
+ *             not start where the data of the packetbuf starts.
+ */
+void packetbuf_frame_attach(struct packetbuf_frame *f, uint16_t off,
+                            uint16_t len);
+#endif /* PACKETBUF_ZEROCOPY */
+
 /**
  * \brief      Extend the header of the packetbuf, for outbound packets
  * \param size The number of bytes the header should be extended
@@ -310,6 +376,12 @@ enum {
   PACKETBUF_ATTR_RADIO_TXPOWER,
   PACKETBUF_ATTR_LISTEN_TIME,
   PACKETBUF_ATTR_TRANSMIT_TIME,
+#if ENERGEST_CONF_SUBSYSTEMS
+  PACKETBUF_ATTR_ENERGEST_SUBSYSTEM,
+#endif /* ENERGEST_CONF_SUBSYSTEMS */
+#if PACKET_TRACE_CONF_ENABLED
+  PACKETBUF_ATTR_TRACE_ID,
+#endif /* PACKET_TRACE_CONF_ENABLED */
   PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
   PACKETBUF_ATTR_MAC_SEQNO,
   PACKETBUF_ATTR_MAC_ACK,
@@ -461,6 +533,42 @@ void              packetbuf_attr_copyto(struct packetbuf_attr *attrs,
 void              packetbuf_attr_copyfrom(struct packetbuf_attr *attrs,
 					struct packetbuf_addr *addrs);
 
+/*
+ * With PACKETBUF_CONF_PACKED_ATTRS_NUM, the attributes can be stored
+ * in a packed form that only holds the attributes that are non-zero
+ * and the addresses that are not linkaddr_null, with a bitmap of
+ * which ones are present. Up to PACKETBUF_CONF_PACKED_ATTRS_NUM
+ * attributes and PACKETBUF_CONF_PACKED_ADDRS_NUM addresses fit. The
+ * queuebufs store their attributes this way.
+ */
+#ifdef PACKETBUF_CONF_PACKED_ATTRS_NUM
+#define PACKETBUF_PACKED_ATTRS_NUM PACKETBUF_CONF_PACKED_ATTRS_NUM
+#else
+#define PACKETBUF_PACKED_ATTRS_NUM 0
+#endif
+
+#ifdef PACKETBUF_CONF_PACKED_ADDRS_NUM
+#define PACKETBUF_PACKED_ADDRS_NUM PACKETBUF_CONF_PACKED_ADDRS_NUM
+#else
+#define PACKETBUF_PACKED_ADDRS_NUM 2
+#endif
+
+#if PACKETBUF_PACKED_ATTRS_NUM
+struct packetbuf_packed_attrs {
+  uint8_t present[(PACKETBUF_ATTR_MAX + 7) / 8];
+  packetbuf_attr_t attrs[PACKETBUF_PACKED_ATTRS_NUM];
+  linkaddr_t addrs[PACKETBUF_PACKED_ADDRS_NUM];
+};
+
+/* Returns zero, and leaves p as it was, if the attributes do not fit. */
+int               packetbuf_attr_pack(struct packetbuf_packed_attrs *p);
+void              packetbuf_attr_unpack(const struct packetbuf_packed_attrs *p);
+packetbuf_attr_t  packetbuf_packed_attr(const struct packetbuf_packed_attrs *p,
+                                        uint8_t type);
+const linkaddr_t *packetbuf_packed_addr(const struct packetbuf_packed_attrs *p,
+                                        uint8_t type);
+#endif /* PACKETBUF_PACKED_ATTRS_NUM */
+
 #define PACKETBUF_ATTRIBUTES(...) { __VA_ARGS__ PACKETBUF_ATTR_LAST }
 #define PACKETBUF_ATTR_LAST { PACKETBUF_ATTR_NONE, 0 }
 
@@ -72,13 +72,44 @@ struct queuebuf {
 
 /* The actual queuebuf data */
 struct queuebuf_data {
+  uint16_t len;
+#if PACKETBUF_PACKED_ATTRS_NUM
+  struct packetbuf_packed_attrs attrs;
+#else /* PACKETBUF_PACKED_ATTRS_NUM */
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+#endif /* PACKETBUF_PACKED_ATTRS_NUM */
+#if PACKETBUF_ZEROCOPY
+  /* The packet is len bytes at offset off in a packetbuf frame. */
+  struct packetbuf_frame *frame;
+  uint16_t off;
+#else /* PACKETBUF_ZEROCOPY */
   uint8_t data[PACKETBUF_SIZE];
+#endif /* PACKETBUF_ZEROCOPY */
+};
+
+#if QUEUEBUF_SMALL_NUM > 0
+/* The data of a small queuebuf. It is accessed as a struct
+   queuebuf_data, of which it is a shorter version. */
+struct queuebuf_small_data {
   uint16_t len;
+#if PACKETBUF_PACKED_ATTRS_NUM
+  struct packetbuf_packed_attrs attrs;
+#else /* PACKETBUF_PACKED_ATTRS_NUM */
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+#endif /* PACKETBUF_PACKED_ATTRS_NUM */
+  uint8_t data[QUEUEBUF_SMALL_SIZE];
 };
 
-MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
+MEMB(bufsmallmem, struct queuebuf_small_data, QUEUEBUF_SMALL_NUM);
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+
+#if PACKETBUF_ZEROCOPY && WITH_SWAP
+#error "PACKETBUF_CONF_ZEROCOPY cannot be used with queuebuf swapping"
+#endif /* PACKETBUF_ZEROCOPY && WITH_SWAP */
+
+MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM + QUEUEBUF_SMALL_NUM);
 MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
 
 #if WITH_SWAP
@@ -111,6 +142,12 @@ static struct ctimer renew_timer;
 
 #endif
 
+#if MEMB_FAILURE_TRACE
+#define TRACE_FAILURE() memb_trace_failure("queuebuf", MEMB_CALLER())
+#else /* MEMB_FAILURE_TRACE */
+#define TRACE_FAILURE()
+#endif /* MEMB_FAILURE_TRACE */
+
 #if QUEUEBUF_DEBUG
 #include "lib/list.h"
 LIST(queuebuf_list);
@@ -124,14 +161,9 @@ LIST(queuebuf_list);
 #define PRINTF(...)
 #endif
 
-#ifdef QUEUEBUF_CONF_STATS
-#define QUEUEBUF_STATS QUEUEBUF_CONF_STATS
-#else
-#define QUEUEBUF_STATS 0
-#endif /* QUEUEBUF_CONF_STATS */
-
 #if QUEUEBUF_STATS
 uint8_t queuebuf_len, queuebuf_max_len;
+static struct queuebuf_pool_stats pool_stats[QUEUEBUF_NUM_POOLS];
 #endif /* QUEUEBUF_STATS */
 
 #if WITH_SWAP
@@ -275,6 +307,102 @@ queuebuf_load_to_ram(struct queuebuf *b)
   return b->ram_ptr;
 }
 #endif /* WITH_SWAP */
+#if PACKETBUF_ZEROCOPY
+/*---------------------------------------------------------------------------*/
+/* Refer to the packetbuf's frame, or copy the packetbuf to a new frame
+   if its header and data are not consecutive. */
+static int
+queuebuf_frame_from_packetbuf(struct queuebuf_data *d)
+{
+  d->frame = packetbuf_frame_ref(&d->off, &d->len);
+  if(d->frame == NULL) {
+    d->frame = packetbuf_frame_alloc();
+    if(d->frame == NULL) {
+      return 0;
+    }
+    d->off = PACKETBUF_HDR_SIZE;
+    d->len = packetbuf_copyto(packetbuf_frame_ptr(d->frame) + d->off);
+  }
+  return 1;
+}
+#endif /* PACKETBUF_ZEROCOPY */
+/*---------------------------------------------------------------------------*/
+static int
+queuebuf_attrs_from_packetbuf(struct queuebuf_data *d)
+{
+#if PACKETBUF_PACKED_ATTRS_NUM
+  return packetbuf_attr_pack(&d->attrs);
+#else /* PACKETBUF_PACKED_ATTRS_NUM */
+  packetbuf_attr_copyto(d->attrs, d->addrs);
+  return 1;
+#endif /* PACKETBUF_PACKED_ATTRS_NUM */
+}
+/*---------------------------------------------------------------------------*/
+/* Allocate RAM for the data of a queuebuf that is to hold len bytes,
+   from the small pool if the data fits there. */
+static struct queuebuf_data *
+queuebuf_data_alloc(uint16_t len)
+{
+#if QUEUEBUF_SMALL_NUM > 0
+  struct queuebuf_data *d;
+
+  if(len <= QUEUEBUF_SMALL_SIZE) {
+    d = memb_alloc(&bufsmallmem);
+    if(d != NULL) {
+      return d;
+    }
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+  return memb_alloc(&buframmem);
+}
+/*---------------------------------------------------------------------------*/
+static void
+queuebuf_data_free(struct queuebuf_data *d)
+{
+#if QUEUEBUF_SMALL_NUM > 0
+  if(memb_inmemb(&bufsmallmem, d)) {
+    memb_free(&bufsmallmem, d);
+    return;
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+  memb_free(&buframmem, d);
+}
+#if QUEUEBUF_SMALL_NUM > 0 || QUEUEBUF_STATS
+/*---------------------------------------------------------------------------*/
+static uint16_t
+queuebuf_data_size(struct queuebuf *b)
+{
+#if QUEUEBUF_SMALL_NUM > 0
+#if WITH_SWAP
+  if(b->location == IN_RAM && memb_inmemb(&bufsmallmem, b->ram_ptr)) {
+#else /* WITH_SWAP */
+  if(memb_inmemb(&bufsmallmem, b->ram_ptr)) {
+#endif /* WITH_SWAP */
+    return QUEUEBUF_SMALL_SIZE;
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+  return PACKETBUF_SIZE;
+}
+#endif /* QUEUEBUF_SMALL_NUM > 0 || QUEUEBUF_STATS */
+#if QUEUEBUF_STATS
+/*---------------------------------------------------------------------------*/
+static struct queuebuf_pool_stats *
+pool_stats_of(struct queuebuf *b)
+{
+  return &pool_stats[queuebuf_data_size(b) == PACKETBUF_SIZE ?
+                     QUEUEBUF_POOL_FULL : QUEUEBUF_POOL_SMALL];
+}
+/*---------------------------------------------------------------------------*/
+int
+queuebuf_pool_stats(int pool, struct queuebuf_pool_stats *stats)
+{
+  if(pool < 0 || pool >= QUEUEBUF_NUM_POOLS) {
+    return 0;
+  }
+  *stats = pool_stats[pool];
+  return 1;
+}
+#endif /* QUEUEBUF_STATS */
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_init(void)
@@ -288,15 +416,30 @@ queuebuf_init(void)
 #endif
   memb_init(&buframmem);
   memb_init(&bufmem);
+#if QUEUEBUF_SMALL_NUM > 0
+  memb_init(&bufsmallmem);
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 #if QUEUEBUF_STATS
   queuebuf_max_len = 0;
+  memset(pool_stats, 0, sizeof(pool_stats));
+  pool_stats[QUEUEBUF_POOL_FULL].size = PACKETBUF_SIZE;
+  pool_stats[QUEUEBUF_POOL_FULL].num = QUEUEBUF_NUM;
+#if QUEUEBUF_SMALL_NUM > 0
+  pool_stats[QUEUEBUF_POOL_SMALL].size = QUEUEBUF_SMALL_SIZE;
+  pool_stats[QUEUEBUF_POOL_SMALL].num = QUEUEBUF_SMALL_NUM;
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 #endif /* QUEUEBUF_STATS */
 }
 /*---------------------------------------------------------------------------*/
 int
 queuebuf_numfree(void)
 {
+#if QUEUEBUF_SMALL_NUM > 0
+  /* Only count the queuebufs that can hold a full packet. */
+  return memb_numfree(&bufmem) - memb_numfree(&bufsmallmem);
+#else /* QUEUEBUF_SMALL_NUM > 0 */
   return memb_numfree(&bufmem);
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 }
 /*---------------------------------------------------------------------------*/
 #if QUEUEBUF_DEBUG
@@ -318,7 +461,7 @@ queuebuf_new_from_packetbuf(void)
     buf->line = line;
     buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
-    buf->ram_ptr = memb_alloc(&buframmem);
+    buf->ram_ptr = queuebuf_data_alloc(packetbuf_totlen());
 #if WITH_SWAP
     /* If the allocation failed, store the qbuf in swap files */
     if(buf->ram_ptr != NULL) {
@@ -334,20 +477,50 @@ queuebuf_new_from_packetbuf(void)
     if(buf->ram_ptr == NULL) {
       PRINTF("queuebuf_new_from_packetbuf: could not queuebuf data\n");
       memb_free(&bufmem, buf);
+#if QUEUEBUF_STATS
+      pool_stats[QUEUEBUF_POOL_FULL].failures++;
+#endif /* QUEUEBUF_STATS */
+      TRACE_FAILURE();
       return NULL;
     }
     buframptr = buf->ram_ptr;
 #endif
 
+    if(!queuebuf_attrs_from_packetbuf(buframptr)) {
+      PRINTF("queuebuf_new_from_packetbuf: too many attributes\n");
+#if WITH_SWAP
+      if(buf->location == IN_RAM) {
+        queuebuf_data_free(buf->ram_ptr);
+      } else {
+        tmpdata_qbuf = NULL;
+      }
+#else /* WITH_SWAP */
+      queuebuf_data_free(buframptr);
+#endif /* WITH_SWAP */
+      memb_free(&bufmem, buf);
+      TRACE_FAILURE();
+      return NULL;
+    }
+
+#if PACKETBUF_ZEROCOPY
+    if(!queuebuf_frame_from_packetbuf(buframptr)) {
+      PRINTF("queuebuf_new_from_packetbuf: could not allocate a frame\n");
+      memb_free(&buframmem, buframptr);
+      memb_free(&bufmem, buf);
+      TRACE_FAILURE();
+      return NULL;
+    }
+#else /* PACKETBUF_ZEROCOPY */
     buframptr->len = packetbuf_copyto(buframptr->data);
-    packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+#endif /* PACKETBUF_ZEROCOPY */
 
 #if WITH_SWAP
     if(buf->location == IN_CFS) {
       if(queuebuf_flush_tmpdata() == -1) {
         /* We were unable to write the data in the swap */
         memb_free(&bufmem, buf);
-        return NULL;
+        TRACE_FAILURE();
+      return NULL;
       }
     }
 #endif
@@ -358,10 +531,20 @@ queuebuf_new_from_packetbuf(void)
     if(queuebuf_len > queuebuf_max_len) {
       queuebuf_max_len = queuebuf_len;
     }
+    {
+      struct queuebuf_pool_stats *ps = pool_stats_of(buf);
+      if(++ps->used > ps->max_used) {
+        ps->max_used = ps->used;
+      }
+    }
 #endif /* QUEUEBUF_STATS */
 
   } else {
     PRINTF("queuebuf_new_from_packetbuf: could not allocate a queuebuf\n");
+    TRACE_FAILURE();
+#if QUEUEBUF_STATS
+    pool_stats[QUEUEBUF_POOL_FULL].failures++;
+#endif /* QUEUEBUF_STATS */
   }
   return buf;
 }
@@ -370,7 +553,8 @@ void
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
-  packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+  /* The old attributes are kept if the new ones do not fit. */
+  queuebuf_attrs_from_packetbuf(buframptr);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
@@ -378,31 +562,67 @@ queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 #endif
 }
 /*---------------------------------------------------------------------------*/
-void
+int
 queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
-  packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_SMALL_NUM > 0
+  if(packetbuf_totlen() > queuebuf_data_size(buf)) {
+    /* The packet has outgrown its small queuebuf. */
+    buframptr = memb_alloc(&buframmem);
+    if(buframptr == NULL) {
+      return 0;
+    }
+    memcpy(buframptr, buf->ram_ptr, sizeof(struct queuebuf_small_data));
+    queuebuf_data_free(buf->ram_ptr);
+    buf->ram_ptr = buframptr;
+#if QUEUEBUF_STATS
+    pool_stats[QUEUEBUF_POOL_SMALL].used--;
+    if(++pool_stats[QUEUEBUF_POOL_FULL].used >
+       pool_stats[QUEUEBUF_POOL_FULL].max_used) {
+      pool_stats[QUEUEBUF_POOL_FULL].max_used =
+        pool_stats[QUEUEBUF_POOL_FULL].used;
+    }
+#endif /* QUEUEBUF_STATS */
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+  buframptr = queuebuf_load_to_ram(buf);
+  if(!queuebuf_attrs_from_packetbuf(buframptr)) {
+    return 0;
+  }
+#if PACKETBUF_ZEROCOPY
+  packetbuf_frame_unref(buframptr->frame);
+  /* Does not fail, as the frame that was just released is free. */
+  queuebuf_frame_from_packetbuf(buframptr);
+#else /* PACKETBUF_ZEROCOPY */
   buframptr->len = packetbuf_copyto(buframptr->data);
+#endif /* PACKETBUF_ZEROCOPY */
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
   }
 #endif
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_free(struct queuebuf *buf)
 {
   if(memb_inmemb(&bufmem, buf)) {
+#if QUEUEBUF_STATS
+    pool_stats_of(buf)->used--;
+#endif /* QUEUEBUF_STATS */
 #if WITH_SWAP
     if(buf->location == IN_RAM) {
-      memb_free(&buframmem, buf->ram_ptr);
+      queuebuf_data_free(buf->ram_ptr);
     } else {
       queuebuf_remove_from_file(buf->swap_id);
     }
 #else
-    memb_free(&buframmem, buf->ram_ptr);
+#if PACKETBUF_ZEROCOPY
+    packetbuf_frame_unref(buf->ram_ptr->frame);
+#endif /* PACKETBUF_ZEROCOPY */
+    queuebuf_data_free(buf->ram_ptr);
 #endif
     memb_free(&bufmem, buf);
 #if QUEUEBUF_STATS
@@ -420,8 +640,16 @@ queuebuf_to_packetbuf(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if PACKETBUF_ZEROCOPY
+    packetbuf_frame_attach(buframptr->frame, buframptr->off, buframptr->len);
+#else /* PACKETBUF_ZEROCOPY */
     packetbuf_copyfrom(buframptr->data, buframptr->len);
+#endif /* PACKETBUF_ZEROCOPY */
+#if PACKETBUF_PACKED_ATTRS_NUM
+    packetbuf_attr_unpack(&buframptr->attrs);
+#else /* PACKETBUF_PACKED_ATTRS_NUM */
     packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+#endif /* PACKETBUF_PACKED_ATTRS_NUM */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -430,7 +658,11 @@ queuebuf_dataptr(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if PACKETBUF_ZEROCOPY
+    return packetbuf_frame_ptr(buframptr->frame) + buframptr->off;
+#else /* PACKETBUF_ZEROCOPY */
     return buframptr->data;
+#endif /* PACKETBUF_ZEROCOPY */
   }
   return NULL;
 }
@@ -446,14 +678,22 @@ linkaddr_t *
 queuebuf_addr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if PACKETBUF_PACKED_ATTRS_NUM
+  return (linkaddr_t *)packetbuf_packed_addr(&buframptr->attrs, type);
+#else /* PACKETBUF_PACKED_ATTRS_NUM */
   return &buframptr->addrs[type - PACKETBUF_ADDR_FIRST].addr;
+#endif /* PACKETBUF_PACKED_ATTRS_NUM */
 }
 /*---------------------------------------------------------------------------*/
 packetbuf_attr_t
 queuebuf_attr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if PACKETBUF_PACKED_ATTRS_NUM
+  return packetbuf_packed_attr(&buframptr->attrs, type);
+#else /* PACKETBUF_PACKED_ATTRS_NUM */
   return buframptr->attrs[type].val;
+#endif /* PACKETBUF_PACKED_ATTRS_NUM */
 }
 /*---------------------------------------------------------------------------*/
 void
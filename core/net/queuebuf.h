@@ -79,6 +79,30 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* QUEUEBUF_SMALL_NUM is the number of additional queuebufs that
+   only hold packets of up to QUEUEBUF_SMALL_SIZE bytes, such as
+   acknowledgements and other short frames. Packets that fit are put
+   in a small queuebuf when there is one free. Small queuebufs are
+   always stored in RAM, and are not used with PACKETBUF_CONF_ZEROCOPY,
+   where a queuebuf only refers to a packetbuf frame. */
+#if defined(QUEUEBUF_CONF_SMALL_NUM) && !PACKETBUF_ZEROCOPY
+#define QUEUEBUF_SMALL_NUM QUEUEBUF_CONF_SMALL_NUM
+#else
+#define QUEUEBUF_SMALL_NUM 0
+#endif
+
+#ifdef QUEUEBUF_CONF_SMALL_SIZE
+#define QUEUEBUF_SMALL_SIZE QUEUEBUF_CONF_SMALL_SIZE
+#else
+#define QUEUEBUF_SMALL_SIZE 32
+#endif
+
+#ifdef QUEUEBUF_CONF_STATS
+#define QUEUEBUF_STATS QUEUEBUF_CONF_STATS
+#else
+#define QUEUEBUF_STATS 0
+#endif /* QUEUEBUF_CONF_STATS */
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
@@ -96,7 +120,9 @@ struct queuebuf *queuebuf_new_from_packetbuf_debug(const char *file, int line);
 struct queuebuf *queuebuf_new_from_packetbuf(void);
 #endif /* QUEUEBUF_DEBUG */
 void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
-void queuebuf_update_from_packetbuf(struct queuebuf *b);
+/* Returns zero if the packet or its attributes did not fit, in which
+   case the queuebuf is left as it was. */
+int queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
@@ -109,8 +135,27 @@ packetbuf_attr_t queuebuf_attr(struct queuebuf *b, uint8_t type);
 
 void queuebuf_debug_print(void);
 
+/* The number of free queuebufs that can hold a full-size packet. */
 int queuebuf_numfree(void);
 
+#if QUEUEBUF_STATS
+#define QUEUEBUF_POOL_SMALL 0
+#define QUEUEBUF_POOL_FULL  1
+#define QUEUEBUF_NUM_POOLS  2
+
+struct queuebuf_pool_stats {
+  uint16_t size;       /* The largest packet, zero for an unused pool */
+  uint8_t num;         /* The number of queuebufs */
+  uint8_t used;        /* The number of queuebufs in use */
+  uint8_t max_used;    /* The highest number in use at the same time */
+  uint16_t failures;   /* The number of failed allocations */
+};
+
+/* Get the statistics of a pool of queuebufs. Returns zero if there is
+   no such pool. */
+int queuebuf_pool_stats(int pool, struct queuebuf_pool_stats *stats);
+#endif /* QUEUEBUF_STATS */
+
 #endif /* __QUEUEBUF_H__ */
 
 /** @} */
@@ -84,10 +84,16 @@ static uint8_t recent_packet_ptr;
 /* This is the header of data packets. The header comtains the routing
    metric of the last hop sender. This is used to avoid routing loops:
    if a node receives a packet with a lower routing metric than its
-   own, it drops the packet. */
+   own, it drops the packet. With COLLECT_HOP_TIMING, the header also
+   carries the clock ticks the packet has spent in send queues and on
+   unacknowledged transmissions at the previous hops. */
 struct data_msg_hdr {
   uint8_t flags, dummy;
   uint16_t rtmetric;
+#if COLLECT_HOP_TIMING
+  uint16_t queue_time;
+  uint16_t tx_time;
+#endif /* COLLECT_HOP_TIMING */
 };
 
 
@@ -206,6 +212,7 @@ struct {
   uint32_t ttldrop;
   uint32_t ackdrop;
   uint32_t timedout;
+  uint32_t aggregated;
 } stats;
 
 /* Debug definition: draw routing tree in Cooja. */
@@ -218,6 +225,11 @@ struct {
 #define PRINTF(...)
 #endif
 
+#if COLLECT_HOP_TIMING
+/* The timing of the packet most recently delivered at the sink. */
+static uint16_t last_queue_time, last_tx_time;
+#endif /* COLLECT_HOP_TIMING */
+
 /* Forward declarations. */
 static void send_queued_packet(struct collect_conn *c);
 static void retransmit_callback(void *ptr);
@@ -509,6 +521,73 @@ send_packet(struct collect_conn *c, struct collect_neighbor *n)
   unicast_send(&c->unicast_conn, &n->addr);
 }
 /*---------------------------------------------------------------------------*/
+#if COLLECT_HOP_TIMING
+/**
+ * This function is called just before the packet with the header at
+ * hdrptr is placed on the send queue. The queue_time field of a queued
+ * packet holds the queueing time at earlier hops minus the time the
+ * packet was queued here, so adding the time when the packet is first
+ * sent yields the total.
+ */
+static void
+hop_timing_enqueue(void *hdrptr)
+{
+  struct data_msg_hdr hdr;
+
+  memcpy(&hdr, hdrptr, sizeof(struct data_msg_hdr));
+  hdr.queue_time -= (uint16_t)clock_time();
+  memcpy(hdrptr, &hdr, sizeof(struct data_msg_hdr));
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function is called when the first packet on the send queue,
+ * now in the packetbuf, is sent for the first time. It takes the
+ * timing of the earlier hops from the queued header.
+ */
+static void
+hop_timing_first_send(struct collect_conn *c)
+{
+  struct data_msg_hdr hdr;
+
+  memcpy(&hdr, packetbuf_dataptr(), sizeof(struct data_msg_hdr));
+  c->first_send_time = clock_time();
+  c->queue_time = hdr.queue_time + (uint16_t)c->first_send_time;
+  c->tx_time = hdr.tx_time;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function fills in the timing of an outgoing packet header: the
+ * time spent on earlier transmissions of this packet is added to the
+ * retry time of the earlier hops.
+ */
+static void
+hop_timing_send(struct collect_conn *c, struct data_msg_hdr *hdr)
+{
+  hdr->queue_time = c->queue_time;
+  hdr->tx_time = c->tx_time + (uint16_t)(clock_time() - c->first_send_time);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ticks_to_ms(uint16_t ticks)
+{
+  uint32_t ms = (uint32_t)ticks * 1000 / CLOCK_SECOND;
+
+  return ms > 0xffff ? 0xffff : ms;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+collect_queue_time(void)
+{
+  return ticks_to_ms(last_queue_time);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+collect_tx_time(void)
+{
+  return ticks_to_ms(last_tx_time);
+}
+#endif /* COLLECT_HOP_TIMING */
+/*---------------------------------------------------------------------------*/
 static void
 proactive_probing_callback(void *ptr)
 {
@@ -641,10 +720,17 @@ send_queued_packet(struct collect_conn *c)
 
       stats.datasent++;
 
+#if COLLECT_HOP_TIMING
+      hop_timing_first_send(c);
+#endif /* COLLECT_HOP_TIMING */
+
       /* Copy our rtmetric into the packet header of the outgoing
          packet. */
       memset(&hdr, 0, sizeof(hdr));
       hdr.rtmetric = c->rtmetric;
+#if COLLECT_HOP_TIMING
+      hop_timing_send(c, &hdr);
+#endif /* COLLECT_HOP_TIMING */
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
       /* Send the packet. */
@@ -746,6 +832,9 @@ retransmit_current_packet(struct collect_conn *c)
          packet. */
       memset(&hdr, 0, sizeof(hdr));
       hdr.rtmetric = c->rtmetric;
+#if COLLECT_HOP_TIMING
+      hop_timing_send(c, &hdr);
+#endif /* COLLECT_HOP_TIMING */
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
       /* Send the packet. */
@@ -920,6 +1009,78 @@ add_packet_to_recent_packets(struct collect_conn *tc)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if COLLECT_AGGREGATION
+static uint8_t aggregate_buf[COLLECT_AGGREGATE_MAX_LEN];
+/**
+ * This function tries to merge the data packet in the packetbuf into
+ * the last packet on the send queue, using the aggregate callback of
+ * the connection. The packet currently being sent is never touched.
+ *
+ * Returns 1 if the packet was merged, 0 if it was not and the
+ * packetbuf is unchanged, and -1 if the merged packet could not be
+ * stored, in which case the packetbuf no longer holds the received
+ * data. The packet attributes needed to ACK the received packet are
+ * kept in the packetbuf in all cases.
+ */
+static int
+aggregate_packet(struct collect_conn *tc)
+{
+  struct packetqueue_item *i, *last;
+  struct queuebuf *q;
+  linkaddr_t originator;
+  uint8_t eseqno, seqno;
+  int len, ret;
+
+  if(tc->cb->aggregate == NULL) {
+    return 0;
+  }
+
+  last = NULL;
+  for(i = packetqueue_first(&tc->send_queue); i != NULL;
+      i = list_item_next(i)) {
+    last = i;
+  }
+  if(last == NULL ||
+     (tc->sending && last == packetqueue_first(&tc->send_queue))) {
+    return 0;
+  }
+
+  /* Keepalive and probe packets have no payload to merge into. */
+  q = packetqueue_queuebuf(last);
+  len = queuebuf_datalen(q) - (int)sizeof(struct data_msg_hdr);
+  if(len <= 0 || len > COLLECT_AGGREGATE_MAX_LEN) {
+    return 0;
+  }
+  memcpy(aggregate_buf,
+         (uint8_t *)queuebuf_dataptr(q) + sizeof(struct data_msg_hdr), len);
+  len = tc->cb->aggregate(aggregate_buf, len,
+                          (uint8_t *)packetbuf_dataptr() +
+                          sizeof(struct data_msg_hdr),
+                          packetbuf_datalen() - sizeof(struct data_msg_hdr),
+                          COLLECT_AGGREGATE_MAX_LEN);
+  if(len <= 0 || len > COLLECT_AGGREGATE_MAX_LEN) {
+    return 0;
+  }
+
+  /* Write the merged payload into the queued packet, keeping the
+     attributes of the received packet for its ACK. */
+  linkaddr_copy(&originator, packetbuf_addr(PACKETBUF_ADDR_ESENDER));
+  eseqno = packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID);
+  seqno = packetbuf_attr(PACKETBUF_ATTR_PACKET_ID);
+
+  queuebuf_to_packetbuf(q);
+  memcpy((uint8_t *)packetbuf_dataptr() + sizeof(struct data_msg_hdr),
+         aggregate_buf, len);
+  packetbuf_set_datalen(sizeof(struct data_msg_hdr) + len);
+  ret = queuebuf_update_from_packetbuf(q) ? 1 : -1;
+
+  packetbuf_set_addr(PACKETBUF_ADDR_ESENDER, &originator);
+  packetbuf_set_attr(PACKETBUF_ATTR_EPACKET_ID, eseqno);
+  packetbuf_set_attr(PACKETBUF_ATTR_PACKET_ID, seqno);
+  return ret;
+}
+#endif /* COLLECT_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 static void
 node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
 {
@@ -1021,6 +1182,10 @@ node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
              packetbuf_addr(PACKETBUF_ADDR_ESENDER)->u8[1],
              from->u8[0], from->u8[1]);
 
+#if COLLECT_HOP_TIMING
+      last_queue_time = hdr.queue_time;
+      last_tx_time = hdr.tx_time;
+#endif /* COLLECT_HOP_TIMING */
       packetbuf_hdrreduce(sizeof(struct data_msg_hdr));
       /* Call receive function. */
       if(packetbuf_datalen() > 0 && tc->cb->recv != NULL) {
@@ -1063,6 +1228,25 @@ node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
          memory problems. We first check the size of our sending queue
          to ensure that we always have entries for packets that
          are originated by this node. */
+#if COLLECT_AGGREGATION
+      /* If the packet can be merged into a queued packet, it needs no
+         queue entry of its own. */
+      switch(aggregate_packet(tc)) {
+      case 1:
+        add_packet_to_recent_packets(tc);
+        send_ack(tc, &ack_to, ackflags);
+        stats.aggregated++;
+        return;
+      case -1:
+        send_ack(tc, &ack_to,
+                 ackflags | ACK_FLAGS_DROPPED | ACK_FLAGS_CONGESTED);
+        stats.qdrop++;
+        return;
+      }
+#endif /* COLLECT_AGGREGATION */
+#if COLLECT_HOP_TIMING
+      hop_timing_enqueue(packetbuf_dataptr());
+#endif /* COLLECT_HOP_TIMING */
       if(packetqueue_len(&tc->send_queue) <= MAX_SENDING_QUEUE - MIN_AVAILABLE_QUEUE_ENTRIES &&
          packetqueue_enqueue_packetbuf(&tc->send_queue,
                                        FORWARD_PACKET_LIFETIME_BASE *
@@ -1456,6 +1640,9 @@ collect_send(struct collect_conn *tc, int rexmits)
 
   if(tc->rtmetric == RTMETRIC_SINK) {
     packetbuf_set_attr(PACKETBUF_ATTR_HOPS, 0);
+#if COLLECT_HOP_TIMING
+    last_queue_time = last_tx_time = 0;
+#endif /* COLLECT_HOP_TIMING */
     if(tc->cb->recv != NULL) {
       tc->cb->recv(packetbuf_addr(PACKETBUF_ADDR_ESENDER),
 		   packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
@@ -1466,6 +1653,10 @@ collect_send(struct collect_conn *tc, int rexmits)
 
     /* Allocate space for the header. */
     packetbuf_hdralloc(sizeof(struct data_msg_hdr));
+#if COLLECT_HOP_TIMING
+    memset(packetbuf_hdrptr(), 0, sizeof(struct data_msg_hdr));
+    hop_timing_enqueue(packetbuf_hdrptr());
+#endif /* COLLECT_HOP_TIMING */
 
     if(packetqueue_enqueue_packetbuf(&tc->send_queue,
                                      FORWARD_PACKET_LIFETIME_BASE *
@@ -1547,12 +1738,12 @@ collect_purge(struct collect_conn *tc)
 void
 collect_print_stats(void)
 {
-  PRINTF("collect stats foundroute %lu newparent %lu routelost %lu acksent %lu datasent %lu datarecv %lu ackrecv %lu badack %lu duprecv %lu qdrop %lu rtdrop %lu ttldrop %lu ackdrop %lu timedout %lu\n",
+  PRINTF("collect stats foundroute %lu newparent %lu routelost %lu acksent %lu datasent %lu datarecv %lu ackrecv %lu badack %lu duprecv %lu qdrop %lu rtdrop %lu ttldrop %lu ackdrop %lu timedout %lu aggregated %lu\n",
          stats.foundroute, stats.newparent, stats.routelost,
          stats.acksent, stats.datasent, stats.datarecv,
          stats.ackrecv, stats.badack, stats.duprecv,
          stats.qdrop, stats.rtdrop, stats.ttldrop, stats.ackdrop,
-         stats.timedout);
+         stats.timedout, stats.aggregated);
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -100,9 +100,47 @@
                             { PACKETBUF_ATTR_PACKET_TYPE, PACKETBUF_ATTR_BIT }, \
                             UNICAST_ATTRIBUTES
 
+/* COLLECT_CONF_AGGREGATION enables the aggregate callback, which lets
+   forwarding nodes merge a packet received from a child into a packet
+   that is already waiting on their send queue. */
+#ifdef COLLECT_CONF_AGGREGATION
+#define COLLECT_AGGREGATION COLLECT_CONF_AGGREGATION
+#else /* COLLECT_CONF_AGGREGATION */
+#define COLLECT_AGGREGATION 0
+#endif /* COLLECT_CONF_AGGREGATION */
+
+/* The maximum payload length of a packet produced by aggregation. It
+   must leave room for the lower layer headers in a radio frame. */
+#ifdef COLLECT_CONF_AGGREGATE_MAX_LEN
+#define COLLECT_AGGREGATE_MAX_LEN COLLECT_CONF_AGGREGATE_MAX_LEN
+#else /* COLLECT_CONF_AGGREGATE_MAX_LEN */
+#define COLLECT_AGGREGATE_MAX_LEN 64
+#endif /* COLLECT_CONF_AGGREGATE_MAX_LEN */
+
+/* COLLECT_CONF_HOP_TIMING adds to each data packet the time it has
+   spent in send queues and the time it has spent on link-layer
+   retries along its path. It changes the packet header, so all nodes
+   of a network must agree on it, and on CLOCK_SECOND. */
+#ifdef COLLECT_CONF_HOP_TIMING
+#define COLLECT_HOP_TIMING COLLECT_CONF_HOP_TIMING
+#else /* COLLECT_CONF_HOP_TIMING */
+#define COLLECT_HOP_TIMING 0
+#endif /* COLLECT_CONF_HOP_TIMING */
+
 struct collect_callbacks {
   void (* recv)(const linkaddr_t *originator, uint8_t seqno,
 		uint8_t hops);
+#if COLLECT_AGGREGATION
+  /* Merges the payload in data into the payload of a queued packet,
+     either by appending it as another record or by reducing both to
+     one value (e.g. min, max or average). Returns the new length of
+     the queued payload, at most max_len, or 0 if the payloads cannot
+     be merged and data should be forwarded on its own. The merged
+     packet keeps the originator and sequence number of the queued
+     packet, so the sink must be able to parse merged payloads. */
+  int (* aggregate)(uint8_t *queued, int queued_len,
+                    const uint8_t *data, int data_len, int max_len);
+#endif /* COLLECT_AGGREGATION */
 };
 
 /* COLLECT_CONF_ANNOUNCEMENTS defines if the Collect implementation
@@ -141,6 +179,10 @@ struct collect_conn {
   uint8_t is_router;
 
   clock_time_t send_time;
+#if COLLECT_HOP_TIMING
+  clock_time_t first_send_time;
+  uint16_t queue_time, tx_time;
+#endif /* COLLECT_HOP_TIMING */
 };
 
 enum {
@@ -164,6 +206,15 @@ void collect_set_keepalive(struct collect_conn *c, clock_time_t period);
 
 void collect_print_stats(void);
 
+#if COLLECT_HOP_TIMING
+/* The time, in milliseconds, that the packet passed to the recv
+   callback spent waiting in send queues, and retrying transmissions
+   that were not acknowledged, summed over all hops. Only valid
+   inside the recv callback. */
+uint16_t collect_queue_time(void);
+uint16_t collect_tx_time(void);
+#endif /* COLLECT_HOP_TIMING */
+
 #define COLLECT_MAX_DEPTH (COLLECT_LINK_ESTIMATE_UNIT * 64 - 1)
 
 #endif /* COLLECT_H_ */
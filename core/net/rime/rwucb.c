@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Windowed reliable unicast bulk transfer
+ */
+
+/**
+ * \addtogroup rimerwucb
+ * @{
+ */
+
+#include "net/rime/rwucb.h"
+#include "net/rime/rime.h"
+#include <string.h>
+
+#ifdef RWUCB_CONF_REXMIT_TIME
+#define REXMIT_TIME RWUCB_CONF_REXMIT_TIME
+#else /* RWUCB_CONF_REXMIT_TIME */
+#define REXMIT_TIME CLOCK_SECOND
+#endif /* RWUCB_CONF_REXMIT_TIME */
+
+#define MAX_TRANSMISSIONS 8
+
+#define TYPE_DATA      0
+#define TYPE_DATA_POLL 1
+#define TYPE_ACK       2
+
+#define STATE_IDLE     0
+#define STATE_SENDING  1
+#define STATE_POLLING  2
+
+#define CHUNK_UNKNOWN  0xffff
+
+struct data_hdr {
+  uint8_t type;
+  uint8_t id;
+  uint16_t chunk;
+};
+
+struct ack_hdr {
+  uint8_t type;
+  uint8_t id;
+  uint16_t base;
+  uint32_t bitmap;
+};
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+/*---------------------------------------------------------------------------*/
+/* Returns non-zero if chunk i is in the window and has not been
+   acknowledged yet. */
+static int
+chunk_pending(struct rwucb_conn *c, uint16_t i)
+{
+  uint16_t d = i - c->base;
+
+  if(d >= RWUCB_WINDOW) {
+    return 0;
+  }
+  if(c->last_chunk != CHUNK_UNKNOWN && i > c->last_chunk) {
+    return 0;
+  }
+  return (c->acked & ((uint32_t)1 << d)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_data(struct rwucb_conn *c, uint16_t chunk)
+{
+  int len = 0;
+
+  packetbuf_clear();
+  if(c->u->read_chunk) {
+    len = c->u->read_chunk(c, chunk * RWUCB_DATASIZE,
+                           (char *)packetbuf_dataptr() + sizeof(struct data_hdr),
+                           RWUCB_DATASIZE);
+  }
+  if(len < 0) {
+    len = 0;
+  }
+  packetbuf_set_datalen(sizeof(struct data_hdr) + len);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_next(void *ptr)
+{
+  struct rwucb_conn *c = ptr;
+  struct data_hdr hdr;
+  uint16_t i;
+  int more;
+
+  if(c->state != STATE_SENDING) {
+    return;
+  }
+
+  /* Skip the chunks that already have been acknowledged. */
+  while(c->next - c->base < RWUCB_WINDOW && !chunk_pending(c, c->next)) {
+    c->next++;
+  }
+  if(c->next - c->base >= RWUCB_WINDOW) {
+    /* The whole window was acknowledged while the round ran. Start
+       over from the new window. */
+    c->next = c->base;
+    if(!chunk_pending(c, c->next)) {
+      return;
+    }
+  }
+
+  i = c->next++;
+  if(read_data(c, i) < RWUCB_DATASIZE) {
+    c->last_chunk = i;
+  }
+
+  /* The last chunk of a round asks for an acknowledgement. */
+  more = 0;
+  while(c->next - c->base < RWUCB_WINDOW) {
+    if(chunk_pending(c, c->next)) {
+      more = 1;
+      break;
+    }
+    c->next++;
+  }
+
+  hdr.type = more ? TYPE_DATA : TYPE_DATA_POLL;
+  hdr.id = c->id;
+  hdr.chunk = i;
+  memcpy(packetbuf_dataptr(), &hdr, sizeof(hdr));
+
+  PRINTF("%d.%d: rwucb: send chunk %u%s\n",
+         linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+         i, more ? "" : " (poll)");
+
+  if(more) {
+    stunicast_send(&c->c, &c->receiver);
+  } else {
+    c->state = STATE_POLLING;
+    c->rxmit = 0;
+    stunicast_send_stubborn(&c->c, &c->receiver, REXMIT_TIME);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sent_by_stunicast(struct stunicast_conn *stunicast, int status, int num_tx)
+{
+  struct rwucb_conn *c = (struct rwucb_conn *)stunicast;
+
+  if(c->state == STATE_SENDING) {
+    /* Send the next chunk once the MAC layer is done with this one. */
+    ctimer_set(&c->pace, 0, send_next, c);
+  } else if(c->state == STATE_POLLING) {
+    c->rxmit++;
+    if(c->rxmit >= MAX_TRANSMISSIONS) {
+      PRINTF("%d.%d: rwucb: timedout\n",
+             linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1]);
+      stunicast_cancel(&c->c);
+      c->state = STATE_IDLE;
+      if(c->u->timedout) {
+        c->u->timedout(c);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_ack(struct rwucb_conn *c, const linkaddr_t *from)
+{
+  struct ack_hdr ack;
+  uint16_t d;
+
+  if(c->state == STATE_IDLE || packetbuf_datalen() < sizeof(ack) ||
+     !linkaddr_cmp(from, &c->receiver)) {
+    return;
+  }
+  memcpy(&ack, packetbuf_dataptr(), sizeof(ack));
+  if(ack.id != c->id) {
+    return;
+  }
+
+  d = ack.base - c->base;
+  if(d > RWUCB_WINDOW) {
+    /* An old acknowledgement */
+    return;
+  }
+  c->acked = d >= 32 ? 0 : c->acked >> d;
+  c->acked |= ack.bitmap;
+  c->base = ack.base;
+
+  PRINTF("%d.%d: rwucb: ack base %u bitmap %08lx\n",
+         linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+         ack.base, (unsigned long)ack.bitmap);
+
+  if(c->last_chunk != CHUNK_UNKNOWN && c->base > c->last_chunk) {
+    /* Everything was received. */
+    stunicast_cancel(&c->c);
+    ctimer_stop(&c->pace);
+    c->state = STATE_IDLE;
+    if(c->u->sent) {
+      c->u->sent(c);
+    }
+    return;
+  }
+
+  if(c->state == STATE_POLLING) {
+    /* The round is over: send what is missing. */
+    stunicast_cancel(&c->c);
+    c->state = STATE_SENDING;
+    c->next = c->base;
+    send_next(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_data(struct rwucb_conn *c, const linkaddr_t *from)
+{
+  struct data_hdr hdr;
+  struct ack_hdr ack;
+  char *data;
+  int datalen;
+  uint16_t d;
+
+  memcpy(&hdr, packetbuf_dataptr(), sizeof(hdr));
+  data = (char *)packetbuf_dataptr() + sizeof(hdr);
+  datalen = packetbuf_datalen() - sizeof(hdr);
+
+  if(linkaddr_cmp(&c->sender, &linkaddr_null) ||
+     (linkaddr_cmp(&c->sender, from) && (int8_t)(hdr.id - c->rx_id) > 0) ||
+     (c->rx_complete && !linkaddr_cmp(&c->sender, from))) {
+    /* A new transfer */
+    linkaddr_copy(&c->sender, from);
+    c->rx_id = hdr.id;
+    c->rx_base = 0;
+    c->rx_bitmap = 0;
+    c->rx_last_chunk = CHUNK_UNKNOWN;
+    c->rx_complete = 0;
+    c->u->write_chunk(c, 0, RWUCB_FLAG_NEWFILE, data, 0);
+  } else if(!linkaddr_cmp(&c->sender, from) || hdr.id != c->rx_id) {
+    /* Busy with another sender, or an old packet */
+    return;
+  }
+
+  d = hdr.chunk - c->rx_base;
+  if(!c->rx_complete && d < RWUCB_WINDOW &&
+     (c->rx_bitmap & ((uint32_t)1 << d)) == 0) {
+    c->rx_bitmap |= (uint32_t)1 << d;
+    if(datalen < RWUCB_DATASIZE) {
+      c->rx_last_chunk = hdr.chunk;
+      c->rx_last_size = datalen;
+    }
+    if(datalen > 0) {
+      c->u->write_chunk(c, hdr.chunk * RWUCB_DATASIZE, RWUCB_FLAG_NONE,
+                        data, datalen);
+    }
+
+    while(c->rx_bitmap & 1) {
+      c->rx_bitmap >>= 1;
+      c->rx_base++;
+    }
+
+    if(c->rx_last_chunk != CHUNK_UNKNOWN && c->rx_base > c->rx_last_chunk) {
+      PRINTF("%d.%d: rwucb: file complete\n",
+             linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1]);
+      c->rx_complete = 1;
+      c->u->write_chunk(c, c->rx_last_chunk * RWUCB_DATASIZE +
+                        c->rx_last_size, RWUCB_FLAG_LASTCHUNK, data, 0);
+    }
+  }
+
+  if(hdr.type == TYPE_DATA_POLL) {
+    packetbuf_clear();
+    ack.type = TYPE_ACK;
+    ack.id = c->rx_id;
+    ack.base = c->rx_base;
+    ack.bitmap = c->rx_bitmap;
+    memcpy(packetbuf_dataptr(), &ack, sizeof(ack));
+    packetbuf_set_datalen(sizeof(ack));
+    stunicast_send(&c->c, from);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_from_stunicast(struct stunicast_conn *stunicast, const linkaddr_t *from)
+{
+  struct rwucb_conn *c = (struct rwucb_conn *)stunicast;
+
+  if(packetbuf_datalen() < sizeof(struct data_hdr)) {
+    return;
+  }
+
+  if(((uint8_t *)packetbuf_dataptr())[0] == TYPE_ACK) {
+    recv_ack(c, from);
+  } else {
+    recv_data(c, from);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct stunicast_callbacks rwucb = {recv_from_stunicast,
+                                                 sent_by_stunicast};
+/*---------------------------------------------------------------------------*/
+void
+rwucb_open(struct rwucb_conn *c, uint16_t channel,
+           const struct rwucb_callbacks *u)
+{
+  stunicast_open(&c->c, channel, &rwucb);
+  c->u = u;
+  c->state = STATE_IDLE;
+  c->id = 0;
+  linkaddr_copy(&c->sender, &linkaddr_null);
+}
+/*---------------------------------------------------------------------------*/
+void
+rwucb_close(struct rwucb_conn *c)
+{
+  ctimer_stop(&c->pace);
+  stunicast_close(&c->c);
+  c->state = STATE_IDLE;
+}
+/*---------------------------------------------------------------------------*/
+int
+rwucb_send(struct rwucb_conn *c, const linkaddr_t *receiver)
+{
+  if(c->state != STATE_IDLE) {
+    return -1;
+  }
+
+  linkaddr_copy(&c->receiver, receiver);
+  c->id++;
+  c->base = 0;
+  c->next = 0;
+  c->acked = 0;
+  c->last_chunk = CHUNK_UNKNOWN;
+  c->state = STATE_SENDING;
+  send_next(c);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
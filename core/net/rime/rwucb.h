@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the windowed reliable unicast bulk transfer module
+ */
+
+/**
+ * \addtogroup rime
+ * @{
+ */
+
+/**
+ * \defgroup rimerwucb Windowed reliable unicast bulk transfer
+ * @{
+ *
+ * The rwucb primitive transfers a file, or any other bulk data, to a
+ * single-hop neighbor, like rucb does. Where rucb waits for the
+ * acknowledgement of each chunk before it sends the next, rwucb sends
+ * a window of up to RWUCB_WINDOW chunks back to back. The last chunk
+ * of each round asks for an acknowledgement and is sent with the
+ * stubborn unicast primitive, so that it is retransmitted until the
+ * receiver answers. The acknowledgement holds the number of chunks
+ * that have been received in order, and a bitmap of the chunks after
+ * those that have been received too. The next round only sends the
+ * chunks of the window that are missing.
+ *
+ * The receiver calls write_chunk() once for every chunk as it
+ * arrives, which may be out of order. When all chunks have arrived,
+ * write_chunk() is called one last time with RWUCB_FLAG_LASTCHUNK,
+ * no data, and the size of the file as offset.
+ *
+ * A connection runs one transfer at a time in each direction.
+ */
+
+#ifndef RWUCB_H_
+#define RWUCB_H_
+
+#include "net/rime/stunicast.h"
+
+/** The number of chunks that are sent before an acknowledgement is
+    needed. At most 32. */
+#ifdef RWUCB_CONF_WINDOW
+#define RWUCB_WINDOW RWUCB_CONF_WINDOW
+#else /* RWUCB_CONF_WINDOW */
+#define RWUCB_WINDOW 8
+#endif /* RWUCB_CONF_WINDOW */
+
+#ifdef RWUCB_CONF_DATASIZE
+#define RWUCB_DATASIZE RWUCB_CONF_DATASIZE
+#else /* RWUCB_CONF_DATASIZE */
+#define RWUCB_DATASIZE 64
+#endif /* RWUCB_CONF_DATASIZE */
+
+struct rwucb_conn;
+
+enum {
+  RWUCB_FLAG_NONE,
+  RWUCB_FLAG_NEWFILE,
+  RWUCB_FLAG_LASTCHUNK,
+};
+
+struct rwucb_callbacks {
+  void (* write_chunk)(struct rwucb_conn *c, int offset, int flag,
+                       char *data, int len);
+  int (* read_chunk)(struct rwucb_conn *c, int offset, char *to,
+                     int maxsize);
+  void (* timedout)(struct rwucb_conn *c);
+  void (* sent)(struct rwucb_conn *c);
+};
+
+struct rwucb_conn {
+  struct stunicast_conn c;
+  struct ctimer pace;
+  const struct rwucb_callbacks *u;
+
+  /* Sender */
+  linkaddr_t receiver;
+  uint32_t acked;
+  uint16_t base;
+  uint16_t next;
+  uint16_t last_chunk;
+  uint8_t id;
+  uint8_t state;
+  uint8_t rxmit;
+
+  /* Receiver */
+  linkaddr_t sender;
+  uint32_t rx_bitmap;
+  uint16_t rx_base;
+  uint16_t rx_last_chunk;
+  uint8_t rx_last_size;
+  uint8_t rx_id;
+  uint8_t rx_complete;
+};
+
+void rwucb_open(struct rwucb_conn *c, uint16_t channel,
+                const struct rwucb_callbacks *u);
+void rwucb_close(struct rwucb_conn *c);
+
+/**
+ * \brief      Start a transfer
+ * \param c    The connection
+ * \param receiver The address of the neighbor to send to
+ * \return     0 if the transfer was started, -1 if the connection
+ *             already is sending
+ *
+ *             The data is read with the read_chunk() callback as it
+ *             is sent. A chunk that is shorter than RWUCB_DATASIZE
+ *             ends the transfer. The sent() callback is called when
+ *             the receiver has acknowledged all chunks, and
+ *             timedout() if it stopped answering.
+ */
+int rwucb_send(struct rwucb_conn *c, const linkaddr_t *receiver);
+
+#endif /* RWUCB_H_ */
+/** @} */
+/** @} */
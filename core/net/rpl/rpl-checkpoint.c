@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Checkpointing of the RPL state to CFS.
+ *
+ *         A node in a DAG stores its DAG, the DIO configuration of the
+ *         instance, its preferred parent and its sequence numbers in a
+ *         file, so that it can rejoin through the same parent right
+ *         after a reboot instead of waiting for DIOs. The parent is then
+ *         asked for a DIO with unicast DIS messages, and the restored
+ *         state is dropped if it does not answer.
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+
+#include "net/rpl/rpl-private.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "cfs/cfs.h"
+#include "lib/random.h"
+#include "sys/ctimer.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#include <string.h>
+
+#if RPL_WITH_CHECKPOINT
+
+/* Changed whenever the layout of struct checkpoint changes */
+#define CHECKPOINT_MAGIC 0x52
+
+struct checkpoint {
+  uint8_t magic;
+  uint8_t instance_id;
+  uint8_t mop;
+  uint8_t dtsn_out;
+  uint8_t dao_sequence;
+  uint8_t dio_intdoubl;
+  uint8_t dio_intmin;
+  uint8_t dio_redundancy;
+  uint8_t default_lifetime;
+  uint8_t version;
+  uint8_t grounded;
+  uint8_t preference;
+  rpl_ocp_t ocp;
+  uint16_t lifetime_unit;
+  rpl_rank_t max_rankinc;
+  rpl_rank_t min_hoprankinc;
+  uip_ipaddr_t dag_id;
+  rpl_prefix_t prefix_info;
+  uip_ipaddr_t parent_ipaddr;
+  linkaddr_t parent_lladdr;
+  rpl_rank_t parent_rank;
+  uint8_t parent_dtsn;
+#if RPL_DAG_MC != RPL_DAG_MC_NONE
+  rpl_metric_container_t parent_mc;
+#endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
+};
+
+/* The state last written to the file */
+static struct checkpoint saved;
+static uint8_t saved_valid;
+static unsigned long saved_time;
+
+/* Set from restoration until the restored parent sends a DIO */
+static uint8_t validating;
+static uint8_t validation_tries;
+static struct ctimer validation_timer;
+/*---------------------------------------------------------------------------*/
+static int
+get_state(struct checkpoint *cp)
+{
+  rpl_instance_t *instance;
+  rpl_dag_t *dag;
+  rpl_parent_t *p;
+  const linkaddr_t *lladdr;
+
+  instance = rpl_get_default_instance();
+  if(instance == NULL || instance->current_dag == NULL) {
+    return 0;
+  }
+  dag = instance->current_dag;
+  p = dag->preferred_parent;
+  if(!dag->joined || p == NULL || dag->rank == ROOT_RANK(instance)) {
+    return 0;
+  }
+  lladdr = nbr_table_get_lladdr(rpl_parents, p);
+  if(lladdr == NULL || rpl_get_parent_ipaddr(p) == NULL) {
+    return 0;
+  }
+
+  memset(cp, 0, sizeof(*cp));
+  cp->magic = CHECKPOINT_MAGIC;
+  cp->instance_id = instance->instance_id;
+  cp->mop = instance->mop;
+  cp->dtsn_out = instance->dtsn_out;
+  cp->dao_sequence = rpl_get_dao_sequence();
+  cp->dio_intdoubl = instance->dio_intdoubl;
+  cp->dio_intmin = instance->dio_intmin;
+  cp->dio_redundancy = instance->dio_redundancy;
+  cp->default_lifetime = instance->default_lifetime;
+  cp->version = dag->version;
+  cp->grounded = dag->grounded;
+  cp->preference = dag->preference;
+  cp->ocp = instance->of->ocp;
+  cp->lifetime_unit = instance->lifetime_unit;
+  cp->max_rankinc = instance->max_rankinc;
+  cp->min_hoprankinc = instance->min_hoprankinc;
+  uip_ipaddr_copy(&cp->dag_id, &dag->dag_id);
+  memcpy(&cp->prefix_info, &dag->prefix_info, sizeof(cp->prefix_info));
+  uip_ipaddr_copy(&cp->parent_ipaddr, rpl_get_parent_ipaddr(p));
+  linkaddr_copy(&cp->parent_lladdr, lladdr);
+  cp->parent_rank = p->rank;
+  cp->parent_dtsn = p->dtsn;
+#if RPL_DAG_MC != RPL_DAG_MC_NONE
+  memcpy(&cp->parent_mc, &p->mc, sizeof(cp->parent_mc));
+#endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* The number of lollipop increments from a to b, up to
+   RPL_CHECKPOINT_DAO_SEQUENCE_SKIP */
+static uint8_t
+sequence_distance(uint8_t a, uint8_t b)
+{
+  uint8_t n;
+
+  for(n = 0; a != b && n < RPL_CHECKPOINT_DAO_SEQUENCE_SKIP; n++) {
+    RPL_LOLLIPOP_INCREMENT(a);
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+discard(void)
+{
+  cfs_remove(RPL_CHECKPOINT_FILE);
+  saved_valid = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_validation_timer(void *ptr)
+{
+  rpl_instance_t *instance;
+  rpl_parent_t *p;
+
+  if(!validating) {
+    return;
+  }
+
+  if(validation_tries < RPL_CHECKPOINT_VALIDATION_TRIES) {
+    validation_tries++;
+    PRINTF("RPL: Asking the restored parent ");
+    PRINT6ADDR(&saved.parent_ipaddr);
+    PRINTF(" for a DIO\n");
+    dis_output(&saved.parent_ipaddr);
+    ctimer_set(&validation_timer, RPL_CHECKPOINT_VALIDATION_INTERVAL,
+               handle_validation_timer, NULL);
+    return;
+  }
+
+  validating = 0;
+  instance = rpl_get_instance(saved.instance_id);
+  if(instance == NULL || instance->current_dag == NULL) {
+    return;
+  }
+  p = instance->current_dag->preferred_parent;
+  if(p != NULL && uip_ipaddr_cmp(rpl_get_parent_ipaddr(p), &saved.parent_ipaddr)) {
+    /* Still on the restored parent, which never answered. */
+    PRINTF("RPL: The restored parent is gone, leaving the instance\n");
+    rpl_free_instance(instance);
+    discard();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_checkpoint_dio_input(uip_ipaddr_t *from)
+{
+  if(validating && uip_ipaddr_cmp(from, &saved.parent_ipaddr)) {
+    PRINTF("RPL: The restored state is confirmed\n");
+    validating = 0;
+    ctimer_stop(&validation_timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_checkpoint_periodic(void)
+{
+  struct checkpoint cp;
+  uint8_t dao_sequence;
+  int fd;
+  int changed;
+
+  if(validating || !get_state(&cp)) {
+    return;
+  }
+
+  if(saved_valid) {
+    /* The DAO sequence only needs saving often enough for the skip on
+       restore to stay ahead of it. */
+    dao_sequence = cp.dao_sequence;
+    cp.dao_sequence = saved.dao_sequence;
+    changed = memcmp(&cp, &saved, sizeof(cp)) != 0;
+    cp.dao_sequence = dao_sequence;
+    if(sequence_distance(saved.dao_sequence, dao_sequence) <
+       RPL_CHECKPOINT_DAO_SEQUENCE_SKIP / 2 &&
+       (!changed ||
+        clock_seconds() - saved_time < RPL_CHECKPOINT_MIN_INTERVAL)) {
+      return;
+    }
+  }
+
+  cfs_remove(RPL_CHECKPOINT_FILE);
+  fd = cfs_open(RPL_CHECKPOINT_FILE, CFS_WRITE);
+  if(fd < 0) {
+    PRINTF("RPL: Failed to open the checkpoint file\n");
+    return;
+  }
+  if(cfs_write(fd, &cp, sizeof(cp)) == sizeof(cp)) {
+    memcpy(&saved, &cp, sizeof(saved));
+    saved_valid = 1;
+    PRINTF("RPL: Checkpointed the state\n");
+  } else {
+    PRINTF("RPL: Failed to write the checkpoint file\n");
+  }
+  /* Also rate-limits retries after a failed write */
+  saved_time = clock_seconds();
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_checkpoint_restore(void)
+{
+  struct checkpoint cp;
+  rpl_dio_t dio;
+  rpl_instance_t *instance;
+  uip_ds6_nbr_t *nbr;
+  uint8_t i;
+  int fd;
+  int len;
+
+  fd = cfs_open(RPL_CHECKPOINT_FILE, CFS_READ);
+  if(fd < 0) {
+    return;
+  }
+  len = cfs_read(fd, &cp, sizeof(cp));
+  cfs_close(fd);
+  if(len != sizeof(cp) || cp.magic != CHECKPOINT_MAGIC) {
+    PRINTF("RPL: Ignoring an invalid checkpoint\n");
+    discard();
+    return;
+  }
+
+  PRINTF("RPL: Restoring instance %u through parent ", cp.instance_id);
+  PRINT6ADDR(&cp.parent_ipaddr);
+  PRINTF("\n");
+
+  if((nbr = uip_ds6_nbr_lookup(&cp.parent_ipaddr)) == NULL) {
+    nbr = uip_ds6_nbr_add(&cp.parent_ipaddr, (uip_lladdr_t *)&cp.parent_lladdr,
+                          0, NBR_REACHABLE);
+    if(nbr == NULL) {
+      discard();
+      return;
+    }
+    stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+  }
+
+  /* Join as if the parent had just sent its last DIO again. */
+  memset(&dio, 0, sizeof(dio));
+  uip_ipaddr_copy(&dio.dag_id, &cp.dag_id);
+  dio.ocp = cp.ocp;
+  dio.rank = cp.parent_rank;
+  dio.grounded = cp.grounded;
+  dio.mop = cp.mop;
+  dio.preference = cp.preference;
+  dio.version = cp.version;
+  dio.instance_id = cp.instance_id;
+  dio.dtsn = cp.parent_dtsn;
+  dio.dag_intdoubl = cp.dio_intdoubl;
+  dio.dag_intmin = cp.dio_intmin;
+  dio.dag_redund = cp.dio_redundancy;
+  dio.default_lifetime = cp.default_lifetime;
+  dio.lifetime_unit = cp.lifetime_unit;
+  dio.dag_max_rankinc = cp.max_rankinc;
+  dio.dag_min_hoprankinc = cp.min_hoprankinc;
+  memcpy(&dio.prefix_info, &cp.prefix_info, sizeof(dio.prefix_info));
+#if RPL_DAG_MC != RPL_DAG_MC_NONE
+  memcpy(&dio.mc, &cp.parent_mc, sizeof(dio.mc));
+#endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
+  rpl_process_dio(&cp.parent_ipaddr, &dio);
+
+  instance = rpl_get_instance(cp.instance_id);
+  if(instance == NULL || instance->current_dag == NULL ||
+     !instance->current_dag->joined) {
+    PRINTF("RPL: Failed to restore the checkpoint\n");
+    discard();
+    return;
+  }
+
+  /* The routes of our sub-DODAG were lost with the reboot: a new DTSN
+     has the children send their DAOs again. Our own DAOs must be newer
+     than the ones sent before the reboot. */
+  instance->dtsn_out = cp.dtsn_out;
+  RPL_LOLLIPOP_INCREMENT(instance->dtsn_out);
+  for(i = 0; i < RPL_CHECKPOINT_DAO_SEQUENCE_SKIP; i++) {
+    RPL_LOLLIPOP_INCREMENT(cp.dao_sequence);
+  }
+  rpl_set_dao_sequence(cp.dao_sequence);
+
+  memcpy(&saved, &cp, sizeof(saved));
+  saved_valid = 1;
+  saved_time = clock_seconds();
+
+  /* Spread the DIS messages of a sub-DODAG that rebooted at once. */
+  validating = 1;
+  validation_tries = 0;
+  ctimer_set(&validation_timer,
+             random_rand() % RPL_CHECKPOINT_VALIDATION_INTERVAL,
+             handle_validation_timer, NULL);
+}
+#endif /* RPL_WITH_CHECKPOINT */
+/*---------------------------------------------------------------------------*/
+
+/** @}*/
@@ -39,6 +39,7 @@
 #define RPL_CONF_H
 
 #include "contiki-conf.h"
+#include "sys/boot-profile.h"
 
 /* Set to 1 to enable RPL statistics */
 #ifndef RPL_CONF_STATS
@@ -70,6 +71,18 @@
 #define RPL_OF rpl_mrhof
 #endif /* RPL_CONF_OF */
 
+/*
+ * The objective functions that this node can join DAGs with, as an
+ * initializer list of rpl_of objects, e.g., {&rpl_mrhof, &rpl_of0}.
+ * A DAG that this node is root of uses RPL_OF unless another one is
+ * given to rpl_set_root_with_of().
+ */
+#ifdef RPL_CONF_SUPPORTED_OFS
+#define RPL_SUPPORTED_OFS RPL_CONF_SUPPORTED_OFS
+#else
+#define RPL_SUPPORTED_OFS {&RPL_OF}
+#endif /* RPL_CONF_SUPPORTED_OFS */
+
 /* This value decides which DAG instance we should participate in by default. */
 #ifdef RPL_CONF_DEFAULT_INSTANCE
 #define RPL_DEFAULT_INSTANCE RPL_CONF_DEFAULT_INSTANCE
@@ -96,6 +109,19 @@
 #define RPL_MAX_INSTANCES     1
 #endif /* RPL_CONF_MAX_INSTANCES */
 
+/*
+ * Number of DSCP values that can be mapped to an instance with
+ * rpl_set_dscp_instance(), so that packets are sent in an instance
+ * other than the default one by their traffic class.
+ */
+#ifdef RPL_CONF_DSCP_MAP_SIZE
+#define RPL_DSCP_MAP_SIZE     RPL_CONF_DSCP_MAP_SIZE
+#elif RPL_MAX_INSTANCES > 1
+#define RPL_DSCP_MAP_SIZE     4
+#else
+#define RPL_DSCP_MAP_SIZE     0
+#endif /* RPL_CONF_DSCP_MAP_SIZE */
+
 /*
  * Maximum number of DAGs within an instance.
  */
@@ -195,6 +221,105 @@
 #define RPL_INIT_LINK_METRIC        RPL_CONF_INIT_LINK_METRIC
 #endif
 
+/*
+ * Neighbor eviction policy. When the neighbor tables are full, a new
+ * neighbor first replaces one that is no parent candidate, then a
+ * candidate whose link metric is above RPL_NBR_POLICY_MAX_LINK_METRIC,
+ * then the candidate with the worst link metric. Without it, the
+ * neighbor used by fewest tables is replaced.
+ */
+#ifdef RPL_CONF_NBR_POLICY
+#define RPL_NBR_POLICY              RPL_CONF_NBR_POLICY
+#else
+#define RPL_NBR_POLICY              0
+#endif
+
+#ifdef RPL_CONF_NBR_POLICY_MAX_LINK_METRIC
+#define RPL_NBR_POLICY_MAX_LINK_METRIC RPL_CONF_NBR_POLICY_MAX_LINK_METRIC
+#else
+#define RPL_NBR_POLICY_MAX_LINK_METRIC (5 * RPL_DAG_MC_ETX_DIVISOR)
+#endif
+
+/*
+ * The energy-aware objective function (rpl_energy_of) ranks like MRHOF
+ * with ETX, but prefers parents on paths with more residual energy.
+ * Nodes advertise, in percent, the lowest residual energy on their path
+ * to the root, which requires RPL_CONF_DAG_MC to be RPL_DAG_MC_ENERGY.
+ * A path whose weakest node has r% of its energy left costs
+ * (100 - r) * RPL_ENERGY_OF_WEIGHT more than its ETX.
+ */
+#ifdef RPL_CONF_ENERGY_OF_OCP
+#define RPL_ENERGY_OF_OCP           RPL_CONF_ENERGY_OF_OCP
+#else
+#define RPL_ENERGY_OF_OCP           0xfe
+#endif
+
+#ifdef RPL_CONF_ENERGY_OF_WEIGHT
+#define RPL_ENERGY_OF_WEIGHT        RPL_CONF_ENERGY_OF_WEIGHT
+#else
+#define RPL_ENERGY_OF_WEIGHT        (RPL_DAG_MC_ETX_DIVISOR / 20)
+#endif
+
+/*
+ * The residual energy of the node. By default, the charge used since
+ * boot is estimated from energest and the current draws below (in uA,
+ * defaults of the Tmote Sky), against a budget in mAh. A budget of 0
+ * disables the estimation. Alternatively, RPL_CONF_ENERGY_OF_RESIDUAL
+ * is the name of a function returning the residual energy in percent.
+ */
+#ifdef RPL_CONF_ENERGY_OF_BUDGET
+#define RPL_ENERGY_OF_BUDGET        RPL_CONF_ENERGY_OF_BUDGET
+#else
+#define RPL_ENERGY_OF_BUDGET        0
+#endif
+
+#ifdef RPL_CONF_ENERGY_OF_CURRENT_CPU
+#define RPL_ENERGY_OF_CURRENT_CPU   RPL_CONF_ENERGY_OF_CURRENT_CPU
+#else
+#define RPL_ENERGY_OF_CURRENT_CPU   1800
+#endif
+
+#ifdef RPL_CONF_ENERGY_OF_CURRENT_LPM
+#define RPL_ENERGY_OF_CURRENT_LPM   RPL_CONF_ENERGY_OF_CURRENT_LPM
+#else
+#define RPL_ENERGY_OF_CURRENT_LPM   55
+#endif
+
+#ifdef RPL_CONF_ENERGY_OF_CURRENT_TX
+#define RPL_ENERGY_OF_CURRENT_TX    RPL_CONF_ENERGY_OF_CURRENT_TX
+#else
+#define RPL_ENERGY_OF_CURRENT_TX    17700
+#endif
+
+#ifdef RPL_CONF_ENERGY_OF_CURRENT_RX
+#define RPL_ENERGY_OF_CURRENT_RX    RPL_CONF_ENERGY_OF_CURRENT_RX
+#else
+#define RPL_ENERGY_OF_CURRENT_RX    20000
+#endif
+
+/*
+ * Also read the battery sensor, and take the lowest of both estimates.
+ * Its readings are mapped linearly from RPL_ENERGY_OF_BATTERY_EMPTY
+ * (0%) to RPL_ENERGY_OF_BATTERY_FULL (100%), in the platform's units.
+ */
+#ifdef RPL_CONF_ENERGY_OF_BATTERY
+#define RPL_ENERGY_OF_BATTERY       RPL_CONF_ENERGY_OF_BATTERY
+#else
+#define RPL_ENERGY_OF_BATTERY       0
+#endif
+
+#ifdef RPL_CONF_ENERGY_OF_BATTERY_EMPTY
+#define RPL_ENERGY_OF_BATTERY_EMPTY RPL_CONF_ENERGY_OF_BATTERY_EMPTY
+#else
+#define RPL_ENERGY_OF_BATTERY_EMPTY 0
+#endif
+
+#ifdef RPL_CONF_ENERGY_OF_BATTERY_FULL
+#define RPL_ENERGY_OF_BATTERY_FULL  RPL_CONF_ENERGY_OF_BATTERY_FULL
+#else
+#define RPL_ENERGY_OF_BATTERY_FULL  4095
+#endif
+
 /*
  * Default route lifetime unit. This is the granularity of time
  * used in RPL lifetime values, in seconds.
@@ -263,6 +388,50 @@
 #define RPL_PROBING_EXPIRATION_TIME (10 * 60 * CLOCK_SECOND)
 #endif
 
+/*
+ * The most probes sent in an instance per RPL_PROBING_INTERVAL. A
+ * probe is only sent when a parent needs one, see below.
+ */
+#ifdef RPL_CONF_PROBING_BUDGET
+#define RPL_PROBING_BUDGET RPL_CONF_PROBING_BUDGET
+#else
+#define RPL_PROBING_BUDGET 1
+#endif
+
+/*
+ * How much a parent must need a probe for one to be sent, from 0 to
+ * 512. The need of a parent is the sum of how long ago its link was
+ * last used, relative to RPL_PROBING_EXPIRATION_TIME, and of how much
+ * its link metric varies, relative to RPL_PROBING_UNCERTAIN_DEV, each
+ * counting up to 256. The need of the preferred parent counts twice.
+ */
+#ifdef RPL_CONF_PROBING_MIN_NEED
+#define RPL_PROBING_MIN_NEED RPL_CONF_PROBING_MIN_NEED
+#else
+#define RPL_PROBING_MIN_NEED 128
+#endif
+
+/*
+ * The average change of the link metric per transmission at which
+ * the link metric of a parent is considered wholly uncertain.
+ */
+#ifdef RPL_CONF_PROBING_UNCERTAIN_DEV
+#define RPL_PROBING_UNCERTAIN_DEV RPL_CONF_PROBING_UNCERTAIN_DEV
+#else
+#define RPL_PROBING_UNCERTAIN_DEV (RPL_DAG_MC_ETX_DIVISOR / 4)
+#endif
+
+/*
+ * How long to wait for a packet that goes upwards, which is then sent
+ * through the parent to be probed, before sending a probe. Zero sends
+ * probes at once.
+ */
+#ifdef RPL_CONF_PROBING_PIGGYBACK_DELAY
+#define RPL_PROBING_PIGGYBACK_DELAY RPL_CONF_PROBING_PIGGYBACK_DELAY
+#else
+#define RPL_PROBING_PIGGYBACK_DELAY (RPL_PROBING_INTERVAL / 8)
+#endif
+
 /*
  * Function used to select the next parent to be probed.
  */
@@ -292,8 +461,9 @@
 #ifdef RPL_CONF_PROBING_DELAY_FUNC
 #define RPL_PROBING_DELAY_FUNC RPL_CONF_PROBING_DELAY_FUNC
 #else
-#define RPL_PROBING_DELAY_FUNC() ((RPL_PROBING_INTERVAL / 2) \
-    + random_rand() % (RPL_PROBING_INTERVAL))
+#define RPL_PROBING_DELAY_FUNC() \
+  ((RPL_PROBING_INTERVAL / RPL_PROBING_BUDGET / 2) \
+   + random_rand() % (RPL_PROBING_INTERVAL / RPL_PROBING_BUDGET))
 #endif
 
 /*
@@ -314,4 +484,88 @@
 #define RPL_DIS_START_DELAY             5
 #endif
 
+/*
+ * Fast join. A node that is not in a DAG sends DIS messages with a
+ * solicited information option, starting RPL_FAST_JOIN_DIS_INTERVAL
+ * seconds after boot and doubling the interval up to RPL_DIS_INTERVAL.
+ * Nodes in a DAG answer such a DIS with a unicast DIO after a random
+ * delay below RPL_FAST_JOIN_DIO_JITTER, at most once per
+ * RPL_FAST_JOIN_DIO_MIN_INTERVAL, instead of resetting their trickle
+ * timer. All nodes of a network should agree on this setting. It is
+ * on by default with BOOT_CONF_FAST.
+ */
+#ifdef RPL_CONF_WITH_FAST_JOIN
+#define RPL_WITH_FAST_JOIN              RPL_CONF_WITH_FAST_JOIN
+#else
+#define RPL_WITH_FAST_JOIN              BOOT_FAST
+#endif
+
+#ifdef RPL_CONF_FAST_JOIN_DIS_INTERVAL
+#define RPL_FAST_JOIN_DIS_INTERVAL      RPL_CONF_FAST_JOIN_DIS_INTERVAL
+#else
+#define RPL_FAST_JOIN_DIS_INTERVAL      1
+#endif
+
+#ifdef RPL_CONF_FAST_JOIN_DIO_JITTER
+#define RPL_FAST_JOIN_DIO_JITTER        RPL_CONF_FAST_JOIN_DIO_JITTER
+#else
+#define RPL_FAST_JOIN_DIO_JITTER        (CLOCK_SECOND / 4)
+#endif
+
+#ifdef RPL_CONF_FAST_JOIN_DIO_MIN_INTERVAL
+#define RPL_FAST_JOIN_DIO_MIN_INTERVAL  RPL_CONF_FAST_JOIN_DIO_MIN_INTERVAL
+#else
+#define RPL_FAST_JOIN_DIO_MIN_INTERVAL  (CLOCK_SECOND / 2)
+#endif
+
+
+/*
+ * Checkpointing. A node in a DAG keeps a compact copy of its RPL state
+ * (DAG, DIO configuration, preferred parent, DTSN and DAO sequence) in
+ * the file RPL_CHECKPOINT_FILE, rewritten at most once per
+ * RPL_CHECKPOINT_MIN_INTERVAL seconds when the state changes. After a
+ * reboot, rpl_init() rejoins the DAG through the stored parent at once
+ * and checks that the parent is still there with unicast DIS messages.
+ * If the parent does not answer with a DIO within
+ * RPL_CHECKPOINT_VALIDATION_TRIES of them, the state is dropped and the
+ * node joins from scratch. The DAO sequence is moved forward by
+ * RPL_CHECKPOINT_DAO_SEQUENCE_SKIP on restore, so that the DAOs sent
+ * after the reboot are newer than the ones sent before it.
+ */
+#ifdef RPL_CONF_WITH_CHECKPOINT
+#define RPL_WITH_CHECKPOINT             RPL_CONF_WITH_CHECKPOINT
+#else
+#define RPL_WITH_CHECKPOINT             0
+#endif
+
+#ifdef RPL_CONF_CHECKPOINT_FILE
+#define RPL_CHECKPOINT_FILE             RPL_CONF_CHECKPOINT_FILE
+#else
+#define RPL_CHECKPOINT_FILE             "rpl-state"
+#endif
+
+#ifdef RPL_CONF_CHECKPOINT_MIN_INTERVAL
+#define RPL_CHECKPOINT_MIN_INTERVAL     RPL_CONF_CHECKPOINT_MIN_INTERVAL
+#else
+#define RPL_CHECKPOINT_MIN_INTERVAL     60
+#endif
+
+#ifdef RPL_CONF_CHECKPOINT_DAO_SEQUENCE_SKIP
+#define RPL_CHECKPOINT_DAO_SEQUENCE_SKIP RPL_CONF_CHECKPOINT_DAO_SEQUENCE_SKIP
+#else
+#define RPL_CHECKPOINT_DAO_SEQUENCE_SKIP 8
+#endif
+
+#ifdef RPL_CONF_CHECKPOINT_VALIDATION_TRIES
+#define RPL_CHECKPOINT_VALIDATION_TRIES RPL_CONF_CHECKPOINT_VALIDATION_TRIES
+#else
+#define RPL_CHECKPOINT_VALIDATION_TRIES 3
+#endif
+
+#ifdef RPL_CONF_CHECKPOINT_VALIDATION_INTERVAL
+#define RPL_CHECKPOINT_VALIDATION_INTERVAL RPL_CONF_CHECKPOINT_VALIDATION_INTERVAL
+#else
+#define RPL_CHECKPOINT_VALIDATION_INTERVAL (2 * CLOCK_SECOND)
+#endif
+
 #endif /* RPL_CONF_H */
@@ -53,6 +53,7 @@
 #include "lib/list.h"
 #include "lib/memb.h"
 #include "sys/ctimer.h"
+#include "sys/boot-profile.h"
 
 #include <limits.h>
 #include <string.h>
@@ -66,8 +67,9 @@ void RPL_CALLBACK_PARENT_SWITCH(rpl_parent_t *old, rpl_parent_t *new);
 #endif /* RPL_CALLBACK_PARENT_SWITCH */
 
 /*---------------------------------------------------------------------------*/
-extern rpl_of_t RPL_OF;
-static rpl_of_t * const objective_functions[] = {&RPL_OF};
+static rpl_of_t * const objective_functions[] = RPL_SUPPORTED_OFS;
+
+static rpl_parent_t *select_parent(rpl_dag_t *dag, rpl_parent_t *changed);
 
 /*---------------------------------------------------------------------------*/
 /* RPL definitions. */
@@ -130,11 +132,47 @@ nbr_callback(void *ptr)
 {
   rpl_remove_parent(ptr);
 }
+/*---------------------------------------------------------------------------*/
+#if RPL_NBR_POLICY
+/* How much a neighbor is worth keeping when the neighbor tables are full */
+static int
+nbr_policy(const linkaddr_t *lladdr)
+{
+  rpl_parent_t *p;
+  uint16_t metric;
+
+  p = nbr_table_get_from_lladdr(rpl_parents, lladdr);
+  if(p == NULL || p->dag == NULL || p->rank == INFINITE_RANK) {
+    /* Not, or no longer, a parent candidate */
+    return 0;
+  }
+  metric = rpl_get_parent_link_metric((const uip_lladdr_t *)lladdr);
+  if(metric == 0) {
+    metric = RPL_INIT_LINK_METRIC * RPL_DAG_MC_ETX_DIVISOR;
+  }
+  if(metric > RPL_NBR_POLICY_MAX_LINK_METRIC) {
+    return 1;
+  }
+  return 2 + RPL_NBR_POLICY_MAX_LINK_METRIC - metric;
+}
+#endif /* RPL_NBR_POLICY */
+/*---------------------------------------------------------------------------*/
 
 void
 rpl_dag_init(void)
 {
+  unsigned int i;
+
   nbr_table_register(rpl_parents, (nbr_table_callback *)nbr_callback);
+#if RPL_NBR_POLICY
+  nbr_table_set_policy(nbr_policy);
+#endif /* RPL_NBR_POLICY */
+
+  for(i = 0;
+      i < sizeof(objective_functions) / sizeof(objective_functions[0]);
+      i++) {
+    objective_functions[i]->reset(NULL);
+  }
 }
 /*---------------------------------------------------------------------------*/
 rpl_parent_t *
@@ -197,6 +235,10 @@ rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
     RPL_CALLBACK_PARENT_SWITCH(dag->preferred_parent, p);
 #endif /* RPL_CALLBACK_PARENT_SWITCH */
 
+    if(p != NULL) {
+      BOOT_PROFILE_MARK(BOOT_PROFILE_RPL);
+    }
+
     /* Always keep the preferred parent locked, so it remains in the
      * neighbor table. */
     nbr_table_unlock(rpl_parents, dag->preferred_parent);
@@ -300,6 +342,12 @@ get_dag(uint8_t instance_id, uip_ipaddr_t *dag_id)
 /*---------------------------------------------------------------------------*/
 rpl_dag_t *
 rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id)
+{
+  return rpl_set_root_with_of(instance_id, dag_id, &RPL_OF);
+}
+/*---------------------------------------------------------------------------*/
+rpl_dag_t *
+rpl_set_root_with_of(uint8_t instance_id, uip_ipaddr_t *dag_id, rpl_of_t *of)
 {
   rpl_dag_t *dag;
   rpl_instance_t *instance;
@@ -340,7 +388,7 @@ rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id)
   dag->grounded = RPL_GROUNDED;
   dag->preference = RPL_PREFERENCE;
   instance->mop = RPL_MOP_DEFAULT;
-  instance->of = &RPL_OF;
+  instance->of = of;
   rpl_set_preferred_parent(dag, NULL);
 
   memcpy(&dag->dag_id, dag_id, sizeof(dag->dag_id));
@@ -371,6 +419,7 @@ rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id)
   instance->of->update_metric_container(instance);
   default_instance = instance;
 
+  BOOT_PROFILE_MARK(BOOT_PROFILE_RPL);
   PRINTF("RPL: Node set to be a DAG root with DAG ID ");
   PRINT6ADDR(&dag->dag_id);
   PRINTF("\n");
@@ -712,7 +761,7 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
 
   best_dag = instance->current_dag;
   if(best_dag->rank != ROOT_RANK(instance)) {
-    if(rpl_select_parent(p->dag) != NULL) {
+    if(select_parent(p->dag, p) != NULL) {
       if(p->dag != best_dag) {
         best_dag = instance->of->best_dag(best_dag, p->dag);
       }
@@ -795,10 +844,22 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
 }
 /*---------------------------------------------------------------------------*/
 static rpl_parent_t *
-best_parent(rpl_dag_t *dag)
+best_parent(rpl_dag_t *dag, rpl_parent_t *changed)
 {
   rpl_parent_t *p, *best;
 
+  /* If only another parent than the preferred one has changed since the
+     parents were last compared, the preferred parent is still better
+     than all others, and only has to be compared with that parent. */
+  best = dag->preferred_parent;
+  if(changed != NULL && best != NULL && changed != best &&
+     changed->dag == dag && best->dag == dag && best->rank != INFINITE_RANK) {
+    if(changed->rank == INFINITE_RANK) {
+      return best;
+    }
+    return dag->instance->of->best_parent(best, changed);
+  }
+
   best = NULL;
 
   p = nbr_table_head(rpl_parents);
@@ -816,10 +877,10 @@ best_parent(rpl_dag_t *dag)
   return best;
 }
 /*---------------------------------------------------------------------------*/
-rpl_parent_t *
-rpl_select_parent(rpl_dag_t *dag)
+static rpl_parent_t *
+select_parent(rpl_dag_t *dag, rpl_parent_t *changed)
 {
-  rpl_parent_t *best = best_parent(dag);
+  rpl_parent_t *best = best_parent(dag, changed);
 
   if(best != NULL) {
     rpl_set_preferred_parent(dag, best);
@@ -831,6 +892,12 @@ rpl_select_parent(rpl_dag_t *dag)
   return best;
 }
 /*---------------------------------------------------------------------------*/
+rpl_parent_t *
+rpl_select_parent(rpl_dag_t *dag)
+{
+  return select_parent(dag, NULL);
+}
+/*---------------------------------------------------------------------------*/
 void
 rpl_remove_parent(rpl_parent_t *parent)
 {
@@ -840,6 +907,13 @@ rpl_remove_parent(rpl_parent_t *parent)
 
   rpl_nullify_parent(parent);
 
+#if RPL_WITH_PROBING
+  if(parent->dag != NULL &&
+     parent->dag->instance->probing_target == parent) {
+    parent->dag->instance->probing_target = NULL;
+  }
+#endif /* RPL_WITH_PROBING */
+
   nbr_table_remove(rpl_parents, parent);
 }
 /*---------------------------------------------------------------------------*/
@@ -1071,6 +1145,7 @@ rpl_add_dag(uip_ipaddr_t *from, rpl_dio_t *dio)
     }
   }
   p->rank = dio->rank;
+  p->flags &= ~RPL_PARENT_FLAG_PATH_METRIC_VALID;
 
   /* Determine the objective function by using the
      objective code point of the DIO. */
@@ -1257,6 +1332,10 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
   rpl_dag_t *dag, *previous_dag;
   rpl_parent_t *p;
 
+#if RPL_WITH_CHECKPOINT
+  rpl_checkpoint_dio_input(from);
+#endif /* RPL_WITH_CHECKPOINT */
+
 #if RPL_CONF_MULTICAST
   /* If the root is advertising MOP 2 but we support MOP 3 we can still join
    * In that scenario, we suppress DAOs for multicast targets */
@@ -1395,7 +1474,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
   p->rank = dio->rank;
 
   /* Parent info has been updated, trigger rank recalculation */
-  p->flags |= RPL_PARENT_FLAG_UPDATED;
+  RPL_PARENT_UPDATED(p);
 
   PRINTF("RPL: preferred DAG ");
   PRINT6ADDR(&instance->current_dag->dag_id);
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         An energy-aware objective function. The rank is computed
+ *         like in MRHOF with ETX, while parents are compared on their
+ *         ETX plus a penalty for the lowest residual energy on their
+ *         path to the root, advertised in the node energy object of
+ *         the DIO metric container. Traffic then moves away from
+ *         relays that run out of energy, which extends the lifetime
+ *         of the network.
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+
+#include "net/rpl/rpl-private.h"
+#include "net/nbr-table.h"
+#include "sys/energest.h"
+#if RPL_ENERGY_OF_BATTERY
+#include "dev/battery-sensor.h"
+#endif /* RPL_ENERGY_OF_BATTERY */
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+static void reset(rpl_dag_t *);
+static void neighbor_link_callback(rpl_parent_t *, int, int);
+static rpl_parent_t *best_parent(rpl_parent_t *, rpl_parent_t *);
+static rpl_dag_t *best_dag(rpl_dag_t *, rpl_dag_t *);
+static rpl_rank_t calculate_rank(rpl_parent_t *, rpl_rank_t);
+static void update_metric_container(rpl_instance_t *);
+
+rpl_of_t rpl_energy_of = {
+  reset,
+  neighbor_link_callback,
+  best_parent,
+  best_dag,
+  calculate_rank,
+  update_metric_container,
+  RPL_ENERGY_OF_OCP
+};
+
+/* Reject parents that have a higher path cost than the following. */
+#define MAX_PATH_COST			100
+
+/*
+ * The cost must differ more than 1/PARENT_SWITCH_THRESHOLD_DIV in order
+ * to switch preferred parent.
+ */
+#define PARENT_SWITCH_THRESHOLD_DIV	2
+
+#if RPL_DAG_MC == RPL_DAG_MC_ENERGY
+#ifdef RPL_CONF_ENERGY_OF_RESIDUAL
+uint8_t RPL_CONF_ENERGY_OF_RESIDUAL(void);
+#endif /* RPL_CONF_ENERGY_OF_RESIDUAL */
+
+/* Returns the residual energy of this node, in percent */
+static uint8_t
+residual_energy(void)
+{
+#ifdef RPL_CONF_ENERGY_OF_RESIDUAL
+  return RPL_CONF_ENERGY_OF_RESIDUAL();
+#else /* RPL_CONF_ENERGY_OF_RESIDUAL */
+  uint8_t residual = 100;
+#if RPL_ENERGY_OF_BUDGET
+  static const uint8_t types[] = {
+    ENERGEST_TYPE_CPU, ENERGEST_TYPE_LPM,
+    ENERGEST_TYPE_TRANSMIT, ENERGEST_TYPE_LISTEN
+  };
+  static const uint16_t currents[] = {
+    RPL_ENERGY_OF_CURRENT_CPU, RPL_ENERGY_OF_CURRENT_LPM,
+    RPL_ENERGY_OF_CURRENT_TX, RPL_ENERGY_OF_CURRENT_RX
+  };
+  /* The energest times wrap around: accumulate their increments, in
+     uA * rtimer ticks, every time the metric container is updated */
+  static unsigned long last_times[sizeof(types)];
+  static uint64_t used;
+  const uint64_t budget = (uint64_t)RPL_ENERGY_OF_BUDGET * 1000 * 3600 * RTIMER_SECOND;
+  uint8_t i;
+
+  energest_flush();
+  for(i = 0; i < sizeof(types); i++) {
+    unsigned long time = energest_type_time(types[i]);
+    used += (uint64_t)(time - last_times[i]) * currents[i];
+    last_times[i] = time;
+  }
+  residual = used >= budget ? 0 : 100 - (uint8_t)(used * 100 / budget);
+#endif /* RPL_ENERGY_OF_BUDGET */
+#if RPL_ENERGY_OF_BATTERY
+  {
+    int value;
+    uint8_t battery;
+    if(!battery_sensor.status(SENSORS_ACTIVE)) {
+      SENSORS_ACTIVATE(battery_sensor);
+    }
+    value = battery_sensor.value(0);
+    if(value <= RPL_ENERGY_OF_BATTERY_EMPTY) {
+      battery = 0;
+    } else if(value >= RPL_ENERGY_OF_BATTERY_FULL) {
+      battery = 100;
+    } else {
+      battery = (uint32_t)(value - RPL_ENERGY_OF_BATTERY_EMPTY) * 100 /
+        (RPL_ENERGY_OF_BATTERY_FULL - RPL_ENERGY_OF_BATTERY_EMPTY);
+    }
+    if(battery < residual) {
+      residual = battery;
+    }
+  }
+#endif /* RPL_ENERGY_OF_BATTERY */
+  return residual;
+#endif /* RPL_CONF_ENERGY_OF_RESIDUAL */
+}
+/* Returns the lowest residual energy on the path through a parent */
+static uint8_t
+path_energy(rpl_parent_t *p)
+{
+  if(p == NULL || p->mc.type != RPL_DAG_MC_ENERGY
+     || p->mc.obj.energy.energy_est > 100) {
+    return 100;
+  }
+  return p->mc.obj.energy.energy_est;
+}
+#endif /* RPL_DAG_MC == RPL_DAG_MC_ENERGY */
+
+/* The path cost is cached in the parent until its rank, metric
+   container or link metric changes, as parents are compared often. */
+static uint16_t
+calculate_path_cost(rpl_parent_t *p)
+{
+  uip_ds6_nbr_t *nbr;
+  uint32_t cost;
+  if(p->flags & RPL_PARENT_FLAG_PATH_METRIC_VALID) {
+    return p->path_metric;
+  }
+  nbr = rpl_get_nbr(p);
+  if(nbr == NULL) {
+    return MAX_PATH_COST * RPL_DAG_MC_ETX_DIVISOR;
+  }
+  cost = (uint32_t)p->rank + nbr->link_metric;
+#if RPL_DAG_MC == RPL_DAG_MC_ENERGY
+  cost += (uint32_t)(100 - path_energy(p)) * RPL_ENERGY_OF_WEIGHT;
+#endif /* RPL_DAG_MC == RPL_DAG_MC_ENERGY */
+  p->path_metric = cost > 0xffff ? 0xffff : cost;
+  p->flags |= RPL_PARENT_FLAG_PATH_METRIC_VALID;
+  return p->path_metric;
+}
+
+static void
+reset(rpl_dag_t *dag)
+{
+  PRINTF("RPL: Reset energy OF\n");
+}
+
+/* The link metric, rank and DAG selection are those of MRHOF */
+static void
+neighbor_link_callback(rpl_parent_t *p, int status, int numtx)
+{
+  rpl_mrhof.neighbor_link_callback(p, status, numtx);
+}
+
+static rpl_rank_t
+calculate_rank(rpl_parent_t *p, rpl_rank_t base_rank)
+{
+  return rpl_mrhof.calculate_rank(p, base_rank);
+}
+
+static rpl_dag_t *
+best_dag(rpl_dag_t *d1, rpl_dag_t *d2)
+{
+  return rpl_mrhof.best_dag(d1, d2);
+}
+
+static rpl_parent_t *
+best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
+{
+  rpl_dag_t *dag;
+  uint16_t min_diff;
+  uint16_t p1_cost;
+  uint16_t p2_cost;
+
+  dag = p1->dag; /* Both parents are in the same DAG. */
+
+  min_diff = RPL_DAG_MC_ETX_DIVISOR /
+             PARENT_SWITCH_THRESHOLD_DIV;
+
+  p1_cost = calculate_path_cost(p1);
+  p2_cost = calculate_path_cost(p2);
+
+  /* Maintain stability of the preferred parent in case of similar costs. */
+  if(p1 == dag->preferred_parent || p2 == dag->preferred_parent) {
+    if(p1_cost < p2_cost + min_diff &&
+       p1_cost + min_diff > p2_cost) {
+      PRINTF("RPL: energy OF hysteresis: %u <= %u <= %u\n",
+             p2_cost - min_diff,
+             p1_cost,
+             p2_cost + min_diff);
+      return dag->preferred_parent;
+    }
+  }
+
+  return p1_cost < p2_cost ? p1 : p2;
+}
+
+#if RPL_DAG_MC == RPL_DAG_MC_ENERGY
+static void
+update_metric_container(rpl_instance_t *instance)
+{
+  rpl_dag_t *dag;
+  uint8_t type;
+  uint8_t energy;
+
+  instance->mc.type = RPL_DAG_MC_ENERGY;
+  instance->mc.flags = RPL_DAG_MC_FLAG_P;
+  instance->mc.aggr = RPL_DAG_MC_AGGR_MINIMUM;
+  instance->mc.prec = 0;
+  instance->mc.length = sizeof(instance->mc.obj.energy);
+
+  dag = instance->current_dag;
+
+  if(!dag->joined) {
+    PRINTF("RPL: Cannot update the metric container when not joined\n");
+    return;
+  }
+
+  if(dag->rank == ROOT_RANK(instance)) {
+    type = RPL_DAG_MC_ENERGY_TYPE_MAINS;
+    energy = 100;
+  } else {
+    type = RPL_DAG_MC_ENERGY_TYPE_BATTERY;
+    energy = residual_energy();
+    if(path_energy(dag->preferred_parent) < energy) {
+      energy = path_energy(dag->preferred_parent);
+    }
+  }
+
+  instance->mc.obj.energy.flags = (type << RPL_DAG_MC_ENERGY_TYPE) |
+    (1 << RPL_DAG_MC_ENERGY_ESTIMATION);
+  instance->mc.obj.energy.energy_est = energy;
+
+  PRINTF("RPL: My path residual energy is %u%%\n", energy);
+}
+#else /* RPL_DAG_MC == RPL_DAG_MC_ENERGY */
+static void
+update_metric_container(rpl_instance_t *instance)
+{
+  /* Without node energy objects, this is MRHOF with ETX */
+  instance->mc.type = RPL_DAG_MC_NONE;
+}
+#endif /* RPL_DAG_MC == RPL_DAG_MC_ENERGY */
+
+/** @}*/
@@ -48,6 +48,7 @@
 #include "net/ip/tcpip.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/packetbuf.h"
 
 #define DEBUG DEBUG_NONE
@@ -64,6 +65,162 @@
 #define UIP_EXT_HDR_OPT_BUF       ((struct uip_ext_hdr_opt *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
 #define UIP_EXT_HDR_OPT_PADN_BUF  ((struct uip_ext_hdr_opt_padn *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
 #define UIP_EXT_HDR_OPT_RPL_BUF   ((struct uip_ext_hdr_opt_rpl *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
+#define UIP_RH_BUF                ((struct uip_routing_hdr *)&uip_buf[uip_l2_l3_hdr_len])
+#define UIP_RPL_SRH_BUF           ((struct rpl_srh_hdr *)&uip_buf[uip_l2_l3_hdr_len + RPL_RH_LEN])
+
+/* The source routing header fields that follow the routing header */
+struct rpl_srh_hdr {
+  uint8_t cmpr;
+  uint8_t pad;
+  uint8_t reserved[2];
+};
+
+/* The instance chosen for the packets being sent, if any */
+static int output_instance_id = RPL_OUTPUT_INSTANCE_NONE;
+
+#if RPL_DSCP_MAP_SIZE > 0
+/* The instances that packets are sent in by their DSCP */
+static struct {
+  uint8_t dscp;
+  uint8_t instance_id;
+} dscp_map[RPL_DSCP_MAP_SIZE];
+static uint8_t dscp_map_len;
+#endif /* RPL_DSCP_MAP_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
+int
+rpl_set_dscp_instance(uint8_t dscp, uint8_t instance_id)
+{
+#if RPL_DSCP_MAP_SIZE > 0
+  uint8_t i;
+
+  for(i = 0; i < dscp_map_len && dscp_map[i].dscp != dscp; i++);
+  if(i == dscp_map_len) {
+    if(dscp_map_len == RPL_DSCP_MAP_SIZE) {
+      PRINTF("RPL: No room to map DSCP %u\n", dscp);
+      return 0;
+    }
+    dscp_map_len++;
+  }
+  dscp_map[i].dscp = dscp;
+  dscp_map[i].instance_id = instance_id;
+  return 1;
+#else /* RPL_DSCP_MAP_SIZE > 0 */
+  return 0;
+#endif /* RPL_DSCP_MAP_SIZE > 0 */
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_set_output_instance(int instance_id)
+{
+  output_instance_id = instance_id;
+}
+/*---------------------------------------------------------------------------*/
+/* The instance of a packet that has no RPL option: the one chosen for
+   the packets being sent, the one that the DSCP of the packet is
+   mapped to, or else the default instance. */
+static rpl_instance_t *
+output_instance(void)
+{
+  rpl_instance_t *instance;
+#if RPL_DSCP_MAP_SIZE > 0
+  uint8_t dscp;
+  uint8_t i;
+#endif /* RPL_DSCP_MAP_SIZE > 0 */
+
+  if(output_instance_id != RPL_OUTPUT_INSTANCE_NONE) {
+    instance = rpl_get_instance(output_instance_id);
+    if(instance != NULL) {
+      return instance;
+    }
+  }
+
+#if RPL_DSCP_MAP_SIZE > 0
+  /* The DSCP is the upper six bits of the traffic class, which
+     straddles the first two octets of the IPv6 header. */
+  dscp = ((UIP_IP_BUF->vtc & 0x0f) << 2) | (UIP_IP_BUF->tcflow >> 6);
+  for(i = 0; i < dscp_map_len; i++) {
+    if(dscp_map[i].dscp == dscp) {
+      instance = rpl_get_instance(dscp_map[i].instance_id);
+      if(instance != NULL) {
+        return instance;
+      }
+      break;
+    }
+  }
+#endif /* RPL_DSCP_MAP_SIZE > 0 */
+
+  return default_instance;
+}
+/*---------------------------------------------------------------------------*/
+rpl_instance_t *
+rpl_get_packet_instance(void)
+{
+  rpl_instance_t *instance;
+  int uip_ext_opt_offset;
+  int last_uip_ext_len;
+
+  last_uip_ext_len = uip_ext_len;
+  uip_ext_len = 0;
+  uip_ext_opt_offset = 2;
+
+  instance = NULL;
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO &&
+     UIP_HBHO_BUF->len == RPL_HOP_BY_HOP_LEN - 8 &&
+     UIP_EXT_HDR_OPT_RPL_BUF->opt_type == UIP_EXT_HDR_OPT_RPL &&
+     UIP_EXT_HDR_OPT_RPL_BUF->opt_len == RPL_HDR_OPT_LEN) {
+    instance = rpl_get_instance(UIP_EXT_HDR_OPT_RPL_BUF->instance);
+  }
+  uip_ext_len = last_uip_ext_len;
+
+  return instance != NULL ? instance : output_instance();
+}
+/*---------------------------------------------------------------------------*/
+uip_ds6_route_t *
+rpl_lookup_route(uip_ipaddr_t *addr)
+{
+  rpl_instance_t *instance;
+
+  instance = rpl_get_packet_instance();
+  if(instance == NULL) {
+    return uip_ds6_route_lookup(addr);
+  }
+  return uip_ds6_route_lookup_table(addr, RPL_ROUTE_TABLE(instance));
+}
+/*---------------------------------------------------------------------------*/
+uip_ipaddr_t *
+rpl_get_default_nexthop(void)
+{
+  rpl_instance_t *instance;
+  rpl_parent_t *parent;
+
+  /* The default routes of all instances are on the default router
+     list, so packets of any other instance than the default one go to
+     the preferred parent of their instance. */
+  instance = rpl_get_packet_instance();
+  if(instance == NULL || instance->current_dag == NULL ||
+     !instance->current_dag->joined) {
+    return uip_ds6_defrt_choose();
+  }
+
+#if RPL_WITH_PROBING
+  /* A parent that is due a probe is probed with the packet instead,
+     if it is closer to the root than this node. */
+  parent = instance->probing_target;
+  if(parent != NULL && parent->dag == instance->current_dag &&
+     parent != parent->dag->preferred_parent &&
+     DAG_RANK(parent->rank, instance) < DAG_RANK(parent->dag->rank, instance) &&
+     rpl_get_nbr(parent) != NULL) {
+    PRINTF("RPL: probing with a packet\n");
+    return rpl_get_parent_ipaddr(parent);
+  }
+#endif /* RPL_WITH_PROBING */
+
+  parent = instance->current_dag->preferred_parent;
+  if(instance != default_instance && parent != NULL) {
+    return rpl_get_parent_ipaddr(parent);
+  }
+  return uip_ds6_defrt_choose();
+}
 /*---------------------------------------------------------------------------*/
 int
 rpl_verify_header(int uip_ext_opt_offset)
@@ -103,7 +260,8 @@ rpl_verify_header(int uip_ext_opt_offset)
        the packet to be forwareded in the first place. We drop any
        routes that go through the neighbor that sent the packet to
        us. */
-    route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr);
+    route = uip_ds6_route_lookup_table(&UIP_IP_BUF->destipaddr,
+                                       RPL_ROUTE_TABLE(instance));
     if(route != NULL) {
       uip_ds6_route_rm(route);
     }
@@ -139,6 +297,7 @@ rpl_verify_header(int uip_ext_opt_offset)
     /* A rank error was signalled, attempt to repair it by updating
      * the sender's rank from ext header */
     sender->rank = sender_rank;
+    sender->flags &= ~RPL_PARENT_FLAG_PATH_METRIC_VALID;
     rpl_select_dag(instance, sender);
   }
 
@@ -148,8 +307,9 @@ rpl_verify_header(int uip_ext_opt_offset)
 	   sender_closer);
     /* Attempt to repair the loop by sending a unicast DIO back to the sender
      * so that it gets a fresh update of our rank. */
-    if(sender != NULL) {
-      instance->unicast_dio_target = sender;
+    if(sender != NULL && rpl_get_parent_ipaddr(sender) != NULL) {
+      uip_ipaddr_copy(&instance->unicast_dio_target,
+                      rpl_get_parent_ipaddr(sender));
       rpl_schedule_unicast_dio_immediately(instance);
     }
     if(UIP_EXT_HDR_OPT_RPL_BUF->flags & RPL_HDR_OPT_RANK_ERR) {
@@ -171,7 +331,7 @@ rpl_verify_header(int uip_ext_opt_offset)
 }
 /*---------------------------------------------------------------------------*/
 static void
-set_rpl_opt(unsigned uip_ext_opt_offset)
+set_rpl_opt(unsigned uip_ext_opt_offset, rpl_instance_t *instance)
 {
   uint8_t temp_len;
 
@@ -183,7 +343,7 @@ set_rpl_opt(unsigned uip_ext_opt_offset)
   UIP_EXT_HDR_OPT_RPL_BUF->opt_type = UIP_EXT_HDR_OPT_RPL;
   UIP_EXT_HDR_OPT_RPL_BUF->opt_len = RPL_HDR_OPT_LEN;
   UIP_EXT_HDR_OPT_RPL_BUF->flags = 0;
-  UIP_EXT_HDR_OPT_RPL_BUF->instance = 0;
+  UIP_EXT_HDR_OPT_RPL_BUF->instance = instance->instance_id;
   UIP_EXT_HDR_OPT_RPL_BUF->senderrank = 0;
   uip_len += RPL_HOP_BY_HOP_LEN;
   temp_len = UIP_IP_BUF->len[1];
@@ -233,12 +393,18 @@ rpl_update_header_empty(void)
   default:
 #if RPL_INSERT_HBH_OPTION
     PRINTF("RPL: No hop-by-hop option found, creating it\n");
+    instance = output_instance();
+    if(instance == NULL) {
+      PRINTF("RPL: No instance to send the packet in\n");
+      uip_ext_len = last_uip_ext_len;
+      return 0;
+    }
     if(uip_len + RPL_HOP_BY_HOP_LEN > UIP_BUFSIZE) {
       PRINTF("RPL: Packet too long: impossible to add hop-by-hop option\n");
       uip_ext_len = last_uip_ext_len;
       return 0;
     }
-    set_rpl_opt(uip_ext_opt_offset);
+    set_rpl_opt(uip_ext_opt_offset, instance);
     uip_ext_len = last_uip_ext_len + RPL_HOP_BY_HOP_LEN;
 #endif
     return 0;
@@ -254,7 +420,8 @@ rpl_update_header_empty(void)
        general not go back up again. If this happens, a
        RPL_HDR_OPT_FWD_ERR should be flagged. */
     if((UIP_EXT_HDR_OPT_RPL_BUF->flags & RPL_HDR_OPT_DOWN)) {
-      if(uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr) == NULL) {
+      if(uip_ds6_route_lookup_table(&UIP_IP_BUF->destipaddr,
+                                    RPL_ROUTE_TABLE(instance)) == NULL) {
         UIP_EXT_HDR_OPT_RPL_BUF->flags |= RPL_HDR_OPT_FWD_ERR;
         PRINTF("RPL forwarding error\n");
         /* We should send back the packet to the originating parent,
@@ -271,7 +438,8 @@ rpl_update_header_empty(void)
       /* Set the down extension flag correctly as described in Section
          11.2 of RFC6550. If the packet progresses along a DAO route,
          the down flag should be set. */
-      if(uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr) == NULL) {
+      if(uip_ds6_route_lookup_table(&UIP_IP_BUF->destipaddr,
+                                    RPL_ROUTE_TABLE(instance)) == NULL) {
         /* No route was found, so this packet will go towards the RPL
            root. If so, we should not set the down flag. */
         UIP_EXT_HDR_OPT_RPL_BUF->flags &= ~RPL_HDR_OPT_DOWN;
@@ -295,6 +463,7 @@ rpl_update_header_empty(void)
 int
 rpl_update_header_final(uip_ipaddr_t *addr)
 {
+  rpl_instance_t *instance;
   rpl_parent_t *parent;
   int uip_ext_opt_offset;
   int last_uip_ext_len;
@@ -313,16 +482,21 @@ rpl_update_header_final(uip_ipaddr_t *addr)
     if(UIP_EXT_HDR_OPT_BUF->type == UIP_EXT_HDR_OPT_RPL) {
       if(UIP_EXT_HDR_OPT_RPL_BUF->senderrank == 0) {
         PRINTF("RPL: Updating RPL option\n");
-        if(default_instance == NULL || !default_instance->used || !default_instance->current_dag->joined) {
-          PRINTF("RPL: Unable to add hop-by-hop extension header: incorrect default instance\n");
+        /* The option was inserted with the instance of the packet */
+        instance = rpl_get_instance(UIP_EXT_HDR_OPT_RPL_BUF->instance);
+        if(instance == NULL || !instance->current_dag->joined) {
+          PRINTF("RPL: Unable to add hop-by-hop extension header: incorrect instance\n");
           return 1;
         }
-        parent = rpl_find_parent(default_instance->current_dag, addr);
-        if(parent == NULL || parent != parent->dag->preferred_parent) {
+        /* Packets sent to the preferred parent, or to another parent
+           that is closer to the root when probing it, go upwards */
+        parent = rpl_find_parent(instance->current_dag, addr);
+        if(parent == NULL || (parent != parent->dag->preferred_parent &&
+                              DAG_RANK(parent->rank, instance) >=
+                              DAG_RANK(parent->dag->rank, instance))) {
           UIP_EXT_HDR_OPT_RPL_BUF->flags = RPL_HDR_OPT_DOWN;
         }
-        UIP_EXT_HDR_OPT_RPL_BUF->instance = default_instance->instance_id;
-        UIP_EXT_HDR_OPT_RPL_BUF->senderrank = UIP_HTONS(default_instance->current_dag->rank);
+        UIP_EXT_HDR_OPT_RPL_BUF->senderrank = UIP_HTONS(instance->current_dag->rank);
       }
     }
   }
@@ -393,11 +567,250 @@ void
 rpl_insert_header(void)
 {
 #if RPL_INSERT_HBH_OPTION
-  if(default_instance != NULL && !uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+  if(!uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
     rpl_update_header_empty();
   }
 #endif
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_NON_STORING
+/* Is there a source routing header, possibly after hop-by-hop or
+   destination options? On return, uip_ext_len is the offset of the
+   header that ends the search. */
+static int
+find_srh(void)
+{
+  uint8_t *next_hdr;
+
+  uip_ext_len = 0;
+  next_hdr = &UIP_IP_BUF->proto;
+  while(*next_hdr == UIP_PROTO_HBHO || *next_hdr == UIP_PROTO_DESTO) {
+    if(UIP_IPH_LEN + uip_ext_len + 8 > uip_len) {
+      return 0;
+    }
+    next_hdr = &UIP_EXT_BUF->next;
+    uip_ext_len += (UIP_EXT_BUF->len << 3) + 8;
+  }
+  return *next_hdr == UIP_PROTO_ROUTING &&
+    UIP_IPH_LEN + uip_ext_len + RPL_RH_LEN + RPL_SRH_LEN <= uip_len &&
+    UIP_RH_BUF->routing_type == RPL_RH_TYPE_SRH;
+}
+/*---------------------------------------------------------------------------*/
+/* The number of leading octets that two addresses share */
+static uint8_t
+common_prefix_len(const uip_ipaddr_t *a, const uip_ipaddr_t *b)
+{
+  uint8_t i;
+
+  for(i = 0; i < 15 && a->u8[i] == b->u8[i]; i++);
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_link_local(uip_ipaddr_t *ipaddr, const uip_ipaddr_t *addr)
+{
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  memcpy(&ipaddr->u8[8], &addr->u8[8], 8);
+}
+#endif /* RPL_WITH_NON_STORING */
+/*---------------------------------------------------------------------------*/
+int
+rpl_insert_srh_header(void)
+{
+#if RPL_WITH_NON_STORING
+  rpl_dag_t *dag;
+  const rpl_ns_id_t *route;
+  uip_ipaddr_t first_hop_addr;
+  uip_ipaddr_t node_addr;
+  uint8_t path_len;
+  uint8_t prefix_len;
+  uint8_t cmpr;
+  uint8_t padding;
+  uint8_t i;
+  uint16_t ext_len;
+  uint8_t *addr_ptr;
+  rpl_instance_t *instance;
+
+  instance = rpl_get_packet_instance();
+  if(!RPL_IS_NON_STORING(instance) ||
+     instance->current_dag == NULL ||
+     instance->current_dag->rank != ROOT_RANK(instance) ||
+     uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     UIP_IP_BUF->proto == UIP_PROTO_ROUTING) {
+    return 1;
+  }
+  dag = instance->current_dag;
+
+  /* Only nodes of the DODAG are source routed. The route lists the
+     nodes from the destination up to the first hop, which becomes the
+     destination of the packet; the other nodes, the destination last,
+     are listed in the header. */
+  if(memcmp(&UIP_IP_BUF->destipaddr, &dag->prefix_info.prefix, 8) != 0) {
+    return 1;
+  }
+  path_len = rpl_ns_get_route(dag, &UIP_IP_BUF->destipaddr, &route);
+  if(path_len <= 1) {
+    /* Unreachable, or a child of the root, which is reached directly */
+    return 1;
+  }
+  path_len--;
+
+  /* All addresses share the prefix that is elided with the first hop,
+     which stays in the destination field while the path is followed */
+  rpl_ns_get_node_global_addr(&first_hop_addr, route[path_len]);
+  cmpr = 15;
+  for(i = 0; i < path_len; i++) {
+    rpl_ns_get_node_global_addr(&node_addr, route[i]);
+    prefix_len = common_prefix_len(&node_addr, &first_hop_addr);
+    if(prefix_len < cmpr) {
+      cmpr = prefix_len;
+    }
+  }
+
+  ext_len = RPL_RH_LEN + RPL_SRH_LEN + path_len * (16 - cmpr);
+  padding = (8 - (ext_len & 7)) & 7;
+  ext_len += padding;
+
+  PRINTF("RPL: Inserting SRH, path length %u, compression %u, length %u\n",
+         path_len, cmpr, ext_len);
+
+  /* The hop-by-hop option is not used on the way down */
+  rpl_remove_header();
+
+  if(uip_len + ext_len > UIP_LINK_MTU ||
+     uip_len + ext_len > UIP_BUFSIZE - UIP_LLH_LEN) {
+    PRINTF("RPL: Packet too long: impossible to add source routing header\n");
+    return 0;
+  }
+
+  uip_ext_len = 0;
+  memmove(&uip_buf[uip_l2_l3_hdr_len + ext_len], UIP_EXT_BUF,
+          uip_len - UIP_IPH_LEN);
+  memset(UIP_RH_BUF, 0, ext_len);
+  UIP_RH_BUF->next = UIP_IP_BUF->proto;
+  UIP_RH_BUF->len = (ext_len >> 3) - 1;
+  UIP_RH_BUF->routing_type = RPL_RH_TYPE_SRH;
+  UIP_RH_BUF->seg_left = path_len;
+  UIP_RPL_SRH_BUF->cmpr = (cmpr << 4) | cmpr;
+  UIP_RPL_SRH_BUF->pad = padding << 4;
+
+  /* Fill in the addresses from the destination upwards */
+  addr_ptr = (uint8_t *)UIP_RH_BUF + RPL_RH_LEN + RPL_SRH_LEN +
+    path_len * (16 - cmpr);
+  for(i = 0; i < path_len; i++) {
+    addr_ptr -= 16 - cmpr;
+    rpl_ns_get_node_global_addr(&node_addr, route[i]);
+    memcpy(addr_ptr, &node_addr.u8[cmpr], 16 - cmpr);
+  }
+
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &first_hop_addr);
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+  uip_len += ext_len;
+  UIP_IP_BUF->len[0] = (uip_len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (uip_len - UIP_IPH_LEN) & 0xff;
+  uip_ext_len = ext_len;
+#endif /* RPL_WITH_NON_STORING */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_process_srh_header(void)
+{
+#if RPL_WITH_NON_STORING
+  uint8_t cmpri;
+  uint8_t cmpre;
+  uint8_t cmpr;
+  uint8_t padding;
+  uint8_t path_len;
+  uint8_t segments_left;
+  uint16_t ext_len;
+  uint8_t *addr_ptr;
+  uip_ipaddr_t current_dest_addr;
+
+  /* uip_ext_len is the offset of the routing header */
+  if(UIP_RH_BUF->routing_type != RPL_RH_TYPE_SRH) {
+    return 0;
+  }
+
+  segments_left = UIP_RH_BUF->seg_left;
+  ext_len = (UIP_RH_BUF->len << 3) + 8;
+  cmpri = UIP_RPL_SRH_BUF->cmpr >> 4;
+  cmpre = UIP_RPL_SRH_BUF->cmpr & 0x0f;
+  padding = UIP_RPL_SRH_BUF->pad >> 4;
+
+  if(UIP_IPH_LEN + uip_ext_len + ext_len > uip_len ||
+     ext_len < RPL_RH_LEN + RPL_SRH_LEN + padding + (16 - cmpre)) {
+    PRINTF("RPL: Bad SRH length\n");
+    return 0;
+  }
+  path_len = ((ext_len - padding - RPL_RH_LEN - RPL_SRH_LEN - (16 - cmpre)) /
+              (16 - cmpri)) + 1;
+  if(segments_left > path_len) {
+    PRINTF("RPL: Bad SRH segments left %u, path length %u\n",
+           segments_left, path_len);
+    return 0;
+  }
+
+  /* As per RFC 6554, swap the destination with the next address */
+  addr_ptr = (uint8_t *)UIP_RH_BUF + RPL_RH_LEN + RPL_SRH_LEN +
+    (path_len - segments_left) * (16 - cmpri);
+  cmpr = segments_left == 1 ? cmpre : cmpri;
+
+  uip_ipaddr_copy(&current_dest_addr, &UIP_IP_BUF->destipaddr);
+  memcpy(&UIP_IP_BUF->destipaddr.u8[cmpr], addr_ptr, 16 - cmpr);
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+    PRINTF("RPL: Multicast address in SRH\n");
+    uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &current_dest_addr);
+    return 0;
+  }
+  memcpy(addr_ptr, &current_dest_addr.u8[cmpr], 16 - cmpr);
+  UIP_RH_BUF->seg_left--;
+
+  PRINTF("RPL: SRH next hop ");
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF(", segments left %u\n", UIP_RH_BUF->seg_left);
+  return 1;
+#else /* RPL_WITH_NON_STORING */
+  return 0;
+#endif /* RPL_WITH_NON_STORING */
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_srh_get_next_hop(uip_ipaddr_t *ipaddr)
+{
+#if RPL_WITH_NON_STORING
+  uint8_t last_uip_ext_len;
+  int found;
+  rpl_dag_t *dag;
+  const rpl_ns_id_t *route;
+  rpl_instance_t *instance;
+
+  instance = rpl_get_packet_instance();
+  if(!RPL_IS_NON_STORING(instance) ||
+     uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+    return 0;
+  }
+
+  /* The destination of a source routed packet is always a neighbor */
+  last_uip_ext_len = uip_ext_len;
+  found = find_srh();
+  uip_ext_len = last_uip_ext_len;
+  if(found) {
+    set_link_local(ipaddr, &UIP_IP_BUF->destipaddr);
+    return 1;
+  }
+
+  /* The root reaches its children without a source routing header */
+  dag = instance->current_dag;
+  if(dag != NULL && dag->rank == ROOT_RANK(instance) &&
+     memcmp(&UIP_IP_BUF->destipaddr, &dag->prefix_info.prefix, 8) == 0 &&
+     rpl_ns_get_route(dag, &UIP_IP_BUF->destipaddr, &route) == 1) {
+    set_link_local(ipaddr, &UIP_IP_BUF->destipaddr);
+    return 1;
+  }
+#endif /* RPL_WITH_NON_STORING */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 
 /** @}*/
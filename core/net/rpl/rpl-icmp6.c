@@ -51,8 +51,10 @@
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/packetbuf.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
+#include "lib/random.h"
 
 #include <limits.h>
 #include <string.h>
@@ -92,6 +94,26 @@ extern rpl_of_t RPL_OF;
 #if RPL_CONF_MULTICAST
 static uip_mcast6_route_t *mcast_group;
 #endif
+
+/* Nodes in a DAG answer joining nodes, unless they are leaves */
+#define FAST_JOIN_REPLY (RPL_WITH_FAST_JOIN && !RPL_LEAF_ONLY)
+
+#if RPL_WITH_DAO_AGGREGATION
+/* The targets that are waiting to be sent in an aggregated DAO */
+struct dao_target {
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  uint8_t lifetime;
+};
+static struct dao_target aggregate_targets[RPL_DAO_AGGREGATION_TARGETS];
+static uint8_t aggregate_num;
+static rpl_instance_t *aggregate_instance;
+static struct ctimer aggregation_timer;
+
+/* The room for a target option, with the transit options that may
+   have to follow it and the target before it */
+#define DAO_TARGET_SPACE (4 + 16 + 2 * (6 + 16))
+#endif /* RPL_WITH_DAO_AGGREGATION */
 /*---------------------------------------------------------------------------*/
 /* Initialise RPL ICMPv6 message handlers */
 UIP_ICMP6_HANDLER(dis_handler, ICMP6_RPL, RPL_CODE_DIS, dis_input);
@@ -147,20 +169,131 @@ set16(uint8_t *buffer, int pos, uint16_t value)
   buffer[pos++] = value & 0xff;
 }
 /*---------------------------------------------------------------------------*/
+static int
+option_len(unsigned char *buffer, int pos)
+{
+  if(buffer[pos] == RPL_OPTION_PAD1) {
+    return 1;
+  }
+  /* The option consists of a two-byte header and a payload. */
+  return 2 + buffer[pos + 1];
+}
+/*---------------------------------------------------------------------------*/
+#if FAST_JOIN_REPLY
+/* Does the instance match the predicates of a solicited information
+   option? */
+static int
+solicited(rpl_instance_t *instance, unsigned char *option)
+{
+  rpl_dag_t *dag;
+
+  dag = instance->current_dag;
+  if(dag == NULL || !dag->joined) {
+    return 0;
+  }
+  if((option[3] & RPL_DIS_SOLICITED_I) && option[2] != instance->instance_id) {
+    return 0;
+  }
+  if((option[3] & RPL_DIS_SOLICITED_D) &&
+     memcmp(&option[4], &dag->dag_id, sizeof(dag->dag_id)) != 0) {
+    return 0;
+  }
+  if((option[3] & RPL_DIS_SOLICITED_V) && option[20] != dag->version) {
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Answer a joining node with a unicast DIO, unless the instance has
+   just done so for another node. */
+static void
+fast_join_dio(rpl_instance_t *instance, uip_ipaddr_t *addr)
+{
+  clock_time_t now;
+
+  now = clock_time();
+  if(!ctimer_expired(&instance->unicast_dio_timer) ||
+     (instance->fast_join_dio_time != 0 &&
+      now - instance->fast_join_dio_time < RPL_FAST_JOIN_DIO_MIN_INTERVAL)) {
+    PRINTF("RPL: Fast join DIO rate limited\n");
+    return;
+  }
+  instance->fast_join_dio_time = now;
+  uip_ipaddr_copy(&instance->unicast_dio_target, addr);
+  rpl_schedule_unicast_dio(instance,
+                           random_rand() % RPL_FAST_JOIN_DIO_JITTER);
+}
+#endif /* FAST_JOIN_REPLY */
+/*---------------------------------------------------------------------------*/
+static void
+rpl_icmp6_send(uip_ipaddr_t *dest, int code, int payload_len)
+{
+#if RPL_CONF_STATS
+  switch(code) {
+  case RPL_CODE_DIS:
+    rpl_stats.dis_sent++;
+    break;
+  case RPL_CODE_DIO:
+    rpl_stats.dio_sent++;
+    break;
+  case RPL_CODE_DAO:
+    rpl_stats.dao_sent++;
+    break;
+  case RPL_CODE_DAO_ACK:
+    rpl_stats.dao_ack_sent++;
+    break;
+  }
+  rpl_stats.control_bytes_sent += UIP_IPH_LEN + UIP_ICMPH_LEN + payload_len;
+#endif /* RPL_CONF_STATS */
+  uip_icmp6_send(dest, ICMP6_RPL, code, payload_len);
+}
+/*---------------------------------------------------------------------------*/
 static void
 dis_input(void)
 {
   rpl_instance_t *instance;
   rpl_instance_t *end;
+#if FAST_JOIN_REPLY
+  unsigned char *buffer;
+  unsigned char *option;
+  int buffer_length;
+  int i;
+#endif /* FAST_JOIN_REPLY */
+
+  RPL_STAT(rpl_stats.dis_recvd++);
 
   /* DAG Information Solicitation */
   PRINTF("RPL: Received a DIS from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF("\n");
 
+#if FAST_JOIN_REPLY
+  /* A joining node asks for DIOs with a solicited information option */
+  buffer = UIP_ICMP_PAYLOAD;
+  buffer_length = uip_len - uip_l3_icmp_hdr_len;
+  option = NULL;
+  for(i = 2; i + 1 < buffer_length; i += option_len(buffer, i)) {
+    if(buffer[i] == RPL_OPTION_SOLICITED_INFO &&
+       buffer[i + 1] == RPL_DIS_SOLICITED_INFO_LEN &&
+       i + 2 + RPL_DIS_SOLICITED_INFO_LEN <= buffer_length) {
+      option = &buffer[i];
+      break;
+    }
+  }
+#endif /* FAST_JOIN_REPLY */
+
   for(instance = &instance_table[0], end = instance + RPL_MAX_INSTANCES;
       instance < end; ++instance) {
     if(instance->used == 1) {
+#if FAST_JOIN_REPLY
+      if(option != NULL && uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+        if(solicited(instance, option)) {
+          PRINTF("RPL: Multicast DIS from a joining node => unicast DIO\n");
+          fast_join_dio(instance, &UIP_IP_BUF->srcipaddr);
+        }
+        continue;
+      }
+#endif /* FAST_JOIN_REPLY */
 #if RPL_LEAF_ONLY
       if(!uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
 	PRINTF("RPL: LEAF ONLY Multicast DIS will NOT reset DIO timer\n");
@@ -183,6 +316,7 @@ dis_output(uip_ipaddr_t *addr)
 {
   unsigned char *buffer;
   uip_ipaddr_t tmpaddr;
+  int pos;
 
   /*
    * DAG Information Solicitation  - 2 bytes reserved
@@ -195,17 +329,26 @@ dis_output(uip_ipaddr_t *addr)
 
   buffer = UIP_ICMP_PAYLOAD;
   buffer[0] = buffer[1] = 0;
+  pos = 2;
 
   if(addr == NULL) {
     uip_create_linklocal_rplnodes_mcast(&tmpaddr);
     addr = &tmpaddr;
+#if RPL_WITH_FAST_JOIN
+    /* Ask the neighbors in any DAG for a unicast DIO at once. With no
+       predicate flags set, the other fields are ignored. */
+    buffer[pos++] = RPL_OPTION_SOLICITED_INFO;
+    buffer[pos++] = RPL_DIS_SOLICITED_INFO_LEN;
+    memset(&buffer[pos], 0, RPL_DIS_SOLICITED_INFO_LEN);
+    pos += RPL_DIS_SOLICITED_INFO_LEN;
+#endif /* RPL_WITH_FAST_JOIN */
   }
 
   PRINTF("RPL: Sending a DIS to ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
-  uip_icmp6_send(addr, ICMP6_RPL, RPL_CODE_DIS, 2);
+  rpl_icmp6_send(addr, RPL_CODE_DIS, pos);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -220,6 +363,8 @@ dio_input(void)
   uip_ipaddr_t from;
   uip_ds6_nbr_t *nbr;
 
+  RPL_STAT(rpl_stats.dio_recvd++);
+
   memset(&dio, 0, sizeof(dio));
 
   /* Set default values in case the DIO configuration option is missing. */
@@ -559,25 +704,162 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
       (unsigned)dag->rank);
   PRINT6ADDR(uc_addr);
   PRINTF("\n");
-  uip_icmp6_send(uc_addr, ICMP6_RPL, RPL_CODE_DIO, pos);
+  rpl_icmp6_send(uc_addr, RPL_CODE_DIO, pos);
 #else /* RPL_LEAF_ONLY */
   /* Unicast requests get unicast replies! */
   if(uc_addr == NULL) {
     PRINTF("RPL: Sending a multicast-DIO with rank %u\n",
         (unsigned)instance->current_dag->rank);
     uip_create_linklocal_rplnodes_mcast(&addr);
-    uip_icmp6_send(&addr, ICMP6_RPL, RPL_CODE_DIO, pos);
+    rpl_icmp6_send(&addr, RPL_CODE_DIO, pos);
   } else {
     PRINTF("RPL: Sending unicast-DIO with rank %u to ",
         (unsigned)instance->current_dag->rank);
     PRINT6ADDR(uc_addr);
     PRINTF("\n");
-    uip_icmp6_send(uc_addr, ICMP6_RPL, RPL_CODE_DIO, pos);
+    rpl_icmp6_send(uc_addr, RPL_CODE_DIO, pos);
   }
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
 static void
+forward_target(int *forward, rpl_instance_t *instance, uip_ipaddr_t *prefix,
+               uint8_t prefixlen, uint8_t lifetime)
+{
+#if RPL_WITH_DAO_AGGREGATION
+  /* Targets that do not fit in the aggregated DAO are forwarded with
+     the DAO they came in */
+  if(dao_aggregate_target(instance, prefix, prefixlen, lifetime)) {
+    return;
+  }
+#endif /* RPL_WITH_DAO_AGGREGATION */
+  *forward = 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Handle one target of a DAO. Returns 1 if the target was accepted, and
+   sets *forward if the DAO has to be forwarded to our parent. */
+static int
+dao_input_target(rpl_instance_t *instance, rpl_dag_t *dag,
+                 uip_ipaddr_t *dao_sender_addr, int learned_from,
+                 uip_ipaddr_t *prefix, uint8_t prefixlen, uint8_t lifetime,
+                 uip_ipaddr_t *dao_parent_addr, int *forward)
+{
+  uip_ds6_route_t *rep;
+  uip_ds6_nbr_t *nbr;
+
+  PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
+          (unsigned)lifetime, (unsigned)prefixlen);
+  PRINT6ADDR(prefix);
+  PRINTF("\n");
+
+#if RPL_WITH_NON_STORING
+  if(RPL_IS_NON_STORING(instance)) {
+    /* Only the root keeps track of the DODAG */
+    if(dag->rank != ROOT_RANK(instance)) {
+      PRINTF("RPL: Ignoring a non-storing DAO when not root\n");
+      return 0;
+    }
+    if(uip_is_addr_unspecified(dao_parent_addr)) {
+      PRINTF("RPL: Ignoring a non-storing DAO without parent address\n");
+      return 0;
+    }
+    if(lifetime == RPL_ZERO_LIFETIME) {
+      PRINTF("RPL: No-Path DAO received\n");
+      rpl_ns_expire_parent(dag, prefix, dao_parent_addr);
+    } else if(rpl_ns_update_node(dag, prefix, dao_parent_addr,
+                                  RPL_LIFETIME(instance, lifetime)) ==
+              RPL_NS_ID_NONE) {
+      RPL_STAT(rpl_stats.mem_overflows++);
+      PRINTF("RPL: Could not add a non-storing node after receiving a DAO\n");
+      return 0;
+    }
+    return 1;
+  }
+#endif /* RPL_WITH_NON_STORING */
+
+#if RPL_CONF_MULTICAST
+  if(uip_is_addr_mcast_global(prefix)) {
+    mcast_group = uip_mcast6_route_add(prefix);
+    if(mcast_group) {
+      mcast_group->dag = dag;
+      mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
+    }
+    goto fwd_dao;
+  }
+#endif
+
+  rep = uip_ds6_route_lookup_table(prefix, RPL_ROUTE_TABLE(instance));
+
+  if(lifetime == RPL_ZERO_LIFETIME) {
+    PRINTF("RPL: No-Path DAO received\n");
+    /* No-Path DAO received; invoke the route purging routine. */
+    if(rep != NULL &&
+       rep->state.nopath_received == 0 &&
+       rep->length == prefixlen &&
+       uip_ds6_route_nexthop(rep) != NULL &&
+       uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), dao_sender_addr)) {
+      PRINTF("RPL: Setting expiration timer for prefix ");
+      PRINT6ADDR(prefix);
+      PRINTF("\n");
+      rep->state.nopath_received = 1;
+      RPL_ROUTE_SET_LIFETIME(rep, RPL_NOPATH_REMOVAL_DELAY);
+
+      /* We forward the incoming No-Path DAO to our parent, if we have
+         one. */
+      forward_target(forward, instance, prefix, prefixlen, lifetime);
+      return 1;
+    }
+    return 0;
+  }
+
+  PRINTF("RPL: adding DAO route\n");
+
+  if((nbr = uip_ds6_nbr_lookup(dao_sender_addr)) == NULL) {
+    if((nbr = uip_ds6_nbr_add(dao_sender_addr,
+                              (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                              0, NBR_REACHABLE)) != NULL) {
+      /* set reachable timer */
+      stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+      PRINTF("RPL: Neighbor added to neighbor cache ");
+      PRINT6ADDR(dao_sender_addr);
+      PRINTF(", ");
+      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      PRINTF("\n");
+    } else {
+      PRINTF("RPL: Out of Memory, dropping DAO from ");
+      PRINT6ADDR(dao_sender_addr);
+      PRINTF(", ");
+      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      PRINTF("\n");
+      return 0;
+    }
+  } else {
+    PRINTF("RPL: Neighbor already in neighbor cache\n");
+  }
+
+  rep = rpl_add_route(dag, prefix, prefixlen, dao_sender_addr);
+  if(rep == NULL) {
+    RPL_STAT(rpl_stats.mem_overflows++);
+    PRINTF("RPL: Could not add a route after receiving a DAO\n");
+    return 0;
+  }
+
+  RPL_ROUTE_SET_LIFETIME(rep, RPL_LIFETIME(instance, lifetime));
+  rep->state.learned_from = learned_from;
+  rep->state.nopath_received = 0;
+
+#if RPL_CONF_MULTICAST
+fwd_dao:
+#endif
+
+  if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
+    forward_target(forward, instance, prefix, prefixlen, lifetime);
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
 dao_input(void)
 {
   uip_ipaddr_t dao_sender_addr;
@@ -589,24 +871,25 @@ dao_input(void)
   uint8_t lifetime;
   uint8_t prefixlen;
   uint8_t flags;
-  uint8_t subopt_type;
   /*
   uint8_t pathcontrol;
   uint8_t pathsequence;
   */
   uip_ipaddr_t prefix;
-  uip_ds6_route_t *rep;
+  uip_ipaddr_t dao_parent_addr;
   uint8_t buffer_length;
   int pos;
-  int len;
   int i;
+  int j;
   int learned_from;
+  int accepted;
+  int forward;
   rpl_parent_t *parent;
-  uip_ds6_nbr_t *nbr;
 
-  prefixlen = 0;
   parent = NULL;
 
+  RPL_STAT(rpl_stats.dao_recvd++);
+
   uip_ipaddr_copy(&dao_sender_addr, &UIP_IP_BUF->srcipaddr);
 
   /* Destination Advertisement Object */
@@ -627,8 +910,6 @@ dao_input(void)
     goto discard;
   }
 
-  lifetime = instance->default_lifetime;
-
   flags = buffer[pos++];
   /* reserved */
   pos++;
@@ -649,7 +930,9 @@ dao_input(void)
 
   PRINTF("RPL: DAO from %s\n",
          learned_from == RPL_ROUTE_FROM_UNICAST_DAO? "unicast": "multicast");
-  if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
+  /* In non-storing mode, DAOs come from anywhere in the DODAG */
+  if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO &&
+     !RPL_IS_NON_STORING(instance)) {
     /* Check whether this is a DAO forwarding loop. */
     parent = rpl_find_parent(dag, &dao_sender_addr);
     /* check if this is a new DAO registration with an "illegal" rank */
@@ -659,7 +942,7 @@ dao_input(void)
       PRINTF("RPL: Loop detected when receiving a unicast DAO from a node with a lower rank! (%u < %u)\n",
           DAG_RANK(parent->rank, instance), DAG_RANK(dag->rank, instance));
       parent->rank = INFINITE_RANK;
-      parent->flags |= RPL_PARENT_FLAG_UPDATED;
+      RPL_PARENT_UPDATED(parent);
       goto discard;
     }
 
@@ -667,139 +950,54 @@ dao_input(void)
     if(parent != NULL && parent == dag->preferred_parent) {
       PRINTF("RPL: Loop detected when receiving a unicast DAO from our parent\n");
       parent->rank = INFINITE_RANK;
-      parent->flags |= RPL_PARENT_FLAG_UPDATED;
+      RPL_PARENT_UPDATED(parent);
       goto discard;
     }
   }
 
-  /* Check if there are any RPL options present. */
-  for(i = pos; i < buffer_length; i += len) {
-    subopt_type = buffer[i];
-    if(subopt_type == RPL_OPTION_PAD1) {
-      len = 1;
-    } else {
-      /* The option consists of a two-byte header and a payload. */
-      len = 2 + buffer[i + 1];
-    }
-
-    switch(subopt_type) {
-    case RPL_OPTION_TARGET:
-      /* Handle the target option. */
-      prefixlen = buffer[i + 3];
-      memset(&prefix, 0, sizeof(prefix));
-      memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
-      break;
-    case RPL_OPTION_TRANSIT:
-      /* The path sequence and control are ignored. */
-      /*      pathcontrol = buffer[i + 3];
-              pathsequence = buffer[i + 4];*/
-      lifetime = buffer[i + 5];
-      /* The parent address is also ignored. */
-      break;
+  /* A DAO may carry several targets. Each group of targets is followed
+     by the transit information that applies to all of them. */
+  accepted = 0;
+  forward = 0;
+  for(i = pos; i < buffer_length; i += option_len(buffer, i)) {
+    if(buffer[i] != RPL_OPTION_TARGET) {
+      continue;
     }
-  }
-
-  PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
-          (unsigned)lifetime, (unsigned)prefixlen);
-  PRINT6ADDR(&prefix);
-  PRINTF("\n");
-
-#if RPL_CONF_MULTICAST
-  if(uip_is_addr_mcast_global(&prefix)) {
-    mcast_group = uip_mcast6_route_add(&prefix);
-    if(mcast_group) {
-      mcast_group->dag = dag;
-      mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
-    }
-    goto fwd_dao;
-  }
-#endif
-
-  rep = uip_ds6_route_lookup(&prefix);
-
-  if(lifetime == RPL_ZERO_LIFETIME) {
-    PRINTF("RPL: No-Path DAO received\n");
-    /* No-Path DAO received; invoke the route purging routine. */
-    if(rep != NULL &&
-       rep->state.nopath_received == 0 &&
-       rep->length == prefixlen &&
-       uip_ds6_route_nexthop(rep) != NULL &&
-       uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &dao_sender_addr)) {
-      PRINTF("RPL: Setting expiration timer for prefix ");
-      PRINT6ADDR(&prefix);
-      PRINTF("\n");
-      rep->state.nopath_received = 1;
-      rep->state.lifetime = RPL_NOPATH_REMOVAL_DELAY;
-
-      /* We forward the incoming No-Path DAO to our parent, if we have
-         one. */
-      if(dag->preferred_parent != NULL &&
-         rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
-        PRINTF("RPL: Forwarding No-Path DAO to parent ");
-        PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
-        PRINTF("\n");
-        uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
-                       ICMP6_RPL, RPL_CODE_DAO, buffer_length);
-      }
-      if(flags & RPL_DAO_K_FLAG) {
-        dao_ack_output(instance, &dao_sender_addr, sequence);
+    prefixlen = buffer[i + 3];
+    memset(&prefix, 0, sizeof(prefix));
+    memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+
+    lifetime = instance->default_lifetime;
+    memset(&dao_parent_addr, 0, sizeof(dao_parent_addr));
+    for(j = i; j < buffer_length; j += option_len(buffer, j)) {
+      if(buffer[j] == RPL_OPTION_TRANSIT) {
+        /* The path sequence and control are ignored. */
+        /*      pathcontrol = buffer[j + 3];
+                pathsequence = buffer[j + 4];*/
+        lifetime = buffer[j + 5];
+        /* The parent address is only present in non-storing mode. */
+        if(option_len(buffer, j) >= 6 + 16) {
+          memcpy(&dao_parent_addr, buffer + j + 6, 16);
+        }
+        break;
       }
     }
-    goto discard;
-  }
 
-  PRINTF("RPL: adding DAO route\n");
-
-  if((nbr = uip_ds6_nbr_lookup(&dao_sender_addr)) == NULL) {
-    if((nbr = uip_ds6_nbr_add(&dao_sender_addr,
-                              (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER),
-                              0, NBR_REACHABLE)) != NULL) {
-      /* set reachable timer */
-      stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
-      PRINTF("RPL: Neighbor added to neighbor cache ");
-      PRINT6ADDR(&dao_sender_addr);
-      PRINTF(", ");
-      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
-      PRINTF("\n");
-    } else {
-      PRINTF("RPL: Out of Memory, dropping DAO from ");
-      PRINT6ADDR(&dao_sender_addr);
-      PRINTF(", ");
-      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
-      PRINTF("\n");
-      goto discard;
-    }
-  } else {
-    PRINTF("RPL: Neighbor already in neighbor cache\n");
+    accepted |= dao_input_target(instance, dag, &dao_sender_addr,
+                                 learned_from, &prefix, prefixlen, lifetime,
+                                 &dao_parent_addr, &forward);
   }
 
-  rep = rpl_add_route(dag, &prefix, prefixlen, &dao_sender_addr);
-  if(rep == NULL) {
-    RPL_STAT(rpl_stats.mem_overflows++);
-    PRINTF("RPL: Could not add a route after receiving a DAO\n");
-    goto discard;
+  if(forward && dag->preferred_parent != NULL &&
+     rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
+    PRINTF("RPL: Forwarding DAO to parent ");
+    PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
+    PRINTF("\n");
+    rpl_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
+                   RPL_CODE_DAO, buffer_length);
   }
-
-  rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
-  rep->state.learned_from = learned_from;
-  rep->state.nopath_received = 0;
-
-#if RPL_CONF_MULTICAST
-fwd_dao:
-#endif
-
-  if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
-    if(dag->preferred_parent != NULL &&
-       rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
-      PRINTF("RPL: Forwarding DAO to parent ");
-      PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
-      PRINTF("\n");
-      uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
-                     ICMP6_RPL, RPL_CODE_DAO, buffer_length);
-    }
-    if(flags & RPL_DAO_K_FLAG) {
-      dao_ack_output(instance, &dao_sender_addr, sequence);
-    }
+  if(accepted && (flags & RPL_DAO_K_FLAG)) {
+    dao_ack_output(instance, &dao_sender_addr, sequence);
   }
 
  discard:
@@ -821,13 +1019,74 @@ dao_output(rpl_parent_t *parent, uint8_t lifetime)
   dao_output_target(parent, &prefix, lifetime);
 }
 /*---------------------------------------------------------------------------*/
+static int
+dao_header(unsigned char *buffer, rpl_instance_t *instance, rpl_dag_t *dag)
+{
+  int pos;
+
+  RPL_LOLLIPOP_INCREMENT(dao_sequence);
+  pos = 0;
+
+  buffer[pos++] = instance->instance_id;
+  buffer[pos] = 0;
+#if RPL_DAO_SPECIFY_DAG
+  buffer[pos] |= RPL_DAO_D_FLAG;
+#endif /* RPL_DAO_SPECIFY_DAG */
+#if RPL_CONF_DAO_ACK
+  buffer[pos] |= RPL_DAO_K_FLAG;
+#endif /* RPL_CONF_DAO_ACK */
+  ++pos;
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = dao_sequence;
+#if RPL_DAO_SPECIFY_DAG
+  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
+  pos+=sizeof(dag->dag_id);
+#endif /* RPL_DAO_SPECIFY_DAG */
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+dao_target_option(unsigned char *buffer, int pos, const uip_ipaddr_t *prefix,
+                  uint8_t prefixlen)
+{
+  buffer[pos++] = RPL_OPTION_TARGET;
+  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = prefixlen;
+  memcpy(buffer + pos, prefix, (prefixlen + 7) / CHAR_BIT);
+  pos += ((prefixlen + 7) / CHAR_BIT);
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+dao_transit_option(unsigned char *buffer, int pos, rpl_instance_t *instance,
+                   rpl_dag_t *dag, uip_ipaddr_t *parent_ipaddr,
+                   uint8_t lifetime)
+{
+  buffer[pos++] = RPL_OPTION_TRANSIT;
+  buffer[pos++] = RPL_IS_NON_STORING(instance) ? 4 + 16 : 4;
+  buffer[pos++] = 0; /* flags - ignored */
+  buffer[pos++] = 0; /* path control - ignored */
+  buffer[pos++] = 0; /* path seq - ignored */
+  buffer[pos++] = lifetime;
+  if(RPL_IS_NON_STORING(instance)) {
+    /* The global address of the parent, assumed to be made of the DAG
+       prefix and the interface identifier of its link-local address */
+    memcpy(buffer + pos, &dag->prefix_info.prefix, 8);
+    memcpy(buffer + pos + 8, &parent_ipaddr->u8[8], 8);
+    pos += 16;
+  }
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
 void
 dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
 {
   rpl_dag_t *dag;
   rpl_instance_t *instance;
   unsigned char *buffer;
-  uint8_t prefixlen;
+  uip_ipaddr_t *parent_ipaddr;
+  uip_ipaddr_t *dest_ipaddr;
   int pos;
 
   /* Destination Advertisement Object */
@@ -858,59 +1117,160 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
     PRINTF("RPL dao_output_target error prefix NULL\n");
     return;
   }
+
+  parent_ipaddr = rpl_get_parent_ipaddr(parent);
+  if(parent_ipaddr == NULL) {
+    PRINTF("RPL dao_output_target error parent address NULL\n");
+    return;
+  }
+  /* In non-storing mode, the DAO goes to the root */
+  dest_ipaddr = RPL_IS_NON_STORING(instance) ? &dag->dag_id : parent_ipaddr;
 #ifdef RPL_DEBUG_DAO_OUTPUT
   RPL_DEBUG_DAO_OUTPUT(parent);
 #endif
 
   buffer = UIP_ICMP_PAYLOAD;
 
-  RPL_LOLLIPOP_INCREMENT(dao_sequence);
-  pos = 0;
-
-  buffer[pos++] = instance->instance_id;
-  buffer[pos] = 0;
-#if RPL_DAO_SPECIFY_DAG
-  buffer[pos] |= RPL_DAO_D_FLAG;
-#endif /* RPL_DAO_SPECIFY_DAG */
-#if RPL_CONF_DAO_ACK
-  buffer[pos] |= RPL_DAO_K_FLAG;
-#endif /* RPL_CONF_DAO_ACK */
-  ++pos;
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = dao_sequence;
-#if RPL_DAO_SPECIFY_DAG
-  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
-  pos+=sizeof(dag->dag_id);
-#endif /* RPL_DAO_SPECIFY_DAG */
+  pos = dao_header(buffer, instance, dag);
 
   /* create target subopt */
-  prefixlen = sizeof(*prefix) * CHAR_BIT;
-  buffer[pos++] = RPL_OPTION_TARGET;
-  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = prefixlen;
-  memcpy(buffer + pos, prefix, (prefixlen + 7) / CHAR_BIT);
-  pos += ((prefixlen + 7) / CHAR_BIT);
+  pos = dao_target_option(buffer, pos, prefix, sizeof(*prefix) * CHAR_BIT);
 
   /* Create a transit information sub-option. */
-  buffer[pos++] = RPL_OPTION_TRANSIT;
-  buffer[pos++] = 4;
-  buffer[pos++] = 0; /* flags - ignored */
-  buffer[pos++] = 0; /* path control - ignored */
-  buffer[pos++] = 0; /* path seq - ignored */
-  buffer[pos++] = lifetime;
+  pos = dao_transit_option(buffer, pos, instance, dag, parent_ipaddr, lifetime);
 
   PRINTF("RPL: Sending %sDAO with prefix ", lifetime == RPL_ZERO_LIFETIME ? "No-Path " : "");
   PRINT6ADDR(prefix);
   PRINTF(" to ");
-  PRINT6ADDR(rpl_get_parent_ipaddr(parent));
+  PRINT6ADDR(dest_ipaddr);
   PRINTF("\n");
 
-  if(rpl_get_parent_ipaddr(parent) != NULL) {
-    uip_icmp6_send(rpl_get_parent_ipaddr(parent), ICMP6_RPL, RPL_CODE_DAO, pos);
+  rpl_icmp6_send(dest_ipaddr, RPL_CODE_DAO, pos);
+}
+/*---------------------------------------------------------------------------*/
+#if RPL_WITH_DAO_AGGREGATION
+static void
+handle_aggregation_timer(void *ptr)
+{
+  dao_aggregate_output();
+}
+/*---------------------------------------------------------------------------*/
+int
+dao_aggregate_target(rpl_instance_t *instance, uip_ipaddr_t *prefix,
+                     uint8_t prefixlen, uint8_t lifetime)
+{
+  uip_ipaddr_t own_addr;
+  int i;
+
+  if(prefix == NULL) {
+    if(get_global_addr(&own_addr) == 0) {
+      PRINTF("RPL: No global address set for this node - suppressing DAO\n");
+      return 1;
+    }
+    prefix = &own_addr;
   }
+
+  if(aggregate_num > 0 && aggregate_instance != instance) {
+    return 0;
+  }
+
+  /* A newer advertisement of a target replaces the pending one */
+  for(i = 0; i < aggregate_num; i++) {
+    if(aggregate_targets[i].prefixlen == prefixlen &&
+       uip_ipaddr_cmp(&aggregate_targets[i].prefix, prefix)) {
+      aggregate_targets[i].lifetime = lifetime;
+      return 1;
+    }
+  }
+
+  if(aggregate_num == RPL_DAO_AGGREGATION_TARGETS) {
+    return 0;
+  }
+
+  aggregate_instance = instance;
+  uip_ipaddr_copy(&aggregate_targets[aggregate_num].prefix, prefix);
+  aggregate_targets[aggregate_num].prefixlen = prefixlen;
+  aggregate_targets[aggregate_num].lifetime = lifetime;
+  aggregate_num++;
+
+  if(aggregate_num == RPL_DAO_AGGREGATION_TARGETS) {
+    /* Full, send it as soon as the current packet has been handled */
+    ctimer_set(&aggregation_timer, 0, handle_aggregation_timer, NULL);
+  } else if(aggregate_num == 1) {
+    ctimer_set(&aggregation_timer, RPL_DAO_AGGREGATION_DELAY,
+               handle_aggregation_timer, NULL);
+  }
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
+void
+dao_aggregate_output(void)
+{
+  rpl_instance_t *instance;
+  rpl_dag_t *dag;
+  rpl_parent_t *parent;
+  unsigned char *buffer;
+  uip_ipaddr_t *parent_ipaddr;
+  uip_ipaddr_t *dest_ipaddr;
+  int pos;
+  int first;
+  int i;
+
+  ctimer_stop(&aggregation_timer);
+  instance = aggregate_instance;
+  if(aggregate_num == 0 || instance == NULL || !instance->used ||
+     rpl_get_mode() == RPL_MODE_FEATHER) {
+    aggregate_num = 0;
+    return;
+  }
+
+  dag = instance->current_dag;
+  parent = dag != NULL ? dag->preferred_parent : NULL;
+  parent_ipaddr = parent != NULL ? rpl_get_parent_ipaddr(parent) : NULL;
+  if(parent_ipaddr == NULL) {
+    PRINTF("RPL: No parent for aggregated DAO, dropping %u targets\n",
+           aggregate_num);
+    aggregate_num = 0;
+    return;
+  }
+  dest_ipaddr = RPL_IS_NON_STORING(instance) ? &dag->dag_id : parent_ipaddr;
+#ifdef RPL_DEBUG_DAO_OUTPUT
+  RPL_DEBUG_DAO_OUTPUT(parent);
+#endif
+
+  buffer = UIP_ICMP_PAYLOAD;
+  i = 0;
+  while(i < aggregate_num) {
+    pos = dao_header(buffer, instance, dag);
+    /* Targets with the same lifetime share a transit option, and as
+       many targets are sent as fit in a packet */
+    for(first = i; i < aggregate_num; i++) {
+      if(i > first &&
+         uip_l3_icmp_hdr_len + pos + DAO_TARGET_SPACE >
+         UIP_BUFSIZE - UIP_LLH_LEN) {
+        break;
+      }
+      if(i > first &&
+         aggregate_targets[i].lifetime != aggregate_targets[i - 1].lifetime) {
+        pos = dao_transit_option(buffer, pos, instance, dag, parent_ipaddr,
+                                 aggregate_targets[i - 1].lifetime);
+      }
+      pos = dao_target_option(buffer, pos, &aggregate_targets[i].prefix,
+                              aggregate_targets[i].prefixlen);
+    }
+    pos = dao_transit_option(buffer, pos, instance, dag, parent_ipaddr,
+                             aggregate_targets[i - 1].lifetime);
+
+    PRINTF("RPL: Sending aggregated DAO to ");
+    PRINT6ADDR(dest_ipaddr);
+    PRINTF("\n");
+
+    rpl_icmp6_send(dest_ipaddr, RPL_CODE_DAO, pos);
+  }
+  aggregate_num = 0;
+}
+#endif /* RPL_WITH_DAO_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 static void
 dao_ack_input(void)
 {
@@ -929,6 +1289,7 @@ dao_ack_input(void)
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF("\n");
 #endif /* DEBUG */
+  RPL_STAT(rpl_stats.dao_ack_recvd++);
   uip_clear_buf();
 }
 /*---------------------------------------------------------------------------*/
@@ -948,7 +1309,7 @@ dao_ack_output(rpl_instance_t *instance, uip_ipaddr_t *dest, uint8_t sequence)
   buffer[2] = sequence;
   buffer[3] = 0;
 
-  uip_icmp6_send(dest, ICMP6_RPL, RPL_CODE_DAO_ACK, 4);
+  rpl_icmp6_send(dest, RPL_CODE_DAO_ACK, 4);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -960,5 +1321,19 @@ rpl_icmp6_register_handlers()
   uip_icmp6_register_input_handler(&dao_ack_handler);
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_CHECKPOINT
+uint8_t
+rpl_get_dao_sequence(void)
+{
+  return dao_sequence;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_set_dao_sequence(uint8_t sequence)
+{
+  dao_sequence = sequence;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_WITH_CHECKPOINT */
 
 /** @}*/
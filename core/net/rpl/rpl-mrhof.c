@@ -87,6 +87,8 @@ rpl_of_t rpl_mrhof = {
 
 typedef uint16_t rpl_path_metric_t;
 
+/* The path metric is cached in the parent until its rank, metric
+   container or link metric changes, as parents are compared often. */
 static rpl_path_metric_t
 calculate_path_metric(rpl_parent_t *p)
 {
@@ -94,21 +96,24 @@ calculate_path_metric(rpl_parent_t *p)
   if(p == NULL) {
     return MAX_PATH_COST * RPL_DAG_MC_ETX_DIVISOR;
   }
+  if(p->flags & RPL_PARENT_FLAG_PATH_METRIC_VALID) {
+    return p->path_metric;
+  }
   nbr = rpl_get_nbr(p);
   if(nbr == NULL) {
     return MAX_PATH_COST * RPL_DAG_MC_ETX_DIVISOR;
   }
 #if RPL_DAG_MC == RPL_DAG_MC_NONE
-  {
-    return p->rank + (uint16_t)nbr->link_metric;
-  }
+  p->path_metric = p->rank + (uint16_t)nbr->link_metric;
 #elif RPL_DAG_MC == RPL_DAG_MC_ETX
-  return p->mc.obj.etx + (uint16_t)nbr->link_metric;
+  p->path_metric = p->mc.obj.etx + (uint16_t)nbr->link_metric;
 #elif RPL_DAG_MC == RPL_DAG_MC_ENERGY
-  return p->mc.obj.energy.energy_est + (uint16_t)nbr->link_metric;
+  p->path_metric = p->mc.obj.energy.energy_est + (uint16_t)nbr->link_metric;
 #else
 #error "Unsupported RPL_DAG_MC configured. See rpl.h."
 #endif /* RPL_DAG_MC */
+  p->flags |= RPL_PARENT_FLAG_PATH_METRIC_VALID;
+  return p->path_metric;
 }
 
 static void
@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         The root's table of nodes and parents in RPL non-storing mode.
+ *
+ *         The table holds one entry per node of the DODAG, with the id
+ *         of the entry of its parent, so that the root needs about 20
+ *         bytes per node instead of a full route with a next hop per
+ *         destination. Nodes are looked up by the hash of their
+ *         interface identifier. Lifetimes are kept as expiration times
+ *         of a clock that ticks once per second, so that aging the
+ *         table only touches the entries when one of them expires.
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+
+#include "net/rpl/rpl-ns.h"
+#include "lib/hashlist.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#include <string.h>
+
+#if RPL_WITH_NON_STORING
+
+struct ns_node {
+  /* The time of the clock at which the node expires */
+  uint32_t expiry;
+  /* NULL for a free entry */
+  rpl_dag_t *dag;
+  uint8_t link_identifier[8];
+  rpl_ns_id_t parent;
+  /* The next node in the same bucket, or the next free entry */
+  rpl_ns_id_t next;
+};
+
+struct ns_route {
+  rpl_ns_id_t dest;
+  uint8_t len;
+  uint16_t stamp;
+  rpl_ns_id_t hops[RPL_NS_MAX_DEPTH];
+};
+
+#if RPL_NS_ROUTE_CACHE > 0
+#define NUM_ROUTES RPL_NS_ROUTE_CACHE
+#else /* RPL_NS_ROUTE_CACHE > 0 */
+#define NUM_ROUTES 1
+#endif /* RPL_NS_ROUTE_CACHE > 0 */
+
+static struct ns_node nodes[RPL_NS_LINK_NUM];
+static rpl_ns_id_t buckets[RPL_NS_BUCKETS];
+static rpl_ns_id_t free_nodes;
+static int num_nodes;
+
+static uint32_t ns_clock;
+/* No node expires before this time */
+static uint32_t next_expiry;
+
+static struct ns_route routes[NUM_ROUTES];
+static uint16_t route_stamp;
+/*---------------------------------------------------------------------------*/
+static rpl_ns_id_t *
+bucket(const uint8_t *link_identifier)
+{
+  return &buckets[hashlist_hash(link_identifier, 8) & (RPL_NS_BUCKETS - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+lifetime_to_expiry(uint32_t lifetime)
+{
+  if(lifetime >= RPL_NS_INFINITE_LIFETIME - ns_clock) {
+    return RPL_NS_INFINITE_LIFETIME;
+  }
+  return ns_clock + lifetime;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_expiry(rpl_ns_id_t id, uint32_t expiry)
+{
+  nodes[id].expiry = expiry;
+  if(expiry < next_expiry) {
+    next_expiry = expiry;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Forget all source routes, when a parent changes or a node goes */
+static void
+flush_routes(void)
+{
+  int i;
+
+  for(i = 0; i < NUM_ROUTES; i++) {
+    routes[i].dest = RPL_NS_ID_NONE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_num_nodes(void)
+{
+  return num_nodes;
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_id_t
+rpl_ns_node_next(rpl_ns_id_t id)
+{
+  for(id++; id < RPL_NS_LINK_NUM; id++) {
+    if(nodes[id].dag != NULL) {
+      return id;
+    }
+  }
+  return RPL_NS_ID_NONE;
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_id_t
+rpl_ns_node_head(void)
+{
+  return rpl_ns_node_next(RPL_NS_ID_NONE);
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_id_t
+rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
+{
+  rpl_ns_id_t id;
+
+  if(dag == NULL || addr == NULL) {
+    return RPL_NS_ID_NONE;
+  }
+  for(id = *bucket(&addr->u8[8]); id != RPL_NS_ID_NONE; id = nodes[id].next) {
+    /* The prefix is that of the DAG, so only the IID is compared */
+    if(nodes[id].dag == dag &&
+       memcmp(nodes[id].link_identifier, &addr->u8[8], 8) == 0) {
+      return id;
+    }
+  }
+  return RPL_NS_ID_NONE;
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_id_t
+rpl_ns_get_parent(rpl_ns_id_t id)
+{
+  return nodes[id].parent;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_get_node_global_addr(uip_ipaddr_t *addr, rpl_ns_id_t id)
+{
+  memcpy(addr, &nodes[id].dag->prefix_info.prefix, 8);
+  memcpy(&addr->u8[8], nodes[id].link_identifier, 8);
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_is_node_reachable(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
+{
+  rpl_ns_id_t id;
+  rpl_ns_id_t root;
+  int depth;
+
+  id = rpl_ns_get_node(dag, addr);
+  root = rpl_ns_get_node(dag, dag != NULL ? &dag->dag_id : NULL);
+  if(root == RPL_NS_ID_NONE) {
+    return 0;
+  }
+
+  for(depth = 0; id != RPL_NS_ID_NONE && depth <= RPL_NS_MAX_DEPTH; depth++) {
+    if(id == root) {
+      return 1;
+    }
+    id = nodes[id].parent;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_get_route(const rpl_dag_t *dag, const uip_ipaddr_t *addr,
+                 const rpl_ns_id_t **route)
+{
+  rpl_ns_id_t dest;
+  rpl_ns_id_t root;
+  rpl_ns_id_t id;
+  struct ns_route *r;
+  int i;
+
+  dest = rpl_ns_get_node(dag, addr);
+  if(dest == RPL_NS_ID_NONE) {
+    return 0;
+  }
+
+  r = &routes[0];
+  for(i = 0; i < NUM_ROUTES; i++) {
+    if(routes[i].dest == dest) {
+      routes[i].stamp = ++route_stamp;
+      *route = routes[i].hops;
+      return routes[i].len;
+    }
+    /* Replace the least recently used route */
+    if(routes[i].dest == RPL_NS_ID_NONE ||
+       (r->dest != RPL_NS_ID_NONE &&
+        (int16_t)(routes[i].stamp - r->stamp) < 0)) {
+      r = &routes[i];
+    }
+  }
+
+  root = rpl_ns_get_node(dag, &dag->dag_id);
+  if(root == RPL_NS_ID_NONE) {
+    return 0;
+  }
+  r->dest = RPL_NS_ID_NONE;
+  r->len = 0;
+  for(id = dest; id != root; id = nodes[id].parent) {
+    if(id == RPL_NS_ID_NONE || r->len == RPL_NS_MAX_DEPTH) {
+      return 0;
+    }
+    r->hops[r->len++] = id;
+  }
+  if(r->len == 0) {
+    /* The root itself */
+    return 0;
+  }
+  r->dest = dest;
+  r->stamp = ++route_stamp;
+  *route = r->hops;
+  return r->len;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_ns_id_t
+add_node(rpl_dag_t *dag, const uip_ipaddr_t *addr, uint32_t lifetime)
+{
+  rpl_ns_id_t id;
+  rpl_ns_id_t *b;
+
+  id = rpl_ns_get_node(dag, addr);
+  if(id == RPL_NS_ID_NONE) {
+    id = free_nodes;
+    if(id == RPL_NS_ID_NONE) {
+      PRINTF("RPL: No space for more non-storing nodes\n");
+      return RPL_NS_ID_NONE;
+    }
+    free_nodes = nodes[id].next;
+    nodes[id].dag = dag;
+    nodes[id].parent = RPL_NS_ID_NONE;
+    memcpy(nodes[id].link_identifier, &addr->u8[8], 8);
+    b = bucket(nodes[id].link_identifier);
+    nodes[id].next = *b;
+    *b = id;
+    num_nodes++;
+  }
+  set_expiry(id, lifetime_to_expiry(lifetime));
+  return id;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_node(rpl_ns_id_t id)
+{
+  rpl_ns_id_t *p;
+
+  for(p = bucket(nodes[id].link_identifier); *p != id; p = &nodes[*p].next);
+  *p = nodes[id].next;
+  nodes[id].dag = NULL;
+  nodes[id].next = free_nodes;
+  free_nodes = id;
+  num_nodes--;
+}
+/*---------------------------------------------------------------------------*/
+/* The children of removed nodes are unreachable until they advertise a
+   new parent. Called after a batch of nodes has been freed. */
+static void
+orphan_children(void)
+{
+  rpl_ns_id_t id;
+
+  for(id = 0; id < RPL_NS_LINK_NUM; id++) {
+    if(nodes[id].dag != NULL && nodes[id].parent != RPL_NS_ID_NONE &&
+       nodes[nodes[id].parent].dag == NULL) {
+      nodes[id].parent = RPL_NS_ID_NONE;
+    }
+  }
+  flush_routes();
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_id_t
+rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child,
+                   const uip_ipaddr_t *parent, uint32_t lifetime)
+{
+  rpl_ns_id_t child_id;
+  rpl_ns_id_t parent_id;
+  rpl_ns_id_t id;
+  int steps;
+
+  /* The parent must be known. The root is added as it is first named
+     as a parent, and never expires. */
+  parent_id = rpl_ns_get_node(dag, parent);
+  if(parent_id == RPL_NS_ID_NONE) {
+    if(uip_ipaddr_cmp(parent, &dag->dag_id)) {
+      parent_id = add_node(dag, parent, RPL_NS_INFINITE_LIFETIME);
+    } else {
+      /* Remember the parent until its own DAO arrives */
+      parent_id = add_node(dag, parent, lifetime);
+    }
+    if(parent_id == RPL_NS_ID_NONE) {
+      return RPL_NS_ID_NONE;
+    }
+  }
+
+  child_id = add_node(dag, child, lifetime);
+  if(child_id == RPL_NS_ID_NONE || child_id == parent_id) {
+    return RPL_NS_ID_NONE;
+  }
+
+  PRINTF("RPL: Non-storing node ");
+  PRINT6ADDR(child);
+  PRINTF(" has parent ");
+  PRINT6ADDR(parent);
+  PRINTF(", lifetime %lu\n", (unsigned long)lifetime);
+
+  if(nodes[child_id].parent == parent_id) {
+    return child_id;
+  }
+
+  /* The parent pointers never form a loop, so the path up from the new
+     parent ends, and if it passes through the child, the new parent
+     would create a loop, for instance because the DAO of a node down
+     the new path is not up to date yet. The old parent is kept until
+     the topology has settled. */
+  id = parent_id;
+  for(steps = 0; id != RPL_NS_ID_NONE && steps < RPL_NS_LINK_NUM; steps++) {
+    if(id == child_id) {
+      PRINTF("RPL: Non-storing parent would create a loop\n");
+      return child_id;
+    }
+    id = nodes[id].parent;
+  }
+
+  nodes[child_id].parent = parent_id;
+  flush_routes();
+  return child_id;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_expire_parent(rpl_dag_t *dag, const uip_ipaddr_t *child,
+                     const uip_ipaddr_t *parent)
+{
+  rpl_ns_id_t id;
+
+  id = rpl_ns_get_node(dag, child);
+  /* A node that has moved to another parent is kept */
+  if(id != RPL_NS_ID_NONE &&
+     nodes[id].parent == rpl_ns_get_node(dag, parent) &&
+     nodes[id].expiry > lifetime_to_expiry(RPL_NOPATH_REMOVAL_DELAY)) {
+    set_expiry(id, lifetime_to_expiry(RPL_NOPATH_REMOVAL_DELAY));
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_remove_nodes(rpl_dag_t *dag)
+{
+  rpl_ns_id_t id;
+
+  for(id = 0; id < RPL_NS_LINK_NUM; id++) {
+    if(dag != NULL && nodes[id].dag == dag) {
+      free_node(id);
+    }
+  }
+  orphan_children();
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_periodic(void)
+{
+  rpl_ns_id_t id;
+  int removed;
+
+  ns_clock++;
+  if(ns_clock < next_expiry) {
+    return;
+  }
+
+  removed = 0;
+  next_expiry = RPL_NS_INFINITE_LIFETIME;
+  for(id = 0; id < RPL_NS_LINK_NUM; id++) {
+    if(nodes[id].dag == NULL) {
+      continue;
+    }
+    if(nodes[id].expiry <= ns_clock) {
+      PRINTF("RPL: Non-storing node expired\n");
+      free_node(id);
+      removed = 1;
+    } else if(nodes[id].expiry < next_expiry) {
+      next_expiry = nodes[id].expiry;
+    }
+  }
+  if(removed) {
+    orphan_children();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_init(void)
+{
+  int i;
+
+  for(i = 0; i < RPL_NS_LINK_NUM; i++) {
+    nodes[i].dag = NULL;
+    nodes[i].next = i + 1 < RPL_NS_LINK_NUM ? i + 1 : RPL_NS_ID_NONE;
+  }
+  free_nodes = 0;
+  for(i = 0; i < RPL_NS_BUCKETS; i++) {
+    buckets[i] = RPL_NS_ID_NONE;
+  }
+  num_nodes = 0;
+  ns_clock = 0;
+  next_expiry = RPL_NS_INFINITE_LIFETIME;
+  flush_routes();
+}
+/*---------------------------------------------------------------------------*/
+#else /* RPL_WITH_NON_STORING */
+void
+rpl_ns_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_num_nodes(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_remove_nodes(rpl_dag_t *dag)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_periodic(void)
+{
+}
+#endif /* RPL_WITH_NON_STORING */
+/*---------------------------------------------------------------------------*/
+
+/** @}*/
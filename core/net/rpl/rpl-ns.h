@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         The root's view of the DODAG in RPL non-storing mode: the
+ *         parent of each node, as advertised in its DAOs. Downward
+ *         source routes are built by following the parent pointers
+ *         from a destination up to the root.
+ *
+ *         Nodes are kept in a table and referred to by their index in
+ *         the table, their node id, so that a parent pointer takes one
+ *         or two bytes instead of a full address.
+ */
+
+#ifndef RPL_NS_H_
+#define RPL_NS_H_
+
+#include "net/rpl/rpl-private.h"
+
+/* The maximum number of nodes (links) the root keeps */
+#ifdef RPL_NS_CONF_LINK_NUM
+#define RPL_NS_LINK_NUM RPL_NS_CONF_LINK_NUM
+#else /* RPL_NS_CONF_LINK_NUM */
+#define RPL_NS_LINK_NUM 32
+#endif /* RPL_NS_CONF_LINK_NUM */
+
+/* The number of hash buckets used to look nodes up by address, a
+   power of two */
+#ifdef RPL_NS_CONF_BUCKETS
+#define RPL_NS_BUCKETS RPL_NS_CONF_BUCKETS
+#else /* RPL_NS_CONF_BUCKETS */
+#define RPL_NS_BUCKETS 16
+#endif /* RPL_NS_CONF_BUCKETS */
+
+/* The maximum number of hops below the root. Nodes that are deeper
+   are unreachable. */
+#ifdef RPL_NS_CONF_MAX_DEPTH
+#define RPL_NS_MAX_DEPTH RPL_NS_CONF_MAX_DEPTH
+#else /* RPL_NS_CONF_MAX_DEPTH */
+#define RPL_NS_MAX_DEPTH 16
+#endif /* RPL_NS_CONF_MAX_DEPTH */
+
+/* The number of source routes that are remembered, so that the route
+   to a busy destination is not built for every packet. At least one. */
+#ifdef RPL_NS_CONF_ROUTE_CACHE
+#define RPL_NS_ROUTE_CACHE RPL_NS_CONF_ROUTE_CACHE
+#else /* RPL_NS_CONF_ROUTE_CACHE */
+#define RPL_NS_ROUTE_CACHE 4
+#endif /* RPL_NS_CONF_ROUTE_CACHE */
+
+/* A node id, the index of a node in the table */
+#if RPL_NS_LINK_NUM > 255
+typedef uint16_t rpl_ns_id_t;
+#define RPL_NS_ID_NONE 0xffff
+#else /* RPL_NS_LINK_NUM > 255 */
+typedef uint8_t rpl_ns_id_t;
+#define RPL_NS_ID_NONE 0xff
+#endif /* RPL_NS_LINK_NUM > 255 */
+
+/* The lifetime of the root's own node */
+#define RPL_NS_INFINITE_LIFETIME 0xffffffff
+
+void rpl_ns_init(void);
+int rpl_ns_num_nodes(void);
+
+/* Iterate over the nodes; the ids end with RPL_NS_ID_NONE */
+rpl_ns_id_t rpl_ns_node_head(void);
+rpl_ns_id_t rpl_ns_node_next(rpl_ns_id_t id);
+
+rpl_ns_id_t rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr);
+rpl_ns_id_t rpl_ns_get_parent(rpl_ns_id_t id);
+void rpl_ns_get_node_global_addr(uip_ipaddr_t *addr, rpl_ns_id_t id);
+
+/* Is there a path of parents from the node with the address up to the
+   root of the DAG? */
+int rpl_ns_is_node_reachable(const rpl_dag_t *dag, const uip_ipaddr_t *addr);
+
+/* Get the source route to the node with the address: the ids of the
+   nodes on the path, from the node itself up to the child of the root.
+   Returns the number of nodes on the path, or 0 if the node cannot be
+   reached. The route is valid until the table is changed. */
+int rpl_ns_get_route(const rpl_dag_t *dag, const uip_ipaddr_t *addr,
+                     const rpl_ns_id_t **route);
+
+/* Record the parent of a node from a DAO. Returns RPL_NS_ID_NONE if
+   there is no room for the node. */
+rpl_ns_id_t rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child,
+                               const uip_ipaddr_t *parent, uint32_t lifetime);
+
+/* Handle a No-Path DAO: expire the node soon if its parent is still the
+   one given. */
+void rpl_ns_expire_parent(rpl_dag_t *dag, const uip_ipaddr_t *child,
+                          const uip_ipaddr_t *parent);
+
+/* Remove all nodes of a DAG. */
+void rpl_ns_remove_nodes(rpl_dag_t *dag);
+
+/* Age the nodes; called once per second. */
+void rpl_ns_periodic(void);
+
+#endif /* RPL_NS_H_ */
@@ -122,34 +122,45 @@ best_dag(rpl_dag_t *d1, rpl_dag_t *d2)
   }
 }
 
+/* The rank of a parent combined with the ETX of the link to it. It is
+   cached in the parent until its rank or link metric changes, as
+   parents are compared often. Returns 0 if the neighbor is unknown. */
+static int
+path_cost(rpl_parent_t *p, rpl_rank_t *cost)
+{
+  uip_ds6_nbr_t *nbr;
+
+  if(!(p->flags & RPL_PARENT_FLAG_PATH_METRIC_VALID)) {
+    nbr = rpl_get_nbr(p);
+    if(nbr == NULL) {
+      return 0;
+    }
+    p->path_metric = DAG_RANK(p->rank, p->dag->instance) * RPL_MIN_HOPRANKINC +
+      nbr->link_metric;
+    p->flags |= RPL_PARENT_FLAG_PATH_METRIC_VALID;
+  }
+  *cost = p->path_metric;
+  return 1;
+}
+
 static rpl_parent_t *
 best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
 {
   rpl_rank_t r1, r2;
   rpl_dag_t *dag;  
-  uip_ds6_nbr_t *nbr1, *nbr2;
-  nbr1 = rpl_get_nbr(p1);
-  nbr2 = rpl_get_nbr(p2);
 
   dag = (rpl_dag_t *)p1->dag; /* Both parents must be in the same DAG. */
 
-  if(nbr1 == NULL || nbr2 == NULL) {
+  if(!path_cost(p1, &r1) || !path_cost(p2, &r2)) {
     return dag->preferred_parent;
   }
 
   PRINTF("RPL: Comparing parent ");
   PRINT6ADDR(rpl_get_parent_ipaddr(p1));
-  PRINTF(" (confidence %d, rank %d) with parent ",
-        nbr1->link_metric, p1->rank);
+  PRINTF(" (cost %d, rank %d) with parent ", r1, p1->rank);
   PRINT6ADDR(rpl_get_parent_ipaddr(p2));
-  PRINTF(" (confidence %d, rank %d)\n",
-        nbr2->link_metric, p2->rank);
-
+  PRINTF(" (cost %d, rank %d)\n", r2, p2->rank);
 
-  r1 = DAG_RANK(p1->rank, p1->dag->instance) * RPL_MIN_HOPRANKINC  +
-    nbr1->link_metric;
-  r2 = DAG_RANK(p2->rank, p1->dag->instance) * RPL_MIN_HOPRANKINC  +
-    nbr2->link_metric;
   /* Compare two parents by looking both and their rank and at the ETX
      for that parent. We choose the parent that has the most
      favourable combination. */
@@ -100,6 +100,11 @@
 #define RPL_HDR_OPT_RANK_ERR_SHIFT   	6
 #define RPL_HDR_OPT_FWD_ERR		0x20
 #define RPL_HDR_OPT_FWD_ERR_SHIFT   	5
+
+/* RPL Source Routing Header (RFC 6554). */
+#define RPL_RH_TYPE_SRH                 3
+#define RPL_RH_LEN                      4
+#define RPL_SRH_LEN                     4
 /*---------------------------------------------------------------------------*/
 /* Default values for RPL constants and variables. */
 
@@ -110,6 +115,29 @@
 #define RPL_DAO_DELAY                 (CLOCK_SECOND * 4)
 #endif /* RPL_CONF_DAO_DELAY */
 
+/* With DAO aggregation, a node advertises all its targets in one DAO,
+   and a storing-mode router collects the targets of the DAOs from its
+   children for RPL_DAO_AGGREGATION_DELAY, and forwards them in one DAO
+   of up to RPL_DAO_AGGREGATION_TARGETS targets, instead of forwarding
+   each DAO as it arrives. */
+#ifdef RPL_CONF_WITH_DAO_AGGREGATION
+#define RPL_WITH_DAO_AGGREGATION      RPL_CONF_WITH_DAO_AGGREGATION
+#else /* RPL_CONF_WITH_DAO_AGGREGATION */
+#define RPL_WITH_DAO_AGGREGATION      0
+#endif /* RPL_CONF_WITH_DAO_AGGREGATION */
+
+#ifdef RPL_CONF_DAO_AGGREGATION_DELAY
+#define RPL_DAO_AGGREGATION_DELAY     RPL_CONF_DAO_AGGREGATION_DELAY
+#else /* RPL_CONF_DAO_AGGREGATION_DELAY */
+#define RPL_DAO_AGGREGATION_DELAY     (CLOCK_SECOND / 2)
+#endif /* RPL_CONF_DAO_AGGREGATION_DELAY */
+
+#ifdef RPL_CONF_DAO_AGGREGATION_TARGETS
+#define RPL_DAO_AGGREGATION_TARGETS   RPL_CONF_DAO_AGGREGATION_TARGETS
+#else /* RPL_CONF_DAO_AGGREGATION_TARGETS */
+#define RPL_DAO_AGGREGATION_TARGETS   8
+#endif /* RPL_CONF_DAO_AGGREGATION_TARGETS */
+
 /* Delay between reception of a no-path DAO and actual route removal */
 #ifdef RPL_CONF_NOPATH_REMOVAL_DELAY
 #define RPL_NOPATH_REMOVAL_DELAY          RPL_CONF_NOPATH_REMOVAL_DELAY
@@ -123,6 +151,20 @@
 #define RPL_LIFETIME(instance, lifetime) \
           ((unsigned long)(instance)->lifetime_unit * (lifetime))
 
+/* Sets the lifetime of a route, in seconds. With an expiry heap in the
+   routing table, state.lifetime keeps the lifetime last given, and
+   uip_ds6_route_lifetime() tells how much of it is left. */
+#if UIP_DS6_ROUTE_EXPIRY_HEAP
+#define RPL_ROUTE_SET_LIFETIME(route, seconds)                  \
+  do {                                                          \
+    (route)->state.lifetime = (seconds);                        \
+    uip_ds6_route_set_lifetime((route), (seconds));             \
+  } while(0)
+#else /* UIP_DS6_ROUTE_EXPIRY_HEAP */
+#define RPL_ROUTE_SET_LIFETIME(route, seconds)                  \
+  ((route)->state.lifetime = (seconds))
+#endif /* UIP_DS6_ROUTE_EXPIRY_HEAP */
+
 #ifndef RPL_CONF_MIN_HOPRANKINC
 #define RPL_MIN_HOPRANKINC          256
 #else
@@ -167,6 +209,21 @@
 #endif /* UIP_IPV6_MULTICAST_RPL */
 #endif /* RPL_CONF_MOP */
 
+/* The non-storing mode of operation is compiled in when it is the
+   default mode, or with RPL_CONF_WITH_NON_STORING. */
+#ifdef RPL_CONF_WITH_NON_STORING
+#define RPL_WITH_NON_STORING            RPL_CONF_WITH_NON_STORING
+#else /* RPL_CONF_WITH_NON_STORING */
+#define RPL_WITH_NON_STORING            (RPL_MOP_DEFAULT == RPL_MOP_NON_STORING)
+#endif /* RPL_CONF_WITH_NON_STORING */
+
+#if RPL_WITH_NON_STORING
+#define RPL_IS_NON_STORING(instance) \
+  ((instance) != NULL && (instance)->mop == RPL_MOP_NON_STORING)
+#else /* RPL_WITH_NON_STORING */
+#define RPL_IS_NON_STORING(instance) 0
+#endif /* RPL_WITH_NON_STORING */
+
 /* Emit a pre-processor error if the user configured multicast with bad MOP */
 #if RPL_CONF_MULTICAST && (RPL_MOP_DEFAULT != RPL_MOP_STORING_MULTICAST)
 #error "RPL Multicast requires RPL_MOP_DEFAULT==3. Check contiki-conf.h"
@@ -189,6 +246,13 @@
 /* DIS related */
 #define RPL_DIS_SEND                    1
 
+/* The solicited information option of a DIS: the length of its
+   payload and the flags that tell which of its predicates apply */
+#define RPL_DIS_SOLICITED_INFO_LEN      19
+#define RPL_DIS_SOLICITED_V             0x80
+#define RPL_DIS_SOLICITED_I             0x40
+#define RPL_DIS_SOLICITED_D             0x20
+
 /*---------------------------------------------------------------------------*/
 /* Lollipop counters */
 
@@ -245,6 +309,17 @@ struct rpl_stats {
   uint16_t loop_errors;
   uint16_t loop_warnings;
   uint16_t root_repairs;
+  /* Control traffic, counted per message type. The bytes are those of
+     the ICMPv6 messages sent, with an uncompressed IPv6 header. */
+  uint16_t dis_sent;
+  uint16_t dio_sent;
+  uint16_t dao_sent;
+  uint16_t dao_ack_sent;
+  uint16_t dis_recvd;
+  uint16_t dio_recvd;
+  uint16_t dao_recvd;
+  uint16_t dao_ack_recvd;
+  uint32_t control_bytes_sent;
 };
 typedef struct rpl_stats rpl_stats_t;
 
@@ -253,6 +328,12 @@ extern rpl_stats_t rpl_stats;
 /*---------------------------------------------------------------------------*/
 /* RPL macros. */
 
+/* Flag a parent whose rank or link metric has changed, so that the
+   rank is recalculated and the cached path metric is computed again. */
+#define RPL_PARENT_UPDATED(p) \
+  ((p)->flags = ((p)->flags | RPL_PARENT_FLAG_UPDATED) & \
+                ~RPL_PARENT_FLAG_PATH_METRIC_VALID)
+
 #if RPL_CONF_STATS
 #define RPL_STAT(code)	(code) 
 #else
@@ -263,13 +344,32 @@ extern rpl_stats_t rpl_stats;
 extern rpl_instance_t instance_table[];
 extern rpl_instance_t *default_instance;
 
+/* The routing table that holds the downward routes of an instance.
+   Without a table per instance, all instances share one table. */
+#if UIP_DS6_ROUTE_TABLES > 1
+#if UIP_DS6_ROUTE_TABLES < RPL_MAX_INSTANCES
+#error "UIP_DS6_ROUTE_CONF_TABLES must be at least RPL_CONF_MAX_INSTANCES"
+#endif
+#define RPL_ROUTE_TABLE(instance) ((uint8_t)((instance) - &instance_table[0]))
+#else /* UIP_DS6_ROUTE_TABLES > 1 */
+#define RPL_ROUTE_TABLE(instance) 0
+#endif /* UIP_DS6_ROUTE_TABLES > 1 */
+
 /* ICMPv6 functions for RPL. */
 void dis_output(uip_ipaddr_t *addr);
 void dio_output(rpl_instance_t *, uip_ipaddr_t *uc_addr);
 void dao_output(rpl_parent_t *, uint8_t lifetime);
 void dao_output_target(rpl_parent_t *, uip_ipaddr_t *, uint8_t lifetime);
 void dao_ack_output(rpl_instance_t *, uip_ipaddr_t *, uint8_t);
+/* Queue a target, or our own address if it is NULL, for the next
+   aggregated DAO. Returns 0 if it does not fit. The DAO is sent after
+   a short delay, or by dao_aggregate_output(). */
+int dao_aggregate_target(rpl_instance_t *, uip_ipaddr_t *, uint8_t prefixlen,
+                         uint8_t lifetime);
+void dao_aggregate_output(void);
 void rpl_icmp6_register_handlers(void);
+uint8_t rpl_get_dao_sequence(void);
+void rpl_set_dao_sequence(uint8_t sequence);
 
 /* RPL logic functions. */
 void rpl_join_dag(uip_ipaddr_t *from, rpl_dio_t *dio);
@@ -309,6 +409,7 @@ rpl_of_t *rpl_find_of(rpl_ocp_t);
 /* Timer functions. */
 void rpl_schedule_dao(rpl_instance_t *);
 void rpl_schedule_dao_immediately(rpl_instance_t *);
+void rpl_schedule_unicast_dio(rpl_instance_t *instance, clock_time_t delay);
 void rpl_schedule_unicast_dio_immediately(rpl_instance_t *instance);
 void rpl_cancel_dao(rpl_instance_t *instance);
 void rpl_schedule_probing(rpl_instance_t *instance);
@@ -319,6 +420,11 @@ void rpl_reset_periodic_timer(void);
 /* Route poisoning. */
 void rpl_poison_routes(rpl_dag_t *, rpl_parent_t *);
 
+/* State checkpointing. */
+void rpl_checkpoint_restore(void);
+void rpl_checkpoint_periodic(void);
+void rpl_checkpoint_dio_input(uip_ipaddr_t *from);
+
 
 rpl_instance_t *rpl_get_default_instance(void);
 
@@ -43,7 +43,9 @@
 
 #include "contiki-conf.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
+#include "net/link-stats.h"
 #include "lib/random.h"
 #include "sys/ctimer.h"
 
@@ -63,6 +65,13 @@ static void new_dio_interval(rpl_instance_t *instance);
 static void handle_dio_timer(void *ptr);
 
 static uint16_t next_dis;
+#if RPL_WITH_FAST_JOIN
+/* The seconds between DIS transmissions while joining, which double
+   up to RPL_DIS_INTERVAL */
+static uint16_t dis_interval;
+#else /* RPL_WITH_FAST_JOIN */
+#define dis_interval RPL_DIS_INTERVAL
+#endif /* RPL_WITH_FAST_JOIN */
 
 /* dio_send_ok is true if the node is ready to send DIOs */
 static uint8_t dio_send_ok;
@@ -73,14 +82,30 @@ handle_periodic_timer(void *ptr)
 {
   rpl_purge_dags();
   rpl_purge_routes();
+  rpl_ns_periodic();
   rpl_recalculate_ranks();
+#if RPL_WITH_CHECKPOINT
+  rpl_checkpoint_periodic();
+#endif /* RPL_WITH_CHECKPOINT */
 
   /* handle DIS */
 #if RPL_DIS_SEND
   next_dis++;
-  if(rpl_get_any_dag() == NULL && next_dis >= RPL_DIS_INTERVAL) {
+  if(rpl_get_any_dag() == NULL) {
+    if(next_dis >= dis_interval) {
+      next_dis = 0;
+      dis_output(NULL);
+#if RPL_WITH_FAST_JOIN
+      dis_interval = dis_interval < RPL_DIS_INTERVAL / 2 ?
+        dis_interval * 2 : RPL_DIS_INTERVAL;
+#endif /* RPL_WITH_FAST_JOIN */
+    }
+#if RPL_WITH_FAST_JOIN
+  } else {
+    /* Join quickly again if the DAG is lost */
+    dis_interval = RPL_FAST_JOIN_DIS_INTERVAL;
     next_dis = 0;
-    dis_output(NULL);
+#endif /* RPL_WITH_FAST_JOIN */
   }
 #endif
   ctimer_reset(&periodic_timer);
@@ -185,9 +210,14 @@ handle_dio_timer(void *ptr)
 void
 rpl_reset_periodic_timer(void)
 {
+#if RPL_WITH_FAST_JOIN
+  dis_interval = RPL_FAST_JOIN_DIS_INTERVAL;
+  next_dis = 0;
+#else /* RPL_WITH_FAST_JOIN */
   next_dis = RPL_DIS_INTERVAL / 2 +
     ((uint32_t)RPL_DIS_INTERVAL * (uint32_t)random_rand()) / RANDOM_RAND_MAX -
     RPL_DIS_START_DELAY;
+#endif /* RPL_WITH_FAST_JOIN */
   ctimer_set(&periodic_timer, CLOCK_SECOND, handle_periodic_timer, NULL);
 }
 /*---------------------------------------------------------------------------*/
@@ -231,6 +261,23 @@ set_dao_lifetime_timer(rpl_instance_t *instance)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_CONF_MULTICAST || RPL_WITH_DAO_AGGREGATION
+static void
+send_dao_target(rpl_instance_t *instance, uip_ipaddr_t *prefix,
+                uint8_t lifetime)
+{
+#if RPL_WITH_DAO_AGGREGATION
+  /* Send the queued targets when there is no room for more */
+  if(!dao_aggregate_target(instance, prefix, 128, lifetime)) {
+    dao_aggregate_output();
+    dao_aggregate_target(instance, prefix, 128, lifetime);
+  }
+#else /* RPL_WITH_DAO_AGGREGATION */
+  dao_output_target(instance->current_dag->preferred_parent, prefix, lifetime);
+#endif /* RPL_WITH_DAO_AGGREGATION */
+}
+#endif /* RPL_CONF_MULTICAST || RPL_WITH_DAO_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 static void
 handle_dao_timer(void *ptr)
 {
@@ -252,7 +299,13 @@ handle_dao_timer(void *ptr)
   if(instance->current_dag->preferred_parent != NULL) {
     PRINTF("RPL: handle_dao_timer - sending DAO\n");
     /* Set the route lifetime to the default value. */
+#if RPL_WITH_DAO_AGGREGATION
+    /* Our own targets go in one DAO, along with the targets from the
+       DAOs of our children that are waiting to be forwarded */
+    send_dao_target(instance, NULL, instance->default_lifetime);
+#else /* RPL_WITH_DAO_AGGREGATION */
     dao_output(instance->current_dag->preferred_parent, instance->default_lifetime);
+#endif /* RPL_WITH_DAO_AGGREGATION */
 
 #if RPL_CONF_MULTICAST
     /* Send DAOs for multicast prefixes only if the instance is in MOP 3 */
@@ -261,8 +314,8 @@ handle_dao_timer(void *ptr)
       for(i = 0; i < UIP_DS6_MADDR_NB; i++) {
         if(uip_ds6_if.maddr_list[i].isused
             && uip_is_addr_mcast_global(&uip_ds6_if.maddr_list[i].ipaddr)) {
-          dao_output_target(instance->current_dag->preferred_parent,
-              &uip_ds6_if.maddr_list[i].ipaddr, RPL_MCAST_LIFETIME);
+          send_dao_target(instance, &uip_ds6_if.maddr_list[i].ipaddr,
+                          RPL_MCAST_LIFETIME);
         }
       }
 
@@ -271,13 +324,15 @@ handle_dao_timer(void *ptr)
       while(mcast_route != NULL) {
         /* Don't send if it's also our own address, done that already */
         if(uip_ds6_maddr_lookup(&mcast_route->group) == NULL) {
-          dao_output_target(instance->current_dag->preferred_parent,
-                     &mcast_route->group, RPL_MCAST_LIFETIME);
+          send_dao_target(instance, &mcast_route->group, RPL_MCAST_LIFETIME);
         }
         mcast_route = list_item_next(mcast_route);
       }
     }
 #endif
+#if RPL_WITH_DAO_AGGREGATION
+    dao_aggregate_output();
+#endif /* RPL_WITH_DAO_AGGREGATION */
   } else {
     PRINTF("RPL: No suitable DAO parent\n");
   }
@@ -341,38 +396,71 @@ static void
 handle_unicast_dio_timer(void *ptr)
 {
   rpl_instance_t *instance = (rpl_instance_t *)ptr;
-  uip_ipaddr_t *target_ipaddr = rpl_get_parent_ipaddr(instance->unicast_dio_target);
 
-  if(target_ipaddr != NULL) {
-    dio_output(instance, target_ipaddr);
-  }
+  dio_output(instance, &instance->unicast_dio_target);
 }
 /*---------------------------------------------------------------------------*/
 void
-rpl_schedule_unicast_dio_immediately(rpl_instance_t *instance)
+rpl_schedule_unicast_dio(rpl_instance_t *instance, clock_time_t delay)
 {
-  ctimer_set(&instance->unicast_dio_timer, 0,
+  ctimer_set(&instance->unicast_dio_timer, delay,
                   handle_unicast_dio_timer, instance);
 }
 /*---------------------------------------------------------------------------*/
+void
+rpl_schedule_unicast_dio_immediately(rpl_instance_t *instance)
+{
+  rpl_schedule_unicast_dio(instance, 0);
+}
+/*---------------------------------------------------------------------------*/
 #if RPL_WITH_PROBING
+/* How much a parent needs a probe: how long ago its link was last
+   used, relative to RPL_PROBING_EXPIRATION_TIME, plus how uncertain
+   its link metric is, each from 0 to 256, and twice that for the
+   preferred parent. */
+static uint16_t
+probing_need(rpl_parent_t *p, clock_time_t now)
+{
+  clock_time_t age;
+  uint16_t need;
+
+  if(!LINK_STATS_ENABLED &&
+     p->dag->instance->of->neighbor_link_callback == NULL) {
+    /* The objective function does not measure links */
+    return 0;
+  }
+
+  age = now - p->last_tx_time;
+  if(p->last_tx_time == 0 || age >= RPL_PROBING_EXPIRATION_TIME) {
+    need = 256;
+  } else {
+    need = (uint32_t)age * 256 / RPL_PROBING_EXPIRATION_TIME;
+  }
+
+  if(!(p->flags & RPL_PARENT_FLAG_LINK_METRIC_VALID) ||
+     p->link_metric_dev >= RPL_PROBING_UNCERTAIN_DEV) {
+    need += 256;
+  } else {
+    need += (uint32_t)p->link_metric_dev * 256 / RPL_PROBING_UNCERTAIN_DEV;
+  }
+
+  if(p == p->dag->preferred_parent) {
+    need *= 2;
+  }
+  return need;
+}
+/*---------------------------------------------------------------------------*/
 static rpl_parent_t *
 get_probing_target(rpl_dag_t *dag)
 {
-  /* Returns the next probing target. The current implementation probes the current
-   * preferred parent if we have not updated its link for RPL_PROBING_EXPIRATION_TIME.
-   * Otherwise, it picks at random between:
-   * (1) selecting the best parent not updated for RPL_PROBING_EXPIRATION_TIME
-   * (2) selecting the least recently updated parent
-   */
-
+  /* Returns the parent that needs a probe the most, out of the
+     preferred parent and the parents that could replace it, or NULL
+     if none needs one more than RPL_PROBING_MIN_NEED. */
   rpl_parent_t *p;
-  rpl_parent_t *probing_target = NULL;
-  rpl_rank_t probing_target_rank = INFINITE_RANK;
-  /* min_last_tx is the clock time RPL_PROBING_EXPIRATION_TIME in the past */
-  clock_time_t min_last_tx = clock_time();
-  min_last_tx = min_last_tx > 2 * RPL_PROBING_EXPIRATION_TIME
-      ? min_last_tx - RPL_PROBING_EXPIRATION_TIME : 1;
+  rpl_parent_t *probing_target;
+  uint16_t need;
+  uint16_t max_need;
+  clock_time_t now;
 
   if(dag == NULL ||
       dag->instance == NULL ||
@@ -380,39 +468,21 @@ get_probing_target(rpl_dag_t *dag)
     return NULL;
   }
 
-  /* Our preferred parent needs probing */
-  if(dag->preferred_parent->last_tx_time < min_last_tx) {
-    probing_target = dag->preferred_parent;
-  }
-
-  /* With 50% probability: probe best parent not updated for RPL_PROBING_EXPIRATION_TIME */
-  if(probing_target == NULL && (random_rand() % 2) == 0) {
-    p = nbr_table_head(rpl_parents);
-    while(p != NULL) {
-      if(p->dag == dag && p->last_tx_time < min_last_tx) {
-        /* p is in our dag and needs probing */
-        rpl_rank_t p_rank = dag->instance->of->calculate_rank(p, 0);
-        if(probing_target == NULL
-            || p_rank < probing_target_rank) {
-          probing_target = p;
-          probing_target_rank = p_rank;
-        }
-      }
-      p = nbr_table_next(rpl_parents, p);
+  now = clock_time();
+  probing_target = NULL;
+  max_need = RPL_PROBING_MIN_NEED;
+  for(p = nbr_table_head(rpl_parents);
+      p != NULL;
+      p = nbr_table_next(rpl_parents, p)) {
+    if(p->dag != dag || p->rank == INFINITE_RANK ||
+       (p != dag->preferred_parent &&
+        DAG_RANK(p->rank, dag->instance) >= DAG_RANK(dag->rank, dag->instance))) {
+      continue;
     }
-  }
-
-  /* The default probing target is the least recently updated parent */
-  if(probing_target == NULL) {
-    p = nbr_table_head(rpl_parents);
-    while(p != NULL) {
-      if(p->dag == dag) {
-        if(probing_target == NULL
-            || p->last_tx_time < probing_target->last_tx_time) {
-          probing_target = p;
-        }
-      }
-      p = nbr_table_next(rpl_parents, p);
+    need = probing_need(p, now);
+    if(need > max_need) {
+      probing_target = p;
+      max_need = need;
     }
   }
 
@@ -423,8 +493,24 @@ static void
 handle_probing_timer(void *ptr)
 {
   rpl_instance_t *instance = (rpl_instance_t *)ptr;
-  rpl_parent_t *probing_target = RPL_PROBING_SELECT_FUNC(instance->current_dag);
-  uip_ipaddr_t *target_ipaddr = rpl_get_parent_ipaddr(probing_target);
+  rpl_parent_t *probing_target;
+  uip_ipaddr_t *target_ipaddr;
+
+  if(instance->probing_target == NULL) {
+    probing_target = RPL_PROBING_SELECT_FUNC(instance->current_dag);
+    if(probing_target != NULL && RPL_PROBING_PIGGYBACK_DELAY > 0) {
+      /* Give a packet the chance to probe the link first. Once the
+         link has been used, the target is cleared. */
+      instance->probing_target = probing_target;
+      ctimer_set(&instance->probing_timer, RPL_PROBING_PIGGYBACK_DELAY,
+                 handle_probing_timer, instance);
+      return;
+    }
+  } else {
+    probing_target = instance->probing_target;
+    instance->probing_target = NULL;
+  }
+  target_ipaddr = rpl_get_parent_ipaddr(probing_target);
 
   /* Perform probing */
   if(target_ipaddr != NULL) {
@@ -446,6 +532,7 @@ handle_probing_timer(void *ptr)
 void
 rpl_schedule_probing(rpl_instance_t *instance)
 {
+  instance->probing_target = NULL;
   ctimer_set(&instance->probing_timer, RPL_PROBING_DELAY_FUNC(),
                   handle_probing_timer, instance);
 }
@@ -47,7 +47,9 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
+#include "net/link-stats.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -107,16 +109,53 @@ rpl_set_mode(enum rpl_mode m)
   return oldmode;
 }
 /*---------------------------------------------------------------------------*/
+/* Removes an expired route. Returns 0 if no more routes should be
+   removed in this round. */
+static int
+purge_route(uip_ds6_route_t *r)
+{
+  uip_ipaddr_t prefix;
+  rpl_dag_t *dag;
+
+  uip_ipaddr_copy(&prefix, &r->ipaddr);
+  uip_ds6_route_rm(r);
+  PRINTF("No more routes to ");
+  PRINT6ADDR(&prefix);
+  dag = default_instance->current_dag;
+  /* Propagate this information with a No-Path DAO to preferred parent if we are not a RPL Root */
+  if(dag->rank != ROOT_RANK(default_instance)) {
+    PRINTF(" -> generate No-Path DAO\n");
+#if RPL_WITH_DAO_AGGREGATION
+    /* The No-Paths of all routes that expire now go in one DAO */
+    if(dao_aggregate_target(default_instance, &prefix, 128,
+                            RPL_ZERO_LIFETIME)) {
+      return 1;
+    }
+#endif /* RPL_WITH_DAO_AGGREGATION */
+    dao_output_target(dag->preferred_parent, &prefix, RPL_ZERO_LIFETIME);
+    /* Don't schedule more than 1 No-Path DAO, let next iteration handle that */
+    return 0;
+  }
+  PRINTF("\n");
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 void
 rpl_purge_routes(void)
 {
   uip_ds6_route_t *r;
-  uip_ipaddr_t prefix;
-  rpl_dag_t *dag;
 #if RPL_CONF_MULTICAST
   uip_mcast6_route_t *mcast_route;
 #endif
 
+#if UIP_DS6_ROUTE_EXPIRY_HEAP
+  /* The routing table keeps the routes in order of expiration */
+  while((r = uip_ds6_route_expired()) != NULL) {
+    if(!purge_route(r)) {
+      return;
+    }
+  }
+#else /* UIP_DS6_ROUTE_EXPIRY_HEAP */
   /* First pass, decrement lifetime */
   r = uip_ds6_route_head();
 
@@ -139,24 +178,15 @@ rpl_purge_routes(void)
     if(r->state.lifetime < 1) {
       /* Routes with lifetime == 1 have only just been decremented from 2 to 1,
        * thus we want to keep them. Hence < and not <= */
-      uip_ipaddr_copy(&prefix, &r->ipaddr);
-      uip_ds6_route_rm(r);
-      r = uip_ds6_route_head();
-      PRINTF("No more routes to ");
-      PRINT6ADDR(&prefix);
-      dag = default_instance->current_dag;
-      /* Propagate this information with a No-Path DAO to preferred parent if we are not a RPL Root */
-      if(dag->rank != ROOT_RANK(default_instance)) {
-        PRINTF(" -> generate No-Path DAO\n");
-        dao_output_target(dag->preferred_parent, &prefix, RPL_ZERO_LIFETIME);
-        /* Don't schedule more than 1 No-Path DAO, let next iteration handle that */
+      if(!purge_route(r)) {
         return;
       }
-      PRINTF("\n");
+      r = uip_ds6_route_head();
     } else {
       r = uip_ds6_route_next(r);
     }
   }
+#endif /* UIP_DS6_ROUTE_EXPIRY_HEAP */
 
 #if RPL_CONF_MULTICAST
   mcast_route = uip_mcast6_route_list_head();
@@ -181,6 +211,8 @@ rpl_remove_routes(rpl_dag_t *dag)
   uip_mcast6_route_t *mcast_route;
 #endif
 
+  rpl_ns_remove_nodes(dag);
+
   r = uip_ds6_route_head();
 
   while(r != NULL) {
@@ -231,13 +263,15 @@ rpl_add_route(rpl_dag_t *dag, uip_ipaddr_t *prefix, int prefix_len,
 {
   uip_ds6_route_t *rep;
 
-  if((rep = uip_ds6_route_add(prefix, prefix_len, next_hop)) == NULL) {
+  if((rep = uip_ds6_route_add_table(prefix, prefix_len, next_hop,
+                                    RPL_ROUTE_TABLE(dag->instance))) == NULL) {
     PRINTF("RPL: No space for more route entries\n");
     return NULL;
   }
 
   rep->state.dag = dag;
-  rep->state.lifetime = RPL_LIFETIME(dag->instance, dag->instance->default_lifetime);
+  RPL_ROUTE_SET_LIFETIME(rep, RPL_LIFETIME(dag->instance,
+                                           dag->instance->default_lifetime));
   rep->state.learned_from = RPL_ROUTE_FROM_INTERNAL;
 
   PRINTF("RPL: Added a route to ");
@@ -249,6 +283,29 @@ rpl_add_route(rpl_dag_t *dag, uip_ipaddr_t *prefix, int prefix_len,
   return rep;
 }
 /*---------------------------------------------------------------------------*/
+#if LINK_STATS_ENABLED
+/* Take the link metric of a parent from the ETX that the link-stats
+   module keeps for the neighbor, instead of from the objective
+   function, so that all objective functions use the same estimate. */
+static void
+link_metric_from_stats(rpl_parent_t *parent, const linkaddr_t *addr)
+{
+  const struct link_stats *stats;
+  uip_ds6_nbr_t *nbr;
+
+  stats = link_stats_from_lladdr(addr);
+  nbr = rpl_get_nbr(parent);
+  if(stats == NULL || stats->etx == 0 || nbr == NULL) {
+    return;
+  }
+  nbr->link_metric = (uint32_t)stats->etx * RPL_DAG_MC_ETX_DIVISOR /
+    LINK_STATS_ETX_DIVISOR;
+  parent->flags |= RPL_PARENT_FLAG_LINK_METRIC_VALID;
+  PRINTF("RPL: link metric %u from link stats\n",
+         (unsigned)(nbr->link_metric / RPL_DAG_MC_ETX_DIVISOR));
+}
+#endif /* LINK_STATS_ENABLED */
+/*---------------------------------------------------------------------------*/
 void
 rpl_link_neighbor_callback(const linkaddr_t *addr, int status, int numtx)
 {
@@ -256,6 +313,11 @@ rpl_link_neighbor_callback(const linkaddr_t *addr, int status, int numtx)
   rpl_parent_t *parent;
   rpl_instance_t *instance;
   rpl_instance_t *end;
+#if RPL_WITH_PROBING
+  uip_ds6_nbr_t *nbr;
+  uint16_t old_metric;
+  uint16_t change;
+#endif /* RPL_WITH_PROBING */
 
   uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
   uip_ds6_set_addr_iid(&ipaddr, (uip_lladdr_t *)addr);
@@ -266,10 +328,30 @@ rpl_link_neighbor_callback(const linkaddr_t *addr, int status, int numtx)
       if(parent != NULL) {
         /* Trigger DAG rank recalculation. */
         PRINTF("RPL: rpl_link_neighbor_callback triggering update\n");
-        parent->flags |= RPL_PARENT_FLAG_UPDATED;
-        if(instance->of->neighbor_link_callback != NULL) {
+        RPL_PARENT_UPDATED(parent);
+        if(LINK_STATS_ENABLED || instance->of->neighbor_link_callback != NULL) {
+#if RPL_WITH_PROBING
+          nbr = rpl_get_nbr(parent);
+          old_metric = nbr != NULL ? nbr->link_metric : 0;
+#endif /* RPL_WITH_PROBING */
+#if LINK_STATS_ENABLED
+          link_metric_from_stats(parent, addr);
+#else /* LINK_STATS_ENABLED */
           instance->of->neighbor_link_callback(parent, status, numtx);
+#endif /* LINK_STATS_ENABLED */
           parent->last_tx_time = clock_time();
+#if RPL_WITH_PROBING
+          if(nbr != NULL) {
+            change = nbr->link_metric > old_metric ?
+              nbr->link_metric - old_metric : old_metric - nbr->link_metric;
+            parent->link_metric_dev =
+              ((uint32_t)parent->link_metric_dev * 3 + change) / 4;
+          }
+          /* The link has been measured, so it needs no probe. */
+          if(instance->probing_target == parent) {
+            instance->probing_target = NULL;
+          }
+#endif /* RPL_WITH_PROBING */
         }
       }
     }
@@ -293,7 +375,7 @@ rpl_ipv6_neighbor_callback(uip_ds6_nbr_t *nbr)
         p->rank = INFINITE_RANK;
         /* Trigger DAG rank recalculation. */
         PRINTF("RPL: rpl_ipv6_neighbor_callback infinite rank\n");
-        p->flags |= RPL_PARENT_FLAG_UPDATED;
+        RPL_PARENT_UPDATED(p);
       }
     }
   }
@@ -335,6 +417,7 @@ rpl_init(void)
   default_instance = NULL;
 
   rpl_dag_init();
+  rpl_ns_init();
   rpl_reset_periodic_timer();
   rpl_icmp6_register_handlers();
 
@@ -346,7 +429,9 @@ rpl_init(void)
   memset(&rpl_stats, 0, sizeof(rpl_stats));
 #endif
 
-  RPL_OF.reset(NULL);
+#if RPL_WITH_CHECKPOINT
+  rpl_checkpoint_restore();
+#endif /* RPL_WITH_CHECKPOINT */
 }
 /*---------------------------------------------------------------------------*/
 
@@ -106,6 +106,7 @@ struct rpl_dag;
 /*---------------------------------------------------------------------------*/
 #define RPL_PARENT_FLAG_UPDATED           0x1
 #define RPL_PARENT_FLAG_LINK_METRIC_VALID 0x2
+#define RPL_PARENT_FLAG_PATH_METRIC_VALID 0x4
 
 struct rpl_parent {
   struct rpl_dag *dag;
@@ -113,6 +114,14 @@ struct rpl_parent {
   rpl_metric_container_t mc;
 #endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
   rpl_rank_t rank;
+  /* The path cost through the parent, as computed by the objective
+     function, while RPL_PARENT_FLAG_PATH_METRIC_VALID is set */
+  uint16_t path_metric;
+#if RPL_WITH_PROBING
+  /* Moving average of how much each transmission moved the link
+     metric, which tells how uncertain the link metric is */
+  uint16_t link_metric_dev;
+#endif /* RPL_WITH_PROBING */
   clock_time_t last_tx_time;
   uint8_t dtsn;
   uint8_t flags;
@@ -159,7 +168,9 @@ typedef struct rpl_instance rpl_instance_t;
  *
  *  Receives link-layer neighbor information. The parameter "known" is set
  *  either to 0 or 1. The "etx" parameter specifies the current
- *  ETX(estimated transmissions) for the neighbor.
+ *  ETX(estimated transmissions) for the neighbor. With LINK_STATS_ENABLED
+ *  it is not called: the link metric of all objective functions is then
+ *  taken from the ETX of the link-stats module.
  *
  * best_parent(parent1, parent2)
  *
@@ -195,6 +206,10 @@ typedef struct rpl_of rpl_of_t;
 
 /* Declare the selected objective function. */
 extern rpl_of_t RPL_OF;
+/* The objective functions that come with ContikiRPL. */
+extern rpl_of_t rpl_of0;
+extern rpl_of_t rpl_mrhof;
+extern rpl_of_t rpl_energy_of;
 /*---------------------------------------------------------------------------*/
 /* Instance */
 struct rpl_instance {
@@ -227,12 +242,18 @@ struct rpl_instance {
   clock_time_t dio_next_delay; /* delay for completion of dio interval */
 #if RPL_WITH_PROBING
   struct ctimer probing_timer;
+  /* The parent that is due a probe, unless a packet is sent to it
+     before the probe */
+  rpl_parent_t *probing_target;
 #endif /* RPL_WITH_PROBING */
   struct ctimer dio_timer;
   struct ctimer dao_timer;
   struct ctimer dao_lifetime_timer;
   struct ctimer unicast_dio_timer;
-  rpl_parent_t *unicast_dio_target;
+  uip_ipaddr_t unicast_dio_target;
+#if RPL_WITH_FAST_JOIN
+  clock_time_t fast_join_dio_time;
+#endif /* RPL_WITH_FAST_JOIN */
 };
 
 /*---------------------------------------------------------------------------*/
@@ -240,6 +261,8 @@ struct rpl_instance {
 void rpl_init(void);
 void uip_rpl_input(void);
 rpl_dag_t *rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id);
+rpl_dag_t *rpl_set_root_with_of(uint8_t instance_id, uip_ipaddr_t *dag_id,
+                                rpl_of_t *of);
 int rpl_set_prefix(rpl_dag_t *dag, uip_ipaddr_t *prefix, unsigned len);
 int rpl_repair_root(uint8_t instance_id);
 int rpl_set_default_route(rpl_instance_t *instance, uip_ipaddr_t *from);
@@ -251,6 +274,15 @@ int rpl_verify_header(int);
 void rpl_insert_header(void);
 void rpl_remove_header(void);
 uint8_t rpl_invert_header(void);
+int rpl_insert_srh_header(void);
+int rpl_process_srh_header(void);
+int rpl_srh_get_next_hop(uip_ipaddr_t *ipaddr);
+rpl_instance_t *rpl_get_packet_instance(void);
+uip_ds6_route_t *rpl_lookup_route(uip_ipaddr_t *addr);
+uip_ipaddr_t *rpl_get_default_nexthop(void);
+void rpl_set_default_instance(rpl_instance_t *instance);
+int rpl_set_dscp_instance(uint8_t dscp, uint8_t instance_id);
+void rpl_set_output_instance(int instance_id);
 uip_ipaddr_t *rpl_get_parent_ipaddr(rpl_parent_t *nbr);
 rpl_parent_t *rpl_get_parent(uip_lladdr_t *addr);
 rpl_rank_t rpl_get_parent_rank(uip_lladdr_t *addr);
@@ -262,6 +294,10 @@ void rpl_print_neighbor_list(void);
 /* Per-parent RPL information */
 NBR_TABLE_DECLARE(rpl_parents);
 
+/* Given to rpl_set_output_instance() when packets should no longer be
+   sent in a particular instance. */
+#define RPL_OUTPUT_INSTANCE_NONE -1
+
 /**
  * RPL modes
  *
@@ -38,6 +38,7 @@
  */
 
 #include "sys/autostart.h"
+#include "sys/boot-profile.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -52,7 +53,8 @@ void
 autostart_start(struct process * const processes[])
 {
   int i;
-  
+
+  BOOT_PROFILE_MARK(BOOT_PROFILE_AUTOSTART);
   for(i = 0; processes[i] != NULL; ++i) {
     process_start(processes[i], NULL);
     PRINTF("autostart_start: starting process '%s'\n", processes[i]->name);
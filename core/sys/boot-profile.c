@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The boot profile, see boot-profile.h
+ */
+
+#include "contiki.h"
+#include "sys/boot-profile.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+
+/* Each phase keeps the clock and the rtimer: the rtimer is precise, the
+   clock tells whether the rtimer may have wrapped around since */
+static clock_time_t clock_times[BOOT_PROFILE_PHASES];
+static rtimer_clock_t rtimer_times[BOOT_PROFILE_PHASES];
+static uint16_t marked;
+
+/* The longest time, in clock ticks, that the rtimer can measure */
+#define RTIMER_SPAN ((clock_time_t)(((rtimer_clock_t)~0 >> 1) / RTIMER_SECOND) * CLOCK_SECOND)
+
+static const char *const names[BOOT_PROFILE_PHASES] = {
+  "start", "platform", "netstack", "autostart", "mac",
+  "address", "rpl", "first-tx", "app"
+};
+/*---------------------------------------------------------------------------*/
+void
+boot_profile_mark(enum boot_profile_phase phase)
+{
+  if(phase < BOOT_PROFILE_PHASES && !(marked & (1 << phase))) {
+    rtimer_times[phase] = RTIMER_NOW();
+    clock_times[phase] = clock_time();
+    marked |= 1 << phase;
+  }
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+boot_profile_get(enum boot_profile_phase phase)
+{
+  clock_time_t clock_start = 0;
+  rtimer_clock_t rtimer_start = 0;
+  clock_time_t elapsed;
+
+  if(phase >= BOOT_PROFILE_PHASES || !(marked & (1 << phase))) {
+    return BOOT_PROFILE_NONE;
+  }
+  if(marked & (1 << BOOT_PROFILE_START)) {
+    clock_start = clock_times[BOOT_PROFILE_START];
+    rtimer_start = rtimer_times[BOOT_PROFILE_START];
+  }
+  elapsed = clock_times[phase] - clock_start;
+  if(elapsed < RTIMER_SPAN) {
+    return (uint64_t)(rtimer_clock_t)(rtimer_times[phase] - rtimer_start)
+      * 1000000 / RTIMER_SECOND;
+  }
+  return (uint64_t)elapsed * 1000000 / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+const char *
+boot_profile_phase_name(enum boot_profile_phase phase)
+{
+  return phase < BOOT_PROFILE_PHASES ? names[phase] : "?";
+}
+/*---------------------------------------------------------------------------*/
+void
+boot_profile_print(void)
+{
+  unsigned long previous = 0;
+  unsigned long t;
+  int i;
+
+  for(i = 0; i < BOOT_PROFILE_PHASES; i++) {
+    t = boot_profile_get(i);
+    if(t == BOOT_PROFILE_NONE) {
+      printf("Boot: %-9s -\n", names[i]);
+    } else {
+      /* Phases may be reached out of order, e.g. with a MAC that
+         associates after the address is preferred */
+      unsigned long delta = t > previous ? t - previous : 0;
+      printf("Boot: %-9s %7lu.%03lu ms (+%lu.%03lu)\n", names[i],
+             t / 1000, t % 1000, delta / 1000, delta % 1000);
+      if(t > previous) {
+        previous = t;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the boot profile
+ */
+
+/**
+ * \addtogroup sys
+ * @{
+ */
+
+/**
+ * \defgroup boot-profile Boot profile
+ * @{
+ *
+ * The boot profile records when a node passes the phases from power-on
+ * to a network-ready node: end of the platform initialization, network
+ * stack initialization, autostart, MAC association, preferred link-local
+ * address, RPL join and first IPv6 packet. Each phase is recorded the
+ * first time it is reached, so that boot_profile_print() gives the
+ * breakdown of a boot and shows which stage to speed up.
+ *
+ * Times are relative to BOOT_PROFILE_START, that the platform marks as
+ * early as its timers allow, or to the start of the clock otherwise.
+ * Marks compile to nothing unless BOOT_PROFILE_CONF_ENABLED is set.
+ *
+ * BOOT_CONF_FAST selects a configuration that reaches the network
+ * sooner: addresses derived from the link-layer address skip duplicate
+ * address detection, and router and DODAG solicitations start at once
+ * (RPL fast join) instead of after fixed delays.
+ */
+
+#ifndef BOOT_PROFILE_H_
+#define BOOT_PROFILE_H_
+
+#include "contiki-conf.h"
+
+#ifdef BOOT_PROFILE_CONF_ENABLED
+#define BOOT_PROFILE_ENABLED BOOT_PROFILE_CONF_ENABLED
+#else /* BOOT_PROFILE_CONF_ENABLED */
+#define BOOT_PROFILE_ENABLED 0
+#endif /* BOOT_PROFILE_CONF_ENABLED */
+
+#ifdef BOOT_CONF_FAST
+#define BOOT_FAST BOOT_CONF_FAST
+#else /* BOOT_CONF_FAST */
+#define BOOT_FAST 0
+#endif /* BOOT_CONF_FAST */
+
+/** The boot phases, in the order they are usually reached */
+enum boot_profile_phase {
+  BOOT_PROFILE_START,      /**< Timers started, marked by the platform */
+  BOOT_PROFILE_PLATFORM,   /**< Platform initialized, netstack_init() called */
+  BOOT_PROFILE_NETSTACK,   /**< Network stack initialized */
+  BOOT_PROFILE_AUTOSTART,  /**< Application processes started */
+  BOOT_PROFILE_MAC,        /**< Associated, with a MAC that associates */
+  BOOT_PROFILE_ADDRESS,    /**< First address preferred */
+  BOOT_PROFILE_RPL,        /**< Joined a DODAG, or became its root */
+  BOOT_PROFILE_FIRST_TX,   /**< First IPv6 packet sent */
+  BOOT_PROFILE_APP,        /**< Marked by the application */
+
+  BOOT_PROFILE_PHASES
+};
+
+/** Returned by boot_profile_get() for a phase not reached yet */
+#define BOOT_PROFILE_NONE 0xffffffffUL
+
+#if BOOT_PROFILE_ENABLED
+#define BOOT_PROFILE_MARK(phase) boot_profile_mark(phase)
+#else /* BOOT_PROFILE_ENABLED */
+#define BOOT_PROFILE_MARK(phase)
+#endif /* BOOT_PROFILE_ENABLED */
+
+/** Record the time of a phase, unless it was recorded already. */
+void boot_profile_mark(enum boot_profile_phase phase);
+
+/**
+ * The time of a phase, in microseconds since the start, or
+ * BOOT_PROFILE_NONE.
+ */
+unsigned long boot_profile_get(enum boot_profile_phase phase);
+
+/** The name of a phase, e.g. "rpl". */
+const char *boot_profile_phase_name(enum boot_profile_phase phase);
+
+/**
+ * Print one "Boot: <phase> <time> ms" line per phase, with the time
+ * since the start and since the previous phase reached.
+ */
+void boot_profile_print(void);
+
+#endif /* BOOT_PROFILE_H_ */
+
+/** @} */
+/** @} */
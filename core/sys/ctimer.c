@@ -46,8 +46,6 @@
 #include "contiki.h"
 #include "lib/list.h"
 
-LIST(ctimer_list);
-
 static char initialized;
 
 #define DEBUG 0
@@ -58,6 +56,281 @@ static char initialized;
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+#if CTIMER_WHEEL_SIZE
+/*
+ * Hashed timer wheel. A pending callback timer is linked into the
+ * bucket given by its expiration time modulo the wheel size. A single
+ * event timer is set for the earliest expiration time. When it fires,
+ * the buckets for all clock ticks that have passed since the last run
+ * are visited and the callback timers in them that have expired are
+ * called. Timers that are more than one turn of the wheel away stay
+ * in their bucket until a later turn.
+ *
+ * Each pending timer points back to the pointer that points to it, so
+ * it can be unlinked without knowing which bucket it is in.
+ */
+#define WHEEL_MASK (CTIMER_WHEEL_SIZE - 1)
+
+static struct ctimer *wheel[CTIMER_WHEEL_SIZE];
+/* Callback timers that have been removed from the wheel and are about
+   to be called. */
+static struct ctimer *fired;
+/* The last clock tick for which the buckets have been visited. */
+static clock_time_t wheel_time;
+static struct etimer wheel_timer;
+/* Number of callback timers that are set and not yet called. */
+static unsigned num_pending;
+
+PROCESS(ctimer_process, "Ctimer process");
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+time_left(struct timer *t, clock_time_t now)
+{
+  clock_time_t elapsed;
+
+  elapsed = now - t->start;
+  if(elapsed >= t->interval) {
+    return 0;
+  }
+  return t->interval - elapsed;
+}
+/*---------------------------------------------------------------------------*/
+static void
+link_timer(struct ctimer **head, struct ctimer *c)
+{
+  c->next = *head;
+  if(c->next != NULL) {
+    c->next->pprev = &c->next;
+  }
+  c->pprev = head;
+  *head = c;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_pending(struct ctimer *c)
+{
+  /* The memory of a timer that has never been set may be
+     uninitialized, so check the back pointer as well. */
+  return c->etimer.p == &ctimer_process &&
+    c->pprev != NULL && *c->pprev == c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+unlink_timer(struct ctimer *c)
+{
+  *c->pprev = c->next;
+  if(c->next != NULL) {
+    c->next->pprev = c->pprev;
+  }
+  c->next = NULL;
+  c->pprev = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule(clock_time_t left, clock_time_t now)
+{
+  if(!initialized) {
+    /* The event timer is set when the ctimer process starts. */
+    return;
+  }
+  if(etimer_expired(&wheel_timer) ||
+     left < time_left(&wheel_timer.timer, now)) {
+    PROCESS_CONTEXT_BEGIN(&ctimer_process);
+    etimer_set(&wheel_timer, left);
+    PROCESS_CONTEXT_END(&ctimer_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_timer(struct ctimer *c)
+{
+  clock_time_t now, left;
+  clock_time_t expiration;
+
+  now = clock_time();
+
+  if(is_pending(c)) {
+    unlink_timer(c);
+  } else {
+    if(num_pending == 0) {
+      /* Nothing has been visited for a while, so start over from the
+         current time. */
+      wheel_time = now;
+    }
+    num_pending++;
+  }
+  /* Marks the timer as pending for etimer_expired(). */
+  c->etimer.p = &ctimer_process;
+
+  left = time_left(&c->etimer.timer, now);
+  if(left == 0) {
+    /* Already expired: put it in the first bucket that will be
+       visited on the next run. */
+    expiration = wheel_time + 1;
+  } else {
+    expiration = now + left;
+  }
+  link_timer(&wheel[expiration & WHEEL_MASK], c);
+  PRINTF("ctimer: add %p bucket %u left %u\n", c,
+         (unsigned)(expiration & WHEEL_MASK), (unsigned)left);
+  schedule(left, now);
+}
+/*---------------------------------------------------------------------------*/
+static void
+collect_bucket(struct ctimer **bucket, clock_time_t now)
+{
+  struct ctimer *c, *next;
+
+  for(c = *bucket; c != NULL; c = next) {
+    next = c->next;
+    if(time_left(&c->etimer.timer, now) == 0) {
+      unlink_timer(c);
+      link_timer(&fired, c);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+reschedule(clock_time_t now)
+{
+  struct ctimer *c;
+  clock_time_t k, left, min;
+  int found;
+
+  /* Visit the buckets in expiration order. A timer in the bucket k
+     ticks from now that expires in k ticks is the next one to
+     expire. Otherwise, fall back to the smallest time left seen. */
+  found = 0;
+  min = 0;
+  for(k = 1; k <= CTIMER_WHEEL_SIZE; k++) {
+    for(c = wheel[(now + k) & WHEEL_MASK]; c != NULL; c = c->next) {
+      left = time_left(&c->etimer.timer, now);
+      if(left == k) {
+        schedule(left, now);
+        return;
+      }
+      if(!found || left < min) {
+        min = left;
+        found = 1;
+      }
+    }
+  }
+  if(found) {
+    schedule(min, now);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ctimer_process, ev, data)
+{
+  struct ctimer *c;
+  clock_time_t now, elapsed, t;
+  int i;
+
+  PROCESS_BEGIN();
+
+  initialized = 1;
+  reschedule(clock_time());
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
+
+    now = clock_time();
+    elapsed = now - wheel_time;
+    if(elapsed >= CTIMER_WHEEL_SIZE) {
+      for(i = 0; i < CTIMER_WHEEL_SIZE; i++) {
+        collect_bucket(&wheel[i], now);
+      }
+    } else {
+      /* Timers that had already expired when they were set are in the
+         bucket after wheel_time, so always visit that one. */
+      if(elapsed == 0) {
+        elapsed = 1;
+      }
+      for(t = 1; t <= elapsed; t++) {
+        collect_bucket(&wheel[(wheel_time + t) & WHEEL_MASK], now);
+      }
+    }
+    wheel_time = now;
+
+    /* A callback may stop or re-arm any timer, including the ones
+       still on the fired list, so always take the first one. */
+    while(fired != NULL) {
+      c = fired;
+      unlink_timer(c);
+      c->etimer.p = PROCESS_NONE;
+      num_pending--;
+      PROCESS_CONTEXT_BEGIN(c->p);
+      if(c->f != NULL) {
+        c->f(c->ptr);
+      }
+      PROCESS_CONTEXT_END(c->p);
+    }
+
+    reschedule(clock_time());
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_init(void)
+{
+  initialized = 0;
+  wheel_time = clock_time();
+  process_start(&ctimer_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_set(struct ctimer *c, clock_time_t t,
+	   void (*f)(void *), void *ptr)
+{
+  ctimer_set_with_process(c, t, f, ptr, PROCESS_CURRENT());
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_set_with_process(struct ctimer *c, clock_time_t t,
+	   void (*f)(void *), void *ptr, struct process *p)
+{
+  PRINTF("ctimer_set %p %u\n", c, (unsigned)t);
+  c->p = p;
+  c->f = f;
+  c->ptr = ptr;
+  timer_set(&c->etimer.timer, t);
+  add_timer(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_reset(struct ctimer *c)
+{
+  timer_reset(&c->etimer.timer);
+  add_timer(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_restart(struct ctimer *c)
+{
+  timer_restart(&c->etimer.timer);
+  add_timer(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_stop(struct ctimer *c)
+{
+  if(is_pending(c)) {
+    unlink_timer(c);
+    num_pending--;
+  }
+  c->etimer.next = NULL;
+  c->etimer.p = PROCESS_NONE;
+}
+/*---------------------------------------------------------------------------*/
+int
+ctimer_expired(struct ctimer *c)
+{
+  return c->etimer.p == PROCESS_NONE;
+}
+#else /* CTIMER_WHEEL_SIZE */
+LIST(ctimer_list);
 /*---------------------------------------------------------------------------*/
 PROCESS(ctimer_process, "Ctimer process");
 PROCESS_THREAD(ctimer_process, ev, data)
@@ -171,5 +444,6 @@ ctimer_expired(struct ctimer *c)
   }
   return 1;
 }
+#endif /* CTIMER_WHEEL_SIZE */
 /*---------------------------------------------------------------------------*/
 /** @} */
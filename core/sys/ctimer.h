@@ -56,8 +56,32 @@
 
 #include "sys/etimer.h"
 
+/*
+ * If CTIMER_CONF_WHEEL_SIZE is set to a non-zero power of two, pending
+ * callback timers are kept in a hashed timer wheel with that many
+ * buckets instead of one list with one event timer per callback
+ * timer. Stopping or re-arming a callback timer then takes constant
+ * time, and all callback timers that have expired are run from a
+ * single timer event. The etimer member is still used to hold the
+ * start time and interval of the callback timer, so
+ * etimer_expired(&c->etimer) and etimer_expiration_time(&c->etimer)
+ * work in both modes.
+ */
+#ifdef CTIMER_CONF_WHEEL_SIZE
+#define CTIMER_WHEEL_SIZE CTIMER_CONF_WHEEL_SIZE
+#else /* CTIMER_CONF_WHEEL_SIZE */
+#define CTIMER_WHEEL_SIZE 0
+#endif /* CTIMER_CONF_WHEEL_SIZE */
+
+#if CTIMER_WHEEL_SIZE & (CTIMER_WHEEL_SIZE - 1)
+#error CTIMER_CONF_WHEEL_SIZE must be a power of two
+#endif
+
 struct ctimer {
   struct ctimer *next;
+#if CTIMER_WHEEL_SIZE
+  struct ctimer **pprev;
+#endif /* CTIMER_WHEEL_SIZE */
   struct etimer etimer;
   struct process *p;
   void (*f)(void *);
@@ -40,6 +40,8 @@
 #include "sys/energest.h"
 #include "contiki-conf.h"
 
+#include <string.h>
+
 #if ENERGEST_CONF_ON
 
 int energest_total_count;
@@ -50,6 +52,16 @@ energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVICE_LEVE
 #endif
 unsigned char energest_current_mode[ENERGEST_TYPE_MAX];
 
+#if ENERGEST_SUBSYSTEMS
+unsigned char energest_active_subsystem;
+unsigned char energest_type_subsystem[ENERGEST_TYPE_MAX];
+static unsigned long subsystem_time[ENERGEST_SUBSYSTEM_MAX][ENERGEST_TYPE_MAX];
+
+static const char *subsystem_names[ENERGEST_SUBSYSTEM_MAX] = {
+  "other", "app", "mac", "tsch", "rpl", "coap"
+};
+#endif /* ENERGEST_SUBSYSTEMS */
+
 /*---------------------------------------------------------------------------*/
 void
 energest_init(void)
@@ -64,6 +76,11 @@ energest_init(void)
     energest_leveldevice_current_leveltime[i].current = 0;
   }
 #endif
+#if ENERGEST_SUBSYSTEMS
+  energest_active_subsystem = ENERGEST_SUBSYSTEM_OTHER;
+  memset(energest_type_subsystem, 0, sizeof(energest_type_subsystem));
+  memset(subsystem_time, 0, sizeof(subsystem_time));
+#endif /* ENERGEST_SUBSYSTEMS */
 }
 /*---------------------------------------------------------------------------*/
 unsigned long
@@ -73,8 +90,7 @@ energest_type_time(int type)
 #ifndef ENERGEST_CONF_LEVELDEVICE_LEVELS
   if(energest_current_mode[type]) {
     rtimer_clock_t now = RTIMER_NOW();
-    energest_total_time[type].current += (rtimer_clock_t)
-      (now - energest_current_time[type]);
+    ENERGEST_ADD(type, (rtimer_clock_t)(now - energest_current_time[type]));
     energest_current_time[type] = now;
   }
 #endif /* ENERGEST_CONF_LEVELDEVICE_LEVELS */
@@ -106,13 +122,63 @@ energest_flush(void)
   for(i = 0; i < ENERGEST_TYPE_MAX; i++) {
     if(energest_current_mode[i]) {
       now = RTIMER_NOW();
-      energest_total_time[i].current += (rtimer_clock_t)
-	(now - energest_current_time[i]);
+      ENERGEST_ADD(i, (rtimer_clock_t)(now - energest_current_time[i]));
       energest_current_time[i] = now;
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+#if ENERGEST_SUBSYSTEMS
+void
+energest_add(int type, rtimer_clock_t diff)
+{
+  energest_total_time[type].current += diff;
+  subsystem_time[energest_type_subsystem[type]][type] += diff;
+}
+/*---------------------------------------------------------------------------*/
+int
+energest_subsystem_set(int subsystem)
+{
+  int previous;
+  rtimer_clock_t now;
+
+  previous = energest_active_subsystem;
+  if(subsystem == previous || subsystem >= ENERGEST_SUBSYSTEM_MAX) {
+    return previous;
+  }
+
+  /* The CPU time so far belongs to the previous subsystem. The other
+     types stay with the subsystem that switched them on. */
+  if(energest_current_mode[ENERGEST_TYPE_CPU]) {
+    now = RTIMER_NOW();
+    energest_add(ENERGEST_TYPE_CPU,
+                 (rtimer_clock_t)(now - energest_current_time[ENERGEST_TYPE_CPU]));
+    energest_current_time[ENERGEST_TYPE_CPU] = now;
+  }
+  energest_active_subsystem = subsystem;
+  energest_type_subsystem[ENERGEST_TYPE_CPU] = subsystem;
+  return previous;
+}
+/*---------------------------------------------------------------------------*/
+int
+energest_subsystem_get(void)
+{
+  return energest_active_subsystem;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_subsystem_time(int subsystem, int type)
+{
+  return subsystem_time[subsystem][type];
+}
+/*---------------------------------------------------------------------------*/
+const char *
+energest_subsystem_name(int subsystem)
+{
+  return subsystem_names[subsystem];
+}
+#endif /* ENERGEST_SUBSYSTEMS */
+/*---------------------------------------------------------------------------*/
 #else /* ENERGEST_CONF_ON */
 void energest_type_set(int type, unsigned long val) {}
 void energest_init(void) {}
@@ -67,6 +67,33 @@ enum energest_type {
   ENERGEST_TYPE_MAX
 };
 
+/*
+ * With ENERGEST_CONF_SUBSYSTEMS, the time of each type is also
+ * attributed to the subsystem that caused it. The CPU time goes to
+ * the subsystem that is set with energest_subsystem_set(), the time
+ * of the other types goes to the subsystem that was set when the
+ * type was switched on. Outgoing packets carry the subsystem in
+ * PACKETBUF_ATTR_ENERGEST_SUBSYSTEM, so that the MAC layer can
+ * attribute the radio time of a transmission to the subsystem that
+ * sent the packet.
+ */
+#ifdef ENERGEST_CONF_SUBSYSTEMS
+#define ENERGEST_SUBSYSTEMS ENERGEST_CONF_SUBSYSTEMS
+#else /* ENERGEST_CONF_SUBSYSTEMS */
+#define ENERGEST_SUBSYSTEMS 0
+#endif /* ENERGEST_CONF_SUBSYSTEMS */
+
+enum energest_subsystem {
+  ENERGEST_SUBSYSTEM_OTHER,
+  ENERGEST_SUBSYSTEM_APP,
+  ENERGEST_SUBSYSTEM_MAC,
+  ENERGEST_SUBSYSTEM_TSCH,
+  ENERGEST_SUBSYSTEM_RPL,
+  ENERGEST_SUBSYSTEM_COAP,
+
+  ENERGEST_SUBSYSTEM_MAX
+};
+
 void energest_init(void);
 unsigned long energest_type_time(int type);
 #ifdef ENERGEST_CONF_LEVELDEVICE_LEVELS
@@ -75,6 +102,25 @@ unsigned long energest_leveldevice_leveltime(int powerlevel);
 void energest_type_set(int type, unsigned long value);
 void energest_flush(void);
 
+#if ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS
+int energest_subsystem_set(int subsystem);
+int energest_subsystem_get(void);
+unsigned long energest_subsystem_time(int subsystem, int type);
+const char *energest_subsystem_name(int subsystem);
+void energest_add(int type, rtimer_clock_t diff);
+
+extern unsigned char energest_active_subsystem;
+extern unsigned char energest_type_subsystem[ENERGEST_TYPE_MAX];
+
+#define ENERGEST_SUBSYSTEM_TAG(type) \
+  (energest_type_subsystem[type] = energest_active_subsystem)
+#define ENERGEST_ADD(type, diff) energest_add(type, diff)
+#else /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
+#define ENERGEST_SUBSYSTEM_TAG(type)
+#define ENERGEST_ADD(type, diff) \
+  (energest_total_time[type].current += (diff))
+#endif /* ENERGEST_CONF_ON && ENERGEST_SUBSYSTEMS */
+
 #if ENERGEST_CONF_ON
 /*extern int energest_total_count;*/
 extern energest_t energest_total_time[ENERGEST_TYPE_MAX];
@@ -89,13 +135,14 @@ extern energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVI
                            /*++energest_total_count;*/ \
                            energest_current_time[type] = RTIMER_NOW(); \
 			   energest_current_mode[type] = 1; \
+                           ENERGEST_SUBSYSTEM_TAG(type); \
                            } while(0)
 #ifdef __AVR__
 /* Handle 16 bit rtimer wraparound */
 #define ENERGEST_OFF(type) if(energest_current_mode[type] != 0) do {	\
 							if (RTIMER_NOW() < energest_current_time[type]) energest_total_time[type].current += RTIMER_ARCH_SECOND; \
-							energest_total_time[type].current += (rtimer_clock_t)(RTIMER_NOW() - \
-							energest_current_time[type]); \
+							ENERGEST_ADD(type, (rtimer_clock_t)(RTIMER_NOW() - \
+							energest_current_time[type])); \
 							energest_current_mode[type] = 0; \
                            } while(0)
 
@@ -112,18 +159,19 @@ extern energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVI
                                                if (energest_local_variable_now < energest_current_time[type_off]) { \
                                                  energest_total_time[type_off].current += RTIMER_ARCH_SECOND; \
                                                } \
-                                               energest_total_time[type_off].current += (rtimer_clock_t)(energest_local_variable_now - \
-                                                 energest_current_time[type_off]); \
+                                               ENERGEST_ADD(type_off, (rtimer_clock_t)(energest_local_variable_now - \
+                                                 energest_current_time[type_off])); \
                                                energest_current_mode[type_off] = 0; \
                                              } \
                                              energest_current_time[type_on] = energest_local_variable_now; \
                                              energest_current_mode[type_on] = 1; \
+                                             ENERGEST_SUBSYSTEM_TAG(type_on); \
                                            } while(0)
 
 #else
 #define ENERGEST_OFF(type) if(energest_current_mode[type] != 0) do {	\
-                           energest_total_time[type].current += (rtimer_clock_t)(RTIMER_NOW() - \
-                           energest_current_time[type]); \
+                           ENERGEST_ADD(type, (rtimer_clock_t)(RTIMER_NOW() - \
+                           energest_current_time[type])); \
 			   energest_current_mode[type] = 0; \
                            } while(0)
 
@@ -136,12 +184,13 @@ extern energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVI
 #define ENERGEST_SWITCH(type_off, type_on) do { \
                                              rtimer_clock_t energest_local_variable_now = RTIMER_NOW(); \
                                              if(energest_current_mode[type_off] != 0) { \
-                                               energest_total_time[type_off].current += (rtimer_clock_t)(energest_local_variable_now - \
-                                                 energest_current_time[type_off]); \
+                                               ENERGEST_ADD(type_off, (rtimer_clock_t)(energest_local_variable_now - \
+                                                 energest_current_time[type_off])); \
                                                energest_current_mode[type_off] = 0; \
                                              } \
                                              energest_current_time[type_on] = energest_local_variable_now; \
                                              energest_current_mode[type_on] = 1; \
+                                             ENERGEST_SUBSYSTEM_TAG(type_on); \
                                            } while(0)
 #endif
 
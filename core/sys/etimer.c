@@ -49,11 +49,94 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+/* If ETIMER_CONF_SORTED is set, the list of pending event timers is
+   kept sorted by expiration time. Finding the next expiration and
+   the timers that have fired then only needs to look at the head of
+   the list, at the cost of a list walk when a timer is set. This
+   pays off on nodes with many pending timers. */
+#ifdef ETIMER_CONF_SORTED
+#define ETIMER_SORTED ETIMER_CONF_SORTED
+#else /* ETIMER_CONF_SORTED */
+#define ETIMER_SORTED 0
+#endif /* ETIMER_CONF_SORTED */
+
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+#if ETIMER_SORTED
+/* Time left until the timer expires, or zero if it already has. This
+   is wrap-safe as long as the interval is less than the clock range,
+   and since all pending timers count down at the same rate, the
+   order between them stays the same as time passes. */
+static clock_time_t
+time_left(struct etimer *t, clock_time_t now)
+{
+  clock_time_t elapsed;
+
+  elapsed = now - t->timer.start;
+  if(elapsed >= t->timer.interval) {
+    return 0;
+  }
+  return t->timer.interval - elapsed;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  if(timerlist == NULL) {
+    next_expiration = 0;
+  } else {
+    /* The list is sorted, so the first timer is the next to expire. */
+    next_expiration = timerlist->timer.start + timerlist->timer.interval;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+remove_timer(struct etimer *et)
+{
+  struct etimer *t, *u;
+
+  u = NULL;
+  for(t = timerlist; t != NULL; t = t->next) {
+    if(t == et) {
+      if(u != NULL) {
+        u->next = t->next;
+      } else {
+        timerlist = t->next;
+      }
+      t->next = NULL;
+      return 1;
+    }
+    u = t;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *et)
+{
+  struct etimer *t, *u;
+  clock_time_t now, left;
+
+  now = clock_time();
+  left = time_left(et, now);
+
+  /* Timers with the same expiration time are kept in the order they
+     were set. */
+  u = NULL;
+  for(t = timerlist; t != NULL && time_left(t, now) <= left; t = t->next) {
+    u = t;
+  }
+  et->next = t;
+  if(u != NULL) {
+    u->next = et;
+  } else {
+    timerlist = et;
+  }
+}
+#else /* ETIMER_SORTED */
 static void
 update_time(void)
 {
@@ -76,10 +159,14 @@ update_time(void)
     next_expiration = now + tdist;
   }
 }
+#endif /* ETIMER_SORTED */
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(etimer_process, ev, data)
 {
-  struct etimer *t, *u;
+  struct etimer *t;
+#if !ETIMER_SORTED
+  struct etimer *u;
+#endif /* !ETIMER_SORTED */
 	
   PROCESS_BEGIN();
 
@@ -104,11 +191,30 @@ PROCESS_THREAD(etimer_process, ev, data)
 	    t = t->next;
 	}
       }
+#if ETIMER_SORTED
+      update_time();
+#endif /* ETIMER_SORTED */
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
     }
 
+#if ETIMER_SORTED
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) != PROCESS_ERR_OK) {
+        etimer_request_poll();
+        break;
+      }
+      /* Reset the process ID of the event timer, to signal that the
+         etimer has expired. This is later checked in the
+         etimer_expired() function. */
+      t->p = PROCESS_NONE;
+      timerlist = t->next;
+      t->next = NULL;
+    }
+    update_time();
+#else /* ETIMER_SORTED */
   again:
     
     u = NULL;
@@ -135,7 +241,7 @@ PROCESS_THREAD(etimer_process, ev, data)
       }
       u = t;
     }
-    
+#endif /* ETIMER_SORTED */
   }
   
   PROCESS_END();
@@ -154,6 +260,15 @@ add_timer(struct etimer *timer)
 
   etimer_request_poll();
 
+#if ETIMER_SORTED
+  if(timer->p != PROCESS_NONE) {
+    /* Timer may already be on the list and needs to be moved to its
+       new position. */
+    remove_timer(timer);
+  }
+  timer->p = PROCESS_CURRENT();
+  insert_timer(timer);
+#else /* ETIMER_SORTED */
   if(timer->p != PROCESS_NONE) {
     for(t = timerlist; t != NULL; t = t->next) {
       if(t == timer) {
@@ -169,6 +284,7 @@ add_timer(struct etimer *timer)
   timer->p = PROCESS_CURRENT();
   timer->next = timerlist;
   timerlist = timer;
+#endif /* ETIMER_SORTED */
 
   update_time();
 }
@@ -206,6 +322,11 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
+#if ETIMER_SORTED
+  if(et->p != PROCESS_NONE && remove_timer(et)) {
+    insert_timer(et);
+  }
+#endif /* ETIMER_SORTED */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
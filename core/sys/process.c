@@ -47,6 +47,9 @@
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#if PROCESS_PROFILE
+#include "sys/clock.h"
+#endif /* PROCESS_PROFILE */
 
 /*
  * Pointer to the currently running process structure.
@@ -63,6 +66,12 @@ struct event_data {
   process_event_t ev;
   process_data_t data;
   struct process *p;
+#if PROCESS_PRIORITY_LEVELS > 1
+  process_num_events_t next;
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
+#if PROCESS_PROFILE
+  rtimer_clock_t posted;
+#endif /* PROCESS_PROFILE */
 };
 
 static process_num_events_t nevents, fevent;
@@ -70,8 +79,32 @@ static struct event_data events[PROCESS_CONF_NUMEVENTS];
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+unsigned int process_overflows;
+#if PROCESS_COALESCE
+unsigned int process_coalesced;
+#endif /* PROCESS_COALESCE */
 #endif
 
+#if PROCESS_PRIORITY_LEVELS > 1
+/*
+ * With priorities, the event slots form one FIFO queue per priority
+ * level, linked through the next field, and a list of free slots.
+ */
+#define EVENT_NONE PROCESS_CONF_NUMEVENTS
+#if PROCESS_CONF_NUMEVENTS > 255
+#error PROCESS_CONF_NUMEVENTS must be less than 256 with priority levels
+#endif
+
+static process_num_events_t queue_head[PROCESS_PRIORITY_LEVELS];
+static process_num_events_t queue_tail[PROCESS_PRIORITY_LEVELS];
+static process_num_events_t queue_len[PROCESS_PRIORITY_LEVELS];
+static process_num_events_t free_event;
+
+#if PROCESS_CONF_STATS
+process_num_events_t process_maxevents_priority[PROCESS_PRIORITY_LEVELS];
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
+
 static volatile unsigned char poll_requested;
 
 #define PROCESS_STATE_NONE        0
@@ -80,6 +113,12 @@ static volatile unsigned char poll_requested;
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
 
+#if PROCESS_PROFILE
+/* Time spent in processes called synchronously from the process that
+   is currently running, which is not counted for that process. */
+static unsigned long nested_time;
+#endif /* PROCESS_PROFILE */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -171,10 +210,27 @@ exit_process(struct process *p, struct process *fromprocess)
   process_current = old_current;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PROFILE
+static void
+update_latency(struct process *p, rtimer_clock_t since)
+{
+  rtimer_clock_t latency;
+
+  latency = RTIMER_NOW() - since;
+  if(latency > p->profile.max_latency) {
+    p->profile.max_latency = latency;
+  }
+}
+#endif /* PROCESS_PROFILE */
+/*---------------------------------------------------------------------------*/
 static void
 call_process(struct process *p, process_event_t ev, process_data_t data)
 {
   int ret;
+#if PROCESS_PROFILE
+  rtimer_clock_t start, elapsed;
+  unsigned long outer_nested_time;
+#endif /* PROCESS_PROFILE */
 
 #if DEBUG
   if(p->state == PROCESS_STATE_CALLED) {
@@ -187,7 +243,18 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_PROFILE
+    outer_nested_time = nested_time;
+    nested_time = 0;
+    start = RTIMER_NOW();
+#endif /* PROCESS_PROFILE */
     ret = p->thread(&p->pt, ev, data);
+#if PROCESS_PROFILE
+    elapsed = RTIMER_NOW() - start;
+    p->profile.time += elapsed - nested_time;
+    p->profile.calls++;
+    nested_time = outer_nested_time + elapsed;
+#endif /* PROCESS_PROFILE */
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -212,8 +279,30 @@ process_init(void)
   nevents = fevent = 0;
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
+  process_overflows = 0;
+#if PROCESS_COALESCE
+  process_coalesced = 0;
+#endif /* PROCESS_COALESCE */
 #endif /* PROCESS_CONF_STATS */
 
+#if PROCESS_PRIORITY_LEVELS > 1
+  {
+    process_num_events_t i;
+
+    for(i = 0; i < PROCESS_PRIORITY_LEVELS; i++) {
+      queue_head[i] = queue_tail[i] = EVENT_NONE;
+      queue_len[i] = 0;
+#if PROCESS_CONF_STATS
+      process_maxevents_priority[i] = 0;
+#endif /* PROCESS_CONF_STATS */
+    }
+    for(i = 0; i < PROCESS_CONF_NUMEVENTS; i++) {
+      events[i].next = i + 1;
+    }
+    free_event = 0;
+  }
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
+
   process_current = process_list = NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -232,6 +321,9 @@ do_poll(void)
     if(p->needspoll) {
       p->state = PROCESS_STATE_RUNNING;
       p->needspoll = 0;
+#if PROCESS_PROFILE
+      update_latency(p, p->profile.poll_time);
+#endif /* PROCESS_PROFILE */
       call_process(p, PROCESS_EVENT_POLL, NULL);
     }
   }
@@ -249,6 +341,13 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+#if PROCESS_PRIORITY_LEVELS > 1
+  static unsigned char prio;
+  static process_num_events_t i;
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
+#if PROCESS_PROFILE
+  static rtimer_clock_t posted;
+#endif /* PROCESS_PROFILE */
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -260,16 +359,45 @@ do_event(void)
 
   if(nevents > 0) {
     
+#if PROCESS_PRIORITY_LEVELS > 1
+    /* Take the first event of the highest priority level that has
+       any events queued, and put its slot back on the free list. */
+    for(prio = 0; queue_head[prio] == EVENT_NONE; prio++);
+    i = queue_head[prio];
+    ev = events[i].ev;
+    data = events[i].data;
+    receiver = events[i].p;
+#if PROCESS_PROFILE
+    posted = events[i].posted;
+#endif /* PROCESS_PROFILE */
+
+    queue_head[prio] = events[i].next;
+    if(queue_head[prio] == EVENT_NONE) {
+      queue_tail[prio] = EVENT_NONE;
+    }
+    --queue_len[prio];
+    events[i].next = free_event;
+    free_event = i;
+#else /* PROCESS_PRIORITY_LEVELS > 1 */
     /* There are events that we should deliver. */
     ev = events[fevent].ev;
     
     data = events[fevent].data;
     receiver = events[fevent].p;
+#if PROCESS_PROFILE
+    posted = events[fevent].posted;
+#endif /* PROCESS_PROFILE */
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
     fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
     --nevents;
+#if PROCESS_MAILBOX_SIZE
+    if(receiver != PROCESS_BROADCAST) {
+      --receiver->nqueued;
+    }
+#endif /* PROCESS_MAILBOX_SIZE */
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
@@ -281,6 +409,9 @@ do_event(void)
 	if(poll_requested) {
 	  do_poll();
 	}
+#if PROCESS_PROFILE
+	update_latency(p, posted);
+#endif /* PROCESS_PROFILE */
 	call_process(p, ev, data);
       }
     } else {
@@ -292,6 +423,9 @@ do_event(void)
 	receiver->state = PROCESS_STATE_RUNNING;
       }
 
+#if PROCESS_PROFILE
+      update_latency(receiver, posted);
+#endif /* PROCESS_PROFILE */
       /* Make sure that the process actually is running. */
       call_process(receiver, ev, data);
     }
@@ -318,10 +452,68 @@ process_nevents(void)
   return nevents + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PRIORITY_LEVELS > 1
+process_num_events_t
+process_nevents_priority(unsigned char prio)
+{
+  if(prio >= PROCESS_PRIORITY_LEVELS) {
+    return 0;
+  }
+  return queue_len[prio];
+}
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
+/*---------------------------------------------------------------------------*/
+int
+process_post_capacity(struct process *p)
+{
+  int capacity;
+
+  capacity = PROCESS_CONF_NUMEVENTS - nevents;
+#if PROCESS_MAILBOX_SIZE
+  if(p != PROCESS_BROADCAST &&
+     PROCESS_MAILBOX_SIZE - p->nqueued < capacity) {
+    capacity = PROCESS_MAILBOX_SIZE - p->nqueued;
+  }
+#endif /* PROCESS_MAILBOX_SIZE */
+  return capacity;
+}
+/*---------------------------------------------------------------------------*/
+#if PROCESS_COALESCE
+static int
+is_queued(struct process *p, process_event_t ev, process_data_t data)
+{
+  process_num_events_t i;
+#if PROCESS_PRIORITY_LEVELS > 1
+  unsigned char prio;
+
+  for(prio = 0; prio < PROCESS_PRIORITY_LEVELS; prio++) {
+    for(i = queue_head[prio]; i != EVENT_NONE; i = events[i].next) {
+      if(events[i].p == p && events[i].ev == ev && events[i].data == data) {
+        return 1;
+      }
+    }
+  }
+#else /* PROCESS_PRIORITY_LEVELS > 1 */
+  process_num_events_t n;
+
+  for(n = 0; n < nevents; n++) {
+    i = (process_num_events_t)(fevent + n) % PROCESS_CONF_NUMEVENTS;
+    if(events[i].p == p && events[i].ev == ev && events[i].data == data) {
+      return 1;
+    }
+  }
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
+  return 0;
+}
+#endif /* PROCESS_COALESCE */
+/*---------------------------------------------------------------------------*/
 int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
   static process_num_events_t snum;
+#if PROCESS_PRIORITY_LEVELS > 1
+  static unsigned char prio;
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -332,7 +524,19 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  if(process_post_capacity(p) <= 0) {
+#if PROCESS_COALESCE
+    if(is_queued(p, ev, data)) {
+      /* The receiver will get the event anyway. */
+#if PROCESS_CONF_STATS
+      process_coalesced++;
+#endif /* PROCESS_CONF_STATS */
+      return PROCESS_ERR_OK;
+    }
+#endif /* PROCESS_COALESCE */
+#if PROCESS_CONF_STATS
+    process_overflows++;
+#endif /* PROCESS_CONF_STATS */
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,11 +547,47 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
+#if PROCESS_PRIORITY_LEVELS > 1
+  snum = free_event;
+  free_event = events[snum].next;
+
+  prio = p == PROCESS_BROADCAST ? PROCESS_PRIORITY_NORMAL : p->priority;
+  if(prio >= PROCESS_PRIORITY_LEVELS) {
+    prio = PROCESS_PRIORITY_LOW;
+  }
+  events[snum].next = EVENT_NONE;
+  if(queue_tail[prio] == EVENT_NONE) {
+    queue_head[prio] = snum;
+  } else {
+    events[queue_tail[prio]].next = snum;
+  }
+  queue_tail[prio] = snum;
+  ++queue_len[prio];
+#if PROCESS_CONF_STATS
+  if(queue_len[prio] > process_maxevents_priority[prio]) {
+    process_maxevents_priority[prio] = queue_len[prio];
+  }
+#endif /* PROCESS_CONF_STATS */
+#else /* PROCESS_PRIORITY_LEVELS > 1 */
   snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
   events[snum].ev = ev;
   events[snum].data = data;
   events[snum].p = p;
+#if PROCESS_PROFILE
+  events[snum].posted = RTIMER_NOW();
+#endif /* PROCESS_PROFILE */
   ++nevents;
+#if PROCESS_MAILBOX_SIZE
+  if(p != PROCESS_BROADCAST) {
+    ++p->nqueued;
+#if PROCESS_CONF_STATS
+    if(p->nqueued > p->maxqueued) {
+      p->maxqueued = p->nqueued;
+    }
+#endif /* PROCESS_CONF_STATS */
+  }
+#endif /* PROCESS_MAILBOX_SIZE */
 
 #if PROCESS_CONF_STATS
   if(nevents > process_maxevents) {
@@ -373,6 +613,11 @@ process_poll(struct process *p)
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
+#if PROCESS_PROFILE
+      if(!p->needspoll) {
+        p->profile.poll_time = RTIMER_NOW();
+      }
+#endif /* PROCESS_PROFILE */
       p->needspoll = 1;
       poll_requested = 1;
     }
@@ -385,4 +630,32 @@ process_is_running(struct process *p)
   return p->state != PROCESS_STATE_NONE;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PROFILE
+unsigned long
+process_profile_time(struct process *p)
+{
+  return p->profile.time;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+process_profile_calls(struct process *p)
+{
+  return p->profile.calls;
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+process_profile_max_latency(struct process *p)
+{
+  return p->profile.max_latency;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_profile_reset(struct process *p)
+{
+  p->profile.time = 0;
+  p->profile.calls = 0;
+  p->profile.max_latency = 0;
+}
+#endif /* PROCESS_PROFILE */
+/*---------------------------------------------------------------------------*/
 /** @} */
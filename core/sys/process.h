@@ -88,6 +88,34 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Process priorities
+ *
+ * If PROCESS_CONF_PRIORITY_LEVELS is set to more than one, the event
+ * queue is split into that many priority levels. An event is queued
+ * at the priority of the process it is posted to, and all queued
+ * events of a higher priority are delivered before any event of a
+ * lower priority. Events at the same priority are delivered in the
+ * order they were posted. Broadcast events are queued at
+ * PROCESS_PRIORITY_NORMAL. All levels share the
+ * PROCESS_CONF_NUMEVENTS event slots.
+ *
+ * Level 0 is the highest priority. The priority of a process is set
+ * with PROCESS_WITH_PRIORITY(); processes declared with PROCESS()
+ * get PROCESS_PRIORITY_NORMAL.
+ * @{
+ */
+#ifdef PROCESS_CONF_PRIORITY_LEVELS
+#define PROCESS_PRIORITY_LEVELS PROCESS_CONF_PRIORITY_LEVELS
+#else /* PROCESS_CONF_PRIORITY_LEVELS */
+#define PROCESS_PRIORITY_LEVELS 1
+#endif /* PROCESS_CONF_PRIORITY_LEVELS */
+
+#define PROCESS_PRIORITY_HIGH   0
+#define PROCESS_PRIORITY_NORMAL (PROCESS_PRIORITY_LEVELS / 2)
+#define PROCESS_PRIORITY_LOW    (PROCESS_PRIORITY_LEVELS - 1)
+/** @} */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -298,20 +326,97 @@ static PT_THREAD(process_thread_##name(struct pt *process_pt,	\
  *
  * \hideinitializer
  */
-#if PROCESS_CONF_NO_PROCESS_NAMES
 #define PROCESS(name, strname)				\
+  PROCESS_WITH_PRIORITY(name, strname, PROCESS_PRIORITY_NORMAL)
+
+/**
+ * Declare a process with a priority.
+ *
+ * This macro works like PROCESS(), but also sets the priority at
+ * which events posted to the process are queued. The priority is
+ * ignored unless PROCESS_CONF_PRIORITY_LEVELS is larger than one.
+ *
+ * \param name The variable name of the process structure.
+ * \param strname The string representation of the process' name.
+ * \param prio The priority of the process, from PROCESS_PRIORITY_HIGH
+ * to PROCESS_PRIORITY_LOW.
+ *
+ * \hideinitializer
+ */
+#if PROCESS_PRIORITY_LEVELS > 1
+#define PROCESS_PRIORITY_INIT(prio) , { 0 }, 0, 0, (prio)
+#else /* PROCESS_PRIORITY_LEVELS > 1 */
+#define PROCESS_PRIORITY_INIT(prio)
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
+
+#if PROCESS_CONF_NO_PROCESS_NAMES
+#define PROCESS_WITH_PRIORITY(name, strname, prio)	\
   PROCESS_THREAD(name, ev, data);			\
   struct process name = { NULL,		        \
-                          process_thread_##name }
+                          process_thread_##name	\
+                          PROCESS_PRIORITY_INIT(prio) }
 #else
-#define PROCESS(name, strname)				\
+#define PROCESS_WITH_PRIORITY(name, strname, prio)	\
   PROCESS_THREAD(name, ev, data);			\
   struct process name = { NULL, strname,		\
-                          process_thread_##name }
+                          process_thread_##name	\
+                          PROCESS_PRIORITY_INIT(prio) }
 #endif
 
 /** @} */
 
+/*
+ * Event queue overflow handling.
+ *
+ * If PROCESS_CONF_COALESCE is set, an event that can not be queued
+ * because the event queue, or the mailbox of the receiving process, is
+ * full is merged with an identical event (same receiver, event number
+ * and data) that is already queued, instead of being dropped. The
+ * receiver then sees the event once.
+ *
+ * If PROCESS_CONF_MAILBOX_SIZE is non-zero, no process can have more
+ * than that many events queued to it at the same time, so that a
+ * single slow receiver can not use up all of the event queue.
+ * process_post_capacity() tells a producer how many events it can
+ * post to a process before posting fails.
+ */
+#ifdef PROCESS_CONF_COALESCE
+#define PROCESS_COALESCE PROCESS_CONF_COALESCE
+#else /* PROCESS_CONF_COALESCE */
+#define PROCESS_COALESCE 0
+#endif /* PROCESS_CONF_COALESCE */
+
+#ifdef PROCESS_CONF_MAILBOX_SIZE
+#define PROCESS_MAILBOX_SIZE PROCESS_CONF_MAILBOX_SIZE
+#else /* PROCESS_CONF_MAILBOX_SIZE */
+#define PROCESS_MAILBOX_SIZE 0
+#endif /* PROCESS_CONF_MAILBOX_SIZE */
+
+/*
+ * If PROCESS_CONF_PROFILE is set, the kernel keeps per-process
+ * profiling counters, measured with the rtimer clock: the time spent
+ * running the process thread, not counting processes it calls
+ * synchronously, the number of times the thread has been called, and
+ * the longest time an event or poll request has waited before it was
+ * delivered to the process.
+ */
+#ifdef PROCESS_CONF_PROFILE
+#define PROCESS_PROFILE PROCESS_CONF_PROFILE
+#else /* PROCESS_CONF_PROFILE */
+#define PROCESS_PROFILE 0
+#endif /* PROCESS_CONF_PROFILE */
+
+#if PROCESS_PROFILE
+#include "sys/rtimer.h"
+
+struct process_profile {
+  unsigned long time;
+  unsigned long calls;
+  rtimer_clock_t max_latency;
+  rtimer_clock_t poll_time;
+};
+#endif /* PROCESS_PROFILE */
+
 struct process {
   struct process *next;
 #if PROCESS_CONF_NO_PROCESS_NAMES
@@ -323,6 +428,18 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_PRIORITY_LEVELS > 1
+  unsigned char priority;
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
+#if PROCESS_MAILBOX_SIZE
+  process_num_events_t nqueued;
+#if PROCESS_CONF_STATS
+  process_num_events_t maxqueued;
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_MAILBOX_SIZE */
+#if PROCESS_PROFILE
+  struct process_profile profile;
+#endif /* PROCESS_PROFILE */
 };
 
 /**
@@ -364,6 +481,22 @@ CCIF void process_start(struct process *p, process_data_t data);
  */
 CCIF int process_post(struct process *p, process_event_t ev, process_data_t data);
 
+/**
+ * Get the number of events that can be posted to a process.
+ *
+ * This function returns how many events can currently be posted to
+ * the process before process_post() returns PROCESS_ERR_FULL. It
+ * takes both the free space in the event queue and, if
+ * PROCESS_CONF_MAILBOX_SIZE is set, the mailbox of the process into
+ * account. Producers that can hold back data should check this
+ * before posting.
+ *
+ * \param p The process, or PROCESS_BROADCAST.
+ *
+ * \return The number of events that can be posted.
+ */
+int process_post_capacity(struct process *p);
+
 /**
  * Post a synchronous event to a process.
  *
@@ -519,6 +652,67 @@ CCIF int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+#if PROCESS_PRIORITY_LEVELS > 1
+/**
+ * Number of events waiting to be processed at a priority level.
+ *
+ * \param prio The priority level.
+ * \return The number of events that are currently queued at the
+ * priority level.
+ */
+process_num_events_t process_nevents_priority(unsigned char prio);
+
+#if PROCESS_CONF_STATS
+/**
+ * The largest number of events that have been queued at the same
+ * time at each priority level.
+ */
+extern process_num_events_t process_maxevents_priority[PROCESS_PRIORITY_LEVELS];
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_PRIORITY_LEVELS > 1 */
+
+#if PROCESS_CONF_STATS
+/** The largest number of events that have been queued at the same time. */
+extern process_num_events_t process_maxevents;
+/** The number of events that were dropped because a queue was full. */
+extern unsigned int process_overflows;
+#if PROCESS_COALESCE
+/** The number of events that were merged with an already queued event. */
+extern unsigned int process_coalesced;
+#endif /* PROCESS_COALESCE */
+#endif /* PROCESS_CONF_STATS */
+
+#if PROCESS_PROFILE
+/**
+ * \brief      Get the time a process has been running.
+ * \param p    The process.
+ * \return     The number of rtimer ticks spent in the process thread.
+ */
+unsigned long process_profile_time(struct process *p);
+
+/**
+ * \brief      Get the number of times a process has been called.
+ * \param p    The process.
+ * \return     The number of times the process thread has been called.
+ */
+unsigned long process_profile_calls(struct process *p);
+
+/**
+ * \brief      Get the longest event delivery latency of a process.
+ * \param p    The process.
+ * \return     The longest time, in rtimer ticks, from when an event
+ *             was posted or a poll was requested until it was
+ *             delivered to the process.
+ */
+rtimer_clock_t process_profile_max_latency(struct process *p);
+
+/**
+ * \brief      Clear the profiling counters of a process.
+ * \param p    The process.
+ */
+void process_profile_reset(struct process *p);
+#endif /* PROCESS_PROFILE */
+
 /** @} */
 
 CCIF extern struct process *process_list;
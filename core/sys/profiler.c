@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The sampling profiler
+ */
+
+#include "sys/profiler.h"
+#include <stdint.h>
+#include <stdio.h>
+
+static struct profiler_sample samples[PROFILER_SIZE];
+/* Written by the interrupt only */
+static volatile uint16_t head;
+static volatile uint16_t dropped;
+/* Written by profiler_read() only */
+static volatile uint16_t tail;
+static unsigned current_rate;
+
+/*---------------------------------------------------------------------------*/
+void
+profiler_start(unsigned rate)
+{
+  if(rate == 0) {
+    return;
+  }
+  current_rate = rate;
+  profiler_arch_start(rate);
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_stop(void)
+{
+  profiler_arch_stop();
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_sample(void *pc)
+{
+  uint16_t next;
+
+  next = (head + 1) % PROFILER_SIZE;
+  if(next == tail) {
+    dropped++;
+    return;
+  }
+  samples[head].pc = pc;
+  samples[head].process = PROCESS_CURRENT();
+  head = next;
+}
+/*---------------------------------------------------------------------------*/
+int
+profiler_read(struct profiler_sample *s)
+{
+  if(tail == head) {
+    return 0;
+  }
+  *s = samples[tail];
+  tail = (tail + 1) % PROFILER_SIZE;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_print(void)
+{
+  struct profiler_sample s;
+  uint16_t d;
+
+  d = dropped;
+  dropped -= d;
+  /* The address of this function lets the host tool find the load
+     address of relocated code, such as native PIE executables */
+  printf("PR rate %u dropped %u base %lx\n", current_rate, d,
+         (unsigned long)(uintptr_t)profiler_print);
+  while(profiler_read(&s)) {
+    printf("PR %lx %lx\n", (unsigned long)(uintptr_t)s.pc,
+           (unsigned long)(uintptr_t)s.process);
+  }
+}
+/*---------------------------------------------------------------------------*/
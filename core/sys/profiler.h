@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the sampling profiler
+ */
+
+/**
+ * \addtogroup sys
+ * @{
+ */
+
+/**
+ * \defgroup profiler Sampling profiler
+ * @{
+ *
+ * The sampling profiler records, at a fixed rate, the program counter
+ * that a timer interrupt interrupted, together with the process that
+ * ran last. Functions show up in the samples in proportion to the time
+ * spent in them, so that the hot spots of a running system can be
+ * found without instrumenting the code. The samples are kept in a ring
+ * buffer that profiler_print() drains; tools/profiler-symbolize maps
+ * them to functions and processes with the firmware ELF.
+ *
+ * The timer is CPU specific, see profiler_arch_start(). Sampling is
+ * only started by profiler_start(), so nothing runs until then; on
+ * cc2538, PROFILER_CONF_ENABLED also connects the interrupt vector.
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include "contiki-conf.h"
+#include "sys/process.h"
+
+/** The number of samples kept until they are read */
+#ifdef PROFILER_CONF_SIZE
+#define PROFILER_SIZE PROFILER_CONF_SIZE
+#else /* PROFILER_CONF_SIZE */
+#define PROFILER_SIZE 128
+#endif /* PROFILER_CONF_SIZE */
+
+struct profiler_sample {
+  void *pc;
+  struct process *process;
+};
+
+/**
+ * Start sampling rate times per second. Samples that do not fit in the
+ * ring buffer are dropped and counted until it is read.
+ */
+void profiler_start(unsigned rate);
+
+/** Stop sampling. */
+void profiler_stop(void);
+
+/** Record a sample. Called from the timer interrupt. */
+void profiler_sample(void *pc);
+
+/** Take the oldest sample. Returns 0 when there is none. */
+int profiler_read(struct profiler_sample *s);
+
+/**
+ * Print and remove the samples, one "PR <pc> <process>" line each in
+ * hexadecimal, after a "PR rate <rate> dropped <dropped> base <address>"
+ * line, where the address is that of profiler_print() itself.
+ */
+void profiler_print(void);
+
+/**
+ * Start a periodic timer interrupt, rate times per second, that calls
+ * profiler_sample() with the program counter it interrupted.
+ */
+void profiler_arch_start(unsigned rate);
+
+/** Stop the timer interrupt. */
+void profiler_arch_stop(void);
+
+#endif /* PROFILER_H_ */
+
+/** @} */
+/** @} */
@@ -56,6 +56,15 @@
 
 static struct rtimer *next_rtimer;
 
+#if RTIMER_QUEUE
+/* Set while rtimer_run_next() runs the due tasks. The hardware timer
+   is programmed when it is done. */
+static uint8_t running;
+
+static unsigned long missed;
+static rtimer_clock_t max_lateness;
+#endif /* RTIMER_QUEUE */
+
 /*---------------------------------------------------------------------------*/
 void
 rtimer_init(void)
@@ -63,6 +72,145 @@ rtimer_init(void)
   rtimer_arch_init();
 }
 /*---------------------------------------------------------------------------*/
+#if RTIMER_QUEUE
+/*---------------------------------------------------------------------------*/
+static int
+remove_task(struct rtimer *rtimer)
+{
+  struct rtimer **pp;
+
+  for(pp = &next_rtimer; *pp != NULL; pp = &(*pp)->next) {
+    if(*pp == rtimer) {
+      *pp = rtimer->next;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_task(struct rtimer *rtimer)
+{
+  struct rtimer **pp;
+
+  /* Tasks with the same time are run in the order they were set. */
+  for(pp = &next_rtimer; *pp != NULL; pp = &(*pp)->next) {
+    if(RTIMER_CLOCK_LT(rtimer->time, (*pp)->time)) {
+      break;
+    }
+  }
+  rtimer->next = *pp;
+  *pp = rtimer;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
+	   rtimer_clock_t duration,
+	   rtimer_callback_t func, void *ptr)
+{
+  struct rtimer *first;
+
+  PRINTF("rtimer_set time %d\n", time);
+
+  first = next_rtimer;
+  remove_task(rtimer);
+
+  rtimer->func = func;
+  rtimer->ptr = ptr;
+  rtimer->time = time;
+  insert_task(rtimer);
+
+  if(!running && (next_rtimer != first || first == rtimer)) {
+    rtimer_arch_schedule(next_rtimer->time);
+  }
+  return RTIMER_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_cancel(struct rtimer *rtimer)
+{
+  struct rtimer *first;
+
+  first = next_rtimer;
+  if(!remove_task(rtimer)) {
+    return 0;
+  }
+  /* The hardware timer is left running if the queue is empty, as
+     there is no portable way to stop it. rtimer_run_next() does
+     nothing when there is no task to run. */
+  if(!running && next_rtimer != first && next_rtimer != NULL) {
+    rtimer_arch_schedule(next_rtimer->time);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_is_scheduled(struct rtimer *rtimer)
+{
+  struct rtimer *t;
+
+  for(t = next_rtimer; t != NULL; t = t->next) {
+    if(t == rtimer) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_run_next(void)
+{
+  struct rtimer *t;
+  rtimer_clock_t now, late;
+
+  if(running) {
+    return;
+  }
+  running = 1;
+
+  /* Run all tasks that are due, including those that become due
+     while the others are run. */
+  while(next_rtimer != NULL) {
+    now = RTIMER_NOW();
+    t = next_rtimer;
+    if(RTIMER_CLOCK_LT(now, t->time)) {
+      break;
+    }
+    next_rtimer = t->next;
+
+    if(RTIMER_CLOCK_LT(t->time, now)) {
+      late = now - t->time;
+      if(late > max_lateness) {
+        max_lateness = late;
+      }
+      if(late > RTIMER_MISS_LIMIT) {
+        missed++;
+        PRINTF("rtimer: missed deadline by %u ticks\n", (unsigned)late);
+      }
+    }
+    t->func(t, t->ptr);
+  }
+
+  running = 0;
+  if(next_rtimer != NULL) {
+    rtimer_arch_schedule(next_rtimer->time);
+  }
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+rtimer_missed_deadlines(void)
+{
+  return missed;
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_max_lateness(void)
+{
+  return max_lateness;
+}
+/*---------------------------------------------------------------------------*/
+#else /* RTIMER_QUEUE */
+/*---------------------------------------------------------------------------*/
 int
 rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
@@ -104,5 +252,17 @@ rtimer_run_next(void)
   return;
 }
 /*---------------------------------------------------------------------------*/
+#endif /* RTIMER_QUEUE */
+/*---------------------------------------------------------------------------*/
+int
+rtimer_next_time(rtimer_clock_t *time)
+{
+  if(next_rtimer == NULL) {
+    return 0;
+  }
+  *time = next_rtimer->time;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 
 /** @}*/
@@ -62,6 +62,19 @@ typedef unsigned short rtimer_clock_t;
 
 #include "rtimer-arch.h"
 
+/**
+ * RTIMER_CONF_QUEUE turns on the real-time task queue. Without it,
+ * only one real-time task can be scheduled at a time and setting a
+ * new task replaces the previous one. With it, any number of tasks
+ * can be scheduled: they are kept in a queue sorted on time and the
+ * hardware timer is always programmed for the earliest one.
+ */
+#ifdef RTIMER_CONF_QUEUE
+#define RTIMER_QUEUE RTIMER_CONF_QUEUE
+#else /* RTIMER_CONF_QUEUE */
+#define RTIMER_QUEUE 0
+#endif /* RTIMER_CONF_QUEUE */
+
 /**
  * \brief      Initialize the real-time scheduler.
  *
@@ -82,6 +95,9 @@ typedef void (* rtimer_callback_t)(struct rtimer *t, void *ptr);
  *             support module for the real-time module.
  */
 struct rtimer {
+#if RTIMER_QUEUE
+  struct rtimer *next;
+#endif /* RTIMER_QUEUE */
   rtimer_clock_t time;
   rtimer_callback_t func;
   void *ptr;
@@ -107,10 +123,55 @@ enum {
  *             This function schedules a real-time task at a specified
  *             time in the future.
  *
+ *             With RTIMER_CONF_QUEUE, a task that already is
+ *             scheduled is moved to the new time.
+ *
  */
 int rtimer_set(struct rtimer *task, rtimer_clock_t time,
 	       rtimer_clock_t duration, rtimer_callback_t func, void *ptr);
 
+#if RTIMER_QUEUE
+/**
+ * RTIMER_CONF_MISS_LIMIT is the number of rtimer ticks that a task
+ * can be run after its time before it is counted as a missed
+ * deadline.
+ */
+#ifdef RTIMER_CONF_MISS_LIMIT
+#define RTIMER_MISS_LIMIT RTIMER_CONF_MISS_LIMIT
+#else /* RTIMER_CONF_MISS_LIMIT */
+#define RTIMER_MISS_LIMIT RTIMER_GUARD_TIME
+#endif /* RTIMER_CONF_MISS_LIMIT */
+
+/**
+ * \brief      Remove a real-time task from the queue
+ * \param task The task
+ * \return     Non-zero (true) if the task was scheduled, zero (false)
+ *             otherwise.
+ */
+int rtimer_cancel(struct rtimer *task);
+
+/**
+ * \brief      Check if a real-time task is scheduled
+ * \param task The task
+ * \return     Non-zero (true) if the task is in the queue
+ */
+int rtimer_is_scheduled(struct rtimer *task);
+
+/**
+ * \brief      Get the number of missed deadlines
+ * \return     The number of tasks that have been run more than
+ *             RTIMER_MISS_LIMIT ticks after their time
+ */
+unsigned long rtimer_missed_deadlines(void);
+
+/**
+ * \brief      Get the latest that a task has been run
+ * \return     The largest number of ticks between the time of a task
+ *             and the time when it was run
+ */
+rtimer_clock_t rtimer_max_lateness(void);
+#endif /* RTIMER_QUEUE */
+
 /**
  * \brief      Execute the next real-time task and schedule the next task, if any
  *
@@ -120,6 +181,14 @@ int rtimer_set(struct rtimer *task, rtimer_clock_t time,
  */
 void rtimer_run_next(void);
 
+/**
+ * \brief      Get the time of the next real-time task
+ * \param time A pointer to where the time is stored if a task is scheduled
+ * \return     Non-zero (true) if a real-time task is scheduled, zero
+ *             (false) otherwise.
+ */
+int rtimer_next_time(rtimer_clock_t *time);
+
 /**
  * \brief      Get the current clock time
  * \return     The current time
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Tickless idle support
+ */
+
+/**
+ * \addtogroup tickless
+ * @{
+ */
+
+#include "sys/tickless.h"
+#include "sys/etimer.h"
+#include "sys/process.h"
+
+/* The largest clock time difference that is not an expired timer. */
+#define MAX_CLOCK_DIFF ((clock_time_t)~(clock_time_t)0 >> 1)
+
+#if RTIMER_SECOND >= CLOCK_SECOND
+/* The rounding down makes deadlines early rather than late. */
+#define RTIMER_TICKS_PER_CLOCK_TICK (RTIMER_SECOND / CLOCK_SECOND)
+#else
+#define RTIMER_TICKS_PER_CLOCK_TICK 1
+#endif
+/*---------------------------------------------------------------------------*/
+int
+tickless_next_clock_deadline(clock_time_t *ticks)
+{
+  clock_time_t left;
+
+  if(process_nevents() > 0) {
+    return TICKLESS_BUSY;
+  }
+  if(!etimer_pending()) {
+    return TICKLESS_NO_DEADLINE;
+  }
+
+  left = etimer_next_expiration_time() - clock_time();
+  if(left == 0 || left > MAX_CLOCK_DIFF) {
+    /* The timer has expired, but the etimer process has not been
+       polled yet. */
+    return TICKLESS_BUSY;
+  }
+  *ticks = left;
+  return TICKLESS_DEADLINE;
+}
+/*---------------------------------------------------------------------------*/
+int
+tickless_next_deadline(rtimer_clock_t *deadline)
+{
+  clock_time_t ticks;
+  rtimer_clock_t now, left, rt;
+  int r;
+
+  r = tickless_next_clock_deadline(&ticks);
+  if(r == TICKLESS_BUSY) {
+    return TICKLESS_BUSY;
+  }
+
+  now = RTIMER_NOW();
+  left = TICKLESS_MAX_SLEEP;
+  if(r == TICKLESS_DEADLINE &&
+     ticks < TICKLESS_MAX_SLEEP / RTIMER_TICKS_PER_CLOCK_TICK) {
+    left = (rtimer_clock_t)ticks * RTIMER_TICKS_PER_CLOCK_TICK;
+  }
+
+  if(rtimer_next_time(&rt)) {
+    if(RTIMER_CLOCK_LT(rt, now)) {
+      left = 0;
+    } else if((rtimer_clock_t)(rt - now) < left) {
+      left = rt - now;
+    }
+    r = TICKLESS_DEADLINE;
+  }
+
+  if(r == TICKLESS_DEADLINE) {
+    *deadline = now + left;
+  }
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+#if TICKLESS_ON
+void
+tickless_sleep_prepare(void)
+{
+  clock_time_t ticks;
+
+  switch(tickless_next_clock_deadline(&ticks)) {
+  case TICKLESS_DEADLINE:
+    tickless_arch_set_wakeup(ticks);
+    break;
+  case TICKLESS_NO_DEADLINE:
+    tickless_arch_set_wakeup(0);
+    break;
+  default:
+    /* Something will happen on the next tick. Leave it alone. */
+    break;
+  }
+}
+#endif /* TICKLESS_ON */
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the tickless idle support
+ */
+
+/**
+ * \addtogroup sys
+ * @{
+ */
+
+/**
+ * \defgroup tickless Tickless idle
+ * @{
+ *
+ * The tickless idle module finds the time when the system next needs
+ * the CPU, given the pending event timers, the scheduled real-time
+ * task and the events and poll requests waiting in the process
+ * queue. The low-power mode code of a platform uses this to program
+ * its wake-up timer for that time and to sleep through the clock
+ * ticks in between, instead of waking up on every tick.
+ *
+ * Tickless idle is enabled with TICKLESS_CONF_ON. The platforms that
+ * support it use it from their low-power mode code. Clock drivers
+ * that can skip ticks implement tickless_arch_set_wakeup(), which is
+ * called through tickless_sleep_prepare() from the main loop right
+ * before the CPU goes to sleep.
+ */
+
+#ifndef TICKLESS_H_
+#define TICKLESS_H_
+
+#include "contiki-conf.h"
+#include "sys/clock.h"
+#include "sys/rtimer.h"
+
+#ifdef TICKLESS_CONF_ON
+#define TICKLESS_ON TICKLESS_CONF_ON
+#else /* TICKLESS_CONF_ON */
+#define TICKLESS_ON 0
+#endif /* TICKLESS_CONF_ON */
+
+/**
+ * The longest time, in rtimer ticks, that tickless_next_deadline()
+ * returns. Deadlines further away are cut to this, so that the time
+ * can be compared with RTIMER_CLOCK_LT().
+ */
+#ifdef TICKLESS_CONF_MAX_SLEEP
+#define TICKLESS_MAX_SLEEP TICKLESS_CONF_MAX_SLEEP
+#else /* TICKLESS_CONF_MAX_SLEEP */
+#define TICKLESS_MAX_SLEEP ((rtimer_clock_t)~(rtimer_clock_t)0 >> 1)
+#endif /* TICKLESS_CONF_MAX_SLEEP */
+
+/** There is work to do now, the CPU should not go to sleep. */
+#define TICKLESS_BUSY        0
+/** Nothing is scheduled, only an interrupt will create more work. */
+#define TICKLESS_NO_DEADLINE 1
+/** The CPU is needed again at the returned deadline. */
+#define TICKLESS_DEADLINE    2
+
+/**
+ * \brief      Get the next time the CPU is needed
+ * \param deadline Pointer to where the deadline, in rtimer ticks, is
+ *             stored if TICKLESS_DEADLINE is returned
+ * \return     TICKLESS_BUSY, TICKLESS_NO_DEADLINE or TICKLESS_DEADLINE
+ *
+ *             This function returns the earliest of the expiration
+ *             time of the next event timer and the time of the next
+ *             real-time task. If there are events or poll requests
+ *             waiting, or an event timer has already expired,
+ *             TICKLESS_BUSY is returned.
+ */
+int tickless_next_deadline(rtimer_clock_t *deadline);
+
+/**
+ * \brief      Get the number of idle clock ticks
+ * \param ticks Pointer to where the number of clock ticks until the
+ *             next event timer expires is stored if TICKLESS_DEADLINE
+ *             is returned
+ * \return     TICKLESS_BUSY, TICKLESS_NO_DEADLINE or TICKLESS_DEADLINE
+ *
+ *             This function works like tickless_next_deadline(), but
+ *             only looks at event timers and the process queue. It is
+ *             meant for clock drivers that do not share their timer
+ *             with the real-time module.
+ */
+int tickless_next_clock_deadline(clock_time_t *ticks);
+
+/**
+ * \brief      Let the clock driver skip the idle clock ticks
+ *
+ *             This function is called by the main loop of a platform
+ *             with interrupts disabled, immediately before the CPU is
+ *             put to sleep. It asks the clock driver, through
+ *             tickless_arch_set_wakeup(), to not wake the CPU up until
+ *             the next event timer expires.
+ */
+void tickless_sleep_prepare(void);
+
+/**
+ * \brief      Program the clock wake-up
+ * \param ticks The number of clock ticks the CPU can sleep. Zero
+ *             means that no event timer is pending.
+ *
+ *             This function is implemented by every platform that
+ *             supports TICKLESS_CONF_ON. Platforms whose low-power
+ *             mode code programs the wake-up timer itself implement
+ *             it as an empty function. It is called with interrupts disabled. The driver
+ *             must wake the CPU up no later than \e ticks clock ticks
+ *             from now, and clock_time() must stay correct while
+ *             ticks are skipped.
+ */
+void tickless_arch_set_wakeup(clock_time_t ticks);
+
+#endif /* TICKLESS_H_ */
+/** @} */
+/** @} */
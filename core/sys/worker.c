@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Worker pool for blocking jobs
+ */
+
+/**
+ * \addtogroup worker
+ * @{
+ */
+
+#include "sys/worker.h"
+#include "sys/mt.h"
+#include "lib/list.h"
+
+struct worker_thread {
+  struct mt_thread mt;
+  struct worker_job *job;
+};
+
+static struct worker_thread threads[WORKER_THREADS];
+
+LIST(jobs);
+
+process_event_t worker_event_done;
+
+/* The worker threads get the CPU last, after all other processes. */
+PROCESS_WITH_PRIORITY(worker_process, "Worker", PROCESS_PRIORITY_LOW);
+/*---------------------------------------------------------------------------*/
+static void
+thread_main(void *data)
+{
+  struct worker_thread *w = data;
+  struct worker_job *job;
+
+  while(1) {
+    job = list_pop(jobs);
+    if(job == NULL) {
+      /* Nothing to do until the next job is submitted */
+      mt_yield();
+      continue;
+    }
+
+    w->job = job;
+    job->state = WORKER_JOB_RUNNING;
+    job->func(job->arg);
+    job->state = WORKER_JOB_IDLE;
+    w->job = NULL;
+
+    process_post(job->p, worker_event_done, job);
+
+    /* Give the other processes a chance between jobs. */
+    mt_yield();
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(worker_process, ev, data)
+{
+  static int i;
+  static int busy;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    /* Give each thread that has work one time slice. */
+    busy = 0;
+    for(i = 0; i < WORKER_THREADS; i++) {
+      if(threads[i].job != NULL || list_head(jobs) != NULL) {
+        mt_exec(&threads[i].mt);
+        busy = 1;
+      }
+    }
+
+    if(busy) {
+      /* Come back after the other processes have run. */
+      process_poll(&worker_process);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+worker_init(void)
+{
+  int i;
+
+  list_init(jobs);
+  worker_event_done = process_alloc_event();
+
+  mt_init();
+  for(i = 0; i < WORKER_THREADS; i++) {
+    threads[i].job = NULL;
+    mt_start(&threads[i].mt, thread_main, &threads[i]);
+  }
+
+  process_start(&worker_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+int
+worker_submit(struct worker_job *job, worker_func_t func, void *arg)
+{
+  if(worker_pending(job)) {
+    return WORKER_ERR_BUSY;
+  }
+
+  job->func = func;
+  job->arg = arg;
+  job->p = PROCESS_CURRENT();
+  job->state = WORKER_JOB_QUEUED;
+  list_add(jobs, job);
+
+  process_poll(&worker_process);
+  return WORKER_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+worker_cancel(struct worker_job *job)
+{
+  if(job->state != WORKER_JOB_QUEUED) {
+    return 0;
+  }
+  list_remove(jobs, job);
+  job->state = WORKER_JOB_IDLE;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+worker_pending(struct worker_job *job)
+{
+  return job->state != WORKER_JOB_IDLE;
+}
+/*---------------------------------------------------------------------------*/
+void
+worker_yield(void)
+{
+  mt_yield();
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
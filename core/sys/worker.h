@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Worker pool for blocking jobs
+ */
+
+/**
+ * \addtogroup sys
+ * @{
+ */
+
+/**
+ * \defgroup worker Worker pool
+ * @{
+ *
+ * The worker module runs long, blocking jobs, such as flash writes,
+ * public key operations or file system scans, on a small pool of
+ * threads from the multi-threading library, so that they do not have
+ * to be split up by hand into protothread steps. A job is a C
+ * function that runs on the stack of a worker thread. It gives the
+ * CPU back to the other processes by calling worker_yield(). When the
+ * function returns, the process that submitted the job gets a
+ * worker_event_done event with a pointer to the job as data.
+ *
+ * The worker threads are run from a process with the lowest priority,
+ * one time slice per poll, so the other processes are not starved
+ * while a job runs. The module needs a platform with a working
+ * mtarch implementation.
+ */
+
+#ifndef WORKER_H_
+#define WORKER_H_
+
+#include "contiki.h"
+
+/** The number of worker threads, and jobs that can run concurrently */
+#ifdef WORKER_CONF_THREADS
+#define WORKER_THREADS WORKER_CONF_THREADS
+#else /* WORKER_CONF_THREADS */
+#define WORKER_THREADS 1
+#endif /* WORKER_CONF_THREADS */
+
+typedef void (* worker_func_t)(void *arg);
+
+struct worker_job {
+  struct worker_job *next;
+  worker_func_t func;
+  void *arg;
+  struct process *p;
+  unsigned char state;
+};
+
+#define WORKER_JOB_IDLE    0
+#define WORKER_JOB_QUEUED  1
+#define WORKER_JOB_RUNNING 2
+
+#define WORKER_OK          0
+#define WORKER_ERR_BUSY    1
+
+/**
+ * The event that is posted to the process that submitted a job when
+ * the job is done. The data is a pointer to the struct worker_job.
+ */
+extern process_event_t worker_event_done;
+
+/**
+ * \brief      Initialize the worker pool
+ *
+ *             This function starts the worker threads and the worker
+ *             process. It must be called before any job is
+ *             submitted.
+ */
+void worker_init(void);
+
+/**
+ * \brief      Submit a job to the worker pool
+ * \param job  A pointer to the job
+ * \param func The function that does the job
+ * \param arg  An opaque pointer that is passed to the function
+ * \retval WORKER_OK The job was queued
+ * \retval WORKER_ERR_BUSY The job is already queued or running
+ *
+ *             This function queues a job for the next free worker
+ *             thread. The calling process gets a worker_event_done
+ *             event when the job is done. The job structure must not
+ *             be reused until then.
+ */
+int worker_submit(struct worker_job *job, worker_func_t func, void *arg);
+
+/**
+ * \brief      Remove a job that has not started yet
+ * \param job  A pointer to the job
+ * \return     Non-zero (true) if the job was removed from the
+ *             queue, zero (false) if it was not queued
+ *
+ *             A job that already is running cannot be cancelled.
+ */
+int worker_cancel(struct worker_job *job);
+
+/**
+ * \brief      Check if a job is queued or running
+ * \param job  A pointer to the job
+ * \return     Non-zero (true) if the job is not done yet
+ */
+int worker_pending(struct worker_job *job);
+
+/**
+ * \brief      Let the other processes run
+ *
+ *             This function is called by a job function to give the
+ *             CPU back to the Contiki processes. The job continues
+ *             the next time the worker process is scheduled. It must
+ *             only be called from a job.
+ */
+void worker_yield(void);
+
+#endif /* WORKER_H_ */
+/** @} */
+/** @} */
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Multi-threading support for ARMv7-M (Cortex-M3/M4) CPUs
+ */
+#include "contiki.h"
+#include "sys/mt.h"
+#include "dev/watchdog.h"
+
+#include <stdio.h>
+
+/* Check the bottom of the thread stack each time a thread yields. */
+#ifdef MTARCH_CONF_STACK_CHECK
+#define MTARCH_STACK_CHECK MTARCH_CONF_STACK_CHECK
+#else
+#define MTARCH_STACK_CHECK 0
+#endif
+
+#define STACK_FILL  0xa5a5a5a5
+#define STACK_GUARD 4
+
+/* The initial frame of a thread, as popped by mtarch_switch(): r3-r11
+   and pc. r3 only keeps the stack 8-byte aligned. */
+#define FRAME_WORDS 10
+
+static uint32_t *main_sp;
+static struct mtarch_thread *running;
+/*--------------------------------------------------------------------------*/
+/*
+ * Saves r4-r11 and lr on the current stack, stores the stack pointer
+ * in *save_sp, and returns on the stack new_sp.
+ */
+static void __attribute__((naked, noinline))
+mtarch_switch(uint32_t **save_sp, uint32_t *new_sp)
+{
+  __asm__ volatile(
+    "push {r3-r11, lr}\n"
+#ifdef __ARM_PCS_VFP
+    "vpush {d8-d15}\n"
+#endif
+    "mov r2, sp\n"
+    "str r2, [r0]\n"
+    "mov sp, r1\n"
+#ifdef __ARM_PCS_VFP
+    "vpop {d8-d15}\n"
+#endif
+    "pop {r3-r11, pc}\n"
+  );
+}
+/*--------------------------------------------------------------------------*/
+/*
+ * A new thread starts here, with the thread function in r4, its
+ * argument in r5 and mt_exit() in r6.
+ */
+static void __attribute__((naked, noinline))
+mtarch_trampoline(void)
+{
+  __asm__ volatile(
+    "mov r0, r5\n"
+    "blx r4\n"
+    "1:\n"
+    "blx r6\n"
+    "b 1b\n"
+  );
+}
+/*--------------------------------------------------------------------------*/
+void
+mtarch_init(void)
+{
+}
+/*--------------------------------------------------------------------------*/
+void
+mtarch_remove(void)
+{
+}
+/*--------------------------------------------------------------------------*/
+void
+mtarch_start(struct mtarch_thread *t,
+             void (*function)(void *), void *data)
+{
+  int i;
+
+  /* Fill the stack so that the stack usage can be measured. */
+  for(i = 0; i < MTARCH_STACKSIZE; ++i) {
+    t->stack[i] = STACK_FILL;
+  }
+
+  t->sp = &t->stack[MTARCH_STACKSIZE & ~1];
+  t->sp -= FRAME_WORDS;
+  for(i = 0; i < FRAME_WORDS; ++i) {
+    t->sp[i] = 0;
+  }
+  t->sp[1] = (uint32_t)function;
+  t->sp[2] = (uint32_t)data;
+  t->sp[3] = (uint32_t)mt_exit;
+  t->sp[FRAME_WORDS - 1] = (uint32_t)mtarch_trampoline;
+#ifdef __ARM_PCS_VFP
+  /* The VFP registers are popped first, so they go below the frame */
+  t->sp -= 16;
+  for(i = 0; i < 16; ++i) {
+    t->sp[i] = 0;
+  }
+#endif
+}
+/*--------------------------------------------------------------------------*/
+void
+mtarch_exec(struct mtarch_thread *t)
+{
+  running = t;
+  mtarch_switch(&main_sp, t->sp);
+  running = NULL;
+
+#if MTARCH_STACK_CHECK
+  {
+    int i;
+    for(i = 0; i < STACK_GUARD; ++i) {
+      if(t->stack[i] != STACK_FILL) {
+        printf("mtarch: stack overflow in thread %p\n", t);
+        watchdog_reboot();
+      }
+    }
+  }
+#endif /* MTARCH_STACK_CHECK */
+}
+/*--------------------------------------------------------------------------*/
+void
+mtarch_yield(void)
+{
+  mtarch_switch(&running->sp, main_sp);
+}
+/*--------------------------------------------------------------------------*/
+void
+mtarch_stop(struct mtarch_thread *t)
+{
+}
+/*--------------------------------------------------------------------------*/
+void
+mtarch_pstart(void)
+{
+}
+/*--------------------------------------------------------------------------*/
+void
+mtarch_pstop(void)
+{
+}
+/*--------------------------------------------------------------------------*/
+int
+mtarch_stack_usage(struct mt_thread *t)
+{
+  int i;
+
+  for(i = 0; i < MTARCH_STACKSIZE; ++i) {
+    if(t->thread.stack[i] != STACK_FILL) {
+      return (MTARCH_STACKSIZE - i) * sizeof(uint32_t);
+    }
+  }
+
+  return 0;
+}
+/*--------------------------------------------------------------------------*/
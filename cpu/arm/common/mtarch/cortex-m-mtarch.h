@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Multi-threading support for ARMv7-M (Cortex-M3/M4) CPUs
+ *
+ *         A switch saves the registers that the AAPCS requires a
+ *         function call to preserve (r4-r11, and d8-d15 with a
+ *         hardware FPU) on the stack of the thread that yields. The
+ *         threads run on the main stack pointer, so interrupts that
+ *         occur while a thread runs use the thread stack and
+ *         MTARCH_STACKSIZE must leave room for them.
+ */
+#ifndef CORTEX_M_MTARCH_H_
+#define CORTEX_M_MTARCH_H_
+
+#include "contiki.h"
+
+/** The size of a thread stack, in 32-bit words */
+#ifndef MTARCH_STACKSIZE
+#define MTARCH_STACKSIZE 256
+#endif /* MTARCH_STACKSIZE */
+
+struct mtarch_thread {
+  uint32_t stack[MTARCH_STACKSIZE] __attribute__((aligned(8)));
+  uint32_t *sp;
+};
+
+struct mt_thread;
+
+/* Returns the number of stack bytes that a thread has used so far. */
+int mtarch_stack_usage(struct mt_thread *t);
+
+#endif /* CORTEX_M_MTARCH_H_ */
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         memcpy(), memset() and memcmp() for Cortex-M3/M4.
+ *
+ *         These replace the C library routines when the CPU Makefile
+ *         is told to use them (ARM_STRING=1). Copies of up to a few
+ *         bytes are done byte by byte. Longer ones are done a word
+ *         at a time, four words per iteration, once the pointers have
+ *         been aligned. When source and destination are not aligned
+ *         alike, memcpy() relies on the unaligned word loads of the
+ *         ARMv7-M architecture.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Copies shorter than this are done one byte at a time */
+#define SMALL_SIZE 8
+
+/* Keep GCC from turning the loops below back into calls to themselves */
+#if defined(__GNUC__) && !defined(__clang__)
+#define NO_LIBCALL __attribute__((optimize("no-tree-loop-distribute-patterns")))
+#else
+#define NO_LIBCALL
+#endif
+
+/* Word access at a possibly unaligned address */
+typedef uint32_t __attribute__((aligned(1), may_alias)) unaligned_word_t;
+typedef uint32_t __attribute__((may_alias)) word_t;
+/*---------------------------------------------------------------------------*/
+NO_LIBCALL void *
+memcpy(void *dst, const void *src, size_t len)
+{
+  uint8_t *d = dst;
+  const uint8_t *s = src;
+
+  if(len >= SMALL_SIZE) {
+    /* Align the destination, since unaligned stores cost more */
+    while((uintptr_t)d & 3) {
+      *d++ = *s++;
+      len--;
+    }
+    if(((uintptr_t)s & 3) == 0) {
+      while(len >= 16) {
+        ((word_t *)d)[0] = ((const word_t *)s)[0];
+        ((word_t *)d)[1] = ((const word_t *)s)[1];
+        ((word_t *)d)[2] = ((const word_t *)s)[2];
+        ((word_t *)d)[3] = ((const word_t *)s)[3];
+        d += 16;
+        s += 16;
+        len -= 16;
+      }
+      while(len >= 4) {
+        *(word_t *)d = *(const word_t *)s;
+        d += 4;
+        s += 4;
+        len -= 4;
+      }
+    } else {
+      while(len >= 4) {
+        *(word_t *)d = *(const unaligned_word_t *)s;
+        d += 4;
+        s += 4;
+        len -= 4;
+      }
+    }
+  }
+
+  while(len > 0) {
+    *d++ = *s++;
+    len--;
+  }
+  return dst;
+}
+/*---------------------------------------------------------------------------*/
+NO_LIBCALL void *
+memset(void *dst, int c, size_t len)
+{
+  uint8_t *d = dst;
+  uint32_t w;
+
+  if(len >= SMALL_SIZE) {
+    while((uintptr_t)d & 3) {
+      *d++ = (uint8_t)c;
+      len--;
+    }
+    w = (uint8_t)c * 0x01010101UL;
+    while(len >= 16) {
+      ((word_t *)d)[0] = w;
+      ((word_t *)d)[1] = w;
+      ((word_t *)d)[2] = w;
+      ((word_t *)d)[3] = w;
+      d += 16;
+      len -= 16;
+    }
+    while(len >= 4) {
+      *(word_t *)d = w;
+      d += 4;
+      len -= 4;
+    }
+  }
+
+  while(len > 0) {
+    *d++ = (uint8_t)c;
+    len--;
+  }
+  return dst;
+}
+/*---------------------------------------------------------------------------*/
+NO_LIBCALL int
+memcmp(const void *a, const void *b, size_t len)
+{
+  const uint8_t *p = a;
+  const uint8_t *q = b;
+
+  /* Skip equal words; the differing one is then compared bytewise */
+  if(len >= SMALL_SIZE && (((uintptr_t)p ^ (uintptr_t)q) & 3) == 0) {
+    while((uintptr_t)p & 3) {
+      if(*p != *q) {
+        return *p - *q;
+      }
+      p++;
+      q++;
+      len--;
+    }
+    while(len >= 4 && *(const word_t *)p == *(const word_t *)q) {
+      p += 4;
+      q += 4;
+      len -= 4;
+    }
+  }
+
+  while(len > 0) {
+    if(*p != *q) {
+      return *p - *q;
+    }
+    p++;
+    q++;
+    len--;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
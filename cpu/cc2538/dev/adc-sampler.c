@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \addtogroup cc2538-adc-sampler
+ * @{
+ *
+ * \file
+ * Implementation of cc2538 periodic ADC sampling
+ */
+#include "contiki.h"
+#include "dev/adc-sampler.h"
+#include "dev/adc.h"
+#include "dev/gptimer.h"
+#include "dev/nvic.h"
+#include "dev/soc-adc.h"
+#include "dev/sys-ctrl.h"
+#include "lpm.h"
+#include "reg.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+static struct sensor_pipeline *pipeline;
+static uint32_t adccon3;
+static int16_t block[ADC_SAMPLER_BLOCK];
+static uint8_t block_len;
+static uint8_t converting;
+/*---------------------------------------------------------------------------*/
+static bool
+permit_pm1(void)
+{
+  return pipeline == NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+adc_sampler_start(struct sensor_pipeline *p, uint8_t channel,
+                  uint8_t ref, uint8_t div, uint32_t rate)
+{
+  static uint8_t registered;
+
+  if(!registered) {
+    lpm_register_peripheral(permit_pm1);
+    registered = 1;
+  }
+
+  adc_sampler_stop();
+
+  /* Conversions are started by writing ADCCON3 */
+  adc_init();
+  adccon3 = (REG(SOC_ADC_ADCCON3) &
+             ~(SOC_ADC_ADCCON3_EREF | SOC_ADC_ADCCON3_EDIV |
+               SOC_ADC_ADCCON3_ECH)) | ref | div | channel;
+  block_len = 0;
+  converting = 0;
+  pipeline = p;
+
+  REG(SYS_CTRL_RCGCGPT) |= SYS_CTRL_RCGCGPT_GPT2;
+  REG(SYS_CTRL_SCGCGPT) |= SYS_CTRL_SCGCGPT_GPT2;
+
+  REG(GPT_2_BASE + GPTIMER_CTL) = 0;
+  REG(GPT_2_BASE + GPTIMER_CFG) = 0;
+  REG(GPT_2_BASE + GPTIMER_TAMR) = GPTIMER_TAMR_TAMR_PERIODIC;
+  REG(GPT_2_BASE + GPTIMER_TAILR) = sys_ctrl_get_sys_clock() / rate - 1;
+  REG(GPT_2_BASE + GPTIMER_ICR) = GPTIMER_ICR_TATOCINT;
+  REG(GPT_2_BASE + GPTIMER_IMR) = GPTIMER_IMR_TATOIM;
+  nvic_interrupt_enable(NVIC_INT_GPTIMER_2A);
+  REG(GPT_2_BASE + GPTIMER_CTL) = GPTIMER_CTL_TAEN;
+}
+/*---------------------------------------------------------------------------*/
+void
+adc_sampler_stop(void)
+{
+  REG(GPT_2_BASE + GPTIMER_CTL) = 0;
+  REG(GPT_2_BASE + GPTIMER_IMR) = 0;
+  nvic_interrupt_disable(NVIC_INT_GPTIMER_2A);
+  nvic_interrupt_unpend(NVIC_INT_GPTIMER_2A);
+  REG(SYS_CTRL_RCGCGPT) &= ~SYS_CTRL_RCGCGPT_GPT2;
+  REG(SYS_CTRL_SCGCGPT) &= ~SYS_CTRL_SCGCGPT_GPT2;
+
+  if(pipeline != NULL && block_len > 0) {
+    sensor_pipeline_input(pipeline, block, block_len);
+  }
+  block_len = 0;
+  pipeline = NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+adc_sampler_isr(void)
+{
+  int16_t res;
+
+  REG(GPT_2_BASE + GPTIMER_ICR) = GPTIMER_ICR_TATOCINT;
+
+  if(pipeline == NULL) {
+    return;
+  }
+
+  /* Collect the conversion started on the previous tick */
+  if(converting && (REG(SOC_ADC_ADCCON1) & SOC_ADC_ADCCON1_EOC)) {
+    /* Reading SOC_ADC_ADCH last clears SOC_ADC_ADCCON1.EOC */
+    res = REG(SOC_ADC_ADCL) & 0xfc;
+    res |= REG(SOC_ADC_ADCH) << 8;
+    block[block_len++] = res;
+    if(block_len == ADC_SAMPLER_BLOCK) {
+      sensor_pipeline_input(pipeline, block, block_len);
+      block_len = 0;
+    }
+  }
+
+  /* Start the next one */
+  REG(SOC_ADC_ADCCON3) = adccon3;
+  converting = 1;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
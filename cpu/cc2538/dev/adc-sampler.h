@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \addtogroup cc2538-adc
+ * @{
+ *
+ * \defgroup cc2538-adc-sampler cc2538 periodic ADC sampling
+ *
+ * Samples one ADC channel at a fixed rate, paced by GPTimer 2A, and
+ * feeds blocks of samples to a sensor pipeline (lib/sensor-pipeline.h).
+ * The timer interrupt reads the previous conversion result and starts
+ * the next conversion, so the CPU spends a few register accesses per
+ * sample and the owner process only runs once per batch.
+ *
+ * ADC_SAMPLER_CONF_ENABLED must be set to 1 for the timer interrupt to
+ * be routed to the sampler. GPTimer 2A must not be used by other code,
+ * such as the PWM driver, while sampling. The system stays in PM0 while
+ * sampling, since the timer needs the 32 MHz clock.
+ * @{
+ *
+ * \file
+ * Header file for cc2538 periodic ADC sampling
+ */
+#ifndef ADC_SAMPLER_H_
+#define ADC_SAMPLER_H_
+
+#include "contiki.h"
+#include "lib/sensor-pipeline.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/** \brief Number of samples passed to the pipeline at a time */
+#ifdef ADC_SAMPLER_CONF_BLOCK
+#define ADC_SAMPLER_BLOCK ADC_SAMPLER_CONF_BLOCK
+#else
+#define ADC_SAMPLER_BLOCK 8
+#endif
+/*---------------------------------------------------------------------------*/
+/** \brief Starts sampling
+ * \param p The pipeline that receives the samples
+ * \param channel The channel: \c SOC_ADC_ADCCON_CH_AINx, or a
+ *                differential pair. The temperature sensor and VDD/3
+ *                channels are not supported.
+ * \param ref The reference voltage: \c SOC_ADC_ADCCON_REF_x
+ * \param div The decimation rate: \c SOC_ADC_ADCCON_DIV_x
+ * \param rate The sampling rate in Hz. A conversion takes about
+ *             (div + 16) / 4 us, which bounds the rate, e.g. to about
+ *             7 kHz with \c SOC_ADC_ADCCON_DIV_512.
+ *
+ * Samples are left-aligned 16-bit values, as returned by adc_get().
+ */
+void adc_sampler_start(struct sensor_pipeline *p, uint8_t channel,
+                       uint8_t ref, uint8_t div, uint32_t rate);
+
+/** \brief Stops sampling */
+void adc_sampler_stop(void);
+
+#endif /* ADC_SAMPLER_H_ */
+
+/**
+ * @}
+ * @}
+ */
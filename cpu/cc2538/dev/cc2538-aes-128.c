@@ -43,6 +43,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 /*---------------------------------------------------------------------------*/
 #define MODULE_NAME     "cc2538-aes-128"
 
@@ -53,6 +54,17 @@
 #define PRINTF(...)
 #endif
 /*---------------------------------------------------------------------------*/
+/* The area of the current key */
+static uint8_t current_area = CC2538_AES_128_KEY_AREA;
+#if CC2538_AES_128_KEY_AREAS > 1
+/* The keys set in the areas, the number of them, which of them were
+   loaded successfully and the next area to replace */
+static uint8_t loaded_keys[CC2538_AES_128_KEY_AREAS][AES_128_KEY_LENGTH];
+static uint8_t loaded_count;
+static uint8_t loaded_map;
+static uint8_t next_area;
+#endif /* CC2538_AES_128_KEY_AREAS > 1 */
+/*---------------------------------------------------------------------------*/
 static uint8_t
 enable_crypto(void)
 {
@@ -75,18 +87,58 @@ static void
 set_key(const uint8_t *key)
 {
   uint8_t crypto_enabled, ret;
+#if CC2538_AES_128_KEY_AREAS > 1
+  uint8_t i;
+#endif /* CC2538_AES_128_KEY_AREAS > 1 */
 
   crypto_enabled = enable_crypto();
 
-  ret = aes_load_keys(key, AES_KEY_STORE_SIZE_KEY_SIZE_128, 1,
-                      CC2538_AES_128_KEY_AREA);
+#if CC2538_AES_128_KEY_AREAS > 1
+  for(i = 0; i < loaded_count; i++) {
+    if(memcmp(loaded_keys[i], key, AES_128_KEY_LENGTH) == 0) {
+      break;
+    }
+  }
+  if(i < loaded_count) {
+    current_area = CC2538_AES_128_KEY_AREA + i;
+    /* Still loaded, unless the key store lost its content in PM2/3 */
+    if((loaded_map & (1 << i)) &&
+       (REG(AES_KEY_STORE_WRITTEN_AREA) & (1 << current_area))) {
+      restore_crypto(crypto_enabled);
+      return;
+    }
+  } else {
+    i = next_area;
+    next_area = (next_area + 1) % CC2538_AES_128_KEY_AREAS;
+    if(loaded_count < CC2538_AES_128_KEY_AREAS) {
+      loaded_count++;
+    }
+    memcpy(loaded_keys[i], key, AES_128_KEY_LENGTH);
+    current_area = CC2538_AES_128_KEY_AREA + i;
+  }
+#endif /* CC2538_AES_128_KEY_AREAS > 1 */
+
+  ret = aes_load_keys(key, AES_KEY_STORE_SIZE_KEY_SIZE_128, 1, current_area);
   if(ret != CRYPTO_SUCCESS) {
     PRINTF("%s: aes_load_keys() error %u\n", MODULE_NAME, ret);
   }
+#if CC2538_AES_128_KEY_AREAS > 1
+  if(ret == CRYPTO_SUCCESS) {
+    loaded_map |= 1 << i;
+  } else {
+    loaded_map &= ~(1 << i);
+  }
+#endif /* CC2538_AES_128_KEY_AREAS > 1 */
 
   restore_crypto(crypto_enabled);
 }
 /*---------------------------------------------------------------------------*/
+uint8_t
+cc2538_aes_128_key_area(void)
+{
+  return current_area;
+}
+/*---------------------------------------------------------------------------*/
 static void
 encrypt(uint8_t *plaintext_and_result)
 {
@@ -95,7 +147,7 @@ encrypt(uint8_t *plaintext_and_result)
 
   crypto_enabled = enable_crypto();
 
-  ret = ecb_crypt_start(true, CC2538_AES_128_KEY_AREA, plaintext_and_result,
+  ret = ecb_crypt_start(true, current_area, plaintext_and_result,
                         plaintext_and_result, AES_128_BLOCK_SIZE, NULL);
   if(ret != CRYPTO_SUCCESS) {
     PRINTF("%s: ecb_crypt_start() error %u\n", MODULE_NAME, ret);
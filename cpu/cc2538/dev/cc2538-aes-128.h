@@ -52,9 +52,25 @@
 #else
 #define CC2538_AES_128_KEY_AREA         0
 #endif
+/*
+ * Number of key areas, from CC2538_AES_128_KEY_AREA on, that keep the
+ * most recently set keys. set_key() with a key that is still loaded only
+ * selects its area, instead of loading it into the key store again.
+ * These areas are reserved for this driver and the CCM* driver.
+ */
+#ifdef CC2538_AES_128_CONF_KEY_AREAS
+#define CC2538_AES_128_KEY_AREAS        CC2538_AES_128_CONF_KEY_AREAS
+#else
+#define CC2538_AES_128_KEY_AREAS        1
+#endif
 /*---------------------------------------------------------------------------*/
 extern const struct aes_128_driver cc2538_aes_128_driver;
 
+/**
+ * \brief The key area of the key set last
+ */
+uint8_t cc2538_aes_128_key_area(void);
+
 #endif /* CC2538_AES_128_H_ */
 
 /**
@@ -39,6 +39,7 @@
 #include "dev/ccm.h"
 #include "dev/cc2538-aes-128.h"
 #include "dev/cc2538-ccm-star.h"
+#include "lib/ccm-star-queue.h"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -54,6 +55,14 @@
 #define PRINTF(...)
 #endif
 /*---------------------------------------------------------------------------*/
+/* The asynchronous job running on the crypto engine, if any */
+static struct ccm_star_job *current_job;
+static uint8_t current_job_crypto_enabled;
+/* A job that is done but whose callback was not called yet */
+static struct ccm_star_job *done_job;
+
+PROCESS(cc2538_ccm_star_process, "cc2538 CCM*");
+/*---------------------------------------------------------------------------*/
 static uint8_t
 enable_crypto(void)
 {
@@ -72,6 +81,29 @@ restore_crypto(uint8_t enabled)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Wait for the running job and collect its result */
+static void
+finish_job(void)
+{
+  struct ccm_star_job *job = current_job;
+  uint8_t ret;
+
+  if(job->forward) {
+    while(!ccm_auth_encrypt_check_status());
+    ret = ccm_auth_encrypt_get_result(job->result, job->mic_len);
+  } else {
+    while(!ccm_auth_decrypt_check_status());
+    ret = ccm_auth_decrypt_get_result(job->m, job->m_len + job->mic_len,
+                                      job->result, job->mic_len);
+  }
+  if(ret != CRYPTO_SUCCESS) {
+    PRINTF("%s: async get_result() error %u\n", MODULE_NAME, ret);
+  }
+  restore_crypto(current_job_crypto_enabled);
+  current_job = NULL;
+  done_job = job;
+}
+/*---------------------------------------------------------------------------*/
 static void
 set_key(const uint8_t *key)
 {
@@ -85,10 +117,17 @@ aead(const uint8_t *nonce, uint8_t *m, uint8_t m_len, const uint8_t *a,
   uint16_t cdata_len;
   uint8_t crypto_enabled, ret;
 
+  if(current_job != NULL) {
+    /* The engine runs one operation at a time: complete the job first.
+       Our process may not be notified any more, poll it */
+    finish_job();
+    process_poll(&cc2538_ccm_star_process);
+  }
+
   crypto_enabled = enable_crypto();
 
   if(forward) {
-    ret = ccm_auth_encrypt_start(CCM_STAR_LEN_LEN, CC2538_AES_128_KEY_AREA,
+    ret = ccm_auth_encrypt_start(CCM_STAR_LEN_LEN, cc2538_aes_128_key_area(),
                                  nonce, a, a_len, m, m_len, m, mic_len, NULL);
     if(ret != CRYPTO_SUCCESS) {
       PRINTF("%s: ccm_auth_encrypt_start() error %u\n", MODULE_NAME, ret);
@@ -103,7 +142,7 @@ aead(const uint8_t *nonce, uint8_t *m, uint8_t m_len, const uint8_t *a,
     }
   } else {
     cdata_len = m_len + mic_len;
-    ret = ccm_auth_decrypt_start(CCM_STAR_LEN_LEN, CC2538_AES_128_KEY_AREA,
+    ret = ccm_auth_decrypt_start(CCM_STAR_LEN_LEN, cc2538_aes_128_key_area(),
                                  nonce, a, a_len, m, cdata_len, m, mic_len,
                                  NULL);
     if(ret != CRYPTO_SUCCESS) {
@@ -122,9 +161,65 @@ aead(const uint8_t *nonce, uint8_t *m, uint8_t m_len, const uint8_t *a,
   restore_crypto(crypto_enabled);
 }
 /*---------------------------------------------------------------------------*/
+static int
+aead_async(struct ccm_star_job *job)
+{
+  uint8_t ret;
+
+  if(current_job != NULL || done_job != NULL) {
+    return 0;
+  }
+  if(!process_is_running(&cc2538_ccm_star_process)) {
+    process_start(&cc2538_ccm_star_process, NULL);
+  }
+
+  current_job_crypto_enabled = enable_crypto();
+  if(job->forward) {
+    ret = ccm_auth_encrypt_start(CCM_STAR_LEN_LEN, cc2538_aes_128_key_area(),
+                                 job->nonce, job->a, job->a_len,
+                                 job->m, job->m_len, job->m, job->mic_len,
+                                 &cc2538_ccm_star_process);
+  } else {
+    ret = ccm_auth_decrypt_start(CCM_STAR_LEN_LEN, cc2538_aes_128_key_area(),
+                                 job->nonce, job->a, job->a_len,
+                                 job->m, job->m_len + job->mic_len, job->m,
+                                 job->mic_len, &cc2538_ccm_star_process);
+  }
+  if(ret != CRYPTO_SUCCESS) {
+    PRINTF("%s: async start error %u\n", MODULE_NAME, ret);
+    restore_crypto(current_job_crypto_enabled);
+    return 0;
+  }
+  current_job = job;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(cc2538_ccm_star_process, ev, data)
+{
+  struct ccm_star_job *job;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    if(current_job != NULL) {
+      finish_job();
+    }
+    if(done_job != NULL) {
+      job = done_job;
+      done_job = NULL;
+      ccm_star_queue_done(job);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
 const struct ccm_star_driver cc2538_ccm_star_driver = {
   set_key,
-  aead
+  aead,
+  aead_async
 };
 
 /** @} */
@@ -48,6 +48,7 @@
 #include "dev/rfcore.h"
 #include "dev/sys-ctrl.h"
 #include "dev/udma.h"
+#include "lib/ringbufindex.h"
 #include "reg.h"
 
 #include <string.h>
@@ -90,6 +91,13 @@
 
 /* 192 usec off -> on interval (RX Callib -> SFD Wait). We wait a bit more */
 #define ONOFF_TIME                    RTIMER_ARCH_SECOND / 3125
+
+/* Timing reported in RADIO_CONST_CAPABILITIES, in usec: from transmit()
+ * to the SFD on air, from on() to listening, and the 12-symbol RX to TX
+ * turnaround */
+#define CC2538_RF_DELAY_BEFORE_TX_US  351
+#define CC2538_RF_DELAY_BEFORE_RX_US  126
+#define CC2538_RF_TURNAROUND_US       192
 /*---------------------------------------------------------------------------*/
 /* Sniffer configuration */
 #ifndef CC2538_RF_CONF_SNIFFER_USB
@@ -121,8 +129,28 @@ static const uint8_t magic[] = { 0x53, 0x6E, 0x69, 0x66 };      /** Snif */
 #endif
 /*---------------------------------------------------------------------------*/
 static uint8_t rf_flags;
+/* Set while sending the frames of a burst after the first one */
+static uint8_t burst_continuation;
 static uint8_t rf_channel = CC2538_RF_CHANNEL;
 
+#if CC2538_RF_RX_RING
+#if CC2538_RF_RX_RING_SLOTS & (CC2538_RF_RX_RING_SLOTS - 1)
+#error "CC2538_RF_CONF_RX_RING_SLOTS must be a power of two"
+#endif
+/* A frame drained from the RX FIFO by the RX ISR */
+struct rx_slot {
+  rtimer_clock_t timestamp;
+  int8_t rssi;
+  uint8_t crc_corr;
+  uint8_t len;
+  uint8_t buf[CC2538_RF_MAX_PACKET_LEN];
+};
+static struct rx_slot rx_slots[CC2538_RF_RX_RING_SLOTS];
+static struct ringbufindex rx_ring;
+/* Timestamp of the last frame returned by read() */
+static rtimer_clock_t last_packet_timestamp;
+#endif /* CC2538_RF_RX_RING */
+
 static int on(void);
 static int off(void);
 /*---------------------------------------------------------------------------*/
@@ -459,6 +487,10 @@ init(void)
 
   set_channel(rf_channel);
 
+#if CC2538_RF_RX_RING
+  ringbufindex_init(&rx_ring, CC2538_RF_RX_RING_SLOTS);
+#endif
+
   /* Acknowledge RF interrupts, FIFOP only */
   REG(RFCORE_XREG_RFIRQM0) |= RFCORE_XREG_RFIRQM0_FIFOP;
   nvic_interrupt_enable(NVIC_INT_RF_RXTX);
@@ -571,18 +603,21 @@ transmit(unsigned short transmit_len)
     while(RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + ONOFF_TIME));
   }
 
-  if(channel_clear() == CC2538_RF_CCA_BUSY) {
-    RIMESTATS_ADD(contentiondrop);
-    return RADIO_TX_COLLISION;
-  }
+  /* Within a burst, we hold the channel since the first frame */
+  if(!burst_continuation) {
+    if(channel_clear() == CC2538_RF_CCA_BUSY) {
+      RIMESTATS_ADD(contentiondrop);
+      return RADIO_TX_COLLISION;
+    }
 
-  /*
-   * prepare() double checked that TX_ACTIVE is low. If SFD is high we are
-   * receiving. Abort transmission and bail out with RADIO_TX_COLLISION
-   */
-  if(REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_SFD) {
-    RIMESTATS_ADD(contentiondrop);
-    return RADIO_TX_COLLISION;
+    /*
+     * prepare() double checked that TX_ACTIVE is low. If SFD is high we are
+     * receiving. Abort transmission and bail out with RADIO_TX_COLLISION
+     */
+    if(REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_SFD) {
+      RIMESTATS_ADD(contentiondrop);
+      return RADIO_TX_COLLISION;
+    }
   }
 
   /* Start the transmission */
@@ -626,12 +661,61 @@ send(const void *payload, unsigned short payload_len)
 }
 /*---------------------------------------------------------------------------*/
 static int
-read(void *buf, unsigned short bufsize)
+send_burst(const struct radio_frame *frames, unsigned short count,
+           unsigned short *sent)
+{
+  int ret = RADIO_TX_OK;
+  uint8_t was_off = 0;
+  rtimer_clock_t t0;
+
+  *sent = 0;
+
+  /* Stay on between the frames */
+  if(!(rf_flags & RX_ACTIVE)) {
+    t0 = RTIMER_NOW();
+    on();
+    was_off = 1;
+    while(RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + ONOFF_TIME));
+  }
+
+  /*
+   * prepare() waits for the end of the previous frame before loading the
+   * TX FIFO, through the uDMA when enabled, and transmit() starts the next
+   * frame right away
+   */
+  while(*sent < count && ret == RADIO_TX_OK) {
+    prepare(frames[*sent].payload, frames[*sent].payload_len);
+    ret = transmit(frames[*sent].payload_len);
+    if(ret == RADIO_TX_OK) {
+      (*sent)++;
+      burst_continuation = 1;
+    }
+  }
+  burst_continuation = 0;
+
+  if(was_off) {
+    off();
+  }
+
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Read the frame at the head of the RX FIFO
+ * \param buf Where to store the payload, without the checksum
+ * \param bufsize The size of \a buf
+ * \param rssi Where to store the RSSI of the frame
+ * \param crc_corr Where to store the CRC OK bit and the correlation value
+ * \return The payload length, 0 if there was no valid frame to read
+ *
+ * Invalid frames are flushed out of the FIFO. Does not touch the packetbuf,
+ * so that the RX ring can call it from the RX ISR
+ */
+static int
+read_frame(void *buf, unsigned short bufsize, int8_t *rssi, uint8_t *crc_corr)
 {
   uint8_t i;
   uint8_t len;
-  uint8_t crc_corr;
-  int8_t rssi;
 
   PRINTF("RF: Read\n");
 
@@ -700,15 +784,13 @@ read(void *buf, unsigned short bufsize)
   }
 
   /* Read the RSSI and CRC/Corr bytes */
-  rssi = ((int8_t)REG(RFCORE_SFR_RFDATA)) - RSSI_OFFSET;
-  crc_corr = REG(RFCORE_SFR_RFDATA);
+  *rssi = ((int8_t)REG(RFCORE_SFR_RFDATA)) - RSSI_OFFSET;
+  *crc_corr = REG(RFCORE_SFR_RFDATA);
 
-  PRINTF("%02x%02x\n", (uint8_t)rssi, crc_corr);
+  PRINTF("%02x%02x\n", (uint8_t)*rssi, *crc_corr);
 
   /* MS bit CRC OK/Not OK, 7 LS Bits, Correlation value */
-  if(crc_corr & CRC_BIT_MASK) {
-    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, rssi);
-    packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, crc_corr & LQI_BIT_MASK);
+  if(*crc_corr & CRC_BIT_MASK) {
     RIMESTATS_ADD(llrx);
   } else {
     RIMESTATS_ADD(badcrc);
@@ -717,6 +799,92 @@ read(void *buf, unsigned short bufsize)
     return 0;
   }
 
+  /* If FIFOP==1 and FIFO==0 then we had a FIFO overflow at some point. */
+  if(REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_FIFOP) {
+    if(REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_FIFO) {
+      process_poll(&cc2538_rf_process);
+    } else {
+      CC2538_RF_CSP_ISFLUSHRX();
+    }
+  }
+
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+#if CC2538_RF_RX_RING
+/**
+ * \brief Move every complete frame from the RX FIFO to the RX ring
+ *
+ * Called from the RX ISR, and from the driver process with the RX interrupt
+ * masked. When the ring is full, frames are left in the FIFO until the
+ * process has freed some slots.
+ */
+static void
+rx_ring_fill(void)
+{
+  struct rx_slot *slot;
+  rtimer_clock_t now = RTIMER_NOW();
+  int index;
+  int len;
+
+  while(REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_FIFOP) {
+    index = ringbufindex_peek_put(&rx_ring);
+    if(index == -1) {
+      PRINTF("RF: RX ring full\n");
+      return;
+    }
+    slot = &rx_slots[index];
+    len = read_frame(slot->buf, sizeof(slot->buf), &slot->rssi,
+                     &slot->crc_corr);
+    if(len > 0) {
+      slot->len = len;
+      slot->timestamp = now;
+      ringbufindex_put(&rx_ring);
+    }
+  }
+}
+#endif /* CC2538_RF_RX_RING */
+/*---------------------------------------------------------------------------*/
+static int
+read(void *buf, unsigned short bufsize)
+{
+  int len;
+  uint8_t crc_corr;
+  int8_t rssi;
+#if CC2538_RF_CONF_SNIFFER
+  uint8_t i;
+#endif
+#if CC2538_RF_RX_RING
+  struct rx_slot *slot;
+  int index;
+
+  index = ringbufindex_peek_get(&rx_ring);
+  if(index == -1) {
+    return 0;
+  }
+  slot = &rx_slots[index];
+  len = slot->len;
+  if(len > bufsize) {
+    PRINTF("RF: too long\n");
+    RIMESTATS_ADD(toolong);
+    ringbufindex_get(&rx_ring);
+    return 0;
+  }
+  memcpy(buf, slot->buf, len);
+  rssi = slot->rssi;
+  crc_corr = slot->crc_corr;
+  last_packet_timestamp = slot->timestamp;
+  ringbufindex_get(&rx_ring);
+#else
+  len = read_frame(buf, bufsize, &rssi, &crc_corr);
+  if(len == 0) {
+    return 0;
+  }
+#endif /* CC2538_RF_RX_RING */
+
+  packetbuf_set_attr(PACKETBUF_ATTR_RSSI, rssi);
+  packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, crc_corr & LQI_BIT_MASK);
+
 #if CC2538_RF_CONF_SNIFFER
   write_byte(magic[0]);
   write_byte(magic[1]);
@@ -731,15 +899,6 @@ read(void *buf, unsigned short bufsize)
   flush();
 #endif
 
-  /* If FIFOP==1 and FIFO==0 then we had a FIFO overflow at some point. */
-  if(REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_FIFOP) {
-    if(REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_FIFO) {
-      process_poll(&cc2538_rf_process);
-    } else {
-      CC2538_RF_CSP_ISFLUSHRX();
-    }
-  }
-
   return (len);
 }
 /*---------------------------------------------------------------------------*/
@@ -764,6 +923,12 @@ pending_packet(void)
 {
   PRINTF("RF: Pending\n");
 
+#if CC2538_RF_RX_RING
+  if(ringbufindex_elements(&rx_ring) > 0) {
+    return 1;
+  }
+#endif
+
   return (REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_FIFOP);
 }
 /*---------------------------------------------------------------------------*/
@@ -881,8 +1046,27 @@ static radio_result_t
 get_object(radio_param_t param, void *dest, size_t size)
 {
   uint8_t *target;
+  struct radio_capabilities *caps;
   int i;
 
+  if(param == RADIO_CONST_CAPABILITIES) {
+    if(size != sizeof(struct radio_capabilities) || !dest) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    caps = dest;
+    memset(caps, 0, sizeof(*caps));
+    caps->flags = RADIO_CAP_HW_ACK | RADIO_CAP_TIMING;
+#if CC2538_RF_RX_RING
+    /* Taken in the RX interrupt, once the frame is in the FIFO */
+    caps->timestamp_precision_us = (1000000UL + RTIMER_SECOND - 1) / RTIMER_SECOND;
+#endif
+    caps->delay_before_tx_us = CC2538_RF_DELAY_BEFORE_TX_US;
+    caps->delay_before_rx_us = CC2538_RF_DELAY_BEFORE_RX_US;
+    caps->delay_before_detect_us = 0;
+    caps->turnaround_us = CC2538_RF_TURNAROUND_US;
+    return RADIO_RESULT_OK;
+  }
+
   if(param == RADIO_PARAM_64BIT_ADDR) {
     if(size != 8 || !dest) {
       return RADIO_RESULT_INVALID_VALUE;
@@ -895,6 +1079,17 @@ get_object(radio_param_t param, void *dest, size_t size)
 
     return RADIO_RESULT_OK;
   }
+
+#if CC2538_RF_RX_RING
+  if(param == RADIO_PARAM_LAST_PACKET_TIMESTAMP) {
+    if(size != sizeof(rtimer_clock_t) || !dest) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    *(rtimer_clock_t *)dest = last_packet_timestamp;
+    return RADIO_RESULT_OK;
+  }
+#endif
+
   return RADIO_RESULT_NOT_SUPPORTED;
 }
 /*---------------------------------------------------------------------------*/
@@ -931,7 +1126,8 @@ const struct radio_driver cc2538_rf_driver = {
   get_value,
   set_value,
   get_object,
-  set_object
+  set_object,
+  send_burst
 };
 /*---------------------------------------------------------------------------*/
 /**
@@ -952,6 +1148,27 @@ PROCESS_THREAD(cc2538_rf_process, ev, data)
   while(1) {
     PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
 
+#if CC2538_RF_RX_RING
+    /* Deliver every frame the RX ISR has queued since the last poll */
+    while(ringbufindex_elements(&rx_ring) > 0) {
+      packetbuf_clear();
+      len = read(packetbuf_dataptr(), PACKETBUF_SIZE);
+
+      if(len > 0) {
+        packetbuf_set_datalen(len);
+
+        NETSTACK_RDC.input();
+      }
+    }
+
+    /* Pick up the frames left in the FIFO while the ring was full */
+    nvic_interrupt_disable(NVIC_INT_RF_RXTX);
+    rx_ring_fill();
+    nvic_interrupt_enable(NVIC_INT_RF_RXTX);
+    if(ringbufindex_elements(&rx_ring) > 0) {
+      process_poll(&cc2538_rf_process);
+    }
+#else
     packetbuf_clear();
     len = read(packetbuf_dataptr(), PACKETBUF_SIZE);
 
@@ -960,6 +1177,7 @@ PROCESS_THREAD(cc2538_rf_process, ev, data)
 
       NETSTACK_RDC.input();
     }
+#endif /* CC2538_RF_RX_RING */
 
     /* If we were polled due to an RF error, reset the transceiver */
     if(rf_flags & RF_MUST_RESET) {
@@ -996,6 +1214,10 @@ cc2538_rf_rx_tx_isr(void)
 {
   ENERGEST_ON(ENERGEST_TYPE_IRQ);
 
+#if CC2538_RF_RX_RING
+  rx_ring_fill();
+#endif
+
   process_poll(&cc2538_rf_process);
 
   /* We only acknowledge FIFOP so we can safely wipe out the entire SFR */
@@ -85,6 +85,27 @@
 #else
 #define CC2538_RF_AUTOACK 1
 #endif /* CC2538_RF_CONF_AUTOACK */
+
+/*
+ * With the RX ring enabled, the RX ISR drains complete frames out of the RX
+ * FIFO (by uDMA when enabled) into a ring of slots, together with their RSSI,
+ * LQI and a timestamp. The driver process then delivers every queued frame
+ * in one go. This frees the single-frame RX FIFO as soon as possible, so
+ * that back-to-back frames are not lost while the process is busy
+ */
+#ifdef CC2538_RF_CONF_RX_RING
+#define CC2538_RF_RX_RING CC2538_RF_CONF_RX_RING
+#else
+#define CC2538_RF_RX_RING 0
+#endif /* CC2538_RF_CONF_RX_RING */
+
+/* Number of slots in the RX ring, must be a power of two. One slot is
+ * always kept free by the ring index, so this holds SLOTS - 1 frames */
+#ifdef CC2538_RF_CONF_RX_RING_SLOTS
+#define CC2538_RF_RX_RING_SLOTS CC2538_RF_CONF_RX_RING_SLOTS
+#else
+#define CC2538_RF_RX_RING_SLOTS 4
+#endif /* CC2538_RF_CONF_RX_RING_SLOTS */
 /*---------------------------------------------------------------------------
  * Command Strobe Processor
  *---------------------------------------------------------------------------*/
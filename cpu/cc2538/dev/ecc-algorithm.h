@@ -39,7 +39,8 @@
  * to free the main CPU / thread while the PKA is calculating.
  *
  * \note
- * Only one request can be processed at a time.
+ * Only one request can be processed at a time. Use the ECC job queue
+ * (ecc-jobs.h) to share the PKA between several processes.
  * Maximal supported key length is 384bit (12 words).
  * @{
  *
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \addtogroup cc2538-ecc-jobs
+ * @{
+ *
+ * \file
+ * Implementation of the cc2538 ECC job queue
+ */
+#include "contiki.h"
+#include "lib/list.h"
+#include "dev/ecc-jobs.h"
+#include "dev/pka.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+LIST(job_queue);
+static ecc_job_t *current;
+process_event_t ecc_job_event_done;
+
+PROCESS(ecc_jobs_process, "ECC jobs");
+/*---------------------------------------------------------------------------*/
+static int
+is_queued(ecc_job_t *job)
+{
+  ecc_job_t *j;
+
+  for(j = list_head(job_queue); j != NULL; j = list_item_next(j)) {
+    if(j == job) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+prepare(ecc_job_t *job)
+{
+  struct pt *pt;
+
+  switch(job->type) {
+  case ECC_JOB_COMPARE:
+    pt = &job->state.compare->pt;
+    job->state.compare->process = &ecc_jobs_process;
+    break;
+  case ECC_JOB_MULTIPLY:
+    pt = &job->state.multiply->pt;
+    job->state.multiply->process = &ecc_jobs_process;
+    break;
+  case ECC_JOB_DSA_SIGN:
+    pt = &job->state.sign->pt;
+    job->state.sign->process = &ecc_jobs_process;
+    break;
+  default:
+    pt = &job->state.verify->pt;
+    job->state.verify->process = &ecc_jobs_process;
+    break;
+  }
+  PT_INIT(pt);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ecc_jobs_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_UNTIL(list_head(job_queue) != NULL);
+
+    current = list_head(job_queue);
+    prepare(current);
+    pka_enable();
+    PRINTF("ecc-jobs: starting job %p type %u\n", current, current->type);
+
+    /*
+     * The ecc-algorithm protothreads yield while the PKA is busy and the
+     * PKA ISR polls this process when an operation has finished. This
+     * cannot be a switch statement, since the protothread local
+     * continuations are switch-based.
+     */
+    if(current->type == ECC_JOB_COMPARE) {
+      PROCESS_PT_SPAWN(&current->state.compare->pt,
+                       ecc_compare(current->state.compare));
+    } else if(current->type == ECC_JOB_MULTIPLY) {
+      PROCESS_PT_SPAWN(&current->state.multiply->pt,
+                       ecc_multiply(current->state.multiply));
+    } else if(current->type == ECC_JOB_DSA_SIGN) {
+      PROCESS_PT_SPAWN(&current->state.sign->pt,
+                       ecc_dsa_sign(current->state.sign));
+    } else {
+      PROCESS_PT_SPAWN(&current->state.verify->pt,
+                       ecc_dsa_verify(current->state.verify));
+    }
+
+    list_remove(job_queue, current);
+    PRINTF("ecc-jobs: job %p done\n", current);
+    process_post(current->owner, ecc_job_event_done, current);
+    current = NULL;
+
+    if(list_head(job_queue) == NULL) {
+      pka_disable();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+ecc_jobs_init(void)
+{
+  if(ecc_job_event_done == 0) {
+    ecc_job_event_done = process_alloc_event();
+  }
+  list_init(job_queue);
+  current = NULL;
+  pka_init();
+  pka_disable();
+  process_start(&ecc_jobs_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+int
+ecc_job_submit(ecc_job_t *job)
+{
+  if(job->type > ECC_JOB_DSA_VERIFY || is_queued(job)) {
+    return 0;
+  }
+  list_add(job_queue, job);
+  process_poll(&ecc_jobs_process);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+ecc_job_cancel(ecc_job_t *job)
+{
+  if(job == current || !is_queued(job)) {
+    return 0;
+  }
+  list_remove(job_queue, job);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+ecc_jobs_pending(void)
+{
+  return list_length(job_queue);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \addtogroup cc2538-ecc
+ * @{
+ *
+ * \defgroup cc2538-ecc-jobs cc2538 ECC job queue
+ *
+ * Asynchronous front-end to the ECC algorithms. Processes hand in jobs
+ * (ECDH point multiplication, ECDSA sign and verify, big number compare)
+ * and get an ecc_job_event_done event once their job has completed.
+ * Jobs from any number of processes are queued and run one after the
+ * other on the PKA, so several secure sessions can have handshakes in
+ * flight at the same time without coordinating with each other.
+ *
+ * The PKA is independent of the AES/SHA cryptoprocessor. While a job
+ * waits for the PKA, the job process yields, so AES/CCM operations
+ * from other processes keep running in between.
+ *
+ * \note
+ * The PKA is owned by the job queue once ecc_jobs_init() has been
+ * called. Do not spawn the ecc-algorithm protothreads directly then.
+ * @{
+ *
+ * \file
+ * Header file for the cc2538 ECC job queue
+ */
+#ifndef ECC_JOBS_H_
+#define ECC_JOBS_H_
+
+#include "contiki.h"
+#include "dev/ecc-algorithm.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/** \name ECC job types
+ * @{
+ */
+#define ECC_JOB_COMPARE    0 /**< ecc_compare(), state.compare */
+#define ECC_JOB_MULTIPLY   1 /**< ecc_multiply() (ECDH), state.multiply */
+#define ECC_JOB_DSA_SIGN   2 /**< ecc_dsa_sign(), state.sign */
+#define ECC_JOB_DSA_VERIFY 3 /**< ecc_dsa_verify(), state.verify */
+/** @} */
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief An ECC job
+ *
+ * The job and its state are owned by the caller and must stay allocated
+ * until ecc_job_event_done has been received for it. The state is
+ * filled in as for the corresponding ecc-algorithm protothread. Its
+ * process field is set by the job queue. The outcome is found in the
+ * result field of the state.
+ */
+typedef struct ecc_job {
+  struct ecc_job *next;
+  struct process *owner;       /**< Process to notify when done */
+  uint8_t type;                /**< One of the ECC_JOB_xyz types */
+  union {
+    ecc_compare_state_t *compare;
+    ecc_multiply_state_t *multiply;
+    ecc_dsa_sign_state_t *sign;
+    ecc_dsa_verify_state_t *verify;
+  } state;
+} ecc_job_t;
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Event posted to the owner of a job once it has completed.
+ * The event data is a pointer to the job.
+ */
+extern process_event_t ecc_job_event_done;
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Initialises the PKA and starts the job queue
+ */
+void ecc_jobs_init(void);
+
+/**
+ * \brief Queues a job
+ * \param job The job, with owner, type and state filled in
+ * \return 1 if the job was queued, 0 if it is already queued or its
+ *         type is unknown
+ *
+ * Jobs are run in the order they were submitted.
+ */
+int ecc_job_submit(ecc_job_t *job);
+
+/**
+ * \brief Removes a job that has not been started yet
+ * \param job The job
+ * \return 1 if the job was removed, 0 if it is running or not queued
+ *
+ * No event is posted for a cancelled job.
+ */
+int ecc_job_cancel(ecc_job_t *job);
+
+/**
+ * \brief Returns the number of queued jobs, including the running one
+ */
+int ecc_jobs_pending(void);
+/*---------------------------------------------------------------------------*/
+#endif /* ECC_JOBS_H_ */
+
+/**
+ * @}
+ * @}
+ */
@@ -38,6 +38,7 @@
 #include "contiki-conf.h"
 #include "sys/energest.h"
 #include "sys/process.h"
+#include "sys/tickless.h"
 #include "dev/sys-ctrl.h"
 #include "dev/scb.h"
 #include "dev/rfcore-xreg.h"
@@ -265,6 +266,31 @@ lpm_enter()
    * Choose the most suitable PM based on anticipated deep sleep duration
    */
   lpm_exit_time = rtimer_arch_next_trigger();
+
+#if TICKLESS_ON
+  /*
+   * With tickless idle, pending etimers do not keep us in PM0. If the next
+   * etimer expires before the next rtimer task, set up the Sleep Timer to
+   * wake us up in time for it instead.
+   */
+  {
+    rtimer_clock_t deadline;
+
+    switch(tickless_next_deadline(&deadline)) {
+    case TICKLESS_BUSY:
+      return;
+    case TICKLESS_DEADLINE:
+      if(lpm_exit_time == 0 || RTIMER_CLOCK_LT(deadline, lpm_exit_time)) {
+        rtimer_arch_schedule_wakeup(deadline);
+        lpm_exit_time = rtimer_arch_next_wakeup();
+      }
+      break;
+    default:
+      break;
+    }
+  }
+#endif /* TICKLESS_ON */
+
   duration = lpm_exit_time - RTIMER_NOW();
 
   if(duration < DEEP_SLEEP_PM1_THRESHOLD || lpm_exit_time == 0) {
@@ -323,10 +349,10 @@ lpm_enter()
    *   were trying to make up our mind. This may have raised an event.
    * - The Sleep Timer may have fired
    *
-   * Check if there is still a scheduled rtimer task and check for pending
+   * Check if the Sleep Timer will still wake us up and check for pending
    * events before going to Deep Sleep
    */
-  if(process_nevents() || rtimer_arch_next_trigger() == 0) {
+  if(process_nevents() || rtimer_arch_next_wakeup() == 0) {
     /* Event flag raised or rtimer inactive.
      * Turn on the 32MHz XOSC, restore PMCTL and abort */
     select_32_mhz_xosc();
@@ -350,6 +376,17 @@ lpm_enter()
   return;
 }
 /*---------------------------------------------------------------------------*/
+#if TICKLESS_ON
+/*
+ * lpm_enter() programs the wake-up itself, from tickless_next_deadline(),
+ * so there is nothing to do here
+ */
+void
+tickless_arch_set_wakeup(clock_time_t ticks)
+{
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TICKLESS_ON */
 void
 lpm_set_max_pm(uint8_t pm)
 {
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup cc2538
+ * @{
+ *
+ * \file
+ * Sampling profiler timer for the cc2538, on GPTimer 3A. The timer must
+ * not be used by other code, such as the PWM driver, while profiling.
+ */
+#include "contiki.h"
+#include "sys/profiler.h"
+#include "dev/gptimer.h"
+#include "dev/nvic.h"
+#include "dev/sys-ctrl.h"
+#include "reg.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+void profiler_isr(void) __attribute__((naked));
+void profiler_timer_isr(void *pc) __attribute__((used));
+/*---------------------------------------------------------------------------*/
+void
+profiler_arch_start(unsigned rate)
+{
+  REG(SYS_CTRL_RCGCGPT) |= SYS_CTRL_RCGCGPT_GPT3;
+  /* Keep sampling while the CPU is idle, as opposed to in a PM */
+  REG(SYS_CTRL_SCGCGPT) |= SYS_CTRL_SCGCGPT_GPT3;
+
+  REG(GPT_3_BASE + GPTIMER_CTL) = 0;
+  REG(GPT_3_BASE + GPTIMER_CFG) = 0;
+  REG(GPT_3_BASE + GPTIMER_TAMR) = GPTIMER_TAMR_TAMR_PERIODIC;
+  REG(GPT_3_BASE + GPTIMER_TAILR) = sys_ctrl_get_sys_clock() / rate - 1;
+  REG(GPT_3_BASE + GPTIMER_ICR) = GPTIMER_ICR_TATOCINT;
+  REG(GPT_3_BASE + GPTIMER_IMR) = GPTIMER_IMR_TATOIM;
+  nvic_interrupt_enable(NVIC_INT_GPTIMER_3A);
+  REG(GPT_3_BASE + GPTIMER_CTL) = GPTIMER_CTL_TAEN;
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_arch_stop(void)
+{
+  REG(GPT_3_BASE + GPTIMER_CTL) = 0;
+  REG(GPT_3_BASE + GPTIMER_IMR) = 0;
+  nvic_interrupt_disable(NVIC_INT_GPTIMER_3A);
+  nvic_interrupt_unpend(NVIC_INT_GPTIMER_3A);
+  REG(SYS_CTRL_RCGCGPT) &= ~SYS_CTRL_RCGCGPT_GPT3;
+  REG(SYS_CTRL_SCGCGPT) &= ~SYS_CTRL_SCGCGPT_GPT3;
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_timer_isr(void *pc)
+{
+  REG(GPT_3_BASE + GPTIMER_ICR) = GPTIMER_ICR_TATOCINT;
+  profiler_sample(pc);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * The interrupted PC is the seventh word of the exception frame, on the
+ * stack that was in use. Bit 2 of EXC_RETURN in LR tells which stack
+ * that was. The handler proper is entered with a branch, so that it
+ * returns from the exception.
+ */
+void
+profiler_isr(void)
+{
+  __asm volatile ("tst lr, #4\n\t"
+                  "ite eq\n\t"
+                  "mrseq r0, msp\n\t"
+                  "mrsne r0, psp\n\t"
+                  "ldr r0, [r0, #24]\n\t"
+                  "b profiler_timer_isr\n\t");
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
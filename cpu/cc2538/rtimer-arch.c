@@ -47,6 +47,13 @@
 #include <stdint.h>
 /*---------------------------------------------------------------------------*/
 static volatile rtimer_clock_t next_trigger;
+/*
+ * The time the Sleep Timer interrupt is programmed for. This is
+ * next_trigger, unless the LPM module has asked for an earlier wake-up
+ * with rtimer_arch_schedule_wakeup(), in which case wakeup_only is set
+ */
+static volatile rtimer_clock_t next_wakeup;
+static volatile uint8_t wakeup_only;
 /*---------------------------------------------------------------------------*/
 /**
  * \brief We don't need to explicitly initialise anything but this
@@ -62,14 +69,9 @@ rtimer_arch_init(void)
   return;
 }
 /*---------------------------------------------------------------------------*/
-/**
- * \brief Schedules an rtimer task to be triggered at time t
- * \param t The time when the task will need executed. This is an absolute
- *          time, in other words the task will be executed AT time \e t,
- *          not IN \e t ticks
- */
-void
-rtimer_arch_schedule(rtimer_clock_t t)
+/* Programs the Sleep Timer compare value and returns the value used */
+static rtimer_clock_t
+set_compare(rtimer_clock_t t)
 {
   rtimer_clock_t now;
 
@@ -96,13 +98,44 @@ rtimer_arch_schedule(rtimer_clock_t t)
 
   INTERRUPTS_ENABLE();
 
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Schedules an rtimer task to be triggered at time t
+ * \param t The time when the task will need executed. This is an absolute
+ *          time, in other words the task will be executed AT time \e t,
+ *          not IN \e t ticks
+ */
+void
+rtimer_arch_schedule(rtimer_clock_t t)
+{
+  t = set_compare(t);
+
   /* Store the value. The LPM module will query us for it */
   next_trigger = t;
+  next_wakeup = t;
+  wakeup_only = 0;
+
+  nvic_interrupt_enable(NVIC_INT_SM_TIMER);
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_schedule_wakeup(rtimer_clock_t t)
+{
+  next_wakeup = set_compare(t);
+  wakeup_only = 1;
 
   nvic_interrupt_enable(NVIC_INT_SM_TIMER);
 }
 /*---------------------------------------------------------------------------*/
 rtimer_clock_t
+rtimer_arch_next_wakeup()
+{
+  return next_wakeup;
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
 rtimer_arch_next_trigger()
 {
   return next_trigger;
@@ -145,12 +178,25 @@ rtimer_isr()
 
   ENERGEST_ON(ENERGEST_TYPE_IRQ);
 
-  next_trigger = 0;
+  next_wakeup = 0;
 
   nvic_interrupt_unpend(NVIC_INT_SM_TIMER);
   nvic_interrupt_disable(NVIC_INT_SM_TIMER);
 
-  rtimer_run_next();
+  if(wakeup_only) {
+    /*
+     * This was an early wake-up for the LPM module. lpm_exit() has
+     * updated the system clock, which polls the etimers. Put the
+     * rtimer task, if any, back on the Sleep Timer.
+     */
+    wakeup_only = 0;
+    if(next_trigger != 0) {
+      rtimer_arch_schedule(next_trigger);
+    }
+  } else {
+    next_trigger = 0;
+    rtimer_run_next();
+  }
 
   ENERGEST_OFF(ENERGEST_TYPE_IRQ);
 }
@@ -74,6 +74,24 @@ rtimer_clock_t rtimer_arch_now(void);
  */
 rtimer_clock_t rtimer_arch_next_trigger(void);
 
+/**
+ * \brief Wake the CPU up at time t without running the rtimer task
+ * \param t The absolute time of the wake-up
+ *
+ * This is used by the LPM module to wake up for an event timer before
+ * the next rtimer task is due. The rtimer task, if any, is put back on
+ * the Sleep Timer when the wake-up interrupt fires. A later call to
+ * rtimer_arch_schedule() cancels the wake-up.
+ */
+void rtimer_arch_schedule_wakeup(rtimer_clock_t t);
+
+/**
+ * \brief Get the time the Sleep Timer interrupt will next fire
+ * \return The time of the next rtimer trigger or wake-up, or 0 if the
+ *         Sleep Timer interrupt is not scheduled
+ */
+rtimer_clock_t rtimer_arch_next_wakeup(void);
+
 #endif /* RTIMER_ARCH_H_ */
 
 /**
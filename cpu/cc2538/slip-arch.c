@@ -37,11 +37,17 @@
  *
  * SLIP can be configured to operate over UART or over USB-Serial, depending
  * on the value of SLIP_ARCH_CONF_USB
+ *
+ * In block mode (SLIP_CONF_BLOCK) over UART, encoded blocks are sent by
+ * uDMA on the UART's TX channel, and the UART interrupt only copies
+ * received bytes to a buffer that is decoded from a poll handler.
  */
-#include "contiki-conf.h"
+#include "contiki.h"
 #include "dev/slip.h"
 #include "dev/uart.h"
+#include "dev/udma.h"
 #include "usb/usb-serial.h"
+#include "reg.h"
 
 #ifndef SLIP_ARCH_CONF_USB
 #define SLIP_ARCH_CONF_USB 0
@@ -58,6 +64,88 @@
 #endif
 
 #define SLIP_END     0300
+
+#if SLIP_BLOCK && !SLIP_ARCH_CONF_USB
+#define SLIP_ARCH_DMA 1
+#else
+#define SLIP_ARCH_DMA 0
+#endif
+
+#if SLIP_ARCH_DMA
+/* The uDMA channel of the UART's TX requests: 9 for either UART, or 23
+   for UART1. */
+#ifdef SLIP_ARCH_CONF_TX_DMA_CHAN
+#define SLIP_ARCH_TX_DMA_CHAN SLIP_ARCH_CONF_TX_DMA_CHAN
+#else
+#define SLIP_ARCH_TX_DMA_CHAN 9
+#endif
+
+#if SLIP_ARCH_TX_DMA_CHAN > UDMA_CONF_MAX_CHANNEL
+#error "SLIP block mode needs UDMA_CONF_MAX_CHANNEL >= SLIP_ARCH_TX_DMA_CHAN"
+#endif
+
+/* The size of the buffer of received bytes. */
+#ifdef SLIP_ARCH_CONF_RX_BUFSIZE
+#define SLIP_ARCH_RX_BUFSIZE SLIP_ARCH_CONF_RX_BUFSIZE
+#else
+#define SLIP_ARCH_RX_BUFSIZE 128
+#endif
+
+#define SLIP_ARCH_UART_BASE \
+  (SLIP_ARCH_CONF_UART == 0 ? UART_0_BASE : UART_1_BASE)
+
+#define UDMA_TX_FLAGS (UDMA_CHCTL_ARBSIZE_4 | UDMA_CHCTL_XFERMODE_BASIC \
+    | UDMA_CHCTL_SRCSIZE_8 | UDMA_CHCTL_DSTSIZE_8 \
+    | UDMA_CHCTL_SRCINC_8 | UDMA_CHCTL_DSTINC_NONE)
+
+static uint8_t rxbuf[SLIP_ARCH_RX_BUFSIZE];
+static volatile uint16_t rx_head, rx_tail;
+
+#define tx_wait() while(udma_channel_get_mode(SLIP_ARCH_TX_DMA_CHAN) \
+                        != UDMA_CHCTL_XFERMODE_STOP)
+
+PROCESS(slip_arch_process, "SLIP arch");
+#endif /* SLIP_ARCH_DMA */
+/*---------------------------------------------------------------------------*/
+#if SLIP_ARCH_DMA
+/* Called from the UART interrupt. */
+static int
+input_byte(unsigned char c)
+{
+  uint16_t next;
+
+  next = rx_head + 1 == SLIP_ARCH_RX_BUFSIZE ? 0 : rx_head + 1;
+  if(next != rx_tail) {
+    rxbuf[rx_head] = c;
+    rx_head = next;
+  }
+  process_poll(&slip_arch_process);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(slip_arch_process, ev, data)
+{
+  uint16_t head;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    /* Decode what has been received, in at most two contiguous chunks. */
+    while(rx_tail != rx_head) {
+      head = rx_head;
+      if(head < rx_tail) {
+        head = SLIP_ARCH_RX_BUFSIZE;
+      }
+      slip_input_block(&rxbuf[rx_tail], head - rx_tail);
+      rx_tail = head == SLIP_ARCH_RX_BUFSIZE ? 0 : head;
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* SLIP_ARCH_DMA */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief Write a byte over SLIP
@@ -66,6 +154,10 @@
 void
 slip_arch_writeb(unsigned char c)
 {
+#if SLIP_ARCH_DMA
+  /* Let a block that is being sent finish first. */
+  tx_wait();
+#endif
   write_byte(c);
   if(c == SLIP_END) {
     flush();
@@ -79,8 +171,68 @@ slip_arch_writeb(unsigned char c)
 void
 slip_arch_init(unsigned long ubr)
 {
+#if SLIP_ARCH_DMA
+  rx_head = rx_tail = 0;
+  process_start(&slip_arch_process, NULL);
+  set_input(input_byte);
+
+  /* Interrupt when the RX FIFO is half full, or on a timeout. */
+  REG(SLIP_ARCH_UART_BASE + UART_IFLS) =
+    UART_IFLS_RXIFLSEL_1_2 | UART_IFLS_TXIFLSEL_1_2;
+
+  udma_set_channel_assignment(SLIP_ARCH_TX_DMA_CHAN,
+                              SLIP_ARCH_TX_DMA_CHAN == 9 ?
+                              SLIP_ARCH_CONF_UART : 0);
+  udma_channel_use_primary(SLIP_ARCH_TX_DMA_CHAN);
+  udma_channel_prio_set_default(SLIP_ARCH_TX_DMA_CHAN);
+  udma_channel_mask_clr(SLIP_ARCH_TX_DMA_CHAN);
+  udma_set_channel_dst(SLIP_ARCH_TX_DMA_CHAN,
+                       SLIP_ARCH_UART_BASE + UART_DR);
+  REG(SLIP_ARCH_UART_BASE + UART_DMACTL) |= UART_DMACTL_TXDMAE;
+#else
   set_input(slip_input_byte);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+#if SLIP_BLOCK
+/**
+ * \brief Start to send a block of SLIP-encoded data
+ * \param buf The data
+ * \param len The number of bytes, at most 1024
+ *
+ * Waits for the previous block to be sent, and returns while this one
+ * is sent by uDMA.
+ */
+void
+slip_arch_write(const uint8_t *buf, uint16_t len)
+{
+#if SLIP_ARCH_DMA
+  tx_wait();
+
+  udma_set_channel_src(SLIP_ARCH_TX_DMA_CHAN, (uint32_t)buf + len - 1);
+  udma_set_channel_control_word(SLIP_ARCH_TX_DMA_CHAN,
+                                UDMA_TX_FLAGS | udma_xfer_size(len));
+  udma_channel_enable(SLIP_ARCH_TX_DMA_CHAN);
+
+#if DBG_CONF_SLIP_MUX
+  /* Debug output is written to the same UART byte by byte, so the last
+     block of a frame must be sent before returning. */
+  if(buf[len - 1] == SLIP_END) {
+    tx_wait();
+  }
+#endif
+#else
+  uint16_t i;
+
+  for(i = 0; i < len; i++) {
+    write_byte(buf[i]);
+  }
+  if(len > 0 && buf[len - 1] == SLIP_END) {
+    flush();
+  }
+#endif
 }
+#endif /* SLIP_BLOCK */
 /*---------------------------------------------------------------------------*/
 
 /** @} */
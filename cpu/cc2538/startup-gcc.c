@@ -81,6 +81,20 @@ void uart1_isr(void);
 #define uart1_isr default_handler
 #endif /* UART_CONF_ENABLE */
 
+/* And the sampling profiler timer ISR */
+#if PROFILER_CONF_ENABLED
+void profiler_isr(void);
+#else /* PROFILER_CONF_ENABLED */
+#define profiler_isr default_handler
+#endif /* PROFILER_CONF_ENABLED */
+
+/* And the periodic ADC sampling timer ISR */
+#if ADC_SAMPLER_CONF_ENABLED
+void adc_sampler_isr(void);
+#else /* ADC_SAMPLER_CONF_ENABLED */
+#define adc_sampler_isr default_handler
+#endif /* ADC_SAMPLER_CONF_ENABLED */
+
 /* Boot Loader Backdoor selection */
 #if FLASH_CCA_CONF_BOOTLDR_BACKDOOR
 /* Backdoor enabled */
@@ -147,7 +161,7 @@ void(*const vectors[])(void) =
   default_handler,            /* 36 Timer 0 subtimer B */
   default_handler,            /* 37 Timer 1 subtimer A */
   default_handler,            /* 38 Timer 1 subtimer B */
-  default_handler,            /* 39 Timer 2 subtimer A */
+  adc_sampler_isr,            /* 39 Timer 2 subtimer A */
   default_handler,            /* 40 Timer 2 subtimer B */
   default_handler,            /* 41 Analog Comparator 0 */
   default_handler,            /* 42 RFCore Rx/Tx (Alternate) */
@@ -159,7 +173,7 @@ void(*const vectors[])(void) =
   default_handler,            /* 48 SM Timer (Alternate) */
   default_handler,            /* 49 MacTimer (Alternate) */
   default_handler,            /* 50 SSI1 Rx and Tx */
-  default_handler,            /* 51 Timer 3 subtimer A */
+  profiler_isr,               /* 51 Timer 3 subtimer A */
   default_handler,            /* 52 Timer 3 subtimer B */
   0,                          /* 53 Reserved */
   0,                          /* 54 Reserved */
@@ -45,6 +45,7 @@
 #include "ti-lib.h"
 #include "lpm.h"
 #include "sys/energest.h"
+#include "sys/tickless.h"
 #include "lib/list.h"
 #include "dev/leds.h"
 #include "dev/watchdog.h"
@@ -234,6 +235,17 @@ wake_up(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if TICKLESS_ON
+/*
+ * lpm_drop() programs the wake-up itself, from
+ * tickless_next_clock_deadline(), so there is nothing to do here
+ */
+void
+tickless_arch_set_wakeup(clock_time_t ticks)
+{
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TICKLESS_ON */
 void
 lpm_drop()
 {
@@ -272,6 +284,20 @@ lpm_drop()
   }
 
   /* Reschedule AON RTC CH1 to fire just in time for the next etimer event */
+#if TICKLESS_ON
+  switch(tickless_next_clock_deadline(&next_event)) {
+  case TICKLESS_BUSY:
+    /* An etimer expired or an event was posted since we last checked */
+    ti_lib_int_master_enable();
+    return;
+  case TICKLESS_DEADLINE:
+    soc_rtc_schedule_one_shot(AON_RTC_CH1, soc_rtc_last_isr_time() +
+                              (next_event * (RTIMER_SECOND / CLOCK_SECOND)));
+    break;
+  default:
+    break;
+  }
+#else /* TICKLESS_ON */
   next_event = etimer_next_expiration_time();
 
   if(etimer_pending()) {
@@ -279,6 +305,7 @@ lpm_drop()
     soc_rtc_schedule_one_shot(AON_RTC_CH1, soc_rtc_last_isr_time() +
                               (next_event * (RTIMER_SECOND / CLOCK_SECOND)));
   }
+#endif /* TICKLESS_ON */
 
   /* Drop */
   if(max_pm == LPM_MODE_SLEEP) {
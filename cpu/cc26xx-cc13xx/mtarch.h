@@ -30,19 +30,12 @@
  */
 /*
  * \file
- * Stub header file for multi-threading. It doesn't do anything, it
- * just exists so that mt.c can compile cleanly.
- *
- * This is based on the original mtarch.h for z80 by Takahide Matsutsuka
- *
- * \author
- * George Oikonomou - <oikonomou@users.sourceforge.net>
+ * Multi-threading support. The Cortex-M implementation is shared with
+ * the other ARMv7-M CPUs in cpu/arm/common/mtarch.
  */
 #ifndef __MTARCH_H__
 #define __MTARCH_H__
 
-struct mtarch_thread {
-  unsigned char *sp;
-};
+#include "cortex-m-mtarch.h"
 
 #endif /* __MTARCH_H__ */
@@ -52,6 +52,7 @@
 #include "sys/clock.h"
 #include "sys/rtimer.h"
 #include "sys/cc.h"
+#include "lib/random.h"
 #include "lpm.h"
 #include "ti-lib.h"
 #include "rf-core/rf-core.h"
@@ -101,6 +102,28 @@
 #else
 #define IEEE_MODE_RSSI_THRESHOLD 0xA6
 #endif /* IEEE_MODE_CONF_RSSI_THRESHOLD */
+
+/*
+ * Configuration to send frames as a single chain of radio operations:
+ * CMD_IEEE_CSMA, CMD_IEEE_TX and, for frames that request one,
+ * CMD_IEEE_RX_ACK, while the background CMD_IEEE_RX keeps running. The
+ * RF core then does CSMA-CA and waits for the ACK itself, and the main
+ * CPU sleeps until the end of the chain. transmit() returns
+ * RADIO_TX_COLLISION when CSMA-CA gives up and RADIO_TX_NOACK when no
+ * ACK arrives, so the MAC should neither do CCA nor wait for ACKs.
+ */
+#ifdef IEEE_MODE_CONF_TX_CHAIN
+#define IEEE_MODE_TX_CHAIN IEEE_MODE_CONF_TX_CHAIN
+#else
+#define IEEE_MODE_TX_CHAIN 0
+#endif /* IEEE_MODE_CONF_TX_CHAIN */
+
+/* The number of RX data entries in the circular RX queue */
+#ifdef IEEE_MODE_CONF_RX_BUF_CNT
+#define IEEE_MODE_RX_BUF_CNT IEEE_MODE_CONF_RX_BUF_CNT
+#else
+#define IEEE_MODE_RX_BUF_CNT 4
+#endif /* IEEE_MODE_CONF_RX_BUF_CNT */
 /*---------------------------------------------------------------------------*/
 /* Data entry status field constants */
 #define DATA_ENTRY_STATUS_PENDING    0x00 /* Not in use by the Radio CPU */
@@ -151,6 +174,13 @@ static uint8_t rf_stats[16] = { 0 };
 
 /* How long to wait for the RF to enter RX in rf_cmd_ieee_rx */
 #define ENTER_RX_WAIT_TIMEOUT (RTIMER_SECOND >> 10)
+
+/* CSMA-CA parameters and the ACK wait duration of chained TX */
+#define TX_CHAIN_MAC_MIN_BE                 3
+#define TX_CHAIN_MAC_MAX_BE                 5
+#define TX_CHAIN_MAC_MAX_CSMA_BACKOFFS      4
+/* macAckWaitDuration, 54 symbols of 16 us, in 4 MHz radio timer ticks */
+#define TX_CHAIN_ACK_WAIT_RAT        (54 * 16 * 4)
 /*---------------------------------------------------------------------------*/
 /* TX Power dBm lookup table - values from SmartRF Studio */
 typedef struct output_config {
@@ -203,11 +233,8 @@ static uint8_t cmd_ieee_rx_buf[RF_CMD_BUFFER_SIZE] CC_ALIGN(4);
 #define DATA_ENTRY_LENSZ_WORD 2 /* 2 bytes */
 
 #define RX_BUF_SIZE 140
-/* Four receive buffers entries with room for 1 IEEE802.15.4 frame in each */
-static uint8_t rx_buf_0[RX_BUF_SIZE] CC_ALIGN(4);
-static uint8_t rx_buf_1[RX_BUF_SIZE] CC_ALIGN(4);
-static uint8_t rx_buf_2[RX_BUF_SIZE] CC_ALIGN(4);
-static uint8_t rx_buf_3[RX_BUF_SIZE] CC_ALIGN(4);
+/* Receive buffer entries with room for 1 IEEE802.15.4 frame in each */
+static uint8_t rx_buf[IEEE_MODE_RX_BUF_CNT][RX_BUF_SIZE] CC_ALIGN(4);
 
 /* The RX Data Queue */
 static dataQueue_t rx_data_queue = { 0 };
@@ -500,26 +527,14 @@ static void
 init_rx_buffers(void)
 {
   rfc_dataEntry_t *entry;
+  int i;
 
-  entry = (rfc_dataEntry_t *)rx_buf_0;
-  entry->pNextEntry = rx_buf_1;
-  entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
-  entry->length = sizeof(rx_buf_0) - 8;
-
-  entry = (rfc_dataEntry_t *)rx_buf_1;
-  entry->pNextEntry = rx_buf_2;
-  entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
-  entry->length = sizeof(rx_buf_0) - 8;
-
-  entry = (rfc_dataEntry_t *)rx_buf_2;
-  entry->pNextEntry = rx_buf_3;
-  entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
-  entry->length = sizeof(rx_buf_0) - 8;
-
-  entry = (rfc_dataEntry_t *)rx_buf_3;
-  entry->pNextEntry = rx_buf_0;
-  entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
-  entry->length = sizeof(rx_buf_0) - 8;
+  for(i = 0; i < IEEE_MODE_RX_BUF_CNT; i++) {
+    entry = (rfc_dataEntry_t *)rx_buf[i];
+    entry->pNextEntry = rx_buf[(i + 1) % IEEE_MODE_RX_BUF_CNT];
+    entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
+    entry->length = RX_BUF_SIZE - 8;
+  }
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -720,18 +735,15 @@ init(void)
   rf_core_set_modesel();
 
   /* Initialise RX buffers */
-  memset(rx_buf_0, 0, RX_BUF_SIZE);
-  memset(rx_buf_1, 0, RX_BUF_SIZE);
-  memset(rx_buf_2, 0, RX_BUF_SIZE);
-  memset(rx_buf_3, 0, RX_BUF_SIZE);
+  memset(rx_buf, 0, sizeof(rx_buf));
 
   /* Set of RF Core data queue. Circular buffer, no last entry */
-  rx_data_queue.pCurrEntry = rx_buf_0;
+  rx_data_queue.pCurrEntry = rx_buf[0];
 
   rx_data_queue.pLastEntry = NULL;
 
   /* Initialize current read pointer to first element (used in ISR) */
-  rx_read_entry = rx_buf_0;
+  rx_read_entry = rx_buf[0];
 
   /* Populate the RF parameters data structure with default values */
   init_rf_params();
@@ -758,16 +770,87 @@ prepare(const void *payload, unsigned short payload_len)
   return RF_CORE_CMD_OK;
 }
 /*---------------------------------------------------------------------------*/
+#if IEEE_MODE_TX_CHAIN
+static uint8_t
+op_running(volatile void *op)
+{
+  uint16_t status = ((volatile rfc_radioOp_t *)op)->status;
+
+  return status != RF_CORE_RADIO_OP_STATUS_SKIPPED &&
+    (status & RF_CORE_RADIO_OP_MASKED_STATUS)
+    == RF_CORE_RADIO_OP_MASKED_STATUS_RUNNING;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * The chain has ended when the CSMA-CA stopped it, or when its last
+ * operation is done. Operations that the chain does not reach keep
+ * their IDLE status, which is also "running" in the masked status, so
+ * each one is only looked at once the previous one has let it run.
+ */
+static uint8_t
+tx_chain_running(volatile rfc_CMD_IEEE_CSMA_t *csma,
+                 volatile rfc_CMD_IEEE_TX_t *tx,
+                 volatile rfc_CMD_IEEE_RX_ACK_t *rx_ack)
+{
+  if(op_running(csma)) {
+    return 1;
+  }
+  if(csma->status != RF_CORE_RADIO_OP_STATUS_IEEE_DONE_OK) {
+    return 0;
+  }
+  if(op_running(tx)) {
+    return 1;
+  }
+  if(rx_ack == NULL || tx->status != RF_CORE_RADIO_OP_STATUS_IEEE_DONE_OK) {
+    return 0;
+  }
+  return op_running(rx_ack);
+}
+/*---------------------------------------------------------------------------*/
+static int
+tx_chain_result(volatile rfc_CMD_IEEE_CSMA_t *csma,
+                volatile rfc_CMD_IEEE_TX_t *tx,
+                volatile rfc_CMD_IEEE_RX_ACK_t *rx_ack)
+{
+  if(csma->status == RF_CORE_RADIO_OP_STATUS_IEEE_DONE_BUSY) {
+    PRINTF("transmit: CSMA-CA found the channel busy\n");
+    return RADIO_TX_COLLISION;
+  }
+  if(csma->status != RF_CORE_RADIO_OP_STATUS_IEEE_DONE_OK ||
+     tx->status != RF_CORE_RADIO_OP_STATUS_IEEE_DONE_OK) {
+    PRINTF("transmit: CSMA status=0x%04x, TX status=0x%04x\n",
+           csma->status, tx->status);
+    return RADIO_TX_ERR;
+  }
+  if(rx_ack == NULL) {
+    return RADIO_TX_OK;
+  }
+  if(rx_ack->status == RF_CORE_RADIO_OP_STATUS_IEEE_DONE_ACK ||
+     rx_ack->status == RF_CORE_RADIO_OP_STATUS_IEEE_DONE_ACKPEND) {
+    return RADIO_TX_OK;
+  }
+  PRINTF("transmit: no ACK, status=0x%04x\n", rx_ack->status);
+  return RADIO_TX_NOACK;
+}
+#endif /* IEEE_MODE_TX_CHAIN */
+/*---------------------------------------------------------------------------*/
 static int
 transmit(unsigned short transmit_len)
 {
   int ret;
   uint8_t was_off = 0;
   uint32_t cmd_status;
+#if !IEEE_MODE_TX_CHAIN
   uint16_t stat;
+#endif /* !IEEE_MODE_TX_CHAIN */
   uint8_t tx_active = 0;
   rtimer_clock_t t0;
   volatile rfc_CMD_IEEE_TX_t cmd;
+#if IEEE_MODE_TX_CHAIN
+  volatile rfc_CMD_IEEE_CSMA_t cmd_csma;
+  volatile rfc_CMD_IEEE_RX_ACK_t cmd_rx_ack;
+  uint8_t ack_req;
+#endif /* IEEE_MODE_TX_CHAIN */
 
   if(!rf_is_on()) {
     was_off = 1;
@@ -805,16 +888,58 @@ transmit(unsigned short transmit_len)
   cmd.payloadLen = transmit_len;
   cmd.pPayload = &tx_buf[TX_BUF_HDR_LEN];
 
+#if IEEE_MODE_TX_CHAIN
+  /* CSMA-CA first, and TX only if it found the channel idle */
+  rf_core_init_radio_op((rfc_radioOp_t *)&cmd_csma, sizeof(cmd_csma),
+                        CMD_IEEE_CSMA);
+  cmd_csma.pNextOp = (rfc_radioOp_t *)&cmd;
+  cmd_csma.condition.rule = COND_STOP_ON_FALSE;
+  cmd_csma.randomState = random_rand();
+  cmd_csma.macMaxBE = TX_CHAIN_MAC_MAX_BE;
+  cmd_csma.macMaxCSMABackoffs = TX_CHAIN_MAC_MAX_CSMA_BACKOFFS;
+  cmd_csma.csmaConfig.initCW = 1;
+  cmd_csma.NB = 0;
+  cmd_csma.BE = TX_CHAIN_MAC_MIN_BE;
+  cmd_csma.endTrigger.triggerType = TRIG_NEVER;
+
+  /* Then wait for the ACK if the frame requests one */
+  ack_req = transmit_len >= 3 && (tx_buf[TX_BUF_HDR_LEN] & 0x20);
+  if(ack_req) {
+    rf_core_init_radio_op((rfc_radioOp_t *)&cmd_rx_ack, sizeof(cmd_rx_ack),
+                          CMD_IEEE_RX_ACK);
+    cmd_rx_ack.seqNo = tx_buf[TX_BUF_HDR_LEN + 2];
+    cmd_rx_ack.endTrigger.triggerType = TRIG_REL_START;
+    cmd_rx_ack.endTime = TX_CHAIN_ACK_WAIT_RAT;
+    cmd.pNextOp = (rfc_radioOp_t *)&cmd_rx_ack;
+    cmd.condition.rule = COND_STOP_ON_FALSE;
+  }
+#endif /* IEEE_MODE_TX_CHAIN */
+
   /* Enable the LAST_FG_COMMAND_DONE interrupt, which will wake us up */
   rf_core_cmd_done_en(true);
 
+#if IEEE_MODE_TX_CHAIN
+  ret = rf_core_send_cmd((uint32_t)&cmd_csma, &cmd_status);
+#else /* IEEE_MODE_TX_CHAIN */
   ret = rf_core_send_cmd((uint32_t)&cmd, &cmd_status);
+#endif /* IEEE_MODE_TX_CHAIN */
 
   if(ret) {
     /* If we enter here, TX actually started */
     ENERGEST_OFF(ENERGEST_TYPE_LISTEN);
     ENERGEST_ON(ENERGEST_TYPE_TRANSMIT);
 
+#if IEEE_MODE_TX_CHAIN
+    /* Idle away while the chain is running */
+    while(tx_chain_running(&cmd_csma, &cmd, ack_req ? &cmd_rx_ack : NULL)) {
+      lpm_sleep();
+    }
+
+    ret = tx_chain_result(&cmd_csma, &cmd, ack_req ? &cmd_rx_ack : NULL);
+    if(ret == RADIO_TX_OK || ret == RADIO_TX_NOACK) {
+      RIMESTATS_ADD(lltx);
+    }
+#else /* IEEE_MODE_TX_CHAIN */
     /* Idle away while the command is running */
     while((cmd.status & RF_CORE_RADIO_OP_MASKED_STATUS)
           == RF_CORE_RADIO_OP_MASKED_STATUS_RUNNING) {
@@ -833,6 +958,7 @@ transmit(unsigned short transmit_len)
              cmd_status, stat);
       ret = RADIO_TX_ERR;
     }
+#endif /* IEEE_MODE_TX_CHAIN */
   } else {
     /* Failure sending the CMD_IEEE_TX command */
     PRINTF("transmit: ret=%d, CMDSTA=0x%08lx, status=0x%04x\n",
@@ -1096,6 +1222,8 @@ on(void)
 static int
 off(void)
 {
+  int i;
+
   /*
    * If we are in the middle of a BLE operation, we got called by ContikiMAC
    * from within an interrupt context. Abort, but pretend everything is OK.
@@ -1123,10 +1251,9 @@ off(void)
    * Just in case there was an ongoing RX (which started after we begun the
    * shutdown sequence), we don't want to leave the buffer in state == ongoing
    */
-  ((rfc_dataEntry_t *)rx_buf_0)->status = DATA_ENTRY_STATUS_PENDING;
-  ((rfc_dataEntry_t *)rx_buf_1)->status = DATA_ENTRY_STATUS_PENDING;
-  ((rfc_dataEntry_t *)rx_buf_2)->status = DATA_ENTRY_STATUS_PENDING;
-  ((rfc_dataEntry_t *)rx_buf_3)->status = DATA_ENTRY_STATUS_PENDING;
+  for(i = 0; i < IEEE_MODE_RX_BUF_CNT; i++) {
+    ((rfc_dataEntry_t *)rx_buf[i])->status = DATA_ENTRY_STATUS_PENDING;
+  }
 
   return RF_CORE_CMD_OK;
 }
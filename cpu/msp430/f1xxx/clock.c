@@ -33,6 +33,7 @@
 #include "sys/energest.h"
 #include "sys/clock.h"
 #include "sys/etimer.h"
+#include "sys/tickless.h"
 #include "rtimer-arch.h"
 #include "dev/watchdog.h"
 #include "isr_compat.h"
@@ -48,6 +49,14 @@ static volatile unsigned long seconds;
 static volatile clock_time_t count = 0;
 /* last_tar is used for calculating clock_fine */
 static volatile uint16_t last_tar = 0;
+#if TICKLESS_ON
+/* The timer value at which count was last incremented. */
+static volatile uint16_t count_tar = 0;
+
+/* The longest sleep, in clock ticks, that keeps the timer value less
+   than half of its range from count_tar. */
+#define MAX_SKIP_TICKS (0x7fff / INTERVAL)
+#endif /* TICKLESS_ON */
 /*---------------------------------------------------------------------------*/
 static inline uint16_t
 read_tar(void)
@@ -74,6 +83,23 @@ ISR(TIMERA1, timera1)
     while(TACTL & MC1 && TACCR1 - read_tar() == 1);
 
     last_tar = read_tar();
+#if TICKLESS_ON
+    /* Count all ticks that have passed. There is more than one if
+       ticks were skipped while the CPU was sleeping. */
+    do {
+      while((uint16_t)(last_tar - count_tar) >= INTERVAL) {
+        count_tar += INTERVAL;
+        ++count;
+        if(count % CLOCK_CONF_SECOND == 0) {
+          ++seconds;
+          energest_flush();
+        }
+      }
+      /* Make sure interrupt time is future */
+      TACCR1 = count_tar + INTERVAL;
+      last_tar = read_tar();
+    } while(!CLOCK_LT(last_tar, TACCR1));
+#else /* TICKLESS_ON */
     /* Make sure interrupt time is future */
     while(!CLOCK_LT(last_tar, TACCR1)) {
       TACCR1 += INTERVAL;
@@ -93,12 +119,20 @@ ISR(TIMERA1, timera1)
       }
       last_tar = read_tar();
     }
+#endif /* TICKLESS_ON */
 
     if(etimer_pending() &&
        (etimer_next_expiration_time() - count - 1) > MAX_TICKS) {
       etimer_request_poll();
       LPM4_EXIT;
     }
+#if TICKLESS_ON
+    else {
+      /* Nothing to do yet: sleep through the ticks until the next
+         etimer expires. This does nothing if events are pending. */
+      tickless_sleep_prepare();
+    }
+#endif /* TICKLESS_ON */
 
   }
   /*  if(process_nevents() >= 0) {
@@ -113,13 +147,44 @@ ISR(TIMERA1, timera1)
 clock_time_t
 clock_time(void)
 {
+#if TICKLESS_ON
+  clock_time_t t;
+  int s;
+
+  /* Ticks that have been skipped have not been added to count yet. */
+  s = splhigh();
+  t = count + (uint16_t)(read_tar() - count_tar) / INTERVAL;
+  splx(s);
+  return t;
+#else /* TICKLESS_ON */
   clock_time_t t1, t2;
   do {
     t1 = count;
     t2 = count;
   } while(t1 != t2);
   return t1;
+#endif /* TICKLESS_ON */
+}
+/*---------------------------------------------------------------------------*/
+#if TICKLESS_ON
+void
+tickless_arch_set_wakeup(clock_time_t ticks)
+{
+  uint16_t t;
+
+  if(ticks == 0 || ticks > MAX_SKIP_TICKS) {
+    ticks = MAX_SKIP_TICKS;
+  }
+  t = count_tar + ticks * INTERVAL;
+
+  /* The compare value must be in the future, otherwise the interrupt
+     would only fire when the timer has wrapped. If it is too close,
+     keep the compare value for the next tick. */
+  if(CLOCK_LT(read_tar() + 2, t)) {
+    TACCR1 = t;
+  }
 }
+#endif /* TICKLESS_ON */
 /*---------------------------------------------------------------------------*/
 void
 clock_set(clock_time_t clock, clock_time_t fclock)
@@ -127,6 +192,9 @@ clock_set(clock_time_t clock, clock_time_t fclock)
   TAR = fclock;
   TACCR1 = fclock + INTERVAL;
   count = clock;
+#if TICKLESS_ON
+  count_tar = fclock;
+#endif /* TICKLESS_ON */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -178,6 +246,9 @@ clock_init(void)
   TACTL |= MC1;
 
   count = 0;
+#if TICKLESS_ON
+  count_tar = 0;
+#endif /* TICKLESS_ON */
 
   /* Enable interrupts. */
   eint();
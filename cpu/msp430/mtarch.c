@@ -32,11 +32,33 @@
 
 #include <stdio.h>
 #include "sys/mt.h"
+#include "dev/watchdog.h"
 
 #ifdef __IAR_SYSTEMS_ICC__
 #define __asm__ asm
 #endif
 
+/*
+ * sw() is a function call, so only the registers that a called
+ * function must preserve are saved on a switch: r4-r10 with GCC and
+ * r4-r11 with IAR. The other registers are already clobbered by the
+ * call.
+ */
+#ifdef __IAR_SYSTEMS_ICC__
+#define SAVED_REGISTERS 8
+#else
+#define SAVED_REGISTERS 7
+#endif
+
+/* Check the bottom of the thread stack each time a thread yields. */
+#ifdef MTARCH_CONF_STACK_CHECK
+#define MTARCH_STACK_CHECK MTARCH_CONF_STACK_CHECK
+#else
+#define MTARCH_STACK_CHECK 0
+#endif
+
+#define STACK_GUARD 4
+
 static unsigned short *sptmp;
 static struct mtarch_thread *running;
 
@@ -73,7 +95,7 @@ mtarch_start(struct mtarch_thread *t,
   --t->sp;
 
   /* Space for registers. */
-  t->sp -= 11;
+  t->sp -= SAVED_REGISTERS - 1;
 
   /* Store function and argument (used in mtarch_wrapper) */
   t->data = data;
@@ -94,11 +116,9 @@ sw(void)
   __asm__("push r8");
   __asm__("push r9");
   __asm__("push r10");
+#ifdef __IAR_SYSTEMS_ICC__
   __asm__("push r11");
-  __asm__("push r12");
-  __asm__("push r13");
-  __asm__("push r14");
-  __asm__("push r15");
+#endif
 
 #ifdef __IAR_SYSTEMS_ICC__
 /*  use IAR intrinsic functions */
@@ -109,11 +129,9 @@ sw(void)
   __asm__("mov.w %0,r1" : : "m" (sptmp));
 #endif
 
-  __asm__("pop r15");
-  __asm__("pop r14");
-  __asm__("pop r13");
-  __asm__("pop r12");
+#ifdef __IAR_SYSTEMS_ICC__
   __asm__("pop r11");
+#endif
   __asm__("pop r10");
   __asm__("pop r9");
   __asm__("pop r8");
@@ -129,6 +147,19 @@ mtarch_exec(struct mtarch_thread *t)
   running = t;
   sw();
   running = NULL;
+
+#if MTARCH_STACK_CHECK
+  {
+    int i;
+    /* The stack was filled with its word index by mtarch_start(). */
+    for(i = 0; i < STACK_GUARD; ++i) {
+      if(t->stack[i] != (unsigned short)i) {
+        printf("mtarch: stack overflow in thread %p\n", t);
+        watchdog_reboot();
+      }
+    }
+  }
+#endif /* MTARCH_STACK_CHECK */
 }
 /*--------------------------------------------------------------------------*/
 void
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Sampling profiler timer for the MSP430, on Timer B CCR0. Timer B
+ *         runs from ACLK in continuous mode, as set up by the radio SFD
+ *         capture code, which uses the other compare registers.
+ */
+
+#include "contiki.h"
+#include "sys/profiler.h"
+
+#if defined(__GNUC__) && defined(__MSP430__) && defined(TIMERB0_VECTOR)
+
+#define ACLK_HZ 32768UL
+
+static unsigned short interval;
+/* The interrupted PC, saved by the interrupt entry */
+volatile unsigned short profiler_arch_pc;
+
+void profiler_arch_sample(void) __attribute__((used));
+/*---------------------------------------------------------------------------*/
+void
+profiler_arch_start(unsigned rate)
+{
+  interval = rate >= ACLK_HZ ? 1 : ACLK_HZ / rate;
+
+  dint();
+  if((TBCTL & (MC1 | MC0)) == 0) {
+    TBCTL = TBSSEL_1 | TBCLR;
+    TBCTL |= MC1;
+  }
+  TBCCR0 = TBR + interval;
+  TBCCTL0 = CCIE;
+  eint();
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_arch_stop(void)
+{
+  TBCCTL0 = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_arch_sample(void)
+{
+  TBCCR0 += interval;
+  profiler_sample((void *)profiler_arch_pc);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * On interrupt entry, the PC is on the stack above the SR. It is saved
+ * before anything else is pushed. The registers that a called function
+ * may change are r12-r15 with mspgcc and r11-r15 with the TI GCC, so
+ * r11-r15 are saved around the call, which takes no arguments.
+ */
+void __attribute__((interrupt(TIMERB0_VECTOR), naked))
+profiler_timerb0(void)
+{
+  asm volatile ("mov 2(r1), &profiler_arch_pc\n\t"
+                "push r15\n\t"
+                "push r14\n\t"
+                "push r13\n\t"
+                "push r12\n\t"
+                "push r11\n\t"
+                "call #profiler_arch_sample\n\t"
+                "pop r11\n\t"
+                "pop r12\n\t"
+                "pop r13\n\t"
+                "pop r14\n\t"
+                "pop r15\n\t"
+                "reti\n\t");
+}
+/*---------------------------------------------------------------------------*/
+#else /* defined(__GNUC__) && defined(__MSP430__) && defined(TIMERB0_VECTOR) */
+/* Sampling needs a GCC naked interrupt handler and Timer B */
+void
+profiler_arch_start(unsigned rate)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_arch_stop(void)
+{
+}
+#endif /* defined(__GNUC__) && defined(__MSP430__) && defined(TIMERB0_VECTOR) */
+/*---------------------------------------------------------------------------*/
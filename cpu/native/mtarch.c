@@ -38,6 +38,30 @@
 #define MTARCH_STACKSIZE 4096
 #endif /* MTARCH_STACKSIZE */
 
+/*
+ * On x86-64 Linux, threads are switched by a few lines of assembly
+ * that only save the registers that the ABI requires a function call
+ * to preserve. swapcontext() saves all registers and makes a system
+ * call for the signal mask on every switch.
+ */
+#ifdef MTARCH_CONF_ASM_SWITCH
+#define MTARCH_ASM_SWITCH MTARCH_CONF_ASM_SWITCH
+#elif defined(__x86_64__) && defined(__linux)
+#define MTARCH_ASM_SWITCH 1
+#else
+#define MTARCH_ASM_SWITCH 0
+#endif
+
+/* Check the bottom of the thread stack each time a thread yields. */
+#ifdef MTARCH_CONF_STACK_CHECK
+#define MTARCH_STACK_CHECK MTARCH_CONF_STACK_CHECK
+#else
+#define MTARCH_STACK_CHECK 0
+#endif
+
+#define STACK_FILL  0xa5
+#define STACK_GUARD 16
+
 #if defined(_WIN32) || defined(__CYGWIN__)
 
 #define WIN32_LEAN_AND_MEAN
@@ -45,6 +69,76 @@
 
 static void *main_fiber;
 
+#elif MTARCH_ASM_SWITCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+struct mtarch_t {
+  char stack[MTARCH_STACKSIZE] __attribute__((aligned(16)));
+  void *sp;
+};
+
+static void *main_sp;
+static struct mtarch_t *running;
+
+/*
+ * Saves the callee-saved registers and the MXCSR and x87 control
+ * words on the current stack, stores the stack pointer in *save_sp,
+ * and restores the same from new_sp.
+ */
+void mtarch_switch(void **save_sp, void *new_sp);
+
+/*
+ * A new thread starts here, with the thread function in r13, its
+ * argument in r12 and mt_exit() in r14.
+ */
+void mtarch_trampoline(void);
+
+__asm__(
+  ".text\n"
+  ".p2align 4\n"
+  ".type mtarch_switch, @function\n"
+  ".hidden mtarch_switch\n"
+  ".globl mtarch_switch\n"
+  "mtarch_switch:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  subq $8, %rsp\n"
+  "  stmxcsr (%rsp)\n"
+  "  fnstcw 4(%rsp)\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq %rsi, %rsp\n"
+  "  ldmxcsr (%rsp)\n"
+  "  fldcw 4(%rsp)\n"
+  "  addq $8, %rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  ".size mtarch_switch, .-mtarch_switch\n"
+  ".p2align 4\n"
+  ".type mtarch_trampoline, @function\n"
+  ".hidden mtarch_trampoline\n"
+  ".globl mtarch_trampoline\n"
+  "mtarch_trampoline:\n"
+  "  movq %r12, %rdi\n"
+  "  callq *%r13\n"
+  "1:\n"
+  "  callq *%r14\n"
+  "  jmp 1b\n"
+  ".size mtarch_trampoline, .-mtarch_trampoline\n"
+);
+
 #elif defined(__linux) || defined(__APPLE__)
 
 #ifdef __APPLE__
@@ -52,7 +146,9 @@ static void *main_fiber;
 #define _XOPEN_SOURCE
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <signal.h>
 #include <ucontext.h>
 
@@ -66,6 +162,21 @@ static ucontext_t *running_context;
 
 #endif /* _WIN32 || __CYGWIN__ || __linux */
 
+/*--------------------------------------------------------------------------*/
+#if MTARCH_STACK_CHECK && !(defined(_WIN32) || defined(__CYGWIN__))
+static void
+check_stack(struct mtarch_t *t)
+{
+  int i;
+
+  for(i = 0; i < STACK_GUARD; i++) {
+    if((unsigned char)t->stack[i] != STACK_FILL) {
+      fprintf(stderr, "mtarch: stack overflow in thread %p\n", (void *)t);
+      abort();
+    }
+  }
+}
+#endif /* MTARCH_STACK_CHECK */
 /*--------------------------------------------------------------------------*/
 void
 mtarch_init(void)
@@ -96,10 +207,38 @@ mtarch_start(struct mtarch_thread *thread,
 
   thread->mt_thread = CreateFiber(0, (LPFIBER_START_ROUTINE)function, data);
 
+#elif MTARCH_ASM_SWITCH
+
+  struct mtarch_t *t;
+  uint64_t *sp;
+
+  t = malloc(sizeof(struct mtarch_t));
+  thread->mt_thread = t;
+
+  /* Fill the stack so that the stack usage can be measured. */
+  memset(t->stack, STACK_FILL, sizeof(t->stack));
+
+  /* The initial frame is popped by mtarch_switch(). The stack is
+     16-byte aligned when mtarch_trampoline() calls the function. */
+  sp = (uint64_t *)((uintptr_t)(t->stack + sizeof(t->stack)) & ~(uintptr_t)15);
+  *--sp = (uint64_t)(uintptr_t)mtarch_trampoline;
+  *--sp = 0;                              /* rbp */
+  *--sp = 0;                              /* rbx */
+  *--sp = (uint64_t)(uintptr_t)data;      /* r12 */
+  *--sp = (uint64_t)(uintptr_t)function;  /* r13 */
+  *--sp = (uint64_t)(uintptr_t)mt_exit;   /* r14 */
+  *--sp = 0;                              /* r15 */
+  /* Default MXCSR and x87 control word */
+  *--sp = 0x1f80 | ((uint64_t)0x037f << 32);
+  t->sp = sp;
+
 #elif defined(__linux)
 
   thread->mt_thread = malloc(sizeof(struct mtarch_t));
 
+  memset(((struct mtarch_t *)thread->mt_thread)->stack, STACK_FILL,
+         sizeof(((struct mtarch_t *)thread->mt_thread)->stack));
+
   getcontext(&((struct mtarch_t *)thread->mt_thread)->context);
 
   ((struct mtarch_t *)thread->mt_thread)->context.uc_link = NULL;
@@ -136,6 +275,10 @@ mtarch_yield(void)
 
   SwitchToFiber(main_fiber);
 
+#elif MTARCH_ASM_SWITCH
+
+  mtarch_switch(&running->sp, main_sp);
+
 #elif defined(__linux)
 
   swapcontext(running_context, &main_context);
@@ -150,11 +293,23 @@ mtarch_exec(struct mtarch_thread *thread)
 
   SwitchToFiber(thread->mt_thread);
 
+#elif MTARCH_ASM_SWITCH
+
+  running = thread->mt_thread;
+  mtarch_switch(&main_sp, running->sp);
+  running = NULL;
+#if MTARCH_STACK_CHECK
+  check_stack(thread->mt_thread);
+#endif /* MTARCH_STACK_CHECK */
+
 #elif defined(__linux)
 
   running_context = &((struct mtarch_t *)thread->mt_thread)->context;
   swapcontext(&main_context, running_context);
   running_context = NULL;
+#if MTARCH_STACK_CHECK
+  check_stack(thread->mt_thread);
+#endif /* MTARCH_STACK_CHECK */
 
 #endif /* _WIN32 || __CYGWIN__ || __linux */
 }
@@ -166,7 +321,7 @@ mtarch_stop(struct mtarch_thread *thread)
 
   DeleteFiber(thread->mt_thread);
 
-#elif defined(linux) || defined(__linux)
+#elif MTARCH_ASM_SWITCH || defined(linux) || defined(__linux)
 
   free(thread->mt_thread);
 
@@ -183,3 +338,30 @@ mtarch_pstop(void)
 {
 }
 /*--------------------------------------------------------------------------*/
+int
+mtarch_stack_usage(struct mt_thread *t)
+{
+#if defined(_WIN32) || defined(__CYGWIN__)
+
+  return -1;
+
+#elif MTARCH_ASM_SWITCH || defined(__linux)
+
+  struct mtarch_t *m = t->thread.mt_thread;
+  int i;
+
+  for(i = 0; i < MTARCH_STACKSIZE; ++i) {
+    if((unsigned char)m->stack[i] != STACK_FILL) {
+      return MTARCH_STACKSIZE - i;
+    }
+  }
+
+  return 0;
+
+#else
+
+  return -1;
+
+#endif /* _WIN32 || __CYGWIN__ || __linux */
+}
+/*--------------------------------------------------------------------------*/
@@ -39,4 +39,10 @@ struct mtarch_thread {
   void *mt_thread;
 };
 
+struct mt_thread;
+
+/* Returns the number of stack bytes that a thread has used so far,
+   or -1 if that is not known. */
+int mtarch_stack_usage(struct mt_thread *t);
+
 #endif /* MTARCH_H_ */
@@ -33,6 +33,11 @@
  *
  */
 
+#ifdef linux
+/* For recvmmsg() */
+#define _GNU_SOURCE
+#endif
+
 #include "contiki.h"
 #include "contiki-conf.h"
 
@@ -51,10 +56,13 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
+#include <errno.h>
 #include <netinet/if_ether.h>
 #include <netpacket/packet.h>
 #include <net/if.h>
 #include <linux/sockios.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
 
 #define DEBUG 0
 #if DEBUG
@@ -64,17 +72,36 @@
 #define PRINTF(...)
 #endif
 
+/* Frames read from the socket per wakeup, with one recvmmsg() */
+#ifdef LINUXRADIO_CONF_READ_BATCH
+#define READ_BATCH LINUXRADIO_CONF_READ_BATCH
+#else
+#define READ_BATCH 8
+#endif
+
 static int sockfd = -1;
 static char *sockbuf;
 static int buflen;
+static char interface[IFNAMSIZ] = NETSTACK_CONF_LINUXRADIO_DEV;
+static rtimer_clock_t last_timestamp;
+static struct timespec last_hw_timestamp;
 
 #define MAX_PACKET_SIZE 256
 
+static struct {
+  struct mmsghdr msgs[READ_BATCH];
+  struct iovec iovs[READ_BATCH];
+  struct sockaddr_ll from[READ_BATCH];
+  uint8_t frames[READ_BATCH][MAX_PACKET_SIZE];
+  uint8_t control[READ_BATCH][CMSG_SPACE(sizeof(struct scm_timestamping))];
+} *rx;
+
 static int
 init(void)
 {
   sockbuf = malloc(MAX_PACKET_SIZE);
-  if(sockbuf == 0) {
+  rx = malloc(sizeof(*rx));
+  if(sockbuf == 0 || rx == NULL) {
     return 1;
   }
   return 0;
@@ -141,14 +168,71 @@ set_fd(fd_set *rset, fd_set *wset)
   FD_SET(sockfd, rset);
   return 1;
 }
+/* Take the kernel's timestamps of a received frame */
+static void
+read_timestamps(struct msghdr *msg)
+{
+  struct cmsghdr *cmsg;
+  struct scm_timestamping *ts;
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  last_hw_timestamp.tv_sec = last_hw_timestamp.tv_nsec = 0;
+  for(cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if(cmsg->cmsg_level == SOL_SOCKET &&
+       cmsg->cmsg_type == SCM_TIMESTAMPING) {
+      ts = (struct scm_timestamping *)CMSG_DATA(cmsg);
+      if(ts->ts[0].tv_sec != 0) {
+        /* The software stamp, on the clock of clock_time() */
+        now = ts->ts[0];
+      }
+      /* The raw stamp of the radio, if it has a clock of its own */
+      last_hw_timestamp = ts->ts[2];
+    }
+  }
+  last_timestamp = (rtimer_clock_t)(now.tv_sec * RTIMER_ARCH_SECOND +
+                                    now.tv_nsec / (1000000000 / RTIMER_ARCH_SECOND));
+}
 static void
 handle_fd(fd_set *rset, fd_set *wset)
 {
-  if(FD_ISSET(sockfd, rset)) {
-    int bytes = read(sockfd, sockbuf, MAX_PACKET_SIZE);
-    buflen = bytes;
-    memcpy(packetbuf_dataptr(), sockbuf, bytes);
-    packetbuf_set_datalen(bytes);
+  int i, n;
+
+  if(!FD_ISSET(sockfd, rset)) {
+    return;
+  }
+
+  for(i = 0; i < READ_BATCH; i++) {
+    rx->iovs[i].iov_base = rx->frames[i];
+    rx->iovs[i].iov_len = MAX_PACKET_SIZE;
+    memset(&rx->msgs[i].msg_hdr, 0, sizeof(rx->msgs[i].msg_hdr));
+    rx->msgs[i].msg_hdr.msg_name = &rx->from[i];
+    rx->msgs[i].msg_hdr.msg_namelen = sizeof(rx->from[i]);
+    rx->msgs[i].msg_hdr.msg_iov = &rx->iovs[i];
+    rx->msgs[i].msg_hdr.msg_iovlen = 1;
+    rx->msgs[i].msg_hdr.msg_control = rx->control[i];
+    rx->msgs[i].msg_hdr.msg_controllen = sizeof(rx->control[i]);
+  }
+
+  n = recvmmsg(sockfd, rx->msgs, READ_BATCH, MSG_DONTWAIT, NULL);
+  if(n < 0) {
+    if(errno != EAGAIN) {
+      perror("linuxradio recvmmsg()");
+    }
+    return;
+  }
+  PRINTF("linuxradio: %d frames\n", n);
+
+  for(i = 0; i < n; i++) {
+    if(rx->from[i].sll_pkttype == PACKET_OUTGOING) {
+      /* Our own frame, looped back by the packet socket */
+      continue;
+    }
+    read_timestamps(&rx->msgs[i].msg_hdr);
+    packetbuf_clear();
+    memcpy(packetbuf_dataptr(), rx->frames[i], rx->msgs[i].msg_len);
+    packetbuf_set_datalen(rx->msgs[i].msg_len);
+    packetbuf_set_attr(PACKETBUF_ATTR_TIMESTAMP, (uint16_t)last_timestamp);
     NETSTACK_RDC.input();
   }
 }
@@ -160,17 +244,25 @@ on(void)
 {
   struct ifreq ifr;
   int err;
+  int opt;
   struct sockaddr_ll sll;
 
+  if(sockfd >= 0) {
+    return 1;
+  }
+
   sockfd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_IEEE802154));
   if(sockfd < 0) {
     perror("linuxradio socket()");
     return 0;
   } else {
-    strncpy((char *)ifr.ifr_name, NETSTACK_CONF_LINUXRADIO_DEV, IFNAMSIZ);
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy((char *)ifr.ifr_name, interface, IFNAMSIZ - 1);
     err = ioctl(sockfd, SIOCGIFINDEX, &ifr);
     if(err == -1) {
       perror("linuxradio ioctl()");
+      close(sockfd);
+      sockfd = -1;
       return 0;
     }
     sll.sll_family = AF_PACKET;
@@ -179,9 +271,23 @@ on(void)
 
     if(bind(sockfd, (struct sockaddr *)&sll, sizeof(sll)) < 0) {
       perror("linuxradio bind()");
+      close(sockfd);
+      sockfd = -1;
       return 0;
     }
 
+#ifdef PACKET_IGNORE_OUTGOING
+    /* Keep the kernel from copying our own frames back to us at all */
+    opt = 1;
+    setsockopt(sockfd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &opt, sizeof(opt));
+#endif
+    /* Hardware stamps where the radio has them, software ones otherwise */
+    opt = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+      SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if(setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &opt, sizeof(opt)) < 0) {
+      PRINTF("linuxradio: no timestamps\n");
+    }
+
     select_set_callback(sockfd, &linuxradio_sock_callback);
     return 1;
   }
@@ -189,10 +295,99 @@ on(void)
 static int
 off(void)
 {
-  close(sockfd);
+  if(sockfd >= 0) {
+    select_set_callback(sockfd, NULL);
+    close(sockfd);
+  }
   sockfd = -1;
   return 1;
 }
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  if(!value) {
+    return RADIO_RESULT_INVALID_VALUE;
+  }
+  if(param == RADIO_PARAM_POWER_MODE) {
+    *value = sockfd >= 0 ? RADIO_POWER_MODE_ON : RADIO_POWER_MODE_OFF;
+    return RADIO_RESULT_OK;
+  }
+  /* Channel, PAN and the like are set up on the interface (iwpan) */
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  if(param == RADIO_PARAM_POWER_MODE) {
+    if(value == RADIO_POWER_MODE_ON) {
+      return on() ? RADIO_RESULT_OK : RADIO_RESULT_ERROR;
+    }
+    off();
+    return RADIO_RESULT_OK;
+  }
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  struct ifreq ifr;
+  int fd;
+
+  if(param == RADIO_PARAM_64BIT_ADDR) {
+    if(size != 8 || !dest) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    /* The interface keeps its extended address in network byte order */
+    fd = sockfd >= 0 ? sockfd : socket(PF_PACKET, SOCK_RAW, 0);
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy((char *)ifr.ifr_name, interface, IFNAMSIZ - 1);
+    if(fd < 0 || ioctl(fd, SIOCGIFHWADDR, &ifr) == -1) {
+      if(fd >= 0 && fd != sockfd) {
+        close(fd);
+      }
+      return RADIO_RESULT_ERROR;
+    }
+    if(fd != sockfd) {
+      close(fd);
+    }
+    memcpy(dest, ifr.ifr_hwaddr.sa_data, 8);
+    return RADIO_RESULT_OK;
+  }
+
+  if(param == RADIO_PARAM_LAST_PACKET_TIMESTAMP) {
+    if(size != sizeof(rtimer_clock_t) || !dest) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    *(rtimer_clock_t *)dest = last_timestamp;
+    return RADIO_RESULT_OK;
+  }
+
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+int
+linuxradio_set_interface(const char *name)
+{
+  int was_on = sockfd >= 0;
+
+  off();
+  memset(interface, 0, sizeof(interface));
+  strncpy(interface, name, sizeof(interface) - 1);
+  return was_on ? on() : 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+linuxradio_last_hw_timestamp(struct timespec *ts)
+{
+  *ts = last_hw_timestamp;
+  return ts->tv_sec != 0 || ts->tv_nsec != 0;
+}
+/*---------------------------------------------------------------------------*/
 const struct radio_driver linuxradio_driver =
 {
   init,
@@ -205,6 +400,10 @@ const struct radio_driver linuxradio_driver =
   pending_packet,
   on,
   off,
+  get_value,
+  set_value,
+  get_object,
+  set_object
 };
 
 #endif
@@ -38,6 +38,25 @@
 
 #include "dev/radio.h"
 
+#include <time.h>
+
 extern const struct radio_driver linuxradio_driver;
 
+/*
+ * The driver reads frames from a raw packet socket on a Linux 802.15.4
+ * (linux-wpan) interface, NETSTACK_CONF_LINUXRADIO_DEV unless set here.
+ * Channel, PAN id and short address belong to the interface and are set
+ * up with iwpan; RADIO_PARAM_64BIT_ADDR gives the interface address.
+ * Returns 0 if the radio was on and could not be opened again.
+ */
+int linuxradio_set_interface(const char *name);
+
+/*
+ * RADIO_PARAM_LAST_PACKET_TIMESTAMP is the kernel's receive time of the
+ * last frame, on the clock of clock_time(). Radios with a clock of their
+ * own may also stamp frames, on that clock: this gives the last such
+ * stamp, and returns 0 if there is none.
+ */
+int linuxradio_last_hw_timestamp(struct timespec *ts);
+
 #endif
@@ -45,6 +45,15 @@
 #define BUF ((struct uip_eth_hdr *)&uip_buf[0])
 #define IPBUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
 
+/* The number of frames read from the device per poll. The frames are
+   handled one at a time in uip_buf, without a process switch between
+   them. */
+#ifdef TAPDEV_CONF_BATCH
+#define TAPDEV_BATCH TAPDEV_CONF_BATCH
+#else
+#define TAPDEV_BATCH 1
+#endif
+
 PROCESS(tapdev_process, "TAP driver");
 
 /*---------------------------------------------------------------------------*/
@@ -59,10 +68,8 @@ tapdev_output(void)
 #endif
 /*---------------------------------------------------------------------------*/
 static void
-pollhandler(void)
+input(void)
 {
-  uip_len = tapdev_poll();
-
   if(uip_len > 0) {
 #if NETSTACK_CONF_WITH_IPV6
     if(BUF->type == uip_htons(UIP_ETHTYPE_IPV6)) {
@@ -88,6 +95,25 @@ pollhandler(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+pollhandler(void)
+{
+  int i;
+
+  for(i = 0; i < TAPDEV_BATCH; i++) {
+    uip_len = tapdev_poll();
+    if(uip_len == 0) {
+      return;
+    }
+    input();
+  }
+
+  /* More frames may be waiting: come back after the other processes. */
+  if(TAPDEV_BATCH > 1) {
+    process_poll(&tapdev_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(tapdev_process, ev, data)
 {
   PROCESS_POLLHANDLER(pollhandler());
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Sampling profiler timer for the native platform, which samples
+ *         on SIGPROF, that is, while the process uses CPU time
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* For REG_RIP and REG_EIP */
+#define _GNU_SOURCE
+#endif /* defined(__linux__) && !defined(_GNU_SOURCE) */
+
+#include "sys/profiler.h"
+
+#include <signal.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#include <ucontext.h>
+#endif /* !_WIN32 */
+#include <stddef.h>
+
+#ifndef _WIN32
+/*---------------------------------------------------------------------------*/
+static void
+interrupt_pc(int sig, siginfo_t *info, void *context)
+{
+  ucontext_t *uc = context;
+  void *pc = NULL;
+
+#if defined(__linux__) && defined(__x86_64__)
+  pc = (void *)uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__linux__) && defined(__i386__)
+  pc = (void *)uc->uc_mcontext.gregs[REG_EIP];
+#elif defined(__linux__) && defined(__aarch64__)
+  pc = (void *)uc->uc_mcontext.pc;
+#elif defined(__APPLE__) && defined(__x86_64__)
+  pc = (void *)uc->uc_mcontext->__ss.__rip;
+#else
+  (void)uc;
+#endif
+  profiler_sample(pc);
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_arch_start(unsigned rate)
+{
+  struct sigaction sa;
+  struct itimerval it;
+
+  sa.sa_sigaction = interrupt_pc;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigaction(SIGPROF, &sa, NULL);
+
+  it.it_interval.tv_sec = 0;
+  it.it_interval.tv_usec = rate >= 1000000 ? 1 : 1000000 / rate;
+  it.it_value = it.it_interval;
+  setitimer(ITIMER_PROF, &it, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_arch_stop(void)
+{
+  struct itimerval it;
+
+  it.it_interval.tv_sec = it.it_interval.tv_usec = 0;
+  it.it_value = it.it_interval;
+  setitimer(ITIMER_PROF, &it, NULL);
+}
+/*---------------------------------------------------------------------------*/
+#else /* _WIN32 */
+void
+profiler_arch_start(unsigned rate)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+profiler_arch_stop(void)
+{
+}
+#endif /* _WIN32 */
+/*---------------------------------------------------------------------------*/
@@ -156,6 +156,8 @@ static int cc2420_read(void *buf, unsigned short bufsize);
 static int cc2420_prepare(const void *data, unsigned short len);
 static int cc2420_transmit(unsigned short len);
 static int cc2420_send(const void *data, unsigned short len);
+static int cc2420_send_burst(const struct radio_frame *frames,
+                             unsigned short count, unsigned short *sent);
 
 static int cc2420_receiving_packet(void);
 static int pending_packet(void);
@@ -178,6 +180,8 @@ static int channel;
 static uint8_t volatile poll_mode = 0;
 /* Do we perform a CCA before sending? */
 static uint8_t send_on_cca = WITH_SEND_CCA;
+/* Set while sending the frames of a burst after the first one */
+static uint8_t burst_continuation;
 
 static radio_result_t
 get_value(radio_param_t param, radio_value_t *value)
@@ -315,6 +319,23 @@ set_value(radio_param_t param, radio_value_t value)
 static radio_result_t
 get_object(radio_param_t param, void *dest, size_t size)
 {
+  struct radio_capabilities *caps;
+
+  if(param == RADIO_CONST_CAPABILITIES) {
+    if(size != sizeof(struct radio_capabilities) || !dest) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    /* The delays depend on the MCU and SPI clock: they are left to the
+     * RADIO_DELAY_* of the platform */
+    caps = dest;
+    memset(caps, 0, sizeof(*caps));
+    caps->flags = RADIO_CAP_HW_ACK | RADIO_CAP_SEND_ON_CCA | RADIO_CAP_POLL_MODE;
+#if CC2420_CONF_SFD_TIMESTAMPS
+    caps->flags |= RADIO_CAP_SFD_TIMESTAMP;
+    caps->timestamp_precision_us = (1000000UL + RTIMER_SECOND - 1) / RTIMER_SECOND;
+#endif
+    return RADIO_RESULT_OK;
+  }
   if(param == RADIO_PARAM_LAST_PACKET_TIMESTAMP) {
 #if CC2420_CONF_SFD_TIMESTAMPS
     if(size != sizeof(rtimer_clock_t) || !dest) {
@@ -350,7 +371,8 @@ const struct radio_driver cc2420_driver =
     get_value,
     set_value,
     get_object,
-    set_object
+    set_object,
+    cc2420_send_burst
   };
 
 /*---------------------------------------------------------------------------*/
@@ -710,7 +732,8 @@ cc2420_transmit(unsigned short payload_len)
 #define LOOP_20_SYMBOLS CC2420_CONF_SYMBOL_LOOP_COUNT
 #endif
 
-  if(send_on_cca) {
+  /* Within a burst, we hold the channel since the first frame */
+  if(send_on_cca && !burst_continuation) {
     strobe(CC2420_SRXON);
     wait_for_status(BV(CC2420_RSSI_VALID));
     strobe(CC2420_STXONCCA);
@@ -814,6 +837,36 @@ cc2420_send(const void *payload, unsigned short payload_len)
   return cc2420_transmit(payload_len);
 }
 /*---------------------------------------------------------------------------*/
+static int
+cc2420_send_burst(const struct radio_frame *frames, unsigned short count,
+                  unsigned short *sent)
+{
+  int ret = RADIO_TX_OK;
+  uint8_t was_on = receive_on;
+
+  *sent = 0;
+
+  /* Stay on between the frames. cc2420_transmit() waits for the end of
+     each frame, so that the next one can be loaded in the TX FIFO */
+  if(!was_on) {
+    cc2420_on();
+  }
+  while(*sent < count && ret == RADIO_TX_OK) {
+    cc2420_prepare(frames[*sent].payload, frames[*sent].payload_len);
+    ret = cc2420_transmit(frames[*sent].payload_len);
+    if(ret == RADIO_TX_OK) {
+      (*sent)++;
+      burst_continuation = 1;
+    }
+  }
+  burst_continuation = 0;
+  if(!was_on) {
+    cc2420_off();
+  }
+
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
 int
 cc2420_off(void)
 {
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of the AES_128 driver of the platform. With the
+ *         software driver, compare the implementations selected with
+ *         AES_128_CONF_IMPL by building once for each. Blocks are
+ *         encrypted for about a second; where the platform defines
+ *         F_CPU, the result is also given in CPU cycles per block.
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "sys/rtimer.h"
+#include "dev/watchdog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Blocks between two reads of the rtimer, short enough for a 16-bit
+ * rtimer not to wrap */
+#define BATCH 8
+
+PROCESS(aes_benchmark_process, "AES-128 benchmark");
+AUTOSTART_PROCESSES(&aes_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *name, int with_set_key)
+{
+  static const uint8_t key[AES_128_KEY_LENGTH] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+  };
+  uint8_t block[AES_128_BLOCK_SIZE];
+  rtimer_clock_t start;
+  uint32_t ticks;
+  uint32_t blocks;
+  uint64_t per_second;
+  int i;
+
+  memset(block, 0, sizeof(block));
+  AES_128.set_key(key);
+  ticks = 0;
+  blocks = 0;
+  while(ticks < RTIMER_SECOND) {
+    start = RTIMER_NOW();
+    for(i = 0; i < BATCH; i++) {
+      if(with_set_key) {
+        AES_128.set_key(key);
+      }
+      AES_128.encrypt(block);
+    }
+    ticks += (rtimer_clock_t)(RTIMER_NOW() - start);
+    blocks += BATCH;
+    watchdog_periodic();
+  }
+
+  per_second = (uint64_t)blocks * RTIMER_SECOND / ticks;
+  printf("%s: %lu blocks in %lu ticks, %lu blocks/s",
+         name, (unsigned long)blocks, (unsigned long)ticks,
+         (unsigned long)per_second);
+#ifdef F_CPU
+  printf(", %lu cycles/block", (unsigned long)(F_CPU / per_second));
+#endif /* F_CPU */
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(aes_benchmark_process, ev, data)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+  static const uint8_t expected[AES_128_BLOCK_SIZE] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+    0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+  };
+  uint8_t key[AES_128_KEY_LENGTH];
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* FIPS-197, appendix C.1 */
+  for(i = 0; i < AES_128_BLOCK_SIZE; i++) {
+    key[i] = i;
+    block[i] = i * 0x11;
+  }
+  AES_128.set_key(key);
+  AES_128.encrypt(block);
+
+  printf("AES-128 benchmark, implementation %u, %lu ticks per second, %s\n",
+         AES_128_IMPL, (unsigned long)RTIMER_SECOND,
+         memcmp(block, expected, AES_128_BLOCK_SIZE) ? "MISMATCH" : "test vector ok");
+  run("encrypt", 0);
+  run("set_key + encrypt", 1);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of relation scans in Antelope. A relation of
+ *         ROWS tuples without indexes is created, and selections that
+ *         return all, few, and an aggregate of the tuples are timed.
+ *         Compare builds with different DB_SCAN_BUFFER_SIZE values.
+ */
+
+#include "contiki.h"
+#include "dev/watchdog.h"
+#include "lib/random.h"
+#include "antelope.h"
+
+#include <stdio.h>
+
+#ifdef SCAN_BENCHMARK_CONF_ROWS
+#define ROWS SCAN_BENCHMARK_CONF_ROWS
+#else /* SCAN_BENCHMARK_CONF_ROWS */
+#define ROWS 10000
+#endif /* SCAN_BENCHMARK_CONF_ROWS */
+
+static const char *queries[] = {
+  "SELECT id, reading FROM bench;",
+  "SELECT id, reading FROM bench WHERE reading < 10;",
+  "SELECT COUNT(id) FROM bench WHERE reading >= 500;",
+};
+
+static db_handle_t handle;
+
+PROCESS(scan_benchmark_process, "Antelope scan benchmark");
+AUTOSTART_PROCESSES(&scan_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static int
+load(void)
+{
+  long i;
+
+  db_query(NULL, "REMOVE RELATION bench;");
+  if(DB_ERROR(db_query(NULL, "CREATE RELATION bench;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE id DOMAIN LONG IN bench;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE reading DOMAIN INT IN bench;"))) {
+    return 0;
+  }
+
+  for(i = 0; i < ROWS; i++) {
+    watchdog_periodic();
+    if(DB_ERROR(db_query(NULL, "INSERT (%ld, %d) INTO bench;",
+                         i, (int)(random_rand() % 1000)))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *query)
+{
+  clock_time_t start, time;
+  db_result_t result;
+  unsigned long calls;
+  unsigned long rows;
+
+  result = db_query(&handle, query);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", query,
+           db_get_result_message(result));
+    return;
+  }
+
+  calls = rows = 0;
+  start = clock_time();
+  while(db_processing(&handle)) {
+    watchdog_periodic();
+    result = db_process(&handle);
+    calls++;
+    if(result == DB_GOT_ROW) {
+      rows++;
+    } else if(result != DB_OK) {
+      if(DB_ERROR(result)) {
+        printf("Processing error: %s\n", db_get_result_message(result));
+      }
+      break;
+    }
+  }
+  time = clock_time() - start;
+  db_free(&handle);
+
+  printf("%s\n  %lu rows, %lu calls, %lu ticks, %lu tuples/s\n",
+         query, rows, calls, (unsigned long)time,
+         time == 0 ? 0 :
+         (unsigned long)((uint64_t)ROWS * CLOCK_SECOND / time));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(scan_benchmark_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  printf("Antelope scan benchmark, %u rows, %u bytes of scan buffer\n",
+         ROWS, DB_SCAN_BUFFER_SIZE);
+  if(!load()) {
+    printf("Failed to create the relation\n");
+    PROCESS_EXIT();
+  }
+
+  for(i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+    run(queries[i]);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Time-to-first-packet benchmark. As soon as the node can
+ *         reach the network, it sends a UDP datagram: a DAG root to
+ *         all nodes on its link, other nodes to the root of the DODAG
+ *         they joined. It then prints the boot profile, from power-on
+ *         to that first datagram. Build with FAST=1 to compare with
+ *         the fast boot configuration, and with ROOT=1 for a root
+ *         (the default on native, which has no network to join).
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ip/uip-udp-packet.h"
+#include "net/rpl/rpl.h"
+#include "sys/boot-profile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UDP_PORT 5678
+
+/* How often to check whether the network can be reached */
+#define POLL_INTERVAL (CLOCK_SECOND / 64)
+
+static struct uip_udp_conn *conn;
+/*---------------------------------------------------------------------------*/
+PROCESS(boot_benchmark_process, "Boot benchmark");
+AUTOSTART_PROCESSES(&boot_benchmark_process);
+/*---------------------------------------------------------------------------*/
+#if BOOT_BENCHMARK_ROOT
+static void
+start_root(void)
+{
+  uip_ipaddr_t prefix;
+  uip_ipaddr_t ipaddr;
+
+  uip_ip6addr(&prefix, 0xfd00, 0, 0, 0, 0, 0, 0, 0);
+  uip_ipaddr_copy(&ipaddr, &prefix);
+  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+  uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
+  rpl_set_root(RPL_DEFAULT_INSTANCE, &ipaddr);
+  rpl_set_prefix(rpl_get_any_dag(), &prefix, 64);
+}
+#endif /* BOOT_BENCHMARK_ROOT */
+/*---------------------------------------------------------------------------*/
+/* Returns the destination of the first datagram, or NULL while the
+   network cannot be reached */
+static const uip_ipaddr_t *
+destination(void)
+{
+  static uip_ipaddr_t addr;
+  rpl_dag_t *dag = rpl_get_any_dag();
+
+  if(uip_ds6_get_link_local(ADDR_PREFERRED) == NULL || dag == NULL) {
+    return NULL;
+  }
+#if BOOT_BENCHMARK_ROOT
+  uip_create_linklocal_allnodes_mcast(&addr);
+  return &addr;
+#else /* BOOT_BENCHMARK_ROOT */
+  if(dag->preferred_parent == NULL) {
+    return NULL;
+  }
+  uip_ipaddr_copy(&addr, &dag->dag_id);
+  return &addr;
+#endif /* BOOT_BENCHMARK_ROOT */
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(boot_benchmark_process, ev, data)
+{
+  static struct etimer timer;
+  const uip_ipaddr_t *dest;
+  static const char payload[] = "boot";
+
+  PROCESS_BEGIN();
+
+#if BOOT_BENCHMARK_ROOT
+  start_root();
+#endif /* BOOT_BENCHMARK_ROOT */
+
+  conn = udp_new(NULL, UIP_HTONS(UDP_PORT), NULL);
+  udp_bind(conn, UIP_HTONS(UDP_PORT));
+
+  while((dest = destination()) == NULL) {
+    etimer_set(&timer, POLL_INTERVAL);
+    PROCESS_WAIT_UNTIL(etimer_expired(&timer));
+  }
+
+  uip_udp_packet_sendto(conn, payload, sizeof(payload) - 1,
+                        dest, UIP_HTONS(UDP_PORT));
+  BOOT_PROFILE_MARK(BOOT_PROFILE_APP);
+
+  printf("Boot profile (fast boot %s):\n", BOOT_FAST ? "on" : "off");
+  boot_profile_print();
+  printf("Time to first packet: %lu ms\n",
+         boot_profile_get(BOOT_PROFILE_APP) / 1000);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of the Internet checksum. ip_chksum_add(), as
+ *         configured for the platform (see IP_CHKSUM_CONF_WORD and
+ *         IP_CHKSUM_CONF_ARCH), is compared with the plain byte loop
+ *         for a few packet sizes, at aligned and unaligned addresses.
+ */
+
+#include "contiki.h"
+#include "net/ip/ip-chksum.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+
+#ifdef CHKSUM_BENCHMARK_CONF_ITERATIONS
+#define ITERATIONS CHKSUM_BENCHMARK_CONF_ITERATIONS
+#else /* CHKSUM_BENCHMARK_CONF_ITERATIONS */
+#define ITERATIONS 1000
+#endif /* CHKSUM_BENCHMARK_CONF_ITERATIONS */
+
+static uint32_t buf[(1280 + 8) / 4];
+static const uint16_t lengths[] = { 20, 40, 127, 1280 };
+
+PROCESS(chksum_benchmark_process, "Checksum benchmark");
+AUTOSTART_PROCESSES(&chksum_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static uint16_t
+reference_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = data + len - 1;
+
+  while(dataptr < last_byte) {
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const uint8_t *data, uint16_t len)
+{
+  rtimer_clock_t start, reference_time, time;
+  uint16_t reference_sum, sum;
+  volatile uint16_t result;
+  int i;
+
+  reference_sum = reference_chksum(0, data, len);
+  sum = ip_chksum_add(0, data, len);
+
+  start = RTIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    result = reference_chksum(0, data, len);
+  }
+  reference_time = RTIMER_NOW() - start;
+
+  start = RTIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    result = ip_chksum_add(0, data, len);
+  }
+  time = RTIMER_NOW() - start;
+  (void)result;
+
+  printf("len %4u offset %u: byte loop %lu ticks, ip_chksum_add %lu ticks%s\n",
+         len, (unsigned)((uintptr_t)data & 3),
+         (unsigned long)reference_time, (unsigned long)time,
+         sum == reference_sum ? "" : " MISMATCH");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(chksum_benchmark_process, ev, data)
+{
+  uint8_t *p;
+  int i, offset;
+
+  PROCESS_BEGIN();
+
+  p = (uint8_t *)buf;
+  for(i = 0; i < sizeof(buf); i++) {
+    p[i] = i * 37 + 11;
+  }
+
+  printf("Checksum benchmark, %u iterations, %lu ticks per second\n",
+         ITERATIONS, (unsigned long)RTIMER_SECOND);
+  for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    for(offset = 0; offset < 4; offset++) {
+      run(p + offset, lengths[i]);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of crc16_data(), as configured for the platform
+ *         (see CRC16_CONF_TABLE and CRC16_CONF_ARCH). It is compared
+ *         with the shift-based byte loop for a packet, a flash page
+ *         and an image-sized buffer.
+ */
+
+#include "contiki.h"
+#include "lib/crc16.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+
+#ifdef CRC16_BENCHMARK_CONF_ITERATIONS
+#define ITERATIONS CRC16_BENCHMARK_CONF_ITERATIONS
+#else /* CRC16_BENCHMARK_CONF_ITERATIONS */
+#define ITERATIONS 100
+#endif /* CRC16_BENCHMARK_CONF_ITERATIONS */
+
+static unsigned char buf[2048];
+static const uint16_t lengths[] = { 127, 512, 2048 };
+
+PROCESS(crc16_benchmark_process, "CRC16 benchmark");
+AUTOSTART_PROCESSES(&crc16_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned short
+reference_crc16(const unsigned char *data, int len, unsigned short acc)
+{
+  int i;
+
+  for(i = 0; i < len; i++) {
+    acc ^= data[i];
+    acc  = (acc >> 8) | (acc << 8);
+    acc ^= (acc & 0xff00) << 4;
+    acc ^= (acc >> 8) >> 4;
+    acc ^= (acc & 0xff00) >> 5;
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(uint16_t len)
+{
+  rtimer_clock_t start, reference_time, time;
+  unsigned short reference_crc, crc;
+  volatile unsigned short result;
+  int i;
+
+  reference_crc = reference_crc16(buf, len, 0);
+  crc = crc16_data(buf, len, 0);
+
+  start = RTIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    result = reference_crc16(buf, len, 0);
+  }
+  reference_time = RTIMER_NOW() - start;
+
+  start = RTIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    result = crc16_data(buf, len, 0);
+  }
+  time = RTIMER_NOW() - start;
+  (void)result;
+
+  printf("len %4u: byte loop %lu ticks, crc16_data %lu ticks%s\n",
+         len, (unsigned long)reference_time, (unsigned long)time,
+         crc == reference_crc ? "" : " MISMATCH");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(crc16_benchmark_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(buf); i++) {
+    buf[i] = i * 37 + 11;
+  }
+
+  printf("CRC16 benchmark, table %u, arch %u, %u iterations, %lu ticks per second\n",
+         CRC16_TABLE, CRC16_ARCH, ITERATIONS, (unsigned long)RTIMER_SECOND);
+  for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    run(lengths[i]);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
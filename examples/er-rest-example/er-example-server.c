@@ -42,6 +42,7 @@
 #include "contiki.h"
 #include "contiki-net.h"
 #include "rest-engine.h"
+#include "net/net-stats.h"
 
 #if PLATFORM_HAS_BUTTON
 #include "dev/button-sensor.h"
@@ -99,6 +100,15 @@ extern resource_t res_radio;
 extern resource_t res_sht11;
 #endif
 */
+#if MEMB_REGISTRY
+extern resource_t res_pools;
+#endif
+#if MEMB_FAILURE_TRACE
+extern resource_t res_allocfail;
+#endif
+#if NET_STATS_ENABLED
+extern resource_t res_net_stats;
+#endif
 
 PROCESS(er_example_server, "Erbium Example Server");
 AUTOSTART_PROCESSES(&er_example_server);
@@ -165,6 +175,15 @@ PROCESS_THREAD(er_example_server, ev, data)
   SENSORS_ACTIVATE(sht11_sensor);  
 #endif
 */
+#if MEMB_REGISTRY
+  rest_activate_resource(&res_pools, "debug/pools");
+#endif
+#if MEMB_FAILURE_TRACE
+  rest_activate_resource(&res_allocfail, "debug/allocfail");
+#endif
+#if NET_STATS_ENABLED
+  rest_activate_resource(&res_net_stats, "debug/net-stats");
+#endif
 
   /* Define application-specific events here. */
   while(1) {
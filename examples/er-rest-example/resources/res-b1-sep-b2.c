@@ -88,7 +88,7 @@ res_post_handler(void *request, void *response, uint8_t *buffer, uint16_t prefer
       }
 
       /* Warning: No check for serialization error. */
-      transaction->packet_len = coap_serialize_message(resp, transaction->packet);
+      transaction->packet_len = coap_serialize_message(resp, COAP_TRANSACTION_PACKET(transaction));
       coap_send_transaction(transaction);
     }
   } else {
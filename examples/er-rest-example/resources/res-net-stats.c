@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      Network stack counters resource
+ */
+
+#include "contiki.h"
+#include "net/net-stats.h"
+
+#if NET_STATS_ENABLED
+
+#include <stdio.h>
+#include <string.h>
+#include "rest-engine.h"
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+static void res_post_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+/*
+ * GET returns a binary snapshot of the registered counters, see
+ * net-stats.h, and GET ?view=names the names that go with it, one
+ * per line. Both can be longer than REST_MAX_CHUNK_SIZE and are sent
+ * in blocks. POST returns the counters that changed since the previous
+ * POST, so that one collector can follow them with small updates.
+ */
+RESOURCE(res_net_stats,
+         "title=\"Network counters\";rt=\"Data\"",
+         res_get_handler,
+         res_post_handler,
+         NULL,
+         NULL);
+
+static void
+block_error(void *response)
+{
+  REST.set_response_status(response, REST.status.BAD_OPTION);
+  /* A block error message should not exceed the minimum block size (16). */
+  const char *error_msg = "BlockOutOfScope";
+  REST.set_response_payload(response, error_msg, strlen(error_msg));
+}
+
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  struct net_stats_group *g;
+  const char *view = NULL;
+  char line[40];
+  int32_t pos = 0;
+  int len, skip, copy, strpos = 0;
+  int i;
+
+  if(REST.get_query_variable(request, "view", &view) == 5 &&
+     strncmp(view, "names", 5) == 0) {
+    /* Generate the whole list, and keep the part of it that is in the
+       requested block. */
+    for(g = net_stats_groups(); g != NULL; g = g->next) {
+      for(i = 0; i < g->count; i++) {
+        len = snprintf(line, sizeof(line), "%s.%s\n", g->name, g->fields[i]);
+        if(len >= (int)sizeof(line)) {
+          len = sizeof(line) - 1;
+        }
+        if(pos + len > *offset && strpos < preferred_size) {
+          skip = *offset > pos ? *offset - pos : 0;
+          copy = len - skip;
+          if(copy > preferred_size - strpos) {
+            copy = preferred_size - strpos;
+          }
+          memcpy(buffer + strpos, line + skip, copy);
+          strpos += copy;
+        }
+        pos += len;
+      }
+    }
+    REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  } else {
+    pos = net_stats_count() * 4;
+    strpos = net_stats_snapshot(buffer, preferred_size, *offset);
+    REST.set_header_content_type(response, REST.type.APPLICATION_OCTET_STREAM);
+  }
+
+  if(*offset > 0 && *offset >= pos) {
+    block_error(response);
+    return;
+  }
+
+  REST.set_response_payload(response, buffer, strpos);
+
+  *offset += strpos;
+  if(*offset >= pos) {
+    /* Signal end of resource representation. */
+    *offset = -1;
+  }
+}
+
+static void
+res_post_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  REST.set_header_content_type(response, REST.type.APPLICATION_OCTET_STREAM);
+  REST.set_response_payload(response, buffer,
+                            net_stats_delta(buffer, preferred_size));
+}
+#endif /* NET_STATS_ENABLED */
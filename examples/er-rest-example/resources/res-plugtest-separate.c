@@ -121,7 +121,8 @@ res_resume_handler()
 
       /* Warning: No check for serialization error. */
       transaction->packet_len = coap_serialize_message(response,
-                                                       transaction->packet);
+                                                       COAP_TRANSACTION_PACKET
+                                                         (transaction));
       coap_send_transaction(transaction);
       /* The engine will clear the transaction (right after send for NON, after acked for CON). */
 
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      Memory pool resource
+ */
+
+#include "contiki.h"
+#include "lib/memb.h"
+
+#if MEMB_REGISTRY
+
+#include <stdio.h>
+#include <string.h>
+#include "rest-engine.h"
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+/*
+ * Lists the registered memory pools, one line per pool:
+ * "name size num used peak failures". The list can be longer than
+ * REST_MAX_CHUNK_SIZE, so it is sent in blocks.
+ */
+RESOURCE(res_pools,
+         "title=\"Memory pools\";rt=\"Text\"",
+         res_get_handler,
+         NULL,
+         NULL,
+         NULL);
+
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  struct memb *m;
+  char line[64];
+  int32_t pos = 0;
+  int len, skip, copy, strpos = 0;
+
+  /* Generate the whole list, and keep the part of it that is in the
+     requested block. */
+  for(m = memb_registry(); m != NULL; m = m->next) {
+    len = snprintf(line, sizeof(line), "%s %d %d %d %d %d\n", m->name,
+                   m->size, m->num, memb_numused(m), memb_highwater(m),
+                   memb_failures(m));
+    if(len >= (int)sizeof(line)) {
+      len = sizeof(line) - 1;
+    }
+    if(pos + len > *offset && strpos < preferred_size) {
+      skip = *offset > pos ? *offset - pos : 0;
+      copy = len - skip;
+      if(copy > preferred_size - strpos) {
+        copy = preferred_size - strpos;
+      }
+      memcpy(buffer + strpos, line + skip, copy);
+      strpos += copy;
+    }
+    pos += len;
+  }
+
+  if(*offset > 0 && *offset >= pos) {
+    REST.set_response_status(response, REST.status.BAD_OPTION);
+    /* A block error message should not exceed the minimum block size (16). */
+    const char *error_msg = "BlockOutOfScope";
+    REST.set_response_payload(response, error_msg, strlen(error_msg));
+    return;
+  }
+
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  REST.set_response_payload(response, buffer, strpos);
+
+  *offset += strpos;
+  if(*offset >= pos) {
+    /* Signal end of resource representation. */
+    *offset = -1;
+  }
+}
+#endif /* MEMB_REGISTRY */
@@ -111,7 +111,7 @@ res_resume_handler()
       coap_set_header_block2(response, separate_store->request_metadata.block2_num, 0, separate_store->request_metadata.block2_size);
 
       /* Warning: No check for serialization error. */
-      transaction->packet_len = coap_serialize_message(response, transaction->packet);
+      transaction->packet_len = coap_serialize_message(response, COAP_TRANSACTION_PACKET(transaction));
       coap_send_transaction(transaction);
       /* The engine will clear the transaction (right after send for NON, after acked for CON). */
 
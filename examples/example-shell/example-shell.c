@@ -66,6 +66,7 @@ PROCESS_THREAD(example_shell_process, ev, data)
   shell_file_init();
   shell_httpd_init();
   shell_irc_init();
+  shell_memdebug_init();
   /*shell_ping_init();*/ /* uIP ping */
   shell_power_init();
   /*shell_profile_init();*/
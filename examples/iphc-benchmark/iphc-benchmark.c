@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of 6LoWPAN IPHC header decompression. Frames with
+ *         the common source and destination address modes are passed
+ *         to the network layer, and the number of frames handled per
+ *         second is printed for each mode, together with the decoded
+ *         addresses. The destinations are link-local or multicast
+ *         addresses of other nodes, so uIP drops the packets right after
+ *         decompression.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ip/uip.h"
+#include "net/ip/uip-debug.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef IPHC_BENCHMARK_CONF_ITERATIONS
+#define ITERATIONS IPHC_BENCHMARK_CONF_ITERATIONS
+#else /* IPHC_BENCHMARK_CONF_ITERATIONS */
+#define ITERATIONS 10000
+#endif /* IPHC_BENCHMARK_CONF_ITERATIONS */
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+/* IPHC: traffic class and flow label elided, next header inline, hop
+   limit 255 */
+#define IPHC0 0x7b
+#define NEXT_HEADER_UDP 17
+
+struct mode {
+  const char *name;
+  uint8_t iphc1;
+  uint8_t addr_len;
+  uint8_t addr[24];
+};
+
+/* The context 0 prefix is aaaa::/64 unless the platform configures
+   another one. */
+static const struct mode modes[] = {
+  { "ll 0/ll 0", 0x33, 0, { 0 } },
+  { "ll 16/ll 16", 0x22, 4, { 0x12, 0x34, 0x56, 0x78 } },
+  { "ll 64/ll 64", 0x11, 16,
+    { 0x02, 0x12, 0x74, 0x01, 0x00, 0x01, 0x01, 0x01,
+      0x02, 0x12, 0x74, 0x02, 0x00, 0x02, 0x02, 0x02 } },
+  { "inline/ll 64", 0x01, 24,
+    { 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+      0x02, 0x12, 0x74, 0x02, 0x00, 0x02, 0x02, 0x02 } },
+  { "ctx 0/ll 0", 0x73, 0, { 0 } },
+  { "ctx 64/ll 16", 0x52, 10,
+    { 0x02, 0x12, 0x74, 0x01, 0x00, 0x01, 0x01, 0x01,
+      0x56, 0x78 } },
+  { "ll 16/mcast 8", 0x2b, 3, { 0x12, 0x34, 0x1a } },
+  { "ll 16/mcast 48", 0x29, 8,
+    { 0x12, 0x34, 0x05, 0x00, 0x00, 0x00, 0x00, 0x1a } },
+};
+
+static const linkaddr_t sender = { { 0x00, 0x12, 0x74, 0x01,
+                                     0x00, 0x01, 0x01, 0x01 } };
+static const linkaddr_t receiver = { { 0x00, 0x12, 0x74, 0x02,
+                                       0x00, 0x02, 0x02, 0x02 } };
+
+static uint8_t frame[64];
+
+PROCESS(iphc_benchmark_process, "IPHC benchmark");
+AUTOSTART_PROCESSES(&iphc_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+build_frame(const struct mode *m)
+{
+  uint8_t *p;
+  uint8_t i;
+
+  p = frame;
+  *p++ = IPHC0;
+  *p++ = m->iphc1;
+  *p++ = NEXT_HEADER_UDP;
+  memcpy(p, m->addr, m->addr_len);
+  p += m->addr_len;
+
+  /* UDP header, port 5678 to 1234, and 24 bytes of data */
+  *p++ = 0x16;
+  *p++ = 0x2e;
+  *p++ = 0x04;
+  *p++ = 0xd2;
+  *p++ = 0;
+  *p++ = 8 + 24;
+  *p++ = 0;
+  *p++ = 0;
+  for(i = 0; i < 24; i++) {
+    *p++ = i;
+  }
+  return p - frame;
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_frame(uint8_t len)
+{
+  packetbuf_clear();
+  packetbuf_copyfrom(frame, len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &receiver);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const struct mode *m)
+{
+  rtimer_clock_t start, time;
+  uint8_t len;
+  int i;
+
+  len = build_frame(m);
+
+  input_frame(len);
+  printf("%-15s %2u bytes: ", m->name, len);
+  uip_debug_ipaddr_print(&UIP_IP_BUF->srcipaddr);
+  printf(" -> ");
+  uip_debug_ipaddr_print(&UIP_IP_BUF->destipaddr);
+  printf("\n");
+
+  start = RTIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    input_frame(len);
+  }
+  time = RTIMER_NOW() - start;
+
+  printf("%-15s %lu ticks, %lu frames/s\n", m->name, (unsigned long)time,
+         time == 0 ? 0 :
+         (unsigned long)((uint64_t)ITERATIONS * RTIMER_SECOND / time));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(iphc_benchmark_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("IPHC benchmark, %u iterations, %lu ticks per second\n",
+         ITERATIONS, (unsigned long)RTIMER_SECOND);
+  for(i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+    run(&modes[i]);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
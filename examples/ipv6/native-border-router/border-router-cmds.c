@@ -85,6 +85,22 @@ border_router_cmd_handler(const uint8_t *data, int len)
 	     data[2], data[3], data[4]);
       packet_sent(data[2], data[3], data[4]);
       return 1;
+    } else if(data[1] == 'W' && command_context == CMD_CONTEXT_RADIO) {
+      /* The slip-radio takes batches: window and largest SLIP frame */
+      border_router_rdc_set_batch(data[2], (data[3] << 8) | data[4]);
+      return 1;
+    } else if(data[1] == 'B' && command_context == CMD_CONTEXT_RADIO) {
+      /* A batch of commands from the slip-radio, each after its length */
+      int pos, entry_len;
+      for(pos = 2; pos + 2 <= len; pos += entry_len) {
+        entry_len = (data[pos] << 8) | data[pos + 1];
+        pos += 2;
+        if(entry_len < 2 || pos + entry_len > len) {
+          break;
+        }
+        cmd_input(&data[pos], entry_len);
+      }
+      return 1;
     } else if(data[1] == 'D' && command_context == CMD_CONTEXT_RADIO) {
       /* We need to know that this is from the slip-radio here... */
       PRINTF("Sensor data received\n");
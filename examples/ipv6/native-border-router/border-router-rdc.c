@@ -55,6 +55,36 @@
 #define MAX_CALLBACKS 16
 static int callback_pos;
 
+/* 3 bytes per packet attribute is required for serialization */
+#define FRAME_SIZE (PACKETBUF_NUM_ATTRS * 3 + PACKETBUF_SIZE + 3)
+
+/*
+ * Once the slip-radio has answered '?B' with its window and largest
+ * SLIP frame (border_router_rdc_set_batch()), frames are queued here and
+ * sent several at a time in '!B' frames, with at most the window of
+ * them not yet reported by '!R'. The queue and the window together
+ * never exceed the callbacks, so no callback is reused while in use.
+ */
+#define BATCH_QUEUE (MAX_CALLBACKS / 2)
+#define BATCH_MAX_LEN 1024
+/* Give back the window if the radio stops reporting, e.g. after a reset */
+#define BATCH_TIMEOUT (CLOCK_SECOND * 2)
+
+struct batch_frame {
+  uint16_t len;
+  uint8_t data[FRAME_SIZE];
+};
+
+static struct batch_frame batch_queue[BATCH_QUEUE];
+static int batch_head;
+static int batch_count;
+static int batch_window;
+static int batch_maxlen;
+static int batch_unreported;
+static struct ctimer batch_timer;
+
+PROCESS(border_router_rdc_process, "Border router RDC");
+
 /* a structure for calling back when packet data is coming back
    from radio... */
 struct tx_callback {
@@ -77,6 +107,90 @@ void packet_sent(uint8_t sessionid, uint8_t status, uint8_t tx)
   } else {
     PRINTF("*** ERROR: too high session id %d\n", sessionid);
   }
+  if(batch_window > 0) {
+    if(batch_unreported > 0) {
+      batch_unreported--;
+    }
+    process_poll(&border_router_rdc_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+batch_timeout(void *ptr)
+{
+  PRINTF("br-rdc: %d frames not reported\n", batch_unreported);
+  batch_unreported = 0;
+  process_poll(&border_router_rdc_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+batch_send(void)
+{
+  static uint8_t buf[BATCH_MAX_LEN];
+  struct batch_frame *f;
+  int len;
+
+  while(batch_count > 0 && batch_unreported < batch_window) {
+    buf[0] = '!';
+    buf[1] = 'B';
+    len = 2;
+    while(batch_count > 0 && batch_unreported < batch_window) {
+      f = &batch_queue[batch_head];
+      if(len + 2 + f->len > batch_maxlen) {
+        break;
+      }
+      buf[len++] = f->len >> 8;
+      buf[len++] = f->len & 0xff;
+      memcpy(&buf[len], f->data, f->len);
+      len += f->len;
+      batch_head = (batch_head + 1) % BATCH_QUEUE;
+      batch_count--;
+      batch_unreported++;
+    }
+    if(len > 2) {
+      write_to_slip(buf, len);
+    } else {
+      /* Too large for a batch, send it on its own */
+      f = &batch_queue[batch_head];
+      write_to_slip(f->data, f->len);
+      batch_head = (batch_head + 1) % BATCH_QUEUE;
+      batch_count--;
+      batch_unreported++;
+    }
+  }
+  if(batch_unreported > 0) {
+    ctimer_set(&batch_timer, BATCH_TIMEOUT, batch_timeout, NULL);
+  } else {
+    ctimer_stop(&batch_timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(border_router_rdc_process, ev, data)
+{
+  PROCESS_BEGIN();
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    batch_send();
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+border_router_rdc_set_batch(int window, int maxlen)
+{
+  if(window > BATCH_QUEUE) {
+    window = BATCH_QUEUE;
+  }
+  if(maxlen > BATCH_MAX_LEN) {
+    maxlen = BATCH_MAX_LEN;
+  }
+  PRINTF("br-rdc: batching %d frames, %d bytes\n", window, maxlen);
+  batch_window = window;
+  batch_maxlen = maxlen;
+  batch_unreported = 0;
+  if(!process_is_running(&border_router_rdc_process)) {
+    process_start(&border_router_rdc_process, NULL);
+  }
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -101,8 +215,8 @@ static void
 send_packet(mac_callback_t sent, void *ptr)
 {
   int size;
-  /* 3 bytes per packet attribute is required for serialization */
-  uint8_t buf[PACKETBUF_NUM_ATTRS * 3 + PACKETBUF_SIZE + 3];
+  uint8_t buf[FRAME_SIZE];
+  struct batch_frame *f;
   uint8_t sid;
 
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
@@ -124,6 +238,9 @@ send_packet(mac_callback_t sent, void *ptr)
     if(size < 0 || size + packetbuf_totlen() + 3 > sizeof(buf)) {
       PRINTF("br-rdc: send failed, too large header\n");
       mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+    } else if(batch_window > 0 && batch_count == BATCH_QUEUE) {
+      /* The radio is behind: let the upper layer try again later */
+      mac_call_sent_callback(sent, ptr, MAC_TX_COLLISION, 0);
     } else {
       sid = setup_callback(sent, ptr);
 
@@ -134,7 +251,16 @@ send_packet(mac_callback_t sent, void *ptr)
       /* Copy packet data */
       memcpy(&buf[3 + size], packetbuf_hdrptr(), packetbuf_totlen());
 
-      write_to_slip(buf, packetbuf_totlen() + size + 3);
+      if(batch_window > 0) {
+        /* Sent once the current event is done, with any frames after it */
+        f = &batch_queue[(batch_head + batch_count) % BATCH_QUEUE];
+        f->len = packetbuf_totlen() + size + 3;
+        memcpy(f->data, buf, f->len);
+        batch_count++;
+        process_poll(&border_router_rdc_process);
+      } else {
+        write_to_slip(buf, packetbuf_totlen() + size + 3);
+      }
     }
   }
 }
@@ -50,6 +50,9 @@
 #include "cmd.h"
 #include "border-router.h"
 #include "border-router-cmds.h"
+#if BORDER_ROUTER_CONF_LINUXRADIO
+#include "linuxradio-drv.h"
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -76,6 +79,7 @@ static char sensors[MAX_SENSORS][32];
 extern int contiki_argc;
 extern char **contiki_argv;
 extern const char *slip_config_ipaddr;
+extern const char *slip_config_siodev;
 
 CMD_HANDLERS(border_router_cmd_handler);
 
@@ -233,12 +237,21 @@ print_local_addresses(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if !BORDER_ROUTER_CONF_LINUXRADIO
 static void
 request_mac(void)
 {
   write_to_slip((uint8_t *)"?M", 2);
 }
 /*---------------------------------------------------------------------------*/
+static void
+request_batch(void)
+{
+  /* A slip-radio with batching answers with '!W', others ignore it */
+  write_to_slip((uint8_t *)"?B", 2);
+}
+#endif /* !BORDER_ROUTER_CONF_LINUXRADIO */
+/*---------------------------------------------------------------------------*/
 void
 border_router_set_mac(const uint8_t *data)
 {
@@ -317,15 +330,42 @@ PROCESS_THREAD(border_router_process, ev, data)
 
   slip_config_handle_arguments(contiki_argc, contiki_argv);
 
+#if BORDER_ROUTER_CONF_LINUXRADIO
+  /* The radio is the linux-wpan interface given with -s, not a slip-radio */
+  if(slip_config_siodev != NULL) {
+    linuxradio_set_interface(slip_config_siodev);
+  }
+  if(!NETSTACK_RADIO.on()) {
+    fprintf(stderr, "can't open the 802.15.4 interface\n");
+    exit(1);
+  }
+  slip_config_siodev = "null";
+#endif
+
   /* tun init is also responsible for setting up the SLIP connection */
   tun_init();
 
+#if BORDER_ROUTER_CONF_LINUXRADIO
+  {
+    uint8_t addr[8];
+
+    if(NETSTACK_RADIO.get_object(RADIO_PARAM_64BIT_ADDR, addr,
+                                 sizeof(addr)) != RADIO_RESULT_OK) {
+      fprintf(stderr, "can't read the 802.15.4 interface address\n");
+      exit(1);
+    }
+    border_router_set_mac(addr);
+  }
+#else
   while(!mac_set) {
     etimer_set(&et, CLOCK_SECOND);
     request_mac();
     PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
   }
 
+  request_batch();
+#endif
+
   if(slip_config_ipaddr != NULL) {
     uip_ipaddr_t prefix;
 
@@ -49,6 +49,7 @@ void border_router_set_prefix_64(const uip_ipaddr_t *prefix_64);
 void border_router_set_mac(const uint8_t *data);
 void border_router_set_sensors(const char *data, int len);
 void border_router_print_stat(void);
+void border_router_rdc_set_batch(int window, int maxlen);
 
 void tun_init(void);
 
@@ -52,7 +52,14 @@
 #define CMD_CONF_OUTPUT border_router_cmd_output
 
 #undef NETSTACK_CONF_RDC
+#if BORDER_ROUTER_CONF_LINUXRADIO
+/* Frames go straight to a linux-wpan interface, which does the acks */
+#define NETSTACK_CONF_RDC nullrdc_driver
+#undef NETSTACK_CONF_RADIO
+#define NETSTACK_CONF_RADIO linuxradio_driver
+#else
 #define NETSTACK_CONF_RDC border_router_rdc_driver
+#endif
 
 /* used by wpcap (see /cpu/native/net/wpcap-drv.c) */
 #define SELECT_CALLBACK 1
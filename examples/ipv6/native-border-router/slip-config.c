@@ -34,6 +34,10 @@
  *         Niclas Finne <nfi@sics.se>
  *         Joakim Eriksson <joakime@sics.se>
  */
+#ifdef linux
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -56,6 +60,7 @@ const char *slip_config_host = NULL;
 const char *slip_config_port = NULL;
 char slip_config_tundev[32] = { "" };
 uint16_t slip_config_basedelay = 0;
+int slip_config_cpu = -1;
 
 #ifndef BAUDRATE
 #define BAUDRATE B115200
@@ -73,7 +78,7 @@ slip_config_handle_arguments(int argc, char **argv)
   slip_config_verbose = 0;
 
   prog = argv[0];
-  while((c = getopt(argc, argv, "B:H:D:Lhs:t:v::d::a:p:T")) != -1) {
+  while((c = getopt(argc, argv, "B:H:D:Lhs:t:v::d::a:p:Tc:")) != -1) {
     switch(c) {
     case 'B':
       baudrate = atoi(optarg);
@@ -116,6 +121,10 @@ slip_config_handle_arguments(int argc, char **argv)
       if(optarg) slip_config_basedelay = atoi(optarg);
       break;
 
+    case 'c':
+      slip_config_cpu = atoi(optarg);
+      break;
+
     case 'v':
       slip_config_verbose = 2;
       if(optarg) slip_config_verbose = atoi(optarg);
@@ -138,6 +147,9 @@ fprintf(stderr," -s siodev      Serial device (default /dev/ttyUSB0)\n");
 fprintf(stderr," -a host        Connect via TCP to server at <host>\n");
 fprintf(stderr," -p port        Connect via TCP to server at <host>:<port>\n");
 fprintf(stderr," -t tundev      Name of interface (default tun0)\n");
+#ifdef linux
+fprintf(stderr," -c cpu         Run on the given CPU core only\n");
+#endif
 fprintf(stderr," -v[level]      Verbosity level\n");
 fprintf(stderr,"    -v0         No messages\n");
 fprintf(stderr,"    -v1         Encapsulated SLIP debug messages (default)\n");
@@ -157,7 +169,7 @@ exit(1);
   argv += optind - 1;
 
   if(argc != 2 && argc != 3) {
-    err(1, "usage: %s [-B baudrate] [-H] [-L] [-s siodev] [-t tundev] [-T] [-v verbosity] [-d delay] [-a serveraddress] [-p serverport] ipaddress", prog);
+    err(1, "usage: %s [-B baudrate] [-H] [-L] [-s siodev] [-t tundev] [-c cpu] [-T] [-v verbosity] [-d delay] [-a serveraddress] [-p serverport] ipaddress", prog);
   }
   slip_config_ipaddr = argv[1];
 
@@ -193,6 +205,19 @@ exit(1);
     /* Use default. */
     strcpy(slip_config_tundev, "tun0");
   }
+
+#ifdef linux
+  if(slip_config_cpu >= 0) {
+    /* Keep several border routers on one host from sharing a core. */
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(slip_config_cpu, &set);
+    if(sched_setaffinity(0, sizeof(set), &set) < 0) {
+      err(1, "cpu %d", slip_config_cpu);
+    }
+  }
+#endif
   return 1;
 }
 /*---------------------------------------------------------------------------*/
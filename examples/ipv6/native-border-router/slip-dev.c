@@ -170,103 +170,98 @@ slip_packet_input(unsigned char *data, int len)
 }
 /*---------------------------------------------------------------------------*/
 /*
- * Read from serial, when we have a packet call slip_packet_input. No output
- * buffering, input buffered by stdio.
+ * Read what is available from serial and decode it in one pass. When we
+ * have a packet call slip_packet_input. No output buffering.
  */
 void
 serial_input(FILE *inslip)
 {
   static unsigned char inbuf[2048];
   static int inbufptr = 0;
-  int ret,i;
+  static int escaped = 0;
+  unsigned char buf[1024];
+  int ret, i, j;
   unsigned char c;
 
-#ifdef linux
-  ret = fread(&c, 1, 1, inslip);
-  if(ret == -1 || ret == 0) err(1, "serial_input: read");
-  goto after_fread;
-#endif
-
- read_more:
-  if(inbufptr >= sizeof(inbuf)) {
-     fprintf(stderr, "*** dropping large %d byte packet\n", inbufptr);
-     inbufptr = 0;
+  ret = read(fileno(inslip), buf, sizeof(buf));
+  if(ret == -1 && errno != EAGAIN) {
+    err(1, "serial_input: read");
   }
-  ret = fread(&c, 1, 1, inslip);
+  if(ret <= 0) {
 #ifdef linux
- after_fread:
+    /* select() said there was something to read. */
+    if(ret == 0) {
+      err(1, "serial_input: read");
+    }
 #endif
-  if(ret == -1) {
-    err(1, "serial_input: read");
-  }
-  if(ret == 0) {
-    clearerr(inslip);
     return;
   }
-  slip_received++;
-  switch(c) {
-  case SLIP_END:
-    if(inbufptr > 0) {
-      if(inbuf[0] == '!') {
-	command_context = CMD_CONTEXT_RADIO;
-	cmd_input(inbuf, inbufptr);
-      } else if(inbuf[0] == '?') {
+  slip_received += ret;
+
+  for(j = 0; j < ret; j++) {
+    c = buf[j];
+    if(escaped) {
+      escaped = 0;
+      switch(c) {
+      case SLIP_ESC_END:
+        c = SLIP_END;
+        break;
+      case SLIP_ESC_ESC:
+        c = SLIP_ESC;
+        break;
+      }
+    } else if(c == SLIP_ESC) {
+      escaped = 1;
+      continue;
+    } else if(c == SLIP_END) {
+      if(inbufptr > 0) {
+        if(inbuf[0] == '!') {
+          command_context = CMD_CONTEXT_RADIO;
+          cmd_input(inbuf, inbufptr);
+        } else if(inbuf[0] == '?') {
 #define DEBUG_LINE_MARKER '\r'
-      } else if(inbuf[0] == DEBUG_LINE_MARKER) {
-	fwrite(inbuf + 1, inbufptr - 1, 1, stdout);
-      } else if(is_sensible_string(inbuf, inbufptr)) {
-        if(slip_config_verbose == 1) {   /* strings already echoed below for verbose>1 */
-          fwrite(inbuf, inbufptr, 1, stdout);
-        }
-      } else {
-        if(slip_config_verbose > 2) {
-          printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
-          if(slip_config_verbose > 4) {
+        } else if(inbuf[0] == DEBUG_LINE_MARKER) {
+          fwrite(inbuf + 1, inbufptr - 1, 1, stdout);
+        } else if(is_sensible_string(inbuf, inbufptr)) {
+          if(slip_config_verbose == 1) {   /* strings already echoed below for verbose>1 */
+            fwrite(inbuf, inbufptr, 1, stdout);
+          }
+        } else {
+          if(slip_config_verbose > 2) {
+            printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
+            if(slip_config_verbose > 4) {
 #if WIRESHARK_IMPORT_FORMAT
-            printf("0000");
-	    for(i = 0; i < inbufptr; i++) printf(" %02x", inbuf[i]);
+              printf("0000");
+              for(i = 0; i < inbufptr; i++) printf(" %02x", inbuf[i]);
 #else
-            printf("         ");
-            for(i = 0; i < inbufptr; i++) {
-              printf("%02x", inbuf[i]);
-              if((i & 3) == 3) printf(" ");
-              if((i & 15) == 15) printf("\n         ");
-            }
+              printf("         ");
+              for(i = 0; i < inbufptr; i++) {
+                printf("%02x", inbuf[i]);
+                if((i & 3) == 3) printf(" ");
+                if((i & 15) == 15) printf("\n         ");
+              }
 #endif
-            printf("\n");
+              printf("\n");
+            }
           }
+          slip_packet_input(inbuf, inbufptr);
         }
-	slip_packet_input(inbuf, inbufptr);
+        inbufptr = 0;
       }
-      inbufptr = 0;
-    }
-    break;
-
-  case SLIP_ESC:
-    if(fread(&c, 1, 1, inslip) != 1) {
-      clearerr(inslip);
-      /* Put ESC back and give up! */
-      ungetc(SLIP_ESC, inslip);
-      return;
+      continue;
     }
 
-    switch(c) {
-    case SLIP_ESC_END:
-      c = SLIP_END;
-      break;
-    case SLIP_ESC_ESC:
-      c = SLIP_ESC;
-      break;
+    if(inbufptr >= sizeof(inbuf)) {
+      fprintf(stderr, "*** dropping large %d byte packet\n", inbufptr);
+      inbufptr = 0;
     }
-    /* FALLTHROUGH */
-  default:
     inbuf[inbufptr++] = c;
 
     /* Echo lines as they are received for verbose=2,3,5+ */
     /* Echo all printable characters for verbose==4 */
     if(slip_config_verbose == 4) {
       if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
-	fwrite(&c, 1, 1, stdout);
+        fwrite(&c, 1, 1, stdout);
       }
     } else if(slip_config_verbose >= 2) {
       if(c == '\n' && is_sensible_string(inbuf, inbufptr)) {
@@ -274,10 +269,7 @@ serial_input(FILE *inslip)
         inbufptr = 0;
       }
     }
-    break;
   }
-
-  goto read_more;
 }
 
 unsigned char slip_buf[2048];
@@ -304,6 +296,35 @@ slip_send(int fd, unsigned char c)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Encode a packet straight into the output buffer. */
+static void
+slip_send_packet(const uint8_t *p, int len)
+{
+  unsigned char *out, *limit;
+  int i;
+
+  out = slip_buf + slip_end;
+  /* Leave room for the SLIP_END. */
+  limit = slip_buf + sizeof(slip_buf) - 1;
+  for(i = 0; i < len; i++) {
+    if(out >= limit) {
+      err(1, "slip_send overflow");
+    }
+    if(p[i] == SLIP_END || p[i] == SLIP_ESC) {
+      if(out + 2 > limit) {
+        err(1, "slip_send overflow");
+      }
+      *out++ = SLIP_ESC;
+      *out++ = p[i] == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC;
+    } else {
+      *out++ = p[i];
+    }
+  }
+  slip_sent += out - (slip_buf + slip_end);
+  slip_end = out - slip_buf;
+  slip_send(-1, SLIP_END);
+}
+/*---------------------------------------------------------------------------*/
 int
 slip_empty()
 {
@@ -385,22 +406,7 @@ write_to_serial(int outfd, const uint8_t *inbuf, int len)
    */
   /* slip_send(outfd, SLIP_END); */
 
-  for(i = 0; i < len; i++) {
-    switch(p[i]) {
-    case SLIP_END:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_END);
-      break;
-    case SLIP_ESC:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_ESC);
-      break;
-    default:
-      slip_send(outfd, p[i]);
-      break;
-    }
-  }
-  slip_send(outfd, SLIP_END);
+  slip_send_packet(p, len);
   PROGRESS("t");
 }
 /*---------------------------------------------------------------------------*/
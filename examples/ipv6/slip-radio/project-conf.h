@@ -33,8 +33,13 @@
 #undef QUEUEBUF_CONF_NUM
 #define QUEUEBUF_CONF_NUM          4
 
+/* Room for a few frames per SLIP frame when batching (see slip-radio.c) */
 #undef UIP_CONF_BUFFER_SIZE
+#if SLIP_RADIO_CONF_BATCH
+#define UIP_CONF_BUFFER_SIZE    400
+#else
 #define UIP_CONF_BUFFER_SIZE    140
+#endif
 
 #undef UIP_CONF_ROUTER
 #define UIP_CONF_ROUTER                 0
@@ -52,12 +52,50 @@
 extern const struct slip_radio_sensors SLIP_RADIO_CONF_SENSORS;
 #endif
 
+/*
+ * With batching, the border router may pack several '!S' commands into
+ * one '!B' SLIP frame, each preceded by its 16-bit length, and have at
+ * most SLIP_RADIO_BATCH_WINDOW of them unreported at any time. The '!R'
+ * reports are collected and sent back together, in a '!B' frame of
+ * their own, once all frames handed to the radio have been reported:
+ * every report hands the border router back one credit. The border
+ * router asks for this with '?B', answered by '!W' with the window and
+ * the largest SLIP frame we accept. Batches need a larger
+ * UIP_CONF_BUFFER_SIZE to be of much use (see project-conf.h).
+ */
+#ifdef SLIP_RADIO_CONF_BATCH
+#define SLIP_RADIO_BATCH SLIP_RADIO_CONF_BATCH
+#else
+#define SLIP_RADIO_BATCH 0
+#endif
+
+#ifdef SLIP_RADIO_CONF_BATCH_WINDOW
+#define SLIP_RADIO_BATCH_WINDOW SLIP_RADIO_CONF_BATCH_WINDOW
+#else
+#define SLIP_RADIO_BATCH_WINDOW 4
+#endif
+
 void slip_send_packet(const uint8_t *ptr, int len);
 
  /* max 16 packets at the same time??? */
 uint8_t packet_ids[16];
 int packet_pos;
 
+#if SLIP_RADIO_BATCH
+#if SLIP_RADIO_BATCH_WINDOW > 16
+#error SLIP_RADIO_BATCH_WINDOW can not be larger than the 16 packet ids
+#endif
+/* A '!B' frame of '!R' reports, each of length 5 */
+#define REPORT_LEN 5
+static uint8_t reports[2 + (2 + REPORT_LEN) * SLIP_RADIO_BATCH_WINDOW] = {
+  '!', 'B'
+};
+static uint8_t report_pos;
+static uint8_t batching;
+static uint8_t in_batch;
+static uint8_t unreported;
+#endif /* SLIP_RADIO_BATCH */
+
 static int slip_radio_cmd_handler(const uint8_t *data, int len);
 
 #if CONTIKI_TARGET_NOOLIBERRY
@@ -75,6 +113,40 @@ CMD_HANDLERS(CMD_CONF_HANDLERS);
 CMD_HANDLERS(slip_radio_cmd_handler);
 #endif
 /*---------------------------------------------------------------------------*/
+#if SLIP_RADIO_BATCH
+static void
+send_reports(void)
+{
+  if(report_pos > 2) {
+    cmd_send(reports, report_pos);
+  }
+  report_pos = 2;
+}
+/*---------------------------------------------------------------------------*/
+static int
+batch_input(const uint8_t *data, int len)
+{
+  int pos, entry_len;
+
+  /* Reports of frames sent right away are held until the end */
+  in_batch = 1;
+  for(pos = 2; pos + 2 <= len; pos += entry_len) {
+    entry_len = (data[pos] << 8) | data[pos + 1];
+    pos += 2;
+    if(entry_len < 2 || pos + entry_len > len) {
+      PRINTF("slip-radio: bad batch entry\n");
+      break;
+    }
+    cmd_input(&data[pos], entry_len);
+  }
+  in_batch = 0;
+  if(unreported == 0) {
+    send_reports();
+  }
+  return 1;
+}
+#endif /* SLIP_RADIO_BATCH */
+/*---------------------------------------------------------------------------*/
 static void
 packet_sent(void *ptr, int status, int transmissions)
 {
@@ -92,6 +164,22 @@ packet_sent(void *ptr, int status, int transmissions)
   buf[pos++] = sid;
   buf[pos++] = status; /* one byte ? */
   buf[pos++] = transmissions;
+#if SLIP_RADIO_BATCH
+  if(batching) {
+    reports[report_pos++] = 0;
+    reports[report_pos++] = REPORT_LEN;
+    memcpy(&reports[report_pos], buf, REPORT_LEN);
+    report_pos += REPORT_LEN;
+    if(unreported > 0) {
+      unreported--;
+    }
+    if((unreported == 0 && !in_batch) ||
+       report_pos + 2 + REPORT_LEN > sizeof(reports)) {
+      send_reports();
+    }
+    return;
+  }
+#endif /* SLIP_RADIO_BATCH */
   cmd_send(buf, pos);
 }
 /*---------------------------------------------------------------------------*/
@@ -125,6 +213,11 @@ slip_radio_cmd_handler(const uint8_t *data, int len)
 
       /* parse frame before sending to get addresses, etc. */
       no_framer.parse();
+#if SLIP_RADIO_BATCH
+      if(batching) {
+        unreported++;
+      }
+#endif /* SLIP_RADIO_BATCH */
       NETSTACK_LLSEC.send(packet_sent, &packet_ids[packet_pos]);
 
       packet_pos++;
@@ -133,6 +226,10 @@ slip_radio_cmd_handler(const uint8_t *data, int len)
       }
 
       return 1;
+#if SLIP_RADIO_BATCH
+    } else if(data[1] == 'B' && batching) {
+      return batch_input(data, len);
+#endif /* SLIP_RADIO_BATCH */
     }
   } else if(uip_buf[0] == '?') {
     PRINTF("Got request message of type %c\n", uip_buf[1]);
@@ -147,6 +244,21 @@ slip_radio_cmd_handler(const uint8_t *data, int len)
       cmd_send(uip_buf, uip_len);
       return 1;
     }
+#if SLIP_RADIO_BATCH
+    if(data[1] == 'B') {
+      uint8_t buf[5];
+      batching = 1;
+      unreported = 0;
+      report_pos = 2;
+      buf[0] = '!';
+      buf[1] = 'W';
+      buf[2] = SLIP_RADIO_BATCH_WINDOW;
+      buf[3] = (UIP_BUFSIZE - UIP_LLH_LEN) >> 8;
+      buf[4] = (UIP_BUFSIZE - UIP_LLH_LEN) & 0xff;
+      cmd_send(buf, sizeof(buf));
+      return 1;
+    }
+#endif /* SLIP_RADIO_BATCH */
   }
   return 0;
 }
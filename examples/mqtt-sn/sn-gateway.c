@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2016, Texas Instruments Incorporated - http://www.ti.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *    MQTT-SN gateway: serves the MQTT-SN nodes of the network over one
+ *    MQTT connection to the broker
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "mqtt.h"
+#include "mqtt-sn-gateway.h"
+/*---------------------------------------------------------------------------*/
+#define BROKER_PORT    1883
+#define KEEP_ALIVE     60
+#define CLIENT_ID      "contiki-mqtt-sn-gw"
+/*---------------------------------------------------------------------------*/
+static struct mqtt_connection conn;
+/*---------------------------------------------------------------------------*/
+PROCESS(sn_gateway_process, "MQTT-SN gateway");
+AUTOSTART_PROCESSES(&sn_gateway_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sn_gateway_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  mqtt_register(&conn, &sn_gateway_process, CLIENT_ID,
+                mqtt_sn_gateway_mqtt_event, MQTT_TCP_OUTPUT_BUFF_SIZE);
+  mqtt_sn_gateway_init(&conn);
+
+  /* The MQTT engine reconnects by itself from now on */
+  mqtt_connect(&conn, MQTT_SN_EXAMPLE_BROKER_IP_ADDR, BROKER_PORT,
+               KEEP_ALIVE);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016, Texas Instruments Incorporated - http://www.ti.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *    MQTT-SN node: publishes a counter every PERIOD and sleeps in between,
+ *    waking halfway to fetch the messages of its "cm" subscription
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/ip/uiplib.h"
+#include "net/linkaddr.h"
+#include "mqtt-sn.h"
+
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define PERIOD         (60 * CLOCK_SECOND)
+#define KEEP_ALIVE     60
+#define SLEEP_DURATION 120
+#define COUNTER_TOPIC  "contiki/mqtt-sn/counter"
+#define COMMAND_TOPIC  "cm"
+/*---------------------------------------------------------------------------*/
+static struct mqtt_sn_connection conn;
+static uip_ipaddr_t gateway;
+static char client_id[MQTT_SN_CLIENT_ID_MAX_LEN + 1];
+static mqtt_sn_event_t last_event;
+static uint16_t counter_topic;
+static struct etimer et;
+/*---------------------------------------------------------------------------*/
+PROCESS(sn_node_process, "MQTT-SN node");
+AUTOSTART_PROCESSES(&sn_node_process);
+/*---------------------------------------------------------------------------*/
+static void
+sn_event(struct mqtt_sn_connection *c, mqtt_sn_event_t event, void *data)
+{
+  struct mqtt_sn_message *msg;
+
+  if(event == MQTT_SN_EVENT_PUBLISH) {
+    msg = data;
+    printf("Command: %.*s\n", msg->payload_length, (char *)msg->payload);
+    return;
+  }
+  if(event == MQTT_SN_EVENT_REGACK) {
+    counter_topic = ((struct mqtt_sn_ack_event *)data)->topic_id;
+  }
+  last_event = event;
+  process_poll(&sn_node_process);
+}
+/*---------------------------------------------------------------------------*/
+/* Waits for the reply to a request, restarts on errors */
+#define WAIT_FOR(e)                                                         \
+  do {                                                                      \
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);                     \
+    if(last_event != (e)) {                                                 \
+      printf("MQTT-SN event %u, restarting\n", last_event);                 \
+      goto restart;                                                         \
+    }                                                                       \
+  } while(0)
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sn_node_process, ev, data)
+{
+  static char payload[12];
+  static unsigned counter;
+
+  PROCESS_BEGIN();
+
+  snprintf(client_id, sizeof(client_id), "contiki-%02x%02x",
+           linkaddr_node_addr.u8[LINKADDR_SIZE - 2],
+           linkaddr_node_addr.u8[LINKADDR_SIZE - 1]);
+  uiplib_ipaddrconv(MQTT_SN_EXAMPLE_GATEWAY_IP_ADDR, &gateway);
+  mqtt_sn_register(&conn, MQTT_SN_PORT, client_id, sn_event);
+
+restart:
+  etimer_set(&et, PERIOD);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  if(mqtt_sn_connect(&conn, &gateway, KEEP_ALIVE) != MQTT_SN_STATUS_OK) {
+    goto restart;
+  }
+  WAIT_FOR(MQTT_SN_EVENT_CONNECTED);
+  mqtt_sn_register_topic(&conn, NULL, COUNTER_TOPIC);
+  WAIT_FOR(MQTT_SN_EVENT_REGACK);
+  mqtt_sn_subscribe(&conn, NULL, COMMAND_TOPIC, 0);
+  WAIT_FOR(MQTT_SN_EVENT_SUBACK);
+
+  while(1) {
+    snprintf(payload, sizeof(payload), "%u", ++counter);
+    mqtt_sn_publish(&conn, NULL, counter_topic, MQTT_SN_TOPIC_NORMAL,
+                    (uint8_t *)payload, strlen(payload), 1, 0);
+    WAIT_FOR(MQTT_SN_EVENT_PUBACK);
+
+    mqtt_sn_sleep(&conn, SLEEP_DURATION);
+    WAIT_FOR(MQTT_SN_EVENT_ASLEEP);
+
+    etimer_set(&et, PERIOD / 2);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    mqtt_sn_wake(&conn);
+    WAIT_FOR(MQTT_SN_EVENT_AWAKE_DONE);
+
+    etimer_set(&et, PERIOD / 2);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    mqtt_sn_connect(&conn, &gateway, KEEP_ALIVE);
+    WAIT_FOR(MQTT_SN_EVENT_CONNECTED);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of the IPv6 hot paths, each timed in isolation:
+ *         802.15.4 framing, 6LoWPAN compression and decompression, uIP
+ *         input of UDP and TCP packets, route and neighbor lookups with
+ *         full tables, CCM* and CoAP. The time per operation is printed
+ *         as a JSON object, so that the results of two builds can be
+ *         compared by a script. On native, "make net-benchmark.json"
+ *         runs the benchmark and keeps only the JSON.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/mac/frame802154.h"
+#include "lib/ccm-star.h"
+#include "er-coap.h"
+#include "sys/rtimer.h"
+#include "dev/watchdog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The time, in rtimer ticks, to run each operation for */
+#ifdef NET_BENCHMARK_CONF_DURATION
+#define DURATION NET_BENCHMARK_CONF_DURATION
+#else /* NET_BENCHMARK_CONF_DURATION */
+#define DURATION (RTIMER_SECOND / 2)
+#endif /* NET_BENCHMARK_CONF_DURATION */
+
+/* Operations between two reads of the rtimer, few enough for a 16-bit
+   rtimer not to wrap */
+#define BATCH 32
+
+#define PAYLOAD_LEN 32
+#define UDP_PORT 1234
+#define TCP_PORT 1235
+
+#define IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UDP_BUF ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+#define TCP_BUF ((struct uip_tcp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+
+static const linkaddr_t sender = { { 0x00, 0x12, 0x74, 0x01,
+                                     0x00, 0x01, 0x01, 0x01 } };
+
+static uint8_t payload[PAYLOAD_LEN];
+
+static frame802154_t frame_params;
+static uint8_t frame[127];
+static int frame_len;
+
+static uint8_t iphc_frame[64];
+static uint8_t iphc_frame_len;
+
+static uint8_t udp_packet[UIP_LLIPH_LEN + UIP_UDPH_LEN + PAYLOAD_LEN];
+static uint8_t tcp_packet[UIP_LLIPH_LEN + UIP_TCPH_LEN];
+
+static uip_ipaddr_t nbr_addrs[NBR_TABLE_MAX_NEIGHBORS];
+static uip_ipaddr_t route_addrs[UIP_DS6_ROUTE_NB];
+static int nbr_count, route_count, lookup;
+
+static uint8_t coap_buf[64];
+static size_t coap_len;
+
+static int first_result = 1;
+
+PROCESS(net_benchmark_process, "Network benchmark");
+PROCESS(udp_sink_process, "UDP sink");
+AUTOSTART_PROCESSES(&net_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name, void (*op)(void), int entries)
+{
+  unsigned long ticks, ops;
+  rtimer_clock_t start;
+  int i;
+
+  ticks = 0;
+  ops = 0;
+  while(ticks < DURATION) {
+    start = RTIMER_NOW();
+    for(i = 0; i < BATCH; i++) {
+      op();
+    }
+    ticks += (rtimer_clock_t)(RTIMER_NOW() - start);
+    ops += BATCH;
+    watchdog_periodic();
+  }
+
+  printf("%s    {\"name\": \"%s\", \"ops\": %lu, \"ns_per_op\": %lu",
+         first_result ? "" : ",\n", name, ops,
+         (unsigned long)((uint64_t)ticks * 1000000000 / RTIMER_SECOND / ops));
+  if(entries > 0) {
+    printf(", \"entries\": %d", entries);
+  }
+  printf("}");
+  first_result = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_frame_create(void)
+{
+  frame802154_create(&frame_params, frame);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_frame_parse(void)
+{
+  frame802154_t parsed;
+
+  frame802154_parse(frame, frame_len, &parsed);
+}
+/*---------------------------------------------------------------------------*/
+static void
+setup_frame(void)
+{
+  int hdr_len;
+
+  memset(&frame_params, 0, sizeof(frame_params));
+  frame_params.fcf.frame_type = FRAME802154_DATAFRAME;
+  frame_params.fcf.frame_version = FRAME802154_IEEE802154_2006;
+  frame_params.fcf.panid_compression = 1;
+  frame_params.fcf.dest_addr_mode = FRAME802154_LONGADDRMODE;
+  frame_params.fcf.src_addr_mode = FRAME802154_LONGADDRMODE;
+  frame_params.seq = 1;
+  frame_params.dest_pid = IEEE802154_PANID;
+  frame_params.src_pid = IEEE802154_PANID;
+  memcpy(frame_params.dest_addr, &linkaddr_node_addr, LINKADDR_SIZE);
+  memcpy(frame_params.src_addr, &sender, LINKADDR_SIZE);
+  frame_params.payload = payload;
+  frame_params.payload_len = sizeof(payload);
+
+  hdr_len = frame802154_create(&frame_params, frame);
+  memcpy(&frame[hdr_len], payload, sizeof(payload));
+  frame_len = hdr_len + sizeof(payload);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill_ip_header(uint8_t proto, uint16_t len)
+{
+  memset(uip_buf, 0, UIP_LLIPH_LEN);
+  IP_BUF->vtc = 0x60;
+  IP_BUF->len[0] = len >> 8;
+  IP_BUF->len[1] = len & 0xff;
+  IP_BUF->proto = proto;
+  IP_BUF->ttl = 64;
+  uip_create_linklocal_prefix(&IP_BUF->srcipaddr);
+  uip_ds6_set_addr_iid(&IP_BUF->srcipaddr, (uip_lladdr_t *)&sender);
+  uip_ipaddr_copy(&IP_BUF->destipaddr,
+                  &uip_ds6_get_link_local(-1)->ipaddr);
+  uip_len = UIP_IPH_LEN + len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+setup_packets(void)
+{
+  uint8_t *p;
+
+  /* A UDP datagram to the sink */
+  fill_ip_header(UIP_PROTO_UDP, UIP_UDPH_LEN + PAYLOAD_LEN);
+  UDP_BUF->srcport = UIP_HTONS(5678);
+  UDP_BUF->destport = UIP_HTONS(UDP_PORT);
+  UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + PAYLOAD_LEN);
+  UDP_BUF->udpchksum = 0;
+  memcpy(&uip_buf[UIP_LLIPH_LEN + UIP_UDPH_LEN], payload, PAYLOAD_LEN);
+  UDP_BUF->udpchksum = ~(uip_udpchksum());
+  memcpy(udp_packet, uip_buf, sizeof(udp_packet));
+
+  /* A TCP SYN to a closed port, which uIP answers with a RST */
+  fill_ip_header(UIP_PROTO_TCP, UIP_TCPH_LEN);
+  memset(TCP_BUF, 0, UIP_TCPH_LEN);
+  TCP_BUF->srcport = UIP_HTONS(5678);
+  TCP_BUF->destport = UIP_HTONS(TCP_PORT);
+  TCP_BUF->seqno[3] = 1;
+  TCP_BUF->tcpoffset = (UIP_TCPH_LEN / 4) << 4;
+  TCP_BUF->flags = 0x02; /* SYN */
+  TCP_BUF->wnd[0] = 1;
+  TCP_BUF->tcpchksum = ~(uip_tcpchksum());
+  memcpy(tcp_packet, uip_buf, sizeof(tcp_packet));
+  uip_clear_buf();
+
+  /* The UDP datagram as an IPHC frame with the addresses elided and
+     the next header inline */
+  p = iphc_frame;
+  *p++ = 0x7b;
+  *p++ = 0x33;
+  *p++ = UIP_PROTO_UDP;
+  memcpy(p, &udp_packet[UIP_LLIPH_LEN], UIP_UDPH_LEN + PAYLOAD_LEN);
+  p += UIP_UDPH_LEN + PAYLOAD_LEN;
+  iphc_frame_len = p - iphc_frame;
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_sicslowpan_compress(void)
+{
+  memcpy(uip_buf, udp_packet, sizeof(udp_packet));
+  uip_len = sizeof(udp_packet);
+  tcpip_output((uip_lladdr_t *)&sender);
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_sicslowpan_uncompress(void)
+{
+  packetbuf_clear();
+  packetbuf_copyfrom(iphc_frame, iphc_frame_len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_udp_input(void)
+{
+  memcpy(uip_buf, udp_packet, sizeof(udp_packet));
+  uip_len = sizeof(udp_packet);
+  uip_input();
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_tcp_input(void)
+{
+  memcpy(uip_buf, tcp_packet, sizeof(tcp_packet));
+  uip_len = sizeof(tcp_packet);
+  uip_input();
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+static void
+setup_tables(void)
+{
+  uip_lladdr_t lladdr;
+  uip_ipaddr_t prefix;
+  int i;
+
+  uip_ip6addr(&prefix, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  memcpy(&lladdr, &sender, sizeof(lladdr));
+
+  for(nbr_count = 0; nbr_count < NBR_TABLE_MAX_NEIGHBORS; nbr_count++) {
+    lladdr.addr[7] = nbr_count + 2;
+    uip_create_linklocal_prefix(&nbr_addrs[nbr_count]);
+    uip_ds6_set_addr_iid(&nbr_addrs[nbr_count], &lladdr);
+    if(uip_ds6_nbr_add(&nbr_addrs[nbr_count], &lladdr,
+                       0, NBR_REACHABLE) == NULL) {
+      break;
+    }
+  }
+
+  for(route_count = 0; route_count < UIP_DS6_ROUTE_NB && nbr_count > 0;
+      route_count++) {
+    i = route_count;
+    uip_ipaddr_copy(&route_addrs[i], &prefix);
+    route_addrs[i].u8[14] = i >> 8;
+    route_addrs[i].u8[15] = i & 0xff;
+    if(uip_ds6_route_add(&route_addrs[i], 128,
+                         &nbr_addrs[i % nbr_count]) == NULL) {
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_route_lookup(void)
+{
+  uip_ds6_route_lookup(&route_addrs[lookup]);
+  lookup = (lookup + 1) % route_count;
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_nbr_lookup(void)
+{
+  uip_ds6_nbr_lookup(&nbr_addrs[lookup]);
+  lookup = (lookup + 1) % nbr_count;
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_ccm_star(void)
+{
+  static const uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t m[100];
+  uint8_t mic[8];
+
+  memcpy(m, frame, sizeof(m));
+  CCM_STAR.aead(nonce, m, sizeof(m), frame, 21, mic, sizeof(mic), 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_coap_serialize(void)
+{
+  static const uint8_t token[] = { 0x12, 0x34, 0x56, 0x78 };
+  coap_packet_t packet;
+
+  coap_init_message(&packet, COAP_TYPE_CON, COAP_GET, 0x1234);
+  coap_set_token(&packet, token, sizeof(token));
+  coap_set_header_uri_path(&packet, "sensors/temperature");
+  coap_set_header_content_format(&packet, TEXT_PLAIN);
+  coap_set_payload(&packet, payload, 16);
+  coap_len = coap_serialize_message(&packet, coap_buf);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_coap_parse(void)
+{
+  coap_packet_t packet;
+  uint8_t buf[sizeof(coap_buf)];
+
+  /* Parsing leaves the options in place, so parse a copy. */
+  memcpy(buf, coap_buf, coap_len);
+  coap_parse_message(&packet, buf, coap_len);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(udp_sink_process, ev, data)
+{
+  static struct uip_udp_conn *conn;
+
+  PROCESS_BEGIN();
+
+  conn = udp_new(NULL, 0, NULL);
+  udp_bind(conn, UIP_HTONS(UDP_PORT));
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(net_benchmark_process, ev, data)
+{
+  static const uint8_t key[16] = { 0x2b, 0x7e, 0x15, 0x16 };
+
+  PROCESS_BEGIN();
+
+  process_start(&udp_sink_process, NULL);
+
+  setup_frame();
+  setup_packets();
+  setup_tables();
+  CCM_STAR.set_key(key);
+  op_coap_serialize();
+
+  printf("{\"ticks_per_second\": %lu, \"results\": [\n",
+         (unsigned long)RTIMER_SECOND);
+  report("frame802154_create", op_frame_create, 0);
+  report("frame802154_parse", op_frame_parse, 0);
+  report("sicslowpan_compress", op_sicslowpan_compress, 0);
+  report("sicslowpan_uncompress", op_sicslowpan_uncompress, 0);
+  report("uip_udp_input", op_udp_input, 0);
+  report("uip_tcp_input", op_tcp_input, 0);
+  lookup = 0;
+  report("route_lookup", op_route_lookup, route_count);
+  lookup = 0;
+  report("nbr_lookup", op_nbr_lookup, nbr_count);
+  report("ccm_star_aead", op_ccm_star, 0);
+  report("coap_serialize", op_coap_serialize, 0);
+  report("coap_parse", op_coap_parse, 0);
+  printf("\n]}\n");
+
+#if CONTIKI_TARGET_NATIVE
+  exit(0);
+#endif /* CONTIKI_TARGET_NATIVE */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Testing the rwucb code in Rime
+ *
+ *         Node 53.0 sends FILESIZE bytes to node 54.0. The addresses
+ *         differ from example-rucb so that both examples can run in
+ *         the same simulation, see example-bulk.csc.
+ */
+
+#include "contiki.h"
+#include "net/rime/rwucb.h"
+
+#include "lib/print-stats.h"
+
+#include <stdio.h>
+
+#define FILESIZE 40000
+
+static clock_time_t start_time;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(example_rwucb_process, "Rwucb example");
+AUTOSTART_PROCESSES(&example_rwucb_process);
+/*---------------------------------------------------------------------------*/
+static void
+write_chunk(struct rwucb_conn *c, int offset, int flag,
+            char *data, int datalen)
+{
+  if(flag == RWUCB_FLAG_LASTCHUNK) {
+    printf("Received %d bytes\n", offset);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_chunk(struct rwucb_conn *c, int offset, char *to, int maxsize)
+{
+  int size;
+
+  size = maxsize;
+  if(offset + maxsize >= FILESIZE) {
+    size = FILESIZE - offset;
+  }
+  return size;
+}
+/*---------------------------------------------------------------------------*/
+static void
+timedout(struct rwucb_conn *c)
+{
+  printf("Transfer timed out\n");
+}
+/*---------------------------------------------------------------------------*/
+static void
+sent(struct rwucb_conn *c)
+{
+  printf("Completion time %lu / %u\n",
+         (unsigned long)clock_time() - start_time, (unsigned int)CLOCK_SECOND);
+  print_stats();
+}
+/*---------------------------------------------------------------------------*/
+static const struct rwucb_callbacks rwucb_call = {write_chunk, read_chunk,
+                                                  timedout, sent};
+static struct rwucb_conn rwucb;
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(example_rwucb_process, ev, data)
+{
+  PROCESS_EXITHANDLER(rwucb_close(&rwucb);)
+  PROCESS_BEGIN();
+
+  PROCESS_PAUSE();
+
+  rwucb_open(&rwucb, 138, &rwucb_call);
+
+  PROCESS_PAUSE();
+
+  if(linkaddr_node_addr.u8[0] == 53 &&
+     linkaddr_node_addr.u8[1] == 0) {
+    linkaddr_t recv;
+
+    recv.u8[0] = 54;
+    recv.u8[1] = 0;
+    start_time = clock_time();
+
+    rwucb_send(&rwucb, &recv);
+  }
+
+  PROCESS_WAIT_EVENT_UNTIL(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of memcpy(), memset() and memcmp() for the sizes
+ *         seen in the network stack, 8 to 127 bytes, at aligned and
+ *         unaligned addresses. Build it once as it is and once with
+ *         ARM_STRING=1 to compare the C library with the routines in
+ *         cpu/arm/common/string. On ARMv7-M the times are CPU cycles
+ *         from the DWT cycle counter, elsewhere rtimer ticks.
+ */
+
+#include "contiki.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef STRING_BENCHMARK_CONF_ITERATIONS
+#define ITERATIONS STRING_BENCHMARK_CONF_ITERATIONS
+#else /* STRING_BENCHMARK_CONF_ITERATIONS */
+#define ITERATIONS 100
+#endif /* STRING_BENCHMARK_CONF_ITERATIONS */
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define DWT_CTRL   (*(volatile uint32_t *)0xE0001000)
+#define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+#define DEMCR      (*(volatile uint32_t *)0xE000EDFC)
+#define TIMER_INIT() do { DEMCR |= 1UL << 24; DWT_CYCCNT = 0; DWT_CTRL |= 1; } while(0)
+#define TIMER_NOW()  DWT_CYCCNT
+#define TIMER_UNIT   "cycles"
+#else
+#define TIMER_INIT()
+#define TIMER_NOW()  RTIMER_NOW()
+#define TIMER_UNIT   "rtimer ticks"
+#endif
+
+static uint32_t src_buf[(127 + 8) / 4];
+static uint32_t dst_buf[(127 + 8) / 4];
+static const uint8_t lengths[] = { 8, 16, 40, 64, 127 };
+
+PROCESS(string_benchmark_process, "String benchmark");
+AUTOSTART_PROCESSES(&string_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static void
+run(uint8_t len, int src_offset, int dst_offset)
+{
+  uint8_t *src = (uint8_t *)src_buf + src_offset;
+  uint8_t *dst = (uint8_t *)dst_buf + dst_offset;
+  /* volatile, so that the compiler has to call the library routines */
+  void *(*volatile copy)(void *, const void *, size_t) = memcpy;
+  void *(*volatile set)(void *, int, size_t) = memset;
+  int (*volatile compare)(const void *, const void *, size_t) = memcmp;
+  uint32_t start, cpy_time, set_time, cmp_time;
+  int i;
+
+  start = TIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    copy(dst, src, len);
+  }
+  cpy_time = TIMER_NOW() - start;
+
+  start = TIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    compare(dst, src, len);
+  }
+  cmp_time = TIMER_NOW() - start;
+
+  start = TIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    set(dst, i, len);
+  }
+  set_time = TIMER_NOW() - start;
+
+  printf("len %3u src+%u dst+%u: memcpy %lu memcmp %lu memset %lu\n",
+         len, src_offset, dst_offset, (unsigned long)cpy_time,
+         (unsigned long)cmp_time, (unsigned long)set_time);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(string_benchmark_process, ev, data)
+{
+  uint8_t *p;
+  int i;
+
+  PROCESS_BEGIN();
+
+  p = (uint8_t *)src_buf;
+  for(i = 0; i < sizeof(src_buf); i++) {
+    p[i] = i * 37 + 11;
+  }
+
+  TIMER_INIT();
+  printf("String benchmark, %u iterations, times in %s\n",
+         ITERATIONS, TIMER_UNIT);
+  for(i = 0; i < sizeof(lengths); i++) {
+    run(lengths[i], 0, 0);
+    run(lengths[i], 1, 0);
+    run(lengths[i], 0, 3);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
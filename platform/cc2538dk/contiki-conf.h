@@ -110,7 +110,12 @@ typedef uint32_t rtimer_clock_t;
 #define USB_ARCH_CONF_TX_DMA_CHAN   1 /**< RAM -> USB DMA channel */
 #define CC2538_RF_CONF_TX_DMA_CHAN  2 /**< RF -> RAM DMA channel */
 #define CC2538_RF_CONF_RX_DMA_CHAN  3 /**< RAM -> RF DMA channel */
+#if SLIP_CONF_BLOCK
+#define SLIP_ARCH_CONF_TX_DMA_CHAN  9 /**< RAM -> SLIP UART DMA channel */
+#define UDMA_CONF_MAX_CHANNEL       SLIP_ARCH_CONF_TX_DMA_CHAN
+#else
 #define UDMA_CONF_MAX_CHANNEL       CC2538_RF_CONF_RX_DMA_CHAN
+#endif
 /** @} */
 /*---------------------------------------------------------------------------*/
 /**
@@ -425,6 +430,11 @@ typedef uint32_t rtimer_clock_t;
 #define UIP_CONF_UDP_CHECKSUMS               1
 #define UIP_CONF_ICMP6                       1
 
+/* Sum checksums a 32-bit word at a time */
+#ifndef IP_CHKSUM_CONF_WORD
+#define IP_CHKSUM_CONF_WORD                  1
+#endif
+
 /* ND and Routing */
 #ifndef UIP_CONF_ROUTER
 #define UIP_CONF_ROUTER                      1
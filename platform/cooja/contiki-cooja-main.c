@@ -125,6 +125,19 @@ SIM_INTERFACES(&vib_interface, &moteid_interface, &rs232_interface, &simlog_inte
 /* Sensors */
 SENSORS(&button_sensor, &pir_sensor, &vib_sensor);
 
+/*
+ * The number of events a mote handles per tick. With 0, only the events
+ * pending when the tick starts are handled, and each event they post
+ * waits for the next tick, one simulated millisecond later. Draining the
+ * events instead lets chains of events complete in one tick, which cuts
+ * the number of ticks COOJA has to schedule.
+ */
+#ifdef COOJA_CONF_EVENTS_PER_TICK
+#define EVENTS_PER_TICK COOJA_CONF_EVENTS_PER_TICK
+#else
+#define EVENTS_PER_TICK 0
+#endif
+
 /*
  * referenceVar is used for comparing absolute and process relative memory.
  * (this must not be static due to memory locations)
@@ -340,10 +353,18 @@ process_run_thread_loop(void *data)
 
     while(1)
     {
+#if EVENTS_PER_TICK
+        {
+          int n;
+
+          for(n = 0; n < EVENTS_PER_TICK && process_run() > 0; n++);
+        }
+#else /* EVENTS_PER_TICK */
         simProcessRunValue = process_run();
         while(simProcessRunValue-- > 0) {
           process_run();
         }
+#endif /* EVENTS_PER_TICK */
         simProcessRunValue = process_nevents();
 
         /* Check if we must stay awake */
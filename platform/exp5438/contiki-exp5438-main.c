@@ -48,6 +48,7 @@
 #include "net/netstack.h"
 #include "net/rime/rime.h"
 #include "sys/autostart.h"
+#include "sys/tickless.h"
 
 #include "sys/node-id.h"
 #include "lcd.h"
@@ -306,6 +307,11 @@ main(int argc, char **argv)
     } else {
       static unsigned long irq_energest = 0;
 
+#if TICKLESS_ON
+      /* Do not wake up on clock ticks before the next etimer expires. */
+      tickless_sleep_prepare();
+#endif /* TICKLESS_ON */
+
       /* Re-enable interrupts and go to sleep atomically. */
       ENERGEST_SWITCH(ENERGEST_TYPE_CPU, ENERGEST_TYPE_LPM);
       /* We only want to measure the processing done in IRQs when we
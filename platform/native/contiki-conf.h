@@ -267,6 +267,10 @@ typedef unsigned long clock_time_t;
 /* Not part of C99 but actually present */
 int strcasecmp(const char*, const char*);
 
+#ifndef AES_128_CONF_IMPL
+#define AES_128_CONF_IMPL AES_128_IMPL_TTABLE
+#endif /* AES_128_CONF_IMPL */
+
 /* include the project config */
 /* PROJECT_CONF_H might be defined in the project Makefile */
 #ifdef PROJECT_CONF_H
@@ -54,6 +54,7 @@
 
 #include "contiki.h"
 #include "net/netstack.h"
+#include "sys/boot-profile.h"
 
 #include "ctk/ctk.h"
 #include "ctk/ctk-curses.h"
@@ -78,9 +79,59 @@
 #define SELECT_MAX 8
 #endif
 
+/* Wait for file descriptors with epoll (Linux) or kqueue (BSD, macOS)
+   instead of select(). The descriptors are then only registered with
+   the kernel when the interest of a callback changes, and only the
+   callbacks of ready descriptors are called. */
+#ifdef SELECT_CONF_EPOLL
+#define SELECT_EPOLL SELECT_CONF_EPOLL
+#else
+#define SELECT_EPOLL 0
+#endif
+
+/* The longest time, in milliseconds, to wait for file descriptors when
+   no events are pending. The wait ends earlier when an etimer expires. */
+#ifdef SELECT_CONF_MAX_WAIT
+#define SELECT_MAX_WAIT SELECT_CONF_MAX_WAIT
+#else
+#define SELECT_MAX_WAIT 1
+#endif
+
+/* Never sleep: check the file descriptors and run the processes in a
+   loop, for the lowest latency at the cost of a busy CPU. */
+#ifdef SELECT_CONF_BUSY_POLL
+#define SELECT_BUSY_POLL SELECT_CONF_BUSY_POLL
+#else
+#define SELECT_BUSY_POLL 0
+#endif
+
+#if SELECT_EPOLL && defined(__linux__)
+#include <sys/epoll.h>
+#define SELECT_QUEUE 1
+#elif SELECT_EPOLL && (defined(__APPLE__) || defined(__FreeBSD__) || \
+                       defined(__NetBSD__) || defined(__OpenBSD__) || \
+                       defined(__DragonFly__))
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#define SELECT_QUEUE 1
+#else
+#define SELECT_QUEUE 0
+#endif
+
 static const struct select_callback *select_callback[SELECT_MAX];
 static int select_max = 0;
 
+#if SELECT_QUEUE
+#define INTEREST_READ  1
+#define INTEREST_WRITE 2
+
+static int queue_fd = -1;
+static uint8_t interest[SELECT_MAX];
+
+static void queue_update(int fd, int new_interest);
+#endif /* SELECT_QUEUE */
+
 SENSORS(&pir_sensor, &vib_sensor, &button_sensor);
 
 static uint8_t serial_id[] = {0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08};
@@ -99,6 +150,12 @@ select_set_callback(int fd, const struct select_callback *callback)
       callback = NULL;
     }
 
+#if SELECT_QUEUE
+    if(callback == NULL) {
+      queue_update(fd, 0);
+    }
+#endif /* SELECT_QUEUE */
+
     select_callback[fd] = callback;
 
     /* Update fd max */
@@ -120,6 +177,165 @@ select_set_callback(int fd, const struct select_callback *callback)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if SELECT_QUEUE
+static void
+queue_update(int fd, int new_interest)
+{
+  int old_interest;
+
+  old_interest = interest[fd];
+  if(new_interest == old_interest) {
+    return;
+  }
+  interest[fd] = new_interest;
+
+#ifdef __linux__
+  {
+    struct epoll_event ev;
+    int op;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = ((new_interest & INTEREST_READ) ? EPOLLIN : 0) |
+      ((new_interest & INTEREST_WRITE) ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+
+    if(new_interest == 0) {
+      /* Fails harmlessly if the descriptor has already been closed. */
+      epoll_ctl(queue_fd, EPOLL_CTL_DEL, fd, &ev);
+      return;
+    }
+
+    op = old_interest == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if(epoll_ctl(queue_fd, op, fd, &ev) < 0) {
+      /* A descriptor that was closed and reopened is no longer
+         registered, and one that was never removed still is. */
+      if(errno == ENOENT) {
+        op = EPOLL_CTL_ADD;
+      } else if(errno == EEXIST) {
+        op = EPOLL_CTL_MOD;
+      } else {
+        perror("epoll_ctl");
+        return;
+      }
+      if(epoll_ctl(queue_fd, op, fd, &ev) < 0) {
+        perror("epoll_ctl");
+      }
+    }
+  }
+#else /* __linux__ */
+  {
+    struct kevent changes[2];
+    int n;
+
+    n = 0;
+    if((new_interest ^ old_interest) & INTEREST_READ) {
+      EV_SET(&changes[n++], fd, EVFILT_READ,
+             (new_interest & INTEREST_READ) ? EV_ADD : EV_DELETE, 0, 0, 0);
+    }
+    if((new_interest ^ old_interest) & INTEREST_WRITE) {
+      EV_SET(&changes[n++], fd, EVFILT_WRITE,
+             (new_interest & INTEREST_WRITE) ? EV_ADD : EV_DELETE, 0, 0, 0);
+    }
+    if(kevent(queue_fd, changes, n, NULL, 0, NULL) < 0 && new_interest != 0) {
+      perror("kevent");
+    }
+  }
+#endif /* __linux__ */
+}
+/*---------------------------------------------------------------------------*/
+/* Waits for the descriptors set in rset and wset, and calls the callbacks
+   of those that are ready. Returns like select(). */
+static int
+queue_wait(fd_set *rset, fd_set *wset, int maxfd, int timeout)
+{
+  int i, j, fd, n;
+  int ready[SELECT_MAX];
+
+  for(i = 0; i < SELECT_MAX; i++) {
+    if(i <= maxfd && select_callback[i] != NULL) {
+      queue_update(i, (FD_ISSET(i, rset) ? INTEREST_READ : 0) |
+                   (FD_ISSET(i, wset) ? INTEREST_WRITE : 0));
+    } else if(interest[i] != 0) {
+      queue_update(i, 0);
+    }
+  }
+
+  FD_ZERO(rset);
+  FD_ZERO(wset);
+
+#ifdef __linux__
+  {
+    struct epoll_event events[SELECT_MAX];
+
+    n = epoll_wait(queue_fd, events, SELECT_MAX, timeout);
+    for(i = 0; i < n; i++) {
+      fd = events[i].data.fd;
+      if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        FD_SET(fd, rset);
+      }
+      if(events[i].events & (EPOLLOUT | EPOLLERR)) {
+        FD_SET(fd, wset);
+      }
+      ready[i] = fd;
+    }
+  }
+#else /* __linux__ */
+  {
+    struct kevent events[SELECT_MAX];
+    struct timespec ts;
+
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (timeout % 1000) * 1000000L;
+    n = kevent(queue_fd, NULL, 0, events, SELECT_MAX, &ts);
+    for(i = 0; i < n; i++) {
+      fd = (int)events[i].ident;
+      if(events[i].filter == EVFILT_READ) {
+        FD_SET(fd, rset);
+      } else {
+        FD_SET(fd, wset);
+      }
+      ready[i] = fd;
+    }
+  }
+#endif /* __linux__ */
+
+  for(i = 0; i < n; i++) {
+    fd = ready[i];
+    /* A descriptor that is ready for both reading and writing is
+       reported twice by kqueue. */
+    for(j = 0; j < i && ready[j] != fd; j++);
+    if(j == i && select_callback[fd] != NULL) {
+      select_callback[fd]->handle_fd(rset, wset);
+    }
+  }
+  return n;
+}
+#endif /* SELECT_QUEUE */
+/*---------------------------------------------------------------------------*/
+/* Returns the time, in milliseconds, to wait for file descriptors. */
+static int
+wait_time(int events_pending)
+{
+  long ticks;
+  int ms;
+
+  if(events_pending || SELECT_BUSY_POLL) {
+    return 0;
+  }
+
+  ms = SELECT_MAX_WAIT;
+  if(etimer_pending()) {
+    ticks = (long)(etimer_next_expiration_time() - clock_time());
+    if(ticks <= 0) {
+      return 0;
+    }
+    if(ticks < (long)ms * CLOCK_SECOND / 1000) {
+      ms = (ticks * 1000 + CLOCK_SECOND - 1) / CLOCK_SECOND;
+    }
+  }
+  return ms;
+}
+/*---------------------------------------------------------------------------*/
 static int
 stdin_set_fd(fd_set *rset, fd_set *wset)
 {
@@ -205,6 +421,7 @@ main(int argc, char **argv)
   process_start(&etimer_process, NULL);
   ctimer_init();
   rtimer_init();
+  BOOT_PROFILE_MARK(BOOT_PROFILE_START);
 
 #if WITH_GUI
   process_start(&ctk_process, NULL);
@@ -249,6 +466,22 @@ main(int argc, char **argv)
   /* Make standard output unbuffered. */
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
+#if SELECT_QUEUE
+#ifdef __linux__
+  queue_fd = epoll_create(SELECT_MAX);
+  if(queue_fd < 0) {
+    perror("epoll_create");
+    return 1;
+  }
+#else /* __linux__ */
+  queue_fd = kqueue();
+  if(queue_fd < 0) {
+    perror("kqueue");
+    return 1;
+  }
+#endif /* __linux__ */
+#endif /* SELECT_QUEUE */
+
   select_set_callback(STDIN_FILENO, &stdin_fd);
   while(1) {
     fd_set fdr;
@@ -256,12 +489,11 @@ main(int argc, char **argv)
     int maxfd;
     int i;
     int retval;
-    struct timeval tv;
+    int timeout;
 
     retval = process_run();
 
-    tv.tv_sec = 0;
-    tv.tv_usec = retval ? 1 : 1000;
+    timeout = wait_time(retval);
 
     FD_ZERO(&fdr);
     FD_ZERO(&fdw);
@@ -272,7 +504,20 @@ main(int argc, char **argv)
       }
     }
 
-    retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
+#if SELECT_QUEUE
+    retval = queue_wait(&fdr, &fdw, maxfd, timeout);
+    if(retval < 0 && errno != EINTR) {
+      perror("wait");
+    }
+#else /* SELECT_QUEUE */
+    {
+      struct timeval tv;
+
+      tv.tv_sec = timeout / 1000;
+      tv.tv_usec = (timeout % 1000) * 1000;
+
+      retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
+    }
     if(retval < 0) {
       if(errno != EINTR) {
         perror("select");
@@ -285,6 +530,7 @@ main(int argc, char **argv)
         }
       }
     }
+#endif /* SELECT_QUEUE */
 
     etimer_request_poll();
 
@@ -53,6 +53,7 @@
 #include "cfs-coffee-arch.h"
 #include "cfs/cfs-coffee.h"
 #include "sys/autostart.h"
+#include "sys/tickless.h"
 
 #if UIP_CONF_ROUTER
 
@@ -441,6 +442,11 @@ main(int argc, char **argv)
       }
 #endif
       
+#if TICKLESS_ON
+      /* Do not wake up on clock ticks before the next etimer expires. */
+      tickless_sleep_prepare();
+#endif /* TICKLESS_ON */
+
       /* Re-enable interrupts and go to sleep atomically. */
       ENERGEST_SWITCH(ENERGEST_TYPE_CPU, ENERGEST_TYPE_LPM);
       /* We only want to measure the processing done in IRQs when we
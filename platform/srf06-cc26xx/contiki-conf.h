@@ -226,6 +226,11 @@
 #define UIP_CONF_UDP                         1
 #define UIP_CONF_UDP_CHECKSUMS               1
 #define UIP_CONF_ICMP6                       1
+
+/* Sum checksums a 32-bit word at a time */
+#ifndef IP_CHKSUM_CONF_WORD
+#define IP_CHKSUM_CONF_WORD                  1
+#endif
 /*---------------------------------------------------------------------------*/
 #else /* NETSTACK_CONF_WITH_IPV6 */
 /* Network setup for non-IPv6 (rime). */
@@ -52,6 +52,7 @@
 
 #include "sys/node-id.h"
 #include "sys/autostart.h"
+#include "sys/tickless.h"
 
 #if UIP_CONF_ROUTER
 
@@ -426,6 +427,11 @@ main(int argc, char **argv)
     } else {
       static unsigned long irq_energest = 0;
 
+#if TICKLESS_ON
+      /* Do not wake up on clock ticks before the next etimer expires. */
+      tickless_sleep_prepare();
+#endif /* TICKLESS_ON */
+
       /* Re-enable interrupts and go to sleep atomically. */
       ENERGEST_SWITCH(ENERGEST_TYPE_CPU, ENERGEST_TYPE_LPM);
       /* We only want to measure the processing done in IRQs when we
@@ -188,6 +188,11 @@
 
 #define UIP_CONF_TCP_SPLIT       0
 
+/* No AES hardware in use: look up the doubling in MixColumn */
+#ifndef AES_128_CONF_IMPL
+#define AES_128_CONF_IMPL AES_128_IMPL_XTIME
+#endif /* AES_128_CONF_IMPL */
+
 #ifdef PROJECT_CONF_H
 #include PROJECT_CONF_H
 #endif /* PROJECT_CONF_H */
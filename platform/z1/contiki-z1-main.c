@@ -57,6 +57,7 @@
 #include "cfs-coffee-arch.h"
 #include "cfs/cfs-coffee.h"
 #include "sys/autostart.h"
+#include "sys/tickless.h"
 
 #include "dev/battery-sensor.h"
 #include "dev/button-sensor.h"
@@ -454,6 +455,11 @@ main(int argc, char **argv)
       }
 #endif
 
+#if TICKLESS_ON
+      /* Do not wake up on clock ticks before the next etimer expires. */
+      tickless_sleep_prepare();
+#endif /* TICKLESS_ON */
+
       /* Re-enable interrupts and go to sleep atomically. */
       ENERGEST_SWITCH(ENERGEST_TYPE_CPU, ENERGEST_TYPE_LPM);
       /* We only want to measure the processing done in IRQs when we
@@ -0,0 +1,144 @@
+/*
+ * RPL convergence benchmark.
+ *
+ * The simulation holds the root, mote 1. This script adds the other
+ * motes on a jittered grid around it, as many as the number that ends
+ * the simulation title. It measures, for each node:
+ *  - the time it joined the DODAG, from its "Joined" line,
+ *  - the time the root learned a route to it, from the root's "Route"
+ *    line, and so the DAO latency,
+ *  - its parent switches and control traffic, from its last "Stats"
+ *    line.
+ * Once every node has joined and has a route, the network runs for
+ * SETTLE_TIME more and the results are written to
+ * rpl-benchmark-<nodes>.csv.
+ */
+TIMEOUT(7200000, timedOut()); /* 2 hours */
+
+var SPACING = 30.0; /* metres between grid positions, the range is 50 */
+var SETTLE_TIME = 600000; /* 10 minutes */
+
+var title = sim.getTitle();
+var nrMotes = parseInt(title.substring(title.lastIndexOf(" ") + 1));
+var random = sim.getRandomGenerator();
+
+var joinTime = {};  /* mote id -> ms */
+var addrToId = {};  /* address -> mote id */
+var routeTime = {}; /* address -> ms */
+var stats = {};     /* mote id -> last Stats line */
+var nrJoined = 0;
+var nrRoutes = 0;
+var convergedTime = -1;
+
+function median(values) {
+  if(values.length == 0) {
+    return -1;
+  }
+  values.sort(function(a, b) { return a - b; });
+  return values[Math.floor(values.length / 2)];
+}
+
+function statsField(line, name) {
+  var fields = line.split(" ");
+  for(var i = 1; i + 1 < fields.length; i++) {
+    if(fields[i] == name) {
+      return parseInt(fields[i + 1]);
+    }
+  }
+  return -1;
+}
+
+function writeResults() {
+  var file = "rpl-benchmark-" + nrMotes + ".csv";
+  var out = new java.io.PrintWriter(new java.io.FileWriter(file));
+  var joins = [], latencies = [];
+  var switches = 0, bytes = 0;
+
+  out.println("id,join_ms,route_ms,dao_latency_ms,parent_switches," +
+              "dio_sent,dis_sent,dao_sent,dao_ack_sent,control_bytes");
+  for(var id = 1; id <= nrMotes; id++) {
+    var join = id in joinTime ? joinTime[id] : -1;
+    var route = -1;
+    for(var addr in addrToId) {
+      if(addrToId[addr] == id && addr in routeTime) {
+        route = routeTime[addr];
+      }
+    }
+    var line = id in stats ? stats[id] : "";
+    if(join >= 0) {
+      joins.push(join);
+    }
+    if(join >= 0 && route >= 0) {
+      latencies.push(route - join);
+    }
+    if(line != "") {
+      switches += Math.max(statsField(line, "switches"), 0);
+      bytes += statsField(line, "bytes");
+    }
+    out.println(id + "," + join + "," + route + "," +
+                (join >= 0 && route >= 0 ? route - join : -1) + "," +
+                statsField(line, "switches") + "," +
+                statsField(line, "dio") + "," + statsField(line, "dis") + "," +
+                statsField(line, "dao") + "," + statsField(line, "dao-ack") + "," +
+                statsField(line, "bytes"));
+  }
+  out.close();
+
+  log.log("Nodes " + nrMotes + ", joined " + nrJoined +
+          ", routes at the root " + nrRoutes + "\n");
+  log.log("DODAG formation " + (joins.length > 0 ? Math.max.apply(null, joins) : -1) +
+          " ms, median join " + median(joins) + " ms\n");
+  log.log("Median DAO latency " + median(latencies) + " ms\n");
+  log.log("Parent switches " + switches + ", control bytes per node " +
+          Math.round(bytes / nrMotes) + "\n");
+  log.log("Results written to " + file + "\n");
+}
+
+function timedOut() {
+  log.log("The network did not converge\n");
+  writeResults();
+}
+
+/* Place the nodes around the root */
+var side = Math.ceil(Math.sqrt(nrMotes));
+var nodeType = sim.getMoteTypes()[1];
+for(var i = 2; i <= nrMotes; i++) {
+  var m = nodeType.generateMote(sim);
+  var x = ((i - 1) % side - (side - 1) / 2) * SPACING;
+  var y = (Math.floor((i - 1) / side) - (side - 1) / 2) * SPACING;
+  m.getInterfaces().getMoteID().setMoteID(i);
+  m.getInterfaces().getPosition().setCoordinates(
+    x + (random.nextDouble() - 0.5) * SPACING / 2,
+    y + (random.nextDouble() - 0.5) * SPACING / 2, 0);
+  sim.addMote(m);
+}
+var startTime = sim.getSimulationTimeMillis();
+log.log("Added " + (nrMotes - 1) + " nodes\n");
+
+while(true) {
+  YIELD();
+  var now = sim.getSimulationTimeMillis() - startTime;
+  if(msg.startsWith("Joined ") && !(id in joinTime)) {
+    joinTime[id] = now;
+    addrToId[msg.split(" ")[1]] = id;
+    nrJoined++;
+  } else if(id == 1 && msg.startsWith("Route ")) {
+    var addr = msg.split(" ")[1];
+    if(!(addr in routeTime)) {
+      routeTime[addr] = now;
+      nrRoutes++;
+    }
+  } else if(msg.startsWith("Stats ")) {
+    stats[id] = msg;
+  } else if(msg.equals("settled")) {
+    writeResults();
+    log.testOK();
+  }
+
+  if(convergedTime < 0 && nrJoined == nrMotes - 1 &&
+     nrRoutes >= nrMotes - 1) {
+    convergedTime = now;
+    log.log("Converged after " + now + " ms\n");
+    GENERATE_MSG(SETTLE_TIME, "settled");
+  }
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         A node of the RPL benchmark. Prints its address when it first
+ *         joins a DAG, and its RPL statistics once a minute.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ip/uip-debug.h"
+#include "net/rpl/rpl-private.h"
+
+#include <stdio.h>
+
+#define STATS_INTERVAL (60 * CLOCK_SECOND)
+
+static struct uip_ds6_notification notification;
+static uint8_t joined;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(node_process, "RPL benchmark node");
+AUTOSTART_PROCESSES(&node_process);
+/*---------------------------------------------------------------------------*/
+static void
+route_callback(int event, uip_ipaddr_t *route, uip_ipaddr_t *nexthop,
+               int num_routes)
+{
+  uip_ds6_addr_t *addr;
+
+  if(event == UIP_DS6_NOTIFICATION_DEFRT_ADD && !joined) {
+    /* RPL configures the global address before the default route */
+    addr = uip_ds6_get_global(-1);
+    if(addr != NULL) {
+      joined = 1;
+      printf("Joined ");
+      uip_debug_ipaddr_print(&addr->ipaddr);
+      printf("\n");
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(node_process, ev, data)
+{
+  static struct etimer stats_timer;
+
+  PROCESS_BEGIN();
+
+  uip_ds6_notification_add(&notification, route_callback);
+
+  /* Spread the statistics of the nodes over the interval */
+  etimer_set(&stats_timer, STATS_INTERVAL / 2 +
+             random_rand() % (STATS_INTERVAL / 2));
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&stats_timer));
+    etimer_set(&stats_timer, STATS_INTERVAL);
+    printf("Stats switches %u dio %u dis %u dao %u dao-ack %u bytes %lu\n",
+           rpl_stats.parent_switch, rpl_stats.dio_sent, rpl_stats.dis_sent,
+           rpl_stats.dao_sent, rpl_stats.dao_ack_sent,
+           (unsigned long)rpl_stats.control_bytes_sent);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
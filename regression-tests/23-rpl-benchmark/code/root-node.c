@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         The root of the RPL benchmark. Prints a line for every route
+ *         it learns, and its RPL statistics once a minute.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ip/uip-debug.h"
+#include "net/rpl/rpl-private.h"
+
+#include <stdio.h>
+
+#define STATS_INTERVAL (60 * CLOCK_SECOND)
+
+static struct uip_ds6_notification notification;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(root_node_process, "RPL benchmark root");
+AUTOSTART_PROCESSES(&root_node_process);
+/*---------------------------------------------------------------------------*/
+static void
+route_callback(int event, uip_ipaddr_t *route, uip_ipaddr_t *nexthop,
+               int num_routes)
+{
+  if(event == UIP_DS6_NOTIFICATION_ROUTE_ADD) {
+    printf("Route ");
+    uip_debug_ipaddr_print(route);
+    printf(" %d\n", num_routes);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+create_rpl_dag(void)
+{
+  uip_ipaddr_t ipaddr;
+  rpl_dag_t *dag;
+
+  uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+  uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
+
+  rpl_set_root(RPL_DEFAULT_INSTANCE, &ipaddr);
+  dag = rpl_get_any_dag();
+  uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  rpl_set_prefix(dag, &ipaddr, 64);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(root_node_process, ev, data)
+{
+  static struct etimer stats_timer;
+
+  PROCESS_BEGIN();
+
+  uip_ds6_notification_add(&notification, route_callback);
+  create_rpl_dag();
+
+  etimer_set(&stats_timer, STATS_INTERVAL);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&stats_timer));
+    etimer_reset(&stats_timer);
+    printf("Stats routes %d dio %u dis %u dao %u dao-ack %u bytes %lu\n",
+           uip_ds6_route_num_routes(), rpl_stats.dio_sent,
+           rpl_stats.dis_sent, rpl_stats.dao_sent, rpl_stats.dao_ack_sent,
+           (unsigned long)rpl_stats.control_bytes_sent);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
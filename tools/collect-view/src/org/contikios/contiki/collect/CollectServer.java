@@ -444,6 +444,15 @@ public class CollectServer implements SerialConnectionListener {
             return data.getLatency();
           }
         },
+        new BarChartPanel(this, NETWORK, "Latency Breakdown (Per Node)", "Average Path Latency",
+            "Nodes", "Milliseconds", new String[] { "Queueing", "Link Retries" }) {
+          protected void addSensorData(SensorData data) {
+            Node node = data.getNode();
+            SensorDataAggregator sda = node.getSensorDataAggregator();
+            dataset.addValue(sda.getAverageQueueTime(), categories[0], node.getName());
+            dataset.addValue(sda.getAverageTransmissionTime(), categories[1], node.getName());
+          }
+        },
         new AggregatedTimeChartPanel<Node>(this, NETWORK,
             "Received (Over Time)", "Time", "Received Packets") {
           {
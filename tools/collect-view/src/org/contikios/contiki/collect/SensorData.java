@@ -119,8 +119,10 @@ public class SensorData implements SensorInfo {
   public static SensorData parseSensorData(CollectServer server, String line, long systemTime) {
     String[] components = line.trim().split("[ \t]+");
     // Check if COOJA log
-    if (components.length == VALUES_COUNT + 2 && components[1].startsWith("ID:")) {
-      if (!components[2].equals("" + VALUES_COUNT)) {
+    if ((components.length == VALUES_COUNT + 2
+        || components.length == HOP_TIMING_VALUES_COUNT + 2)
+        && components[1].startsWith("ID:")) {
+      if (!components[2].equals("" + (components.length - 2))) {
         // Ignore non sensor data
         return null;
       }
@@ -140,12 +142,13 @@ public class SensorData implements SensorInfo {
         // First column does not seem to be system time
       }
     }
-    if (components.length != SensorData.VALUES_COUNT) {
+    if (components.length != SensorData.VALUES_COUNT
+        && components.length != SensorData.HOP_TIMING_VALUES_COUNT) {
       return null;
     }
     // Sensor data line (probably)
     int[] data = parseToInt(components);
-    if (data == null || data[0] != VALUES_COUNT) {
+    if (data == null || data[0] != components.length) {
       System.err.println("Failed to parse data line: '" + line + "'");
       return null;
     }
@@ -216,6 +219,20 @@ public class SensorData implements SensorInfo {
     return values[LATENCY] / 32678.0;
   }
 
+  public boolean hasHopTiming() {
+    return values.length >= HOP_TIMING_VALUES_COUNT;
+  }
+
+  /* Milliseconds spent in send queues along the path */
+  public int getQueueTime() {
+    return hasHopTiming() ? values[QUEUE_TIME] : 0;
+  }
+
+  /* Milliseconds spent on unacknowledged transmissions along the path */
+  public int getTransmissionTime() {
+    return hasHopTiming() ? values[TX_TIME] : 0;
+  }
+
   public double getHumidity() {
     double v = -4.0 + 405.0 * values[HUMIDITY] / 10000.0;
     if(v > 100) {
@@ -57,6 +57,9 @@ public class SensorDataAggregator implements SensorInfo {
   private int lastNextHop = -1;
   private long shortestPeriod = Long.MAX_VALUE;
   private long longestPeriod = 0;
+  private int hopTimingCount = 0;
+  private long queueTime = 0;
+  private long transmissionTime = 0;
 
   public SensorDataAggregator(Node node) {
     this.node = node;
@@ -140,6 +143,11 @@ public class SensorDataAggregator implements SensorInfo {
       for (int i = 0, n = Math.min(VALUES_COUNT, data.getValueCount()); i < n; i++) {
         values[i] += data.getValue(i);
       }
+      if (data.hasHopTiming()) {
+        hopTimingCount++;
+        queueTime += data.getQueueTime();
+        transmissionTime += data.getTransmissionTime();
+      }
 
       if (node.getSensorDataCount() > 1) {
         long timeDiff = data.getNodeTime() - node.getSensorData(node.getSensorDataCount() - 2).getNodeTime();
@@ -195,6 +203,9 @@ public class SensorDataAggregator implements SensorInfo {
     seqnoDelta = 0;
     shortestPeriod = Long.MAX_VALUE;
     longestPeriod = 0;
+    hopTimingCount = 0;
+    queueTime = 0;
+    transmissionTime = 0;
   }
 
   public String toString() {
@@ -252,6 +263,16 @@ public class SensorDataAggregator implements SensorInfo {
     return getAverageValue(LATENCY) / 4096.0;
   }
 
+  /* Average milliseconds spent in send queues along the path */
+  public double getAverageQueueTime() {
+    return hopTimingCount > 0 ? (double)queueTime / hopTimingCount : 0;
+  }
+
+  /* Average milliseconds spent on link-layer retries along the path */
+  public double getAverageTransmissionTime() {
+    return hopTimingCount > 0 ? (double)transmissionTime / hopTimingCount : 0;
+  }
+
   public double getAverageHumidity() {
     double v = 0.0;
     if (dataCount > 0) {
@@ -82,4 +82,9 @@ public interface SensorInfo {
 
   public static final int VALUES_COUNT = 30;
 
+  /* Appended by sinks built with COLLECT_CONF_HOP_TIMING */
+  public static final int QUEUE_TIME = 30;
+  public static final int TX_TIME = 31;
+  public static final int HOP_TIMING_VALUES_COUNT = 32;
+
 }
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/*
+ * Creates a patch that turns one image into another, for apps/delta:
+ *
+ *   delta-diff old.bin new.bin update.patch
+ *
+ * The new image is described with runs of bytes copied from the old
+ * image and bytes inserted as they are. Runs are found through a hash
+ * table of the old image. After a changed byte, the tool first tries to
+ * continue at the same offset in the old image, which makes changed
+ * addresses in otherwise unchanged code cheap. See apps/delta/delta.h
+ * for the patch format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DELTA_MAGIC           "CDLT"
+#define DELTA_COPY            1
+#define DELTA_INSERT          2
+#define DELTA_SEEK            3
+
+#define HASH_BITS             16
+#define HASH_LENGTH           4
+#define MAX_CANDIDATES        64
+/* The shortest runs that are worth a SEEK at the same offset and at
+   another offset in the old image. */
+#define MIN_ALIGNED_RUN       4
+#define MIN_RUN               8
+
+static unsigned char *old_image, *new_image;
+static long old_size, new_size;
+static long *head, *next;
+static FILE *out;
+static long patch_size;
+/*---------------------------------------------------------------------------*/
+static unsigned short
+crc16_add(unsigned char b, unsigned short acc)
+{
+  acc ^= b;
+  acc  = (acc >> 8) | (acc << 8);
+  acc ^= (acc & 0xff00) << 4;
+  acc ^= (acc >> 8) >> 4;
+  acc ^= (acc & 0xff00) >> 5;
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+crc16_data(const unsigned char *data, long len)
+{
+  unsigned short acc;
+
+  for(acc = 0; len > 0; len--) {
+    acc = crc16_add(*data++, acc);
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned char *
+read_file(const char *name, long *size)
+{
+  FILE *f;
+  unsigned char *buf;
+
+  f = fopen(name, "rb");
+  if(f == NULL) {
+    perror(name);
+    exit(1);
+  }
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f);
+  rewind(f);
+  buf = malloc(*size + 1);
+  if(buf == NULL || fread(buf, 1, *size, f) != (size_t)*size) {
+    fprintf(stderr, "%s: read error\n", name);
+    exit(1);
+  }
+  fclose(f);
+  return buf;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_bytes(const void *data, long length)
+{
+  if(fwrite(data, 1, length, out) != (size_t)length) {
+    perror("write");
+    exit(1);
+  }
+  patch_size += length;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_uint(unsigned long value, int bytes)
+{
+  unsigned char buf[4];
+  int i;
+
+  for(i = 0; i < bytes; i++) {
+    buf[i] = value >> (8 * i);
+  }
+  put_bytes(buf, bytes);
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_command(int code, unsigned long argument)
+{
+  unsigned char c;
+
+  c = code;
+  put_bytes(&c, 1);
+  do {
+    c = argument & 0x7f;
+    argument >>= 7;
+    if(argument != 0) {
+      c |= 0x80;
+    }
+    put_bytes(&c, 1);
+  } while(argument != 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_seek(long distance)
+{
+  if(distance > 0) {
+    put_command(DELTA_SEEK, 2 * distance);
+  } else if(distance < 0) {
+    put_command(DELTA_SEEK, -2 * distance - 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash(const unsigned char *p)
+{
+  unsigned long h;
+
+  h = p[0] | (p[1] << 8) | ((unsigned long)p[2] << 16) |
+    ((unsigned long)p[3] << 24);
+  return ((h * 2654435761UL) & 0xffffffffUL) >> (32 - HASH_BITS);
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_old_image(void)
+{
+  long i;
+
+  head = malloc(sizeof(long) << HASH_BITS);
+  next = malloc(sizeof(long) * (old_size + 1));
+  if(head == NULL || next == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  for(i = 0; i < 1L << HASH_BITS; i++) {
+    head[i] = -1;
+  }
+  for(i = 0; i + HASH_LENGTH <= old_size; i++) {
+    next[i] = head[hash(&old_image[i])];
+    head[hash(&old_image[i])] = i;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static long
+run_length(long old_offset, long new_offset)
+{
+  long n;
+
+  if(old_offset < 0) {
+    return 0;
+  }
+  for(n = 0; old_offset + n < old_size && new_offset + n < new_size &&
+        old_image[old_offset + n] == new_image[new_offset + n]; n++);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the longest run in the old image that matches the new image at
+   an offset. */
+static long
+find_run(long new_offset, long *old_offset)
+{
+  long candidate, n, best;
+  int i;
+
+  best = 0;
+  if(new_offset + HASH_LENGTH > new_size) {
+    return 0;
+  }
+  candidate = head[hash(&new_image[new_offset])];
+  for(i = 0; candidate >= 0 && i < MAX_CANDIDATES; i++) {
+    n = run_length(candidate, new_offset);
+    if(n > best) {
+      best = n;
+      *old_offset = candidate;
+    }
+    candidate = next[candidate];
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  long old_offset, new_offset, inserted, n, candidate;
+
+  if(argc != 4) {
+    fprintf(stderr, "usage: %s old-image new-image patch\n", argv[0]);
+    return 1;
+  }
+
+  old_image = read_file(argv[1], &old_size);
+  new_image = read_file(argv[2], &new_size);
+  index_old_image();
+
+  out = fopen(argv[3], "wb");
+  if(out == NULL) {
+    perror(argv[3]);
+    return 1;
+  }
+
+  put_bytes(DELTA_MAGIC, 4);
+  put_uint(old_size, 4);
+  put_uint(new_size, 4);
+  put_uint(crc16_data(old_image, old_size), 2);
+  put_uint(crc16_data(new_image, new_size), 2);
+
+  old_offset = 0;
+  inserted = 0;
+  for(new_offset = 0; new_offset < new_size;) {
+    candidate = old_offset + inserted;
+    n = run_length(candidate, new_offset);
+    if(n < MIN_ALIGNED_RUN && n < new_size - new_offset) {
+      n = find_run(new_offset, &candidate);
+      if(n < MIN_RUN && n < new_size - new_offset) {
+        /* No run here; insert the byte. */
+        inserted++;
+        new_offset++;
+        continue;
+      }
+    }
+
+    if(inserted > 0) {
+      put_command(DELTA_INSERT, inserted);
+      put_bytes(&new_image[new_offset - inserted], inserted);
+      inserted = 0;
+    }
+    put_seek(candidate - old_offset);
+    put_command(DELTA_COPY, n);
+    old_offset = candidate + n;
+    new_offset += n;
+  }
+  if(inserted > 0) {
+    put_command(DELTA_INSERT, inserted);
+    put_bytes(&new_image[new_offset - inserted], inserted);
+  }
+
+  if(fclose(out) != 0) {
+    perror(argv[3]);
+    return 1;
+  }
+  fprintf(stderr, "%ld bytes to %ld bytes with a patch of %ld bytes\n",
+          old_size, new_size, patch_size);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,565 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/*
+ * Appends a prelinked image to an ELF module, so that the ELF loader
+ * can copy the module into memory without relocating it on the node.
+ * The image is linked against the symbols of a specific firmware, as
+ * listed by "nm -P" in the same way as for make-symbols-nm:
+ *
+ *   msp430-nm -P firmware.sky > firmware.nm
+ *   elf-prelink firmware.nm module.ce module.pce
+ *
+ * The addresses of the module's text and data are taken from the
+ * textmemory and datamemory_aligned symbols of the firmware, unless
+ * they are given with the -t and -d options. The ELF loader falls
+ * back to the ELF sections when the image does not match the firmware
+ * that it runs on. See core/loader/elfloader.h for the image format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PRELINK_MAGIC         "CPLK"
+#define PRELINK_VERSION       1
+#define PRELINK_HEADER_SIZE   24
+#define MAX_NAME_LENGTH       29
+#define MAX_IMPORTS           255
+
+#define SHT_SYMTAB            2
+#define SHT_RELA              4
+
+#define EM_386                3
+#define EM_MSP430             105
+#define EM_MSP430_OLD         0x1059
+
+#define R_386_NONE            0
+#define R_386_32              1
+#define R_386_PC32            2
+
+struct firmware_symbol {
+  char *name;
+  unsigned long value;
+  int global;
+};
+
+struct section {
+  unsigned int number;
+  unsigned long offset;
+  unsigned long size;
+  unsigned long address;
+  unsigned char *image;
+};
+
+struct relocations {
+  unsigned long offset;
+  unsigned long size;
+  int using_relas;
+};
+
+static struct firmware_symbol *firmware;
+static int firmware_count;
+
+static unsigned char *elf;
+static long elf_size;
+static int machine;
+
+static struct section text, rodata, data, bss;
+static struct relocations textrel, rodatarel, datarel;
+static unsigned long symtab, symtabsize, strtab;
+
+static struct {
+  char name[MAX_NAME_LENGTH + 1];
+  unsigned long value;
+} imports[MAX_IMPORTS];
+static int import_count;
+/*---------------------------------------------------------------------------*/
+static void
+fail(const char *message, const char *arg)
+{
+  fprintf(stderr, "elf-prelink: %s%s\n", message, arg);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+get(const unsigned char *ptr, int len)
+{
+  unsigned long value;
+
+  value = 0;
+  while(len-- > 0) {
+    value = (value << 8) | ptr[len];
+  }
+  return value;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put(unsigned char *ptr, int len, unsigned long value)
+{
+  while(len-- > 0) {
+    *ptr++ = value & 0xff;
+    value >>= 8;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned char *
+elf_at(unsigned long offset, unsigned long len)
+{
+  if(offset + len > (unsigned long)elf_size) {
+    fail("truncated ELF file", "");
+  }
+  return elf + offset;
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_firmware_symbols(const char *filename)
+{
+  FILE *fp;
+  char line[256];
+  char name[256];
+  char type;
+  unsigned long value;
+  int size;
+
+  fp = fopen(filename, "r");
+  if(fp == NULL) {
+    fail("cannot open ", filename);
+  }
+
+  size = 0;
+  while(fgets(line, sizeof(line), fp) != NULL) {
+    if(sscanf(line, "%255s %c %lx", name, &type, &value) != 3) {
+      continue;
+    }
+    if(firmware_count == size) {
+      size = size == 0 ? 256 : size * 2;
+      firmware = realloc(firmware, size * sizeof(*firmware));
+      if(firmware == NULL) {
+        fail("out of memory", "");
+      }
+    }
+    firmware[firmware_count].name = strdup(name);
+    firmware[firmware_count].value = value;
+    /* These are the symbols that make-symbols-nm puts in the symbol
+       table of the firmware. */
+    firmware[firmware_count].global = type >= 'A' && type <= 'Z' &&
+      strcmp(name, "symbols") != 0;
+    firmware_count++;
+  }
+  fclose(fp);
+}
+/*---------------------------------------------------------------------------*/
+static struct firmware_symbol *
+find_firmware_symbol(const char *name, int global)
+{
+  int i;
+
+  for(i = 0; i < firmware_count; i++) {
+    if((firmware[i].global || !global) &&
+       strcmp(firmware[i].name, name) == 0) {
+      return &firmware[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_module(const char *filename)
+{
+  FILE *fp;
+
+  fp = fopen(filename, "rb");
+  if(fp == NULL) {
+    fail("cannot open ", filename);
+  }
+  fseek(fp, 0, SEEK_END);
+  elf_size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  elf = malloc(elf_size);
+  if(elf == NULL || fread(elf, 1, elf_size, fp) != (size_t)elf_size) {
+    fail("cannot read ", filename);
+  }
+  fclose(fp);
+}
+/*---------------------------------------------------------------------------*/
+static void
+find_sections(void)
+{
+  unsigned char *ehdr, *shdr;
+  unsigned long shoff, strs;
+  unsigned int shentsize, shnum, i;
+  const char *name;
+
+  ehdr = elf_at(0, 52);
+  if(memcmp(ehdr, "\177ELF\001\001\001", 7) != 0) {
+    fail("not a 32-bit little-endian ELF file", "");
+  }
+  machine = get(&ehdr[18], 2);
+  shoff = get(&ehdr[32], 4);
+  shentsize = get(&ehdr[46], 2);
+  shnum = get(&ehdr[48], 2);
+  strs = get(elf_at(shoff + shentsize * get(&ehdr[50], 2), 40) + 16, 4);
+
+  text.number = rodata.number = data.number = bss.number = -1;
+
+  /* Pick the sections in the same way as the ELF loader does. */
+  for(i = 0; i < shnum; i++) {
+    shdr = elf_at(shoff + shentsize * i, 40);
+    name = (const char *)elf_at(strs + get(&shdr[0], 4), 1);
+
+    if(get(&shdr[4], 4) == SHT_SYMTAB) {
+      symtab = get(&shdr[16], 4);
+      symtabsize = get(&shdr[20], 4);
+      strtab = get(elf_at(shoff + shentsize * get(&shdr[24], 4), 40) + 16, 4);
+    } else if(strncmp(name, ".text", 5) == 0) {
+      text.number = i;
+      text.offset = get(&shdr[16], 4);
+      text.size = get(&shdr[20], 4);
+    } else if(strncmp(name, ".rel.text", 9) == 0 ||
+              strncmp(name, ".rela.text", 10) == 0) {
+      textrel.offset = get(&shdr[16], 4);
+      textrel.size = get(&shdr[20], 4);
+      textrel.using_relas = get(&shdr[4], 4) == SHT_RELA;
+    } else if(strncmp(name, ".data", 5) == 0) {
+      data.number = i;
+      data.offset = get(&shdr[16], 4);
+      data.size = get(&shdr[20], 4);
+    } else if(strncmp(name, ".rodata", 7) == 0) {
+      rodata.number = i;
+      rodata.offset = get(&shdr[16], 4);
+      rodata.size = get(&shdr[20], 4);
+    } else if(strncmp(name, ".rel.rodata", 11) == 0 ||
+              strncmp(name, ".rela.rodata", 12) == 0) {
+      rodatarel.offset = get(&shdr[16], 4);
+      rodatarel.size = get(&shdr[20], 4);
+      rodatarel.using_relas = get(&shdr[4], 4) == SHT_RELA;
+    } else if(strncmp(name, ".rel.data", 9) == 0 ||
+              strncmp(name, ".rela.data", 10) == 0) {
+      datarel.offset = get(&shdr[16], 4);
+      datarel.size = get(&shdr[20], 4);
+      datarel.using_relas = get(&shdr[4], 4) == SHT_RELA;
+    } else if(strncmp(name, ".bss", 4) == 0) {
+      bss.number = i;
+      bss.size = get(&shdr[20], 4);
+    }
+  }
+
+  if(symtabsize == 0) {
+    fail("no symbol table", "");
+  }
+  if(text.size == 0) {
+    fail("no text section", "");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct section *
+find_section(unsigned int number)
+{
+  if(number == bss.number) {
+    return &bss;
+  } else if(number == data.number) {
+    return &data;
+  } else if(number == rodata.number) {
+    return &rodata;
+  } else if(number == text.number) {
+    return &text;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+find_local_symbol(const char *name, unsigned long *value)
+{
+  unsigned char *s;
+  unsigned long a;
+  struct section *sect;
+
+  for(a = symtab; a < symtab + symtabsize; a += 16) {
+    s = elf_at(a, 16);
+    if(get(&s[0], 4) != 0 &&
+       strcmp((const char *)elf_at(strtab + get(&s[0], 4), 1), name) == 0) {
+      sect = find_section(get(&s[14], 2));
+      if(sect == NULL) {
+        return 0;
+      }
+      *value = sect->address + get(&s[4], 4);
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_import(const char *name, unsigned long value)
+{
+  int i;
+
+  for(i = 0; i < import_count; i++) {
+    if(strcmp(imports[i].name, name) == 0) {
+      return;
+    }
+  }
+  if(import_count == MAX_IMPORTS) {
+    fail("too many imported symbols", "");
+  }
+  if(strlen(name) > MAX_NAME_LENGTH) {
+    fail("symbol name too long: ", name);
+  }
+  strcpy(imports[import_count].name, name);
+  imports[import_count].value = value;
+  import_count++;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+resolve_symbol(unsigned long symbol)
+{
+  unsigned char *s;
+  const char *name;
+  struct firmware_symbol *fs;
+  struct section *sect;
+  unsigned long value;
+
+  s = elf_at(symtab + 16 * symbol, 16);
+  if(get(&s[0], 4) != 0) {
+    name = (const char *)elf_at(strtab + get(&s[0], 4), 1);
+    fs = find_firmware_symbol(name, 1);
+    if(fs != NULL) {
+      add_import(name, fs->value);
+      return fs->value;
+    }
+    if(find_local_symbol(name, &value)) {
+      return value;
+    }
+    sect = find_section(get(&s[14], 2));
+    if(sect == NULL) {
+      fail("unknown symbol: ", name);
+    }
+  } else {
+    sect = find_section(get(&s[14], 2));
+    if(sect == NULL) {
+      fail("relocation against an unknown section", "");
+    }
+  }
+  return sect->address;
+}
+/*---------------------------------------------------------------------------*/
+static void
+relocate(struct relocations *rel, struct section *sect)
+{
+  unsigned char *r, *ptr;
+  unsigned long a, rel_size, offset, info, addr;
+  long addend;
+
+  rel_size = rel->using_relas ? 12 : 8;
+  for(a = rel->offset; a < rel->offset + rel->size; a += rel_size) {
+    r = elf_at(a, rel_size);
+    offset = get(&r[0], 4);
+    info = get(&r[4], 4);
+    if(offset + (machine == EM_386 ? 4 : 2) > sect->size) {
+      fail("relocation outside its section", "");
+    }
+    ptr = sect->image + offset;
+    addr = resolve_symbol(info >> 8);
+
+    switch(machine) {
+    case EM_MSP430:
+    case EM_MSP430_OLD:
+      /* The same relocation as in elfloader-msp430.c. */
+      addend = rel->using_relas ? (long)get(&r[8], 4) : (long)get(ptr, 2);
+      put(ptr, 2, addr + addend);
+      break;
+    case EM_386:
+      /* The same relocations as in elfloader-x86.c. */
+      addend = rel->using_relas ? (long)get(&r[8], 4) : (long)get(ptr, 4);
+      switch(info & 0xff) {
+      case R_386_NONE:
+        break;
+      case R_386_32:
+        put(ptr, 4, addr + addend);
+        break;
+      case R_386_PC32:
+        put(ptr, 4, addr + addend - (sect->address + offset));
+        break;
+      default:
+        fail("unsupported relocation type", "");
+      }
+      break;
+    default:
+      fail("unsupported machine type", "");
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse_address(const char *arg, unsigned long *value)
+{
+  char *end;
+
+  *value = strtoul(arg, &end, 0);
+  return *end == '\0';
+}
+/*---------------------------------------------------------------------------*/
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: elf-prelink [-t text-address] [-d data-address] "
+          "firmware-symbols module output\n");
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  struct firmware_symbol *fs;
+  unsigned long textaddr, dataaddr, autostart;
+  unsigned long image_offset, textsize;
+  unsigned char header[PRELINK_HEADER_SIZE];
+  unsigned char buf[4];
+  int have_text, have_data;
+  int c, i;
+  FILE *out;
+
+  have_text = have_data = 0;
+  textaddr = dataaddr = 0;
+  while((c = getopt(argc, argv, "t:d:")) != -1) {
+    switch(c) {
+    case 't':
+      have_text = parse_address(optarg, &textaddr);
+      if(!have_text) {
+        usage();
+      }
+      break;
+    case 'd':
+      have_data = parse_address(optarg, &dataaddr);
+      if(!have_data) {
+        usage();
+      }
+      break;
+    default:
+      usage();
+    }
+  }
+  if(argc - optind != 3) {
+    usage();
+  }
+
+  read_firmware_symbols(argv[optind]);
+  read_module(argv[optind + 1]);
+  find_sections();
+
+  if(!have_text) {
+    fs = find_firmware_symbol("textmemory", 0);
+    if(fs == NULL) {
+      fail("no textmemory in the firmware; use -t", "");
+    }
+    textaddr = fs->value;
+  }
+  if(!have_data) {
+    fs = find_firmware_symbol("datamemory_aligned", 0);
+    if(fs == NULL) {
+      fail("no datamemory_aligned in the firmware; use -d", "");
+    }
+    dataaddr = fs->value;
+  }
+
+  /* Lay out the sections as elfloader_load() does. */
+  textsize = text.size + rodata.size;
+  if(textsize > 0xffff || data.size + bss.size > 0xffff) {
+    fail("module too large", "");
+  }
+  text.address = textaddr;
+  rodata.address = textaddr + text.size;
+  bss.address = dataaddr;
+  data.address = dataaddr + bss.size;
+
+  text.image = calloc(1, textsize + data.size + 2);
+  if(text.image == NULL) {
+    fail("out of memory", "");
+  }
+  rodata.image = text.image + text.size;
+  data.image = text.image + textsize;
+  memcpy(text.image, elf_at(text.offset, text.size), text.size);
+  memcpy(rodata.image, elf_at(rodata.offset, rodata.size), rodata.size);
+  memcpy(data.image, elf_at(data.offset, data.size), data.size);
+
+  if(textrel.size > 0) {
+    relocate(&textrel, &text);
+  }
+  if(rodatarel.size > 0) {
+    relocate(&rodatarel, &rodata);
+  }
+  if(datarel.size > 0) {
+    relocate(&datarel, &data);
+  }
+
+  autostart = 0;
+  if(!find_local_symbol("autostart_processes", &autostart)) {
+    fprintf(stderr, "elf-prelink: warning: no autostart_processes\n");
+  }
+
+  memcpy(header, PRELINK_MAGIC, 4);
+  header[4] = PRELINK_VERSION;
+  header[5] = import_count;
+  put(&header[6], 2, textsize);
+  put(&header[8], 2, data.size);
+  put(&header[10], 2, bss.size);
+  put(&header[12], 4, textaddr);
+  put(&header[16], 4, dataaddr);
+  put(&header[20], 4, autostart);
+
+  out = fopen(argv[optind + 2], "wb");
+  if(out == NULL) {
+    fail("cannot create ", argv[optind + 2]);
+  }
+  image_offset = elf_size;
+  fwrite(elf, 1, elf_size, out);
+  fwrite(header, 1, sizeof(header), out);
+  for(i = 0; i < import_count; i++) {
+    put(buf, 4, imports[i].value);
+    fwrite(buf, 1, 4, out);
+    fwrite(imports[i].name, 1, strlen(imports[i].name) + 1, out);
+  }
+  fwrite(text.image, 1, textsize + data.size, out);
+  put(buf, 4, image_offset);
+  fwrite(buf, 1, 4, out);
+  fwrite(PRELINK_MAGIC, 1, 4, out);
+  if(fclose(out) != 0) {
+    fail("cannot write ", argv[optind + 2]);
+  }
+
+  printf("%s: %lu bytes of text, %lu bytes of data, %d imported symbols\n",
+         argv[optind + 2], textsize, data.size + bss.size, import_count);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/*
+ * Builds latency breakdowns from the output of core/net/packet-trace:
+ *
+ *   packet-trace [log...]
+ *
+ * Reads the "PT" lines printed by packet_trace_print() on one or more
+ * nodes, from files or standard input, with anything before "PT" on a
+ * line ignored so that timestamped serial logs work as they are. Prints
+ * the stages of each packet on each node it went through, relative to
+ * its first stage on that node, and then the distribution of the time
+ * spent between consecutive stages over all packets. Times on different
+ * nodes are only compared when their clocks are synchronized, which is
+ * left to the reader: the per-hop times are printed as they are.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RECORDS 100000
+#define MAX_NODES   256
+
+static const char *stage_names[] = {
+  "ip-out", "6lo-out", "mac-queue", "mac-tx", "mac-done", "mac-in", "ip-in"
+};
+#define STAGES (sizeof(stage_names) / sizeof(stage_names[0]))
+
+enum { MAC_QUEUE = 2, MAC_TX = 3, MAC_DONE = 4 };
+
+struct record {
+  unsigned node;
+  unsigned id;
+  int stage;
+  unsigned long time;
+  unsigned info;
+  int instance;
+};
+
+struct node {
+  unsigned addr;
+  unsigned long rate;
+  unsigned long lost;
+};
+
+static struct record records[MAX_RECORDS];
+static int num_records;
+static struct node nodes[MAX_NODES];
+static int num_nodes;
+static int num_instances;
+
+struct samples {
+  double *us;
+  int count;
+  int size;
+};
+static struct samples transitions[STAGES][STAGES];
+/*---------------------------------------------------------------------------*/
+static struct node *
+get_node(unsigned addr)
+{
+  int i;
+
+  for(i = 0; i < num_nodes; i++) {
+    if(nodes[i].addr == addr) {
+      return &nodes[i];
+    }
+  }
+  if(num_nodes == MAX_NODES) {
+    fprintf(stderr, "packet-trace: too many nodes\n");
+    exit(1);
+  }
+  nodes[num_nodes].addr = addr;
+  nodes[num_nodes].rate = 0;
+  nodes[num_nodes].lost = 0;
+  return &nodes[num_nodes++];
+}
+/*---------------------------------------------------------------------------*/
+static int
+stage_number(const char *name)
+{
+  unsigned i;
+
+  for(i = 0; i < STAGES; i++) {
+    if(strcmp(name, stage_names[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+parse_line(const char *line)
+{
+  const char *p;
+  unsigned addr, id, info;
+  unsigned long a, b;
+  char stage[16];
+  struct record *r;
+
+  p = strstr(line, "PT ");
+  if(p == NULL) {
+    return;
+  }
+  if(sscanf(p, "PT %x rate %lu lost %lu", &addr, &a, &b) == 3) {
+    get_node(addr)->rate = a;
+    get_node(addr)->lost += b;
+    return;
+  }
+  if(sscanf(p, "PT %x %x %15s %lu %u", &addr, &id, stage, &a, &info) != 5 ||
+     stage_number(stage) < 0) {
+    return;
+  }
+  if(num_records == MAX_RECORDS) {
+    fprintf(stderr, "packet-trace: too many records\n");
+    exit(1);
+  }
+  get_node(addr);
+  r = &records[num_records++];
+  r->node = addr;
+  r->id = id;
+  r->stage = stage_number(stage);
+  r->time = a;
+  r->info = info;
+  r->instance = -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Microseconds from a to b on the clock of a node. Clocks of 16 bits
+   or less are assumed to wrap at 65536. */
+static double
+elapsed(unsigned addr, unsigned long a, unsigned long b)
+{
+  unsigned long rate = get_node(addr)->rate;
+  unsigned long ticks;
+
+  if(b < a && a < 65536) {
+    ticks = b + 65536 - a;
+  } else {
+    ticks = b - a;
+  }
+  if(rate == 0) {
+    /* No rate line: leave the time in ticks */
+    return ticks;
+  }
+  return ticks * 1000000.0 / rate;
+}
+/*---------------------------------------------------------------------------*/
+/* Groups the records of a node and an ID into packets. An ID comes back
+   when a packet is sent again, which shows as a stage seen twice. Only
+   the MAC stages repeat within a packet, for fragments and retries. */
+static void
+assign_instances(void)
+{
+  int i, j;
+  unsigned seen;
+
+  for(i = 0; i < num_records; i++) {
+    if(records[i].instance >= 0) {
+      continue;
+    }
+    seen = 0;
+    for(j = i; j < num_records; j++) {
+      if(records[j].node != records[i].node ||
+         records[j].id != records[i].id || records[j].instance >= 0) {
+        continue;
+      }
+      if((seen & (1 << records[j].stage)) &&
+         records[j].stage != MAC_QUEUE && records[j].stage != MAC_TX &&
+         records[j].stage != MAC_DONE) {
+        break;
+      }
+      seen |= 1 << records[j].stage;
+      records[j].instance = num_instances;
+    }
+    num_instances++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_sample(int from, int to, double us)
+{
+  struct samples *s = &transitions[from][to];
+
+  if(s->count == s->size) {
+    s->size = s->size ? s->size * 2 : 64;
+    s->us = realloc(s->us, s->size * sizeof(double));
+    if(s->us == NULL) {
+      fprintf(stderr, "packet-trace: out of memory\n");
+      exit(1);
+    }
+  }
+  s->us[s->count++] = us;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_packets(void)
+{
+  int i, j, k;
+  struct record *first, *prev;
+
+  for(i = 0; i < num_records; i++) {
+    /* Each ID once, at its first record */
+    for(j = 0; j < i && records[j].id != records[i].id; j++);
+    if(j < i) {
+      continue;
+    }
+    printf("packet %04x\n", records[i].id);
+    /* Each packet with the ID, at its first record */
+    for(j = i; j < num_records; j++) {
+      if(records[j].id != records[i].id) {
+        continue;
+      }
+      for(k = i; k < j && records[k].instance != records[j].instance; k++);
+      if(k < j) {
+        continue;
+      }
+      first = prev = &records[j];
+      printf("  node %04x:", first->node);
+      for(k = j; k < num_records; k++) {
+        if(records[k].instance != first->instance) {
+          continue;
+        }
+        printf(" %s +%.0f", stage_names[records[k].stage],
+               elapsed(first->node, first->time, records[k].time));
+        if(records[k].stage == MAC_TX || records[k].stage == MAC_DONE) {
+          printf("(%u)", records[k].info);
+        }
+        if(&records[k] != prev) {
+          add_sample(prev->stage, records[k].stage,
+                     elapsed(first->node, prev->time, records[k].time));
+          prev = &records[k];
+        }
+      }
+      printf("\n");
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+compare(const void *a, const void *b)
+{
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_transitions(void)
+{
+  unsigned i, j;
+  struct samples *s;
+
+  printf("\n%-22s %8s %10s %10s %10s\n", "stages", "count", "p50", "p95", "max");
+  for(i = 0; i < STAGES; i++) {
+    for(j = 0; j < STAGES; j++) {
+      s = &transitions[i][j];
+      if(s->count == 0) {
+        continue;
+      }
+      qsort(s->us, s->count, sizeof(double), compare);
+      printf("%-9s -> %-9s %8d %10.0f %10.0f %10.0f\n",
+             stage_names[i], stage_names[j], s->count,
+             s->us[s->count / 2], s->us[(s->count * 95) / 100],
+             s->us[s->count - 1]);
+    }
+  }
+  for(i = 0; i < (unsigned)num_nodes; i++) {
+    if(nodes[i].rate == 0) {
+      fprintf(stderr, "packet-trace: no rate for node %04x, times are in ticks\n",
+              nodes[i].addr);
+    }
+    if(nodes[i].lost > 0) {
+      printf("node %04x lost %lu records\n", nodes[i].addr, nodes[i].lost);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_log(FILE *f)
+{
+  char line[256];
+
+  while(fgets(line, sizeof(line), f) != NULL) {
+    parse_line(line);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  FILE *f;
+  int i;
+
+  if(argc < 2) {
+    read_log(stdin);
+  }
+  for(i = 1; i < argc; i++) {
+    f = fopen(argv[i], "r");
+    if(f == NULL) {
+      perror(argv[i]);
+      return 1;
+    }
+    read_log(f);
+    fclose(f);
+  }
+
+  assign_instances();
+  print_packets();
+  print_transitions();
+  return 0;
+}
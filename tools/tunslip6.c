@@ -70,6 +70,14 @@ int slipfd = 0;
 uint16_t basedelay=0,delaymsec=0;
 uint32_t startsec,startmsec,delaystartsec,delaystartmsec;
 int timestamp = 0, flowcontrol=0, showprogress=0, flowcontrol_xonxoff=0;
+int batch = 0, stats_interval = 0;
+
+/* Traffic counters, printed every stats_interval seconds with -S */
+struct {
+  unsigned long tun_packets, tun_bytes;     /* tun -> slip */
+  unsigned long slip_packets, slip_bytes;   /* slip -> tun */
+  unsigned long serial_out, serial_in;      /* SLIP encoded bytes */
+} stats, last_stats;
 
 int ssystem(const char *fmt, ...)
      __attribute__((__format__ (__printf__, 1, 2)));
@@ -112,6 +120,13 @@ ssystem(const char *fmt, ...)
 #define XON           17
 #define XOFF          19
 
+/* Batched mode (-b): bytes read from serial at a time, and size of the
+   SLIP output buffer, which holds several escaped packets */
+#define BATCH_READ_SIZE 16384
+#define BATCH_BUF_SIZE  65536
+/* Output buffer space needed for one more packet from tun */
+#define TUN_ROOM        (2 * 2000 + 1)
+
 /* get sockaddr, IPv4 or IPv6: */
 void *
 get_in_addr(struct sockaddr *sa)
@@ -164,6 +179,138 @@ is_sensible_string(const unsigned char *s, int len)
   return 1;
 }
 
+/*
+ * Handle a packet received from serial: a command, a debug string or an
+ * IP packet written to tun.
+ */
+void
+slip_packet(unsigned char *inbuf, int len, int outfd)
+{
+  int i;
+
+  if(inbuf[0] == '!') {
+    if(inbuf[1] == 'M') {
+      /* Read gateway MAC address and autoconfigure tap0 interface */
+      char macs[24];
+      int i, pos;
+      for(i = 0, pos = 0; i < 16; i++) {
+	macs[pos++] = inbuf[2 + i];
+	if((i & 1) == 1 && i < 14) {
+	  macs[pos++] = ':';
+	}
+      }
+      if(timestamp) stamptime();
+      macs[pos] = '\0';
+//      printf("*** Gateway's MAC address: %s\n", macs);
+      fprintf(stderr,"*** Gateway's MAC address: %s\n", macs);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s down", tundev);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s hw ether %s", tundev, &macs[6]);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s up", tundev);
+    }
+  } else if(inbuf[0] == '?') {
+    if(inbuf[1] == 'P') {
+      /* Prefix info requested */
+      struct in6_addr addr;
+      int i;
+      char *s = strchr(ipaddr, '/');
+      if(s != NULL) {
+	*s = '\0';
+      }
+      inet_pton(AF_INET6, ipaddr, &addr);
+      if(timestamp) stamptime();
+      fprintf(stderr,"*** Address:%s => %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
+	     ipaddr,
+	     addr.s6_addr[0], addr.s6_addr[1],
+	     addr.s6_addr[2], addr.s6_addr[3],
+	     addr.s6_addr[4], addr.s6_addr[5],
+	     addr.s6_addr[6], addr.s6_addr[7]);
+      slip_send(slipfd, '!');
+      slip_send(slipfd, 'P');
+      for(i = 0; i < 8; i++) {
+	/* need to call the slip_send_char for stuffing */
+	slip_send_char(slipfd, addr.s6_addr[i]);
+      }
+      slip_send(slipfd, SLIP_END);
+    }
+#define DEBUG_LINE_MARKER '\r'
+  } else if(inbuf[0] == DEBUG_LINE_MARKER) {
+    fwrite(inbuf + 1, len - 1, 1, stdout);
+  } else if(is_sensible_string(inbuf, len)) {
+    if(verbose==1) {   /* strings already echoed below for verbose>1 */
+      if (timestamp) stamptime();
+      fwrite(inbuf, len, 1, stdout);
+    }
+  } else {
+    if(verbose>2) {
+      if (timestamp) stamptime();
+      printf("Packet from SLIP of length %d - write TUN\n", len);
+      if (verbose>4) {
+#if WIRESHARK_IMPORT_FORMAT
+	printf("0000");
+	for(i = 0; i < len; i++) printf(" %02x",inbuf[i]);
+#else
+	printf("         ");
+	for(i = 0; i < len; i++) {
+	  printf("%02x", inbuf[i]);
+	  if((i & 3) == 3) printf(" ");
+	  if((i & 15) == 15) printf("\n         ");
+	}
+#endif
+	printf("\n");
+      }
+    }
+    if(write(outfd, inbuf, len) != len) {
+      err(1, "serial_to_tun: write");
+    }
+    stats.slip_packets++;
+    stats.slip_bytes += len;
+  }
+}
+
+/*
+ * Echo lines as they are received for verbose=2,3,5+ and all printable
+ * characters for verbose==4. c is the last byte stored in inbuf; returns
+ * the new number of bytes in inbuf.
+ */
+int
+slip_echo(unsigned char *inbuf, int inbufptr, unsigned char c)
+{
+  if((verbose==2) || (verbose==3) || (verbose>4)) {
+    if(c=='\n') {
+      if(is_sensible_string(inbuf, inbufptr)) {
+        if (timestamp) stamptime();
+        fwrite(inbuf, inbufptr, 1, stdout);
+        inbufptr=0;
+      }
+    }
+  } else if(verbose==4) {
+    if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
+      fwrite(&c, 1, 1, stdout);
+      if(c=='\n') if(timestamp) stamptime();
+    }
+  }
+  return inbufptr;
+}
+
+unsigned char
+slip_unescape(unsigned char c)
+{
+  switch(c) {
+  case SLIP_ESC_END:
+    return SLIP_END;
+  case SLIP_ESC_ESC:
+    return SLIP_ESC;
+  case SLIP_ESC_XON:
+    return XON;
+  case SLIP_ESC_XOFF:
+    return XOFF;
+  }
+  return c;
+}
+
 /*
  * Read from serial, when we have a packet write it to tun. No output
  * buffering, input buffered by stdio.
@@ -175,7 +322,7 @@ serial_to_tun(FILE *inslip, int outfd)
     unsigned char inbuf[2000];
   } uip;
   static int inbufptr = 0;
-  int ret,i;
+  int ret;
   unsigned char c;
 
 #ifdef linux
@@ -202,87 +349,11 @@ serial_to_tun(FILE *inslip, int outfd)
     return;
   }
   PROGRESS(".");
+  stats.serial_in++;
   switch(c) {
   case SLIP_END:
     if(inbufptr > 0) {
-      if(uip.inbuf[0] == '!') {
-	if(uip.inbuf[1] == 'M') {
-	  /* Read gateway MAC address and autoconfigure tap0 interface */
-	  char macs[24];
-	  int i, pos;
-	  for(i = 0, pos = 0; i < 16; i++) {
-	    macs[pos++] = uip.inbuf[2 + i];
-	    if((i & 1) == 1 && i < 14) {
-	      macs[pos++] = ':';
-	    }
-	  }
-          if(timestamp) stamptime();
-	  macs[pos] = '\0';
-//	  printf("*** Gateway's MAC address: %s\n", macs);
-	  fprintf(stderr,"*** Gateway's MAC address: %s\n", macs);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s down", tundev);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s hw ether %s", tundev, &macs[6]);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s up", tundev);
-	}
-      } else if(uip.inbuf[0] == '?') {
-	if(uip.inbuf[1] == 'P') {
-          /* Prefix info requested */
-          struct in6_addr addr;
-	  int i;
-	  char *s = strchr(ipaddr, '/');
-	  if(s != NULL) {
-	    *s = '\0';
-	  }
-          inet_pton(AF_INET6, ipaddr, &addr);
-          if(timestamp) stamptime();
-          fprintf(stderr,"*** Address:%s => %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
-		 ipaddr,
-		 addr.s6_addr[0], addr.s6_addr[1],
-		 addr.s6_addr[2], addr.s6_addr[3],
-		 addr.s6_addr[4], addr.s6_addr[5],
-		 addr.s6_addr[6], addr.s6_addr[7]);
-	  slip_send(slipfd, '!');
-	  slip_send(slipfd, 'P');
-	  for(i = 0; i < 8; i++) {
-	    /* need to call the slip_send_char for stuffing */
-	    slip_send_char(slipfd, addr.s6_addr[i]);
-	  }
-	  slip_send(slipfd, SLIP_END);
-        }
-#define DEBUG_LINE_MARKER '\r'
-      } else if(uip.inbuf[0] == DEBUG_LINE_MARKER) {
-	fwrite(uip.inbuf + 1, inbufptr - 1, 1, stdout);
-      } else if(is_sensible_string(uip.inbuf, inbufptr)) {
-        if(verbose==1) {   /* strings already echoed below for verbose>1 */
-          if (timestamp) stamptime();
-          fwrite(uip.inbuf, inbufptr, 1, stdout);
-        }
-      } else {
-        if(verbose>2) {
-          if (timestamp) stamptime();
-          printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
-          if (verbose>4) {
-#if WIRESHARK_IMPORT_FORMAT
-            printf("0000");
-	        for(i = 0; i < inbufptr; i++) printf(" %02x",uip.inbuf[i]);
-#else
-            printf("         ");
-            for(i = 0; i < inbufptr; i++) {
-              printf("%02x", uip.inbuf[i]);
-              if((i & 3) == 3) printf(" ");
-              if((i & 15) == 15) printf("\n         ");
-            }
-#endif
-            printf("\n");
-          }
-        }
-	if(write(outfd, uip.inbuf, inbufptr) != inbufptr) {
-	  err(1, "serial_to_tun: write");
-	}
-      }
+      slip_packet(uip.inbuf, inbufptr, outfd);
       inbufptr = 0;
     }
     break;
@@ -295,48 +366,98 @@ serial_to_tun(FILE *inslip, int outfd)
       return;
     }
 
-    switch(c) {
-    case SLIP_ESC_END:
-      c = SLIP_END;
-      break;
-    case SLIP_ESC_ESC:
-      c = SLIP_ESC;
-      break;
-    case SLIP_ESC_XON:
-      c = XON;
-      break;
-    case SLIP_ESC_XOFF:
-      c = XOFF;
-      break;
-    }
+    c = slip_unescape(c);
     /* FALLTHROUGH */
   default:
     uip.inbuf[inbufptr++] = c;
+    inbufptr = slip_echo(uip.inbuf, inbufptr, c);
 
-    /* Echo lines as they are received for verbose=2,3,5+ */
-    /* Echo all printable characters for verbose==4 */
-    if((verbose==2) || (verbose==3) || (verbose>4)) {
-      if(c=='\n') {
-        if(is_sensible_string(uip.inbuf, inbufptr)) {
-          if (timestamp) stamptime();
-          fwrite(uip.inbuf, inbufptr, 1, stdout);
-          inbufptr=0;
-        }
+    break;
+  }
+
+  goto read_more;
+}
+
+/*
+ * Batched mode: read whatever the serial port has and decode it in one
+ * go. Without per-character echo, the runs of bytes between SLIP special
+ * characters are copied as a whole.
+ */
+void
+serial_to_tun_batch(int infd, int outfd)
+{
+  static unsigned char inbuf[2000];
+  static int inbufptr = 0;
+  static int esc = 0;
+  unsigned char buf[BATCH_READ_SIZE];
+  unsigned char *p, *q, *end;
+  unsigned char c;
+  int n, run;
+
+  n = read(infd, buf, sizeof(buf));
+  if(n == -1) {
+    if(errno == EAGAIN || errno == EINTR) {
+      return;
+    }
+    err(1, "serial_to_tun: read");
+  }
+  if(n == 0) {
+    return;
+  }
+  PROGRESS(".");
+  stats.serial_in += n;
+
+  for(p = buf, end = buf + n; p < end;) {
+    if(esc) {
+      esc = 0;
+      c = slip_unescape(*p++);
+    } else if(*p == SLIP_END) {
+      p++;
+      if(inbufptr > 0) {
+        slip_packet(inbuf, inbufptr, outfd);
+        inbufptr = 0;
       }
-    } else if(verbose==4) {
-      if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
-	fwrite(&c, 1, 1, stdout);
-        if(c=='\n') if(timestamp) stamptime();
+      continue;
+    } else if(*p == SLIP_ESC) {
+      p++;
+      esc = 1;
+      continue;
+    } else if(verbose < 2) {
+      for(q = p; q < end && *q != SLIP_END && *q != SLIP_ESC; q++);
+      while(p < q) {
+        if(inbufptr >= sizeof(inbuf)) {
+          if(timestamp) stamptime();
+          fprintf(stderr, "*** dropping large %d byte packet\n", inbufptr);
+          inbufptr = 0;
+        }
+        run = q - p;
+        if(run > sizeof(inbuf) - inbufptr) {
+          run = sizeof(inbuf) - inbufptr;
+        }
+        memcpy(inbuf + inbufptr, p, run);
+        inbufptr += run;
+        p += run;
       }
+      continue;
+    } else {
+      c = *p++;
     }
 
-    break;
+    if(inbufptr >= sizeof(inbuf)) {
+      if(timestamp) stamptime();
+      fprintf(stderr, "*** dropping large %d byte packet\n", inbufptr);
+      inbufptr = 0;
+    }
+    inbuf[inbufptr++] = c;
+    inbufptr = slip_echo(inbuf, inbufptr, c);
   }
-
-  goto read_more;
 }
 
-unsigned char slip_buf[2000];
+/*
+ * SLIP output buffer. Only one packet at a time is queued in it, except
+ * in batched mode where it collects all the packets read from tun.
+ */
+unsigned char slip_buf[BATCH_BUF_SIZE];
 int slip_end, slip_begin;
 
 void
@@ -389,6 +510,21 @@ slip_empty()
   return slip_end == 0;
 }
 
+/*
+ * Free space at the end of the output buffer, after moving what is
+ * still to be written to its start.
+ */
+int
+slip_room(void)
+{
+  if(slip_begin > 0) {
+    memmove(slip_buf, slip_buf + slip_begin, slip_end - slip_begin);
+    slip_end -= slip_begin;
+    slip_begin = 0;
+  }
+  return sizeof(slip_buf) - slip_end;
+}
+
 void
 slip_flushbuf(int fd)
 {
@@ -405,6 +541,7 @@ slip_flushbuf(int fd)
   } else if(n == -1) {
     PROGRESS("Q");		/* Outqueueis full! */
   } else {
+    stats.serial_out += n;
     slip_begin += n;
     if(slip_begin == slip_end) {
       slip_begin = slip_end = 0;
@@ -412,11 +549,21 @@ slip_flushbuf(int fd)
   }
 }
 
+static int
+slip_needs_escape(unsigned char c)
+{
+  return c == SLIP_END || c == SLIP_ESC ||
+    (flowcontrol_xonxoff && (c == XON || c == XOFF));
+}
+
 void
 write_to_serial(int outfd, void *inbuf, int len)
 {
   u_int8_t *p = inbuf;
-  int i;
+  int i, run;
+
+  stats.tun_packets++;
+  stats.tun_bytes += len;
 
   if(verbose>2) {
     if (timestamp) stamptime();
@@ -442,36 +589,22 @@ write_to_serial(int outfd, void *inbuf, int len)
    */
   /* slip_send(outfd, SLIP_END); */
 
-  for(i = 0; i < len; i++) {
-    switch(p[i]) {
-    case SLIP_END:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_END);
-      break;
-    case SLIP_ESC:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_ESC);
-      break;
-    case XON:
-      if(flowcontrol_xonxoff) {
-        slip_send(outfd, SLIP_ESC);
-        slip_send(outfd, SLIP_ESC_XON);
-      } else {
-        slip_send(outfd, p[i]);
-      }
-      break;
-    case XOFF:
-      if(flowcontrol_xonxoff) {
-        slip_send(outfd, SLIP_ESC);
-        slip_send(outfd, SLIP_ESC_XOFF);
-      } else {
-        slip_send(outfd, p[i]);
-      }
-      break;
-    default:
-      slip_send(outfd, p[i]);
-      break;
+  /* Worst case every byte is escaped */
+  if(slip_end + 2 * len + 1 > sizeof(slip_buf) && slip_room() < 2 * len + 1) {
+    err(1, "slip_send overflow");
+  }
+
+  /* Copy the runs of bytes that need no escaping as a whole */
+  i = 0;
+  while(i < len) {
+    for(run = i; run < len && !slip_needs_escape(p[run]); run++);
+    memcpy(slip_buf + slip_end, p + i, run - i);
+    slip_end += run - i;
+    if(run < len) {
+      slip_send_char(outfd, p[run]);
+      run++;
     }
+    i = run;
   }
   slip_send(outfd, SLIP_END);
   PROGRESS("t");
@@ -495,6 +628,34 @@ tun_to_serial(int infd, int outfd)
   return size;
 }
 
+/*
+ * Batched mode: read the packets waiting on the (nonblocking) tun device
+ * while they fit in the output buffer, so that they go out in one write.
+ * With -d only one packet is read, the delay applies between packets.
+ */
+int
+tun_to_serial_batch(int infd, int outfd)
+{
+  unsigned char inbuf[2000];
+  int size, n;
+
+  for(n = 0; slip_room() >= TUN_ROOM; n++) {
+    size = read(infd, inbuf, sizeof(inbuf));
+    if(size == -1) {
+      if(errno == EAGAIN || errno == EINTR) {
+        break;
+      }
+      err(1, "tun_to_serial: read");
+    }
+    write_to_serial(outfd, inbuf, size);
+    if(basedelay) {
+      n++;
+      break;
+    }
+  }
+  return n;
+}
+
 void
 stty_telos(int fd)
 {
@@ -658,6 +819,172 @@ sigalarm_reset()
   got_sigalarm = 0;
 }
 
+/*
+ * Optional delay between outgoing packets: returns 1 when the delay
+ * started by the last packet has passed.
+ */
+int
+delay_passed(void)
+{
+  if(delaymsec) {
+    struct timeval tv;
+    int dmsec;
+    gettimeofday(&tv, NULL) ;
+    dmsec=(tv.tv_sec-delaystartsec)*1000+tv.tv_usec/1000-delaystartmsec;
+    if(dmsec<0) delaymsec=0;
+    if(dmsec>delaymsec) delaymsec=0;
+  }
+  return delaymsec == 0;
+}
+
+void
+delay_start(void)
+{
+  if(basedelay) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL) ;
+ // delaymsec=basedelay*(1+(size/120));//multiply by # of 6lowpan packets?
+    delaymsec=basedelay;
+    delaystartsec =tv.tv_sec;
+    delaystartmsec=tv.tv_usec/1000;
+  }
+}
+
+void
+ipa_inquire(void)
+{
+  /* Send "?IPA". */
+  slip_send(slipfd, '?');
+  slip_send(slipfd, 'I');
+  slip_send(slipfd, 'P');
+  slip_send(slipfd, 'A');
+  slip_send(slipfd, SLIP_END);
+  got_sigalarm = 0;
+}
+
+#define RATE(f) ((stats.f - last_stats.f) * 1000 / msec)
+
+/* Print the traffic rates every stats_interval seconds */
+void
+stats_print(void)
+{
+  static struct timeval last;
+  struct timeval tv;
+  unsigned long msec;
+
+  gettimeofday(&tv, NULL);
+  if(last.tv_sec == 0) {
+    last = tv;
+    return;
+  }
+  msec = (tv.tv_sec - last.tv_sec) * 1000 +
+    (tv.tv_usec - last.tv_usec) / 1000;
+  if(msec < stats_interval * 1000) {
+    return;
+  }
+  if(timestamp) stamptime();
+  fprintf(stderr, "*** tun->slip %lu pkt/s %lu B/s, slip->tun %lu pkt/s %lu B/s,"
+          " serial out %lu B/s in %lu B/s\n",
+          RATE(tun_packets), RATE(tun_bytes),
+          RATE(slip_packets), RATE(slip_bytes),
+          RATE(serial_out), RATE(serial_in));
+  last_stats = stats;
+  last = tv;
+}
+
+#ifdef linux
+#include <sys/epoll.h>
+
+static void
+epoll_want(int epfd, int fd, uint32_t *cur, uint32_t want)
+{
+  struct epoll_event ev;
+
+  if(*cur == want) {
+    return;
+  }
+  memset(&ev, 0, sizeof(ev));
+  ev.events = want;
+  ev.data.fd = fd;
+  if(epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == -1) err(1, "epoll_ctl");
+  *cur = want;
+}
+
+/*
+ * Batched mode main loop: everything waiting on serial and tun is read
+ * at each wakeup, and the SLIP output is written in as few writes as
+ * the serial port takes.
+ */
+void
+batch_loop(int tunfd, int ipa_enable)
+{
+  struct epoll_event ev, events[2];
+  uint32_t slipev = 0, tunev = 0;
+  int epfd, n, i, timeout;
+
+  epfd = epoll_create(2);
+  if(epfd == -1) err(1, "epoll_create");
+  memset(&ev, 0, sizeof(ev));
+  ev.data.fd = slipfd;
+  if(epoll_ctl(epfd, EPOLL_CTL_ADD, slipfd, &ev) == -1) err(1, "epoll_ctl");
+  ev.data.fd = tunfd;
+  if(epoll_ctl(epfd, EPOLL_CTL_ADD, tunfd, &ev) == -1) err(1, "epoll_ctl");
+
+  while(1) {
+    if(got_sigalarm && ipa_enable) {
+      ipa_inquire();
+    }
+
+    /* Read from slip ASAP, write when there is anything to flush */
+    epoll_want(epfd, slipfd, &slipev,
+               EPOLLIN | (slip_empty() ? 0 : EPOLLOUT));
+
+    /* Read from tun while the output has room and no delay runs */
+    timeout = -1;
+    if(delay_passed() && slip_room() >= TUN_ROOM) {
+      epoll_want(epfd, tunfd, &tunev, EPOLLIN);
+    } else {
+      epoll_want(epfd, tunfd, &tunev, 0);
+      if(delaymsec) {
+        timeout = delaymsec;
+      }
+    }
+    if(stats_interval && (timeout == -1 || timeout > 1000)) {
+      timeout = 1000;
+    }
+
+    n = epoll_wait(epfd, events, 2, timeout);
+    if(n == -1) {
+      if(errno != EINTR) {
+        err(1, "epoll_wait");
+      }
+      n = 0;
+    }
+    for(i = 0; i < n; i++) {
+      if(events[i].data.fd == slipfd) {
+        if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+          serial_to_tun_batch(slipfd, tunfd);
+        }
+        if(events[i].events & EPOLLOUT) {
+          slip_flushbuf(slipfd);
+          if(ipa_enable) sigalarm_reset();
+        }
+      } else if(events[i].data.fd == tunfd) {
+        if(tun_to_serial_batch(tunfd, slipfd) > 0) {
+          slip_flushbuf(slipfd);
+          if(ipa_enable) sigalarm_reset();
+          delay_start();
+        }
+      }
+    }
+
+    if(stats_interval) {
+      stats_print();
+    }
+  }
+}
+#endif /* linux */
+
 void
 ifconf(const char *tundev, const char *ipaddr)
 {
@@ -749,6 +1076,7 @@ main(int argc, char **argv)
   int tunfd, maxfd;
   int ret;
   fd_set rset, wset;
+  struct timeval tv;
   FILE *inslip;
   const char *siodev = NULL;
   const char *host = NULL;
@@ -762,7 +1090,7 @@ main(int argc, char **argv)
   prog = argv[0];
   setvbuf(stdout, NULL, _IOLBF, 0); /* Line buffered output. */
 
-  while((c = getopt(argc, argv, "B:HILPhXM:s:t:v::d::a:p:T")) != -1) {
+  while((c = getopt(argc, argv, "B:HILPhXM:s:t:v::d::a:p:TbS:")) != -1) {
     switch(c) {
     case 'B':
       baudrate = atoi(optarg);
@@ -833,6 +1161,18 @@ main(int argc, char **argv)
       tap = 1;
       break;
 
+    case 'b':
+#ifdef linux
+      batch = 1;
+#else
+      fprintf(stderr, "Batched mode needs epoll, -b ignored\n");
+#endif
+      break;
+
+    case 'S':
+      stats_interval = atoi(optarg);
+      break;
+
     case '?':
     case 'h':
     default:
@@ -840,7 +1180,8 @@ fprintf(stderr,"usage:  %s [options] ipaddress\n", prog);
 fprintf(stderr,"example: tunslip6 -L -v2 -s ttyUSB1 aaaa::1/64\n");
 fprintf(stderr,"Options are:\n");
 #ifndef __APPLE__
-fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200 (default),230400,460800,921600\n");
+fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200 (default),230400,460800,921600,\n");
+fprintf(stderr,"                1000000,1152000,1500000,2000000,2500000,3000000,3500000,4000000\n");
 #else
 fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200 (default),230400\n");
 #endif
@@ -863,6 +1204,9 @@ fprintf(stderr,"    -v          Equivalent to -v3\n");
 fprintf(stderr," -d[basedelay]  Minimum delay between outgoing SLIP packets.\n");
 fprintf(stderr,"                Actual delay is basedelay*(#6LowPAN fragments) milliseconds.\n");
 fprintf(stderr,"                -d is equivalent to -d10.\n");
+fprintf(stderr," -b             Batched mode for high throughput links (linux only):\n");
+fprintf(stderr,"                several packets per serial write, whole buffer SLIP decoding\n");
+fprintf(stderr," -S seconds     Print packet and byte rates every seconds\n");
 fprintf(stderr," -a serveraddr  \n");
 fprintf(stderr," -p serverport  \n");
 exit(1);
@@ -973,19 +1317,20 @@ exit(1);
   signal(SIGALRM, sigalarm);
   ifconf(tundev, ipaddr);
 
+#ifdef linux
+  if(batch) {
+    if(fcntl(tunfd, F_SETFL, O_NONBLOCK) == -1) err(1, "fcntl");
+    batch_loop(tunfd, ipa_enable);
+  }
+#endif
+
   while(1) {
     maxfd = 0;
     FD_ZERO(&rset);
     FD_ZERO(&wset);
 
     if(got_sigalarm && ipa_enable) {
-      /* Send "?IPA". */
-      slip_send(slipfd, '?');
-      slip_send(slipfd, 'I');
-      slip_send(slipfd, 'P');
-      slip_send(slipfd, 'A');
-      slip_send(slipfd, SLIP_END);
-      got_sigalarm = 0;
+      ipa_inquire();
     }
 
     if(!slip_empty()) {		/* Anything to flush? */
@@ -1001,7 +1346,11 @@ exit(1);
       if(tunfd > maxfd) maxfd = tunfd;
     }
 
-    ret = select(maxfd + 1, &rset, &wset, NULL, NULL);
+    if(stats_interval) {
+      tv.tv_sec = 1;
+      tv.tv_usec = 0;
+    }
+    ret = select(maxfd + 1, &rset, &wset, NULL, stats_interval ? &tv : NULL);
     if(ret == -1 && errno != EINTR) {
       err(1, "select");
     } else if(ret > 0) {
@@ -1015,31 +1364,18 @@ exit(1);
       }
 
       /* Optional delay between outgoing packets */
-      /* Base delay times number of 6lowpan fragments to be sent */
-      if(delaymsec) {
-       struct timeval tv;
-       int dmsec;
-       gettimeofday(&tv, NULL) ;
-       dmsec=(tv.tv_sec-delaystartsec)*1000+tv.tv_usec/1000-delaystartmsec;
-       if(dmsec<0) delaymsec=0;
-       if(dmsec>delaymsec) delaymsec=0;
-      }
-      if(delaymsec==0) {
-        int size;
+      if(delay_passed()) {
         if(slip_empty() && FD_ISSET(tunfd, &rset)) {
-          size=tun_to_serial(tunfd, slipfd);
+          tun_to_serial(tunfd, slipfd);
           slip_flushbuf(slipfd);
           if(ipa_enable) sigalarm_reset();
-          if(basedelay) {
-            struct timeval tv;
-            gettimeofday(&tv, NULL) ;
- //         delaymsec=basedelay*(1+(size/120));//multiply by # of 6lowpan packets?
-            delaymsec=basedelay;
-            delaystartsec =tv.tv_sec;
-            delaystartmsec=tv.tv_usec/1000;
-          }
+          delay_start();
         }
       }
     }
+
+    if(stats_interval) {
+      stats_print();
+    }
   }
 }